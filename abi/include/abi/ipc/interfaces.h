@@ -96,6 +96,8 @@ typedef enum {
 	    FOURCC_COMPACT('v', 'f', 's', 'd') | IFACE_EXCHANGE_SERIALIZE,
 	INTERFACE_VFS_DRIVER_CB =
 	    FOURCC_COMPACT('v', 'f', 's', 'd') | IFACE_EXCHANGE_PARALLEL | IFACE_MOD_CALLBACK,
+	INTERFACE_VFS_DIRECT =
+	    FOURCC_COMPACT('v', 'f', 's', 'r') | IFACE_EXCHANGE_SERIALIZE,
 	INTERFACE_BLOCK =
 	    FOURCC_COMPACT('b', 'l', 'd', 'v') | IFACE_EXCHANGE_SERIALIZE,
 	INTERFACE_BLOCK_CB =
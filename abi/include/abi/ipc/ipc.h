@@ -35,6 +35,9 @@
 #ifndef ABI_IPC_IPC_H_
 #define ABI_IPC_IPC_H_
 
+#include <_bits/native.h>
+#include <abi/cap.h>
+
 /** Length of data being transferred with IPC call
  *
  * The uspace may not be able to utilize the full length
@@ -45,6 +48,9 @@
 /** Maximum active async calls per phone */
 #define IPC_MAX_ASYNC_CALLS  64
 
+/** Maximum number of calls made or received by a single batched syscall */
+#define IPC_BATCH_MAX  16
+
 /* Flags for calls */
 
 /** This is answer to a call */
@@ -68,6 +74,12 @@
  */
 #define DATA_XFER_LIMIT  (64 * 1024)
 
+/**
+ * Maximum size of the payload carried inline by a call made with
+ * SYS_IPC_CALL_ASYNC_PAYLOAD.
+ */
+#define IPC_PAYLOAD_MAX  256
+
 /* Macros for manipulating calling data */
 #define IPC_SET_RETVAL(data, retval)  ((data).args[0] = (sysarg_t) (retval))
 #define IPC_SET_IMETHOD(data, val)    ((data).args[0] = (val))
@@ -107,6 +119,16 @@
 /** User-defined IPC methods */
 #define IPC_FIRST_USER_METHOD  1024
 
+/** Asynchronous call made by SYS_IPC_CALL_ASYNC_BATCH */
+typedef struct {
+	/** Phone capability for the call */
+	cap_phone_handle_t phone;
+	/** Interface, method and payload arguments */
+	sysarg_t args[IPC_CALL_LEN];
+	/** User-defined label */
+	sysarg_t label;
+} ipc_batch_call_t;
+
 #endif
 
 /** @}
@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup generic
+ * @{
+ */
+/** @file
+ */
+
+#ifndef ABI_KTRACE_H_
+#define ABI_KTRACE_H_
+
+#include <stdint.h>
+
+/** Operations of the SYS_KTRACE syscall. */
+typedef enum {
+	/** Record the events in the mask passed as the argument. */
+	KTRACE_ENABLE,
+	/** Stop recording any events. */
+	KTRACE_DISABLE,
+	/** Sample the interrupted code every given number of CPU cycles. */
+	KTRACE_SAMPLE_START,
+	/** Stop sampling. */
+	KTRACE_SAMPLE_STOP,
+	/** Look up the name of the kernel function at the given address. */
+	KTRACE_SYMBOL
+} ktrace_operation_t;
+
+/** Kernel trace events.
+ *
+ * The meaning of the record arguments is given for each event.
+ */
+typedef enum {
+	/** Context switch: previous thread ID, next thread ID. */
+	KTRACE_SCHED_SWITCH,
+	/** Thread made ready: thread ID, ID of the target CPU. */
+	KTRACE_SCHED_WAKEUP,
+	/** Thread stolen by this CPU: thread ID, ID of the source CPU. */
+	KTRACE_SCHED_MIGRATE,
+	/** IPC request sent: call, method. */
+	KTRACE_IPC_CALL,
+	/** IPC answer sent: call, return value. */
+	KTRACE_IPC_ANSWER,
+	/** IPC request forwarded: call, method. */
+	KTRACE_IPC_FORWARD,
+	/** Page fault: faulting address, access type. */
+	KTRACE_PAGE_FAULT,
+	/** Interrupt or exception entry: vector, from uspace. */
+	KTRACE_IRQ_ENTRY,
+	/** Interrupt or exception exit: vector, cycles spent. */
+	KTRACE_IRQ_EXIT,
+	/** Profiling sample: interrupted PC, task ID or 0 for the kernel. */
+	KTRACE_SAMPLE,
+
+	KTRACE_EVENT_COUNT
+} ktrace_event_t;
+
+/** Mask of all kernel trace events. */
+#define KTRACE_ALL  ((UINT32_C(1) << KTRACE_EVENT_COUNT) - 1)
+
+/** Trace record. */
+typedef struct {
+	/** CPU cycle counter of the recording CPU. */
+	uint64_t timestamp;
+	/** ktrace_event_t */
+	uint32_t event;
+	/** ID of the recording CPU. */
+	uint32_t cpu;
+	/** Event-specific arguments. */
+	uint64_t arg[2];
+} ktrace_record_t;
+
+/** Header of the trace ring of one CPU.
+ *
+ * The headers of all CPUs form an array at the beginning of the trace
+ * area. The records of a ring are overwritten cyclically. Record n lives
+ * in slot n % capacity and is complete once head is past n. Readers must
+ * check head again after copying records, as records older than
+ * head - capacity may have been overwritten in the meantime.
+ */
+typedef struct {
+	/** Number of records ever written, modulo 2^32. */
+	uint32_t head;
+	/** Number of record slots, a power of two. */
+	uint32_t capacity;
+	/** Offset of the first record slot from the start of the area. */
+	uint32_t offset;
+	/** ID of the CPU. */
+	uint32_t cpu;
+	/** Padding to a cache line. */
+	uint8_t reserved[48];
+} ktrace_ring_t;
+
+#endif
+
+/** @}
+ */
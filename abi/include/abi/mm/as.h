@@ -44,12 +44,20 @@
 #define AS_AREA_CACHEABLE    0x08
 #define AS_AREA_GUARD        0x10
 #define AS_AREA_LATE_RESERVE 0x20
+#define AS_AREA_LARGE        0x40
+#define AS_AREA_POPULATE     0x80
 
 #define AS_AREA_ANY    ((void *) -1)
 #define AS_MAP_FAILED  ((void *) -1)
 
 #define AS_AREA_UNPAGED NULL
 
+/**
+ * Flag in ARG2 of a successful IPC_M_PAGE_IN answer. The page is shared
+ * with other address spaces and can only be mapped into read-only areas.
+ */
+#define AS_PAGE_IN_SHARED  0x01
+
 /** Address space area info exported to uspace. */
 typedef struct {
 	/** Starting address */
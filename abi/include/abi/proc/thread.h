@@ -39,6 +39,18 @@
 
 typedef uint64_t thread_id_t;
 
+/** Maximum number of CPUs which can be described by cpuset_t */
+#define CPUSET_MAX_CPUS  256
+
+/** Set of CPUs
+ *
+ * Used to describe the CPU affinity of threads and tasks.
+ * CPU with ID i is represented by bit (i % 32) of mask[i / 32].
+ */
+typedef struct {
+	uint32_t mask[CPUSET_MAX_CPUS / 32];
+} cpuset_t;
+
 /** Thread states */
 typedef enum {
 	/** It is an error, if thread is found in this state. */
@@ -47,6 +47,13 @@
 /** Futex operation (makes sleep with timeout composable). */
 #define SYNCH_FLAGS_FUTEX          (1 << 2)
 
+/** Futex private to the calling task (looked up by virtual address). */
+#define FUTEX_PRIVATE  0
+/** Futex possibly shared with other tasks (looked up by physical address). */
+#define FUTEX_SHARED   (1 << 0)
+/** Futex used as a lock whose owner inherits the priority of waiters. */
+#define FUTEX_PI       (1 << 1)
+
 #endif
 
 /** @}
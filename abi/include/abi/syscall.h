@@ -43,11 +43,13 @@ typedef enum {
 	SYS_THREAD_GET_ID,
 	SYS_THREAD_USLEEP,
 	SYS_THREAD_UDELAY,
+	SYS_THREAD_SET_AFFINITY,
 
 	SYS_TASK_GET_ID,
 	SYS_TASK_SET_NAME,
 	SYS_TASK_KILL,
 	SYS_TASK_EXIT,
+	SYS_TASK_SET_AFFINITY,
 	SYS_PROGRAM_SPAWN_LOADER,
 
 	SYS_FUTEX_SLEEP,
@@ -64,11 +66,15 @@ typedef enum {
 
 	SYS_IPC_CALL_ASYNC_FAST,
 	SYS_IPC_CALL_ASYNC_SLOW,
+	SYS_IPC_CALL_ASYNC_BATCH,
+	SYS_IPC_CALL_ASYNC_PAYLOAD,
 	SYS_IPC_ANSWER_FAST,
 	SYS_IPC_ANSWER_SLOW,
 	SYS_IPC_FORWARD_FAST,
 	SYS_IPC_FORWARD_SLOW,
 	SYS_IPC_WAIT,
+	SYS_IPC_WAIT_BATCH,
+	SYS_IPC_PAYLOAD_GET,
 	SYS_IPC_POKE,
 	SYS_IPC_HANGUP,
 	SYS_IPC_CONNECT_KBOX,
@@ -89,6 +95,8 @@ typedef enum {
 
 	SYS_IPC_IRQ_SUBSCRIBE,
 	SYS_IPC_IRQ_UNSUBSCRIBE,
+	SYS_IPC_IRQ_COALESCE,
+	SYS_IPC_IRQ_SET_AFFINITY,
 
 	SYS_SYSINFO_GET_KEYS_SIZE,
 	SYS_SYSINFO_GET_KEYS,
@@ -100,6 +108,7 @@ typedef enum {
 	SYS_DEBUG_CONSOLE,
 
 	SYS_KLOG,
+	SYS_KTRACE,
 
 	SYSCALL_END
 } syscall_t;
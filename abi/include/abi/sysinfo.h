@@ -36,6 +36,7 @@
 #ifndef ABI_SYSINFO_H_
 #define ABI_SYSINFO_H_
 
+#include <_bits/native.h>
 #include <abi/bool.h>
 #include <abi/proc/task.h>
 #include <abi/proc/thread.h>
@@ -47,6 +48,16 @@
 /** Maximum name sizes */
 #define TASK_NAME_BUFLEN  20
 #define EXC_NAME_BUFLEN   20
+#define SLAB_NAME_BUFLEN  20
+
+/** IPC latency histogram
+ *
+ * Bucket i counts the calls answered within 2^(i + STATS_IPC_LATENCY_SHIFT)
+ * CPU cycles of being sent, but not within the bound of the preceding
+ * bucket. The last bucket also counts all slower calls.
+ */
+#define STATS_IPC_LATENCY_BUCKETS  16
+#define STATS_IPC_LATENCY_SHIFT    10
 
 /** Item value type
  *
@@ -63,13 +74,25 @@ typedef enum {
  *
  */
 typedef struct {
-	unsigned int id;         /**< CPU ID as stored by kernel */
-	bool active;             /**< CPU is activate */
-	uint16_t frequency_mhz;  /**< Frequency in MHz */
-	uint64_t idle_cycles;    /**< Number of idle cycles */
-	uint64_t busy_cycles;    /**< Number of busy cycles */
+	unsigned int id;           /**< CPU ID as stored by kernel */
+	bool active;               /**< CPU is activate */
+	uint16_t frequency_mhz;    /**< Frequency in MHz */
+	uint64_t idle_cycles;      /**< Number of idle cycles */
+	uint64_t busy_cycles;      /**< Number of busy cycles */
+	uint64_t steal_attempts;   /**< Number of idle work-stealing attempts */
+	uint64_t steal_successes;  /**< Number of threads stolen when idle */
+	uint64_t nrdy;             /**< Number of threads in the run queues */
 } stats_cpu_t;
 
+/** Interrupts of a single INR handled by a single CPU
+ *
+ */
+typedef struct {
+	unsigned int inr;  /**< Interrupt number */
+	unsigned int cpu;  /**< CPU ID as stored by kernel */
+	uint64_t count;    /**< Number of interrupts handled */
+} stats_irq_t;
+
 /** Physical memory statistics
  *
  */
@@ -92,8 +115,33 @@ typedef struct {
 	uint64_t answer_received;     /**< IPC answers received */
 	uint64_t irq_notif_received;  /**< IPC IRQ notifications */
 	uint64_t forwarded;           /**< IPC messages forwarded */
+	uint64_t bytes_copied;        /**< IPC data bytes copied into the task */
+	/** Latencies of the calls made by the task */
+	uint64_t latency[STATS_IPC_LATENCY_BUCKETS];
 } stats_ipc_t;
 
+/** IPC statistics of a phone
+ *
+ */
+typedef struct {
+	uint64_t call_sent;        /**< IPC calls sent */
+	uint64_t answer_received;  /**< IPC answers received */
+	uint64_t forwarded;        /**< IPC messages forwarded to the phone */
+	uint64_t bytes_copied;     /**< IPC data bytes transferred */
+	/** Latencies of the calls made through the phone */
+	uint64_t latency[STATS_IPC_LATENCY_BUCKETS];
+} stats_ipc_phone_t;
+
+/** Statistics about a single phone
+ *
+ */
+typedef struct {
+	task_id_t task_id;           /**< Task owning the phone */
+	sysarg_t handle;             /**< Capability handle of the phone */
+	task_id_t callee_id;         /**< Connected task ID or 0 */
+	stats_ipc_phone_t ipc_info;  /**< IPC statistics */
+} stats_phone_t;
+
 /** Statistics about a single task
  *
  */
@@ -105,6 +153,8 @@ typedef struct {
 	size_t threads;               /**< Number of threads */
 	uint64_t ucycles;             /**< Number of CPU cycles in user space */
 	uint64_t kcycles;             /**< Number of CPU cycles in kernel */
+	uint64_t page_faults;         /**< Page faults serviced */
+	uint64_t pages_prefaulted;    /**< Pages mapped ahead of access */
 	stats_ipc_t ipc_info;         /**< IPC statistics */
 } stats_task_t;
 
@@ -133,6 +183,21 @@ typedef struct {
 	uint64_t count;              /**< Number of handled exceptions */
 } stats_exc_t;
 
+/** Statistics about a single slab cache
+ *
+ */
+typedef struct {
+	char name[SLAB_NAME_BUFLEN];  /**< Cache name */
+	uint64_t size;                /**< Object size (bytes) */
+	uint64_t slabs;               /**< Number of allocated slabs */
+	uint64_t allocated;           /**< Number of allocated objects */
+	uint64_t cached;              /**< Number of objects in magazines */
+	uint64_t mag_size;            /**< Size of newly allocated magazines */
+	uint64_t hits;                /**< Allocations served from magazines */
+	uint64_t misses;              /**< Allocations passed to the slab layer */
+	uint64_t contention;          /**< Contended magazine depot locks */
+} stats_slab_t;
+
 /** Load fixed-point value */
 typedef uint32_t load_t;
 
@@ -35,6 +35,10 @@
 #ifndef ABI_UDEBUG_H_
 #define ABI_UDEBUG_H_
 
+#include <_bits/native.h>
+#include <abi/syscall.h>
+#include <stdint.h>
+
 #define UDEBUG_EVMASK(event)  (1 << ((event) - 1))
 
 typedef enum { /* udebug_method_t */
@@ -150,7 +154,54 @@ typedef enum { /* udebug_method_t */
 	 * - ARG4 - size of receiving buffer in bytes
 	 *
 	 */
-	UDEBUG_M_MEM_READ
+	UDEBUG_M_MEM_READ,
+
+	/** Set the event filter.
+	 *
+	 * - ARG2 - address of a udebug_filter_t structure in the caller's
+	 *          address space or 0 to remove the filter
+	 *
+	 * Syscall events are only generated for syscalls selected by
+	 * the filter. The filter applies both to the stop mode and to
+	 * the log mode.
+	 *
+	 */
+	UDEBUG_M_SET_FILTER,
+
+	/** Switch the debugged task to the log mode.
+	 *
+	 * - ARG2 - capacity of the event log in entries
+	 *
+	 * All threads must be stopped. They are resumed and their events
+	 * are recorded into a per-task log instead of stopping them. The
+	 * log is drained with UDEBUG_M_LOG_READ. The GO and STOP methods
+	 * are refused while in the log mode.
+	 *
+	 */
+	UDEBUG_M_LOG_START,
+
+	/** Switch the debugged task back to the stop mode.
+	 *
+	 * All threads stop at their next stopping point and wait for GO.
+	 * Entries remaining in the log can still be read.
+	 *
+	 */
+	UDEBUG_M_LOG_STOP,
+
+	/** Read and remove entries from the event log.
+	 *
+	 * - ARG2 - destination address in the caller's address space
+	 * - ARG3 - size of receiving buffer in bytes
+	 *
+	 * The kernel fills the buffer with udebug_log_entry_t structures
+	 * and does not block if the log is empty. Upon answer, the kernel
+	 * will set:
+	 *
+	 * - ARG2 - number of bytes that were actually copied
+	 * - ARG3 - number of events lost to a full log since the last read
+	 *
+	 */
+	UDEBUG_M_LOG_READ
 } udebug_method_t;
 
 typedef enum {
@@ -178,6 +229,43 @@ typedef enum {
 	    UDEBUG_EVMASK(UDEBUG_EVENT_THREAD_E))
 } udebug_evmask_t;
 
+/** Number of words of the syscall mask of the filter */
+#define UDEBUG_FILTER_SC_WORDS  ((SYSCALL_END + 31) / 32)
+
+/** Maximum number of IPC methods the filter can select */
+#define UDEBUG_FILTER_METHODS_MAX  8
+
+/** Syscall event filter.
+ *
+ * A syscall passes the filter if its bit in @c sc_mask is set. If
+ * @c methods_cnt is non-zero, IPC syscalls sending, forwarding or
+ * receiving a call must additionally carry one of the listed methods.
+ * Answers received by SYS_IPC_WAIT do not pass such a filter.
+ */
+typedef struct {
+	uint32_t sc_mask[UDEBUG_FILTER_SC_WORDS];
+	sysarg_t methods_cnt;
+	sysarg_t methods[UDEBUG_FILTER_METHODS_MAX];
+} udebug_filter_t;
+
+/** Entry of the event log.
+ *
+ * For SYSCALL_B and SYSCALL_E events, @c val0 is the syscall number,
+ * @c val1 the return value (SYSCALL_E only) and @c args the syscall
+ * arguments. For THREAD_B events, @c val0 is the hash of the new thread.
+ */
+typedef struct {
+	/** udebug_event_t */
+	sysarg_t type;
+	/** Hash of the thread generating the event */
+	sysarg_t thash;
+	sysarg_t val0;
+	sysarg_t val1;
+	sysarg_t args[6];
+	/** Uptime in nanoseconds */
+	uint64_t timestamp;
+} udebug_log_entry_t;
+
 #endif
 
 /** @}
@@ -31,12 +31,14 @@
  * @brief Implementation of inflate decompression
  *
  * A simple inflate implementation (decompression of `deflate' stream as
- * described by RFC 1951) based on puff.c by Mark Adler. It is not optimized
- * for speed but for readability as it is used as part of the bootloader and
- * any miss-optimization might be hard to debug.
+ * described by RFC 1951) based on puff.c by Mark Adler. The structure
+ * follows puff.c, but Huffman codes of up to FAST_BITS bits are decoded
+ * by a single table lookup instead of bit by bit, using the same tables
+ * as the inflate in uspace/lib/compress.
  *
- * All dynamically allocated memory memory is taken from the stack. The
- * stack usage should be typically bounded by 2 KB.
+ * The lookup tables are static, as the boot loader is single-threaded
+ * and runs on small stacks. Apart from them, all memory is taken from
+ * the stack. The stack usage should be typically bounded by 2 KB.
  *
  * Original copyright notice:
  *
@@ -66,6 +68,7 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <errno.h>
 #include <memstr.h>
 #include <inflate.h>
@@ -87,6 +90,15 @@
 /** Number of all codes */
 #define MAX_CODE  (MAX_LITLEN + MAX_DIST)
 
+/** Number of bits decoded by a single lookup in the fast table */
+#define FAST_BITS  9
+#define FAST_SIZE  (1 << FAST_BITS)
+#define FAST_MASK  (FAST_SIZE - 1)
+
+/** Fast table entry: code length above the symbol, zero length if absent */
+#define FAST_SYMBOL_BITS  9
+#define FAST_SYMBOL_MASK  ((1 << FAST_SYMBOL_BITS) - 1)
+
 /** Check for input buffer overrun condition */
 #define CHECK_OVERRUN(state) \
 	do { \
@@ -107,7 +119,7 @@ typedef struct {
 	size_t srclen;    /**< Input buffer size */
 	size_t srccnt;    /**< Position in the input buffer */
 
-	uint16_t bitbuf;  /**< Bit buffer */
+	uint32_t bitbuf;  /**< Bit buffer */
 	size_t bitlen;    /**< Number of bits in the bit buffer */
 
 	bool overrun;     /**< Overrun condition */
@@ -119,6 +131,7 @@ typedef struct {
 typedef struct {
 	uint16_t *count;   /**< Array of symbol counts */
 	uint16_t *symbol;  /**< Array of symbols */
+	uint16_t *fast;    /**< Lookup table for codes of up to FAST_BITS */
 } huffman_t;
 
 /** Length codes
@@ -211,12 +224,28 @@ static uint16_t dist_symbol[MAX_DIST] = {
 	16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29
 };
 
+/** Static length lookup table */
+static uint16_t len_fast[FAST_SIZE];
+
+/** Static distance lookup table */
+static uint16_t dist_fast[FAST_SIZE];
+
+/** Static lookup tables have been filled */
+static bool fixed_ready = false;
+
+/** Dynamic length lookup table */
+static uint16_t dyn_len_fast[FAST_SIZE];
+
+/** Dynamic distance lookup table */
+static uint16_t dyn_dist_fast[FAST_SIZE];
+
 /** Huffman code for lengths
  *
  */
 static huffman_t len_code = {
 	.count = len_count,
-	.symbol = len_symbol
+	.symbol = len_symbol,
+	.fast = len_fast
 };
 
 /** Huffman code for distances
@@ -224,9 +253,28 @@ static huffman_t len_code = {
  */
 static huffman_t dist_code = {
 	.count = dist_count,
-	.symbol = dist_symbol
+	.symbol = dist_symbol,
+	.fast = dist_fast
 };
 
+/** Load bits into the bit buffer without consuming them
+ *
+ * Fewer bits are loaded if the input ends earlier.
+ *
+ * @param state Inflate state.
+ * @param cnt   Number of bits to have in the bit buffer (at most 24).
+ *
+ */
+static inline void load_bits(inflate_state_t *state, size_t cnt)
+{
+	while ((state->bitlen < cnt) && (state->srccnt < state->srclen)) {
+		state->bitbuf |= ((uint32_t) state->src[state->srccnt]) <<
+		    state->bitlen;
+		state->srccnt++;
+		state->bitlen += 8;
+	}
+}
+
 /** Get bits from the bit buffer
  *
  * @param state Inflate state.
@@ -237,26 +285,19 @@ static huffman_t dist_code = {
  */
 static inline uint16_t get_bits(inflate_state_t *state, size_t cnt)
 {
-	/* Bit accumulator for at least 20 bits */
-	uint32_t val = state->bitbuf;
-
-	while (state->bitlen < cnt) {
-		if (state->srccnt == state->srclen) {
-			state->overrun = true;
-			return 0;
-		}
-
-		/* Load 8 more bits */
-		val |= ((uint32_t) state->src[state->srccnt]) << state->bitlen;
-		state->srccnt++;
-		state->bitlen += 8;
+	load_bits(state, cnt);
+	if (state->bitlen < cnt) {
+		state->overrun = true;
+		return 0;
 	}
 
+	uint16_t val = (uint16_t) (state->bitbuf & ((1 << cnt) - 1));
+
 	/* Update bits in the buffer */
-	state->bitbuf = (uint16_t) (val >> cnt);
+	state->bitbuf >>= cnt;
 	state->bitlen -= cnt;
 
-	return ((uint16_t) (val & ((1 << cnt) - 1)));
+	return val;
 }
 
 /** Decode `stored' block
@@ -271,23 +312,25 @@ static inline uint16_t get_bits(inflate_state_t *state, size_t cnt)
  */
 static int inflate_stored(inflate_state_t *state)
 {
-	/* Discard bits in the bit buffer */
-	state->bitbuf = 0;
-	state->bitlen = 0;
+	/* Discard bits up to the byte boundary */
+	size_t skip = state->bitlen & 7;
+	state->bitbuf >>= skip;
+	state->bitlen -= skip;
 
-	if (state->srccnt + 4 > state->srclen)
-		return ELIMIT;
+	uint16_t len = get_bits(state, 16);
+	CHECK_OVERRUN(*state);
 
-	uint16_t len =
-	    state->src[state->srccnt] | (state->src[state->srccnt + 1] << 8);
-	uint16_t len_compl =
-	    state->src[state->srccnt + 2] | (state->src[state->srccnt + 3] << 8);
+	uint16_t len_compl = get_bits(state, 16);
+	CHECK_OVERRUN(*state);
 
 	/* Check block length and its complement */
-	if (((int16_t) len) != ~((int16_t) len_compl))
+	if ((len ^ len_compl) != 0xffff)
 		return EINVAL;
 
-	state->srccnt += 4;
+	/* Return whole bytes read ahead into the bit buffer to the input */
+	state->srccnt -= state->bitlen / 8;
+	state->bitbuf = 0;
+	state->bitlen = 0;
 
 	/* Check input buffer size */
 	if (state->srccnt + len > state->srclen)
@@ -318,6 +361,18 @@ static int inflate_stored(inflate_state_t *state)
 static int huffman_decode(inflate_state_t *state, huffman_t *huffman,
     uint16_t *symbol)
 {
+	/* Short codes are resolved by a single lookup */
+	load_bits(state, FAST_BITS);
+
+	uint16_t entry = huffman->fast[state->bitbuf & FAST_MASK];
+	size_t fast_len = entry >> FAST_SYMBOL_BITS;
+	if ((fast_len != 0) && (fast_len <= state->bitlen)) {
+		state->bitbuf >>= fast_len;
+		state->bitlen -= fast_len;
+		*symbol = entry & FAST_SYMBOL_MASK;
+		return EOK;
+	}
+
 	/* Decoded bits */
 	uint16_t code = 0;
 
@@ -353,6 +408,39 @@ static int huffman_decode(inflate_state_t *state, huffman_t *huffman,
 	return EINVAL;
 }
 
+/** Fill the fast lookup table of a Huffman code
+ *
+ * The bits of a code are read starting from its most significant bit,
+ * so each code is entered bit-reversed and replicated for all values
+ * of the bits following it.
+ *
+ * @param huffman Huffman code with valid counts and symbols.
+ *
+ */
+static void huffman_fast(huffman_t *huffman)
+{
+	uint16_t code = 0;
+	size_t index = 0;
+
+	for (size_t len = 1; len <= FAST_BITS; len++) {
+		for (size_t i = 0; i < huffman->count[len]; i++) {
+			uint16_t rev = 0;
+			for (size_t bit = 0; bit < len; bit++)
+				rev |= ((code >> bit) & 1) << (len - 1 - bit);
+
+			uint16_t entry = (len << FAST_SYMBOL_BITS) |
+			    huffman->symbol[index];
+			for (size_t fill = rev; fill < FAST_SIZE; fill += 1 << len)
+				huffman->fast[fill] = entry;
+
+			code++;
+			index++;
+		}
+
+		code <<= 1;
+	}
+}
+
 /** Construct Huffman tables from canonical Huffman code
  *
  * @param huffman Constructed Huffman tables.
@@ -366,6 +454,8 @@ static int huffman_decode(inflate_state_t *state, huffman_t *huffman,
  */
 static int16_t huffman_construct(huffman_t *huffman, uint16_t *length, size_t n)
 {
+	memset(huffman->fast, 0, FAST_SIZE * sizeof(uint16_t));
+
 	/* Count number of codes for each length */
 	size_t len;
 	for (len = 0; len <= MAX_HUFFMAN_BIT; len++)
@@ -406,6 +496,7 @@ static int16_t huffman_construct(huffman_t *huffman, uint16_t *length, size_t n)
 		}
 	}
 
+	huffman_fast(huffman);
 	return left;
 }
 
@@ -441,8 +532,7 @@ static int inflate_codes(inflate_state_t *state, huffman_t *len_code,
 			if (state->destcnt == state->destlen)
 				return ENOMEM;
 
-			state->dest[state->destcnt] = (uint8_t) symbol;
-			state->destcnt++;
+			state->dest[state->destcnt++] = (uint8_t) symbol;
 		} else if (symbol > 256) {
 			/* Compute length */
 			symbol -= 257;
@@ -458,17 +548,24 @@ static int inflate_codes(inflate_state_t *state, huffman_t *len_code,
 				return err;
 
 			size_t dist = dists[symbol] + get_bits(state, dists_ext[symbol]);
+			CHECK_OVERRUN(*state);
+
 			if (dist > state->destcnt)
 				return ENOENT;
 
 			if (state->destcnt + len > state->destlen)
 				return ENOMEM;
 
+			/*
+			 * Copy len bytes from distance bytes back. The areas
+			 * overlap if dist < len, so copy byte by byte.
+			 */
+			uint8_t *out = state->dest + state->destcnt;
+			const uint8_t *from = out - dist;
+			state->destcnt += len;
+
 			while (len > 0) {
-				/* Copy len bytes from distance bytes back */
-				state->dest[state->destcnt] =
-				    state->dest[state->destcnt - dist];
-				state->destcnt++;
+				*out++ = *from++;
 				len--;
 			}
 		}
@@ -493,6 +590,12 @@ static int inflate_codes(inflate_state_t *state, huffman_t *len_code,
 static int inflate_fixed(inflate_state_t *state, huffman_t *len_code,
     huffman_t *dist_code)
 {
+	if (!fixed_ready) {
+		huffman_fast(len_code);
+		huffman_fast(dist_code);
+		fixed_ready = true;
+	}
+
 	return inflate_codes(state, len_code, dist_code);
 }
 
@@ -519,9 +622,11 @@ static int inflate_dynamic(inflate_state_t *state)
 
 	dyn_len_code.count = dyn_len_count;
 	dyn_len_code.symbol = dyn_len_symbol;
+	dyn_len_code.fast = dyn_len_fast;
 
 	dyn_dist_code.count = dyn_dist_count;
 	dyn_dist_code.symbol = dyn_dist_symbol;
+	dyn_dist_code.fast = dyn_dist_fast;
 
 	/* Get number of bits in each table */
 	uint16_t nlen = get_bits(state, 5) + 257;
@@ -559,7 +664,7 @@ static int inflate_dynamic(inflate_state_t *state)
 		uint16_t symbol;
 		int err = huffman_decode(state, &dyn_len_code, &symbol);
 		if (err != EOK)
-			return EOK;
+			return err;
 
 		if (symbol < 16) {
 			length[index] = symbol;
@@ -187,6 +187,15 @@ NO_TRACE static inline bool interrupts_disabled(void)
 	return false;
 }
 
+NO_TRACE static inline void cpu_interruptible_sleep(void)
+{
+	/*
+	 * On real hardware this should enable interrupts and put the
+	 * CPU into low-power mode atomically, so that an interrupt
+	 * coming in between cannot be missed.
+	 */
+}
+
 NO_TRACE static inline uintptr_t get_stack_base(void)
 {
 	/*
@@ -69,6 +69,21 @@ NO_TRACE static inline void cpu_sleep(void)
 	);
 }
 
+/** Enable interrupts and sleep until an interrupt comes
+ *
+ * STI delays the recognition of interrupts until after the next
+ * instruction, so an interrupt cannot slip in between enabling the
+ * interrupts and halting and leave the processor asleep.
+ *
+ */
+NO_TRACE static inline void cpu_interruptible_sleep(void)
+{
+	asm volatile (
+	    "sti\n"
+	    "hlt\n"
+	);
+}
+
 NO_TRACE static inline void __attribute__((noreturn)) cpu_halt(void)
 {
 	while (true) {
@@ -319,6 +334,17 @@ NO_TRACE static inline sysarg_t read_msr(uint32_t msr)
 	return ((uint64_t) dx << 32) | ax;
 }
 
+/** Write to extended control register */
+NO_TRACE static inline void write_xcr(uint32_t xcr, uint64_t value)
+{
+	asm volatile (
+	    "xsetbv\n"
+	    :: "c" (xcr),
+	      "a" ((uint32_t) (value)),
+	      "d" ((uint32_t) (value >> 32))
+	);
+}
+
 /** Invalidate TLB Entry.
  *
  * @param addr Address on a page whose TLB entry is to be invalidated.
@@ -332,6 +358,33 @@ NO_TRACE static inline void invlpg(uintptr_t addr)
 	);
 }
 
+/** INVPCID invalidation types. */
+#define INVPCID_ADDRESS       0  /**< One address of one PCID. */
+#define INVPCID_CONTEXT       1  /**< All addresses of one PCID. */
+#define INVPCID_ALL_GLOBAL    2  /**< All PCIDs including global entries. */
+
+/** Invalidate TLB entries tagged with a PCID.
+ *
+ * @param type INVPCID_ADDRESS, INVPCID_CONTEXT or INVPCID_ALL_GLOBAL.
+ * @param pcid PCID of the entries to invalidate.
+ * @param addr Address to invalidate for INVPCID_ADDRESS.
+ *
+ */
+NO_TRACE static inline void invpcid(uint64_t type, uint64_t pcid,
+    uintptr_t addr)
+{
+	struct {
+		uint64_t pcid;
+		uint64_t addr;
+	} desc = { pcid, addr };
+
+	asm volatile (
+	    "invpcid %[desc], %[type]\n"
+	    :: [desc] "m" (desc), [type] "r" (type)
+	    : "memory"
+	);
+}
+
 /** Load GDTR register from memory.
  *
  * @param gdtr_reg Address of memory from where to load GDTR.
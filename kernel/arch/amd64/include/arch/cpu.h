@@ -53,11 +53,23 @@
 #define CR0_MP		(1 << 1)
 #define CR0_EM		(1 << 2)
 #define CR0_TS		(1 << 3)
+#define CR0_WP		(1 << 16)
 #define CR0_AM		(1 << 18)
 #define CR0_PG		(1 << 31)
 
 #define CR4_PAE		(1 << 5)
 #define CR4_OSFXSR	(1 << 9)
+#define CR4_PCIDE	(1 << 17)
+#define CR4_OSXSAVE	(1 << 18)
+
+/* XCR0 state components */
+#define XCR0		0
+#define XCR0_X87	(1 << 0)
+#define XCR0_SSE	(1 << 1)
+#define XCR0_AVX	(1 << 2)
+
+/* Do not invalidate TLB entries tagged with the PCID being loaded */
+#define CR3_NOFLUSH	(UINT64_C(1) << 63)
 
 /* EFER bits */
 #define AMD_SCE		(1 << 0)
@@ -92,6 +104,9 @@ typedef struct {
 	unsigned int id; /** CPU's local, ie physical, APIC ID. */
 
 	size_t iomapver_copy;  /** Copy of TASK's I/O Permission bitmap generation count. */
+
+	uint32_t apic_timer_period;   /** Local APIC timer count per clock tick. */
+	uint32_t apic_timer_oneshot;  /** Count of the pending one-shot. */
 } cpu_arch_t;
 
 struct star_msr {
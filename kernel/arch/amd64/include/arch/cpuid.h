@@ -39,11 +39,23 @@
 #define AMD_EXT_NOEXECUTE   20
 #define AMD_EXT_LONG_MODE   29
 
+#define AMD_CPUID_APM       0x80000007
+#define AMD_APM_INVARIANT_TSC  8
+
 #define INTEL_CPUID_LEVEL     0x00000000
 #define INTEL_CPUID_STANDARD  0x00000001
 #define INTEL_CPUID_EXTENDED  0x80000000
 #define INTEL_SSE2            26
 #define INTEL_FXSAVE          24
+#define INTEL_PCID            17
+#define INTEL_XSAVE           26
+#define INTEL_AVX             28
+
+#define INTEL_CPUID_FEATURES  0x00000007
+#define INTEL_INVPCID         10
+
+#define INTEL_CPUID_XSAVE     0x0000000d
+#define INTEL_XSAVEOPT        0
 
 #ifndef __ASSEMBLER__
 
@@ -59,6 +71,7 @@ typedef struct {
 extern int has_cpuid(void);
 
 extern void cpuid(uint32_t cmd, cpu_info_t *info);
+extern void cpuid_subleaf(uint32_t cmd, uint32_t subleaf, cpu_info_t *info);
 
 #endif /* !def __ASSEMBLER__ */
 #endif
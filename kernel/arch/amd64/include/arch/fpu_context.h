@@ -1 +0,0 @@
-../../../ia32/include/arch/fpu_context.h
\ No newline at end of file
@@ -41,6 +41,10 @@
 #define PAGE_WIDTH  FRAME_WIDTH
 #define PAGE_SIZE   FRAME_SIZE
 
+/* Large pages are mapped directly by PTL2 entries. */
+#define LARGE_PAGE_WIDTH  21
+#define LARGE_PAGE_SIZE   (1 << LARGE_PAGE_WIDTH)
+
 #ifdef MEMORY_MODEL_kernel
 
 #ifndef __ASSEMBLER__
@@ -107,8 +111,14 @@
 	    (((uint64_t) ((pte_t *) (ptl3))[(i)].addr_32_51) << 32)))
 
 /* Set PTE address accessors for each level. */
+#ifdef CONFIG_ASID
+/* With PCIDs, CR3 is loaded together with the PCID in as_install_arch(). */
+#define SET_PTL0_ADDRESS_ARCH(ptl0) \
+	((void) (pcid_enabled || (write_cr3((uintptr_t) (ptl0)), false)))
+#else
 #define SET_PTL0_ADDRESS_ARCH(ptl0) \
 	(write_cr3((uintptr_t) (ptl0)))
+#endif
 #define SET_PTL1_ADDRESS_ARCH(ptl0, i, a) \
 	set_pt_addr((pte_t *) (ptl0), (size_t) (i), a)
 #define SET_PTL2_ADDRESS_ARCH(ptl1, i, a) \
@@ -148,6 +158,12 @@
 #define SET_FRAME_PRESENT_ARCH(ptl3, i) \
 	set_pt_present((pte_t *) (ptl3), (size_t) (i))
 
+/* Large page accessors for PTL2 entries. */
+#define GET_PTL3_LARGE_ARCH(ptl2, i) \
+	(((pte_t *) (ptl2))[(i)].page_size != 0)
+#define SET_PTL3_LARGE_ARCH(ptl2, i, x) \
+	(((pte_t *) (ptl2))[(i)].page_size = ((x) ? 1 : 0))
+
 /* Macros for querying the last-level PTE entries. */
 #define PTE_VALID_ARCH(p) \
 	((p)->soft_valid != 0)
@@ -165,6 +181,7 @@
 
 #include <mm/mm.h>
 #include <arch/interrupt.h>
+#include <arch/mm/tlb.h>
 #include <typedefs.h>
 
 /* Page fault error codes. */
@@ -197,7 +214,7 @@ typedef struct {
 	unsigned int page_cache_disable : 1;
 	unsigned int accessed : 1;
 	unsigned int dirty : 1;
-	unsigned int unused : 1;
+	unsigned int page_size : 1;  /**< Maps a large page (PTL2 entries only). */
 	unsigned int global : 1;
 	unsigned int soft_valid : 1;  /**< Valid content even if present bit is cleared. */
 	unsigned int avl : 2;
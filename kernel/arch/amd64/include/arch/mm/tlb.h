@@ -35,6 +35,15 @@
 #ifndef KERN_amd64_TLB_H_
 #define KERN_amd64_TLB_H_
 
+#ifndef __ASSEMBLER__
+
+#include <stdbool.h>
+
+/** True if address spaces are tagged with PCIDs. */
+extern bool pcid_enabled;
+
+#endif /* __ASSEMBLER__ */
+
 #endif
 
 /** @}
@@ -113,6 +113,10 @@ void amd64_pre_mm_init(void)
 	write_rflags(read_rflags() & ~(RFLAGS_IOPL | RFLAGS_NT));
 	/* Disable alignment check */
 	write_cr0(read_cr0() & ~CR0_AM);
+#ifdef CONFIG_PAGE_MERGE
+	/* Make kernel writes fault on write-protected merged pages */
+	write_cr0(read_cr0() | CR0_WP);
+#endif
 
 	if (config.cpu_active == 1) {
 		interrupt_init();
@@ -130,7 +134,7 @@ void amd64_post_mm_init(void)
 
 	if (config.cpu_active == 1) {
 		/* Initialize IRQ routing */
-		irq_init(IRQ_COUNT, IRQ_COUNT);
+		irq_init(IRQ_COUNT + MSI_COUNT, IRQ_COUNT + MSI_COUNT);
 
 		/* hard clock */
 		i8254_init();
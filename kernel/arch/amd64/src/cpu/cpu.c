@@ -71,11 +71,13 @@ static const char *vendor_str[] = {
  * cr0.osfxsr = 1 -> we do support fxstor/fxrestor
  * cr0.em = 0 -> we do not emulate coprocessor
  * cr0.mp = 1 -> we do want lazy context switch
+ * cr4.osxsave = 1 -> we do support xsave/xrstor, if the CPU does
  */
 void cpu_setup_fpu(void)
 {
 	write_cr0((read_cr0() & ~CR0_EM) | CR0_MP);
 	write_cr4(read_cr4() | CR4_OSFXSR);
+	fpu_xsave_init();
 }
 
 /** Set the TS flag to 1.
@@ -34,27 +34,145 @@
  */
 
 #include <fpu_context.h>
+#include <arch/asm.h>
+#include <arch/cpu.h>
+#include <arch/cpuid.h>
+#include <config.h>
+#include <panic.h>
+#include <stdbool.h>
 
-/** Save FPU (mmx, sse) context using fxsave instruction */
+typedef enum {
+	FPU_SAVE_FXSAVE,
+	FPU_SAVE_XSAVE,
+	FPU_SAVE_XSAVEOPT
+} fpu_save_t;
+
+/** Instruction used to save the context, decided on the bootstrap CPU */
+static fpu_save_t fpu_save = FPU_SAVE_FXSAVE;
+
+/** State components enabled in XCR0 and saved with each context */
+static uint64_t fpu_xcr0 = XCR0_X87 | XCR0_SSE;
+
+/** Pristine XSAVE image restored into the registers of a new context
+ *
+ * All state components are marked as being in their initial
+ * configuration by the zeroed XSAVE header, only MXCSR is loaded
+ * from the image. The default value 0x1f80 masks all SSE exceptions.
+ */
+static fpu_context_t fpu_clean __attribute__((aligned(FPU_CONTEXT_ALIGN))) = {
+	.fpu = {
+		[24] = 0x80,
+		[25] = 0x1f
+	}
+};
+
+/** Enable XSAVE on the current CPU if available
+ *
+ * Called on each CPU during its early initialization. The bootstrap
+ * CPU decides which state components and which save instruction are
+ * used, the application processors merely follow that decision.
+ */
+void fpu_xsave_init(void)
+{
+	cpu_info_t info;
+
+	if (config.cpu_active == 1) {
+		cpuid(INTEL_CPUID_STANDARD, &info);
+		if (!(info.cpuid_ecx & (1 << INTEL_XSAVE)))
+			return;
+
+		cpuid_subleaf(INTEL_CPUID_XSAVE, 0, &info);
+		uint64_t supported = ((uint64_t) info.cpuid_edx << 32) |
+		    info.cpuid_eax;
+
+		uint64_t xcr0 = XCR0_X87 | XCR0_SSE;
+		if (supported & XCR0_AVX)
+			xcr0 |= XCR0_AVX;
+
+		write_cr4(read_cr4() | CR4_OSXSAVE);
+		write_xcr(XCR0, xcr0);
+
+		/* EBX reports the area size for the features enabled in XCR0 */
+		cpuid_subleaf(INTEL_CPUID_XSAVE, 0, &info);
+		if (info.cpuid_ebx > sizeof(fpu_context_t)) {
+			panic("XSAVE area of %" PRIu32 " bytes does not fit "
+			    "into the FPU context.", info.cpuid_ebx);
+		}
+
+		cpuid_subleaf(INTEL_CPUID_XSAVE, 1, &info);
+		bool xsaveopt = (info.cpuid_eax & (1 << INTEL_XSAVEOPT)) != 0;
+
+		fpu_xcr0 = xcr0;
+		fpu_save = xsaveopt ? FPU_SAVE_XSAVEOPT : FPU_SAVE_XSAVE;
+		return;
+	}
+
+	if (fpu_save == FPU_SAVE_FXSAVE)
+		return;
+
+	write_cr4(read_cr4() | CR4_OSXSAVE);
+	write_xcr(XCR0, fpu_xcr0);
+}
+
+/** Save FPU (mmx, sse, avx) context */
 void fpu_context_save(fpu_context_t *fctx)
 {
-	asm volatile (
-	    "fxsave %[fctx]\n"
-	    : [fctx] "=m" (fctx->fpu)
-	);
+	switch (fpu_save) {
+	case FPU_SAVE_XSAVEOPT:
+		asm volatile (
+		    "xsaveopt64 %[fctx]\n"
+		    : [fctx] "+m" (fctx->fpu)
+		    : "a" ((uint32_t) fpu_xcr0),
+		      "d" ((uint32_t) (fpu_xcr0 >> 32))
+		);
+		break;
+	case FPU_SAVE_XSAVE:
+		asm volatile (
+		    "xsave64 %[fctx]\n"
+		    : [fctx] "+m" (fctx->fpu)
+		    : "a" ((uint32_t) fpu_xcr0),
+		      "d" ((uint32_t) (fpu_xcr0 >> 32))
+		);
+		break;
+	case FPU_SAVE_FXSAVE:
+		asm volatile (
+		    "fxsave %[fctx]\n"
+		    : [fctx] "=m" (fctx->fpu)
+		);
+		break;
+	}
 }
 
-/** Restore FPU (mmx,sse) context using fxrstor instruction */
+/** Restore FPU (mmx, sse, avx) context */
 void fpu_context_restore(fpu_context_t *fctx)
 {
-	asm volatile (
-	    "fxrstor %[fctx]\n"
-	    : [fctx] "=m" (fctx->fpu)
-	);
+	if (fpu_save != FPU_SAVE_FXSAVE) {
+		asm volatile (
+		    "xrstor64 %[fctx]\n"
+		    :: [fctx] "m" (fctx->fpu),
+		      "a" ((uint32_t) fpu_xcr0),
+		      "d" ((uint32_t) (fpu_xcr0 >> 32))
+		);
+	} else {
+		asm volatile (
+		    "fxrstor %[fctx]\n"
+		    : [fctx] "=m" (fctx->fpu)
+		);
+	}
 }
 
 void fpu_init(void)
 {
+	/*
+	 * With XSAVE, reset all enabled state components including the
+	 * upper halves of the YMM registers, which would otherwise leak
+	 * from the previous thread.
+	 */
+	if (fpu_save != FPU_SAVE_FXSAVE) {
+		fpu_context_restore(&fpu_clean);
+		return;
+	}
+
 	/* TODO: Zero all SSE, MMX etc. registers */
 	/*
 	 * Default value of SCR register is 0x1f80,
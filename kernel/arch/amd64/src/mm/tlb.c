@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2005 Jakub Jermar
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup amd64mm
+ * @{
+ */
+/** @file
+ */
+
+#include <mm/tlb.h>
+#include <mm/asid.h>
+#include <arch/mm/asid.h>
+#include <arch/mm/tlb.h>
+#include <arch/asm.h>
+#include <arch/cpu.h>
+#include <arch/cpuid.h>
+#include <config.h>
+#include <typedefs.h>
+
+bool pcid_enabled = false;
+
+/** Invalidate all entries in TLB. */
+void tlb_invalidate_all(void)
+{
+	if (pcid_enabled)
+		invpcid(INVPCID_ALL_GLOBAL, 0, 0);
+	else
+		write_cr3(read_cr3());
+}
+
+/** Invalidate all entries in TLB that belong to specified address space.
+ *
+ * Kernel mappings are cached under every PCID, so invalidating the
+ * kernel address space invalidates all entries.
+ *
+ * @param asid Address space identifier.
+ */
+void tlb_invalidate_asid(asid_t asid)
+{
+	if ((pcid_enabled) && (asid != ASID_KERNEL))
+		invpcid(INVPCID_CONTEXT, asid, 0);
+	else
+		tlb_invalidate_all();
+}
+
+/** Invalidate TLB entries for specified page range belonging to specified address space.
+ *
+ * With PCIDs, the address space need not be the one installed on the
+ * processor.
+ *
+ * @param asid Address space identifier.
+ * @param page Address of the first page whose entry is to be invalidated.
+ * @param cnt Number of entries to invalidate.
+ */
+void tlb_invalidate_pages(asid_t asid, uintptr_t page, size_t cnt)
+{
+	unsigned int i;
+
+	if (!pcid_enabled) {
+		for (i = 0; i < cnt; i++)
+			invlpg(page + i * PAGE_SIZE);
+		return;
+	}
+
+	if (asid == ASID_KERNEL) {
+		tlb_invalidate_all();
+		return;
+	}
+
+	for (i = 0; i < cnt; i++)
+		invpcid(INVPCID_ADDRESS, asid, page + i * PAGE_SIZE);
+}
+
+/** Check whether the processor supports PCIDs and INVPCID.
+ *
+ * INVPCID is required because shootdown messages delivered lazily
+ * must be able to invalidate address spaces which are not installed.
+ */
+static bool pcid_supported(void)
+{
+	cpu_info_t info;
+
+	if (!has_cpuid())
+		return false;
+
+	cpuid(INTEL_CPUID_LEVEL, &info);
+	if (info.cpuid_eax < INTEL_CPUID_FEATURES)
+		return false;
+
+	cpuid(INTEL_CPUID_STANDARD, &info);
+	if ((info.cpuid_ecx & (1 << INTEL_PCID)) == 0)
+		return false;
+
+	cpuid(INTEL_CPUID_FEATURES, &info);
+	return (info.cpuid_ebx & (1 << INTEL_INVPCID)) != 0;
+}
+
+void tlb_arch_init(void)
+{
+#ifdef CONFIG_ASID
+	/* The bootstrap processor decides for all processors. */
+	if (config.cpu_active == 1)
+		pcid_enabled = pcid_supported();
+
+	/* CR3 still holds the kernel page table with PCID 0 here. */
+	if (pcid_enabled)
+		write_cr4(read_cr4() | CR4_PCIDE);
+#endif
+}
+
+void tlb_print(void)
+{
+}
+
+/** @}
+ */
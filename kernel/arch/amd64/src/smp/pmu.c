@@ -0,0 +1 @@
+../../../ia32/src/smp/pmu.c
\ No newline at end of file
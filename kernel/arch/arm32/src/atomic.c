@@ -95,5 +95,29 @@ void *__atomic_exchange_4(void **mem, void *val, int model)
 	return old;
 }
 
+unsigned int __atomic_fetch_or_4(unsigned int *mem, unsigned int val, int model)
+{
+	(void) model;
+
+	irq_spinlock_lock(&cas_lock, true);
+	unsigned int old = *mem;
+	*mem = old | val;
+	irq_spinlock_unlock(&cas_lock, true);
+
+	return old;
+}
+
+unsigned int __atomic_fetch_and_4(unsigned int *mem, unsigned int val, int model)
+{
+	(void) model;
+
+	irq_spinlock_lock(&cas_lock, true);
+	unsigned int old = *mem;
+	*mem = old & val;
+	irq_spinlock_unlock(&cas_lock, true);
+
+	return old;
+}
+
 /** @}
  */
@@ -63,6 +63,21 @@ NO_TRACE static inline void cpu_sleep(void)
 	);
 }
 
+/** Enable interrupts and sleep until an interrupt comes
+ *
+ * STI delays the recognition of interrupts until after the next
+ * instruction, so an interrupt cannot slip in between enabling the
+ * interrupts and halting and leave the processor asleep.
+ *
+ */
+NO_TRACE static inline void cpu_interruptible_sleep(void)
+{
+	asm volatile (
+	    "sti\n"
+	    "hlt\n"
+	);
+}
+
 #define GEN_READ_REG(reg) NO_TRACE static inline sysarg_t read_ ##reg (void) \
 	{ \
 		sysarg_t res; \
@@ -81,6 +81,9 @@ typedef struct {
 	tss_t *tss;
 
 	size_t iomapver_copy;  /** Copy of TASK's I/O Permission bitmap generation count. */
+
+	uint32_t apic_timer_period;   /** Local APIC timer count per clock tick. */
+	uint32_t apic_timer_oneshot;  /** Count of the pending one-shot. */
 } cpu_arch_t;
 
 #endif
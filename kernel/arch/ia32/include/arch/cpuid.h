@@ -39,6 +39,10 @@
 #define INTEL_CPUID_STANDARD  0x00000001
 #define INTEL_PSE             3
 #define INTEL_SEP             11
+#define INTEL_CPUID_EXTENDED  0x80000000
+
+#define AMD_CPUID_APM       0x80000007
+#define AMD_APM_INVARIANT_TSC  8
 
 #ifndef __ASSEMBLER__
 
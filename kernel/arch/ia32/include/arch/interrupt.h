@@ -49,6 +49,15 @@
 #define IVT_IRQBASE   (IVT_EXCBASE + EXC_COUNT)
 #define IVT_FREEBASE  (IVT_IRQBASE + IRQ_COUNT)
 
+/*
+ * Message signalled interrupts are delivered by the local APIC directly
+ * to one of these vectors. They are dispatched as INRs following the
+ * legacy ones.
+ */
+#define MSI_COUNT    32
+#define IVT_MSIBASE  (IVT_FREEBASE + 16)
+#define IRQ_MSIBASE  IRQ_COUNT
+
 #define EXC_DE 0
 #define EXC_DB 1
 #define EXC_NM 7
@@ -85,6 +94,7 @@
 #define VECTOR_TLB_SHOOTDOWN_IPI  (IVT_FREEBASE + 1)
 #define VECTOR_DEBUG_IPI          (IVT_FREEBASE + 2)
 #define VECTOR_SMP_CALL_IPI       (IVT_FREEBASE + 3)
+#define VECTOR_PMU                (IVT_FREEBASE + 4)
 
 extern void (*disable_irqs_function)(uint16_t);
 extern void (*enable_irqs_function)(uint16_t);
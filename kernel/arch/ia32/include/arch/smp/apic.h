@@ -38,6 +38,10 @@
 #define L_APIC_BASE	0xfee00000
 #define IO_APIC_BASE	0xfec00000
 
+/** MSI address window, destination APIC ID goes to bits 12-19 */
+#define MSI_ADDRESS_BASE   0xfee00000
+#define MSI_ADDRESS_DEST(id)  (((uint32_t) (id)) << 12)
+
 #ifndef __ASSEMBLER__
 
 #include <cpu.h>
@@ -45,6 +49,7 @@
 
 #define FIXED  (0 << 0)
 #define LOPRI  (1 << 0)
+#define PHYS   (1 << 1)
 
 #define APIC_ID_COUNT  16
 
@@ -251,6 +256,22 @@ typedef union {
 	} __attribute__((packed));
 } lvt_error_t;
 
+/** LVT Performance Counter register. */
+#define LVT_PCINT  (0x340U / sizeof(uint32_t))
+
+typedef union {
+	uint32_t value;
+	struct {
+		uint8_t vector;           /**< Performance Counter Interrupt vector. */
+		unsigned int delmod : 3;  /**< Delivery Mode. */
+		unsigned int : 1;         /**< Reserved. */
+		unsigned int delivs : 1;  /**< Delivery status (RO). */
+		unsigned int : 3;         /**< Reserved. */
+		unsigned int masked : 1;  /**< Interrupt Mask. */
+		unsigned int : 15;        /**< Reserved. */
+	} __attribute__((packed));
+} lvt_pcint_t;
+
 /** Local APIC ID Register. */
 #define L_APIC_ID  (0x020U / sizeof(uint32_t))
 
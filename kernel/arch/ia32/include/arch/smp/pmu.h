@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup ia32
+ * @{
+ */
+/** @file
+ */
+
+#ifndef KERN_ia32_PMU_H_
+#define KERN_ia32_PMU_H_
+
+#include <stdint.h>
+
+/** Intel architectural performance monitoring MSRs. */
+#define MSR_IA32_PMC0                  0x0c1
+#define MSR_IA32_PERFEVTSEL0           0x186
+#define MSR_IA32_PERF_GLOBAL_CTRL      0x38f
+#define MSR_IA32_PERF_GLOBAL_OVF_CTRL  0x390
+
+/** AMD legacy performance counter MSRs. */
+#define MSR_AMD_PERF_CTL0  0xc0010000
+#define MSR_AMD_PERF_CTR0  0xc0010004
+
+/** Event select register bits. */
+#define PERFEVTSEL_USR  (UINT64_C(1) << 16)
+#define PERFEVTSEL_OS   (UINT64_C(1) << 17)
+#define PERFEVTSEL_INT  (UINT64_C(1) << 20)
+#define PERFEVTSEL_EN   (UINT64_C(1) << 22)
+
+/** Unhalted core cycles event of Intel architectural performance monitoring. */
+#define INTEL_EVENT_CORE_CYCLES  0x3c
+/** CPU clocks not halted event of AMD processors. */
+#define AMD_EVENT_CPU_CLOCKS     0x76
+
+extern void pmu_init(void);
+
+#endif
+
+/** @}
+ */
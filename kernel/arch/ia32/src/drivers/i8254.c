@@ -62,6 +62,22 @@
 
 static irq_t i8254_irq;
 
+/** Check whether the TSC runs at a constant rate in all power states */
+static bool i8254_tsc_invariant(void)
+{
+	cpu_info_t info;
+
+	if (!has_cpuid())
+		return false;
+
+	cpuid(INTEL_CPUID_EXTENDED, &info);
+	if (info.cpuid_eax < AMD_CPUID_APM)
+		return false;
+
+	cpuid(AMD_CPUID_APM, &info);
+	return (info.cpuid_edx & (1 << AMD_APM_INVARIANT_TSC)) != 0;
+}
+
 static irq_ownership_t i8254_claim(irq_t *irq)
 {
 	return IRQ_ACCEPT;
@@ -114,6 +130,8 @@ void i8254_calibrate_delay_loop(void)
 	uint8_t not_ok;
 	uint32_t t1;
 	uint32_t t2;
+	uint64_t tsc1;
+	uint64_t tsc2;
 
 	do {
 		/* will read both status and count */
@@ -122,12 +140,14 @@ void i8254_calibrate_delay_loop(void)
 		t1 = pio_read_8(CLK_PORT1);
 		t1 |= pio_read_8(CLK_PORT1) << 8;
 	} while (not_ok);
+	tsc1 = get_cycle();
 
 	asm_delay_loop(LOOPS);
 
 	pio_write_8(CLK_PORT4, 0xd2);
 	t2 = pio_read_8(CLK_PORT1);
 	t2 |= pio_read_8(CLK_PORT1) << 8;
+	tsc2 = get_cycle();
 
 	/*
 	 * We want to determine the overhead of the calibrating mechanism.
@@ -152,7 +172,12 @@ void i8254_calibrate_delay_loop(void)
 
 	CPU->frequency_mhz = (clk2 - clk1) >> SHIFT;
 
-	return;
+	/*
+	 * Let the userspace compute the uptime from an invariant TSC.
+	 * The TSC frequency is measured directly against the PIT.
+	 */
+	if ((config.cpu_active == 1) && (t1 > t2) && i8254_tsc_invariant())
+		clock_cycle_register((tsc2 - tsc1) * CLK_CONST / (t1 - t2));
 }
 
 /** @}
@@ -36,6 +36,7 @@
 #include <arch/smp/apic.h>
 #include <arch/smp/ap.h>
 #include <arch/smp/mps.h>
+#include <arch/smp/pmu.h>
 #include <arch/boot/boot.h>
 #include <assert.h>
 #include <mm/page.h>
@@ -46,6 +47,10 @@
 #include <arch/asm.h>
 #include <arch.h>
 #include <ddi/irq.h>
+#include <time/clock.h>
+#include <cpu.h>
+#include <sysinfo/sysinfo.h>
+#include <errno.h>
 
 #ifdef CONFIG_SMP
 
@@ -138,6 +143,74 @@ static void apic_spurious(unsigned int n __attribute__((unused)),
 #endif
 }
 
+/** Message signalled interrupt handler.
+ *
+ * The vector is translated to an INR and dispatched like any other
+ * device interrupt. No I/O APIC is involved, so only the local APIC
+ * needs to be acknowledged.
+ *
+ * @param n      Interrupt vector.
+ * @param istate Interrupted state.
+ *
+ */
+static void msi_interrupt(unsigned int n, istate_t *istate)
+{
+	assert(n >= IVT_MSIBASE);
+	assert(n < IVT_MSIBASE + MSI_COUNT);
+
+	inr_t inr = IRQ_MSIBASE + (n - IVT_MSIBASE);
+	bool ack = false;
+
+	irq_t *irq = irq_dispatch_and_lock(inr);
+	if (irq) {
+		if (irq->preack) {
+			l_apic_eoi();
+			ack = true;
+		}
+		irq->handler(irq);
+		irq_spinlock_unlock(&irq->lock, false);
+	} else {
+#ifdef CONFIG_DEBUG
+		log(LF_ARCH, LVL_DEBUG, "cpu%u: spurious MSI (inr=%d)",
+		    CPU->id, inr);
+#endif
+	}
+
+	if (!ack)
+		l_apic_eoi();
+}
+
+/** Serializes redirection table updates coming from different CPUs. */
+IRQ_SPINLOCK_STATIC_INITIALIZE(io_apic_lock);
+
+/** Deliver a legacy interrupt to a single CPU.
+ *
+ * Message signalled interrupts carry their destination in the device
+ * and are routed by the PCI bus driver instead.
+ *
+ * @param inr Interrupt number.
+ * @param cpu ID of an active CPU.
+ *
+ * @return Error code.
+ *
+ */
+static errno_t io_apic_set_affinity(inr_t inr, unsigned int cpu)
+{
+	if (inr >= IRQ_COUNT)
+		return ENOTSUP;
+
+	int pin = smp_irq_to_pin(inr);
+	if (pin == -1)
+		return ENOENT;
+
+	irq_spinlock_lock(&io_apic_lock, true);
+	io_apic_change_ioredtbl((uint8_t) pin, cpus[cpu].arch.id,
+	    (uint8_t) (IVT_IRQBASE + inr), FIXED | PHYS);
+	irq_spinlock_unlock(&io_apic_lock, true);
+
+	return EOK;
+}
+
 static irq_ownership_t l_apic_timer_claim(irq_t *irq)
 {
 	return IRQ_ACCEPT;
@@ -155,6 +228,74 @@ static void l_apic_timer_irq_handler(irq_t *irq)
 	irq_spinlock_lock(&irq->lock, false);
 }
 
+/** Return the longest local timer one-shot period in clock ticks. */
+static uint64_t l_apic_timer_max_ticks(void)
+{
+	if (CPU->arch.apic_timer_period == 0)
+		return 0;
+
+	return UINT32_MAX / CPU->arch.apic_timer_period;
+}
+
+/** Switch the local timer to the one-shot mode.
+ *
+ * @param ticks Number of clock ticks after which the timer fires.
+ *
+ */
+static void l_apic_timer_oneshot(uint64_t ticks)
+{
+	lvt_tm_t tm;
+
+	tm.value = l_apic[LVT_Tm];
+	tm.mode = TIMER_ONESHOT;
+	l_apic[LVT_Tm] = tm.value;
+
+	CPU->arch.apic_timer_oneshot =
+	    (uint32_t) ticks * CPU->arch.apic_timer_period;
+	l_apic[ICRT] = CPU->arch.apic_timer_oneshot;
+}
+
+/** Switch the local timer back to the periodic mode.
+ *
+ * @return Number of clock ticks elapsed since the one-shot was started,
+ *         rounded to the nearest tick.
+ *
+ */
+static uint64_t l_apic_timer_periodic(void)
+{
+	uint32_t period = CPU->arch.apic_timer_period;
+	uint32_t elapsed = CPU->arch.apic_timer_oneshot - l_apic[CCRT];
+
+	lvt_tm_t tm;
+
+	tm.value = l_apic[LVT_Tm];
+	tm.mode = TIMER_PERIODIC;
+	l_apic[LVT_Tm] = tm.value;
+	l_apic[ICRT] = period;
+
+	return (elapsed + period / 2) / period;
+}
+
+/** Wake up an idle processor.
+ *
+ * The SMP call handler finds no pending calls, the interrupt merely
+ * makes the processor leave cpu_sleep().
+ *
+ * @param cpu_id Processor to wake up.
+ *
+ */
+static void l_apic_timer_kick(unsigned int cpu_id)
+{
+	(void) l_apic_send_custom_ipi(cpus[cpu_id].arch.id, VECTOR_SMP_CALL_IPI);
+}
+
+static clock_dyntick_ops_t l_apic_dyntick_ops = {
+	.max_ticks = l_apic_timer_max_ticks,
+	.oneshot = l_apic_timer_oneshot,
+	.periodic = l_apic_timer_periodic,
+	.kick = l_apic_timer_kick
+};
+
 /** Get Local APIC ID.
  *
  * @return Local APIC ID.
@@ -177,6 +318,7 @@ void apic_init(void)
 	enable_irqs_function = io_apic_enable_irqs;
 	disable_irqs_function = io_apic_disable_irqs;
 	eoi_function = l_apic_eoi;
+	irq_affinity_function = io_apic_set_affinity;
 	irqs_info = "apic";
 
 	/*
@@ -224,6 +366,24 @@ void apic_init(void)
 	l_apic_debug();
 
 	bsp_l_apic = l_apic_id();
+
+	/*
+	 * Message signalled interrupts are all targeted at the BSP. Publish
+	 * the address and the vector range so that the PCI bus driver can
+	 * program the devices.
+	 */
+	for (i = 0; i < MSI_COUNT; i++) {
+		exc_register(IVT_MSIBASE + i, "msi", true,
+		    (iroutine_t) msi_interrupt);
+	}
+
+	sysinfo_set_item_val("msi.address", NULL,
+	    MSI_ADDRESS_BASE | MSI_ADDRESS_DEST(bsp_l_apic));
+	sysinfo_set_item_val("msi.vector", NULL, IVT_MSIBASE);
+	sysinfo_set_item_val("msi.inr", NULL, IRQ_MSIBASE);
+	sysinfo_set_item_val("msi.count", NULL, MSI_COUNT);
+
+	pmu_init();
 }
 
 /** Poll for APIC errors.
@@ -489,6 +649,8 @@ void l_apic_init(void)
 	uint32_t t2 = l_apic[CCRT];
 
 	l_apic[ICRT] = t1 - t2;
+	CPU->arch.apic_timer_period = t1 - t2;
+	clock_dyntick_register(&l_apic_dyntick_ops);
 
 	/* Program Logical Destination Register. */
 	assert(CPU->id < 8);
@@ -585,7 +747,8 @@ void io_apic_write(uint8_t address, uint32_t val)
  * @param pin   IO APIC pin number.
  * @param dest  Interrupt destination address.
  * @param vec   Interrupt vector to trigger.
- * @param flags Flags.
+ * @param flags Flags. PHYS selects physical destination mode, the
+ *              destination is a logical one otherwise.
  *
  */
 void io_apic_change_ioredtbl(uint8_t pin, uint8_t dest, uint8_t vec,
@@ -598,12 +761,19 @@ void io_apic_change_ioredtbl(uint8_t pin, uint8_t dest, uint8_t vec,
 	else
 		dlvr = DELMOD_FIXED;
 
+	unsigned int destmod;
+
+	if (flags & PHYS)
+		destmod = DESTMOD_PHYS;
+	else
+		destmod = DESTMOD_LOGIC;
+
 	io_redirection_reg_t reg;
 	reg.lo = io_apic_read((uint8_t) (IOREDTBL + pin * 2));
 	reg.hi = io_apic_read((uint8_t) (IOREDTBL + pin * 2 + 1));
 
 	reg.dest = dest;
-	reg.destmod = DESTMOD_LOGIC;
+	reg.destmod = destmod;
 	reg.trigger_mode = TRIGMOD_EDGE;
 	reg.intpol = POLARITY_HIGH;
 	reg.delmod = dlvr;
@@ -0,0 +1,204 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup ia32
+ * @{
+ */
+/** @file
+ * @brief Sampling with performance monitoring counters.
+ *
+ * The first general-purpose counter counts unhalted core cycles, starting
+ * from the negated sampling period. Its overflow is delivered through the
+ * local APIC performance counter LVT entry and the handler reports the
+ * interrupted state as a profiling sample before rearming the counter.
+ *
+ * The counter interrupt is an ordinary maskable interrupt, so code running
+ * with interrupts disabled is attributed to the point where it enables
+ * them again.
+ */
+
+#include <arch/smp/pmu.h>
+#include <arch/smp/apic.h>
+#include <arch/asm.h>
+#include <arch/cpuid.h>
+#include <arch/interrupt.h>
+#include <interrupt.h>
+#include <ktrace.h>
+#include <log.h>
+#include <stdbool.h>
+
+#ifdef CONFIG_SMP
+
+/** First word of the AMD vendor string */
+#define AMD_CPUID_EBX  UINT32_C(0x68747541)
+
+/** Leaf of Intel architectural performance monitoring */
+#define INTEL_CPUID_PERFMON  0x0000000a
+
+/** Event select MSR of the sampling counter */
+static uint32_t pmu_evtsel_msr;
+/** Counter MSR of the sampling counter */
+static uint32_t pmu_counter_msr;
+/** Event counted by the sampling counter */
+static uint64_t pmu_event;
+/** Mask of the implemented counter bits */
+static uint64_t pmu_counter_mask;
+/** Longest sampling period the counter can be loaded with */
+static uint64_t pmu_period_max;
+/** Version of Intel architectural performance monitoring, 0 on AMD */
+static unsigned int pmu_version;
+
+/** Counter value which overflows after the sampling period */
+static uint64_t pmu_reload;
+
+static void pmu_lvt_set(bool masked)
+{
+	lvt_pcint_t pcint;
+
+	pcint.value = l_apic[LVT_PCINT];
+	pcint.vector = VECTOR_PMU;
+	pcint.delmod = DELMOD_FIXED;
+	pcint.masked = masked;
+	l_apic[LVT_PCINT] = pcint.value;
+}
+
+static void pmu_start(uint64_t period)
+{
+	if (period > pmu_period_max)
+		period = pmu_period_max;
+
+	pmu_reload = (-period) & pmu_counter_mask;
+
+	write_msr(pmu_evtsel_msr, 0);
+	write_msr(pmu_counter_msr, pmu_reload);
+	pmu_lvt_set(false);
+
+	if (pmu_version >= 2) {
+		write_msr(MSR_IA32_PERF_GLOBAL_OVF_CTRL, 1);
+		write_msr(MSR_IA32_PERF_GLOBAL_CTRL,
+		    read_msr(MSR_IA32_PERF_GLOBAL_CTRL) | 1);
+	}
+
+	write_msr(pmu_evtsel_msr, pmu_event | PERFEVTSEL_USR | PERFEVTSEL_OS |
+	    PERFEVTSEL_INT | PERFEVTSEL_EN);
+}
+
+static void pmu_stop(void)
+{
+	write_msr(pmu_evtsel_msr, 0);
+	pmu_lvt_set(true);
+}
+
+static ktrace_sampler_ops_t pmu_sampler_ops = {
+	.start = pmu_start,
+	.stop = pmu_stop
+};
+
+/** Performance counter overflow interrupt handler.
+ *
+ * @param n      Interrupt vector.
+ * @param istate Interrupted state.
+ *
+ */
+static void pmu_interrupt(unsigned int n __attribute__((unused)),
+    istate_t *istate)
+{
+	ktrace_sample(istate);
+
+	write_msr(pmu_counter_msr, pmu_reload);
+	if (pmu_version >= 2)
+		write_msr(MSR_IA32_PERF_GLOBAL_OVF_CTRL, 1);
+
+	/* Intel processors mask the LVT entry when delivering the interrupt */
+	pmu_lvt_set(false);
+	l_apic_eoi();
+}
+
+/** Detect the performance counters and register them for sampling.
+ *
+ * Assumes that all processors implement the same counters as the BSP.
+ *
+ */
+void pmu_init(void)
+{
+	cpu_info_t info;
+
+	if (!has_cpuid())
+		return;
+
+	cpuid(INTEL_CPUID_LEVEL, &info);
+	uint32_t max_leaf = info.cpuid_eax;
+
+	if (info.cpuid_ebx == AMD_CPUID_EBX) {
+		/* Processors since K7 have the legacy counters */
+		cpuid(INTEL_CPUID_STANDARD, &info);
+		if (((info.cpuid_eax >> 8) & 0xf) < 6)
+			return;
+
+		pmu_evtsel_msr = MSR_AMD_PERF_CTL0;
+		pmu_counter_msr = MSR_AMD_PERF_CTR0;
+		pmu_event = AMD_EVENT_CPU_CLOCKS;
+		pmu_counter_mask = (UINT64_C(1) << 48) - 1;
+		pmu_period_max = pmu_counter_mask >> 1;
+		pmu_version = 0;
+	} else {
+		if (max_leaf < INTEL_CPUID_PERFMON)
+			return;
+
+		cpuid(INTEL_CPUID_PERFMON, &info);
+
+		unsigned int version = info.cpuid_eax & 0xff;
+		unsigned int counters = (info.cpuid_eax >> 8) & 0xff;
+		unsigned int width = (info.cpuid_eax >> 16) & 0xff;
+		unsigned int events = (info.cpuid_eax >> 24) & 0xff;
+
+		/* The core cycles event is available if its EBX bit is clear */
+		if ((version == 0) || (counters == 0) || (width < 32) ||
+		    (events == 0) || ((info.cpuid_ebx & 1) != 0))
+			return;
+
+		pmu_evtsel_msr = MSR_IA32_PERFEVTSEL0;
+		pmu_counter_msr = MSR_IA32_PMC0;
+		pmu_event = INTEL_EVENT_CORE_CYCLES;
+		pmu_counter_mask = (width < 64) ?
+		    (UINT64_C(1) << width) - 1 : UINT64_MAX;
+		/* Plain counter writes only set the sign-extended low 32 bits */
+		pmu_period_max = INT32_MAX;
+		pmu_version = version;
+	}
+
+	exc_register(VECTOR_PMU, "pmu", true, (iroutine_t) pmu_interrupt);
+	ktrace_sampler_register(&pmu_sampler_ops);
+
+	log(LF_ARCH, LVL_NOTE, "Performance counter sampling available");
+}
+
+#endif /* CONFIG_SMP */
+
+/** @}
+ */
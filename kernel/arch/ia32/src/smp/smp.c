@@ -41,6 +41,7 @@
 #include <errno.h>
 #include <genarch/acpi/acpi.h>
 #include <genarch/acpi/madt.h>
+#include <genarch/acpi/srat.h>
 #include <config.h>
 #include <synch/waitq.h>
 #include <arch/pm.h>
@@ -56,6 +57,7 @@
 #include <mem.h>
 #include <arch/drivers/i8259.h>
 #include <cpu.h>
+#include <sysinfo/sysinfo.h>
 
 #ifdef CONFIG_SMP
 
@@ -68,6 +70,8 @@ void smp_init(void)
 		ops = &madt_config_operations;
 	}
 
+	acpi_srat_parse();
+
 	if (config.cpu_count == 1) {
 		mps_init();
 		ops = &mps_config_operations;
@@ -88,6 +92,22 @@ static void cpu_arch_id_init(void)
 
 	for (unsigned int i = 0; i < config.cpu_count; ++i) {
 		cpus[i].arch.id = ops->cpu_apic_id(i);
+		cpus[i].node = acpi_srat_apic_node(cpus[i].arch.id);
+	}
+
+	/*
+	 * Let the PCI bus driver target message signalled interrupts
+	 * at any processor, indexed by the kernel CPU ID.
+	 */
+	uint32_t *msi_addresses = malloc(sizeof(uint32_t) * config.cpu_count);
+	if (msi_addresses) {
+		for (unsigned int i = 0; i < config.cpu_count; ++i) {
+			msi_addresses[i] = MSI_ADDRESS_BASE |
+			    MSI_ADDRESS_DEST(cpus[i].arch.id);
+		}
+
+		sysinfo_set_item_data("msi.addresses", NULL, msi_addresses,
+		    sizeof(uint32_t) * config.cpu_count);
 	}
 }
 
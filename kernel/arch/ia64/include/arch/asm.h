@@ -483,6 +483,19 @@ extern void cpu_halt(void) __attribute__((noreturn));
 extern void cpu_sleep(void);
 extern void asm_delay_loop(uint32_t t);
 
+/** Enable interrupts and sleep until an interrupt comes
+ *
+ * An interrupt taken between enabling the interrupts and going to sleep
+ * does not wake the processor up. The periodic tick is never stopped on
+ * this architecture, so such a wakeup is delayed by one tick at most.
+ *
+ */
+NO_TRACE static inline void cpu_interruptible_sleep(void)
+{
+	interrupts_enable();
+	cpu_sleep();
+}
+
 extern void switch_to_userspace(uintptr_t, uintptr_t, uintptr_t, uintptr_t,
     uint64_t, uint64_t);
 
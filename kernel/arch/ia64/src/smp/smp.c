@@ -41,6 +41,10 @@ void ipi_broadcast_arch(int ipi)
 {
 }
 
+void ipi_unicast_arch(unsigned int cpu_id, int ipi)
+{
+}
+
 void smp_init(void)
 {
 }
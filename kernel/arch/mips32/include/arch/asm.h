@@ -104,6 +104,19 @@ extern void interrupts_restore(ipl_t);
 extern ipl_t interrupts_read(void);
 extern bool interrupts_disabled(void);
 
+/** Enable interrupts and sleep until an interrupt comes
+ *
+ * An interrupt taken between enabling the interrupts and going to sleep
+ * does not wake the processor up. The periodic tick is never stopped on
+ * this architecture, so such a wakeup is delayed by one tick at most.
+ *
+ */
+NO_TRACE static inline void cpu_interruptible_sleep(void)
+{
+	interrupts_enable();
+	cpu_sleep();
+}
+
 #endif
 
 /** @}
@@ -107,6 +107,19 @@ NO_TRACE static inline void cpu_sleep(void)
 {
 }
 
+/** Enable interrupts and sleep until an interrupt comes
+ *
+ * An interrupt taken between enabling the interrupts and going to sleep
+ * does not wake the processor up. The periodic tick is never stopped on
+ * this architecture, so such a wakeup is delayed by one tick at most.
+ *
+ */
+NO_TRACE static inline void cpu_interruptible_sleep(void)
+{
+	interrupts_enable();
+	cpu_sleep();
+}
+
 NO_TRACE static inline void pio_write_8(ioport8_t *port, uint8_t v)
 {
 	*port = v;
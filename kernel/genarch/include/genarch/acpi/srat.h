@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup genarch
+ * @{
+ */
+/** @file
+ */
+
+#ifndef KERN_SRAT_H_
+#define KERN_SRAT_H_
+
+#include <genarch/acpi/acpi.h>
+
+#define SRAT_L_APIC_AFFINITY    0
+#define SRAT_MEMORY_AFFINITY    1
+#define SRAT_X2APIC_AFFINITY    2
+
+#define SRAT_FLAGS_ENABLED      (1 << 0)
+
+struct srat_header {
+	uint8_t type;
+	uint8_t length;
+} __attribute__((packed));
+
+/* System Resource Affinity Table */
+struct acpi_srat {
+	struct acpi_sdt_header header;
+	uint32_t reserved1;
+	uint64_t reserved2;
+	struct srat_header srat_header[];
+} __attribute__((packed));
+
+struct srat_l_apic_affinity {
+	struct srat_header header;
+	uint8_t domain_lo;
+	uint8_t apic_id;
+	uint32_t flags;
+	uint8_t sapic_eid;
+	uint8_t domain_hi[3];
+	uint32_t clock_domain;
+} __attribute__((packed));
+
+struct srat_memory_affinity {
+	struct srat_header header;
+	uint32_t domain;
+	uint16_t reserved1;
+	uint32_t base_lo;
+	uint32_t base_hi;
+	uint32_t length_lo;
+	uint32_t length_hi;
+	uint32_t reserved2;
+	uint32_t flags;
+	uint64_t reserved3;
+} __attribute__((packed));
+
+struct srat_x2apic_affinity {
+	struct srat_header header;
+	uint16_t reserved1;
+	uint32_t domain;
+	uint32_t x2apic_id;
+	uint32_t flags;
+	uint32_t clock_domain;
+	uint32_t reserved2;
+} __attribute__((packed));
+
+/* System Locality Information Table */
+struct acpi_slit {
+	struct acpi_sdt_header header;
+	uint64_t localities;
+	uint8_t entry[];
+} __attribute__((packed));
+
+extern struct acpi_srat *acpi_srat;
+extern struct acpi_slit *acpi_slit;
+
+extern void acpi_srat_parse(void);
+extern unsigned int acpi_srat_apic_node(uint32_t);
+
+#endif /* KERN_SRAT_H_ */
+
+/** @}
+ */
@@ -128,6 +128,18 @@
 #define SET_PTL3_PRESENT(ptl2, i)   SET_PTL3_PRESENT_ARCH(ptl2, i)
 #define SET_FRAME_PRESENT(ptl3, i)  SET_FRAME_PRESENT_ARCH(ptl3, i)
 
+#ifdef LARGE_PAGE_SIZE
+
+/*
+ * These macros are provided to query and set whether a PTL2 entry
+ * maps a large page directly.
+ *
+ */
+#define GET_PTL3_LARGE(ptl2, i)     GET_PTL3_LARGE_ARCH(ptl2, i)
+#define SET_PTL3_LARGE(ptl2, i, x)  SET_PTL3_LARGE_ARCH(ptl2, i, x)
+
+#endif
+
 /*
  * Macros for querying the last-level PTEs.
  *
@@ -0,0 +1,203 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup genarch
+ * @{
+ */
+/**
+ * @file
+ * @brief System Resource Affinity Table (SRAT) and System Locality
+ *        Information Table (SLIT) parsing.
+ */
+
+#include <typedefs.h>
+#include <genarch/acpi/acpi.h>
+#include <genarch/acpi/srat.h>
+#include <mm/numa.h>
+#include <mm/slab.h>
+#include <log.h>
+
+struct acpi_srat *acpi_srat = NULL;
+struct acpi_slit *acpi_slit = NULL;
+
+typedef struct {
+	uint32_t apic_id;
+	unsigned int node;
+} srat_cpu_t;
+
+static srat_cpu_t *srat_cpus = NULL;
+static size_t srat_cpu_cnt = 0;
+
+#define SRAT_FOREACH(hdr, end) \
+	for ((hdr) = acpi_srat->srat_header; (hdr) < (end); \
+	    (hdr) = (struct srat_header *) (((uint8_t *) (hdr)) + (hdr)->length))
+
+static void srat_cpu_add(uint32_t apic_id, uint32_t domain)
+{
+	srat_cpus[srat_cpu_cnt].apic_id = apic_id;
+	srat_cpus[srat_cpu_cnt].node = numa_node_get(domain);
+	srat_cpu_cnt++;
+}
+
+static void srat_memory_add(struct srat_memory_affinity *mem)
+{
+	uint64_t base = ((uint64_t) mem->base_hi << 32) | mem->base_lo;
+	uint64_t length = ((uint64_t) mem->length_hi << 32) | mem->length_lo;
+
+	/* Ignore memory the kernel cannot address. */
+	if ((length == 0) || (base > UINTPTR_MAX))
+		return;
+
+	if (length - 1 > UINTPTR_MAX - base)
+		length = (uint64_t) UINTPTR_MAX - base + 1;
+
+	unsigned int node = numa_node_get(mem->domain);
+	numa_memory_add((uintptr_t) base, (size_t) length, node);
+
+	log(LF_ARCH, LVL_NOTE, "SRAT: memory %#" PRIx64 "+%#" PRIx64
+	    " on node %u (domain %" PRIu32 ")", base, length, node,
+	    mem->domain);
+}
+
+static void slit_parse(void)
+{
+	uint64_t n = acpi_slit->localities;
+
+	if (sizeof(struct acpi_slit) + n * n > acpi_slit->header.length) {
+		log(LF_ARCH, LVL_WARN, "SLIT: truncated table, ignoring");
+		return;
+	}
+
+	for (uint64_t i = 0; i < n; i++) {
+		unsigned int from = numa_node_find(i);
+		if (from == NUMA_NODE_ANY)
+			continue;
+
+		for (uint64_t j = 0; j < n; j++) {
+			unsigned int to = numa_node_find(j);
+			if (to == NUMA_NODE_ANY)
+				continue;
+
+			numa_distance_set(from, to, acpi_slit->entry[i * n + j]);
+		}
+	}
+}
+
+/** Parse SRAT and SLIT and register the NUMA topology they describe. */
+void acpi_srat_parse(void)
+{
+	if (acpi_srat == NULL)
+		return;
+
+	struct srat_header *end = (struct srat_header *)
+	    (((uint8_t *) acpi_srat) + acpi_srat->header.length);
+	struct srat_header *hdr;
+
+	/* Count processor entries */
+	size_t cpu_entries = 0;
+	SRAT_FOREACH(hdr, end) {
+		if (hdr->length == 0)
+			return;
+
+		if ((hdr->type == SRAT_L_APIC_AFFINITY) ||
+		    (hdr->type == SRAT_X2APIC_AFFINITY))
+			cpu_entries++;
+	}
+
+	if (cpu_entries > 0) {
+		srat_cpus = (srat_cpu_t *) malloc(cpu_entries *
+		    sizeof(srat_cpu_t));
+		if (!srat_cpus) {
+			log(LF_ARCH, LVL_WARN, "SRAT: out of memory, ignoring");
+			return;
+		}
+	}
+
+	SRAT_FOREACH(hdr, end) {
+		switch (hdr->type) {
+		case SRAT_L_APIC_AFFINITY:
+			{
+				struct srat_l_apic_affinity *lapic =
+				    (struct srat_l_apic_affinity *) hdr;
+				if (!(lapic->flags & SRAT_FLAGS_ENABLED))
+					break;
+
+				uint32_t domain = lapic->domain_lo |
+				    (lapic->domain_hi[0] << 8) |
+				    (lapic->domain_hi[1] << 16) |
+				    ((uint32_t) lapic->domain_hi[2] << 24);
+				srat_cpu_add(lapic->apic_id, domain);
+				break;
+			}
+		case SRAT_MEMORY_AFFINITY:
+			{
+				struct srat_memory_affinity *mem =
+				    (struct srat_memory_affinity *) hdr;
+				if (mem->flags & SRAT_FLAGS_ENABLED)
+					srat_memory_add(mem);
+				break;
+			}
+		case SRAT_X2APIC_AFFINITY:
+			{
+				struct srat_x2apic_affinity *x2apic =
+				    (struct srat_x2apic_affinity *) hdr;
+				if (x2apic->flags & SRAT_FLAGS_ENABLED)
+					srat_cpu_add(x2apic->x2apic_id,
+					    x2apic->domain);
+				break;
+			}
+		default:
+			break;
+		}
+	}
+
+	if (acpi_slit)
+		slit_parse();
+
+	numa_commit();
+}
+
+/** Get the NUMA node of a processor.
+ *
+ * @param apic_id Local APIC ID of the processor.
+ *
+ * @return Node ID, 0 if SRAT does not mention the processor.
+ *
+ */
+unsigned int acpi_srat_apic_node(uint32_t apic_id)
+{
+	for (size_t i = 0; i < srat_cpu_cnt; i++) {
+		if (srat_cpus[i].apic_id == apic_id)
+			return srat_cpus[i].node;
+	}
+
+	return 0;
+}
+
+/** @}
+ */
@@ -64,6 +64,7 @@
 #include <synch/spinlock.h>
 #include <synch/mutex.h>
 #include <adt/list.h>
+#include <cpu/cpu_mask.h>
 
 static size_t asids_allocated = 0;
 
@@ -125,9 +126,16 @@ asid_t asid_get(void)
 		/*
 		 * Get the system rid of the stolen ASID.
 		 */
-		ipl_t ipl = tlb_shootdown_start(TLB_INVL_ASID, asid, 0, 0);
+		ipl_t ipl = tlb_shootdown_start(as, TLB_INVL_ASID, asid, 0, 0);
 		tlb_invalidate_asid(asid);
 		tlb_shootdown_finalize(ipl);
+
+		/*
+		 * The processors which had the address space installed
+		 * have its stale entries purged by now or will purge
+		 * them before they switch to another address space.
+		 */
+		cpu_mask_none(as->cpu_mask);
 	} else {
 
 		/*
@@ -141,7 +149,8 @@ asid_t asid_get(void)
 		/*
 		 * Purge the allocated ASID from TLBs.
 		 */
-		ipl_t ipl = tlb_shootdown_start(TLB_INVL_ASID, asid, 0, 0);
+		ipl_t ipl = tlb_shootdown_start(NULL, TLB_INVL_ASID, asid,
+		    0, 0);
 		tlb_invalidate_asid(asid);
 		tlb_shootdown_finalize(ipl);
 	}
@@ -56,33 +56,36 @@ static void pt_mapping_remove(as_t *, uintptr_t);
 static bool pt_mapping_find(as_t *, uintptr_t, bool, pte_t *pte);
 static void pt_mapping_update(as_t *, uintptr_t, bool, pte_t *pte);
 static void pt_mapping_make_global(uintptr_t, size_t);
+#ifdef LARGE_PAGE_SIZE
+static bool pt_mapping_insert_large(as_t *, uintptr_t, uintptr_t,
+    unsigned int);
+static void pt_mapping_split(as_t *, uintptr_t);
+#endif
 
 page_mapping_operations_t pt_mapping_operations = {
 	.mapping_insert = pt_mapping_insert,
 	.mapping_remove = pt_mapping_remove,
 	.mapping_find = pt_mapping_find,
 	.mapping_update = pt_mapping_update,
-	.mapping_make_global = pt_mapping_make_global
+	.mapping_make_global = pt_mapping_make_global,
+#ifdef LARGE_PAGE_SIZE
+	.mapping_insert_large = pt_mapping_insert_large,
+	.mapping_split = pt_mapping_split
+#endif
 };
 
-/** Map page to frame using hierarchical page tables.
- *
- * Map virtual address page to physical address frame
- * using flags.
+/** Find the PTL2 table covering a page, creating missing tables.
  *
  * @param as    Address space to wich page belongs.
- * @param page  Virtual address of the page to be mapped.
- * @param frame Physical address of memory frame to which the mapping is done.
- * @param flags Flags to be used for mapping.
+ * @param page  Virtual address of the page.
+ *
+ * @return Kernel address of the PTL2 table.
  *
  */
-void pt_mapping_insert(as_t *as, uintptr_t page, uintptr_t frame,
-    unsigned int flags)
+static pte_t *pt_ptl2_get(as_t *as, uintptr_t page)
 {
 	pte_t *ptl0 = (pte_t *) PA2KA((uintptr_t) as->genarch.page_table);
 
-	assert(page_table_locked(as));
-
 	if (GET_PTL1_FLAGS(ptl0, PTL0_INDEX(page)) & PAGE_NOT_PRESENT) {
 		pte_t *newpt = (pte_t *)
 		    PA2KA(frame_alloc(PTL1_FRAMES, FRAME_LOWMEM, PTL1_SIZE - 1));
@@ -117,7 +120,30 @@ void pt_mapping_insert(as_t *as, uintptr_t page, uintptr_t frame,
 		SET_PTL2_PRESENT(ptl1, PTL1_INDEX(page));
 	}
 
-	pte_t *ptl2 = (pte_t *) PA2KA(GET_PTL2_ADDRESS(ptl1, PTL1_INDEX(page)));
+	return (pte_t *) PA2KA(GET_PTL2_ADDRESS(ptl1, PTL1_INDEX(page)));
+}
+
+/** Map page to frame using hierarchical page tables.
+ *
+ * Map virtual address page to physical address frame
+ * using flags.
+ *
+ * @param as    Address space to wich page belongs.
+ * @param page  Virtual address of the page to be mapped.
+ * @param frame Physical address of memory frame to which the mapping is done.
+ * @param flags Flags to be used for mapping.
+ *
+ */
+void pt_mapping_insert(as_t *as, uintptr_t page, uintptr_t frame,
+    unsigned int flags)
+{
+	assert(page_table_locked(as));
+
+	pte_t *ptl2 = pt_ptl2_get(as, page);
+
+#ifdef LARGE_PAGE_SIZE
+	assert(!GET_PTL3_LARGE(ptl2, PTL2_INDEX(page)));
+#endif
 
 	if (GET_PTL3_FLAGS(ptl2, PTL2_INDEX(page)) & PAGE_NOT_PRESENT) {
 		pte_t *newpt = (pte_t *)
@@ -145,6 +171,105 @@ void pt_mapping_insert(as_t *as, uintptr_t page, uintptr_t frame,
 	SET_FRAME_PRESENT(ptl3, PTL3_INDEX(page));
 }
 
+#ifdef LARGE_PAGE_SIZE
+
+/** Map a large page using a single PTL2 entry.
+ *
+ * @param as    Address space to wich page belongs.
+ * @param page  Virtual address of the large page, aligned to
+ *              LARGE_PAGE_SIZE.
+ * @param frame Physical address of LARGE_PAGE_SIZE of contiguous
+ *              memory, aligned to LARGE_PAGE_SIZE.
+ * @param flags Flags to be used for mapping.
+ *
+ * @return False if some page within the large page is already
+ *         mapped, true on success.
+ *
+ */
+bool pt_mapping_insert_large(as_t *as, uintptr_t page, uintptr_t frame,
+    unsigned int flags)
+{
+	assert(page_table_locked(as));
+	assert(IS_ALIGNED(page, LARGE_PAGE_SIZE));
+	assert(IS_ALIGNED(frame, LARGE_PAGE_SIZE));
+
+	pte_t *ptl2 = pt_ptl2_get(as, page);
+
+	if (!(GET_PTL3_FLAGS(ptl2, PTL2_INDEX(page)) & PAGE_NOT_PRESENT))
+		return false;
+
+	SET_PTL3_ADDRESS(ptl2, PTL2_INDEX(page), frame);
+	SET_PTL3_FLAGS(ptl2, PTL2_INDEX(page), flags | PAGE_NOT_PRESENT);
+	SET_PTL3_LARGE(ptl2, PTL2_INDEX(page), true);
+	/*
+	 * Make the new mapping visible only after it is fully initialized.
+	 */
+	write_barrier();
+	SET_PTL3_PRESENT(ptl2, PTL2_INDEX(page));
+
+	return true;
+}
+
+/** Split a large mapping at page.
+ *
+ * If page lies inside a large page other than at its start, the large
+ * mapping is replaced by equivalent small mappings, so that the pages
+ * below and above page can be removed independently.
+ *
+ * @param as   Address space to wich page belongs.
+ * @param page Virtual address of the page.
+ *
+ */
+void pt_mapping_split(as_t *as, uintptr_t page)
+{
+	assert(page_table_locked(as));
+
+	if (IS_ALIGNED(page, LARGE_PAGE_SIZE))
+		return;
+
+	pte_t *ptl0 = (pte_t *) PA2KA((uintptr_t) as->genarch.page_table);
+	if (GET_PTL1_FLAGS(ptl0, PTL0_INDEX(page)) & PAGE_NOT_PRESENT)
+		return;
+
+	pte_t *ptl1 = (pte_t *) PA2KA(GET_PTL1_ADDRESS(ptl0, PTL0_INDEX(page)));
+	if (GET_PTL2_FLAGS(ptl1, PTL1_INDEX(page)) & PAGE_NOT_PRESENT)
+		return;
+
+	pte_t *ptl2 = (pte_t *) PA2KA(GET_PTL2_ADDRESS(ptl1, PTL1_INDEX(page)));
+	if ((GET_PTL3_FLAGS(ptl2, PTL2_INDEX(page)) & PAGE_NOT_PRESENT) ||
+	    (!GET_PTL3_LARGE(ptl2, PTL2_INDEX(page))))
+		return;
+
+	uintptr_t frame = (uintptr_t) GET_PTL3_ADDRESS(ptl2, PTL2_INDEX(page));
+	unsigned int flags = GET_PTL3_FLAGS(ptl2, PTL2_INDEX(page));
+
+	pte_t *newpt = (pte_t *)
+	    PA2KA(frame_alloc(PTL3_FRAMES, FRAME_LOWMEM, PTL3_SIZE - 1));
+	memsetb(newpt, PTL3_SIZE, 0);
+
+	unsigned int i;
+	for (i = 0; i < PTL3_ENTRIES; i++) {
+		SET_FRAME_ADDRESS(newpt, i, frame + P2SZ(i));
+		SET_FRAME_FLAGS(newpt, i, flags);
+	}
+
+	/*
+	 * Build the new PTL2 entry aside and store it at once so that
+	 * a concurrent hardware page table walk sees either the large
+	 * mapping or the complete PTL3. Both translate the same way.
+	 */
+	pte_t entry;
+	memsetb(&entry, sizeof(pte_t), 0);
+	SET_PTL3_ADDRESS(&entry, 0, KA2PA(newpt));
+	SET_PTL3_FLAGS(&entry, 0, PAGE_USER | PAGE_EXEC | PAGE_CACHEABLE |
+	    PAGE_WRITE);
+
+	write_barrier();
+	ptl2[PTL2_INDEX(page)] = entry;
+}
+
+#endif /* LARGE_PAGE_SIZE */
+
 /** Remove mapping of page from hierarchical page tables.
  *
  * Remove any mapping of page within address space as.
@@ -153,12 +278,19 @@ void pt_mapping_insert(as_t *as, uintptr_t page, uintptr_t frame,
  *
  * Empty page tables except PTL0 are freed.
  *
+ * A large mapping is removed as a whole together with its last page,
+ * removing its other pages has no effect. Callers removing only some
+ * pages of a large page need to split it with pt_mapping_split() first.
+ *
  * @param as   Address space to wich page belongs.
  * @param page Virtual address of the page to be demapped.
  *
  */
 void pt_mapping_remove(as_t *as, uintptr_t page)
 {
+	bool empty = true;
+	unsigned int i;
+
 	assert(page_table_locked(as));
 
 	/*
@@ -177,6 +309,17 @@ void pt_mapping_remove(as_t *as, uintptr_t page)
 	if (GET_PTL3_FLAGS(ptl2, PTL2_INDEX(page)) & PAGE_NOT_PRESENT)
 		return;
 
+#ifdef LARGE_PAGE_SIZE
+	if (GET_PTL3_LARGE(ptl2, PTL2_INDEX(page))) {
+		if (page != ALIGN_DOWN(page, LARGE_PAGE_SIZE) +
+		    LARGE_PAGE_SIZE - PAGE_SIZE)
+			return;
+
+		memsetb(&ptl2[PTL2_INDEX(page)], sizeof(pte_t), 0);
+		goto check_ptl2;
+	}
+#endif
+
 	pte_t *ptl3 = (pte_t *) PA2KA(GET_PTL3_ADDRESS(ptl2, PTL2_INDEX(page)));
 
 	/*
@@ -195,9 +338,6 @@ void pt_mapping_remove(as_t *as, uintptr_t page)
 	 */
 
 	/* Check PTL3 */
-	bool empty = true;
-
-	unsigned int i;
 	for (i = 0; i < PTL3_ENTRIES; i++) {
 		if (PTE_VALID(&ptl3[i])) {
 			empty = false;
@@ -232,6 +372,9 @@ void pt_mapping_remove(as_t *as, uintptr_t page)
 		return;
 	}
 
+#ifdef LARGE_PAGE_SIZE
+check_ptl2:
+#endif
 	/* Check PTL2, empty is still true */
 #if (PTL2_ENTRIES != 0)
 	for (i = 0; i < PTL2_ENTRIES; i++) {
@@ -291,8 +434,21 @@ void pt_mapping_remove(as_t *as, uintptr_t page)
 #endif /* PTL1_ENTRIES != 0 */
 }
 
-static pte_t *pt_mapping_find_internal(as_t *as, uintptr_t page, bool nolock)
+/** Find the PTE mapping a page.
+ *
+ * @param as         Address space to which page belongs.
+ * @param page       Virtual page.
+ * @param nolock     True if the page tables need not be locked.
+ * @param[out] large Set to true if the PTE is a PTL2 entry mapping the
+ *                   whole large page containing page.
+ *
+ * @return Pointer to the PTE or NULL if there is no mapping.
+ */
+static pte_t *pt_mapping_find_internal(as_t *as, uintptr_t page, bool nolock,
+    bool *large)
 {
+	*large = false;
+
 	assert(nolock || page_table_locked(as));
 
 	pte_t *ptl0 = (pte_t *) PA2KA((uintptr_t) as->genarch.page_table);
@@ -316,6 +472,13 @@ static pte_t *pt_mapping_find_internal(as_t *as, uintptr_t page, bool nolock)
 	if (GET_PTL3_FLAGS(ptl2, PTL2_INDEX(page)) & PAGE_NOT_PRESENT)
 		return NULL;
 
+#ifdef LARGE_PAGE_SIZE
+	if (GET_PTL3_LARGE(ptl2, PTL2_INDEX(page))) {
+		*large = true;
+		return &ptl2[PTL2_INDEX(page)];
+	}
+#endif
+
 #if (PTL2_ENTRIES != 0)
 	/*
 	 * Always read ptl3 only after we are sure it is present.
@@ -339,10 +502,28 @@ static pte_t *pt_mapping_find_internal(as_t *as, uintptr_t page, bool nolock)
  */
 bool pt_mapping_find(as_t *as, uintptr_t page, bool nolock, pte_t *pte)
 {
-	pte_t *t = pt_mapping_find_internal(as, page, nolock);
-	if (t)
-		*pte = *t;
-	return t != NULL;
+	bool large;
+	pte_t *t = pt_mapping_find_internal(as, page, nolock, &large);
+	if (!t)
+		return false;
+
+	*pte = *t;
+
+#ifdef LARGE_PAGE_SIZE
+	if (large) {
+		/*
+		 * Present the part of the large mapping that covers page
+		 * as an ordinary last-level PTE.
+		 */
+		uintptr_t frame = (uintptr_t) GET_PTL3_ADDRESS(t, 0) +
+		    (page & (LARGE_PAGE_SIZE - 1));
+
+		SET_PTL3_LARGE(pte, 0, false);
+		SET_FRAME_ADDRESS(pte, 0, ALIGN_DOWN(frame, FRAME_SIZE));
+	}
+#endif
+
+	return true;
 }
 
 /** Update mapping for virtual page in hierarchical page tables.
@@ -354,16 +535,35 @@ bool pt_mapping_find(as_t *as, uintptr_t page, bool nolock, pte_t *pte)
  */
 void pt_mapping_update(as_t *as, uintptr_t page, bool nolock, pte_t *pte)
 {
-	pte_t *t = pt_mapping_find_internal(as, page, nolock);
+	bool large;
+	pte_t *t = pt_mapping_find_internal(as, page, nolock, &large);
 	if (!t)
 		panic("Updating non-existent PTE");
 
 	assert(PTE_VALID(t) == PTE_VALID(pte));
 	assert(PTE_PRESENT(t) == PTE_PRESENT(pte));
-	assert(PTE_GET_FRAME(t) == PTE_GET_FRAME(pte));
 	assert(PTE_WRITABLE(t) == PTE_WRITABLE(pte));
 	assert(PTE_EXECUTABLE(t) == PTE_EXECUTABLE(pte));
 
+#ifdef LARGE_PAGE_SIZE
+	if (large) {
+		/*
+		 * Only the status bits can change, keep the frame of the
+		 * whole large page.
+		 */
+		uintptr_t frame = (uintptr_t) GET_PTL3_ADDRESS(t, 0);
+
+		assert(frame == ALIGN_DOWN(PTE_GET_FRAME(pte), LARGE_PAGE_SIZE));
+
+		*t = *pte;
+		SET_PTL3_ADDRESS(t, 0, frame);
+		SET_PTL3_LARGE(t, 0, true);
+		return;
+	}
+#endif
+
+	assert(PTE_GET_FRAME(t) == PTE_GET_FRAME(pte));
+
 	*t = *pte;
 }
 
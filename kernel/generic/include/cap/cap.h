@@ -38,10 +38,9 @@
 #include <abi/cap.h>
 #include <typedefs.h>
 #include <adt/list.h>
-#include <adt/hash.h>
-#include <adt/hash_table.h>
 #include <lib/ra.h>
 #include <synch/mutex.h>
+#include <synch/rcu_types.h>
 #include <atomic.h>
 
 typedef enum {
@@ -69,6 +68,8 @@ typedef struct kobject_ops {
 
 /*
  * Everything in kobject_t except for the atomic reference count is imutable.
+ * The kobject_t wrapper is freed only after an RCU grace period elapses so
+ * that kobject_get() can find it without holding the cap_info_t lock.
  */
 typedef struct kobject {
 	kobject_type_t type;
@@ -76,6 +77,9 @@ typedef struct kobject {
 
 	kobject_ops_t *ops;
 
+	/* Used for deferring the deallocation. */
+	rcu_item_t rcu;
+
 	union {
 		void *raw;
 		struct call *call;
@@ -85,7 +89,9 @@ typedef struct kobject {
 } kobject_t;
 
 /*
- * A cap_t may only be accessed under the protection of the cap_info_t lock.
+ * A cap_t may only be modified under the protection of the cap_info_t lock.
+ * Readers within an RCU read-side critical section may look it up and read
+ * its kobject member without the lock.
  */
 typedef struct cap {
 	cap_state_t state;
@@ -96,18 +102,22 @@ typedef struct cap {
 	/* Link to the task's capabilities of the same kobject type. */
 	link_t type_link;
 
-	ht_link_t caps_link;
+	/* Used for deferring the deallocation. */
+	rcu_item_t rcu;
 
-	/* The underlying kernel object. */
+	/* The underlying kernel object, NULL unless published. */
 	kobject_t *kobject;
 } cap_t;
 
+struct cap_node;
+
 typedef struct cap_info {
 	mutex_t lock;
 
 	list_t type_list[KOBJECT_TYPE_MAX];
 
-	hash_table_t caps;
+	/* Radix table of capabilities indexed by their handles. */
+	struct cap_node *table;
 	ra_arena_t *handles;
 } cap_info_t;
 
@@ -38,7 +38,10 @@
 #include <mm/tlb.h>
 #include <synch/spinlock.h>
 #include <synch/rcu_types.h>
+#include <time/timeout_types.h>
 #include <proc/scheduler.h>
+#include <mm/frame.h>
+#include <mm/reserve.h>
 #include <arch/cpu.h>
 #include <arch/context.h>
 #include <adt/list.h>
@@ -57,14 +60,43 @@ typedef struct cpu {
 	tlb_shootdown_msg_t tlb_messages[TLB_MESSAGE_QUEUE_LEN];
 	size_t tlb_messages_count;
 
+	/**
+	 * Address space installed on this processor. Senders of TLB
+	 * shootdown messages only interrupt processors which have the
+	 * affected address space installed.
+	 */
+	struct as *tlb_as;
+
 	context_t saved_context;
 
 	atomic_t nrdy;
 	runq_t rq[RQ_COUNT];
+
+	/**
+	 * Bitmap of non-empty run queues. Bit i is set if and only if
+	 * rq[i] contains ready threads. Bit i is only modified while
+	 * holding rq[i].lock.
+	 */
+	uint32_t rq_mask;
+
 	volatile size_t needs_relink;
 
+	/**
+	 * Thread most recently handed this processor, NULL if none.
+	 * Only compared with the next thread picked to run.
+	 */
+	struct thread *handoff_thread;
+
+	/**
+	 * Ticks left over by a thread which blocked in ipc_wait_for_call()
+	 * after handing this processor off. They are donated to
+	 * handoff_thread if that is the next thread to run and are
+	 * dropped otherwise.
+	 */
+	uint64_t donated_ticks;
+
 	IRQ_SPINLOCK_DECLARE(timeoutlock);
-	list_t timeout_active_list;
+	timeout_wheel_t timeout_wheel;
 
 	/**
 	 * When system clock loses a tick, it is
@@ -75,6 +107,13 @@ typedef struct cpu {
 	 */
 	size_t missed_clock_ticks;
 
+	/**
+	 * The periodic tick of this processor is stopped while it is
+	 * idle. Set only by the processor itself, read by others to
+	 * find out whether they need to wake it up.
+	 */
+	volatile bool tickless;
+
 	/**
 	 * Processor cycle accounting.
 	 */
@@ -83,11 +122,28 @@ typedef struct cpu {
 	uint64_t idle_cycles;
 	uint64_t busy_cycles;
 
+	/**
+	 * Idle work-stealing accounting.
+	 */
+	uint64_t steal_attempts;
+	uint64_t steal_successes;
+
+	/**
+	 * Number of interrupts handled, indexed by INR. Only updated
+	 * by the processor itself with interrupts disabled.
+	 */
+	uint64_t *irq_counts;
+
 	/**
 	 * Processor ID assigned by kernel.
 	 */
 	unsigned int id;
 
+	/**
+	 * NUMA node the processor belongs to.
+	 */
+	unsigned int node;
+
 	bool active;
 	volatile bool tlb_active;
 
@@ -98,15 +154,36 @@ typedef struct cpu {
 
 	struct thread *fpu_owner;
 
+	/**
+	 * Thread currently running on this processor or NULL. Only
+	 * compared by other processors, never dereferenced by them.
+	 */
+	struct thread *running;
+
 	/**
 	 * SMP calls to invoke on this CPU.
 	 */
 	SPINLOCK_DECLARE(smp_calls_lock);
 	list_t smp_pending_calls;
 
+#ifdef CONFIG_SMP
+	/**
+	 * Queue nodes for contexts waiting on MCS spinlocks, used only
+	 * by this processor.
+	 */
+	spinlock_mcs_node_t spinlock_nodes[SPINLOCK_MCS_NESTING];
+	unsigned int spinlock_nesting;
+#endif
+
 	/** RCU per-cpu data. Uses own locking. */
 	rcu_cpu_data_t rcu;
 
+	/** Cache of free frames. Uses own locking. */
+	frame_pcp_t frame_pcp;
+
+	/** Cache of reservation credit. Uses own locking. */
+	reserve_pcp_t reserve_pcp;
+
 	/**
 	 * Stack used by scheduler when there is no running thread.
 	 */
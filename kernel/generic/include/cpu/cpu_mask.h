@@ -36,7 +36,7 @@
 
 #include <cpu.h>
 #include <config.h>
-#include <lib/memfnc.h>
+#include <abi/proc/thread.h>
 
 /** Iterates over all cpu id's whose bit is included in the cpu mask.
  *
@@ -56,7 +56,7 @@
 
 /** Allocates a cpu_mask_t on stack. */
 #define DEFINE_CPU_MASK(cpu_mask) \
-	cpu_mask_t *(cpu_mask) = (cpu_mask_t*) alloca(cpu_mask_size())
+	cpu_mask_t *(cpu_mask) = (cpu_mask_t*) __builtin_alloca(cpu_mask_size())
 
 /** If used with DEFINE_CPU_MASK, the mask is large enough for all detected cpus.*/
 typedef struct cpu_mask {
@@ -72,6 +72,8 @@ extern void cpu_mask_set(cpu_mask_t *, unsigned int);
 extern void cpu_mask_reset(cpu_mask_t *, unsigned int);
 extern bool cpu_mask_is_set(cpu_mask_t *, unsigned int);
 extern bool cpu_mask_is_none(cpu_mask_t *);
+extern void cpu_mask_copy(cpu_mask_t *, cpu_mask_t *);
+extern errno_t cpu_mask_from_uspace(cpu_mask_t *, const cpuset_t *);
 
 #endif /* KERN_CPU_CPU_MASK_H_ */
 
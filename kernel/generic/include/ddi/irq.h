@@ -43,6 +43,7 @@
 #include <proc/task.h>
 #include <ipc/ipc.h>
 #include <mm/slab.h>
+#include <time/timeout.h>
 
 typedef enum {
 	IRQ_DECLINE,  /**< Decline to service. */
@@ -82,6 +83,21 @@ typedef struct {
 	irq_code_t *code;
 	/** Counter. */
 	size_t counter;
+	/** Merge interrupts into a notification which has not been received. */
+	bool coalesce;
+	/** Minimum interval between two notifications (usec), 0 if unlimited. */
+	uint32_t holdoff;
+	/** True while holdoff_timeout is registered or its handler runs. */
+	bool holdoff_active;
+	/** Timeout ending the current holdoff period. */
+	timeout_t holdoff_timeout;
+	/** Notification held back until the holdoff period ends. */
+	call_t *deferred;
+	/**
+	 * Queued notification which has not been received yet.
+	 * Protected by answerbox->irq_lock.
+	 */
+	call_t *pending;
 } ipc_notif_cfg_t;
 
 /** Structure representing one device IRQ.
@@ -135,10 +151,14 @@ extern slab_cache_t *irq_cache;
 
 extern inr_t last_inr;
 
+extern errno_t (*irq_affinity_function)(inr_t, unsigned int);
+
 extern void irq_init(size_t, size_t);
 extern void irq_initialize(irq_t *);
 extern void irq_register(irq_t *);
 extern irq_t *irq_dispatch_and_lock(inr_t);
+extern errno_t irq_set_affinity(inr_t, unsigned int);
+extern void irq_balance(inr_t);
 
 #endif
 
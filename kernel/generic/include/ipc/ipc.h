@@ -40,10 +40,19 @@
 #include <synch/waitq.h>
 #include <abi/ipc/ipc.h>
 #include <abi/proc/task.h>
+#include <abi/sysinfo.h>
 #include <typedefs.h>
 #include <mm/slab.h>
 #include <cap/cap.h>
 
+/**
+ * IPC_M_DATA_WRITE and IPC_M_DATA_READ transfers of at least this size
+ * starting at a page-aligned address are copied directly from the pinned
+ * frames of the source task instead of being bounced through a kernel
+ * buffer.
+ */
+#define DATA_XFER_PIN_THRESHOLD  (4 * PAGE_SIZE)
+
 struct answerbox;
 struct task;
 
@@ -69,6 +78,8 @@ typedef struct phone {
 	ipc_phone_state_t state;
 	atomic_t active_calls;
 	kobject_t *kobject;
+	/** IPC statistics, updated atomically. */
+	stats_ipc_phone_t ipc_info;
 } phone_t;
 
 typedef struct answerbox {
@@ -116,6 +127,8 @@ typedef struct {
 	sysarg_t label;
 	/** Capability handle */
 	cap_call_handle_t cap_handle;
+	/** Size of the inline payload of a request, 0 if there is none */
+	size_t payload_size;
 } ipc_data_t;
 
 typedef struct call {
@@ -177,6 +190,27 @@ typedef struct call {
 
 	/** Buffer for IPC_M_DATA_WRITE and IPC_M_DATA_READ. */
 	uint8_t *buffer;
+
+	/** Inline payload of the request, data.payload_size bytes long. */
+	uint8_t *payload;
+
+	/**
+	 * Pinned source frames for IPC_M_DATA_WRITE and IPC_M_DATA_READ,
+	 * used instead of buffer for large page-aligned transfers.
+	 */
+	uintptr_t *frames;
+	/** Number of entries in frames. */
+	size_t frame_count;
+
+	/** Cycle count when the request was first sent, 0 if not sent. */
+	uint64_t sent_cycles;
+
+	/**
+	 * Pending notification slot of the IRQ which may still coalesce
+	 * interrupts into this notification, NULL if none. Protected by the
+	 * irq_lock of the receiving answerbox.
+	 */
+	struct call **notif_slot;
 } call_t;
 
 extern slab_cache_t *phone_cache;
@@ -189,6 +223,9 @@ extern call_t *ipc_call_alloc(unsigned int);
 extern void ipc_call_free(call_t *);
 extern void ipc_call_hold(call_t *);
 extern void ipc_call_release(call_t *);
+extern bool ipc_call_pin_data(call_t *, uintptr_t, size_t);
+extern errno_t ipc_call_copy_data(call_t *, uintptr_t, size_t);
+extern errno_t ipc_call_set_payload(call_t *, uintptr_t, size_t);
 
 extern errno_t ipc_call_sync(phone_t *, call_t *);
 extern errno_t ipc_call(phone_t *, call_t *);
@@ -41,6 +41,9 @@
 /** Maximum length of IPC IRQ program. */
 #define IRQ_MAX_PROG_SIZE  256
 
+/** Maximum holdoff period between IPC IRQ notifications (usec). */
+#define IRQ_MAX_HOLDOFF  1000000
+
 #include <ipc/ipc.h>
 #include <ddi/irq.h>
 #include <typedefs.h>
@@ -53,6 +56,8 @@ extern void ipc_irq_top_half_handler(irq_t *);
 extern errno_t ipc_irq_subscribe(answerbox_t *, inr_t, sysarg_t, irq_code_t *,
     cap_irq_handle_t *);
 extern errno_t ipc_irq_unsubscribe(answerbox_t *, cap_irq_handle_t);
+extern errno_t ipc_irq_coalesce(answerbox_t *, cap_irq_handle_t, sysarg_t);
+extern errno_t ipc_irq_set_affinity(answerbox_t *, cap_irq_handle_t, sysarg_t);
 
 /*
  * User friendly wrappers for ipc_irq_send_msg(). They are in the form
@@ -45,10 +45,17 @@ extern sys_errno_t sys_ipc_call_async_fast(cap_phone_handle_t, sysarg_t,
     sysarg_t, sysarg_t, sysarg_t, sysarg_t);
 extern sys_errno_t sys_ipc_call_async_slow(cap_phone_handle_t, ipc_data_t *,
     sysarg_t);
+extern sys_errno_t sys_ipc_call_async_batch(ipc_batch_call_t *, size_t,
+    size_t *);
+extern sys_errno_t sys_ipc_call_async_payload(cap_phone_handle_t, ipc_data_t *,
+    void *, size_t, sysarg_t);
+extern sys_errno_t sys_ipc_payload_get(cap_call_handle_t, void *, size_t);
 extern sys_errno_t sys_ipc_answer_fast(cap_call_handle_t, sysarg_t, sysarg_t,
     sysarg_t, sysarg_t, sysarg_t);
 extern sys_errno_t sys_ipc_answer_slow(cap_call_handle_t, ipc_data_t *);
 extern sys_errno_t sys_ipc_wait_for_call(ipc_data_t *, uint32_t, unsigned int);
+extern sys_errno_t sys_ipc_wait_for_call_batch(ipc_data_t *, size_t, uint32_t,
+    unsigned int, size_t *);
 extern sys_errno_t sys_ipc_poke(void);
 extern sys_errno_t sys_ipc_forward_fast(cap_call_handle_t, cap_phone_handle_t,
     sysarg_t, sysarg_t, sysarg_t, unsigned int);
@@ -59,6 +66,8 @@ extern sys_errno_t sys_ipc_hangup(cap_phone_handle_t);
 extern sys_errno_t sys_ipc_irq_subscribe(inr_t, sysarg_t, irq_code_t *,
     cap_irq_handle_t *);
 extern sys_errno_t sys_ipc_irq_unsubscribe(cap_irq_handle_t);
+extern sys_errno_t sys_ipc_irq_coalesce(cap_irq_handle_t, sysarg_t);
+extern sys_errno_t sys_ipc_irq_set_affinity(cap_irq_handle_t, sysarg_t);
 
 extern sys_errno_t sys_ipc_connect_kbox(task_id_t *, cap_phone_handle_t *);
 
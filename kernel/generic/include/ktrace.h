@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup generic
+ * @{
+ */
+/** @file
+ */
+
+#ifndef KERN_KTRACE_H_
+#define KERN_KTRACE_H_
+
+#include <stdint.h>
+#include <typedefs.h>
+#include <abi/ktrace.h>
+#include <arch/istate.h>
+
+/** Minimum sampling period in CPU cycles. */
+#define KTRACE_SAMPLE_PERIOD_MIN  10000
+
+/** Hardware performance counter operations used for sampling
+ *
+ * Both operations concern the counters of the current processor and
+ * are called with interrupts disabled. The overflow interrupt handler
+ * reports each sample by calling ktrace_sample().
+ */
+typedef struct {
+	/** Interrupt every given number of cycles. */
+	void (*start)(uint64_t);
+	/** Stop the counter interrupts. */
+	void (*stop)(void);
+} ktrace_sampler_ops_t;
+
+/** Mask of the events being recorded. */
+extern uint32_t ktrace_mask;
+
+extern void ktrace_init(void);
+extern void ktrace_emit(ktrace_event_t, uint64_t, uint64_t);
+extern void ktrace_sampler_register(ktrace_sampler_ops_t *);
+extern void ktrace_sample(istate_t *);
+extern sys_errno_t sys_ktrace(sysarg_t, sysarg_t, sysarg_t, sysarg_t);
+
+/** Static tracepoint.
+ *
+ * When the event is not being recorded, the tracepoint costs a load
+ * and a predicted branch and the arguments are not evaluated.
+ *
+ * @param event ktrace_event_t to record.
+ * @param arg0  First event argument.
+ * @param arg1  Second event argument.
+ *
+ */
+#define KTRACE(event, arg0, arg1) \
+	do { \
+		if (__builtin_expect(__atomic_load_n(&ktrace_mask, \
+		    __ATOMIC_RELAXED) & (UINT32_C(1) << (event)), 0)) \
+			ktrace_emit((event), (uint64_t) (arg0), \
+			    (uint64_t) (arg1)); \
+	} while (0)
+
+#endif
+
+/** @}
+ */
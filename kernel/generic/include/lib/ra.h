@@ -40,9 +40,26 @@
 #include <adt/hash_table.h>
 #include <synch/spinlock.h>
 
+/** Number of quantum cache size classes (quantum, 2 * quantum, ...). */
+#define RA_QCACHE_ORDERS	4
+
+/** Capacity of one per-CPU quantum cache size class. */
+#define RA_QCACHE_SIZE		16
+
+/** Per-CPU cache of naturally aligned small segments. */
+typedef struct {
+	IRQ_SPINLOCK_DECLARE(lock);
+	size_t count[RA_QCACHE_ORDERS];
+	uintptr_t base[RA_QCACHE_ORDERS][RA_QCACHE_SIZE];
+} ra_qcache_t;
+
 typedef struct {
 	IRQ_SPINLOCK_DECLARE(lock);
 	list_t spans;		/**< List of arena's spans. */
+
+	link_t qcache_link;	/**< Link in the list of cached arenas. */
+	size_t quantum;		/**< Quantum of cached sizes or zero. */
+	ra_qcache_t *qcache;	/**< Per-CPU quantum caches or NULL. */
 } ra_arena_t;
 
 typedef struct {
@@ -85,7 +102,9 @@ typedef struct {
 } ra_segment_t;
 
 extern void ra_init(void);
+extern void ra_enable_cpucache(void);
 extern ra_arena_t *ra_arena_create(void);
+extern ra_arena_t *ra_arena_create_qcache(size_t);
 extern void ra_arena_destroy(ra_arena_t *);
 extern bool ra_span_add(ra_arena_t *, uintptr_t, size_t);
 extern bool ra_alloc(ra_arena_t *, size_t, size_t, uintptr_t *);
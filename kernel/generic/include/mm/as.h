@@ -45,6 +45,7 @@
 #include <synch/mutex.h>
 #include <adt/list.h>
 #include <adt/btree.h>
+#include <adt/odict.h>
 #include <lib/elf.h>
 #include <arch.h>
 
@@ -101,6 +102,14 @@ typedef struct as {
 	 */
 	size_t cpu_refcount;
 
+	/**
+	 * Processors on which this address space has been installed
+	 * since it was assigned its ASID and which may thus have its
+	 * mappings cached in their TLBs. NULL for the kernel address
+	 * space. Bits are set under tlblock and cleared under asidlock.
+	 */
+	struct cpu_mask *cpu_mask;
+
 	/** Address space identifier.
 	 *
 	 * Constant on architectures that do not
@@ -114,8 +123,8 @@ typedef struct as {
 
 	mutex_t lock;
 
-	/** B+tree of address space areas. */
-	btree_t as_area_btree;
+	/** Address space areas ordered by their base address. */
+	odict_t as_areas;
 
 	/** Non-generic content. */
 	as_genarch_t genarch;
@@ -192,6 +201,18 @@ typedef union mem_backend_data {
 
 } mem_backend_data_t;
 
+/** Interval of used pages in an address space area. */
+typedef struct {
+	/** Link to as_area_t.used_space. */
+	odlink_t lused_space;
+
+	/** First page of the interval. */
+	uintptr_t page;
+
+	/** Number of pages in the interval. */
+	size_t count;
+} used_space_ival_t;
+
 /** Address space area structure.
  *
  * Each as_area_t structure describes one contiguous area of virtual memory.
@@ -203,6 +224,9 @@ typedef struct {
 	/** Containing address space. */
 	as_t *as;
 
+	/** Link to as_t.as_areas. */
+	odlink_t las_areas;
+
 	/** Memory flags. */
 	unsigned int flags;
 
@@ -218,8 +242,11 @@ typedef struct {
 	/** Base address of this area. */
 	uintptr_t base;
 
-	/** Map of used space. */
-	btree_t used_space;
+	/**
+	 * Map of used space. Non-adjacent intervals of used pages ordered
+	 * by their first page.
+	 */
+	odict_t used_space;
 
 	/**
 	 * If the address space area is shared. this is
@@ -273,9 +300,16 @@ extern errno_t as_area_share(as_t *, uintptr_t, size_t, as_t *, unsigned int,
     uintptr_t *, uintptr_t);
 extern errno_t as_area_change_flags(as_t *, unsigned int, uintptr_t);
 
+extern as_area_t *as_area_first(as_t *);
+extern as_area_t *as_area_next(as_area_t *);
 extern unsigned int as_area_get_flags(as_area_t *);
 extern bool as_area_check_access(as_area_t *, pf_access_t);
 extern size_t as_area_get_size(uintptr_t);
+extern errno_t as_pin_frames(as_t *, uintptr_t, size_t, uintptr_t *);
+extern void as_unpin_frames(uintptr_t *, size_t);
+extern used_space_ival_t *used_space_first(as_area_t *);
+extern used_space_ival_t *used_space_last(as_area_t *);
+extern used_space_ival_t *used_space_next(as_area_t *, used_space_ival_t *);
 extern bool used_space_insert(as_area_t *, uintptr_t, size_t);
 extern bool used_space_remove(as_area_t *, uintptr_t, size_t);
 
@@ -47,6 +47,12 @@
 /** Maximum number of zones in the system. */
 #define ZONES_MAX  32
 
+/** Capacity of the per-CPU free frame cache. */
+#define FRAME_PCP_MAX  64
+
+/** Default number of frames moved between the zones and a per-CPU cache. */
+#define FRAME_PCP_BATCH  16
+
 typedef uint8_t frame_flags_t;
 
 #define FRAME_NONE        0x00
@@ -109,6 +115,9 @@ typedef struct {
 	/** Type of the zone */
 	zone_flags_t flags;
 
+	/** NUMA node the memory of the zone belongs to */
+	unsigned int node;
+
 	/** Frame bitmap */
 	bitmap_t bitmap;
 
@@ -128,6 +137,22 @@ typedef struct {
 
 extern zones_t zones;
 
+/** Per-CPU cache of single free frames
+ *
+ * The cached frames are taken from the zones in batches and still appear
+ * as busy in the zones. Freed frames are queued as pending and their
+ * reference counts are dropped in batches as well.
+ *
+ */
+typedef struct {
+	IRQ_SPINLOCK_DECLARE(lock);
+	size_t zone;                   /**< Zone hint for the cached frames */
+	size_t count;                  /**< Number of cached free frames */
+	size_t pending_count;          /**< Number of pending frees */
+	pfn_t frames[FRAME_PCP_MAX];   /**< Cached free frames */
+	pfn_t pending[FRAME_PCP_MAX];  /**< Frames waiting to be released */
+} frame_pcp_t;
+
 extern void frame_init(void);
 extern bool frame_adjust_zone_bounds(bool, uintptr_t *, size_t *);
 extern uintptr_t frame_alloc_generic(size_t, frame_flags_t, uintptr_t,
@@ -138,16 +163,21 @@ extern void frame_free(uintptr_t, size_t);
 extern void frame_free_noreserve(uintptr_t, size_t);
 extern void frame_reference_add(pfn_t);
 extern size_t frame_total_free_get(void);
+extern void frame_pcp_initialize(frame_pcp_t *);
+extern void frame_pcp_drain_all(void);
+extern errno_t frame_pcp_set_batch(size_t);
 
 extern size_t find_zone(pfn_t, size_t, size_t);
 extern size_t zone_create(pfn_t, size_t, pfn_t, zone_flags_t);
 extern void *frame_get_parent(pfn_t, size_t);
 extern void frame_set_parent(pfn_t, void *, size_t);
+extern size_t frame_refcount_get(pfn_t);
 extern void frame_mark_unavailable(pfn_t, size_t);
 extern size_t zone_conf_size(size_t);
 extern pfn_t zone_external_conf_alloc(size_t);
 extern bool zone_merge(size_t, size_t);
 extern void zone_merge_all(void);
+extern void zones_numa_update(void);
 extern uint64_t zones_total_size(void);
 extern void zones_stats(uint64_t *, uint64_t *, uint64_t *, uint64_t *);
 
@@ -50,6 +50,10 @@ typedef struct {
 	bool (*mapping_find)(as_t *, uintptr_t, bool, pte_t *);
 	void (*mapping_update)(as_t *, uintptr_t, bool, pte_t *);
 	void (*mapping_make_global)(uintptr_t, size_t);
+	/** Optional, map a large page. */
+	bool (*mapping_insert_large)(as_t *, uintptr_t, uintptr_t, unsigned int);
+	/** Optional, split a large mapping. */
+	void (*mapping_split)(as_t *, uintptr_t);
 } page_mapping_operations_t;
 
 extern page_mapping_operations_t *page_mapping_operations;
@@ -63,6 +67,9 @@ extern void page_mapping_remove(as_t *, uintptr_t);
 extern bool page_mapping_find(as_t *, uintptr_t, bool, pte_t *);
 extern void page_mapping_update(as_t *, uintptr_t, bool, pte_t *);
 extern void page_mapping_make_global(uintptr_t, size_t);
+extern bool page_mapping_insert_large(as_t *, uintptr_t, uintptr_t,
+    unsigned int);
+extern void page_mapping_split(as_t *, uintptr_t);
 extern pte_t *page_table_create(unsigned int);
 extern void page_table_destroy(pte_t *);
 
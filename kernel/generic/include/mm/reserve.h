@@ -37,8 +37,18 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <synch/spinlock.h>
+
+/** Per-CPU cache of reservation credit. */
+typedef struct {
+	IRQ_SPINLOCK_DECLARE(lock);
+
+	/** Frames taken from the global pool but not reserved by anyone yet. */
+	size_t credit;
+} reserve_pcp_t;
 
 extern void reserve_init(void);
+extern void reserve_pcp_initialize(reserve_pcp_t *);
 extern bool reserve_try_alloc(size_t);
 extern void reserve_force_alloc(size_t);
 extern void reserve_free(size_t);
@@ -39,6 +39,7 @@
 #include <synch/spinlock.h>
 #include <atomic.h>
 #include <mm/frame.h>
+#include <abi/sysinfo.h>
 
 /** Minimum size to be allocated by malloc */
 #define SLAB_MIN_MALLOC_W  4
@@ -46,9 +47,21 @@
 /** Maximum size to be allocated by malloc */
 #define SLAB_MAX_MALLOC_W  22
 
-/** Initial Magazine size (TODO: dynamically growing magazines) */
+/** Initial magazine size */
 #define SLAB_MAG_SIZE  4
 
+/** Number of magazine size classes (each doubling the previous one) */
+#define SLAB_MAG_CLASSES  5
+
+/** Maximum magazine size */
+#define SLAB_MAG_SIZE_MAX  (SLAB_MAG_SIZE << (SLAB_MAG_CLASSES - 1))
+
+/** Number of depot lock acquisitions in one contention sampling window */
+#define SLAB_MAG_RESIZE_WINDOW  256
+
+/** Contended depot acquisitions per window which trigger magazine growth */
+#define SLAB_MAG_RESIZE_THRESHOLD  16
+
 /** If object size is less, store control structure inside SLAB */
 #define SLAB_INSIDE_SIZE  (PAGE_SIZE >> 3)
 
@@ -81,6 +94,11 @@ typedef struct {
 	slab_magazine_t *current;
 	slab_magazine_t *last;
 	IRQ_SPINLOCK_DECLARE(lock);
+
+	/* Statistics */
+	uint64_t hits;        /**< Allocations served from the magazines */
+	uint64_t misses;      /**< Allocations passed down to the slab layer */
+	uint64_t contention;  /**< Contended magazine depot acquisitions */
 } slab_mag_cache_t;
 
 typedef struct {
@@ -118,6 +136,11 @@ typedef struct {
 	list_t magazines;  /**< List o full magazines */
 	IRQ_SPINLOCK_DECLARE(maglock);
 
+	/* Magazine resizing (updated under maglock) */
+	size_t mag_size;        /**< Size of newly allocated magazines */
+	size_t mag_ops;         /**< Depot acquisitions in the current window */
+	size_t mag_contention;  /**< Contended acquisitions in the window */
+
 	/** CPU cache */
 	slab_mag_cache_t *mag_cache;
 } slab_cache_t;
@@ -138,6 +161,11 @@ extern void slab_enable_cpucache(void);
 /* kconsole debug */
 extern void slab_print_list(void);
 
+/* sysinfo statistics */
+#define SLAB_STATS_ALL_CPUS  ((unsigned int) -1)
+
+extern size_t slab_stats_get(stats_slab_t *, size_t, unsigned int);
+
 /* malloc support */
 extern void *malloc(size_t)
     __attribute__((malloc));
@@ -40,10 +40,17 @@
 #include <time/clock.h>
 #include <atomic.h>
 #include <adt/list.h>
+#include <bitops.h>
+#include <trace.h>
+#include <abi/proc/thread.h>
 
 #define RQ_COUNT          16
 #define NEEDS_RELINK_MAX  (HZ)
 
+#if RQ_COUNT > 32
+#error "RQ_COUNT does not fit into the run queue bitmap"
+#endif
+
 /** Scheduler run queue structure. */
 typedef struct {
 	IRQ_SPINLOCK_DECLARE(lock);
@@ -51,6 +58,54 @@ typedef struct {
 	size_t n;			/**< Number of threads in rq_ready. */
 } runq_t;
 
+/** Mark run queue as non-empty in the run queue bitmap.
+ *
+ * Must be called with the respective run queue lock held.
+ *
+ * @param mask Run queue bitmap.
+ * @param i    Run queue index.
+ *
+ */
+NO_TRACE static inline void rq_mask_set(uint32_t *mask, unsigned int i)
+{
+	(void) __atomic_fetch_or(mask, UINT32_C(1) << i, __ATOMIC_RELAXED);
+}
+
+/** Mark run queue as empty in the run queue bitmap.
+ *
+ * Must be called with the respective run queue lock held.
+ *
+ * @param mask Run queue bitmap.
+ * @param i    Run queue index.
+ *
+ */
+NO_TRACE static inline void rq_mask_clear(uint32_t *mask, unsigned int i)
+{
+	(void) __atomic_fetch_and(mask, ~(UINT32_C(1) << i), __ATOMIC_RELAXED);
+}
+
+/** Find the highest-priority non-empty run queue.
+ *
+ * The bitmap is read without holding any run queue lock, therefore
+ * the result is only a hint which needs to be verified under the
+ * respective run queue lock.
+ *
+ * @param mask Run queue bitmap.
+ *
+ * @return Index of the highest-priority non-empty run queue
+ *         or RQ_COUNT if all run queues appear to be empty.
+ *
+ */
+NO_TRACE static inline unsigned int rq_mask_first(uint32_t *mask)
+{
+	uint32_t val = __atomic_load_n(mask, __ATOMIC_RELAXED);
+	if (val == 0)
+		return RQ_COUNT;
+
+	/* Isolate the lowest set bit */
+	return fnzb32(val & (~val + 1));
+}
+
 extern atomic_t nrdy;
 extern void scheduler_init(void);
 
@@ -58,6 +113,10 @@ extern void scheduler_fpu_lazy_request(void);
 extern void scheduler(void);
 extern void kcpulb(void *arg);
 
+struct thread;
+extern void scheduler_pi_boost(struct thread *, int);
+extern void scheduler_pi_unboost(struct thread *);
+
 extern void sched_print_list(void);
 
 /*
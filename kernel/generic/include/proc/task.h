@@ -36,6 +36,7 @@
 #define KERN_TASK_H_
 
 #include <cpu.h>
+#include <cpu/cpu_mask.h>
 #include <ipc/ipc.h>
 #include <ipc/event.h>
 #include <ipc/kbox.h>
@@ -64,6 +65,9 @@
 
 #define TASK                 THE->task
 
+/** Number of buckets of the per-task thread ID hash. */
+#define TASK_TID_BUCKETS     16
+
 
 struct thread;
 struct cap;
@@ -83,6 +87,15 @@ typedef struct task {
 	char name[TASK_NAME_BUFLEN];
 	/** List of threads contained in this task. */
 	list_t threads;
+
+	/** Lock protecting tid_hash.
+	 *
+	 * Can be acquired while holding the task lock. Must be acquired
+	 * before run queue locks and thread lock of any of its threads.
+	 */
+	IRQ_SPINLOCK_DECLARE(tid_lock);
+	/** Threads contained in this task hashed by their thread ID. */
+	list_t tid_hash[TASK_TID_BUCKETS];
 	/** Address space. */
 	as_t *as;
 	/** Unique identity of task. */
@@ -144,6 +157,22 @@ typedef struct task {
 	/** Accumulated accounting. */
 	uint64_t ucycles;
 	uint64_t kcycles;
+
+	/**
+	 * Page fault statistics. Protected by the lock of the task's
+	 * address space.
+	 */
+	uint64_t page_faults;
+	uint64_t pages_prefaulted;
+
+	/**
+	 * CPUs the threads of the task are allowed to run on.
+	 * Inherited by newly created threads. Protected by lock.
+	 *
+	 * The mask is sized for all detected CPUs, therefore it must
+	 * remain the last member of the structure.
+	 */
+	cpu_mask_t affinity;
 } task_t;
 
 IRQ_SPINLOCK_EXTERN(tasks_lock);
@@ -183,6 +212,7 @@ extern sysarg_t sys_task_get_id(void);
 extern sys_errno_t sys_task_set_name(const char *, size_t);
 extern sys_errno_t sys_task_kill(task_id_t *);
 extern sys_errno_t sys_task_exit(sysarg_t);
+extern sys_errno_t sys_task_set_affinity(const cpuset_t *);
 
 #endif
 
@@ -39,6 +39,7 @@
 #include <proc/task.h>
 #include <time/timeout.h>
 #include <cpu.h>
+#include <cpu/cpu_mask.h>
 #include <synch/spinlock.h>
 #include <synch/rcu_types.h>
 #include <adt/avl.h>
@@ -74,6 +75,7 @@ typedef struct thread {
 	link_t rq_link;  /**< Run queue link. */
 	link_t wq_link;  /**< Wait queue link. */
 	link_t th_link;  /**< Links to threads within containing task. */
+	link_t tid_link;  /**< Link in tid_hash of the containing task. */
 
 	/** Threads linkage to the threads_tree. */
 	avltree_node_t threads_tree_node;
@@ -175,6 +177,8 @@ typedef struct thread {
 	bool wired;
 	/** Thread was migrated to another CPU and has not run yet. */
 	bool stolen;
+	/** Thread is blocking in ipc_wait_for_call(). */
+	bool ipc_wait;
 	/** Thread is executed in user space. */
 	bool uspace;
 
@@ -191,6 +195,11 @@ typedef struct thread {
 
 	/** Thread's priority. Implemented as index to CPU->rq */
 	int priority;
+
+	/** Number of priority boosts lent by waiters on locks held. */
+	unsigned int pi_boosts;
+	/** Most urgent priority lent while pi_boosts is non-zero. */
+	int pi_priority;
 	/** Thread ID. */
 	thread_id_t tid;
 
@@ -222,6 +231,14 @@ typedef struct thread {
 	/** Debugging stuff */
 	udebug_thread_t udebug;
 #endif /* CONFIG_UDEBUG */
+
+	/**
+	 * CPUs the thread is allowed to run on. Protected by lock.
+	 *
+	 * The mask is sized for all detected CPUs, therefore it must
+	 * remain the last member of the structure.
+	 */
+	cpu_mask_t affinity;
 } thread_t;
 
 /** Thread list lock.
@@ -241,6 +258,7 @@ extern thread_t *thread_create(void (*)(void *), void *, task_t *,
 extern void thread_wire(thread_t *, cpu_t *);
 extern void thread_attach(thread_t *, task_t *);
 extern void thread_ready(thread_t *);
+extern void thread_ready_handoff(thread_t *);
 extern void thread_exit(void) __attribute__((noreturn));
 extern void thread_interrupt(thread_t *);
 extern bool thread_interrupted(thread_t *);
@@ -269,6 +287,7 @@ extern void thread_detach(thread_t *);
 extern void thread_print_list(bool);
 extern void thread_destroy(thread_t *, bool);
 extern thread_t *thread_find_by_id(thread_id_t);
+extern thread_t *thread_find_in_task(task_t *, thread_id_t);
 extern void thread_update_accounting(bool);
 extern bool thread_exists(thread_t *);
 
@@ -289,6 +308,7 @@ extern sys_errno_t sys_thread_exit(int);
 extern sys_errno_t sys_thread_get_id(thread_id_t *);
 extern sys_errno_t sys_thread_usleep(uint32_t);
 extern sys_errno_t sys_thread_udelay(uint32_t);
+extern sys_errno_t sys_thread_set_affinity(thread_id_t *, const cpuset_t *);
 
 #endif
 
@@ -37,23 +37,25 @@
 
 #include <typedefs.h>
 #include <synch/waitq.h>
-#include <adt/hash_table.h>
+#include <adt/list.h>
 
 /** Kernel-side futex structure. */
 typedef struct {
-	/** Physical address of the status variable. */
+	/** Physical address of the status variable of a shared futex. */
 	uintptr_t paddr;
+	/** True if the futex is in the global futex table. */
+	bool shared;
 	/** Wait queue for threads waiting for futex availability. */
 	waitq_t wq;
-	/** Futex hash table link. */
-	ht_link_t ht_link;
+	/** Link to the global futex table bucket of a shared futex. */
+	link_t ht_link;
 	/** Number of tasks that reference this futex. */
 	size_t refcount;
 } futex_t;
 
 extern void futex_init(void);
-extern sys_errno_t sys_futex_sleep(uintptr_t, uintptr_t);
-extern sys_errno_t sys_futex_wakeup(uintptr_t);
+extern sys_errno_t sys_futex_sleep(uintptr_t, uintptr_t, sysarg_t, sysarg_t);
+extern sys_errno_t sys_futex_wakeup(uintptr_t, sysarg_t);
 
 extern void futex_task_cleanup(void);
 extern void futex_task_init(struct task *);
@@ -38,23 +38,42 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <synch/semaphore.h>
+#include <atomic.h>
 #include <abi/synch.h>
+#include <abi/proc/thread.h>
 
 typedef enum {
 	MUTEX_PASSIVE,
 	MUTEX_RECURSIVE,
-	MUTEX_ACTIVE
+	MUTEX_ACTIVE,
+	MUTEX_PI
 } mutex_type_t;
 
 struct thread;
+struct cpu;
 
 typedef struct {
 	mutex_type_t type;
 	semaphore_t sem;
 	struct thread *owner;
+	thread_id_t owner_tid;
+	/** Processor the owner of a passive mutex acquired it on. */
+	struct cpu *owner_cpu;
 	unsigned nesting;
 } mutex_t;
 
+/** Contention statistics of passive mutexes. */
+typedef struct {
+	/** Acquisitions which found the mutex locked. */
+	atomic_t contended;
+	/** Contended acquisitions which succeeded while spinning. */
+	atomic_t spun;
+	/** Contended acquisitions which fell back to sleeping. */
+	atomic_t blocked;
+} mutex_stats_t;
+
+extern mutex_stats_t mutex_stats;
+
 #define mutex_lock(mtx) \
 	_mutex_lock_timeout((mtx), SYNCH_NO_TIMEOUT, SYNCH_FLAGS_NONE)
 
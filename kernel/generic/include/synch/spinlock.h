@@ -42,13 +42,62 @@
 #include <atomic.h>
 #include <arch/asm.h>
 
+/** Tell the processor that we are busy-waiting */
+#if defined(__i386__) || defined(__x86_64__)
+#define spin_hint()  asm volatile ("pause")
+#else
+#define spin_hint()
+#endif
+
+/** Spinlock implementation variants */
+typedef enum {
+	/** Test-and-set lock, cheapest when uncontended (default) */
+	SPINLOCK_TAS = 0,
+	/** Ticket lock, grants the lock in FIFO order */
+	SPINLOCK_TICKET,
+	/** Queued (MCS) lock, each waiter spins on its own cache line */
+	SPINLOCK_MCS
+} spinlock_kind_t;
+
 #ifdef CONFIG_SMP
 
+/** Maximum nesting of contexts spinning on MCS locks on one CPU */
+#define SPINLOCK_MCS_NESTING  4
+
+/** Per-CPU queue node of a waiter on an MCS lock */
+typedef struct spinlock_mcs_node {
+	struct spinlock_mcs_node *next;
+	bool locked;
+} spinlock_mcs_node_t;
+
+#ifdef CONFIG_DEBUG_SPINLOCK
+
+/** Spinlock contention statistics */
+typedef struct {
+	/** Number of acquisitions */
+	uint64_t acquired;
+	/** Number of acquisitions which had to wait */
+	uint64_t contended;
+	/** Total number of spin iterations spent waiting */
+	uint64_t spins;
+} spinlock_stats_t;
+
+#endif /* CONFIG_DEBUG_SPINLOCK */
+
 typedef struct spinlock {
+	/**
+	 * Lock word. For SPINLOCK_TAS it is non-zero when locked,
+	 * for SPINLOCK_TICKET it holds the next and the owner ticket,
+	 * for SPINLOCK_MCS the locked bit and the queue tail.
+	 */
 	atomic_t val;
 
+	/** Implementation variant */
+	spinlock_kind_t kind;
+
 #ifdef CONFIG_DEBUG_SPINLOCK
 	const char *name;
+	spinlock_stats_t stats;
 #endif /* CONFIG_DEBUG_SPINLOCK */
 } spinlock_t;
 
@@ -99,7 +148,7 @@ typedef struct spinlock {
 #define ASSERT_SPINLOCK(expr, lock) \
 	assert(expr)
 
-#define spinlock_lock(lock)    atomic_lock_arch(&(lock)->val)
+#define spinlock_lock(lock)    spinlock_lock_nondebug((lock))
 #define spinlock_unlock(lock)  spinlock_unlock_nondebug((lock))
 
 #endif /* CONFIG_DEBUG_SPINLOCK */
@@ -111,11 +160,34 @@ typedef struct spinlock {
 	SPINLOCK_STATIC_INITIALIZE_NAME(lock_name, #lock_name)
 
 extern void spinlock_initialize(spinlock_t *, const char *);
+extern void spinlock_set_kind(spinlock_t *, spinlock_kind_t);
 extern bool spinlock_trylock(spinlock_t *);
 extern void spinlock_lock_debug(spinlock_t *);
 extern void spinlock_unlock_debug(spinlock_t *);
+extern void spinlock_lock_queued(spinlock_t *);
+extern void spinlock_release_queued(spinlock_t *);
 extern bool spinlock_locked(spinlock_t *);
 
+#ifdef CONFIG_DEBUG_SPINLOCK
+extern void spinlock_stats(spinlock_t *, spinlock_stats_t *);
+#endif
+
+/** Lock spinlock
+ *
+ * Lock spinlock for non-debug kernels. Test-and-set locks take
+ * the inlined architecture fast path.
+ *
+ * @param lock Pointer to spinlock_t structure.
+ *
+ */
+NO_TRACE static inline void spinlock_lock_nondebug(spinlock_t *lock)
+{
+	if (lock->kind == SPINLOCK_TAS)
+		atomic_lock_arch(&lock->val);
+	else
+		spinlock_lock_queued(lock);
+}
+
 /** Unlock spinlock
  *
  * Unlock spinlock for non-debug kernels.
@@ -130,7 +202,11 @@ NO_TRACE static inline void spinlock_unlock_nondebug(spinlock_t *lock)
 	 */
 	CS_LEAVE_BARRIER();
 
-	atomic_set(&lock->val, 0);
+	if (lock->kind == SPINLOCK_TAS)
+		atomic_set(&lock->val, 0);
+	else
+		spinlock_release_queued(lock);
+
 	preemption_enable();
 }
 
@@ -177,6 +253,7 @@ typedef struct spinlock spinlock_t;
 #define ASSERT_SPINLOCK(expr, lock)  assert(expr)
 
 #define spinlock_initialize(lock, name)
+#define spinlock_set_kind(lock, kind)
 
 #define spinlock_lock(lock)     preemption_disable()
 #define spinlock_trylock(lock)  ({ preemption_disable(); 1; })
@@ -284,6 +361,7 @@ typedef struct {
 	IRQ_SPINLOCK_STATIC_INITIALIZE_NAME(lock_name, #lock_name)
 
 extern void irq_spinlock_initialize(irq_spinlock_t *, const char *);
+extern void irq_spinlock_set_kind(irq_spinlock_t *, spinlock_kind_t);
 extern void irq_spinlock_lock(irq_spinlock_t *, bool);
 extern void irq_spinlock_unlock(irq_spinlock_t *, bool);
 extern bool irq_spinlock_trylock(irq_spinlock_t *);
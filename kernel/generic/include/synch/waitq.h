@@ -42,7 +42,9 @@
 
 typedef enum {
 	WAKEUP_FIRST = 0,
-	WAKEUP_ALL
+	WAKEUP_ALL,
+	/** Wake the first sleeper and hand it the current CPU. */
+	WAKEUP_HANDOFF
 } wakeup_mode_t;
 
 /** Wait queue structure.
@@ -39,17 +39,60 @@
 
 #define HZ  100
 
-/** Uptime structure */
+/** Uptime structure
+ *
+ * If the architecture registered an invariant cycle counter, the uptime
+ * in nanoseconds can also be computed from the counter as
+ *
+ *   nseconds + (((cycle - cycles) * cycle_mult) >> cycle_shift)
+ *
+ * The calibration is valid when cycle_mult is non-zero. The base values
+ * are periodically rebased and may be read only when cycle_seq is even
+ * and unchanged across the read.
+ */
 typedef struct {
 	sysarg_t seconds1;
 	sysarg_t useconds;
 	sysarg_t seconds2;
+
+	sysarg_t cycle_seq;
+	uint32_t cycle_mult;
+	uint32_t cycle_shift;
+	uint64_t cycles;
+	uint64_t nseconds;
 } uptime_t;
 
+/** Upper bound on the number of ticks an idle processor may skip. */
+#define CLOCK_IDLE_TICKS_MAX  HZ
+
+/** Local timer operations needed for stopping the tick on idle processors
+ *
+ * All operations concern the timer of the current processor and are
+ * called with interrupts disabled, except for kick().
+ */
+typedef struct {
+	/** Return the longest one-shot period in ticks the timer supports. */
+	uint64_t (*max_ticks)(void);
+	/** Stop the periodic tick and fire once after the given ticks. */
+	void (*oneshot)(uint64_t);
+	/** Resume the periodic tick, return the ticks elapsed meanwhile. */
+	uint64_t (*periodic)(void);
+	/** Wake up the idle processor with the given id. */
+	void (*kick)(unsigned int);
+} clock_dyntick_ops_t;
+
+struct cpu;
+
 extern uptime_t *uptime;
 
 extern void clock(void);
 extern void clock_counter_init(void);
+extern void clock_cycle_register(uint64_t);
+extern uint64_t clock_uptime_nsec(void);
+extern void clock_dyntick_register(clock_dyntick_ops_t *);
+extern void clock_idle_enter(void);
+extern void clock_idle_exit(void);
+extern void clock_idle_kick(struct cpu *);
 
 #endif
 
@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2018 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup time
+ * @{
+ */
+/** @file
+ */
+
+#ifndef KERN_TIMEOUT_TYPES_H_
+#define KERN_TIMEOUT_TYPES_H_
+
+#include <adt/list.h>
+#include <stdint.h>
+
+/** Number of bits of a deadline covered by one level of the timeout wheel. */
+#define TIMEOUT_WHEEL_BITS    6
+/** Number of slots in one level of the timeout wheel. */
+#define TIMEOUT_WHEEL_SLOTS   (1 << TIMEOUT_WHEEL_BITS)
+#define TIMEOUT_WHEEL_MASK    (TIMEOUT_WHEEL_SLOTS - 1)
+/** Number of levels of the timeout wheel. */
+#define TIMEOUT_WHEEL_LEVELS  4
+
+/** Hierarchical timing wheel of active timeouts.
+ *
+ * Level 0 has a slot for each of the next TIMEOUT_WHEEL_SLOTS ticks.
+ * Every slot of level n covers TIMEOUT_WHEEL_SLOTS slots of level
+ * n - 1; its timeouts are cascaded to the lower level when the wheel
+ * reaches the range covered by the slot.
+ */
+typedef struct {
+	/** Tick which the wheel is going to process next. */
+	uint64_t now;
+	/** Lists of timeouts, indexed by level and slot. */
+	list_t slot[TIMEOUT_WHEEL_LEVELS][TIMEOUT_WHEEL_SLOTS];
+} timeout_wheel_t;
+
+#endif
+
+/** @}
+ */
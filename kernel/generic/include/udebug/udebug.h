@@ -63,6 +63,22 @@ typedef struct {
 	int not_stoppable_count;
 	struct task *debugger;
 	udebug_evmask_t evmask;
+
+	/** Syscall event filter or NULL if all syscalls pass */
+	udebug_filter_t *filter;
+
+	/** Events are logged instead of stopping the threads */
+	bool log_mode;
+	/** Ring of logged events */
+	udebug_log_entry_t *log;
+	/** Capacity of the ring in entries */
+	size_t log_capacity;
+	/** Index of the oldest entry */
+	size_t log_head;
+	/** Number of entries in the ring */
+	size_t log_count;
+	/** Number of events dropped because the ring was full */
+	size_t log_lost;
 } udebug_task_t;
 
 /** Debugging part of thread_t structure.
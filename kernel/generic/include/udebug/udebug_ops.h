@@ -43,6 +43,12 @@
 errno_t udebug_begin(call_t *call, bool *active);
 errno_t udebug_end(void);
 errno_t udebug_set_evmask(udebug_evmask_t mask);
+errno_t udebug_set_filter(udebug_filter_t *filter);
+
+errno_t udebug_log_start(size_t capacity);
+errno_t udebug_log_stop(void);
+errno_t udebug_log_read(void **buffer, size_t buf_size, size_t *stored,
+    size_t *lost);
 
 errno_t udebug_go(thread_t *t, call_t *call);
 errno_t udebug_stop(thread_t *t, call_t *call);
@@ -70,6 +70,13 @@
  * kobject_get() or kobject_add_ref(). When the kernel object is removed from
  * the container, the reference count should go down via a call to
  * kobject_put().
+ *
+ * Capabilities of a task are kept in a radix table indexed directly by their
+ * handles. The table and the capabilities are modified only under the
+ * protection of the task's cap_info_t lock, but the capabilities and the
+ * kernel object wrappers are freed only after an RCU grace period elapses.
+ * This allows kobject_get(), which is invoked by every IPC syscall, to
+ * translate a handle without taking any lock.
  */
 
 #include <cap/cap.h>
@@ -79,6 +86,8 @@
 #include <abi/errno.h>
 #include <mm/slab.h>
 #include <adt/list.h>
+#include <synch/rcu.h>
+#include <mem.h>
 
 #include <stdint.h>
 
@@ -86,37 +95,172 @@
 #define CAPS_SIZE	(INT_MAX - CAPS_START)
 #define CAPS_LAST	(CAPS_SIZE - 1)
 
+/* Number of handle bits resolved by one level of the capability table. */
+#define CAPS_LEVEL_BITS	8
+#define CAPS_LEVEL_SIZE	(1 << CAPS_LEVEL_BITS)
+#define CAPS_LEVEL_MASK	(CAPS_LEVEL_SIZE - 1)
+
+/* Maximum height of the capability table needed to cover CAPS_LAST. */
+#define CAPS_LEVELS	4
+
+/*
+ * Node of the capability table. The slots of a node of height 1 point to
+ * capabilities, the slots of higher nodes point to nodes one level lower.
+ * The table grows at the root as higher handles get allocated and is only
+ * freed as a whole.
+ */
+typedef struct cap_node {
+	unsigned int height;
+	void *slot[CAPS_LEVEL_SIZE];
+} cap_node_t;
+
 static slab_cache_t *cap_cache;
+static slab_cache_t *cap_node_cache;
 
-static size_t caps_hash(const ht_link_t *item)
+void caps_init(void)
 {
-	cap_t *cap = hash_table_get_inst(item, cap_t, caps_link);
-	return hash_mix(CAP_HANDLE_RAW(cap->handle));
+	cap_cache = slab_cache_create("cap_t", sizeof(cap_t), 0, NULL,
+	    NULL, 0);
+	cap_node_cache = slab_cache_create("cap_node_t", sizeof(cap_node_t),
+	    0, NULL, NULL, 0);
 }
 
-static size_t caps_key_hash(void *key)
+/** Return index of the slot covering a handle in a node of given height */
+static inline size_t caps_slot_idx(uintptr_t raw, unsigned int height)
 {
-	cap_handle_t *handle = (cap_handle_t *) key;
-	return hash_mix(CAP_HANDLE_RAW(*handle));
+	return (raw >> ((height - 1) * CAPS_LEVEL_BITS)) & CAPS_LEVEL_MASK;
 }
 
-static bool caps_key_equal(void *key, const ht_link_t *item)
+/** Test whether a handle is covered by a table with the given root */
+static inline bool caps_node_covers(cap_node_t *root, uintptr_t raw)
 {
-	cap_handle_t *handle = (cap_handle_t *) key;
-	cap_t *cap = hash_table_get_inst(item, cap_t, caps_link);
-	return *handle == cap->handle;
+	return (root->height >= CAPS_LEVELS) ||
+	    ((raw >> (root->height * CAPS_LEVEL_BITS)) == 0);
 }
 
-static hash_table_ops_t caps_ops = {
-	.hash = caps_hash,
-	.key_hash = caps_key_hash,
-	.key_equal = caps_key_equal
-};
+/** Initialize a spare table node for use
+ *
+ * The spare node is allocated by the caller without holding the cap_info_t
+ * lock so that the allocation can block.
+ *
+ * @param spare   Spare node, NULL on return.
+ * @param height  Height of the node in the table.
+ *
+ * @return The initialized node.
+ * @return NULL if there is no spare node.
+ */
+static cap_node_t *caps_node_take(cap_node_t **spare, unsigned int height)
+{
+	cap_node_t *node = *spare;
+	if (!node)
+		return NULL;
 
-void caps_init(void)
+	*spare = NULL;
+	node->height = height;
+	memsetb(node->slot, sizeof(node->slot), 0);
+	return node;
+}
+
+static void caps_node_free(cap_node_t *node)
 {
-	cap_cache = slab_cache_create("cap_t", sizeof(cap_t), 0, NULL,
-	    NULL, 0);
+	if (node->height > 1) {
+		for (size_t i = 0; i < CAPS_LEVEL_SIZE; i++) {
+			if (node->slot[i])
+				caps_node_free((cap_node_t *) node->slot[i]);
+		}
+	}
+
+	slab_free(cap_node_cache, node);
+}
+
+/** Find the table slot of a capability
+ *
+ * The caller must either hold the cap_info_t lock or be in an RCU read-side
+ * critical section.
+ *
+ * @param info    Capability info structure of the task.
+ * @param handle  Capability handle.
+ *
+ * @return Address of the slot for the capability.
+ * @return NULL if the table does not cover the handle.
+ */
+static void **caps_slot_find(cap_info_t *info, cap_handle_t handle)
+{
+	if ((CAP_HANDLE_RAW(handle) < CAPS_START) ||
+	    (CAP_HANDLE_RAW(handle) > CAPS_LAST))
+		return NULL;
+
+	uintptr_t raw = (uintptr_t) CAP_HANDLE_RAW(handle);
+	cap_node_t *node = rcu_access(info->table);
+	if ((!node) || (!caps_node_covers(node, raw)))
+		return NULL;
+
+	for (unsigned int h = node->height; h > 1; h--) {
+		node = rcu_access(node->slot[caps_slot_idx(raw, h)]);
+		if (!node)
+			return NULL;
+	}
+
+	return &node->slot[caps_slot_idx(raw, 1)];
+}
+
+/** Find or create the table slot of a capability
+ *
+ * New nodes are fully initialized before they become reachable so that
+ * concurrent lock-free readers never see a partially initialized node.
+ *
+ * @param info    Capability info structure of the task. Must be locked.
+ * @param handle  Capability handle.
+ * @param spare   Spare node to use for a missing table node.
+ *
+ * @return Address of the slot for the capability.
+ * @return NULL if another node is needed and there is no spare node left.
+ */
+static void **caps_slot_get(cap_info_t *info, cap_handle_t handle,
+    cap_node_t **spare)
+{
+	assert(mutex_locked(&info->lock));
+
+	uintptr_t raw = (uintptr_t) CAP_HANDLE_RAW(handle);
+	cap_node_t *node = info->table;
+
+	/* Grow the table at the root until it covers the handle. */
+	while ((!node) || (!caps_node_covers(node, raw))) {
+		cap_node_t *root = caps_node_take(spare,
+		    node ? node->height + 1 : 1);
+		if (!root)
+			return NULL;
+
+		root->slot[0] = node;
+		rcu_assign(info->table, root);
+		node = root;
+	}
+
+	for (unsigned int h = node->height; h > 1; h--) {
+		void **slot = &node->slot[caps_slot_idx(raw, h)];
+		if (!*slot) {
+			cap_node_t *child = caps_node_take(spare, h - 1);
+			if (!child)
+				return NULL;
+
+			rcu_assign(*slot, child);
+		}
+		node = (cap_node_t *) *slot;
+	}
+
+	return &node->slot[caps_slot_idx(raw, 1)];
+}
+
+static void cap_free_rcu(rcu_item_t *item)
+{
+	cap_t *cap = member_to_inst(item, cap_t, rcu);
+	slab_free(cap_cache, cap);
+}
+
+static void kobject_free_rcu(rcu_item_t *item)
+{
+	kobject_t *kobj = member_to_inst(item, kobject_t, rcu);
+	free(kobj);
 }
 
 /** Allocate the capability info structure
@@ -133,8 +277,7 @@ errno_t caps_task_alloc(task_t *task)
 		goto error_handles;
 	if (!ra_span_add(task->cap_info->handles, CAPS_START, CAPS_SIZE))
 		goto error_span;
-	if (!hash_table_create(&task->cap_info->caps, 0, 0, &caps_ops))
-		goto error_span;
+	task->cap_info->table = NULL;
 	return EOK;
 
 error_span:
@@ -162,7 +305,8 @@ void caps_task_init(task_t *task)
  */
 void caps_task_free(task_t *task)
 {
-	hash_table_destroy(&task->cap_info->caps);
+	if (task->cap_info->table)
+		caps_node_free(task->cap_info->table);
 	ra_arena_destroy(task->cap_info->handles);
 	free(task->cap_info);
 }
@@ -206,6 +350,7 @@ static void cap_initialize(cap_t *cap, task_t *task, cap_handle_t handle)
 	cap->state = CAP_STATE_FREE;
 	cap->task = task;
 	cap->handle = handle;
+	cap->kobject = NULL;
 	link_initialize(&cap->type_link);
 }
 
@@ -222,14 +367,11 @@ static cap_t *cap_get(task_t *task, cap_handle_t handle, cap_state_t state)
 {
 	assert(mutex_locked(&task->cap_info->lock));
 
-	if ((CAP_HANDLE_RAW(handle) < CAPS_START) ||
-	    (CAP_HANDLE_RAW(handle) > CAPS_LAST))
-		return NULL;
-	ht_link_t *link = hash_table_find(&task->cap_info->caps, &handle);
-	if (!link)
+	void **slot = caps_slot_find(task->cap_info, handle);
+	if (!slot)
 		return NULL;
-	cap_t *cap = hash_table_get_inst(link, cap_t, caps_link);
-	if (cap->state != state)
+	cap_t *cap = (cap_t *) *slot;
+	if ((!cap) || (cap->state != state))
 		return NULL;
 	return cap;
 }
@@ -244,25 +386,48 @@ static cap_t *cap_get(task_t *task, cap_handle_t handle, cap_state_t state)
  */
 errno_t cap_alloc(task_t *task, cap_handle_t *handle)
 {
-	mutex_lock(&task->cap_info->lock);
-	cap_t *cap = slab_alloc(cap_cache, FRAME_ATOMIC);
-	if (!cap) {
-		mutex_unlock(&task->cap_info->lock);
+	cap_node_t *spare = NULL;
+
+	/* Do not allocate memory while holding the lock. */
+	cap_t *cap = slab_alloc(cap_cache, 0);
+	if (!cap)
 		return ENOMEM;
-	}
+
+	mutex_lock(&task->cap_info->lock);
 	uintptr_t hbase;
 	if (!ra_alloc(task->cap_info->handles, 1, 1, &hbase)) {
-		slab_free(cap_cache, cap);
 		mutex_unlock(&task->cap_info->lock);
+		slab_free(cap_cache, cap);
 		return ENOMEM;
 	}
+
+	void **slot;
+	while (!(slot = caps_slot_get(task->cap_info, (cap_handle_t) hbase,
+	    &spare))) {
+		/*
+		 * The table needs another node. Allocate it without the lock
+		 * and retry, the table may have changed in the meantime.
+		 */
+		mutex_unlock(&task->cap_info->lock);
+		spare = slab_alloc(cap_node_cache, 0);
+		mutex_lock(&task->cap_info->lock);
+		if (!spare) {
+			ra_free(task->cap_info->handles, hbase, 1);
+			mutex_unlock(&task->cap_info->lock);
+			slab_free(cap_cache, cap);
+			return ENOMEM;
+		}
+	}
 	cap_initialize(cap, task, (cap_handle_t) hbase);
-	hash_table_insert(&task->cap_info->caps, &cap->caps_link);
+	rcu_assign(*slot, cap);
 
 	cap->state = CAP_STATE_ALLOCATED;
 	*handle = cap->handle;
 	mutex_unlock(&task->cap_info->lock);
 
+	if (spare)
+		slab_free(cap_node_cache, spare);
+
 	return EOK;
 }
 
@@ -284,7 +449,7 @@ cap_publish(task_t *task, cap_handle_t handle, kobject_t *kobj)
 	assert(cap);
 	cap->state = CAP_STATE_PUBLISHED;
 	/* Hand over kobj's reference to cap */
-	cap->kobject = kobj;
+	rcu_assign(cap->kobject, kobj);
 	list_append(&cap->type_link, &task->cap_info->type_list[kobj->type]);
 	mutex_unlock(&task->cap_info->lock);
 }
@@ -336,9 +501,10 @@ void cap_free(task_t *task, cap_handle_t handle)
 
 	assert(cap);
 
-	hash_table_remove_item(&task->cap_info->caps, &cap->caps_link);
+	*caps_slot_find(task->cap_info, handle) = NULL;
 	ra_free(task->cap_info->handles, CAP_HANDLE_RAW(handle), 1);
-	slab_free(cap_cache, cap);
+	/* Lock-free readers may still be looking at the capability. */
+	rcu_call(&cap->rcu, cap_free_rcu);
 	mutex_unlock(&task->cap_info->lock);
 }
 
@@ -358,7 +524,31 @@ void kobject_initialize(kobject_t *kobj, kobject_type_t type, void *raw,
 	kobj->ops = ops;
 }
 
+/** Add reference to kernel object unless it is already being destroyed
+ *
+ * @param kobj  Kernel object whose reference count to increment.
+ *
+ * @return True if the reference was added.
+ * @return False if the last reference to the object was already dropped.
+ */
+static bool kobject_try_add_ref(kobject_t *kobj)
+{
+	atomic_count_t cnt = atomic_get(&kobj->refcnt);
+
+	while (cnt != 0) {
+		if (__atomic_compare_exchange_n(&kobj->refcnt.count, &cnt,
+		    cnt + 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+			return true;
+	}
+
+	return false;
+}
+
 /** Get new reference to kernel object from capability
+ *
+ * The lookup does not take the cap_info_t lock. A capability concurrently
+ * unpublished by another thread either yields its former kernel object, if
+ * the object is still alive, or NULL.
  *
  * @param task    Task from which to get the reference.
  * @param handle  Capability handle.
@@ -373,15 +563,15 @@ kobject_get(struct task *task, cap_handle_t handle, kobject_type_t type)
 {
 	kobject_t *kobj = NULL;
 
-	mutex_lock(&task->cap_info->lock);
-	cap_t *cap = cap_get(task, handle, CAP_STATE_PUBLISHED);
-	if (cap) {
-		if (cap->kobject->type == type) {
-			kobj = cap->kobject;
-			atomic_inc(&kobj->refcnt);
-		}
+	rcu_read_lock();
+	void **slot = caps_slot_find(task->cap_info, handle);
+	if (slot) {
+		cap_t *cap = (cap_t *) rcu_access(*slot);
+		kobject_t *cur = cap ? rcu_access(cap->kobject) : NULL;
+		if ((cur) && (cur->type == type) && kobject_try_add_ref(cur))
+			kobj = cur;
 	}
-	mutex_unlock(&task->cap_info->lock);
+	rcu_read_unlock();
 
 	return kobj;
 }
@@ -406,7 +596,8 @@ void kobject_put(kobject_t *kobj)
 {
 	if (atomic_postdec(&kobj->refcnt) == 1) {
 		kobj->ops->destroy(kobj->raw);
-		free(kobj);
+		/* The wrapper may still be looked at by kobject_get(). */
+		rcu_call(&kobj->rcu, kobject_free_rcu);
 	}
 }
 
@@ -223,7 +223,8 @@ static cmd_arg_t bench_argv[] = {
 };
 static cmd_info_t bench_info = {
 	.name = "bench",
-	.description = "<test> <count> Run kernel test as benchmark.",
+	.description = "<test> <count> Run kernel test as benchmark "
+	    "or scaling benchmark with <count> iterations per thread.",
 	.func = cmd_bench,
 	.argc = 2,
 	.argv = bench_argv
@@ -535,6 +536,20 @@ static cmd_info_t zone_info = {
 	.argv = &zone_argv
 };
 
+/* Data and methods for 'framebatch' command */
+static int cmd_framebatch(cmd_arg_t *argv);
+static cmd_arg_t framebatch_argv = {
+	.type = ARG_TYPE_INT,
+};
+
+static cmd_info_t framebatch_info = {
+	.name = "framebatch",
+	.description = "<frames> Set batch size of per-CPU free frame caches.",
+	.func = cmd_framebatch,
+	.argc = 1,
+	.argv = &framebatch_argv
+};
+
 /* Data and methods for the 'workq' command */
 static int cmd_workq(cmd_arg_t *argv);
 static cmd_info_t workq_info = {
@@ -630,6 +645,7 @@ static cmd_info_t *basic_commands[] = {
 	&workq_info,
 	&zones_info,
 	&zone_info,
+	&framebatch_info,
 #ifdef CONFIG_TEST
 	&test_info,
 	&bench_info,
@@ -1350,6 +1366,21 @@ int cmd_zone(cmd_arg_t *argv)
 	return 1;
 }
 
+/** Command for setting the batch size of per-CPU free frame caches
+ *
+ * @param argv Integer argument from cmdline expected
+ *
+ * return Always 1
+ */
+int cmd_framebatch(cmd_arg_t *argv)
+{
+	if (frame_pcp_set_batch(argv[0].intval) != EOK)
+		printf("Batch size must be at most %d frames.\n",
+		    FRAME_PCP_MAX / 2);
+
+	return 1;
+}
+
 /** Command for printing task IPC details
  *
  * @param argv Integer argument from cmdline expected
@@ -1529,12 +1560,18 @@ static void list_tests(void)
 {
 	size_t len = 0;
 	test_t *test;
+	bench_t *bench;
 
 	for (test = tests; test->name != NULL; test++) {
 		if (str_length(test->name) > len)
 			len = str_length(test->name);
 	}
 
+	for (bench = benches; bench->name != NULL; bench++) {
+		if (str_length(bench->name) > len)
+			len = str_length(bench->name);
+	}
+
 	unsigned int _len = (unsigned int) len;
 	if ((_len != len) || (((int) _len) < 0)) {
 		printf("Command length overflow\n");
@@ -1546,6 +1583,11 @@ static void list_tests(void)
 		    (test->safe ? "" : " (unsafe)"));
 
 	printf("%-*s Run all safe tests\n", _len, "*");
+
+	printf("\nScaling benchmarks (bench <name> <iterations>):\n");
+
+	for (bench = benches; bench->name != NULL; bench++)
+		printf("%-*s %s\n", _len, bench->name, bench->desc);
 }
 
 /** Command for listing and running kernel tests
@@ -1587,6 +1629,9 @@ int cmd_test(cmd_arg_t *argv)
 }
 
 /** Command for returning kernel tests as benchmarks
+ *
+ * Scaling benchmarks are run on 1 to N CPUs with the count
+ * being the number of iterations performed by each thread.
  *
  * @param argv Argument vector.
  *
@@ -1597,6 +1642,13 @@ int cmd_bench(cmd_arg_t *argv)
 	test_t *test;
 	uint32_t cnt = argv[1].intval;
 
+	for (bench_t *bench = benches; bench->name != NULL; bench++) {
+		if (str_cmp(bench->name, (char *) argv->buffer) == 0) {
+			bench_run(bench, cnt);
+			return 1;
+		}
+	}
+
 	if (str_cmp((char *) argv->buffer, "*") == 0) {
 		for (test = tests; test->name != NULL; test++) {
 			if (test->safe) {
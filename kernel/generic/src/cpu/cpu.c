@@ -38,6 +38,7 @@
 #include <cpu.h>
 #include <arch.h>
 #include <arch/cpu.h>
+#include <ddi/irq.h>
 #include <mm/slab.h>
 #include <mm/page.h>
 #include <mm/frame.h>
@@ -72,6 +73,18 @@ void cpu_init(void)
 		memsetb(cpus, sizeof(cpu_t) * config.cpu_count, 0);
 
 		size_t i;
+		for (i = 0; i < config.cpu_count; i++) {
+			frame_pcp_initialize(&cpus[i].frame_pcp);
+			reserve_pcp_initialize(&cpus[i].reserve_pcp);
+
+			/* Not fatal, the statistics are just not collected. */
+			cpus[i].irq_counts = (uint64_t *)
+			    malloc(sizeof(uint64_t) * (last_inr + 1));
+			if (cpus[i].irq_counts)
+				memsetb(cpus[i].irq_counts,
+				    sizeof(uint64_t) * (last_inr + 1), 0);
+		}
+
 		for (i = 0; i < config.cpu_count; i++) {
 			uintptr_t stack_phys = frame_alloc(STACK_FRAMES,
 			    FRAME_LOWMEM | FRAME_ATOMIC, STACK_SIZE - 1);
@@ -85,6 +98,7 @@ void cpu_init(void)
 
 			for (unsigned int j = 0; j < RQ_COUNT; j++) {
 				irq_spinlock_initialize(&cpus[i].rq[j].lock, "cpus[].rq[].lock");
+				irq_spinlock_set_kind(&cpus[i].rq[j].lock, SPINLOCK_TICKET);
 				list_initialize(&cpus[i].rq[j].rq);
 			}
 		}
@@ -102,6 +116,8 @@ void cpu_init(void)
 	CPU->last_cycle = get_cycle();
 	CPU->idle_cycles = 0;
 	CPU->busy_cycles = 0;
+	CPU->steal_attempts = 0;
+	CPU->steal_successes = 0;
 
 	cpu_identify();
 	cpu_arch_init();
@@ -38,6 +38,9 @@
 #include <cpu/cpu_mask.h>
 #include <cpu.h>
 #include <config.h>
+#include <errno.h>
+#include <mem.h>
+#include <syscall/copy.h>
 
 static const size_t word_size = sizeof(unsigned int);
 static const size_t word_bit_cnt = 8 * sizeof(unsigned int);
@@ -136,5 +139,44 @@ bool cpu_mask_is_none(cpu_mask_t *cpus)
 	return true;
 }
 
+/** Copies the contents of one mask to another. */
+void cpu_mask_copy(cpu_mask_t *dst, cpu_mask_t *src)
+{
+	memcpy(dst, src, cpu_mask_size());
+}
+
+/** Initializes the mask from a CPU set in user space.
+ *
+ * CPUs which are not active are ignored.
+ *
+ * @param mask        Mask to initialize.
+ * @param uspace_set  CPU set in user space.
+ *
+ * @return EOK on success, EINVAL if the CPU set contains no active CPU
+ *         or an error code returned by copy_from_uspace().
+ */
+errno_t cpu_mask_from_uspace(cpu_mask_t *mask, const cpuset_t *uspace_set)
+{
+	cpuset_t set;
+	errno_t rc = copy_from_uspace(&set, uspace_set, sizeof(set));
+	if (rc != EOK)
+		return rc;
+
+	cpu_mask_none(mask);
+
+	for (unsigned int cpu_id = 0;
+	    (cpu_id < config.cpu_count) && (cpu_id < CPUSET_MAX_CPUS);
+	    ++cpu_id) {
+		if ((set.mask[cpu_id / 32] & (UINT32_C(1) << (cpu_id % 32))) &&
+		    (cpus[cpu_id].active))
+			cpu_mask_set(mask, cpu_id);
+	}
+
+	if (cpu_mask_is_none(mask))
+		return EINVAL;
+
+	return EOK;
+}
+
 /** @}
  */
\ No newline at end of file
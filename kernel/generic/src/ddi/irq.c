@@ -48,6 +48,10 @@
 #include <interrupt.h>
 #include <mem.h>
 #include <arch.h>
+#include <atomic.h>
+#include <config.h>
+#include <cpu.h>
+#include <errno.h>
 
 slab_cache_t *irq_cache = NULL;
 
@@ -86,6 +90,12 @@ static hash_table_ops_t irq_ht_ops = {
 /** Last valid INR */
 inr_t last_inr = 0;
 
+/** Route an INR to a single CPU, NULL if the routing cannot be changed */
+errno_t (*irq_affinity_function)(inr_t, unsigned int) = NULL;
+
+/** Next CPU to receive a newly subscribed interrupt */
+static atomic_t irq_balance_next = { 0 };
+
 /** Initialize IRQ subsystem
  *
  * @param inrs    Numbers of unique IRQ numbers or INRs.
@@ -148,6 +158,12 @@ irq_dispatch_and_lock_table(hash_table_t *h, irq_spinlock_t *l, inr_t inr)
 		if (irq->claim(irq) == IRQ_ACCEPT) {
 			/* leave irq locked */
 			irq_spinlock_unlock(l, false);
+
+			/* The counters are CPU-local, interrupts are disabled */
+			if ((CPU) && (CPU->irq_counts) && (inr >= 0) &&
+			    (inr <= last_inr))
+				CPU->irq_counts[inr]++;
+
 			return irq;
 		}
 		irq_spinlock_unlock(&irq->lock, false);
@@ -229,5 +245,54 @@ bool irq_ht_key_equal(void *key, const ht_link_t *item)
 	return irq->inr == *inr;
 }
 
+/** Deliver an interrupt to a single CPU
+ *
+ * @param inr  Interrupt number.
+ * @param cpu  ID of an active CPU.
+ *
+ * @return EOK on success, EINVAL if the CPU is not active, ENOTSUP
+ *         if the platform cannot route the interrupt.
+ *
+ */
+errno_t irq_set_affinity(inr_t inr, unsigned int cpu)
+{
+	if ((inr < 0) || (inr > last_inr))
+		return EINVAL;
+
+	if ((cpu >= config.cpu_count) || (!cpus[cpu].active))
+		return EINVAL;
+
+	if (!irq_affinity_function)
+		return ENOTSUP;
+
+	return irq_affinity_function(inr, cpu);
+}
+
+/** Spread interrupts across CPUs
+ *
+ * Route a newly subscribed interrupt to the next active CPU in round-robin
+ * order, so that interrupts of different devices do not all land on the
+ * bootstrap processor. Failures are ignored, the interrupt then keeps its
+ * current routing.
+ *
+ * @param inr  Interrupt number.
+ *
+ */
+void irq_balance(inr_t inr)
+{
+	if (!irq_affinity_function)
+		return;
+
+	for (size_t i = 0; i < config.cpu_count; i++) {
+		unsigned int cpu =
+		    atomic_postinc(&irq_balance_next) % config.cpu_count;
+
+		if (cpus[cpu].active) {
+			(void) irq_affinity_function(inr, cpu);
+			return;
+		}
+	}
+}
+
 /** @}
  */
@@ -56,6 +56,7 @@
 #include <arch/stack.h>
 #include <str.h>
 #include <trace.h>
+#include <ktrace.h>
 
 exc_table_t exc_table[IVT_ITEMS];
 IRQ_SPINLOCK_INITIALIZE(exctbl_lock);
@@ -128,6 +129,8 @@ NO_TRACE void exc_dispatch(unsigned int n, istate_t *istate)
 		THREAD->udebug.uspace_state = istate;
 #endif
 
+	KTRACE(KTRACE_IRQ_ENTRY, n + IVT_FIRST, istate_from_uspace(istate));
+
 	exc_table[n].handler(n + IVT_FIRST, istate);
 
 #ifdef CONFIG_UDEBUG
@@ -142,6 +145,8 @@ NO_TRACE void exc_dispatch(unsigned int n, istate_t *istate)
 	/* Account exception handling */
 	uint64_t end_cycle = get_cycle();
 
+	KTRACE(KTRACE_IRQ_EXIT, n + IVT_FIRST, end_cycle - begin_cycle);
+
 	irq_spinlock_lock(&exctbl_lock, false);
 	exc_table[n].cycles += end_cycle - begin_cycle;
 	exc_table[n].count++;
@@ -51,6 +51,11 @@
 #include <ipc/sysipc_priv.h>
 #include <errno.h>
 #include <mm/slab.h>
+#include <mm/as.h>
+#include <mm/frame.h>
+#include <syscall/copy.h>
+#include <align.h>
+#include <macros.h>
 #include <arch.h>
 #include <proc/task.h>
 #include <mem.h>
@@ -60,6 +65,9 @@
 #include <arch/interrupt.h>
 #include <ipc/irq.h>
 #include <cap/cap.h>
+#include <ktrace.h>
+#include <bitops.h>
+#include <arch/cycle.h>
 
 static void ipc_forget_call(call_t *);
 
@@ -67,10 +75,27 @@ static void ipc_forget_call(call_t *);
 answerbox_t *ipc_box_0 = NULL;
 
 static slab_cache_t *call_cache;
+static slab_cache_t *payload_cache;
 static slab_cache_t *answerbox_cache;
 
 slab_cache_t *phone_cache = NULL;
 
+/** Find the latency histogram bucket of a call.
+ *
+ * @param cycles Cycles elapsed between the request and the answer.
+ *
+ * @return Index into the latency histogram.
+ *
+ */
+static unsigned int ipc_latency_bucket(uint64_t cycles)
+{
+	uint64_t scaled = cycles >> STATS_IPC_LATENCY_SHIFT;
+	if (scaled == 0)
+		return 0;
+
+	return min(fnzb64(scaled) + 1, STATS_IPC_LATENCY_BUCKETS - 1);
+}
+
 /** Initialize a call structure.
  *
  * @param call Call structure to be initialized.
@@ -85,6 +110,9 @@ static void _ipc_call_init(call_t *call)
 	call->sender = NULL;
 	call->callerbox = NULL;
 	call->buffer = NULL;
+	call->payload = NULL;
+	call->frames = NULL;
+	call->frame_count = 0;
 }
 
 static void call_destroy(void *arg)
@@ -93,6 +121,12 @@ static void call_destroy(void *arg)
 
 	if (call->buffer)
 		free(call->buffer);
+	if (call->payload)
+		slab_free(payload_cache, call->payload);
+	if (call->frames) {
+		as_unpin_frames(call->frames, call->frame_count);
+		free(call->frames);
+	}
 	if (call->caller_phone)
 		kobject_put(call->caller_phone->kobject);
 	slab_free(call_cache, call);
@@ -137,6 +171,123 @@ call_t *ipc_call_alloc(unsigned int flags)
 	return call;
 }
 
+/** Pin the source of a data transfer for direct copying.
+ *
+ * Try to pin the frames backing the source buffer of an IPC_M_DATA_WRITE
+ * or IPC_M_DATA_READ transfer in the current address space, so that the
+ * data can later be copied directly to the destination without an
+ * intermediate kernel buffer. The frames are released in ipc_call_free()
+ * at the latest.
+ *
+ * @param call Call carrying the transfer.
+ * @param src  Source address in the current address space.
+ * @param size Size of the transfer.
+ *
+ * @return True if the frames were pinned, false if the transfer is too
+ *         small, not page-aligned or its source cannot be pinned and the
+ *         caller must fall back to call->buffer.
+ *
+ */
+bool ipc_call_pin_data(call_t *call, uintptr_t src, size_t size)
+{
+	assert(!call->buffer);
+	assert(!call->frames);
+
+	if ((size < DATA_XFER_PIN_THRESHOLD) || !IS_ALIGNED(src, PAGE_SIZE))
+		return false;
+
+	size_t count = SIZE2FRAMES(size);
+	uintptr_t *frames = malloc(count * sizeof(uintptr_t));
+	if (!frames)
+		return false;
+
+	if (as_pin_frames(AS, src, count, frames) != EOK) {
+		free(frames);
+		return false;
+	}
+
+	call->frames = frames;
+	call->frame_count = count;
+	return true;
+}
+
+/** Attach an inline payload to a request.
+ *
+ * The payload is copied from the current address space into a buffer from
+ * a dedicated slab cache and travels with the call, so that the callee can
+ * get it without another IPC round trip.
+ *
+ * @param call Request to attach the payload to.
+ * @param src  Source address in the current address space.
+ * @param size Size of the payload, at most IPC_PAYLOAD_MAX.
+ *
+ * @return EOK on success, EINVAL if the payload is too large or an error
+ *         code from copy_from_uspace().
+ *
+ */
+errno_t ipc_call_set_payload(call_t *call, uintptr_t src, size_t size)
+{
+	if (size > IPC_PAYLOAD_MAX)
+		return EINVAL;
+
+	uint8_t *payload = slab_alloc(payload_cache, 0);
+	errno_t rc = copy_from_uspace(payload, (void *) src, size);
+	if (rc != EOK) {
+		slab_free(payload_cache, payload);
+		return rc;
+	}
+
+	call->payload = payload;
+	call->data.payload_size = size;
+	return EOK;
+}
+
+/** Copy data of a transfer to the current address space.
+ *
+ * @param call Call carrying the data either in pinned frames or in
+ *             call->buffer.
+ * @param dst  Destination address in the current address space.
+ * @param size Number of bytes to copy.
+ *
+ * @return EOK on success or an error code from copy_to_uspace().
+ *
+ */
+errno_t ipc_call_copy_data(call_t *call, uintptr_t dst, size_t size)
+{
+	size_t total = size;
+
+	if (!call->frames) {
+		errno_t rc = copy_to_uspace((void *) dst, call->buffer, size);
+		if (rc != EOK)
+			return rc;
+	} else {
+		assert(size <= FRAMES2SIZE(call->frame_count));
+
+		for (size_t i = 0; size > 0; i++) {
+			size_t chunk = min(size, PAGE_SIZE);
+			errno_t rc = copy_to_uspace((void *) dst,
+			    (void *) PA2KA(call->frames[i]), chunk);
+			if (rc != EOK)
+				return rc;
+
+			dst += chunk;
+			size -= chunk;
+		}
+	}
+
+	/* Count copied bytes */
+	irq_spinlock_lock(&TASK->lock, true);
+	TASK->ipc_info.bytes_copied += total;
+	irq_spinlock_unlock(&TASK->lock, true);
+
+	if (call->caller_phone) {
+		__atomic_fetch_add(&call->caller_phone->ipc_info.bytes_copied,
+		    total, __ATOMIC_RELAXED);
+	}
+
+	return EOK;
+}
+
 /** Initialize an answerbox structure.
  *
  * @param box  Answerbox structure to be initialized.
@@ -205,6 +356,7 @@ void ipc_phone_init(phone_t *phone, task_t *caller)
 	phone->state = IPC_PHONE_FREE;
 	atomic_set(&phone->active_calls, 0);
 	phone->kobject = NULL;
+	memsetb(&phone->ipc_info, sizeof(phone->ipc_info), 0);
 }
 
 /** Helper function to facilitate synchronous calls.
@@ -284,11 +436,31 @@ errno_t ipc_call_sync(phone_t *phone, call_t *request)
  */
 void _ipc_answer_free_call(call_t *call, bool selflocked)
 {
+	KTRACE(KTRACE_IPC_ANSWER, (uintptr_t) call, IPC_GET_RETVAL(call->data));
+
 	/* Count sent answer */
 	irq_spinlock_lock(&TASK->lock, true);
 	TASK->ipc_info.answer_sent++;
 	irq_spinlock_unlock(&TASK->lock, true);
 
+	unsigned int bucket = STATS_IPC_LATENCY_BUCKETS;
+	if (call->sent_cycles != 0)
+		bucket = ipc_latency_bucket(get_cycle() - call->sent_cycles);
+
+	if (call->caller_phone) {
+		phone_t *phone = call->caller_phone;
+
+		__atomic_fetch_add(&phone->ipc_info.answer_received, 1,
+		    __ATOMIC_RELAXED);
+		if (bucket < STATS_IPC_LATENCY_BUCKETS) {
+			__atomic_fetch_add(&phone->ipc_info.latency[bucket], 1,
+			    __ATOMIC_RELAXED);
+		}
+	}
+
+	/* The inline payload belongs to the request only. */
+	call->data.payload_size = 0;
+
 	spinlock_lock(&call->forget_lock);
 	if (call->forget) {
 		/* This is a forgotten call and call->sender is not valid. */
@@ -296,6 +468,15 @@ void _ipc_answer_free_call(call_t *call, bool selflocked)
 		kobject_put(call->kobject);
 		return;
 	} else {
+		/*
+		 * The sender's latencies are counted without its lock,
+		 * which must not be taken under the forget lock.
+		 */
+		if (bucket < STATS_IPC_LATENCY_BUCKETS) {
+			__atomic_fetch_add(&call->sender->ipc_info.latency[bucket],
+			    1, __ATOMIC_RELAXED);
+		}
+
 		/*
 		 * If the call is still active, i.e. it was answered
 		 * in a non-standard way, remove the call from the
@@ -325,7 +506,8 @@ void _ipc_answer_free_call(call_t *call, bool selflocked)
 	if (do_lock)
 		irq_spinlock_unlock(&callerbox->lock, true);
 
-	waitq_wakeup(&callerbox->wq, WAKEUP_FIRST);
+	/* The answering thread is likely to wait for the next call */
+	waitq_wakeup(&callerbox->wq, WAKEUP_HANDOFF);
 }
 
 /** Answer a message which is in a callee queue.
@@ -403,19 +585,33 @@ static void _ipc_call(phone_t *phone, answerbox_t *box, call_t *call,
 {
 	task_t *caller = phone->caller;
 
+	KTRACE(KTRACE_IPC_CALL, (uintptr_t) call, IPC_GET_IMETHOD(call->data));
+
 	/* Count sent ipc call */
 	irq_spinlock_lock(&caller->lock, true);
 	caller->ipc_info.call_sent++;
 	irq_spinlock_unlock(&caller->lock, true);
 
-	if (!(call->flags & IPC_CALL_FORWARDED))
+	__atomic_fetch_add(&phone->ipc_info.call_sent, 1, __ATOMIC_RELAXED);
+
+	if (!(call->flags & IPC_CALL_FORWARDED)) {
+		call->sent_cycles = get_cycle();
 		_ipc_call_actions_internal(phone, call, preforget);
+	}
 
 	irq_spinlock_lock(&box->lock, true);
 	list_append(&call->ab_link, &box->calls);
 	irq_spinlock_unlock(&box->lock, true);
 
-	waitq_wakeup(&box->wq, WAKEUP_FIRST);
+	/*
+	 * The calling thread is likely to wait for the answer. The CPU
+	 * is actually handed off only if it does so in ipc_wait_for_call()
+	 * before running anything else. A forwarding thread goes on.
+	 */
+	if (call->flags & IPC_CALL_FORWARDED)
+		waitq_wakeup(&box->wq, WAKEUP_FIRST);
+	else
+		waitq_wakeup(&box->wq, WAKEUP_HANDOFF);
 }
 
 /** Send an asynchronous request using a phone to an answerbox.
@@ -510,7 +706,12 @@ errno_t ipc_phone_hangup(phone_t *phone)
 errno_t ipc_forward(call_t *call, phone_t *newphone, answerbox_t *oldbox,
     unsigned int mode)
 {
+	KTRACE(KTRACE_IPC_FORWARD, (uintptr_t) call,
+	    IPC_GET_IMETHOD(call->data));
+
 	/* Count forwarded calls */
+	__atomic_fetch_add(&newphone->ipc_info.forwarded, 1, __ATOMIC_RELAXED);
+
 	irq_spinlock_lock(&TASK->lock, true);
 	TASK->ipc_info.forwarded++;
 	irq_spinlock_pass(&TASK->lock, &oldbox->lock);
@@ -549,7 +750,10 @@ call_t *ipc_wait_for_call(answerbox_t *box, uint32_t usec, unsigned int flags)
 	uint64_t call_cnt = 0;
 	errno_t rc;
 
+	/* Let a thread we have just woken up have our CPU while we wait */
+	THREAD->ipc_wait = true;
 	rc = waitq_sleep_timeout(&box->wq, usec, flags, NULL);
+	THREAD->ipc_wait = false;
 	if (rc != EOK)
 		return NULL;
 
@@ -564,6 +768,12 @@ call_t *ipc_wait_for_call(answerbox_t *box, uint32_t usec, unsigned int flags)
 		    call_t, ab_link);
 		list_remove(&request->ab_link);
 
+		/* No further interrupts can be coalesced into the request */
+		if (request->notif_slot) {
+			*request->notif_slot = NULL;
+			request->notif_slot = NULL;
+		}
+
 		irq_spinlock_unlock(&box->irq_lock, false);
 	} else if (!list_empty(&box->answers)) {
 		/* Count received answer */
@@ -874,6 +1084,8 @@ void ipc_init(void)
 {
 	call_cache = slab_cache_create("call_t", sizeof(call_t), 0, NULL,
 	    NULL, 0);
+	payload_cache = slab_cache_create("ipc_payload", IPC_PAYLOAD_MAX, 0,
+	    NULL, NULL, 0);
 	phone_cache = slab_cache_create("phone_t", sizeof(phone_t), 0, NULL,
 	    NULL, 0);
 	answerbox_cache = slab_cache_create("answerbox_t", sizeof(answerbox_t),
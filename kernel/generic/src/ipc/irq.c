@@ -289,15 +289,55 @@ static void irq_hash_out(irq_t *irq)
 		irq->notif_cfg.hashed_in = false;
 	}
 
+	/* The queued notification must not refer to the IRQ any longer. */
+	answerbox_t *box = irq->notif_cfg.answerbox;
+	irq_spinlock_lock(&box->irq_lock, false);
+	if (irq->notif_cfg.pending) {
+		irq->notif_cfg.pending->notif_slot = NULL;
+		irq->notif_cfg.pending = NULL;
+	}
+	irq_spinlock_unlock(&box->irq_lock, false);
+
 	irq_spinlock_unlock(&irq->lock, false);
 	irq_spinlock_unlock(&irq_uspace_hash_table_lock, true);
 }
 
+/** Wait until the holdoff timeout of an unhashed IRQ is gone.
+ *
+ * The timeout handler does not re-register itself once the IRQ has been
+ * removed from the hash table, but it may still be running on another CPU.
+ *
+ * @param irq IRQ structure.
+ *
+ */
+static void irq_holdoff_cancel(irq_t *irq)
+{
+	while (true) {
+		irq_spinlock_lock(&irq->lock, true);
+		if (!irq->notif_cfg.holdoff_active) {
+			irq_spinlock_unlock(&irq->lock, true);
+			return;
+		}
+
+		if (timeout_unregister(&irq->notif_cfg.holdoff_timeout)) {
+			irq->notif_cfg.holdoff_active = false;
+			irq_spinlock_unlock(&irq->lock, true);
+			return;
+		}
+
+		irq_spinlock_unlock(&irq->lock, true);
+	}
+}
+
 static void irq_destroy(void *arg)
 {
 	irq_t *irq = (irq_t *) arg;
 
 	irq_hash_out(irq);
+	irq_holdoff_cancel(irq);
+
+	if (irq->notif_cfg.deferred)
+		kobject_put(irq->notif_cfg.deferred->kobject);
 
 	/* Free up the IRQ code and associated structures. */
 	code_free(irq->notif_cfg.code);
@@ -370,6 +410,12 @@ errno_t ipc_irq_subscribe(answerbox_t *box, inr_t inr, sysarg_t imethod,
 	irq->notif_cfg.imethod = imethod;
 	irq->notif_cfg.code = code;
 	irq->notif_cfg.counter = 0;
+	irq->notif_cfg.coalesce = false;
+	irq->notif_cfg.holdoff = 0;
+	irq->notif_cfg.holdoff_active = false;
+	timeout_initialize(&irq->notif_cfg.holdoff_timeout);
+	irq->notif_cfg.deferred = NULL;
+	irq->notif_cfg.pending = NULL;
 
 	/*
 	 * Insert the IRQ structure into the uspace IRQ hash table.
@@ -386,6 +432,8 @@ errno_t ipc_irq_subscribe(answerbox_t *box, inr_t inr, sysarg_t imethod,
 	kobject_initialize(kobject, KOBJECT_TYPE_IRQ, irq, &irq_kobject_ops);
 	cap_publish(TASK, handle, kobject);
 
+	irq_balance(inr);
+
 	return EOK;
 }
 
@@ -413,6 +461,79 @@ errno_t ipc_irq_unsubscribe(answerbox_t *box, cap_irq_handle_t handle)
 	return EOK;
 }
 
+/** Configure coalescing of IRQ notifications.
+ *
+ * When coalescing is enabled, an interrupt which arrives while the previous
+ * notification is still waiting in the answerbox does not produce a new
+ * notification. Instead, the queued notification is updated with the latest
+ * payload arguments and the number of interrupts it stands for is increased.
+ *
+ * A non-zero holdoff additionally caps the notification rate. Interrupts
+ * arriving within the holdoff period after a notification was sent are
+ * merged into a single notification sent when the period ends.
+ *
+ * @param box     Answerbox associated with the notification.
+ * @param handle  IRQ capability handle.
+ * @param holdoff Minimum interval between two notifications in
+ *                microseconds, 0 for no rate cap.
+ *
+ * @return EOK on success or an error code.
+ *
+ */
+errno_t ipc_irq_coalesce(answerbox_t *box, cap_irq_handle_t handle,
+    sysarg_t holdoff)
+{
+	if (holdoff > IRQ_MAX_HOLDOFF)
+		return EINVAL;
+
+	kobject_t *kobj = kobject_get(TASK, handle, KOBJECT_TYPE_IRQ);
+	if (!kobj)
+		return ENOENT;
+
+	irq_t *irq = kobj->irq;
+	assert(irq->notif_cfg.answerbox == box);
+
+	irq_spinlock_lock(&irq->lock, true);
+	irq->notif_cfg.coalesce = true;
+	irq->notif_cfg.holdoff = (uint32_t) holdoff;
+	irq_spinlock_unlock(&irq->lock, true);
+
+	kobject_put(kobj);
+
+	return EOK;
+}
+
+/** Deliver the interrupt of an IRQ capability to a single CPU.
+ *
+ * The routing applies to the interrupt source, so it is shared by all
+ * subscribers of the same INR.
+ *
+ * @param box     Answerbox associated with the notification.
+ * @param handle  IRQ capability handle.
+ * @param cpu     ID of the target CPU.
+ *
+ * @return EOK on success or an error code.
+ *
+ */
+errno_t ipc_irq_set_affinity(answerbox_t *box, cap_irq_handle_t handle,
+    sysarg_t cpu)
+{
+	kobject_t *kobj = kobject_get(TASK, handle, KOBJECT_TYPE_IRQ);
+	if (!kobj)
+		return ENOENT;
+
+	irq_t *irq = kobj->irq;
+	assert(irq->notif_cfg.answerbox == box);
+
+	errno_t rc = EINVAL;
+	if (cpu <= UINT_MAX)
+		rc = irq_set_affinity(irq->inr, (unsigned int) cpu);
+
+	kobject_put(kobj);
+
+	return rc;
+}
+
 /** Add a call to the proper answerbox queue.
  *
  * Assume irq->lock is locked and interrupts disabled.
@@ -425,11 +546,140 @@ static void send_call(irq_t *irq, call_t *call)
 {
 	irq_spinlock_lock(&irq->notif_cfg.answerbox->irq_lock, false);
 	list_append(&call->ab_link, &irq->notif_cfg.answerbox->irq_notifs);
+	if (irq->notif_cfg.coalesce) {
+		irq->notif_cfg.pending = call;
+		call->notif_slot = &irq->notif_cfg.pending;
+	}
 	irq_spinlock_unlock(&irq->notif_cfg.answerbox->irq_lock, false);
 
 	waitq_wakeup(&irq->notif_cfg.answerbox->wq, WAKEUP_FIRST);
 }
 
+/** Store the latest interrupt into a notification call.
+ *
+ * @param irq  IRQ structure.
+ * @param call IRQ notification call.
+ * @param a1   Driver-specific payload argument.
+ * @param a2   Driver-specific payload argument.
+ * @param a3   Driver-specific payload argument.
+ * @param a4   Driver-specific payload argument.
+ * @param a5   Driver-specific payload argument.
+ *
+ */
+static void notif_update(irq_t *irq, call_t *call, sysarg_t a1, sysarg_t a2,
+    sysarg_t a3, sysarg_t a4, sysarg_t a5)
+{
+	/* Put a counter to the message */
+	call->priv = irq->notif_cfg.counter;
+	/* Count the interrupts the notification stands for */
+	call->data.task_id++;
+
+	IPC_SET_IMETHOD(call->data, irq->notif_cfg.imethod);
+	IPC_SET_ARG1(call->data, a1);
+	IPC_SET_ARG2(call->data, a2);
+	IPC_SET_ARG3(call->data, a3);
+	IPC_SET_ARG4(call->data, a4);
+	IPC_SET_ARG5(call->data, a5);
+}
+
+/** Allocate a new notification call.
+ *
+ * @return Notification call or NULL if out of memory.
+ *
+ */
+static call_t *notif_alloc(void)
+{
+	call_t *call = ipc_call_alloc(FRAME_ATOMIC);
+	if (!call)
+		return NULL;
+
+	call->flags |= IPC_CALL_NOTIF;
+	return call;
+}
+
+/** End of the holdoff period of an IRQ.
+ *
+ * Send the notification held back during the period, if any, and start
+ * a new period after it.
+ *
+ * @param arg IRQ structure.
+ *
+ */
+static void irq_holdoff_expired(void *arg)
+{
+	irq_t *irq = (irq_t *) arg;
+
+	irq_spinlock_lock(&irq->lock, true);
+
+	call_t *call = irq->notif_cfg.deferred;
+	if ((call) && (irq->notif_cfg.hashed_in)) {
+		irq->notif_cfg.deferred = NULL;
+		send_call(irq, call);
+		timeout_register(&irq->notif_cfg.holdoff_timeout,
+		    irq->notif_cfg.holdoff, irq_holdoff_expired, irq);
+	} else
+		irq->notif_cfg.holdoff_active = false;
+
+	irq_spinlock_unlock(&irq->lock, true);
+}
+
+/** Notify the answerbox about an interrupt.
+ *
+ * Assume irq->lock is locked and interrupts disabled.
+ *
+ * @param irq IRQ structure.
+ * @param a1  Driver-specific payload argument.
+ * @param a2  Driver-specific payload argument.
+ * @param a3  Driver-specific payload argument.
+ * @param a4  Driver-specific payload argument.
+ * @param a5  Driver-specific payload argument.
+ *
+ */
+static void notify(irq_t *irq, sysarg_t a1, sysarg_t a2, sysarg_t a3,
+    sysarg_t a4, sysarg_t a5)
+{
+	answerbox_t *box = irq->notif_cfg.answerbox;
+
+	irq->notif_cfg.counter++;
+
+	if (irq->notif_cfg.coalesce) {
+		irq_spinlock_lock(&box->irq_lock, false);
+
+		call_t *call = irq->notif_cfg.pending;
+		if (call)
+			notif_update(irq, call, a1, a2, a3, a4, a5);
+
+		irq_spinlock_unlock(&box->irq_lock, false);
+
+		if (call)
+			return;
+	}
+
+	if (irq->notif_cfg.holdoff_active) {
+		if (!irq->notif_cfg.deferred) {
+			irq->notif_cfg.deferred = notif_alloc();
+			if (!irq->notif_cfg.deferred)
+				return;
+		}
+
+		notif_update(irq, irq->notif_cfg.deferred, a1, a2, a3, a4, a5);
+		return;
+	}
+
+	call_t *call = notif_alloc();
+	if (!call)
+		return;
+
+	notif_update(irq, call, a1, a2, a3, a4, a5);
+	send_call(irq, call);
+
+	if (irq->notif_cfg.holdoff > 0) {
+		irq->notif_cfg.holdoff_active = true;
+		timeout_register(&irq->notif_cfg.holdoff_timeout,
+		    irq->notif_cfg.holdoff, irq_holdoff_expired, irq);
+	}
+}
+
 /** Apply the top-half IRQ code to find out whether to accept the IRQ or not.
  *
  * @param irq IRQ structure.
@@ -528,23 +778,9 @@ void ipc_irq_top_half_handler(irq_t *irq)
 	assert(irq_spinlock_locked(&irq->lock));
 
 	if (irq->notif_cfg.answerbox) {
-		call_t *call = ipc_call_alloc(FRAME_ATOMIC);
-		if (!call)
-			return;
-
-		call->flags |= IPC_CALL_NOTIF;
-		/* Put a counter to the message */
-		call->priv = ++irq->notif_cfg.counter;
-
-		/* Set up args */
-		IPC_SET_IMETHOD(call->data, irq->notif_cfg.imethod);
-		IPC_SET_ARG1(call->data, irq->notif_cfg.scratch[1]);
-		IPC_SET_ARG2(call->data, irq->notif_cfg.scratch[2]);
-		IPC_SET_ARG3(call->data, irq->notif_cfg.scratch[3]);
-		IPC_SET_ARG4(call->data, irq->notif_cfg.scratch[4]);
-		IPC_SET_ARG5(call->data, irq->notif_cfg.scratch[5]);
-
-		send_call(irq, call);
+		uint32_t *scratch = irq->notif_cfg.scratch;
+		notify(irq, scratch[1], scratch[2], scratch[3], scratch[4],
+		    scratch[5]);
 	}
 }
 
@@ -563,26 +799,8 @@ void ipc_irq_send_msg(irq_t *irq, sysarg_t a1, sysarg_t a2, sysarg_t a3,
 {
 	irq_spinlock_lock(&irq->lock, true);
 
-	if (irq->notif_cfg.answerbox) {
-		call_t *call = ipc_call_alloc(FRAME_ATOMIC);
-		if (!call) {
-			irq_spinlock_unlock(&irq->lock, true);
-			return;
-		}
-
-		call->flags |= IPC_CALL_NOTIF;
-		/* Put a counter to the message */
-		call->priv = ++irq->notif_cfg.counter;
-
-		IPC_SET_IMETHOD(call->data, irq->notif_cfg.imethod);
-		IPC_SET_ARG1(call->data, a1);
-		IPC_SET_ARG2(call->data, a2);
-		IPC_SET_ARG3(call->data, a3);
-		IPC_SET_ARG4(call->data, a4);
-		IPC_SET_ARG5(call->data, a5);
-
-		send_call(irq, call);
-	}
+	if (irq->notif_cfg.answerbox)
+		notify(irq, a1, a2, a3, a4, a5);
 
 	irq_spinlock_unlock(&irq->lock, true);
 }
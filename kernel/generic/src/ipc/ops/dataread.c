@@ -59,6 +59,7 @@ static errno_t request_preprocess(call_t *call, phone_t *phone)
 static errno_t answer_preprocess(call_t *answer, ipc_data_t *olddata)
 {
 	assert(!answer->buffer);
+	assert(!answer->frames);
 
 	if (!IPC_GET_RETVAL(answer->data)) {
 		/* The recipient agreed to send data. */
@@ -74,6 +75,9 @@ static errno_t answer_preprocess(call_t *answer, ipc_data_t *olddata)
 			 */
 			IPC_SET_ARG1(answer->data, dst);
 
+			if (ipc_call_pin_data(answer, src, size))
+				return EOK;
+
 			answer->buffer = malloc(size);
 			if (!answer->buffer) {
 				IPC_SET_RETVAL(answer->data, ENOMEM);
@@ -101,12 +105,12 @@ static errno_t answer_preprocess(call_t *answer, ipc_data_t *olddata)
 
 static errno_t answer_process(call_t *answer)
 {
-	if (answer->buffer) {
+	if (answer->buffer || answer->frames) {
 		uintptr_t dst = IPC_GET_ARG1(answer->data);
 		size_t size = IPC_GET_ARG2(answer->data);
 		errno_t rc;
 
-		rc = copy_to_uspace((void *) dst, answer->buffer, size);
+		rc = ipc_call_copy_data(answer, dst, size);
 		if (rc)
 			IPC_SET_RETVAL(answer->data, rc);
 	}
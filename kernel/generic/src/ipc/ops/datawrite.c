@@ -55,6 +55,9 @@ static errno_t request_preprocess(call_t *call, phone_t *phone)
 			return ELIMIT;
 	}
 
+	if (ipc_call_pin_data(call, src, size))
+		return EOK;
+
 	call->buffer = (uint8_t *) malloc(size);
 	if (!call->buffer)
 		return ENOMEM;
@@ -72,7 +75,7 @@ static errno_t request_preprocess(call_t *call, phone_t *phone)
 
 static errno_t answer_preprocess(call_t *answer, ipc_data_t *olddata)
 {
-	assert(answer->buffer);
+	assert(answer->buffer || answer->frames);
 
 	if (!IPC_GET_RETVAL(answer->data)) {
 		/* The recipient agreed to receive data. */
@@ -81,8 +84,7 @@ static errno_t answer_preprocess(call_t *answer, ipc_data_t *olddata)
 		size_t max_size = (size_t)IPC_GET_ARG2(*olddata);
 
 		if (size <= max_size) {
-			errno_t rc = copy_to_uspace((void *) dst,
-			    answer->buffer, size);
+			errno_t rc = ipc_call_copy_data(answer, dst, size);
 			if (rc)
 				IPC_SET_RETVAL(answer->data, rc);
 		} else {
@@ -45,7 +45,11 @@ static int request_process(call_t *call, answerbox_t *box)
 
 static errno_t answer_process(call_t *answer)
 {
-	if (answer->buffer) {
+	/*
+	 * A failed call may still carry the argument copied by
+	 * udebug_request_preprocess(), which must not be copied back.
+	 */
+	if (answer->buffer && IPC_GET_RETVAL(answer->data) == EOK) {
 		uintptr_t dst = IPC_GET_ARG1(answer->data);
 		size_t size = IPC_GET_ARG2(answer->data);
 		errno_t rc;
@@ -444,6 +444,134 @@ sys_errno_t sys_ipc_call_async_slow(cap_phone_handle_t handle, ipc_data_t *data,
 	return EOK;
 }
 
+/** Make an asynchronous IPC call with an inline payload.
+ *
+ * The payload is delivered together with the call. The callee learns its
+ * size from the payload_size member of the call data and gets it by
+ * sys_ipc_payload_get() without another round trip to the caller, unlike
+ * with IPC_M_DATA_WRITE.
+ *
+ * @param handle  Phone capability for the call.
+ * @param data    Userspace address of call data with the request.
+ * @param payload Userspace address of the payload.
+ * @param size    Size of the payload, at most IPC_PAYLOAD_MAX.
+ * @param label   User-defined label.
+ *
+ * @return See sys_ipc_call_async_fast(), EINVAL if the payload is too
+ *         large.
+ *
+ */
+sys_errno_t sys_ipc_call_async_payload(cap_phone_handle_t handle,
+    ipc_data_t *data, void *payload, size_t size, sysarg_t label)
+{
+	if (size > IPC_PAYLOAD_MAX)
+		return EINVAL;
+
+	kobject_t *kobj = kobject_get(TASK, handle, KOBJECT_TYPE_PHONE);
+	if (!kobj)
+		return ENOENT;
+
+	if (check_call_limit(kobj->phone)) {
+		kobject_put(kobj);
+		return ELIMIT;
+	}
+
+	call_t *call = ipc_call_alloc(0);
+	errno_t rc = copy_from_uspace(&call->data.args, &data->args,
+	    sizeof(call->data.args));
+	if (rc == EOK)
+		rc = ipc_call_set_payload(call, (uintptr_t) payload, size);
+	if (rc != EOK) {
+		kobject_put(call->kobject);
+		kobject_put(kobj);
+		return (sys_errno_t) rc;
+	}
+
+	/* Set the user-defined label */
+	call->data.label = label;
+
+	errno_t res = request_preprocess(call, kobj->phone);
+
+	if (!res)
+		ipc_call(kobj->phone, call);
+	else
+		ipc_backsend_err(kobj->phone, call, res);
+
+	kobject_put(kobj);
+	return EOK;
+}
+
+/** Make a batch of asynchronous IPC calls.
+ *
+ * The calls are made in the order in which they appear in the array and
+ * can go over different phones. Processing stops at the first call which
+ * cannot be made.
+ *
+ * @param calls          Userspace address of an array of calls.
+ * @param count          Number of calls in the array (at most IPC_BATCH_MAX).
+ * @param uspace_posted  Userspace address where to store the number of
+ *                       calls which were made. Can be NULL.
+ *
+ * @return EOK if all calls were made.
+ * @return An error code of the first call which could not be made
+ *         (see sys_ipc_call_async_fast()).
+ *
+ */
+sys_errno_t sys_ipc_call_async_batch(ipc_batch_call_t *calls, size_t count,
+    size_t *uspace_posted)
+{
+	if (count > IPC_BATCH_MAX)
+		return EINVAL;
+
+	size_t posted;
+	errno_t rc = EOK;
+
+	for (posted = 0; posted < count; posted++) {
+		ipc_batch_call_t bcall;
+
+		rc = copy_from_uspace(&bcall, &calls[posted], sizeof(bcall));
+		if (rc != EOK)
+			break;
+
+		kobject_t *kobj = kobject_get(TASK, bcall.phone,
+		    KOBJECT_TYPE_PHONE);
+		if (!kobj) {
+			rc = ENOENT;
+			break;
+		}
+
+		if (check_call_limit(kobj->phone)) {
+			kobject_put(kobj);
+			rc = ELIMIT;
+			break;
+		}
+
+		call_t *call = ipc_call_alloc(0);
+		memcpy(call->data.args, bcall.args, sizeof(call->data.args));
+
+		/* Set the user-defined label */
+		call->data.label = bcall.label;
+
+		errno_t res = request_preprocess(call, kobj->phone);
+
+		if (!res)
+			ipc_call(kobj->phone, call);
+		else
+			ipc_backsend_err(kobj->phone, call, res);
+
+		kobject_put(kobj);
+	}
+
+	if (uspace_posted) {
+		errno_t crc = copy_to_uspace(uspace_posted, &posted,
+		    sizeof(posted));
+		if (rc == EOK)
+			rc = crc;
+	}
+
+	return (sys_errno_t) rc;
+}
+
 /** Forward a received call to another destination
  *
  * Common code for both the fast and the slow version.
@@ -739,19 +867,25 @@ sys_errno_t sys_ipc_hangup(cap_phone_handle_t handle)
 }
 
 /** Wait for an incoming IPC call or an answer.
+ *
+ * Common code for the single and the batched version.
  *
  * @param calldata Pointer to buffer where the call/answer data is stored.
  * @param usec     Timeout. See waitq_sleep_timeout() for explanation.
  * @param flags    Select mode of sleep operation. See waitq_sleep_timeout()
  *                 for explanation.
+ * @param received Set to true if a call or an answer was stored,
+ *                 false if the wait timed out or was interrupted.
  *
  * @return An error code on error.
  */
-sys_errno_t sys_ipc_wait_for_call(ipc_data_t *calldata, uint32_t usec,
-    unsigned int flags)
+static errno_t ipc_wait_for_call_common(ipc_data_t *calldata, uint32_t usec,
+    unsigned int flags, bool *received)
 {
 	call_t *call;
 
+	*received = false;
+
 restart:
 
 #ifdef CONFIG_UDEBUG
@@ -774,7 +908,10 @@ restart:
 
 	call->data.flags = call->flags;
 	if (call->flags & IPC_CALL_NOTIF) {
-		/* Set in_phone_hash to the interrupt counter */
+		/*
+		 * Set in_phone_hash to the interrupt counter and in_task_id
+		 * to the number of interrupts coalesced into the notification
+		 */
 		call->data.phone = (void *) call->priv;
 
 		call->data.cap_handle = CAP_NIL;
@@ -782,6 +919,7 @@ restart:
 		STRUCT_TO_USPACE(calldata, &call->data);
 		kobject_put(call->kobject);
 
+		*received = true;
 		return EOK;
 	}
 
@@ -798,6 +936,7 @@ restart:
 		STRUCT_TO_USPACE(calldata, &call->data);
 		kobject_put(call->kobject);
 
+		*received = true;
 		return EOK;
 	}
 
@@ -822,6 +961,8 @@ restart:
 
 	kobject_add_ref(call->kobject);
 	cap_publish(TASK, handle, call->kobject);
+
+	*received = true;
 	return EOK;
 
 error:
@@ -850,6 +991,113 @@ error:
 	return rc;
 }
 
+/** Wait for an incoming IPC call or an answer.
+ *
+ * @param calldata Pointer to buffer where the call/answer data is stored.
+ * @param usec     Timeout. See waitq_sleep_timeout() for explanation.
+ * @param flags    Select mode of sleep operation. See waitq_sleep_timeout()
+ *                 for explanation.
+ *
+ * @return An error code on error.
+ */
+sys_errno_t sys_ipc_wait_for_call(ipc_data_t *calldata, uint32_t usec,
+    unsigned int flags)
+{
+	bool received;
+
+	return (sys_errno_t) ipc_wait_for_call_common(calldata, usec, flags,
+	    &received);
+}
+
+/** Wait for a batch of incoming IPC calls or answers.
+ *
+ * Waits for the first call or answer as sys_ipc_wait_for_call() does and
+ * then picks up the calls and answers which are already queued in the
+ * answerbox without blocking again.
+ *
+ * @param calldata        Pointer to an array of buffers where the call/answer
+ *                        data is stored.
+ * @param count           Number of buffers in the array (at most
+ *                        IPC_BATCH_MAX).
+ * @param usec            Timeout for the first call. See
+ *                        waitq_sleep_timeout() for explanation.
+ * @param flags           Select mode of sleep operation for the first call.
+ *                        See waitq_sleep_timeout() for explanation.
+ * @param uspace_received Userspace address where to store the number of
+ *                        received calls and answers.
+ *
+ * @return An error code on error.
+ */
+sys_errno_t sys_ipc_wait_for_call_batch(ipc_data_t *calldata, size_t count,
+    uint32_t usec, unsigned int flags, size_t *uspace_received)
+{
+	if ((count == 0) || (count > IPC_BATCH_MAX))
+		return EINVAL;
+
+	size_t nreceived = 0;
+	errno_t rc = EOK;
+
+	while (nreceived < count) {
+		bool received;
+
+		rc = ipc_wait_for_call_common(&calldata[nreceived], usec,
+		    flags, &received);
+		if ((rc != EOK) || (!received))
+			break;
+
+		nreceived++;
+
+		/* Only pick up what is already there */
+		usec = SYNCH_NO_TIMEOUT;
+		flags |= SYNCH_FLAGS_NON_BLOCKING;
+	}
+
+	/*
+	 * An error after some calls have been stored cannot be reported
+	 * without losing those calls. The failed call itself has already
+	 * been answered, so just return what has been received.
+	 */
+	if (nreceived > 0)
+		rc = EOK;
+
+	if (rc == EOK)
+		rc = copy_to_uspace(uspace_received, &nreceived,
+		    sizeof(nreceived));
+
+	return (sys_errno_t) rc;
+}
+
+/** Get the inline payload of a received call.
+ *
+ * @param chandle Handle of the call which has not been answered yet.
+ * @param buf     Userspace address of the buffer for the payload.
+ * @param size    Size of the buffer. At most the payload_size bytes of the
+ *                call are copied.
+ *
+ * @return EOK on success, ENOENT if there is no such call, EINVAL if the call
+ *         carries no payload or an error code from copy_to_uspace().
+ *
+ */
+sys_errno_t sys_ipc_payload_get(cap_call_handle_t chandle, void *buf,
+    size_t size)
+{
+	kobject_t *kobj = kobject_get(TASK, chandle, KOBJECT_TYPE_CALL);
+	if (!kobj)
+		return ENOENT;
+
+	call_t *call = kobj->call;
+	errno_t rc;
+
+	if (!call->payload)
+		rc = EINVAL;
+	else
+		rc = copy_to_uspace(buf, call->payload,
+		    min(size, call->data.payload_size));
+
+	kobject_put(kobj);
+	return (sys_errno_t) rc;
+}
+
 /** Interrupt one thread from sys_ipc_wait_for_call().
  *
  */
@@ -897,6 +1145,39 @@ sys_errno_t sys_ipc_irq_unsubscribe(cap_irq_handle_t handle)
 	return 0;
 }
 
+/** Configure coalescing of IRQ notifications.
+ *
+ * @param handle  IRQ capability handle.
+ * @param holdoff Minimum interval between two notifications in
+ *                microseconds, 0 for no rate cap.
+ *
+ * @return EPERM or an error code returned by ipc_irq_coalesce().
+ *
+ */
+sys_errno_t sys_ipc_irq_coalesce(cap_irq_handle_t handle, sysarg_t holdoff)
+{
+	if (!(perm_get(TASK) & PERM_IRQ_REG))
+		return EPERM;
+
+	return ipc_irq_coalesce(&TASK->answerbox, handle, holdoff);
+}
+
+/** Deliver the interrupt of an IRQ capability to a single CPU.
+ *
+ * @param handle  IRQ capability handle.
+ * @param cpu     ID of the target CPU.
+ *
+ * @return EPERM or an error code returned by ipc_irq_set_affinity().
+ *
+ */
+sys_errno_t sys_ipc_irq_set_affinity(cap_irq_handle_t handle, sysarg_t cpu)
+{
+	if (!(perm_get(TASK) & PERM_IRQ_REG))
+		return EPERM;
+
+	return ipc_irq_set_affinity(&TASK->answerbox, handle, cpu);
+}
+
 /** Syscall connect to a task by ID
  *
  * @return Error code.
@@ -0,0 +1,313 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup generic
+ * @{
+ */
+
+/**
+ * @file
+ * @brief System-wide kernel event tracing.
+ *
+ * Tracepoints write fixed-size records into a ring of the current CPU.
+ * The rings of all CPUs live in one physically contiguous area, which a
+ * privileged task can map read-only using the physical address published
+ * in sysinfo. Recording is switched on and off per event by SYS_KTRACE.
+ *
+ * Where the architecture registers hardware performance counters, the
+ * counter overflow interrupt records the interrupted program counter as
+ * a KTRACE_SAMPLE event, which makes the rings double as the stream of a
+ * sampling profiler.
+ */
+
+#include <ktrace.h>
+#include <abi/ktrace.h>
+#include <arch.h>
+#include <arch/asm.h>
+#include <arch/cycle.h>
+#include <config.h>
+#include <cpu.h>
+#include <ddi/ddi.h>
+#include <errno.h>
+#include <log.h>
+#include <macros.h>
+#include <mem.h>
+#include <mm/frame.h>
+#include <proc/task.h>
+#include <security/perm.h>
+#include <smp/smp_call.h>
+#include <str.h>
+#include <symtab_lookup.h>
+#include <synch/mutex.h>
+#include <syscall/copy.h>
+#include <sysinfo/sysinfo.h>
+
+/** Number of pages of the trace ring of each CPU */
+#define KTRACE_RING_PAGES  16
+
+uint32_t ktrace_mask = 0;
+
+/** Trace area starting with the ring headers of all CPUs */
+static uint8_t *ktrace_area = NULL;
+
+static parea_t ktrace_parea;
+
+/** Performance counters of the platform or NULL */
+static ktrace_sampler_ops_t *sampler_ops = NULL;
+
+/** Serializes starting and stopping of sampling */
+static mutex_t sample_lock;
+
+/** Current sampling period or 0 if not sampling */
+static uint64_t sample_period = 0;
+
+/** Allocate the trace rings and publish them to uspace
+ *
+ * Tracing stays unavailable if the area cannot be allocated.
+ *
+ */
+void ktrace_init(void)
+{
+	mutex_initialize(&sample_lock, MUTEX_PASSIVE);
+
+	size_t header_frames =
+	    SIZE2FRAMES(config.cpu_count * sizeof(ktrace_ring_t));
+	size_t frames = header_frames + config.cpu_count * KTRACE_RING_PAGES;
+
+	uintptr_t base = frame_alloc(frames, FRAME_LOWMEM | FRAME_ATOMIC, 0);
+	if (base == 0) {
+		log(LF_OTHER, LVL_WARN, "Cannot allocate %zu frames for "
+		    "kernel tracing.", frames);
+		return;
+	}
+
+	uint8_t *area = (uint8_t *) PA2KA(base);
+	memsetb(area, FRAMES2SIZE(header_frames), 0);
+
+	ktrace_ring_t *rings = (ktrace_ring_t *) area;
+	for (size_t i = 0; i < config.cpu_count; i++) {
+		rings[i].head = 0;
+		rings[i].capacity = FRAMES2SIZE(KTRACE_RING_PAGES) /
+		    sizeof(ktrace_record_t);
+		rings[i].offset = FRAMES2SIZE(header_frames +
+		    i * KTRACE_RING_PAGES);
+		rings[i].cpu = i;
+	}
+
+	ktrace_parea.pbase = base;
+	ktrace_parea.frames = frames;
+	ktrace_parea.unpriv = false;
+	ktrace_parea.mapped = false;
+	ddi_parea_register(&ktrace_parea);
+
+	sysinfo_set_item_val("ktrace.faddr", NULL, (sysarg_t) base);
+	sysinfo_set_item_val("ktrace.pages", NULL, frames);
+	sysinfo_set_item_val("ktrace.cpus", NULL, config.cpu_count);
+
+	__atomic_store_n(&ktrace_area, area, __ATOMIC_RELEASE);
+}
+
+/** Append a record to the trace ring of the current CPU
+ *
+ * Called by the KTRACE() tracepoints only when the event is enabled.
+ *
+ * @param event Event to record.
+ * @param arg0  First event argument.
+ * @param arg1  Second event argument.
+ *
+ */
+void ktrace_emit(ktrace_event_t event, uint64_t arg0, uint64_t arg1)
+{
+	uint8_t *area = __atomic_load_n(&ktrace_area, __ATOMIC_ACQUIRE);
+	if ((area == NULL) || (CPU == NULL))
+		return;
+
+	/* Tracepoints in interrupt handlers must not interleave with ours */
+	ipl_t ipl = interrupts_disable();
+
+	ktrace_ring_t *ring = &((ktrace_ring_t *) area)[CPU->id];
+	ktrace_record_t *records = (ktrace_record_t *) (area + ring->offset);
+	uint32_t head = ring->head;
+
+	/*
+	 * Readers which observe the slot being overwritten must also
+	 * observe the head that invalidates its previous contents.
+	 */
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	ktrace_record_t *record = &records[head & (ring->capacity - 1)];
+	record->timestamp = get_cycle();
+	record->event = event;
+	record->cpu = CPU->id;
+	record->arg[0] = arg0;
+	record->arg[1] = arg1;
+
+	__atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+
+	interrupts_restore(ipl);
+}
+
+/** Register the performance counters used for sampling
+ *
+ * @param ops Counter operations, valid on all processors.
+ *
+ */
+void ktrace_sampler_register(ktrace_sampler_ops_t *ops)
+{
+	sampler_ops = ops;
+}
+
+/** Record a profiling sample
+ *
+ * Called by the counter overflow interrupt handler.
+ *
+ * @param istate State interrupted by the counter overflow.
+ *
+ */
+void ktrace_sample(istate_t *istate)
+{
+	KTRACE(KTRACE_SAMPLE, istate_get_pc(istate),
+	    istate_from_uspace(istate) ? TASK->taskid : 0);
+}
+
+static void sample_start_local(void *arg)
+{
+	sampler_ops->start(*(uint64_t *) arg);
+}
+
+static void sample_stop_local(void *arg)
+{
+	sampler_ops->stop();
+}
+
+/** Start or stop sampling on all processors
+ *
+ * @param period Sampling period in cycles or 0 to stop sampling.
+ *
+ * @return ENOTSUP if the platform has no usable performance counters.
+ *
+ */
+static errno_t ktrace_sample_set(uint64_t period)
+{
+	if (sampler_ops == NULL)
+		return ENOTSUP;
+
+	mutex_lock(&sample_lock);
+
+	if (period != 0) {
+		__atomic_fetch_or(&ktrace_mask, UINT32_C(1) << KTRACE_SAMPLE,
+		    __ATOMIC_RELAXED);
+	}
+
+	for (unsigned int i = 0; i < config.cpu_count; i++) {
+		if (period != 0)
+			smp_call(i, sample_start_local, &period);
+		else if (sample_period != 0)
+			smp_call(i, sample_stop_local, NULL);
+	}
+
+	if (period == 0) {
+		__atomic_fetch_and(&ktrace_mask, ~(UINT32_C(1) << KTRACE_SAMPLE),
+		    __ATOMIC_RELAXED);
+	}
+
+	sample_period = period;
+	mutex_unlock(&sample_lock);
+	return EOK;
+}
+
+/** Copy the name of the kernel function at an address to uspace
+ *
+ * @param addr       Kernel address.
+ * @param uspace_buf Buffer for the NUL-terminated name.
+ * @param size       Size of the buffer.
+ *
+ */
+static errno_t ktrace_symbol(uintptr_t addr, void *uspace_buf, size_t size)
+{
+	const char *name;
+	errno_t rc = symtab_name_lookup(addr, &name, NULL);
+	if (rc != EOK)
+		return rc;
+
+	if (size == 0)
+		return EINVAL;
+
+	char buf[MAX_SYMBOL_NAME + 1];
+	str_cpy(buf, min(size, sizeof(buf)), name);
+
+	return copy_to_uspace(uspace_buf, buf, str_size(buf) + 1);
+}
+
+/** Control kernel tracing from uspace
+ *
+ * @param operation Operation to perform (ktrace_operation_t).
+ * @param arg1      Mask of events for KTRACE_ENABLE, sampling period in
+ *                  cycles for KTRACE_SAMPLE_START, kernel address for
+ *                  KTRACE_SYMBOL.
+ * @param arg2      Buffer for the symbol name for KTRACE_SYMBOL.
+ * @param arg3      Size of the buffer for KTRACE_SYMBOL.
+ *
+ * @return EPERM if the task may not map the trace area.
+ * @return ENOTSUP if tracing or sampling is not available.
+ * @return EINVAL if the sampling period is too short.
+ * @return ENOENT if there is no kernel symbol at the address.
+ *
+ */
+sys_errno_t sys_ktrace(sysarg_t operation, sysarg_t arg1, sysarg_t arg2,
+    sysarg_t arg3)
+{
+	if ((perm_get(TASK) & PERM_MEM_MANAGER) != PERM_MEM_MANAGER)
+		return (sys_errno_t) EPERM;
+
+	if (__atomic_load_n(&ktrace_area, __ATOMIC_ACQUIRE) == NULL)
+		return (sys_errno_t) ENOTSUP;
+
+	switch (operation) {
+	case KTRACE_ENABLE:
+		__atomic_store_n(&ktrace_mask, (uint32_t) arg1 & KTRACE_ALL,
+		    __ATOMIC_RELAXED);
+		return EOK;
+	case KTRACE_DISABLE:
+		__atomic_store_n(&ktrace_mask, 0, __ATOMIC_RELAXED);
+		return EOK;
+	case KTRACE_SAMPLE_START:
+		if (arg1 < KTRACE_SAMPLE_PERIOD_MIN)
+			return (sys_errno_t) EINVAL;
+		return (sys_errno_t) ktrace_sample_set(arg1);
+	case KTRACE_SAMPLE_STOP:
+		return (sys_errno_t) ktrace_sample_set(0);
+	case KTRACE_SYMBOL:
+		return (sys_errno_t) ktrace_symbol(arg1, (void *) arg2, arg3);
+	default:
+		return (sys_errno_t) ENOTSUP;
+	}
+}
+
+/** @}
+ */
@@ -57,6 +57,31 @@ void *memset(void *dst, int val, size_t cnt)
 {
 	uint8_t *dp = (uint8_t *) dst;
 
+	/* Fill the unaligned head byte by byte. */
+	while (cnt != 0 && ((uintptr_t) dp & (sizeof(unsigned long) - 1)) != 0) {
+		*dp++ = val;
+		cnt--;
+	}
+
+	/* Fill the aligned part four words at a time. */
+	unsigned long pattern = (uint8_t) val * (~0UL / 0xff);
+	unsigned long *dw = (unsigned long *) dp;
+
+	while (cnt >= 4 * sizeof(unsigned long)) {
+		dw[0] = pattern;
+		dw[1] = pattern;
+		dw[2] = pattern;
+		dw[3] = pattern;
+		dw += 4;
+		cnt -= 4 * sizeof(unsigned long);
+	}
+
+	while (cnt >= sizeof(unsigned long)) {
+		*dw++ = pattern;
+		cnt -= sizeof(unsigned long);
+	}
+
+	dp = (uint8_t *) dw;
 	while (cnt-- != 0)
 		*dp++ = val;
 
@@ -79,6 +104,45 @@ void *memcpy(void *dst, const void *src, size_t cnt)
 {
 	uint8_t *dp = (uint8_t *) dst;
 	const uint8_t *sp = (uint8_t *) src;
+	const uintptr_t mask = sizeof(unsigned long) - 1;
+
+	/*
+	 * If the addresses are congruent modulo the word size, copy
+	 * the aligned part by words.
+	 */
+	if ((((uintptr_t) dp ^ (uintptr_t) sp) & mask) == 0) {
+		while (cnt != 0 && ((uintptr_t) dp & mask) != 0) {
+			*dp++ = *sp++;
+			cnt--;
+		}
+
+		unsigned long *dw = (unsigned long *) dp;
+		const unsigned long *sw = (const unsigned long *) sp;
+
+		while (cnt >= 4 * sizeof(unsigned long)) {
+			unsigned long w0 = sw[0];
+			unsigned long w1 = sw[1];
+			unsigned long w2 = sw[2];
+			unsigned long w3 = sw[3];
+
+			dw[0] = w0;
+			dw[1] = w1;
+			dw[2] = w2;
+			dw[3] = w3;
+
+			dw += 4;
+			sw += 4;
+			cnt -= 4 * sizeof(unsigned long);
+		}
+
+		while (cnt >= sizeof(unsigned long)) {
+			*dw++ = *sw++;
+			cnt -= sizeof(unsigned long);
+		}
+
+		dp = (uint8_t *) dw;
+		sp = (const uint8_t *) sw;
+	}
 
 	while (cnt-- != 0)
 		*dp++ = *sp++;
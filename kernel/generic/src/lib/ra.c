@@ -40,6 +40,12 @@
  *   Bonwick J., Adams J.: Magazines and Vmem: Extending the Slab Allocator to
  *   Many CPUs and Arbitrary Resources, USENIX 2001
  *
+ * Arenas created by ra_arena_create_qcache() front the span free lists with
+ * per-CPU quantum caches for the small power-of-two multiples of the arena
+ * quantum. The caches hold naturally aligned segments and exchange them
+ * with the arena in batches, so that most small allocations do not touch
+ * the arena lock at all.
+ *
  */
 
 #include <assert.h>
@@ -54,9 +60,19 @@
 #include <align.h>
 #include <macros.h>
 #include <synch/spinlock.h>
+#include <config.h>
+#include <cpu.h>
+#include <arch.h>
 
 static slab_cache_t *ra_segment_cache;
 
+/** Arenas with quantum caches. */
+static LIST_INITIALIZE(ra_qcache_arenas);
+IRQ_SPINLOCK_STATIC_INITIALIZE(ra_qcache_lock);
+
+/** True once the number of processors is known. */
+static bool ra_cpucache_enabled = false;
+
 /** Return the hash of the key stored in the item */
 static size_t used_hash(const ht_link_t *item)
 {
@@ -210,14 +226,92 @@ ra_arena_t *ra_arena_create(void)
 	irq_spinlock_initialize(&arena->lock, "arena_lock");
 	list_initialize(&arena->spans);
 
+	link_initialize(&arena->qcache_link);
+	arena->quantum = 0;
+	arena->qcache = NULL;
+
 	return arena;
 }
 
+/** Allocate and initialize per-CPU quantum caches of an arena. */
+static ra_qcache_t *ra_qcache_create(void)
+{
+	ra_qcache_t *qcache = (ra_qcache_t *) malloc(config.cpu_count *
+	    sizeof(ra_qcache_t));
+	if (!qcache)
+		return NULL;
+
+	for (unsigned int i = 0; i < config.cpu_count; i++) {
+		irq_spinlock_initialize(&qcache[i].lock, "ra_qcache_lock");
+		for (unsigned int order = 0; order < RA_QCACHE_ORDERS; order++)
+			qcache[i].count[order] = 0;
+	}
+
+	return qcache;
+}
+
+/** Create an empty arena with per-CPU quantum caches.
+ *
+ * Segments of quantum, 2 * quantum, ... up to RA_QCACHE_ORDERS size classes
+ * allocated with at most their natural alignment are served from per-CPU
+ * caches. The caches are used only after ra_enable_cpucache() has been
+ * called.
+ *
+ * @param quantum Smallest cached size, must be a power of two.
+ *
+ */
+ra_arena_t *ra_arena_create_qcache(size_t quantum)
+{
+	assert(ispwr2(quantum));
+
+	ra_arena_t *arena = ra_arena_create();
+	if (!arena)
+		return NULL;
+
+	arena->quantum = quantum;
+
+	irq_spinlock_lock(&ra_qcache_lock, true);
+	if (ra_cpucache_enabled) {
+		/* No-one else can see the arena yet. */
+		irq_spinlock_unlock(&ra_qcache_lock, true);
+		arena->qcache = ra_qcache_create();
+		irq_spinlock_lock(&ra_qcache_lock, true);
+	}
+	list_append(&arena->qcache_link, &ra_qcache_arenas);
+	irq_spinlock_unlock(&ra_qcache_lock, true);
+
+	return arena;
+}
+
+/** Enable quantum caches of all arenas.
+ *
+ * Kernel calls this function when it knows the real number of processors,
+ * i.e. before the application processors start running.
+ *
+ */
+void ra_enable_cpucache(void)
+{
+	irq_spinlock_lock(&ra_qcache_lock, true);
+	ra_cpucache_enabled = true;
+	irq_spinlock_unlock(&ra_qcache_lock, true);
+
+	/* Nothing else runs yet, so the list cannot change under us. */
+	list_foreach(ra_qcache_arenas, qcache_link, ra_arena_t, arena)
+		arena->qcache = ra_qcache_create();
+}
+
 void ra_arena_destroy(ra_arena_t *arena)
 {
+	if (link_used(&arena->qcache_link)) {
+		irq_spinlock_lock(&ra_qcache_lock, true);
+		list_remove(&arena->qcache_link);
+		irq_spinlock_unlock(&ra_qcache_lock, true);
+	}
+
 	/*
 	 * No locking necessary as this is the cleanup and all users should have
-	 * stopped using the arena already.
+	 * stopped using the arena already. Segments held by the quantum caches
+	 * go away together with the spans.
 	 */
 	list_foreach_safe(arena->spans, cur, next) {
 		ra_span_t *span = list_get_instance(cur, ra_span_t, span_link);
@@ -225,6 +319,8 @@ void ra_arena_destroy(ra_arena_t *arena)
 		ra_span_destroy(span);
 	}
 
+	if (arena->qcache)
+		free(arena->qcache);
 	free(arena);
 }
 
@@ -411,42 +507,206 @@ static void ra_span_free(ra_span_t *span, size_t base, size_t size)
 	list_append(&seg->fl_link, &span->free[order]);
 }
 
+static bool ra_arena_alloc_locked(ra_arena_t *arena, size_t size,
+    size_t alignment, uintptr_t *base)
+{
+	assert(irq_spinlock_locked(&arena->lock));
+
+	list_foreach(arena->spans, span_link, ra_span_t, span) {
+		if (ra_span_alloc(span, size, alignment, base))
+			return true;
+	}
+
+	return false;
+}
+
+static bool ra_arena_free_locked(ra_arena_t *arena, uintptr_t base,
+    size_t size)
+{
+	assert(irq_spinlock_locked(&arena->lock));
+
+	list_foreach(arena->spans, span_link, ra_span_t, span) {
+		if (iswithin(span->base, span->size, base, size)) {
+			ra_span_free(span, base, size);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/** Return the quantum cache size class of a request.
+ *
+ * @return Size class or -1 if the request cannot be cached.
+ *
+ */
+static int ra_qcache_order(ra_arena_t *arena, size_t size, size_t alignment)
+{
+	if ((!arena->qcache) || (!ispwr2(size)) || (size < arena->quantum) ||
+	    (alignment > size))
+		return -1;
+
+	size_t order = fnzb(size) - fnzb(arena->quantum);
+	if (order >= RA_QCACHE_ORDERS)
+		return -1;
+
+	return (int) order;
+}
+
+/** Allocate a segment from the quantum cache of the current CPU.
+ *
+ * An empty cache is refilled with half of its capacity at once.
+ *
+ */
+static bool ra_qcache_alloc(ra_arena_t *arena, size_t order, uintptr_t *base)
+{
+	size_t size = arena->quantum << order;
+
+	if (!CPU)
+		return false;
+
+	ra_qcache_t *qcache = &arena->qcache[CPU->id];
+	irq_spinlock_lock(&qcache->lock, true);
+
+	if (qcache->count[order] == 0) {
+		irq_spinlock_lock(&arena->lock, false);
+		while (qcache->count[order] < RA_QCACHE_SIZE / 2) {
+			uintptr_t seg;
+			if (!ra_arena_alloc_locked(arena, size, size, &seg))
+				break;
+
+			qcache->base[order][qcache->count[order]++] = seg;
+		}
+		irq_spinlock_unlock(&arena->lock, false);
+	}
+
+	bool success = (qcache->count[order] > 0);
+	if (success)
+		*base = qcache->base[order][--qcache->count[order]];
+
+	irq_spinlock_unlock(&qcache->lock, true);
+	return success;
+}
+
+/** Return a segment to the quantum cache of the current CPU.
+ *
+ * A full cache first gives the older half of its contents back to the
+ * arena.
+ *
+ */
+static bool ra_qcache_free(ra_arena_t *arena, size_t order, uintptr_t base)
+{
+	size_t size = arena->quantum << order;
+
+	/* Only naturally aligned segments can satisfy any cached request. */
+	if ((!CPU) || (!IS_ALIGNED(base, size)))
+		return false;
+
+	ra_qcache_t *qcache = &arena->qcache[CPU->id];
+	irq_spinlock_lock(&qcache->lock, true);
+
+	if (qcache->count[order] == RA_QCACHE_SIZE) {
+		size_t half = RA_QCACHE_SIZE / 2;
+
+		irq_spinlock_lock(&arena->lock, false);
+		for (size_t i = 0; i < half; i++) {
+			if (!ra_arena_free_locked(arena, qcache->base[order][i],
+			    size))
+				panic("Freeing to wrong arena (base=%" PRIxPTR
+				    ", size=%zd).", qcache->base[order][i],
+				    size);
+		}
+		irq_spinlock_unlock(&arena->lock, false);
+
+		for (size_t i = half; i < RA_QCACHE_SIZE; i++)
+			qcache->base[order][i - half] = qcache->base[order][i];
+		qcache->count[order] -= half;
+	}
+
+	qcache->base[order][qcache->count[order]++] = base;
+
+	irq_spinlock_unlock(&qcache->lock, true);
+	return true;
+}
+
+/** Give all segments held by the quantum caches back to the arena.
+ *
+ * @return True if any segment was given back.
+ *
+ */
+static bool ra_qcache_reap(ra_arena_t *arena)
+{
+	bool reaped = false;
+
+	for (unsigned int i = 0; i < config.cpu_count; i++) {
+		ra_qcache_t *qcache = &arena->qcache[i];
+
+		irq_spinlock_lock(&qcache->lock, true);
+		irq_spinlock_lock(&arena->lock, false);
+
+		for (size_t order = 0; order < RA_QCACHE_ORDERS; order++) {
+			size_t size = arena->quantum << order;
+
+			while (qcache->count[order] > 0) {
+				uintptr_t seg =
+				    qcache->base[order][--qcache->count[order]];
+				if (!ra_arena_free_locked(arena, seg, size))
+					panic("Freeing to wrong arena (base=%"
+					    PRIxPTR ", size=%zd).", seg, size);
+				reaped = true;
+			}
+		}
+
+		irq_spinlock_unlock(&arena->lock, false);
+		irq_spinlock_unlock(&qcache->lock, true);
+	}
+
+	return reaped;
+}
+
 /** Allocate resources from arena. */
 bool
 ra_alloc(ra_arena_t *arena, size_t size, size_t alignment, uintptr_t *base)
 {
-	bool success = false;
+	bool success;
 
 	assert(size >= 1);
 	assert(alignment >= 1);
 	assert(ispwr2(alignment));
 
+	int order = ra_qcache_order(arena, size, alignment);
+	if ((order >= 0) && (ra_qcache_alloc(arena, order, base)))
+		return true;
+
 	irq_spinlock_lock(&arena->lock, true);
-	list_foreach(arena->spans, span_link, ra_span_t, span) {
-		success = ra_span_alloc(span, size, alignment, base);
-		if (success)
-			break;
-	}
+	success = ra_arena_alloc_locked(arena, size, alignment, base);
 	irq_spinlock_unlock(&arena->lock, true);
 
+	if ((!success) && (arena->qcache) && (ra_qcache_reap(arena))) {
+		/* The cached segments might have been in the way. */
+		irq_spinlock_lock(&arena->lock, true);
+		success = ra_arena_alloc_locked(arena, size, alignment, base);
+		irq_spinlock_unlock(&arena->lock, true);
+	}
+
 	return success;
 }
 
 /* Return resources to arena. */
 void ra_free(ra_arena_t *arena, uintptr_t base, size_t size)
 {
+	int order = ra_qcache_order(arena, size, 1);
+	if ((order >= 0) && (ra_qcache_free(arena, order, base)))
+		return;
+
 	irq_spinlock_lock(&arena->lock, true);
-	list_foreach(arena->spans, span_link, ra_span_t, span) {
-		if (iswithin(span->base, span->size, base, size)) {
-			ra_span_free(span, base, size);
-			irq_spinlock_unlock(&arena->lock, true);
-			return;
-		}
-	}
+	bool freed = ra_arena_free_locked(arena, base, size);
 	irq_spinlock_unlock(&arena->lock, true);
 
-	panic("Freeing to wrong arena (base=%" PRIxPTR ", size=%zd).",
-	    base, size);
+	if (!freed) {
+		panic("Freeing to wrong arena (base=%" PRIxPTR ", size=%zd).",
+		    base, size);
+	}
 }
 
 void ra_init(void)
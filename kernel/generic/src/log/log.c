@@ -53,138 +53,374 @@
 #include <console/console.h>
 #include <abi/log.h>
 #include <mm/slab.h>
+#include <time/timeout.h>
+#include <arch/asm.h>
+#include <config.h>
+#include <cpu.h>
+#include <macros.h>
+#include <mem.h>
 
 #define LOG_PAGES    8
 #define LOG_LENGTH   (LOG_PAGES * PAGE_SIZE)
-#define LOG_ENTRY_HEADER_LENGTH (sizeof(size_t) + sizeof(uint32_t))
+#define LOG_ENTRY_HEADER_LENGTH (sizeof(size_t) + 3 * sizeof(uint32_t))
 
-/** Cyclic buffer holding the data for kernel log */
-uint8_t log_buffer[LOG_LENGTH] __attribute__((aligned(PAGE_SIZE)));
+/** Notify klog at the latest once this many bytes have been logged */
+#define LOG_NOTIFY_BYTES  (PAGE_SIZE / 2)
 
-/** Kernel log initialized */
-static atomic_t log_inited = { false };
+/** Notify klog at the latest this many microseconds after a message */
+#define LOG_NOTIFY_DELAY  20000
+
+/** Size of the chunks in which entries are copied to the kernel console */
+#define LOG_KIO_CHUNK  64
+
+/** Per-processor cyclic buffer of log entries
+ *
+ * Only the owning processor appends to its buffer, with interrupts
+ * disabled, so appending to the log does not take any lock. Positions
+ * grow monotonically and are reduced modulo LOG_LENGTH on access.
+ * The writer advances the tail before it overwrites the oldest entries,
+ * which lets readers detect entries that changed under their hands.
+ */
+typedef struct {
+	/** Buffer holding the entries */
+	uint8_t *data;
+	/** Position where the oldest entry starts */
+	size_t tail;
+	/** Position just past the newest complete entry */
+	size_t head;
+	/** Length (including header) of the entry currently being written */
+	size_t current_len;
+	/** Interrupt level to restore once the current entry is finished */
+	ipl_t ipl;
+	/** Start of the next entry to be handed to uspace */
+	size_t next_for_uspace;
+} log_ring_t;
+
+/** Cyclic buffer holding the log entries of the boot processor */
+uint8_t log_buffer[LOG_LENGTH] __attribute__((aligned(PAGE_SIZE)));
 
-/** Position in the cyclic buffer where the first log entry starts */
-size_t log_start = 0;
+/** Log ring used before the per-processor rings are set up */
+static log_ring_t log_boot_ring = {
+	.data = log_buffer
+};
 
-/** Sum of length of all log entries currently stored in the cyclic buffer */
-size_t log_used = 0;
+/** Log rings of all processors, indexed by processor ID */
+static log_ring_t **log_rings = NULL;
 
-/** Log spinlock */
-SPINLOCK_STATIC_INITIALIZE_NAME(log_lock, "log_lock");
+/** Kernel log initialized */
+static atomic_t log_inited = { false };
 
 /** Overall count of logged messages, which may overflow as needed */
 static uint32_t log_counter = 0;
 
-/** Starting position of the entry currently being written to the log */
-static size_t log_current_start = 0;
+/** Serializes readers of the log */
+SPINLOCK_STATIC_INITIALIZE_NAME(log_read_lock, "log_read_lock");
+
+/** Number of bytes logged since klog was last notified */
+static size_t log_pending = 0;
 
-/** Length (including header) of the entry currently being written to the log */
-static size_t log_current_len = 0;
+/** True while log_notify_timeout is registered */
+static bool log_notify_armed = false;
 
-/** Start of the next entry to be handed to uspace starting from log_start */
-static size_t next_for_uspace = 0;
+/** Timeout delivering a delayed notification to klog */
+static timeout_t log_notify_timeout;
 
 static void log_update(void *);
 
 /** Initialize kernel logging facility
+ *
+ * Set up a log ring for each processor. The boot processor keeps the ring
+ * with the messages logged so far.
  *
  */
 void log_init(void)
 {
+	log_ring_t **rings = malloc(sizeof(log_ring_t *) * config.cpu_count);
+	if (!rings)
+		panic("Cannot allocate log rings.");
+
+	for (size_t i = 0; i < config.cpu_count; i++) {
+		if (i == CPU->id) {
+			rings[i] = &log_boot_ring;
+			continue;
+		}
+
+		rings[i] = malloc(sizeof(log_ring_t));
+		if (!rings[i])
+			panic("Cannot allocate log rings.");
+
+		memsetb(rings[i], sizeof(log_ring_t), 0);
+		rings[i]->data = malloc(LOG_LENGTH);
+		if (!rings[i]->data)
+			panic("Cannot allocate log rings.");
+	}
+
+	timeout_initialize(&log_notify_timeout);
+	__atomic_store_n(&log_rings, rings, __ATOMIC_RELEASE);
+
 	event_set_unmask_callback(EVENT_KLOG, log_update);
 	atomic_set(&log_inited, true);
 }
 
-static size_t log_copy_from(uint8_t *data, size_t pos, size_t len)
+/** Get the number of log rings */
+static size_t log_ring_count(void)
 {
-	for (size_t i = 0; i < len; i++, pos = (pos + 1) % LOG_LENGTH) {
-		data[i] = log_buffer[pos];
-	}
-	return pos;
+	return (__atomic_load_n(&log_rings, __ATOMIC_ACQUIRE) != NULL) ?
+	    config.cpu_count : 1;
 }
 
-static size_t log_copy_to(const uint8_t *data, size_t pos, size_t len)
+/** Get a log ring by its index */
+static log_ring_t *log_ring_get(size_t i)
 {
-	for (size_t i = 0; i < len; i++, pos = (pos + 1) % LOG_LENGTH) {
-		log_buffer[pos] = data[i];
-	}
-	return pos;
+	log_ring_t **rings = __atomic_load_n(&log_rings, __ATOMIC_ACQUIRE);
+	return (rings != NULL) ? rings[i] : &log_boot_ring;
+}
+
+/** Get the log ring of the current processor
+ *
+ * Interrupts must be disabled.
+ */
+static log_ring_t *log_ring_local(void)
+{
+	log_ring_t **rings = __atomic_load_n(&log_rings, __ATOMIC_ACQUIRE);
+	if ((rings == NULL) || (CPU == NULL))
+		return &log_boot_ring;
+
+	return rings[CPU->id];
+}
+
+/** Check whether position a precedes position b */
+static inline bool log_pos_before(size_t a, size_t b)
+{
+	return (ssize_t) (a - b) < 0;
+}
+
+static void log_copy_from(log_ring_t *ring, uint8_t *data, size_t pos,
+    size_t len)
+{
+	for (size_t i = 0; i < len; i++, pos++)
+		data[i] = ring->data[pos % LOG_LENGTH];
+}
+
+static void log_copy_to(log_ring_t *ring, const uint8_t *data, size_t pos,
+    size_t len)
+{
+	for (size_t i = 0; i < len; i++, pos++)
+		ring->data[pos % LOG_LENGTH] = data[i];
 }
 
 /** Append data to the currently open log entry.
  *
- * This function requires that the log_lock is acquired by the caller.
+ * This function must be called by the processor owning the ring
+ * with interrupts disabled.
  */
-static void log_append(const uint8_t *data, size_t len)
+static void log_append(log_ring_t *ring, const uint8_t *data, size_t len)
 {
 	/* Cap the length so that the entry entirely fits into the buffer */
-	if (len > LOG_LENGTH - log_current_len) {
-		len = LOG_LENGTH - log_current_len;
+	if (len > LOG_LENGTH - ring->current_len) {
+		len = LOG_LENGTH - ring->current_len;
 	}
 
 	if (len == 0)
 		return;
 
-	size_t log_free = LOG_LENGTH - log_used - log_current_len;
-
 	/* Discard older entries to make space, if necessary */
-	while (len > log_free) {
+	size_t tail = ring->tail;
+	while ((ring->head - tail) + ring->current_len + len > LOG_LENGTH) {
 		size_t entry_len;
-		log_copy_from((uint8_t *) &entry_len, log_start, sizeof(size_t));
-		log_start = (log_start + entry_len) % LOG_LENGTH;
-		log_used -= entry_len;
-		log_free += entry_len;
-		next_for_uspace -= entry_len;
+		log_copy_from(ring, (uint8_t *) &entry_len, tail, sizeof(size_t));
+		tail += entry_len;
+	}
+
+	if (tail != ring->tail) {
+		/* Readers must see the new tail before the data is overwritten */
+		__atomic_store_n(&ring->tail, tail, __ATOMIC_RELAXED);
+		__atomic_thread_fence(__ATOMIC_RELEASE);
+	}
+
+	log_copy_to(ring, data, ring->head + ring->current_len, len);
+	ring->current_len += len;
+}
+
+/** Check that data copied from a log ring was not overwritten meanwhile.
+ *
+ * @param ring Log ring.
+ * @param pos  Position from which the data was copied.
+ *
+ * @return True if the copied data is intact.
+ */
+static bool log_intact(log_ring_t *ring, size_t pos)
+{
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	return !log_pos_before(pos, __atomic_load_n(&ring->tail,
+	    __ATOMIC_RELAXED));
+}
+
+/** Read the header of the next entry of a ring to be handed to uspace.
+ *
+ * Entries overwritten before being read are skipped. The caller must
+ * hold log_read_lock.
+ *
+ * @param ring   Log ring.
+ * @param len    Place to store the length of the entry.
+ * @param serial Place to store the serial number of the entry.
+ *
+ * @return True if there is such an entry.
+ */
+static bool log_peek(log_ring_t *ring, size_t *len, uint32_t *serial)
+{
+	while (true) {
+		size_t tail = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+		if (log_pos_before(ring->next_for_uspace, tail))
+			ring->next_for_uspace = tail;
+
+		size_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+		if (!log_pos_before(ring->next_for_uspace, head))
+			return false;
+
+		log_copy_from(ring, (uint8_t *) len, ring->next_for_uspace,
+		    sizeof(size_t));
+		log_copy_from(ring, (uint8_t *) serial,
+		    ring->next_for_uspace + sizeof(size_t), sizeof(uint32_t));
+
+		if (log_intact(ring, ring->next_for_uspace))
+			return true;
+	}
+}
+
+/** Check whether there are entries not yet handed to uspace */
+static bool log_unread(void)
+{
+	for (size_t i = 0; i < log_ring_count(); i++) {
+		log_ring_t *ring = log_ring_get(i);
+
+		size_t pos = ring->next_for_uspace;
+		size_t tail = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+		if (log_pos_before(pos, tail))
+			pos = tail;
+
+		if (log_pos_before(pos, __atomic_load_n(&ring->head,
+		    __ATOMIC_ACQUIRE)))
+			return true;
 	}
 
-	size_t pos = (log_current_start + log_current_len) % LOG_LENGTH;
-	log_copy_to(data, pos, len);
-	log_current_len += len;
+	return false;
+}
+
+/** Print the text of a finished entry to the kernel console.
+ *
+ * The text is decoded in chunks which do not split UTF-8 sequences.
+ * This function requires that the kio_lock is acquired by the caller.
+ */
+static void log_kio_push(log_ring_t *ring, size_t pos, size_t len)
+{
+	char chunk[LOG_KIO_CHUNK];
+
+	while (len > 0) {
+		size_t n = min(len, sizeof(chunk));
+		log_copy_from(ring, (uint8_t *) chunk, pos, n);
+
+		if (n < len) {
+			/* Leave a possibly incomplete character for the next chunk */
+			size_t k = n;
+			while ((k > 0) && ((chunk[k - 1] & 0xc0) == 0x80))
+				k--;
+			if (k > 1)
+				n = k - 1;
+		}
+
+		size_t offset = 0;
+		while (offset < n)
+			kio_push_char(str_decode(chunk, &offset, n));
+
+		pos += n;
+		len -= n;
+	}
 }
 
 /** Begin writing an entry to the log.
  *
- * This acquires the log and output buffer locks, so only calls to log_* functions should
- * be used until calling log_end.
+ * This disables interrupts until log_end(), so only calls to log_*
+ * functions should be used until calling log_end.
  */
 void log_begin(log_facility_t fac, log_level_t level)
 {
-	spinlock_lock(&log_lock);
-	spinlock_lock(&kio_lock);
+	ipl_t ipl = interrupts_disable();
+	log_ring_t *ring = log_ring_local();
+
+	ring->ipl = ipl;
+	ring->current_len = 0;
 
-	log_current_start = (log_start + log_used) % LOG_LENGTH;
-	log_current_len = 0;
+	uint32_t serial = __atomic_fetch_add(&log_counter, 1, __ATOMIC_RELAXED);
 
 	/* Write header of the log entry, the length will be written in log_end() */
-	log_append((uint8_t *) &log_current_len, sizeof(size_t));
-	log_append((uint8_t *) &log_counter, sizeof(uint32_t));
+	log_append(ring, (uint8_t *) &ring->current_len, sizeof(size_t));
+	log_append(ring, (uint8_t *) &serial, sizeof(uint32_t));
 	uint32_t fac32 = fac;
 	uint32_t lvl32 = level;
-	log_append((uint8_t *) &fac32, sizeof(uint32_t));
-	log_append((uint8_t *) &lvl32, sizeof(uint32_t));
+	log_append(ring, (uint8_t *) &fac32, sizeof(uint32_t));
+	log_append(ring, (uint8_t *) &lvl32, sizeof(uint32_t));
+}
+
+static void log_notify_timeout_handler(void *arg)
+{
+	__atomic_store_n(&log_notify_armed, false, __ATOMIC_RELAXED);
+	log_update(NULL);
+}
+
+/** Let klog know about a new entry.
+ *
+ * Notifications are batched: klog is notified right away only once enough
+ * data has accumulated, otherwise the notification is delayed.
+ *
+ * @param len Length of the new entry.
+ */
+static void log_notify(size_t len)
+{
+	if (!atomic_get(&log_inited))
+		return;
+
+	if (__atomic_add_fetch(&log_pending, len, __ATOMIC_RELAXED) >=
+	    LOG_NOTIFY_BYTES) {
+		log_update(NULL);
+		return;
+	}
 
-	log_counter++;
+	bool expected = false;
+	if (__atomic_compare_exchange_n(&log_notify_armed, &expected, true,
+	    false, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+		timeout_register(&log_notify_timeout, LOG_NOTIFY_DELAY,
+		    log_notify_timeout_handler, NULL);
+	}
 }
 
 /** Finish writing an entry to the log.
  *
- * This releases the log and output buffer locks.
+ * This publishes the entry to readers, prints it to the kernel console
+ * and restores the interrupt level saved by log_begin().
  */
 void log_end(void)
 {
+	log_ring_t *ring = log_ring_local();
+	size_t start = ring->head;
+	size_t len = ring->current_len;
+
 	/* Set the length in the header to correct value */
-	log_copy_to((uint8_t *) &log_current_len, log_current_start, sizeof(size_t));
-	log_used += log_current_len;
+	log_copy_to(ring, (uint8_t *) &len, start, sizeof(size_t));
+	__atomic_store_n(&ring->head, start + len, __ATOMIC_RELEASE);
 
+	/* Print the whole entry at once so that processors do not interleave */
+	spinlock_lock(&kio_lock);
+	log_kio_push(ring, start + LOG_ENTRY_HEADER_LENGTH,
+	    len - LOG_ENTRY_HEADER_LENGTH);
 	kio_push_char('\n');
 	spinlock_unlock(&kio_lock);
-	spinlock_unlock(&log_lock);
 
-	/* This has to be called after we released the locks above */
+	interrupts_restore(ring->ipl);
+
 	kio_flush();
 	kio_update(NULL);
-	log_update(NULL);
+	log_notify(len);
 }
 
 static void log_update(void *event)
@@ -192,25 +428,17 @@ static void log_update(void *event)
 	if (!atomic_get(&log_inited))
 		return;
 
-	spinlock_lock(&log_lock);
-	if (next_for_uspace < log_used)
+	if (log_unread()) {
+		__atomic_store_n(&log_pending, 0, __ATOMIC_RELAXED);
 		event_notify_0(EVENT_KLOG, true);
-	spinlock_unlock(&log_lock);
+	}
 }
 
 static int log_printf_str_write(const char *str, size_t size, void *data)
 {
-	size_t offset = 0;
-	size_t chars = 0;
-
-	while (offset < size) {
-		kio_push_char(str_decode(str, &offset, size));
-		chars++;
-	}
+	log_append(log_ring_local(), (const uint8_t *) str, size);
 
-	log_append((const uint8_t *)str, size);
-
-	return chars;
+	return str_nlength(str, size);
 }
 
 static int log_printf_wstr_write(const wchar_t *wstr, size_t size, void *data)
@@ -220,15 +448,14 @@ static int log_printf_wstr_write(const wchar_t *wstr, size_t size, void *data)
 	size_t chars = 0;
 
 	for (offset = 0; offset < size; offset += sizeof(wchar_t), chars++) {
-		kio_push_char(wstr[chars]);
-
 		size_t buffer_offset = 0;
 		errno_t rc = chr_encode(wstr[chars], buffer, &buffer_offset, 16);
 		if (rc != EOK) {
 			return EOF;
 		}
 
-		log_append((const uint8_t *)buffer, buffer_offset);
+		log_append(log_ring_local(), (const uint8_t *) buffer,
+		    buffer_offset);
 	}
 
 	return chars;
@@ -329,16 +556,38 @@ sys_errno_t sys_klog(sysarg_t operation, void *buf, size_t size,
 		if (!data)
 			return (sys_errno_t) ENOMEM;
 
-		size_t entry_len = 0;
 		size_t copied = 0;
 
 		rc = EOK;
 
-		spinlock_lock(&log_lock);
+		spinlock_lock(&log_read_lock);
+
+		while (true) {
+			/* Merge the entries of all processors by serial number */
+			log_ring_t *oldest = NULL;
+			size_t entry_len = 0;
+			uint32_t oldest_serial = 0;
 
-		while (next_for_uspace < log_used) {
-			size_t pos = (log_start + next_for_uspace) % LOG_LENGTH;
-			log_copy_from((uint8_t *) &entry_len, pos, sizeof(size_t));
+			for (size_t i = 0; i < log_ring_count(); i++) {
+				log_ring_t *ring = log_ring_get(i);
+				size_t len;
+				uint32_t serial;
+
+				if (!log_peek(ring, &len, &serial))
+					continue;
+
+				if ((oldest == NULL) ||
+				    ((int32_t) (serial - oldest_serial) < 0)) {
+					oldest = ring;
+					entry_len = len;
+					oldest_serial = serial;
+				}
+			}
+
+			if (oldest == NULL)
+				break;
+
+			size_t pos = oldest->next_for_uspace;
 
 			if (entry_len > PAGE_SIZE) {
 				/*
@@ -349,7 +598,7 @@ sys_errno_t sys_klog(sysarg_t operation, void *buf, size_t size,
 				 * userspace being stuck trying to
 				 * read them.
 				 */
-				next_for_uspace += entry_len;
+				oldest->next_for_uspace += entry_len;
 				continue;
 			}
 
@@ -359,12 +608,18 @@ sys_errno_t sys_klog(sysarg_t operation, void *buf, size_t size,
 				break;
 			}
 
-			log_copy_from((uint8_t *) (data + copied), pos, entry_len);
+			log_copy_from(oldest, (uint8_t *) (data + copied), pos,
+			    entry_len);
+
+			/* Drop the entry if it was overwritten while copying */
+			if (!log_intact(oldest, pos))
+				continue;
+
 			copied += entry_len;
-			next_for_uspace += entry_len;
+			oldest->next_for_uspace = pos + entry_len;
 		}
 
-		spinlock_unlock(&log_lock);
+		spinlock_unlock(&log_read_lock);
 
 		if (rc != EOK) {
 			free(data);
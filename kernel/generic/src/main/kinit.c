@@ -58,6 +58,8 @@
 #include <mm/as.h>
 #include <mm/frame.h>
 #include <mm/km.h>
+#include <mm/pressure.h>
+#include <mm/merge.h>
 #include <print.h>
 #include <log.h>
 #include <mem.h>
@@ -66,6 +68,7 @@
 #include <console/kconsole.h>
 #include <security/perm.h>
 #include <lib/rd.h>
+#include <lib/elf.h>
 #include <ipc/ipc.h>
 #include <str.h>
 #include <sysinfo/stats.h>
@@ -90,6 +93,223 @@ static char alive[ALIVE_CHARS] = "-\\|/";
 #define INIT_PREFIX      "init:"
 #define INIT_PREFIX_LEN  5
 
+/** Boot argument listing init tasks to be loaded last */
+#define INIT_DEFER       "init.defer="
+#define INIT_DEFER_LEN   11
+
+/** Programs created from the init task images */
+static program_t init_programs[CONFIG_INIT_TASKS];
+
+/** Check whether an init task image is an ELF image
+ *
+ * @param i Index of the frame aligned init task image.
+ *
+ * @return True if the image starts with the ELF magic.
+ *
+ */
+static bool init_is_elf(size_t i)
+{
+	if (init.tasks[i].size < sizeof(elf_header_t))
+		return false;
+
+	uintptr_t page = km_map(init.tasks[i].paddr, FRAME_SIZE,
+	    PAGE_READ | PAGE_CACHEABLE);
+	assert(page);
+
+	elf_header_t *header = (elf_header_t *) page;
+	bool elf = (header->e_ident[EI_MAG0] == ELFMAG0) &&
+	    (header->e_ident[EI_MAG1] == ELFMAG1) &&
+	    (header->e_ident[EI_MAG2] == ELFMAG2) &&
+	    (header->e_ident[EI_MAG3] == ELFMAG3);
+
+	km_unmap(page, FRAME_SIZE);
+	return elf;
+}
+
+/** Check whether an init task image is the program loader
+ *
+ * @param i Index of the init task image.
+ *
+ * @return True if the image is named "loader".
+ *
+ */
+static bool init_is_loader(size_t i)
+{
+	return (str_cmp(init.tasks[i].name, "loader") == 0);
+}
+
+/** Check whether an init task is to be loaded last
+ *
+ * The init tasks listed in the init.defer=name[,name...] boot argument
+ * are created only after all other init tasks are running. The program
+ * loader is registered before any task runs and is never deferred.
+ *
+ * @param name Name of the init task.
+ *
+ * @return True if the init task is deferred.
+ *
+ */
+static bool init_deferred(const char *name)
+{
+	size_t len = str_size(name);
+	if (len == 0)
+		return false;
+
+	const char *arg = bargs;
+	while (*arg != 0) {
+		/* Find the start of the next boot argument */
+		while (*arg == ' ')
+			arg++;
+
+		const char *end = arg;
+		while ((*end != 0) && (*end != ' '))
+			end++;
+
+		if (str_lcmp(arg, INIT_DEFER, INIT_DEFER_LEN) == 0) {
+			const char *item = arg + INIT_DEFER_LEN;
+			while (item < end) {
+				const char *next = item;
+				while ((next < end) && (*next != ','))
+					next++;
+
+				if (((size_t) (next - item) == len) &&
+				    (memcmp(item, name, len) == 0))
+					return true;
+
+				item = next + 1;
+			}
+		}
+
+		arg = end;
+	}
+
+	return false;
+}
+
+/** Create a program from an init task image
+ *
+ * On success, the task is stored in init_programs[i] and it is up to
+ * the caller to make it ready.
+ *
+ * @param i    Index of the init task image.
+ * @param last Whether this is the last image, which is taken for
+ *             the RAM disk if it is not a program.
+ *
+ */
+static void init_load(size_t i, bool last)
+{
+	program_t *program = &init_programs[i];
+	program->task = NULL;
+
+	if (init.tasks[i].paddr % FRAME_SIZE) {
+		log(LF_OTHER, LVL_ERROR,
+		    "init[%zu]: Address is not frame aligned", i);
+		return;
+	}
+
+	/*
+	 * Construct task name from the 'init:' prefix and the
+	 * name stored in the init structure (if any).
+	 */
+
+	char namebuf[TASK_NAME_BUFLEN];
+
+	const char *name = init.tasks[i].name;
+	if (name[0] == 0)
+		name = "<unknown>";
+
+	static_assert(TASK_NAME_BUFLEN >= INIT_PREFIX_LEN, "");
+	str_cpy(namebuf, TASK_NAME_BUFLEN, INIT_PREFIX);
+	str_cpy(namebuf + INIT_PREFIX_LEN,
+	    TASK_NAME_BUFLEN - INIT_PREFIX_LEN, name);
+
+	/*
+	 * Create virtual memory mappings for init task images.
+	 */
+	uintptr_t page = km_map(init.tasks[i].paddr,
+	    init.tasks[i].size,
+	    PAGE_READ | PAGE_WRITE | PAGE_CACHEABLE);
+	assert(page);
+
+	if (str_cmp(name, "loader") == 0) {
+		/* Register image as the program loader */
+		if (program_loader == NULL) {
+			program_loader = (void *) page;
+			log(LF_OTHER, LVL_NOTE, "Program loader at %p",
+			    program_loader);
+		} else {
+			log(LF_OTHER, LVL_ERROR,
+			    "init[%zu]: Second binary named \"loader\""
+			    " present.", i);
+		}
+
+		return;
+	}
+
+	errno_t rc = program_create_from_image((void *) page, namebuf,
+	    program);
+
+	if (rc == 0) {
+		assert(program->task != NULL);
+
+		/*
+		 * Set permissions to init userspace tasks.
+		 */
+		perm_set(program->task,
+		    PERM_PERM | PERM_MEM_MANAGER |
+		    PERM_IO_MANAGER | PERM_IRQ_REG);
+
+		if (!ipc_box_0) {
+			ipc_box_0 = &program->task->answerbox;
+			/*
+			 * Hold the first task so that
+			 * ipc_box_0 remains a valid pointer
+			 * even if the first task exits for
+			 * whatever reason.
+			 */
+			task_hold(program->task);
+		}
+	} else if (last) {
+		/*
+		 * Assume the last task is the RAM disk.
+		 */
+		init_rd((void *) init.tasks[i].paddr, init.tasks[i].size);
+	} else {
+		log(LF_OTHER, LVL_ERROR,
+		    "init[%zu]: Init binary load failed "
+		    "(error %s, loader status %u)", i,
+		    str_error_name(rc), program->loader_status);
+	}
+}
+
+/** Deferred init task loading thread.
+ *
+ * Creates and runs the init tasks deferred by the init.defer boot
+ * argument while the other init tasks are already running.
+ *
+ * @param arg Index of the image which may still be the RAM disk
+ *            (init.cnt if it has been registered already).
+ *
+ */
+static void kinitdefer(void *arg)
+{
+	size_t rd = (size_t) arg;
+
+	thread_detach(THREAD);
+
+	for (size_t i = 1; i < init.cnt; i++) {
+		if ((i == init.cnt - 1) && (rd == init.cnt))
+			break;
+
+		if ((init_is_loader(i)) || (!init_deferred(init.tasks[i].name)))
+			continue;
+
+		init_load(i, i == rd);
+		if (init_programs[i].task != NULL)
+			program_ready(&init_programs[i]);
+	}
+}
+
 /** Kernel initialization thread.
  *
  * kinit takes care of higher level kernel
@@ -169,6 +389,28 @@ void kinit(void *arg)
 	else
 		log(LF_OTHER, LVL_ERROR, "Unable to create kload thread");
 
+	/* Start thread notifying tasks about memory pressure */
+	mem_pressure_init();
+	thread = thread_create(kmempressure, NULL, TASK, THREAD_FLAG_NONE,
+	    "kmempressure");
+	if (thread != NULL)
+		thread_ready(thread);
+	else
+		log(LF_OTHER, LVL_ERROR,
+		    "Unable to create kmempressure thread");
+
+#ifdef CONFIG_PAGE_MERGE
+	/* Start thread merging identical anonymous pages */
+	page_merge_init();
+	thread = thread_create(kpagemerge, NULL, TASK, THREAD_FLAG_NONE,
+	    "kpagemerge");
+	if (thread != NULL)
+		thread_ready(thread);
+	else
+		log(LF_OTHER, LVL_ERROR,
+		    "Unable to create kpagemerge thread");
+#endif /* CONFIG_PAGE_MERGE */
+
 #ifdef CONFIG_KCONSOLE
 	if (stdin) {
 		/*
@@ -196,7 +438,6 @@ void kinit(void *arg)
 	 * Create user tasks, load RAM disk images.
 	 */
 	size_t i;
-	program_t programs[CONFIG_INIT_TASKS];
 
 	// FIXME: do not propagate arguments through sysinfo
 	// but pass them directly to the tasks
@@ -220,97 +461,59 @@ void kinit(void *arg)
 		sysinfo_set_item_data(item_name, NULL, arguments_copy, arguments_size);
 	}
 
-	for (i = 0; i < init.cnt; i++) {
-		if (init.tasks[i].paddr % FRAME_SIZE) {
-			log(LF_OTHER, LVL_ERROR,
-			    "init[%zu]: Address is not frame aligned", i);
-			programs[i].task = NULL;
-			continue;
-		}
-
-		/*
-		 * Construct task name from the 'init:' prefix and the
-		 * name stored in the init structure (if any).
-		 */
-
-		char namebuf[TASK_NAME_BUFLEN];
+	/*
+	 * Register the RAM disk before any task runs so that it is
+	 * available to the servers as soon as they ask for it.
+	 */
+	size_t cnt = init.cnt;
+	size_t rd = cnt;
+	if ((cnt > 0) && (init.tasks[cnt - 1].paddr % FRAME_SIZE == 0) &&
+	    (!init_is_elf(cnt - 1))) {
+		cnt--;
+		init_rd((void *) init.tasks[cnt].paddr, init.tasks[cnt].size);
+	} else if (cnt > 0) {
+		rd = cnt - 1;
+	}
 
-		const char *name = init.tasks[i].name;
-		if (name[0] == 0)
-			name = "<unknown>";
+	/*
+	 * Register the program loader before any task runs, the naming
+	 * service spawns loaders as soon as it starts.
+	 */
+	for (i = 0; i < cnt; i++) {
+		if (init_is_loader(i))
+			init_load(i, false);
+	}
 
-		static_assert(TASK_NAME_BUFLEN >= INIT_PREFIX_LEN, "");
-		str_cpy(namebuf, TASK_NAME_BUFLEN, INIT_PREFIX);
-		str_cpy(namebuf + INIT_PREFIX_LEN,
-		    TASK_NAME_BUFLEN - INIT_PREFIX_LEN, name);
+	/*
+	 * Create and run user tasks one by one so that the first servers
+	 * start while the following images are still being loaded.
+	 * The first task (the naming service) is never deferred.
+	 */
+	bool deferred = false;
 
-		/*
-		 * Create virtual memory mappings for init task images.
-		 */
-		uintptr_t page = km_map(init.tasks[i].paddr,
-		    init.tasks[i].size,
-		    PAGE_READ | PAGE_WRITE | PAGE_CACHEABLE);
-		assert(page);
-
-		if (str_cmp(name, "loader") == 0) {
-			/* Register image as the program loader */
-			if (program_loader == NULL) {
-				program_loader = (void *) page;
-				log(LF_OTHER, LVL_NOTE, "Program loader at %p",
-				    program_loader);
-			} else {
-				log(LF_OTHER, LVL_ERROR,
-				    "init[%zu]: Second binary named \"loader\""
-				    " present.", i);
-			}
+	for (i = 0; i < cnt; i++) {
+		if (init_is_loader(i))
+			continue;
 
-			programs[i].task = NULL;
+		if ((i > 0) && (init_deferred(init.tasks[i].name))) {
+			init_programs[i].task = NULL;
+			deferred = true;
 			continue;
 		}
 
-		errno_t rc = program_create_from_image((void *) page, namebuf,
-		    &programs[i]);
-
-		if (rc == 0) {
-			assert(programs[i].task != NULL);
-
-			/*
-			 * Set permissions to init userspace tasks.
-			 */
-			perm_set(programs[i].task,
-			    PERM_PERM | PERM_MEM_MANAGER |
-			    PERM_IO_MANAGER | PERM_IRQ_REG);
-
-			if (!ipc_box_0) {
-				ipc_box_0 = &programs[i].task->answerbox;
-				/*
-				 * Hold the first task so that
-				 * ipc_box_0 remains a valid pointer
-				 * even if the first task exits for
-				 * whatever reason.
-				 */
-				task_hold(programs[i].task);
-			}
-
-		} else if (i == init.cnt - 1) {
-			/*
-			 * Assume the last task is the RAM disk.
-			 */
-			init_rd((void *) init.tasks[i].paddr, init.tasks[i].size);
-		} else {
-			log(LF_OTHER, LVL_ERROR,
-			    "init[%zu]: Init binary load failed "
-			    "(error %s, loader status %u)", i,
-			    str_error_name(rc), programs[i].loader_status);
-		}
+		init_load(i, i == rd);
+		if (init_programs[i].task != NULL)
+			program_ready(&init_programs[i]);
 	}
 
-	/*
-	 * Run user tasks.
-	 */
-	for (i = 0; i < init.cnt; i++) {
-		if (programs[i].task != NULL)
-			program_ready(&programs[i]);
+	if (deferred) {
+		thread = thread_create(kinitdefer, (void *) rd, TASK,
+		    THREAD_FLAG_NONE, "kinitdefer");
+		if (thread != NULL)
+			thread_ready(thread);
+		else
+			log(LF_OTHER, LVL_ERROR,
+			    "Unable to create kinitdefer thread");
 	}
 
 #ifdef CONFIG_KCONSOLE
@@ -63,6 +63,7 @@
 #include <console/kconsole.h>
 #include <console/console.h>
 #include <log.h>
+#include <ktrace.h>
 #include <cpu.h>
 #include <align.h>
 #include <interrupt.h>
@@ -263,6 +264,7 @@ void main_bsp_separated_stack(void)
 
 	/* Slab must be initialized after we know the number of processors. */
 	slab_enable_cpucache();
+	ra_enable_cpucache();
 
 	uint64_t size;
 	const char *size_suffix;
@@ -298,6 +300,7 @@ void main_bsp_separated_stack(void)
 	event_init();
 	kio_init();
 	log_init();
+	ktrace_init();
 	stats_init();
 
 	/*
@@ -52,6 +52,7 @@
 #include <mm/frame.h>
 #include <mm/slab.h>
 #include <mm/tlb.h>
+#include <mm/merge.h>
 #include <arch/mm/page.h>
 #include <genarch/mm/page_pt.h>
 #include <genarch/mm/page_ht.h>
@@ -62,6 +63,7 @@
 #include <synch/mutex.h>
 #include <adt/list.h>
 #include <adt/btree.h>
+#include <adt/odict.h>
 #include <proc/task.h>
 #include <proc/thread.h>
 #include <arch/asm.h>
@@ -73,12 +75,14 @@
 #include <bitops.h>
 #include <arch.h>
 #include <errno.h>
+#include <cpu/cpu_mask.h>
 #include <config.h>
 #include <align.h>
 #include <typedefs.h>
 #include <syscall/copy.h>
 #include <arch/interrupt.h>
 #include <interrupt.h>
+#include <ktrace.h>
 
 /**
  * Each architecture decides what functions will be used to carry out
@@ -91,6 +95,11 @@ as_operations_t *as_operations = NULL;
  */
 static slab_cache_t *as_cache;
 
+/** Slab for used_space_ival_t objects.
+ *
+ */
+static slab_cache_t *used_space_ival_cache;
+
 /** ASID subsystem lock.
  *
  * This lock protects:
@@ -125,6 +134,37 @@ NO_TRACE static size_t as_destructor(void *obj)
 	return as_destructor_arch((as_t *) obj);
 }
 
+static void used_space_finalize(as_area_t *);
+
+/** Get key of an address space area in as_t.as_areas. */
+static void *as_areas_getkey(odlink_t *odlink)
+{
+	as_area_t *area = odict_get_instance(odlink, as_area_t, las_areas);
+	return &area->base;
+}
+
+/** Get key of a used space interval in as_area_t.used_space. */
+static void *used_space_getkey(odlink_t *odlink)
+{
+	used_space_ival_t *ival = odict_get_instance(odlink,
+	    used_space_ival_t, lused_space);
+	return &ival->page;
+}
+
+/** Compare two virtual addresses used as keys. */
+static int addr_cmp(void *a, void *b)
+{
+	uintptr_t addr_a = *(uintptr_t *) a;
+	uintptr_t addr_b = *(uintptr_t *) b;
+
+	if (addr_a < addr_b)
+		return -1;
+	else if (addr_a == addr_b)
+		return 0;
+	else
+		return 1;
+}
+
 /** Initialize address space subsystem. */
 void as_init(void)
 {
@@ -133,6 +173,9 @@ void as_init(void)
 	as_cache = slab_cache_create("as_t", sizeof(as_t), 0,
 	    as_constructor, as_destructor, SLAB_CACHE_MAGDEFERRED);
 
+	used_space_ival_cache = slab_cache_create("used_space_ival_t",
+	    sizeof(used_space_ival_t), 0, NULL, NULL, SLAB_CACHE_MAGDEFERRED);
+
 	AS_KERNEL = as_create(FLAG_AS_KERNEL);
 	if (!AS_KERNEL)
 		panic("Cannot create kernel address space.");
@@ -155,7 +198,7 @@ as_t *as_create(unsigned int flags)
 	as_t *as = (as_t *) slab_alloc(as_cache, 0);
 	(void) as_create_arch(as, 0);
 
-	btree_create(&as->as_area_btree);
+	odict_initialize(&as->as_areas, as_areas_getkey, addr_cmp);
 
 	if (flags & FLAG_AS_KERNEL)
 		as->asid = ASID_KERNEL;
@@ -165,6 +208,13 @@ as_t *as_create(unsigned int flags)
 	atomic_set(&as->refcount, 0);
 	as->cpu_refcount = 0;
 
+	if (flags & FLAG_AS_KERNEL) {
+		as->cpu_mask = NULL;
+	} else {
+		as->cpu_mask = nfmalloc(cpu_mask_size());
+		cpu_mask_none(as->cpu_mask);
+	}
+
 #ifdef AS_PAGE_TABLE
 	as->genarch.page_table = page_table_create(flags);
 #else
@@ -230,22 +280,12 @@ retry:
 
 	/*
 	 * Destroy address space areas of the address space.
-	 * The B+tree must be walked carefully because it is
-	 * also being destroyed.
 	 */
-	bool cond = true;
-	while (cond) {
-		assert(!list_empty(&as->as_area_btree.leaf_list));
+	as_area_t *area;
+	while ((area = as_area_first(as)) != NULL)
+		as_area_destroy(as, area->base);
 
-		btree_node_t *node =
-		    list_get_instance(list_first(&as->as_area_btree.leaf_list),
-		    btree_node_t, leaf_link);
-
-		if ((cond = node->keys))
-			as_area_destroy(as, node->key[0]);
-	}
-
-	btree_destroy(&as->as_area_btree);
+	assert(odict_empty(&as->as_areas));
 
 #ifdef AS_PAGE_TABLE
 	page_table_destroy(as->genarch.page_table);
@@ -253,6 +293,9 @@ retry:
 	page_table_destroy(NULL);
 #endif
 
+	if (as->cpu_mask)
+		free(as->cpu_mask);
+
 	slab_free(as_cache, as);
 }
 
@@ -314,25 +357,15 @@ NO_TRACE static bool check_area_conflicts(as_t *as, uintptr_t addr,
 		return false;
 
 	/*
-	 * The leaf node is found in O(log n), where n is proportional to
-	 * the number of address space areas belonging to as.
-	 * The check for conflicts is then attempted on the rightmost
-	 * record in the left neighbour, the leftmost record in the right
-	 * neighbour and all records in the leaf node itself.
+	 * The areas do not overlap each other, so only the nearest area
+	 * below addr and the nearest area at or above addr can possibly
+	 * conflict. Both are found in O(log n), where n is the number of
+	 * address space areas belonging to as.
 	 */
-	btree_node_t *leaf;
-	as_area_t *area =
-	    (as_area_t *) btree_search(&as->as_area_btree, addr, &leaf);
-	if (area) {
-		if (area != avoid)
-			return false;
-	}
-
-	/* First, check the two border cases. */
-	btree_node_t *node =
-	    btree_leaf_node_left_neighbour(&as->as_area_btree, leaf);
-	if (node) {
-		area = (as_area_t *) node->value[node->keys - 1];
+	odlink_t *odlink = odict_find_lt(&as->as_areas, &addr, NULL);
+	if (odlink) {
+		as_area_t *area = odict_get_instance(odlink, as_area_t,
+		    las_areas);
 
 		if (area != avoid) {
 			mutex_lock(&area->lock);
@@ -343,15 +376,11 @@ NO_TRACE static bool check_area_conflicts(as_t *as, uintptr_t addr,
 			 * that they are separated by at least one unmapped
 			 * page.
 			 */
-			int const gp = (guarded ||
+			int gp = (guarded ||
 			    (area->flags & AS_AREA_GUARD)) ? 1 : 0;
+			if (gp && overflows(area->base, P2SZ(area->pages)))
+				gp--;
 
-			/*
-			 * The area comes from the left neighbour node, which
-			 * means that there already are some areas in the leaf
-			 * node, which in turn means that adding gp is safe and
-			 * will not cause an integer overflow.
-			 */
 			if (overlaps(addr, P2SZ(count), area->base,
 			    P2SZ(area->pages + gp))) {
 				mutex_unlock(&area->lock);
@@ -362,61 +391,30 @@ NO_TRACE static bool check_area_conflicts(as_t *as, uintptr_t addr,
 		}
 	}
 
-	node = btree_leaf_node_right_neighbour(&as->as_area_btree, leaf);
-	if (node) {
-		area = (as_area_t *) node->value[0];
+	odlink = odict_find_geq(&as->as_areas, &addr, NULL);
+	if ((odlink) && (odict_get_instance(odlink, as_area_t,
+	    las_areas) == avoid))
+		odlink = odict_next(odlink, &as->as_areas);
 
-		if (area != avoid) {
-			int gp;
-
-			mutex_lock(&area->lock);
-
-			gp = (guarded || (area->flags & AS_AREA_GUARD)) ? 1 : 0;
-			if (gp && overflows(addr, P2SZ(count))) {
-				/*
-				 * Guard page not needed if the supposed area
-				 * is adjacent to the end of the address space.
-				 * We already know that the following test is
-				 * going to fail...
-				 */
-				gp--;
-			}
-
-			if (overlaps(addr, P2SZ(count + gp), area->base,
-			    P2SZ(area->pages))) {
-				mutex_unlock(&area->lock);
-				return false;
-			}
-
-			mutex_unlock(&area->lock);
-		}
-	}
-
-	/* Second, check the leaf node. */
-	btree_key_t i;
-	for (i = 0; i < leaf->keys; i++) {
-		area = (as_area_t *) leaf->value[i];
-		int agp;
-		int gp;
-
-		if (area == avoid)
-			continue;
+	if (odlink) {
+		as_area_t *area = odict_get_instance(odlink, as_area_t,
+		    las_areas);
 
 		mutex_lock(&area->lock);
 
-		gp = (guarded || (area->flags & AS_AREA_GUARD)) ? 1 : 0;
-		agp = gp;
-
-		/*
-		 * Sanitize the two possible unsigned integer overflows.
-		 */
-		if (gp && overflows(addr, P2SZ(count)))
+		int gp = (guarded || (area->flags & AS_AREA_GUARD)) ? 1 : 0;
+		if (gp && overflows(addr, P2SZ(count))) {
+			/*
+			 * Guard page not needed if the supposed area
+			 * is adjacent to the end of the address space.
+			 * We already know that the following test is
+			 * going to fail...
+			 */
 			gp--;
-		if (agp && overflows(area->base, P2SZ(area->pages)))
-			agp--;
+		}
 
 		if (overlaps(addr, P2SZ(count + gp), area->base,
-		    P2SZ(area->pages + agp))) {
+		    P2SZ(area->pages))) {
 			mutex_unlock(&area->lock);
 			return false;
 		}
@@ -487,34 +485,37 @@ NO_TRACE static uintptr_t as_get_unmapped_area(as_t *as, uintptr_t bound,
 			return addr;
 	}
 
-	/* Eventually check the addresses behind each area */
-	list_foreach(as->as_area_btree.leaf_list, leaf_link, btree_node_t, node) {
-
-		for (btree_key_t i = 0; i < node->keys; i++) {
-			as_area_t *area = (as_area_t *) node->value[i];
+	/*
+	 * Eventually check the addresses behind each area. Areas which lie
+	 * entirely below the area containing or preceding the bound cannot
+	 * yield an address above the bound and are skipped.
+	 */
+	odlink_t *odlink = odict_find_leq(&as->as_areas, &bound, NULL);
+	as_area_t *area = (odlink != NULL) ?
+	    odict_get_instance(odlink, as_area_t, las_areas) :
+	    as_area_first(as);
 
-			mutex_lock(&area->lock);
+	for (; area != NULL; area = as_area_next(area)) {
+		mutex_lock(&area->lock);
 
-			addr =
-			    ALIGN_UP(area->base + P2SZ(area->pages), PAGE_SIZE);
+		addr = ALIGN_UP(area->base + P2SZ(area->pages), PAGE_SIZE);
 
-			if (guarded || area->flags & AS_AREA_GUARD) {
-				/*
-				 * We must leave an unmapped page
-				 * between the two areas.
-				 */
-				addr += P2SZ(1);
-			}
+		if (guarded || area->flags & AS_AREA_GUARD) {
+			/*
+			 * We must leave an unmapped page
+			 * between the two areas.
+			 */
+			addr += P2SZ(1);
+		}
 
-			bool avail =
-			    ((addr >= bound) && (addr >= area->base) &&
-			    (check_area_conflicts(as, addr, pages, guarded, area)));
+		bool avail =
+		    ((addr >= bound) && (addr >= area->base) &&
+		    (check_area_conflicts(as, addr, pages, guarded, area)));
 
-			mutex_unlock(&area->lock);
+		mutex_unlock(&area->lock);
 
-			if (avail)
-				return addr;
-		}
+		if (avail)
+			return addr;
 	}
 
 	/* No suitable address space area found */
@@ -564,6 +565,55 @@ NO_TRACE static void sh_info_remove_reference(share_info_t *sh_info)
 }
 
 
+/** Map all pages of a newly created address space area.
+ *
+ * The pages are faulted in by the backend one after another
+ * so that the task does not take a trap on the first access to each
+ * of them. Population stops silently at the first page the backend
+ * refuses to map, the rest of the area is then faulted in on demand.
+ *
+ * @param area Address space area in the current address space.
+ *
+ */
+NO_TRACE static void as_area_populate(as_area_t *area)
+{
+	assert(mutex_locked(&AS->lock));
+
+	if ((!area->backend) || (!area->backend->page_fault))
+		return;
+
+	pf_access_t access;
+	if (area->flags & AS_AREA_WRITE)
+		access = PF_ACCESS_WRITE;
+	else if (area->flags & AS_AREA_READ)
+		access = PF_ACCESS_READ;
+	else if (area->flags & AS_AREA_EXEC)
+		access = PF_ACCESS_EXEC;
+	else
+		return;
+
+	mutex_lock(&area->lock);
+	page_table_lock(AS, false);
+
+	for (size_t i = 0; i < area->pages; i++) {
+		uintptr_t page = area->base + P2SZ(i);
+		pte_t pte;
+
+		/* The backend may have mapped more than a single page. */
+		if (page_mapping_find(AS, page, false, &pte) &&
+		    PTE_PRESENT(&pte))
+			continue;
+
+		if (area->backend->page_fault(area, page, access) != AS_PF_OK)
+			break;
+
+		TASK->pages_prefaulted++;
+	}
+
+	page_table_unlock(AS, false);
+	mutex_unlock(&area->lock);
+}
+
 /** Create address space area of common attributes.
  *
  * The created address space area is added to the target address space.
@@ -686,15 +736,59 @@ as_area_t *as_area_create(as_t *as, unsigned int flags, size_t size,
 		}
 	}
 
-	btree_create(&area->used_space);
-	btree_insert(&as->as_area_btree, *base, (void *) area,
-	    NULL);
+	odict_initialize(&area->used_space, used_space_getkey, addr_cmp);
+	odlink_initialize(&area->las_areas);
+	odict_insert(&area->las_areas, &as->as_areas, NULL);
+
+	/*
+	 * Backends service page faults only in the current address space,
+	 * areas created elsewhere are populated on demand as usual.
+	 */
+	if ((flags & AS_AREA_POPULATE) && (as == AS) &&
+	    !(attrs & AS_AREA_ATTR_PARTIAL))
+		as_area_populate(area);
 
 	mutex_unlock(&as->lock);
 
 	return area;
 }
 
+/** Return the first address space area of an address space.
+ *
+ * The address space must be already locked.
+ *
+ * @param as Address space.
+ *
+ * @return Area with the lowest base address or NULL if there is none.
+ *
+ */
+as_area_t *as_area_first(as_t *as)
+{
+	odlink_t *odlink = odict_first(&as->as_areas);
+	if (!odlink)
+		return NULL;
+
+	return odict_get_instance(odlink, as_area_t, las_areas);
+}
+
+/** Return the next address space area of an address space.
+ *
+ * The address space must be already locked.
+ *
+ * @param cur Current address space area.
+ *
+ * @return Area following cur or NULL if cur is the last one.
+ *
+ */
+as_area_t *as_area_next(as_area_t *cur)
+{
+	odlink_t *odlink = odict_next(&cur->las_areas, &cur->as->as_areas);
+	if (!odlink)
+		return NULL;
+
+	return odict_get_instance(odlink, as_area_t, las_areas);
+}
+
 /** Find address space area and lock it.
  *
  * @param as Address space.
@@ -708,52 +802,22 @@ NO_TRACE static as_area_t *find_area_and_lock(as_t *as, uintptr_t va)
 {
 	assert(mutex_locked(&as->lock));
 
-	btree_node_t *leaf;
-	as_area_t *area = (as_area_t *) btree_search(&as->as_area_btree, va,
-	    &leaf);
-	if (area) {
-		/* va is the base address of an address space area */
-		mutex_lock(&area->lock);
-		return area;
-	}
-
 	/*
-	 * Search the leaf node and the rightmost record of its left neighbour
-	 * to find out whether this is a miss or va belongs to an address
-	 * space area found there.
+	 * Only the area with the highest base address not above va
+	 * can contain va.
 	 */
+	odlink_t *odlink = odict_find_leq(&as->as_areas, &va, NULL);
+	if (!odlink)
+		return NULL;
 
-	/* First, search the leaf node itself. */
-	btree_key_t i;
-
-	for (i = 0; i < leaf->keys; i++) {
-		area = (as_area_t *) leaf->value[i];
-
-		mutex_lock(&area->lock);
-
-		if ((area->base <= va) &&
-		    (va <= area->base + (P2SZ(area->pages) - 1)))
-			return area;
-
-		mutex_unlock(&area->lock);
-	}
-
-	/*
-	 * Second, locate the left neighbour and test its last record.
-	 * Because of its position in the B+tree, it must have base < va.
-	 */
-	btree_node_t *lnode = btree_leaf_node_left_neighbour(&as->as_area_btree,
-	    leaf);
-	if (lnode) {
-		area = (as_area_t *) lnode->value[lnode->keys - 1];
+	as_area_t *area = odict_get_instance(odlink, as_area_t, las_areas);
 
-		mutex_lock(&area->lock);
+	mutex_lock(&area->lock);
 
-		if (va <= area->base + (P2SZ(area->pages) - 1))
-			return area;
+	if (va <= area->base + (P2SZ(area->pages) - 1))
+		return area;
 
-		mutex_unlock(&area->lock);
-	}
+	mutex_unlock(&area->lock);
 
 	return NULL;
 }
@@ -828,25 +892,24 @@ errno_t as_area_resize(as_t *as, uintptr_t address, size_t size, unsigned int fl
 
 		page_table_lock(as, false);
 
+		/*
+		 * A large page straddling the new end of the area needs to
+		 * be split before its upper part can be removed.
+		 */
+		page_mapping_split(as, start_free);
+
 		/*
 		 * Remove frames belonging to used space starting from
 		 * the highest addresses downwards until an overlap with
-		 * the resized address space area is found. Note that this
-		 * is also the right way to remove part of the used_space
-		 * B+tree leaf list.
+		 * the resized address space area is found.
 		 */
 		bool cond = true;
 		while (cond) {
-			assert(!list_empty(&area->used_space.leaf_list));
+			used_space_ival_t *ival = used_space_last(area);
 
-			btree_node_t *node =
-			    list_get_instance(list_last(&area->used_space.leaf_list),
-			    btree_node_t, leaf_link);
-
-			if ((cond = (node->keys != 0))) {
-				uintptr_t ptr = node->key[node->keys - 1];
-				size_t node_size =
-				    (size_t) node->value[node->keys - 1];
+			if ((cond = (ival != NULL))) {
+				uintptr_t ptr = ival->page;
+				size_t node_size = ival->count;
 				size_t i = 0;
 
 				if (overlaps(ptr, P2SZ(node_size), area->base,
@@ -889,13 +952,14 @@ errno_t as_area_resize(as_t *as, uintptr_t address, size_t size, unsigned int fl
 				 * repeated multiple times. The reason is that
 				 * we don't want to have used_space_remove()
 				 * inside the sequence as it may use a blocking
-				 * memory allocation for its B+tree. Blocking
-				 * while holding the tlblock spinlock is
-				 * forbidden and would hit a kernel assertion.
+				 * memory allocation. Blocking while holding
+				 * the tlblock spinlock is forbidden and would
+				 * hit a kernel assertion.
 				 */
 
-				ipl_t ipl = tlb_shootdown_start(TLB_INVL_PAGES,
-				    as->asid, area->base + P2SZ(pages),
+				ipl_t ipl = tlb_shootdown_start(as,
+				    TLB_INVL_PAGES, as->asid,
+				    area->base + P2SZ(pages),
 				    area->pages - pages);
 
 				for (; i < node_size; i++) {
@@ -992,45 +1056,39 @@ errno_t as_area_destroy(as_t *as, uintptr_t address)
 	if (area->backend && area->backend->destroy)
 		area->backend->destroy(area);
 
-	uintptr_t base = area->base;
-
 	page_table_lock(as, false);
 
 	/*
 	 * Start TLB shootdown sequence.
 	 */
-	ipl_t ipl = tlb_shootdown_start(TLB_INVL_PAGES, as->asid, area->base,
-	    area->pages);
+	ipl_t ipl = tlb_shootdown_start(as, TLB_INVL_PAGES, as->asid,
+	    area->base, area->pages);
 
 	/*
-	 * Visit only the pages mapped by used_space B+tree.
+	 * Visit only the pages mapped according to used_space.
 	 */
-	list_foreach(area->used_space.leaf_list, leaf_link, btree_node_t,
-	    node) {
-		btree_key_t i;
-
-		for (i = 0; i < node->keys; i++) {
-			uintptr_t ptr = node->key[i];
-			size_t size;
-
-			for (size = 0; size < (size_t) node->value[i]; size++) {
-				pte_t pte;
-				bool found = page_mapping_find(as,
-				    ptr + P2SZ(size), false, &pte);
-
-				assert(found);
-				assert(PTE_VALID(&pte));
-				assert(PTE_PRESENT(&pte));
-
-				if ((area->backend) &&
-				    (area->backend->frame_free)) {
-					area->backend->frame_free(area,
-					    ptr + P2SZ(size),
-					    PTE_GET_FRAME(&pte));
-				}
-
-				page_mapping_remove(as, ptr + P2SZ(size));
+	for (used_space_ival_t *ival = used_space_first(area);
+	    ival != NULL; ival = used_space_next(area, ival)) {
+		uintptr_t ptr = ival->page;
+		size_t size;
+
+		for (size = 0; size < ival->count; size++) {
+			pte_t pte;
+			bool found = page_mapping_find(as,
+			    ptr + P2SZ(size), false, &pte);
+
+			assert(found);
+			assert(PTE_VALID(&pte));
+			assert(PTE_PRESENT(&pte));
+
+			if ((area->backend) &&
+			    (area->backend->frame_free)) {
+				area->backend->frame_free(area,
+				    ptr + P2SZ(size),
+				    PTE_GET_FRAME(&pte));
 			}
+
+			page_mapping_remove(as, ptr + P2SZ(size));
 		}
 	}
 
@@ -1049,7 +1107,7 @@ errno_t as_area_destroy(as_t *as, uintptr_t address)
 
 	page_table_unlock(as, false);
 
-	btree_destroy(&area->used_space);
+	used_space_finalize(area);
 
 	area->attributes |= AS_AREA_ATTR_PARTIAL;
 
@@ -1060,7 +1118,7 @@ errno_t as_area_destroy(as_t *as, uintptr_t address)
 	/*
 	 * Remove the empty area from address space.
 	 */
-	btree_remove(&as->as_area_btree, base, NULL);
+	odict_remove(&area->las_areas);
 
 	free(area);
 
@@ -1289,17 +1347,9 @@ errno_t as_area_change_flags(as_t *as, unsigned int flags, uintptr_t address)
 	mutex_unlock(&area->sh_info->lock);
 
 	/*
-	 * Compute total number of used pages in the used_space B+tree
+	 * The total number of used pages is the number of resident pages.
 	 */
-	size_t used_pages = 0;
-
-	list_foreach(area->used_space.leaf_list, leaf_link, btree_node_t,
-	    node) {
-		btree_key_t i;
-
-		for (i = 0; i < node->keys; i++)
-			used_pages += (size_t) node->value[i];
-	}
+	size_t used_pages = area->resident;
 
 	/* An array for storing frame numbers */
 	uintptr_t *old_frame = malloc(used_pages * sizeof(uintptr_t));
@@ -1314,8 +1364,8 @@ errno_t as_area_change_flags(as_t *as, unsigned int flags, uintptr_t address)
 	/*
 	 * Start TLB shootdown sequence.
 	 */
-	ipl_t ipl = tlb_shootdown_start(TLB_INVL_PAGES, as->asid, area->base,
-	    area->pages);
+	ipl_t ipl = tlb_shootdown_start(as, TLB_INVL_PAGES, as->asid,
+	    area->base, area->pages);
 
 	/*
 	 * Remove used pages from page tables and remember their frame
@@ -1323,28 +1373,24 @@ errno_t as_area_change_flags(as_t *as, unsigned int flags, uintptr_t address)
 	 */
 	size_t frame_idx = 0;
 
-	list_foreach(area->used_space.leaf_list, leaf_link, btree_node_t,
-	    node) {
-		btree_key_t i;
+	for (used_space_ival_t *ival = used_space_first(area);
+	    ival != NULL; ival = used_space_next(area, ival)) {
+		uintptr_t ptr = ival->page;
+		size_t size;
 
-		for (i = 0; i < node->keys; i++) {
-			uintptr_t ptr = node->key[i];
-			size_t size;
+		for (size = 0; size < ival->count; size++) {
+			pte_t pte;
+			bool found = page_mapping_find(as,
+			    ptr + P2SZ(size), false, &pte);
 
-			for (size = 0; size < (size_t) node->value[i]; size++) {
-				pte_t pte;
-				bool found = page_mapping_find(as,
-				    ptr + P2SZ(size), false, &pte);
+			assert(found);
+			assert(PTE_VALID(&pte));
+			assert(PTE_PRESENT(&pte));
 
-				assert(found);
-				assert(PTE_VALID(&pte));
-				assert(PTE_PRESENT(&pte));
+			old_frame[frame_idx++] = PTE_GET_FRAME(&pte);
 
-				old_frame[frame_idx++] = PTE_GET_FRAME(&pte);
-
-				/* Remove old mapping */
-				page_mapping_remove(as, ptr + P2SZ(size));
-			}
+			/* Remove old mapping */
+			page_mapping_remove(as, ptr + P2SZ(size));
 		}
 	}
 
@@ -1375,23 +1421,26 @@ errno_t as_area_change_flags(as_t *as, unsigned int flags, uintptr_t address)
 	 */
 	frame_idx = 0;
 
-	list_foreach(area->used_space.leaf_list, leaf_link, btree_node_t,
-	    node) {
-		btree_key_t i;
+	for (used_space_ival_t *ival = used_space_first(area);
+	    ival != NULL; ival = used_space_next(area, ival)) {
+		uintptr_t ptr = ival->page;
+		size_t size;
 
-		for (i = 0; i < node->keys; i++) {
-			uintptr_t ptr = node->key[i];
-			size_t size;
+		for (size = 0; size < ival->count; size++) {
+			uintptr_t frame = old_frame[frame_idx++];
+			unsigned int frame_flags = page_flags;
 
-			for (size = 0; size < (size_t) node->value[i]; size++) {
-				page_table_lock(as, false);
+			/* Merged frames stay write-protected. */
+			if (page_merge_frame_merged(frame))
+				frame_flags &= ~PAGE_WRITE;
 
-				/* Insert the new mapping */
-				page_mapping_insert(as, ptr + P2SZ(size),
-				    old_frame[frame_idx++], page_flags);
+			page_table_lock(as, false);
 
-				page_table_unlock(as, false);
-			}
+			/* Insert the new mapping */
+			page_mapping_insert(as, ptr + P2SZ(size), frame,
+			    frame_flags);
+
+			page_table_unlock(as, false);
 		}
 	}
 
@@ -1427,6 +1476,8 @@ int as_page_fault(uintptr_t address, pf_access_t access, istate_t *istate)
 	uintptr_t page = ALIGN_DOWN(address, PAGE_SIZE);
 	int rc = AS_PF_FAULT;
 
+	KTRACE(KTRACE_PAGE_FAULT, address, access);
+
 	if (!THREAD)
 		goto page_fault;
 
@@ -1494,6 +1545,8 @@ int as_page_fault(uintptr_t address, pf_access_t access, istate_t *istate)
 		goto page_fault;
 	}
 
+	TASK->page_faults++;
+
 	page_table_unlock(AS, false);
 	mutex_unlock(&area->lock);
 	mutex_unlock(&AS->lock);
@@ -1588,6 +1641,12 @@ retry:
 			new_as->asid = asid_get();
 	}
 
+	/*
+	 * Catch up with TLB shootdowns delivered to this processor
+	 * lazily and let future senders know about it.
+	 */
+	tlb_shootdown_as_switch(new_as);
+
 #ifdef AS_PAGE_TABLE
 	SET_PTL0_ADDRESS(new_as->genarch.page_table);
 #endif
@@ -1726,293 +1785,168 @@ size_t as_area_get_size(uintptr_t base)
 	return size;
 }
 
-/** Mark portion of address space area as used.
+/** Pin frames backing a range of an anonymous address space area.
  *
- * The address space area must be already locked.
+ * A reference is taken on each frame so that it outlives a subsequent
+ * unmap or destruction of the area. The frames can then be accessed via
+ * the kernel identity mapping without going through the address space.
  *
- * @param area  Address space area.
- * @param page  First page to be marked.
- * @param count Number of page to be marked.
+ * Only fully resident ranges of a single readable anonymous area with
+ * eager reservation are supported, because only for those the frames
+ * can be released without breaking the memory reservation accounting.
  *
- * @return False on failure or true on success.
+ * @param as     Address space.
+ * @param base   Page-aligned virtual address of the range.
+ * @param count  Number of pages.
+ * @param frames Array of at least count entries to receive the physical
+ *               addresses of the frames.
+ *
+ * @return EOK on success.
+ * @return ENOENT if the range is not covered by a single area.
+ * @return ENOTSUP if the area or some of its pages cannot be pinned.
  *
  */
-bool used_space_insert(as_area_t *area, uintptr_t page, size_t count)
+errno_t as_pin_frames(as_t *as, uintptr_t base, size_t count,
+    uintptr_t *frames)
 {
-	assert(mutex_locked(&area->lock));
-	assert(IS_ALIGNED(page, PAGE_SIZE));
-	assert(count);
+	assert(IS_ALIGNED(base, PAGE_SIZE));
 
-	btree_node_t *leaf = NULL;
-	size_t pages = (size_t) btree_search(&area->used_space, page, &leaf);
-	if (pages) {
-		/*
-		 * We hit the beginning of some used space.
-		 */
-		return false;
-	}
+	uintptr_t limit = KA2PA(config.identity_base) + config.identity_size;
 
-	assert(leaf != NULL);
+	mutex_lock(&as->lock);
+	as_area_t *area = find_area_and_lock(as, base);
+	if (!area) {
+		mutex_unlock(&as->lock);
+		return ENOENT;
+	}
 
-	if (!leaf->keys) {
-		btree_insert(&area->used_space, page, (void *) count, leaf);
-		goto success;
+	if ((area->backend != &anon_backend) ||
+	    (area->flags & AS_AREA_LATE_RESERVE) ||
+	    !(area->flags & AS_AREA_READ) ||
+	    (count > area->pages - ((base - area->base) >> PAGE_WIDTH))) {
+		mutex_unlock(&area->lock);
+		mutex_unlock(&as->lock);
+		return ENOTSUP;
 	}
 
-	btree_node_t *node = btree_leaf_node_left_neighbour(&area->used_space, leaf);
-	if (node) {
-		uintptr_t left_pg = node->key[node->keys - 1];
-		uintptr_t right_pg = leaf->key[0];
-		size_t left_cnt = (size_t) node->value[node->keys - 1];
-		size_t right_cnt = (size_t) leaf->value[0];
+	size_t i;
+	page_table_lock(as, false);
+	for (i = 0; i < count; i++) {
+		pte_t pte;
 
-		/*
-		 * Examine the possibility that the interval fits
-		 * somewhere between the rightmost interval of
-		 * the left neigbour and the first interval of the leaf.
-		 */
+		/* Pinned frames can be written, do not pin merged ones. */
+		(void) page_merge_break(as, area, base + P2SZ(i));
 
-		if (page >= right_pg) {
-			/* Do nothing. */
-		} else if (overlaps(page, P2SZ(count), left_pg,
-		    P2SZ(left_cnt))) {
-			/* The interval intersects with the left interval. */
-			return false;
-		} else if (overlaps(page, P2SZ(count), right_pg,
-		    P2SZ(right_cnt))) {
-			/* The interval intersects with the right interval. */
-			return false;
-		} else if ((page == left_pg + P2SZ(left_cnt)) &&
-		    (page + P2SZ(count) == right_pg)) {
-			/*
-			 * The interval can be added by merging the two already
-			 * present intervals.
-			 */
-			node->value[node->keys - 1] += count + right_cnt;
-			btree_remove(&area->used_space, right_pg, leaf);
-			goto success;
-		} else if (page == left_pg + P2SZ(left_cnt)) {
-			/*
-			 * The interval can be added by simply growing the left
-			 * interval.
-			 */
-			node->value[node->keys - 1] += count;
-			goto success;
-		} else if (page + P2SZ(count) == right_pg) {
-			/*
-			 * The interval can be addded by simply moving base of
-			 * the right interval down and increasing its size
-			 * accordingly.
-			 */
-			leaf->value[0] += count;
-			leaf->key[0] = page;
-			goto success;
-		} else {
-			/*
-			 * The interval is between both neigbouring intervals,
-			 * but cannot be merged with any of them.
-			 */
-			btree_insert(&area->used_space, page, (void *) count,
-			    leaf);
-			goto success;
-		}
-	} else if (page < leaf->key[0]) {
-		uintptr_t right_pg = leaf->key[0];
-		size_t right_cnt = (size_t) leaf->value[0];
+		if (!page_mapping_find(as, base + P2SZ(i), false, &pte) ||
+		    !PTE_VALID(&pte) || !PTE_PRESENT(&pte))
+			break;
 
-		/*
-		 * Investigate the border case in which the left neighbour does
-		 * not exist but the interval fits from the left.
-		 */
+		uintptr_t frame = PTE_GET_FRAME(&pte);
+		if (frame + PAGE_SIZE > limit)
+			break;
 
-		if (overlaps(page, P2SZ(count), right_pg, P2SZ(right_cnt))) {
-			/* The interval intersects with the right interval. */
-			return false;
-		} else if (page + P2SZ(count) == right_pg) {
-			/*
-			 * The interval can be added by moving the base of the
-			 * right interval down and increasing its size
-			 * accordingly.
-			 */
-			leaf->key[0] = page;
-			leaf->value[0] += count;
-			goto success;
-		} else {
-			/*
-			 * The interval doesn't adjoin with the right interval.
-			 * It must be added individually.
-			 */
-			btree_insert(&area->used_space, page, (void *) count,
-			    leaf);
-			goto success;
-		}
+		frame_reference_add(ADDR2PFN(frame));
+		frames[i] = frame;
 	}
+	page_table_unlock(as, false);
 
-	node = btree_leaf_node_right_neighbour(&area->used_space, leaf);
-	if (node) {
-		uintptr_t left_pg = leaf->key[leaf->keys - 1];
-		uintptr_t right_pg = node->key[0];
-		size_t left_cnt = (size_t) leaf->value[leaf->keys - 1];
-		size_t right_cnt = (size_t) node->value[0];
+	mutex_unlock(&area->lock);
+	mutex_unlock(&as->lock);
 
-		/*
-		 * Examine the possibility that the interval fits
-		 * somewhere between the leftmost interval of
-		 * the right neigbour and the last interval of the leaf.
-		 */
+	if (i < count) {
+		as_unpin_frames(frames, i);
+		return ENOTSUP;
+	}
 
-		if (page < left_pg) {
-			/* Do nothing. */
-		} else if (overlaps(page, P2SZ(count), left_pg,
-		    P2SZ(left_cnt))) {
-			/* The interval intersects with the left interval. */
-			return false;
-		} else if (overlaps(page, P2SZ(count), right_pg,
-		    P2SZ(right_cnt))) {
-			/* The interval intersects with the right interval. */
-			return false;
-		} else if ((page == left_pg + P2SZ(left_cnt)) &&
-		    (page + P2SZ(count) == right_pg)) {
-			/*
-			 * The interval can be added by merging the two already
-			 * present intervals.
-			 */
-			leaf->value[leaf->keys - 1] += count + right_cnt;
-			btree_remove(&area->used_space, right_pg, node);
-			goto success;
-		} else if (page == left_pg + P2SZ(left_cnt)) {
-			/*
-			 * The interval can be added by simply growing the left
-			 * interval.
-			 */
-			leaf->value[leaf->keys - 1] += count;
-			goto success;
-		} else if (page + P2SZ(count) == right_pg) {
-			/*
-			 * The interval can be addded by simply moving base of
-			 * the right interval down and increasing its size
-			 * accordingly.
-			 */
-			node->value[0] += count;
-			node->key[0] = page;
-			goto success;
-		} else {
-			/*
-			 * The interval is between both neigbouring intervals,
-			 * but cannot be merged with any of them.
-			 */
-			btree_insert(&area->used_space, page, (void *) count,
-			    leaf);
-			goto success;
-		}
-	} else if (page >= leaf->key[leaf->keys - 1]) {
-		uintptr_t left_pg = leaf->key[leaf->keys - 1];
-		size_t left_cnt = (size_t) leaf->value[leaf->keys - 1];
+	return EOK;
+}
 
-		/*
-		 * Investigate the border case in which the right neighbour
-		 * does not exist but the interval fits from the right.
-		 */
+/** Release frames pinned by as_pin_frames().
+ *
+ * @param frames Physical addresses of the frames.
+ * @param count  Number of frames.
+ *
+ */
+void as_unpin_frames(uintptr_t *frames, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+		frame_free_noreserve(frames[i], 1);
+}
 
-		if (overlaps(page, P2SZ(count), left_pg, P2SZ(left_cnt))) {
-			/* The interval intersects with the left interval. */
-			return false;
-		} else if (left_pg + P2SZ(left_cnt) == page) {
-			/*
-			 * The interval can be added by growing the left
-			 * interval.
-			 */
-			leaf->value[leaf->keys - 1] += count;
-			goto success;
-		} else {
-			/*
-			 * The interval doesn't adjoin with the left interval.
-			 * It must be added individually.
-			 */
-			btree_insert(&area->used_space, page, (void *) count,
-			    leaf);
-			goto success;
-		}
-	}
+/** Return the used space interval containing an odict link. */
+static used_space_ival_t *used_space_ival(odlink_t *odlink)
+{
+	if (!odlink)
+		return NULL;
 
-	/*
-	 * Note that if the algorithm made it thus far, the interval can fit
-	 * only between two other intervals of the leaf. The two border cases
-	 * were already resolved.
-	 */
-	btree_key_t i;
-	for (i = 1; i < leaf->keys; i++) {
-		if (page < leaf->key[i]) {
-			uintptr_t left_pg = leaf->key[i - 1];
-			uintptr_t right_pg = leaf->key[i];
-			size_t left_cnt = (size_t) leaf->value[i - 1];
-			size_t right_cnt = (size_t) leaf->value[i];
+	return odict_get_instance(odlink, used_space_ival_t, lused_space);
+}
 
-			/*
-			 * The interval fits between left_pg and right_pg.
-			 */
+/** Return the first interval of used space of an address space area.
+ *
+ * The address space area must be already locked.
+ *
+ * @param area Address space area.
+ *
+ * @return Interval with the lowest address or NULL if no page is used.
+ *
+ */
+used_space_ival_t *used_space_first(as_area_t *area)
+{
+	return used_space_ival(odict_first(&area->used_space));
+}
 
-			if (overlaps(page, P2SZ(count), left_pg,
-			    P2SZ(left_cnt))) {
-				/*
-				 * The interval intersects with the left
-				 * interval.
-				 */
-				return false;
-			} else if (overlaps(page, P2SZ(count), right_pg,
-			    P2SZ(right_cnt))) {
-				/*
-				 * The interval intersects with the right
-				 * interval.
-				 */
-				return false;
-			} else if ((page == left_pg + P2SZ(left_cnt)) &&
-			    (page + P2SZ(count) == right_pg)) {
-				/*
-				 * The interval can be added by merging the two
-				 * already present intervals.
-				 */
-				leaf->value[i - 1] += count + right_cnt;
-				btree_remove(&area->used_space, right_pg, leaf);
-				goto success;
-			} else if (page == left_pg + P2SZ(left_cnt)) {
-				/*
-				 * The interval can be added by simply growing
-				 * the left interval.
-				 */
-				leaf->value[i - 1] += count;
-				goto success;
-			} else if (page + P2SZ(count) == right_pg) {
-				/*
-				 * The interval can be addded by simply moving
-				 * base of the right interval down and
-				 * increasing its size accordingly.
-				 */
-				leaf->value[i] += count;
-				leaf->key[i] = page;
-				goto success;
-			} else {
-				/*
-				 * The interval is between both neigbouring
-				 * intervals, but cannot be merged with any of
-				 * them.
-				 */
-				btree_insert(&area->used_space, page,
-				    (void *) count, leaf);
-				goto success;
-			}
-		}
-	}
+/** Return the last interval of used space of an address space area.
+ *
+ * The address space area must be already locked.
+ *
+ * @param area Address space area.
+ *
+ * @return Interval with the highest address or NULL if no page is used.
+ *
+ */
+used_space_ival_t *used_space_last(as_area_t *area)
+{
+	return used_space_ival(odict_last(&area->used_space));
+}
 
-	panic("Inconsistency detected while adding %zu pages of used "
-	    "space at %p.", count, (void *) page);
+/** Return the next interval of used space of an address space area.
+ *
+ * The address space area must be already locked.
+ *
+ * @param area Address space area.
+ * @param cur  Current interval.
+ *
+ * @return Interval following cur or NULL if cur is the last one.
+ *
+ */
+used_space_ival_t *used_space_next(as_area_t *area, used_space_ival_t *cur)
+{
+	return used_space_ival(odict_next(&cur->lused_space,
+	    &area->used_space));
+}
 
-success:
-	area->resident += count;
-	return true;
+/** Forget all used space of an address space area.
+ *
+ * The address space area must be already locked.
+ *
+ * @param area Address space area.
+ *
+ */
+static void used_space_finalize(as_area_t *area)
+{
+	assert(mutex_locked(&area->lock));
+
+	used_space_ival_t *ival;
+	while ((ival = used_space_first(area)) != NULL) {
+		odict_remove(&ival->lused_space);
+		slab_free(used_space_ival_cache, ival);
+	}
+
+	area->resident = 0;
 }
 
-/** Mark portion of address space area as unused.
+/** Mark portion of address space area as used.
  *
  * The address space area must be already locked.
  *
@@ -2023,174 +1957,123 @@ success:
  * @return False on failure or true on success.
  *
  */
-bool used_space_remove(as_area_t *area, uintptr_t page, size_t count)
+bool used_space_insert(as_area_t *area, uintptr_t page, size_t count)
 {
 	assert(mutex_locked(&area->lock));
 	assert(IS_ALIGNED(page, PAGE_SIZE));
 	assert(count);
 
-	btree_node_t *leaf;
-	size_t pages = (size_t) btree_search(&area->used_space, page, &leaf);
-	if (pages) {
+	/*
+	 * Only the nearest intervals below and above the new one can
+	 * overlap it or be adjacent to it.
+	 */
+	used_space_ival_t *left = used_space_ival(odict_find_lt(
+	    &area->used_space, &page, NULL));
+	used_space_ival_t *right = used_space_ival(odict_find_geq(
+	    &area->used_space, &page, NULL));
+
+	if ((left) &&
+	    (overlaps(left->page, P2SZ(left->count), page, P2SZ(count))))
+		return false;
+
+	if ((right) &&
+	    (overlaps(right->page, P2SZ(right->count), page, P2SZ(count))))
+		return false;
+
+	bool merge_left = (left) &&
+	    (left->page + P2SZ(left->count) == page);
+	bool merge_right = (right) &&
+	    (page + P2SZ(count) == right->page);
+
+	if ((merge_left) && (merge_right)) {
+		/* The new interval joins its two neighbours. */
+		left->count += count + right->count;
+		odict_remove(&right->lused_space);
+		slab_free(used_space_ival_cache, right);
+	} else if (merge_left) {
+		left->count += count;
+	} else if (merge_right) {
 		/*
-		 * We are lucky, page is the beginning of some interval.
+		 * Moving the start of the interval down does not change
+		 * its position among the other intervals.
 		 */
-		if (count > pages) {
+		right->page = page;
+		right->count += count;
+	} else {
+		used_space_ival_t *ival = (used_space_ival_t *)
+		    slab_alloc(used_space_ival_cache, 0);
+		if (!ival)
 			return false;
-		} else if (count == pages) {
-			btree_remove(&area->used_space, page, leaf);
-			goto success;
-		} else {
-			/*
-			 * Find the respective interval.
-			 * Decrease its size and relocate its start address.
-			 */
-			btree_key_t i;
-			for (i = 0; i < leaf->keys; i++) {
-				if (leaf->key[i] == page) {
-					leaf->key[i] += P2SZ(count);
-					leaf->value[i] -= count;
-					goto success;
-				}
-			}
 
-			goto error;
-		}
+		ival->page = page;
+		ival->count = count;
+		odlink_initialize(&ival->lused_space);
+		odict_insert(&ival->lused_space, &area->used_space, NULL);
 	}
 
-	btree_node_t *node = btree_leaf_node_left_neighbour(&area->used_space,
-	    leaf);
-	if ((node) && (page < leaf->key[0])) {
-		uintptr_t left_pg = node->key[node->keys - 1];
-		size_t left_cnt = (size_t) node->value[node->keys - 1];
-
-		if (overlaps(left_pg, P2SZ(left_cnt), page, P2SZ(count))) {
-			if (page + P2SZ(count) == left_pg + P2SZ(left_cnt)) {
-				/*
-				 * The interval is contained in the rightmost
-				 * interval of the left neighbour and can be
-				 * removed by updating the size of the bigger
-				 * interval.
-				 */
-				node->value[node->keys - 1] -= count;
-				goto success;
-			} else if (page + P2SZ(count) <
-			    left_pg + P2SZ(left_cnt)) {
-				size_t new_cnt;
+	area->resident += count;
+	return true;
+}
 
-				/*
-				 * The interval is contained in the rightmost
-				 * interval of the left neighbour but its
-				 * removal requires both updating the size of
-				 * the original interval and also inserting a
-				 * new interval.
-				 */
-				new_cnt = ((left_pg + P2SZ(left_cnt)) -
-				    (page + P2SZ(count))) >> PAGE_WIDTH;
-				node->value[node->keys - 1] -= count + new_cnt;
-				btree_insert(&area->used_space, page +
-				    P2SZ(count), (void *) new_cnt, leaf);
-				goto success;
-			}
-		}
+/** Mark portion of address space area as unused.
+ *
+ * The address space area must be already locked.
+ *
+ * @param area  Address space area.
+ * @param page  First page to be marked.
+ * @param count Number of page to be marked.
+ *
+ * @return False on failure or true on success.
+ *
+ */
+bool used_space_remove(as_area_t *area, uintptr_t page, size_t count)
+{
+	assert(mutex_locked(&area->lock));
+	assert(IS_ALIGNED(page, PAGE_SIZE));
+	assert(count);
 
+	/*
+	 * The pages must all belong to the interval starting at or
+	 * nearest below page.
+	 */
+	used_space_ival_t *ival = used_space_ival(odict_find_leq(
+	    &area->used_space, &page, NULL));
+	if (!ival)
 		return false;
-	} else if (page < leaf->key[0])
-		return false;
-
-	if (page > leaf->key[leaf->keys - 1]) {
-		uintptr_t left_pg = leaf->key[leaf->keys - 1];
-		size_t left_cnt = (size_t) leaf->value[leaf->keys - 1];
-
-		if (overlaps(left_pg, P2SZ(left_cnt), page, P2SZ(count))) {
-			if (page + P2SZ(count) == left_pg + P2SZ(left_cnt)) {
-				/*
-				 * The interval is contained in the rightmost
-				 * interval of the leaf and can be removed by
-				 * updating the size of the bigger interval.
-				 */
-				leaf->value[leaf->keys - 1] -= count;
-				goto success;
-			} else if (page + P2SZ(count) < left_pg +
-			    P2SZ(left_cnt)) {
-				size_t new_cnt;
-
-				/*
-				 * The interval is contained in the rightmost
-				 * interval of the leaf but its removal
-				 * requires both updating the size of the
-				 * original interval and also inserting a new
-				 * interval.
-				 */
-				new_cnt = ((left_pg + P2SZ(left_cnt)) -
-				    (page + P2SZ(count))) >> PAGE_WIDTH;
-				leaf->value[leaf->keys - 1] -= count + new_cnt;
-				btree_insert(&area->used_space, page +
-				    P2SZ(count), (void *) new_cnt, leaf);
-				goto success;
-			}
-		}
 
+	uintptr_t end = ival->page + P2SZ(ival->count);
+	if (page + P2SZ(count) > end)
 		return false;
-	}
-
-	/*
-	 * The border cases have been already resolved.
-	 * Now the interval can be only between intervals of the leaf.
-	 */
-	btree_key_t i;
-	for (i = 1; i < leaf->keys - 1; i++) {
-		if (page < leaf->key[i]) {
-			uintptr_t left_pg = leaf->key[i - 1];
-			size_t left_cnt = (size_t) leaf->value[i - 1];
 
-			/*
-			 * Now the interval is between intervals corresponding
-			 * to (i - 1) and i.
-			 */
-			if (overlaps(left_pg, P2SZ(left_cnt), page,
-			    P2SZ(count))) {
-				if (page + P2SZ(count) ==
-				    left_pg + P2SZ(left_cnt)) {
-					/*
-					 * The interval is contained in the
-					 * interval (i - 1) of the leaf and can
-					 * be removed by updating the size of
-					 * the bigger interval.
-					 */
-					leaf->value[i - 1] -= count;
-					goto success;
-				} else if (page + P2SZ(count) <
-				    left_pg + P2SZ(left_cnt)) {
-					size_t new_cnt;
+	if (ival->page == page) {
+		if (ival->count == count) {
+			/* The whole interval is removed. */
+			odict_remove(&ival->lused_space);
+			slab_free(used_space_ival_cache, ival);
+		} else {
+			/* The beginning of the interval is removed. */
+			ival->page += P2SZ(count);
+			ival->count -= count;
+		}
+	} else if (page + P2SZ(count) == end) {
+		/* The end of the interval is removed. */
+		ival->count -= count;
+	} else {
+		/* The middle of the interval is removed. */
+		used_space_ival_t *upper = (used_space_ival_t *)
+		    slab_alloc(used_space_ival_cache, 0);
+		if (!upper)
+			return false;
 
-					/*
-					 * The interval is contained in the
-					 * interval (i - 1) of the leaf but its
-					 * removal requires both updating the
-					 * size of the original interval and
-					 * also inserting a new interval.
-					 */
-					new_cnt = ((left_pg + P2SZ(left_cnt)) -
-					    (page + P2SZ(count))) >>
-					    PAGE_WIDTH;
-					leaf->value[i - 1] -= count + new_cnt;
-					btree_insert(&area->used_space, page +
-					    P2SZ(count), (void *) new_cnt,
-					    leaf);
-					goto success;
-				}
-			}
+		upper->page = page + P2SZ(count);
+		upper->count = (end - upper->page) >> PAGE_WIDTH;
+		ival->count = (page - ival->page) >> PAGE_WIDTH;
 
-			return false;
-		}
+		odlink_initialize(&upper->lused_space);
+		odict_insert(&upper->lused_space, &area->used_space,
+		    &ival->lused_space);
 	}
 
-error:
-	panic("Inconsistency detected while removing %zu pages of used "
-	    "space from %p.", count, (void *) page);
-
-success:
 	area->resident -= count;
 	return true;
 }
@@ -2251,12 +2134,7 @@ void as_get_area_info(as_t *as, as_area_info_t **obuf, size_t *osize)
 
 	/* First pass, count number of areas. */
 
-	size_t area_cnt = 0;
-
-	list_foreach(as->as_area_btree.leaf_list, leaf_link, btree_node_t,
-	    node) {
-		area_cnt += node->keys;
-	}
+	size_t area_cnt = odict_count(&as->as_areas);
 
 	size_t isize = area_cnt * sizeof(as_area_info_t);
 	as_area_info_t *info = nfmalloc(isize);
@@ -2265,23 +2143,17 @@ void as_get_area_info(as_t *as, as_area_info_t **obuf, size_t *osize)
 
 	size_t area_idx = 0;
 
-	list_foreach(as->as_area_btree.leaf_list, leaf_link, btree_node_t,
-	    node) {
-		btree_key_t i;
-
-		for (i = 0; i < node->keys; i++) {
-			as_area_t *area = node->value[i];
-
-			assert(area_idx < area_cnt);
-			mutex_lock(&area->lock);
+	for (as_area_t *area = as_area_first(as); area != NULL;
+	    area = as_area_next(area)) {
+		assert(area_idx < area_cnt);
+		mutex_lock(&area->lock);
 
-			info[area_idx].start_addr = area->base;
-			info[area_idx].size = P2SZ(area->pages);
-			info[area_idx].flags = area->flags;
-			++area_idx;
+		info[area_idx].start_addr = area->base;
+		info[area_idx].size = P2SZ(area->pages);
+		info[area_idx].flags = area->flags;
+		++area_idx;
 
-			mutex_unlock(&area->lock);
-		}
+		mutex_unlock(&area->lock);
 	}
 
 	mutex_unlock(&as->lock);
@@ -2300,20 +2172,14 @@ void as_print(as_t *as)
 	mutex_lock(&as->lock);
 
 	/* Print out info about address space areas */
-	list_foreach(as->as_area_btree.leaf_list, leaf_link, btree_node_t,
-	    node) {
-		btree_key_t i;
-
-		for (i = 0; i < node->keys; i++) {
-			as_area_t *area = node->value[i];
-
-			mutex_lock(&area->lock);
-			printf("as_area: %p, base=%p, pages=%zu"
-			    " (%p - %p)\n", area, (void *) area->base,
-			    area->pages, (void *) area->base,
-			    (void *) (area->base + P2SZ(area->pages)));
-			mutex_unlock(&area->lock);
-		}
+	for (as_area_t *area = as_area_first(as); area != NULL;
+	    area = as_area_next(area)) {
+		mutex_lock(&area->lock);
+		printf("as_area: %p, base=%p, pages=%zu"
+		    " (%p - %p)\n", area, (void *) area->base,
+		    area->pages, (void *) area->base,
+		    (void *) (area->base + P2SZ(area->pages)));
+		mutex_unlock(&area->lock);
 	}
 
 	mutex_unlock(&as->lock);
@@ -40,6 +40,7 @@
 #include <mm/as.h>
 #include <mm/page.h>
 #include <mm/reserve.h>
+#include <mm/merge.h>
 #include <genarch/mm/page_pt.h>
 #include <genarch/mm/page_ht.h>
 #include <mm/frame.h>
@@ -121,36 +122,35 @@ void anon_share(as_area_t *area)
 	 * Copy used portions of the area to sh_info's page map.
 	 */
 	mutex_lock(&area->sh_info->lock);
-	list_foreach(area->used_space.leaf_list, leaf_link, btree_node_t,
-	    node) {
-		unsigned int i;
+	for (used_space_ival_t *ival = used_space_first(area);
+	    ival != NULL; ival = used_space_next(area, ival)) {
+		uintptr_t base = ival->page;
+		size_t count = ival->count;
+		unsigned int j;
 
-		for (i = 0; i < node->keys; i++) {
-			uintptr_t base = node->key[i];
-			size_t count = (size_t) node->value[i];
-			unsigned int j;
+		for (j = 0; j < count; j++) {
+			pte_t pte;
+			bool found;
 
-			for (j = 0; j < count; j++) {
-				pte_t pte;
-				bool found;
+			page_table_lock(area->as, false);
 
-				page_table_lock(area->as, false);
-				found = page_mapping_find(area->as,
-				    base + P2SZ(j), false, &pte);
+			/* Merged frames must not be shared writable. */
+			(void) page_merge_break(area->as, area, base + P2SZ(j));
 
-				assert(found);
-				assert(PTE_VALID(&pte));
-				assert(PTE_PRESENT(&pte));
+			found = page_mapping_find(area->as,
+			    base + P2SZ(j), false, &pte);
 
-				btree_insert(&area->sh_info->pagemap,
-				    (base + P2SZ(j)) - area->base,
-				    (void *) PTE_GET_FRAME(&pte), NULL);
-				page_table_unlock(area->as, false);
+			assert(found);
+			assert(PTE_VALID(&pte));
+			assert(PTE_PRESENT(&pte));
 
-				pfn_t pfn = ADDR2PFN(PTE_GET_FRAME(&pte));
-				frame_reference_add(pfn);
-			}
+			btree_insert(&area->sh_info->pagemap,
+			    (base + P2SZ(j)) - area->base,
+			    (void *) PTE_GET_FRAME(&pte), NULL);
+			page_table_unlock(area->as, false);
 
+			pfn_t pfn = ADDR2PFN(PTE_GET_FRAME(&pte));
+			frame_reference_add(pfn);
 		}
 	}
 	mutex_unlock(&area->sh_info->lock);
@@ -174,6 +174,59 @@ bool anon_is_shareable(as_area_t *area)
 	return !(area->flags & AS_AREA_LATE_RESERVE);
 }
 
+#ifdef LARGE_PAGE_SIZE
+
+/** Try to service a page fault by mapping a whole large page.
+ *
+ * The large page containing upage is mapped only if it lies entirely
+ * within the area, none of its pages is mapped yet and enough suitably
+ * aligned contiguous physical memory is available without blocking.
+ *
+ * @param area  Private anonymous area with the AS_AREA_LARGE flag.
+ * @param upage Faulting virtual page.
+ *
+ * @return True if the large page was mapped, false if the caller
+ *         should fall back to a small page.
+ */
+static bool anon_page_fault_large(as_area_t *area, uintptr_t upage)
+{
+	size_t count = LARGE_PAGE_SIZE / PAGE_SIZE;
+	uintptr_t base = ALIGN_DOWN(upage, LARGE_PAGE_SIZE);
+
+	if ((base < area->base) ||
+	    (base + LARGE_PAGE_SIZE > area->base + P2SZ(area->pages)))
+		return false;
+
+	if ((area->flags & AS_AREA_LATE_RESERVE) && !reserve_try_alloc(count))
+		return false;
+
+	uintptr_t frame = frame_alloc(count,
+	    FRAME_LOWMEM | FRAME_ATOMIC | FRAME_NO_RESERVE,
+	    LARGE_PAGE_SIZE - 1);
+	if (frame == 0)
+		goto error;
+
+	memsetb((void *) PA2KA(frame), LARGE_PAGE_SIZE, 0);
+
+	if (!page_mapping_insert_large(AS, base, frame,
+	    as_area_get_flags(area))) {
+		frame_free_noreserve(frame, count);
+		goto error;
+	}
+
+	if (!used_space_insert(area, base, count))
+		panic("Cannot insert used space.");
+
+	return true;
+
+error:
+	if (area->flags & AS_AREA_LATE_RESERVE)
+		reserve_free(count);
+	return false;
+}
+
+#endif /* LARGE_PAGE_SIZE */
+
 /** Service a page fault in the anonymous memory address space area.
  *
  * The address space area and page tables must be already locked.
@@ -197,6 +250,13 @@ int anon_page_fault(as_area_t *area, uintptr_t upage, pf_access_t access)
 	if (!as_area_check_access(area, access))
 		return AS_PF_FAULT;
 
+	/*
+	 * A write to a page merged with identical pages of other tasks
+	 * gives the page its own copy of the frame.
+	 */
+	if ((access == PF_ACCESS_WRITE) && page_merge_break(AS, area, upage))
+		return AS_PF_OK;
+
 	mutex_lock(&area->sh_info->lock);
 	if (area->sh_info->shared) {
 		btree_node_t *leaf;
@@ -254,8 +314,18 @@ int anon_page_fault(as_area_t *area, uintptr_t upage, pf_access_t access)
 		 *   reuse; when this becomes a possibility,
 		 *   do not forget to distinguish between
 		 *   the different causes
+		 *
+		 * Write faults on merged pages are handled above.
 		 */
 
+#ifdef LARGE_PAGE_SIZE
+		if ((area->flags & AS_AREA_LARGE) &&
+		    anon_page_fault_large(area, upage)) {
+			mutex_unlock(&area->sh_info->lock);
+			return AS_PF_OK;
+		}
+#endif
+
 		if (area->flags & AS_AREA_LATE_RESERVE) {
 			/*
 			 * Reserve the memory for this page now.
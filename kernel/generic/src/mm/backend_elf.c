@@ -52,6 +52,9 @@
 #include <arch.h>
 #include <arch/barrier.h>
 
+/** Maximum number of pages mapped by a single page fault. */
+#define ELF_FAULT_AROUND  16
+
 static bool elf_create(as_area_t *);
 static bool elf_resize(as_area_t *, size_t);
 static void elf_share(as_area_t *);
@@ -137,81 +140,58 @@ bool elf_resize(as_area_t *area, size_t new_pages)
 void elf_share(as_area_t *area)
 {
 	elf_segment_header_t *entry = area->backend_data.segment;
-	link_t *cur;
-	btree_node_t *leaf, *node;
 	uintptr_t start_anon = entry->p_vaddr + entry->p_filesz;
 
 	assert(mutex_locked(&area->as->lock));
 	assert(mutex_locked(&area->lock));
 
-	/*
-	 * Find the node in which to start linear search.
-	 */
-	if (area->flags & AS_AREA_WRITE) {
-		node = list_get_instance(list_first(&area->used_space.leaf_list),
-		    btree_node_t, leaf_link);
-	} else {
-		(void) btree_search(&area->sh_info->pagemap, start_anon, &leaf);
-		node = btree_leaf_node_left_neighbour(&area->sh_info->pagemap,
-		    leaf);
-		if (!node)
-			node = leaf;
-	}
-
 	/*
 	 * Copy used anonymous portions of the area to sh_info's page map.
 	 */
 	mutex_lock(&area->sh_info->lock);
-	for (cur = &node->leaf_link; cur != &area->used_space.leaf_list.head;
-	    cur = cur->next) {
-		unsigned int i;
+	for (used_space_ival_t *ival = used_space_first(area); ival != NULL;
+	    ival = used_space_next(area, ival)) {
+		uintptr_t base = ival->page;
+		size_t count = ival->count;
+		unsigned int j;
 
-		node = list_get_instance(cur, btree_node_t, leaf_link);
+		/*
+		 * Skip read-only areas of used space that are backed
+		 * by the ELF image.
+		 */
+		if (!(area->flags & AS_AREA_WRITE))
+			if (base >= entry->p_vaddr &&
+			    base + P2SZ(count) <= start_anon)
+				continue;
 
-		for (i = 0; i < node->keys; i++) {
-			uintptr_t base = node->key[i];
-			size_t count = (size_t) node->value[i];
-			unsigned int j;
+		for (j = 0; j < count; j++) {
+			pte_t pte;
+			bool found;
 
 			/*
-			 * Skip read-only areas of used space that are backed
-			 * by the ELF image.
+			 * Skip read-only pages that are backed by the
+			 * ELF image.
 			 */
 			if (!(area->flags & AS_AREA_WRITE))
 				if (base >= entry->p_vaddr &&
-				    base + P2SZ(count) <= start_anon)
+				    base + P2SZ(j + 1) <= start_anon)
 					continue;
 
-			for (j = 0; j < count; j++) {
-				pte_t pte;
-				bool found;
-
-				/*
-				 * Skip read-only pages that are backed by the
-				 * ELF image.
-				 */
-				if (!(area->flags & AS_AREA_WRITE))
-					if (base >= entry->p_vaddr &&
-					    base + P2SZ(j + 1) <= start_anon)
-						continue;
-
-				page_table_lock(area->as, false);
-				found = page_mapping_find(area->as,
-				    base + P2SZ(j), false, &pte);
-
-				assert(found);
-				assert(PTE_VALID(&pte));
-				assert(PTE_PRESENT(&pte));
-
-				btree_insert(&area->sh_info->pagemap,
-				    (base + P2SZ(j)) - area->base,
-				    (void *) PTE_GET_FRAME(&pte), NULL);
-				page_table_unlock(area->as, false);
-
-				pfn_t pfn = ADDR2PFN(PTE_GET_FRAME(&pte));
-				frame_reference_add(pfn);
-			}
+			page_table_lock(area->as, false);
+			found = page_mapping_find(area->as,
+			    base + P2SZ(j), false, &pte);
+
+			assert(found);
+			assert(PTE_VALID(&pte));
+			assert(PTE_PRESENT(&pte));
 
+			btree_insert(&area->sh_info->pagemap,
+			    (base + P2SZ(j)) - area->base,
+			    (void *) PTE_GET_FRAME(&pte), NULL);
+			page_table_unlock(area->as, false);
+
+			pfn_t pfn = ADDR2PFN(PTE_GET_FRAME(&pte));
+			frame_reference_add(pfn);
 		}
 	}
 	mutex_unlock(&area->sh_info->lock);
@@ -235,6 +215,60 @@ bool elf_is_shareable(as_area_t *area)
 	return true;
 }
 
+/** Map read-only pages backed by the ELF image around a faulting page.
+ *
+ * The pages are mapped directly from the ELF image, so no memory is
+ * allocated or copied. Only pages within the naturally aligned window
+ * of ELF_FAULT_AROUND pages containing upage which are not mapped yet
+ * are considered.
+ *
+ * The address space area and page tables must be already locked.
+ *
+ * @param area		Pointer to the address space area.
+ * @param upage		Faulting virtual page, already mapped.
+ */
+static void elf_fault_around(as_area_t *area, uintptr_t upage)
+{
+	elf_header_t *elf = area->backend_data.elf;
+	elf_segment_header_t *entry = area->backend_data.segment;
+	uintptr_t base = (uintptr_t)
+	    (((void *) elf) + ALIGN_DOWN(entry->p_offset, PAGE_SIZE));
+	uintptr_t first = ALIGN_DOWN(upage, P2SZ(ELF_FAULT_AROUND));
+	uintptr_t last = first + P2SZ(ELF_FAULT_AROUND);
+
+	/* Clip the window to the part of the area backed by the image. */
+	first = max(first, ALIGN_UP(entry->p_vaddr, PAGE_SIZE));
+	first = max(first, area->base);
+	last = min(last, ALIGN_DOWN(entry->p_vaddr + entry->p_filesz,
+	    PAGE_SIZE));
+	last = min(last, area->base + P2SZ(area->pages));
+
+	for (uintptr_t page = first; page < last; page += PAGE_SIZE) {
+		pte_t pte;
+
+		if (page == upage)
+			continue;
+
+		if (page_mapping_find(AS, page, false, &pte) &&
+		    PTE_VALID(&pte))
+			continue;
+
+		size_t i = (page - ALIGN_DOWN(entry->p_vaddr, PAGE_SIZE)) >>
+		    PAGE_WIDTH;
+		if (!page_mapping_find(AS_KERNEL, base + i * FRAME_SIZE, true,
+		    &pte))
+			panic("Image page not mapped in the kernel.");
+
+		assert(PTE_PRESENT(&pte));
+
+		page_mapping_insert(AS, page, PTE_GET_FRAME(&pte),
+		    as_area_get_flags(area));
+		if (!used_space_insert(area, page, 1))
+			panic("Cannot insert used space.");
+
+		TASK->pages_prefaulted++;
+	}
+}
 
 /** Service a page fault in the ELF backend address space area.
  *
@@ -259,6 +293,7 @@ int elf_page_fault(as_area_t *area, uintptr_t upage, pf_access_t access)
 	uintptr_t start_anon;
 	size_t i;
 	bool dirty = false;
+	bool around = false;
 
 	assert(page_table_locked(AS));
 	assert(mutex_locked(&area->lock));
@@ -348,6 +383,7 @@ int elf_page_fault(as_area_t *area, uintptr_t upage, pf_access_t access)
 			assert(PTE_PRESENT(&pte));
 
 			frame = PTE_GET_FRAME(&pte);
+			around = true;
 		}
 	} else if (upage >= start_anon) {
 		/*
@@ -405,6 +441,9 @@ int elf_page_fault(as_area_t *area, uintptr_t upage, pf_access_t access)
 	if (!used_space_insert(area, upage, 1))
 		panic("Cannot insert used space.");
 
+	if (around)
+		elf_fault_around(area, upage);
+
 	return AS_PF_OK;
 }
 
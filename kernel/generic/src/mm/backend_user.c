@@ -145,6 +145,17 @@ int user_page_fault(as_area_t *area, uintptr_t upage, pf_access_t access)
 	 */
 
 	uintptr_t frame = IPC_GET_ARG1(data);
+
+	/*
+	 * The pager may hand out a frame it shares with other address spaces.
+	 * Such a frame must never become writable through this area.
+	 */
+	if ((IPC_GET_ARG2(data) & AS_PAGE_IN_SHARED) &&
+	    (area->flags & AS_AREA_WRITE)) {
+		user_frame_free(area, upage, frame);
+		return AS_PF_FAULT;
+	}
+
 	page_mapping_insert(AS, upage, frame, as_area_get_flags(area));
 	if (!used_space_insert(area, upage, 1))
 		panic("Cannot insert used space.");
@@ -44,6 +44,8 @@
 #include <typedefs.h>
 #include <mm/frame.h>
 #include <mm/reserve.h>
+#include <mm/numa.h>
+#include <mm/pressure.h>
 #include <mm/as.h>
 #include <panic.h>
 #include <assert.h>
@@ -60,6 +62,8 @@
 #include <macros.h>
 #include <config.h>
 #include <str.h>
+#include <errno.h>
+#include <cpu.h>
 #include <proc/thread.h> /* THREAD */
 
 zones_t zones;
@@ -73,6 +77,15 @@ static condvar_t mem_avail_cv;
 static size_t mem_avail_req = 0;  /**< Number of frames requested. */
 static size_t mem_avail_gen = 0;  /**< Generation counter. */
 
+/** Zone flags of the frames kept in the per-CPU caches. */
+#define FRAME_PCP_ZONE_FLAGS  FRAME_TO_ZONE_FLAGS(FRAME_NONE)
+
+/**
+ * Number of frames moved between the zones and a per-CPU cache at once.
+ * Zero disables the per-CPU caches.
+ */
+static size_t frame_pcp_batch = FRAME_PCP_BATCH;
+
 /** Initialize frame structure.
  *
  * @param frame Frame structure to be initialized.
@@ -234,13 +247,14 @@ NO_TRACE static bool zone_can_alloc(zone_t *zone, size_t count,
  * @param constraint Indication of bits that cannot be set in the
  *                   physical frame number of the first allocated frame.
  * @param hint       Preferred zone.
+ * @param node       Required NUMA node of the zone or NUMA_NODE_ANY.
  *
  * @return Zone that can allocate specified number of frames.
  * @return -1 if no zone can satisfy the request.
  *
  */
 NO_TRACE static size_t find_free_zone_all(size_t count, zone_flags_t flags,
-    pfn_t constraint, size_t hint)
+    pfn_t constraint, size_t hint, unsigned int node)
 {
 	for (size_t pos = 0; pos < zones.count; pos++) {
 		size_t i = (pos + hint) % zones.count;
@@ -249,6 +263,9 @@ NO_TRACE static size_t find_free_zone_all(size_t count, zone_flags_t flags,
 		if (!ZONE_FLAGS_MATCH(zones.info[i].flags, flags))
 			continue;
 
+		if ((node != NUMA_NODE_ANY) && (zones.info[i].node != node))
+			continue;
+
 		/* Check if the zone can satisfy the allocation request. */
 		if (zone_can_alloc(&zones.info[i], count, constraint))
 			return i;
@@ -280,13 +297,14 @@ NO_TRACE static bool is_high_priority(pfn_t base, size_t count)
  * @param constraint Indication of bits that cannot be set in the
  *                   physical frame number of the first allocated frame.
  * @param hint       Preferred zone.
+ * @param node       Required NUMA node of the zone or NUMA_NODE_ANY.
  *
  * @return Zone that can allocate specified number of frames.
  * @return -1 if no low-priority zone can satisfy the request.
  *
  */
 NO_TRACE static size_t find_free_zone_lowprio(size_t count, zone_flags_t flags,
-    pfn_t constraint, size_t hint)
+    pfn_t constraint, size_t hint, unsigned int node)
 {
 	for (size_t pos = 0; pos < zones.count; pos++) {
 		size_t i = (pos + hint) % zones.count;
@@ -299,6 +317,9 @@ NO_TRACE static size_t find_free_zone_lowprio(size_t count, zone_flags_t flags,
 		if (!ZONE_FLAGS_MATCH(zones.info[i].flags, flags))
 			continue;
 
+		if ((node != NUMA_NODE_ANY) && (zones.info[i].node != node))
+			continue;
+
 		/* Check if the zone can satisfy the allocation request. */
 		if (zone_can_alloc(&zones.info[i], count, constraint))
 			return i;
@@ -309,7 +330,7 @@ NO_TRACE static size_t find_free_zone_lowprio(size_t count, zone_flags_t flags,
 
 /** Find a zone that can allocate specified number of frames
  *
- * Assume interrupts are disabled and zones lock is
+ * Zones on the NUMA node of the current CPU are preferred. Assume interrupts are disabled and zones lock is
  * locked.
  *
  * @param count      Number of free frames we are trying to find.
@@ -328,17 +349,29 @@ NO_TRACE static size_t find_free_zone(size_t count, zone_flags_t flags,
 	if (hint >= zones.count)
 		hint = 0;
 
+	size_t znum;
+
 	/*
-	 * Prefer zones with low-priority memory over
-	 * zones with high-priority memory.
+	 * Prefer node-local zones with low-priority memory, then
+	 * low-priority memory anywhere and only then zones with
+	 * high-priority memory.
 	 */
 
-	size_t znum = find_free_zone_lowprio(count, flags, constraint, hint);
+	if ((numa_node_count > 1) && (CPU != NULL)) {
+		znum = find_free_zone_lowprio(count, flags, constraint, hint,
+		    CPU->node);
+		if (znum != (size_t) -1)
+			return znum;
+	}
+
+	znum = find_free_zone_lowprio(count, flags, constraint, hint,
+	    NUMA_NODE_ANY);
 	if (znum != (size_t) -1)
 		return znum;
 
 	/* Take all zones into account */
-	return find_free_zone_all(count, flags, constraint, hint);
+	return find_free_zone_all(count, flags, constraint, hint,
+	    NUMA_NODE_ANY);
 }
 
 /******************/
@@ -544,7 +577,8 @@ bool zone_merge(size_t z1, size_t z2)
 	 * set of flags
 	 */
 	if ((z1 >= zones.count) || (z2 >= zones.count) || (z2 - z1 != 1) ||
-	    (zones.info[z1].flags != zones.info[z2].flags)) {
+	    (zones.info[z1].flags != zones.info[z2].flags) ||
+	    (zones.info[z1].node != zones.info[z2].node)) {
 		ret = false;
 		goto errout;
 	}
@@ -611,6 +645,22 @@ void zone_merge_all(void)
 	}
 }
 
+/** Tag all zones with the NUMA nodes their memory belongs to.
+ *
+ * Zones are created before the firmware NUMA tables are parsed. A zone
+ * spanning several nodes is attributed to the node of its first frame.
+ *
+ */
+void zones_numa_update(void)
+{
+	irq_spinlock_lock(&zones.lock, true);
+
+	for (size_t i = 0; i < zones.count; i++)
+		zones.info[i].node = numa_node_of_addr(PFN2ADDR(zones.info[i].base));
+
+	irq_spinlock_unlock(&zones.lock, true);
+}
+
 /** Create new frame zone.
  *
  * @param zone     Zone to construct.
@@ -628,6 +678,7 @@ NO_TRACE static void zone_construct(zone_t *zone, pfn_t start, size_t count,
 	zone->base = start;
 	zone->count = count;
 	zone->flags = flags;
+	zone->node = numa_node_of_addr(PFN2ADDR(start));
 	zone->free_count = count;
 	zone->busy_count = 0;
 
@@ -815,6 +866,293 @@ void *frame_get_parent(pfn_t pfn, size_t hint)
 	return res;
 }
 
+/** Get the number of references to frame. */
+size_t frame_refcount_get(pfn_t pfn)
+{
+	irq_spinlock_lock(&zones.lock, true);
+
+	size_t znum = find_zone(pfn, 1, 0);
+
+	assert(znum != (size_t) -1);
+
+	size_t refcount = zone_get_frame(&zones.info[znum],
+	    pfn - zones.info[znum].base)->refcount;
+
+	irq_spinlock_unlock(&zones.lock, true);
+
+	return refcount;
+}
+
+/** Wake up threads waiting for free memory.
+ *
+ * @param freed Number of frames which have been returned to the zones.
+ *
+ */
+static void mem_avail_signal(size_t freed)
+{
+	/*
+	 * Since the mem_avail_mtx is an active mutex,
+	 * we need to disable interruptsto prevent deadlock
+	 * with TLB shootdown.
+	 */
+
+	ipl_t ipl = interrupts_disable();
+	mutex_lock(&mem_avail_mtx);
+
+	if (mem_avail_req > 0)
+		mem_avail_req -= min(mem_avail_req, freed);
+
+	if (mem_avail_req == 0) {
+		mem_avail_gen++;
+		condvar_broadcast(&mem_avail_cv);
+	}
+
+	mutex_unlock(&mem_avail_mtx);
+	interrupts_restore(ipl);
+}
+
+/********************************/
+/* Per-CPU free frame functions */
+/********************************/
+
+/** Initialize per-CPU free frame cache.
+ *
+ * @param pcp Per-CPU free frame cache.
+ *
+ */
+void frame_pcp_initialize(frame_pcp_t *pcp)
+{
+	irq_spinlock_initialize(&pcp->lock, "cpu.frame_pcp.lock");
+	pcp->zone = 0;
+	pcp->count = 0;
+	pcp->pending_count = 0;
+}
+
+/** Refill per-CPU free frame cache from the zones.
+ *
+ * Assume interrupts are disabled and the cache is locked.
+ *
+ * @param pcp   Per-CPU free frame cache.
+ * @param batch Number of frames to take.
+ *
+ */
+NO_TRACE static void frame_pcp_refill(frame_pcp_t *pcp, size_t batch)
+{
+	assert(irq_spinlock_locked(&pcp->lock));
+
+	irq_spinlock_lock(&zones.lock, false);
+
+	while ((batch-- > 0) && (pcp->count < FRAME_PCP_MAX)) {
+		size_t znum = find_free_zone(1, FRAME_PCP_ZONE_FLAGS, 0,
+		    pcp->zone);
+		if (znum == (size_t) -1)
+			break;
+
+		pcp->frames[pcp->count++] = zones.info[znum].base +
+		    zone_frame_alloc(&zones.info[znum], 1, 0);
+		pcp->zone = znum;
+	}
+
+	irq_spinlock_unlock(&zones.lock, false);
+}
+
+/** Release pending frames and trim per-CPU free frame cache.
+ *
+ * The reference counts of the pending frames are dropped. The frames which
+ * become free are kept in the cache as long as there are less than @a keep
+ * cached frames, the rest is returned to the zones.
+ *
+ * Assume interrupts are disabled and the cache is locked.
+ *
+ * @param pcp      Per-CPU free frame cache.
+ * @param keep     Maximum number of cached frames to keep.
+ * @param freed    Incremented by the number of frames which became free.
+ * @param released Incremented by the number of frames returned to the zones.
+ *
+ */
+NO_TRACE static void frame_pcp_flush(frame_pcp_t *pcp, size_t keep,
+    size_t *freed, size_t *released)
+{
+	assert(irq_spinlock_locked(&pcp->lock));
+	assert(keep <= FRAME_PCP_MAX);
+
+	irq_spinlock_lock(&zones.lock, false);
+
+	for (size_t i = 0; i < pcp->pending_count; i++) {
+		pfn_t pfn = pcp->pending[i];
+		size_t znum = find_zone(pfn, 1, pcp->zone);
+
+		assert(znum != (size_t) -1);
+
+		zone_t *zone = &zones.info[znum];
+		frame_t *frame = zone_get_frame(zone, pfn - zone->base);
+
+		assert(frame->refcount > 0);
+
+		if (frame->refcount > 1) {
+			/* Still shared */
+			frame->refcount--;
+			continue;
+		}
+
+		(*freed)++;
+
+		if ((pcp->count < keep) &&
+		    (ZONE_FLAGS_MATCH(zone->flags, FRAME_PCP_ZONE_FLAGS))) {
+			/* Keep the last reference on behalf of the cache */
+			pcp->frames[pcp->count++] = pfn;
+			continue;
+		}
+
+		*released += zone_frame_free(zone, pfn - zone->base);
+	}
+
+	pcp->pending_count = 0;
+
+	while (pcp->count > keep) {
+		pfn_t pfn = pcp->frames[--pcp->count];
+		size_t znum = find_zone(pfn, 1, pcp->zone);
+
+		assert(znum != (size_t) -1);
+
+		*released += zone_frame_free(&zones.info[znum],
+		    pfn - zones.info[znum].base);
+	}
+
+	irq_spinlock_unlock(&zones.lock, false);
+}
+
+/** Allocate a single frame from the per-CPU free frame cache.
+ *
+ * @param constraint Indication of bits that cannot be set in the
+ *                   physical frame number of the allocated frame.
+ * @param pfn        Place to store the allocated frame number to.
+ * @param pzone      If not NULL, place to store the zone hint to.
+ *
+ * @return True if the frame has been allocated.
+ *
+ */
+NO_TRACE static bool frame_pcp_alloc(pfn_t constraint, pfn_t *pfn,
+    size_t *pzone)
+{
+	size_t batch = frame_pcp_batch;
+
+	if ((!CPU) || (batch == 0))
+		return false;
+
+	frame_pcp_t *pcp = &CPU->frame_pcp;
+	irq_spinlock_lock(&pcp->lock, true);
+
+	if (pcp->count == 0)
+		frame_pcp_refill(pcp, batch);
+
+	if ((pcp->count == 0) ||
+	    ((pcp->frames[pcp->count - 1] & constraint) != 0)) {
+		irq_spinlock_unlock(&pcp->lock, true);
+		return false;
+	}
+
+	*pfn = pcp->frames[--pcp->count];
+	if (pzone)
+		*pzone = pcp->zone;
+
+	irq_spinlock_unlock(&pcp->lock, true);
+	return true;
+}
+
+/** Free a single frame into the per-CPU free frame cache.
+ *
+ * @param pfn Frame number of the frame to be freed.
+ *
+ * @return True if the frame has been queued for release.
+ *
+ */
+NO_TRACE static bool frame_pcp_free(pfn_t pfn)
+{
+	size_t batch = frame_pcp_batch;
+
+	/*
+	 * Do not defer the release if somebody is waiting for memory.
+	 * The unlocked read of mem_avail_req is only a heuristic.
+	 */
+	if ((!CPU) || (batch == 0) || (mem_avail_req > 0))
+		return false;
+
+	frame_pcp_t *pcp = &CPU->frame_pcp;
+	irq_spinlock_lock(&pcp->lock, true);
+
+	if (pcp->pending_count == FRAME_PCP_MAX) {
+		irq_spinlock_unlock(&pcp->lock, true);
+		return false;
+	}
+
+	pcp->pending[pcp->pending_count++] = pfn;
+
+	size_t freed = 0;
+	size_t released = 0;
+
+	bool flush = (pcp->pending_count >= batch);
+	if (flush)
+		frame_pcp_flush(pcp, 2 * batch, &freed, &released);
+
+	irq_spinlock_unlock(&pcp->lock, true);
+
+	if (flush) {
+		reserve_free(freed);
+		mem_avail_signal(released);
+	}
+
+	return true;
+}
+
+/** Return all frames from the per-CPU free frame caches to the zones.
+ *
+ * This is used when the system runs low on memory and after the
+ * slab allocator reclaimed memory, because the frames freed by the
+ * slab allocator might be still pending in the per-CPU caches.
+ *
+ */
+void frame_pcp_drain_all(void)
+{
+	/* The CPU structures might not exist yet */
+	if (!cpus)
+		return;
+
+	size_t freed = 0;
+	size_t released = 0;
+
+	for (unsigned int i = 0; i < config.cpu_count; i++) {
+		frame_pcp_t *pcp = &cpus[i].frame_pcp;
+
+		irq_spinlock_lock(&pcp->lock, true);
+		frame_pcp_flush(pcp, 0, &freed, &released);
+		irq_spinlock_unlock(&pcp->lock, true);
+	}
+
+	reserve_free(freed);
+
+	if (released > 0)
+		mem_avail_signal(released);
+}
+
+/** Set the number of frames moved between the zones and a per-CPU cache.
+ *
+ * @param batch New batch size, zero disables the per-CPU caches.
+ *
+ * @return EOK on success, EINVAL if the batch size is too large.
+ *
+ */
+errno_t frame_pcp_set_batch(size_t batch)
+{
+	if (batch > FRAME_PCP_MAX / 2)
+		return EINVAL;
+
+	frame_pcp_batch = batch;
+	frame_pcp_drain_all();
+
+	return EOK;
+}
+
 /** Allocate frames of physical memory.
  *
  * @param count      Number of continuous frames to allocate.
@@ -840,6 +1178,18 @@ uintptr_t frame_alloc_generic(size_t count, frame_flags_t flags,
 	if (!(flags & FRAME_NO_RESERVE))
 		reserve_force_alloc(count);
 
+	/*
+	 * Single frames are served from the per-CPU caches so that
+	 * the zones lock does not need to be taken every time.
+	 */
+	if ((count == 1) &&
+	    (FRAME_TO_ZONE_FLAGS(flags) == FRAME_PCP_ZONE_FLAGS)) {
+		pfn_t pfn;
+
+		if (frame_pcp_alloc(frame_constraint, &pfn, pzone))
+			return PFN2ADDR(pfn);
+	}
+
 loop:
 	irq_spinlock_lock(&zones.lock, true);
 
@@ -855,21 +1205,30 @@ loop:
 	 */
 	if ((znum == (size_t) -1) && (!(flags & FRAME_NO_RECLAIM))) {
 		irq_spinlock_unlock(&zones.lock, true);
-		size_t freed = slab_reclaim(0);
+
+		/* Let user space caches know as soon as possible. */
+		mem_pressure_kick();
+		(void) slab_reclaim(0);
+
+		/*
+		 * The frames released by the slab allocator, as well as
+		 * the frames cached by other CPUs, may be sitting in the
+		 * per-CPU caches. Return them to the zones before retrying.
+		 */
+		frame_pcp_drain_all();
 		irq_spinlock_lock(&zones.lock, true);
 
-		if (freed > 0)
-			znum = find_free_zone(count, FRAME_TO_ZONE_FLAGS(flags),
-			    frame_constraint, hint);
+		znum = find_free_zone(count, FRAME_TO_ZONE_FLAGS(flags),
+		    frame_constraint, hint);
 
 		if (znum == (size_t) -1) {
 			irq_spinlock_unlock(&zones.lock, true);
-			freed = slab_reclaim(SLAB_RECLAIM_ALL);
+			(void) slab_reclaim(SLAB_RECLAIM_ALL);
+			frame_pcp_drain_all();
 			irq_spinlock_lock(&zones.lock, true);
 
-			if (freed > 0)
-				znum = find_free_zone(count, FRAME_TO_ZONE_FLAGS(flags),
-				    frame_constraint, hint);
+			znum = find_free_zone(count, FRAME_TO_ZONE_FLAGS(flags),
+			    frame_constraint, hint);
 		}
 	}
 
@@ -958,6 +1317,11 @@ uintptr_t frame_alloc(size_t count, frame_flags_t flags, uintptr_t constraint)
  */
 void frame_free_generic(uintptr_t start, size_t count, frame_flags_t flags)
 {
+	/* Queue single frames in the per-CPU caches */
+	if ((count == 1) && (!(flags & FRAME_NO_RESERVE)) &&
+	    (frame_pcp_free(ADDR2PFN(start))))
+		return;
+
 	size_t freed = 0;
 
 	irq_spinlock_lock(&zones.lock, true);
@@ -977,26 +1341,8 @@ void frame_free_generic(uintptr_t start, size_t count, frame_flags_t flags)
 
 	irq_spinlock_unlock(&zones.lock, true);
 
-	/*
-	 * Signal that some memory has been freed.
-	 * Since the mem_avail_mtx is an active mutex,
-	 * we need to disable interruptsto prevent deadlock
-	 * with TLB shootdown.
-	 */
-
-	ipl_t ipl = interrupts_disable();
-	mutex_lock(&mem_avail_mtx);
-
-	if (mem_avail_req > 0)
-		mem_avail_req -= min(mem_avail_req, freed);
-
-	if (mem_avail_req == 0) {
-		mem_avail_gen++;
-		condvar_broadcast(&mem_avail_cv);
-	}
-
-	mutex_unlock(&mem_avail_mtx);
-	interrupts_restore(ipl);
+	/* Signal that some memory has been freed. */
+	mem_avail_signal(freed);
 
 	if (!(flags & FRAME_NO_RESERVE))
 		reserve_free(freed);
@@ -1064,6 +1410,7 @@ void frame_init(void)
 	if (config.cpu_active == 1) {
 		zones.count = 0;
 		irq_spinlock_initialize(&zones.lock, "frame.zones.lock");
+		irq_spinlock_set_kind(&zones.lock, SPINLOCK_MCS);
 		mutex_initialize(&mem_avail_mtx, MUTEX_ACTIVE);
 		condvar_initialize(&mem_avail_cv);
 	}
@@ -1328,6 +1675,7 @@ void zone_print_one(size_t num)
 	pfn_t fbase = zones.info[znum].base;
 	uintptr_t base = PFN2ADDR(fbase);
 	zone_flags_t flags = zones.info[znum].flags;
+	unsigned int node = zones.info[znum].node;
 	size_t count = zones.info[znum].count;
 	size_t free_count = zones.info[znum].free_count;
 	size_t busy_count = zones.info[znum].busy_count;
@@ -1380,6 +1728,7 @@ void zone_print_one(size_t num)
 	    (flags & ZONE_FIRMWARE) ? 'F' : '-',
 	    (flags & ZONE_LOWMEM) ? 'L' : '-',
 	    (flags & ZONE_HIGHMEM) ? 'H' : '-');
+	printf("Zone NUMA node:          %u\n", node);
 
 	if (available) {
 		bin_order_suffix(FRAMES2SIZE(busy_count), &size, &size_suffix,
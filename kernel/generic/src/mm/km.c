@@ -68,7 +68,8 @@ static unsigned km_flush_deferred(void)
 	unsigned i = 0;
 	ipl_t ipl;
 
-	ipl = tlb_shootdown_start(TLB_INVL_ASID, ASID_KERNEL, 0, 0);
+	ipl = tlb_shootdown_start(AS_KERNEL, TLB_INVL_ASID, ASID_KERNEL,
+	    0, 0);
 
 	for (i = 0; i < deferred_pages; i++) {
 		page_mapping_remove(AS_KERNEL, deferred_page[i]);
@@ -93,7 +94,7 @@ void km_identity_init(void)
 /** Architecture dependent setup of non-identity-mapped kernel memory. */
 void km_non_identity_init(void)
 {
-	km_ni_arena = ra_arena_create();
+	km_ni_arena = ra_arena_create_qcache(PAGE_SIZE);
 	assert(km_ni_arena != NULL);
 	km_non_identity_arch_init();
 	config.non_identity_configured = true;
@@ -162,7 +163,8 @@ static void km_unmap_aligned(uintptr_t vaddr, size_t size)
 
 	page_table_lock(AS_KERNEL, true);
 
-	ipl = tlb_shootdown_start(TLB_INVL_ASID, ASID_KERNEL, 0, 0);
+	ipl = tlb_shootdown_start(AS_KERNEL, TLB_INVL_ASID, ASID_KERNEL,
+	    0, 0);
 
 	for (offs = 0; offs < size; offs += PAGE_SIZE)
 		page_mapping_remove(AS_KERNEL, vaddr + offs);
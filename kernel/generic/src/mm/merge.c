@@ -0,0 +1,588 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup genericmm
+ * @{
+ */
+
+/**
+ * @file
+ * @brief Merging of identical anonymous pages.
+ *
+ * The kpagemerge thread slowly walks the private anonymous address space
+ * areas of all tasks and hashes the contents of their resident pages.
+ * Pages whose hash has already been seen during the current pass are
+ * write-protected and become stable, i.e. their frames are entered into
+ * the stable table. Pages found to be identical with a stable frame are
+ * then mapped read-only to that frame and their own frames are freed.
+ *
+ * Sharing of merged frames is tracked solely by the frame reference
+ * count, the stable table holds one reference on its own. A write to a
+ * merged page faults and the anonymous backend replaces the merged frame
+ * with a private copy. Once the stable table holds the only reference to
+ * a frame, the frame is released at the end of the pass.
+ *
+ * The memory reservation of merged pages is not given back, so that the
+ * sharing can always be broken without failing.
+ */
+
+#include <mm/merge.h>
+#include <mm/as.h>
+#include <arch/mm/as.h>
+#include <mm/page.h>
+#include <mm/frame.h>
+#include <mm/km.h>
+#include <mm/tlb.h>
+#include <genarch/mm/page_pt.h>
+#include <genarch/mm/page_ht.h>
+#include <adt/avl.h>
+#include <adt/hash.h>
+#include <adt/hash_table.h>
+#include <proc/task.h>
+#include <proc/thread.h>
+#include <synch/mutex.h>
+#include <sysinfo/sysinfo.h>
+#include <assert.h>
+#include <config.h>
+#include <panic.h>
+#include <mm/slab.h>
+#include <mem.h>
+
+/** Number of pages scanned in one step. */
+#define PAGE_MERGE_BATCH  256
+
+/** Delay between two steps of a pass (in microseconds). */
+#define PAGE_MERGE_DELAY  50000
+
+/** Delay between two passes (in microseconds). */
+#define PAGE_MERGE_PASS_DELAY  5000000
+
+/** Maximum number of hashes remembered during a pass. */
+#define PAGE_MERGE_UNSTABLE_MAX  65536
+
+/** Stable frame, i.e. a write-protected frame available for merging. */
+typedef struct {
+	ht_link_t link;
+	uint64_t hash;
+	uintptr_t frame;
+} merge_stable_t;
+
+/** Hash of a page seen during the current pass. */
+typedef struct {
+	ht_link_t link;
+	uint64_t hash;
+} merge_unstable_t;
+
+typedef struct {
+	task_id_t id;
+	task_t *task;
+} merge_task_lookup_t;
+
+/** Frame parent marking frames in the stable table. */
+static int page_merge_marker;
+
+/** Table of stable frames, accessed only by the kpagemerge thread. */
+static hash_table_t merge_stable;
+
+/** Hashes of pages seen during the current pass. */
+static hash_table_t merge_unstable;
+
+/** Number of frames in the stable table. */
+static size_t merge_shared;
+
+/** Number of frames saved by merging as of the last pass. */
+static size_t merge_saved;
+
+/** Position of the scan. */
+static struct {
+	task_id_t task;
+	uintptr_t page;
+} merge_cursor;
+
+/** Limit of the frames accessible via the identity mapping. */
+static uintptr_t merge_identity_limit;
+
+static size_t merge_stable_hash(const ht_link_t *item)
+{
+	merge_stable_t *stable = hash_table_get_inst(item, merge_stable_t,
+	    link);
+	return hash_mix64(stable->hash);
+}
+
+static size_t merge_stable_key_hash(void *key)
+{
+	return hash_mix64(*(uint64_t *) key);
+}
+
+static bool merge_stable_equal(const ht_link_t *item1, const ht_link_t *item2)
+{
+	return hash_table_get_inst(item1, merge_stable_t, link)->hash ==
+	    hash_table_get_inst(item2, merge_stable_t, link)->hash;
+}
+
+static bool merge_stable_key_equal(void *key, const ht_link_t *item)
+{
+	return hash_table_get_inst(item, merge_stable_t, link)->hash ==
+	    *(uint64_t *) key;
+}
+
+static void merge_stable_remove_callback(ht_link_t *item)
+{
+	free(hash_table_get_inst(item, merge_stable_t, link));
+}
+
+static hash_table_ops_t merge_stable_ops = {
+	.hash = merge_stable_hash,
+	.key_hash = merge_stable_key_hash,
+	.equal = merge_stable_equal,
+	.key_equal = merge_stable_key_equal,
+	.remove_callback = merge_stable_remove_callback
+};
+
+static size_t merge_unstable_hash(const ht_link_t *item)
+{
+	merge_unstable_t *unstable = hash_table_get_inst(item,
+	    merge_unstable_t, link);
+	return hash_mix64(unstable->hash);
+}
+
+static bool merge_unstable_equal(const ht_link_t *item1,
+    const ht_link_t *item2)
+{
+	return hash_table_get_inst(item1, merge_unstable_t, link)->hash ==
+	    hash_table_get_inst(item2, merge_unstable_t, link)->hash;
+}
+
+static bool merge_unstable_key_equal(void *key, const ht_link_t *item)
+{
+	return hash_table_get_inst(item, merge_unstable_t, link)->hash ==
+	    *(uint64_t *) key;
+}
+
+static void merge_unstable_remove_callback(ht_link_t *item)
+{
+	free(hash_table_get_inst(item, merge_unstable_t, link));
+}
+
+static hash_table_ops_t merge_unstable_ops = {
+	.hash = merge_unstable_hash,
+	.key_hash = merge_stable_key_hash,
+	.equal = merge_unstable_equal,
+	.key_equal = merge_unstable_key_equal,
+	.remove_callback = merge_unstable_remove_callback
+};
+
+static sysarg_t page_merge_stats(struct sysinfo_item *item, void *data)
+{
+	return (sysarg_t) *((size_t *) data);
+}
+
+/** Initialize merging of identical pages. */
+void page_merge_init(void)
+{
+	if ((!hash_table_create(&merge_stable, 0, 0, &merge_stable_ops)) ||
+	    (!hash_table_create(&merge_unstable, 0, 0, &merge_unstable_ops)))
+		panic("Cannot create page merging tables.");
+
+	merge_identity_limit = KA2PA(config.identity_base) +
+	    config.identity_size;
+
+	sysinfo_set_item_gen_val("system.merge.shared", NULL,
+	    page_merge_stats, &merge_shared);
+	sysinfo_set_item_gen_val("system.merge.saved", NULL,
+	    page_merge_stats, &merge_saved);
+}
+
+/** Check whether a frame is shared by merged pages.
+ *
+ * @param frame Physical address of the frame.
+ *
+ * @return True if the frame must not be written through any mapping.
+ *
+ */
+bool page_merge_frame_merged(uintptr_t frame)
+{
+	if (merge_shared == 0)
+		return false;
+
+	return (frame_get_parent(ADDR2PFN(frame), 0) == &page_merge_marker);
+}
+
+/** Remove the mapping of a page and invalidate it in all TLBs.
+ *
+ * The address space area and page tables must be already locked.
+ *
+ */
+static void page_merge_unmap(as_t *as, uintptr_t page)
+{
+	ipl_t ipl = tlb_shootdown_start(as, TLB_INVL_PAGES, as->asid,
+	    page, 1);
+
+	page_mapping_remove(as, page);
+	tlb_invalidate_pages(as->asid, page, 1);
+
+	/*
+	 * Invalidate potential software translation caches
+	 * (e.g. TSB on sparc64, PHT on ppc32).
+	 */
+	as_invalidate_translation_cache(as, page, 1);
+	tlb_shootdown_finalize(ipl);
+}
+
+/** Replace a merged frame by a private copy.
+ *
+ * The address space area and page tables must be already locked.
+ *
+ * @param as   Address space.
+ * @param area Private anonymous address space area containing the page.
+ * @param page Virtual page.
+ *
+ * @return True if the page was mapped to a merged frame and has been
+ *         given a private writable copy of it, false if the page is not
+ *         mapped to a merged frame.
+ *
+ */
+bool page_merge_break(as_t *as, as_area_t *area, uintptr_t page)
+{
+	assert(page_table_locked(as));
+	assert(mutex_locked(&area->lock));
+
+	pte_t pte;
+	if ((!page_mapping_find(as, page, false, &pte)) ||
+	    (!PTE_VALID(&pte)) || (!PTE_PRESENT(&pte)))
+		return false;
+
+	uintptr_t merged = PTE_GET_FRAME(&pte);
+	if (!page_merge_frame_merged(merged))
+		return false;
+
+	uintptr_t frame;
+	uintptr_t kpage = km_temporary_page_get(&frame, FRAME_NO_RESERVE);
+	memcpy((void *) kpage, (void *) PA2KA(merged), PAGE_SIZE);
+	km_temporary_page_put(kpage);
+
+	page_merge_unmap(as, page);
+	page_mapping_insert(as, page, frame, as_area_get_flags(area));
+
+	/* The stable table still holds its reference. */
+	frame_free_noreserve(merged, 1);
+
+	return true;
+}
+
+/** Hash the contents of a frame. */
+static uint64_t page_merge_hash(uintptr_t frame)
+{
+	const uint64_t *data = (const uint64_t *) PA2KA(frame);
+	uint64_t hash = 0xcbf29ce484222325ULL;
+
+	/* FNV-1a over 64-bit words */
+	for (size_t i = 0; i < PAGE_SIZE / sizeof(uint64_t); i++)
+		hash = (hash ^ data[i]) * 0x100000001b3ULL;
+
+	return hash;
+}
+
+/** Try to merge a page with a stable frame.
+ *
+ * @return True if the page has been merged.
+ *
+ */
+static bool page_merge_try(as_t *as, as_area_t *area, uintptr_t page,
+    uintptr_t frame, uintptr_t stable)
+{
+	unsigned int flags = as_area_get_flags(area);
+
+	/*
+	 * Unmap the page first so that it cannot change while it is being
+	 * compared. Faults on the page wait for the area lock.
+	 */
+	page_merge_unmap(as, page);
+
+	if (memcmp((void *) PA2KA(frame), (void *) PA2KA(stable),
+	    PAGE_SIZE) != 0) {
+		page_mapping_insert(as, page, frame, flags);
+		return false;
+	}
+
+	frame_reference_add(ADDR2PFN(stable));
+	page_mapping_insert(as, page, stable, flags & ~PAGE_WRITE);
+	frame_free_noreserve(frame, 1);
+
+	return true;
+}
+
+/** Make the frame of a page stable. */
+static void page_merge_promote(as_t *as, as_area_t *area, uintptr_t page,
+    uintptr_t frame)
+{
+	merge_stable_t *stable = malloc(sizeof(merge_stable_t));
+	if (!stable)
+		return;
+
+	page_merge_unmap(as, page);
+	page_mapping_insert(as, page, frame,
+	    as_area_get_flags(area) & ~PAGE_WRITE);
+
+	/* The page might have changed before it was write-protected. */
+	stable->hash = page_merge_hash(frame);
+	stable->frame = frame;
+
+	frame_reference_add(ADDR2PFN(frame));
+	frame_set_parent(ADDR2PFN(frame), &page_merge_marker, 0);
+
+	hash_table_insert(&merge_stable, &stable->link);
+	merge_shared++;
+}
+
+/** Scan a single page.
+ *
+ * The address space area and page tables must be already locked.
+ *
+ */
+static void page_merge_page(as_t *as, as_area_t *area, uintptr_t page)
+{
+	pte_t pte;
+	if ((!page_mapping_find(as, page, false, &pte)) ||
+	    (!PTE_VALID(&pte)) || (!PTE_PRESENT(&pte)))
+		return;
+
+	uintptr_t frame = PTE_GET_FRAME(&pte);
+	if (frame + PAGE_SIZE > merge_identity_limit)
+		return;
+
+	/*
+	 * Frames which are already merged, pinned or shared otherwise have
+	 * more than one reference.
+	 */
+	if (frame_refcount_get(ADDR2PFN(frame)) != 1)
+		return;
+
+	uint64_t hash = page_merge_hash(frame);
+
+	ht_link_t *link = hash_table_find(&merge_stable, &hash);
+	if (link != NULL) {
+		merge_stable_t *stable = hash_table_get_inst(link,
+		    merge_stable_t, link);
+		(void) page_merge_try(as, area, page, frame, stable->frame);
+		return;
+	}
+
+	if (hash_table_find(&merge_unstable, &hash) != NULL) {
+		page_merge_promote(as, area, page, frame);
+		return;
+	}
+
+	if (hash_table_size(&merge_unstable) >= PAGE_MERGE_UNSTABLE_MAX)
+		return;
+
+	merge_unstable_t *unstable = malloc(sizeof(merge_unstable_t));
+	if (unstable) {
+		unstable->hash = hash;
+		hash_table_insert(&merge_unstable, &unstable->link);
+	}
+}
+
+/** Check whether the pages of an address space area can be merged.
+ *
+ * The address space area must be already locked.
+ *
+ */
+static bool page_merge_eligible(as_area_t *area)
+{
+	unsigned int required = AS_AREA_READ | AS_AREA_CACHEABLE;
+
+	if ((area->backend != &anon_backend) ||
+	    (area->attributes & AS_AREA_ATTR_PARTIAL) ||
+	    (area->flags & (AS_AREA_LATE_RESERVE | AS_AREA_LARGE)) ||
+	    ((area->flags & required) != required))
+		return false;
+
+	mutex_lock(&area->sh_info->lock);
+	bool shared = area->sh_info->shared;
+	mutex_unlock(&area->sh_info->lock);
+
+	return !shared;
+}
+
+/** Scan the resident pages of an area from the cursor position on. */
+static void page_merge_scan_area(as_t *as, as_area_t *area, size_t *budget)
+{
+	page_table_lock(as, false);
+
+	for (used_space_ival_t *ival = used_space_first(area);
+	    (ival != NULL) && (*budget > 0);
+	    ival = used_space_next(area, ival)) {
+		if (ival->page + P2SZ(ival->count) <= merge_cursor.page)
+			continue;
+
+		size_t i = 0;
+		if (merge_cursor.page > ival->page)
+			i = (merge_cursor.page - ival->page) >> PAGE_WIDTH;
+
+		for (; (i < ival->count) && (*budget > 0); i++) {
+			uintptr_t page = ival->page + P2SZ(i);
+
+			page_merge_page(as, area, page);
+			merge_cursor.page = page + PAGE_SIZE;
+			(*budget)--;
+		}
+	}
+
+	page_table_unlock(as, false);
+}
+
+static bool page_merge_task_walker(avltree_node_t *node, void *arg)
+{
+	task_t *task = avltree_get_instance(node, task_t, tasks_tree_node);
+	merge_task_lookup_t *lookup = (merge_task_lookup_t *) arg;
+
+	if (task->taskid < lookup->id)
+		return true;
+
+	lookup->task = task;
+	return false;
+}
+
+/** Scan the next batch of pages.
+ *
+ * @return True if the pass has been completed.
+ *
+ */
+static bool page_merge_scan(void)
+{
+	merge_task_lookup_t lookup = {
+		.id = merge_cursor.task,
+		.task = NULL
+	};
+	as_t *as = NULL;
+
+	irq_spinlock_lock(&tasks_lock, true);
+	avltree_walk(&tasks_tree, page_merge_task_walker, &lookup);
+	if (lookup.task != NULL) {
+		lookup.id = lookup.task->taskid;
+		as = lookup.task->as;
+		as_hold(as);
+	}
+	irq_spinlock_unlock(&tasks_lock, true);
+
+	if (as == NULL)
+		return true;
+
+	if (lookup.id != merge_cursor.task) {
+		merge_cursor.task = lookup.id;
+		merge_cursor.page = 0;
+	}
+
+	size_t budget = PAGE_MERGE_BATCH;
+
+	if (as != AS_KERNEL) {
+		mutex_lock(&as->lock);
+
+		for (as_area_t *area = as_area_first(as);
+		    (area != NULL) && (budget > 0);
+		    area = as_area_next(area)) {
+			if (area->base + P2SZ(area->pages) <= merge_cursor.page)
+				continue;
+
+			mutex_lock(&area->lock);
+			if (page_merge_eligible(area))
+				page_merge_scan_area(as, area, &budget);
+			mutex_unlock(&area->lock);
+		}
+
+		mutex_unlock(&as->lock);
+	}
+
+	as_release(as);
+
+	if (budget > 0) {
+		/* Continue with the next task. */
+		merge_cursor.task = lookup.id + 1;
+		merge_cursor.page = 0;
+	}
+
+	return false;
+}
+
+static bool page_merge_release(ht_link_t *item, void *arg)
+{
+	merge_stable_t *stable = hash_table_get_inst(item, merge_stable_t,
+	    link);
+	size_t *saved = (size_t *) arg;
+
+	size_t refcount = frame_refcount_get(ADDR2PFN(stable->frame));
+	if (refcount > 1) {
+		*saved += refcount - 2;
+		return true;
+	}
+
+	/* No page is mapped to the frame anymore. */
+	frame_set_parent(ADDR2PFN(stable->frame), NULL, 0);
+	frame_free_noreserve(stable->frame, 1);
+	hash_table_remove_item(&merge_stable, item);
+
+	return true;
+}
+
+/** Finish a pass over all tasks. */
+static void page_merge_pass_end(void)
+{
+	size_t saved = 0;
+
+	hash_table_apply(&merge_stable, page_merge_release, &saved);
+	hash_table_clear(&merge_unstable);
+
+	merge_shared = hash_table_size(&merge_stable);
+	merge_saved = saved;
+
+	merge_cursor.task = 0;
+	merge_cursor.page = 0;
+}
+
+/** Page merging thread
+ *
+ * @param arg Unused.
+ *
+ */
+void kpagemerge(void *arg)
+{
+	thread_detach(THREAD);
+
+	while (true) {
+		if (page_merge_scan()) {
+			page_merge_pass_end();
+			thread_usleep(PAGE_MERGE_PASS_DELAY);
+		} else {
+			thread_usleep(PAGE_MERGE_DELAY);
+		}
+	}
+}
+
+/** @}
+ */
@@ -0,0 +1,210 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup genericmm
+ * @{
+ */
+
+/**
+ * @file
+ * @brief NUMA topology.
+ *
+ * Firmware (e.g. ACPI SRAT and SLIT) describes which physical memory ranges
+ * and which processors belong to which proximity domain and how far the
+ * domains are from each other. This module turns proximity domains into
+ * dense node IDs usable as array indices and answers the questions the
+ * frame allocator and the scheduler ask about the topology.
+ *
+ * The topology is registered once during boot, before the application
+ * processors are started, and never changes afterwards, so no locking
+ * is needed. Until firmware registers anything, the machine is treated
+ * as a single node 0 containing all memory and all processors.
+ */
+
+#include <mm/numa.h>
+#include <mm/frame.h>
+#include <assert.h>
+#include <log.h>
+
+#define NUMA_RANGES_MAX  64
+
+typedef struct {
+	uintptr_t base;
+	size_t size;
+	unsigned int node;
+} numa_range_t;
+
+/** Number of known nodes (always at least one). */
+unsigned int numa_node_count = 1;
+
+/** Proximity domain of each node. */
+static uint32_t node_domain[NUMA_NODES_MAX];
+static unsigned int domain_count = 0;
+
+static numa_range_t ranges[NUMA_RANGES_MAX];
+static size_t range_count = 0;
+
+/** Node distance matrix, zero means "not reported". */
+static uint8_t distance[NUMA_NODES_MAX][NUMA_NODES_MAX];
+
+/** Find the node ID of a known proximity domain.
+ *
+ * @param domain Proximity domain.
+ *
+ * @return Node ID or NUMA_NODE_ANY if the domain has not been seen yet.
+ *
+ */
+unsigned int numa_node_find(uint32_t domain)
+{
+	for (unsigned int i = 0; i < domain_count; i++) {
+		if (node_domain[i] == domain)
+			return i;
+	}
+
+	return NUMA_NODE_ANY;
+}
+
+/** Translate a firmware proximity domain to a node ID.
+ *
+ * A new node ID is assigned when the domain is seen for the first time.
+ *
+ * @param domain Proximity domain.
+ *
+ * @return Node ID. Domains beyond NUMA_NODES_MAX are folded into node 0.
+ *
+ */
+unsigned int numa_node_get(uint32_t domain)
+{
+	unsigned int node = numa_node_find(domain);
+	if (node != NUMA_NODE_ANY)
+		return node;
+
+	if (domain_count == NUMA_NODES_MAX) {
+		log(LF_OTHER, LVL_WARN, "NUMA: too many proximity domains, "
+		    "folding domain %" PRIu32 " into node 0", domain);
+		return 0;
+	}
+
+	node_domain[domain_count] = domain;
+	numa_node_count = domain_count + 1;
+	return domain_count++;
+}
+
+/** Register a physical memory range belonging to a node.
+ *
+ * @param base Physical base address.
+ * @param size Size of the range in bytes.
+ * @param node Node ID obtained from numa_node_get().
+ *
+ */
+void numa_memory_add(uintptr_t base, size_t size, unsigned int node)
+{
+	assert(node < numa_node_count);
+
+	if (range_count == NUMA_RANGES_MAX) {
+		log(LF_OTHER, LVL_WARN, "NUMA: too many memory ranges, "
+		    "ignoring %p+%zu", (void *) base, size);
+		return;
+	}
+
+	ranges[range_count].base = base;
+	ranges[range_count].size = size;
+	ranges[range_count].node = node;
+	range_count++;
+}
+
+/** Find the node a physical address belongs to.
+ *
+ * @param addr Physical address.
+ *
+ * @return Node ID, 0 if the address is not covered by any range.
+ *
+ */
+unsigned int numa_node_of_addr(uintptr_t addr)
+{
+	for (size_t i = 0; i < range_count; i++) {
+		if ((addr >= ranges[i].base) &&
+		    (addr - ranges[i].base < ranges[i].size))
+			return ranges[i].node;
+	}
+
+	return 0;
+}
+
+/** Set the relative distance between two nodes.
+ *
+ * @param from Source node ID.
+ * @param to   Destination node ID.
+ * @param dist Relative distance (NUMA_DISTANCE_LOCAL is local).
+ *
+ */
+void numa_distance_set(unsigned int from, unsigned int to, uint8_t dist)
+{
+	if ((from >= NUMA_NODES_MAX) || (to >= NUMA_NODES_MAX))
+		return;
+
+	distance[from][to] = dist;
+}
+
+/** Get the relative distance between two nodes.
+ *
+ * @param from Source node ID.
+ * @param to   Destination node ID.
+ *
+ * @return Distance reported by firmware, or a default distance
+ *         if none was reported.
+ *
+ */
+uint8_t numa_distance(unsigned int from, unsigned int to)
+{
+	if ((from < NUMA_NODES_MAX) && (to < NUMA_NODES_MAX) &&
+	    (distance[from][to] != 0))
+		return distance[from][to];
+
+	return (from == to) ? NUMA_DISTANCE_LOCAL : NUMA_DISTANCE_REMOTE;
+}
+
+/** Apply the registered topology.
+ *
+ * Called once after firmware tables have been parsed. Tags the existing
+ * frame zones with the nodes their memory belongs to.
+ *
+ */
+void numa_commit(void)
+{
+	if (numa_node_count < 2)
+		return;
+
+	zones_numa_update();
+
+	log(LF_OTHER, LVL_NOTE, "NUMA: %u nodes, %zu memory ranges",
+	    numa_node_count, range_count);
+}
+
+/** @}
+ */
@@ -189,6 +189,61 @@ void page_mapping_make_global(uintptr_t base, size_t size)
 	return page_mapping_operations->mapping_make_global(base, size);
 }
 
+/** Map a large page to contiguous frames.
+ *
+ * The large page is afterwards treated as LARGE_PAGE_SIZE / PAGE_SIZE
+ * consecutive pages by page_mapping_find(). It is removed by
+ * page_mapping_remove() of its last page, unless it is split first.
+ *
+ * @param as    Address space to which the page belongs.
+ * @param page  Virtual address of the large page.
+ * @param frame Physical address of the contiguous frames.
+ * @param flags Flags to be used for mapping.
+ *
+ * @return True on success, false if large pages are not supported or
+ *         some page within the large page is already mapped.
+ *
+ */
+NO_TRACE bool page_mapping_insert_large(as_t *as, uintptr_t page,
+    uintptr_t frame, unsigned int flags)
+{
+	assert(page_table_locked(as));
+
+	assert(page_mapping_operations);
+	if (!page_mapping_operations->mapping_insert_large)
+		return false;
+
+	if (!page_mapping_operations->mapping_insert_large(as, page, frame,
+	    flags))
+		return false;
+
+	/* Repel prefetched accesses to the old mapping. */
+	memory_barrier();
+
+	return true;
+}
+
+/** Split a large mapping at page.
+ *
+ * Replace the large mapping containing page, if any, by small mappings
+ * so that the pages below page can stay mapped while page and the pages
+ * above it are removed. Nothing is done if page starts a large page.
+ * Must not be called within a TLB shootdown sequence as it may block.
+ *
+ * @param as   Address space to which the page belongs.
+ * @param page Virtual address of the page.
+ *
+ */
+NO_TRACE void page_mapping_split(as_t *as, uintptr_t page)
+{
+	assert(page_table_locked(as));
+
+	assert(page_mapping_operations);
+	if (page_mapping_operations->mapping_split)
+		page_mapping_operations->mapping_split(as,
+		    ALIGN_DOWN(page, PAGE_SIZE));
+}
+
 errno_t page_find_mapping(uintptr_t virt, uintptr_t *phys)
 {
 	page_table_lock(AS, true);
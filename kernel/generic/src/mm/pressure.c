@@ -0,0 +1,206 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup genericmm
+ * @{
+ */
+
+/**
+ * @file
+ * @brief Memory pressure notifications.
+ *
+ * The kmempressure thread periodically compares the amount of free
+ * physical memory with the amount of usable memory and derives a memory
+ * pressure level. Tasks which subscribe the per-task
+ * EVENT_TASK_MEM_PRESSURE event are notified whenever the level changes
+ * and repeatedly while memory stays short, so that they can grow their
+ * caches while memory is plentiful and shrink them on demand. The frame
+ * allocator kicks the thread when it runs out of memory, so that the
+ * notification does not have to wait for the next period.
+ */
+
+#include <mm/pressure.h>
+#include <mm/frame.h>
+#include <ipc/event.h>
+#include <proc/task.h>
+#include <proc/thread.h>
+#include <synch/waitq.h>
+#include <sysinfo/sysinfo.h>
+#include <adt/avl.h>
+#include <log.h>
+
+/** Period of the memory pressure evaluation (in microseconds). */
+#define MEM_PRESSURE_PERIOD  1000000
+
+/** Free memory below which the pressure is low (in percent). */
+#define MEM_PRESSURE_LOW_PCT  10
+
+/** Free memory below which the pressure is critical (in percent). */
+#define MEM_PRESSURE_CRITICAL_PCT  3
+
+/**
+ * A level is left only after free memory exceeds its threshold by this
+ * amount (in percent) so that the level does not oscillate.
+ */
+#define MEM_PRESSURE_HYSTERESIS_PCT  2
+
+/** Number of periods after which a low pressure is reported again. */
+#define MEM_PRESSURE_LOW_REPEAT  5
+
+typedef struct {
+	mem_pressure_t level;
+	size_t free;
+	size_t total;
+} mem_pressure_msg_t;
+
+static waitq_t mem_pressure_wq;
+static bool mem_pressure_ready = false;
+static mem_pressure_t mem_pressure_level = MEM_PRESSURE_NONE;
+
+/** Initialize memory pressure tracking. */
+void mem_pressure_init(void)
+{
+	waitq_initialize(&mem_pressure_wq);
+	sysinfo_set_item_val("system.mem_pressure", NULL, MEM_PRESSURE_NONE);
+	mem_pressure_ready = true;
+}
+
+/** Ask for an immediate evaluation of the memory pressure
+ *
+ * Can be called from any context, including the frame allocator.
+ *
+ */
+void mem_pressure_kick(void)
+{
+	if (mem_pressure_ready)
+		waitq_wakeup(&mem_pressure_wq, WAKEUP_FIRST);
+}
+
+/** Get the current memory pressure level. */
+mem_pressure_t mem_pressure_get(void)
+{
+	return mem_pressure_level;
+}
+
+static mem_pressure_t mem_pressure_compute(mem_pressure_t cur,
+    uint64_t free, uint64_t usable)
+{
+	if (usable == 0)
+		return MEM_PRESSURE_NONE;
+
+	uint64_t pct = (free * 100) / usable;
+
+	if (pct < MEM_PRESSURE_CRITICAL_PCT)
+		return MEM_PRESSURE_CRITICAL;
+
+	if ((cur == MEM_PRESSURE_CRITICAL) &&
+	    (pct < MEM_PRESSURE_CRITICAL_PCT + MEM_PRESSURE_HYSTERESIS_PCT))
+		return MEM_PRESSURE_CRITICAL;
+
+	if (pct < MEM_PRESSURE_LOW_PCT)
+		return MEM_PRESSURE_LOW;
+
+	if ((cur != MEM_PRESSURE_NONE) &&
+	    (pct < MEM_PRESSURE_LOW_PCT + MEM_PRESSURE_HYSTERESIS_PCT))
+		return MEM_PRESSURE_LOW;
+
+	return MEM_PRESSURE_NONE;
+}
+
+static bool mem_pressure_notify_walker(avltree_node_t *node, void *arg)
+{
+	task_t *task = avltree_get_instance(node, task_t, tasks_tree_node);
+	mem_pressure_msg_t *msg = (mem_pressure_msg_t *) arg;
+
+	/* Tasks which have not subscribed the event are skipped. */
+	(void) event_task_notify_3(task, EVENT_TASK_MEM_PRESSURE, false,
+	    msg->level, msg->free, msg->total);
+
+	return true;
+}
+
+/** Memory pressure thread
+ *
+ * @param arg Unused.
+ *
+ */
+void kmempressure(void *arg)
+{
+	unsigned int quiet = 0;
+
+	thread_detach(THREAD);
+
+	while (true) {
+		(void) waitq_sleep_timeout(&mem_pressure_wq,
+		    MEM_PRESSURE_PERIOD, SYNCH_FLAGS_NONE, NULL);
+
+		uint64_t total;
+		uint64_t unavail;
+		uint64_t busy;
+		uint64_t free;
+		zones_stats(&total, &unavail, &busy, &free);
+
+		mem_pressure_t prev = mem_pressure_level;
+		mem_pressure_t level = mem_pressure_compute(prev, free,
+		    busy + free);
+
+		bool notify;
+		if (level != prev) {
+			mem_pressure_level = level;
+			sysinfo_set_item_val("system.mem_pressure", NULL, level);
+			log(LF_OTHER, LVL_NOTE, "Memory pressure %u -> %u "
+			    "(%" PRIu64 " of %" PRIu64 " bytes free)", prev,
+			    level, free, busy + free);
+			notify = true;
+		} else if (level == MEM_PRESSURE_CRITICAL) {
+			notify = true;
+		} else if (level == MEM_PRESSURE_LOW) {
+			notify = (++quiet >= MEM_PRESSURE_LOW_REPEAT);
+		} else {
+			notify = false;
+		}
+
+		if (!notify)
+			continue;
+
+		quiet = 0;
+
+		mem_pressure_msg_t msg = {
+			.level = level,
+			.free = SIZE2FRAMES(free),
+			.total = SIZE2FRAMES(busy + free)
+		};
+
+		irq_spinlock_lock(&tasks_lock, true);
+		avltree_walk(&tasks_tree, mem_pressure_notify_walker, &msg);
+		irq_spinlock_unlock(&tasks_lock, true);
+	}
+}
+
+/** @}
+ */
@@ -42,12 +42,35 @@
 #include <synch/spinlock.h>
 #include <typedefs.h>
 #include <arch/types.h>
+#include <arch/asm.h>
+#include <config.h>
+#include <cpu.h>
+#include <arch.h>
+
+/** Number of frames a processor takes from the global pool at once. */
+#define RESERVE_PCP_BATCH  64
+
+/** Credit above which a processor returns frames to the global pool. */
+#define RESERVE_PCP_MAX  (2 * RESERVE_PCP_BATCH)
 
 static bool reserve_initialized = false;
 
 IRQ_SPINLOCK_STATIC_INITIALIZE_NAME(reserve_lock, "reserve_lock");
 static ssize_t reserve = 0;
 
+/** Adjust the global pool.
+ *
+ * Must be called with reserve_lock held. The pool is stored atomically
+ * because reserve_pcp_put() reads it without the lock.
+ *
+ * @param delta		Number of frames to add (negative to subtract).
+ */
+static void reserve_adjust(ssize_t delta)
+{
+	assert(irq_spinlock_locked(&reserve_lock));
+	__atomic_store_n(&reserve, reserve + delta, __ATOMIC_RELAXED);
+}
+
 /** Initialize memory reservations tracking.
  *
  * This function must be called after frame zones are created and merged
@@ -59,52 +82,188 @@ void reserve_init(void)
 	reserve_initialized = true;
 }
 
-/** Try to reserve memory.
+/** Initialize a per-CPU cache of reservation credit. */
+void reserve_pcp_initialize(reserve_pcp_t *pcp)
+{
+	irq_spinlock_initialize(&pcp->lock, "reserve_pcp.lock");
+	pcp->credit = 0;
+}
+
+/** Take credit from the cache of the current processor.
  *
- * This function may not be called from contexts that do not allow memory
- * reclaiming, such as some invocations of frame_alloc_generic().
+ * @param size		Number of frames to take.
+ * @return		True if the cache held enough credit.
+ */
+static bool reserve_pcp_take(size_t size)
+{
+	if (!CPU)
+		return false;
+
+	ipl_t ipl = interrupts_disable();
+	reserve_pcp_t *pcp = &CPU->reserve_pcp;
+
+	irq_spinlock_lock(&pcp->lock, false);
+	bool taken = (pcp->credit >= size);
+	if (taken)
+		pcp->credit -= size;
+	irq_spinlock_unlock(&pcp->lock, false);
+
+	interrupts_restore(ipl);
+	return taken;
+}
+
+/** Give credit to the cache of the current processor.
  *
- * @param size		Number of frames to reserve.
+ * Credit is not cached while the global pool is overdrawn, so that
+ * cached credit cannot be reserved while other reservations are still
+ * waiting to be covered. A cache holding too much credit returns the
+ * excess to the global pool.
+ *
+ * @param size		Number of frames to give.
+ * @return		False if the frames have to be returned to the global
+ *			pool by the caller.
+ */
+static bool reserve_pcp_put(size_t size)
+{
+	if (!CPU)
+		return false;
+
+	ipl_t ipl = interrupts_disable();
+	reserve_pcp_t *pcp = &CPU->reserve_pcp;
+	size_t excess = 0;
+
+	/*
+	 * Take an atomic snapshot of the pool instead of taking
+	 * reserve_lock on this fast path. A stale value is harmless:
+	 * credit wrongly cached while the pool is overdrawn is still
+	 * accounted for, it is bounded by RESERVE_PCP_MAX per processor
+	 * and reserve_try_alloc() drains it back into the pool before
+	 * failing. Credit wrongly returned to the caller simply goes
+	 * to the pool.
+	 */
+	bool cached = (__atomic_load_n(&reserve, __ATOMIC_RELAXED) >= 0);
+
+	irq_spinlock_lock(&pcp->lock, false);
+	if (cached) {
+		pcp->credit += size;
+		if (pcp->credit > RESERVE_PCP_MAX) {
+			excess = pcp->credit - RESERVE_PCP_BATCH;
+			pcp->credit = RESERVE_PCP_BATCH;
+		}
+	}
+	irq_spinlock_unlock(&pcp->lock, false);
+
+	interrupts_restore(ipl);
+
+	if (excess > 0) {
+		irq_spinlock_lock(&reserve_lock, true);
+		reserve_adjust(excess);
+		irq_spinlock_unlock(&reserve_lock, true);
+	}
+
+	return cached;
+}
+
+/** Return the credit cached by all processors to the global pool. */
+static void reserve_pcp_drain_all(void)
+{
+	size_t drained = 0;
+
+	if (!cpus)
+		return;
+
+	for (unsigned int i = 0; i < config.cpu_count; i++) {
+		reserve_pcp_t *pcp = &cpus[i].reserve_pcp;
+
+		irq_spinlock_lock(&pcp->lock, true);
+		drained += pcp->credit;
+		pcp->credit = 0;
+		irq_spinlock_unlock(&pcp->lock, true);
+	}
+
+	if (drained > 0) {
+		irq_spinlock_lock(&reserve_lock, true);
+		reserve_adjust(drained);
+		irq_spinlock_unlock(&reserve_lock, true);
+	}
+}
+
+/** Take frames from the global pool.
+ *
+ * If the pool allows, a batch of credit for the cache of the current
+ * processor is taken along.
+ *
+ * @param size		Number of frames to take.
  * @return		True on success or false otherwise.
  */
-bool reserve_try_alloc(size_t size)
+static bool reserve_global_take(size_t size)
 {
+	size_t batch = CPU ? RESERVE_PCP_BATCH : 0;
 	bool reserved = false;
 
-	assert(reserve_initialized);
-
 	irq_spinlock_lock(&reserve_lock, true);
-	if (reserve >= 0 && (size_t) reserve >= size) {
-		reserve -= size;
+	if (reserve >= 0 && (size_t) reserve >= size + batch) {
+		reserve_adjust(-(ssize_t) (size + batch));
 		reserved = true;
-	} else {
-		/*
-		 * Some reservable frames may be cached by the slab allocator.
-		 * Try to reclaim some reservable memory. Try to be gentle for
-		 * the first time. If it does not help, try to reclaim
-		 * everything.
-		 */
-		irq_spinlock_unlock(&reserve_lock, true);
-		slab_reclaim(0);
-		irq_spinlock_lock(&reserve_lock, true);
-		if (reserve >= 0 && (size_t) reserve >= size) {
-			reserve -= size;
-			reserved = true;
-		} else {
-			irq_spinlock_unlock(&reserve_lock, true);
-			slab_reclaim(SLAB_RECLAIM_ALL);
-			irq_spinlock_lock(&reserve_lock, true);
-			if (reserve >= 0 && (size_t) reserve >= size) {
-				reserve -= size;
-				reserved = true;
-			}
-		}
+	} else if (reserve >= 0 && (size_t) reserve >= size) {
+		reserve_adjust(-(ssize_t) size);
+		reserved = true;
+		batch = 0;
 	}
 	irq_spinlock_unlock(&reserve_lock, true);
 
+	if (reserved && batch > 0 && !reserve_pcp_put(batch)) {
+		irq_spinlock_lock(&reserve_lock, true);
+		reserve_adjust(batch);
+		irq_spinlock_unlock(&reserve_lock, true);
+	}
+
 	return reserved;
 }
 
+/** Try to reserve memory.
+ *
+ * This function may not be called from contexts that do not allow memory
+ * reclaiming, such as some invocations of frame_alloc_generic().
+ *
+ * Most requests are satisfied from the credit cached by the current
+ * processor without taking the global lock.
+ *
+ * @param size		Number of frames to reserve.
+ * @return		True on success or false otherwise.
+ */
+bool reserve_try_alloc(size_t size)
+{
+	assert(reserve_initialized);
+
+	if (reserve_pcp_take(size))
+		return true;
+
+	if (reserve_global_take(size))
+		return true;
+
+	/*
+	 * Other processors may be caching some credit. Return it to the
+	 * global pool before deciding that there is not enough memory.
+	 */
+	reserve_pcp_drain_all();
+	if (reserve_global_take(size))
+		return true;
+
+	/*
+	 * Some reservable frames may be cached by the slab allocator.
+	 * Try to reclaim some reservable memory. Try to be gentle for
+	 * the first time. If it does not help, try to reclaim
+	 * everything.
+	 */
+	slab_reclaim(0);
+	if (reserve_global_take(size))
+		return true;
+
+	slab_reclaim(SLAB_RECLAIM_ALL);
+	return reserve_global_take(size);
+}
+
 /** Reserve memory.
  *
  * This function simply marks the respective amount of memory frames reserved.
@@ -119,9 +278,17 @@ void reserve_force_alloc(size_t size)
 	if (!reserve_initialized)
 		return;
 
+	if (reserve_pcp_take(size))
+		return;
+
 	irq_spinlock_lock(&reserve_lock, true);
-	reserve -= size;
+	reserve_adjust(-(ssize_t) size);
+	bool overdrawn = (reserve < 0);
 	irq_spinlock_unlock(&reserve_lock, true);
+
+	/* Cached credit must first cover the overdraft. */
+	if (overdrawn)
+		reserve_pcp_drain_all();
 }
 
 /** Unreserve memory.
@@ -133,8 +300,11 @@ void reserve_free(size_t size)
 	if (!reserve_initialized)
 		return;
 
+	if (reserve_pcp_put(size))
+		return;
+
 	irq_spinlock_lock(&reserve_lock, true);
-	reserve += size;
+	reserve_adjust(size);
 	irq_spinlock_unlock(&reserve_lock, true);
 }
 
@@ -45,8 +45,6 @@
  *
  * Following features are not currently supported but would be easy to do:
  * @li cache coloring
- * @li dynamic magazine growing (different magazine sizes are already
- *     supported, but we would need to adjust allocation strategy)
  *
  * The slab allocator supports per-CPU caches ('magazines') to facilitate
  * good SMP scaling.
@@ -66,6 +64,13 @@
  * size boundary. LIFO order is enforced, which should avoid fragmentation
  * as much as possible.
  *
+ * Magazines grow dynamically. Every cache starts with magazines of
+ * SLAB_MAG_SIZE slots. When too many acquisitions of the cache-shared
+ * magazine list lock (the 'depot') within a sampling window find the lock
+ * busy, the size of newly allocated magazines is doubled (up to
+ * SLAB_MAG_SIZE_MAX), which makes the CPUs go to the depot less often.
+ * Brutal reclaim resets the magazine size back to the initial value.
+ *
  * Every cache contains list of full slabs and list of partially full slabs.
  * Empty slabs are immediately freed (thrashing will be avoided because
  * of magazines).
@@ -106,6 +111,7 @@
 #include <mm/slab.h>
 #include <adt/list.h>
 #include <mem.h>
+#include <str.h>
 #include <align.h>
 #include <mm/frame.h>
 #include <config.h>
@@ -119,8 +125,16 @@
 IRQ_SPINLOCK_STATIC_INITIALIZE(slab_cache_lock);
 static LIST_INITIALIZE(slab_cache_list);
 
-/** Magazine cache */
-static slab_cache_t mag_cache;
+/** Magazine caches (one for each magazine size class) */
+static slab_cache_t mag_cache[SLAB_MAG_CLASSES];
+
+static const char *mag_cache_names[] = {
+	"slab_magazine_t-4",
+	"slab_magazine_t-8",
+	"slab_magazine_t-16",
+	"slab_magazine_t-32",
+	"slab_magazine_t-64"
+};
 
 /** Cache for cache descriptors */
 static slab_cache_t slab_cache_cache;
@@ -350,6 +364,48 @@ NO_TRACE static void *slab_obj_create(slab_cache_t *cache, unsigned int flags)
 /* CPU-Cache slab functions */
 /****************************/
 
+/** Return the magazine cache for magazines of the given size */
+NO_TRACE static slab_cache_t *mag_cache_of(size_t size)
+{
+	unsigned int idx = fnzb(size) - fnzb(SLAB_MAG_SIZE);
+
+	assert(idx < SLAB_MAG_CLASSES);
+	return &mag_cache[idx];
+}
+
+/** Lock the magazine list of a cache
+ *
+ * Contended acquisitions are counted and when there are too many of
+ * them within a sampling window, the size of newly allocated magazines
+ * is doubled.
+ *
+ * Interrupts must be disabled.
+ *
+ */
+NO_TRACE static void maglock_lock(slab_cache_t *cache)
+{
+	assert(interrupts_disabled());
+
+	bool contended = !irq_spinlock_trylock(&cache->maglock);
+	if (contended) {
+		if ((CPU) && (cache->mag_cache))
+			cache->mag_cache[CPU->id].contention++;
+
+		irq_spinlock_lock(&cache->maglock, false);
+		cache->mag_contention++;
+	}
+
+	if (++cache->mag_ops < SLAB_MAG_RESIZE_WINDOW)
+		return;
+
+	if ((cache->mag_contention >= SLAB_MAG_RESIZE_THRESHOLD) &&
+	    (cache->mag_size < SLAB_MAG_SIZE_MAX))
+		cache->mag_size <<= 1;
+
+	cache->mag_ops = 0;
+	cache->mag_contention = 0;
+}
+
 /** Find a full magazine in cache, take it from list and return it
  *
  * @param first If true, return first, else last mag.
@@ -361,7 +417,8 @@ NO_TRACE static slab_magazine_t *get_mag_from_cache(slab_cache_t *cache,
 	slab_magazine_t *mag = NULL;
 	link_t *cur;
 
-	irq_spinlock_lock(&cache->maglock, true);
+	ipl_t ipl = interrupts_disable();
+	maglock_lock(cache);
 	if (!list_empty(&cache->magazines)) {
 		if (first)
 			cur = list_first(&cache->magazines);
@@ -372,7 +429,8 @@ NO_TRACE static slab_magazine_t *get_mag_from_cache(slab_cache_t *cache,
 		list_remove(&mag->link);
 		atomic_dec(&cache->magazine_counter);
 	}
-	irq_spinlock_unlock(&cache->maglock, true);
+	irq_spinlock_unlock(&cache->maglock, false);
+	interrupts_restore(ipl);
 
 	return mag;
 }
@@ -383,12 +441,14 @@ NO_TRACE static slab_magazine_t *get_mag_from_cache(slab_cache_t *cache,
 NO_TRACE static void put_mag_to_cache(slab_cache_t *cache,
     slab_magazine_t *mag)
 {
-	irq_spinlock_lock(&cache->maglock, true);
+	ipl_t ipl = interrupts_disable();
+	maglock_lock(cache);
 
 	list_prepend(&mag->link, &cache->magazines);
 	atomic_inc(&cache->magazine_counter);
 
-	irq_spinlock_unlock(&cache->maglock, true);
+	irq_spinlock_unlock(&cache->maglock, false);
+	interrupts_restore(ipl);
 }
 
 /** Free all objects in magazine and free memory associated with magazine
@@ -407,7 +467,7 @@ NO_TRACE static size_t magazine_destroy(slab_cache_t *cache,
 		atomic_dec(&cache->cached_objs);
 	}
 
-	slab_free(&mag_cache, mag);
+	slab_free(mag_cache_of(mag->size), mag);
 
 	return frames;
 }
@@ -461,11 +521,13 @@ NO_TRACE static void *magazine_obj_get(slab_cache_t *cache)
 
 	slab_magazine_t *mag = get_full_current_mag(cache);
 	if (!mag) {
+		cache->mag_cache[CPU->id].misses++;
 		irq_spinlock_unlock(&cache->mag_cache[CPU->id].lock, true);
 		return NULL;
 	}
 
 	void *obj = mag->objs[--mag->busy];
+	cache->mag_cache[CPU->id].hits++;
 	irq_spinlock_unlock(&cache->mag_cache[CPU->id].lock, true);
 
 	atomic_dec(&cache->cached_objs);
@@ -508,12 +570,13 @@ NO_TRACE static slab_magazine_t *make_empty_current_mag(slab_cache_t *cache)
 	 * this would deadlock.
 	 *
 	 */
-	slab_magazine_t *newmag = slab_alloc(&mag_cache,
+	size_t size = cache->mag_size;
+	slab_magazine_t *newmag = slab_alloc(mag_cache_of(size),
 	    FRAME_ATOMIC | FRAME_NO_RECLAIM);
 	if (!newmag)
 		return NULL;
 
-	newmag->size = SLAB_MAG_SIZE;
+	newmag->size = size;
 	newmag->busy = 0;
 
 	/* Flush last to magazine list */
@@ -633,6 +696,7 @@ NO_TRACE static void _slab_cache_create(slab_cache_t *cache, const char *name,
 
 	irq_spinlock_initialize(&cache->slablock, "slab.cache.slablock");
 	irq_spinlock_initialize(&cache->maglock, "slab.cache.maglock");
+	cache->mag_size = SLAB_MAG_SIZE;
 
 	if (!(cache->flags & SLAB_CACHE_NOMAGAZINE))
 		(void) make_magcache(cache);
@@ -719,6 +783,13 @@ NO_TRACE static size_t _slab_reclaim(slab_cache_t *cache, unsigned int flags)
 
 			irq_spinlock_unlock(&cache->mag_cache[i].lock, true);
 		}
+
+		/* Start growing the magazines from scratch */
+		irq_spinlock_lock(&cache->maglock, true);
+		cache->mag_size = SLAB_MAG_SIZE;
+		cache->mag_ops = 0;
+		cache->mag_contention = 0;
+		irq_spinlock_unlock(&cache->maglock, true);
 	}
 
 	return frames;
@@ -889,13 +960,76 @@ void slab_print_list(void)
 	}
 }
 
+/** Gather statistics about slab caches
+ *
+ * @param stats Array to store the statistics to (may be NULL).
+ * @param count Number of entries in the array.
+ * @param cpu   CPU whose magazine counters to report or
+ *              SLAB_STATS_ALL_CPUS to sum them up over all CPUs.
+ *
+ * @return Total number of slab caches (which might be larger
+ *         than the number of entries filled in).
+ *
+ */
+size_t slab_stats_get(stats_slab_t *stats, size_t count, unsigned int cpu)
+{
+	size_t total = 0;
+
+	irq_spinlock_lock(&slab_cache_lock, true);
+
+	list_foreach(slab_cache_list, link, slab_cache_t, cache) {
+		if (total < count) {
+			stats_slab_t *cur = &stats[total];
+
+			str_cpy(cur->name, SLAB_NAME_BUFLEN, cache->name);
+			cur->size = cache->size;
+			cur->slabs = atomic_get(&cache->allocated_slabs);
+			cur->allocated = atomic_get(&cache->allocated_objs);
+			cur->cached = atomic_get(&cache->cached_objs);
+			cur->mag_size = cache->mag_size;
+			cur->hits = 0;
+			cur->misses = 0;
+			cur->contention = 0;
+
+			if (!(cache->flags & SLAB_CACHE_NOMAGAZINE)) {
+				size_t i;
+				for (i = 0; i < config.cpu_count; i++) {
+					if ((cpu != SLAB_STATS_ALL_CPUS) &&
+					    (cpu != i))
+						continue;
+
+					slab_mag_cache_t *mc = &cache->mag_cache[i];
+
+					irq_spinlock_lock(&mc->lock, false);
+					cur->hits += mc->hits;
+					cur->misses += mc->misses;
+					cur->contention += mc->contention;
+					irq_spinlock_unlock(&mc->lock, false);
+				}
+			} else
+				cur->mag_size = 0;
+		}
+
+		total++;
+	}
+
+	irq_spinlock_unlock(&slab_cache_lock, true);
+
+	return total;
+}
+
 void slab_cache_init(void)
 {
-	/* Initialize magazine cache */
-	_slab_cache_create(&mag_cache, "slab_magazine_t",
-	    sizeof(slab_magazine_t) + SLAB_MAG_SIZE * sizeof(void *),
-	    sizeof(uintptr_t), NULL, NULL, SLAB_CACHE_NOMAGAZINE |
-	    SLAB_CACHE_SLINSIDE);
+	size_t i;
+	size_t size;
+
+	/* Initialize magazine caches */
+	for (i = 0; i < SLAB_MAG_CLASSES; i++) {
+		_slab_cache_create(&mag_cache[i], mag_cache_names[i],
+		    sizeof(slab_magazine_t) + (SLAB_MAG_SIZE << i) *
+		    sizeof(void *), sizeof(uintptr_t), NULL, NULL,
+		    SLAB_CACHE_NOMAGAZINE | SLAB_CACHE_SLINSIDE);
+	}
 
 	/* Initialize slab_cache cache */
 	_slab_cache_create(&slab_cache_cache, "slab_cache_cache",
@@ -907,9 +1041,6 @@ void slab_cache_init(void)
 	    NULL, NULL, SLAB_CACHE_SLINSIDE | SLAB_CACHE_MAGDEFERRED);
 
 	/* Initialize structures for malloc */
-	size_t i;
-	size_t size;
-
 	for (i = 0, size = (1 << SLAB_MIN_MALLOC_W);
 	    i < (SLAB_MAX_MALLOC_W - SLAB_MIN_MALLOC_W + 1);
 	    i++, size <<= 1) {
@@ -35,12 +35,20 @@
  * @brief Generic TLB shootdown algorithm.
  *
  * The algorithm implemented here is based on the CMU TLB shootdown
- * algorithm and is further simplified (e.g. all CPUs receive all TLB
- * shootdown messages).
+ * algorithm and is further simplified.
+ *
+ * Only the processors which have the address space in question
+ * installed are interrupted. Processors which merely have stale
+ * entries of the address space cached receive the message lazily
+ * and process it the next time they switch address spaces. Address
+ * spaces keep track of the processors they have been installed on
+ * in their cpu_mask.
  */
 
 #include <mm/tlb.h>
 #include <mm/asid.h>
+#include <mm/as.h>
+#include <mm/page.h>
 #include <arch/mm/tlb.h>
 #include <assert.h>
 #include <smp/ipi.h>
@@ -51,11 +59,7 @@
 #include <arch.h>
 #include <panic.h>
 #include <cpu.h>
-
-void tlb_init(void)
-{
-	tlb_arch_init();
-}
+#include <cpu/cpu_mask.h>
 
 #ifdef CONFIG_SMP
 
@@ -67,11 +71,120 @@ void tlb_init(void)
  */
 IRQ_SPINLOCK_STATIC_INITIALIZE(tlblock);
 
+#endif /* CONFIG_SMP */
+
+void tlb_init(void)
+{
+#ifdef CONFIG_SMP
+	/* All processors may contend for tlblock during a shootdown. */
+	if (config.cpu_active == 1)
+		irq_spinlock_set_kind(&tlblock, SPINLOCK_MCS);
+#endif
+
+	tlb_arch_init();
+}
+
+#ifdef CONFIG_SMP
+
+/** Enqueue TLB shootdown message.
+ *
+ * Messages already covered by a queued message are dropped
+ * and adjacent page ranges are coalesced, so that a series of
+ * shootdowns which a processor receives lazily takes as little
+ * room in its queue as possible.
+ *
+ * @param cpu   Recipient processor. Its lock must be held.
+ * @param type  Type describing scope of shootdown.
+ * @param asid  Address space, if required by type.
+ * @param page  Virtual page address, if required by type.
+ * @param count Number of pages, if required by type.
+ *
+ */
+static void tlb_message_enqueue(cpu_t *cpu, tlb_invalidate_type_t type,
+    asid_t asid, uintptr_t page, size_t count)
+{
+	size_t i;
+	for (i = 0; i < cpu->tlb_messages_count; i++) {
+		tlb_shootdown_msg_t *msg = &cpu->tlb_messages[i];
+
+		if (msg->type == TLB_INVL_ALL)
+			return;
+
+		if ((type != TLB_INVL_ALL) && (msg->type == TLB_INVL_ASID) &&
+		    (msg->asid == asid))
+			return;
+	}
+
+	if ((type == TLB_INVL_PAGES) && (cpu->tlb_messages_count > 0)) {
+		tlb_shootdown_msg_t *last =
+		    &cpu->tlb_messages[cpu->tlb_messages_count - 1];
+
+		if ((last->type == TLB_INVL_PAGES) && (last->asid == asid)) {
+			uintptr_t last_end = last->page + P2SZ(last->count);
+			uintptr_t end = page + P2SZ(count);
+
+			if ((page <= last_end) && (end >= last->page)) {
+				if (page < last->page)
+					last->page = page;
+				if (end > last_end)
+					last_end = end;
+				last->count = (last_end - last->page) >> PAGE_WIDTH;
+				return;
+			}
+		}
+	}
+
+	if (cpu->tlb_messages_count == TLB_MESSAGE_QUEUE_LEN) {
+		/*
+		 * The message queue is full.
+		 * Erase the queue and store one TLB_INVL_ALL message.
+		 */
+		cpu->tlb_messages_count = 1;
+		cpu->tlb_messages[0].type = TLB_INVL_ALL;
+		cpu->tlb_messages[0].asid = ASID_INVALID;
+		cpu->tlb_messages[0].page = 0;
+		cpu->tlb_messages[0].count = 0;
+	} else {
+		/*
+		 * Enqueue the message.
+		 */
+		size_t idx = cpu->tlb_messages_count++;
+		cpu->tlb_messages[idx].type = type;
+		cpu->tlb_messages[idx].asid = asid;
+		cpu->tlb_messages[idx].page = page;
+		cpu->tlb_messages[idx].count = count;
+	}
+}
+
+/** Interrupt processors with a pending TLB shootdown message.
+ *
+ * @param targets   Processors to interrupt.
+ * @param ntargets  Number of processors in @a targets.
+ *
+ */
+static void tlb_shootdown_ipi_send(cpu_mask_t *targets, size_t ntargets)
+{
+	if (ntargets == 0)
+		return;
+
+	if (ntargets == config.cpu_count - 1) {
+		ipi_broadcast(VECTOR_TLB_SHOOTDOWN_IPI);
+		return;
+	}
+
+	cpu_mask_for_each(*targets, i)
+		ipi_unicast(i, VECTOR_TLB_SHOOTDOWN_IPI);
+}
+
 /** Send TLB shootdown message.
  *
- * This function attempts to deliver TLB shootdown message
- * to all other processors.
+ * This function attempts to deliver TLB shootdown message to all
+ * other processors which may have the address space cached. Only
+ * processors which have the address space currently installed are
+ * interrupted and waited for.
  *
+ * @param as    Address space whose mappings are being changed or NULL
+ *              if the shootdown concerns all processors.
  * @param type  Type describing scope of shootdown.
  * @param asid  Address space, if required by type.
  * @param page  Virtual page address, if required by type.
@@ -80,49 +193,45 @@ IRQ_SPINLOCK_STATIC_INITIALIZE(tlblock);
  * @return The interrupt priority level as it existed prior to this call.
  *
  */
-ipl_t tlb_shootdown_start(tlb_invalidate_type_t type, asid_t asid,
+ipl_t tlb_shootdown_start(as_t *as, tlb_invalidate_type_t type, asid_t asid,
     uintptr_t page, size_t count)
 {
+	DEFINE_CPU_MASK(targets);
+	size_t ntargets = 0;
+
+	bool global = (as == NULL) || (as == AS_KERNEL) ||
+	    (as->cpu_mask == NULL);
+
 	ipl_t ipl = interrupts_disable();
 	CPU->tlb_active = false;
 	irq_spinlock_lock(&tlblock, false);
 
+	cpu_mask_none(targets);
+
 	size_t i;
 	for (i = 0; i < config.cpu_count; i++) {
 		if (i == CPU->id)
 			continue;
 
+		if ((!global) && (!cpu_mask_is_set(as->cpu_mask, i)))
+			continue;
+
 		cpu_t *cpu = &cpus[i];
 
 		irq_spinlock_lock(&cpu->lock, false);
-		if (cpu->tlb_messages_count == TLB_MESSAGE_QUEUE_LEN) {
-			/*
-			 * The message queue is full.
-			 * Erase the queue and store one TLB_INVL_ALL message.
-			 */
-			cpu->tlb_messages_count = 1;
-			cpu->tlb_messages[0].type = TLB_INVL_ALL;
-			cpu->tlb_messages[0].asid = ASID_INVALID;
-			cpu->tlb_messages[0].page = 0;
-			cpu->tlb_messages[0].count = 0;
-		} else {
-			/*
-			 * Enqueue the message.
-			 */
-			size_t idx = cpu->tlb_messages_count++;
-			cpu->tlb_messages[idx].type = type;
-			cpu->tlb_messages[idx].asid = asid;
-			cpu->tlb_messages[idx].page = page;
-			cpu->tlb_messages[idx].count = count;
+		tlb_message_enqueue(cpu, type, asid, page, count);
+		if ((global) || (cpu->tlb_as == as)) {
+			cpu_mask_set(targets, i);
+			ntargets++;
 		}
 		irq_spinlock_unlock(&cpu->lock, false);
 	}
 
-	tlb_shootdown_ipi_send();
+	tlb_shootdown_ipi_send(targets, ntargets);
 
 busy_wait:
-	for (i = 0; i < config.cpu_count; i++) {
-		if (cpus[i].tlb_active)
+	cpu_mask_for_each(*targets, j) {
+		if (cpus[j].tlb_active)
 			goto busy_wait;
 	}
 
@@ -141,22 +250,13 @@ void tlb_shootdown_finalize(ipl_t ipl)
 	interrupts_restore(ipl);
 }
 
-void tlb_shootdown_ipi_send(void)
-{
-	ipi_broadcast(VECTOR_TLB_SHOOTDOWN_IPI);
-}
-
-/** Receive TLB shootdown message.
+/** Process TLB shootdown messages queued for the current processor.
+ *
+ * The caller must have waited for the sender to finalize the shootdown.
  *
  */
-void tlb_shootdown_ipi_recv(void)
+static void tlb_shootdown_process(void)
 {
-	assert(CPU);
-
-	CPU->tlb_active = false;
-	irq_spinlock_lock(&tlblock, false);
-	irq_spinlock_unlock(&tlblock, false);
-
 	irq_spinlock_lock(&CPU->lock, false);
 	assert(CPU->tlb_messages_count <= TLB_MESSAGE_QUEUE_LEN);
 
@@ -189,6 +289,65 @@ void tlb_shootdown_ipi_recv(void)
 
 	CPU->tlb_messages_count = 0;
 	irq_spinlock_unlock(&CPU->lock, false);
+}
+
+/** Receive TLB shootdown message.
+ *
+ */
+void tlb_shootdown_ipi_recv(void)
+{
+	assert(CPU);
+
+	CPU->tlb_active = false;
+	irq_spinlock_lock(&tlblock, false);
+	irq_spinlock_unlock(&tlblock, false);
+
+	tlb_shootdown_process();
+	CPU->tlb_active = true;
+}
+
+/** Prepare the current processor for running in an address space.
+ *
+ * Record the address space as installed on the current processor
+ * and process any TLB shootdown messages that were delivered to the
+ * processor lazily. If the processor is installing the address space
+ * for the first time, it is added to its cpu_mask.
+ *
+ * Must be called with interrupts disabled and asidlock held, before
+ * the address space is installed.
+ *
+ * @param as Address space being installed.
+ *
+ */
+void tlb_shootdown_as_switch(as_t *as)
+{
+	assert(interrupts_disabled());
+
+	irq_spinlock_lock(&CPU->lock, false);
+	CPU->tlb_as = as;
+	bool pending = (CPU->tlb_messages_count > 0);
+	irq_spinlock_unlock(&CPU->lock, false);
+
+	bool join = (as->cpu_mask != NULL) &&
+	    (!cpu_mask_is_set(as->cpu_mask, CPU->id));
+
+	if ((!pending) && (!join))
+		return;
+
+	/*
+	 * Wait for any shootdown in progress to finish so that the
+	 * pending messages are processed only after the mappings have
+	 * been changed. Setting the mask bit under tlblock makes sure
+	 * that a sender either sees the bit or finishes changing the
+	 * mappings before this processor starts using them.
+	 */
+	CPU->tlb_active = false;
+	irq_spinlock_lock(&tlblock, false);
+	if (join)
+		cpu_mask_set(as->cpu_mask, CPU->id);
+	irq_spinlock_unlock(&tlblock, false);
+
+	tlb_shootdown_process();
 	CPU->tlb_active = true;
 }
 
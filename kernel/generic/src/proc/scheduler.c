@@ -34,8 +34,9 @@
  * @file
  * @brief Scheduler and load balancing.
  *
- * This file contains the scheduler and kcpulb kernel thread which
- * performs load-balancing of per-CPU run queues.
+ * This file contains the scheduler, the idle work-stealing logic and
+ * kcpulb kernel thread which performs load-balancing of per-CPU run
+ * queues.
  */
 
 #include <assert.h>
@@ -47,6 +48,7 @@
 #include <mm/as.h>
 #include <time/timeout.h>
 #include <time/delay.h>
+#include <time/clock.h>
 #include <arch/asm.h>
 #include <arch/faddr.h>
 #include <arch/cycle.h>
@@ -65,6 +67,8 @@
 #include <print.h>
 #include <log.h>
 #include <stacktrace.h>
+#include <ktrace.h>
+#include <mm/numa.h>
 
 static void scheduler_separated_stack(void);
 
@@ -188,6 +192,172 @@ void scheduler_init(void)
 {
 }
 
+#ifdef CONFIG_SMP
+/** Remove a migratable thread from a run queue of another CPU
+ *
+ * The run queue is searched from the back so that the threads
+ * which would run last on the victim CPU are preferred. Only
+ * threads whose affinity allows them to run on the current CPU
+ * are considered.
+ *
+ * cpu->rq[rq].lock must be held.
+ *
+ * @param cpu Victim CPU.
+ * @param rq  Index of the victim run queue.
+ *
+ * @return Thread removed from the run queue or NULL if the run queue
+ *         contains no thread which could be migrated.
+ *
+ */
+static thread_t *steal_thread_from_rq(cpu_t *cpu, int rq)
+{
+	assert(irq_spinlock_locked(&cpu->rq[rq].lock));
+
+	link_t *link = cpu->rq[rq].rq.head.prev;
+
+	while (link != &(cpu->rq[rq].rq.head)) {
+		thread_t *thread = (thread_t *) list_get_instance(link,
+		    thread_t, rq_link);
+
+		/*
+		 * Do not steal CPU-wired threads, threads
+		 * already stolen, threads for which migration was temporarily
+		 * disabled, threads whose FPU context is still
+		 * in the CPU or threads which are not allowed
+		 * to run on this CPU.
+		 */
+		irq_spinlock_lock(&thread->lock, false);
+
+		if ((!thread->wired) && (!thread->stolen) &&
+		    (!thread->nomigrate) &&
+		    (!thread->fpu_context_engaged) &&
+		    (cpu_mask_is_set(&thread->affinity, CPU->id))) {
+			/*
+			 * Remove thread from ready queue.
+			 */
+			irq_spinlock_unlock(&thread->lock, false);
+
+			atomic_dec(&cpu->nrdy);
+			atomic_dec(&nrdy);
+
+			if (--cpu->rq[rq].n == 0)
+				rq_mask_clear(&cpu->rq_mask, rq);
+
+			list_remove(&thread->rq_link);
+
+			KTRACE(KTRACE_SCHED_MIGRATE, thread->tid, cpu->id);
+			return thread;
+		}
+
+		irq_spinlock_unlock(&thread->lock, false);
+
+		link = link->prev;
+	}
+
+	return NULL;
+}
+
+/** Steal a ready thread from a victim CPU
+ *
+ * The lowest-priority run queues of the victim are searched first.
+ * Interrupts must be disabled.
+ *
+ * @param cpu Victim CPU.
+ *
+ * @return True if a thread has been stolen and made ready
+ *         on the current CPU.
+ *
+ */
+static bool steal_thread_from_cpu(cpu_t *cpu)
+{
+	uint32_t mask = __atomic_load_n(&cpu->rq_mask, __ATOMIC_RELAXED);
+
+	while (mask != 0) {
+		int rq = fnzb32(mask);
+		mask &= ~(UINT32_C(1) << rq);
+
+		irq_spinlock_lock(&(cpu->rq[rq].lock), false);
+		thread_t *thread = steal_thread_from_rq(cpu, rq);
+		if (thread == NULL) {
+			irq_spinlock_unlock(&(cpu->rq[rq].lock), false);
+			continue;
+		}
+
+		irq_spinlock_pass(&(cpu->rq[rq].lock), &thread->lock);
+
+		thread->stolen = true;
+		thread->state = Entering;
+
+		irq_spinlock_unlock(&thread->lock, false);
+
+		/* The thread becomes ready on the current CPU */
+		thread_ready(thread);
+
+		return true;
+	}
+
+	return false;
+}
+
+/** Steal a ready thread for an idle CPU
+ *
+ * Before the current CPU goes to sleep, try to steal a ready
+ * thread from another CPU. The victim CPUs are tried in the order
+ * of increasing distance of their IDs from the ID of the current
+ * CPU, alternating between the higher and the lower neighbour.
+ * Since SMT siblings and cores of the same package are usually
+ * enumerated next to each other, this approximates a topology-aware
+ * victim selection. On NUMA machines, CPUs on the same node as the
+ * current CPU are tried before remote ones. On each victim, the
+ * lowest-priority run queues are searched first.
+ *
+ * Interrupts must be disabled.
+ *
+ * @return True if a thread has been stolen and made ready
+ *         on the current CPU.
+ *
+ */
+static bool steal_thread(void)
+{
+	assert(interrupts_disabled());
+
+	if (config.cpu_active < 2)
+		return false;
+
+	bool stolen = false;
+	unsigned int passes = (numa_node_count > 1) ? 2 : 1;
+
+	for (unsigned int pass = 0; (pass < passes) && (!stolen); pass++) {
+		for (size_t dist = 1; (dist < config.cpu_count) && (!stolen);
+		    dist++) {
+			size_t offset = (dist + 1) / 2;
+			size_t victim = (dist % 2) ? (CPU->id + offset) :
+			    (CPU->id + config.cpu_count - offset);
+			victim %= config.cpu_count;
+			cpu_t *cpu = &cpus[victim];
+
+			if ((!cpu->active) || (atomic_get(&cpu->nrdy) == 0))
+				continue;
+
+			/* Local node first, remote nodes in the second pass */
+			if ((passes > 1) &&
+			    ((cpu->node == CPU->node) != (pass == 0)))
+				continue;
+
+			stolen = steal_thread_from_cpu(cpu);
+		}
+	}
+
+	irq_spinlock_lock(&CPU->lock, false);
+	CPU->steal_attempts++;
+	if (stolen)
+		CPU->steal_successes++;
+	irq_spinlock_unlock(&CPU->lock, false);
+
+	return stolen;
+}
+#endif /* CONFIG_SMP */
+
 /** Get thread to be scheduled
  *
  * Get the optimal thread to be scheduled
@@ -204,6 +374,15 @@ static thread_t *find_best_thread(void)
 loop:
 
 	if (atomic_get(&CPU->nrdy) == 0) {
+#ifdef CONFIG_SMP
+		/*
+		 * Before giving up, try to get some work from
+		 * the other CPUs.
+		 */
+		if (steal_thread())
+			goto loop;
+#endif
+
 		/*
 		 * For there was nothing to run, the CPU goes to sleep
 		 * until a hardware interrupt or an IPI comes.
@@ -212,59 +391,82 @@ loop:
 		irq_spinlock_lock(&CPU->lock, false);
 		CPU->idle = true;
 		irq_spinlock_unlock(&CPU->lock, false);
-		interrupts_enable();
+		clock_idle_enter();
 
 		/*
-		 * An interrupt might occur right now and wake up a thread.
-		 * In such case, the CPU will continue to go to sleep
-		 * even though there is a runnable thread.
+		 * A thread readied by another CPU from now on is signalled
+		 * by an interrupt. Enabling interrupts and going to sleep
+		 * must be atomic so that the interrupt does not come right
+		 * in between and leave the CPU asleep with the tick stopped.
 		 */
-		cpu_sleep();
+		cpu_interruptible_sleep();
 		interrupts_disable();
+		clock_idle_exit();
 		goto loop;
 	}
 
 	assert(!CPU->idle);
 
-	unsigned int i;
-	for (i = 0; i < RQ_COUNT; i++) {
-		irq_spinlock_lock(&(CPU->rq[i].lock), false);
-		if (CPU->rq[i].n == 0) {
-			/*
-			 * If this queue is empty, try a lower-priority queue.
-			 */
-			irq_spinlock_unlock(&(CPU->rq[i].lock), false);
-			continue;
-		}
-
-		atomic_dec(&CPU->nrdy);
-		atomic_dec(&nrdy);
-		CPU->rq[i].n--;
+	/*
+	 * Pick the highest-priority non-empty run queue directly from
+	 * the run queue bitmap so that only a single lock is taken.
+	 */
+	unsigned int i = rq_mask_first(&CPU->rq_mask);
+	if (i == RQ_COUNT) {
+		/*
+		 * The thread accounted in nrdy has just been stolen
+		 * by another CPU, try again.
+		 */
+		goto loop;
+	}
 
+	irq_spinlock_lock(&(CPU->rq[i].lock), false);
+	if (CPU->rq[i].n == 0) {
 		/*
-		 * Take the first thread from the queue.
+		 * The queue has been emptied before we managed
+		 * to lock it, try again.
 		 */
-		thread_t *thread = list_get_instance(
-		    list_first(&CPU->rq[i].rq), thread_t, rq_link);
-		list_remove(&thread->rq_link);
+		irq_spinlock_unlock(&(CPU->rq[i].lock), false);
+		goto loop;
+	}
 
-		irq_spinlock_pass(&(CPU->rq[i].lock), &thread->lock);
+	atomic_dec(&CPU->nrdy);
+	atomic_dec(&nrdy);
+	if (--CPU->rq[i].n == 0)
+		rq_mask_clear(&CPU->rq_mask, i);
 
-		thread->cpu = CPU;
-		thread->ticks = us2ticks((i + 1) * 10000);
-		thread->priority = i;  /* Correct rq index */
+	/*
+	 * Take the first thread from the queue.
+	 */
+	thread_t *thread = list_get_instance(
+	    list_first(&CPU->rq[i].rq), thread_t, rq_link);
+	list_remove(&thread->rq_link);
 
-		/*
-		 * Clear the stolen flag so that it can be migrated
-		 * when load balancing needs emerge.
-		 */
-		thread->stolen = false;
-		irq_spinlock_unlock(&thread->lock, false);
+	irq_spinlock_pass(&(CPU->rq[i].lock), &thread->lock);
 
-		return thread;
-	}
+	thread->cpu = CPU;
+	thread->ticks = us2ticks((i + 1) * 10000);
+	thread->priority = i;  /* Correct rq index */
 
-	goto loop;
+	/*
+	 * A handed-off thread runs on the time slice its waker
+	 * left unused by blocking.
+	 */
+	if ((thread == CPU->handoff_thread) && (CPU->donated_ticks > 0))
+		thread->ticks = CPU->donated_ticks;
+
+	/* The donation and the handoff end here whichever thread is picked */
+	CPU->handoff_thread = NULL;
+	CPU->donated_ticks = 0;
+
+	/*
+	 * Clear the stolen flag so that it can be migrated
+	 * when load balancing needs emerge.
+	 */
+	thread->stolen = false;
+	irq_spinlock_unlock(&thread->lock, false);
+
+	return thread;
 }
 
 /** Prevent rq starvation
@@ -294,6 +496,7 @@ static void relink_rq(int start)
 			list_concat(&list, &CPU->rq[i + 1].rq);
 			size_t n = CPU->rq[i + 1].n;
 			CPU->rq[i + 1].n = 0;
+			rq_mask_clear(&CPU->rq_mask, i + 1);
 			irq_spinlock_unlock(&CPU->rq[i + 1].lock, false);
 
 			/* Append rq[i + 1] to rq[i] */
@@ -301,6 +504,8 @@ static void relink_rq(int start)
 			irq_spinlock_lock(&CPU->rq[i].lock, false);
 			list_concat(&CPU->rq[i].rq, &list);
 			CPU->rq[i].n += n;
+			if (CPU->rq[i].n > 0)
+				rq_mask_set(&CPU->rq_mask, i);
 			irq_spinlock_unlock(&CPU->rq[i].lock, false);
 		}
 
@@ -401,6 +606,7 @@ void scheduler_separated_stack(void)
 	DEADLOCK_PROBE_INIT(p_joinwq);
 	task_t *old_task = TASK;
 	as_t *old_as = AS;
+	thread_id_t old_tid = THREAD ? THREAD->tid : 0;
 
 	assert((!THREAD) || (irq_spinlock_locked(&THREAD->lock)));
 	assert(CPU != NULL);
@@ -463,6 +669,14 @@ void scheduler_separated_stack(void)
 			 */
 			THREAD->priority = -1;
 
+			/*
+			 * Leave the rest of the time slice to the thread
+			 * this one has handed off to, if it is waiting for
+			 * its IPC answer or next call.
+			 */
+			if ((THREAD->ipc_wait) && (CPU->handoff_thread != NULL))
+				CPU->donated_ticks = THREAD->ticks;
+
 			/*
 			 * We need to release wq->lock which we locked in
 			 * waitq_sleep(). Address of wq->lock is kept in
@@ -483,6 +697,7 @@ void scheduler_separated_stack(void)
 		}
 
 		THREAD = NULL;
+		__atomic_store_n(&CPU->running, NULL, __ATOMIC_RELAXED);
 	}
 
 	THREAD = find_best_thread();
@@ -524,6 +739,8 @@ void scheduler_separated_stack(void)
 
 	irq_spinlock_lock(&THREAD->lock, false);
 	THREAD->state = Running;
+	__atomic_store_n(&CPU->running, THREAD, __ATOMIC_RELAXED);
+	KTRACE(KTRACE_SCHED_SWITCH, old_tid, THREAD->tid);
 
 #ifdef SCHEDULER_VERBOSE
 	log(LF_OTHER, LVL_DEBUG,
@@ -557,7 +774,9 @@ void scheduler_separated_stack(void)
 /** Load balancing thread
  *
  * SMP load balancing thread, supervising thread supplies
- * for the CPU it's wired to.
+ * for the CPU it's wired to. Idle CPUs steal ready threads
+ * on their own in find_best_thread(), therefore kcpulb serves
+ * only as a fallback which evens out the load of busy CPUs.
  *
  * @param arg Generic thread argument (unused).
  *
@@ -595,111 +814,86 @@ not_satisfied:
 
 	/*
 	 * Searching least priority queues on all CPU's first and most priority
-	 * queues on all CPU's last.
+	 * queues on all CPU's last. On NUMA machines, CPUs of the local node
+	 * are searched before remote ones.
 	 */
 	size_t acpu;
 	size_t acpu_bias = 0;
 	int rq;
 
-	for (rq = RQ_COUNT - 1; rq >= 0; rq--) {
-		for (acpu = 0; acpu < config.cpu_active; acpu++) {
-			cpu_t *cpu = &cpus[(acpu + acpu_bias) % config.cpu_active];
+	unsigned int passes = (numa_node_count > 1) ? 2 : 1;
 
-			/*
-			 * Not interested in ourselves.
-			 * Doesn't require interrupt disabling for kcpulb has
-			 * THREAD_FLAG_WIRED.
-			 *
-			 */
-			if (CPU == cpu)
-				continue;
-
-			if (atomic_get(&cpu->nrdy) <= average)
-				continue;
-
-			irq_spinlock_lock(&(cpu->rq[rq].lock), true);
-			if (cpu->rq[rq].n == 0) {
-				irq_spinlock_unlock(&(cpu->rq[rq].lock), true);
-				continue;
-			}
-
-			thread_t *thread = NULL;
-
-			/* Search rq from the back */
-			link_t *link = cpu->rq[rq].rq.head.prev;
-
-			while (link != &(cpu->rq[rq].rq.head)) {
-				thread = (thread_t *) list_get_instance(link,
-				    thread_t, rq_link);
+	for (unsigned int pass = 0; pass < passes; pass++) {
+		for (rq = RQ_COUNT - 1; rq >= 0; rq--) {
+			for (acpu = 0; acpu < config.cpu_active; acpu++) {
+				cpu_t *cpu = &cpus[(acpu + acpu_bias) %
+				    config.cpu_active];
 
 				/*
-				 * Do not steal CPU-wired threads, threads
-				 * already stolen, threads for which migration
-				 * was temporarily disabled or threads whose
-				 * FPU context is still in the CPU.
+				 * Not interested in ourselves.
+				 * Doesn't require interrupt disabling for
+				 * kcpulb has THREAD_FLAG_WIRED.
+				 *
 				 */
-				irq_spinlock_lock(&thread->lock, false);
+				if (CPU == cpu)
+					continue;
 
-				if ((!thread->wired) && (!thread->stolen) &&
-				    (!thread->nomigrate) &&
-				    (!thread->fpu_context_engaged)) {
-					/*
-					 * Remove thread from ready queue.
-					 */
-					irq_spinlock_unlock(&thread->lock,
-					    false);
-
-					atomic_dec(&cpu->nrdy);
-					atomic_dec(&nrdy);
+				/*
+				 * Local node in the first pass, remote
+				 * nodes in the second.
+				 */
+				if ((passes > 1) &&
+				    ((cpu->node == CPU->node) != (pass == 0)))
+					continue;
 
-					cpu->rq[rq].n--;
-					list_remove(&thread->rq_link);
+				if (atomic_get(&cpu->nrdy) <= average)
+					continue;
 
-					break;
+				irq_spinlock_lock(&(cpu->rq[rq].lock), true);
+				if (cpu->rq[rq].n == 0) {
+					irq_spinlock_unlock(&(cpu->rq[rq].lock), true);
+					continue;
 				}
 
-				irq_spinlock_unlock(&thread->lock, false);
+				thread_t *thread = steal_thread_from_rq(cpu, rq);
 
-				link = link->prev;
-				thread = NULL;
-			}
+				if (thread) {
+					/*
+					 * Ready thread on local CPU
+					 */
 
-			if (thread) {
-				/*
-				 * Ready thread on local CPU
-				 */
+					irq_spinlock_pass(&(cpu->rq[rq].lock),
+					    &thread->lock);
 
-				irq_spinlock_pass(&(cpu->rq[rq].lock),
-				    &thread->lock);
+	#ifdef KCPULB_VERBOSE
+					log(LF_OTHER, LVL_DEBUG,
+					    "kcpulb%u: TID %" PRIu64 " -> cpu%u, "
+					    "nrdy=%ld, avg=%ld", CPU->id, t->tid,
+					    CPU->id, atomic_get(&CPU->nrdy),
+					    atomic_get(&nrdy) / config.cpu_active);
+	#endif
 
-#ifdef KCPULB_VERBOSE
-				log(LF_OTHER, LVL_DEBUG,
-				    "kcpulb%u: TID %" PRIu64 " -> cpu%u, "
-				    "nrdy=%ld, avg=%ld", CPU->id, t->tid,
-				    CPU->id, atomic_get(&CPU->nrdy),
-				    atomic_get(&nrdy) / config.cpu_active);
-#endif
+					thread->stolen = true;
+					thread->state = Entering;
 
-				thread->stolen = true;
-				thread->state = Entering;
+					irq_spinlock_unlock(&thread->lock, true);
+					thread_ready(thread);
 
-				irq_spinlock_unlock(&thread->lock, true);
-				thread_ready(thread);
+					if (--count == 0)
+						goto satisfied;
 
-				if (--count == 0)
-					goto satisfied;
-
-				/*
-				 * We are not satisfied yet, focus on another
-				 * CPU next time.
-				 *
-				 */
-				acpu_bias++;
+					/*
+					 * We are not satisfied yet, focus on another
+					 * CPU next time.
+					 *
+					 */
+					acpu_bias++;
 
-				continue;
-			} else
-				irq_spinlock_unlock(&(cpu->rq[rq].lock), true);
+					continue;
+				} else
+					irq_spinlock_unlock(&(cpu->rq[rq].lock), true);
 
+			}
 		}
 	}
 
@@ -725,6 +919,118 @@ satisfied:
 }
 #endif /* CONFIG_SMP */
 
+/** Move a ready thread to the run queue matching its boosted priority
+ *
+ * A ready thread is linked in the run queue of its priority or, after
+ * relink_rq(), in a more urgent one. Only the run queues between the
+ * boosted and the current priority are locked, in ascending order, so
+ * that the thread cannot be dequeued, stolen or relinked while it is
+ * being looked up and moved. If the thread has been readied again with
+ * a less urgent priority meanwhile, it is left alone; it picks up the
+ * boost the next time it is readied.
+ *
+ * Interrupts must be disabled.
+ *
+ * @param thread Thread to requeue.
+ * @param cpu    CPU whose run queues the thread was readied to.
+ * @param dst    Boosted priority of the thread.
+ * @param src    Priority of the thread when it was boosted.
+ *
+ */
+static void pi_requeue(thread_t *thread, cpu_t *cpu, int dst, int src)
+{
+	int i;
+	for (i = dst; i <= src; i++)
+		irq_spinlock_lock(&cpu->rq[i].lock, false);
+
+	irq_spinlock_lock(&thread->lock, false);
+
+	if ((thread->state == Ready) && (thread->cpu == cpu) &&
+	    (thread->pi_boosts > 0) && (thread->priority <= src) &&
+	    (link_in_use(&thread->rq_link))) {
+		for (i = dst + 1; i <= src; i++) {
+			if (!list_member(&thread->rq_link, &cpu->rq[i].rq))
+				continue;
+
+			list_remove(&thread->rq_link);
+			if (--cpu->rq[i].n == 0)
+				rq_mask_clear(&cpu->rq_mask, i);
+
+			list_append(&thread->rq_link, &cpu->rq[dst].rq);
+			cpu->rq[dst].n++;
+			rq_mask_set(&cpu->rq_mask, dst);
+			thread->priority = dst;
+			break;
+		}
+	}
+
+	irq_spinlock_unlock(&thread->lock, false);
+
+	for (i = src; i >= dst; i--)
+		irq_spinlock_unlock(&cpu->rq[i].lock, false);
+}
+
+/** Lend priority to the owner of a contended lock
+ *
+ * The owner's priority is boosted to at least the given run queue
+ * index until the matching scheduler_pi_unboost(). Boosts nest; the
+ * most urgent priority lent is kept until the last boost is dropped.
+ * If the owner is already waiting in a run queue, it is moved to the
+ * run queue of the boosted priority right away.
+ *
+ * The caller must make sure that the owner cannot be destroyed for the
+ * duration of the call, e.g. by holding threads_lock or the tid_lock of
+ * the owner's task. Neither lock is taken here.
+ *
+ * @param thread   Owner thread.
+ * @param priority Run queue index of the waiting thread.
+ *
+ */
+void scheduler_pi_boost(thread_t *thread, int priority)
+{
+	if (priority < 0)
+		priority = 0;
+
+	ipl_t ipl = interrupts_disable();
+	irq_spinlock_lock(&thread->lock, false);
+
+	bool requeue = false;
+	if ((thread->pi_boosts++ == 0) || (priority < thread->pi_priority)) {
+		thread->pi_priority = priority;
+		requeue = (thread->state == Ready) &&
+		    (thread->priority > priority);
+	}
+
+	cpu_t *cpu = thread->cpu;
+	int src = thread->priority;
+
+	irq_spinlock_unlock(&thread->lock, false);
+
+	if ((requeue) && (cpu != NULL))
+		pi_requeue(thread, cpu, priority, src);
+
+	interrupts_restore(ipl);
+}
+
+/** Drop a priority boost lent by scheduler_pi_boost()
+ *
+ * The thread keeps its current run queue index, it drifts back to
+ * its own priority the next time it is readied.
+ *
+ * The same rules as for scheduler_pi_boost() apply to keeping the
+ * owner from being destroyed.
+ *
+ * @param thread Owner thread passed to scheduler_pi_boost().
+ *
+ */
+void scheduler_pi_unboost(thread_t *thread)
+{
+	irq_spinlock_lock(&thread->lock, true);
+	if (thread->pi_boosts > 0)
+		thread->pi_boosts--;
+	irq_spinlock_unlock(&thread->lock, true);
+}
+
 /** Print information about threads & scheduler queues
  *
  */
@@ -92,8 +92,9 @@ void task_init(void)
 {
 	TASK = NULL;
 	avltree_create(&tasks_tree);
-	task_cache = slab_cache_create("task_t", sizeof(task_t), 0,
-	    tsk_constructor, tsk_destructor, 0);
+	task_cache = slab_cache_create("task_t",
+	    sizeof(task_t) + cpu_mask_size(), 0, tsk_constructor,
+	    tsk_destructor, 0);
 }
 
 /** Task finish walker.
@@ -172,6 +173,10 @@ errno_t tsk_constructor(void *obj, unsigned int kmflags)
 
 	list_initialize(&task->threads);
 
+	irq_spinlock_initialize(&task->tid_lock, "task_t_tid_lock");
+	for (unsigned int i = 0; i < TASK_TID_BUCKETS; i++)
+		list_initialize(&task->tid_hash[i]);
+
 	ipc_answerbox_init(&task->answerbox, task);
 
 	spinlock_initialize(&task->active_calls_lock, "active_calls_lock");
@@ -219,6 +224,9 @@ task_t *task_create(as_t *as, const char *name)
 	task->perms = 0;
 	task->ucycles = 0;
 	task->kcycles = 0;
+	task->page_faults = 0;
+	task->pages_prefaulted = 0;
+	cpu_mask_all(&task->affinity);
 
 	caps_task_init(task);
 
@@ -603,6 +611,40 @@ sys_errno_t sys_task_exit(sysarg_t notify)
 	return EOK;
 }
 
+/** Syscall for setting the CPU affinity of the current task.
+ *
+ * The affinity is applied to all existing threads of the task
+ * and inherited by threads created later. The threads are
+ * migrated the next time they are made ready.
+ *
+ * @param uspace_set Userspace address of the CPU set.
+ *
+ * @return 0 on success or an error code from @ref errno.h.
+ *
+ */
+sys_errno_t sys_task_set_affinity(const cpuset_t *uspace_set)
+{
+	DEFINE_CPU_MASK(mask);
+
+	errno_t rc = cpu_mask_from_uspace(mask, uspace_set);
+	if (rc != EOK)
+		return (sys_errno_t) rc;
+
+	irq_spinlock_lock(&TASK->lock, true);
+
+	cpu_mask_copy(&TASK->affinity, mask);
+
+	list_foreach(TASK->threads, th_link, thread_t, thread) {
+		irq_spinlock_lock(&thread->lock, false);
+		cpu_mask_copy(&thread->affinity, mask);
+		irq_spinlock_unlock(&thread->lock, false);
+	}
+
+	irq_spinlock_unlock(&TASK->lock, true);
+
+	return EOK;
+}
+
 static bool task_print_walker(avltree_node_t *node, void *arg)
 {
 	bool *additional = (bool *) arg;
@@ -67,6 +67,7 @@
 #include <main/uinit.h>
 #include <syscall/copy.h>
 #include <errno.h>
+#include <ktrace.h>
 
 /** Thread states */
 const char *thread_states[] = {
@@ -160,6 +161,7 @@ static errno_t thr_constructor(void *obj, unsigned int kmflags)
 	link_initialize(&thread->rq_link);
 	link_initialize(&thread->wq_link);
 	link_initialize(&thread->th_link);
+	link_initialize(&thread->tid_link);
 
 	/* call the architecture-specific part of the constructor */
 	thr_constructor_arch(thread);
@@ -240,8 +242,9 @@ void thread_init(void)
 	THREAD = NULL;
 
 	atomic_set(&nrdy, 0);
-	thread_cache = slab_cache_create("thread_t", sizeof(thread_t), 0,
-	    thr_constructor, thr_destructor, 0);
+	thread_cache = slab_cache_create("thread_t",
+	    sizeof(thread_t) + cpu_mask_size(), 0, thr_constructor,
+	    thr_destructor, 0);
 
 #ifdef CONFIG_FPU
 	fpu_context_cache = slab_cache_create("fpu_context_t",
@@ -271,14 +274,67 @@ static void before_thread_is_ready(thread_t *thread)
 	workq_before_thread_is_ready(thread);
 }
 
+/** Find the least loaded CPU allowed by thread's affinity
+ *
+ * CPUs on the NUMA node on which the thread ran last (or on the node
+ * of the current CPU for a thread which has not run yet) are preferred
+ * over less loaded CPUs on other nodes, so that the thread stays close
+ * to the memory it has likely allocated.
+ *
+ * @param thread Locked thread.
+ *
+ * @return Active CPU from the thread's affinity mask with the lowest
+ *         number of ready threads or CPU if the mask contains no
+ *         active CPU.
+ *
+ */
+static cpu_t *thread_affinity_cpu(thread_t *thread)
+{
+	assert(irq_spinlock_locked(&thread->lock));
+
+	unsigned int node = (thread->cpu != NULL) ? thread->cpu->node :
+	    CPU->node;
+	cpu_t *best = NULL;
+
+	cpu_mask_for_each(thread->affinity, cpu_id) {
+		cpu_t *cpu = &cpus[cpu_id];
+
+		if (!cpu->active)
+			continue;
+
+		if (best == NULL) {
+			best = cpu;
+			continue;
+		}
+
+		bool local = (cpu->node == node);
+		bool best_local = (best->node == node);
+
+		if ((local && !best_local) || ((local == best_local) &&
+		    (atomic_get(&cpu->nrdy) < atomic_get(&best->nrdy))))
+			best = cpu;
+	}
+
+	return (best != NULL) ? best : CPU;
+}
+
 /** Make thread ready
  *
- * Switch thread to the ready state.
+ * Switch thread to the ready state. Unless the thread is bound
+ * to its current CPU, the CPU affinity of the thread is respected.
  *
- * @param thread Thread to make ready.
+ * With @a handoff, the thread is readied at the head of the run queue
+ * of the current CPU if it is allowed to run there and the CPU remembers
+ * it as the handoff thread. Should the current thread block waiting for
+ * an IPC message before another thread is picked, the handoff thread
+ * runs on the rest of its time slice. Until then, the thread can be
+ * stolen by other CPUs as usual.
+ *
+ * @param thread  Thread to make ready.
+ * @param handoff Hand the current CPU over to the thread.
  *
  */
-void thread_ready(thread_t *thread)
+static void _thread_ready(thread_t *thread, bool handoff)
 {
 	irq_spinlock_lock(&thread->lock, true);
 
@@ -289,37 +345,97 @@ void thread_ready(thread_t *thread)
 	int i = (thread->priority < RQ_COUNT - 1) ?
 	    ++thread->priority : thread->priority;
 
+	/* Do not let a thread holding a contended lock fall behind */
+	if ((thread->pi_boosts > 0) && (thread->pi_priority < i)) {
+		i = thread->pi_priority;
+		thread->priority = i;
+	}
+
+	/*
+	 * Only a thread woken up by another thread can be handed the CPU.
+	 * A thread bound to another CPU keeps running there.
+	 */
+	if ((THREAD == NULL) || (THREAD == thread) ||
+	    (!cpu_mask_is_set(&thread->affinity, CPU->id)))
+		handoff = false;
+	else if ((thread->wired || thread->nomigrate ||
+	    thread->fpu_context_engaged) && (thread->cpu != CPU))
+		handoff = false;
+
 	cpu_t *cpu;
-	if (thread->wired || thread->nomigrate || thread->fpu_context_engaged) {
+	if (handoff) {
+		cpu = CPU;
+	} else if (thread->wired || thread->nomigrate ||
+	    thread->fpu_context_engaged) {
 		/* Cannot ready to another CPU */
 		assert(thread->cpu != NULL);
 		cpu = thread->cpu;
 	} else if (thread->stolen) {
 		/* Ready to the stealing CPU */
 		cpu = CPU;
-	} else if (thread->cpu) {
+	} else if ((thread->cpu) &&
+	    (cpu_mask_is_set(&thread->affinity, thread->cpu->id))) {
 		/* Prefer the CPU on which the thread ran last */
-		assert(thread->cpu != NULL);
 		cpu = thread->cpu;
-	} else {
+	} else if (cpu_mask_is_set(&thread->affinity, CPU->id)) {
 		cpu = CPU;
+	} else {
+		/* Neither CPU is allowed by the thread's affinity */
+		cpu = thread_affinity_cpu(thread);
 	}
 
 	thread->state = Ready;
+	thread->cpu = cpu;
+	if (handoff)
+		CPU->handoff_thread = thread;
 
 	irq_spinlock_pass(&thread->lock, &(cpu->rq[i].lock));
 
 	/*
 	 * Append thread to respective ready queue
-	 * on respective processor.
+	 * on respective processor. A handed-off thread
+	 * goes first.
 	 */
 
-	list_append(&thread->rq_link, &cpu->rq[i].rq);
+	if (handoff)
+		list_prepend(&thread->rq_link, &cpu->rq[i].rq);
+	else
+		list_append(&thread->rq_link, &cpu->rq[i].rq);
 	cpu->rq[i].n++;
+	rq_mask_set(&cpu->rq_mask, i);
+	KTRACE(KTRACE_SCHED_WAKEUP, thread->tid, cpu->id);
 	irq_spinlock_unlock(&(cpu->rq[i].lock), true);
 
 	atomic_inc(&nrdy);
 	atomic_inc(&cpu->nrdy);
+
+	clock_idle_kick(cpu);
+}
+
+/** Make thread ready
+ *
+ * @param thread Thread to make ready.
+ *
+ */
+void thread_ready(thread_t *thread)
+{
+	_thread_ready(thread, false);
+}
+
+/** Make thread ready and hand it the current CPU
+ *
+ * Used when the current thread is likely to block waiting for the
+ * thread it has just woken up, i.e. after sending an IPC request or
+ * answer. If the current thread blocks in ipc_wait_for_call() before
+ * another thread is picked, the woken thread runs next on this CPU on
+ * the rest of the current thread's time slice.
+ *
+ * @param thread Thread to make ready.
+ *
+ */
+void thread_ready_handoff(thread_t *thread)
+{
+	_thread_ready(thread, true);
 }
 
 /** Create new thread
@@ -371,9 +487,12 @@ thread_t *thread_create(void (*func)(void *), void *arg, task_t *task,
 	thread->uncounted =
 	    ((flags & THREAD_FLAG_UNCOUNTED) == THREAD_FLAG_UNCOUNTED);
 	thread->priority = -1;          /* Start in rq[0] */
+	thread->pi_boosts = 0;
+	thread->pi_priority = 0;
 	thread->cpu = NULL;
 	thread->wired = false;
 	thread->stolen = false;
+	thread->ipc_wait = false;
 	thread->uspace =
 	    ((flags & THREAD_FLAG_USPACE) == THREAD_FLAG_USPACE);
 
@@ -395,6 +514,11 @@ thread_t *thread_create(void (*func)(void *), void *arg, task_t *task,
 
 	thread->task = task;
 
+	/* Inherit the CPU affinity of the task */
+	irq_spinlock_lock(&task->lock, true);
+	cpu_mask_copy(&thread->affinity, &task->affinity);
+	irq_spinlock_unlock(&task->lock, true);
+
 	thread->workq = NULL;
 
 	thread->fpu_context_exists = false;
@@ -451,6 +575,11 @@ void thread_destroy(thread_t *thread, bool irq_res)
 	 * Detach from the containing task.
 	 */
 	list_remove(&thread->th_link);
+
+	irq_spinlock_lock(&thread->task->tid_lock, false);
+	list_remove(&thread->tid_link);
+	irq_spinlock_unlock(&thread->task->tid_lock, false);
+
 	irq_spinlock_unlock(&thread->task->lock, irq_res);
 
 	/*
@@ -485,6 +614,11 @@ void thread_attach(thread_t *thread, task_t *task)
 
 	list_append(&thread->th_link, &task->threads);
 
+	irq_spinlock_lock(&task->tid_lock, false);
+	list_append(&thread->tid_link,
+	    &task->tid_hash[thread->tid % TASK_TID_BUCKETS]);
+	irq_spinlock_unlock(&task->tid_lock, false);
+
 	irq_spinlock_pass(&task->lock, &threads_lock);
 
 	/*
@@ -883,6 +1017,32 @@ thread_t *thread_find_by_id(thread_id_t thread_id)
 	return iterator.thread;
 }
 
+/** Find thread of a task corresponding to thread ID.
+ *
+ * Unlike thread_find_by_id(), this does not need the global threads_lock.
+ * The tid_lock of the task must be already held by the caller of this
+ * function. The thread cannot be destroyed while the lock is held.
+ *
+ * @param task      Task containing the thread.
+ * @param thread_id Thread ID.
+ *
+ * @return Thread structure address or NULL if the task has no thread
+ *         with such thread ID.
+ *
+ */
+thread_t *thread_find_in_task(task_t *task, thread_id_t thread_id)
+{
+	assert(irq_spinlock_locked(&task->tid_lock));
+
+	list_foreach(task->tid_hash[thread_id % TASK_TID_BUCKETS], tid_link,
+	    thread_t, thread) {
+		if (thread->tid == thread_id)
+			return thread;
+	}
+
+	return NULL;
+}
+
 #ifdef CONFIG_UDEBUG
 
 void thread_stack_trace(thread_id_t thread_id)
@@ -1034,6 +1194,51 @@ sys_errno_t sys_thread_get_id(thread_id_t *uspace_thread_id)
 	    sizeof(THREAD->tid));
 }
 
+/** Syscall for setting the CPU affinity of a thread.
+ *
+ * The thread must belong to the current task. If the thread is currently
+ * running or ready on a CPU outside of the new affinity mask, it is
+ * migrated the next time it is made ready.
+ *
+ * @param uspace_thread_id Userspace address of 8-byte buffer
+ *                         containing the thread ID.
+ * @param uspace_set       Userspace address of the CPU set.
+ *
+ * @return 0 on success or an error code from @ref errno.h.
+ *
+ */
+sys_errno_t sys_thread_set_affinity(thread_id_t *uspace_thread_id,
+    const cpuset_t *uspace_set)
+{
+	thread_id_t thread_id;
+	errno_t rc = copy_from_uspace(&thread_id, uspace_thread_id,
+	    sizeof(thread_id));
+	if (rc != EOK)
+		return (sys_errno_t) rc;
+
+	DEFINE_CPU_MASK(mask);
+
+	rc = cpu_mask_from_uspace(mask, uspace_set);
+	if (rc != EOK)
+		return (sys_errno_t) rc;
+
+	irq_spinlock_lock(&threads_lock, true);
+
+	thread_t *thread = thread_find_by_id(thread_id);
+	if ((thread == NULL) || (thread->task != TASK)) {
+		irq_spinlock_unlock(&threads_lock, true);
+		return (sys_errno_t) ENOENT;
+	}
+
+	irq_spinlock_lock(&thread->lock, false);
+	cpu_mask_copy(&thread->affinity, mask);
+	irq_spinlock_unlock(&thread->lock, false);
+
+	irq_spinlock_unlock(&threads_lock, true);
+
+	return EOK;
+}
+
 /** Syscall wrapper for sleeping. */
 sys_errno_t sys_thread_usleep(uint32_t usec)
 {
@@ -38,7 +38,9 @@
 #ifdef CONFIG_SMP
 
 #include <smp/ipi.h>
+#include <assert.h>
 #include <config.h>
+#include <cpu.h>
 
 /** Broadcast IPI message
  *
@@ -59,6 +61,23 @@ void ipi_broadcast(int ipi)
 		ipi_broadcast_arch(ipi);
 }
 
+/** Send IPI message to one CPU
+ *
+ * Interrupts must be disabled.
+ *
+ * @param cpu_id Destination CPU id (index into cpus array). Must not
+ *               be the current CPU.
+ * @param ipi    Message to send.
+ *
+ */
+void ipi_unicast(unsigned int cpu_id, int ipi)
+{
+	assert(cpu_id < config.cpu_count);
+	assert(&cpus[cpu_id] != CPU);
+
+	ipi_unicast_arch(cpu_id, ipi);
+}
+
 #endif /* CONFIG_SMP */
 
 /** @}
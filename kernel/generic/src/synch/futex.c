@@ -35,10 +35,19 @@
  * @file
  * @brief	Kernel backend for futexes.
  *
- * Kernel futex objects are stored in a global hash table futex_ht
- * where the physical address of the futex variable (futex_t.paddr)
+ * Futexes are either private to a task or shared among tasks. The flags
+ * passed along with each futex syscall select the kind. A futex variable
+ * must be consistently used as either private or shared by a task.
+ *
+ * Private futexes, which is the overwhelming majority, are identified only
+ * by the virtual address of the futex variable. They are never entered into
+ * any global structure and accessing them never walks the page tables.
+ *
+ * Kernel objects of shared futexes are stored in a global hash table
+ * futex_ht where the physical address of the futex variable (futex_t.paddr)
  * is used as the lookup key. As a result multiple address spaces
- * may share the same futex variable.
+ * may share the same futex variable. Each bucket of the table is protected
+ * by its own spinlock.
  *
  * A kernel futex object is created the first time a task accesses
  * the futex (having a futex variable at a physical address not
@@ -57,7 +66,8 @@
  * task are furthermore stored in a concurrent hash table (CHT,
  * task->futexes->ht). A single lookup without locks or accesses
  * to the page table translates a futex variable's virtual address
- * into its futex kernel object.
+ * into its futex kernel object. The cache is also the only place where
+ * private futexes are kept.
  */
 
 #include <assert.h>
@@ -70,16 +80,20 @@
 #include <mm/slab.h>
 #include <proc/thread.h>
 #include <proc/task.h>
+#include <proc/scheduler.h>
 #include <genarch/mm/page_pt.h>
 #include <genarch/mm/page_ht.h>
 #include <adt/cht.h>
 #include <adt/hash.h>
-#include <adt/hash_table.h>
 #include <adt/list.h>
 #include <arch.h>
 #include <align.h>
 #include <panic.h>
 #include <errno.h>
+#include <abi/synch.h>
+
+/** Number of buckets of the global futex hash table, a power of two. */
+#define FUTEX_HT_BUCKETS  64
 
 /** Task specific pointer to a global kernel futex object. */
 typedef struct futex_ptr {
@@ -96,46 +110,37 @@ typedef struct futex_ptr {
 
 static void destroy_task_cache(work_t *work);
 
-static void futex_initialize(futex_t *futex, uintptr_t paddr);
-static void futex_add_ref(futex_t *futex);
-static void futex_release_ref(futex_t *futex);
+static void futex_initialize(futex_t *futex, uintptr_t paddr, bool shared);
 static void futex_release_ref_locked(futex_t *futex);
 
-static futex_t *get_futex(uintptr_t uaddr);
+static futex_t *get_futex(uintptr_t uaddr, sysarg_t flags);
 static futex_t *find_cached_futex(uintptr_t uaddr);
-static futex_t *get_and_cache_futex(uintptr_t phys_addr, uintptr_t uaddr);
+static futex_t *get_shared_futex(uintptr_t phys_addr);
+static futex_t *cache_futex(futex_t *futex, uintptr_t uaddr);
 static bool find_futex_paddr(uintptr_t uaddr, uintptr_t *phys_addr);
 
-static size_t futex_ht_hash(const ht_link_t *item);
-static size_t futex_ht_key_hash(void *key);
-static bool futex_ht_key_equal(void *key, const ht_link_t *item);
-static void futex_ht_remove_callback(ht_link_t *item);
-
 static size_t task_fut_ht_hash(const cht_link_t *link);
 static size_t task_fut_ht_key_hash(void *key);
 static bool task_fut_ht_equal(const cht_link_t *item1, const cht_link_t *item2);
 static bool task_fut_ht_key_equal(void *key, const cht_link_t *item);
 
 
-/** Mutex protecting the global futex hash table.
- *
- * Acquire task specific TASK->futex_list_lock before this mutex.
- */
-SPINLOCK_STATIC_INITIALIZE_NAME(futex_ht_lock, "futex-ht-lock");
+/** Bucket of the global futex hash table. */
+typedef struct {
+	/** Protects the bucket and the reference counts of its futexes.
+	 *
+	 * Acquire task specific TASK->futex_list_lock before this lock.
+	 */
+	SPINLOCK_DECLARE(lock);
+	/** Shared futexes hashing into this bucket. */
+	list_t list;
+} futex_bucket_t;
 
-/** Global kernel futex hash table. Lock futex_ht_lock before accessing.
+/** Global kernel futex hash table of shared futexes.
  *
  * Physical address of the futex variable is the lookup key.
  */
-static hash_table_t futex_ht;
-
-/** Global kernel futex hash table operations. */
-static hash_table_ops_t futex_ht_ops = {
-	.hash = futex_ht_hash,
-	.key_hash = futex_ht_key_hash,
-	.key_equal = futex_ht_key_equal,
-	.remove_callback = futex_ht_remove_callback
-};
+static futex_bucket_t futex_ht[FUTEX_HT_BUCKETS];
 
 /** Task futex cache CHT operations. */
 static cht_ops_t task_futex_ht_ops = {
@@ -149,7 +154,17 @@ static cht_ops_t task_futex_ht_ops = {
 /** Initialize futex subsystem. */
 void futex_init(void)
 {
-	hash_table_create(&futex_ht, 0, 0, &futex_ht_ops);
+	for (size_t i = 0; i < FUTEX_HT_BUCKETS; i++) {
+		spinlock_initialize(&futex_ht[i].lock, "futex-ht-lock");
+		spinlock_set_kind(&futex_ht[i].lock, SPINLOCK_TICKET);
+		list_initialize(&futex_ht[i].list);
+	}
+}
+
+/** Return the global futex table bucket of a physical address. */
+static futex_bucket_t *futex_bucket(uintptr_t paddr)
+{
+	return &futex_ht[hash_mix(paddr) & (FUTEX_HT_BUCKETS - 1)];
 }
 
 /** Initializes the futex structures for the new task. */
@@ -228,60 +243,75 @@ void futex_task_cleanup(void)
 
 /** Initialize the kernel futex structure.
  *
- * @param futex	Kernel futex structure.
- * @param paddr Physical address of the futex variable.
+ * @param futex	 Kernel futex structure.
+ * @param paddr  Physical address of the futex variable.
+ * @param shared True if the futex is to be entered into the global table.
  */
-static void futex_initialize(futex_t *futex, uintptr_t paddr)
+static void futex_initialize(futex_t *futex, uintptr_t paddr, bool shared)
 {
 	waitq_initialize(&futex->wq);
+	link_initialize(&futex->ht_link);
 	futex->paddr = paddr;
+	futex->shared = shared;
 	futex->refcount = 1;
 }
 
-/** Increments the counter of tasks referencing the futex. */
-static void futex_add_ref(futex_t *futex)
-{
-	assert(spinlock_locked(&futex_ht_lock));
-	assert(0 < futex->refcount);
-	++futex->refcount;
-}
-
 /** Decrements the counter of tasks referencing the futex. May free the futex.*/
-static void futex_release_ref(futex_t *futex)
+static void futex_release_ref_locked(futex_t *futex)
 {
-	assert(spinlock_locked(&futex_ht_lock));
-	assert(0 < futex->refcount);
+	if (!futex->shared) {
+		/* Private futexes are referenced by their task only. */
+		assert(futex->refcount == 1);
+		free(futex);
+		return;
+	}
+
+	futex_bucket_t *bucket = futex_bucket(futex->paddr);
 
+	spinlock_lock(&bucket->lock);
+
+	assert(0 < futex->refcount);
 	--futex->refcount;
 
 	if (0 == futex->refcount) {
-		hash_table_remove(&futex_ht, &futex->paddr);
+		list_remove(&futex->ht_link);
+		spinlock_unlock(&bucket->lock);
+		free(futex);
+		return;
 	}
-}
 
-/** Decrements the counter of tasks referencing the futex. May free the futex.*/
-static void futex_release_ref_locked(futex_t *futex)
-{
-	spinlock_lock(&futex_ht_lock);
-	futex_release_ref(futex);
-	spinlock_unlock(&futex_ht_lock);
+	spinlock_unlock(&bucket->lock);
 }
 
-/** Returns a futex for the virtual address @a uaddr (or creates one). */
-static futex_t *get_futex(uintptr_t uaddr)
+/** Returns a futex for the virtual address @a uaddr (or creates one).
+ *
+ * @param uaddr  Userspace address of the futex variable.
+ * @param flags  FUTEX_PRIVATE or FUTEX_SHARED.
+ */
+static futex_t *get_futex(uintptr_t uaddr, sysarg_t flags)
 {
 	futex_t *futex = find_cached_futex(uaddr);
 
 	if (futex)
 		return futex;
 
-	uintptr_t paddr;
+	if (flags & FUTEX_SHARED) {
+		uintptr_t paddr;
 
-	if (!find_futex_paddr(uaddr, &paddr)) {
-		return 0;
+		if (!find_futex_paddr(uaddr, &paddr))
+			return NULL;
+
+		futex = get_shared_futex(paddr);
+	} else {
+		futex = malloc(sizeof(futex_t));
+		if (futex)
+			futex_initialize(futex, 0, false);
 	}
 
-	return get_and_cache_futex(paddr, uaddr);
+	if (!futex)
+		return NULL;
+
+	return cache_futex(futex, uaddr);
 }
 
 
@@ -289,7 +319,6 @@ static futex_t *get_futex(uintptr_t uaddr)
 static bool find_futex_paddr(uintptr_t uaddr, uintptr_t *paddr)
 {
 	page_table_lock(AS, false);
-	spinlock_lock(&futex_ht_lock);
 
 	bool success = false;
 
@@ -303,7 +332,6 @@ static bool find_futex_paddr(uintptr_t uaddr, uintptr_t *paddr)
 		    (uaddr - ALIGN_DOWN(uaddr, PAGE_SIZE));
 	}
 
-	spinlock_unlock(&futex_ht_lock);
 	page_table_unlock(AS, false);
 
 	return success;
@@ -333,42 +361,54 @@ static futex_t *find_cached_futex(uintptr_t uaddr)
 
 
 /**
- * Returns a kernel futex for the physical address @a phys_addr and caches
- * it in this task under the virtual address @a uaddr (if not already cached).
+ * Returns a new reference to the shared kernel futex for the physical
+ * address @a phys_addr.
  */
-static futex_t *get_and_cache_futex(uintptr_t phys_addr, uintptr_t uaddr)
+static futex_t *get_shared_futex(uintptr_t phys_addr)
 {
-	futex_t *futex = malloc(sizeof(futex_t));
-	if (!futex)
+	futex_t *new_futex = malloc(sizeof(futex_t));
+	if (!new_futex)
 		return NULL;
 
 	/*
 	 * Find the futex object in the global futex table (or insert it
 	 * if it is not present).
 	 */
-	spinlock_lock(&futex_ht_lock);
+	futex_bucket_t *bucket = futex_bucket(phys_addr);
 
-	ht_link_t *fut_link = hash_table_find(&futex_ht, &phys_addr);
+	spinlock_lock(&bucket->lock);
 
-	if (fut_link) {
-		free(futex);
-		futex = member_to_inst(fut_link, futex_t, ht_link);
-		futex_add_ref(futex);
-	} else {
-		futex_initialize(futex, phys_addr);
-		hash_table_insert(&futex_ht, &futex->ht_link);
+	list_foreach(bucket->list, ht_link, futex_t, futex) {
+		if (futex->paddr == phys_addr) {
+			assert(0 < futex->refcount);
+			++futex->refcount;
+			spinlock_unlock(&bucket->lock);
+
+			free(new_futex);
+			return futex;
+		}
 	}
 
-	spinlock_unlock(&futex_ht_lock);
+	futex_initialize(new_futex, phys_addr, true);
+	list_append(&new_futex->ht_link, &bucket->list);
+
+	spinlock_unlock(&bucket->lock);
+
+	return new_futex;
+}
 
+/**
+ * Caches the reference to @a futex in this task under the virtual address
+ * @a uaddr (if not already cached) and returns the cached futex.
+ */
+static futex_t *cache_futex(futex_t *futex, uintptr_t uaddr)
+{
 	/*
 	 * Cache the link to the futex object for this task.
 	 */
 	futex_ptr_t *fut_ptr = malloc(sizeof(futex_ptr_t));
 	if (!fut_ptr) {
-		spinlock_lock(&futex_ht_lock);
-		futex_release_ref(futex);
-		spinlock_unlock(&futex_ht_lock);
+		futex_release_ref_locked(futex);
 		return NULL;
 	}
 	cht_link_t *dup_link;
@@ -397,24 +437,79 @@ static futex_t *get_and_cache_futex(uintptr_t phys_addr, uintptr_t uaddr)
 	return futex;
 }
 
+/** Lend the current thread's priority to the owner of a PI futex.
+ *
+ * Only threads of the current task can be boosted. The owner is looked
+ * up in the thread ID hash of the task, which keeps it from being
+ * destroyed while it is being boosted.
+ *
+ * @param owner_id Thread ID of the futex owner as recorded by userspace.
+ *
+ * @return True if the owner has been boosted and needs to be unboosted
+ *         by futex_pi_unboost() later.
+ */
+static bool futex_pi_boost(sysarg_t owner_id)
+{
+	bool boosted = false;
+
+	irq_spinlock_lock(&TASK->tid_lock, true);
+
+	thread_t *owner = thread_find_in_task(TASK, (thread_id_t) owner_id);
+	if ((owner != NULL) && (owner != THREAD)) {
+		scheduler_pi_boost(owner, THREAD->priority);
+		boosted = true;
+	}
+
+	irq_spinlock_unlock(&TASK->tid_lock, true);
+
+	return boosted;
+}
+
+/** Drop a priority boost lent by futex_pi_boost().
+ *
+ * Nothing is done if the owner has exited meanwhile.
+ *
+ * @param owner_id Thread ID passed to futex_pi_boost().
+ */
+static void futex_pi_unboost(sysarg_t owner_id)
+{
+	irq_spinlock_lock(&TASK->tid_lock, true);
+
+	thread_t *owner = thread_find_in_task(TASK, (thread_id_t) owner_id);
+	if (owner != NULL)
+		scheduler_pi_unboost(owner);
+
+	irq_spinlock_unlock(&TASK->tid_lock, true);
+}
+
 /** Sleep in futex wait queue with a timeout.
  *  If the sleep times out or is interrupted, the next wakeup is ignored.
  *  The userspace portion of the call must handle this condition.
  *
  * @param uaddr	 	Userspace address of the futex counter.
  * @param timeout	Maximum number of useconds to sleep. 0 means no limit.
+ * @param flags		FUTEX_PRIVATE or FUTEX_SHARED, optionally combined
+ *			with FUTEX_PI.
+ * @param owner		Thread ID of the current owner of a FUTEX_PI futex
+ *			or zero if unknown.
  *
- * @return		If there is no physical mapping for uaddr ENOENT is
- *			returned. Otherwise returns the return value of
+ * @return		If there is no physical mapping for the uaddr of
+ *			a shared futex or there is not enough memory, ENOENT
+ *			is returned. Otherwise returns the return value of
  *                      waitq_sleep_timeout().
  */
-sys_errno_t sys_futex_sleep(uintptr_t uaddr, uintptr_t timeout)
+sys_errno_t sys_futex_sleep(uintptr_t uaddr, uintptr_t timeout,
+    sysarg_t flags, sysarg_t owner)
 {
-	futex_t *futex = get_futex(uaddr);
+	futex_t *futex = get_futex(uaddr, flags);
 
 	if (!futex)
 		return (sys_errno_t) ENOENT;
 
+	bool boosted = false;
+	if ((flags & FUTEX_PI) && (owner != 0))
+		boosted = futex_pi_boost(owner);
+
 #ifdef CONFIG_UDEBUG
 	udebug_stoppable_begin();
 #endif
@@ -426,18 +521,24 @@ sys_errno_t sys_futex_sleep(uintptr_t uaddr, uintptr_t timeout)
 	udebug_stoppable_end();
 #endif
 
+	if (boosted)
+		futex_pi_unboost(owner);
+
 	return (sys_errno_t) rc;
 }
 
 /** Wakeup one thread waiting in futex wait queue.
  *
  * @param uaddr		Userspace address of the futex counter.
+ * @param flags		FUTEX_PRIVATE or FUTEX_SHARED, optionally combined
+ *			with FUTEX_PI.
  *
- * @return		ENOENT if there is no physical mapping for uaddr.
+ * @return		ENOENT if there is no physical mapping for the uaddr
+ *			of a shared futex.
  */
-sys_errno_t sys_futex_wakeup(uintptr_t uaddr)
+sys_errno_t sys_futex_wakeup(uintptr_t uaddr, sysarg_t flags)
 {
-	futex_t *futex = get_futex(uaddr);
+	futex_t *futex = get_futex(uaddr, flags);
 
 	if (futex) {
 		waitq_wakeup(&futex->wq, WAKEUP_FIRST);
@@ -448,40 +549,6 @@ sys_errno_t sys_futex_wakeup(uintptr_t uaddr)
 }
 
 
-/** Return the hash of the key stored in the item */
-size_t futex_ht_hash(const ht_link_t *item)
-{
-	futex_t *futex = hash_table_get_inst(item, futex_t, ht_link);
-	return hash_mix(futex->paddr);
-}
-
-/** Return the hash of the key */
-size_t futex_ht_key_hash(void *key)
-{
-	uintptr_t *paddr = (uintptr_t *) key;
-	return hash_mix(*paddr);
-}
-
-/** Return true if the key is equal to the item's lookup key. */
-bool futex_ht_key_equal(void *key, const ht_link_t *item)
-{
-	uintptr_t *paddr = (uintptr_t *) key;
-	futex_t *futex = hash_table_get_inst(item, futex_t, ht_link);
-	return *paddr == futex->paddr;
-}
-
-/** Callback for removal items from futex hash table.
- *
- * @param item		Item removed from the hash table.
- */
-void futex_ht_remove_callback(ht_link_t *item)
-{
-	futex_t *futex;
-
-	futex = hash_table_get_inst(item, futex_t, ht_link);
-	free(futex);
-}
-
 /*
  * Operations of a task's CHT that caches mappings of futex user space
  * virtual addresses to kernel futex objects.
@@ -43,6 +43,12 @@
 #include <stacktrace.h>
 #include <cpu.h>
 #include <proc/thread.h>
+#include <proc/scheduler.h>
+
+/** Maximum number of attempts to acquire a contended mutex by spinning. */
+#define MUTEX_SPIN_MAX  1000
+
+mutex_stats_t mutex_stats;
 
 /** Initialize mutex.
  *
@@ -53,6 +59,8 @@ void mutex_initialize(mutex_t *mtx, mutex_type_t type)
 {
 	mtx->type = type;
 	mtx->owner = NULL;
+	mtx->owner_tid = 0;
+	mtx->owner_cpu = NULL;
 	mtx->nesting = 0;
 	semaphore_initialize(&mtx->sem, 1);
 }
@@ -70,6 +78,86 @@ bool mutex_locked(mutex_t *mtx)
 
 #define MUTEX_DEADLOCK_THRESHOLD	100000000
 
+/** Spin on a contended passive mutex while its owner is running.
+ *
+ * Going to sleep and being woken up costs much more than a short
+ * critical section, so it pays off to wait for an owner which is
+ * running on another processor. Spinning stops as soon as the owner
+ * is preempted or goes to sleep itself. The owner is only compared
+ * with the thread running on its processor and never dereferenced.
+ *
+ * @param mtx  Mutex.
+ *
+ * @return EOK if the mutex has been acquired, ETIMEOUT otherwise.
+ *
+ */
+static errno_t mutex_spin(mutex_t *mtx)
+{
+	for (unsigned int i = 0; i < MUTEX_SPIN_MAX; i++) {
+		if (semaphore_trydown(&mtx->sem) == EOK)
+			return EOK;
+
+		struct thread *owner =
+		    __atomic_load_n(&mtx->owner, __ATOMIC_RELAXED);
+		cpu_t *cpu = __atomic_load_n(&mtx->owner_cpu, __ATOMIC_RELAXED);
+
+		/* The owner may be between acquiring and recording itself */
+		if (owner == NULL) {
+			spin_hint();
+			continue;
+		}
+
+		if ((cpu == NULL) || (cpu == CPU) ||
+		    (__atomic_load_n(&cpu->running, __ATOMIC_RELAXED) != owner))
+			break;
+
+		spin_hint();
+	}
+
+	return ETIMEOUT;
+}
+
+/** Lend the current thread's priority to the owner of a MUTEX_PI mutex.
+ *
+ * The owner is not referenced, it is validated against the list of
+ * threads. Its thread ID guards against the thread structure having
+ * been reused.
+ *
+ * @param owner Owner of the mutex.
+ * @param tid   Thread ID of the owner.
+ *
+ * @return True if the owner has been boosted and needs to be unboosted
+ *         by mutex_pi_unboost() later.
+ *
+ */
+static bool mutex_pi_boost(struct thread *owner, thread_id_t tid)
+{
+	bool boosted = false;
+
+	irq_spinlock_lock(&threads_lock, true);
+	if ((thread_exists(owner)) && (owner->tid == tid)) {
+		scheduler_pi_boost(owner, THREAD->priority);
+		boosted = true;
+	}
+	irq_spinlock_unlock(&threads_lock, true);
+
+	return boosted;
+}
+
+/** Drop a priority boost lent by mutex_pi_boost().
+ *
+ * @param owner Owner passed to mutex_pi_boost().
+ * @param tid   Thread ID passed to mutex_pi_boost().
+ *
+ */
+static void mutex_pi_unboost(struct thread *owner, thread_id_t tid)
+{
+	irq_spinlock_lock(&threads_lock, true);
+	if ((thread_exists(owner)) && (owner->tid == tid))
+		scheduler_pi_unboost(owner);
+	irq_spinlock_unlock(&threads_lock, true);
+}
+
 /** Acquire mutex.
  *
  * Timeout mode and non-blocking mode can be requested.
@@ -89,7 +177,25 @@ errno_t _mutex_lock_timeout(mutex_t *mtx, uint32_t usec, unsigned int flags)
 	errno_t rc;
 
 	if (mtx->type == MUTEX_PASSIVE && THREAD) {
-		rc = _semaphore_down_timeout(&mtx->sem, usec, flags);
+		rc = semaphore_trydown(&mtx->sem);
+		if ((rc != EOK) &&
+		    ((usec != 0) || !(flags & SYNCH_FLAGS_NON_BLOCKING))) {
+			atomic_inc(&mutex_stats.contended);
+
+			rc = mutex_spin(mtx);
+			if (rc == EOK) {
+				atomic_inc(&mutex_stats.spun);
+			} else {
+				atomic_inc(&mutex_stats.blocked);
+				rc = _semaphore_down_timeout(&mtx->sem, usec,
+				    flags);
+			}
+		}
+
+		if (rc == EOK) {
+			__atomic_store_n(&mtx->owner_cpu, CPU, __ATOMIC_RELAXED);
+			__atomic_store_n(&mtx->owner, THREAD, __ATOMIC_RELAXED);
+		}
 	} else if (mtx->type == MUTEX_RECURSIVE) {
 		assert(THREAD);
 
@@ -103,6 +209,30 @@ errno_t _mutex_lock_timeout(mutex_t *mtx, uint32_t usec, unsigned int flags)
 				mtx->nesting = 1;
 			}
 		}
+	} else if (mtx->type == MUTEX_PI && THREAD) {
+		rc = semaphore_trydown(&mtx->sem);
+		if ((rc != EOK) &&
+		    ((usec != 0) || !(flags & SYNCH_FLAGS_NON_BLOCKING))) {
+			/*
+			 * Lend our priority to the owner for as long as we
+			 * wait so that it cannot be starved by threads of
+			 * intermediate priority while we are blocked.
+			 */
+			struct thread *owner = mtx->owner;
+			thread_id_t tid = mtx->owner_tid;
+			bool boosted = (owner != NULL) &&
+			    mutex_pi_boost(owner, tid);
+
+			rc = _semaphore_down_timeout(&mtx->sem, usec, flags);
+
+			if (boosted)
+				mutex_pi_unboost(owner, tid);
+		}
+
+		if (rc == EOK) {
+			mtx->owner = THREAD;
+			mtx->owner_tid = THREAD->tid;
+		}
 	} else {
 		assert((mtx->type == MUTEX_ACTIVE) || !THREAD);
 		assert(usec == SYNCH_NO_TIMEOUT);
@@ -133,11 +263,15 @@ errno_t _mutex_lock_timeout(mutex_t *mtx, uint32_t usec, unsigned int flags)
  */
 void mutex_unlock(mutex_t *mtx)
 {
-	if (mtx->type == MUTEX_RECURSIVE) {
+	if (mtx->type == MUTEX_PASSIVE) {
+		__atomic_store_n(&mtx->owner, NULL, __ATOMIC_RELAXED);
+	} else if (mtx->type == MUTEX_RECURSIVE) {
 		assert(mtx->owner == THREAD);
 		if (--mtx->nesting > 0)
 			return;
 		mtx->owner = NULL;
+	} else if (mtx->type == MUTEX_PI) {
+		mtx->owner = NULL;
 	}
 	semaphore_up(&mtx->sem);
 }
@@ -38,6 +38,12 @@
 #include <synch/smp_memory_barrier.h>
 #include <smp/smp_call.h>
 #include <config.h>
+#include <cpu.h>
+#include <proc/task.h>
+#include <arch/barrier.h>
+
+/** Number of barrier requests in flight at the same time. */
+#define SMP_MB_BATCH  16
 
 
 static void issue_mem_bar(void *arg)
@@ -48,14 +54,41 @@ static void issue_mem_bar(void *arg)
 /** Issues a memory barrier on each cpu that is running a thread of the current
  * task.
  *
+ * Only processors which have the address space of the task installed are
+ * interrupted, the others execute a memory barrier when they switch to a
+ * thread of the task. The barriers are requested on all the processors
+ * before waiting for any of them.
+ *
  * @return Irrelevant.
  */
 sys_errno_t sys_smp_memory_barrier(void)
 {
-	for (unsigned int cpu_id = 0; cpu_id < config.cpu_active; ++cpu_id) {
-		smp_call(cpu_id, issue_mem_bar, NULL);
+	smp_call_t calls[SMP_MB_BATCH];
+	size_t count = 0;
+
+	/* Order preceding accesses before the check of tlb_as. */
+	memory_barrier();
+
+	for (unsigned int cpu_id = 0; cpu_id < config.cpu_count; ++cpu_id) {
+		if (!cpus[cpu_id].active)
+			continue;
+
+		if (__atomic_load_n(&cpus[cpu_id].tlb_as, __ATOMIC_RELAXED) !=
+		    AS)
+			continue;
+
+		smp_call_async(cpu_id, issue_mem_bar, NULL, &calls[count++]);
+
+		if (count == SMP_MB_BATCH) {
+			for (size_t i = 0; i < count; ++i)
+				smp_call_wait(&calls[i]);
+			count = 0;
+		}
 	}
 
+	for (size_t i = 0; i < count; ++i)
+		smp_call_wait(&calls[i]);
+
 	return 0;
 }
 
@@ -48,7 +48,39 @@
 
 #ifdef CONFIG_SMP
 
+/*
+ * Layout of the lock word of a ticket lock: the owner ticket
+ * in the lower half and the next ticket in the upper half.
+ */
+#define TICKET_SHIFT  (sizeof(atomic_count_t) * 4)
+#define TICKET_MASK   ((((atomic_count_t) 1) << TICKET_SHIFT) - 1)
+#define TICKET_NEXT   (((atomic_count_t) 1) << TICKET_SHIFT)
+
+/*
+ * Layout of the lock word of an MCS lock: the locked bit and the
+ * queue tail, which encodes the CPU and the nesting level of the
+ * queue node of the last waiter (zero if there are no waiters).
+ */
+#define MCS_LOCKED     ((atomic_count_t) 1)
+#define MCS_TAIL_SHIFT  8
+#define MCS_TAIL_MASK   (~((((atomic_count_t) 1) << MCS_TAIL_SHIFT) - 1))
+
+#define MCS_TAIL(cpu_id, idx) \
+	(((((atomic_count_t) (cpu_id) + 1) * SPINLOCK_MCS_NESTING) + (idx)) << \
+	    MCS_TAIL_SHIFT)
+
+/** State of a single spinning acquisition */
+typedef struct {
+	size_t spins;
+#ifdef CONFIG_DEBUG_SPINLOCK
+	size_t probe;
+	bool deadlock_reported;
+#endif
+} spin_state_t;
+
 /** Initialize spinlock
+ *
+ * The lock is initialized as a test-and-set lock.
  *
  * @param sl Pointer to spinlock_t structure.
  *
@@ -56,11 +88,262 @@
 void spinlock_initialize(spinlock_t *lock, const char *name)
 {
 	atomic_set(&lock->val, 0);
+	lock->kind = SPINLOCK_TAS;
 #ifdef CONFIG_DEBUG_SPINLOCK
 	lock->name = name;
+	lock->stats = (spinlock_stats_t) { 0 };
 #endif
 }
 
+/** Select the implementation of a spinlock
+ *
+ * Must be called while nobody can use the lock, typically right
+ * after the lock is initialized.
+ *
+ * @param lock Pointer to spinlock_t structure.
+ * @param kind Implementation variant.
+ *
+ */
+void spinlock_set_kind(spinlock_t *lock, spinlock_kind_t kind)
+{
+	ASSERT_SPINLOCK(!spinlock_locked(lock), lock);
+
+	atomic_set(&lock->val, 0);
+	lock->kind = kind;
+}
+
+/** Wait for one spin iteration
+ *
+ * In debug kernels, report a possible deadlock if the lock cannot
+ * be acquired for too long.
+ *
+ */
+NO_TRACE static inline void spin_wait(spinlock_t *lock, spin_state_t *state)
+{
+	state->spins++;
+	spin_hint();
+
+#ifdef CONFIG_DEBUG_SPINLOCK
+	/*
+	 * We need to be careful about particular locks
+	 * which are directly used to report deadlocks
+	 * via printf() (and recursively other functions).
+	 * This conserns especially printf_lock and the
+	 * framebuffer lock.
+	 *
+	 * Any lock whose name is prefixed by "*" will be
+	 * ignored by this deadlock detection routine
+	 * as this might cause an infinite recursion.
+	 * We trust our code that there is no possible deadlock
+	 * caused by these locks (except when an exception
+	 * is triggered for instance by printf()).
+	 *
+	 * We encountered false positives caused by very
+	 * slow framebuffer interaction (especially when
+	 * run in a simulator) that caused problems with both
+	 * printf_lock and the framebuffer lock.
+	 */
+	if (lock->name[0] == '*')
+		return;
+
+	if (state->probe++ > DEADLOCK_THRESHOLD) {
+		printf("cpu%u: looping on spinlock %p:%s, "
+		    "caller=%p (%s)\n", CPU->id, lock, lock->name,
+		    (void *) CALLER, symtab_fmt_name_lookup(CALLER));
+		stack_trace();
+
+		state->probe = 0;
+		state->deadlock_reported = true;
+	}
+#endif
+}
+
+NO_TRACE static void tas_acquire(spinlock_t *lock, spin_state_t *state)
+{
+	while (test_and_set(&lock->val))
+		spin_wait(lock, state);
+}
+
+NO_TRACE static void ticket_acquire(spinlock_t *lock, spin_state_t *state)
+{
+	atomic_count_t *word = (atomic_count_t *) &lock->val.count;
+	atomic_count_t ticket = (__atomic_fetch_add(word, TICKET_NEXT,
+	    __ATOMIC_ACQUIRE) >> TICKET_SHIFT) & TICKET_MASK;
+
+	while ((__atomic_load_n(word, __ATOMIC_ACQUIRE) & TICKET_MASK) != ticket)
+		spin_wait(lock, state);
+}
+
+NO_TRACE static void ticket_release(spinlock_t *lock)
+{
+	atomic_count_t *word = (atomic_count_t *) &lock->val.count;
+	atomic_count_t old = __atomic_load_n(word, __ATOMIC_RELAXED);
+	atomic_count_t new;
+
+	/* Advance the owner ticket without carrying into the next ticket. */
+	do {
+		new = (old & ~TICKET_MASK) | ((old + 1) & TICKET_MASK);
+	} while (!__atomic_compare_exchange_n(word, &old, new, false,
+	    __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+NO_TRACE static spinlock_mcs_node_t *mcs_node(atomic_count_t tail)
+{
+	atomic_count_t code = (tail >> MCS_TAIL_SHIFT);
+
+	return &cpus[code / SPINLOCK_MCS_NESTING - 1].spinlock_nodes[
+	    code % SPINLOCK_MCS_NESTING];
+}
+
+/** Acquire an MCS lock
+ *
+ * Waiters enqueue their per-CPU node and spin on it until they
+ * become the head of the queue. Only the head spins on the lock
+ * word itself. The queue node is needed only while waiting, so
+ * the nesting of queue nodes follows the nesting of contexts
+ * (thread, interrupt handler) spinning on the CPU, not the nesting
+ * of locks being held.
+ *
+ */
+NO_TRACE static void mcs_acquire(spinlock_t *lock, spin_state_t *state)
+{
+	atomic_count_t *word = (atomic_count_t *) &lock->val.count;
+	atomic_count_t old = 0;
+
+	if (__atomic_compare_exchange_n(word, &old, MCS_LOCKED, false,
+	    __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+		return;
+
+	if ((CPU == NULL) || (CPU->spinlock_nesting == SPINLOCK_MCS_NESTING)) {
+		/* No queue node available, compete for the locked bit. */
+		while (true) {
+			old = __atomic_load_n(word, __ATOMIC_RELAXED);
+			if ((!(old & MCS_LOCKED)) &&
+			    (__atomic_compare_exchange_n(word, &old,
+			    old | MCS_LOCKED, false, __ATOMIC_ACQUIRE,
+			    __ATOMIC_RELAXED)))
+				return;
+
+			spin_wait(lock, state);
+		}
+	}
+
+	unsigned int idx = CPU->spinlock_nesting++;
+	spinlock_mcs_node_t *node = &CPU->spinlock_nodes[idx];
+	atomic_count_t tail = MCS_TAIL(CPU->id, idx);
+
+	node->next = NULL;
+	node->locked = false;
+
+	/* Become the new tail of the queue */
+	old = __atomic_load_n(word, __ATOMIC_RELAXED);
+	while (!__atomic_compare_exchange_n(word, &old,
+	    (old & ~MCS_TAIL_MASK) | tail, false, __ATOMIC_ACQ_REL,
+	    __ATOMIC_RELAXED))
+		;
+
+	if (old & MCS_TAIL_MASK) {
+		/* Link behind the previous tail and wait to become the head */
+		spinlock_mcs_node_t *prev = mcs_node(old & MCS_TAIL_MASK);
+		__atomic_store_n(&prev->next, node, __ATOMIC_RELEASE);
+
+		while (!__atomic_load_n(&node->locked, __ATOMIC_ACQUIRE))
+			spin_wait(lock, state);
+	}
+
+	/* Head of the queue, wait for the owner to release the lock */
+	while (true) {
+		old = __atomic_load_n(word, __ATOMIC_ACQUIRE);
+		if (old & MCS_LOCKED) {
+			spin_wait(lock, state);
+			continue;
+		}
+
+		if ((old & MCS_TAIL_MASK) == tail) {
+			/* Last in the queue, take the lock and empty the queue */
+			if (__atomic_compare_exchange_n(word, &old, MCS_LOCKED,
+			    false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+				goto out;
+		} else if (__atomic_compare_exchange_n(word, &old,
+		    old | MCS_LOCKED, false, __ATOMIC_ACQUIRE,
+		    __ATOMIC_RELAXED)) {
+			break;
+		}
+	}
+
+	/* Make the successor the new head of the queue */
+	spinlock_mcs_node_t *next;
+	while ((next = __atomic_load_n(&node->next, __ATOMIC_ACQUIRE)) == NULL)
+		spin_wait(lock, state);
+
+	__atomic_store_n(&next->locked, true, __ATOMIC_RELEASE);
+
+out:
+	CPU->spinlock_nesting--;
+}
+
+NO_TRACE static void spinlock_acquire(spinlock_t *lock, spin_state_t *state)
+{
+	switch (lock->kind) {
+	case SPINLOCK_TICKET:
+		ticket_acquire(lock, state);
+		break;
+	case SPINLOCK_MCS:
+		mcs_acquire(lock, state);
+		break;
+	default:
+		tas_acquire(lock, state);
+		break;
+	}
+
+#ifdef CONFIG_DEBUG_SPINLOCK
+	/* The statistics are protected by the lock itself. */
+	lock->stats.acquired++;
+	if (state->spins > 0) {
+		lock->stats.contended++;
+		lock->stats.spins += state->spins;
+	}
+#endif
+}
+
+/** Lock a ticket or MCS spinlock
+ *
+ * Out-of-line slow path of spinlock_lock() for spinlocks
+ * which are not test-and-set locks.
+ *
+ * @param lock Pointer to spinlock_t structure.
+ *
+ */
+void spinlock_lock_queued(spinlock_t *lock)
+{
+	spin_state_t state = { 0 };
+
+	preemption_disable();
+	spinlock_acquire(lock, &state);
+
+	/*
+	 * Prevent critical section code from bleeding out this way up.
+	 */
+	CS_ENTER_BARRIER();
+}
+
+/** Release a ticket or MCS spinlock
+ *
+ * Only updates the lock word, the caller takes care of
+ * the barrier and preemption.
+ *
+ * @param lock Pointer to spinlock_t structure.
+ *
+ */
+void spinlock_release_queued(spinlock_t *lock)
+{
+	if (lock->kind == SPINLOCK_TICKET)
+		ticket_release(lock);
+	else
+		__atomic_fetch_and((atomic_count_t *) &lock->val.count,
+		    ~MCS_LOCKED, __ATOMIC_RELEASE);
+}
+
 #ifdef CONFIG_DEBUG_SPINLOCK
 
 /** Lock spinlock
@@ -74,45 +357,12 @@ void spinlock_initialize(spinlock_t *lock, const char *name)
  */
 void spinlock_lock_debug(spinlock_t *lock)
 {
-	size_t i = 0;
-	bool deadlock_reported = false;
+	spin_state_t state = { 0 };
 
 	preemption_disable();
-	while (test_and_set(&lock->val)) {
-		/*
-		 * We need to be careful about particular locks
-		 * which are directly used to report deadlocks
-		 * via printf() (and recursively other functions).
-		 * This conserns especially printf_lock and the
-		 * framebuffer lock.
-		 *
-		 * Any lock whose name is prefixed by "*" will be
-		 * ignored by this deadlock detection routine
-		 * as this might cause an infinite recursion.
-		 * We trust our code that there is no possible deadlock
-		 * caused by these locks (except when an exception
-		 * is triggered for instance by printf()).
-		 *
-		 * We encountered false positives caused by very
-		 * slow framebuffer interaction (especially when
-		 * run in a simulator) that caused problems with both
-		 * printf_lock and the framebuffer lock.
-		 */
-		if (lock->name[0] == '*')
-			continue;
-
-		if (i++ > DEADLOCK_THRESHOLD) {
-			printf("cpu%u: looping on spinlock %p:%s, "
-			    "caller=%p (%s)\n", CPU->id, lock, lock->name,
-			    (void *) CALLER, symtab_fmt_name_lookup(CALLER));
-			stack_trace();
+	spinlock_acquire(lock, &state);
 
-			i = 0;
-			deadlock_reported = true;
-		}
-	}
-
-	if (deadlock_reported)
+	if (state.deadlock_reported)
 		printf("cpu%u: not deadlocked\n", CPU->id);
 
 	/*
@@ -136,10 +386,27 @@ void spinlock_unlock_debug(spinlock_t *lock)
 	 */
 	CS_LEAVE_BARRIER();
 
-	atomic_set(&lock->val, 0);
+	if (lock->kind == SPINLOCK_TAS)
+		atomic_set(&lock->val, 0);
+	else
+		spinlock_release_queued(lock);
+
 	preemption_enable();
 }
 
+/** Get contention statistics of a spinlock
+ *
+ * The statistics are read without locking and may be slightly stale.
+ *
+ * @param lock  Pointer to spinlock_t structure.
+ * @param stats Place to store the statistics.
+ *
+ */
+void spinlock_stats(spinlock_t *lock, spinlock_stats_t *stats)
+{
+	*stats = lock->stats;
+}
+
 #endif
 
 /** Lock spinlock conditionally
@@ -154,8 +421,29 @@ void spinlock_unlock_debug(spinlock_t *lock)
  */
 bool spinlock_trylock(spinlock_t *lock)
 {
+	atomic_count_t *word = (atomic_count_t *) &lock->val.count;
+	atomic_count_t old;
+	bool ret;
+
 	preemption_disable();
-	bool ret = !test_and_set(&lock->val);
+
+	switch (lock->kind) {
+	case SPINLOCK_TICKET:
+		old = __atomic_load_n(word, __ATOMIC_RELAXED);
+		ret = (((old >> TICKET_SHIFT) & TICKET_MASK) ==
+		    (old & TICKET_MASK)) &&
+		    __atomic_compare_exchange_n(word, &old, old + TICKET_NEXT,
+		    false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+		break;
+	case SPINLOCK_MCS:
+		old = 0;
+		ret = __atomic_compare_exchange_n(word, &old, MCS_LOCKED,
+		    false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+		break;
+	default:
+		ret = !test_and_set(&lock->val);
+		break;
+	}
 
 	/*
 	 * Prevent critical section code from bleeding out this way up.
@@ -164,6 +452,10 @@ bool spinlock_trylock(spinlock_t *lock)
 
 	if (!ret)
 		preemption_enable();
+#ifdef CONFIG_DEBUG_SPINLOCK
+	else
+		lock->stats.acquired++;
+#endif
 
 	return ret;
 }
@@ -175,7 +467,17 @@ bool spinlock_trylock(spinlock_t *lock)
  */
 bool spinlock_locked(spinlock_t *lock)
 {
-	return atomic_get(&lock->val) != 0;
+	atomic_count_t val = atomic_get(&lock->val);
+
+	switch (lock->kind) {
+	case SPINLOCK_TICKET:
+		return ((val >> TICKET_SHIFT) & TICKET_MASK) !=
+		    (val & TICKET_MASK);
+	case SPINLOCK_MCS:
+		return (val & MCS_LOCKED) != 0;
+	default:
+		return val != 0;
+	}
 }
 
 #endif
@@ -193,6 +495,17 @@ void irq_spinlock_initialize(irq_spinlock_t *lock, const char *name)
 	lock->ipl = 0;
 }
 
+/** Select the implementation of an interrupts-disabled spinlock
+ *
+ * @param lock IRQ spinlock.
+ * @param kind Implementation variant.
+ *
+ */
+void irq_spinlock_set_kind(irq_spinlock_t *lock, spinlock_kind_t kind)
+{
+	spinlock_set_kind(&(lock->lock), kind);
+}
+
 /** Lock interrupts-disabled spinlock
  *
  * Lock a spinlock which requires disabled interrupts.
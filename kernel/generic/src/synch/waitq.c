@@ -510,7 +510,7 @@ void _waitq_wakeup_unsafe(waitq_t *wq, wakeup_mode_t mode)
 	assert(irq_spinlock_locked(&wq->lock));
 
 	if (wq->ignore_wakeups > 0) {
-		if (mode == WAKEUP_FIRST) {
+		if (mode != WAKEUP_ALL) {
 			wq->ignore_wakeups--;
 			return;
 		}
@@ -557,7 +557,10 @@ loop:
 	thread->sleep_queue = NULL;
 	irq_spinlock_unlock(&thread->lock, false);
 
-	thread_ready(thread);
+	if (mode == WAKEUP_HANDOFF)
+		thread_ready_handoff(thread);
+	else
+		thread_ready(thread);
 
 	if (mode == WAKEUP_ALL)
 		goto loop;
@@ -56,6 +56,7 @@
 #include <console/console.h>
 #include <udebug/udebug.h>
 #include <log.h>
+#include <ktrace.h>
 
 /** Dispatch system call */
 sysarg_t syscall_handler(sysarg_t a1, sysarg_t a2, sysarg_t a3,
@@ -129,11 +130,13 @@ syshandler_t syscall_table[SYSCALL_END] = {
 	[SYS_THREAD_GET_ID] = (syshandler_t) sys_thread_get_id,
 	[SYS_THREAD_USLEEP] = (syshandler_t) sys_thread_usleep,
 	[SYS_THREAD_UDELAY] = (syshandler_t) sys_thread_udelay,
+	[SYS_THREAD_SET_AFFINITY] = (syshandler_t) sys_thread_set_affinity,
 
 	[SYS_TASK_GET_ID] = (syshandler_t) sys_task_get_id,
 	[SYS_TASK_SET_NAME] = (syshandler_t) sys_task_set_name,
 	[SYS_TASK_KILL] = (syshandler_t) sys_task_kill,
 	[SYS_TASK_EXIT] = (syshandler_t) sys_task_exit,
+	[SYS_TASK_SET_AFFINITY] = (syshandler_t) sys_task_set_affinity,
 	[SYS_PROGRAM_SPAWN_LOADER] = (syshandler_t) sys_program_spawn_loader,
 
 	/* Synchronization related syscalls. */
@@ -154,11 +157,15 @@ syshandler_t syscall_table[SYSCALL_END] = {
 	/* IPC related syscalls. */
 	[SYS_IPC_CALL_ASYNC_FAST] = (syshandler_t) sys_ipc_call_async_fast,
 	[SYS_IPC_CALL_ASYNC_SLOW] = (syshandler_t) sys_ipc_call_async_slow,
+	[SYS_IPC_CALL_ASYNC_BATCH] = (syshandler_t) sys_ipc_call_async_batch,
+	[SYS_IPC_CALL_ASYNC_PAYLOAD] = (syshandler_t) sys_ipc_call_async_payload,
 	[SYS_IPC_ANSWER_FAST] = (syshandler_t) sys_ipc_answer_fast,
 	[SYS_IPC_ANSWER_SLOW] = (syshandler_t) sys_ipc_answer_slow,
 	[SYS_IPC_FORWARD_FAST] = (syshandler_t) sys_ipc_forward_fast,
 	[SYS_IPC_FORWARD_SLOW] = (syshandler_t) sys_ipc_forward_slow,
 	[SYS_IPC_WAIT] = (syshandler_t) sys_ipc_wait_for_call,
+	[SYS_IPC_WAIT_BATCH] = (syshandler_t) sys_ipc_wait_for_call_batch,
+	[SYS_IPC_PAYLOAD_GET] = (syshandler_t) sys_ipc_payload_get,
 	[SYS_IPC_POKE] = (syshandler_t) sys_ipc_poke,
 	[SYS_IPC_HANGUP] = (syshandler_t) sys_ipc_hangup,
 	[SYS_IPC_CONNECT_KBOX] = (syshandler_t) sys_ipc_connect_kbox,
@@ -182,6 +189,8 @@ syshandler_t syscall_table[SYSCALL_END] = {
 
 	[SYS_IPC_IRQ_SUBSCRIBE] = (syshandler_t) sys_ipc_irq_subscribe,
 	[SYS_IPC_IRQ_UNSUBSCRIBE] = (syshandler_t) sys_ipc_irq_unsubscribe,
+	[SYS_IPC_IRQ_COALESCE] = (syshandler_t) sys_ipc_irq_coalesce,
+	[SYS_IPC_IRQ_SET_AFFINITY] = (syshandler_t) sys_ipc_irq_set_affinity,
 
 	/* Sysinfo syscalls. */
 	[SYS_SYSINFO_GET_KEYS_SIZE] = (syshandler_t) sys_sysinfo_get_keys_size,
@@ -195,6 +204,7 @@ syshandler_t syscall_table[SYSCALL_END] = {
 	[SYS_DEBUG_CONSOLE] = (syshandler_t) sys_debug_console,
 
 	[SYS_KLOG] = (syshandler_t) sys_klog,
+	[SYS_KTRACE] = (syshandler_t) sys_ktrace,
 };
 
 /** @}
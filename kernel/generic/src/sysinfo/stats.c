@@ -42,11 +42,16 @@
 #include <synch/mutex.h>
 #include <time/clock.h>
 #include <mm/frame.h>
+#include <mm/slab.h>
 #include <proc/task.h>
 #include <proc/thread.h>
+#include <ipc/ipc.h>
+#include <ddi/irq.h>
+#include <cap/cap.h>
 #include <interrupt.h>
 #include <stdbool.h>
 #include <str.h>
+#include <macros.h>
 #include <errno.h>
 #include <cpu.h>
 #include <arch.h>
@@ -115,6 +120,9 @@ static void *get_stats_cpus(struct sysinfo_item *item, size_t *size,
 		stats_cpus[i].frequency_mhz = cpus[i].frequency_mhz;
 		stats_cpus[i].busy_cycles = cpus[i].busy_cycles;
 		stats_cpus[i].idle_cycles = cpus[i].idle_cycles;
+		stats_cpus[i].steal_attempts = cpus[i].steal_attempts;
+		stats_cpus[i].steal_successes = cpus[i].steal_successes;
+		stats_cpus[i].nrdy = atomic_get(&cpus[i].nrdy);
 
 		irq_spinlock_unlock(&cpus[i].lock, true);
 	}
@@ -122,6 +130,71 @@ static void *get_stats_cpus(struct sysinfo_item *item, size_t *size,
 	return ((void *) stats_cpus);
 }
 
+/** Get interrupt statistics of all CPUs
+ *
+ * Only INRs which have been handled at least once by a CPU are reported.
+ *
+ * @param item    Sysinfo item (unused).
+ * @param size    Size of the returned data.
+ * @param dry_run Do not get the data, just calculate the size.
+ * @param data    Unused.
+ *
+ * @return Data containing several stats_irq_t structures.
+ *         If the return value is not NULL, it should be freed
+ *         in the context of the sysinfo request.
+ */
+static void *get_stats_irqs(struct sysinfo_item *item, size_t *size,
+    bool dry_run, void *data)
+{
+	size_t count = 0;
+	size_t i;
+	inr_t inr;
+
+	for (i = 0; i < config.cpu_count; i++) {
+		if (cpus[i].irq_counts == NULL)
+			continue;
+
+		for (inr = 0; inr <= last_inr; inr++) {
+			if (cpus[i].irq_counts[inr] != 0)
+				count++;
+		}
+	}
+
+	*size = sizeof(stats_irq_t) * count;
+	if ((dry_run) || (count == 0))
+		return NULL;
+
+	stats_irq_t *stats_irqs = (stats_irq_t *) malloc(*size);
+	if (stats_irqs == NULL) {
+		*size = 0;
+		return NULL;
+	}
+
+	/*
+	 * The counters only grow, so no new non-zero entries can be
+	 * found, only fewer of them fit if more have appeared meanwhile.
+	 */
+	size_t pos = 0;
+	for (i = 0; i < config.cpu_count; i++) {
+		if (cpus[i].irq_counts == NULL)
+			continue;
+
+		for (inr = 0; (inr <= last_inr) && (pos < count); inr++) {
+			uint64_t irqs = cpus[i].irq_counts[inr];
+			if (irqs == 0)
+				continue;
+
+			stats_irqs[pos].inr = inr;
+			stats_irqs[pos].cpu = i;
+			stats_irqs[pos].count = irqs;
+			pos++;
+		}
+	}
+
+	*size = sizeof(stats_irq_t) * pos;
+	return ((void *) stats_irqs);
+}
+
 /** Count number of nodes in an AVL tree
  *
  * AVL tree walker for counting nodes.
@@ -161,19 +234,14 @@ static size_t get_task_virtmem(as_t *as)
 
 	size_t pages = 0;
 
-	/* Walk the B+ tree and count pages */
-	list_foreach(as->as_area_btree.leaf_list, leaf_link, btree_node_t,
-	    node) {
-		unsigned int i;
-		for (i = 0; i < node->keys; i++) {
-			as_area_t *area = node->value[i];
-
-			if (mutex_trylock(&area->lock) != EOK)
-				continue;
+	/* Walk the areas and count pages */
+	for (as_area_t *area = as_area_first(as); area != NULL;
+	    area = as_area_next(area)) {
+		if (mutex_trylock(&area->lock) != EOK)
+			continue;
 
-			pages += area->pages;
-			mutex_unlock(&area->lock);
-		}
+		pages += area->pages;
+		mutex_unlock(&area->lock);
 	}
 
 	mutex_unlock(&as->lock);
@@ -202,18 +270,14 @@ static size_t get_task_resmem(as_t *as)
 
 	size_t pages = 0;
 
-	/* Walk the B+ tree and count pages */
-	list_foreach(as->as_area_btree.leaf_list, leaf_link, btree_node_t, node) {
-		unsigned int i;
-		for (i = 0; i < node->keys; i++) {
-			as_area_t *area = node->value[i];
-
-			if (mutex_trylock(&area->lock) != EOK)
-				continue;
+	/* Walk the areas and count pages */
+	for (as_area_t *area = as_area_first(as); area != NULL;
+	    area = as_area_next(area)) {
+		if (mutex_trylock(&area->lock) != EOK)
+			continue;
 
-			pages += area->resident;
-			mutex_unlock(&area->lock);
-		}
+		pages += area->resident;
+		mutex_unlock(&area->lock);
 	}
 
 	mutex_unlock(&as->lock);
@@ -241,6 +305,8 @@ static void produce_stats_task(task_t *task, stats_task_t *stats_task)
 	stats_task->threads = atomic_get(&task->refcount);
 	task_get_accounting(task, &(stats_task->ucycles),
 	    &(stats_task->kcycles));
+	stats_task->page_faults = task->page_faults;
+	stats_task->pages_prefaulted = task->pages_prefaulted;
 	stats_task->ipc_info = task->ipc_info;
 }
 
@@ -571,6 +637,127 @@ static sysinfo_return_t get_stats_thread(const char *name, bool dry_run,
 	return ret;
 }
 
+/** Iterator of the phone statistics walk */
+typedef struct {
+	stats_phone_t *phones;
+	size_t count;
+	size_t max;
+} phone_walk_t;
+
+static bool phone_count_cb(cap_t *cap, void *arg)
+{
+	size_t *count = (size_t *) arg;
+	(*count)++;
+	return true;
+}
+
+/** Gather statistics of a phone
+ *
+ * Capability walker for gathering phone statistics.
+ *
+ * @param cap Phone capability.
+ * @param arg Pointer to the phone_walk_t iterator.
+ *
+ * @return False once the walk iterator is full.
+ *
+ */
+static bool phone_serialize_cb(cap_t *cap, void *arg)
+{
+	phone_walk_t *walk = (phone_walk_t *) arg;
+	phone_t *phone = cap->kobject->phone;
+
+	if (walk->count == walk->max)
+		return false;
+
+	mutex_lock(&phone->lock);
+	if (phone->state != IPC_PHONE_FREE) {
+		stats_phone_t *stats_phone = &walk->phones[walk->count++];
+
+		stats_phone->task_id = phone->caller->taskid;
+		stats_phone->handle = (sysarg_t) CAP_HANDLE_RAW(cap->handle);
+		stats_phone->callee_id =
+		    (phone->state == IPC_PHONE_CONNECTED) ?
+		    phone->callee->task->taskid : 0;
+		stats_phone->ipc_info = phone->ipc_info;
+	}
+	mutex_unlock(&phone->lock);
+
+	return true;
+}
+
+/** Get phone statistics of a task
+ *
+ * Get statistics of all phones of a given task. The task ID is
+ * passed as a string.
+ *
+ * @param name    Task ID (string-encoded number).
+ * @param dry_run Do not get the data, just calculate the size.
+ * @param data    Unused.
+ *
+ * @return Sysinfo return holder. The type of the returned
+ *         data is either SYSINFO_VAL_UNDEFINED (unknown
+ *         task ID or memory allocation error) or
+ *         SYSINFO_VAL_FUNCTION_DATA (in that case the
+ *         generated data should be freed within the
+ *         sysinfo request context).
+ *
+ */
+static sysinfo_return_t get_stats_phones(const char *name, bool dry_run,
+    void *data)
+{
+	/* Initially no return value */
+	sysinfo_return_t ret;
+	ret.tag = SYSINFO_VAL_UNDEFINED;
+
+	/* Parse the task ID */
+	task_id_t task_id;
+	if (str_uint64_t(name, NULL, 0, true, &task_id) != EOK)
+		return ret;
+
+	irq_spinlock_lock(&tasks_lock, true);
+
+	task_t *task = task_find_by_id(task_id);
+	if (task == NULL) {
+		/* No task with this ID */
+		irq_spinlock_unlock(&tasks_lock, true);
+		return ret;
+	}
+
+	/* The capabilities are protected by a mutex */
+	task_hold(task);
+	irq_spinlock_unlock(&tasks_lock, true);
+
+	size_t count = 0;
+	caps_apply_to_kobject_type(task, KOBJECT_TYPE_PHONE, phone_count_cb,
+	    &count);
+
+	ret.tag = SYSINFO_VAL_FUNCTION_DATA;
+	ret.data.data = NULL;
+	ret.data.size = sizeof(stats_phone_t) * count;
+
+	if ((!dry_run) && (count > 0)) {
+		phone_walk_t walk;
+		walk.phones = (stats_phone_t *) malloc(ret.data.size);
+		walk.count = 0;
+		walk.max = count;
+
+		if (walk.phones == NULL) {
+			task_release(task);
+			ret.tag = SYSINFO_VAL_UNDEFINED;
+			return ret;
+		}
+
+		caps_apply_to_kobject_type(task, KOBJECT_TYPE_PHONE,
+		    phone_serialize_cb, &walk);
+
+		ret.data.data = (void *) walk.phones;
+		ret.data.size = sizeof(stats_phone_t) * walk.count;
+	}
+
+	task_release(task);
+	return ret;
+}
+
 /** Get exceptions statistics
  *
  * @param item    Sysinfo item (unused).
@@ -724,6 +911,112 @@ static void *get_stats_physmem(struct sysinfo_item *item, size_t *size,
 	return ((void *) stats_physmem);
 }
 
+/** Get slab cache statistics
+ *
+ * @param item    Sysinfo item (unused).
+ * @param size    Size of the returned data.
+ * @param dry_run Do not get the data, just calculate the size.
+ * @param data    Unused.
+ *
+ * @return Data containing several stats_slab_t structures.
+ *         If the return value is not NULL, it should be freed
+ *         in the context of the sysinfo request.
+ */
+static void *get_stats_slabs(struct sysinfo_item *item, size_t *size,
+    bool dry_run, void *data)
+{
+	/* Count the caches first, we cannot allocate while walking them */
+	size_t count = slab_stats_get(NULL, 0, SLAB_STATS_ALL_CPUS);
+
+	*size = sizeof(stats_slab_t) * count;
+	if ((dry_run) || (count == 0))
+		return NULL;
+
+	stats_slab_t *stats_slabs = (stats_slab_t *) malloc(*size);
+	if (stats_slabs == NULL) {
+		*size = 0;
+		return NULL;
+	}
+
+	/* Caches might have been created or destroyed in the meantime */
+	count = min(count, slab_stats_get(stats_slabs, count,
+	    SLAB_STATS_ALL_CPUS));
+	*size = sizeof(stats_slab_t) * count;
+
+	return ((void *) stats_slabs);
+}
+
+/** Get slab cache statistics of a single CPU
+ *
+ * The magazine counters (hits, misses and contention) are those
+ * of the given CPU only, the other members are the same as in
+ * system.slabs.
+ *
+ * @param name    CPU ID (string-encoded number).
+ * @param dry_run Do not get the data, just calculate the size.
+ * @param data    Unused.
+ *
+ * @return Sysinfo return holder. The type of the returned
+ *         data is either SYSINFO_VAL_UNDEFINED (unknown
+ *         CPU ID or memory allocation error) or
+ *         SYSINFO_VAL_FUNCTION_DATA (in that case the
+ *         generated data should be freed within the
+ *         sysinfo request context).
+ *
+ */
+static sysinfo_return_t get_stats_slabs_cpu(const char *name, bool dry_run,
+    void *data)
+{
+	/* Initially no return value */
+	sysinfo_return_t ret;
+	ret.tag = SYSINFO_VAL_UNDEFINED;
+
+	/* Parse the CPU ID */
+	uint64_t cpu;
+	if (str_uint64_t(name, NULL, 0, true, &cpu) != EOK)
+		return ret;
+
+	if (cpu >= config.cpu_count)
+		return ret;
+
+	/* Count the caches first, we cannot allocate while walking them */
+	size_t count = slab_stats_get(NULL, 0, cpu);
+
+	if ((dry_run) || (count == 0)) {
+		ret.tag = SYSINFO_VAL_FUNCTION_DATA;
+		ret.data.data = NULL;
+		ret.data.size = sizeof(stats_slab_t) * count;
+		return ret;
+	}
+
+	stats_slab_t *stats_slabs =
+	    (stats_slab_t *) malloc(sizeof(stats_slab_t) * count);
+	if (stats_slabs == NULL)
+		return ret;
+
+	/* Caches might have been created or destroyed in the meantime */
+	count = min(count, slab_stats_get(stats_slabs, count, cpu));
+
+	ret.tag = SYSINFO_VAL_FUNCTION_DATA;
+	ret.data.data = (void *) stats_slabs;
+	ret.data.size = sizeof(stats_slab_t) * count;
+
+	return ret;
+}
+
+/** Get a mutex contention counter
+ *
+ * @param item Sysinfo item (unused).
+ * @param data Counter in mutex_stats.
+ *
+ * @return Current value of the counter.
+ *
+ */
+static sysarg_t get_stats_mutex(struct sysinfo_item *item, void *data)
+{
+	return (sysarg_t) atomic_get((atomic_t *) data);
+}
+
 /** Get system load
  *
  * @param item    Sysinfo item (unused).
@@ -806,14 +1099,24 @@ void stats_init(void)
 	mutex_initialize(&load_lock, MUTEX_PASSIVE);
 
 	sysinfo_set_item_gen_data("system.cpus", NULL, get_stats_cpus, NULL);
+	sysinfo_set_item_gen_data("system.irqs", NULL, get_stats_irqs, NULL);
 	sysinfo_set_item_gen_data("system.physmem", NULL, get_stats_physmem, NULL);
 	sysinfo_set_item_gen_data("system.load", NULL, get_stats_load, NULL);
 	sysinfo_set_item_gen_data("system.tasks", NULL, get_stats_tasks, NULL);
 	sysinfo_set_item_gen_data("system.threads", NULL, get_stats_threads, NULL);
 	sysinfo_set_item_gen_data("system.exceptions", NULL, get_stats_exceptions, NULL);
+	sysinfo_set_item_gen_data("system.slabs", NULL, get_stats_slabs, NULL);
+	sysinfo_set_item_gen_val("system.mutex.contended", NULL,
+	    get_stats_mutex, &mutex_stats.contended);
+	sysinfo_set_item_gen_val("system.mutex.spun", NULL,
+	    get_stats_mutex, &mutex_stats.spun);
+	sysinfo_set_item_gen_val("system.mutex.blocked", NULL,
+	    get_stats_mutex, &mutex_stats.blocked);
 	sysinfo_set_subtree_fn("system.tasks", NULL, get_stats_task, NULL);
 	sysinfo_set_subtree_fn("system.threads", NULL, get_stats_thread, NULL);
+	sysinfo_set_subtree_fn("system.phones", NULL, get_stats_phones, NULL);
 	sysinfo_set_subtree_fn("system.exceptions", NULL, get_stats_exception, NULL);
+	sysinfo_set_subtree_fn("system.slabs", NULL, get_stats_slabs_cpu, NULL);
 }
 
 /** @}
@@ -57,6 +57,8 @@
 #include <mm/frame.h>
 #include <ddi/ddi.h>
 #include <arch/cycle.h>
+#include <assert.h>
+#include <macros.h>
 
 /* Pointer to variable with uptime */
 uptime_t *uptime;
@@ -64,6 +66,20 @@ uptime_t *uptime;
 /** Physical memory area of the real time clock */
 static parea_t clock_parea;
 
+/** Local timer operations for stopping the tick on idle processors */
+static clock_dyntick_ops_t *dyntick_ops = NULL;
+
+/** Frequency of the invariant cycle counter in Hz or zero if unavailable */
+static uint64_t cycle_frequency = 0;
+
+/** Fixed point shift of the cycle to nanosecond conversion
+ *
+ * With the counter rebased every second, the product of the elapsed
+ * cycles and the multiplier does not overflow for cycle counters
+ * slower than several THz.
+ */
+#define CYCLE_SHIFT  24
+
 /** Fragment of second
  *
  * For updating  seconds correctly.
@@ -90,6 +106,23 @@ void clock_counter_init(void)
 	uptime->seconds2 = 0;
 	uptime->useconds = 0;
 
+	uptime->cycle_seq = 0;
+	uptime->cycle_mult = 0;
+	uptime->cycle_shift = 0;
+	uptime->cycles = 0;
+	uptime->nseconds = 0;
+
+	if (cycle_frequency != 0) {
+		uint64_t mult = (UINT64_C(1000000000) << CYCLE_SHIFT) /
+		    cycle_frequency;
+		if ((mult > 0) && (mult <= UINT32_MAX)) {
+			uptime->cycles = get_cycle();
+			uptime->cycle_shift = CYCLE_SHIFT;
+			write_barrier();
+			uptime->cycle_mult = mult;
+		}
+	}
+
 	clock_parea.pbase = faddr;
 	clock_parea.frames = 1;
 	clock_parea.unpriv = true;
@@ -104,6 +137,83 @@ void clock_counter_init(void)
 	sysinfo_set_item_val("clock.faddr", NULL, (sysarg_t) faddr);
 }
 
+/** Register an invariant cycle counter
+ *
+ * Called by the architecture on the bootstrap processor before
+ * clock_counter_init() if the cycle counter runs at a constant rate,
+ * is synchronized among processors and can be read from userspace.
+ *
+ * @param frequency Frequency of the cycle counter in Hz.
+ *
+ */
+void clock_cycle_register(uint64_t frequency)
+{
+	cycle_frequency = frequency;
+}
+
+/** Rebase the cycle counter calibration
+ *
+ * Move the base of the calibration to the current cycle so that
+ * the conversion in userspace does not overflow.
+ *
+ */
+static void clock_cycle_rebase(void)
+{
+	if (uptime->cycle_mult == 0)
+		return;
+
+	uint64_t now = get_cycle();
+	uint64_t nsec = uptime->nseconds + (((now - uptime->cycles) *
+	    uptime->cycle_mult) >> uptime->cycle_shift);
+
+	uptime->cycle_seq++;
+	write_barrier();
+	uptime->cycles = now;
+	uptime->nseconds = nsec;
+	write_barrier();
+	uptime->cycle_seq++;
+}
+
+/** Get the uptime in nanoseconds
+ *
+ * Use the cycle counter calibration if there is one so that the result
+ * is comparable with the uptime computed by the userspace, otherwise
+ * fall back to the resolution of the clock tick.
+ *
+ * @return Nanoseconds since the clock was initialized.
+ *
+ */
+uint64_t clock_uptime_nsec(void)
+{
+	if (uptime->cycle_mult != 0) {
+		sysarg_t seq;
+		uint64_t base;
+		uint64_t nsec;
+
+		do {
+			seq = uptime->cycle_seq;
+			read_barrier();
+			base = uptime->cycles;
+			nsec = uptime->nseconds;
+			read_barrier();
+		} while ((seq & 1) || (seq != uptime->cycle_seq));
+
+		return nsec + (((get_cycle() - base) * uptime->cycle_mult) >>
+		    uptime->cycle_shift);
+	}
+
+	sysarg_t s2 = uptime->seconds2;
+	read_barrier();
+	sysarg_t us = uptime->useconds;
+	read_barrier();
+	sysarg_t s1 = uptime->seconds1;
+
+	if (s1 != s2)
+		return (uint64_t) max(s1, s2) * 1000000000;
+
+	return (uint64_t) s1 * 1000000000 + (uint64_t) us * 1000;
+}
+
 /** Update public counters
  *
  * Update it only on first processor
@@ -121,6 +231,8 @@ static void clock_update_counters(void)
 			uptime->useconds = secfrag;
 			write_barrier();
 			uptime->seconds2 = uptime->seconds1;
+
+			clock_cycle_rebase();
 		} else
 			uptime->useconds += 1000000 / HZ;
 	}
@@ -135,6 +247,90 @@ static void cpu_update_accounting(void)
 	irq_spinlock_unlock(&CPU->lock, false);
 }
 
+/** Register local timer operations for stopping the tick
+ *
+ * Only architectures whose cpu_interruptible_sleep() enables interrupts
+ * and goes to sleep atomically may stop the tick. Otherwise a wakeup
+ * lost in between would be delayed until the one-shot timer fires.
+ *
+ * @param ops Operations of the local timer.
+ *
+ */
+void clock_dyntick_register(clock_dyntick_ops_t *ops)
+{
+	dyntick_ops = ops;
+}
+
+/** Stop the periodic tick of an idle processor
+ *
+ * Program the local timer to fire when the earliest timeout of the
+ * processor is due. Processor 0 keeps ticking as it maintains the
+ * uptime shared with userspace. Must be called with interrupts
+ * disabled right before the processor goes to sleep.
+ *
+ */
+void clock_idle_enter(void)
+{
+	assert(interrupts_disabled());
+
+	if ((dyntick_ops == NULL) || (CPU->id == 0))
+		return;
+
+	uint64_t ticks = min3(timeout_idle_ticks(), dyntick_ops->max_ticks(),
+	    CLOCK_IDLE_TICKS_MAX);
+	if (ticks < 2)
+		return;
+
+	/*
+	 * Pairs with the barrier in clock_idle_kick(). Either the
+	 * processor readying a thread sees the tick stopped or this
+	 * processor sees the thread.
+	 */
+	CPU->tickless = true;
+	memory_barrier();
+	if (atomic_get(&CPU->nrdy) != 0) {
+		CPU->tickless = false;
+		return;
+	}
+
+	dyntick_ops->oneshot(ticks);
+}
+
+/** Resume the periodic tick of a processor waking up from idle
+ *
+ * The ticks that elapsed while the tick was stopped are processed
+ * by the next clock() as missed ticks. Must be called with interrupts
+ * disabled.
+ *
+ */
+void clock_idle_exit(void)
+{
+	assert(interrupts_disabled());
+
+	if (!CPU->tickless)
+		return;
+
+	CPU->tickless = false;
+	CPU->missed_clock_ticks += dyntick_ops->periodic();
+}
+
+/** Wake up a processor with a stopped tick
+ *
+ * Called after a thread has been readied to the run queue of @a cpu.
+ *
+ * @param cpu Processor whose run queue received a thread.
+ *
+ */
+void clock_idle_kick(cpu_t *cpu)
+{
+	if ((dyntick_ops == NULL) || (cpu == CPU))
+		return;
+
+	memory_barrier();
+	if (cpu->tickless)
+		dyntick_ops->kick(cpu->id);
+}
+
 /** Clock routine
  *
  * Clock routine executed from clock interrupt handler
@@ -144,49 +340,30 @@ static void cpu_update_accounting(void)
  */
 void clock(void)
 {
+	if (CPU->tickless) {
+		/*
+		 * The one-shot timer of an idle processor has expired.
+		 * This call accounts for one of the elapsed ticks.
+		 */
+		CPU->tickless = false;
+		uint64_t elapsed = dyntick_ops->periodic();
+		if (elapsed > 0)
+			CPU->missed_clock_ticks += elapsed - 1;
+	}
+
 	size_t missed_clock_ticks = CPU->missed_clock_ticks;
 
 	/* Account CPU usage */
 	cpu_update_accounting();
 
-	/*
-	 * To avoid lock ordering problems,
-	 * run all expired timeouts as you visit them.
-	 *
-	 */
 	size_t i;
 	for (i = 0; i <= missed_clock_ticks; i++) {
 		/* Update counters and accounting */
 		clock_update_counters();
 		cpu_update_accounting();
 
-		irq_spinlock_lock(&CPU->timeoutlock, false);
-
-		link_t *cur;
-		while ((cur = list_first(&CPU->timeout_active_list)) != NULL) {
-			timeout_t *timeout = list_get_instance(cur, timeout_t,
-			    link);
-
-			irq_spinlock_lock(&timeout->lock, false);
-			if (timeout->ticks-- != 0) {
-				irq_spinlock_unlock(&timeout->lock, false);
-				break;
-			}
-
-			list_remove(cur);
-			timeout_handler_t handler = timeout->handler;
-			void *arg = timeout->arg;
-			timeout_reinitialize(timeout);
-
-			irq_spinlock_unlock(&timeout->lock, false);
-			irq_spinlock_unlock(&CPU->timeoutlock, false);
-
-			handler(arg);
-
-			irq_spinlock_lock(&CPU->timeoutlock, false);
-		}
-
-		irq_spinlock_unlock(&CPU->timeoutlock, false);
+		/* Run expired timeouts */
+		timeout_tick();
 	}
 	CPU->missed_clock_ticks = 0;
 
@@ -53,7 +53,69 @@
 void timeout_init(void)
 {
 	irq_spinlock_initialize(&CPU->timeoutlock, "cpu.timeoutlock");
-	list_initialize(&CPU->timeout_active_list);
+
+	CPU->timeout_wheel.now = 0;
+	for (unsigned int i = 0; i < TIMEOUT_WHEEL_LEVELS; i++) {
+		for (unsigned int j = 0; j < TIMEOUT_WHEEL_SLOTS; j++)
+			list_initialize(&CPU->timeout_wheel.slot[i][j]);
+	}
+}
+
+/** Insert timeout into the timeout wheel
+ *
+ * The timeout is placed on the lowest level of the wheel whose
+ * span covers its deadline. Timeouts beyond the span of the whole
+ * wheel are placed at its far end and are re-inserted when they
+ * get cascaded.
+ *
+ * @param wheel   Timeout wheel. Its lock must be held.
+ * @param timeout Timeout to be inserted.
+ *
+ */
+static void timeout_wheel_insert(timeout_wheel_t *wheel, timeout_t *timeout)
+{
+	uint64_t delta = 0;
+	if (timeout->deadline > wheel->now)
+		delta = timeout->deadline - wheel->now;
+
+	unsigned int level = 0;
+	while ((level < TIMEOUT_WHEEL_LEVELS - 1) &&
+	    (delta >= ((uint64_t) 1 << ((level + 1) * TIMEOUT_WHEEL_BITS))))
+		level++;
+
+	uint64_t span = (uint64_t) 1 << (TIMEOUT_WHEEL_LEVELS *
+	    TIMEOUT_WHEEL_BITS);
+	if (delta >= span)
+		delta = span - 1;
+
+	uint64_t expires = wheel->now + delta;
+	unsigned int idx = (expires >> (level * TIMEOUT_WHEEL_BITS)) &
+	    TIMEOUT_WHEEL_MASK;
+
+	list_append(&timeout->link, &wheel->slot[level][idx]);
+}
+
+/** Move timeouts of one slot to lower levels of the timeout wheel
+ *
+ * @param wheel Timeout wheel. Its lock must be held.
+ * @param level Level of the slot.
+ * @param idx   Index of the slot.
+ *
+ */
+static void timeout_wheel_cascade(timeout_wheel_t *wheel, unsigned int level,
+    unsigned int idx)
+{
+	list_t pending;
+	list_initialize(&pending);
+	list_concat(&pending, &wheel->slot[level][idx]);
+
+	link_t *cur;
+	while ((cur = list_first(&pending)) != NULL) {
+		timeout_t *timeout = list_get_instance(cur, timeout_t, link);
+
+		list_remove(cur);
+		timeout_wheel_insert(wheel, timeout);
+	}
 }
 
 /** Reinitialize timeout
@@ -66,7 +128,7 @@ void timeout_init(void)
 void timeout_reinitialize(timeout_t *timeout)
 {
 	timeout->cpu = NULL;
-	timeout->ticks = 0;
+	timeout->deadline = 0;
 	timeout->handler = NULL;
 	timeout->arg = NULL;
 	link_initialize(&timeout->link);
@@ -107,49 +169,12 @@ void timeout_register(timeout_t *timeout, uint64_t time,
 		panic("Unexpected: timeout->cpu != 0.");
 
 	timeout->cpu = CPU;
-	timeout->ticks = us2ticks(time);
+	timeout->deadline = CPU->timeout_wheel.now + us2ticks(time);
 
 	timeout->handler = handler;
 	timeout->arg = arg;
 
-	/*
-	 * Insert timeout into the active timeouts list according to timeout->ticks.
-	 */
-	uint64_t sum = 0;
-	timeout_t *target = NULL;
-	link_t *cur;
-	for (cur = CPU->timeout_active_list.head.next;
-	    cur != &CPU->timeout_active_list.head; cur = cur->next) {
-		target = list_get_instance(cur, timeout_t, link);
-		irq_spinlock_lock(&target->lock, false);
-
-		if (timeout->ticks < sum + target->ticks) {
-			irq_spinlock_unlock(&target->lock, false);
-			break;
-		}
-
-		sum += target->ticks;
-		irq_spinlock_unlock(&target->lock, false);
-	}
-
-	/* Avoid using cur->prev directly */
-	link_t *prev = cur->prev;
-	list_insert_after(&timeout->link, prev);
-
-	/*
-	 * Adjust timeout->ticks according to ticks
-	 * accumulated in target's predecessors.
-	 */
-	timeout->ticks -= sum;
-
-	/*
-	 * Decrease ticks of timeout's immediate succesor by timeout->ticks.
-	 */
-	if (cur != &CPU->timeout_active_list.head) {
-		irq_spinlock_lock(&target->lock, false);
-		target->ticks -= timeout->ticks;
-		irq_spinlock_unlock(&target->lock, false);
-	}
+	timeout_wheel_insert(&CPU->timeout_wheel, timeout);
 
 	irq_spinlock_unlock(&timeout->lock, false);
 	irq_spinlock_unlock(&CPU->timeoutlock, true);
@@ -183,17 +208,9 @@ grab_locks:
 
 	/*
 	 * Now we know for sure that timeout hasn't been activated yet
-	 * and is lurking in timeout->cpu->timeout_active_list.
+	 * and is lurking in the timeout wheel of timeout->cpu.
 	 */
 
-	link_t *cur = timeout->link.next;
-	if (cur != &timeout->cpu->timeout_active_list.head) {
-		timeout_t *tmp = list_get_instance(cur, timeout_t, link);
-		irq_spinlock_lock(&tmp->lock, false);
-		tmp->ticks += timeout->ticks;
-		irq_spinlock_unlock(&tmp->lock, false);
-	}
-
 	list_remove(&timeout->link);
 	irq_spinlock_unlock(&timeout->cpu->timeoutlock, false);
 
@@ -203,5 +220,114 @@ grab_locks:
 	return true;
 }
 
+/** Find out how many ticks the local processor can skip
+ *
+ * Slots of the higher levels of the wheel are accounted for by the
+ * tick at which they get cascaded, which is the earliest deadline
+ * their timeouts can have.
+ *
+ * @return Number of ticks until the earliest tick at which a timeout
+ *         may expire.
+ *
+ */
+uint64_t timeout_idle_ticks(void)
+{
+	timeout_wheel_t *wheel = &CPU->timeout_wheel;
+	uint64_t ticks = UINT64_MAX;
+
+	irq_spinlock_lock(&CPU->timeoutlock, false);
+
+	for (unsigned int d = 0; d < TIMEOUT_WHEEL_SLOTS; d++) {
+		if (!list_empty(&wheel->slot[0][(wheel->now + d) &
+		    TIMEOUT_WHEEL_MASK])) {
+			ticks = d;
+			break;
+		}
+	}
+
+	for (unsigned int level = 1; level < TIMEOUT_WHEEL_LEVELS; level++) {
+		unsigned int shift = level * TIMEOUT_WHEEL_BITS;
+		uint64_t block = wheel->now >> shift;
+
+		for (unsigned int d = 1; d <= TIMEOUT_WHEEL_SLOTS; d++) {
+			if (!list_empty(&wheel->slot[level][(block + d) &
+			    TIMEOUT_WHEEL_MASK])) {
+				uint64_t start = ((block + d) << shift) - wheel->now;
+				if (start < ticks)
+					ticks = start;
+				break;
+			}
+		}
+	}
+
+	irq_spinlock_unlock(&CPU->timeoutlock, false);
+
+	return ticks;
+}
+
+/** Process one tick of the timeout wheel
+ *
+ * Cascade timeouts from higher levels of the wheel as it wraps
+ * around and run the timeouts which expire in the current tick.
+ * Must be called from clock() on the local processor with
+ * interrupts disabled.
+ *
+ */
+void timeout_tick(void)
+{
+	timeout_wheel_t *wheel = &CPU->timeout_wheel;
+
+	irq_spinlock_lock(&CPU->timeoutlock, false);
+
+	unsigned int idx = wheel->now & TIMEOUT_WHEEL_MASK;
+	if (idx == 0) {
+		for (unsigned int level = 1; level < TIMEOUT_WHEEL_LEVELS;
+		    level++) {
+			unsigned int lidx = (wheel->now >>
+			    (level * TIMEOUT_WHEEL_BITS)) & TIMEOUT_WHEEL_MASK;
+
+			timeout_wheel_cascade(wheel, level, lidx);
+			if (lidx != 0)
+				break;
+		}
+	}
+
+	/*
+	 * Timeouts registered by the handlers belong to the future
+	 * ticks. The expired timeouts can still be unregistered while
+	 * the lock is dropped to run the handlers.
+	 */
+	list_t expired;
+	list_initialize(&expired);
+	list_concat(&expired, &wheel->slot[0][idx]);
+	wheel->now++;
+
+	/*
+	 * To avoid lock ordering problems,
+	 * run all expired timeouts as you visit them.
+	 *
+	 */
+	link_t *cur;
+	while ((cur = list_first(&expired)) != NULL) {
+		timeout_t *timeout = list_get_instance(cur, timeout_t, link);
+
+		irq_spinlock_lock(&timeout->lock, false);
+
+		list_remove(cur);
+		timeout_handler_t handler = timeout->handler;
+		void *arg = timeout->arg;
+		timeout_reinitialize(timeout);
+
+		irq_spinlock_unlock(&timeout->lock, false);
+		irq_spinlock_unlock(&CPU->timeoutlock, false);
+
+		handler(arg);
+
+		irq_spinlock_lock(&CPU->timeoutlock, false);
+	}
+
+	irq_spinlock_unlock(&CPU->timeoutlock, false);
+}
+
 /** @}
  */
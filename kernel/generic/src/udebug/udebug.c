@@ -42,10 +42,15 @@
 #include <synch/waitq.h>
 #include <udebug/udebug.h>
 #include <errno.h>
+#include <mem.h>
 #include <print.h>
 #include <arch.h>
+#include <abi/syscall.h>
+#include <mm/slab.h>
 #include <proc/task.h>
 #include <proc/thread.h>
+#include <syscall/copy.h>
+#include <time/clock.h>
 
 /** Initialize udebug part of task structure.
  *
@@ -60,6 +65,32 @@ void udebug_task_init(udebug_task_t *ut)
 	ut->begin_call = NULL;
 	ut->not_stoppable_count = 0;
 	ut->evmask = 0;
+	ut->filter = NULL;
+	ut->log_mode = false;
+	ut->log = NULL;
+	ut->log_capacity = 0;
+	ut->log_head = 0;
+	ut->log_count = 0;
+	ut->log_lost = 0;
+}
+
+/** Free the event filter and the event log of a task.
+ *
+ * @param ut Udebug part of the task structure. The lock must be held.
+ *
+ */
+static void udebug_task_log_free(udebug_task_t *ut)
+{
+	free(ut->filter);
+	ut->filter = NULL;
+
+	free(ut->log);
+	ut->log = NULL;
+	ut->log_mode = false;
+	ut->log_capacity = 0;
+	ut->log_head = 0;
+	ut->log_count = 0;
+	ut->log_lost = 0;
 }
 
 /** Initialize udebug part of thread structure.
@@ -151,20 +182,23 @@ void udebug_stoppable_begin(void)
 		if (THREAD->udebug.active == true &&
 		    THREAD->udebug.go == false) {
 			/*
-			 * Thread was requested to stop - answer go call
+			 * Thread was requested to stop - answer go call.
+			 * There is none if the thread was running in the
+			 * log mode.
 			 *
 			 */
 
 			/* Make sure nobody takes this call away from us */
 			call_t *go_call = THREAD->udebug.go_call;
 			THREAD->udebug.go_call = NULL;
-			assert(go_call);
-
-			IPC_SET_RETVAL(go_call->data, 0);
-			IPC_SET_ARG1(go_call->data, UDEBUG_EVENT_STOP);
 
 			THREAD->udebug.cur_event = UDEBUG_EVENT_STOP;
-			ipc_answer(&TASK->answerbox, go_call);
+
+			if (go_call != NULL) {
+				IPC_SET_RETVAL(go_call->data, 0);
+				IPC_SET_ARG1(go_call->data, UDEBUG_EVENT_STOP);
+				ipc_answer(&TASK->answerbox, go_call);
+			}
 		}
 	}
 
@@ -215,6 +249,155 @@ void udebug_before_thread_runs(void)
 	udebug_stoppable_end();
 }
 
+/** Check whether a syscall carries an IPC call.
+ *
+ * @param id Syscall number.
+ *
+ * @return True if the syscall sends, forwards or receives an IPC call.
+ *
+ */
+static bool udebug_syscall_is_ipc(sysarg_t id)
+{
+	switch (id) {
+	case SYS_IPC_CALL_ASYNC_FAST:
+	case SYS_IPC_CALL_ASYNC_SLOW:
+	case SYS_IPC_CALL_ASYNC_PAYLOAD:
+	case SYS_IPC_FORWARD_FAST:
+	case SYS_IPC_FORWARD_SLOW:
+	case SYS_IPC_WAIT:
+		return true;
+	default:
+		return false;
+	}
+}
+
+/** Get the method of the IPC call carried by a syscall.
+ *
+ * Must be called in the context of the thread invoking the syscall,
+ * as the arguments may point to its address space.
+ *
+ * @param id          Syscall number.
+ * @param a1          First syscall argument.
+ * @param a2          Second syscall argument.
+ * @param a3          Third syscall argument.
+ * @param rc          Return value of the syscall.
+ * @param end_variant True if the syscall has already been serviced.
+ * @param method      Place to store the method.
+ *
+ * @return True if @a method was stored, false if the syscall does not
+ *         carry an IPC call or the call is not known (yet).
+ *
+ */
+static bool udebug_syscall_method(sysarg_t id, sysarg_t a1, sysarg_t a2,
+    sysarg_t a3, sysarg_t rc, bool end_variant, sysarg_t *method)
+{
+	ipc_data_t *data;
+
+	switch (id) {
+	case SYS_IPC_CALL_ASYNC_FAST:
+		*method = a2;
+		return true;
+	case SYS_IPC_FORWARD_FAST:
+		*method = a3;
+		return true;
+	case SYS_IPC_CALL_ASYNC_SLOW:
+	case SYS_IPC_CALL_ASYNC_PAYLOAD:
+		data = (ipc_data_t *) a2;
+		break;
+	case SYS_IPC_FORWARD_SLOW:
+		data = (ipc_data_t *) a3;
+		break;
+	case SYS_IPC_WAIT:
+		/* Only a received call has a method, an answer does not. */
+		if (!end_variant || rc != EOK)
+			return false;
+
+		data = (ipc_data_t *) a1;
+
+		unsigned flags;
+		if (copy_from_uspace(&flags, &data->flags, sizeof(flags)) != EOK)
+			return false;
+		if ((flags & IPC_CALL_ANSWERED) != 0)
+			return false;
+		break;
+	default:
+		return false;
+	}
+
+	return copy_from_uspace(method, &data->args[0], sizeof(*method)) == EOK;
+}
+
+/** Check whether a syscall event passes the filter of the current task.
+ *
+ * TASK->udebug.lock must be held.
+ *
+ * @param id           Syscall number.
+ * @param method_known True if @a method is valid.
+ * @param method       Method of the IPC call carried by the syscall.
+ *
+ */
+static bool udebug_filter_pass(sysarg_t id, bool method_known,
+    sysarg_t method)
+{
+	udebug_filter_t *filter = TASK->udebug.filter;
+
+	if (filter == NULL)
+		return true;
+
+	if (id >= SYSCALL_END ||
+	    (filter->sc_mask[id / 32] & (UINT32_C(1) << (id % 32))) == 0)
+		return false;
+
+	if (filter->methods_cnt == 0 || !udebug_syscall_is_ipc(id))
+		return true;
+
+	if (!method_known)
+		return false;
+
+	for (sysarg_t i = 0; i < filter->methods_cnt; i++) {
+		if (filter->methods[i] == method)
+			return true;
+	}
+
+	return false;
+}
+
+/** Record an event in the log of the current task.
+ *
+ * TASK->udebug.lock must be held. If the log is full, the event is
+ * dropped and counted as lost, so that the debugger can report it.
+ *
+ * @param etype Event type.
+ * @param val0  First event value.
+ * @param val1  Second event value.
+ * @param args  Syscall arguments or NULL.
+ *
+ */
+static void udebug_log_event(udebug_event_t etype, sysarg_t val0,
+    sysarg_t val1, const sysarg_t *args)
+{
+	udebug_task_t *ut = &TASK->udebug;
+
+	if (ut->log_count == ut->log_capacity) {
+		ut->log_lost++;
+		return;
+	}
+
+	udebug_log_entry_t *entry =
+	    &ut->log[(ut->log_head + ut->log_count) % ut->log_capacity];
+	ut->log_count++;
+
+	entry->type = etype;
+	entry->thash = (sysarg_t) THREAD;
+	entry->val0 = val0;
+	entry->val1 = val1;
+	if (args != NULL)
+		memcpy(entry->args, args, sizeof(entry->args));
+	else
+		memset(entry->args, 0, sizeof(entry->args));
+	entry->timestamp = clock_uptime_nsec();
+}
+
 /** Syscall event hook.
  *
  * Must be called before and after servicing a system call. This generates
@@ -228,12 +411,35 @@ void udebug_syscall_event(sysarg_t a1, sysarg_t a2, sysarg_t a3,
 	udebug_event_t etype =
 	    end_variant ? UDEBUG_EVENT_SYSCALL_E : UDEBUG_EVENT_SYSCALL_B;
 
+	/*
+	 * The method must be read before locking, as reading it may fault.
+	 * The filter pointer is only a hint here, it is checked again with
+	 * the lock held.
+	 */
+	sysarg_t method = 0;
+	bool method_known = false;
+	if (TASK->udebug.filter != NULL && udebug_syscall_is_ipc(id)) {
+		method_known = udebug_syscall_method(id, a1, a2, a3, rc,
+		    end_variant, &method);
+	}
+
 	mutex_lock(&TASK->udebug.lock);
 	mutex_lock(&THREAD->udebug.lock);
 
 	/* Must only generate events when in debugging session and is go. */
 	if (THREAD->udebug.active != true || THREAD->udebug.go == false ||
-	    (TASK->udebug.evmask & UDEBUG_EVMASK(etype)) == 0) {
+	    (TASK->udebug.evmask & UDEBUG_EVMASK(etype)) == 0 ||
+	    !udebug_filter_pass(id, method_known, method)) {
+		mutex_unlock(&THREAD->udebug.lock);
+		mutex_unlock(&TASK->udebug.lock);
+		return;
+	}
+
+	if (TASK->udebug.log_mode) {
+		/* Record the event and keep running. */
+		sysarg_t args[6] = { a1, a2, a3, a4, a5, a6 };
+		udebug_log_event(etype, id, rc, args);
+
 		mutex_unlock(&THREAD->udebug.lock);
 		mutex_unlock(&TASK->udebug.lock);
 		return;
@@ -309,6 +515,25 @@ void udebug_thread_b_event_attach(struct thread *thread, struct task *task)
 		return;
 	}
 
+	if (TASK->udebug.log_mode) {
+		/*
+		 * The new thread joins the debugging session and runs
+		 * like the other threads, without waiting for GO.
+		 */
+		thread->udebug.active = true;
+		thread->udebug.go = true;
+
+		if ((TASK->udebug.evmask &
+		    UDEBUG_EVMASK(UDEBUG_EVENT_THREAD_B)) != 0) {
+			udebug_log_event(UDEBUG_EVENT_THREAD_B,
+			    (sysarg_t) thread, 0, NULL);
+		}
+
+		mutex_unlock(&THREAD->udebug.lock);
+		mutex_unlock(&TASK->udebug.lock);
+		return;
+	}
+
 	LOG("Trigger event");
 
 	call_t *call = THREAD->udebug.go_call;
@@ -360,6 +585,20 @@ void udebug_thread_e_event(void)
 		return;
 	}
 
+	if (TASK->udebug.log_mode) {
+		if ((TASK->udebug.evmask &
+		    UDEBUG_EVMASK(UDEBUG_EVENT_THREAD_E)) != 0)
+			udebug_log_event(UDEBUG_EVENT_THREAD_E, 0, 0, NULL);
+
+		THREAD->udebug.active = false;
+		THREAD->udebug.cur_event = 0;   /* None */
+		THREAD->udebug.go = false;      /* Set to initial value */
+
+		mutex_unlock(&THREAD->udebug.lock);
+		mutex_unlock(&TASK->udebug.lock);
+		return;
+	}
+
 	LOG("Trigger event");
 
 	call_t *call = THREAD->udebug.go_call;
@@ -425,15 +664,18 @@ errno_t udebug_task_cleanup(struct task *task)
 				 */
 				thread->udebug.go = false;
 
-				/* Answer GO call */
-				LOG("Answer GO call with EVENT_FINISHED.");
+				/* Answer GO call (there is none in log mode) */
+				if (thread->udebug.go_call != NULL) {
+					LOG("Answer GO call with EVENT_FINISHED.");
 
-				IPC_SET_RETVAL(thread->udebug.go_call->data, 0);
-				IPC_SET_ARG1(thread->udebug.go_call->data,
-				    UDEBUG_EVENT_FINISHED);
+					IPC_SET_RETVAL(thread->udebug.go_call->data, 0);
+					IPC_SET_ARG1(thread->udebug.go_call->data,
+					    UDEBUG_EVENT_FINISHED);
 
-				ipc_answer(&task->answerbox, thread->udebug.go_call);
-				thread->udebug.go_call = NULL;
+					ipc_answer(&task->answerbox,
+					    thread->udebug.go_call);
+					thread->udebug.go_call = NULL;
+				}
 			} else {
 				/*
 				 * Debug_stop is already at initial value.
@@ -457,6 +699,7 @@ errno_t udebug_task_cleanup(struct task *task)
 
 	task->udebug.dt_state = UDEBUG_TS_INACTIVE;
 	task->udebug.debugger = NULL;
+	udebug_task_log_free(&task->udebug);
 
 	return 0;
 }
@@ -52,7 +52,31 @@
 
 errno_t udebug_request_preprocess(call_t *call, phone_t *phone)
 {
+	uintptr_t uspace_addr;
+	errno_t rc;
+
 	switch (IPC_GET_ARG1(call->data)) {
+	case UDEBUG_M_SET_FILTER:
+		/*
+		 * The filter is in the address space of the debugger, copy
+		 * it while we are still running in its context.
+		 */
+		uspace_addr = IPC_GET_ARG2(call->data);
+		if (uspace_addr == 0)
+			break;
+
+		call->buffer = malloc(sizeof(udebug_filter_t));
+		if (call->buffer == NULL)
+			return ENOMEM;
+
+		rc = copy_from_uspace(call->buffer, (void *) uspace_addr,
+		    sizeof(udebug_filter_t));
+		if (rc != EOK) {
+			free(call->buffer);
+			call->buffer = NULL;
+			return rc;
+		}
+		break;
 		/* future UDEBUG_M_REGS_WRITE, UDEBUG_M_MEM_WRITE: */
 	default:
 		break;
@@ -123,6 +147,101 @@ static void udebug_receive_set_evmask(call_t *call)
 }
 
 
+/** Process a SET_FILTER call.
+ *
+ * Sets the syscall event filter for the current debugging session.
+ * @param call	The call structure.
+ */
+static void udebug_receive_set_filter(call_t *call)
+{
+	errno_t rc;
+
+	/*
+	 * Take the filter copied by udebug_request_preprocess() away from
+	 * the call, so that it is not copied back to the debugger.
+	 */
+	udebug_filter_t *filter = (udebug_filter_t *) call->buffer;
+	call->buffer = NULL;
+
+	rc = udebug_set_filter(filter);
+	if (rc != EOK)
+		free(filter);
+
+	IPC_SET_RETVAL(call->data, rc);
+	ipc_answer(&TASK->kb.box, call);
+}
+
+/** Process a LOG_START call.
+ *
+ * Switches the current task to the log mode.
+ * @param call	The call structure.
+ */
+static void udebug_receive_log_start(call_t *call)
+{
+	errno_t rc;
+
+	rc = udebug_log_start(IPC_GET_ARG2(call->data));
+
+	IPC_SET_RETVAL(call->data, rc);
+	ipc_answer(&TASK->kb.box, call);
+}
+
+/** Process a LOG_STOP call.
+ *
+ * Switches the current task back to the stop mode.
+ * @param call	The call structure.
+ */
+static void udebug_receive_log_stop(call_t *call)
+{
+	errno_t rc;
+
+	rc = udebug_log_stop();
+
+	IPC_SET_RETVAL(call->data, rc);
+	ipc_answer(&TASK->kb.box, call);
+}
+
+/** Process a LOG_READ call.
+ *
+ * Moves entries from the event log of the current task to the debugger.
+ * @param call	The call structure.
+ */
+static void udebug_receive_log_read(call_t *call)
+{
+	uintptr_t uspace_addr;
+	size_t buf_size;
+	void *buffer;
+	size_t copied, lost;
+	errno_t rc;
+
+	uspace_addr = IPC_GET_ARG2(call->data);	/* Destination address */
+	buf_size = IPC_GET_ARG3(call->data);	/* Dest. buffer size */
+
+	rc = udebug_log_read(&buffer, buf_size, &copied, &lost);
+	if (rc != EOK) {
+		IPC_SET_RETVAL(call->data, rc);
+		ipc_answer(&TASK->kb.box, call);
+		return;
+	}
+
+	/*
+	 * Make use of call->buffer to transfer data to caller's userspace
+	 */
+
+	IPC_SET_RETVAL(call->data, 0);
+	/*
+	 * ARG1=dest, ARG2=size as in IPC_M_DATA_READ so that
+	 * same code in process_answer() can be used
+	 * (no way to distinguish method in answer)
+	 */
+	IPC_SET_ARG1(call->data, uspace_addr);
+	IPC_SET_ARG2(call->data, copied);
+	IPC_SET_ARG3(call->data, lost);
+	call->buffer = buffer;
+
+	ipc_answer(&TASK->kb.box, call);
+}
+
 /** Process a GO call.
  *
  * Resumes execution of the specified thread.
@@ -447,6 +566,10 @@ void udebug_call_receive(call_t *call)
 		 * control exits this function.
 		 */
 		if (TASK->udebug.debugger != call->sender) {
+			/* Do not copy a SET_FILTER argument back. */
+			free(call->buffer);
+			call->buffer = NULL;
+
 			IPC_SET_RETVAL(call->data, EINVAL);
 			ipc_answer(&TASK->kb.box, call);
 			return;
@@ -487,6 +610,18 @@ void udebug_call_receive(call_t *call)
 	case UDEBUG_M_MEM_READ:
 		udebug_receive_mem_read(call);
 		break;
+	case UDEBUG_M_SET_FILTER:
+		udebug_receive_set_filter(call);
+		break;
+	case UDEBUG_M_LOG_START:
+		udebug_receive_log_start(call);
+		break;
+	case UDEBUG_M_LOG_STOP:
+		udebug_receive_log_stop(call);
+		break;
+	case UDEBUG_M_LOG_READ:
+		udebug_receive_log_read(call);
+		break;
 	}
 }
 
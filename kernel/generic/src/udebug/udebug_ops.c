@@ -52,6 +52,10 @@
 #include <udebug/udebug.h>
 #include <udebug/udebug_ops.h>
 #include <mem.h>
+#include <macros.h>
+
+/** Maximum capacity of the event log in entries */
+#define UDEBUG_LOG_CAPACITY_MAX  16384
 
 /** Prepare a thread for a debugging operation.
  *
@@ -255,6 +259,194 @@ errno_t udebug_set_evmask(udebug_evmask_t mask)
 	return EOK;
 }
 
+/** Set the event filter.
+ *
+ * Replaces the syscall event filter of the current task.
+ *
+ * @param filter Filter allocated with malloc() or NULL to remove the filter.
+ *               The ownership passes to the task on success.
+ *
+ * @return Zero on success or an error code.
+ *
+ */
+errno_t udebug_set_filter(udebug_filter_t *filter)
+{
+	if (filter != NULL && filter->methods_cnt > UDEBUG_FILTER_METHODS_MAX)
+		return EINVAL;
+
+	mutex_lock(&TASK->udebug.lock);
+
+	if (TASK->udebug.dt_state != UDEBUG_TS_ACTIVE) {
+		mutex_unlock(&TASK->udebug.lock);
+		return EINVAL;
+	}
+
+	free(TASK->udebug.filter);
+	TASK->udebug.filter = filter;
+	mutex_unlock(&TASK->udebug.lock);
+
+	return EOK;
+}
+
+/** Switch the current task to the log mode.
+ *
+ * Events are recorded into a log of @a capacity entries instead
+ * of stopping the threads. All threads must be stopped. They are
+ * given GO without a GO call, so they do not stop in any event
+ * until udebug_log_stop() is called.
+ *
+ * @param capacity Capacity of the log in entries.
+ *
+ * @return Zero on success, EBUSY if a thread is not stopped
+ *         or an error code.
+ *
+ */
+errno_t udebug_log_start(size_t capacity)
+{
+	if (capacity == 0 || capacity > UDEBUG_LOG_CAPACITY_MAX)
+		return EINVAL;
+
+	udebug_log_entry_t *log = malloc(capacity * sizeof(udebug_log_entry_t));
+	if (log == NULL)
+		return ENOMEM;
+
+	mutex_lock(&TASK->udebug.lock);
+
+	if (TASK->udebug.dt_state != UDEBUG_TS_ACTIVE ||
+	    TASK->udebug.log_mode) {
+		mutex_unlock(&TASK->udebug.lock);
+		free(log);
+		return EINVAL;
+	}
+
+	list_foreach(TASK->threads, th_link, thread_t, thread) {
+		mutex_lock(&thread->udebug.lock);
+		bool go = thread->uspace && thread->udebug.active &&
+		    thread->udebug.go;
+		mutex_unlock(&thread->udebug.lock);
+
+		if (go) {
+			mutex_unlock(&TASK->udebug.lock);
+			free(log);
+			return EBUSY;
+		}
+	}
+
+	/* Entries left from a previous log session are discarded. */
+	free(TASK->udebug.log);
+	TASK->udebug.log = log;
+	TASK->udebug.log_capacity = capacity;
+	TASK->udebug.log_head = 0;
+	TASK->udebug.log_count = 0;
+	TASK->udebug.log_lost = 0;
+	TASK->udebug.log_mode = true;
+
+	list_foreach(TASK->threads, th_link, thread_t, thread) {
+		mutex_lock(&thread->udebug.lock);
+		if (thread->uspace && thread->udebug.active) {
+			thread->udebug.go = true;
+			thread->udebug.cur_event = 0;  /* none */
+			waitq_wakeup(&thread->udebug.go_wq, WAKEUP_FIRST);
+		}
+		mutex_unlock(&thread->udebug.lock);
+	}
+
+	mutex_unlock(&TASK->udebug.lock);
+	return EOK;
+}
+
+/** Switch the current task back to the stop mode.
+ *
+ * Takes GO away from all threads. As they have no GO call, they
+ * stop silently at their next stopping point. The debugger can
+ * find them with THREAD_READ and give them GO.
+ *
+ * @return Zero on success or an error code.
+ *
+ */
+errno_t udebug_log_stop(void)
+{
+	mutex_lock(&TASK->udebug.lock);
+
+	if (TASK->udebug.dt_state != UDEBUG_TS_ACTIVE ||
+	    !TASK->udebug.log_mode) {
+		mutex_unlock(&TASK->udebug.lock);
+		return EINVAL;
+	}
+
+	TASK->udebug.log_mode = false;
+
+	list_foreach(TASK->threads, th_link, thread_t, thread) {
+		mutex_lock(&thread->udebug.lock);
+		if (thread->uspace && thread->udebug.active)
+			thread->udebug.go = false;
+		mutex_unlock(&thread->udebug.lock);
+	}
+
+	mutex_unlock(&TASK->udebug.lock);
+	return EOK;
+}
+
+/** Read and remove entries from the event log of the current task.
+ *
+ * A buffer is allocated and a pointer to it written to @a buffer.
+ * As many of the oldest entries as fit into @a buf_size bytes are
+ * moved from the log into this buffer. Does not block if the log
+ * is empty.
+ *
+ * @param buffer   The buffer for storing the entries.
+ * @param buf_size Buffer size in bytes.
+ * @param stored   The actual number of bytes copied will be stored here.
+ * @param lost     The number of events lost to a full log since the last
+ *                 read will be stored here.
+ *
+ * @return Zero on success or an error code.
+ *
+ */
+errno_t udebug_log_read(void **buffer, size_t buf_size, size_t *stored,
+    size_t *lost)
+{
+	size_t max_entries = min(buf_size / sizeof(udebug_log_entry_t),
+	    (size_t) UDEBUG_LOG_CAPACITY_MAX);
+
+	udebug_log_entry_t *entries =
+	    malloc(max_entries * sizeof(udebug_log_entry_t) + 1);
+	if (entries == NULL)
+		return ENOMEM;
+
+	mutex_lock(&TASK->udebug.lock);
+
+	if (TASK->udebug.dt_state != UDEBUG_TS_ACTIVE ||
+	    TASK->udebug.log == NULL) {
+		mutex_unlock(&TASK->udebug.lock);
+		free(entries);
+		return EINVAL;
+	}
+
+	udebug_task_t *ut = &TASK->udebug;
+	size_t count = min(max_entries, ut->log_count);
+
+	/* The entries may wrap around the end of the ring. */
+	size_t first = min(count, ut->log_capacity - ut->log_head);
+	memcpy(entries, &ut->log[ut->log_head],
+	    first * sizeof(udebug_log_entry_t));
+	memcpy(&entries[first], ut->log,
+	    (count - first) * sizeof(udebug_log_entry_t));
+
+	ut->log_head = (ut->log_head + count) % ut->log_capacity;
+	ut->log_count -= count;
+
+	*lost = ut->log_lost;
+	ut->log_lost = 0;
+
+	mutex_unlock(&TASK->udebug.lock);
+
+	*buffer = entries;
+	*stored = count * sizeof(udebug_log_entry_t);
+
+	return EOK;
+}
+
 /** Give thread GO.
  *
  * Upon recieving a go message, the thread is given GO. Being GO
@@ -267,6 +459,13 @@ errno_t udebug_set_evmask(udebug_evmask_t mask)
  */
 errno_t udebug_go(thread_t *thread, call_t *call)
 {
+	/*
+	 * The mode is only changed by the kbox thread, which is the thread
+	 * servicing this call, so it can be tested without locking.
+	 */
+	if (TASK->udebug.log_mode)
+		return EBUSY;
+
 	/* On success, this will lock thread->udebug.lock. */
 	errno_t rc = _thread_op_begin(thread, false);
 	if (rc != EOK)
@@ -300,6 +499,10 @@ errno_t udebug_stop(thread_t *thread, call_t *call)
 {
 	LOG("udebug_stop()");
 
+	/* See udebug_go() */
+	if (TASK->udebug.log_mode)
+		return EBUSY;
+
 	/*
 	 * On success, this will lock thread->udebug.lock. Note that this
 	 * makes sure the thread is not stopped.
@@ -0,0 +1,226 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <print.h>
+#include <test.h>
+#include <arch.h>
+#include <arch/cycle.h>
+#include <atomic.h>
+#include <config.h>
+#include <cpu.h>
+#include <mm/slab.h>
+#include <proc/thread.h>
+#include <sysinfo/sysinfo.h>
+#include <typedefs.h>
+
+/*
+ * Scaling benchmark harness
+ *
+ * Each benchmark is run with 1 to N worker threads, N being the number
+ * of active CPUs. Every worker is wired to its own CPU, waits until all
+ * other workers are running and then times its share of the operations
+ * using the CPU cycle counter. The results are printed and exported in
+ * sysinfo as
+ *
+ *   bench.<name>.<threads>.avg  average cycles per operation
+ *   bench.<name>.<threads>.max  cycles per operation of the slowest worker
+ *
+ * so that they can be collected from user space after the run.
+ */
+
+#define BENCH_SYSINFO_NAME_LEN  64
+
+typedef struct {
+	const bench_t *bench;
+	unsigned int index;
+	uint64_t iterations;
+	uint64_t cycles;
+} bench_worker_t;
+
+static atomic_t bench_ready;
+static unsigned int bench_threads;
+
+static void bench_worker(void *arg)
+{
+	bench_worker_t *worker = (bench_worker_t *) arg;
+
+	/* Start together so that the workers really contend */
+	atomic_inc(&bench_ready);
+	while (atomic_get(&bench_ready) < bench_threads)
+		;
+
+	uint64_t start = get_cycle();
+	worker->bench->entry(worker->index, worker->iterations);
+	worker->cycles = get_cycle() - start;
+}
+
+static void bench_export(const bench_t *bench, unsigned int threads,
+    const char *what, uint64_t value)
+{
+	char name[BENCH_SYSINFO_NAME_LEN];
+
+	snprintf(name, sizeof(name), "bench.%s.%u.%s", bench->name, threads,
+	    what);
+	sysinfo_set_item_val(name, NULL, (sysarg_t) value);
+}
+
+/** Run one round of a scaling benchmark
+ *
+ * @param bench      Benchmark to run.
+ * @param cpu_ids    Indices of the CPUs to wire the workers to.
+ * @param threads    Number of workers.
+ * @param iterations Number of operations performed by each worker.
+ * @param workers    Array of at least @a threads worker descriptors.
+ * @param thread     Array of at least @a threads thread pointers.
+ *
+ * @return NULL on success or an error message.
+ *
+ */
+static const char *bench_round(const bench_t *bench, unsigned int *cpu_ids,
+    unsigned int threads, uint64_t iterations, bench_worker_t *workers,
+    thread_t **thread)
+{
+	if (bench->setup != NULL) {
+		const char *ret = bench->setup(threads);
+		if (ret != NULL)
+			return ret;
+	}
+
+	atomic_set(&bench_ready, 0);
+
+	unsigned int created;
+	for (created = 0; created < threads; created++) {
+		workers[created].bench = bench;
+		workers[created].index = created;
+		workers[created].iterations = iterations;
+		workers[created].cycles = 0;
+
+		thread[created] = thread_create(bench_worker, &workers[created],
+		    TASK, THREAD_FLAG_NONE, "bench");
+		if (thread[created] == NULL)
+			break;
+
+		thread_wire(thread[created], &cpus[cpu_ids[created]]);
+	}
+
+	/* Let the workers already created finish even if the round fails */
+	bench_threads = created;
+
+	for (unsigned int i = 0; i < created; i++)
+		thread_ready(thread[i]);
+
+	for (unsigned int i = 0; i < created; i++) {
+		thread_join(thread[i]);
+		thread_detach(thread[i]);
+	}
+
+	if (bench->teardown != NULL)
+		bench->teardown();
+
+	if (created < threads)
+		return "Unable to create worker thread";
+
+	uint64_t sum = 0;
+	uint64_t max = 0;
+	for (unsigned int i = 0; i < threads; i++) {
+		sum += workers[i].cycles;
+		if (workers[i].cycles > max)
+			max = workers[i].cycles;
+	}
+
+	uint64_t avg_op = sum / threads / iterations;
+	uint64_t max_op = max / iterations;
+
+	/* Aggregate throughput bound by the slowest worker */
+	uint64_t ops_mcycle = (max > 0) ?
+	    threads * iterations * 1000000 / max : 0;
+
+	printf("%-12s %7u %12" PRIu64 " %12" PRIu64 " %14" PRIu64 "\n",
+	    bench->name, threads, avg_op, max_op, ops_mcycle);
+
+	bench_export(bench, threads, "avg", avg_op);
+	bench_export(bench, threads, "max", max_op);
+
+	return NULL;
+}
+
+/** Run a scaling benchmark on 1 to N CPUs
+ *
+ * @param bench      Benchmark to run.
+ * @param iterations Number of operations performed by each worker.
+ *
+ * @return True if all rounds were completed.
+ *
+ */
+bool bench_run(const bench_t *bench, uint64_t iterations)
+{
+	if (iterations == 0)
+		return true;
+
+	unsigned int *cpu_ids =
+	    malloc(sizeof(unsigned int) * config.cpu_count);
+	bench_worker_t *workers =
+	    malloc(sizeof(bench_worker_t) * config.cpu_count);
+	thread_t **thread = malloc(sizeof(thread_t *) * config.cpu_count);
+
+	if ((cpu_ids == NULL) || (workers == NULL) || (thread == NULL)) {
+		printf("Error allocating memory for benchmark\n");
+		free(cpu_ids);
+		free(workers);
+		free(thread);
+		return false;
+	}
+
+	unsigned int active = 0;
+	for (unsigned int i = 0; i < config.cpu_count; i++) {
+		if (cpus[i].active)
+			cpu_ids[active++] = i;
+	}
+
+	printf("%s (%s), %" PRIu64 " iterations per thread\n",
+	    bench->name, bench->desc, iterations);
+	printf("%-12s %7s %12s %12s %14s\n", "[name]", "[thrds]",
+	    "[cycles/op]", "[max/op]", "[ops/Mcycle]");
+
+	bool ok = true;
+	for (unsigned int threads = 1; threads <= active; threads++) {
+		const char *ret = bench_round(bench, cpu_ids, threads,
+		    iterations, workers, thread);
+		if (ret != NULL) {
+			printf("%s\n", ret);
+			ok = false;
+			break;
+		}
+	}
+
+	free(cpu_ids);
+	free(workers);
+	free(thread);
+
+	return ok;
+}
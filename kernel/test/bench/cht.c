@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <test.h>
+#include <adt/cht.h>
+#include <adt/hash.h>
+#include <mm/slab.h>
+#include <synch/rcu.h>
+#include <typedefs.h>
+
+/** Number of items present in the table during the benchmarks */
+#define BENCH_CHT_ITEMS  1024
+
+typedef struct {
+	cht_link_t link;
+	uint64_t key;
+} bench_item_t;
+
+static cht_t bench_cht;
+
+static size_t bench_key_hash(void *key)
+{
+	return hash_mix64(*(uint64_t *) key);
+}
+
+static size_t bench_hash(const cht_link_t *item)
+{
+	bench_item_t *it = member_to_inst(item, bench_item_t, link);
+	return hash_mix64(it->key);
+}
+
+static bool bench_equal(const cht_link_t *item1, const cht_link_t *item2)
+{
+	bench_item_t *it1 = member_to_inst(item1, bench_item_t, link);
+	bench_item_t *it2 = member_to_inst(item2, bench_item_t, link);
+	return it1->key == it2->key;
+}
+
+static bool bench_key_equal(void *key, const cht_link_t *item)
+{
+	bench_item_t *it = member_to_inst(item, bench_item_t, link);
+	return *(uint64_t *) key == it->key;
+}
+
+static void bench_remove_callback(cht_link_t *item)
+{
+	free(member_to_inst(item, bench_item_t, link));
+}
+
+static cht_ops_t bench_ops = {
+	.hash = bench_hash,
+	.key_hash = bench_key_hash,
+	.equal = bench_equal,
+	.key_equal = bench_key_equal,
+	.remove_callback = bench_remove_callback
+};
+
+static bool bench_insert(uint64_t key)
+{
+	bench_item_t *item = malloc(sizeof(bench_item_t));
+	if (item == NULL)
+		return false;
+
+	item->key = key;
+	cht_insert(&bench_cht, &item->link);
+	return true;
+}
+
+const char *bench_cht_setup(unsigned int threads)
+{
+	if (!cht_create_simple(&bench_cht, &bench_ops))
+		return "Unable to create hash table";
+
+	for (uint64_t key = 0; key < BENCH_CHT_ITEMS; key++) {
+		if (!bench_insert(key)) {
+			bench_cht_teardown();
+			return "Unable to allocate hash table items";
+		}
+	}
+
+	return NULL;
+}
+
+void bench_cht_teardown(void)
+{
+	for (uint64_t key = 0; key < BENCH_CHT_ITEMS; key++)
+		cht_remove_key(&bench_cht, &key);
+
+	cht_destroy(&bench_cht);
+}
+
+void bench_cht_find(unsigned int index, uint64_t iterations)
+{
+	for (uint64_t i = 0; i < iterations; i++) {
+		uint64_t key = (i + index) % BENCH_CHT_ITEMS;
+
+		rcu_read_lock();
+		cht_find(&bench_cht, &key);
+		rcu_read_unlock();
+	}
+}
+
+void bench_cht_update(unsigned int index, uint64_t iterations)
+{
+	for (uint64_t i = 0; i < iterations; i++) {
+		/* Keys private to the worker, disjoint from the resident items */
+		uint64_t key = ((uint64_t) (index + 1) << 32) | i;
+
+		if (!bench_insert(key))
+			continue;
+
+		cht_remove_key(&bench_cht, &key);
+	}
+}
@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <test.h>
+#include <mm/frame.h>
+#include <mm/slab.h>
+#include <typedefs.h>
+
+#define BENCH_SLAB_SIZE  64
+
+static slab_cache_t *bench_cache;
+
+void bench_falloc(unsigned int index, uint64_t iterations)
+{
+	for (uint64_t i = 0; i < iterations; i++) {
+		uintptr_t frame = frame_alloc(1, FRAME_ATOMIC, 0);
+		if (frame != 0)
+			frame_free(frame, 1);
+	}
+}
+
+const char *bench_slab_setup(unsigned int threads)
+{
+	bench_cache = slab_cache_create("bench_slab", BENCH_SLAB_SIZE, 0,
+	    NULL, NULL, 0);
+	if (bench_cache == NULL)
+		return "Unable to create slab cache";
+
+	return NULL;
+}
+
+void bench_slab(unsigned int index, uint64_t iterations)
+{
+	for (uint64_t i = 0; i < iterations; i++) {
+		void *obj = slab_alloc(bench_cache, FRAME_ATOMIC);
+		if (obj != NULL)
+			slab_free(bench_cache, obj);
+	}
+}
+
+void bench_slab_teardown(void)
+{
+	slab_cache_destroy(bench_cache);
+	bench_cache = NULL;
+}
@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <test.h>
+#include <synch/mutex.h>
+#include <synch/rcu.h>
+#include <synch/spinlock.h>
+#include <typedefs.h>
+
+SPINLOCK_STATIC_INITIALIZE(shared_spinlock);
+static mutex_t shared_mutex;
+
+/** Shared counter updated in the critical sections */
+static volatile uint64_t bench_counter;
+
+void bench_rcu_read(unsigned int index, uint64_t iterations)
+{
+	for (uint64_t i = 0; i < iterations; i++) {
+		rcu_read_lock();
+		rcu_read_unlock();
+	}
+}
+
+void bench_rcu_sync(unsigned int index, uint64_t iterations)
+{
+	for (uint64_t i = 0; i < iterations; i++)
+		rcu_synchronize();
+}
+
+void bench_spinlock(unsigned int index, uint64_t iterations)
+{
+	for (uint64_t i = 0; i < iterations; i++) {
+		spinlock_lock(&shared_spinlock);
+		bench_counter++;
+		spinlock_unlock(&shared_spinlock);
+	}
+}
+
+const char *bench_mutex_setup(unsigned int threads)
+{
+	mutex_initialize(&shared_mutex, MUTEX_PASSIVE);
+	bench_counter = 0;
+	return NULL;
+}
+
+void bench_mutex(unsigned int index, uint64_t iterations)
+{
+	for (uint64_t i = 0; i < iterations; i++) {
+		mutex_lock(&shared_mutex);
+		bench_counter++;
+		mutex_unlock(&shared_mutex);
+	}
+}
@@ -0,0 +1,244 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <print.h>
+#include <test.h>
+#include <mm/as.h>
+#include <mm/page.h>
+#include <arch/cycle.h>
+#include <typedefs.h>
+
+/** Number of address space areas created by the test. */
+#define AREAS  20000
+
+/** Number of pages of the area used for the used space test. */
+#define USED_PAGES  4096
+
+/** The areas do not consume any memory reservation. */
+#define AREA_FLAGS  (AS_AREA_READ | AS_AREA_LATE_RESERVE)
+
+/** Base address of the i-th test area, areas are separated by a page. */
+#define AREA_BASE(i) \
+	(USER_ADDRESS_SPACE_START + P2SZ(16) + P2SZ(2 * (i)))
+
+static const char *test_used_space(as_area_t *area)
+{
+	uintptr_t base = area->base;
+	used_space_ival_t *ival;
+	const char *err = NULL;
+	uint64_t t0, t1;
+
+	mutex_lock(&area->lock);
+
+	/* Fill every other page, then the gaps to merge the intervals. */
+	t0 = get_cycle();
+	for (size_t i = 0; i < USED_PAGES; i += 2) {
+		if (!used_space_insert(area, base + P2SZ(i), 1)) {
+			err = "Cannot insert used space";
+			goto out;
+		}
+	}
+
+	if (used_space_insert(area, base, 1)) {
+		err = "Overlapping used space inserted";
+		goto out;
+	}
+
+	for (size_t i = 1; i < USED_PAGES; i += 2) {
+		if (!used_space_insert(area, base + P2SZ(i), 1)) {
+			err = "Cannot insert used space";
+			goto out;
+		}
+	}
+	t1 = get_cycle();
+
+	TPRINTF("Inserted %u pages of used space in %" PRIu64 " cycles.\n",
+	    USED_PAGES, t1 - t0);
+
+	ival = used_space_first(area);
+	if ((ival == NULL) || (ival->page != base) ||
+	    (ival->count != USED_PAGES) || (used_space_next(area, ival))) {
+		err = "Used space intervals not merged";
+		goto out;
+	}
+
+	/* Punch holes into the single interval and remove the rest. */
+	t0 = get_cycle();
+	for (size_t i = 1; i < USED_PAGES; i += 2) {
+		if (!used_space_remove(area, base + P2SZ(i), 1)) {
+			err = "Cannot remove used space";
+			goto out;
+		}
+	}
+
+	if (used_space_remove(area, base + P2SZ(1), 1)) {
+		err = "Unused space removed";
+		goto out;
+	}
+
+	size_t ivals = 0;
+	for (ival = used_space_first(area); ival != NULL;
+	    ival = used_space_next(area, ival))
+		ivals++;
+
+	if ((ivals != USED_PAGES / 2) || (area->resident != USED_PAGES / 2)) {
+		err = "Used space not split";
+		goto out;
+	}
+
+	for (size_t i = 0; i < USED_PAGES; i += 2) {
+		if (!used_space_remove(area, base + P2SZ(i), 1)) {
+			err = "Cannot remove used space";
+			goto out;
+		}
+	}
+	t1 = get_cycle();
+
+	TPRINTF("Removed %u pages of used space in %" PRIu64 " cycles.\n",
+	    USED_PAGES, t1 - t0);
+
+	if ((used_space_first(area) != NULL) || (area->resident != 0)) {
+		err = "Used space not empty";
+		goto out;
+	}
+
+out:
+	/* Leave no used space behind as there are no pages mapped. */
+	while ((ival = used_space_first(area)) != NULL)
+		(void) used_space_remove(area, ival->page, ival->count);
+
+	mutex_unlock(&area->lock);
+	return err;
+}
+
+const char *test_as1(void)
+{
+	const char *err = NULL;
+	uint64_t t0, t1;
+
+	as_t *as = as_create(0);
+	if (!as)
+		return "Cannot create address space";
+
+	TPRINTF("Creating %u address space areas.\n", AREAS);
+
+	t0 = get_cycle();
+	for (size_t i = 0; i < AREAS; i++) {
+		uintptr_t base = AREA_BASE(i);
+		if (!as_area_create(as, AREA_FLAGS, PAGE_SIZE,
+		    AS_AREA_ATTR_NONE, &anon_backend, NULL, &base, 0)) {
+			err = "Cannot create address space area";
+			goto out;
+		}
+	}
+	t1 = get_cycle();
+
+	TPRINTF("Created %u areas in %" PRIu64 " cycles.\n", AREAS, t1 - t0);
+
+	/* The areas must be kept in the order of their base addresses. */
+	size_t cnt = 0;
+	mutex_lock(&as->lock);
+	for (as_area_t *area = as_area_first(as); area != NULL;
+	    area = as_area_next(area)) {
+		if (area->base != AREA_BASE(cnt)) {
+			mutex_unlock(&as->lock);
+			err = "Address space areas out of order";
+			goto out;
+		}
+		cnt++;
+	}
+	mutex_unlock(&as->lock);
+
+	if (cnt != AREAS) {
+		err = "Wrong number of address space areas";
+		goto out;
+	}
+
+	/* Every attempt to create an overlapping area must fail. */
+	t0 = get_cycle();
+	for (size_t i = 0; i < AREAS; i++) {
+		uintptr_t base = AREA_BASE(i);
+		if (as_area_create(as, AREA_FLAGS, PAGE_SIZE,
+		    AS_AREA_ATTR_NONE, &anon_backend, NULL, &base, 0)) {
+			err = "Overlapping address space area created";
+			goto out;
+		}
+
+		/* Growing over the separating page must fail, too. */
+		if ((i + 1 < AREAS) && (as_area_resize(as, AREA_BASE(i),
+		    P2SZ(3), 0) == EOK)) {
+			err = "Address space area resized over its neighbour";
+			goto out;
+		}
+	}
+	t1 = get_cycle();
+
+	TPRINTF("Checked %u conflicts in %" PRIu64 " cycles.\n", 2 * AREAS,
+	    t1 - t0);
+
+	/* Exercise used space tracking on a larger area above the others. */
+	uintptr_t base = AREA_BASE(AREAS);
+	as_area_t *area = as_area_create(as, AREA_FLAGS, P2SZ(USED_PAGES),
+	    AS_AREA_ATTR_NONE, &anon_backend, NULL, &base, 0);
+	if (!area) {
+		err = "Cannot create address space area";
+		goto out;
+	}
+
+	err = test_used_space(area);
+	if (err)
+		goto out;
+
+	/* Destroy every other area using an address inside of it. */
+	t0 = get_cycle();
+	for (size_t i = 0; i < AREAS; i += 2) {
+		if (as_area_destroy(as, AREA_BASE(i) + PAGE_SIZE / 2) != EOK) {
+			err = "Cannot destroy address space area";
+			goto out;
+		}
+	}
+	t1 = get_cycle();
+
+	TPRINTF("Destroyed %u areas in %" PRIu64 " cycles.\n", AREAS / 2,
+	    t1 - t0);
+
+	/* Destroyed areas must not be found anymore. */
+	for (size_t i = 0; i < AREAS; i += 2) {
+		if (as_area_destroy(as, AREA_BASE(i)) != ENOENT) {
+			err = "Destroyed address space area found";
+			goto out;
+		}
+	}
+
+	if (odict_count(&as->as_areas) != AREAS / 2 + 1)
+		err = "Wrong number of remaining address space areas";
+
+out:
+	as_destroy(as);
+	return err;
+}
@@ -45,6 +45,7 @@ test_t tests[] = {
 #include <cht/cht1.def>
 #include <debug/mips1.def>
 #include <fault/fault1.def>
+#include <mm/as1.def>
 #include <mm/falloc1.def>
 #include <mm/falloc2.def>
 #include <mm/mapping1.def>
@@ -69,6 +70,17 @@ test_t tests[] = {
 	}
 };
 
+bench_t benches[] = {
+#include <bench/mm.def>
+#include <bench/cht.def>
+#include <bench/synch.def>
+	{
+		.name = NULL,
+		.desc = NULL,
+		.entry = NULL
+	}
+};
+
 const char *tests_hints_enum(const char *input, const char **help,
     void **ctx)
 {
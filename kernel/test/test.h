@@ -36,6 +36,7 @@
 #define KERN_TEST_H_
 
 #include <stdbool.h>
+#include <stdint.h>
 
 extern bool test_quiet;
 
@@ -55,12 +56,31 @@ typedef struct {
 	bool safe;
 } test_t;
 
+/** Body of a scaling benchmark
+ *
+ * Performs the given number of operations on behalf of the worker
+ * with the given index.
+ *
+ */
+typedef void (*bench_entry_t)(unsigned int, uint64_t);
+
+typedef struct {
+	const char *name;
+	const char *desc;
+	/** Optional, called with the number of workers before each round */
+	const char *(*setup)(unsigned int);
+	bench_entry_t entry;
+	/** Optional, called after each round */
+	void (*teardown)(void);
+} bench_t;
+
 extern const char *test_atomic1(void);
 extern const char *test_avltree1(void);
 extern const char *test_btree1(void);
 extern const char *test_cht1(void);
 extern const char *test_mips1(void);
 extern const char *test_fault1(void);
+extern const char *test_as1(void);
 extern const char *test_falloc1(void);
 extern const char *test_falloc2(void);
 extern const char *test_mapping1(void);
@@ -81,8 +101,24 @@ extern const char *test_workqueue3(void);
 extern const char *test_workqueue3quit(void);
 extern const char *test_rcu1(void);
 
+extern void bench_falloc(unsigned int, uint64_t);
+extern const char *bench_slab_setup(unsigned int);
+extern void bench_slab(unsigned int, uint64_t);
+extern void bench_slab_teardown(void);
+extern const char *bench_cht_setup(unsigned int);
+extern void bench_cht_find(unsigned int, uint64_t);
+extern void bench_cht_update(unsigned int, uint64_t);
+extern void bench_cht_teardown(void);
+extern void bench_rcu_read(unsigned int, uint64_t);
+extern void bench_rcu_sync(unsigned int, uint64_t);
+extern void bench_spinlock(unsigned int, uint64_t);
+extern const char *bench_mutex_setup(unsigned int);
+extern void bench_mutex(unsigned int, uint64_t);
 
 extern test_t tests[];
+extern bench_t benches[];
+
+extern bool bench_run(const bench_t *, uint64_t);
 
 extern const char *tests_hints_enum(const char *, const char **, void **);
 
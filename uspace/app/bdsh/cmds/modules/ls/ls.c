@@ -136,30 +136,21 @@ static signed int ls_scan_dir(const char *d, DIR *dirp,
 	int alloc_blocks = 20;
 	int i;
 	int nbdirs = 0;
-	errno_t rc;
-	int len;
-	char *buff;
 	struct dir_elem_t *tmp;
 	struct dir_elem_t *tosort;
 	struct dirent *dp;
+	vfs_stat_t stat;
 
 	if (!dirp)
 		return -1;
 
-	buff = (char *) malloc(PATH_MAX);
-	if (!buff) {
-		cli_error(CL_ENOMEM, "ls: failed to scan %s", d);
-		return -1;
-	}
-
 	tosort = (struct dir_elem_t *) malloc(alloc_blocks * sizeof(*tosort));
 	if (!tosort) {
 		cli_error(CL_ENOMEM, "ls: failed to scan %s", d);
-		free(buff);
 		return -1;
 	}
 
-	while ((dp = readdir(dirp))) {
+	while ((dp = readdir_stat(dirp, &stat))) {
 		if (nbdirs + 1 > alloc_blocks) {
 			alloc_blocks += alloc_blocks;
 
@@ -180,15 +171,7 @@ static signed int ls_scan_dir(const char *d, DIR *dirp,
 		}
 
 		str_cpy(tosort[nbdirs].name, str_size(dp->d_name) + 1, dp->d_name);
-		len = snprintf(buff, PATH_MAX - 1, "%s/%s", d, tosort[nbdirs].name);
-		buff[len] = '\0';
-
-		rc = vfs_stat_path(buff, &tosort[nbdirs++].s);
-		if (rc != EOK) {
-			printf("ls: skipping bogus node %s\n", buff);
-			printf("error=%s\n", str_error_name(rc));
-			goto out;
-		}
+		tosort[nbdirs++].s = stat;
 	}
 
 	if (ls.sort)
@@ -220,7 +203,6 @@ out:
 	for (i = 0; i < nbdirs; i++)
 		free(tosort[i].name);
 	free(tosort);
-	free(buff);
 
 	return nbdirs;
 }
@@ -95,14 +95,22 @@ static char *find_command(char *cmd)
 	return (char *) cmd;
 }
 
-unsigned int try_exec(char *cmd, char **argv, iostate_t *io)
+/** Start a command without waiting for it.
+ *
+ * @param cmd   Command name
+ * @param argv  Arguments, including the command name
+ * @param io    Standard streams of the command
+ * @param twait Task wait structure to pass to exec_wait()
+ *
+ * @return 0 on success, 1 if the command could not be started
+ */
+unsigned int exec_spawn(char *cmd, char **argv, iostate_t *io,
+    task_wait_t *twait)
 {
 	task_id_t tid;
-	task_wait_t twait;
-	task_exit_t texit;
 	char *tmp;
 	errno_t rc;
-	int retval, i;
+	int i;
 	int file_handles[3] = { -1, -1, -1 };
 	FILE *files[3];
 
@@ -117,7 +125,7 @@ unsigned int try_exec(char *cmd, char **argv, iostate_t *io)
 		vfs_fhandle(files[i], &file_handles[i]);
 	}
 
-	rc = task_spawnvf(&tid, &twait, tmp, (const char **) argv,
+	rc = task_spawnvf(&tid, twait, tmp, (const char **) argv,
 	    file_handles[0], file_handles[1], file_handles[2]);
 	free(tmp);
 
@@ -127,7 +135,21 @@ unsigned int try_exec(char *cmd, char **argv, iostate_t *io)
 		return 1;
 	}
 
-	rc = task_wait(&twait, &texit, &retval);
+	return 0;
+}
+
+/** Wait for a command started by exec_spawn() and report its failure.
+ *
+ * @param twait Task wait structure filled in by exec_spawn()
+ *
+ * @return 0 if the command exited normally with zero exit code, 1 otherwise
+ */
+unsigned int exec_wait(task_wait_t *twait)
+{
+	task_exit_t texit;
+	int retval;
+
+	errno_t rc = task_wait(twait, &texit, &retval);
 	if (rc != EOK) {
 		printf("%s: Failed waiting for command (%s)\n", progname,
 		    str_error(rc));
@@ -143,3 +165,13 @@ unsigned int try_exec(char *cmd, char **argv, iostate_t *io)
 
 	return 0;
 }
+
+unsigned int try_exec(char *cmd, char **argv, iostate_t *io)
+{
+	task_wait_t twait;
+
+	if (exec_spawn(cmd, argv, io, &twait) != 0)
+		return 1;
+
+	return exec_wait(&twait);
+}
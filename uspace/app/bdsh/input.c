@@ -31,6 +31,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <str.h>
+#include <str_error.h>
 #include <io/console.h>
 #include <io/keycode.h>
 #include <io/style.h>
@@ -59,12 +60,13 @@ static tinput_t *tinput;
 
 /* Private helpers */
 static int run_command(char **, cliuser_t *, iostate_t *);
+static int run_pipeline(char ***, unsigned int, cliuser_t *, iostate_t *);
 static void print_pipe_usage(void);
 
 /*
  * Tokenizes input from console, sees if the first word is a built-in, if so
  * invokes the built-in entry point (a[0]) passing all arguments in a[] to
- * the handler
+ * the handler. Commands separated by pipes are run as a pipeline.
  */
 errno_t process_input(cliuser_t *usr)
 {
@@ -73,13 +75,16 @@ errno_t process_input(cliuser_t *usr)
 		return ENOMEM;
 	token_t *tokens = tokens_buf;
 
-	char *cmd[WORD_MAX];
+	char **args = NULL;
+	char ***stages = NULL;
+	char ***cmds;
 	errno_t rc = EOK;
 	tokenizer_t tok;
-	unsigned int i, pipe_count, processed_pipes;
-	unsigned int pipe_pos[2];
+	unsigned int i, stage_count;
 	char *redir_from = NULL;
 	char *redir_to = NULL;
+	FILE *from = NULL;
+	FILE *to = NULL;
 
 	if (usr->line == NULL) {
 		free(tokens_buf);
@@ -106,68 +111,57 @@ errno_t process_input(cliuser_t *usr)
 		tokens_length--;
 	}
 
-	/*
-	 * Until full support for pipes is implemented, allow for a simple case:
-	 * [from <file> |] command [| to <file>]
-	 *
-	 * First find the pipes and check that there are no more
-	 */
-	for (i = 0, pipe_count = 0; i < tokens_length; i++) {
-		if (tokens[i].type == TOKTYPE_PIPE) {
-			if (pipe_count >= 2) {
-				print_pipe_usage();
-				rc = ENOTSUP;
-				goto finit;
-			}
-			pipe_pos[pipe_count] = i;
-			pipe_count++;
-		}
+	/* Split the tokens into NULL-terminated argument vectors of stages */
+	stage_count = 1;
+	for (i = 0; i < tokens_length; i++) {
+		if (tokens[i].type == TOKTYPE_PIPE)
+			stage_count++;
 	}
 
-	unsigned int cmd_token_start = 0;
-	unsigned int cmd_token_end = tokens_length;
-
-	processed_pipes = 0;
-
-	/* Check if the first part (from <file> |) is present */
-	if (pipe_count > 0 && (pipe_pos[0] == 3 || pipe_pos[0] == 4) && str_cmp(tokens[0].text, "from") == 0) {
-		/* Ignore the first three tokens (from, file, pipe) and set from */
-		redir_from = tokens[2].text;
-		cmd_token_start = pipe_pos[0] + 1;
-		processed_pipes++;
+	args = calloc(tokens_length + stage_count, sizeof(char *));
+	stages = calloc(stage_count, sizeof(char **));
+	if (args == NULL || stages == NULL) {
+		rc = ENOMEM;
+		goto finit;
 	}
 
-	/* Check if the second part (| to <file>) is present */
-	if ((pipe_count - processed_pipes) > 0 &&
-	    (pipe_pos[processed_pipes] == tokens_length - 4 ||
-	    (pipe_pos[processed_pipes] == tokens_length - 5 &&
-	    tokens[tokens_length - 4].type == TOKTYPE_SPACE)) &&
-	    str_cmp(tokens[tokens_length - 3].text, "to") == 0) {
-		/* Ignore the last three tokens (pipe, to, file) and set to */
-		redir_to = tokens[tokens_length - 1].text;
-		cmd_token_end = pipe_pos[processed_pipes];
-		processed_pipes++;
+	unsigned int arg_pos = 0;
+	unsigned int stage = 0;
+	stages[0] = args;
+	for (i = 0; i < tokens_length; i++) {
+		if (tokens[i].type == TOKTYPE_PIPE) {
+			args[arg_pos++] = NULL;
+			stages[++stage] = &args[arg_pos];
+		} else if (tokens[i].type != TOKTYPE_SPACE) {
+			args[arg_pos++] = tokens[i].text;
+		}
 	}
-
-	if (processed_pipes != pipe_count) {
-		print_pipe_usage();
-		rc = ENOTSUP;
-		goto finit;
+	args[arg_pos] = NULL;
+
+	/* [from <file> |] and [| to <file>] redirect the pipeline */
+	cmds = stages;
+	if (stage_count > 1 && cmds[0][0] != NULL &&
+	    str_cmp(cmds[0][0], "from") == 0 &&
+	    cmds[0][1] != NULL && cmds[0][2] == NULL) {
+		redir_from = cmds[0][1];
+		cmds++;
+		stage_count--;
 	}
 
-	/* Convert tokens of the command to string array */
-	unsigned int cmd_pos = 0;
-	for (i = cmd_token_start; i < cmd_token_end; i++) {
-		if (tokens[i].type != TOKTYPE_SPACE) {
-			cmd[cmd_pos++] = tokens[i].text;
-		}
+	if (stage_count > 1 && cmds[stage_count - 1][0] != NULL &&
+	    str_cmp(cmds[stage_count - 1][0], "to") == 0 &&
+	    cmds[stage_count - 1][1] != NULL &&
+	    cmds[stage_count - 1][2] == NULL) {
+		redir_to = cmds[stage_count - 1][1];
+		stage_count--;
 	}
-	cmd[cmd_pos++] = NULL;
 
-	if (cmd[0] == NULL) {
-		print_pipe_usage();
-		rc = ENOTSUP;
-		goto finit;
+	for (i = 0; i < stage_count; i++) {
+		if (cmds[i][0] == NULL) {
+			print_pipe_usage();
+			rc = ENOTSUP;
+			goto finit;
+		}
 	}
 
 	iostate_t new_iostate = {
@@ -176,15 +170,12 @@ errno_t process_input(cliuser_t *usr)
 		.stderr = stderr
 	};
 
-	FILE *from = NULL;
-	FILE *to = NULL;
-
 	if (redir_from) {
 		from = fopen(redir_from, "r");
 		if (from == NULL) {
 			printf("Cannot open file %s\n", redir_from);
 			rc = errno;
-			goto finit_with_files;
+			goto finit;
 		}
 		new_iostate.stdin = from;
 	}
@@ -195,32 +186,34 @@ errno_t process_input(cliuser_t *usr)
 		if (to == NULL) {
 			printf("Cannot open file %s\n", redir_to);
 			rc = errno;
-			goto finit_with_files;
+			goto finit;
 		}
 		new_iostate.stdout = to;
 	}
 
-	if (run_command(cmd, usr, &new_iostate) == 0) {
-		rc = EOK;
-	} else {
-		rc = EINVAL;
-	}
+	int ret;
+	if (stage_count == 1)
+		ret = run_command(cmds[0], usr, &new_iostate);
+	else
+		ret = run_pipeline(cmds, stage_count, usr, &new_iostate);
+
+	rc = (ret == 0) ? EOK : EINVAL;
 
-finit_with_files:
+finit:
 	if (from != NULL) {
 		fclose(from);
 	}
 	if (to != NULL) {
 		fclose(to);
 	}
-
-finit:
 	if (NULL != usr->line) {
 		free(usr->line);
 		usr->line = (char *) NULL;
 	}
 	tok_fini(&tok);
 	free(tokens_buf);
+	free(args);
+	free(stages);
 
 	return rc;
 }
@@ -228,11 +221,139 @@ finit:
 void print_pipe_usage(void)
 {
 	printf("Invalid syntax!\n");
-	printf("Usage of redirection (pipes in the future):\n");
-	printf("from filename | command ...\n");
-	printf("from filename | command ... | to filename\n");
-	printf("command ... | to filename\n");
+	printf("Usage of pipes and redirection:\n");
+	printf("command ... | command ... [| command ...]\n");
+	printf("from filename | command ... [| command ...]\n");
+	printf("command ... [| command ...] | to filename\n");
+}
+
+/** Run commands connected by pipes.
+ *
+ * All external commands run concurrently, each reading the output of the
+ * previous one through a pipe. At most one stage can be a built-in command
+ * or a module. It runs inside the shell once the external commands have
+ * been started.
+ *
+ * @param stages   Argument vectors of the commands
+ * @param count    Number of commands, at least two
+ * @param usr      Shell user
+ * @param io       Standard streams of the whole pipeline
+ *
+ * @return 0 if all commands succeeded, non-zero otherwise
+ */
+static int run_pipeline(char ***stages, unsigned int count, cliuser_t *usr,
+    iostate_t *io)
+{
+	FILE **rd = calloc(count - 1, sizeof(FILE *));
+	FILE **wr = calloc(count - 1, sizeof(FILE *));
+	task_wait_t *twait = calloc(count, sizeof(task_wait_t));
+	bool *spawned = calloc(count, sizeof(bool));
+	int internal = -1;
+	int ret = 0;
+	unsigned int i;
+
+	if (rd == NULL || wr == NULL || twait == NULL || spawned == NULL) {
+		cli_error(CL_ENOMEM, "%s: Out of memory", progname);
+		ret = CL_ENOMEM;
+		goto out;
+	}
+
+	for (i = 0; i < count; i++) {
+		if (is_builtin(stages[i][0]) < 0 && is_module(stages[i][0]) < 0)
+			continue;
+
+		if (internal >= 0) {
+			cli_error(CL_ENOTSUP, "%s: Only one built-in command "
+			    "can be used in a pipeline", progname);
+			ret = CL_ENOTSUP;
+			goto out;
+		}
+
+		internal = i;
+	}
+
+	for (i = 0; i < count - 1; i++) {
+		int rfd, wfd;
+		errno_t rc = vfs_pipe(&rfd, &wfd);
+		if (rc != EOK) {
+			cli_error(CL_EFAIL, "%s: Cannot create pipe (%s)",
+			    progname, str_error(rc));
+			ret = CL_EFAIL;
+			goto out;
+		}
+
+		rd[i] = fdopen(rfd, "r");
+		wr[i] = fdopen(wfd, "w");
+		if (rd[i] == NULL || wr[i] == NULL) {
+			if (rd[i] == NULL)
+				vfs_put(rfd);
+			if (wr[i] == NULL)
+				vfs_put(wfd);
+			cli_error(CL_ENOMEM, "%s: Out of memory", progname);
+			ret = CL_ENOMEM;
+			goto out;
+		}
+	}
+
+	iostate_t stage_io;
+	stage_io.stderr = io->stderr;
+
+	for (i = 0; i < count; i++) {
+		if ((int) i == internal)
+			continue;
+
+		stage_io.stdin = (i == 0) ? io->stdin : rd[i - 1];
+		stage_io.stdout = (i == count - 1) ? io->stdout : wr[i];
+
+		if (exec_spawn(stages[i][0], stages[i], &stage_io,
+		    &twait[i]) == 0)
+			spawned[i] = true;
+		else
+			ret = 1;
+	}
+
+	/*
+	 * The commands hold their ends of the pipes now. Readers only see
+	 * the end of data once the shell has put its write ends as well.
+	 */
+	for (i = 0; i < count - 1; i++) {
+		if ((int) i != internal) {
+			fclose(wr[i]);
+			wr[i] = NULL;
+		}
+		if ((int) i + 1 != internal) {
+			fclose(rd[i]);
+			rd[i] = NULL;
+		}
+	}
+
+	if (internal >= 0) {
+		stage_io.stdin = (internal == 0) ? io->stdin : rd[internal - 1];
+		stage_io.stdout = ((unsigned int) internal == count - 1) ?
+		    io->stdout : wr[internal];
+
+		if (run_command(stages[internal], usr, &stage_io) != 0)
+			ret = 1;
+	}
+
+out:
+	for (i = 0; rd != NULL && wr != NULL && i < count - 1; i++) {
+		if (wr[i] != NULL)
+			fclose(wr[i]);
+		if (rd[i] != NULL)
+			fclose(rd[i]);
+	}
+
+	for (i = 0; spawned != NULL && i < count; i++) {
+		if (spawned[i] && exec_wait(&twait[i]) != 0)
+			ret = 1;
+	}
 
+	free(rd);
+	free(wr);
+	free(twait);
+	free(spawned);
+	return ret;
 }
 
 int run_command(char **cmd, cliuser_t *usr, iostate_t *new_iostate)
@@ -49,6 +49,10 @@
 #include <time.h>
 #include <dirent.h>
 #include <str.h>
+#include <deflate.h>
+
+#include "fsbench.h"
+#include "micro.h"
 
 #define NAME	"bnchmark"
 #define BUFSIZE 8096
@@ -57,6 +61,13 @@
 typedef errno_t (*measure_func_t)(void *);
 typedef unsigned long umseconds_t; /* milliseconds */
 
+typedef struct {
+	char *path;
+	unsigned int level;
+	size_t in_size;
+	size_t out_size;
+} deflate_bench_t;
+
 static void syntax_print(void);
 
 static errno_t measure(measure_func_t fn, void *data, umseconds_t *result)
@@ -109,6 +120,64 @@ static errno_t sequential_read_file(void *data)
 	return EOK;
 }
 
+static errno_t deflate_count(void *arg, const void *data, size_t size)
+{
+	deflate_bench_t *bench = (deflate_bench_t *) arg;
+
+	bench->out_size += size;
+	return EOK;
+}
+
+static errno_t deflate_file(void *data)
+{
+	deflate_bench_t *bench = (deflate_bench_t *) data;
+	char *buf = malloc(BUFSIZE);
+
+	if (buf == NULL)
+		return ENOMEM;
+
+	FILE *file = fopen(bench->path, "r");
+	if (file == NULL) {
+		fprintf(stderr, "Failed opening file: %s\n", bench->path);
+		free(buf);
+		return EIO;
+	}
+
+	deflate_t *deflate;
+	errno_t rc = deflate_create(bench->level, deflate_count, bench,
+	    &deflate);
+	if (rc != EOK) {
+		fclose(file);
+		free(buf);
+		return rc;
+	}
+
+	bench->in_size = 0;
+	bench->out_size = 0;
+
+	while (!feof(file)) {
+		size_t nread = fread(buf, 1, BUFSIZE, file);
+		if (ferror(file)) {
+			fprintf(stderr, "Failed reading file\n");
+			rc = EIO;
+			break;
+		}
+
+		bench->in_size += nread;
+		rc = deflate_write(deflate, buf, nread);
+		if (rc != EOK)
+			break;
+	}
+
+	if (rc == EOK)
+		rc = deflate_finish(deflate);
+
+	deflate_destroy(deflate);
+	fclose(file);
+	free(buf);
+	return rc;
+}
+
 static errno_t sequential_read_dir(void *data)
 {
 	char *path = (char *) data;
@@ -140,6 +209,8 @@ int main(int argc, char **argv)
 	char *log_str = NULL;
 	char *test_type = NULL;
 	char *endptr;
+	void *data;
+	deflate_bench_t deflate_bench;
 
 	if (argc < 5) {
 		fprintf(stderr, NAME ": Error, argument missing.\n");
@@ -176,10 +247,45 @@ int main(int argc, char **argv)
 	++argv;
 	path = *argv;
 
+	data = path;
+
+	if (micro_is_test(test_type)) {
+		if (iterations <= 0) {
+			fprintf(stderr, "Error, invalid number of iterations\n");
+			return 1;
+		}
+
+		rc = micro_run(test_type, log_str, iterations);
+		return rc == EOK ? 0 : 1;
+	}
+
+	if (fsbench_is_test(test_type)) {
+		if (iterations <= 0) {
+			fprintf(stderr, "Error, invalid number of iterations\n");
+			return 1;
+		}
+
+		rc = fsbench_run(test_type, log_str, path, iterations);
+		return rc == EOK ? 0 : 1;
+	}
+
 	if (str_cmp(test_type, "sequential-file-read") == 0) {
 		fn = sequential_read_file;
 	} else if (str_cmp(test_type, "sequential-dir-read") == 0) {
 		fn = sequential_read_dir;
+	} else if (str_lcmp(test_type, "deflate-", str_length("deflate-")) == 0) {
+		deflate_bench.path = path;
+		deflate_bench.level = strtol(test_type + str_length("deflate-"),
+		    &endptr, 10);
+		if (*endptr != '\0' || endptr == test_type + str_length("deflate-") ||
+		    deflate_bench.level > DEFLATE_LEVEL_BEST) {
+			fprintf(stderr, "Error, invalid compression level\n");
+			syntax_print();
+			return 1;
+		}
+
+		fn = deflate_file;
+		data = &deflate_bench;
 	} else {
 		fprintf(stderr, "Error, unknown test type\n");
 		syntax_print();
@@ -187,13 +293,20 @@ int main(int argc, char **argv)
 	}
 
 	for (iteration = 0; iteration < iterations; iteration++) {
-		rc = measure(fn, path, &milliseconds_taken);
+		rc = measure(fn, data, &milliseconds_taken);
 		if (rc != EOK) {
 			fprintf(stderr, "Error: %s\n", str_error(rc));
 			return 1;
 		}
 
-		printf("%s;%s;%s;%lu;ms\n", test_type, path, log_str, milliseconds_taken);
+		if (fn == deflate_file) {
+			printf("%s;%s;%s;%lu;ms;%zu;%zu;bytes\n", test_type, path,
+			    log_str, milliseconds_taken, deflate_bench.in_size,
+			    deflate_bench.out_size);
+		} else {
+			printf("%s;%s;%s;%lu;ms\n", test_type, path, log_str,
+			    milliseconds_taken);
+		}
 	}
 
 	return 0;
@@ -207,8 +320,28 @@ static void syntax_print(void)
 	fprintf(stderr, "  <test-type>     one of:\n");
 	fprintf(stderr, "                    sequential-file-read\n");
 	fprintf(stderr, "                    sequential-dir-read\n");
+	fprintf(stderr, "                    deflate-<level> (compress file, level 0-9,\n");
+	fprintf(stderr, "                      also prints input and output size)\n");
+	fprintf(stderr, "                    ipc-ping, ipc-ping-async,\n");
+	fprintf(stderr, "                    ipc-data-write, ipc-data-read,\n");
+	fprintf(stderr, "                    ipc-share-in, ipc-share-out,\n");
+	fprintf(stderr, "                    fibril-switch, futex-wake, thread-create,\n");
+	fprintf(stderr, "                    draw-fill-rect, draw-fill-round,\n");
+	fprintf(stderr, "                    draw-fill-circle, draw-stroke,\n");
+	fprintf(stderr, "                    micro-all (run all of the above;\n");
+	fprintf(stderr, "                      IPC tests need the ipc-test service)\n");
+	fprintf(stderr, "                    fs-<workload>[-<block-size>[-<queue-depth>]]\n");
+	fprintf(stderr, "                      workload is one of seqread, seqwrite,\n");
+	fprintf(stderr, "                      randread, randwrite, fsync (<path> is\n");
+	fprintf(stderr, "                      a scratch file) or dirstorm (<path> is\n");
+	fprintf(stderr, "                      a directory); prints IOPS, KiB/s,\n");
+	fprintf(stderr, "                      latency percentiles and histogram\n");
 	fprintf(stderr, "  <log-str>       a string to attach to results\n");
 	fprintf(stderr, "  <path>          file/directory to use for testing\n");
+	fprintf(stderr, "                  (ignored by micro-benchmarks)\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "Micro-benchmarks take <iterations> samples and print\n");
+	fprintf(stderr, "  <test>;<param>;<log-str>;<batch>;<min>;<p50>;<p90>;<p99>;<max>;ns\n");
 }
 
 /**
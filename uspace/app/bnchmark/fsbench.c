@@ -0,0 +1,542 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup test
+ * @{
+ */
+
+/**
+ * @file	fsbench.c
+ * File system benchmarks.
+ *
+ * Test types have the form fs-<workload>[-<block-size>[-<queue-depth>]].
+ * Queue depth is emulated by running that many fibrils, each issuing one
+ * request at a time. The workloads are:
+ *
+ *   seqread, seqwrite   sequential I/O over a FSB_FILE_SIZE file
+ *   randread, randwrite random block I/O over the same file
+ *   fsync               sequential writes, each followed by a sync
+ *   dirstorm            create, stat and unlink FSB_DIR_FILES files
+ *
+ * Each run prints IOPS, bandwidth and latency percentiles, followed by a
+ * latency histogram with power-of-two microsecond buckets.
+ */
+
+#include <adt/hash.h>
+#include <assert.h>
+#include <errno.h>
+#include <fibril.h>
+#include <fibril_synch.h>
+#include <inttypes.h>
+#include <macros.h>
+#include <mem.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <str.h>
+#include <str_error.h>
+#include <sys/time.h>
+#include <vfs/vfs.h>
+
+#include "fsbench.h"
+
+#define FSB_PREFIX        "fs-"
+#define FSB_FILE_SIZE     (16 * 1024 * 1024)
+#define FSB_DIR_FILES     256
+#define FSB_BSIZE_DEFAULT 4096
+#define FSB_BSIZE_MAX     (1024 * 1024)
+#define FSB_QD_MAX        64
+#define FSB_HIST_BUCKETS  24
+
+typedef enum {
+	FSB_SEQREAD,
+	FSB_SEQWRITE,
+	FSB_RANDREAD,
+	FSB_RANDWRITE,
+	FSB_FSYNC,
+	FSB_DIRSTORM
+} fsb_workload_t;
+
+typedef enum {
+	FSB_OP_READ,
+	FSB_OP_WRITE,
+	FSB_OP_WRITE_SYNC,
+	FSB_OP_CREATE,
+	FSB_OP_STAT,
+	FSB_OP_UNLINK
+} fsb_op_t;
+
+static const char *fsb_workload_names[] = {
+	[FSB_SEQREAD] = "seqread",
+	[FSB_SEQWRITE] = "seqwrite",
+	[FSB_RANDREAD] = "randread",
+	[FSB_RANDWRITE] = "randwrite",
+	[FSB_FSYNC] = "fsync",
+	[FSB_DIRSTORM] = "dirstorm"
+};
+
+typedef struct {
+	fsb_workload_t workload;
+	/** Block size */
+	size_t bsize;
+	/** Queue depth */
+	unsigned int qd;
+	/** File or directory to work in */
+	const char *path;
+	/** Open file */
+	int fd;
+	/** Number of blocks in the file */
+	size_t nblocks;
+
+	/** Protects the fields below */
+	fibril_mutex_t lock;
+	/** Signalled when a worker finishes */
+	fibril_condvar_t done_cv;
+	/** Operation performed in the current phase */
+	fsb_op_t op;
+	/** Operations in the current phase */
+	size_t nops;
+	/** Next operation to issue */
+	size_t next_op;
+	/** Number of running workers */
+	unsigned int running;
+	/** First error */
+	errno_t rc;
+
+	/** Latencies of all operations in microseconds */
+	suseconds_t *lat;
+	/** Number of latencies recorded */
+	size_t nlat;
+	/** Bytes transferred */
+	uint64_t bytes;
+} fsbench_t;
+
+/** Parse test type.
+ *
+ * @return EOK on success, EINVAL if @a name is not a valid file system
+ *         test type.
+ */
+static errno_t fsbench_parse(const char *name, fsbench_t *fsb)
+{
+	const char *p;
+	const char *endp;
+	size_t len;
+	size_t val;
+	unsigned int i;
+
+	if (str_lcmp(name, FSB_PREFIX, str_length(FSB_PREFIX)) != 0)
+		return EINVAL;
+	p = name + str_size(FSB_PREFIX);
+
+	for (i = 0; i < sizeof(fsb_workload_names) / sizeof(char *); i++) {
+		len = str_size(fsb_workload_names[i]);
+		if (str_lcmp(p, fsb_workload_names[i], len) == 0 &&
+		    (p[len] == '\0' || p[len] == '-'))
+			break;
+	}
+
+	if (i >= sizeof(fsb_workload_names) / sizeof(char *))
+		return EINVAL;
+
+	fsb->workload = i;
+	fsb->bsize = FSB_BSIZE_DEFAULT;
+	fsb->qd = 1;
+	p += len;
+
+	if (*p == '-') {
+		if (str_size_t(p + 1, &endp, 10, false, &val) != EOK ||
+		    val == 0 || val > FSB_BSIZE_MAX)
+			return EINVAL;
+		fsb->bsize = val;
+		p = endp;
+	}
+
+	if (*p == '-') {
+		if (str_size_t(p + 1, &endp, 10, false, &val) != EOK ||
+		    val == 0 || val > FSB_QD_MAX)
+			return EINVAL;
+		fsb->qd = val;
+		p = endp;
+	}
+
+	if (*p != '\0')
+		return EINVAL;
+
+	return EOK;
+}
+
+/** Determine whether test type is a file system benchmark. */
+bool fsbench_is_test(const char *name)
+{
+	fsbench_t fsb;
+
+	return fsbench_parse(name, &fsb) == EOK;
+}
+
+/** Get file name for dirstorm operation. */
+static char *fsbench_dir_entry(fsbench_t *fsb, size_t idx)
+{
+	char *fname;
+
+	if (asprintf(&fname, "%s/fsb%zu", fsb->path, idx) < 0)
+		return NULL;
+
+	return fname;
+}
+
+/** Perform one operation. */
+static errno_t fsbench_op(fsbench_t *fsb, fsb_op_t op, size_t idx,
+    char *buf, size_t *nbytes)
+{
+	aoff64_t pos;
+	size_t block;
+	size_t n;
+	char *fname;
+	vfs_stat_t st;
+	int fd;
+	errno_t rc;
+
+	*nbytes = 0;
+
+	switch (fsb->workload) {
+	case FSB_RANDREAD:
+	case FSB_RANDWRITE:
+		block = hash_mix(idx + 1) % fsb->nblocks;
+		break;
+	default:
+		block = idx;
+		break;
+	}
+
+	pos = (aoff64_t) block * fsb->bsize;
+
+	switch (op) {
+	case FSB_OP_READ:
+		rc = vfs_read(fsb->fd, &pos, buf, fsb->bsize, &n);
+		*nbytes = n;
+		return rc;
+	case FSB_OP_WRITE:
+	case FSB_OP_WRITE_SYNC:
+		rc = vfs_write(fsb->fd, &pos, buf, fsb->bsize, &n);
+		*nbytes = n;
+		if (rc == EOK && op == FSB_OP_WRITE_SYNC)
+			rc = vfs_sync(fsb->fd);
+		return rc;
+	default:
+		break;
+	}
+
+	fname = fsbench_dir_entry(fsb, idx);
+	if (fname == NULL)
+		return ENOMEM;
+
+	switch (op) {
+	case FSB_OP_CREATE:
+		rc = vfs_lookup(fname, WALK_REGULAR | WALK_MUST_CREATE, &fd);
+		if (rc == EOK)
+			vfs_put(fd);
+		break;
+	case FSB_OP_STAT:
+		rc = vfs_stat_path(fname, &st);
+		break;
+	case FSB_OP_UNLINK:
+		rc = vfs_unlink_path(fname);
+		break;
+	default:
+		assert(false);
+		rc = EINVAL;
+		break;
+	}
+
+	free(fname);
+	return rc;
+}
+
+/** Worker fibril issuing operations of the current phase. */
+static errno_t fsbench_worker(void *arg)
+{
+	fsbench_t *fsb = (fsbench_t *) arg;
+	struct timeval start;
+	struct timeval end;
+	size_t nbytes;
+	size_t idx;
+	char *buf;
+	errno_t rc;
+
+	buf = malloc(fsb->bsize);
+	if (buf != NULL)
+		memset(buf, 0x5a, fsb->bsize);
+
+	fibril_mutex_lock(&fsb->lock);
+
+	if (buf == NULL && fsb->rc == EOK)
+		fsb->rc = ENOMEM;
+
+	while (fsb->rc == EOK && fsb->next_op < fsb->nops) {
+		idx = fsb->next_op++;
+		fibril_mutex_unlock(&fsb->lock);
+
+		getuptime(&start);
+		rc = fsbench_op(fsb, fsb->op, idx, buf, &nbytes);
+		getuptime(&end);
+
+		fibril_mutex_lock(&fsb->lock);
+		if (rc != EOK && fsb->rc == EOK)
+			fsb->rc = rc;
+		fsb->lat[fsb->nlat++] = tv_sub_diff(&end, &start);
+		fsb->bytes += nbytes;
+	}
+
+	fsb->running--;
+	fibril_condvar_broadcast(&fsb->done_cv);
+	fibril_mutex_unlock(&fsb->lock);
+
+	free(buf);
+	return EOK;
+}
+
+/** Run one phase of a workload with fsb->qd workers. */
+static errno_t fsbench_phase(fsbench_t *fsb, fsb_op_t op, size_t nops)
+{
+	fid_t fid;
+
+	fibril_mutex_lock(&fsb->lock);
+	fsb->op = op;
+	fsb->nops = nops;
+	fsb->next_op = 0;
+	fsb->running = 0;
+
+	for (unsigned int i = 0; i < fsb->qd; i++) {
+		fid = fibril_create(fsbench_worker, fsb);
+		if (fid == 0) {
+			if (fsb->rc == EOK)
+				fsb->rc = ENOMEM;
+			break;
+		}
+
+		fsb->running++;
+		fibril_add_ready(fid);
+	}
+
+	while (fsb->running > 0)
+		fibril_condvar_wait(&fsb->done_cv, &fsb->lock);
+
+	fibril_mutex_unlock(&fsb->lock);
+	return fsb->rc;
+}
+
+/** Create the test file and fill it, if the workload reads or rewrites it. */
+static errno_t fsbench_prepare(fsbench_t *fsb)
+{
+	aoff64_t pos = 0;
+	size_t nwr;
+	char *buf;
+	errno_t rc;
+
+	rc = vfs_lookup_open(fsb->path, WALK_REGULAR | WALK_MAY_CREATE,
+	    MODE_READ | MODE_WRITE, &fsb->fd);
+	if (rc != EOK) {
+		fprintf(stderr, "Failed opening file: %s\n", fsb->path);
+		return rc;
+	}
+
+	rc = vfs_resize(fsb->fd, 0);
+	if (rc != EOK || fsb->workload == FSB_SEQWRITE ||
+	    fsb->workload == FSB_FSYNC)
+		return rc;
+
+	buf = calloc(1, fsb->bsize);
+	if (buf == NULL)
+		return ENOMEM;
+
+	for (size_t i = 0; i < fsb->nblocks && rc == EOK; i++)
+		rc = vfs_write(fsb->fd, &pos, buf, fsb->bsize, &nwr);
+
+	if (rc == EOK)
+		rc = vfs_sync(fsb->fd);
+
+	free(buf);
+	return rc;
+}
+
+static int fsbench_lat_cmp(const void *a, const void *b)
+{
+	suseconds_t va = *(const suseconds_t *) a;
+	suseconds_t vb = *(const suseconds_t *) b;
+
+	return (va > vb) - (va < vb);
+}
+
+/** Nearest-rank percentile of sorted latencies. */
+static suseconds_t fsbench_pct(fsbench_t *fsb, unsigned int pct)
+{
+	size_t rank = (pct * fsb->nlat + 99) / 100;
+
+	return fsb->lat[rank > 0 ? rank - 1 : 0];
+}
+
+/** Print results of one run. */
+static void fsbench_report(fsbench_t *fsb, const char *name,
+    const char *log_str, suseconds_t usec)
+{
+	uint64_t hist[FSB_HIST_BUCKETS];
+	unsigned int b;
+	suseconds_t lat;
+
+	if (usec == 0)
+		usec = 1;
+
+	qsort(fsb->lat, fsb->nlat, sizeof(suseconds_t), fsbench_lat_cmp);
+
+	printf("%s;%s;%s;%zu;%" PRIu64 ";iops;%" PRIu64 ";KiB/s;%ld;%ld;%ld;"
+	    "%ld;us\n", name, fsb->path, log_str, fsb->nlat,
+	    (uint64_t) fsb->nlat * 1000000 / usec,
+	    fsb->bytes * 1000000 / 1024 / usec,
+	    (long) fsbench_pct(fsb, 50), (long) fsbench_pct(fsb, 90),
+	    (long) fsbench_pct(fsb, 99), (long) fsb->lat[fsb->nlat - 1]);
+
+	memset(hist, 0, sizeof(hist));
+	for (size_t i = 0; i < fsb->nlat; i++) {
+		lat = fsb->lat[i];
+		b = 0;
+		while (lat > 1 && b < FSB_HIST_BUCKETS - 1) {
+			lat >>= 1;
+			b++;
+		}
+		hist[b]++;
+	}
+
+	printf("%s;%s;%s;hist", name, fsb->path, log_str);
+	for (b = 0; b < FSB_HIST_BUCKETS; b++)
+		printf("%c%" PRIu64, b == 0 ? ';' : ',', hist[b]);
+	printf(";log2us\n");
+}
+
+/** Run one iteration of a workload. */
+static errno_t fsbench_iter(fsbench_t *fsb, const char *name,
+    const char *log_str)
+{
+	struct timeval start;
+	struct timeval end;
+	errno_t rc;
+
+	fsb->fd = -1;
+	fsb->rc = EOK;
+	fsb->nlat = 0;
+	fsb->bytes = 0;
+
+	if (fsb->workload != FSB_DIRSTORM) {
+		rc = fsbench_prepare(fsb);
+		if (rc != EOK)
+			goto out;
+	}
+
+	getuptime(&start);
+
+	switch (fsb->workload) {
+	case FSB_SEQREAD:
+	case FSB_RANDREAD:
+		rc = fsbench_phase(fsb, FSB_OP_READ, fsb->nblocks);
+		break;
+	case FSB_SEQWRITE:
+	case FSB_RANDWRITE:
+		rc = fsbench_phase(fsb, FSB_OP_WRITE, fsb->nblocks);
+		if (rc == EOK)
+			rc = vfs_sync(fsb->fd);
+		break;
+	case FSB_FSYNC:
+		rc = fsbench_phase(fsb, FSB_OP_WRITE_SYNC, fsb->nblocks);
+		break;
+	case FSB_DIRSTORM:
+		rc = fsbench_phase(fsb, FSB_OP_CREATE, FSB_DIR_FILES);
+		if (rc == EOK)
+			rc = fsbench_phase(fsb, FSB_OP_STAT, FSB_DIR_FILES);
+		if (rc == EOK)
+			rc = fsbench_phase(fsb, FSB_OP_UNLINK, FSB_DIR_FILES);
+		break;
+	}
+
+	getuptime(&end);
+
+	if (rc == EOK && fsb->nlat > 0)
+		fsbench_report(fsb, name, log_str, tv_sub_diff(&end, &start));
+out:
+	if (fsb->fd >= 0) {
+		vfs_put(fsb->fd);
+		vfs_unlink_path(fsb->path);
+	}
+
+	return rc;
+}
+
+/** Run file system benchmark.
+ *
+ * @param name		Test type
+ * @param log_str	String to attach to results
+ * @param path		File (or directory for dirstorm) to work in
+ * @param iterations	Number of times to run the workload
+ */
+errno_t fsbench_run(const char *name, const char *log_str, const char *path,
+    unsigned int iterations)
+{
+	fsbench_t fsb;
+	size_t maxops;
+	errno_t rc = EOK;
+
+	rc = fsbench_parse(name, &fsb);
+	if (rc != EOK)
+		return rc;
+
+	if (fsb.bsize > FSB_FILE_SIZE)
+		return EINVAL;
+
+	fsb.path = path;
+	fsb.nblocks = FSB_FILE_SIZE / fsb.bsize;
+	fibril_mutex_initialize(&fsb.lock);
+	fibril_condvar_initialize(&fsb.done_cv);
+
+	maxops = fsb.workload == FSB_DIRSTORM ? 3 * FSB_DIR_FILES :
+	    fsb.nblocks;
+	fsb.lat = calloc(maxops, sizeof(suseconds_t));
+	if (fsb.lat == NULL)
+		return ENOMEM;
+
+	for (unsigned int i = 0; i < iterations && rc == EOK; i++) {
+		rc = fsbench_iter(&fsb, name, log_str);
+		if (rc != EOK) {
+			fprintf(stderr, "%s failed: %s\n", name,
+			    str_error(rc));
+		}
+	}
+
+	free(fsb.lat);
+	return rc;
+}
+
+/**
+ * @}
+ */
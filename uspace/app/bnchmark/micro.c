@@ -0,0 +1,698 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup test
+ * @{
+ */
+
+/**
+ * @file	micro.c
+ * IPC and threading micro-benchmarks.
+ *
+ * Each sample times a batch of operations, so that even without a cycle
+ * counter backed uptime, the tick resolution of the system clock does not
+ * dominate. The batch size is calibrated so that a batch takes at least
+ * MICRO_BATCH_NSEC and the per-operation time is reported in nanoseconds.
+ * Minimum, percentiles and maximum are computed over the samples.
+ *
+ * IPC benchmarks talk to the ipc-test service, which must be running.
+ * Drawing benchmarks fill or stroke typical widget shapes of a given size
+ * on an off-screen surface.
+ */
+
+#include <as.h>
+#include <async.h>
+#include <drawctx.h>
+#include <errno.h>
+#include <fibril.h>
+#include <futex.h>
+#include <inttypes.h>
+#include <ipc/ipc_test.h>
+#include <ipc/services.h>
+#include <loc.h>
+#include <macros.h>
+#include <math.h>
+#include <path.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <str.h>
+#include <str_error.h>
+#include <surface.h>
+#include <sys/time.h>
+#include <thread.h>
+
+#include "micro.h"
+
+/** Minimum duration of one timed batch */
+#define MICRO_BATCH_NSEC   (10 * 1000 * 1000)
+/** Maximum number of operations in one timed batch */
+#define MICRO_BATCH_MAX    (1024 * 1024)
+/** Number of asynchronous messages in flight */
+#define MICRO_ASYNC_WINDOW 64
+/** Width and height of the drawing surface */
+#define MICRO_DRAW_SIZE    512
+/** Number of line segments approximating a full circle */
+#define MICRO_DRAW_ARC     32
+
+typedef struct {
+	/** Session to the ipc-test service */
+	async_sess_t *sess;
+	/** Data transfer buffer */
+	char *buf;
+	/** Area for share out */
+	void *area;
+	/** Futexes for thread ping-pong */
+	futex_t ping;
+	futex_t pong;
+	/** Signalled by a helper thread when it is about to exit */
+	futex_t done;
+	/** Stop flag for helper fibril or thread */
+	volatile bool stop;
+	/** Surface to draw on */
+	surface_t *surface;
+	/** Path of the shape being drawn */
+	path_t *path;
+} micro_t;
+
+/** Run a given number of operations of a benchmark.
+ *
+ * @param micro	Benchmark state
+ * @param param	Benchmark parameter (e.g. transfer size)
+ * @param count	Number of operations
+ */
+typedef errno_t (*micro_func_t)(micro_t *, size_t, size_t);
+
+typedef struct {
+	/** Test type name */
+	const char *name;
+	/** Operation */
+	micro_func_t func;
+	/** Parameters to run with, zero-terminated, NULL for single run */
+	const size_t *params;
+	/** Number of timed events per operation */
+	unsigned int events;
+	/** Requires the ipc-test service */
+	bool ipc;
+} micro_bench_t;
+
+/** Data transfer sizes, 64 B to 16 MiB */
+static const size_t micro_xfer_sizes[] = {
+	64, 256, 1024, 4096, 16384, 65536, 262144, 1048576, 4194304,
+	16777216, 0
+};
+
+#define MICRO_XFER_MAX  (16 * 1024 * 1024)
+
+/** Widget sizes, 16 to 256 pixels */
+static const size_t micro_draw_sizes[] = {
+	16, 32, 64, 128, 256, 0
+};
+
+static errno_t micro_ipc_ping(micro_t *micro, size_t param, size_t count)
+{
+	errno_t rc = EOK;
+
+	for (size_t i = 0; i < count && rc == EOK; i++) {
+		async_exch_t *exch = async_exchange_begin(micro->sess);
+		rc = async_req_0_0(exch, IPC_TEST_PING);
+		async_exchange_end(exch);
+	}
+
+	return rc;
+}
+
+static errno_t micro_ipc_ping_async(micro_t *micro, size_t param,
+    size_t count)
+{
+	aid_t aids[MICRO_ASYNC_WINDOW];
+	errno_t rc = EOK;
+	errno_t retval;
+	size_t n;
+
+	async_exch_t *exch = async_exchange_begin(micro->sess);
+
+	while (count > 0) {
+		n = min(count, MICRO_ASYNC_WINDOW);
+
+		for (size_t i = 0; i < n; i++)
+			aids[i] = async_send_0(exch, IPC_TEST_PING, NULL);
+
+		for (size_t i = 0; i < n; i++) {
+			async_wait_for(aids[i], &retval);
+			if (retval != EOK)
+				rc = retval;
+		}
+
+		count -= n;
+	}
+
+	async_exchange_end(exch);
+	return rc;
+}
+
+/** Transfer data in chunks of at most DATA_XFER_LIMIT. */
+static errno_t micro_ipc_xfer(micro_t *micro, size_t size, size_t count,
+    bool write)
+{
+	errno_t rc = EOK;
+	errno_t retval;
+	size_t chunk;
+	size_t done;
+	aid_t req;
+
+	async_exch_t *exch = async_exchange_begin(micro->sess);
+
+	for (size_t i = 0; i < count && rc == EOK; i++) {
+		done = 0;
+		while (done < size && rc == EOK) {
+			chunk = min(size - done, DATA_XFER_LIMIT);
+			if (write) {
+				req = async_send_0(exch, IPC_TEST_DATA_WRITE,
+				    NULL);
+				rc = async_data_write_start(exch,
+				    micro->buf + done, chunk);
+			} else {
+				req = async_send_0(exch, IPC_TEST_DATA_READ,
+				    NULL);
+				rc = async_data_read_start(exch,
+				    micro->buf + done, chunk);
+			}
+
+			async_wait_for(req, &retval);
+			if (rc == EOK)
+				rc = retval;
+			done += chunk;
+		}
+	}
+
+	async_exchange_end(exch);
+	return rc;
+}
+
+static errno_t micro_ipc_data_write(micro_t *micro, size_t size,
+    size_t count)
+{
+	return micro_ipc_xfer(micro, size, count, true);
+}
+
+static errno_t micro_ipc_data_read(micro_t *micro, size_t size, size_t count)
+{
+	return micro_ipc_xfer(micro, size, count, false);
+}
+
+static errno_t micro_ipc_share_in(micro_t *micro, size_t param, size_t count)
+{
+	errno_t rc = EOK;
+	errno_t retval;
+	void *dst;
+	aid_t req;
+
+	async_exch_t *exch = async_exchange_begin(micro->sess);
+
+	for (size_t i = 0; i < count && rc == EOK; i++) {
+		req = async_send_0(exch, IPC_TEST_SHARE_IN, NULL);
+		rc = async_share_in_start_0_0(exch, IPC_TEST_SHARE_SIZE, &dst);
+		async_wait_for(req, &retval);
+		if (rc == EOK) {
+			as_area_destroy(dst);
+			rc = retval;
+		}
+	}
+
+	async_exchange_end(exch);
+	return rc;
+}
+
+static errno_t micro_ipc_share_out(micro_t *micro, size_t param,
+    size_t count)
+{
+	errno_t rc = EOK;
+	errno_t retval;
+	aid_t req;
+
+	async_exch_t *exch = async_exchange_begin(micro->sess);
+
+	for (size_t i = 0; i < count && rc == EOK; i++) {
+		req = async_send_0(exch, IPC_TEST_SHARE_OUT, NULL);
+		rc = async_share_out_start(exch, micro->area,
+		    AS_AREA_READ | AS_AREA_CACHEABLE);
+		async_wait_for(req, &retval);
+		if (rc == EOK)
+			rc = retval;
+	}
+
+	async_exchange_end(exch);
+	return rc;
+}
+
+static errno_t micro_yield_fibril(void *arg)
+{
+	micro_t *micro = (micro_t *) arg;
+
+	while (!micro->stop)
+		fibril_yield();
+
+	return EOK;
+}
+
+static errno_t micro_fibril_switch(micro_t *micro, size_t param,
+    size_t count)
+{
+	fid_t fid;
+
+	fid = fibril_create(micro_yield_fibril, micro);
+	if (fid == 0)
+		return ENOMEM;
+
+	micro->stop = false;
+	fibril_add_ready(fid);
+
+	/* Each yield switches to the helper fibril and back. */
+	for (size_t i = 0; i < count; i++)
+		fibril_yield();
+
+	micro->stop = true;
+	fibril_yield();
+	return EOK;
+}
+
+static void micro_pong_thread(void *arg)
+{
+	micro_t *micro = (micro_t *) arg;
+
+	while (true) {
+		futex_down(&micro->ping);
+		if (micro->stop)
+			break;
+		futex_up(&micro->pong);
+	}
+
+	futex_up(&micro->done);
+}
+
+static errno_t micro_futex_wake(micro_t *micro, size_t param, size_t count)
+{
+	thread_id_t tid;
+	errno_t rc;
+
+	futex_initialize(&micro->ping, 0);
+	futex_initialize(&micro->pong, 0);
+	futex_initialize(&micro->done, 0);
+	micro->stop = false;
+
+	rc = thread_create(micro_pong_thread, micro, "micro_pong", &tid);
+	if (rc != EOK)
+		return rc;
+
+	/* Each round trip wakes the other thread and is woken back. */
+	for (size_t i = 0; i < count; i++) {
+		futex_up(&micro->ping);
+		futex_down(&micro->pong);
+	}
+
+	/* thread_join() is not implemented, wait for the thread to finish. */
+	micro->stop = true;
+	futex_up(&micro->ping);
+	futex_down(&micro->done);
+	return EOK;
+}
+
+static void micro_null_thread(void *arg)
+{
+	micro_t *micro = (micro_t *) arg;
+
+	futex_up(&micro->done);
+}
+
+static errno_t micro_thread_create(micro_t *micro, size_t param,
+    size_t count)
+{
+	thread_id_t tid;
+	errno_t rc;
+
+	futex_initialize(&micro->done, 0);
+
+	for (size_t i = 0; i < count; i++) {
+		rc = thread_create(micro_null_thread, micro, "micro_null", &tid);
+		if (rc != EOK)
+			return rc;
+
+		futex_down(&micro->done);
+	}
+
+	return EOK;
+}
+
+/** Continue path to an absolute position. */
+static void micro_path_to(path_t *path, bool move, double x, double y)
+{
+	double cx, cy;
+
+	path_get_cursor(path, &cx, &cy);
+	if (move)
+		path_move_to(path, x - cx, y - cy);
+	else
+		path_line_to(path, x - cx, y - cy);
+}
+
+/** Add arc of a quarter of circle to path. */
+static void micro_path_arc(path_t *path, double cx, double cy, double r,
+    unsigned int quarter)
+{
+	unsigned int segs = MICRO_DRAW_ARC / 4;
+
+	for (unsigned int i = 0; i <= segs; i++) {
+		double a = (quarter + (double) i / segs) * M_PI / 2;
+		micro_path_to(path, false, cx + r * cos(a), cy + r * sin(a));
+	}
+}
+
+/** Build rounded rectangle path like a button frame. */
+static void micro_path_round(path_t *path, double x, double y, double w,
+    double h, double r)
+{
+	micro_path_to(path, true, x + r, y);
+	micro_path_arc(path, x + w - r, y + r, r, 3);
+	micro_path_arc(path, x + w - r, y + h - r, r, 0);
+	micro_path_arc(path, x + r, y + h - r, r, 1);
+	micro_path_arc(path, x + r, y + r, r, 2);
+}
+
+/** Draw the current path a given number of times. */
+static errno_t micro_draw(micro_t *micro, size_t count, bool stroke)
+{
+	drawctx_t context;
+	source_t source;
+
+	source_init(&source);
+	source_set_color(&source, PIXEL(255, 64, 128, 192));
+
+	drawctx_init(&context, micro->surface);
+	drawctx_set_compose(&context, compose_over);
+	drawctx_set_source(&context, &source);
+
+	for (size_t i = 0; i < count; i++) {
+		if (stroke)
+			drawctx_stroke(&context, micro->path);
+		else
+			drawctx_fill(&context, micro->path);
+	}
+
+	surface_reset_damaged_region(micro->surface);
+	return EOK;
+}
+
+/*
+ * Shapes are placed at fractional coordinates so that their edges are
+ * anti-aliased as they would be after scaling.
+ */
+
+static errno_t micro_draw_rect(micro_t *micro, size_t param, size_t count)
+{
+	path_clear(micro->path);
+	path_rectangle(micro->path, 8.25, 8.25, param, param / 2.0);
+	return micro_draw(micro, count, false);
+}
+
+static errno_t micro_draw_round(micro_t *micro, size_t param, size_t count)
+{
+	path_clear(micro->path);
+	micro_path_round(micro->path, 8.25, 8.25, param, param / 2.0,
+	    param / 8.0);
+	return micro_draw(micro, count, false);
+}
+
+static errno_t micro_draw_circle(micro_t *micro, size_t param, size_t count)
+{
+	double r = param / 2.0;
+
+	path_clear(micro->path);
+	micro_path_to(micro->path, true, 8.25 + 2 * r, 8.25 + r);
+	for (unsigned int q = 0; q < 4; q++)
+		micro_path_arc(micro->path, 8.25 + r, 8.25 + r, r, q);
+
+	return micro_draw(micro, count, false);
+}
+
+static errno_t micro_draw_stroke(micro_t *micro, size_t param, size_t count)
+{
+	double s = param;
+
+	/* Frame of a check box with a check mark in it */
+	path_clear(micro->path);
+	micro_path_round(micro->path, 8.5, 8.5, s, s, s / 8);
+	micro_path_to(micro->path, true, 8.5 + s / 4, 8.5 + s / 2);
+	micro_path_to(micro->path, false, 8.5 + s / 2, 8.5 + 3 * s / 4);
+	micro_path_to(micro->path, false, 8.5 + 3 * s / 4, 8.5 + s / 4);
+
+	return micro_draw(micro, count, true);
+}
+
+static micro_bench_t micro_benches[] = {
+	{ "ipc-ping", micro_ipc_ping, NULL, 1, true },
+	{ "ipc-ping-async", micro_ipc_ping_async, NULL, 1, true },
+	{ "ipc-data-write", micro_ipc_data_write, micro_xfer_sizes, 1, true },
+	{ "ipc-data-read", micro_ipc_data_read, micro_xfer_sizes, 1, true },
+	{ "ipc-share-in", micro_ipc_share_in, NULL, 1, true },
+	{ "ipc-share-out", micro_ipc_share_out, NULL, 1, true },
+	{ "fibril-switch", micro_fibril_switch, NULL, 2, false },
+	{ "futex-wake", micro_futex_wake, NULL, 2, false },
+	{ "thread-create", micro_thread_create, NULL, 1, false },
+	{ "draw-fill-rect", micro_draw_rect, micro_draw_sizes, 1, false },
+	{ "draw-fill-round", micro_draw_round, micro_draw_sizes, 1, false },
+	{ "draw-fill-circle", micro_draw_circle, micro_draw_sizes, 1, false },
+	{ "draw-stroke", micro_draw_stroke, micro_draw_sizes, 1, false },
+	{ NULL, NULL, NULL, 0, false }
+};
+
+static micro_bench_t *micro_find(const char *name)
+{
+	for (micro_bench_t *bench = micro_benches; bench->name != NULL;
+	    bench++) {
+		if (str_cmp(bench->name, name) == 0)
+			return bench;
+	}
+
+	return NULL;
+}
+
+/** Determine whether test type is a micro-benchmark. */
+bool micro_is_test(const char *name)
+{
+	return str_cmp(name, "micro-all") == 0 || micro_find(name) != NULL;
+}
+
+/** Time one batch of operations.
+ *
+ * @param nsec	Place to store duration in nanoseconds
+ */
+static errno_t micro_time(micro_bench_t *bench, micro_t *micro, size_t param,
+    size_t count, uint64_t *nsec)
+{
+	uint64_t start;
+	errno_t rc;
+
+	start = getuptime_nsec();
+	rc = bench->func(micro, param, count);
+	*nsec = getuptime_nsec() - start;
+
+	return rc;
+}
+
+static int micro_cmp(const void *a, const void *b)
+{
+	uint64_t va = *(const uint64_t *) a;
+	uint64_t vb = *(const uint64_t *) b;
+
+	return (va > vb) - (va < vb);
+}
+
+/** Nearest-rank percentile of sorted samples. */
+static uint64_t micro_pct(uint64_t *samples, unsigned int n, unsigned int pct)
+{
+	unsigned int rank = (pct * n + 99) / 100;
+
+	return samples[rank > 0 ? rank - 1 : 0];
+}
+
+/** Run one benchmark with one parameter and print a result line.
+ *
+ * The line has the form
+ * <test>;<param>;<log-str>;<batch>;<min>;<p50>;<p90>;<p99>;<max>;ns
+ * where times are per event in nanoseconds and batch is the number of
+ * operations timed together in each sample.
+ */
+static errno_t micro_run_one(micro_bench_t *bench, micro_t *micro,
+    size_t param, const char *log_str, unsigned int samples)
+{
+	uint64_t *ns;
+	uint64_t nsec;
+	size_t count;
+	errno_t rc;
+
+	ns = calloc(samples, sizeof(uint64_t));
+	if (ns == NULL)
+		return ENOMEM;
+
+	/* Warm up and calibrate batch size. */
+	count = 1;
+	while (true) {
+		rc = micro_time(bench, micro, param, count, &nsec);
+		if (rc != EOK)
+			goto out;
+		if (nsec >= MICRO_BATCH_NSEC || count >= MICRO_BATCH_MAX)
+			break;
+		count *= 2;
+	}
+
+	for (unsigned int i = 0; i < samples; i++) {
+		rc = micro_time(bench, micro, param, count, &nsec);
+		if (rc != EOK)
+			goto out;
+
+		ns[i] = nsec / (count * bench->events);
+	}
+
+	qsort(ns, samples, sizeof(uint64_t), micro_cmp);
+
+	printf("%s;%zu;%s;%zu;%" PRIu64 ";%" PRIu64 ";%" PRIu64 ";%" PRIu64
+	    ";%" PRIu64 ";ns\n", bench->name, param, log_str, count, ns[0],
+	    micro_pct(ns, samples, 50), micro_pct(ns, samples, 90),
+	    micro_pct(ns, samples, 99), ns[samples - 1]);
+out:
+	if (rc != EOK) {
+		fprintf(stderr, "%s (%zu) failed: %s\n", bench->name, param,
+		    str_error(rc));
+	}
+
+	free(ns);
+	return rc;
+}
+
+static errno_t micro_run_bench(micro_bench_t *bench, micro_t *micro,
+    const char *log_str, unsigned int samples)
+{
+	errno_t rc;
+
+	if (bench->ipc && micro->sess == NULL) {
+		fprintf(stderr, "%s skipped, ipc-test service not available\n",
+		    bench->name);
+		return ENOENT;
+	}
+
+	if (bench->params == NULL)
+		return micro_run_one(bench, micro, 0, log_str, samples);
+
+	for (const size_t *param = bench->params; *param != 0; param++) {
+		rc = micro_run_one(bench, micro, *param, log_str, samples);
+		if (rc != EOK)
+			return rc;
+	}
+
+	return EOK;
+}
+
+/** Run micro-benchmark.
+ *
+ * @param name		Test type, or micro-all to run all benchmarks
+ * @param log_str	String to attach to results
+ * @param samples	Number of samples per benchmark and parameter
+ */
+errno_t micro_run(const char *name, const char *log_str, unsigned int samples)
+{
+	micro_t micro;
+	micro_bench_t *bench;
+	service_id_t svc_id;
+	errno_t rc = EOK;
+	errno_t brc;
+	bool all;
+
+	if (samples == 0)
+		return EINVAL;
+
+	all = str_cmp(name, "micro-all") == 0;
+	bench = all ? NULL : micro_find(name);
+
+	micro.sess = NULL;
+	micro.stop = false;
+
+	micro.buf = malloc(MICRO_XFER_MAX);
+	if (micro.buf == NULL)
+		return ENOMEM;
+
+	micro.area = as_area_create(AS_AREA_ANY, IPC_TEST_SHARE_SIZE,
+	    AS_AREA_READ | AS_AREA_WRITE | AS_AREA_CACHEABLE, AS_AREA_UNPAGED);
+	if (micro.area == AS_MAP_FAILED) {
+		free(micro.buf);
+		return ENOMEM;
+	}
+
+	micro.surface = surface_create(MICRO_DRAW_SIZE, MICRO_DRAW_SIZE, NULL,
+	    SURFACE_FLAG_NONE);
+	micro.path = path_create();
+	if (micro.surface == NULL || micro.path == NULL) {
+		if (micro.surface != NULL)
+			surface_destroy(micro.surface);
+		if (micro.path != NULL)
+			path_destroy(micro.path);
+		as_area_destroy(micro.area);
+		free(micro.buf);
+		return ENOMEM;
+	}
+
+	if (all || bench->ipc) {
+		rc = loc_service_get_id(SERVICE_NAME_IPC_TEST, &svc_id, 0);
+		if (rc == EOK) {
+			micro.sess = loc_service_connect(svc_id, INTERFACE_DDF,
+			    0);
+		}
+	}
+
+	if (all) {
+		rc = EOK;
+		for (bench = micro_benches; bench->name != NULL; bench++) {
+			brc = micro_run_bench(bench, &micro, log_str, samples);
+			if (brc != EOK)
+				rc = brc;
+		}
+	} else {
+		rc = micro_run_bench(bench, &micro, log_str, samples);
+	}
+
+	if (micro.sess != NULL)
+		async_hangup(micro.sess);
+	path_destroy(micro.path);
+	surface_destroy(micro.surface);
+	as_area_destroy(micro.area);
+	free(micro.buf);
+	return rc;
+}
+
+/**
+ * @}
+ */
@@ -53,6 +53,7 @@ static void print_syntax(void)
 	printf("\t%s get-ns\n", NAME);
 	printf("\t%s set-ns <server-addr>\n", NAME);
 	printf("\t%s unset-ns\n", NAME);
+	printf("\t%s cache-stats\n", NAME);
 }
 
 static errno_t dnscfg_set_ns(int argc, char *argv[])
@@ -125,6 +126,25 @@ static errno_t dnscfg_print(void)
 	return EOK;
 }
 
+static errno_t dnscfg_cache_stats(void)
+{
+	dnsr_cache_stats_t stats;
+	errno_t rc = dnsr_get_cache_stats(&stats);
+	if (rc != EOK) {
+		printf("%s: Failed getting cache statistics (%s)\n", NAME,
+		    str_error(rc));
+		return rc;
+	}
+
+	printf("Cached entries: %zu\n", stats.entries);
+	printf("Hits:           %zu\n", stats.hits);
+	printf("Negative hits:  %zu\n", stats.neg_hits);
+	printf("Misses:         %zu\n", stats.misses);
+	printf("Joined queries: %zu\n", stats.joined);
+	printf("Evictions:      %zu\n", stats.evictions);
+	return EOK;
+}
+
 int main(int argc, char *argv[])
 {
 	if ((argc < 2) || (str_cmp(argv[1], "get-ns") == 0))
@@ -133,6 +153,8 @@ int main(int argc, char *argv[])
 		return dnscfg_set_ns(argc - 2, argv + 2);
 	else if (str_cmp(argv[1], "unset-ns") == 0)
 		return dnscfg_unset_ns();
+	else if (str_cmp(argv[1], "cache-stats") == 0)
+		return dnscfg_cache_stats();
 	else {
 		printf("%s: Unknown command '%s'.\n", NAME, argv[1]);
 		print_syntax();
@@ -224,8 +224,12 @@ int main(int argc, char *argv[])
 			goto error;
 		}
 
+		http_body_reader_t body;
+		rc = http_body_init(&body, &http->recv_buffer, response);
+
 		size_t body_size;
-		while ((rc = recv_buffer(&http->recv_buffer, buf, buf_size, &body_size)) == EOK && body_size > 0) {
+		while (rc == EOK && (rc = http_body_read(&body, buf, buf_size,
+		    &body_size)) == EOK && body_size > 0) {
 			fwrite(buf, 1, body_size, ofile != NULL ? ofile : stdout);
 		}
 
@@ -595,6 +595,9 @@ static errno_t file_save(char const *fname)
 	case EIO:
 		status_display("Error writing data!");
 		break;
+	case ENOMEM:
+		status_display("Not enough memory!");
+		break;
 	default:
 		status_display("File saved.");
 		break;
@@ -690,43 +693,21 @@ static char *prompt(char const *prompt, char const *init_value)
 
 /** Insert file at caret position.
  *
- * Reads in the contents of a file and inserts them at the current position
- * of the caret.
+ * Inserts the contents of a file at the current position of the caret.
+ * The file is not read in as a whole, the sheet only refers to it.
  */
 static errno_t file_insert(char *fname)
 {
-	FILE *f;
-	wchar_t c;
-	char buf[BUF_SIZE];
-	int bcnt;
-	int n_read;
-	size_t off;
-
-	f = fopen(fname, "rt");
-	if (f == NULL)
-		return EINVAL;
-
-	bcnt = 0;
-
-	while (true) {
-		if (bcnt < STR_BOUNDS(1)) {
-			n_read = fread(buf + bcnt, 1, BUF_SIZE - bcnt, f);
-			bcnt += n_read;
-		}
-
-		off = 0;
-		c = str_decode(buf, &off, bcnt);
-		if (c == '\0')
-			break;
-
-		bcnt -= off;
-		memcpy(buf, buf + off, bcnt);
+	spt_t pt;
+	errno_t rc;
 
-		insert_char(c);
-	}
+	tag_get_pt(&pane.caret_pos, &pt);
 
-	fclose(f);
+	rc = sheet_insert_file(doc.sh, &pt, dir_before, fname);
+	if (rc != EOK)
+		return EINVAL;
 
+	pane.rflags |= REDRAW_TEXT;
 	return EOK;
 }
 
@@ -739,6 +720,10 @@ static errno_t file_save_range(char const *fname, spt_t const *spos,
 	spt_t sp, bep;
 	size_t bytes, n_written;
 
+	/* The file we are about to overwrite may be the one we refer to. */
+	if (sheet_detach_file(doc.sh) != EOK)
+		return ENOMEM;
+
 	f = fopen(fname, "wt");
 	if (f == NULL)
 		return EINVAL;
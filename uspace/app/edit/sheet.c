@@ -31,7 +31,7 @@
  */
 /**
  * @file
- * @brief Prototype implementation of Sheet data structure.
+ * @brief Piece table implementation of Sheet data structure.
  *
  * The sheet is an abstract data structure representing a piece of text.
  * On top of this data structure we can implement a text editor. It is
@@ -43,17 +43,31 @@
  * versa. The text that is inserted or deleted can contain tabs and newlines
  * which are interpreted and properly acted upon.
  *
- * This is a trivial implementation with poor efficiency with O(N+n)
- * insertion and deletion and O(N) mapping (in both directions), where
- * N is the size of the file and n is the size of the inserted/deleted text.
+ * The text is kept in a piece table. The sheet is a sequence of pieces,
+ * each referring to a run of text either in the file the sheet was loaded
+ * from or in a buffer which the inserted text is appended to. Text is never
+ * moved, insertion and deletion only split pieces and insert or remove
+ * entries of the piece table, which costs O(P+n) where P is the number of
+ * pieces and n is the size of the inserted/deleted text.
+ *
+ * The loaded file is mapped into memory rather than read, so only the parts
+ * of it which are actually looked at are brought in. It is cut into pieces
+ * of bounded size, and each piece caches the number of newlines it contains
+ * and precedes it. Mapping of coordinates to position and vice versa thus
+ * takes O(log P) to find the row plus time proportional to the length of
+ * the row and of one piece.
  */
 
+#include <as.h>
+#include <assert.h>
 #include <stdlib.h>
 #include <str.h>
 #include <errno.h>
 #include <adt/list.h>
 #include <align.h>
 #include <macros.h>
+#include <mem.h>
+#include <vfs/vfs.h>
 
 #include "sheet.h"
 #include "sheet_impl.h"
@@ -61,8 +75,14 @@
 enum {
 	TAB_WIDTH	= 8,
 
-	/** Initial  of dat buffer in bytes */
-	INITIAL_SIZE	= 32
+	/** Initial size of the buffer of inserted text in bytes */
+	INITIAL_SIZE	= 32,
+
+	/** Initial number of entries of the piece table */
+	INITIAL_PIECES	= 16,
+
+	/** Maximum size of a piece of loaded text in bytes */
+	PIECE_MAX	= 16384
 };
 
 /** Initialize an empty sheet. */
@@ -74,12 +94,24 @@ errno_t sheet_create(sheet_t **rsh)
 	if (sh == NULL)
 		return ENOMEM;
 
-	sh->dbuf_size = INITIAL_SIZE;
-	sh->text_size = 0;
+	sh->add_cap = INITIAL_SIZE;
+	sh->add_size = 0;
+	sh->add_buf = malloc(sh->add_cap);
 
-	sh->data = malloc(sh->dbuf_size);
-	if (sh->data == NULL)
+	sh->pieces_cap = INITIAL_PIECES;
+	sh->npieces = 0;
+	sh->pieces = malloc(sh->pieces_cap * sizeof(sheet_piece_t));
+
+	if (sh->add_buf == NULL || sh->pieces == NULL) {
+		free(sh->add_buf);
+		free(sh->pieces);
+		free(sh);
 		return ENOMEM;
+	}
+
+	sh->text_size = 0;
+	sh->file_text = NULL;
+	sh->file_fd = -1;
 
 	list_initialize(&sh->tags);
 
@@ -87,6 +119,159 @@ errno_t sheet_create(sheet_t **rsh)
 	return EOK;
 }
 
+/** Get text of a piece. */
+static const char *piece_text(sheet_t *sh, sheet_piece_t *p)
+{
+	return (p->add ? sh->add_buf : sh->file_text) + p->off;
+}
+
+/** Count newlines in a run of text. */
+static size_t count_nl(const char *text, size_t size)
+{
+	size_t cnt = 0;
+
+	for (size_t i = 0; i < size; i++) {
+		if (text[i] == '\n')
+			cnt++;
+	}
+
+	return cnt;
+}
+
+/** Get the number of newlines in the sheet. */
+static size_t sheet_nl_total(sheet_t *sh)
+{
+	if (sh->npieces == 0)
+		return 0;
+
+	sheet_piece_t *p = &sh->pieces[sh->npieces - 1];
+	return p->nl_before + p->nl;
+}
+
+/** Recompute positions of pieces starting with the piece @a first. */
+static void sheet_update(sheet_t *sh, size_t first)
+{
+	size_t start = 0;
+	size_t nl = 0;
+
+	if (first > 0) {
+		sheet_piece_t *p = &sh->pieces[first - 1];
+		start = p->start + p->len;
+		nl = p->nl_before + p->nl;
+	}
+
+	for (size_t i = first; i < sh->npieces; i++) {
+		sh->pieces[i].start = start;
+		sh->pieces[i].nl_before = nl;
+		start += sh->pieces[i].len;
+		nl += sh->pieces[i].nl;
+	}
+}
+
+/** Find the piece containing the byte at @a b_off.
+ *
+ * @return Index of the piece or the number of pieces if @a b_off is at or
+ *         beyond the end of text.
+ */
+static size_t sheet_find_piece(sheet_t *sh, size_t b_off)
+{
+	size_t lo = 0;
+	size_t hi = sh->npieces;
+
+	while (lo < hi) {
+		size_t mid = (lo + hi) / 2;
+		sheet_piece_t *p = &sh->pieces[mid];
+
+		if (p->start + p->len <= b_off)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+/** Make room for @a extra more entries of the piece table. */
+static errno_t sheet_reserve_pieces(sheet_t *sh, size_t extra)
+{
+	if (sh->npieces + extra <= sh->pieces_cap)
+		return EOK;
+
+	size_t cap = max(sh->pieces_cap * 2, sh->npieces + extra);
+	sheet_piece_t *newp = realloc(sh->pieces, cap * sizeof(sheet_piece_t));
+	if (newp == NULL)
+		return ENOMEM;
+
+	sh->pieces = newp;
+	sh->pieces_cap = cap;
+	return EOK;
+}
+
+/** Make room for @a size more bytes of inserted text. */
+static errno_t sheet_reserve_add(sheet_t *sh, size_t size)
+{
+	if (sh->add_size + size <= sh->add_cap)
+		return EOK;
+
+	size_t cap = max(sh->add_cap * 2, sh->add_size + size);
+	char *newp = realloc(sh->add_buf, cap);
+	if (newp == NULL)
+		return ENOMEM;
+
+	sh->add_buf = newp;
+	sh->add_cap = cap;
+	return EOK;
+}
+
+/** Make sure a piece starts at @a b_off.
+ *
+ * There must be room for one more entry in the piece table.
+ *
+ * @return Index of the piece starting at @a b_off or the number of pieces
+ *         if @a b_off is the end of text.
+ */
+static size_t sheet_split(sheet_t *sh, size_t b_off)
+{
+	size_t i = sheet_find_piece(sh, b_off);
+	if (i == sh->npieces || sh->pieces[i].start == b_off)
+		return i;
+
+	assert(sh->npieces < sh->pieces_cap);
+
+	sheet_piece_t *p = &sh->pieces[i];
+	size_t lsize = b_off - p->start;
+	size_t lnl = count_nl(piece_text(sh, p), lsize);
+
+	memmove(&sh->pieces[i + 2], &sh->pieces[i + 1],
+	    (sh->npieces - i - 1) * sizeof(sheet_piece_t));
+	sh->npieces++;
+
+	sheet_piece_t *q = &sh->pieces[i + 1];
+	*q = *p;
+	q->off += lsize;
+	q->len -= lsize;
+	q->nl -= lnl;
+	q->start = b_off;
+	q->nl_before = p->nl_before + lnl;
+
+	p->len = lsize;
+	p->nl = lnl;
+
+	return i + 1;
+}
+
+/** Move tags after inserting @a sz bytes at @a b_off. */
+static void sheet_insert_tags(sheet_t *sh, size_t b_off, enum dir_spec dir,
+    size_t sz)
+{
+	list_foreach(sh->tags, link, tag_t, tag) {
+		if (tag->b_off > b_off)
+			tag->b_off += sz;
+		else if (tag->b_off == b_off && dir == dir_before)
+			tag->b_off += sz;
+	}
+}
+
 /** Insert text into sheet.
  *
  * @param sh	Sheet to insert to.
@@ -102,36 +287,46 @@ errno_t sheet_create(sheet_t **rsh)
  */
 errno_t sheet_insert(sheet_t *sh, spt_t *pos, enum dir_spec dir, char *str)
 {
-	char *ipp;
 	size_t sz;
-	char *newp;
+	size_t aoff;
+	size_t i;
 
 	sz = str_size(str);
-	if (sh->text_size + sz > sh->dbuf_size) {
-		/* Enlarge data buffer. */
-		newp = realloc(sh->data, sh->dbuf_size * 2);
-		if (newp == NULL)
-			return ELIMIT;
-
-		sh->data = newp;
-		sh->dbuf_size = sh->dbuf_size * 2;
+	if (sz == 0)
+		return EOK;
+
+	if (sheet_reserve_add(sh, sz) != EOK ||
+	    sheet_reserve_pieces(sh, 2) != EOK)
+		return ELIMIT;
+
+	/* Append the text to the buffer of inserted text. */
+	aoff = sh->add_size;
+	memcpy(sh->add_buf + aoff, str, sz);
+	sh->add_size += sz;
+
+	i = sheet_split(sh, pos->b_off);
+
+	if (i > 0 && sh->pieces[i - 1].add &&
+	    sh->pieces[i - 1].off + sh->pieces[i - 1].len == aoff) {
+		/* Typing just extends the piece that was inserted last. */
+		sh->pieces[i - 1].len += sz;
+		sh->pieces[i - 1].nl += count_nl(str, sz);
+	} else {
+		memmove(&sh->pieces[i + 1], &sh->pieces[i],
+		    (sh->npieces - i) * sizeof(sheet_piece_t));
+		sh->npieces++;
+
+		sh->pieces[i].add = true;
+		sh->pieces[i].off = aoff;
+		sh->pieces[i].len = sz;
+		sh->pieces[i].nl = count_nl(str, sz);
 	}
 
-	ipp = sh->data + pos->b_off;
-
-	/* Copy data. */
-	memmove(ipp + sz, ipp, sh->text_size - pos->b_off);
-	memcpy(ipp, str, sz);
+	sheet_update(sh, i > 0 ? i - 1 : 0);
 	sh->text_size += sz;
 
 	/* Adjust tags. */
-
-	list_foreach(sh->tags, link, tag_t, tag) {
-		if (tag->b_off > pos->b_off)
-			tag->b_off += sz;
-		else if (tag->b_off == pos->b_off && dir == dir_before)
-			tag->b_off += sz;
-	}
+	sheet_insert_tags(sh, pos->b_off, dir, sz);
 
 	return EOK;
 }
@@ -148,15 +343,25 @@ errno_t sheet_insert(sheet_t *sh, spt_t *pos, enum dir_spec dir, char *str)
  */
 errno_t sheet_delete(sheet_t *sh, spt_t *spos, spt_t *epos)
 {
-	char *spp;
 	size_t sz;
-	char *newp;
-	size_t shrink_size;
+	size_t i, j;
 
-	spp = sh->data + spos->b_off;
 	sz = epos->b_off - spos->b_off;
+	if (sz == 0)
+		return EOK;
+
+	if (sheet_reserve_pieces(sh, 2) != EOK)
+		return ELIMIT;
+
+	/* Drop the pieces covering the range. */
+	i = sheet_split(sh, spos->b_off);
+	j = sheet_split(sh, epos->b_off);
 
-	memmove(spp, spp + sz, sh->text_size - (spos->b_off + sz));
+	memmove(&sh->pieces[i], &sh->pieces[j],
+	    (sh->npieces - j) * sizeof(sheet_piece_t));
+	sh->npieces -= j - i;
+
+	sheet_update(sh, i);
 	sh->text_size -= sz;
 
 	/* Adjust tags. */
@@ -167,20 +372,295 @@ errno_t sheet_delete(sheet_t *sh, spt_t *spos, spt_t *epos)
 			tag->b_off = spos->b_off;
 	}
 
-	/* See if we should free up some memory. */
-	shrink_size = max(sh->dbuf_size / 4, INITIAL_SIZE);
-	if (sh->text_size <= shrink_size && sh->dbuf_size > INITIAL_SIZE) {
-		/* Shrink data buffer. */
-		newp = realloc(sh->data, shrink_size);
-		if (newp == NULL) {
-			/* Failed to shrink buffer... no matter. */
-			return EOK;
+	return EOK;
+}
+
+/** Check loaded text.
+ *
+ * The text is cropped before the first NUL character.
+ *
+ * @param text	Text to check.
+ * @param size	Size of the text, updated if the text is cropped.
+ *
+ * @return	@c true if the text is valid UTF-8.
+ */
+static bool sheet_text_valid(const char *text, size_t *size)
+{
+	size_t off = 0;
+
+	while (off < *size) {
+		uint8_t b = (uint8_t) text[off];
+		size_t cbytes;
+
+		if (b == 0) {
+			*size = off;
+			break;
+		}
+
+		if ((b & 0x80) == 0)
+			cbytes = 0;
+		else if ((b & 0xe0) == 0xc0)
+			cbytes = 1;
+		else if ((b & 0xf0) == 0xe0)
+			cbytes = 2;
+		else if ((b & 0xf8) == 0xf0)
+			cbytes = 3;
+		else
+			return false;
+
+		if (off + 1 + cbytes > *size)
+			return false;
+
+		for (size_t k = 1; k <= cbytes; k++) {
+			if (((uint8_t) text[off + k] & 0xc0) != 0x80)
+				return false;
+		}
+
+		off += 1 + cbytes;
+	}
+
+	return true;
+}
+
+/** Insert pieces referring to a run of loaded text.
+ *
+ * The text is cut into pieces of at most PIECE_MAX bytes on character
+ * boundaries.
+ *
+ * @param sh	Sheet.
+ * @param i	Index in the piece table where to insert the pieces.
+ * @param add	Text is stored in the buffer of inserted text.
+ * @param buf	Buffer containing the text.
+ * @param off	Offset of the text in the buffer.
+ * @param size	Size of the text.
+ *
+ * @return	EOK on success or ENOMEM.
+ */
+static errno_t sheet_insert_pieces(sheet_t *sh, size_t i, bool add,
+    const char *buf, size_t off, size_t size)
+{
+	/* Characters are at most four bytes long, cuts never go further. */
+	size_t npieces = size / (PIECE_MAX - 3) + 1;
+
+	if (sheet_reserve_pieces(sh, npieces) != EOK)
+		return ENOMEM;
+
+	const char *text = buf + off;
+	size_t n = 0;
+	size_t cur = 0;
+
+	memmove(&sh->pieces[i + npieces], &sh->pieces[i],
+	    (sh->npieces - i) * sizeof(sheet_piece_t));
+
+	while (cur < size) {
+		size_t end = min(cur + PIECE_MAX, size);
+
+		/* Do not cut a character in two. */
+		while (end < size && ((uint8_t) text[end] & 0xc0) == 0x80)
+			end--;
+
+		sheet_piece_t *p = &sh->pieces[i + n];
+		p->add = add;
+		p->off = off + cur;
+		p->len = end - cur;
+		p->nl = count_nl(text + cur, end - cur);
+
+		cur = end;
+		n++;
+	}
+
+	/* Close the gap left by the estimate. */
+	memmove(&sh->pieces[i + n], &sh->pieces[i + npieces],
+	    (sh->npieces - i) * sizeof(sheet_piece_t));
+	sh->npieces += n;
+
+	return EOK;
+}
+
+/** Read a file into the buffer of inserted text, replacing invalid UTF-8.
+ *
+ * @param sh	Sheet.
+ * @param text	Text of the file.
+ * @param size	Size of the text.
+ * @param rsize	Place to store the size of the converted text.
+ *
+ * @return	EOK on success or ENOMEM.
+ */
+static errno_t sheet_convert_text(sheet_t *sh, const char *text, size_t size,
+    size_t *rsize)
+{
+	size_t off = 0;
+	size_t aoff;
+	wchar_t c;
+
+	/* Invalid sequences become U_SPECIAL, the text never grows. */
+	if (sheet_reserve_add(sh, size) != EOK)
+		return ENOMEM;
+
+	aoff = sh->add_size;
+	while (true) {
+		c = str_decode(text, &off, size);
+		if (c == '\0')
+			break;
+
+		if (chr_encode(c, sh->add_buf, &aoff, sh->add_cap) != EOK)
+			break;
+	}
+
+	*rsize = aoff - sh->add_size;
+	return EOK;
+}
+
+/** Insert contents of a file into sheet.
+ *
+ * The first file inserted into the sheet is mapped into memory, so its
+ * contents are only read when they are needed. The file must not be changed
+ * by anyone else while it is mapped (see sheet_detach_file()). Text which
+ * is not valid UTF-8 is converted and kept in memory like inserted text.
+ * The file is cropped before the first NUL character.
+ *
+ * @param sh	Sheet to insert to.
+ * @param pos	Point where to insert.
+ * @param dir	Whether to insert before or after the point (affects tags).
+ * @param fname	Name of the file.
+ *
+ * @return	EOK on success or an error code.
+ */
+errno_t sheet_insert_file(sheet_t *sh, spt_t *pos, enum dir_spec dir,
+    const char *fname)
+{
+	vfs_stat_t st;
+	size_t size;
+	char *text = NULL;
+	bool mapped = false;
+	int fd;
+	errno_t rc;
+
+	rc = vfs_lookup_open(fname, WALK_REGULAR, MODE_READ, &fd);
+	if (rc != EOK)
+		return rc;
+
+	rc = vfs_stat(fd, &st);
+	if (rc != EOK)
+		goto error;
+
+	if (st.size > SIZE_MAX / 2) {
+		rc = ENOMEM;
+		goto error;
+	}
+
+	size = st.size;
+	if (size == 0) {
+		vfs_put(fd);
+		return EOK;
+	}
+
+	if (sh->file_text == NULL) {
+		text = vfs_map(fd, 0, AS_AREA_ANY, size,
+		    AS_AREA_READ | AS_AREA_CACHEABLE);
+		if (text == AS_MAP_FAILED)
+			text = NULL;
+		else
+			mapped = true;
+	}
+
+	if (text == NULL) {
+		aoff64_t fpos = 0;
+		size_t nread;
+
+		text = malloc(size);
+		if (text == NULL) {
+			rc = ENOMEM;
+			goto error;
 		}
 
-		sh->data = newp;
-		sh->dbuf_size = shrink_size;
+		rc = vfs_read(fd, &fpos, text, size, &nread);
+		if (rc != EOK)
+			goto error;
+
+		size = nread;
+	}
+
+	if (sheet_reserve_pieces(sh, 1) != EOK) {
+		rc = ENOMEM;
+		goto error;
+	}
+
+	size_t i = sheet_split(sh, pos->b_off);
+
+	size_t isize = size;
+	if (sheet_text_valid(text, &isize) && sh->file_text == NULL) {
+		/* Refer to the file text directly. */
+		rc = sheet_insert_pieces(sh, i, false, text, 0, isize);
+		if (rc != EOK)
+			goto error;
+
+		sh->file_text = text;
+		sh->file_size = size;
+		if (mapped)
+			sh->file_fd = fd;
+		else
+			vfs_put(fd);
+	} else {
+		/* Keep a converted copy. */
+		size_t aoff = sh->add_size;
+
+		rc = sheet_convert_text(sh, text, size, &isize);
+		if (rc == EOK)
+			rc = sheet_insert_pieces(sh, i, true, sh->add_buf, aoff,
+			    isize);
+		if (rc != EOK)
+			goto error;
+
+		sh->add_size += isize;
+
+		if (mapped)
+			as_area_destroy(text);
+		else
+			free(text);
+		vfs_put(fd);
 	}
 
+	sheet_update(sh, i);
+	sh->text_size += isize;
+
+	/* Adjust tags. */
+	sheet_insert_tags(sh, pos->b_off, dir, isize);
+
+	return EOK;
+error:
+	if (mapped)
+		as_area_destroy(text);
+	else
+		free(text);
+	vfs_put(fd);
+	return rc;
+}
+
+/** Stop referring to the file the sheet was loaded from.
+ *
+ * A mapped file must not change while the sheet refers to it. Make
+ * a private copy of its text before the file is written to.
+ *
+ * @param sh	Sheet.
+ *
+ * @return	EOK on success or ENOMEM.
+ */
+errno_t sheet_detach_file(sheet_t *sh)
+{
+	if (sh->file_fd < 0)
+		return EOK;
+
+	char *copy = malloc(sh->file_size);
+	if (copy == NULL)
+		return ENOMEM;
+
+	memcpy(copy, sh->file_text, sh->file_size);
+	as_area_destroy((void *) sh->file_text);
+	vfs_put(sh->file_fd);
+
+	sh->file_text = copy;
+	sh->file_fd = -1;
 	return EOK;
 }
 
@@ -188,42 +668,140 @@ errno_t sheet_delete(sheet_t *sh, spt_t *spos, spt_t *epos)
 void sheet_copy_out(sheet_t *sh, spt_t const *spos, spt_t const *epos,
     char *buf, size_t bufsize, spt_t *fpos)
 {
-	char *spp;
 	size_t range_sz;
 	size_t copy_sz;
+	size_t done;
 	size_t off, prev;
+	size_t i;
 	wchar_t c;
 
-	spp = sh->data + spos->b_off;
 	range_sz = epos->b_off - spos->b_off;
 	copy_sz = (range_sz < bufsize - 1) ? range_sz : bufsize - 1;
 
+	/* Gather the text from the pieces. */
+	done = 0;
+	i = sheet_find_piece(sh, spos->b_off);
+	while (done < copy_sz && i < sh->npieces) {
+		sheet_piece_t *p = &sh->pieces[i];
+		size_t poff = spos->b_off + done - p->start;
+		size_t n = min(p->len - poff, copy_sz - done);
+
+		memcpy(buf + done, piece_text(sh, p) + poff, n);
+		done += n;
+		++i;
+	}
+
+	copy_sz = done;
+
 	prev = off = 0;
 	do {
 		prev = off;
-		c = str_decode(spp, &off, copy_sz);
+		c = str_decode(buf, &off, copy_sz);
 	} while (c != '\0');
 
 	/* Crop copy_sz down to the last full character. */
 	copy_sz = prev;
-
-	memcpy(buf, spp, copy_sz);
 	buf[copy_sz] = '\0';
 
 	fpos->b_off = spos->b_off + copy_sz;
 	fpos->sh = sh;
 }
 
+/** Decode the character at @a *b_off and advance past it.
+ *
+ * @param sh	Sheet.
+ * @param pi	Index of a piece not following the one containing @a *b_off,
+ *		updated to the index of the piece containing it.
+ * @param b_off	Position of the character, updated to the next one.
+ *
+ * @return	The character or '\0' at the end of text.
+ */
+static wchar_t sheet_decode(sheet_t *sh, size_t *pi, size_t *b_off)
+{
+	while (*pi < sh->npieces &&
+	    *b_off >= sh->pieces[*pi].start + sh->pieces[*pi].len)
+		++*pi;
+
+	if (*pi >= sh->npieces)
+		return '\0';
+
+	sheet_piece_t *p = &sh->pieces[*pi];
+	size_t off = *b_off - p->start;
+	wchar_t c = str_decode(piece_text(sh, p), &off, p->len);
+	*b_off = p->start + off;
+
+	return c;
+}
+
+/** Find the beginning of a row.
+ *
+ * @param sh	Sheet.
+ * @param row	Row number.
+ * @param b_off	Place to store the position of the first character of the row.
+ *
+ * @return	@c false if the sheet does not have that many rows.
+ */
+static bool sheet_row_start(sheet_t *sh, int row, size_t *b_off)
+{
+	if (row <= 1) {
+		*b_off = 0;
+		return true;
+	}
+
+	/* Number of newlines preceding the row */
+	size_t n = row - 1;
+	if (n > sheet_nl_total(sh))
+		return false;
+
+	/* Find the piece containing the n-th newline. */
+	size_t lo = 0;
+	size_t hi = sh->npieces;
+	while (lo < hi) {
+		size_t mid = (lo + hi) / 2;
+		sheet_piece_t *p = &sh->pieces[mid];
+
+		if (p->nl_before + p->nl < n)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	sheet_piece_t *p = &sh->pieces[lo];
+	const char *text = piece_text(sh, p);
+	size_t k = n - p->nl_before;
+	size_t off;
+
+	for (off = 0; off < p->len; ++off) {
+		if (text[off] == '\n' && --k == 0)
+			break;
+	}
+
+	*b_off = p->start + off + 1;
+	return true;
+}
+
 /** Get point preceding or following character cell. */
 void sheet_get_cell_pt(sheet_t *sh, coord_t const *coord, enum dir_spec dir,
     spt_t *pt)
 {
 	size_t cur_pos, prev_pos;
+	size_t pi;
 	wchar_t c;
 	coord_t cc;
 
-	cc.row = cc.column = 1;
-	cur_pos = prev_pos = 0;
+	pt->sh = sh;
+
+	/* Start at the beginning of the row. */
+	if (!sheet_row_start(sh, coord->row, &cur_pos)) {
+		pt->b_off = sh->text_size;
+		return;
+	}
+
+	prev_pos = (cur_pos > 0) ? cur_pos - 1 : 0;
+	cc.row = max(coord->row, 1);
+	cc.column = 1;
+	pi = sheet_find_piece(sh, cur_pos);
+
 	while (true) {
 		if (prev_pos >= sh->text_size) {
 			/* Cannot advance any further. */
@@ -238,7 +816,7 @@ void sheet_get_cell_pt(sheet_t *sh, coord_t const *coord, enum dir_spec dir,
 
 		prev_pos = cur_pos;
 
-		c = str_decode(sh->data, &cur_pos, sh->text_size);
+		c = sheet_decode(sh, &pi, &cur_pos);
 		if (c == '\n') {
 			++cc.row;
 			cc.column = 1;
@@ -249,7 +827,6 @@ void sheet_get_cell_pt(sheet_t *sh, coord_t const *coord, enum dir_spec dir,
 		}
 	}
 
-	pt->sh = sh;
 	pt->b_off = (dir == dir_before) ? prev_pos : cur_pos;
 }
 
@@ -271,32 +848,38 @@ void sheet_get_row_width(sheet_t *sh, int row, int *length)
 /** Get the number of rows in a sheet. */
 void sheet_get_num_rows(sheet_t *sh, int *rows)
 {
-	int cnt;
-	size_t bo;
-
-	cnt = 1;
-	for (bo = 0; bo < sh->dbuf_size; ++bo) {
-		if (sh->data[bo] == '\n')
-			cnt += 1;
-	}
-
-	*rows = cnt;
+	*rows = sheet_nl_total(sh) + 1;
 }
 
 /** Get the coordinates of an s-point. */
 void spt_get_coord(spt_t const *pos, coord_t *coord)
 {
-	size_t off;
+	size_t off, b_off;
+	size_t pi;
 	coord_t cc;
 	wchar_t c;
 	sheet_t *sh;
 
 	sh = pos->sh;
-	cc.row = cc.column = 1;
+	b_off = min(pos->b_off, sh->text_size);
+
+	/* Count the newlines preceding the point. */
+	pi = sheet_find_piece(sh, b_off);
+	if (pi < sh->npieces) {
+		sheet_piece_t *p = &sh->pieces[pi];
+		cc.row = 1 + p->nl_before +
+		    count_nl(piece_text(sh, p), b_off - p->start);
+	} else {
+		cc.row = 1 + sheet_nl_total(sh);
+	}
+
+	/* Count the cells from the beginning of the row. */
+	(void) sheet_row_start(sh, cc.row, &off);
+	pi = sheet_find_piece(sh, off);
+	cc.column = 1;
 
-	off = 0;
-	while (off < pos->b_off && off < sh->text_size) {
-		c = str_decode(sh->data, &off, sh->text_size);
+	while (off < b_off) {
+		c = sheet_decode(sh, &pi, &off);
 		if (c == '\n') {
 			++cc.row;
 			cc.column = 1;
@@ -319,7 +902,8 @@ bool spt_equal(spt_t const *a, spt_t const *b)
 /** Get a character at spt and return next spt */
 wchar_t spt_next_char(spt_t spt, spt_t *next)
 {
-	wchar_t ch = str_decode(spt.sh->data, &spt.b_off, spt.sh->text_size);
+	size_t pi = sheet_find_piece(spt.sh, spt.b_off);
+	wchar_t ch = sheet_decode(spt.sh, &pi, &spt.b_off);
 	if (next)
 		*next = spt;
 	return ch;
@@ -327,7 +911,17 @@ wchar_t spt_next_char(spt_t spt, spt_t *next)
 
 wchar_t spt_prev_char(spt_t spt, spt_t *prev)
 {
-	wchar_t ch = str_decode_reverse(spt.sh->data, &spt.b_off, spt.sh->text_size);
+	wchar_t ch = '\0';
+
+	if (spt.b_off > 0) {
+		size_t pi = sheet_find_piece(spt.sh, spt.b_off - 1);
+		sheet_piece_t *p = &spt.sh->pieces[pi];
+		size_t off = spt.b_off - p->start;
+
+		ch = str_decode_reverse(piece_text(spt.sh, p), &off, p->len);
+		spt.b_off = p->start + off;
+	}
+
 	if (prev)
 		*prev = spt;
 	return ch;
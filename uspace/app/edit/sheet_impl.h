@@ -38,13 +38,43 @@
 
 #include "sheet.h"
 
+/** Piece of sheet text */
+typedef struct {
+	/** Text is in the buffer of inserted text, not in the file text */
+	bool add;
+	/** Offset of the text in its buffer */
+	size_t off;
+	/** Size of the text in bytes */
+	size_t len;
+	/** Number of newlines in the piece */
+	size_t nl;
+	/** Position of the piece in the sheet */
+	size_t start;
+	/** Number of newlines in the sheet preceding the piece */
+	size_t nl_before;
+} sheet_piece_t;
+
 /** Sheet */
 struct sheet {
 	/* Note: This structure is opaque for the user. */
 
 	size_t text_size;
-	size_t dbuf_size;
-	char *data;
+
+	/** Text of the file the sheet was loaded from */
+	const char *file_text;
+	size_t file_size;
+	/** File descriptor if file text is mapped or -1 */
+	int file_fd;
+
+	/** Buffer of inserted text */
+	char *add_buf;
+	size_t add_size;
+	size_t add_cap;
+
+	/** Piece table */
+	sheet_piece_t *pieces;
+	size_t npieces;
+	size_t pieces_cap;
 
 	list_t tags;
 };
@@ -37,13 +37,31 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+static errno_t gunzip_read(void *arg, void *buf, size_t size,
+    size_t *nread)
+{
+	FILE *f = (FILE *) arg;
+
+	*nread = fread(buf, 1, size, f);
+	if (*nread == 0 && ferror(f))
+		return EIO;
+
+	return EOK;
+}
+
+static errno_t gunzip_write(void *arg, const void *data, size_t size)
+{
+	FILE *wf = (FILE *) arg;
+
+	if (fwrite(data, 1, size, wf) != size)
+		return EIO;
+
+	return EOK;
+}
+
 int main(int argc, char *argv[])
 {
 	errno_t rc;
-	void *data, *ddata;
-	size_t size, dsize;
-	size_t nread, nwr;
-	long len;
 	FILE *f, *wf;
 
 	if (argc != 3) {
@@ -57,58 +75,24 @@ int main(int argc, char *argv[])
 		return 1;
 	}
 
-	if (fseek(f, 0, SEEK_END) < 0) {
-		printf("Error determining size of '%s'\n", argv[1]);
-		fclose(f);
-		return 1;
-	}
-
-	len = ftell(f);
-	if (len < 0) {
-		printf("Error determining size of '%s'\n", argv[1]);
-		fclose(f);
-		return 1;
-	}
-
-	if (fseek(f, 0, SEEK_SET) < 0) {
-		printf ("Error rewinding '%s'\n", argv[1]);
+	wf = fopen(argv[2], "wb");
+	if (wf == NULL) {
+		printf("Error creating file '%s'\n", argv[2]);
 		fclose(f);
 		return 1;
 	}
 
-	data = malloc(len);
-	if (data == NULL) {
-		printf("Error allocating %ld bytes.\n", len);
-		fclose(f);
-		return 1;
-	}
+	rc = gzip_expand_pipe(gunzip_read, f, gunzip_write, wf);
+	fclose(f);
 
-	nread = fread(data, 1, len, f);
-	if (nread != (size_t)len) {
-		printf("Error reading '%s'\n", argv[1]);
-		fclose(f);
+	if (rc == EIO) {
+		printf("Error reading '%s' or writing '%s'\n", argv[1], argv[2]);
+		fclose(wf);
 		return 1;
 	}
 
-	fclose(f);
-
-	size = (size_t) len;
-
-	rc = gzip_expand(data, size, &ddata, &dsize);
 	if (rc != EOK) {
 		printf("Error decompressing data.\n");
-		return 1;
-	}
-
-	wf = fopen(argv[2], "wb");
-	if (wf == NULL) {
-		printf("Error creating file '%s'\n", argv[2]);
-		return 1;
-	}
-
-	nwr = fwrite(ddata, 1, dsize, wf);
-	if (nwr != dsize) {
-		printf("Error writing '%s'\n", argv[2]);
 		fclose(wf);
 		return 1;
 	}
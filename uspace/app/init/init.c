@@ -39,6 +39,8 @@
 #include <vfs/vfs.h>
 #include <stdbool.h>
 #include <errno.h>
+#include <fibril.h>
+#include <fibril_synch.h>
 #include <task.h>
 #include <stdlib.h>
 #include <macros.h>
@@ -47,6 +49,7 @@
 #include <str_error.h>
 #include <config.h>
 #include <io/logctl.h>
+#include <sys/time.h>
 #include "untar.h"
 #include "init.h"
 
@@ -71,6 +74,93 @@
 #define srv_start(path, ...) \
 	srv_startl(path, path, ##__VA_ARGS__, NULL)
 
+/** Maximum number of dependencies of a server in the manifest */
+#define SRV_DEPS_MAX  3
+
+/** Server manifest entry.
+ *
+ * A server is started once all servers it depends on have been started
+ * and signalled readiness (i.e. registered their services and called
+ * task_retval()). Servers with no mutual dependencies start in parallel.
+ */
+typedef struct {
+	/** Server binary */
+	const char *path;
+	/** Optional argument */
+	const char *arg;
+	/** Do not start the server if the root file system has this type */
+	const char *rdfmt_skip;
+	/** Servers that need to be ready first */
+	const char *deps[SRV_DEPS_MAX];
+} srv_manifest_t;
+
+/** Start state of a server from the manifest */
+typedef struct {
+	link_t link;
+	const srv_manifest_t *manifest;
+	/** Server start has completed (successfully or not) */
+	bool done;
+	/** Start result */
+	errno_t rc;
+	/** Time the server was spawned */
+	struct timeval spawned;
+	/** Time the server became ready (or failed) */
+	struct timeval ready;
+} srv_state_t;
+
+/** Servers needed before the location service file system is mounted */
+static const srv_manifest_t srv_manifest_early[] = {
+	{ .path = "/srv/tmpfs", .rdfmt_skip = "tmpfs" },
+	{ .path = "/srv/exfat", .rdfmt_skip = "exfat" },
+	{ .path = "/srv/fat", .rdfmt_skip = "fat" },
+	{ .path = "/srv/cdfs" },
+	{ .path = "/srv/mfs" },
+
+	{ .path = "/srv/klog" },
+	{ .path = "/srv/locfs" },
+	{ .path = "/srv/taskmon" },
+	{ .path = NULL }
+};
+
+/** Remaining servers */
+static const srv_manifest_t srv_manifest_late[] = {
+	{ .path = "/srv/devman" },
+	{ .path = "/srv/s3c24xx_uart" },
+	{ .path = "/srv/s3c24xx_ts" },
+
+	{ .path = "/srv/vbd" },
+	{ .path = "/srv/volsrv", .deps = { "/srv/vbd" } },
+
+	{ .path = "/srv/loopip" },
+	{ .path = "/srv/ethip" },
+	{ .path = "/srv/inetsrv" },
+	{ .path = "/srv/tcp", .deps = { "/srv/inetsrv" } },
+	{ .path = "/srv/udp", .deps = { "/srv/inetsrv" } },
+	{ .path = "/srv/dnsrsrv", .deps = { "/srv/udp" } },
+	{ .path = "/srv/dhcp", .deps = { "/srv/inetsrv", "/srv/udp" } },
+	{ .path = "/srv/nconfsrv", .deps = { "/srv/inetsrv", "/srv/dhcp" } },
+
+	{ .path = "/srv/clipboard" },
+	{ .path = "/srv/remcons", .deps = { "/srv/tcp" } },
+
+	{ .path = "/srv/input", .arg = HID_INPUT },
+	{ .path = "/srv/output", .arg = HID_OUTPUT },
+	{ .path = "/srv/hound" },
+	{ .path = NULL }
+};
+
+/** Time init was started */
+static struct timeval init_start;
+
+/** All servers started from the manifest, in order of readiness */
+static LIST_INITIALIZE(srv_timeline);
+
+/** Protects server start states */
+static FIBRIL_MUTEX_INITIALIZE(srv_lock);
+
+/** Signalled when a server start completes */
+static FIBRIL_CONDVAR_INITIALIZE(srv_cv);
+
 /** Print banner */
 static void info_print(void)
 {
@@ -226,6 +316,176 @@ static errno_t srv_startl(const char *path, ...)
 	return retval == 0 ? EOK : EPARTY;
 }
 
+/** Find start state of a server in a group.
+ *
+ * @param states Start states of the group
+ * @param count  Number of servers in the group
+ * @param path   Server binary
+ *
+ * @return Start state or @c NULL if the server is not part of the group
+ */
+static srv_state_t *srv_state_find(srv_state_t *states, size_t count,
+    const char *path)
+{
+	for (size_t i = 0; i < count; i++) {
+		if (str_cmp(states[i].manifest->path, path) == 0)
+			return &states[i];
+	}
+
+	return NULL;
+}
+
+/** Server start fibril arguments */
+typedef struct {
+	srv_state_t *states;
+	size_t count;
+	srv_state_t *state;
+} srv_start_arg_t;
+
+/** Wait for dependencies of a server and start it.
+ *
+ * @param arg Server start fibril arguments (srv_start_arg_t)
+ * @return EOK
+ */
+static errno_t srv_start_fibril(void *arg)
+{
+	srv_start_arg_t *sarg = (srv_start_arg_t *) arg;
+	srv_state_t *state = sarg->state;
+	const srv_manifest_t *manifest = state->manifest;
+	srv_state_t *dep;
+	errno_t rc;
+
+	fibril_mutex_lock(&srv_lock);
+
+	for (size_t i = 0; i < SRV_DEPS_MAX; i++) {
+		if (manifest->deps[i] == NULL)
+			break;
+
+		/* Dependencies not in the group are taken as satisfied */
+		dep = srv_state_find(sarg->states, sarg->count,
+		    manifest->deps[i]);
+		if (dep == NULL)
+			continue;
+
+		while (!dep->done)
+			fibril_condvar_wait(&srv_cv, &srv_lock);
+
+		if (dep->rc != EOK) {
+			printf("%s: Starting %s although %s failed to start\n",
+			    NAME, manifest->path, manifest->deps[i]);
+		}
+	}
+
+	fibril_mutex_unlock(&srv_lock);
+
+	getuptime(&state->spawned);
+	rc = srv_startl(manifest->path, manifest->path, manifest->arg, NULL);
+
+	fibril_mutex_lock(&srv_lock);
+	getuptime(&state->ready);
+	state->rc = rc;
+	state->done = true;
+	list_append(&state->link, &srv_timeline);
+	fibril_condvar_broadcast(&srv_cv);
+	fibril_mutex_unlock(&srv_lock);
+
+	return EOK;
+}
+
+/** Start a group of servers from the manifest.
+ *
+ * Every server is started by its own fibril as soon as its dependencies
+ * are ready. Returns once all servers of the group have been started.
+ *
+ * @param manifest Manifest entries terminated by an entry with @c NULL path
+ */
+static void srv_start_group(const srv_manifest_t *manifest)
+{
+	srv_state_t *states;
+	srv_start_arg_t *args;
+	size_t count;
+	size_t n;
+	size_t i;
+	fid_t fid;
+
+	count = 0;
+	while (manifest[count].path != NULL)
+		count++;
+
+	states = calloc(count, sizeof(srv_state_t));
+	args = calloc(count, sizeof(srv_start_arg_t));
+	if (states == NULL || args == NULL) {
+		printf("%s: Out of memory, starting servers sequentially\n",
+		    NAME);
+		free(states);
+		free(args);
+
+		for (i = 0; i < count; i++) {
+			if (manifest[i].rdfmt_skip == NULL ||
+			    str_cmp(STRING(RDFMT), manifest[i].rdfmt_skip) != 0)
+				srv_startl(manifest[i].path, manifest[i].path,
+				    manifest[i].arg, NULL);
+		}
+
+		return;
+	}
+
+	/* Leave out servers for the root file system type in use */
+	n = 0;
+	for (i = 0; i < count; i++) {
+		if (manifest[i].rdfmt_skip != NULL &&
+		    str_cmp(STRING(RDFMT), manifest[i].rdfmt_skip) == 0)
+			continue;
+
+		link_initialize(&states[n].link);
+		states[n].manifest = &manifest[i];
+		n++;
+	}
+
+	for (i = 0; i < n; i++) {
+		args[i].states = states;
+		args[i].count = n;
+		args[i].state = &states[i];
+
+		fid = fibril_create(srv_start_fibril, &args[i]);
+		if (fid == 0) {
+			/* Start it from this fibril instead */
+			srv_start_fibril(&args[i]);
+			continue;
+		}
+
+		fibril_add_ready(fid);
+	}
+
+	fibril_mutex_lock(&srv_lock);
+	for (i = 0; i < n; i++) {
+		while (!states[i].done)
+			fibril_condvar_wait(&srv_cv, &srv_lock);
+	}
+	fibril_mutex_unlock(&srv_lock);
+
+	/* Start states stay on the timeline, args are no longer needed */
+	free(args);
+}
+
+/** Print when each server from the manifest was started and ready. */
+static void srv_timeline_print(void)
+{
+	printf("%s: Server startup timeline (ms since init start):\n", NAME);
+
+	list_foreach(srv_timeline, link, srv_state_t, state) {
+		/* Server not present on this platform */
+		if (state->rc == ENOENT)
+			continue;
+
+		printf("%s: %6lld %6lld  %s%s\n", NAME,
+		    (long long) tv_sub_diff(&state->spawned, &init_start) / 1000,
+		    (long long) tv_sub_diff(&state->ready, &init_start) / 1000,
+		    state->manifest->path,
+		    state->rc == EOK ? "" : " (failed)");
+	}
+}
+
 static errno_t console(const char *isvc, const char *osvc)
 {
 	/* Wait for the input service to be ready */
@@ -324,6 +584,7 @@ int main(int argc, char *argv[])
 {
 	errno_t rc;
 
+	getuptime(&init_start);
 	info_print();
 
 	if (!mount_root(STRING(RDFMT))) {
@@ -332,18 +593,7 @@ int main(int argc, char *argv[])
 	}
 
 	/* Make sure file systems are running. */
-	if (str_cmp(STRING(RDFMT), "tmpfs") != 0)
-		srv_start("/srv/tmpfs");
-	if (str_cmp(STRING(RDFMT), "exfat") != 0)
-		srv_start("/srv/exfat");
-	if (str_cmp(STRING(RDFMT), "fat") != 0)
-		srv_start("/srv/fat");
-	srv_start("/srv/cdfs");
-	srv_start("/srv/mfs");
-
-	srv_start("/srv/klog");
-	srv_start("/srv/locfs");
-	srv_start("/srv/taskmon");
+	srv_start_group(srv_manifest_early);
 
 	if (!mount_locfs()) {
 		printf("%s: Exiting\n", NAME);
@@ -352,28 +602,8 @@ int main(int argc, char *argv[])
 
 	mount_tmpfs();
 
-	srv_start("/srv/devman");
-	srv_start("/srv/s3c24xx_uart");
-	srv_start("/srv/s3c24xx_ts");
-
-	srv_start("/srv/vbd");
-	srv_start("/srv/volsrv");
-
-	srv_start("/srv/loopip");
-	srv_start("/srv/ethip");
-	srv_start("/srv/inetsrv");
-	srv_start("/srv/tcp");
-	srv_start("/srv/udp");
-	srv_start("/srv/dnsrsrv");
-	srv_start("/srv/dhcp");
-	srv_start("/srv/nconfsrv");
-
-	srv_start("/srv/clipboard");
-	srv_start("/srv/remcons");
-
-	srv_start("/srv/input", HID_INPUT);
-	srv_start("/srv/output", HID_OUTPUT);
-	srv_start("/srv/hound");
+	srv_start_group(srv_manifest_late);
+	srv_timeline_print();
 
 	if (!config_key_exists("console")) {
 		rc = compositor(HID_INPUT, HID_COMPOSITOR_SERVER);
@@ -0,0 +1,305 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup ktrace
+ * @brief Kernel event tracing
+ * @{
+ */
+/**
+ * @file
+ */
+
+#include <arg_parse.h>
+#include <as.h>
+#include <async.h>
+#include <ddi.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <ktrace.h>
+#include <macros.h>
+#include <qsort.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <str.h>
+#include <str_error.h>
+#include <sysinfo.h>
+
+#define NAME  "ktrace"
+
+/** Interval between two polls of the trace rings in microseconds */
+#define POLL_INTERVAL  50000
+
+/** Default tracing duration in seconds */
+#define DEFAULT_DURATION  5
+
+static const char *event_names[KTRACE_EVENT_COUNT] = {
+	[KTRACE_SCHED_SWITCH] = "switch",
+	[KTRACE_SCHED_WAKEUP] = "wakeup",
+	[KTRACE_SCHED_MIGRATE] = "migrate",
+	[KTRACE_IPC_CALL] = "call",
+	[KTRACE_IPC_ANSWER] = "answer",
+	[KTRACE_IPC_FORWARD] = "forward",
+	[KTRACE_PAGE_FAULT] = "pagefault",
+	[KTRACE_IRQ_ENTRY] = "irq-entry",
+	[KTRACE_IRQ_EXIT] = "irq-exit",
+	[KTRACE_SAMPLE] = "sample"
+};
+
+/** Mapped trace area */
+static uint8_t *area;
+/** Number of CPUs which have a trace ring */
+static size_t cpus;
+/** Next record to read from each ring */
+static uint32_t *next;
+
+/** Records collected during one poll */
+static ktrace_record_t *batch;
+static size_t batch_size;
+static size_t batch_count;
+
+/** Number of records overwritten before they could be read */
+static uint64_t lost;
+
+static void usage(const char *name)
+{
+	printf(
+	    "Usage: %s [-e <event>[,<event>...]] [-t <seconds>]\n"
+	    "\n"
+	    "Options:\n"
+	    "\t-e events\n"
+	    "\t--events=events\n"
+	    "\t\tComma-separated list of events to record (default all):\n"
+	    "\t\tswitch, wakeup, migrate, call, answer, forward,\n"
+	    "\t\tpagefault, irq-entry, irq-exit, sample\n"
+	    "\n"
+	    "\t-t seconds\n"
+	    "\t--time=seconds\n"
+	    "\t\tRecord for the given number of seconds (default %d)\n"
+	    "\n"
+	    "\t-h\n"
+	    "\t--help\n"
+	    "\t\tPrint this usage information\n",
+	    name, DEFAULT_DURATION);
+}
+
+/** Parse a comma-separated list of event names into a mask */
+static errno_t parse_events(char *list, uint32_t *mask)
+{
+	*mask = 0;
+
+	char *state;
+	char *name = str_tok(list, ",", &state);
+	while (name != NULL) {
+		unsigned int i;
+		for (i = 0; i < KTRACE_EVENT_COUNT; i++) {
+			if (str_cmp(name, event_names[i]) == 0)
+				break;
+		}
+
+		if (i == KTRACE_EVENT_COUNT) {
+			fprintf(stderr, "%s: Unknown event '%s'\n", NAME, name);
+			return EINVAL;
+		}
+
+		*mask |= UINT32_C(1) << i;
+		name = str_tok(NULL, ",", &state);
+	}
+
+	return EOK;
+}
+
+/** Collect the new records of one ring into the batch */
+static void collect(size_t cpu)
+{
+	ktrace_ring_t *ring = &((ktrace_ring_t *) area)[cpu];
+	ktrace_record_t *records = (ktrace_record_t *) (area + ring->offset);
+
+	uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+	if (head - next[cpu] > ring->capacity) {
+		lost += head - next[cpu] - ring->capacity;
+		next[cpu] = head - ring->capacity;
+	}
+
+	size_t first = batch_count;
+	for (uint32_t i = next[cpu]; i != head; i++) {
+		batch[batch_count++] =
+		    records[i & (ring->capacity - 1)];
+	}
+
+	/* Drop records which the kernel overwrote while we were copying */
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	uint32_t now = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+
+	size_t valid = first;
+	for (uint32_t i = next[cpu]; i != head; i++) {
+		if (now - i < ring->capacity)
+			batch[valid++] = batch[first + (i - next[cpu])];
+		else
+			lost++;
+	}
+
+	batch_count = valid;
+	next[cpu] = head;
+}
+
+static int record_cmp(const void *a, const void *b)
+{
+	const ktrace_record_t *ra = a;
+	const ktrace_record_t *rb = b;
+
+	if (ra->timestamp < rb->timestamp)
+		return -1;
+	if (ra->timestamp > rb->timestamp)
+		return 1;
+	return 0;
+}
+
+static void print_record(ktrace_record_t *record)
+{
+	const char *name = (record->event < KTRACE_EVENT_COUNT) ?
+	    event_names[record->event] : "?";
+
+	printf("%" PRIu64 " cpu%" PRIu32 " %-9s %#" PRIx64 " %#" PRIx64 "\n",
+	    record->timestamp, record->cpu, name, record->arg[0],
+	    record->arg[1]);
+}
+
+/** Read and print the new records of all rings
+ *
+ * The records of each poll are ordered by timestamp. Timestamps are
+ * cycle counts of the individual CPUs, so the order across CPUs is
+ * only as good as the synchronization of their cycle counters.
+ */
+static void poll_rings(void)
+{
+	batch_count = 0;
+	for (size_t cpu = 0; cpu < cpus; cpu++)
+		collect(cpu);
+
+	qsort(batch, batch_count, sizeof(ktrace_record_t), record_cmp);
+
+	for (size_t i = 0; i < batch_count; i++)
+		print_record(&batch[i]);
+}
+
+int main(int argc, char *argv[])
+{
+	uint32_t mask = KTRACE_ALL;
+	int duration = DEFAULT_DURATION;
+
+	for (int i = 1; i < argc; i++) {
+		int off;
+
+		if ((off = arg_parse_short_long(argv[i], "-h", "--help")) != -1) {
+			usage(argv[0]);
+			return 0;
+		}
+
+		if ((off = arg_parse_short_long(argv[i], "-e", "--events=")) != -1) {
+			char *list;
+			errno_t rc = arg_parse_string(argc, argv, &i, &list, off);
+			if ((rc != EOK) || (parse_events(list, &mask) != EOK)) {
+				usage(argv[0]);
+				return 1;
+			}
+			continue;
+		}
+
+		if ((off = arg_parse_short_long(argv[i], "-t", "--time=")) != -1) {
+			errno_t rc = arg_parse_int(argc, argv, &i, &duration, off);
+			if ((rc != EOK) || (duration <= 0)) {
+				printf("%s: Malformed duration '%s'\n", NAME, argv[i]);
+				return 1;
+			}
+			continue;
+		}
+
+		usage(argv[0]);
+		return 1;
+	}
+
+	sysarg_t faddr;
+	sysarg_t pages;
+	sysarg_t count;
+	if ((sysinfo_get_value("ktrace.faddr", &faddr) != EOK) ||
+	    (sysinfo_get_value("ktrace.pages", &pages) != EOK) ||
+	    (sysinfo_get_value("ktrace.cpus", &count) != EOK)) {
+		fprintf(stderr, "%s: Kernel tracing is not available\n", NAME);
+		return 2;
+	}
+
+	errno_t rc = physmem_map(faddr, pages, AS_AREA_READ | AS_AREA_CACHEABLE,
+	    (void *) &area);
+	if (rc != EOK) {
+		fprintf(stderr, "%s: Unable to map trace rings: %s\n", NAME,
+		    str_error(rc));
+		return 2;
+	}
+
+	cpus = count;
+	next = calloc(cpus, sizeof(uint32_t));
+
+	batch_size = 0;
+	for (size_t cpu = 0; cpu < cpus; cpu++)
+		batch_size += ((ktrace_ring_t *) area)[cpu].capacity;
+	batch = calloc(batch_size, sizeof(ktrace_record_t));
+
+	if ((next == NULL) || (batch == NULL)) {
+		fprintf(stderr, "%s: Out of memory\n", NAME);
+		return 2;
+	}
+
+	/* Skip records left over from earlier tracing sessions */
+	for (size_t cpu = 0; cpu < cpus; cpu++)
+		next[cpu] = __atomic_load_n(&((ktrace_ring_t *) area)[cpu].head,
+		    __ATOMIC_ACQUIRE);
+
+	rc = ktrace_enable(mask);
+	if (rc != EOK) {
+		fprintf(stderr, "%s: Unable to enable tracing: %s\n", NAME,
+		    str_error(rc));
+		return 2;
+	}
+
+	for (int t = 0; t < duration * (1000000 / POLL_INTERVAL); t++) {
+		async_usleep(POLL_INTERVAL);
+		poll_rings();
+	}
+
+	ktrace_disable();
+	poll_rings();
+
+	if (lost > 0)
+		printf("%s: %" PRIu64 " records lost\n", NAME, lost);
+
+	return 0;
+}
+
+/** @}
+ */
@@ -895,6 +895,10 @@ int main (int argc, char **argv)
 		return 2;
 	}
 
+	/* The previous contents of the device are not needed any more */
+	(void) block_discard(service_id, 0, min(cfg.volume_count, SIZE_MAX));
+	(void) block_discard_flush(service_id);
+
 	printf("Writing the allocation table.\n");
 
 	/* Initialize the FAT table */
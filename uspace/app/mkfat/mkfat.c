@@ -239,6 +239,10 @@ int main(int argc, char **argv)
 
 	printf(NAME ": Filesystem type FAT%d.\n", cfg.fat_type);
 
+	/* The previous contents of the device are not needed any more */
+	(void) block_discard(service_id, 0, cfg.total_sectors);
+	(void) block_discard_flush(service_id);
+
 	rc = fat_blocks_write(&cfg, service_id);
 	if (rc != EOK) {
 		printf(NAME ": Error writing device.\n");
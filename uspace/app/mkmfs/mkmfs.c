@@ -42,6 +42,7 @@
 #include <errno.h>
 #include <inttypes.h>
 #include <getopt.h>
+#include <macros.h>
 #include <mem.h>
 #include <str.h>
 #include <time.h>
@@ -236,6 +237,13 @@ int main (int argc, char **argv)
 		return 2;
 	}
 
+	/* The previous contents of the device are not needed any more */
+	if (rc == EOK) {
+		(void) block_discard(service_id, 0,
+		    min(sb.dev_nblocks, SIZE_MAX));
+		(void) block_discard_flush(service_id);
+	}
+
 	/* Minimum block size is 1 Kb */
 	sb.dev_nblocks /= 2;
 
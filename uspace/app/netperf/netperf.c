@@ -0,0 +1,277 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup netperf
+ * @{
+ */
+/**
+ * @file Network throughput and latency benchmark.
+ *
+ * The stream modes follow the iperf 2 wire format, so either side can be
+ * replaced by iperf 2: TCP streams are plain data, UDP datagrams carry the
+ * iperf sequence number and timestamp header and the server answers the
+ * final datagram with an iperf server report.
+ */
+
+#include <errno.h>
+#include <inet/host.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <str.h>
+#include <str_error.h>
+
+#include "netperf.h"
+
+#define DEFAULT_PORT      5001
+#define DEFAULT_DURATION  10
+#define DEFAULT_TCP_LEN   (128 * 1024)
+#define DEFAULT_UDP_LEN   1470
+#define DEFAULT_RR_LEN    1
+#define DEFAULT_UDP_RATE  (1000 * 1000)
+#define MAX_STREAMS       128
+#define MAX_LEN           (1024 * 1024)
+
+static void print_syntax(void)
+{
+	printf("Network throughput and latency benchmark\n"
+	    "\n"
+	    "Syntax:\n"
+	    "  " NAME " -s [-u|-r] [-p <port>]\n"
+	    "  " NAME " -c <host> [-u|-r] [-p <port>] [-P <streams>] "
+	    "[-l <len>]\n"
+	    "      [-t <seconds>] [-b <rate>[K|M|G]]\n"
+	    "\n"
+	    "  -s  Run as server\n"
+	    "  -c  Run as client connecting to <host>\n"
+	    "  -u  UDP datagrams (iperf 2 compatible)\n"
+	    "  -r  TCP request/response latency, server echoes requests\n"
+	    "  -p  Port (default %d)\n"
+	    "  -P  Number of parallel streams (default 1)\n"
+	    "  -l  Buffer length, datagram size or request size\n"
+	    "      (default %d, %d or %d bytes)\n"
+	    "  -t  Duration (default %d seconds)\n"
+	    "  -b  UDP rate per stream in bits/s (default 1M)\n",
+	    DEFAULT_PORT, DEFAULT_TCP_LEN, DEFAULT_UDP_LEN, DEFAULT_RR_LEN,
+	    DEFAULT_DURATION);
+}
+
+/** Print count per second with two decimal places. */
+void np_print_rate(uint64_t count, suseconds_t usec, const char *unit)
+{
+	uint64_t centi;
+
+	if (usec <= 0)
+		usec = 1;
+
+	centi = count * 100 * 1000000 / (uint64_t) usec;
+	printf("%" PRIu64 ".%02" PRIu64 " %s", centi / 100, centi % 100, unit);
+}
+
+/** Print stream results in iperf style. */
+void np_report(np_result_t *res)
+{
+	suseconds_t usec = res->usec > 0 ? res->usec : 1;
+	uint64_t mbps;
+
+	if (res->id == 0)
+		printf("[SUM] ");
+	else
+		printf("[%3u] ", res->id);
+
+	printf("0.0-%ld.%01ld sec  %" PRIu64 " KBytes  ",
+	    (long) (usec / 1000000), (long) (usec % 1000000 / 100000),
+	    res->bytes / 1024);
+	/* Bits per microsecond are megabits per second. */
+	mbps = res->bytes * 8 * 100 / (uint64_t) usec;
+	printf("%" PRIu64 ".%02" PRIu64 " Mbits/sec\n", mbps / 100, mbps % 100);
+}
+
+static errno_t parse_uint(const char *str, unsigned int max,
+    unsigned int *rval)
+{
+	const char *endp;
+	uint64_t val;
+
+	if (str_uint64_t(str, &endp, 10, false, &val) != EOK ||
+	    *endp != '\0' || val == 0 || val > max)
+		return EINVAL;
+
+	*rval = val;
+	return EOK;
+}
+
+static errno_t parse_rate(const char *str, uint64_t *rval)
+{
+	const char *endp;
+	uint64_t val;
+
+	if (str_uint64_t(str, &endp, 10, false, &val) != EOK || val == 0)
+		return EINVAL;
+
+	switch (*endp) {
+	case '\0':
+		break;
+	case 'k':
+	case 'K':
+		val *= 1000;
+		++endp;
+		break;
+	case 'm':
+	case 'M':
+		val *= 1000 * 1000;
+		++endp;
+		break;
+	case 'g':
+	case 'G':
+		val *= 1000 * 1000 * 1000;
+		++endp;
+		break;
+	default:
+		return EINVAL;
+	}
+
+	if (*endp != '\0')
+		return EINVAL;
+
+	*rval = val;
+	return EOK;
+}
+
+int main(int argc, char *argv[])
+{
+	np_opts_t opts;
+	const char *host = NULL;
+	const char *errmsg;
+	unsigned int val;
+	bool len_set = false;
+	bool udp = false;
+	bool rr = false;
+	errno_t rc;
+	int i;
+
+	opts.server = false;
+	opts.port = DEFAULT_PORT;
+	opts.streams = 1;
+	opts.duration = DEFAULT_DURATION;
+	opts.rate = DEFAULT_UDP_RATE;
+	opts.len = 0;
+
+	for (i = 1; i < argc; i++) {
+		if (argv[i][0] != '-' || argv[i][1] == '\0' ||
+		    argv[i][2] != '\0')
+			goto syntax;
+
+		switch (argv[i][1]) {
+		case 's':
+			opts.server = true;
+			continue;
+		case 'u':
+			udp = true;
+			continue;
+		case 'r':
+			rr = true;
+			continue;
+		default:
+			break;
+		}
+
+		/* Options with argument */
+		if (i + 1 >= argc)
+			goto syntax;
+
+		switch (argv[i][1]) {
+		case 'c':
+			host = argv[++i];
+			break;
+		case 'p':
+			if (parse_uint(argv[++i], UINT16_MAX, &val) != EOK)
+				goto syntax;
+			opts.port = val;
+			break;
+		case 'P':
+			if (parse_uint(argv[++i], MAX_STREAMS, &val) != EOK)
+				goto syntax;
+			opts.streams = val;
+			break;
+		case 'l':
+			if (parse_uint(argv[++i], MAX_LEN, &val) != EOK)
+				goto syntax;
+			opts.len = val;
+			len_set = true;
+			break;
+		case 't':
+			if (parse_uint(argv[++i], UINT16_MAX, &val) != EOK)
+				goto syntax;
+			opts.duration = val;
+			break;
+		case 'b':
+			if (parse_rate(argv[++i], &opts.rate) != EOK)
+				goto syntax;
+			break;
+		default:
+			goto syntax;
+		}
+	}
+
+	if (opts.server == (host != NULL) || (udp && rr))
+		goto syntax;
+
+	opts.mode = udp ? np_udp_stream : rr ? np_tcp_rr : np_tcp_stream;
+	if (!len_set) {
+		opts.len = udp ? DEFAULT_UDP_LEN : rr ? DEFAULT_RR_LEN :
+		    DEFAULT_TCP_LEN;
+	}
+
+	if (!opts.server) {
+		rc = inet_host_plookup_one(host, ip_any, &opts.addr, NULL,
+		    &errmsg);
+		if (rc != EOK) {
+			printf("%s: %s (host %s).\n", NAME, errmsg, host);
+			return 1;
+		}
+	}
+
+	if (udp)
+		rc = opts.server ? np_udp_server(&opts) : np_udp_client(&opts);
+	else
+		rc = opts.server ? np_tcp_server(&opts) : np_tcp_client(&opts);
+
+	if (rc != EOK) {
+		printf("%s: %s.\n", NAME, str_error(rc));
+		return 1;
+	}
+
+	return 0;
+syntax:
+	print_syntax();
+	return 1;
+}
+
+/** @}
+ */
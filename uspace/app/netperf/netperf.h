@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup netperf
+ * @{
+ */
+/** @file
+ */
+
+#ifndef NETPERF_H
+#define NETPERF_H
+
+#include <errno.h>
+#include <inet/addr.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/time.h>
+
+#define NAME  "netperf"
+
+/** Test mode */
+typedef enum {
+	/** TCP bulk transfer */
+	np_tcp_stream,
+	/** UDP datagrams at a given rate */
+	np_udp_stream,
+	/** TCP request/response */
+	np_tcp_rr
+} np_mode_t;
+
+/** Options */
+typedef struct {
+	/** Run as server */
+	bool server;
+	/** Server address (client only) */
+	inet_addr_t addr;
+	/** Port */
+	uint16_t port;
+	/** Test mode */
+	np_mode_t mode;
+	/** Number of parallel streams (client only) */
+	unsigned int streams;
+	/** Buffer (TCP) or datagram (UDP) length, request size for RR */
+	size_t len;
+	/** Test duration in seconds (client only) */
+	unsigned int duration;
+	/** UDP target rate in bits per second per stream */
+	uint64_t rate;
+} np_opts_t;
+
+/** Stream results */
+typedef struct {
+	/** Stream ID */
+	unsigned int id;
+	/** Bytes transferred */
+	uint64_t bytes;
+	/** Duration in microseconds */
+	suseconds_t usec;
+} np_result_t;
+
+extern void np_print_rate(uint64_t, suseconds_t, const char *);
+extern void np_report(np_result_t *);
+
+extern errno_t np_tcp_client(np_opts_t *);
+extern errno_t np_tcp_server(np_opts_t *);
+extern errno_t np_udp_client(np_opts_t *);
+extern errno_t np_udp_server(np_opts_t *);
+
+#endif
+
+/** @}
+ */
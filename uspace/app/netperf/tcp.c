@@ -0,0 +1,446 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup netperf
+ * @{
+ */
+/**
+ * @file TCP stream and request/response tests.
+ */
+
+#include <async.h>
+#include <errno.h>
+#include <fibril.h>
+#include <fibril_synch.h>
+#include <inet/endpoint.h>
+#include <inet/tcp.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <str_error.h>
+
+#include "netperf.h"
+
+/** Receive buffer size of the server */
+#define NP_TCP_SRV_BUF  (64 * 1024)
+
+/** Client stream */
+typedef struct {
+	np_opts_t *opts;
+	tcp_t *tcp;
+	np_result_t res;
+	/** Request/response latencies in microseconds */
+	suseconds_t *lat;
+	/** Number of latencies */
+	size_t nlat;
+	/** Allocated size of @c lat */
+	size_t lat_size;
+	errno_t rc;
+} np_tcp_stream_t;
+
+static FIBRIL_MUTEX_INITIALIZE(np_tcp_lock);
+static FIBRIL_CONDVAR_INITIALIZE(np_tcp_cv);
+static unsigned int np_tcp_running;
+
+/** Server options */
+static np_opts_t *np_tcp_srv_opts;
+/** Server connection counter */
+static unsigned int np_tcp_srv_conns;
+
+static void np_tcp_new_conn(tcp_listener_t *, tcp_conn_t *);
+
+static tcp_listen_cb_t np_tcp_listen_cb = {
+	.new_conn = np_tcp_new_conn
+};
+
+static tcp_cb_t np_tcp_conn_cb = {
+	.connected = NULL
+};
+
+/** Record request/response latency. */
+static errno_t np_tcp_lat_add(np_tcp_stream_t *st, suseconds_t usec)
+{
+	suseconds_t *nlat;
+	size_t nsize;
+
+	if (st->nlat >= st->lat_size) {
+		nsize = st->lat_size > 0 ? 2 * st->lat_size : 1024;
+		nlat = realloc(st->lat, nsize * sizeof(suseconds_t));
+		if (nlat == NULL)
+			return ENOMEM;
+
+		st->lat = nlat;
+		st->lat_size = nsize;
+	}
+
+	st->lat[st->nlat++] = usec;
+	return EOK;
+}
+
+/** Send one request and wait for the echoed response. */
+static errno_t np_tcp_transact(np_tcp_stream_t *st, tcp_conn_t *conn,
+    char *buf)
+{
+	size_t len = st->opts->len;
+	size_t got = 0;
+	size_t nrecv;
+	errno_t rc;
+
+	rc = tcp_conn_send(conn, buf, len);
+	if (rc != EOK)
+		return rc;
+
+	while (got < len) {
+		rc = tcp_conn_recv_wait(conn, buf + got, len - got, &nrecv);
+		if (rc != EOK)
+			return rc;
+		if (nrecv == 0)
+			return ECONNABORTED;
+		got += nrecv;
+	}
+
+	return EOK;
+}
+
+static errno_t np_tcp_client_fibril(void *arg)
+{
+	np_tcp_stream_t *st = (np_tcp_stream_t *) arg;
+	np_opts_t *opts = st->opts;
+	suseconds_t duration = (suseconds_t) opts->duration * 1000000;
+	tcp_conn_t *conn = NULL;
+	struct timeval start;
+	struct timeval t0;
+	struct timeval now;
+	inet_ep2_t epp;
+	size_t nrecv;
+	char *buf;
+	errno_t rc;
+
+	buf = calloc(1, opts->len);
+	if (buf == NULL) {
+		rc = ENOMEM;
+		goto out;
+	}
+
+	inet_ep2_init(&epp);
+	epp.remote.addr = opts->addr;
+	epp.remote.port = opts->port;
+
+	rc = tcp_conn_create(st->tcp, &epp, &np_tcp_conn_cb, NULL, &conn);
+	if (rc != EOK)
+		goto out;
+
+	rc = tcp_conn_wait_connected(conn);
+	if (rc != EOK)
+		goto out;
+
+	if (opts->mode == np_tcp_rr) {
+		rc = tcp_conn_set_nodelay(conn, true);
+		if (rc != EOK)
+			goto out;
+	}
+
+	getuptime(&start);
+	now = start;
+
+	while (tv_sub_diff(&now, &start) < duration) {
+		if (opts->mode == np_tcp_rr) {
+			getuptime(&t0);
+			rc = np_tcp_transact(st, conn, buf);
+			getuptime(&now);
+			if (rc == EOK)
+				rc = np_tcp_lat_add(st, tv_sub_diff(&now, &t0));
+		} else {
+			rc = tcp_conn_send(conn, buf, opts->len);
+			getuptime(&now);
+		}
+
+		if (rc != EOK)
+			goto out;
+
+		st->res.bytes += opts->len;
+	}
+
+	rc = tcp_conn_send_fin(conn);
+	if (rc != EOK)
+		goto out;
+
+	/* The server closes its side once it has received all data. */
+	do {
+		rc = tcp_conn_recv_wait(conn, buf, opts->len, &nrecv);
+	} while (rc == EOK && nrecv > 0);
+
+	getuptime(&now);
+	st->res.usec = tv_sub_diff(&now, &start);
+out:
+	st->rc = rc;
+	tcp_conn_destroy(conn);
+	free(buf);
+
+	fibril_mutex_lock(&np_tcp_lock);
+	--np_tcp_running;
+	fibril_condvar_broadcast(&np_tcp_cv);
+	fibril_mutex_unlock(&np_tcp_lock);
+	return EOK;
+}
+
+static int np_lat_cmp(const void *a, const void *b)
+{
+	suseconds_t va = *(const suseconds_t *) a;
+	suseconds_t vb = *(const suseconds_t *) b;
+
+	return (va > vb) - (va < vb);
+}
+
+/** Nearest-rank percentile of sorted latencies. */
+static suseconds_t np_lat_pct(suseconds_t *lat, size_t n, unsigned int pct)
+{
+	size_t rank = (pct * n + 99) / 100;
+
+	return lat[rank > 0 ? rank - 1 : 0];
+}
+
+/** Print request/response results. */
+static void np_tcp_rr_report(unsigned int id, suseconds_t *lat, size_t n,
+    suseconds_t usec)
+{
+	if (id == 0)
+		printf("[SUM] ");
+	else
+		printf("[%3u] ", id);
+
+	printf("%zu transactions  ", n);
+	np_print_rate(n, usec, "trans/sec");
+
+	if (n > 0) {
+		qsort(lat, n, sizeof(suseconds_t), np_lat_cmp);
+		printf("  latency us min/p50/p90/p99/max %ld/%ld/%ld/%ld/%ld",
+		    (long) lat[0], (long) np_lat_pct(lat, n, 50),
+		    (long) np_lat_pct(lat, n, 90), (long) np_lat_pct(lat, n, 99),
+		    (long) lat[n - 1]);
+	}
+
+	printf("\n");
+}
+
+/** Print summary of all request/response streams. */
+static void np_tcp_rr_summary(np_tcp_stream_t *streams, unsigned int n,
+    suseconds_t usec)
+{
+	suseconds_t *lat;
+	size_t total = 0;
+	size_t pos = 0;
+
+	for (unsigned int i = 0; i < n; i++)
+		total += streams[i].nlat;
+
+	lat = calloc(total > 0 ? total : 1, sizeof(suseconds_t));
+	if (lat == NULL)
+		return;
+
+	for (unsigned int i = 0; i < n; i++) {
+		for (size_t j = 0; j < streams[i].nlat; j++)
+			lat[pos++] = streams[i].lat[j];
+	}
+
+	np_tcp_rr_report(0, lat, total, usec);
+	free(lat);
+}
+
+/** Run TCP client. */
+errno_t np_tcp_client(np_opts_t *opts)
+{
+	np_tcp_stream_t *streams;
+	np_result_t sum;
+	tcp_t *tcp;
+	fid_t fid;
+	errno_t rc = EOK;
+	unsigned int i;
+
+	rc = tcp_create(&tcp);
+	if (rc != EOK)
+		return rc;
+
+	streams = calloc(opts->streams, sizeof(np_tcp_stream_t));
+	if (streams == NULL) {
+		tcp_destroy(tcp);
+		return ENOMEM;
+	}
+
+	printf("%s: TCP %s, %u stream(s), %zu byte buffer, %u seconds\n",
+	    NAME, opts->mode == np_tcp_rr ? "request/response" : "stream",
+	    opts->streams, opts->len, opts->duration);
+
+	fibril_mutex_lock(&np_tcp_lock);
+	for (i = 0; i < opts->streams; i++) {
+		streams[i].opts = opts;
+		streams[i].tcp = tcp;
+		streams[i].res.id = i + 1;
+
+		fid = fibril_create(np_tcp_client_fibril, &streams[i]);
+		if (fid == 0) {
+			rc = ENOMEM;
+			break;
+		}
+
+		++np_tcp_running;
+		fibril_add_ready(fid);
+	}
+
+	while (np_tcp_running > 0)
+		fibril_condvar_wait(&np_tcp_cv, &np_tcp_lock);
+	fibril_mutex_unlock(&np_tcp_lock);
+
+	sum.id = 0;
+	sum.bytes = 0;
+	sum.usec = 0;
+
+	for (unsigned int j = 0; j < i; j++) {
+		if (streams[j].rc != EOK) {
+			printf("[%3u] failed: %s\n", streams[j].res.id,
+			    str_error(streams[j].rc));
+			rc = streams[j].rc;
+			continue;
+		}
+
+		if (opts->mode == np_tcp_rr) {
+			np_tcp_rr_report(streams[j].res.id, streams[j].lat,
+			    streams[j].nlat, streams[j].res.usec);
+		} else {
+			np_report(&streams[j].res);
+		}
+
+		sum.bytes += streams[j].res.bytes;
+		if (streams[j].res.usec > sum.usec)
+			sum.usec = streams[j].res.usec;
+	}
+
+	if (i > 1) {
+		if (opts->mode == np_tcp_rr)
+			np_tcp_rr_summary(streams, i, sum.usec);
+		else
+			np_report(&sum);
+	}
+
+	for (unsigned int j = 0; j < i; j++)
+		free(streams[j].lat);
+	free(streams);
+	tcp_destroy(tcp);
+	return rc;
+}
+
+/** Serve one connection: count received data or echo requests. */
+static void np_tcp_new_conn(tcp_listener_t *lst, tcp_conn_t *conn)
+{
+	np_opts_t *opts = np_tcp_srv_opts;
+	bool echo = opts->mode == np_tcp_rr;
+	np_result_t res;
+	struct timeval start;
+	struct timeval now;
+	size_t nrecv;
+	char *buf;
+	errno_t rc;
+
+	buf = malloc(NP_TCP_SRV_BUF);
+	if (buf == NULL) {
+		tcp_conn_reset(conn);
+		return;
+	}
+
+	res.id = ++np_tcp_srv_conns;
+	res.bytes = 0;
+
+	if (echo)
+		(void) tcp_conn_set_nodelay(conn, true);
+
+	getuptime(&start);
+
+	while (true) {
+		rc = tcp_conn_recv_wait(conn, buf, NP_TCP_SRV_BUF, &nrecv);
+		if (rc != EOK || nrecv == 0)
+			break;
+
+		res.bytes += nrecv;
+
+		if (echo) {
+			rc = tcp_conn_send(conn, buf, nrecv);
+			if (rc != EOK)
+				break;
+		}
+	}
+
+	getuptime(&now);
+	res.usec = tv_sub_diff(&now, &start);
+
+	if (rc != EOK) {
+		printf("[%3u] connection failed: %s\n", res.id, str_error(rc));
+		tcp_conn_reset(conn);
+	} else {
+		(void) tcp_conn_send_fin(conn);
+		np_report(&res);
+	}
+
+	free(buf);
+}
+
+/** Run TCP server. */
+errno_t np_tcp_server(np_opts_t *opts)
+{
+	tcp_listener_t *lst;
+	inet_ep_t ep;
+	tcp_t *tcp;
+	errno_t rc;
+
+	np_tcp_srv_opts = opts;
+
+	rc = tcp_create(&tcp);
+	if (rc != EOK)
+		return rc;
+
+	inet_ep_init(&ep);
+	ep.port = opts->port;
+
+	rc = tcp_listener_create(tcp, &ep, &np_tcp_listen_cb, NULL,
+	    &np_tcp_conn_cb, NULL, &lst);
+	if (rc != EOK) {
+		tcp_destroy(tcp);
+		return rc;
+	}
+
+	printf("%s: TCP %s server listening on port %" PRIu16 "\n", NAME,
+	    opts->mode == np_tcp_rr ? "request/response" : "stream",
+	    opts->port);
+
+	async_manager();
+
+	/* Not reached */
+	return EOK;
+}
+
+/** @}
+ */
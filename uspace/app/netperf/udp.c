@@ -0,0 +1,544 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup netperf
+ * @{
+ */
+/**
+ * @file UDP stream test.
+ *
+ * Datagrams start with the iperf 2 header (sequence number and send time).
+ * The final datagram of a stream carries a negative sequence number and is
+ * answered by the server with an iperf 2 server report giving received
+ * bytes, loss, reordering and jitter.
+ */
+
+#include <adt/list.h>
+#include <async.h>
+#include <byteorder.h>
+#include <errno.h>
+#include <fibril.h>
+#include <fibril_synch.h>
+#include <inet/endpoint.h>
+#include <inet/udp.h>
+#include <inttypes.h>
+#include <macros.h>
+#include <mem.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <str_error.h>
+
+#include "netperf.h"
+
+/** iperf 2 server report header flag */
+#define NP_HEADER_VERSION1  0x80000000
+
+/** Number of times the final datagram is sent */
+#define NP_UDP_FIN_TRIES    10
+/** Time to wait for server report after each final datagram */
+#define NP_UDP_FIN_USEC     (250 * 1000)
+
+/** iperf 2 datagram header (big endian) */
+typedef struct {
+	uint32_t id;
+	uint32_t tv_sec;
+	uint32_t tv_usec;
+} __attribute__((packed)) np_udp_hdr_t;
+
+/** iperf 2 server report (big endian), follows the datagram header */
+typedef struct {
+	uint32_t flags;
+	uint32_t total_len1;
+	uint32_t total_len2;
+	uint32_t stop_sec;
+	uint32_t stop_usec;
+	uint32_t error_cnt;
+	uint32_t outorder_cnt;
+	uint32_t datagrams;
+	uint32_t jitter1;
+	uint32_t jitter2;
+} __attribute__((packed)) np_udp_report_t;
+
+/** Report datagram */
+typedef struct {
+	np_udp_hdr_t hdr;
+	np_udp_report_t report;
+} __attribute__((packed)) np_udp_report_msg_t;
+
+/** Client stream */
+typedef struct {
+	np_opts_t *opts;
+	udp_t *udp;
+	udp_assoc_t *assoc;
+	inet_ep_t remote;
+	np_result_t res;
+	/** Datagrams sent */
+	uint32_t sent;
+	/** Server report received */
+	bool have_report;
+	np_udp_report_t report;
+	errno_t rc;
+} np_udp_stream_t;
+
+/** Server peer state */
+typedef struct {
+	link_t lpeers;
+	inet_ep_t ep;
+	np_result_t res;
+	struct timeval start;
+	/** Datagrams received */
+	uint32_t count;
+	/** Highest sequence number seen */
+	uint32_t max_id;
+	/** Datagrams received out of order */
+	uint32_t outorder;
+	/** Jitter in microseconds, scaled by 16 */
+	uint64_t jitter16;
+	/** Transit time of previous datagram */
+	int64_t last_transit;
+	/** Stream finished, @c report is valid */
+	bool done;
+	np_udp_report_msg_t report;
+} np_udp_peer_t;
+
+static FIBRIL_MUTEX_INITIALIZE(np_udp_lock);
+static FIBRIL_CONDVAR_INITIALIZE(np_udp_cv);
+static unsigned int np_udp_running;
+
+static LIST_INITIALIZE(np_udp_peers);
+static unsigned int np_udp_srv_conns;
+
+static void np_udp_client_recv_msg(udp_assoc_t *, udp_rmsg_t *);
+static void np_udp_server_recv_msg(udp_assoc_t *, udp_rmsg_t *);
+
+static udp_cb_t np_udp_client_cb = {
+	.recv_msg = np_udp_client_recv_msg
+};
+
+static udp_cb_t np_udp_server_cb = {
+	.recv_msg = np_udp_server_recv_msg
+};
+
+static void np_udp_hdr_encode(np_udp_hdr_t *hdr, int32_t id)
+{
+	struct timeval now;
+
+	gettimeofday(&now, NULL);
+	hdr->id = host2uint32_t_be((uint32_t) id);
+	hdr->tv_sec = host2uint32_t_be(now.tv_sec);
+	hdr->tv_usec = host2uint32_t_be(now.tv_usec);
+}
+
+/** Receive server report. */
+static void np_udp_client_recv_msg(udp_assoc_t *assoc, udp_rmsg_t *rmsg)
+{
+	np_udp_stream_t *st = (np_udp_stream_t *) udp_assoc_userptr(assoc);
+	np_udp_report_msg_t msg;
+
+	if (udp_rmsg_size(rmsg) < sizeof(msg))
+		return;
+	if (udp_rmsg_read(rmsg, 0, &msg, sizeof(msg)) != EOK)
+		return;
+	if ((int32_t) uint32_t_be2host(msg.hdr.id) >= 0)
+		return;
+
+	fibril_mutex_lock(&np_udp_lock);
+	st->report = msg.report;
+	st->have_report = true;
+	fibril_condvar_broadcast(&np_udp_cv);
+	fibril_mutex_unlock(&np_udp_lock);
+}
+
+/** Send datagrams at the configured rate, then the final datagram. */
+static errno_t np_udp_client_fibril(void *arg)
+{
+	np_udp_stream_t *st = (np_udp_stream_t *) arg;
+	np_opts_t *opts = st->opts;
+	suseconds_t duration = (suseconds_t) opts->duration * 1000000;
+	uint64_t interval;
+	struct timeval start;
+	struct timeval now;
+	suseconds_t elapsed;
+	suseconds_t due;
+	char *buf;
+	errno_t rc;
+
+	buf = calloc(1, opts->len);
+	if (buf == NULL) {
+		rc = ENOMEM;
+		goto out;
+	}
+
+	/* Microseconds between datagrams, scaled by 1024 */
+	interval = (uint64_t) opts->len * 8 * 1000000 * 1024 / opts->rate;
+
+	getuptime(&start);
+
+	while (true) {
+		getuptime(&now);
+		elapsed = tv_sub_diff(&now, &start);
+		if (elapsed >= duration)
+			break;
+
+		due = (suseconds_t) (st->sent * interval / 1024);
+		if (due > elapsed + 1000) {
+			/* Ahead of schedule */
+			async_usleep(due - elapsed);
+			continue;
+		}
+
+		np_udp_hdr_encode((np_udp_hdr_t *) buf, st->sent);
+		rc = udp_assoc_send_msg(st->assoc, &st->remote, buf, opts->len);
+		if (rc != EOK)
+			goto out;
+
+		++st->sent;
+		st->res.bytes += opts->len;
+	}
+
+	st->res.usec = elapsed;
+
+	/* Send final datagram until the server reports. */
+	rc = EOK;
+	fibril_mutex_lock(&np_udp_lock);
+	for (unsigned int i = 0; i < NP_UDP_FIN_TRIES && !st->have_report;
+	    i++) {
+		np_udp_hdr_encode((np_udp_hdr_t *) buf, -(int32_t) st->sent);
+		rc = udp_assoc_send_msg(st->assoc, &st->remote, buf, opts->len);
+		if (rc != EOK)
+			break;
+
+		(void) fibril_condvar_wait_timeout(&np_udp_cv, &np_udp_lock,
+		    NP_UDP_FIN_USEC);
+	}
+	fibril_mutex_unlock(&np_udp_lock);
+out:
+	st->rc = rc;
+	free(buf);
+
+	fibril_mutex_lock(&np_udp_lock);
+	--np_udp_running;
+	fibril_condvar_broadcast(&np_udp_cv);
+	fibril_mutex_unlock(&np_udp_lock);
+	return EOK;
+}
+
+/** Print client stream results and server report. */
+static void np_udp_client_report(np_udp_stream_t *st)
+{
+	np_udp_report_t *r = &st->report;
+	uint32_t lost;
+	uint32_t total;
+	uint32_t jitter_us;
+
+	np_report(&st->res);
+	printf("[%3u] %" PRIu32 " datagrams  ", st->res.id, st->sent);
+	np_print_rate(st->sent, st->res.usec, "datagrams/sec");
+	printf("\n");
+
+	if (!st->have_report) {
+		printf("[%3u] No server report received\n", st->res.id);
+		return;
+	}
+
+	lost = uint32_t_be2host(r->error_cnt);
+	total = uint32_t_be2host(r->datagrams);
+	jitter_us = uint32_t_be2host(r->jitter1) * 1000000 +
+	    uint32_t_be2host(r->jitter2);
+
+	printf("[%3u] Server report: %" PRIu64 " KBytes  jitter %" PRIu32
+	    ".%03" PRIu32 " ms  %" PRIu32 "/%" PRIu32 " lost  %" PRIu32
+	    " out of order\n", st->res.id,
+	    (((uint64_t) uint32_t_be2host(r->total_len1) << 32) |
+	    uint32_t_be2host(r->total_len2)) / 1024,
+	    jitter_us / 1000, jitter_us % 1000, lost, total,
+	    uint32_t_be2host(r->outorder_cnt));
+}
+
+/** Run UDP client. */
+errno_t np_udp_client(np_opts_t *opts)
+{
+	np_udp_stream_t *streams;
+	np_result_t sum;
+	inet_ep2_t epp;
+	udp_t *udp;
+	fid_t fid;
+	errno_t rc = EOK;
+	unsigned int i;
+
+	if (opts->len < sizeof(np_udp_report_msg_t)) {
+		printf("%s: Datagram length must be at least %zu bytes.\n",
+		    NAME, sizeof(np_udp_report_msg_t));
+		return EINVAL;
+	}
+
+	rc = udp_create(&udp);
+	if (rc != EOK)
+		return rc;
+
+	streams = calloc(opts->streams, sizeof(np_udp_stream_t));
+	if (streams == NULL) {
+		udp_destroy(udp);
+		return ENOMEM;
+	}
+
+	printf("%s: UDP, %u stream(s), %zu byte datagrams, %" PRIu64
+	    " bits/s per stream, %u seconds\n", NAME, opts->streams, opts->len,
+	    opts->rate, opts->duration);
+
+	inet_ep2_init(&epp);
+	epp.remote.addr = opts->addr;
+	epp.remote.port = opts->port;
+
+	for (i = 0; i < opts->streams; i++) {
+		streams[i].opts = opts;
+		streams[i].udp = udp;
+		streams[i].remote = epp.remote;
+		streams[i].res.id = i + 1;
+
+		rc = udp_assoc_create(udp, &epp, &np_udp_client_cb,
+		    &streams[i], &streams[i].assoc);
+		if (rc != EOK)
+			break;
+	}
+
+	unsigned int nassoc = i;
+
+	fibril_mutex_lock(&np_udp_lock);
+	for (i = 0; i < nassoc; i++) {
+		fid = fibril_create(np_udp_client_fibril, &streams[i]);
+		if (fid == 0) {
+			rc = ENOMEM;
+			break;
+		}
+
+		++np_udp_running;
+		fibril_add_ready(fid);
+	}
+
+	while (np_udp_running > 0)
+		fibril_condvar_wait(&np_udp_cv, &np_udp_lock);
+	fibril_mutex_unlock(&np_udp_lock);
+
+	sum.id = 0;
+	sum.bytes = 0;
+	sum.usec = 0;
+
+	for (unsigned int j = 0; j < i; j++) {
+		if (streams[j].rc != EOK) {
+			printf("[%3u] failed: %s\n", streams[j].res.id,
+			    str_error(streams[j].rc));
+			rc = streams[j].rc;
+			continue;
+		}
+
+		np_udp_client_report(&streams[j]);
+		sum.bytes += streams[j].res.bytes;
+		if (streams[j].res.usec > sum.usec)
+			sum.usec = streams[j].res.usec;
+	}
+
+	if (i > 1)
+		np_report(&sum);
+
+	for (unsigned int j = 0; j < nassoc; j++)
+		udp_assoc_destroy(streams[j].assoc);
+	free(streams);
+	udp_destroy(udp);
+	return rc;
+}
+
+static bool np_udp_ep_equal(inet_ep_t *a, inet_ep_t *b)
+{
+	return a->port == b->port && inet_addr_compare(&a->addr, &b->addr);
+}
+
+/** Find or create state for peer. */
+static np_udp_peer_t *np_udp_peer_get(inet_ep_t *ep)
+{
+	np_udp_peer_t *peer;
+
+	list_foreach(np_udp_peers, lpeers, np_udp_peer_t, p) {
+		if (np_udp_ep_equal(&p->ep, ep))
+			return p;
+	}
+
+	peer = calloc(1, sizeof(np_udp_peer_t));
+	if (peer == NULL)
+		return NULL;
+
+	peer->ep = *ep;
+	peer->done = true;
+	list_append(&peer->lpeers, &np_udp_peers);
+	return peer;
+}
+
+/** Finish peer stream and build server report. */
+static void np_udp_peer_finish(np_udp_peer_t *peer, int32_t id)
+{
+	np_udp_report_t *r = &peer->report.report;
+	struct timeval now;
+	uint32_t total;
+	uint32_t lost;
+	uint64_t jitter_us;
+
+	getuptime(&now);
+	peer->res.usec = tv_sub_diff(&now, &peer->start);
+
+	total = (uint32_t) -id;
+	lost = total > peer->count ? total - peer->count : 0;
+	jitter_us = peer->jitter16 / 16;
+
+	np_udp_hdr_encode(&peer->report.hdr, id);
+	r->flags = host2uint32_t_be(NP_HEADER_VERSION1);
+	r->total_len1 = host2uint32_t_be((uint32_t) (peer->res.bytes >> 32));
+	r->total_len2 = host2uint32_t_be((uint32_t) peer->res.bytes);
+	r->stop_sec = host2uint32_t_be(peer->res.usec / 1000000);
+	r->stop_usec = host2uint32_t_be(peer->res.usec % 1000000);
+	r->error_cnt = host2uint32_t_be(lost);
+	r->outorder_cnt = host2uint32_t_be(peer->outorder);
+	r->datagrams = host2uint32_t_be(total);
+	r->jitter1 = host2uint32_t_be(jitter_us / 1000000);
+	r->jitter2 = host2uint32_t_be(jitter_us % 1000000);
+	peer->done = true;
+
+	np_report(&peer->res);
+	printf("[%3u] jitter %" PRIu64 ".%03" PRIu64 " ms  %" PRIu32 "/%"
+	    PRIu32 " lost  %" PRIu32 " out of order  ", peer->res.id,
+	    jitter_us / 1000, jitter_us % 1000, lost, total, peer->outorder);
+	np_print_rate(peer->count, peer->res.usec, "datagrams/sec");
+	printf("\n");
+}
+
+/** Account received datagram. */
+static void np_udp_server_recv_msg(udp_assoc_t *assoc, udp_rmsg_t *rmsg)
+{
+	np_udp_peer_t *peer;
+	np_udp_hdr_t hdr;
+	inet_ep_t ep;
+	struct timeval now;
+	int64_t transit;
+	int64_t d;
+	int32_t id;
+	size_t size;
+
+	size = udp_rmsg_size(rmsg);
+	if (size < sizeof(hdr))
+		return;
+	if (udp_rmsg_read(rmsg, 0, &hdr, sizeof(hdr)) != EOK)
+		return;
+
+	gettimeofday(&now, NULL);
+	udp_rmsg_remote_ep(rmsg, &ep);
+	id = (int32_t) uint32_t_be2host(hdr.id);
+
+	fibril_mutex_lock(&np_udp_lock);
+
+	peer = np_udp_peer_get(&ep);
+	if (peer == NULL) {
+		fibril_mutex_unlock(&np_udp_lock);
+		return;
+	}
+
+	if (peer->done && id >= 0) {
+		/* New stream from this peer */
+		memset(&peer->res, 0, sizeof(peer->res));
+		peer->res.id = ++np_udp_srv_conns;
+		peer->count = 0;
+		peer->max_id = 0;
+		peer->outorder = 0;
+		peer->jitter16 = 0;
+		peer->last_transit = 0;
+		peer->done = false;
+		getuptime(&peer->start);
+	}
+
+	if (id < 0) {
+		if (!peer->done)
+			np_udp_peer_finish(peer, id);
+		(void) udp_assoc_send_msg(assoc, &ep, &peer->report,
+		    sizeof(peer->report));
+		fibril_mutex_unlock(&np_udp_lock);
+		return;
+	}
+
+	/* RFC 3550 interarrival jitter */
+	transit = ((int64_t) now.tv_sec * 1000000 + now.tv_usec) -
+	    ((int64_t) uint32_t_be2host(hdr.tv_sec) * 1000000 +
+	    uint32_t_be2host(hdr.tv_usec));
+	if (peer->count > 0) {
+		d = transit - peer->last_transit;
+		if (d < 0)
+			d = -d;
+		peer->jitter16 += d - ((peer->jitter16 + 8) >> 4);
+	}
+	peer->last_transit = transit;
+
+	if (peer->count > 0 && (uint32_t) id < peer->max_id)
+		++peer->outorder;
+	else
+		peer->max_id = id;
+
+	++peer->count;
+	peer->res.bytes += size;
+
+	fibril_mutex_unlock(&np_udp_lock);
+}
+
+/** Run UDP server. */
+errno_t np_udp_server(np_opts_t *opts)
+{
+	udp_assoc_t *assoc;
+	inet_ep2_t epp;
+	udp_t *udp;
+	errno_t rc;
+
+	rc = udp_create(&udp);
+	if (rc != EOK)
+		return rc;
+
+	inet_ep2_init(&epp);
+	epp.local.port = opts->port;
+
+	rc = udp_assoc_create(udp, &epp, &np_udp_server_cb, NULL, &assoc);
+	if (rc != EOK) {
+		udp_destroy(udp);
+		return rc;
+	}
+
+	printf("%s: UDP server listening on port %" PRIu16 "\n", NAME,
+	    opts->port);
+
+	async_manager();
+
+	/* Not reached */
+	return EOK;
+}
+
+/** @}
+ */
@@ -69,6 +69,7 @@ static void print_syntax(void)
 	printf("\tunicast <block|default|list|promisc> - set unicast receive filtering\n");
 	printf("\tmulticast <block|list|promisc> - set multicast receive filtering\n");
 	printf("\tbroadcast <block|allow> - block or allow incoming broadcast frames\n");
+	printf("\titr <usec> - set minimum interrupt interval (0 to disable throttling)\n");
 }
 
 static async_sess_t *get_nic_by_index(size_t i)
@@ -555,6 +556,44 @@ static errno_t nic_set_rx_broadcast(int i, char *str)
 	return EINVAL;
 }
 
+static errno_t nic_set_itr(int i, char *str)
+{
+	async_sess_t *sess;
+	uint32_t usecs;
+	errno_t rc;
+
+	rc = str_uint32_t(str, NULL, 10, true, &usecs);
+	if (rc != EOK) {
+		printf("Invalid interrupt interval.\n");
+		return EINVAL;
+	}
+
+	sess = get_nic_by_index(i);
+	if (sess == NULL) {
+		printf("Specified NIC doesn't exist or cannot connect to it.\n");
+		return EINVAL;
+	}
+
+	if (usecs == 0) {
+		rc = nic_poll_set_mode(sess, NIC_POLL_IMMEDIATE, NULL);
+	} else {
+		struct timeval period = {
+			.tv_sec = usecs / 1000000,
+			.tv_usec = usecs % 1000000
+		};
+
+		rc = nic_poll_set_mode(sess, NIC_POLL_PERIODIC, &period);
+	}
+
+	if (rc != EOK) {
+		printf("Error setting interrupt interval: %s\n",
+		    str_error(rc));
+		return rc;
+	}
+
+	return EOK;
+}
+
 int main(int argc, char *argv[])
 {
 	errno_t rc;
@@ -593,6 +632,9 @@ int main(int argc, char *argv[])
 		if (!str_cmp(argv[2], "broadcast"))
 			return nic_set_rx_broadcast(index, argv[3]);
 
+		if (!str_cmp(argv[2], "itr"))
+			return nic_set_itr(index, argv[3]);
+
 	} else {
 		printf(NAME ": Invalid argument.\n");
 		print_syntax();
@@ -0,0 +1,486 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup prof
+ * @brief Sampling CPU profiler
+ * @{
+ */
+/**
+ * @file
+ *
+ * The kernel samples the code interrupted by performance counter
+ * overflows into its trace rings. The profiler collects the samples,
+ * attributes them to functions using the kernel symbol table and the
+ * ELF symbol tables of the sampled tasks and prints the hottest
+ * functions.
+ */
+
+#include <adt/list.h>
+#include <arg_parse.h>
+#include <as.h>
+#include <async.h>
+#include <ddi.h>
+#include <elf/elf_symtab.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <ktrace.h>
+#include <qsort.h>
+#include <stats.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <str.h>
+#include <str_error.h>
+#include <sysinfo.h>
+
+#define NAME  "prof"
+
+/** Interval between two polls of the trace rings in microseconds */
+#define POLL_INTERVAL  50000
+
+/** Default profiling duration in seconds */
+#define DEFAULT_DURATION  5
+
+/** Default sampling period in CPU cycles */
+#define DEFAULT_PERIOD  1000000
+
+/** Default number of functions to print */
+#define DEFAULT_TOP  20
+
+/** Task which was sampled */
+typedef struct {
+	link_t link;
+	task_id_t id;
+	char name[TASK_NAME_BUFLEN];
+	/** Symbol table of the task executable, NULL if not found */
+	symtab_t *symtab;
+	bool symtab_loaded;
+} prof_task_t;
+
+/** Samples of one program counter, later of one function */
+typedef struct {
+	/** Sampled task, NULL for the kernel */
+	prof_task_t *task;
+	uintptr_t pc;
+	size_t count;
+	char *function;
+} prof_entry_t;
+
+/** Mapped trace area */
+static uint8_t *area;
+/** Number of CPUs which have a trace ring */
+static size_t cpus;
+/** Next record to read from each ring */
+static uint32_t *next;
+
+/** Sampled tasks */
+static LIST_INITIALIZE(tasks);
+
+/** Collected samples */
+static prof_entry_t *entries;
+static size_t entries_size;
+static size_t entries_count;
+
+/** Number of samples overwritten before they could be read */
+static uint64_t lost;
+
+static void usage(const char *name)
+{
+	printf(
+	    "Usage: %s [-p <cycles>] [-t <seconds>] [-n <count>]\n"
+	    "\n"
+	    "Options:\n"
+	    "\t-p cycles\n"
+	    "\t--period=cycles\n"
+	    "\t\tSample every given number of CPU cycles (default %d)\n"
+	    "\n"
+	    "\t-t seconds\n"
+	    "\t--time=seconds\n"
+	    "\t\tProfile for the given number of seconds (default %d)\n"
+	    "\n"
+	    "\t-n count\n"
+	    "\t--top=count\n"
+	    "\t\tPrint the given number of hottest functions (default %d)\n"
+	    "\n"
+	    "\t-h\n"
+	    "\t--help\n"
+	    "\t\tPrint this usage information\n",
+	    name, DEFAULT_PERIOD, DEFAULT_DURATION, DEFAULT_TOP);
+}
+
+/** Find or create the record of a sampled task
+ *
+ * The name of the task is looked up right away, while the task is
+ * likely to still exist.
+ */
+static prof_task_t *task_get(task_id_t id)
+{
+	list_foreach(tasks, link, prof_task_t, task) {
+		if (task->id == id)
+			return task;
+	}
+
+	prof_task_t *task = calloc(1, sizeof(prof_task_t));
+	if (task == NULL)
+		return NULL;
+
+	task->id = id;
+
+	stats_task_t *stats = stats_get_task(id);
+	if (stats != NULL) {
+		str_cpy(task->name, TASK_NAME_BUFLEN, stats->name);
+		free(stats);
+	}
+
+	list_append(&task->link, &tasks);
+	return task;
+}
+
+/** Load the symbol table of the executable of a task
+ *
+ * The executable is looked for at the same places as by taskdump.
+ */
+static symtab_t *task_symtab(prof_task_t *task)
+{
+	static const char *formats[] = {
+		"/app/%s",
+		"/srv/%s",
+		"/drv/%s/%s"
+	};
+
+	if (task->symtab_loaded)
+		return task->symtab;
+
+	task->symtab_loaded = true;
+	if (task->name[0] == '\0')
+		return NULL;
+
+	for (size_t i = 0; i < sizeof(formats) / sizeof(formats[0]); i++) {
+		char *file_name;
+		if (asprintf(&file_name, formats[i], task->name, task->name) < 0)
+			return NULL;
+
+		errno_t rc = symtab_load(file_name, &task->symtab);
+		free(file_name);
+
+		if (rc == EOK)
+			return task->symtab;
+	}
+
+	task->symtab = NULL;
+	return NULL;
+}
+
+static void sample_add(ktrace_record_t *record)
+{
+	prof_task_t *task = NULL;
+	if (record->arg[1] != 0) {
+		task = task_get(record->arg[1]);
+		if (task == NULL) {
+			lost++;
+			return;
+		}
+	}
+
+	if (entries_count == entries_size) {
+		size_t size = (entries_size == 0) ? 1024 : 2 * entries_size;
+		prof_entry_t *new_entries = realloc(entries,
+		    size * sizeof(prof_entry_t));
+		if (new_entries == NULL) {
+			lost++;
+			return;
+		}
+
+		entries = new_entries;
+		entries_size = size;
+	}
+
+	prof_entry_t *entry = &entries[entries_count++];
+	entry->task = task;
+	entry->pc = record->arg[0];
+	entry->count = 1;
+	entry->function = NULL;
+}
+
+/** Collect the new samples of one ring */
+static void collect(size_t cpu)
+{
+	ktrace_ring_t *ring = &((ktrace_ring_t *) area)[cpu];
+	ktrace_record_t *records = (ktrace_record_t *) (area + ring->offset);
+
+	uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+	if (head - next[cpu] > ring->capacity)
+		next[cpu] = head - ring->capacity;
+
+	for (uint32_t i = next[cpu]; i != head; i++) {
+		ktrace_record_t record = records[i & (ring->capacity - 1)];
+
+		/* Drop the record if the kernel overwrote it while copying */
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		uint32_t now = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+		if (now - i >= ring->capacity) {
+			lost++;
+			continue;
+		}
+
+		if (record.event == KTRACE_SAMPLE)
+			sample_add(&record);
+	}
+
+	next[cpu] = head;
+}
+
+static void poll_rings(void)
+{
+	for (size_t cpu = 0; cpu < cpus; cpu++)
+		collect(cpu);
+}
+
+static task_id_t entry_task_id(const prof_entry_t *entry)
+{
+	return (entry->task != NULL) ? entry->task->id : 0;
+}
+
+static int entry_pc_cmp(const void *a, const void *b)
+{
+	const prof_entry_t *ea = a;
+	const prof_entry_t *eb = b;
+
+	if (entry_task_id(ea) != entry_task_id(eb))
+		return (entry_task_id(ea) < entry_task_id(eb)) ? -1 : 1;
+	if (ea->pc != eb->pc)
+		return (ea->pc < eb->pc) ? -1 : 1;
+	return 0;
+}
+
+static int entry_function_cmp(const void *a, const void *b)
+{
+	const prof_entry_t *ea = a;
+	const prof_entry_t *eb = b;
+
+	if (entry_task_id(ea) != entry_task_id(eb))
+		return (entry_task_id(ea) < entry_task_id(eb)) ? -1 : 1;
+	return str_cmp(ea->function, eb->function);
+}
+
+static int entry_count_cmp(const void *a, const void *b)
+{
+	const prof_entry_t *ea = a;
+	const prof_entry_t *eb = b;
+
+	if (ea->count != eb->count)
+		return (ea->count > eb->count) ? -1 : 1;
+	return 0;
+}
+
+/** Merge adjacent entries which compare equal, summing their counts */
+static void entries_merge(int (*cmp)(const void *, const void *))
+{
+	if (entries_count == 0)
+		return;
+
+	qsort(entries, entries_count, sizeof(prof_entry_t), cmp);
+
+	size_t last = 0;
+	for (size_t i = 1; i < entries_count; i++) {
+		if (cmp(&entries[last], &entries[i]) == 0) {
+			entries[last].count += entries[i].count;
+			free(entries[i].function);
+		} else {
+			entries[++last] = entries[i];
+		}
+	}
+
+	entries_count = last + 1;
+}
+
+/** Name the function containing the program counter of an entry */
+static char *symbolize(prof_entry_t *entry)
+{
+	char *function;
+
+	if (entry->task == NULL) {
+		char name[64];
+		if (ktrace_symbol(entry->pc, name, sizeof(name)) == EOK)
+			return str_dup(name);
+	} else {
+		symtab_t *symtab = task_symtab(entry->task);
+		char *name;
+		size_t offs;
+		if ((symtab != NULL) &&
+		    (symtab_addr_to_name(symtab, entry->pc, &name, &offs) == EOK))
+			return str_dup(name);
+	}
+
+	if (asprintf(&function, "%#" PRIxPTR, entry->pc) < 0)
+		return NULL;
+
+	return function;
+}
+
+static void report(size_t top)
+{
+	size_t total = 0;
+	for (size_t i = 0; i < entries_count; i++)
+		total += entries[i].count;
+
+	printf("%zu samples", total);
+	if (lost > 0)
+		printf(", %" PRIu64 " lost", lost);
+	printf("\n");
+
+	if (total == 0)
+		return;
+
+	/* Symbolize every distinct program counter only once */
+	entries_merge(entry_pc_cmp);
+
+	for (size_t i = 0; i < entries_count; i++) {
+		entries[i].function = symbolize(&entries[i]);
+		if (entries[i].function == NULL) {
+			fprintf(stderr, "%s: Out of memory\n", NAME);
+			return;
+		}
+	}
+
+	entries_merge(entry_function_cmp);
+	qsort(entries, entries_count, sizeof(prof_entry_t), entry_count_cmp);
+
+	printf("\n%8s %7s  %-20s %s\n", "Samples", "Share", "Task", "Function");
+
+	for (size_t i = 0; (i < entries_count) && (i < top); i++) {
+		prof_entry_t *entry = &entries[i];
+		size_t permille = entry->count * 1000 / total;
+
+		const char *task_name = "kernel";
+		if (entry->task != NULL) {
+			task_name = (entry->task->name[0] != '\0') ?
+			    entry->task->name : "?";
+		}
+
+		printf("%8zu %5zu.%zu%%  %-20s %s\n", entry->count,
+		    permille / 10, permille % 10, task_name, entry->function);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	int period = DEFAULT_PERIOD;
+	int duration = DEFAULT_DURATION;
+	int top = DEFAULT_TOP;
+
+	for (int i = 1; i < argc; i++) {
+		int off;
+
+		if ((off = arg_parse_short_long(argv[i], "-h", "--help")) != -1) {
+			usage(argv[0]);
+			return 0;
+		}
+
+		if ((off = arg_parse_short_long(argv[i], "-p", "--period=")) != -1) {
+			errno_t rc = arg_parse_int(argc, argv, &i, &period, off);
+			if ((rc != EOK) || (period <= 0)) {
+				printf("%s: Malformed period '%s'\n", NAME, argv[i]);
+				return 1;
+			}
+			continue;
+		}
+
+		if ((off = arg_parse_short_long(argv[i], "-t", "--time=")) != -1) {
+			errno_t rc = arg_parse_int(argc, argv, &i, &duration, off);
+			if ((rc != EOK) || (duration <= 0)) {
+				printf("%s: Malformed duration '%s'\n", NAME, argv[i]);
+				return 1;
+			}
+			continue;
+		}
+
+		if ((off = arg_parse_short_long(argv[i], "-n", "--top=")) != -1) {
+			errno_t rc = arg_parse_int(argc, argv, &i, &top, off);
+			if ((rc != EOK) || (top <= 0)) {
+				printf("%s: Malformed count '%s'\n", NAME, argv[i]);
+				return 1;
+			}
+			continue;
+		}
+
+		usage(argv[0]);
+		return 1;
+	}
+
+	sysarg_t faddr;
+	sysarg_t pages;
+	sysarg_t count;
+	if ((sysinfo_get_value("ktrace.faddr", &faddr) != EOK) ||
+	    (sysinfo_get_value("ktrace.pages", &pages) != EOK) ||
+	    (sysinfo_get_value("ktrace.cpus", &count) != EOK)) {
+		fprintf(stderr, "%s: Kernel tracing is not available\n", NAME);
+		return 2;
+	}
+
+	errno_t rc = physmem_map(faddr, pages, AS_AREA_READ | AS_AREA_CACHEABLE,
+	    (void *) &area);
+	if (rc != EOK) {
+		fprintf(stderr, "%s: Unable to map trace rings: %s\n", NAME,
+		    str_error(rc));
+		return 2;
+	}
+
+	cpus = count;
+	next = calloc(cpus, sizeof(uint32_t));
+	if (next == NULL) {
+		fprintf(stderr, "%s: Out of memory\n", NAME);
+		return 2;
+	}
+
+	/* Skip records left over from earlier tracing sessions */
+	for (size_t cpu = 0; cpu < cpus; cpu++)
+		next[cpu] = __atomic_load_n(&((ktrace_ring_t *) area)[cpu].head,
+		    __ATOMIC_ACQUIRE);
+
+	rc = ktrace_sample_start(period);
+	if (rc != EOK) {
+		fprintf(stderr, "%s: Unable to start sampling: %s\n", NAME,
+		    str_error(rc));
+		return 2;
+	}
+
+	for (int t = 0; t < duration * (1000000 / POLL_INTERVAL); t++) {
+		async_usleep(POLL_INTERVAL);
+		poll_rings();
+	}
+
+	ktrace_sample_stop();
+	poll_rings();
+
+	report(top);
+	return 0;
+}
+
+/** @}
+ */
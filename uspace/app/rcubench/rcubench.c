@@ -47,6 +47,7 @@
 #include <compiler/barrier.h>
 #include <futex.h>
 #include <str.h>
+#include <atomic.h>
 
 #include <rcu.h>
 
@@ -73,8 +74,8 @@ static void  kernel_futex_bench(bench_t *bench)
 	int val = 0;
 
 	for (size_t i = 0; i < iters; ++i) {
-		__SYSCALL1(SYS_FUTEX_WAKEUP, (sysarg_t) &val);
-		__SYSCALL1(SYS_FUTEX_SLEEP, (sysarg_t) &val);
+		__SYSCALL2(SYS_FUTEX_WAKEUP, (sysarg_t) &val, FUTEX_PRIVATE);
+		__SYSCALL4(SYS_FUTEX_SLEEP, (sysarg_t) &val, 0, FUTEX_PRIVATE, 0);
 	}
 }
 
@@ -104,6 +105,54 @@ static void libc_futex_sema_bench(bench_t *bench)
 	}
 }
 
+static void rcu_sync_bench(bench_t *bench)
+{
+	const size_t iters = bench->iters;
+
+	for (size_t i = 0; i < iters; ++i) {
+		rcu_synchronize();
+	}
+}
+
+static void rcu_sync_exp_bench(bench_t *bench)
+{
+	const size_t iters = bench->iters;
+
+	for (size_t i = 0; i < iters; ++i) {
+		rcu_synchronize_expedite();
+	}
+}
+
+/* Number of rcu_call() callbacks that have not been invoked yet. */
+static atomic_t pending_callbacks = { 0 };
+
+static void rcu_call_bench_cb(rcu_item_t *item)
+{
+	free(item);
+	atomic_dec(&pending_callbacks);
+}
+
+static void rcu_call_bench(bench_t *bench)
+{
+	const size_t iters = bench->iters;
+
+	for (size_t i = 0; i < iters; ++i) {
+		rcu_item_t *item = malloc(sizeof(rcu_item_t));
+		if (item == NULL) {
+			printf("Error: Out of memory.\n");
+			abort();
+		}
+
+		atomic_inc(&pending_callbacks);
+		rcu_call(item, rcu_call_bench_cb);
+	}
+
+	/* Updates are complete only once their callbacks have run. */
+	while (atomic_get(&pending_callbacks) != 0) {
+		async_usleep(1000);
+	}
+}
+
 static void thread_func(void *arg)
 {
 	bench_t *bench = (bench_t *)arg;
@@ -185,10 +234,15 @@ static void print_usage(void)
 	printf("              but for separate variables/futex kernel objects.\n");
 	printf("  lock     .. threads lock/unlock separate futexes.\n");
 	printf("  sema     .. threads down/up separate futexes.\n");
+	printf("  sync     .. threads call rcu_synchronize() in a loop.\n");
+	printf("  sync-exp .. threads call rcu_synchronize_expedite() in a loop.\n");
+	printf("  call     .. threads call rcu_call() in a loop and wait for\n");
+	printf("              the callbacks to complete.\n");
 	printf("eg:\n");
 	printf("  rcubench sys-futex  100000 3\n");
 	printf("  rcubench lock 100000 2 ..runs futex_lock/unlock in a loop\n");
 	printf("  rcubench sema 100000 2 ..runs futex_down/up in a loop\n");
+	printf("  rcubench call 100000 2 ..measures rcu updater throughput\n");
 	printf("Results are stored in %s\n", results_txt);
 }
 
@@ -208,6 +262,12 @@ static bool parse_cmd_line(int argc, char **argv, bench_t *bench,
 		bench->func = libc_futex_lock_bench;
 	} else if (0 == str_cmp(argv[1], "sema")) {
 		bench->func = libc_futex_sema_bench;
+	} else if (0 == str_cmp(argv[1], "sync")) {
+		bench->func = rcu_sync_bench;
+	} else if (0 == str_cmp(argv[1], "sync-exp")) {
+		bench->func = rcu_sync_exp_bench;
+	} else if (0 == str_cmp(argv[1], "call")) {
+		bench->func = rcu_call_bench;
 	} else {
 		*err = "Unknown test name";
 		return false;
@@ -255,7 +315,7 @@ int main(int argc, char **argv)
 
 	open_results();
 
-	print_res("Running '%s' futex bench in '%zu' threads with '%zu' iterations.\n",
+	print_res("Running '%s' bench in '%zu' threads with '%zu' iterations.\n",
 	    bench.name, bench.nthreads, bench.iters);
 
 	struct timeval start, end;
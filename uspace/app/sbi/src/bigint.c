@@ -549,7 +549,7 @@ static void bigint_sub_abs(bigint_t *a, bigint_t *b, bigint_t *dest)
 		da = idx < a->length ? a->digit[idx] : 0;
 		db = idx < b->length ? b->digit[idx] : 0;
 
-		if (da > db + borrow) {
+		if (da >= db + borrow) {
 			tmp = da - db - borrow;
 			borrow = 0;
 		} else {
@@ -576,7 +576,7 @@ static void bigint_sub_abs(bigint_t *a, bigint_t *b, bigint_t *dest)
 			da = 0;
 			db = dest->digit[idx];
 
-			if (da > db + borrow) {
+			if (da >= db + borrow) {
 				tmp = da - db - borrow;
 				borrow = 0;
 			} else {
@@ -89,6 +89,81 @@ static void rdata_var_copy_to(rdata_var_t *src, rdata_var_t *dest);
 static void rdata_address_print(rdata_address_t *address);
 static void rdata_var_print(rdata_var_t *var);
 
+/** Size of a recycled rdata node. Must fit all types using the node cache. */
+#define RDATA_NODE_SIZE 32
+
+/** Maximum number of free nodes kept for reuse */
+#define RDATA_NODE_CACHE_MAX 1024
+
+/** Free rdata node */
+typedef union rdata_node {
+	union rdata_node *next;
+	char data[RDATA_NODE_SIZE];
+} rdata_node_t;
+
+/** Free nodes available for reuse */
+static rdata_node_t *rdata_node_cache;
+/** Number of nodes in rdata_node_cache */
+static size_t rdata_node_cache_len;
+
+static void *rdata_node_alloc(size_t size);
+static void rdata_node_free(void *node);
+
+/** Allocate small rdata node.
+ *
+ * Items, addresses, values, vars and primitive values are created and
+ * destroyed at a very high rate while evaluating expressions. Recycle
+ * them through a free list instead of going to the heap allocator each
+ * time.
+ *
+ * @param size	Size of the node, at most RDATA_NODE_SIZE
+ * @return	New zero-initialized node.
+ */
+static void *rdata_node_alloc(size_t size)
+{
+	rdata_node_t *node;
+	size_t i;
+
+	assert(size <= RDATA_NODE_SIZE);
+
+	node = rdata_node_cache;
+	if (node != NULL) {
+		rdata_node_cache = node->next;
+		--rdata_node_cache_len;
+
+		for (i = 0; i < RDATA_NODE_SIZE; i++)
+			node->data[i] = 0;
+
+		return node;
+	}
+
+	node = calloc(1, sizeof(rdata_node_t));
+	if (node == NULL) {
+		printf("Memory allocation failed.\n");
+		exit(1);
+	}
+
+	return node;
+}
+
+/** Free small rdata node.
+ *
+ * @param node	Node allocated using rdata_node_alloc()
+ */
+static void rdata_node_free(void *node)
+{
+	rdata_node_t *rnode = (rdata_node_t *) node;
+
+	if (rdata_node_cache_len >= RDATA_NODE_CACHE_MAX) {
+		free(rnode);
+		return;
+	}
+
+	rnode->next = rdata_node_cache;
+	rdata_node_cache = rnode;
+	++rdata_node_cache_len;
+}
+
 /** Allocate new data item.
  *
  * @param ic	Item class.
@@ -98,11 +173,7 @@ rdata_item_t *rdata_item_new(item_class_t ic)
 {
 	rdata_item_t *item;
 
-	item = calloc(1, sizeof(rdata_item_t));
-	if (item == NULL) {
-		printf("Memory allocation failed.\n");
-		exit(1);
-	}
+	item = rdata_node_alloc(sizeof(rdata_item_t));
 
 	item->ic = ic;
 	return item;
@@ -116,11 +187,7 @@ rdata_addr_var_t *rdata_addr_var_new(void)
 {
 	rdata_addr_var_t *addr_var;
 
-	addr_var = calloc(1, sizeof(rdata_addr_var_t));
-	if (addr_var == NULL) {
-		printf("Memory allocation failed.\n");
-		exit(1);
-	}
+	addr_var = rdata_node_alloc(sizeof(rdata_addr_var_t));
 
 	return addr_var;
 }
@@ -187,11 +254,7 @@ rdata_address_t *rdata_address_new(address_class_t ac)
 {
 	rdata_address_t *address;
 
-	address = calloc(1, sizeof(rdata_address_t));
-	if (address == NULL) {
-		printf("Memory allocation failed.\n");
-		exit(1);
-	}
+	address = rdata_node_alloc(sizeof(rdata_address_t));
 
 	address->ac = ac;
 	return address;
@@ -205,11 +268,7 @@ rdata_value_t *rdata_value_new(void)
 {
 	rdata_value_t *value;
 
-	value = calloc(1, sizeof(rdata_value_t));
-	if (value == NULL) {
-		printf("Memory allocation failed.\n");
-		exit(1);
-	}
+	value = rdata_node_alloc(sizeof(rdata_value_t));
 
 	return value;
 }
@@ -223,11 +282,7 @@ rdata_var_t *rdata_var_new(var_class_t vc)
 {
 	rdata_var_t *var;
 
-	var = calloc(1, sizeof(rdata_var_t));
-	if (var == NULL) {
-		printf("Memory allocation failed.\n");
-		exit(1);
-	}
+	var = rdata_node_alloc(sizeof(rdata_var_t));
 
 	var->vc = vc;
 	return var;
@@ -333,11 +388,7 @@ rdata_bool_t *rdata_bool_new(void)
 {
 	rdata_bool_t *bool_v;
 
-	bool_v = calloc(1, sizeof(rdata_bool_t));
-	if (bool_v == NULL) {
-		printf("Memory allocation failed.\n");
-		exit(1);
-	}
+	bool_v = rdata_node_alloc(sizeof(rdata_bool_t));
 
 	return bool_v;
 }
@@ -350,11 +401,7 @@ rdata_char_t *rdata_char_new(void)
 {
 	rdata_char_t *char_v;
 
-	char_v = calloc(1, sizeof(rdata_char_t));
-	if (char_v == NULL) {
-		printf("Memory allocation failed.\n");
-		exit(1);
-	}
+	char_v = rdata_node_alloc(sizeof(rdata_char_t));
 
 	return char_v;
 }
@@ -367,11 +414,7 @@ rdata_int_t *rdata_int_new(void)
 {
 	rdata_int_t *int_v;
 
-	int_v = calloc(1, sizeof(rdata_int_t));
-	if (int_v == NULL) {
-		printf("Memory allocation failed.\n");
-		exit(1);
-	}
+	int_v = rdata_node_alloc(sizeof(rdata_int_t));
 
 	return int_v;
 }
@@ -471,7 +514,7 @@ static int rdata_array_get_dim(rdata_array_t *array)
 void rdata_item_delete(rdata_item_t *item)
 {
 	assert(item != NULL);
-	free(item);
+	rdata_node_free(item);
 }
 
 /** Deallocate variable address.
@@ -481,7 +524,7 @@ void rdata_item_delete(rdata_item_t *item)
 void rdata_addr_var_delete(rdata_addr_var_t *addr_var)
 {
 	assert(addr_var != NULL);
-	free(addr_var);
+	rdata_node_free(addr_var);
 }
 
 /** Deallocate property address.
@@ -521,7 +564,7 @@ void rdata_aprop_indexed_delete(rdata_aprop_indexed_t *aprop_indexed)
 void rdata_address_delete(rdata_address_t *address)
 {
 	assert(address != NULL);
-	free(address);
+	rdata_node_free(address);
 }
 
 /** Deallocate value.
@@ -531,7 +574,7 @@ void rdata_address_delete(rdata_address_t *address)
 void rdata_value_delete(rdata_value_t *value)
 {
 	assert(value != NULL);
-	free(value);
+	rdata_node_free(value);
 }
 
 /** Deallocate var node.
@@ -541,7 +584,7 @@ void rdata_value_delete(rdata_value_t *value)
 void rdata_var_delete(rdata_var_t *var)
 {
 	assert(var != NULL);
-	free(var);
+	rdata_node_free(var);
 }
 
 /** Deallocate boolean.
@@ -551,7 +594,7 @@ void rdata_var_delete(rdata_var_t *var)
 void rdata_bool_delete(rdata_bool_t *bool_v)
 {
 	assert(bool_v != NULL);
-	free(bool_v);
+	rdata_node_free(bool_v);
 }
 
 /** Deallocate character.
@@ -561,7 +604,7 @@ void rdata_bool_delete(rdata_bool_t *bool_v)
 void rdata_char_delete(rdata_char_t *char_v)
 {
 	assert(char_v != NULL);
-	free(char_v);
+	rdata_node_free(char_v);
 }
 
 /** Deallocate integer.
@@ -571,7 +614,7 @@ void rdata_char_delete(rdata_char_t *char_v)
 void rdata_int_delete(rdata_int_t *int_v)
 {
 	assert(int_v != NULL);
-	free(int_v);
+	rdata_node_free(int_v);
 }
 
 /** Deallocate string.
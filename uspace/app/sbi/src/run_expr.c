@@ -109,6 +109,8 @@ static void run_access_object_nonstatic(run_t *run, stree_access_t *access,
     rdata_var_t *obj_var, rdata_item_t **res);
 static void run_access_symbol(run_t *run, stree_access_t *access,
     rdata_item_t *arg, rdata_item_t **res);
+static stree_symbol_t *run_access_member(run_t *run, stree_access_t *access,
+    stree_csi_t *csi);
 
 static void run_call(run_t *run, stree_call_t *call, rdata_item_t **res);
 static void run_call_args(run_t *run, list_t *args, list_t *arg_vals);
@@ -263,7 +265,17 @@ static void run_nameref(run_t *run, stree_nameref_t *nameref,
 		csi = NULL;
 	}
 
-	sym = symbol_lookup_in_csi(run->program, csi, nameref->name);
+	/*
+	 * The same name reference is usually evaluated in the same CSI
+	 * over and over, so remember the result of the last lookup.
+	 */
+	if (nameref->ic_sym != NULL && nameref->ic_csi == csi) {
+		sym = nameref->ic_sym;
+	} else {
+		sym = symbol_lookup_in_csi(run->program, csi, nameref->name);
+		nameref->ic_csi = csi;
+		nameref->ic_sym = sym;
+	}
 
 	/* Existence should have been verified in type checking phase. */
 	assert(sym != NULL);
@@ -1733,8 +1745,7 @@ static void run_access_object_static(run_t *run, stree_access_t *access,
 
 	assert(object->static_obj == sn_static);
 
-	member = symbol_search_csi(run->program, object->class_sym->u.csi,
-	    access->member_name);
+	member = run_access_member(run, access, object->class_sym->u.csi);
 
 	/* Member existence should be ensured by static type checking. */
 	assert(member != NULL);
@@ -1854,8 +1865,7 @@ static void run_access_object_nonstatic(run_t *run, stree_access_t *access,
 
 	assert(object->static_obj == sn_nonstatic);
 
-	member = symbol_search_csi(run->program, object->class_sym->u.csi,
-	    access->member_name);
+	member = run_access_member(run, access, object->class_sym->u.csi);
 
 	if (member == NULL) {
 		printf("Error: Object of class '");
@@ -1995,6 +2005,31 @@ static void run_access_symbol(run_t *run, stree_access_t *access,
 	*res = ritem;
 }
 
+/** Look up member of an object's CSI for an access operation.
+ *
+ * Most access operations see objects of the same class every time
+ * they are evaluated. The member found is cached in the access node
+ * together with the class, so that repeated evaluation does not need
+ * to search the CSI and its base classes.
+ *
+ * @param run		Runner object
+ * @param access	Access operation
+ * @param csi		CSI of the object being accessed
+ * @return		Member symbol or @c NULL if there is no such member
+ */
+static stree_symbol_t *run_access_member(run_t *run, stree_access_t *access,
+    stree_csi_t *csi)
+{
+	if (access->ic_member != NULL && access->ic_csi == csi)
+		return access->ic_member;
+
+	access->ic_member = symbol_search_csi(run->program, csi,
+	    access->member_name);
+	access->ic_csi = csi;
+
+	return access->ic_member;
+}
+
 /** Call a function.
  *
  * Call a function and return the result in @a res.
@@ -38,6 +38,8 @@
  */
 
 struct stree_expr;
+struct stree_csi;
+struct stree_symbol;
 
 /** Identifier */
 typedef struct {
@@ -51,6 +53,11 @@ typedef struct {
 	struct stree_expr *expr;
 
 	stree_ident_t *name;
+
+	/** Inline cache: CSI in which @c name was last looked up */
+	struct stree_csi *ic_csi;
+	/** Inline cache: symbol found in @c ic_csi or @c NULL */
+	struct stree_symbol *ic_sym;
 } stree_nameref_t;
 
 /** Boolean literal */
@@ -173,6 +180,11 @@ typedef struct {
 	struct stree_expr *arg;
 	/** Name of member being accessed. */
 	stree_ident_t *member_name;
+
+	/** Inline cache: class of the object last accessed */
+	struct stree_csi *ic_csi;
+	/** Inline cache: member found in @c ic_csi or @c NULL */
+	struct stree_symbol *ic_member;
 } stree_access_t;
 
 /** Function call operation */
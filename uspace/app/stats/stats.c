@@ -140,7 +140,8 @@ static void list_cpus(void)
 		return;
 	}
 
-	printf("[id] [MHz     ] [busy cycles] [idle cycles]\n");
+	printf("[id] [MHz     ] [busy cycles] [idle cycles] "
+	    "[steal attempts] [steals]\n");
 
 	size_t i;
 	for (i = 0; i < count; i++) {
@@ -152,9 +153,11 @@ static void list_cpus(void)
 			order_suffix(cpus[i].busy_cycles, &bcycles, &bsuffix);
 			order_suffix(cpus[i].idle_cycles, &icycles, &isuffix);
 
-			printf("%10" PRIu16 " %12" PRIu64 "%c %12" PRIu64 "%c\n",
+			printf("%10" PRIu16 " %12" PRIu64 "%c %12" PRIu64 "%c "
+			    "%16" PRIu64 " %8" PRIu64 "\n",
 			    cpus[i].frequency_mhz, bcycles, bsuffix,
-			    icycles, isuffix);
+			    icycles, isuffix, cpus[i].steal_attempts,
+			    cpus[i].steal_successes);
 		} else
 			printf("inactive\n");
 	}
@@ -162,6 +165,106 @@ static void list_cpus(void)
 	free(cpus);
 }
 
+static void list_irqs(void)
+{
+	size_t count;
+	stats_irq_t *irqs = stats_get_irqs(&count);
+
+	if (irqs == NULL) {
+		fprintf(stderr, "%s: Unable to get interrupt statistics\n",
+		    NAME);
+		return;
+	}
+
+	printf("[cpu] [inr] [count     ]\n");
+
+	size_t i;
+	for (i = 0; i < count; i++) {
+		printf("%5u %5u %12" PRIu64 "\n", irqs[i].cpu, irqs[i].inr,
+		    irqs[i].count);
+	}
+
+	free(irqs);
+}
+
+static void list_slabs(void)
+{
+	size_t count;
+	stats_slab_t *slabs = stats_get_slabs(&count);
+
+	if (slabs == NULL) {
+		fprintf(stderr, "%s: Unable to get slab cache statistics\n",
+		    NAME);
+		return;
+	}
+
+	printf("[cache name         ] [size  ] [slabs ] [alloc ] [cached]"
+	    " [mag] [hits    ] [misses  ] [contention]\n");
+
+	size_t i;
+	for (i = 0; i < count; i++) {
+		uint64_t hits, misses;
+		char hsuffix, msuffix;
+
+		order_suffix(slabs[i].hits, &hits, &hsuffix);
+		order_suffix(slabs[i].misses, &misses, &msuffix);
+
+		printf("%-21s %8" PRIu64 " %8" PRIu64 " %8" PRIu64 " %8" PRIu64
+		    " %5" PRIu64 " %9" PRIu64 "%c %9" PRIu64 "%c %12" PRIu64 "\n",
+		    slabs[i].name, slabs[i].size, slabs[i].slabs,
+		    slabs[i].allocated, slabs[i].cached, slabs[i].mag_size,
+		    hits, hsuffix, misses, msuffix, slabs[i].contention);
+	}
+
+	free(slabs);
+}
+
+static void list_magazines(void)
+{
+	size_t cpu_count;
+	stats_cpu_t *cpus = stats_get_cpus(&cpu_count);
+
+	if (cpus == NULL) {
+		fprintf(stderr, "%s: Unable to get CPU statistics\n", NAME);
+		return;
+	}
+
+	printf("[cpu] [cache name         ] [hits    ] [misses  ] [contention]\n");
+
+	size_t i;
+	for (i = 0; i < cpu_count; i++) {
+		size_t count;
+		stats_slab_t *slabs = stats_get_slabs_cpu(cpus[i].id, &count);
+
+		if (slabs == NULL) {
+			fprintf(stderr, "%s: Unable to get slab cache statistics "
+			    "of CPU %u\n", NAME, cpus[i].id);
+			continue;
+		}
+
+		size_t j;
+		for (j = 0; j < count; j++) {
+			uint64_t hits, misses;
+			char hsuffix, msuffix;
+
+			/* Caches without magazines */
+			if (slabs[j].mag_size == 0)
+				continue;
+
+			order_suffix(slabs[j].hits, &hits, &hsuffix);
+			order_suffix(slabs[j].misses, &misses, &msuffix);
+
+			printf("%5u %-21s %9" PRIu64 "%c %9" PRIu64 "%c %12" PRIu64
+			    "\n", cpus[i].id, slabs[j].name, hits, hsuffix,
+			    misses, msuffix, slabs[j].contention);
+		}
+
+		free(slabs);
+	}
+
+	free(cpus);
+}
+
 static void print_load(void)
 {
 	size_t count;
@@ -200,7 +303,7 @@ static void print_uptime(void)
 static void usage(const char *name)
 {
 	printf(
-	    "Usage: %s [-t task_id] [-a] [-c] [-l] [-u]\n"
+	    "Usage: %s [-t task_id] [-a] [-c] [-i] [-s] [-m] [-l] [-u]\n"
 	    "\n"
 	    "Options:\n"
 	    "\t-t task_id\n"
@@ -215,6 +318,18 @@ static void usage(const char *name)
 	    "\t--cpus\n"
 	    "\t\tList CPUs\n"
 	    "\n"
+	    "\t-i\n"
+	    "\t--irqs\n"
+	    "\t\tList interrupts handled by each CPU\n"
+	    "\n"
+	    "\t-s\n"
+	    "\t--slabs\n"
+	    "\t\tList kernel slab caches\n"
+	    "\n"
+	    "\t-m\n"
+	    "\t--magazines\n"
+	    "\t\tList slab magazine statistics of each CPU\n"
+	    "\n"
 	    "\t-l\n"
 	    "\t--load\n"
 	    "\t\tPrint system load\n"
@@ -237,6 +352,9 @@ int main(int argc, char *argv[])
 	bool toggle_threads = false;
 	bool toggle_all = false;
 	bool toggle_cpus = false;
+	bool toggle_irqs = false;
+	bool toggle_slabs = false;
+	bool toggle_magazines = false;
 	bool toggle_load = false;
 	bool toggle_uptime = false;
 
@@ -267,6 +385,27 @@ int main(int argc, char *argv[])
 			continue;
 		}
 
+		/* Interrupts */
+		if ((off = arg_parse_short_long(argv[i], "-i", "--irqs")) != -1) {
+			toggle_tasks = false;
+			toggle_irqs = true;
+			continue;
+		}
+
+		/* Slab caches */
+		if ((off = arg_parse_short_long(argv[i], "-s", "--slabs")) != -1) {
+			toggle_tasks = false;
+			toggle_slabs = true;
+			continue;
+		}
+
+		/* Per-CPU slab magazines */
+		if ((off = arg_parse_short_long(argv[i], "-m", "--magazines")) != -1) {
+			toggle_tasks = false;
+			toggle_magazines = true;
+			continue;
+		}
+
 		/* Threads */
 		if ((off = arg_parse_short_long(argv[i], "-t", "--task=")) != -1) {
 			// TODO: Support for 64b range
@@ -308,6 +447,15 @@ int main(int argc, char *argv[])
 	if (toggle_cpus)
 		list_cpus();
 
+	if (toggle_irqs)
+		list_irqs();
+
+	if (toggle_slabs)
+		list_slabs();
+
+	if (toggle_magazines)
+		list_magazines();
+
 	if (toggle_load)
 		print_load();
 
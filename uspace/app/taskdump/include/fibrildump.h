@@ -37,7 +37,7 @@
 #define FIBRILDUMP_H
 
 #include <async.h>
-#include <symtab.h>
+#include <elf/elf_symtab.h>
 
 extern errno_t fibrils_dump(symtab_t *, async_sess_t *sess);
 
@@ -0,0 +1,199 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <byteorder.h>
+#include <sys/time.h>
+#include <pcm/format.h>
+#include "../tester.h"
+
+/** Number of frames in one mixing buffer */
+#define FRAMES    4096
+#define CHANNELS  2
+
+/** Number of streams mixed into the destination buffer */
+#define STREAMS  8
+
+/** Number of buffers mixed for each format pair */
+#define ROUNDS  256
+
+typedef struct {
+	pcm_sample_format_t src;
+	pcm_sample_format_t dst;
+} mix_pair_t;
+
+static const mix_pair_t pairs[] = {
+	{ PCM_SAMPLE_SINT16_LE, PCM_SAMPLE_SINT16_LE },
+	{ PCM_SAMPLE_UINT8, PCM_SAMPLE_SINT16_LE },
+	{ PCM_SAMPLE_SINT16_BE, PCM_SAMPLE_SINT16_LE },
+	{ PCM_SAMPLE_SINT32_LE, PCM_SAMPLE_SINT32_LE },
+	{ PCM_SAMPLE_SINT16_LE, PCM_SAMPLE_SINT32_LE },
+	{ PCM_SAMPLE_FLOAT32, PCM_SAMPLE_FLOAT32 },
+	{ PCM_SAMPLE_SINT16_LE, PCM_SAMPLE_FLOAT32 }
+};
+
+/** Check that mixing signed 16-bit samples saturates. */
+static const char *check_saturation(void)
+{
+	uint16_t dst[4];
+	uint16_t src[4];
+	const int16_t dst_init[4] = { 30000, -30000, 100, 0 };
+	const int16_t src_init[4] = { 30000, -30000, -50, 7 };
+	const int16_t expected[4] = { INT16_MAX, INT16_MIN, 50, 7 };
+
+	pcm_format_t format = {
+		.channels = CHANNELS,
+		.sampling_rate = 44100,
+		.sample_format = PCM_SAMPLE_SINT16_LE
+	};
+
+	for (size_t i = 0; i < 4; i++) {
+		dst[i] = host2uint16_t_le((uint16_t) dst_init[i]);
+		src[i] = host2uint16_t_le((uint16_t) src_init[i]);
+	}
+
+	errno_t rc = pcm_format_mix(dst, src, sizeof(dst), &format);
+	if (rc != EOK)
+		return "Mixing failed";
+
+	for (size_t i = 0; i < 4; i++) {
+		if (uint16_t_le2host(dst[i]) != (uint16_t) expected[i])
+			return "Mixed samples do not saturate";
+	}
+
+	return NULL;
+}
+
+/** Mix STREAMS buffers into one and return the throughput.
+ *
+ * @return Throughput in frames per second of each stream.
+ *
+ */
+static uint64_t bench_pair(const mix_pair_t *pair, void *dst,
+    void *src[STREAMS], errno_t *rc)
+{
+	pcm_format_t sf = {
+		.channels = CHANNELS,
+		.sampling_rate = 44100,
+		.sample_format = pair->src
+	};
+	pcm_format_t df = {
+		.channels = CHANNELS,
+		.sampling_rate = 44100,
+		.sample_format = pair->dst
+	};
+
+	const size_t src_size = FRAMES * pcm_format_frame_size(&sf);
+	const size_t dst_size = FRAMES * pcm_format_frame_size(&df);
+
+	struct timeval start;
+	gettimeofday(&start, NULL);
+
+	for (size_t i = 0; i < ROUNDS; i++) {
+		pcm_format_silence(dst, dst_size, &df);
+
+		for (size_t j = 0; j < STREAMS; j++) {
+			*rc = pcm_format_convert_and_mix(dst, dst_size, src[j],
+			    src_size, &sf, &df);
+			if (*rc != EOK)
+				return 0;
+		}
+	}
+
+	struct timeval end;
+	gettimeofday(&end, NULL);
+
+	uint64_t usec = tv_sub_diff(&end, &start);
+	if (usec == 0)
+		usec = 1;
+
+	return (uint64_t) ROUNDS * FRAMES * 1000000 / usec;
+}
+
+const char *test_mix1(void)
+{
+	const char *err = check_saturation();
+	if (err != NULL)
+		return err;
+
+	/* Large enough for the widest sample format */
+	const size_t size = FRAMES * CHANNELS * sizeof(uint32_t);
+
+	void *dst = malloc(size);
+	void *src[STREAMS];
+	size_t allocated = 0;
+
+	if (dst == NULL)
+		return "Out of memory";
+
+	for (; allocated < STREAMS; allocated++) {
+		src[allocated] = malloc(size);
+		if (src[allocated] == NULL) {
+			err = "Out of memory";
+			goto out;
+		}
+
+		/* Quiet pseudo-random noise, valid in every format */
+		uint8_t *bytes = src[allocated];
+		for (size_t i = 0; i < size; i++)
+			bytes[i] = (i * 131 + allocated * 17) & 0x0f;
+	}
+
+	TPRINTF("%-22s %-22s %12s\n", "source", "destination",
+	    "[frames/s]");
+
+	for (size_t i = 0; i < sizeof(pairs) / sizeof(pairs[0]); i++) {
+		/* Float sources need valid float data */
+		if (pairs[i].src == PCM_SAMPLE_FLOAT32) {
+			for (size_t j = 0; j < STREAMS; j++) {
+				float *samples = src[j];
+				for (size_t k = 0; k < FRAMES * CHANNELS; k++)
+					samples[k] = (float) ((k + j) % 64) / 1024.0f;
+			}
+		}
+
+		errno_t rc;
+		uint64_t rate = bench_pair(&pairs[i], dst, src, &rc);
+		if (rc != EOK) {
+			err = "Mixing failed";
+			goto out;
+		}
+
+		TPRINTF("%-22s %-22s %12" PRIu64 "\n",
+		    pcm_sample_format_str(pairs[i].src),
+		    pcm_sample_format_str(pairs[i].dst), rate);
+	}
+
+out:
+	for (size_t i = 0; i < allocated; i++)
+		free(src[i]);
+	free(dst);
+	return err;
+}
@@ -0,0 +1,209 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <byteorder.h>
+#include <sys/time.h>
+#include <pcm/format.h>
+#include <pcm/resample.h>
+#include "../tester.h"
+
+/** Number of source frames in one buffer */
+#define FRAMES    4096
+#define CHANNELS  2
+
+/** Number of buffers converted for each rate pair */
+#define ROUNDS  64
+
+/** Constant sample value used to check the filter gain */
+#define LEVEL  12000
+
+typedef struct {
+	unsigned src;
+	unsigned dst;
+} rate_pair_t;
+
+static const rate_pair_t pairs[] = {
+	{ 44100, 48000 },
+	{ 48000, 44100 },
+	{ 48000, 96000 },
+	{ 96000, 48000 },
+	{ 22050, 48000 }
+};
+
+static const char *quality_str[] = {
+	[PCM_RESAMPLE_LINEAR] = "linear",
+	[PCM_RESAMPLE_MEDIUM] = "medium",
+	[PCM_RESAMPLE_HIGH] = "high"
+};
+
+/** Convert FRAMES constant frames and check the output.
+ *
+ * The output needs to keep the level once the filter is filled and the
+ * number of output frames needs to follow the rate ratio.
+ *
+ */
+static const char *check_pair(const rate_pair_t *pair,
+    pcm_resample_quality_t quality, uint16_t *src, uint16_t *dst,
+    size_t dst_frames)
+{
+	pcm_format_t sf = {
+		.channels = CHANNELS,
+		.sampling_rate = pair->src,
+		.sample_format = PCM_SAMPLE_SINT16_LE
+	};
+	pcm_format_t df = {
+		.channels = CHANNELS,
+		.sampling_rate = pair->dst,
+		.sample_format = PCM_SAMPLE_SINT16_LE
+	};
+
+	pcm_resampler_t *resampler;
+	if (pcm_resampler_create(&sf, &df, quality, &resampler) != EOK)
+		return "Failed to create resampler";
+
+	for (size_t i = 0; i < FRAMES * CHANNELS; i++)
+		src[i] = host2uint16_t_le(LEVEL);
+
+	const size_t dst_size = dst_frames * pcm_format_frame_size(&df);
+	pcm_format_silence(dst, dst_size, &df);
+
+	size_t used;
+	const size_t mixed = pcm_resampler_mix(resampler, dst, dst_size, src,
+	    FRAMES * pcm_format_frame_size(&sf), &used);
+	pcm_resampler_destroy(resampler);
+
+	if (used != FRAMES * pcm_format_frame_size(&sf))
+		return "Source data not consumed";
+
+	/* The filter holds back at most a few hundred frames */
+	const size_t frames = mixed / pcm_format_frame_size(&df);
+	const size_t expected = (uint64_t) FRAMES * pair->dst / pair->src;
+	if (frames > expected || frames + 256 < expected)
+		return "Unexpected number of output frames";
+
+	for (size_t i = (frames / 4) * CHANNELS; i < frames * CHANNELS; i++) {
+		const int16_t sample = (int16_t) uint16_t_le2host(dst[i]);
+		if (sample < LEVEL - 2 || sample > LEVEL + 2)
+			return "Resampler does not keep the signal level";
+	}
+
+	return NULL;
+}
+
+/** Convert ROUNDS buffers and return the throughput.
+ *
+ * @return Throughput in source frames per second.
+ *
+ */
+static uint64_t bench_pair(const rate_pair_t *pair,
+    pcm_resample_quality_t quality, void *src, void *dst,
+    size_t dst_frames, errno_t *rc)
+{
+	pcm_format_t sf = {
+		.channels = CHANNELS,
+		.sampling_rate = pair->src,
+		.sample_format = PCM_SAMPLE_SINT16_LE
+	};
+	pcm_format_t df = {
+		.channels = CHANNELS,
+		.sampling_rate = pair->dst,
+		.sample_format = PCM_SAMPLE_SINT16_LE
+	};
+
+	pcm_resampler_t *resampler;
+	*rc = pcm_resampler_create(&sf, &df, quality, &resampler);
+	if (*rc != EOK)
+		return 0;
+
+	const size_t src_size = FRAMES * pcm_format_frame_size(&sf);
+	const size_t dst_size = dst_frames * pcm_format_frame_size(&df);
+
+	struct timeval start;
+	gettimeofday(&start, NULL);
+
+	for (size_t i = 0; i < ROUNDS; i++) {
+		size_t used;
+		pcm_resampler_mix(resampler, dst, dst_size, src, src_size,
+		    &used);
+	}
+
+	struct timeval end;
+	gettimeofday(&end, NULL);
+	pcm_resampler_destroy(resampler);
+
+	uint64_t usec = tv_sub_diff(&end, &start);
+	if (usec == 0)
+		usec = 1;
+
+	return (uint64_t) ROUNDS * FRAMES * 1000000 / usec;
+}
+
+const char *test_resample1(void)
+{
+	const char *err = NULL;
+
+	/* Enough for the largest ratio */
+	const size_t dst_frames = FRAMES * 4;
+	uint16_t *src = malloc(FRAMES * CHANNELS * sizeof(uint16_t));
+	uint16_t *dst = malloc(dst_frames * CHANNELS * sizeof(uint16_t));
+	if (src == NULL || dst == NULL) {
+		err = "Out of memory";
+		goto out;
+	}
+
+	TPRINTF("%8s %8s %-8s %12s\n", "source", "dest", "quality",
+	    "[frames/s]");
+
+	for (size_t i = 0; i < sizeof(pairs) / sizeof(pairs[0]); i++) {
+		for (unsigned q = PCM_RESAMPLE_LINEAR; q <= PCM_RESAMPLE_HIGH;
+		    q++) {
+			err = check_pair(&pairs[i], q, src, dst, dst_frames);
+			if (err != NULL)
+				goto out;
+
+			errno_t rc;
+			uint64_t rate = bench_pair(&pairs[i], q, src, dst,
+			    dst_frames, &rc);
+			if (rc != EOK) {
+				err = "Failed to create resampler";
+				goto out;
+			}
+
+			TPRINTF("%8u %8u %-8s %12" PRIu64 "\n", pairs[i].src,
+			    pairs[i].dst, quality_str[q], rate);
+		}
+	}
+
+out:
+	free(src);
+	free(dst);
+	return err;
+}
@@ -32,6 +32,7 @@
 #include <stdlib.h>
 #include <stddef.h>
 #include <math.h>
+#include <vmath.h>
 #include "../tester.h"
 
 #define OPERANDS         10
@@ -349,6 +350,31 @@ const char *test_float2(void)
 		}
 	}
 
+	double vec[OPERANDS];
+	float vecf[OPERANDS];
+
+	for (unsigned int i = 0; i < OPERANDS; i++) {
+		vec[i] = arguments_exp[i];
+		vecf[i] = arguments_exp[i];
+	}
+
+	vexp_f64(vec, OPERANDS);
+	vexp_f32(vecf, OPERANDS);
+
+	for (unsigned int i = 0; i < OPERANDS; i++) {
+		if (!cmp_double(vec[i], results_exp[i])) {
+			TPRINTF("Double precision vector exp failed "
+			    "(%lf != %lf, arg %u)\n", vec[i], results_exp[i], i);
+			fail = true;
+		}
+
+		if (!cmp_float(vecf[i], results_exp[i])) {
+			TPRINTF("Single precision vector exp failed "
+			    "(%f != %lf, arg %u)\n", vecf[i], results_exp[i], i);
+			fail = true;
+		}
+	}
+
 	for (unsigned int i = 0; i < OPERANDS; i++) {
 		double res = fabs(arguments[i]);
 
@@ -489,6 +515,28 @@ const char *test_float2(void)
 		}
 	}
 
+	for (unsigned int i = 0; i < OPERANDS; i++) {
+		vec[i] = arguments_sqrt[i];
+		vecf[i] = arguments_sqrt[i];
+	}
+
+	vsqrt_f64(vec, OPERANDS);
+	vsqrt_f32(vecf, OPERANDS);
+
+	for (unsigned int i = 0; i < OPERANDS; i++) {
+		if (!cmp_double(vec[i], results_sqrt[i])) {
+			TPRINTF("Double precision vector sqrt failed "
+			    "(%lf != %lf, arg %u)\n", vec[i], results_sqrt[i], i);
+			fail = true;
+		}
+
+		if (!cmp_float(vecf[i], results_sqrt[i])) {
+			TPRINTF("Single precision vector sqrt failed "
+			    "(%f != %lf, arg %u)\n", vecf[i], results_sqrt[i], i);
+			fail = true;
+		}
+	}
+
 	for (unsigned int i = 0; i < OPERANDS; i++) {
 		double res = tan(arguments[i]);
 
@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2018 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <atomic.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <malloc.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <thread.h>
+#include "../tester.h"
+
+#define THREADS   4
+#define BLOCKS    64
+#define ROUNDS    2000
+
+static atomic_t threads_running;
+static atomic_t failed;
+
+/** Allocate and free batches of small blocks of varying sizes. */
+static void worker(void *arg)
+{
+	void *blocks[BLOCKS];
+
+	for (unsigned int round = 0; round < ROUNDS; round++) {
+		for (unsigned int i = 0; i < BLOCKS; i++) {
+			blocks[i] = malloc(8 + ((round + i) % 16) * 16);
+			if (blocks[i] == NULL) {
+				atomic_inc(&failed);
+				while (i > 0)
+					free(blocks[--i]);
+				goto out;
+			}
+		}
+
+		for (unsigned int i = 0; i < BLOCKS; i++)
+			free(blocks[i]);
+	}
+
+out:
+	atomic_dec(&threads_running);
+}
+
+static void worker_thread(void *arg)
+{
+	thread_detach(thread_get_id());
+	worker(arg);
+}
+
+const char *test_malloc4(void)
+{
+	for (unsigned int threads = 1; threads <= THREADS; threads++) {
+		struct timeval start;
+		struct timeval end;
+
+		atomic_set(&failed, 0);
+		atomic_set(&threads_running, threads);
+
+		getuptime(&start);
+
+		for (unsigned int i = 1; i < threads; i++) {
+			if (thread_create(worker_thread, NULL, "malloc4",
+			    NULL) != EOK)
+				atomic_dec(&threads_running);
+		}
+
+		worker(NULL);
+
+		while (atomic_get(&threads_running) > 0)
+			thread_usleep(1000);
+
+		getuptime(&end);
+
+		if (atomic_get(&failed) > 0)
+			return "Failed allocating memory";
+
+		suseconds_t usec = tv_sub_diff(&end, &start);
+		if (usec == 0)
+			usec = 1;
+
+		uint64_t ops = (uint64_t) threads * ROUNDS * BLOCKS * 2;
+		TPRINTF("%u thread(s): %" PRIu64 " operations/s\n", threads,
+		    ops * 1000000 / usec);
+	}
+
+	if (heap_check() != NULL)
+		return "Heap corrupted";
+
+	return NULL;
+}
@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <mem.h>
+#include <sys/time.h>
+#include "../tester.h"
+
+#define MIN_SIZE   8
+#define MAX_SIZE   (1024 * 1024)
+
+/** Total number of bytes processed for each block size */
+#define TOTAL_BYTES  (64 * 1024 * 1024)
+
+typedef enum {
+	OP_MEMCPY,
+	OP_MEMMOVE,
+	OP_MEMSET,
+	OP_MEMCMP
+} mem_op_t;
+
+static const char *op_names[] = {
+	[OP_MEMCPY] = "memcpy",
+	[OP_MEMMOVE] = "memmove",
+	[OP_MEMSET] = "memset",
+	[OP_MEMCMP] = "memcmp"
+};
+
+static volatile int sink;
+
+/** Run one operation on blocks of @a size bytes and return the throughput.
+ *
+ * @return Throughput in KiB/s.
+ *
+ */
+static uint64_t bench_op(mem_op_t op, uint8_t *dst, uint8_t *src, size_t size)
+{
+	size_t rounds = TOTAL_BYTES / size;
+
+	struct timeval start;
+	gettimeofday(&start, NULL);
+
+	for (size_t i = 0; i < rounds; i++) {
+		switch (op) {
+		case OP_MEMCPY:
+			memcpy(dst, src, size);
+			break;
+		case OP_MEMMOVE:
+			/* Overlapping move towards higher addresses */
+			memmove(dst + 1, dst, size);
+			break;
+		case OP_MEMSET:
+			memset(dst, (int) i, size);
+			break;
+		case OP_MEMCMP:
+			sink += memcmp(dst, src, size);
+			break;
+		}
+	}
+
+	struct timeval end;
+	gettimeofday(&end, NULL);
+
+	uint64_t usec = tv_sub_diff(&end, &start);
+	if (usec == 0)
+		usec = 1;
+
+	return ((uint64_t) rounds * size / 1024) * 1000000 / usec;
+}
+
+const char *test_memcpy1(void)
+{
+	/* One spare byte for the overlapping memmove */
+	uint8_t *dst = malloc(MAX_SIZE + 1);
+	uint8_t *src = malloc(MAX_SIZE);
+	if (dst == NULL || src == NULL) {
+		free(dst);
+		free(src);
+		return "Out of memory";
+	}
+
+	for (size_t i = 0; i < MAX_SIZE; i++)
+		src[i] = i;
+	memcpy(dst, src, MAX_SIZE);
+
+	TPRINTF("%10s", "size");
+	for (mem_op_t op = OP_MEMCPY; op <= OP_MEMCMP; op++)
+		TPRINTF(" %12s", op_names[op]);
+	TPRINTF("   [KiB/s]\n");
+
+	for (size_t size = MIN_SIZE; size <= MAX_SIZE; size *= 2) {
+		TPRINTF("%10zu", size);
+
+		for (mem_op_t op = OP_MEMCPY; op <= OP_MEMCMP; op++) {
+			/* memcmp has to see equal blocks to scan them whole */
+			if (op == OP_MEMCMP)
+				memcpy(dst, src, size);
+
+			TPRINTF(" %12" PRIu64, bench_op(op, dst, src, size));
+		}
+
+		TPRINTF("\n");
+	}
+
+	free(dst);
+	free(src);
+	return NULL;
+}
@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <str.h>
+#include <sys/time.h>
+#include "../tester.h"
+
+#define ROUNDS  100000
+
+/** Typical path names as handled by VFS */
+static const char *paths[] = {
+	"/",
+	"/app/bdsh",
+	"/data/web/index.html",
+	"/usr/share/fonts/dejavu/DejaVuSansMono.ttf",
+	"/w/cfg/net/dhcp/eth0/lease/../../../resolver/servers",
+	"/data/dokumenty/příliš žluťoučký kůň/úpěl ďábelské ódy.txt"
+};
+
+/** Typical HTTP request header lines */
+static const char *headers[] = {
+	"GET /index.html HTTP/1.1",
+	"Host: www.helenos.org",
+	"User-Agent: Mozilla/5.0 (X11; HelenOS; rv:1.0) Gecko/20100101",
+	"Accept: text/html,application/xhtml+xml,application/xml;q=0.9",
+	"Accept-Language: cs-CZ,cs;q=0.9,en;q=0.8",
+	"Connection: keep-alive"
+};
+
+#define PATH_COUNT    (sizeof(paths) / sizeof(paths[0]))
+#define HEADER_COUNT  (sizeof(headers) / sizeof(headers[0]))
+
+static volatile size_t sink;
+
+/** Run one workload over a set of strings.
+ *
+ * @param name    Workload name to print.
+ * @param strs    Strings to process.
+ * @param count   Number of strings.
+ * @param op      Operation to run on each string (returns a value
+ *                that is accumulated to prevent optimizing it away).
+ *
+ */
+static void bench(const char *name, const char **strs, size_t count,
+    size_t (*op)(const char *, const char *))
+{
+	size_t bytes = 0;
+	for (size_t i = 0; i < count; i++)
+		bytes += str_size(strs[i]);
+
+	struct timeval start;
+	gettimeofday(&start, NULL);
+
+	for (size_t r = 0; r < ROUNDS; r++) {
+		for (size_t i = 0; i < count; i++)
+			sink += op(strs[i], strs[(i + 1) % count]);
+	}
+
+	struct timeval end;
+	gettimeofday(&end, NULL);
+
+	uint64_t usec = tv_sub_diff(&end, &start);
+	if (usec == 0)
+		usec = 1;
+
+	TPRINTF("%-24s %10" PRIu64 " us %10" PRIu64 " KiB/s\n", name, usec,
+	    ((uint64_t) ROUNDS * bytes / 1024) * 1000000 / usec);
+}
+
+static size_t op_size(const char *s, const char *other)
+{
+	return str_size(s);
+}
+
+static size_t op_cmp_self(const char *s, const char *other)
+{
+	return str_cmp(s, s);
+}
+
+static size_t op_cmp_other(const char *s, const char *other)
+{
+	return str_cmp(s, other);
+}
+
+static size_t op_chr_slash(const char *s, const char *other)
+{
+	/* Walk all path components like canonify() does */
+	size_t n = 0;
+	const char *p = s;
+
+	while ((p = str_chr(p, '/')) != NULL) {
+		p++;
+		n++;
+	}
+
+	return n;
+}
+
+static size_t op_chr_colon(const char *s, const char *other)
+{
+	return (size_t) str_chr(s, ':');
+}
+
+static size_t op_decode(const char *s, const char *other)
+{
+	size_t off = 0;
+	size_t sum = 0;
+	wchar_t ch;
+
+	while ((ch = str_decode(s, &off, STR_NO_LIMIT)) != 0)
+		sum += ch;
+
+	return sum;
+}
+
+const char *test_str1(void)
+{
+	TPRINTF("Paths:\n");
+	bench("str_size", paths, PATH_COUNT, op_size);
+	bench("str_cmp (equal)", paths, PATH_COUNT, op_cmp_self);
+	bench("str_cmp (different)", paths, PATH_COUNT, op_cmp_other);
+	bench("str_chr ('/' walk)", paths, PATH_COUNT, op_chr_slash);
+	bench("str_decode", paths, PATH_COUNT, op_decode);
+
+	TPRINTF("HTTP headers:\n");
+	bench("str_size", headers, HEADER_COUNT, op_size);
+	bench("str_cmp (equal)", headers, HEADER_COUNT, op_cmp_self);
+	bench("str_cmp (different)", headers, HEADER_COUNT, op_cmp_other);
+	bench("str_chr (':')", headers, HEADER_COUNT, op_chr_colon);
+	bench("str_decode", headers, HEADER_COUNT, op_decode);
+
+	return NULL;
+}
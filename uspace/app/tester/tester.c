@@ -48,6 +48,8 @@ char **test_argv;
 test_t tests[] = {
 #include "thread/thread1.def"
 #include "thread/setjmp1.def"
+#include "thread/fibril1.def"
+#include "thread/mutex1.def"
 #include "print/print1.def"
 #include "print/print2.def"
 #include "print/print3.def"
@@ -72,8 +74,13 @@ test_t tests[] = {
 #include "mm/malloc1.def"
 #include "mm/malloc2.def"
 #include "mm/malloc3.def"
+#include "mm/malloc4.def"
 #include "mm/mapping1.def"
 #include "mm/pager1.def"
+#include "mm/memcpy1.def"
+#include "audio/mix1.def"
+#include "audio/resample1.def"
+#include "str/str1.def"
 #include "hw/serial/serial1.def"
 #include "chardev/chardev1.def"
 	{ NULL, NULL, NULL, false }
@@ -80,6 +80,8 @@ typedef struct {
 
 extern const char *test_thread1(void);
 extern const char *test_setjmp1(void);
+extern const char *test_fibril1(void);
+extern const char *test_mutex1(void);
 extern const char *test_print1(void);
 extern const char *test_print2(void);
 extern const char *test_print3(void);
@@ -104,8 +106,13 @@ extern const char *test_loop1(void);
 extern const char *test_malloc1(void);
 extern const char *test_malloc2(void);
 extern const char *test_malloc3(void);
+extern const char *test_malloc4(void);
 extern const char *test_mapping1(void);
 extern const char *test_pager1(void);
+extern const char *test_memcpy1(void);
+extern const char *test_mix1(void);
+extern const char *test_resample1(void);
+extern const char *test_str1(void);
 extern const char *test_serial1(void);
 extern const char *test_devman1(void);
 extern const char *test_devman2(void);
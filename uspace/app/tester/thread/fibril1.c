@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) 2018 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <atomic.h>
+#include <errno.h>
+#include <fibril.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/time.h>
+#include <thread.h>
+#include "../tester.h"
+
+#define FIBRILS   16
+#define THREADS   4
+#define DURATION  1000000
+
+static atomic_t finish;
+static atomic_t fibrils_running;
+static atomic_t threads_running;
+
+static uint64_t switches[FIBRILS];
+
+static errno_t switcher(void *arg)
+{
+	uint64_t *count = (uint64_t *) arg;
+
+	while (!atomic_get(&finish)) {
+		fibril_yield();
+		(*count)++;
+	}
+
+	atomic_dec(&fibrils_running);
+	return EOK;
+}
+
+static void runner(void *arg)
+{
+	thread_detach(thread_get_id());
+
+	/*
+	 * Keep this thread busy with switching fibrils taken from its own
+	 * ready queue or stolen from the other threads.
+	 */
+	while (!atomic_get(&finish))
+		fibril_yield();
+
+	atomic_dec(&threads_running);
+}
+
+const char *test_fibril1(void)
+{
+	for (unsigned int threads = 1; threads <= THREADS; threads++) {
+		atomic_set(&finish, 0);
+		atomic_set(&fibrils_running, 0);
+		atomic_set(&threads_running, 0);
+
+		for (unsigned int i = 1; i < threads; i++) {
+			atomic_inc(&threads_running);
+			if (thread_create(runner, NULL, "fibril1", NULL) != EOK) {
+				atomic_dec(&threads_running);
+				atomic_set(&finish, 1);
+				return "Failed creating thread";
+			}
+		}
+
+		for (unsigned int i = 0; i < FIBRILS; i++) {
+			switches[i] = 0;
+
+			fid_t fid = fibril_create(switcher, &switches[i]);
+			if (fid == 0) {
+				atomic_set(&finish, 1);
+				return "Failed creating fibril";
+			}
+
+			atomic_inc(&fibrils_running);
+			fibril_add_ready(fid);
+		}
+
+		struct timeval start;
+		struct timeval now;
+
+		getuptime(&start);
+		do {
+			fibril_yield();
+			getuptime(&now);
+		} while (tv_sub_diff(&now, &start) < DURATION);
+
+		atomic_set(&finish, 1);
+
+		while ((atomic_get(&fibrils_running) > 0) ||
+		    (atomic_get(&threads_running) > 0))
+			fibril_yield();
+
+		uint64_t total = 0;
+		for (unsigned int i = 0; i < FIBRILS; i++)
+			total += switches[i];
+
+		TPRINTF("%u thread(s): %" PRIu64 " switches/s\n", threads,
+		    total * 1000000 / tv_sub_diff(&now, &start));
+	}
+
+	return NULL;
+}
@@ -262,6 +262,7 @@ static inline void print_cpu_info(data_t *data)
 			print_percent(data->cpus_perc[i].idle, 2);
 			fputs(", busy: ", stdout);
 			print_percent(data->cpus_perc[i].busy, 2);
+			printf(", ready: %" PRIu64, data->cpus[i].nrdy);
 		} else
 			printf("cpu%u inactive", data->cpus[i].id);
 
@@ -316,9 +317,18 @@ static inline void print_help(void)
 	printf(" i .. IPC statistics");
 	screen_newline();
 
+	printf(" p .. IPC phone statistics");
+	screen_newline();
+
 	printf(" e .. exceptions statistics");
 	screen_newline();
 
+	printf(" c .. CPU run queue statistics");
+	screen_newline();
+
+	printf(" l .. lock contention statistics");
+	screen_newline();
+
 	printf("      a .. toggle display of all/hot exceptions");
 	screen_newline();
 
@@ -41,7 +41,9 @@
 #include <sys/time.h>
 #include <errno.h>
 #include <gsort.h>
+#include <mem.h>
 #include <str.h>
+#include <sysinfo.h>
 #include "screen.h"
 #include "top.h"
 
@@ -56,7 +58,10 @@
 typedef enum {
 	OP_TASKS,
 	OP_IPC,
+	OP_PHONES,
 	OP_EXCS,
+	OP_CPUS,
+	OP_LOCKS,
 } op_mode_t;
 
 static const column_t task_columns[] = {
@@ -68,6 +73,7 @@ static const column_t task_columns[] = {
 	{ "%virt",    'V',  7 },
 	{ "%user",    'U',  7 },
 	{ "%kern",    'K',  7 },
+	{ "flt/s",    'f',  7 },
 	{ "name",     'd',  0 },
 };
 
@@ -80,6 +86,7 @@ enum {
 	TASK_COL_PERCENT_VIRTUAL,
 	TASK_COL_PERCENT_USER,
 	TASK_COL_PERCENT_KERNEL,
+	TASK_COL_FAULT_RATE,
 	TASK_COL_NAME,
 	TASK_NUM_COLUMNS,
 };
@@ -91,6 +98,11 @@ static const column_t ipc_columns[] = {
 	{ "ans snt", 'a', 9 },
 	{ "ans rcv", 'A', 9 },
 	{ "forward", 'f', 9 },
+	{ "bytes",   'b', 9 },
+	{ "snt/s",   's', 7 },
+	{ "rcv/s",   'r', 7 },
+	{ "lat 50%", 'l', 9 },
+	{ "lat 99%", 'L', 9 },
 	{ "name",    'd', 0 },
 };
 
@@ -101,10 +113,44 @@ enum {
 	IPC_COL_ANS_SNT,
 	IPC_COL_ANS_RCV,
 	IPC_COL_FORWARD,
+	IPC_COL_BYTES,
+	IPC_COL_SNT_RATE,
+	IPC_COL_RCV_RATE,
+	IPC_COL_LATENCY_MEDIAN,
+	IPC_COL_LATENCY_TAIL,
 	IPC_COL_NAME,
 	IPC_NUM_COLUMNS,
 };
 
+static const column_t phone_columns[] = {
+	{ "taskid",  't',  8 },
+	{ "phone",   'p',  7 },
+	{ "cls snt", 'c',  9 },
+	{ "ans rcv", 'A',  9 },
+	{ "forward", 'f',  9 },
+	{ "bytes",   'b',  9 },
+	{ "snt/s",   's',  7 },
+	{ "lat 50%", 'l',  9 },
+	{ "lat 99%", 'L',  9 },
+	{ "callee",  'e', 16 },
+	{ "name",    'd',  0 },
+};
+
+enum {
+	PHONE_COL_TASKID = 0,
+	PHONE_COL_HANDLE,
+	PHONE_COL_CLS_SNT,
+	PHONE_COL_ANS_RCV,
+	PHONE_COL_FORWARD,
+	PHONE_COL_BYTES,
+	PHONE_COL_SNT_RATE,
+	PHONE_COL_LATENCY_MEDIAN,
+	PHONE_COL_LATENCY_TAIL,
+	PHONE_COL_CALLEE,
+	PHONE_COL_NAME,
+	PHONE_NUM_COLUMNS,
+};
+
 static const column_t exception_columns[] = {
 	{ "exc",         'e',  8 },
 	{ "count",       'n', 10 },
@@ -124,6 +170,45 @@ enum {
 	EXCEPTION_NUM_COLUMNS,
 };
 
+static const column_t cpu_columns[] = {
+	{ "cpu",      'c',  6 },
+	{ "MHz",      'm',  6 },
+	{ "ready",    'r',  7 },
+	{ "%busy",    'b',  8 },
+	{ "steals/s", 'a', 10 },
+	{ "stolen/s", 's', 10 },
+	{ "state",    'd',  0 },
+};
+
+enum {
+	CPU_COL_ID = 0,
+	CPU_COL_FREQUENCY,
+	CPU_COL_READY,
+	CPU_COL_PERCENT_BUSY,
+	CPU_COL_STEAL_ATTEMPTS,
+	CPU_COL_STEAL_SUCCESSES,
+	CPU_COL_STATE,
+	CPU_NUM_COLUMNS,
+};
+
+static const column_t lock_columns[] = {
+	{ "count",   'n', 10 },
+	{ "per sec", 'r', 10 },
+	{ "kind",    'k', 12 },
+	{ "name",    'd',  0 },
+};
+
+enum {
+	LOCK_COL_COUNT = 0,
+	LOCK_COL_RATE,
+	LOCK_COL_KIND,
+	LOCK_COL_NAME,
+	LOCK_NUM_COLUMNS,
+};
+
+/** Number of global mutex counters shown in the lock table */
+#define MUTEX_ROWS  3
+
 screen_mode_t screen_mode = SCREEN_TABLE;
 static op_mode_t op_mode = OP_TASKS;
 static size_t sort_column = TASK_COL_PERCENT_USER;
@@ -136,12 +221,22 @@ static const char *read_data(data_t *target)
 	target->load = NULL;
 	target->cpus = NULL;
 	target->cpus_perc = NULL;
+	target->cpus_rate = NULL;
 	target->tasks = NULL;
 	target->tasks_perc = NULL;
+	target->tasks_rate = NULL;
 	target->threads = NULL;
+	target->phones_count = 0;
+	target->phones = NULL;
+	target->phones_rate = NULL;
 	target->exceptions = NULL;
 	target->exceptions_perc = NULL;
 	target->physmem = NULL;
+	target->slabs_count = 0;
+	target->slabs = NULL;
+	target->slabs_rate = NULL;
+	memset(&target->mutex, 0, sizeof(target->mutex));
+	memset(&target->mutex_rate, 0, sizeof(target->mutex_rate));
 	target->ucycles_diff = NULL;
 	target->kcycles_diff = NULL;
 	target->ecycles_diff = NULL;
@@ -168,6 +263,8 @@ static const char *read_data(data_t *target)
 	target->uhours = (uptime.tv_sec % DAY) / HOUR;
 	target->uminutes = (uptime.tv_sec % HOUR) / MINUTE;
 	target->useconds = uptime.tv_sec % MINUTE;
+	target->sample_usec = (uint64_t) uptime.tv_sec * 1000000 +
+	    uptime.tv_usec;
 
 	/* Get load */
 	target->load = stats_get_load(&(target->load_count));
@@ -184,6 +281,11 @@ static const char *read_data(data_t *target)
 	if (target->cpus_perc == NULL)
 		return "Not enough memory for CPU utilization";
 
+	target->cpus_rate =
+	    (rate_cpu_t *) calloc(target->cpus_count, sizeof(rate_cpu_t));
+	if (target->cpus_rate == NULL)
+		return "Not enough memory for CPU rates";
+
 	/* Get tasks */
 	target->tasks = stats_get_tasks(&(target->tasks_count));
 	if (target->tasks == NULL)
@@ -194,11 +296,42 @@ static const char *read_data(data_t *target)
 	if (target->tasks_perc == NULL)
 		return "Not enough memory for task utilization";
 
+	target->tasks_rate =
+	    (rate_task_t *) calloc(target->tasks_count, sizeof(rate_task_t));
+	if (target->tasks_rate == NULL)
+		return "Not enough memory for task rates";
+
 	/* Get threads */
 	target->threads = stats_get_threads(&(target->threads_count));
 	if (target->threads == NULL)
 		return "Cannot get threads";
 
+	/* Get phones of all tasks */
+	for (size_t i = 0; i < target->tasks_count; i++) {
+		size_t count;
+		stats_phone_t *phones =
+		    stats_get_phones(target->tasks[i].task_id, &count);
+		if (phones == NULL)
+			continue;
+
+		stats_phone_t *all = realloc(target->phones,
+		    (target->phones_count + count) * sizeof(stats_phone_t));
+		if (all == NULL) {
+			free(phones);
+			return "Not enough memory for phones";
+		}
+
+		memcpy(all + target->phones_count, phones,
+		    count * sizeof(stats_phone_t));
+		target->phones = all;
+		target->phones_count += count;
+		free(phones);
+	}
+
+	target->phones_rate = calloc(target->phones_count, sizeof(uint64_t));
+	if ((target->phones_rate == NULL) && (target->phones_count > 0))
+		return "Not enough memory for phone rates";
+
 	/* Get Exceptions */
 	target->exceptions = stats_get_exceptions(&(target->exceptions_count));
 	if (target->exceptions == NULL)
@@ -214,6 +347,26 @@ static const char *read_data(data_t *target)
 	if (target->physmem == NULL)
 		return "Cannot get physical memory";
 
+	/*
+	 * Lock contention counters are optional, a kernel without
+	 * them simply shows an empty lock table.
+	 */
+	target->slabs = stats_get_slabs(&(target->slabs_count));
+	if (target->slabs == NULL)
+		target->slabs_count = 0;
+
+	target->slabs_rate = calloc(target->slabs_count, sizeof(uint64_t));
+	if ((target->slabs_rate == NULL) && (target->slabs_count > 0))
+		return "Not enough memory for slab rates";
+
+	sysarg_t value;
+	if (sysinfo_get_value("system.mutex.contended", &value) == EOK)
+		target->mutex.contended = value;
+	if (sysinfo_get_value("system.mutex.spun", &value) == EOK)
+		target->mutex.spun = value;
+	if (sysinfo_get_value("system.mutex.blocked", &value) == EOK)
+		target->mutex.blocked = value;
+
 	target->ucycles_diff = calloc(target->tasks_count,
 	    sizeof(uint64_t));
 	if (target->ucycles_diff == NULL)
@@ -238,14 +391,34 @@ static const char *read_data(data_t *target)
 	return NULL;
 }
 
-/** Computes percentage differencies from old_data to new_data
+/** Compute per-second rate of a monotonic counter
+ *
+ * @param cur      Current value of the counter.
+ * @param prev     Value of the counter in the previous sample.
+ * @param interval Time between the samples (in microseconds).
+ *
+ * @return Number of events per second, zero if it cannot be computed.
+ *
+ */
+static uint64_t compute_rate(uint64_t cur, uint64_t prev, uint64_t interval)
+{
+	if ((interval == 0) || (cur < prev))
+		return 0;
+
+	return ((cur - prev) * 1000000 + interval / 2) / interval;
+}
+
+/** Computes percentage differencies and rates from old_data to new_data
  *
  * @param old_data Pointer to old data strucutre.
- * @param new_data Pointer to actual data where percetages are stored.
+ * @param new_data Pointer to actual data where percetages and rates
+ *                 are stored.
  *
  */
 static void compute_percentages(data_t *old_data, data_t *new_data)
 {
+	uint64_t interval = new_data->sample_usec - old_data->sample_usec;
+
 	/*
 	 * For each CPU: Compute total cycles and divide it between
 	 * user and kernel
@@ -261,6 +434,14 @@ static void compute_percentages(data_t *old_data, data_t *new_data)
 
 		FRACTION_TO_FLOAT(new_data->cpus_perc[i].idle, idle * 100, sum);
 		FRACTION_TO_FLOAT(new_data->cpus_perc[i].busy, busy * 100, sum);
+
+		/* Assumption: the number of CPUs is constant */
+		new_data->cpus_rate[i].steal_attempts =
+		    compute_rate(new_data->cpus[i].steal_attempts,
+		    old_data->cpus[i].steal_attempts, interval);
+		new_data->cpus_rate[i].steal_successes =
+		    compute_rate(new_data->cpus[i].steal_successes,
+		    old_data->cpus[i].steal_successes, interval);
 	}
 
 	/* For all tasks compute sum and differencies of all cycles */
@@ -294,6 +475,16 @@ static void compute_percentages(data_t *old_data, data_t *new_data)
 		new_data->kcycles_diff[i] =
 		    new_data->tasks[i].kcycles - old_data->tasks[j].kcycles;
 
+		new_data->tasks_rate[i].page_faults =
+		    compute_rate(new_data->tasks[i].page_faults,
+		    old_data->tasks[j].page_faults, interval);
+		new_data->tasks_rate[i].call_sent =
+		    compute_rate(new_data->tasks[i].ipc_info.call_sent,
+		    old_data->tasks[j].ipc_info.call_sent, interval);
+		new_data->tasks_rate[i].call_received =
+		    compute_rate(new_data->tasks[i].ipc_info.call_received,
+		    old_data->tasks[j].ipc_info.call_received, interval);
+
 		virtmem_total += new_data->tasks[i].virtmem;
 		resmem_total += new_data->tasks[i].resmem;
 		ucycles_total += new_data->ucycles_diff[i];
@@ -313,6 +504,45 @@ static void compute_percentages(data_t *old_data, data_t *new_data)
 		    new_data->kcycles_diff[i] * 100, kcycles_total);
 	}
 
+	/* For each phone compute the rate of sent calls */
+
+	for (i = 0; i < new_data->phones_count; i++) {
+		stats_phone_t *phone = &new_data->phones[i];
+
+		for (size_t j = 0; j < old_data->phones_count; j++) {
+			stats_phone_t *prev = &old_data->phones[j];
+
+			if ((phone->task_id == prev->task_id) &&
+			    (phone->handle == prev->handle)) {
+				new_data->phones_rate[i] =
+				    compute_rate(phone->ipc_info.call_sent,
+				    prev->ipc_info.call_sent, interval);
+				break;
+			}
+		}
+	}
+
+	/* Lock contention rates */
+
+	for (i = 0; i < new_data->slabs_count; i++) {
+		for (size_t j = 0; j < old_data->slabs_count; j++) {
+			if (str_cmp(new_data->slabs[i].name,
+			    old_data->slabs[j].name) == 0) {
+				new_data->slabs_rate[i] =
+				    compute_rate(new_data->slabs[i].contention,
+				    old_data->slabs[j].contention, interval);
+				break;
+			}
+		}
+	}
+
+	new_data->mutex_rate.contended = compute_rate(new_data->mutex.contended,
+	    old_data->mutex.contended, interval);
+	new_data->mutex_rate.spun = compute_rate(new_data->mutex.spun,
+	    old_data->mutex.spun, interval);
+	new_data->mutex_rate.blocked = compute_rate(new_data->mutex.blocked,
+	    old_data->mutex.blocked, interval);
+
 	/* For all exceptions compute sum and differencies of cycles */
 
 	uint64_t ecycles_total = 0;
@@ -406,6 +636,49 @@ static void sort_table(table_t *table)
 	    sizeof(field_t) * table->num_columns, cmp_data, NULL);
 }
 
+/** Estimate a latency percentile from a latency histogram
+ *
+ * @param latency Histogram of STATS_IPC_LATENCY_BUCKETS buckets.
+ * @param percent Percentile to estimate.
+ * @param field   Field to store the upper bound of the bucket containing
+ *                the percentile in, empty if there are no samples.
+ *
+ */
+static void latency_percentile(const uint64_t *latency, unsigned int percent,
+    field_t *field)
+{
+	uint64_t total = 0;
+	for (unsigned int i = 0; i < STATS_IPC_LATENCY_BUCKETS; i++)
+		total += latency[i];
+
+	if (total == 0) {
+		field->type = FIELD_EMPTY;
+		return;
+	}
+
+	uint64_t target = (total * percent + 99) / 100;
+	uint64_t sum = 0;
+	unsigned int i;
+	for (i = 0; i < STATS_IPC_LATENCY_BUCKETS - 1; i++) {
+		sum += latency[i];
+		if (sum >= target)
+			break;
+	}
+
+	field->type = FIELD_UINT_SUFFIX_DEC;
+	field->uint = UINT64_C(1) << (i + STATS_IPC_LATENCY_SHIFT);
+}
+
+static const char *task_name(data_t *data, task_id_t task_id)
+{
+	for (size_t i = 0; i < data->tasks_count; i++) {
+		if (data->tasks[i].task_id == task_id)
+			return data->tasks[i].name;
+	}
+
+	return "?";
+}
+
 static const char *fill_task_table(data_t *data)
 {
 	data->table.name = "Tasks";
@@ -437,6 +710,8 @@ static const char *fill_task_table(data_t *data)
 		field[TASK_COL_PERCENT_USER].fixed = perc->ucycles;
 		field[TASK_COL_PERCENT_KERNEL].type = FIELD_PERCENT;
 		field[TASK_COL_PERCENT_KERNEL].fixed = perc->kcycles;
+		field[TASK_COL_FAULT_RATE].type = FIELD_UINT_SUFFIX_DEC;
+		field[TASK_COL_FAULT_RATE].uint = data->tasks_rate[i].page_faults;
 		field[TASK_COL_NAME].type = FIELD_STRING;
 		field[TASK_COL_NAME].string = task->name;
 		field += TASK_NUM_COLUMNS;
@@ -470,6 +745,16 @@ static const char *fill_ipc_table(data_t *data)
 		field[IPC_COL_ANS_RCV].uint = data->tasks[i].ipc_info.answer_received;
 		field[IPC_COL_FORWARD].type = FIELD_UINT_SUFFIX_DEC;
 		field[IPC_COL_FORWARD].uint = data->tasks[i].ipc_info.forwarded;
+		field[IPC_COL_BYTES].type = FIELD_UINT_SUFFIX_BIN;
+		field[IPC_COL_BYTES].uint = data->tasks[i].ipc_info.bytes_copied;
+		field[IPC_COL_SNT_RATE].type = FIELD_UINT_SUFFIX_DEC;
+		field[IPC_COL_SNT_RATE].uint = data->tasks_rate[i].call_sent;
+		field[IPC_COL_RCV_RATE].type = FIELD_UINT_SUFFIX_DEC;
+		field[IPC_COL_RCV_RATE].uint = data->tasks_rate[i].call_received;
+		latency_percentile(data->tasks[i].ipc_info.latency, 50,
+		    &field[IPC_COL_LATENCY_MEDIAN]);
+		latency_percentile(data->tasks[i].ipc_info.latency, 99,
+		    &field[IPC_COL_LATENCY_TAIL]);
 		field[IPC_COL_NAME].type = FIELD_STRING;
 		field[IPC_COL_NAME].string = data->tasks[i].name;
 		field += IPC_NUM_COLUMNS;
@@ -478,6 +763,51 @@ static const char *fill_ipc_table(data_t *data)
 	return NULL;
 }
 
+static const char *fill_phone_table(data_t *data)
+{
+	data->table.name = "Phones";
+	data->table.num_columns = PHONE_NUM_COLUMNS;
+	data->table.columns = phone_columns;
+	data->table.num_fields = data->phones_count * PHONE_NUM_COLUMNS;
+	data->table.fields = calloc(data->table.num_fields,
+	    sizeof(field_t));
+	if (data->table.fields == NULL)
+		return "Not enough memory for table fields";
+
+	field_t *field = data->table.fields;
+	for (size_t i = 0; i < data->phones_count; i++) {
+		stats_phone_t *phone = &data->phones[i];
+		field[PHONE_COL_TASKID].type = FIELD_UINT;
+		field[PHONE_COL_TASKID].uint = phone->task_id;
+		field[PHONE_COL_HANDLE].type = FIELD_UINT;
+		field[PHONE_COL_HANDLE].uint = phone->handle;
+		field[PHONE_COL_CLS_SNT].type = FIELD_UINT_SUFFIX_DEC;
+		field[PHONE_COL_CLS_SNT].uint = phone->ipc_info.call_sent;
+		field[PHONE_COL_ANS_RCV].type = FIELD_UINT_SUFFIX_DEC;
+		field[PHONE_COL_ANS_RCV].uint = phone->ipc_info.answer_received;
+		field[PHONE_COL_FORWARD].type = FIELD_UINT_SUFFIX_DEC;
+		field[PHONE_COL_FORWARD].uint = phone->ipc_info.forwarded;
+		field[PHONE_COL_BYTES].type = FIELD_UINT_SUFFIX_BIN;
+		field[PHONE_COL_BYTES].uint = phone->ipc_info.bytes_copied;
+		field[PHONE_COL_SNT_RATE].type = FIELD_UINT_SUFFIX_DEC;
+		field[PHONE_COL_SNT_RATE].uint = data->phones_rate[i];
+		latency_percentile(phone->ipc_info.latency, 50,
+		    &field[PHONE_COL_LATENCY_MEDIAN]);
+		latency_percentile(phone->ipc_info.latency, 99,
+		    &field[PHONE_COL_LATENCY_TAIL]);
+		if (phone->callee_id != 0) {
+			field[PHONE_COL_CALLEE].type = FIELD_STRING;
+			field[PHONE_COL_CALLEE].string =
+			    task_name(data, phone->callee_id);
+		}
+		field[PHONE_COL_NAME].type = FIELD_STRING;
+		field[PHONE_COL_NAME].string = task_name(data, phone->task_id);
+		field += PHONE_NUM_COLUMNS;
+	}
+
+	return NULL;
+}
+
 static const char *fill_exception_table(data_t *data)
 {
 	data->table.name = "Exceptions";
@@ -514,6 +844,85 @@ static const char *fill_exception_table(data_t *data)
 	return NULL;
 }
 
+static const char *fill_cpu_table(data_t *data)
+{
+	data->table.name = "CPUs";
+	data->table.num_columns = CPU_NUM_COLUMNS;
+	data->table.columns = cpu_columns;
+	data->table.num_fields = data->cpus_count * CPU_NUM_COLUMNS;
+	data->table.fields = calloc(data->table.num_fields, sizeof(field_t));
+	if (data->table.fields == NULL)
+		return "Not enough memory for table fields";
+
+	field_t *field = data->table.fields;
+	for (size_t i = 0; i < data->cpus_count; i++) {
+		stats_cpu_t *cpu = &data->cpus[i];
+		field[CPU_COL_ID].type = FIELD_UINT;
+		field[CPU_COL_ID].uint = cpu->id;
+		field[CPU_COL_FREQUENCY].type = FIELD_UINT;
+		field[CPU_COL_FREQUENCY].uint = cpu->frequency_mhz;
+		field[CPU_COL_READY].type = FIELD_UINT;
+		field[CPU_COL_READY].uint = cpu->nrdy;
+		field[CPU_COL_PERCENT_BUSY].type = FIELD_PERCENT;
+		field[CPU_COL_PERCENT_BUSY].fixed = data->cpus_perc[i].busy;
+		field[CPU_COL_STEAL_ATTEMPTS].type = FIELD_UINT_SUFFIX_DEC;
+		field[CPU_COL_STEAL_ATTEMPTS].uint =
+		    data->cpus_rate[i].steal_attempts;
+		field[CPU_COL_STEAL_SUCCESSES].type = FIELD_UINT_SUFFIX_DEC;
+		field[CPU_COL_STEAL_SUCCESSES].uint =
+		    data->cpus_rate[i].steal_successes;
+		field[CPU_COL_STATE].type = FIELD_STRING;
+		field[CPU_COL_STATE].string = cpu->active ? "active" : "inactive";
+		field += CPU_NUM_COLUMNS;
+	}
+
+	return NULL;
+}
+
+static void fill_lock_row(field_t *field, const char *kind, const char *name,
+    uint64_t count, uint64_t rate)
+{
+	field[LOCK_COL_COUNT].type = FIELD_UINT_SUFFIX_DEC;
+	field[LOCK_COL_COUNT].uint = count;
+	field[LOCK_COL_RATE].type = FIELD_UINT_SUFFIX_DEC;
+	field[LOCK_COL_RATE].uint = rate;
+	field[LOCK_COL_KIND].type = FIELD_STRING;
+	field[LOCK_COL_KIND].string = kind;
+	field[LOCK_COL_NAME].type = FIELD_STRING;
+	field[LOCK_COL_NAME].string = name;
+}
+
+static const char *fill_lock_table(data_t *data)
+{
+	data->table.name = "Locks";
+	data->table.num_columns = LOCK_NUM_COLUMNS;
+	data->table.columns = lock_columns;
+	data->table.num_fields = (MUTEX_ROWS + data->slabs_count) *
+	    LOCK_NUM_COLUMNS;
+	data->table.fields = calloc(data->table.num_fields, sizeof(field_t));
+	if (data->table.fields == NULL)
+		return "Not enough memory for table fields";
+
+	field_t *field = data->table.fields;
+	fill_lock_row(field, "mutex", "contended", data->mutex.contended,
+	    data->mutex_rate.contended);
+	field += LOCK_NUM_COLUMNS;
+	fill_lock_row(field, "mutex", "spun", data->mutex.spun,
+	    data->mutex_rate.spun);
+	field += LOCK_NUM_COLUMNS;
+	fill_lock_row(field, "mutex", "blocked", data->mutex.blocked,
+	    data->mutex_rate.blocked);
+	field += LOCK_NUM_COLUMNS;
+
+	for (size_t i = 0; i < data->slabs_count; i++) {
+		fill_lock_row(field, "slab depot", data->slabs[i].name,
+		    data->slabs[i].contention, data->slabs_rate[i]);
+		field += LOCK_NUM_COLUMNS;
+	}
+
+	return NULL;
+}
+
 static const char *fill_table(data_t *data)
 {
 	if (data->table.fields != NULL) {
@@ -526,8 +935,14 @@ static const char *fill_table(data_t *data)
 		return fill_task_table(data);
 	case OP_IPC:
 		return fill_ipc_table(data);
+	case OP_PHONES:
+		return fill_phone_table(data);
 	case OP_EXCS:
 		return fill_exception_table(data);
+	case OP_CPUS:
+		return fill_cpu_table(data);
+	case OP_LOCKS:
+		return fill_lock_table(data);
 	}
 	return NULL;
 }
@@ -543,15 +958,27 @@ static void free_data(data_t *target)
 	if (target->cpus_perc != NULL)
 		free(target->cpus_perc);
 
+	if (target->cpus_rate != NULL)
+		free(target->cpus_rate);
+
 	if (target->tasks != NULL)
 		free(target->tasks);
 
 	if (target->tasks_perc != NULL)
 		free(target->tasks_perc);
 
+	if (target->tasks_rate != NULL)
+		free(target->tasks_rate);
+
 	if (target->threads != NULL)
 		free(target->threads);
 
+	if (target->phones != NULL)
+		free(target->phones);
+
+	if (target->phones_rate != NULL)
+		free(target->phones_rate);
+
 	if (target->exceptions != NULL)
 		free(target->exceptions);
 
@@ -561,6 +988,12 @@ static void free_data(data_t *target)
 	if (target->physmem != NULL)
 		free(target->physmem);
 
+	if (target->slabs != NULL)
+		free(target->slabs);
+
+	if (target->slabs_rate != NULL)
+		free(target->slabs_rate);
+
 	if (target->ucycles_diff != NULL)
 		free(target->ucycles_diff);
 
@@ -636,9 +1069,18 @@ int main(int argc, char *argv[])
 		case 'i':
 			op_mode = OP_IPC;
 			break;
+		case 'p':
+			op_mode = OP_PHONES;
+			break;
 		case 'e':
 			op_mode = OP_EXCS;
 			break;
+		case 'c':
+			op_mode = OP_CPUS;
+			break;
+		case 'l':
+			op_mode = OP_LOCKS;
+			break;
 		case 's':
 			screen_mode = SCREEN_SORT;
 			break;
@@ -79,6 +79,23 @@ typedef struct {
 	fixed_float count;
 } perc_exc_t;
 
+typedef struct {
+	uint64_t steal_attempts;
+	uint64_t steal_successes;
+} rate_cpu_t;
+
+typedef struct {
+	uint64_t page_faults;
+	uint64_t call_sent;
+	uint64_t call_received;
+} rate_task_t;
+
+typedef struct {
+	uint64_t contended;
+	uint64_t spun;
+	uint64_t blocked;
+} mutex_counts_t;
+
 typedef enum {
 	FIELD_EMPTY,
 	FIELD_UINT,
@@ -121,26 +138,42 @@ typedef struct {
 	sysarg_t uminutes;
 	sysarg_t useconds;
 
+	/** Uptime of the sample in microseconds, used to compute rates */
+	uint64_t sample_usec;
+
 	size_t load_count;
 	load_t *load;
 
 	size_t cpus_count;
 	stats_cpu_t *cpus;
 	perc_cpu_t *cpus_perc;
+	rate_cpu_t *cpus_rate;
 
 	size_t tasks_count;
 	stats_task_t *tasks;
 	perc_task_t *tasks_perc;
+	rate_task_t *tasks_rate;
 
 	size_t threads_count;
 	stats_thread_t *threads;
 
+	size_t phones_count;
+	stats_phone_t *phones;
+	uint64_t *phones_rate;
+
 	size_t exceptions_count;
 	stats_exc_t *exceptions;
 	perc_exc_t *exceptions_perc;
 
 	stats_physmem_t *physmem;
 
+	size_t slabs_count;
+	stats_slab_t *slabs;
+	uint64_t *slabs_rate;
+
+	mutex_counts_t mutex;
+	mutex_counts_t mutex_rate;
+
 	uint64_t *ucycles_diff;
 	uint64_t *kcycles_diff;
 	uint64_t *ecycles_diff;
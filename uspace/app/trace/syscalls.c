@@ -45,8 +45,8 @@ const sc_desc_t syscall_desc[] = {
 
 	[SYS_TASK_GET_ID] = { "task_get_id", 1, V_ERRNO },
 	[SYS_TASK_SET_NAME] = { "task_set_name", 2, V_ERRNO },
-	[SYS_FUTEX_SLEEP] = { "futex_sleep_timeout", 3, V_ERRNO },
-	[SYS_FUTEX_WAKEUP] = { "futex_wakeup", 1, V_ERRNO },
+	[SYS_FUTEX_SLEEP] = { "futex_sleep_timeout", 4, V_ERRNO },
+	[SYS_FUTEX_WAKEUP] = { "futex_wakeup", 2, V_ERRNO },
 
 	[SYS_AS_AREA_CREATE] = { "as_area_create", 5, V_ERRNO },
 	[SYS_AS_AREA_RESIZE] = { "as_area_resize", 3, V_ERRNO },
@@ -54,12 +54,16 @@ const sc_desc_t syscall_desc[] = {
 
 	[SYS_IPC_CALL_ASYNC_FAST] = { "ipc_call_async_fast", 6, V_HASH },
 	[SYS_IPC_CALL_ASYNC_SLOW] = { "ipc_call_async_slow", 3, V_HASH },
+	[SYS_IPC_CALL_ASYNC_BATCH] = { "ipc_call_async_batch", 3, V_ERRNO },
+	[SYS_IPC_CALL_ASYNC_PAYLOAD] = { "ipc_call_async_payload", 5, V_ERRNO },
 
 	[SYS_IPC_ANSWER_FAST] = { "ipc_answer_fast", 6, V_ERRNO },
 	[SYS_IPC_ANSWER_SLOW] = { "ipc_answer_slow", 2, V_ERRNO },
 	[SYS_IPC_FORWARD_FAST] = { "ipc_forward_fast", 6, V_ERRNO },
 	[SYS_IPC_FORWARD_SLOW] = { "ipc_forward_slow", 3, V_ERRNO },
 	[SYS_IPC_WAIT] = { "ipc_wait_for_call", 3, V_HASH },
+	[SYS_IPC_WAIT_BATCH] = { "ipc_wait_for_call_batch", 5, V_ERRNO },
+	[SYS_IPC_PAYLOAD_GET] = { "ipc_payload_get", 3, V_ERRNO },
 	[SYS_IPC_POKE] = { "ipc_poke", 0, V_ERRNO },
 	[SYS_IPC_HANGUP] = { "ipc_hangup", 1, V_ERRNO },
 
@@ -74,6 +78,8 @@ const sc_desc_t syscall_desc[] = {
 
 	[SYS_IPC_IRQ_SUBSCRIBE] = { "ipc_irq_subscribe", 4, V_ERRNO },
 	[SYS_IPC_IRQ_UNSUBSCRIBE] = { "ipc_irq_unsubscribe", 2, V_ERRNO },
+	[SYS_IPC_IRQ_COALESCE] = { "ipc_irq_coalesce", 2, V_ERRNO },
+	[SYS_IPC_IRQ_SET_AFFINITY] = { "ipc_irq_set_affinity", 2, V_ERRNO },
 
 	[SYS_SYSINFO_GET_VAL_TYPE] = { "sysinfo_get_val_type", 2, V_INTEGER },
 	[SYS_SYSINFO_GET_VALUE] = { "sysinfo_get_value", 3, V_ERRNO },
@@ -81,7 +87,8 @@ const sc_desc_t syscall_desc[] = {
 	[SYS_SYSINFO_GET_DATA] = { "sysinfo_get_data", 5, V_ERRNO },
 
 	[SYS_DEBUG_CONSOLE] = { "debug_console", 0, V_ERRNO },
-	[SYS_IPC_CONNECT_KBOX] = { "ipc_connect_kbox", 1, V_ERRNO }
+	[SYS_IPC_CONNECT_KBOX] = { "ipc_connect_kbox", 1, V_ERRNO },
+	[SYS_KTRACE] = { "ktrace", 4, V_ERRNO }
 };
 
 const size_t syscall_desc_len = (sizeof(syscall_desc) / sizeof(sc_desc_t));
@@ -51,6 +51,7 @@
 #include <io/keycode.h>
 #include <fibril_synch.h>
 #include <vfs/vfs.h>
+#include <sys/time.h>
 
 #include <libc.h>
 
@@ -65,6 +66,14 @@
 #include "trace.h"
 
 #define THBUF_SIZE 64
+
+/** Capacity of the kernel event log in buffered mode */
+#define LOG_CAPACITY  4096
+/** Number of log entries read at once */
+#define LOG_READ_ENTRIES  128
+/** Interval of polling an empty event log in microseconds */
+#define LOG_POLL_USEC  10000
+
 uintptr_t thread_hash_buf[THBUF_SIZE];
 int n_threads;
 
@@ -72,6 +81,18 @@ int next_thread_id;
 
 ipc_call_t thread_ipc_req[THBUF_SIZE];
 
+/** Uptime in nanoseconds when each thread entered its current syscall */
+static uint64_t thread_sc_start[THBUF_SIZE];
+/** Whether the entry of the current syscall of each thread was seen */
+static bool thread_in_sc[THBUF_SIZE];
+
+/** Events are read from the kernel log instead of stopping the threads */
+static bool log_mode;
+
+/** Syscall event filter and whether it should be set */
+static udebug_filter_t filter;
+static bool filter_set;
+
 async_sess_t *sess;
 bool abort_trace;
 
@@ -172,6 +193,14 @@ static errno_t connect_task(task_id_t task_id)
 		return rc;
 	}
 
+	if (filter_set) {
+		rc = udebug_set_filter(ksess, &filter);
+		if (rc != EOK) {
+			printf("udebug_set_filter() -> %s\n", str_error_name(rc));
+			return rc;
+		}
+	}
+
 	sess = ksess;
 	return 0;
 }
@@ -344,46 +373,59 @@ static void sc_ipc_wait(sysarg_t *sc_args, cap_call_handle_t sc_rc)
 		ipcp_call_in(&call, sc_rc);
 }
 
-static void event_syscall_b(unsigned thread_id, uintptr_t thread_hash,
-    unsigned sc_id, sysarg_t sc_rc)
+static void print_sc_name(unsigned sc_id, sysarg_t *sc_args)
 {
-	sysarg_t sc_args[6];
-	errno_t rc;
-
-	/* Read syscall arguments */
-	rc = udebug_args_read(sess, thread_hash, sc_args);
-
-	if (rc != EOK) {
-		printf("error\n");
-		return;
+	if (syscall_desc_defined(sc_id)) {
+		printf("%s", syscall_desc[sc_id].name);
+		print_sc_args(sc_args, syscall_desc[sc_id].n_args);
+	} else {
+		printf("unknown_syscall<%d>", sc_id);
+		print_sc_args(sc_args, 6);
 	}
+}
+
+/** Print the entry to a syscall.
+ *
+ * @param thread_id Thread ID
+ * @param sc_id     Syscall number
+ * @param sc_args   Syscall arguments
+ * @param now       Uptime of the entry in nanoseconds
+ */
+static void syscall_b_print(unsigned thread_id, unsigned sc_id,
+    sysarg_t *sc_args, uint64_t now)
+{
+	thread_in_sc[thread_id] = true;
 
 	if ((display_mask & DM_SYSCALL) != 0) {
-		/* Print syscall name and arguments */
-		if (syscall_desc_defined(sc_id)) {
-			printf("%s", syscall_desc[sc_id].name);
-			print_sc_args(sc_args, syscall_desc[sc_id].n_args);
-		} else {
-			printf("unknown_syscall<%d>", sc_id);
-			print_sc_args(sc_args, 6);
+		if ((display_mask & DM_TIME) != 0) {
+			thread_sc_start[thread_id] = now;
+			printf("[%" PRIu64 ".%09" PRIu64 "] ", now / 1000000000,
+			    now % 1000000000);
 		}
+
+		/* Print syscall name and arguments */
+		print_sc_name(sc_id, sc_args);
 	}
 }
 
-static void event_syscall_e(unsigned thread_id, uintptr_t thread_hash,
-    unsigned sc_id, sysarg_t sc_rc)
+/** Print the return from a syscall.
+ *
+ * The entry to the syscall may not have been seen if the filter
+ * let only the return pass. The syscall name is printed then.
+ *
+ * @param thread_id Thread ID
+ * @param sc_id     Syscall number
+ * @param sc_rc     Syscall return value
+ * @param sc_args   Syscall arguments
+ * @param now       Uptime of the return in nanoseconds
+ */
+static void syscall_e_print(unsigned thread_id, unsigned sc_id,
+    sysarg_t sc_rc, sysarg_t *sc_args, uint64_t now)
 {
-	sysarg_t sc_args[6];
 	int rv_type;
-	errno_t rc;
+	bool in_sc = thread_in_sc[thread_id];
 
-	/* Read syscall arguments */
-	rc = udebug_args_read(sess, thread_hash, sc_args);
-
-	if (rc != EOK) {
-		printf("error\n");
-		return;
-	}
+	thread_in_sc[thread_id] = false;
 
 	if ((display_mask & DM_SYSCALL) != 0) {
 		/* Print syscall return value */
@@ -391,6 +433,15 @@ static void event_syscall_e(unsigned thread_id, uintptr_t thread_hash,
 			rv_type = syscall_desc[sc_id].rv_type;
 		else
 			rv_type = V_PTR;
+
+		if (!in_sc)
+			print_sc_name(sc_id, sc_args);
+
+		if ((display_mask & DM_TIME) != 0 && in_sc) {
+			printf(" <%" PRIu64 " ns>", now -
+			    thread_sc_start[thread_id]);
+		}
+
 		print_sc_retval(sc_rc, rv_type);
 	}
 
@@ -399,6 +450,7 @@ static void event_syscall_e(unsigned thread_id, uintptr_t thread_hash,
 		sc_ipc_call_async_fast(sc_args, (errno_t) sc_rc);
 		break;
 	case SYS_IPC_CALL_ASYNC_SLOW:
+	case SYS_IPC_CALL_ASYNC_PAYLOAD:
 		sc_ipc_call_async_slow(sc_args, (errno_t) sc_rc);
 		break;
 	case SYS_IPC_WAIT:
@@ -409,6 +461,40 @@ static void event_syscall_e(unsigned thread_id, uintptr_t thread_hash,
 	}
 }
 
+static void event_syscall_b(unsigned thread_id, uintptr_t thread_hash,
+    unsigned sc_id, sysarg_t sc_rc)
+{
+	sysarg_t sc_args[6];
+	errno_t rc;
+
+	/* Read syscall arguments */
+	rc = udebug_args_read(sess, thread_hash, sc_args);
+
+	if (rc != EOK) {
+		printf("error\n");
+		return;
+	}
+
+	syscall_b_print(thread_id, sc_id, sc_args, getuptime_nsec());
+}
+
+static void event_syscall_e(unsigned thread_id, uintptr_t thread_hash,
+    unsigned sc_id, sysarg_t sc_rc)
+{
+	sysarg_t sc_args[6];
+	errno_t rc;
+
+	/* Read syscall arguments */
+	rc = udebug_args_read(sess, thread_hash, sc_args);
+
+	if (rc != EOK) {
+		printf("error\n");
+		return;
+	}
+
+	syscall_e_print(thread_id, sc_id, sc_rc, sc_args, getuptime_nsec());
+}
+
 static void event_thread_b(uintptr_t hash)
 {
 	printf("New thread, hash %p\n", (void *) hash);
@@ -505,6 +591,106 @@ void thread_trace_start(uintptr_t thread_hash)
 	fibril_add_ready(fid);
 }
 
+/** Get the ID of a thread in buffered mode.
+ *
+ * Threads are numbered by their position in the thread list, threads
+ * unknown so far are appended to it.
+ *
+ * @param thread_hash Thread hash
+ * @return Thread ID
+ */
+static unsigned log_thread_id(uintptr_t thread_hash)
+{
+	int i;
+
+	for (i = 0; i < n_threads; i++) {
+		if (thread_hash_buf[i] == thread_hash)
+			return i;
+	}
+
+	/* Threads over the limit share the last slot. */
+	if (n_threads == THBUF_SIZE)
+		return THBUF_SIZE - 1;
+
+	thread_hash_buf[n_threads] = thread_hash;
+	return n_threads++;
+}
+
+/** Print an event read from the kernel event log. */
+static void log_event(udebug_log_entry_t *entry)
+{
+	unsigned thread_id = log_thread_id(entry->thash);
+
+	switch (entry->type) {
+	case UDEBUG_EVENT_SYSCALL_B:
+		syscall_b_print(thread_id, entry->val0, entry->args,
+		    entry->timestamp);
+		break;
+	case UDEBUG_EVENT_SYSCALL_E:
+		syscall_e_print(thread_id, entry->val0, entry->val1,
+		    entry->args, entry->timestamp);
+		break;
+	case UDEBUG_EVENT_THREAD_B:
+		printf("New thread, hash %p\n", (void *) entry->val0);
+		(void) log_thread_id(entry->val0);
+		break;
+	case UDEBUG_EVENT_THREAD_E:
+		printf("Thread %p exited.\n", (void *) entry->thash);
+		break;
+	default:
+		printf("Unknown event type %" PRIun ".\n", entry->type);
+		break;
+	}
+}
+
+/** Drain the kernel event log in buffered mode.
+ *
+ * The traced threads are not stopped. The log is polled until it
+ * cannot be read anymore, which happens when the task terminates.
+ */
+static errno_t log_fibril(void *arg)
+{
+	udebug_log_entry_t *entries;
+	size_t copied;
+	size_t lost;
+	size_t i;
+	errno_t rc;
+
+	(void) arg;
+
+	entries = calloc(LOG_READ_ENTRIES, sizeof(udebug_log_entry_t));
+	if (entries == NULL) {
+		printf("Out of memory.\n");
+		rc = ENOMEM;
+		goto out;
+	}
+
+	while (!abort_trace) {
+		rc = udebug_log_read(sess, entries, LOG_READ_ENTRIES, &copied,
+		    &lost);
+		if (rc != EOK)
+			break;
+
+		if (lost > 0)
+			printf("[%zu events lost]\n", lost);
+
+		for (i = 0; i < copied; i++)
+			log_event(&entries[i]);
+
+		if (copied == 0)
+			async_usleep(LOG_POLL_USEC);
+	}
+
+	free(entries);
+out:
+	fibril_mutex_lock(&state_lock);
+	abort_trace = true;
+	fibril_condvar_broadcast(&state_cv);
+	fibril_mutex_unlock(&state_lock);
+
+	return rc;
+}
+
 static loader_t *preload_task(const char *path, char **argv,
     task_id_t *task_id)
 {
@@ -621,8 +807,24 @@ static void trace_task(task_id_t task_id)
 
 	abort_trace = false;
 
-	for (i = 0; i < n_threads; i++) {
-		thread_trace_start(thread_hash_buf[i]);
+	if (log_mode) {
+		rc = udebug_log_start(sess, LOG_CAPACITY);
+		if (rc != EOK) {
+			printf("udebug_log_start() -> %s\n", str_error_name(rc));
+			return;
+		}
+
+		fid_t fid = fibril_create(log_fibril, NULL);
+		if (fid == 0) {
+			printf("Error creating fibril\n");
+			return;
+		}
+
+		fibril_add_ready(fid);
+	} else {
+		for (i = 0; i < n_threads; i++) {
+			thread_trace_start(thread_hash_buf[i]);
+		}
 	}
 
 	done = false;
@@ -651,6 +853,11 @@ static void trace_task(task_id_t task_id)
 			done = true;
 			break;
 		case KC_P:
+			if (log_mode) {
+				printf("Pausing is not available in buffered "
+				    "mode.\n");
+				break;
+			}
 			printf("Pause...\n");
 			rc = udebug_stop(sess, thash);
 			if (rc != EOK)
@@ -745,18 +952,26 @@ static void main_init(void)
 static void print_syntax(void)
 {
 	printf("Syntax:\n");
-	printf("\ttrace [+<events>] <executable> [<arg1> [...]]\n");
-	printf("or\ttrace [+<events>] -t <task_id>\n");
+	printf("\ttrace [+<events>] [<options>] <executable> [<arg1> [...]]\n");
+	printf("or\ttrace [+<events>] [<options>] -t <task_id>\n");
+	printf("Options:\n");
+	printf("\t-b ... Buffered mode: do not stop the threads, read the\n");
+	printf("\t       events from a kernel log (pausing is not available)\n");
+	printf("\t-s <syscall>[,...] ... Trace only the listed system calls\n");
+	printf("\t-m <method>[,...] ... Trace only IPC calls with the listed "
+	    "methods\n");
 	printf("Events: (default is +tp)\n");
 	printf("\n");
 	printf("\tt ... Thread creation and termination\n");
 	printf("\ts ... System calls\n");
 	printf("\ti ... Low-level IPC\n");
 	printf("\tp ... Protocol level\n");
+	printf("\tT ... Timestamps and durations of system calls\n");
 	printf("\n");
 	printf("Examples:\n");
 	printf("\ttrace +s /app/tetris\n");
 	printf("\ttrace +tsip -t 12\n");
+	printf("\ttrace +sT -b -s ipc_call_async_fast,ipc_wait -t 12\n");
 }
 
 static display_mask_t parse_display_mask(const char *text)
@@ -778,6 +993,9 @@ static display_mask_t parse_display_mask(const char *text)
 		case 'p':
 			dm = dm | DM_SYSTEM | DM_USER;
 			break;
+		case 'T':
+			dm = dm | DM_TIME;
+			break;
 		default:
 			printf("Unexpected event type '%c'.\n", *c);
 			exit(1);
@@ -789,11 +1007,75 @@ static display_mask_t parse_display_mask(const char *text)
 	return dm;
 }
 
+/** Parse a comma-separated list of syscall names into the filter. */
+static int parse_sc_filter(char *text)
+{
+	char *next;
+	char *name;
+	size_t i;
+
+	memset(filter.sc_mask, 0, sizeof(filter.sc_mask));
+
+	name = str_tok(text, ",", &next);
+	while (name != NULL) {
+		for (i = 0; i < syscall_desc_len; i++) {
+			if (syscall_desc_defined(i) &&
+			    str_cmp(syscall_desc[i].name, name) == 0)
+				break;
+		}
+
+		if (i == syscall_desc_len || i >= SYSCALL_END) {
+			printf("Unknown system call '%s'\n", name);
+			return -1;
+		}
+
+		filter.sc_mask[i / 32] |= UINT32_C(1) << (i % 32);
+		name = str_tok(next, ",", &next);
+	}
+
+	return 0;
+}
+
+/** Parse a comma-separated list of IPC methods into the filter. */
+static int parse_method_filter(char *text)
+{
+	char *next;
+	char *tok;
+	char *err_p;
+
+	filter.methods_cnt = 0;
+
+	tok = str_tok(text, ",", &next);
+	while (tok != NULL) {
+		if (filter.methods_cnt == UDEBUG_FILTER_METHODS_MAX) {
+			printf("At most %d methods can be traced\n",
+			    UDEBUG_FILTER_METHODS_MAX);
+			return -1;
+		}
+
+		filter.methods[filter.methods_cnt++] = strtoul(tok, &err_p, 0);
+		if (*err_p) {
+			printf("Method syntax error\n");
+			return -1;
+		}
+
+		tok = str_tok(next, ",", &next);
+	}
+
+	return 0;
+}
+
 static int parse_args(int argc, char *argv[])
 {
 	char *err_p;
 
 	task_id = 0;
+	log_mode = false;
+
+	/* Without the -s option, all system calls pass the filter. */
+	filter_set = false;
+	memset(filter.sc_mask, 0xff, sizeof(filter.sc_mask));
+	filter.methods_cnt = 0;
 
 	--argc;
 	++argv;
@@ -815,6 +1097,24 @@ static int parse_args(int argc, char *argv[])
 					print_syntax();
 					return -1;
 				}
+			} else if (arg[1] == 'b') {
+				log_mode = true;
+			} else if (arg[1] == 's' || arg[1] == 'm') {
+				--argc;
+				++argv;
+				if (argc == 0) {
+					printf("Missing argument of '-%c'\n", arg[1]);
+					print_syntax();
+					return -1;
+				}
+
+				if ((arg[1] == 's' ? parse_sc_filter(*argv) :
+				    parse_method_filter(*argv)) < 0) {
+					print_syntax();
+					return -1;
+				}
+
+				filter_set = true;
 			} else {
 				printf("Uknown option '%c'\n", arg[0]);
 				print_syntax();
@@ -33,8 +33,10 @@
  * @file Skeletal web server.
  */
 
+#include <adt/list.h>
 #include <errno.h>
 #include <assert.h>
+#include <fibril_synch.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdint.h>
@@ -50,6 +52,7 @@
 
 #include <arg_parse.h>
 #include <macros.h>
+#include <mem.h>
 #include <str.h>
 #include <str_error.h>
 
@@ -62,6 +65,18 @@
 /** Buffer for receiving the request. */
 #define BUFFER_SIZE  1024
 
+/** Block size for sending files (the largest single TCP send). */
+#define FILE_BUFFER_SIZE  (64 * 1024)
+
+/** Files up to this size are kept in memory. */
+#define CACHE_FILE_MAX  (64 * 1024)
+
+/** Total size of the cached files. */
+#define CACHE_SIZE_MAX  (4 * 1024 * 1024)
+
+/** Size of a buffer holding an entity tag, including the quotes. */
+#define ETAG_SIZE  32
+
 static void websrv_new_conn(tcp_listener_t *, tcp_conn_t *);
 
 static tcp_listen_cb_t listen_cb = {
@@ -83,19 +98,51 @@ typedef struct {
 
 	char lbuf[BUFFER_SIZE + 1];
 	size_t lbuf_used;
+
+	/** The peer has closed its side of the connection */
+	bool closed;
+
+	/** Buffer for the response header and file data */
+	char *fbuf;
 } recv_t;
 
+/** Request as far as the response depends on it. */
+typedef struct {
+	/** Whether the connection persists after the response */
+	bool keep_alive;
+	/** Value of the If-None-Match header, empty if none */
+	char if_none_match[ETAG_SIZE];
+} req_t;
+
+/** Cached file. */
+typedef struct {
+	/** Link to cache, most recently used first */
+	link_t link;
+	/** File name */
+	char *fname;
+	/** File identity, to notice the name now refers to another file */
+	service_id_t service_id;
+	fs_index_t index;
+	/** Entity tag derived from the contents */
+	char etag[ETAG_SIZE];
+	/** Contents */
+	char *data;
+	size_t size;
+	/** Number of responses being sent from the entry */
+	unsigned refcnt;
+	/** Removed from the cache, to be freed with the last reference */
+	bool evicted;
+} cache_entry_t;
+
+static FIBRIL_MUTEX_INITIALIZE(cache_lock);
+static LIST_INITIALIZE(cache);
+static size_t cache_size = 0;
+
 static bool verbose = false;
 
 /** Responses to send to client. */
 
-static const char *msg_ok =
-    "HTTP/1.0 200 OK\r\n"
-    "\r\n";
-
 static const char *msg_bad_request =
-    "HTTP/1.0 400 Bad Request\r\n"
-    "\r\n"
     "<!DOCTYPE HTML PUBLIC \"-//IETF//DTD HTML 2.0//EN\">\r\n"
     "<html><head>\r\n"
     "<title>400 Bad Request</title>\r\n"
@@ -107,8 +154,6 @@ static const char *msg_bad_request =
     "</html>\r\n";
 
 static const char *msg_not_found =
-    "HTTP/1.0 404 Not Found\r\n"
-    "\r\n"
     "<!DOCTYPE HTML PUBLIC \"-//IETF//DTD HTML 2.0//EN\">\r\n"
     "<html><head>\r\n"
     "<title>404 Not Found</title>\r\n"
@@ -120,8 +165,6 @@ static const char *msg_not_found =
     "</html>\r\n";
 
 static const char *msg_not_implemented =
-    "HTTP/1.0 501 Not Implemented\r\n"
-    "\r\n"
     "<!DOCTYPE HTML PUBLIC \"-//IETF//DTD HTML 2.0//EN\">\r\n"
     "<html><head>\r\n"
     "<title>501 Not Implemented</title>\r\n"
@@ -141,6 +184,12 @@ static errno_t recv_create(tcp_conn_t *conn, recv_t **rrecv)
 	if (recv == NULL)
 		return ENOMEM;
 
+	recv->fbuf = malloc(FILE_BUFFER_SIZE);
+	if (recv->fbuf == NULL) {
+		free(recv);
+		return ENOMEM;
+	}
+
 	recv->conn = conn;
 	recv->rbuf_out = 0;
 	recv->rbuf_in = 0;
@@ -152,6 +201,8 @@ static errno_t recv_create(tcp_conn_t *conn, recv_t **rrecv)
 
 static void recv_destroy(recv_t *recv)
 {
+	if (recv != NULL)
+		free(recv->fbuf);
 	free(recv);
 }
 
@@ -171,6 +222,11 @@ static errno_t recv_char(recv_t *recv, char *c)
 			return rc;
 		}
 
+		if (nrecv == 0) {
+			recv->closed = true;
+			return ENOTCONN;
+		}
+
 		recv->rbuf_in = nrecv;
 	}
 
@@ -225,14 +281,48 @@ static bool uri_is_valid(char *uri)
 	return true;
 }
 
-static errno_t send_response(tcp_conn_t *conn, const char *msg)
+/** Send the status line and headers of a response.
+ *
+ * If @a data fits in the buffer behind the headers, it is sent along in
+ * the same block.
+ *
+ * @param recv Connection
+ * @param status Status code and reason phrase
+ * @param etag Entity tag or NULL
+ * @param length Length of the body
+ * @param data Body to send along or NULL
+ * @param keep_alive Whether the connection persists
+ * @param rsent Place to store whether @a data was sent, or NULL
+ */
+static errno_t send_header(recv_t *recv, const char *status, const char *etag,
+    uint64_t length, const void *data, bool keep_alive, bool *rsent)
 {
-	size_t response_size = str_size(msg);
+	int hlen = snprintf(recv->fbuf, FILE_BUFFER_SIZE,
+	    "HTTP/1.1 %s\r\n"
+	    "Content-Length: %" PRIu64 "\r\n"
+	    "%s%s%s"
+	    "%s"
+	    "\r\n",
+	    status, length,
+	    etag != NULL ? "ETag: " : "",
+	    etag != NULL ? etag : "",
+	    etag != NULL ? "\r\n" : "",
+	    keep_alive ? "" : "Connection: close\r\n");
+	assert(hlen > 0 && hlen < FILE_BUFFER_SIZE);
+
+	size_t size = hlen;
+	const bool along = data != NULL && length <= FILE_BUFFER_SIZE - size;
+	if (along) {
+		memcpy(recv->fbuf + size, data, length);
+		size += length;
+	}
+	if (rsent != NULL)
+		*rsent = along;
 
 	if (verbose)
-		fprintf(stderr, "Sending response\n");
+		fprintf(stderr, "Sending response %s\n", status);
 
-	errno_t rc = tcp_conn_send(conn, (void *) msg, response_size);
+	errno_t rc = tcp_conn_send(recv->conn, recv->fbuf, size);
 	if (rc != EOK) {
 		fprintf(stderr, "tcp_conn_send() failed\n");
 		return rc;
@@ -241,20 +331,179 @@ static errno_t send_response(tcp_conn_t *conn, const char *msg)
 	return EOK;
 }
 
-static errno_t uri_get(const char *uri, tcp_conn_t *conn)
+/** Send a complete response with a body held in memory. */
+static errno_t send_response(recv_t *recv, const char *status, const char *etag,
+    const void *data, size_t size, bool keep_alive)
+{
+	bool sent;
+	errno_t rc = send_header(recv, status, etag, size, data, keep_alive,
+	    &sent);
+	if (rc != EOK || sent)
+		return rc;
+
+	const char *dp = data;
+	while (size > 0) {
+		const size_t now = min(size, (size_t) FILE_BUFFER_SIZE);
+		rc = tcp_conn_send(recv->conn, dp, now);
+		if (rc != EOK) {
+			fprintf(stderr, "tcp_conn_send() failed\n");
+			return rc;
+		}
+		dp += now;
+		size -= now;
+	}
+
+	return EOK;
+}
+
+static errno_t send_error(recv_t *recv, const char *status, const char *msg,
+    bool keep_alive)
+{
+	return send_response(recv, status, NULL, msg, str_size(msg),
+	    keep_alive);
+}
+
+/** Drop a reference to a cache entry. Call with cache_lock held. */
+static void cache_entry_put(cache_entry_t *entry)
+{
+	assert(entry->refcnt > 0);
+	if (--entry->refcnt == 0 && entry->evicted) {
+		free(entry->fname);
+		free(entry->data);
+		free(entry);
+	}
+}
+
+/** Remove entry from the cache. Call with cache_lock held. */
+static void cache_evict(cache_entry_t *entry)
+{
+	list_remove(&entry->link);
+	cache_size -= entry->size;
+	entry->evicted = true;
+
+	/* The cache's own reference */
+	cache_entry_put(entry);
+}
+
+/** Get a cached file, loading it if needed.
+ *
+ * @param fname File name
+ * @param fd Open file
+ * @param stat Attributes of @a fd
+ * @param rentry Place to store the referenced entry
+ */
+static errno_t cache_get(const char *fname, int fd, const vfs_stat_t *stat,
+    cache_entry_t **rentry)
+{
+	fibril_mutex_lock(&cache_lock);
+
+	list_foreach(cache, link, cache_entry_t, entry) {
+		if (str_cmp(entry->fname, fname) != 0)
+			continue;
+
+		if (entry->service_id != stat->service_id ||
+		    entry->index != stat->index || entry->size != stat->size) {
+			/* The file changed. */
+			cache_evict(entry);
+			break;
+		}
+
+		list_remove(&entry->link);
+		list_prepend(&entry->link, &cache);
+		entry->refcnt++;
+		fibril_mutex_unlock(&cache_lock);
+
+		*rentry = entry;
+		return EOK;
+	}
+
+	fibril_mutex_unlock(&cache_lock);
+
+	cache_entry_t *entry = calloc(1, sizeof(cache_entry_t));
+	if (entry == NULL)
+		return ENOMEM;
+
+	entry->fname = str_dup(fname);
+	entry->data = malloc(max(stat->size, 1));
+	if (entry->fname == NULL || entry->data == NULL) {
+		free(entry->fname);
+		free(entry->data);
+		free(entry);
+		return ENOMEM;
+	}
+
+	entry->service_id = stat->service_id;
+	entry->index = stat->index;
+	entry->size = stat->size;
+
+	size_t nr;
+	aoff64_t pos = 0;
+	errno_t rc = vfs_read(fd, &pos, entry->data, entry->size, &nr);
+	if (rc == EOK && nr != entry->size)
+		rc = EIO;
+	if (rc != EOK) {
+		free(entry->fname);
+		free(entry->data);
+		free(entry);
+		return rc;
+	}
+
+	/* FNV-1a over the contents */
+	uint32_t hash = 2166136261U;
+	for (size_t i = 0; i < entry->size; i++)
+		hash = (hash ^ (uint8_t) entry->data[i]) * 16777619U;
+	snprintf(entry->etag, ETAG_SIZE, "\"%08" PRIx32 "-%zx\"", hash,
+	    entry->size);
+
+	/* One reference for the cache, one for the caller */
+	entry->refcnt = 2;
+
+	fibril_mutex_lock(&cache_lock);
+	while (cache_size + entry->size > CACHE_SIZE_MAX && !list_empty(&cache)) {
+		cache_evict(list_get_instance(list_last(&cache), cache_entry_t,
+		    link));
+	}
+	list_prepend(&entry->link, &cache);
+	cache_size += entry->size;
+	fibril_mutex_unlock(&cache_lock);
+
+	*rentry = entry;
+	return EOK;
+}
+
+/** Serve a small file from the cache. */
+static errno_t uri_get_cached(recv_t *recv, req_t *req, const char *fname,
+    int fd, const vfs_stat_t *stat)
+{
+	cache_entry_t *entry;
+
+	errno_t rc = cache_get(fname, fd, stat, &entry);
+	if (rc != EOK)
+		return rc;
+
+	if (str_cmp(req->if_none_match, entry->etag) == 0 ||
+	    str_cmp(req->if_none_match, "*") == 0) {
+		rc = send_header(recv, "304 Not Modified", entry->etag, 0,
+		    NULL, req->keep_alive, NULL);
+	} else {
+		rc = send_response(recv, "200 OK", entry->etag, entry->data,
+		    entry->size, req->keep_alive);
+	}
+
+	fibril_mutex_lock(&cache_lock);
+	cache_entry_put(entry);
+	fibril_mutex_unlock(&cache_lock);
+
+	return rc;
+}
+
+static errno_t uri_get(const char *uri, recv_t *recv, req_t *req)
 {
-	char *fbuf = NULL;
 	char *fname = NULL;
 	errno_t rc;
 	size_t nr;
 	int fd = -1;
 
-	fbuf = calloc(BUFFER_SIZE, 1);
-	if (fbuf == NULL) {
-		rc = ENOMEM;
-		goto out;
-	}
-
 	if (str_cmp(uri, "/") == 0)
 		uri = "/index.html";
 
@@ -265,27 +514,47 @@ static errno_t uri_get(const char *uri, tcp_conn_t *conn)
 
 	rc = vfs_lookup_open(fname, WALK_REGULAR, MODE_READ, &fd);
 	if (rc != EOK) {
-		rc = send_response(conn, msg_not_found);
+		rc = send_error(recv, "404 Not Found", msg_not_found,
+		    req->keep_alive);
+		goto out;
+	}
+
+	vfs_stat_t stat;
+	rc = vfs_stat(fd, &stat);
+	if (rc != EOK)
 		goto out;
+
+	if (stat.size <= CACHE_FILE_MAX) {
+		rc = uri_get_cached(recv, req, fname, fd, &stat);
+		if (rc != ENOMEM)
+			goto out;
+		/* Serve it directly if there is no memory to cache it. */
 	}
 
 	free(fname);
 	fname = NULL;
 
-	rc = send_response(conn, msg_ok);
+	/* Large files are read and sent in big blocks. */
+	rc = send_header(recv, "200 OK", NULL, stat.size, NULL,
+	    req->keep_alive, NULL);
 	if (rc != EOK)
 		goto out;
 
 	aoff64_t pos = 0;
-	while (true) {
-		rc = vfs_read(fd, &pos, fbuf, BUFFER_SIZE, &nr);
+	while (pos < stat.size) {
+		const aoff64_t left = stat.size - pos;
+
+		rc = vfs_read(fd, &pos, recv->fbuf, FILE_BUFFER_SIZE, &nr);
 		if (rc != EOK)
 			goto out;
 
-		if (nr == 0)
-			break;
+		if (nr == 0) {
+			/* The file shrank, the promised length cannot be met. */
+			rc = EIO;
+			goto out;
+		}
 
-		rc = tcp_conn_send(conn, fbuf, nr);
+		rc = tcp_conn_send(recv->conn, recv->fbuf, min(nr, left));
 		if (rc != EOK) {
 			fprintf(stderr, "tcp_conn_send() failed\n");
 			goto out;
@@ -297,17 +566,59 @@ out:
 	if (fd >= 0)
 		vfs_put(fd);
 	free(fname);
-	free(fbuf);
 	return rc;
 }
 
-static errno_t req_process(tcp_conn_t *conn, recv_t *recv)
+/** Receive header fields the response depends on, up to the empty line. */
+static errno_t req_recv_headers(recv_t *recv, req_t *req)
+{
+	char *line;
+
+	while (true) {
+		errno_t rc = recv_line(recv, &line);
+		if (rc != EOK)
+			return rc;
+
+		if (str_cmp(line, "\r\n") == 0)
+			return EOK;
+
+		/* Strip CRLF */
+		line[str_size(line) - 2] = '\0';
+
+		char *value = str_chr(line, ':');
+		if (value == NULL)
+			continue;
+		*value++ = '\0';
+		while (*value == ' ' || *value == '\t')
+			value++;
+
+		if (str_casecmp(line, "Connection") == 0) {
+			if (str_casecmp(value, "close") == 0)
+				req->keep_alive = false;
+			else if (str_casecmp(value, "keep-alive") == 0)
+				req->keep_alive = true;
+		} else if (str_casecmp(line, "If-None-Match") == 0) {
+			str_cpy(req->if_none_match, ETAG_SIZE, value);
+		}
+	}
+}
+
+/** Process one request.
+ *
+ * @param recv Connection
+ * @param keep_alive Place to store whether another request may follow
+ */
+static errno_t req_process(recv_t *recv, bool *keep_alive)
 {
 	char *reqline = NULL;
+	req_t req;
+
+	*keep_alive = false;
 
 	errno_t rc = recv_line(recv, &reqline);
 	if (rc != EOK) {
-		fprintf(stderr, "recv_line() failed\n");
+		if (!recv->closed)
+			fprintf(stderr, "recv_line() failed\n");
 		return rc;
 	}
 
@@ -315,8 +626,9 @@ static errno_t req_process(tcp_conn_t *conn, recv_t *recv)
 		fprintf(stderr, "Request: %s", reqline);
 
 	if (str_lcmp(reqline, "GET ", 4) != 0) {
-		rc = send_response(conn, msg_not_implemented);
-		return rc;
+		/* The request might carry a body we do not understand. */
+		return send_error(recv, "501 Not Implemented",
+		    msg_not_implemented, false);
 	}
 
 	char *uri = reqline + 4;
@@ -330,12 +642,31 @@ static errno_t req_process(tcp_conn_t *conn, recv_t *recv)
 	if (verbose)
 		fprintf(stderr, "Requested URI: %s\n", uri);
 
-	if (!uri_is_valid(uri)) {
-		rc = send_response(conn, msg_bad_request);
+	/* HTTP/1.1 connections persist unless the client says otherwise. */
+	memset(&req, 0, sizeof(req));
+	req.keep_alive = str_lcmp(end_uri + 1, "HTTP/1.1", 8) == 0;
+
+	/* The request line is overwritten by the header lines. */
+	char *uri_copy = str_dup(uri);
+	if (uri_copy == NULL)
+		return ENOMEM;
+
+	rc = req_recv_headers(recv, &req);
+	if (rc != EOK) {
+		free(uri_copy);
 		return rc;
 	}
 
-	return uri_get(uri, conn);
+	if (!uri_is_valid(uri_copy)) {
+		rc = send_error(recv, "400 Bad Request", msg_bad_request,
+		    req.keep_alive);
+	} else {
+		rc = uri_get(uri_copy, recv, &req);
+	}
+
+	free(uri_copy);
+	*keep_alive = req.keep_alive;
+	return rc;
 }
 
 static void usage(void)
@@ -414,11 +745,17 @@ static void websrv_new_conn(tcp_listener_t *lst, tcp_conn_t *conn)
 		goto error;
 	}
 
-	rc = req_process(conn, recv);
-	if (rc != EOK) {
-		fprintf(stderr, "Error processing request (%s)\n",
-		    str_error(rc));
-		goto error;
+	/* Requests are served in order, pipelined ones wait in rbuf. */
+	bool keep_alive = true;
+	while (keep_alive) {
+		rc = req_process(recv, &keep_alive);
+		if (rc == ENOTCONN && recv->closed)
+			break;
+		if (rc != EOK) {
+			fprintf(stderr, "Error processing request (%s)\n",
+			    str_error(rc));
+			goto error;
+		}
 	}
 
 	rc = tcp_conn_send_fin(conn);
@@ -40,6 +40,7 @@
 #include <errno.h>
 #include <fibril_synch.h>
 #include <macros.h>
+#include <mem.h>
 #include <stdint.h>
 
 #include "codec.h"
@@ -338,6 +339,51 @@ static void hda_rirb_fini(hda_t *hda)
 		dmamem_unmap_anonymous(hda->ctl->rirb_virt);
 }
 
+/** Initialize the DMA position buffer
+ *
+ * The controller then writes the position of every stream descriptor
+ * to memory, so the position can be read without a register access.
+ */
+static errno_t hda_dmapos_init(hda_t *hda)
+{
+	void *dmapos;
+	errno_t rc;
+
+	ddf_msg(LVL_NOTE, "hda_dmapos_init()");
+
+	/*
+	 * DMA position buffer must be aligned to 128 bytes. If 64OK is not
+	 * set, it must be within the 32-bit address space.
+	 */
+	dmapos = AS_AREA_ANY;
+	rc = dmamem_map_anonymous(64 * sizeof(hda_dmapos_entry_t),
+	    hda->ctl->ok64bit ? 0 : DMAMEM_4GiB, AS_AREA_READ | AS_AREA_WRITE, 0,
+	    &hda->ctl->dmapos_phys, &dmapos);
+	if (rc != EOK) {
+		ddf_msg(LVL_NOTE, "Failed allocating DMA position buffer");
+		return rc;
+	}
+
+	memset(dmapos, 0, 64 * sizeof(hda_dmapos_entry_t));
+	hda->ctl->dmapos = dmapos;
+
+	hda_reg32_write(&hda->regs->dpubase, UPPER32(hda->ctl->dmapos_phys));
+	hda_reg32_write(&hda->regs->dplbase, LOWER32(hda->ctl->dmapos_phys) |
+	    BIT_V(uint32_t, dplbase_dpbe));
+	return EOK;
+}
+
+/** Tear down the DMA position buffer */
+static void hda_dmapos_fini(hda_t *hda)
+{
+	if (hda->ctl->dmapos == NULL)
+		return;
+
+	hda_reg32_write(&hda->regs->dplbase, 0);
+	dmamem_unmap_anonymous(hda->ctl->dmapos);
+	hda->ctl->dmapos = NULL;
+}
+
 static size_t hda_get_corbrp(hda_t *hda)
 {
 	uint16_t corbrp;
@@ -600,6 +646,11 @@ hda_ctl_t *hda_ctl_init(hda_t *hda)
 	if (rc != EOK)
 		goto error;
 
+	/* Not fatal, stream positions are then read from the registers */
+	rc = hda_dmapos_init(hda);
+	if (rc != EOK)
+		ddf_msg(LVL_WARN, "DMA position buffer not available");
+
 	ddf_msg(LVL_NOTE, "call hda_codec_init()");
 	hda->ctl->codec = hda_codec_init(hda, 0);
 	if (hda->ctl->codec == NULL) {
@@ -613,6 +664,7 @@ hda_ctl_t *hda_ctl_init(hda_t *hda)
 
 	return ctl;
 error:
+	hda_dmapos_fini(hda);
 	hda_rirb_fini(hda);
 	hda_corb_fini(hda);
 	free(ctl);
@@ -623,6 +675,7 @@ error:
 void hda_ctl_fini(hda_ctl_t *ctl)
 {
 	ddf_msg(LVL_NOTE, "hda_ctl_fini()");
+	hda_dmapos_fini(ctl->hda);
 	hda_rirb_fini(ctl->hda);
 	hda_corb_fini(ctl->hda);
 	free(ctl);
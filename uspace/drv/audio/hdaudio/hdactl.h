@@ -60,6 +60,10 @@ typedef struct hda_ctl {
 	size_t rirb_entries;
 	size_t rirb_rp;
 
+	/** DMA position buffer, NULL if not available */
+	uintptr_t dmapos_phys;
+	hda_dmapos_entry_t *dmapos;
+
 	fibril_mutex_t solrb_lock;
 	fibril_condvar_t solrb_cv;
 	hda_rirb_entry_t solrb[softrb_entries];
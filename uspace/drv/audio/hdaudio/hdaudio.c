@@ -48,6 +48,7 @@
 #include "hdaudio.h"
 #include "pcm_iface.h"
 #include "spec/regs.h"
+#include "stream.h"
 
 #define NAME "hdaudio"
 
@@ -378,16 +379,16 @@ static void hdaudio_interrupt(ipc_call_t *icall, ddf_dev_t *dev)
 	if (IPC_GET_ARG3(*icall) != 0) {
 		/* Buffer completed */
 		hda_lock(hda);
-		if (hda->playing) {
-			hda_pcm_event(hda, PCM_EVENT_FRAMES_PLAYED);
-			hda_pcm_event(hda, PCM_EVENT_FRAMES_PLAYED);
-			hda_pcm_event(hda, PCM_EVENT_FRAMES_PLAYED);
-			hda_pcm_event(hda, PCM_EVENT_FRAMES_PLAYED);
-		} else if (hda->capturing) {
-			hda_pcm_event(hda, PCM_EVENT_FRAMES_CAPTURED);
-			hda_pcm_event(hda, PCM_EVENT_FRAMES_CAPTURED);
-			hda_pcm_event(hda, PCM_EVENT_FRAMES_CAPTURED);
-			hda_pcm_event(hda, PCM_EVENT_FRAMES_CAPTURED);
+		if (hda->pcm_stream != NULL && hda->pcm_buffers->ioc) {
+			/* One event for each completed period */
+			size_t n = hda_stream_buffers_completed(hda->pcm_stream);
+
+			while (n-- > 0) {
+				if (hda->playing)
+					hda_pcm_event(hda, PCM_EVENT_FRAMES_PLAYED);
+				else if (hda->capturing)
+					hda_pcm_event(hda, PCM_EVENT_FRAMES_CAPTURED);
+			}
 		}
 
 		hda_unlock(hda);
@@ -81,7 +81,11 @@ audio_pcm_iface_t hda_pcm_iface = {
 };
 
 enum {
-	max_buffer_size = 65536 /* XXX this is completely arbitrary */
+	max_buffer_size = 65536, /* XXX this is completely arbitrary */
+	/** Frame size of the only supported format (16-bit stereo) */
+	frame_size = 4,
+	/** Smallest period, one aligned buffer descriptor */
+	min_period_frames = hda_buf_align / frame_size
 };
 
 static hda_t *fun_to_hda(ddf_fun_t *fun)
@@ -111,13 +115,13 @@ static unsigned hda_query_cap(ddf_fun_t *fun, audio_cap_t cap)
 		/* Yes if we have an input converter */
 		return hda->ctl->codec->in_aw >= 0;
 	case AUDIO_CAP_BUFFER_POS:
-		return 0;
+		return 1;
 	case AUDIO_CAP_MAX_BUFFER:
 		return max_buffer_size;
 	case AUDIO_CAP_INTERRUPT_MIN_FRAMES:
-		return 128;
+		return min_period_frames;
 	case AUDIO_CAP_INTERRUPT_MAX_FRAMES:
-		return 16384;
+		return max_buffer_size / 2 / frame_size;
 	default:
 		return -1;
 	}
@@ -162,8 +166,15 @@ static errno_t hda_get_buffer(ddf_fun_t *fun, void **buffer, size_t *size)
 		return EBUSY;
 	}
 
+	/*
+	 * Clients that want low latency ask for a small buffer, the default
+	 * is the largest one.
+	 */
+	if (*size == 0 || *size > max_buffer_size)
+		*size = max_buffer_size;
+
 	ddf_msg(LVL_NOTE, "hda_get_buffer() - allocate stream buffers");
-	rc = hda_stream_buffers_alloc(hda, &hda->pcm_buffers);
+	rc = hda_stream_buffers_alloc(hda, *size, &hda->pcm_buffers);
 	if (rc != EOK) {
 		assert(rc == ENOMEM);
 		hda_unlock(hda);
@@ -171,9 +182,8 @@ static errno_t hda_get_buffer(ddf_fun_t *fun, void **buffer, size_t *size)
 	}
 
 	ddf_msg(LVL_NOTE, "hda_get_buffer() - fill info");
-	/* XXX This is only one buffer */
-	*buffer = hda->pcm_buffers->buf[0];
-	*size = hda->pcm_buffers->bufsize * hda->pcm_buffers->nbuffers;
+	*buffer = hda->pcm_buffers->buf;
+	*size = hda->pcm_buffers->size;
 
 	ddf_msg(LVL_NOTE, "hda_get_buffer() returing EOK, buffer=%p, size=%zu",
 	    *buffer, *size);
@@ -184,8 +194,35 @@ static errno_t hda_get_buffer(ddf_fun_t *fun, void **buffer, size_t *size)
 
 static errno_t hda_get_buffer_position(ddf_fun_t *fun, size_t *pos)
 {
-	ddf_msg(LVL_NOTE, "hda_get_buffer_position()");
-	return ENOTSUP;
+	hda_t *hda = fun_to_hda(fun);
+
+	hda_lock(hda);
+	if (hda->pcm_stream == NULL) {
+		hda_unlock(hda);
+		return EINVAL;
+	}
+
+	*pos = hda_stream_get_position(hda->pcm_stream);
+	hda_unlock(hda);
+	return EOK;
+}
+
+/** Divide the buffer into periods of the requested size.
+ *
+ * @param hda Device
+ * @param frames Period size in frames, zero if no events are wanted
+ * @return EOK on success or an error code
+ */
+static errno_t hda_set_period(hda_t *hda, unsigned frames)
+{
+	if (hda->pcm_buffers == NULL)
+		return EINVAL;
+
+	if (frames != 0 && frames < min_period_frames)
+		frames = min_period_frames;
+
+	return hda_stream_buffers_set_period(hda->pcm_buffers,
+	    frames * frame_size);
 }
 
 static errno_t hda_set_event_session(ddf_fun_t *fun, async_sess_t *sess)
@@ -252,6 +289,12 @@ static errno_t hda_start_playback(ddf_fun_t *fun, unsigned frames,
 	/* 48 kHz, 16-bits, 1 channel */
 	fmt = (fmt_base_44khz << fmt_base) | (fmt_bits_16 << fmt_bits_l) | 1;
 
+	rc = hda_set_period(hda, frames);
+	if (rc != EOK) {
+		hda_unlock(hda);
+		return rc;
+	}
+
 	ddf_msg(LVL_NOTE, "hda_start_playback() - create output stream");
 	hda->pcm_stream = hda_stream_create(hda, sdir_output, hda->pcm_buffers,
 	    fmt);
@@ -311,6 +354,12 @@ static errno_t hda_start_capture(ddf_fun_t *fun, unsigned frames, unsigned chann
 	/* 48 kHz, 16-bits, 1 channel */
 	fmt = (fmt_base_44khz << fmt_base) | (fmt_bits_16 << fmt_bits_l) | 1;
 
+	rc = hda_set_period(hda, frames);
+	if (rc != EOK) {
+		hda_unlock(hda);
+		return rc;
+	}
+
 	ddf_msg(LVL_NOTE, "hda_start_capture() - create input stream");
 	hda->pcm_stream = hda_stream_create(hda, sdir_input, hda->pcm_buffers,
 	    fmt);
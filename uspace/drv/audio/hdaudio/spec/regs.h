@@ -286,6 +286,19 @@ typedef enum {
 	rirbsize_size_l = 0
 } hda_rirbsize_bits_t;
 
+typedef enum {
+	/** DMA Position Buffer Enable */
+	dplbase_dpbe = 0
+} hda_dplbase_bits_t;
+
+/** DMA Position Buffer entry, one for each stream descriptor */
+typedef struct {
+	/** Link Position in Current Buffer */
+	uint32_t lpib;
+	/** Reserved */
+	uint32_t reserved;
+} hda_dmapos_entry_t;
+
 typedef struct {
 	/** Response - data received from codec */
 	uint32_t resp;
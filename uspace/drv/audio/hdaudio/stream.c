@@ -32,6 +32,7 @@
 /** @file High Definition Audio stream
  */
 
+#include <align.h>
 #include <as.h>
 #include <bitops.h>
 #include <byteorder.h>
@@ -48,14 +49,20 @@
 #include "spec/bdl.h"
 #include "stream.h"
 
-errno_t hda_stream_buffers_alloc(hda_t *hda, hda_stream_buffers_t **rbufs)
+/** Allocate stream buffers.
+ *
+ * @param hda Device
+ * @param size Requested size of the cyclic buffer, zero for the default
+ * @param rbufs Place to store pointer to the new buffers
+ * @return EOK on success or an error code
+ */
+errno_t hda_stream_buffers_alloc(hda_t *hda, size_t size,
+    hda_stream_buffers_t **rbufs)
 {
 	void *bdl;
 	void *buffer;
 	uintptr_t buffer_phys;
 	hda_stream_buffers_t *bufs = NULL;
-	size_t i;
-	//size_t j, k;
 	errno_t rc;
 
 	bufs = calloc(1, sizeof(hda_stream_buffers_t));
@@ -64,15 +71,20 @@ errno_t hda_stream_buffers_alloc(hda_t *hda, hda_stream_buffers_t **rbufs)
 		goto error;
 	}
 
-	bufs->nbuffers = 4;
-	bufs->bufsize = 16384;
+	/*
+	 * Every buffer descriptor needs to start at a 128-byte boundary and
+	 * the cyclic buffer needs at least two of them.
+	 */
+	bufs->size = ALIGN_UP(size, hda_buf_align);
+	if (bufs->size < 2 * hda_buf_align)
+		bufs->size = 2 * hda_buf_align;
 
 	/*
 	 * BDL must be aligned to 128 bytes. If 64OK is not set,
 	 * it must be within the 32-bit address space.
 	 */
 	bdl = AS_AREA_ANY;
-	rc = dmamem_map_anonymous(bufs->nbuffers * sizeof(hda_buffer_desc_t),
+	rc = dmamem_map_anonymous(hda_bdl_max_entries * sizeof(hda_buffer_desc_t),
 	    hda->ctl->ok64bit ? 0 : DMAMEM_4GiB, AS_AREA_READ | AS_AREA_WRITE,
 	    0, &bufs->bdl_phys, &bdl);
 	if (rc != EOK)
@@ -80,45 +92,9 @@ errno_t hda_stream_buffers_alloc(hda_t *hda, hda_stream_buffers_t **rbufs)
 
 	bufs->bdl = bdl;
 
-	/* Allocate arrays of buffer pointers */
-
-	bufs->buf = calloc(bufs->nbuffers, sizeof(void *));
-	if (bufs->buf == NULL)
-		goto error;
-
-	bufs->buf_phys = calloc(bufs->nbuffers, sizeof(uintptr_t));
-	if (bufs->buf_phys == NULL)
-		goto error;
-
-	/* Allocate buffers */
-#if 0
-	for (i = 0; i < bufs->nbuffers; i++) {
-		buffer = AS_AREA_ANY;
-		rc = dmamem_map_anonymous(bufs->bufsize,
-		    bufs->hda->ctl->ok64bit ? 0 : DMAMEM_4GiB, AS_AREA_READ | AS_AREA_WRITE,
-		    0, &buffer_phys, &buffer);
-		if (rc != EOK)
-			goto error;
-
-		ddf_msg(LVL_NOTE, "Stream buf phys=0x%llx virt=%p",
-		    (unsigned long long)buffer_phys, buffer);
-
-		bufs->buf[i] = buffer;
-		bufs->buf_phys[i] = buffer_phys;
-
-		k = 0;
-		for (j = 0; j < bufs->bufsize / 2; j++) {
-			int16_t *bp = bufs->buf[i];
-			bp[j] = (k > 128) ? -100 : 100;
-			++k;
-			if (k >= 256)
-				k = 0;
-		}
-	}
-#endif
 	/* audio_pcm_iface requires a single contiguous buffer */
 	buffer = AS_AREA_ANY;
-	rc = dmamem_map_anonymous(bufs->bufsize * bufs->nbuffers,
+	rc = dmamem_map_anonymous(bufs->size,
 	    hda->ctl->ok64bit ? 0 : DMAMEM_4GiB, AS_AREA_READ | AS_AREA_WRITE,
 	    0, &buffer_phys, &buffer);
 	if (rc != EOK) {
@@ -126,21 +102,16 @@ errno_t hda_stream_buffers_alloc(hda_t *hda, hda_stream_buffers_t **rbufs)
 		goto error;
 	}
 
-	for (i = 0; i < bufs->nbuffers; i++) {
-		bufs->buf[i] = buffer + i * bufs->bufsize;
-		bufs->buf_phys[i] = buffer_phys + i * bufs->bufsize;
+	bufs->buf = buffer;
+	bufs->buf_phys = buffer_phys;
 
-		ddf_msg(LVL_NOTE, "Stream buf phys=0x%llx virt=%p",
-		    (long long unsigned)(uintptr_t)bufs->buf[i],
-		    (void *)bufs->buf_phys[i]);
-	}
+	ddf_msg(LVL_NOTE, "Stream buf phys=0x%llx virt=%p size=%zu",
+	    (unsigned long long)bufs->buf_phys, bufs->buf, bufs->size);
 
-	/* Fill in BDL */
-	for (i = 0; i < bufs->nbuffers; i++) {
-		bufs->bdl[i].address = host2uint64_t_le(bufs->buf_phys[i]);
-		bufs->bdl[i].length = host2uint32_t_le(bufs->bufsize);
-		bufs->bdl[i].flags = BIT_V(uint32_t, bdf_ioc);
-	}
+	/* Until the client chooses, use two buffers without interrupts */
+	rc = hda_stream_buffers_set_period(bufs, 0);
+	if (rc != EOK)
+		goto error;
 
 	*rbufs = bufs;
 	return EOK;
@@ -149,12 +120,62 @@ error:
 	return ENOMEM;
 }
 
+/** Split stream buffer into periods.
+ *
+ * The cyclic buffer is described by one buffer descriptor for each
+ * period. The controller interrupts at the end of each of them.
+ *
+ * @param bufs Stream buffers
+ * @param period Period size in bytes, zero if no interrupts are wanted
+ * @return EOK on success or an error code
+ */
+errno_t hda_stream_buffers_set_period(hda_stream_buffers_t *bufs,
+    size_t period)
+{
+	size_t i;
+
+	bufs->ioc = period != 0;
+	if (period == 0)
+		period = bufs->size / 2;
+
+	/* Buffers need to be aligned and there need to be at least two */
+	period = ALIGN_UP(period, hda_buf_align);
+	if (period > bufs->size / 2)
+		period = ALIGN_DOWN(bufs->size / 2, hda_buf_align);
+	if (period < bufs->size / hda_bdl_max_entries)
+		period = ALIGN_UP(bufs->size / hda_bdl_max_entries,
+		    hda_buf_align);
+
+	bufs->bufsize = period;
+	bufs->nbuffers = (bufs->size + period - 1) / period;
+	if (bufs->nbuffers > hda_bdl_max_entries)
+		return EINVAL;
+
+	/* Fill in BDL, the last buffer may be shorter */
+	for (i = 0; i < bufs->nbuffers; i++) {
+		size_t offs = i * period;
+
+		bufs->bdl[i].address = host2uint64_t_le(bufs->buf_phys + offs);
+		bufs->bdl[i].length = host2uint32_t_le(min(period,
+		    bufs->size - offs));
+		bufs->bdl[i].flags = bufs->ioc ?
+		    host2uint32_t_le(BIT_V(uint32_t, bdf_ioc)) : 0;
+	}
+
+	ddf_msg(LVL_NOTE, "Stream buffers: %zu x %zu bytes, ioc=%d",
+	    bufs->nbuffers, bufs->bufsize, bufs->ioc);
+	return EOK;
+}
+
 void hda_stream_buffers_free(hda_stream_buffers_t *bufs)
 {
 	if (bufs == NULL)
 		return;
 
-	/* XXX */
+	if (bufs->buf != NULL)
+		dmamem_unmap_anonymous(bufs->buf);
+	if (bufs->bdl != NULL)
+		dmamem_unmap_anonymous(bufs->bdl);
 	free(bufs);
 }
 
@@ -166,16 +187,18 @@ static void hda_stream_desc_configure(hda_stream_t *stream)
 	uint8_t ctl3;
 
 	ctl3 = (stream->sid << 4);
-	ctl1 = 0x4;
+	ctl1 = bufs->ioc ? BIT_V(uint8_t, sdctl1_ioce) : 0;
 
 	sdregs = &stream->hda->regs->sdesc[stream->sdid];
 	hda_reg8_write(&sdregs->ctl3, ctl3);
 	hda_reg8_write(&sdregs->ctl1, ctl1);
-	hda_reg32_write(&sdregs->cbl, bufs->nbuffers * bufs->bufsize);
+	hda_reg32_write(&sdregs->cbl, bufs->size);
 	hda_reg16_write(&sdregs->lvi, bufs->nbuffers - 1);
 	hda_reg16_write(&sdregs->fmt, stream->fmt);
 	hda_reg32_write(&sdregs->bdpl, LOWER32(bufs->bdl_phys));
 	hda_reg32_write(&sdregs->bdpu, UPPER32(bufs->bdl_phys));
+
+	stream->last_buffer = 0;
 }
 
 static void hda_stream_set_run(hda_stream_t *stream, bool run)
@@ -278,5 +301,54 @@ void hda_stream_reset(hda_stream_t *stream)
 	hda_stream_desc_configure(stream);
 }
 
+/** Get stream position.
+ *
+ * The position is taken from the DMA position buffer if the controller
+ * provides it, which avoids a register read.
+ *
+ * @param stream Stream
+ * @return Position within the cyclic buffer in bytes
+ */
+size_t hda_stream_get_position(hda_stream_t *stream)
+{
+	hda_ctl_t *ctl = stream->hda->ctl;
+	uint32_t pos;
+
+	if (ctl->dmapos != NULL) {
+		volatile hda_dmapos_entry_t *entry = &ctl->dmapos[stream->sdid];
+		pos = uint32_t_le2host(entry->lpib);
+	} else {
+		pos = hda_reg32_read(&stream->hda->regs->sdesc[stream->sdid].lpib);
+	}
+
+	return min(pos, stream->buffers->size - 1);
+}
+
+/** Determine number of buffers completed since the last call.
+ *
+ * Called after a buffer completion interrupt. Interrupts that were
+ * coalesced are accounted for using the stream position.
+ *
+ * @param stream Stream
+ * @return Number of completed buffers
+ */
+size_t hda_stream_buffers_completed(hda_stream_t *stream)
+{
+	hda_stream_buffers_t *bufs = stream->buffers;
+	size_t cur;
+	size_t n;
+
+	cur = min(hda_stream_get_position(stream) / bufs->bufsize,
+	    bufs->nbuffers - 1);
+	n = (cur + bufs->nbuffers - stream->last_buffer) % bufs->nbuffers;
+
+	/* The position may lag slightly behind the interrupt */
+	if (n == 0 || n > bufs->nbuffers / 2)
+		n = 1;
+
+	stream->last_buffer = (stream->last_buffer + n) % bufs->nbuffers;
+	return n;
+}
+
 /** @}
  */
@@ -35,6 +35,8 @@
 #ifndef STREAM_H
 #define STREAM_H
 
+#include <stdbool.h>
+#include <stddef.h>
 #include "hdaudio.h"
 #include "spec/bdl.h"
 
@@ -47,19 +49,30 @@ typedef enum {
 	sdir_bidi
 } hda_stream_dir_t;
 
+enum {
+	/** Maximum number of buffer descriptors */
+	hda_bdl_max_entries = 256,
+	/** Alignment of buffers described by a buffer descriptor */
+	hda_buf_align = 128
+};
+
 typedef struct hda_stream_buffers {
-	/** Number of buffers */
+	/** Number of buffers (periods) */
 	size_t nbuffers;
-	/** Buffer size */
+	/** Buffer (period) size */
 	size_t bufsize;
+	/** Size of the whole cyclic buffer */
+	size_t size;
+	/** Interrupt on completion of each buffer */
+	bool ioc;
 	/** Buffer Descriptor List */
 	hda_buffer_desc_t *bdl;
 	/** Physical address of BDL */
 	uintptr_t bdl_phys;
-	/** Buffers */
-	void **buf;
-	/** Physical addresses of buffers */
-	uintptr_t *buf_phys;
+	/** Cyclic buffer */
+	void *buf;
+	/** Physical address of the cyclic buffer */
+	uintptr_t buf_phys;
 } hda_stream_buffers_t;
 
 typedef struct hda_stream {
@@ -74,9 +87,13 @@ typedef struct hda_stream {
 	hda_stream_buffers_t *buffers;
 	/** Stream format */
 	uint32_t fmt;
+	/** Last buffer reported as completed */
+	size_t last_buffer;
 } hda_stream_t;
 
-extern errno_t hda_stream_buffers_alloc(hda_t *, hda_stream_buffers_t **);
+extern errno_t hda_stream_buffers_alloc(hda_t *, size_t,
+    hda_stream_buffers_t **);
+extern errno_t hda_stream_buffers_set_period(hda_stream_buffers_t *, size_t);
 extern void hda_stream_buffers_free(hda_stream_buffers_t *);
 extern hda_stream_t *hda_stream_create(hda_t *, hda_stream_dir_t,
     hda_stream_buffers_t *, uint32_t);
@@ -84,6 +101,8 @@ extern void hda_stream_destroy(hda_stream_t *);
 extern void hda_stream_start(hda_stream_t *);
 extern void hda_stream_stop(hda_stream_t *);
 extern void hda_stream_reset(hda_stream_t *);
+extern size_t hda_stream_get_position(hda_stream_t *);
+extern size_t hda_stream_buffers_completed(hda_stream_t *);
 
 #endif
 
@@ -31,7 +31,10 @@
  */
 
 #include <as.h>
+#include <assert.h>
 #include <errno.h>
+#include <byteorder.h>
+#include <macros.h>
 #include <stdio.h>
 #include <ddf/interrupt.h>
 #include <ddf/log.h>
@@ -45,6 +48,9 @@
 
 #define NAME  "ahci"
 
+/** Maximum number of milliseconds to wait for a port to stop. */
+#define AHCI_PORT_STOP_TIMEOUT  500
+
 #define LO(ptr) \
 	((uint32_t) (((uint64_t) ((uintptr_t) (ptr))) & 0xffffffff))
 
@@ -113,11 +119,14 @@ static errno_t get_num_blocks(ddf_fun_t *, uint64_t *);
 static errno_t get_block_size(ddf_fun_t *, size_t *);
 static errno_t read_blocks(ddf_fun_t *, uint64_t, size_t, void *);
 static errno_t write_blocks(ddf_fun_t *, uint64_t, size_t, void *);
+static errno_t discard_blocks(ddf_fun_t *, const bd_extent_t *, size_t);
 
 static errno_t ahci_identify_device(sata_dev_t *);
 static errno_t ahci_set_highest_ultra_dma_mode(sata_dev_t *);
-static errno_t ahci_rb_fpdma(sata_dev_t *, uintptr_t, uint64_t);
-static errno_t ahci_wb_fpdma(sata_dev_t *, uintptr_t, uint64_t);
+static errno_t ahci_rw_fpdma(sata_dev_t *, bool, uint64_t, size_t, void *);
+static errno_t ahci_trim(sata_dev_t *, const bd_extent_t *, size_t);
+static void ahci_xfer_retire(sata_dev_t *, ahci_xfer_t *);
+static void ahci_ncq_complete(sata_dev_t *, ahci_port_is_t);
 
 static void ahci_sata_devices_create(ahci_dev_t *, ddf_dev_t *);
 static ahci_dev_t *ahci_ahci_create(ddf_dev_t *);
@@ -139,7 +148,8 @@ static ahci_iface_t ahci_interface = {
 	.get_num_blocks = &get_num_blocks,
 	.get_block_size = &get_block_size,
 	.read_blocks = &read_blocks,
-	.write_blocks = &write_blocks
+	.write_blocks = &write_blocks,
+	.discard_blocks = &discard_blocks
 };
 
 static ddf_dev_ops_t ahci_ops = {
@@ -229,32 +239,7 @@ static errno_t read_blocks(ddf_fun_t *fun, uint64_t blocknum,
 {
 	sata_dev_t *sata = fun_sata_dev(fun);
 
-	uintptr_t phys;
-	void *ibuf = AS_AREA_ANY;
-	errno_t rc = dmamem_map_anonymous(sata->block_size, DMAMEM_4GiB,
-	    AS_AREA_READ | AS_AREA_WRITE, 0, &phys, &ibuf);
-	if (rc != EOK) {
-		ddf_msg(LVL_ERROR, "Cannot allocate read buffer.");
-		return rc;
-	}
-
-	memset(buf, 0, sata->block_size);
-
-	fibril_mutex_lock(&sata->lock);
-
-	for (size_t cur = 0; cur < count; cur++) {
-		rc = ahci_rb_fpdma(sata, phys, blocknum + cur);
-		if (rc != EOK)
-			break;
-
-		memcpy((void *) (((uint8_t *) buf) + (sata->block_size * cur)),
-		    ibuf, sata->block_size);
-	}
-
-	fibril_mutex_unlock(&sata->lock);
-	dmamem_unmap_anonymous(ibuf);
-
-	return rc;
+	return ahci_rw_fpdma(sata, false, blocknum, count, buf);
 }
 
 /** Write data blocks into SATA device.
@@ -272,29 +257,24 @@ static errno_t write_blocks(ddf_fun_t *fun, uint64_t blocknum,
 {
 	sata_dev_t *sata = fun_sata_dev(fun);
 
-	uintptr_t phys;
-	void *ibuf = AS_AREA_ANY;
-	errno_t rc = dmamem_map_anonymous(sata->block_size, DMAMEM_4GiB,
-	    AS_AREA_READ | AS_AREA_WRITE, 0, &phys, &ibuf);
-	if (rc != EOK) {
-		ddf_msg(LVL_ERROR, "Cannot allocate write buffer.");
-		return rc;
-	}
-
-	fibril_mutex_lock(&sata->lock);
-
-	for (size_t cur = 0; cur < count; cur++) {
-		memcpy(ibuf, (void *) (((uint8_t *) buf) + (sata->block_size * cur)),
-		    sata->block_size);
-		rc = ahci_wb_fpdma(sata, phys, blocknum + cur);
-		if (rc != EOK)
-			break;
-	}
+	return ahci_rw_fpdma(sata, true, blocknum, count, buf);
+}
 
-	fibril_mutex_unlock(&sata->lock);
-	dmamem_unmap_anonymous(ibuf);
+/** Discard data blocks of SATA device.
+ *
+ * @param fun Device function handling the call.
+ * @param ext Extents to discard.
+ * @param cnt Number of extents.
+ *
+ * @return EOK if succeed, error code otherwise
+ *
+ */
+static errno_t discard_blocks(ddf_fun_t *fun, const bd_extent_t *ext,
+    size_t cnt)
+{
+	sata_dev_t *sata = fun_sata_dev(fun);
 
-	return rc;
+	return ahci_trim(sata, ext, cnt);
 }
 
 /*----------------------------------------------------------------------------*/
@@ -469,6 +449,8 @@ static errno_t ahci_identify_device(sata_dev_t *sata)
 
 	ahci_get_model_name(idata->model_name, sata->model);
 
+	sata->ncq_depth = (idata->queue_depth & 0x1f) + 1;
+
 	/*
 	 * Due to QEMU limitation (as of 2012-06-22),
 	 * only NCQ FPDMA mode is supported.
@@ -525,6 +507,12 @@ static errno_t ahci_identify_device(sata_dev_t *sata)
 		}
 	}
 
+	if ((!sata->is_packet_device) && ((idata->dsm & sata_dsm_trim) != 0)) {
+		sata->trim = true;
+		sata->dsm_max_blocks = min(max(idata->dsm_max_blocks, 1),
+		    AHCI_SLOT_BUF_SIZE / SATA_DSM_BLOCK_SIZE);
+	}
+
 	uint8_t udma_mask = idata->udma & 0x007f;
 	sata->highest_udma_mode = (uint8_t) -1;
 	if (udma_mask == 0) {
@@ -668,23 +656,197 @@ error:
 	return EINTR;
 }
 
-/** Set AHCI registers for reading one sector from the SATA device using FPDMA.
+/** Allocate NCQ command slot for a transfer.
+ *
+ * If all slots are in use, completed commands of the transfer are
+ * retired while waiting, so that a transfer never waits for its own
+ * slots.
+ *
+ * @param sata SATA device structure, locked.
+ * @param xfer Transfer.
+ *
+ * @return Allocated slot.
+ *
+ */
+static ahci_slot_t *ahci_slot_get(sata_dev_t *sata, ahci_xfer_t *xfer)
+{
+	while ((sata->free_head < 0) || (sata->exclusive)) {
+		if ((xfer->head >= 0) && (sata->slots[xfer->head].done))
+			ahci_xfer_retire(sata, xfer);
+		else
+			fibril_condvar_wait(&sata->slot_cv, &sata->lock);
+	}
+
+	ahci_slot_t *slot = &sata->slots[sata->free_head];
+	sata->free_head = slot->next;
+
+	slot->done = false;
+	slot->rc = EOK;
+	slot->next = -1;
+	slot->dest = NULL;
+	slot->size = 0;
+
+	if (xfer->tail >= 0)
+		sata->slots[xfer->tail].next = slot->tag;
+	else
+		xfer->head = slot->tag;
+
+	xfer->tail = slot->tag;
+
+	return slot;
+}
+
+/** Retire the oldest command of a transfer.
+ *
+ * The command must be completed. Data read into the bounce buffer is
+ * copied to its destination and the slot is returned to the free list.
+ *
+ * @param sata SATA device structure, locked.
+ * @param xfer Transfer.
+ *
+ */
+static void ahci_xfer_retire(sata_dev_t *sata, ahci_xfer_t *xfer)
+{
+	ahci_slot_t *slot = &sata->slots[xfer->head];
+
+	assert(slot->done);
+
+	if ((slot->rc == EOK) && (slot->dest != NULL))
+		memcpy(slot->dest, slot->buf, slot->size);
+
+	if ((slot->rc != EOK) && (xfer->rc == EOK))
+		xfer->rc = slot->rc;
+
+	xfer->head = slot->next;
+	if (xfer->head < 0)
+		xfer->tail = -1;
+
+	slot->done = false;
+	slot->next = sata->free_head;
+	sata->free_head = slot->tag;
+
+	fibril_condvar_broadcast(&sata->slot_cv);
+}
+
+/** Wait until all commands of a transfer complete and retire them.
+ *
+ * @param sata SATA device structure, locked.
+ * @param xfer Transfer.
+ *
+ * @return EOK if succeed, error code of the first failed command otherwise.
+ *
+ */
+static errno_t ahci_xfer_wait(sata_dev_t *sata, ahci_xfer_t *xfer)
+{
+	while (xfer->head >= 0) {
+		if (sata->slots[xfer->head].done)
+			ahci_xfer_retire(sata, xfer);
+		else
+			fibril_condvar_wait(&sata->slot_cv, &sata->lock);
+	}
+
+	return xfer->rc;
+}
+
+/** Describe client buffer directly by the PRDT of a command slot.
+ *
+ * The buffer usually is an area shared by the client, therefore its
+ * pages need not be mapped yet. They are faulted in before their physical
+ * addresses are looked up.
+ *
+ * @param sata SATA device structure.
+ * @param slot Command slot.
+ * @param buf  Data buffer.
+ * @param size Size of the data in bytes.
+ *
+ * @return Number of PRDT entries used, zero if the buffer cannot be
+ *         accessed by the HBA directly.
+ *
+ */
+static unsigned int ahci_prdt_direct_set(sata_dev_t *sata, ahci_slot_t *slot,
+    void *buf, size_t size)
+{
+	volatile ahci_cmd_prdt_t *prdt = (ahci_cmd_prdt_t *)
+	    (&slot->cmd_table[AHCI_CMD_TABLE_PRDT_OFFSET / sizeof(uint32_t)]);
+	uint8_t *ptr = (uint8_t *) buf;
+	uint64_t next_phys = 0;
+	size_t dbc = 0;
+	unsigned int cnt = 0;
+
+	/* Data base address must be word aligned */
+	if (((uintptr_t) buf & 1) != 0)
+		return 0;
+
+	while (size > 0) {
+		size_t chunk = min(size,
+		    PAGE_SIZE - ((uintptr_t) ptr & (PAGE_SIZE - 1)));
+
+		(void) *((volatile uint8_t *) ptr);
+
+		uintptr_t phys;
+		if (as_get_physical_mapping(ptr, &phys) != EOK)
+			return 0;
+
+		if ((!sata->dma64) &&
+		    ((uint64_t) phys + chunk > ((uint64_t) 1 << 32)))
+			return 0;
+
+		if ((cnt > 0) && (phys == next_phys) &&
+		    (dbc + chunk <= AHCI_PRDT_DBC_MAX)) {
+			/* Physically contiguous with the previous entry */
+			dbc += chunk;
+		} else {
+			if (cnt == AHCI_PRDT_ENTRIES)
+				return 0;
+
+			if (cnt > 0)
+				prdt[cnt - 1].dbc = dbc - 1;
+
+			prdt[cnt].data_address_low = LO(phys);
+			prdt[cnt].data_address_upper = HI(phys);
+			prdt[cnt].reserved1 = 0;
+			prdt[cnt].reserved2 = 0;
+			prdt[cnt].ioc = 0;
+			dbc = chunk;
+			cnt++;
+		}
+
+		next_phys = (uint64_t) phys + chunk;
+		ptr += chunk;
+		size -= chunk;
+	}
+
+	if (cnt > 0)
+		prdt[cnt - 1].dbc = dbc - 1;
+
+	return cnt;
+}
+
+/** Set AHCI registers for FPDMA transfer between the device and a slot.
+ *
+ * The data is transferred directly to or from the client buffer if the
+ * HBA can access it, otherwise the bounce buffer of the slot is used.
  *
  * @param sata     SATA device structure.
- * @param phys     Physical address of buffer for sector data.
- * @param blocknum Block number to read.
+ * @param slot     Command slot.
+ * @param write    Write to the device (otherwise read).
+ * @param blocknum Number of first block.
+ * @param count    Number of blocks.
+ * @param buf      Client buffer.
  *
  */
-static void ahci_rb_fpdma_cmd(sata_dev_t *sata, uintptr_t phys,
-    uint64_t blocknum)
+static void ahci_rw_fpdma_cmd(sata_dev_t *sata, ahci_slot_t *slot,
+    bool write, uint64_t blocknum, size_t count, void *buf)
 {
 	volatile sata_ncq_command_frame_t *cmd =
-	    (sata_ncq_command_frame_t *) sata->cmd_table;
+	    (sata_ncq_command_frame_t *) slot->cmd_table;
+	volatile ahci_cmdhdr_t *cmd_header = &sata->cmd_header[slot->tag];
+	size_t size = count * sata->block_size;
 
 	cmd->fis_type = SATA_CMD_FIS_TYPE;
 	cmd->c = SATA_CMD_FIS_COMMAND_INDICATOR;
-	cmd->command = 0x60;
-	cmd->tag = 0;
+	cmd->command = write ? 0x61 : 0x60;
+	cmd->tag = slot->tag << 3;
 	cmd->control = 0;
 
 	cmd->reserved1 = 0;
@@ -694,8 +856,8 @@ static void ahci_rb_fpdma_cmd(sata_dev_t *sata, uintptr_t phys,
 	cmd->reserved5 = 0;
 	cmd->reserved6 = 0;
 
-	cmd->sector_count_low = 1;
-	cmd->sector_count_high = 0;
+	cmd->sector_count_low = count & 0xff;
+	cmd->sector_count_high = (count >> 8) & 0xff;
 
 	cmd->lba0 = blocknum & 0xff;
 	cmd->lba1 = (blocknum >> 8) & 0xff;
@@ -704,141 +866,340 @@ static void ahci_rb_fpdma_cmd(sata_dev_t *sata, uintptr_t phys,
 	cmd->lba4 = (blocknum >> 32) & 0xff;
 	cmd->lba5 = (blocknum >> 40) & 0xff;
 
-	volatile ahci_cmd_prdt_t *prdt =
-	    (ahci_cmd_prdt_t *) (&sata->cmd_table[0x20]);
-
-	prdt->data_address_low = LO(phys);
-	prdt->data_address_upper = HI(phys);
-	prdt->reserved1 = 0;
-	prdt->dbc = sata->block_size - 1;
-	prdt->reserved2 = 0;
-	prdt->ioc = 0;
+	slot->size = size;
+
+	unsigned int prdtl = ahci_prdt_direct_set(sata, slot, buf, size);
+	if (prdtl == 0) {
+		volatile ahci_cmd_prdt_t *prdt = (ahci_cmd_prdt_t *)
+		    (&slot->cmd_table[AHCI_CMD_TABLE_PRDT_OFFSET /
+		    sizeof(uint32_t)]);
+
+		if (write)
+			memcpy(slot->buf, buf, size);
+		else
+			slot->dest = buf;
+
+		prdt->data_address_low = LO(slot->buf_phys);
+		prdt->data_address_upper = HI(slot->buf_phys);
+		prdt->reserved1 = 0;
+		prdt->dbc = size - 1;
+		prdt->reserved2 = 0;
+		prdt->ioc = 0;
+		prdtl = 1;
+	}
 
-	sata->cmd_header->prdtl = 1;
-	sata->cmd_header->flags =
+	cmd_header->prdtl = prdtl;
+	cmd_header->flags =
 	    AHCI_CMDHDR_FLAGS_CLEAR_BUSY_UPON_OK |
+	    (write ? AHCI_CMDHDR_FLAGS_WRITE : 0) |
 	    AHCI_CMDHDR_FLAGS_5DWCMD;
-	sata->cmd_header->bytesprocessed = 0;
+	cmd_header->bytesprocessed = 0;
 
-	sata->port->pxsact |= 1;
-	sata->port->pxci |= 1;
+	sata->ncq_active |= 1U << slot->tag;
+
+	/* Writing zero bits has no effect, set just the bit of this slot. */
+	sata->port->pxsact = 1U << slot->tag;
+	sata->port->pxci = 1U << slot->tag;
 }
 
-/** Read one sector from the SATA device using FPDMA.
+/** Read or write blocks using FPDMA.
+ *
+ * The transfer is split into commands of at most AHCI_SLOT_BUF_SIZE
+ * bytes, which are all queued to the device before waiting for the
+ * first of them to complete.
  *
  * @param sata     SATA device structure.
- * @param phys     Physical address of buffer for sector data.
- * @param blocknum Block number to read.
+ * @param write    Write to the device (otherwise read).
+ * @param blocknum Number of first block.
+ * @param count    Number of blocks.
+ * @param buf      Data buffer.
  *
  * @return EOK if succeed, error code otherwise
  *
  */
-static errno_t ahci_rb_fpdma(sata_dev_t *sata, uintptr_t phys, uint64_t blocknum)
+static errno_t ahci_rw_fpdma(sata_dev_t *sata, bool write, uint64_t blocknum,
+    size_t count, void *buf)
 {
 	if (sata->is_invalid_device) {
 		ddf_msg(LVL_ERROR,
-		    "%s: FPDMA read from invalid device", sata->model);
+		    "%s: FPDMA %s invalid device", sata->model,
+		    write ? "write to" : "read from");
 		return EINTR;
 	}
 
-	ahci_rb_fpdma_cmd(sata, phys, blocknum);
-	ahci_port_is_t pxis = ahci_wait_event(sata);
+	ahci_xfer_t xfer = {
+		.head = -1,
+		.tail = -1,
+		.rc = EOK
+	};
 
-	if ((sata->is_invalid_device) || (ahci_port_is_error(pxis))) {
-		ddf_msg(LVL_ERROR,
-		    "%s: Unrecoverable error during FPDMA read", sata->model);
-		return EINTR;
+	size_t cmd_blocks = AHCI_SLOT_BUF_SIZE / sata->block_size;
+	uint8_t *ptr = (uint8_t *) buf;
+
+	fibril_mutex_lock(&sata->lock);
+
+	while ((count > 0) && (xfer.rc == EOK)) {
+		if (sata->is_invalid_device) {
+			xfer.rc = EINTR;
+			break;
+		}
+
+		size_t cnt = min(count, cmd_blocks);
+		ahci_slot_t *slot = ahci_slot_get(sata, &xfer);
+
+		ahci_rw_fpdma_cmd(sata, slot, write, blocknum, cnt, ptr);
+
+		blocknum += cnt;
+		count -= cnt;
+		ptr += cnt * sata->block_size;
 	}
 
-	return EOK;
+	errno_t rc = ahci_xfer_wait(sata, &xfer);
+
+	fibril_mutex_unlock(&sata->lock);
+
+	if (rc != EOK) {
+		ddf_msg(LVL_ERROR, "%s: Unrecoverable error during FPDMA %s",
+		    sata->model, write ? "write" : "read");
+	}
+
+	return rc;
 }
 
-/** Set AHCI registers for writing one sector to the SATA device, use FPDMA.
+/** Set AHCI registers for DATA SET MANAGEMENT with the TRIM bit.
  *
- * @param sata     SATA device structure.
- * @param phys     Physical address of buffer with sector data.
- * @param blocknum Block number to write.
+ * The command is not queued, the range entries are transferred from
+ * the bounce buffer of the slot.
  *
- * @return EOK if succeed, error code otherwise
+ * @param sata   SATA device structure.
+ * @param slot   Command slot.
+ * @param blocks Number of blocks of range entries.
  *
  */
-static void ahci_wb_fpdma_cmd(sata_dev_t *sata, uintptr_t phys,
-    uint64_t blocknum)
+static void ahci_trim_cmd(sata_dev_t *sata, ahci_slot_t *slot, size_t blocks)
 {
-	volatile sata_ncq_command_frame_t *cmd =
-	    (sata_ncq_command_frame_t *) sata->cmd_table;
+	volatile sata_std_command_frame_t *cmd =
+	    (sata_std_command_frame_t *) slot->cmd_table;
+	volatile ahci_cmdhdr_t *cmd_header = &sata->cmd_header[slot->tag];
 
 	cmd->fis_type = SATA_CMD_FIS_TYPE;
 	cmd->c = SATA_CMD_FIS_COMMAND_INDICATOR;
-	cmd->command = 0x61;
-	cmd->tag = 0;
-	cmd->control = 0;
-
+	cmd->command = SATA_CMD_DSM;
+	cmd->features = SATA_DSM_TRIM;
+	cmd->lba_lower = 0;
+	cmd->device = 0x40;
+	cmd->lba_upper = 0;
+	cmd->features_upper = 0;
+	cmd->count = blocks;
 	cmd->reserved1 = 0;
+	cmd->control = 0;
 	cmd->reserved2 = 0;
-	cmd->reserved3 = 0;
-	cmd->reserved4 = 0;
-	cmd->reserved5 = 0;
-	cmd->reserved6 = 0;
-
-	cmd->sector_count_low = 1;
-	cmd->sector_count_high = 0;
 
-	cmd->lba0 = blocknum & 0xff;
-	cmd->lba1 = (blocknum >> 8) & 0xff;
-	cmd->lba2 = (blocknum >> 16) & 0xff;
-	cmd->lba3 = (blocknum >> 24) & 0xff;
-	cmd->lba4 = (blocknum >> 32) & 0xff;
-	cmd->lba5 = (blocknum >> 40) & 0xff;
-
-	volatile ahci_cmd_prdt_t *prdt =
-	    (ahci_cmd_prdt_t *) (&sata->cmd_table[0x20]);
+	volatile ahci_cmd_prdt_t *prdt = (ahci_cmd_prdt_t *)
+	    (&slot->cmd_table[AHCI_CMD_TABLE_PRDT_OFFSET / sizeof(uint32_t)]);
 
-	prdt->data_address_low = LO(phys);
-	prdt->data_address_upper = HI(phys);
+	prdt->data_address_low = LO(slot->buf_phys);
+	prdt->data_address_upper = HI(slot->buf_phys);
 	prdt->reserved1 = 0;
-	prdt->dbc = sata->block_size - 1;
+	prdt->dbc = blocks * SATA_DSM_BLOCK_SIZE - 1;
 	prdt->reserved2 = 0;
 	prdt->ioc = 0;
 
-	sata->cmd_header->prdtl = 1;
-	sata->cmd_header->flags =
+	cmd_header->prdtl = 1;
+	cmd_header->flags =
 	    AHCI_CMDHDR_FLAGS_CLEAR_BUSY_UPON_OK |
 	    AHCI_CMDHDR_FLAGS_WRITE |
 	    AHCI_CMDHDR_FLAGS_5DWCMD;
-	sata->cmd_header->bytesprocessed = 0;
+	cmd_header->bytesprocessed = 0;
 
-	sata->port->pxsact |= 1;
-	sata->port->pxci |= 1;
+	/*
+	 * The slot is completed like an NCQ command, its SActive bit
+	 * is simply never set.
+	 */
+	slot->done = false;
+	sata->ncq_active |= 1U << slot->tag;
+	sata->port->pxci = 1U << slot->tag;
 }
 
-/** Write one sector into the SATA device, use FPDMA.
+/** Discard blocks using DATA SET MANAGEMENT with the TRIM bit.
  *
- * @param sata     SATA device structure.
- * @param phys     Physical addres of buffer with sector data.
- * @param blocknum Block number to write.
+ * DATA SET MANAGEMENT is not an NCQ command, so no new NCQ commands are
+ * issued and the outstanding ones are drained before it runs. Extents
+ * are split into range entries of at most SATA_DSM_RANGE_MAX sectors,
+ * which are packed into as few commands as possible.
+ *
+ * @param sata SATA device structure.
+ * @param ext  Extents to discard.
+ * @param cnt  Number of extents.
  *
  * @return EOK if succeed, error code otherwise
  *
  */
-static errno_t ahci_wb_fpdma(sata_dev_t *sata, uintptr_t phys, uint64_t blocknum)
+static errno_t ahci_trim(sata_dev_t *sata, const bd_extent_t *ext,
+    size_t cnt)
 {
 	if (sata->is_invalid_device) {
-		ddf_msg(LVL_ERROR,
-		    "%s: FPDMA write to invalid device", sata->model);
+		ddf_msg(LVL_ERROR, "%s: TRIM on invalid device", sata->model);
 		return EINTR;
 	}
 
-	ahci_wb_fpdma_cmd(sata, phys, blocknum);
-	ahci_port_is_t pxis = ahci_wait_event(sata);
+	if (!sata->trim)
+		return ENOTSUP;
 
-	if ((sata->is_invalid_device) || (ahci_port_is_error(pxis))) {
-		ddf_msg(LVL_ERROR,
-		    "%s: Unrecoverable error during FPDMA write", sata->model);
-		return EINTR;
+	size_t max_ranges = sata->dsm_max_blocks * SATA_DSM_BLOCK_SIZE /
+	    sizeof(uint64_t);
+	errno_t rc = EOK;
+
+	fibril_mutex_lock(&sata->lock);
+
+	while (sata->exclusive)
+		fibril_condvar_wait(&sata->slot_cv, &sata->lock);
+
+	sata->exclusive = true;
+
+	while ((sata->ncq_active != 0) || (sata->free_head < 0))
+		fibril_condvar_wait(&sata->slot_cv, &sata->lock);
+
+	ahci_slot_t *slot = &sata->slots[sata->free_head];
+	sata->free_head = slot->next;
+
+	uint64_t *range = (uint64_t *) slot->buf;
+	size_t i = 0;
+	uint64_t ba = (cnt > 0) ? ext[0].ba : 0;
+	size_t left = (cnt > 0) ? ext[0].cnt : 0;
+
+	while ((rc == EOK) && (i < cnt)) {
+		size_t nranges = 0;
+
+		memset(slot->buf, 0, sata->dsm_max_blocks *
+		    SATA_DSM_BLOCK_SIZE);
+
+		while ((nranges < max_ranges) && (i < cnt)) {
+			if (left == 0) {
+				if (++i < cnt) {
+					ba = ext[i].ba;
+					left = ext[i].cnt;
+				}
+				continue;
+			}
+
+			size_t n = min(left, SATA_DSM_RANGE_MAX);
+			range[nranges++] = host2uint64_t_le(
+			    (ba & UINT64_C(0xffffffffffff)) | ((uint64_t) n << 48));
+			ba += n;
+			left -= n;
+		}
+
+		if (nranges == 0)
+			break;
+
+		if (sata->is_invalid_device) {
+			rc = EINTR;
+			break;
+		}
+
+		size_t blocks = (nranges * sizeof(uint64_t) +
+		    SATA_DSM_BLOCK_SIZE - 1) / SATA_DSM_BLOCK_SIZE;
+
+		ahci_trim_cmd(sata, slot, blocks);
+
+		while (!slot->done)
+			fibril_condvar_wait(&sata->slot_cv, &sata->lock);
+
+		rc = slot->rc;
 	}
 
-	return EOK;
+	slot->done = false;
+	slot->next = sata->free_head;
+	sata->free_head = slot->tag;
+
+	sata->exclusive = false;
+	fibril_condvar_broadcast(&sata->slot_cv);
+
+	fibril_mutex_unlock(&sata->lock);
+
+	if (rc != EOK)
+		ddf_msg(LVL_ERROR, "%s: Error during TRIM", sata->model);
+
+	return rc;
+}
+
+/** Restart command list processing of a port after an error.
+ *
+ * @param sata SATA device structure.
+ *
+ */
+static void ahci_port_restart(sata_dev_t *sata)
+{
+	ahci_port_cmd_t pxcmd;
+
+	pxcmd.u32 = sata->port->pxcmd;
+	pxcmd.st = 0;
+	sata->port->pxcmd = pxcmd.u32;
+
+	for (unsigned int i = 0; i < AHCI_PORT_STOP_TIMEOUT; i++) {
+		pxcmd.u32 = sata->port->pxcmd;
+		if (pxcmd.cr == 0)
+			break;
+
+		async_usleep(1000);
+	}
+
+	/* Clear error status. */
+	sata->port->pxserr = 0xffffffff;
+
+	pxcmd.st = 1;
+	sata->port->pxcmd = pxcmd.u32;
+}
+
+/** Complete NCQ commands after a port interrupt.
+ *
+ * @param sata SATA device structure.
+ * @param pxis Value of port interrupt status register.
+ *
+ */
+static void ahci_ncq_complete(sata_dev_t *sata, ahci_port_is_t pxis)
+{
+	errno_t rc = EOK;
+	uint32_t done;
+
+	fibril_mutex_lock(&sata->lock);
+
+	if (sata->ncq_active == 0) {
+		fibril_mutex_unlock(&sata->lock);
+		return;
+	}
+
+	if (ahci_port_is_error(pxis)) {
+		/*
+		 * The failed command cannot be told from the others,
+		 * fail all outstanding commands and restart the port.
+		 */
+		done = sata->ncq_active;
+		rc = EIO;
+
+		if (ahci_port_is_permanent_error(pxis))
+			sata->is_invalid_device = true;
+		else
+			ahci_port_restart(sata);
+	} else {
+		done = sata->ncq_active &
+		    ~(sata->port->pxsact | sata->port->pxci);
+	}
+
+	for (unsigned int tag = 0; tag < sata->nslots; tag++) {
+		if ((done & (1U << tag)) != 0) {
+			sata->slots[tag].rc = rc;
+			sata->slots[tag].done = true;
+		}
+	}
+
+	sata->ncq_active &= ~done;
+
+	if (done != 0)
+		fibril_condvar_broadcast(&sata->slot_cv);
+
+	fibril_mutex_unlock(&sata->lock);
 }
 
 /*----------------------------------------------------------------------------*/
@@ -915,6 +1276,8 @@ static void ahci_interrupt(ipc_call_t *icall, ddf_dev_t *dev)
 		fibril_condvar_signal(&sata->event_condvar);
 
 		fibril_mutex_unlock(&sata->event_lock);
+
+		ahci_ncq_complete(sata, pxis);
 	}
 }
 
@@ -968,17 +1331,26 @@ static sata_dev_t *ahci_sata_allocate(ahci_dev_t *ahci, volatile ahci_port_t *po
 	sata->port->pxclb = LO(phys);
 	sata->cmd_header = (ahci_cmdhdr_t *) virt_cmd;
 
-	/* Allocate and init command table structure. */
-	rc = dmamem_map_anonymous(size, DMAMEM_4GiB,
+	/* Allocate and init command table structures of all slots. */
+	size_t table_size = AHCI_NCQ_SLOTS * AHCI_CMD_TABLE_SIZE;
+	rc = dmamem_map_anonymous(table_size, DMAMEM_4GiB,
 	    AS_AREA_READ | AS_AREA_WRITE, 0, &phys, &virt_table);
 	if (rc != EOK)
 		goto error_table;
 
-	memset(virt_table, 0, size);
-	sata->cmd_header->cmdtableu = HI(phys);
-	sata->cmd_header->cmdtable = LO(phys);
+	memset(virt_table, 0, table_size);
 	sata->cmd_table = (uint32_t *) virt_table;
 
+	for (unsigned int tag = 0; tag < AHCI_NCQ_SLOTS; tag++) {
+		uintptr_t table_phys = phys + tag * AHCI_CMD_TABLE_SIZE;
+
+		sata->cmd_header[tag].cmdtableu = HI(table_phys);
+		sata->cmd_header[tag].cmdtable = LO(table_phys);
+		sata->slots[tag].tag = tag;
+		sata->slots[tag].cmd_table = (uint32_t *)
+		    ((uint8_t *) virt_table + tag * AHCI_CMD_TABLE_SIZE);
+	}
+
 	return sata;
 
 error_table:
@@ -990,6 +1362,47 @@ error_retfis:
 	return NULL;
 }
 
+/** Allocate bounce buffers of the NCQ command slots.
+ *
+ * The number of slots is limited by the number of command slots of the
+ * HBA and by the NCQ queue depth of the device.
+ *
+ * @param sata SATA device structure.
+ *
+ * @return EOK if succeed, error code otherwise.
+ *
+ */
+static errno_t ahci_slots_init(sata_dev_t *sata)
+{
+	ahci_ghc_cap_t cap;
+
+	cap.u32 = sata->ahci->memregs->ghc.cap;
+	sata->dma64 = cap.s64a;
+	sata->nslots = min(min(AHCI_NCQ_SLOTS, cap.ncs + 1), sata->ncq_depth);
+
+	for (unsigned int i = sata->nslots; i > 0; i--) {
+		ahci_slot_t *slot = &sata->slots[i - 1];
+
+		slot->buf = AS_AREA_ANY;
+		errno_t rc = dmamem_map_anonymous(AHCI_SLOT_BUF_SIZE,
+		    DMAMEM_4GiB, AS_AREA_READ | AS_AREA_WRITE, 0,
+		    &slot->buf_phys, &slot->buf);
+		if (rc != EOK) {
+			ddf_msg(LVL_ERROR, "Cannot allocate command slot buffer.");
+			slot->buf = NULL;
+			return rc;
+		}
+
+		slot->next = sata->free_head;
+		sata->free_head = slot->tag;
+	}
+
+	ddf_msg(LVL_NOTE, "%s: %u NCQ commands in flight", sata->model,
+	    sata->nslots);
+
+	return EOK;
+}
+
 /** Initialize and start SATA hardware device.
  *
  * @param sata SATA device structure.
@@ -1056,6 +1469,8 @@ static errno_t ahci_sata_create(ahci_dev_t *ahci, ddf_dev_t *dev,
 	fibril_mutex_initialize(&sata->lock);
 	fibril_mutex_initialize(&sata->event_lock);
 	fibril_condvar_initialize(&sata->event_condvar);
+	fibril_condvar_initialize(&sata->slot_cv);
+	sata->free_head = -1;
 
 	ahci_sata_hw_start(sata);
 
@@ -1067,6 +1482,10 @@ static errno_t ahci_sata_create(ahci_dev_t *ahci, ddf_dev_t *dev,
 	if (ahci_set_highest_ultra_dma_mode(sata) != EOK)
 		goto error;
 
+	/* Allocate NCQ command slots */
+	if (ahci_slots_init(sata) != EOK)
+		goto error;
+
 	/* Add device to the system */
 	char sata_dev_name[16];
 	snprintf(sata_dev_name, 16, "ahci_%u", sata_devices_count);
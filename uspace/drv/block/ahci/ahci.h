@@ -40,6 +40,26 @@
 #include <stdint.h>
 #include "ahci_hw.h"
 
+/** Maximum number of NCQ commands in flight on one port. */
+#define AHCI_NCQ_SLOTS  32
+
+/** Size of the command table of one command slot in bytes. */
+#define AHCI_CMD_TABLE_SIZE  512
+
+/** Offset of the PRDT in the command table in bytes. */
+#define AHCI_CMD_TABLE_PRDT_OFFSET  0x80
+
+/** Number of PRDT entries in one command table. */
+#define AHCI_PRDT_ENTRIES \
+	((AHCI_CMD_TABLE_SIZE - AHCI_CMD_TABLE_PRDT_OFFSET) / \
+	sizeof(ahci_cmd_prdt_t))
+
+/** Maximum data transfer of one command (and size of its bounce buffer). */
+#define AHCI_SLOT_BUF_SIZE  (64 * 1024)
+
+/** Maximum byte count of one PRDT entry. */
+#define AHCI_PRDT_DBC_MAX  (4 * 1024 * 1024)
+
 /** AHCI Device. */
 typedef struct {
 	/** Pointer to ddf device. */
@@ -55,6 +75,48 @@ typedef struct {
 	async_sess_t *parent_sess;
 } ahci_dev_t;
 
+/** NCQ command slot. */
+typedef struct {
+	/** Slot number, also used as the NCQ tag. */
+	unsigned int tag;
+
+	/** Command has been completed by the device. */
+	bool done;
+
+	/** Completion status of the command. */
+	errno_t rc;
+
+	/** Next slot in the free list or in a transfer, -1 if none. */
+	int next;
+
+	/** Pointer to command table of the slot. */
+	volatile uint32_t *cmd_table;
+
+	/** Bounce buffer. */
+	void *buf;
+
+	/** Physical address of the bounce buffer. */
+	uintptr_t buf_phys;
+
+	/** Where to copy data read into the bounce buffer, NULL if nowhere. */
+	void *dest;
+
+	/** Size of the data transfer in bytes. */
+	size_t size;
+} ahci_slot_t;
+
+/** Transfer consisting of a list of NCQ commands. */
+typedef struct {
+	/** First slot of the transfer, -1 if none. */
+	int head;
+
+	/** Last slot of the transfer, -1 if none. */
+	int tail;
+
+	/** Status of the first failed command or EOK. */
+	errno_t rc;
+} ahci_xfer_t;
+
 /** SATA Device. */
 typedef struct {
 	/** Pointer to AHCI device. */
@@ -72,15 +134,33 @@ typedef struct {
 	/** Pointer to SATA port. */
 	volatile ahci_port_t *port;
 
-	/** Pointer to command header. */
+	/** Pointer to command header (of slot 0, followed by the others). */
 	volatile ahci_cmdhdr_t *cmd_header;
 
-	/** Pointer to command table. */
+	/** Pointer to command table (of slot 0, followed by the others). */
 	volatile uint32_t *cmd_table;
 
-	/** Mutex for single operation on device. */
+	/** Mutex for single operation on device and for the NCQ slots. */
 	fibril_mutex_t lock;
 
+	/** NCQ command slots. */
+	ahci_slot_t slots[AHCI_NCQ_SLOTS];
+
+	/** Number of usable NCQ command slots. */
+	unsigned int nslots;
+
+	/** First free NCQ command slot, -1 if none. */
+	int free_head;
+
+	/** Mask of NCQ commands issued to the device and not completed. */
+	uint32_t ncq_active;
+
+	/** Signalled when an NCQ command completes or a slot is freed. */
+	fibril_condvar_t slot_cv;
+
+	/** HBA can access memory above 4 GiB. */
+	bool dma64;
+
 	/** Mutex for event signaling condition variable. */
 	fibril_mutex_t event_lock;
 
@@ -104,6 +184,18 @@ typedef struct {
 
 	/** Highest UDMA mode supported. */
 	uint8_t highest_udma_mode;
+
+	/** NCQ queue depth supported by the device. */
+	unsigned int ncq_depth;
+
+	/** Device supports TRIM. */
+	bool trim;
+
+	/** Maximum number of blocks of range entries of one TRIM command. */
+	unsigned int dsm_max_blocks;
+
+	/** A non-queued command waits for the NCQ commands to drain. */
+	bool exclusive;
 } sata_dev_t;
 
 #endif
@@ -55,6 +55,18 @@
 /** Sata FIS Type number. */
 #define SATA_CMD_FIS_TYPE  0x27
 
+/** DATA SET MANAGEMENT command. */
+#define SATA_CMD_DSM  0x06
+
+/** TRIM bit of the DATA SET MANAGEMENT features. */
+#define SATA_DSM_TRIM  0x01
+
+/** Size of a block of DSM range entries. */
+#define SATA_DSM_BLOCK_SIZE  512
+
+/** Maximum number of sectors in one DSM range entry. */
+#define SATA_DSM_RANGE_MAX  0xffff
+
 /** Sata FIS Type command indicator. */
 #define SATA_CMD_FIS_COMMAND_INDICATOR  0x80
 
@@ -209,12 +221,17 @@ typedef struct {
 	uint16_t total_lba48_2;
 	uint16_t total_lba48_3;
 
-	uint16_t reserved104[1 + 105 - 104];
+	uint16_t reserved104;
+	/* Maximum number of 512 B blocks of DSM range entries. */
+	uint16_t dsm_max_blocks;
 	uint16_t physical_logic_sector_size;
 	/* Note: more fields are defined in ATA/ATAPI-7. */
 	uint16_t reserved107[1 + 127 - 107];
 	uint16_t reserved128[1 + 159 - 128];
-	uint16_t reserved160[1 + 255 - 160];
+	uint16_t reserved160[1 + 168 - 160];
+	/* Data set management support. */
+	uint16_t dsm;
+	uint16_t reserved170[1 + 255 - 170];
 } sata_identify_data_t;
 
 /** Capability bits for register device. */
@@ -225,6 +242,12 @@ enum sata_rd_caps {
 	sata_rd_cap_dma = 0x0100
 };
 
+/** Bits of @c identify_data_t.dsm. */
+enum sata_dsm {
+	/** Supports the TRIM bit of DATA SET MANAGEMENT. */
+	sata_dsm_trim = 0x0001
+};
+
 /** Bits of @c identify_data_t.cmd_set1. */
 enum sata_cs1 {
 	/** 48-bit address feature set. */
@@ -35,8 +35,12 @@
  * @brief ATA disk driver
  *
  * This driver supports CHS, 28-bit and 48-bit LBA addressing, as well as
- * PACKET devices. It only uses PIO transfers. There is no support DMA
- * or any other fancy features such as S.M.A.R.T, removable devices, etc.
+ * PACKET devices. Register devices transfer data using bus master DMA if
+ * the parent provides the bus master register block, otherwise multi-sector
+ * PIO is used. Command completion is signalled by interrupt if the parent
+ * provides one. Read and write requests are queued, sorted in elevator order
+ * and contiguous requests are merged into a single command. There is no
+ * support for other fancy features such as S.M.A.R.T, removable devices, etc.
  *
  * This driver is based on the ATA-1, ATA-2, ATA-3 and ATA/ATAPI-4 through 7
  * standards, as published by the ANSI, NCITS and INCITS standards bodies,
@@ -48,7 +52,9 @@
  */
 
 #include <ddi.h>
+#include <ddf/interrupt.h>
 #include <ddf/log.h>
+#include <device/hw_res.h>
 #include <async.h>
 #include <as.h>
 #include <bd_srv.h>
@@ -65,6 +71,7 @@
 #include <errno.h>
 #include <byteorder.h>
 #include <macros.h>
+#include <mem.h>
 
 #include "ata_hw.h"
 #include "ata_bd.h"
@@ -83,6 +90,10 @@ static const size_t identify_data_size = 512;
 
 static errno_t ata_bd_init_io(ata_ctrl_t *ctrl);
 static void ata_bd_fini_io(ata_ctrl_t *ctrl);
+static errno_t ata_bd_init_irq(ata_ctrl_t *ctrl);
+static void ata_bd_fini_irq(ata_ctrl_t *ctrl);
+static errno_t ata_bd_init_xbuf(ata_ctrl_t *ctrl);
+static void ata_bd_fini_xbuf(ata_ctrl_t *ctrl);
 
 static errno_t ata_bd_open(bd_srvs_t *, bd_srv_t *);
 static errno_t ata_bd_close(bd_srv_t *);
@@ -95,10 +106,10 @@ static errno_t ata_bd_get_block_size(bd_srv_t *, size_t *);
 static errno_t ata_bd_get_num_blocks(bd_srv_t *, aoff64_t *);
 static errno_t ata_bd_sync_cache(bd_srv_t *, aoff64_t, size_t);
 
-static errno_t ata_rcmd_read(disk_t *disk, uint64_t ba, size_t cnt,
-    void *buf);
-static errno_t ata_rcmd_write(disk_t *disk, uint64_t ba, size_t cnt,
-    const void *buf);
+static errno_t ata_req_xfer(disk_t *disk, bool write, uint64_t ba,
+    size_t cnt, void *buf);
+static errno_t ata_rcmd_read(disk_t *disk, uint64_t ba, size_t cnt);
+static errno_t ata_rcmd_write(disk_t *disk, uint64_t ba, size_t cnt);
 static errno_t ata_rcmd_flush_cache(disk_t *disk);
 static errno_t disk_init(ata_ctrl_t *ctrl, disk_t *d, int disk_id);
 static errno_t ata_identify_dev(disk_t *disk, void *buf);
@@ -119,6 +130,8 @@ static void coord_sc_program(ata_ctrl_t *ctrl, const block_coord_t *bc,
     uint16_t scnt);
 static errno_t wait_status(ata_ctrl_t *ctrl, unsigned set, unsigned n_reset,
     uint8_t *pstatus, unsigned timeout);
+static void wait_irq_arm(ata_ctrl_t *ctrl);
+static errno_t wait_irq(ata_ctrl_t *ctrl, uint8_t *pstatus, unsigned timeout);
 
 bd_ops_t ata_bd_ops = {
 	.open = ata_bd_open,
@@ -151,8 +164,15 @@ errno_t ata_ctrl_init(ata_ctrl_t *ctrl, ata_base_t *res)
 	ddf_msg(LVL_DEBUG, "ata_ctrl_init()");
 
 	fibril_mutex_initialize(&ctrl->lock);
+	fibril_mutex_initialize(&ctrl->irq_lock);
+	fibril_condvar_initialize(&ctrl->irq_cv);
+	fibril_mutex_initialize(&ctrl->req_lock);
+	fibril_condvar_initialize(&ctrl->req_cv);
+	list_initialize(&ctrl->reqs);
 	ctrl->cmd_physical = res->cmd;
 	ctrl->ctl_physical = res->ctl;
+	ctrl->bm_physical = res->bm;
+	ctrl->irq = res->irq;
 
 	ddf_msg(LVL_NOTE, "I/O address %p/%p", (void *) ctrl->cmd_physical,
 	    (void *) ctrl->ctl_physical);
@@ -161,6 +181,19 @@ errno_t ata_ctrl_init(ata_ctrl_t *ctrl, ata_base_t *res)
 	if (rc != EOK)
 		return rc;
 
+	rc = ata_bd_init_xbuf(ctrl);
+	if (rc != EOK) {
+		ata_bd_fini_io(ctrl);
+		return rc;
+	}
+
+	rc = ata_bd_init_irq(ctrl);
+	if (rc != EOK) {
+		ata_bd_fini_xbuf(ctrl);
+		ata_bd_fini_io(ctrl);
+		return rc;
+	}
+
 	for (i = 0; i < MAX_DISKS; i++) {
 		ddf_msg(LVL_NOTE, "Identify drive %d...", i);
 
@@ -203,6 +236,8 @@ error:
 			    "disk %d.", i);
 		}
 	}
+	ata_bd_fini_irq(ctrl);
+	ata_bd_fini_xbuf(ctrl);
 	ata_bd_fini_io(ctrl);
 	return rc;
 }
@@ -226,6 +261,8 @@ errno_t ata_ctrl_remove(ata_ctrl_t *ctrl)
 		}
 	}
 
+	ata_bd_fini_irq(ctrl);
+	ata_bd_fini_xbuf(ctrl);
 	ata_bd_fini_io(ctrl);
 	fibril_mutex_unlock(&ctrl->lock);
 
@@ -251,6 +288,8 @@ errno_t ata_ctrl_gone(ata_ctrl_t *ctrl)
 		}
 	}
 
+	ata_bd_fini_irq(ctrl);
+	ata_bd_fini_xbuf(ctrl);
 	ata_bd_fini_io(ctrl);
 	fibril_mutex_unlock(&ctrl->lock);
 
@@ -328,6 +367,21 @@ static errno_t ata_bd_init_io(ata_ctrl_t *ctrl)
 
 	ctrl->ctl = vaddr;
 
+	ctrl->bm = NULL;
+	if (ctrl->bm_physical != 0) {
+		rc = pio_enable((void *) ctrl->bm_physical, sizeof(ata_bm_t),
+		    &vaddr);
+		if (rc != EOK) {
+			ddf_msg(LVL_ERROR, "Cannot initialize bus master "
+			    "I/O space.");
+			return rc;
+		}
+
+		ctrl->bm = vaddr;
+		ddf_msg(LVL_NOTE, "Bus master I/O address %p",
+		    (void *) ctrl->bm_physical);
+	}
+
 	return EOK;
 }
 
@@ -338,6 +392,150 @@ static void ata_bd_fini_io(ata_ctrl_t *ctrl)
 	/* XXX TODO */
 }
 
+/** Allocate the transfer buffer and the PRD table. */
+static errno_t ata_bd_init_xbuf(ata_ctrl_t *ctrl)
+{
+	errno_t rc;
+
+	ctrl->prdt = NULL;
+	ctrl->xbuf = NULL;
+
+	/* The bus master can only address the lower 4 GiB. */
+	rc = dmamem_map_anonymous(ATA_XBUF_SIZE, DMAMEM_4GiB,
+	    AS_AREA_READ | AS_AREA_WRITE, 0, &ctrl->xbuf_phys, &ctrl->xbuf);
+	if (rc != EOK) {
+		ctrl->xbuf = NULL;
+		ddf_msg(LVL_ERROR, "Failed allocating transfer buffer.");
+		return rc;
+	}
+
+	if (ctrl->bm == NULL)
+		return EOK;
+
+	rc = dmamem_map_anonymous(ATA_PRD_MAX * sizeof(ata_prd_t),
+	    DMAMEM_4GiB, AS_AREA_READ | AS_AREA_WRITE, 0, &ctrl->prdt_phys,
+	    (void **) &ctrl->prdt);
+	if (rc != EOK) {
+		ctrl->prdt = NULL;
+		ddf_msg(LVL_ERROR, "Failed allocating PRD table.");
+		ata_bd_fini_xbuf(ctrl);
+		return rc;
+	}
+
+	return EOK;
+}
+
+/** Free the transfer buffer and the PRD table. */
+static void ata_bd_fini_xbuf(ata_ctrl_t *ctrl)
+{
+	if (ctrl->prdt != NULL) {
+		dmamem_unmap_anonymous(ctrl->prdt);
+		ctrl->prdt = NULL;
+	}
+
+	if (ctrl->xbuf != NULL) {
+		dmamem_unmap_anonymous(ctrl->xbuf);
+		ctrl->xbuf = NULL;
+	}
+}
+
+/** ATA interrupt handler.
+ *
+ * The interrupt pseudocode has already acknowledged the interrupt by reading
+ * the status register, wake up the fibril waiting for the command.
+ */
+static void ata_irq_handler(ipc_call_t *icall, ddf_dev_t *dev)
+{
+	ata_ctrl_t *ctrl = (ata_ctrl_t *) ddf_dev_data_get(dev);
+
+	fibril_mutex_lock(&ctrl->irq_lock);
+	ctrl->irq_status = IPC_GET_ARG1(*icall);
+	ctrl->irq_fired = true;
+	fibril_condvar_broadcast(&ctrl->irq_cv);
+	fibril_mutex_unlock(&ctrl->irq_lock);
+}
+
+/** Register the interrupt handler and enable device interrupts.
+ *
+ * If the parent provides no interrupt, the driver polls the status register.
+ */
+static errno_t ata_bd_init_irq(ata_ctrl_t *ctrl)
+{
+	async_sess_t *parent_sess;
+	errno_t rc;
+
+	if (ctrl->irq < 0) {
+		ddf_msg(LVL_NOTE, "No interrupt, polling status register.");
+		return EOK;
+	}
+
+	irq_pio_range_t pio_ranges[] = {
+		{
+			.base = ctrl->cmd_physical,
+			.size = sizeof(ata_cmd_t)
+		}
+	};
+
+	/* Reading the status register clears the pending interrupt. */
+	irq_cmd_t irq_commands[] = {
+		{
+			.cmd = CMD_PIO_READ_8,
+			.addr = &((ata_cmd_t *) ctrl->cmd_physical)->status,
+			.dstarg = 1
+		},
+		{
+			.cmd = CMD_ACCEPT
+		}
+	};
+
+	irq_code_t irq_code = {
+		.rangecount = sizeof(pio_ranges) / sizeof(irq_pio_range_t),
+		.ranges = pio_ranges,
+		.cmdcount = sizeof(irq_commands) / sizeof(irq_cmd_t),
+		.cmds = irq_commands
+	};
+
+	rc = register_interrupt_handler(ctrl->dev, ctrl->irq, ata_irq_handler,
+	    &irq_code, &ctrl->irq_handle);
+	if (rc != EOK) {
+		ddf_msg(LVL_ERROR, "Failed registering interrupt handler.");
+		return rc;
+	}
+
+	parent_sess = ddf_dev_parent_sess_get(ctrl->dev);
+	if (parent_sess == NULL) {
+		rc = ENOMEM;
+		goto error;
+	}
+
+	rc = hw_res_enable_interrupt(parent_sess, ctrl->irq);
+	if (rc != EOK) {
+		ddf_msg(LVL_ERROR, "Failed enabling interrupt.");
+		goto error;
+	}
+
+	/* Clear nIEN so that the devices assert INTRQ. */
+	pio_write_8(&ctrl->ctl->device_control, 0);
+
+	ddf_msg(LVL_NOTE, "Registered IRQ %d", ctrl->irq);
+	return EOK;
+error:
+	unregister_interrupt_handler(ctrl->dev, ctrl->irq_handle);
+	ctrl->irq = -1;
+	return rc;
+}
+
+/** Disable device interrupts and unregister the interrupt handler. */
+static void ata_bd_fini_irq(ata_ctrl_t *ctrl)
+{
+	if (ctrl->irq < 0)
+		return;
+
+	pio_write_8(&ctrl->ctl->device_control, DCR_nIEN);
+	unregister_interrupt_handler(ctrl->dev, ctrl->irq_handle);
+	ctrl->irq = -1;
+}
+
 /** Initialize a disk.
  *
  * Probes for a disk, determines its parameters and initializes
@@ -362,6 +560,7 @@ static errno_t disk_init(ata_ctrl_t *ctrl, disk_t *d, int disk_id)
 	d->disk_id = disk_id;
 	d->present = false;
 	d->afun = NULL;
+	d->dma = false;
 
 	/* Try identify command. */
 	rc = ata_identify_dev(d, &idata);
@@ -492,6 +691,11 @@ static errno_t disk_init(ata_ctrl_t *ctrl, disk_t *d, int disk_id)
 	} else {
 		/* Assume register Read always uses 512-byte blocks. */
 		d->block_size = 512;
+
+		/* DMA commands need LBA addressing. */
+		if (ctrl->bm != NULL && d->amode != am_chs &&
+		    (idata.caps & rd_cap_dma) != 0)
+			d->dma = true;
 	}
 
 	d->present = true;
@@ -518,14 +722,11 @@ static errno_t ata_bd_read_blocks(bd_srv_t *bd, uint64_t ba, size_t cnt,
 	if (size < cnt * disk->block_size)
 		return EINVAL;
 
-	while (cnt > 0) {
-		if (disk->dev_type == ata_reg_dev) {
-			rc = ata_rcmd_read(disk, ba, 1, buf);
-		} else {
-			rc = ata_pcmd_read_12(disk, ba, 1, buf,
-			    disk->block_size);
-		}
+	if (disk->dev_type == ata_reg_dev)
+		return ata_req_xfer(disk, false, ba, cnt, buf);
 
+	while (cnt > 0) {
+		rc = ata_pcmd_read_12(disk, ba, 1, buf, disk->block_size);
 		if (rc != EOK)
 			return rc;
 
@@ -550,7 +751,6 @@ static errno_t ata_bd_write_blocks(bd_srv_t *bd, uint64_t ba, size_t cnt,
     const void *buf, size_t size)
 {
 	disk_t *disk = bd_srv_disk(bd);
-	errno_t rc;
 
 	if (disk->dev_type != ata_reg_dev)
 		return ENOTSUP;
@@ -558,17 +758,7 @@ static errno_t ata_bd_write_blocks(bd_srv_t *bd, uint64_t ba, size_t cnt,
 	if (size < cnt * disk->block_size)
 		return EINVAL;
 
-	while (cnt > 0) {
-		rc = ata_rcmd_write(disk, ba, 1, buf);
-		if (rc != EOK)
-			return rc;
-
-		++ba;
-		--cnt;
-		buf += disk->block_size;
-	}
-
-	return EOK;
+	return ata_req_xfer(disk, true, ba, cnt, (void *) buf);
 }
 
 /** Get device block size. */
@@ -601,34 +791,232 @@ static errno_t ata_bd_sync_cache(bd_srv_t *bd, uint64_t ba, size_t cnt)
 	return ata_rcmd_flush_cache(disk);
 }
 
-/** PIO data-in command protocol. */
+/** Compare request queue positions.
+ *
+ * @return @c true if block @a ba1 of disk @a disk1 comes before block
+ *         @a ba2 of disk @a disk2.
+ */
+static bool ata_req_pos_before(int disk1, uint64_t ba1, int disk2, uint64_t ba2)
+{
+	if (disk1 != disk2)
+		return disk1 < disk2;
+
+	return ba1 < ba2;
+}
+
+/** Insert request into the queue, keeping the queue sorted. */
+static void ata_req_insert(ata_ctrl_t *ctrl, ata_req_t *req)
+{
+	list_foreach(ctrl->reqs, lreqs, ata_req_t, r) {
+		if (ata_req_pos_before(req->disk->disk_id, req->ba,
+		    r->disk->disk_id, r->ba)) {
+			list_insert_before(&req->lreqs, &r->lreqs);
+			return;
+		}
+	}
+
+	list_append(&req->lreqs, &ctrl->reqs);
+}
+
+/** Pick the next request to dispatch.
+ *
+ * Requests are serviced in C-LOOK order: the first request at or after the
+ * position where the last command ended, wrapping around to the lowest
+ * position when there is none.
+ *
+ * @param ctrl Controller, the request queue must not be empty
+ */
+static ata_req_t *ata_req_next(ata_ctrl_t *ctrl)
+{
+	list_foreach(ctrl->reqs, lreqs, ata_req_t, r) {
+		if (!ata_req_pos_before(r->disk->disk_id, r->ba,
+		    ctrl->head_disk, ctrl->head_ba))
+			return r;
+	}
+
+	return list_get_instance(list_first(&ctrl->reqs), ata_req_t, lreqs);
+}
+
+/** Dispatch one command.
+ *
+ * Picks the next request and merges following requests which continue
+ * it on the same disk in the same direction until the transfer buffer
+ * is full. Requests only partially transferred are put back into the queue.
+ *
+ * Must be called with @c ctrl->req_lock held and @c ctrl->dispatching set.
+ * The lock is dropped while the command executes.
+ */
+static void ata_req_dispatch(ata_ctrl_t *ctrl)
+{
+	list_t batch;
+	ata_req_t *req;
+	link_t *link;
+	disk_t *disk;
+	bool write;
+	uint64_t ba;
+	size_t cnt;
+	size_t pos;
+	size_t n;
+	errno_t rc;
+
+	list_initialize(&batch);
+
+	req = ata_req_next(ctrl);
+	disk = req->disk;
+	write = req->write;
+	ba = req->ba;
+	cnt = 0;
+
+	while (req != NULL && req->disk == disk && req->write == write &&
+	    req->ba == ba + cnt && cnt < ATA_XFER_MAX_BLOCKS) {
+		link = list_next(&req->lreqs, &ctrl->reqs);
+		list_remove(&req->lreqs);
+		list_append(&req->lreqs, &batch);
+		cnt += min(req->cnt, ATA_XFER_MAX_BLOCKS - cnt);
+
+		req = (link != NULL) ?
+		    list_get_instance(link, ata_req_t, lreqs) : NULL;
+	}
+
+	ctrl->head_disk = disk->disk_id;
+	ctrl->head_ba = ba + cnt;
+
+	fibril_mutex_unlock(&ctrl->req_lock);
+
+	if (write) {
+		pos = 0;
+		list_foreach(batch, lreqs, ata_req_t, r) {
+			n = min(r->cnt, cnt - pos);
+			memcpy(ctrl->xbuf + pos * disk->block_size, r->buf,
+			    n * disk->block_size);
+			pos += n;
+		}
+
+		rc = ata_rcmd_write(disk, ba, cnt);
+	} else {
+		rc = ata_rcmd_read(disk, ba, cnt);
+	}
+
+	fibril_mutex_lock(&ctrl->req_lock);
+
+	pos = 0;
+	while (!list_empty(&batch)) {
+		req = list_get_instance(list_first(&batch), ata_req_t, lreqs);
+		list_remove(&req->lreqs);
+
+		n = min(req->cnt, cnt - pos);
+		if (rc == EOK && !write) {
+			memcpy(req->buf, ctrl->xbuf + pos * disk->block_size,
+			    n * disk->block_size);
+		}
+		pos += n;
+
+		if (rc != EOK) {
+			req->rc = rc;
+			req->done = true;
+			continue;
+		}
+
+		req->ba += n;
+		req->cnt -= n;
+		req->buf += n * disk->block_size;
+
+		if (req->cnt == 0) {
+			req->rc = EOK;
+			req->done = true;
+		} else {
+			ata_req_insert(ctrl, req);
+		}
+	}
+}
+
+/** Transfer blocks of a register device through the request queue.
+ *
+ * The calling fibril dispatches commands itself while no other fibril
+ * does, so that requests queued in the meantime get merged and sorted.
+ *
+ * @param disk		Disk
+ * @param write		@c true to write, @c false to read
+ * @param ba		Address of the first block
+ * @param cnt		Number of blocks to transfer
+ * @param buf		Data buffer
+ *
+ * @return EOK on success, EINVAL if out of bounds, EIO on error.
+ */
+static errno_t ata_req_xfer(disk_t *disk, bool write, uint64_t ba,
+    size_t cnt, void *buf)
+{
+	ata_ctrl_t *ctrl = disk->ctrl;
+	ata_req_t req;
+
+	if (cnt > disk->blocks || ba > disk->blocks - cnt)
+		return EINVAL;
+
+	if (cnt == 0)
+		return EOK;
+
+	link_initialize(&req.lreqs);
+	req.disk = disk;
+	req.write = write;
+	req.ba = ba;
+	req.cnt = cnt;
+	req.buf = buf;
+	req.rc = EOK;
+	req.done = false;
+
+	fibril_mutex_lock(&ctrl->req_lock);
+
+	ata_req_insert(ctrl, &req);
+
+	while (!req.done) {
+		if (ctrl->dispatching) {
+			fibril_condvar_wait(&ctrl->req_cv, &ctrl->req_lock);
+			continue;
+		}
+
+		ctrl->dispatching = true;
+		ata_req_dispatch(ctrl);
+		ctrl->dispatching = false;
+		fibril_condvar_broadcast(&ctrl->req_cv);
+	}
+
+	fibril_mutex_unlock(&ctrl->req_lock);
+	return req.rc;
+}
+
+/** PIO data-in command protocol.
+ *
+ * The interrupt must have been armed before issuing the command.
+ */
 static errno_t ata_pio_data_in(disk_t *disk, void *obuf, size_t obuf_size,
     size_t blk_size, size_t nblocks)
 {
 	ata_ctrl_t *ctrl = disk->ctrl;
+	uint16_t *bp = obuf;
 	uint16_t data;
-	size_t i;
+	size_t i, b;
 	uint8_t status;
 
-	/* XXX Support multiple blocks */
-	assert(nblocks == 1);
 	assert(blk_size % 2 == 0);
+	assert(obuf_size >= blk_size * nblocks);
 
-	if (wait_status(ctrl, 0, ~SR_BSY, &status, TIMEOUT_BSY) != EOK)
-		return EIO;
+	for (b = 0; b < nblocks; b++) {
+		if (wait_irq(ctrl, &status, TIMEOUT_BSY) != EOK)
+			return EIO;
 
-	if ((status & SR_DRQ) != 0) {
-		/* Read data from the device buffer. */
+		if ((status & SR_ERR) != 0 || (status & SR_DRQ) == 0)
+			return EIO;
 
+		/* The device interrupts again once the next block is ready. */
+		wait_irq_arm(ctrl);
+
+		/* Read data from the device buffer. */
 		for (i = 0; i < blk_size / 2; i++) {
 			data = pio_read_16(&ctrl->cmd->data_port);
-			((uint16_t *) obuf)[i] = data;
+			*bp++ = data;
 		}
 	}
 
-	if ((status & SR_ERR) != 0)
-		return EIO;
-
 	return EOK;
 }
 
@@ -637,25 +1025,100 @@ static errno_t ata_pio_data_out(disk_t *disk, const void *buf, size_t buf_size,
     size_t blk_size, size_t nblocks)
 {
 	ata_ctrl_t *ctrl = disk->ctrl;
-	size_t i;
+	const uint16_t *bp = buf;
+	size_t i, b;
 	uint8_t status;
 
-	/* XXX Support multiple blocks */
-	assert(nblocks == 1);
 	assert(blk_size % 2 == 0);
+	assert(buf_size >= blk_size * nblocks);
 
+	/* The device does not interrupt before the first block. */
 	if (wait_status(ctrl, 0, ~SR_BSY, &status, TIMEOUT_BSY) != EOK)
 		return EIO;
 
-	if ((status & SR_DRQ) != 0) {
+	for (b = 0; b < nblocks; b++) {
+		if ((status & SR_ERR) != 0 || (status & SR_DRQ) == 0)
+			return EIO;
+
+		wait_irq_arm(ctrl);
+
 		/* Write data to the device buffer. */
+		for (i = 0; i < blk_size / 2; i++)
+			pio_write_16(&ctrl->cmd->data_port, *bp++);
 
-		for (i = 0; i < blk_size / 2; i++) {
-			pio_write_16(&ctrl->cmd->data_port, ((uint16_t *) buf)[i]);
-		}
+		if (wait_irq(ctrl, &status, TIMEOUT_BSY) != EOK)
+			return EIO;
 	}
 
-	if (status & SR_ERR)
+	if ((status & (SR_ERR | SR_DWF)) != 0)
+		return EIO;
+
+	return EOK;
+}
+
+/** Program the bus master for a transfer from or to the transfer buffer.
+ *
+ * @param ctrl		Controller
+ * @param size		Number of bytes to transfer
+ * @param read		@c true if transferring from the device to memory
+ */
+static void ata_dma_setup(ata_ctrl_t *ctrl, size_t size, bool read)
+{
+	uintptr_t phys = ctrl->xbuf_phys;
+	size_t i;
+	size_t n;
+	uint8_t status;
+
+	assert(size <= ATA_XBUF_SIZE);
+
+	i = 0;
+	while (size > 0) {
+		n = min(size, PRD_BOUNDARY - (phys % PRD_BOUNDARY));
+
+		ctrl->prdt[i].base = host2uint32_t_le(phys);
+		ctrl->prdt[i].count = host2uint16_t_le(n % PRD_BOUNDARY);
+		ctrl->prdt[i].flags = 0;
+
+		phys += n;
+		size -= n;
+		++i;
+	}
+
+	ctrl->prdt[i - 1].flags = host2uint16_t_le(PRD_EOT);
+
+	pio_write_8(&ctrl->bm->command, read ? BMC_READ : 0);
+	pio_write_32(&ctrl->bm->prdt, ctrl->prdt_phys);
+
+	/* Clear the interrupt and error bits. */
+	status = pio_read_8(&ctrl->bm->status);
+	pio_write_8(&ctrl->bm->status, status | BMS_INTR | BMS_ERR);
+}
+
+/** Bus master DMA command protocol.
+ *
+ * Starts the bus master after the command has been issued and waits for
+ * the command to complete.
+ */
+static errno_t ata_dma_run(ata_ctrl_t *ctrl, bool read)
+{
+	uint8_t bm_cmd = read ? BMC_READ : 0;
+	uint8_t status;
+	uint8_t bm_status;
+	errno_t rc;
+
+	pio_write_8(&ctrl->bm->command, bm_cmd | BMC_START);
+
+	rc = wait_irq(ctrl, &status, TIMEOUT_DRDY);
+
+	pio_write_8(&ctrl->bm->command, bm_cmd);
+	bm_status = pio_read_8(&ctrl->bm->status);
+	pio_write_8(&ctrl->bm->status, bm_status | BMS_INTR | BMS_ERR);
+
+	if (rc != EOK)
+		return EIO;
+
+	if ((bm_status & BMS_ERR) != 0 ||
+	    (status & (SR_ERR | SR_DWF)) != 0)
 		return EIO;
 
 	return EOK;
@@ -708,6 +1171,7 @@ static errno_t ata_identify_dev(disk_t *disk, void *buf)
 	if (wait_status(ctrl, 0, ~SR_BSY, NULL, TIMEOUT_PROBE) != EOK)
 		return ETIMEOUT;
 
+	wait_irq_arm(ctrl);
 	pio_write_8(&ctrl->cmd->command, CMD_IDENTIFY_DRIVE);
 
 	if (wait_status(ctrl, 0, ~SR_BSY, &status, TIMEOUT_PROBE) != EOK)
@@ -755,6 +1219,7 @@ static errno_t ata_identify_pkt_dev(disk_t *disk, void *buf)
 	if (wait_status(ctrl, 0, ~SR_BSY, NULL, TIMEOUT_PROBE) != EOK)
 		return EIO;
 
+	wait_irq_arm(ctrl);
 	pio_write_8(&ctrl->cmd->command, CMD_IDENTIFY_PKT_DEV);
 
 	return ata_pio_data_in(disk, buf, identify_data_size,
@@ -992,17 +1457,15 @@ static errno_t ata_pcmd_read_toc(disk_t *disk, uint8_t session, void *obuf,
 	return EOK;
 }
 
-/** Read a physical block from the device.
+/** Read physical blocks from the device into the transfer buffer.
  *
  * @param disk		Disk
  * @param ba		Address the first block.
  * @param cnt		Number of blocks to transfer.
- * @param buf		Buffer for holding the data.
  *
  * @return EOK on success, EIO on error.
  */
-static errno_t ata_rcmd_read(disk_t *disk, uint64_t ba, size_t blk_cnt,
-    void *buf)
+static errno_t ata_rcmd_read(disk_t *disk, uint64_t ba, size_t blk_cnt)
 {
 	ata_ctrl_t *ctrl = disk->ctrl;
 	uint8_t drv_head;
@@ -1039,30 +1502,39 @@ static errno_t ata_rcmd_read(disk_t *disk, uint64_t ba, size_t blk_cnt,
 	}
 
 	/* Program block coordinates into the device. */
-	coord_sc_program(ctrl, &bc, 1);
+	coord_sc_program(ctrl, &bc, blk_cnt);
+
+	if (disk->dma) {
+		ata_dma_setup(ctrl, blk_cnt * disk->block_size, true);
+
+		wait_irq_arm(ctrl);
+		pio_write_8(&ctrl->cmd->command, disk->amode == am_lba48 ?
+		    CMD_READ_DMA_EXT : CMD_READ_DMA);
 
-	pio_write_8(&ctrl->cmd->command, disk->amode == am_lba48 ?
-	    CMD_READ_SECTORS_EXT : CMD_READ_SECTORS);
+		rc = ata_dma_run(ctrl, true);
+	} else {
+		wait_irq_arm(ctrl);
+		pio_write_8(&ctrl->cmd->command, disk->amode == am_lba48 ?
+		    CMD_READ_SECTORS_EXT : CMD_READ_SECTORS);
 
-	rc = ata_pio_data_in(disk, buf, blk_cnt * disk->block_size,
-	    disk->block_size, blk_cnt);
+		rc = ata_pio_data_in(disk, ctrl->xbuf,
+		    blk_cnt * disk->block_size, disk->block_size, blk_cnt);
+	}
 
 	fibril_mutex_unlock(&ctrl->lock);
 
 	return rc;
 }
 
-/** Write a physical block to the device.
+/** Write physical blocks from the transfer buffer to the device.
  *
  * @param disk		Disk
  * @param ba		Address of the first block.
  * @param cnt		Number of blocks to transfer.
- * @param buf		Buffer holding the data to write.
  *
  * @return EOK on success, EIO on error.
  */
-static errno_t ata_rcmd_write(disk_t *disk, uint64_t ba, size_t cnt,
-    const void *buf)
+static errno_t ata_rcmd_write(disk_t *disk, uint64_t ba, size_t cnt)
 {
 	ata_ctrl_t *ctrl = disk->ctrl;
 	uint8_t drv_head;
@@ -1099,13 +1571,23 @@ static errno_t ata_rcmd_write(disk_t *disk, uint64_t ba, size_t cnt,
 	}
 
 	/* Program block coordinates into the device. */
-	coord_sc_program(ctrl, &bc, 1);
+	coord_sc_program(ctrl, &bc, cnt);
+
+	if (disk->dma) {
+		ata_dma_setup(ctrl, cnt * disk->block_size, false);
+
+		wait_irq_arm(ctrl);
+		pio_write_8(&ctrl->cmd->command, disk->amode == am_lba48 ?
+		    CMD_WRITE_DMA_EXT : CMD_WRITE_DMA);
 
-	pio_write_8(&ctrl->cmd->command, disk->amode == am_lba48 ?
-	    CMD_WRITE_SECTORS_EXT : CMD_WRITE_SECTORS);
+		rc = ata_dma_run(ctrl, false);
+	} else {
+		pio_write_8(&ctrl->cmd->command, disk->amode == am_lba48 ?
+		    CMD_WRITE_SECTORS_EXT : CMD_WRITE_SECTORS);
 
-	rc = ata_pio_data_out(disk, buf, cnt * disk->block_size,
-	    disk->block_size, cnt);
+		rc = ata_pio_data_out(disk, ctrl->xbuf, cnt * disk->block_size,
+		    disk->block_size, cnt);
+	}
 
 	fibril_mutex_unlock(&ctrl->lock);
 	return rc;
@@ -1288,6 +1770,68 @@ static errno_t wait_status(ata_ctrl_t *ctrl, unsigned set, unsigned n_reset,
 	return EOK;
 }
 
+/** Prepare for waiting for an interrupt.
+ *
+ * Must be called before the device can raise the interrupt which is going
+ * to be waited for, i.e. before issuing the command or transferring a data
+ * block.
+ *
+ * @param ctrl		Controller
+ */
+static void wait_irq_arm(ata_ctrl_t *ctrl)
+{
+	if (ctrl->irq < 0)
+		return;
+
+	fibril_mutex_lock(&ctrl->irq_lock);
+	ctrl->irq_fired = false;
+	fibril_mutex_unlock(&ctrl->irq_lock);
+}
+
+/** Wait until the device interrupts.
+ *
+ * Without an interrupt, this polls the status register until BSY is reset.
+ * If the interrupt does not arrive in time, the status register is checked
+ * in case the interrupt was lost.
+ *
+ * @param ctrl		Controller
+ * @param pstatus	Pointer where to store the device status.
+ * @param timeout	Timeout in 10ms units.
+ *
+ * @return		EOK on success, EIO on timeout.
+ */
+static errno_t wait_irq(ata_ctrl_t *ctrl, uint8_t *pstatus, unsigned timeout)
+{
+	errno_t rc = EOK;
+	int i;
+
+	if (ctrl->irq < 0) {
+		/* Give the device 400 ns to set BSY. */
+		for (i = 0; i < 4; i++)
+			(void) pio_read_8(&ctrl->ctl->alt_status);
+
+		return wait_status(ctrl, 0, ~SR_BSY, pstatus, timeout);
+	}
+
+	fibril_mutex_lock(&ctrl->irq_lock);
+
+	while (!ctrl->irq_fired && rc != ETIMEOUT) {
+		rc = fibril_condvar_wait_timeout(&ctrl->irq_cv,
+		    &ctrl->irq_lock, (suseconds_t) timeout * 10000);
+	}
+
+	if (ctrl->irq_fired) {
+		*pstatus = ctrl->irq_status;
+		fibril_mutex_unlock(&ctrl->irq_lock);
+		return EOK;
+	}
+
+	fibril_mutex_unlock(&ctrl->irq_lock);
+
+	ddf_msg(LVL_WARN, "Interrupt timed out.");
+	return wait_status(ctrl, 0, ~SR_BSY, pstatus, 1);
+}
+
 /**
  * @}
  */
@@ -38,6 +38,7 @@
 #include <async.h>
 #include <bd_srv.h>
 #include <ddf/driver.h>
+#include <adt/list.h>
 #include <fibril_synch.h>
 #include <str.h>
 #include <stdint.h>
@@ -50,8 +51,19 @@
 typedef struct {
 	uintptr_t cmd;	/**< Command block base address. */
 	uintptr_t ctl;	/**< Control block base address. */
+	uintptr_t bm;	/**< Bus master block base address or 0. */
+	int irq;	/**< Interrupt line or -1. */
 } ata_base_t;
 
+/** Maximum number of sectors transferred by one command. */
+#define ATA_XFER_MAX_BLOCKS	128
+
+/** Size of the transfer buffer. */
+#define ATA_XBUF_SIZE	(ATA_XFER_MAX_BLOCKS * 512)
+
+/** Maximum number of PRD table entries. */
+#define ATA_PRD_MAX	(ATA_XBUF_SIZE / PRD_BOUNDARY + 1)
+
 /** Timeout definitions. Unit is 10 ms. */
 enum ata_timeout {
 	TIMEOUT_PROBE	=  100, /*  1 s */
@@ -121,6 +133,9 @@ typedef struct {
 	uint64_t blocks;
 	size_t block_size;
 
+	/** Use bus master DMA for data transfers */
+	bool dma;
+
 	char model[STR_BOUNDS(40) + 1];
 
 	int disk_id;
@@ -140,12 +155,64 @@ typedef struct ata_ctrl {
 	/** Control registers */
 	ata_ctl_t *ctl;
 
+	/** I/O base address of the bus master registers or 0 */
+	uintptr_t bm_physical;
+	/** Bus master registers or @c NULL if DMA is not available */
+	ata_bm_t *bm;
+
 	/** Per-disk state. */
 	disk_t disk[MAX_DISKS];
 
 	fibril_mutex_t lock;
+
+	/** Interrupt line or -1 if status registers need to be polled */
+	int irq;
+	cap_irq_handle_t irq_handle;
+	/** Protects @c irq_fired and @c irq_status */
+	fibril_mutex_t irq_lock;
+	/** Signalled when an interrupt arrives */
+	fibril_condvar_t irq_cv;
+	/** Interrupt arrived since the last command was issued */
+	bool irq_fired;
+	/** Device status read by the interrupt pseudocode */
+	uint8_t irq_status;
+
+	/** PRD table */
+	ata_prd_t *prdt;
+	uintptr_t prdt_phys;
+	/** Transfer buffer for merged register device requests */
+	void *xbuf;
+	uintptr_t xbuf_phys;
+
+	/** Protects the request queue */
+	fibril_mutex_t req_lock;
+	/** Signalled when a request is done or dispatching becomes free */
+	fibril_condvar_t req_cv;
+	/** Pending requests sorted by disk and block address, ata_req_t */
+	list_t reqs;
+	/** Some fibril is dispatching requests */
+	bool dispatching;
+	/** Disk and block address following the last dispatched request */
+	int head_disk;
+	uint64_t head_ba;
 } ata_ctrl_t;
 
+/** Register device read or write request */
+typedef struct {
+	/** Link to ata_ctrl_t.reqs */
+	link_t lreqs;
+	disk_t *disk;
+	bool write;
+	/** Next block to transfer */
+	uint64_t ba;
+	/** Number of blocks left to transfer */
+	size_t cnt;
+	/** Client buffer position of the next block */
+	uint8_t *buf;
+	errno_t rc;
+	bool done;
+} ata_req_t;
+
 typedef struct ata_fun {
 	ddf_fun_t *fun;
 	disk_t *disk;
@@ -133,12 +133,56 @@ enum ata_command {
 	CMD_READ_SECTORS_EXT	= 0x24,
 	CMD_WRITE_SECTORS	= 0x30,
 	CMD_WRITE_SECTORS_EXT	= 0x34,
+	CMD_READ_DMA_EXT	= 0x25,
+	CMD_WRITE_DMA_EXT	= 0x35,
+	CMD_READ_DMA		= 0xC8,
+	CMD_WRITE_DMA		= 0xCA,
 	CMD_PACKET		= 0xA0,
 	CMD_IDENTIFY_PKT_DEV	= 0xA1,
 	CMD_IDENTIFY_DRIVE	= 0xEC,
 	CMD_FLUSH_CACHE		= 0xE7
 };
 
+/** Bus master IDE registers (one set per channel). */
+typedef struct {
+	uint8_t command;
+	uint8_t pad0;
+	uint8_t status;
+	uint8_t pad1;
+	uint32_t prdt;		/**< Physical address of the PRD table */
+} ata_bm_t;
+
+enum bm_command_bits {
+	BMC_READ	= 0x08, /**< Transfer direction is device to memory */
+	BMC_START	= 0x01  /**< Start bus master operation */
+};
+
+enum bm_status_bits {
+	BMS_SIMPLEX	= 0x80, /**< Simplex only */
+	BMS_DRV1_DMA	= 0x40, /**< Drive 1 DMA capable */
+	BMS_DRV0_DMA	= 0x20, /**< Drive 0 DMA capable */
+	BMS_INTR	= 0x04, /**< Interrupt (write 1 to clear) */
+	BMS_ERR		= 0x02, /**< Error (write 1 to clear) */
+	BMS_ACTIVE	= 0x01  /**< Bus master IDE active */
+};
+
+/** Physical region descriptor */
+typedef struct {
+	/** Physical base address of the memory region */
+	uint32_t base;
+	/** Byte count of the region, zero means 64 KiB */
+	uint16_t count;
+	/** PRD flags */
+	uint16_t flags;
+} ata_prd_t;
+
+enum prd_flags {
+	PRD_EOT		= 0x8000 /**< End of table */
+};
+
+/** A memory region described by one PRD must not cross a 64 KiB boundary. */
+#define PRD_BOUNDARY	0x10000
+
 /** Data returned from identify device and identify packet device command. */
 typedef struct {
 	uint16_t gen_conf;
@@ -76,7 +76,11 @@ static errno_t ata_get_res(ddf_dev_t *dev, ata_base_t *ata_res)
 	if (rc != EOK)
 		return rc;
 
-	if (hw_res.io_ranges.count != 2) {
+	/*
+	 * The optional third range is the bus master IDE register block of
+	 * the channel. Without it, the driver falls back to PIO.
+	 */
+	if (hw_res.io_ranges.count != 2 && hw_res.io_ranges.count != 3) {
 		rc = EINVAL;
 		goto error;
 	}
@@ -96,6 +100,23 @@ static errno_t ata_get_res(ddf_dev_t *dev, ata_base_t *ata_res)
 		goto error;
 	}
 
+	ata_res->bm = 0;
+	if (hw_res.io_ranges.count == 3) {
+		addr_range_t *bm_rng = &hw_res.io_ranges.ranges[2];
+
+		if (RNGSZ(*bm_rng) < sizeof(ata_bm_t)) {
+			rc = EINVAL;
+			goto error;
+		}
+
+		ata_res->bm = RNGABS(*bm_rng);
+	}
+
+	ata_res->irq = -1;
+	if (hw_res.irqs.count > 0)
+		ata_res->irq = hw_res.irqs.irqs[0];
+
+	hw_res_list_parsed_clean(&hw_res);
 	return EOK;
 error:
 	hw_res_list_parsed_clean(&hw_res);
@@ -0,0 +1,1288 @@
+/*
+ * Copyright (c) 2018 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @file
+ * NVM Express driver
+ *
+ * Each namespace of the controller is exposed as a block device. The
+ * controller gets one I/O queue pair per CPU (up to NVME_IO_QUEUES_MAX),
+ * a request uses the queue pair selected by the server thread which
+ * handles it. Transfers are split into commands of at most max_xfer bytes
+ * which are all queued before waiting for the first one to complete.
+ */
+
+#include <as.h>
+#include <assert.h>
+#include <byteorder.h>
+#include <ddf/interrupt.h>
+#include <ddf/log.h>
+#include <device/hw_res.h>
+#include <device/hw_res_parsed.h>
+#include <errno.h>
+#include <libarch/barrier.h>
+#include <macros.h>
+#include <mem.h>
+#include <stats.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <str.h>
+#include <str_error.h>
+#include <thread.h>
+
+#include "nvme.h"
+
+#define NAME	"nvme"
+
+/** Interval of polling the controller status in microseconds */
+#define NVME_POLL_INTERVAL	10000
+
+static errno_t nvme_dev_add(ddf_dev_t *);
+
+static driver_ops_t nvme_driver_ops = {
+	.dev_add = nvme_dev_add
+};
+
+static driver_t nvme_driver = {
+	.name = NAME,
+	.driver_ops = &nvme_driver_ops
+};
+
+static errno_t nvme_bd_open(bd_srvs_t *, bd_srv_t *);
+static errno_t nvme_bd_close(bd_srv_t *);
+static errno_t nvme_bd_read_blocks(bd_srv_t *, aoff64_t, size_t, void *,
+    size_t);
+static errno_t nvme_bd_write_blocks(bd_srv_t *, aoff64_t, size_t,
+    const void *, size_t);
+static errno_t nvme_bd_sync_cache(bd_srv_t *, aoff64_t, size_t);
+static errno_t nvme_bd_discard_blocks(bd_srv_t *, const bd_extent_t *,
+    size_t);
+static errno_t nvme_bd_get_block_size(bd_srv_t *, size_t *);
+static errno_t nvme_bd_get_num_blocks(bd_srv_t *, aoff64_t *);
+
+static bd_ops_t nvme_bd_ops = {
+	.open = nvme_bd_open,
+	.close = nvme_bd_close,
+	.read_blocks = nvme_bd_read_blocks,
+	.write_blocks = nvme_bd_write_blocks,
+	.sync_cache = nvme_bd_sync_cache,
+	.discard_blocks = nvme_bd_discard_blocks,
+	.get_block_size = nvme_bd_get_block_size,
+	.get_num_blocks = nvme_bd_get_num_blocks
+};
+
+static uint32_t nvme_reg_read32(nvme_ctrl_t *ctrl, size_t offs)
+{
+	return pio_read_le32((ioport32_t *) ((uint8_t *) ctrl->regs + offs));
+}
+
+static void nvme_reg_write32(nvme_ctrl_t *ctrl, size_t offs, uint32_t val)
+{
+	pio_write_le32((ioport32_t *) ((uint8_t *) ctrl->regs + offs), val);
+}
+
+/** Read 64-bit register as two 32-bit halves, lower one first. */
+static uint64_t nvme_reg_read64(nvme_ctrl_t *ctrl, size_t offs)
+{
+	uint64_t lo = nvme_reg_read32(ctrl, offs);
+	uint64_t hi = nvme_reg_read32(ctrl, offs + sizeof(uint32_t));
+
+	return (hi << 32) | lo;
+}
+
+/** Write 64-bit register as two 32-bit halves, lower one first. */
+static void nvme_reg_write64(nvme_ctrl_t *ctrl, size_t offs, uint64_t val)
+{
+	nvme_reg_write32(ctrl, offs, LOWER32(val));
+	nvme_reg_write32(ctrl, offs + sizeof(uint32_t), UPPER32(val));
+}
+
+/** Wait until the controller becomes ready or not ready.
+ *
+ * @param ctrl  Controller
+ * @param ready Wait for the controller to become ready
+ * @return EOK on success, ETIMEOUT or EIO on controller fatal status
+ */
+static errno_t nvme_ctrl_wait_ready(nvme_ctrl_t *ctrl, bool ready)
+{
+	/* The timeout is in 500 ms units */
+	unsigned polls = (ctrl->timeout + 1) * 500000 / NVME_POLL_INTERVAL;
+
+	for (unsigned i = 0; i < polls; i++) {
+		uint32_t csts = nvme_reg_read32(ctrl, NVME_REG_CSTS);
+		if (ready && (csts & NVME_CSTS_CFS) != 0)
+			return EIO;
+		if (((csts & NVME_CSTS_RDY) != 0) == ready)
+			return EOK;
+
+		async_usleep(NVME_POLL_INTERVAL);
+	}
+
+	return ETIMEOUT;
+}
+
+/** Initialize queue pair and allocate its memory.
+ *
+ * @param ctrl Controller
+ * @param q    Queue pair
+ * @param qid  Queue identifier
+ * @param size Number of entries of each of the queues
+ * @return EOK on success or an error code
+ */
+static errno_t nvme_queue_init(nvme_ctrl_t *ctrl, nvme_queue_t *q,
+    uint16_t qid, uint16_t size)
+{
+	uintptr_t prp_phys;
+	errno_t rc;
+
+	memset(q, 0, sizeof(nvme_queue_t));
+	q->ctrl = ctrl;
+	q->qid = qid;
+	q->size = size;
+	fibril_mutex_initialize(&q->lock);
+	fibril_condvar_initialize(&q->cv);
+
+	q->sq = AS_AREA_ANY;
+	rc = dmamem_map_anonymous(size * sizeof(nvme_sqe_t), 0,
+	    AS_AREA_READ | AS_AREA_WRITE, 0, &q->sq_phys, (void **) &q->sq);
+	if (rc != EOK) {
+		q->sq = NULL;
+		goto error;
+	}
+
+	q->cq = AS_AREA_ANY;
+	rc = dmamem_map_anonymous(size * sizeof(nvme_cqe_t), 0,
+	    AS_AREA_READ | AS_AREA_WRITE, 0, &q->cq_phys, (void **) &q->cq);
+	if (rc != EOK) {
+		q->cq = NULL;
+		goto error;
+	}
+
+	memset(q->sq, 0, size * sizeof(nvme_sqe_t));
+	memset(q->cq, 0, size * sizeof(nvme_cqe_t));
+	q->cq_phase = NVME_CQE_PHASE;
+
+	q->sq_db = (ioport32_t *) ((uint8_t *) ctrl->regs + NVME_REG_DOORBELL +
+	    (2 * qid) * ctrl->db_stride);
+	q->cq_db = (ioport32_t *) ((uint8_t *) ctrl->regs + NVME_REG_DOORBELL +
+	    (2 * qid + 1) * ctrl->db_stride);
+
+	/* A full submission queue holds one entry less than its size */
+	q->nslots = size - 1;
+	q->slots = calloc(q->nslots, sizeof(nvme_slot_t));
+	if (q->slots == NULL) {
+		rc = ENOMEM;
+		goto error;
+	}
+
+	q->prp_lists = AS_AREA_ANY;
+	rc = dmamem_map_anonymous(q->nslots * NVME_PAGE_SIZE, 0,
+	    AS_AREA_READ | AS_AREA_WRITE, 0, &prp_phys, &q->prp_lists);
+	if (rc != EOK) {
+		q->prp_lists = NULL;
+		goto error;
+	}
+
+	q->free_head = -1;
+	for (unsigned i = q->nslots; i > 0; i--) {
+		nvme_slot_t *slot = &q->slots[i - 1];
+
+		slot->cid = i - 1;
+		slot->prp_list = (uint64_t *) ((uint8_t *) q->prp_lists +
+		    (i - 1) * NVME_PAGE_SIZE);
+		slot->prp_list_phys = prp_phys + (i - 1) * NVME_PAGE_SIZE;
+		slot->next = q->free_head;
+		q->free_head = i - 1;
+	}
+
+	return EOK;
+error:
+	if (q->cq != NULL)
+		dmamem_unmap_anonymous(q->cq);
+	if (q->sq != NULL)
+		dmamem_unmap_anonymous(q->sq);
+	free(q->slots);
+	q->slots = NULL;
+	return rc;
+}
+
+/** Free memory of a queue pair. */
+static void nvme_queue_fini(nvme_queue_t *q)
+{
+	if (q->prp_lists != NULL)
+		dmamem_unmap_anonymous(q->prp_lists);
+	if (q->cq != NULL)
+		dmamem_unmap_anonymous(q->cq);
+	if (q->sq != NULL)
+		dmamem_unmap_anonymous(q->sq);
+	free(q->slots);
+	memset(q, 0, sizeof(nvme_queue_t));
+}
+
+/** Retire the oldest command of a transfer.
+ *
+ * The command must be completed. Data read into a bounce buffer is copied
+ * to its destination and the slot is returned to the free list.
+ *
+ * @param q    Queue pair, locked
+ * @param xfer Transfer
+ */
+static void nvme_xfer_retire(nvme_queue_t *q, nvme_xfer_t *xfer)
+{
+	nvme_slot_t *slot = &q->slots[xfer->head];
+
+	assert(fibril_mutex_is_locked(&q->lock));
+	assert(slot->done);
+
+	if (slot->status != 0) {
+		ddf_msg(LVL_WARN, "Command %u on queue %u failed, status 0x%x",
+		    (unsigned) slot->cid, (unsigned) q->qid,
+		    (unsigned) slot->status);
+		if (xfer->rc == EOK)
+			xfer->rc = EIO;
+	}
+
+	if (slot->bounce != NULL) {
+		if (slot->status == 0 && slot->dest != NULL)
+			memcpy(slot->dest, slot->bounce, slot->size);
+		dmamem_unmap_anonymous(slot->bounce);
+		slot->bounce = NULL;
+	}
+
+	xfer->head = slot->next;
+	if (xfer->head < 0)
+		xfer->tail = -1;
+
+	slot->done = false;
+	slot->next = q->free_head;
+	q->free_head = slot->cid;
+
+	fibril_condvar_broadcast(&q->cv);
+}
+
+/** Allocate slot for a new command of a transfer.
+ *
+ * If all slots are in use, completed commands of the transfer are retired
+ * while waiting, so that a transfer never waits for its own slots.
+ *
+ * @param q    Queue pair, locked
+ * @param xfer Transfer
+ * @return Allocated slot
+ */
+static nvme_slot_t *nvme_slot_get(nvme_queue_t *q, nvme_xfer_t *xfer)
+{
+	assert(fibril_mutex_is_locked(&q->lock));
+
+	while (q->free_head < 0) {
+		if (xfer->head >= 0 && q->slots[xfer->head].done)
+			nvme_xfer_retire(q, xfer);
+		else
+			fibril_condvar_wait(&q->cv, &q->lock);
+	}
+
+	nvme_slot_t *slot = &q->slots[q->free_head];
+	q->free_head = slot->next;
+
+	slot->done = false;
+	slot->status = 0;
+	slot->result = 0;
+	slot->next = -1;
+	slot->dest = NULL;
+	slot->size = 0;
+
+	if (xfer->tail >= 0)
+		q->slots[xfer->tail].next = slot->cid;
+	else
+		xfer->head = slot->cid;
+	xfer->tail = slot->cid;
+
+	return slot;
+}
+
+/** Wait until all commands of a transfer complete and retire them.
+ *
+ * @param q    Queue pair, locked
+ * @param xfer Transfer
+ * @return EOK on success or an error code of the first failed command
+ */
+static errno_t nvme_xfer_wait(nvme_queue_t *q, nvme_xfer_t *xfer)
+{
+	while (xfer->head >= 0) {
+		if (q->slots[xfer->head].done)
+			nvme_xfer_retire(q, xfer);
+		else
+			fibril_condvar_wait(&q->cv, &q->lock);
+	}
+
+	return xfer->rc;
+}
+
+/** Place command in the submission queue and ring the doorbell.
+ *
+ * @param q    Queue pair, locked
+ * @param slot Slot allocated for the command
+ * @param sqe  Command
+ */
+static void nvme_cmd_submit(nvme_queue_t *q, nvme_slot_t *slot,
+    nvme_sqe_t *sqe)
+{
+	sqe->cid = host2uint16_t_le(slot->cid);
+	memcpy(&q->sq[q->sq_tail], sqe, sizeof(nvme_sqe_t));
+
+	q->sq_tail = (q->sq_tail + 1) % q->size;
+
+	write_barrier();
+	pio_write_le32(q->sq_db, q->sq_tail);
+}
+
+/** Process new entries of a completion queue.
+ *
+ * @param q Queue pair
+ */
+static void nvme_queue_poll(nvme_queue_t *q)
+{
+	bool consumed = false;
+
+	fibril_mutex_lock(&q->lock);
+
+	while (q->cq != NULL) {
+		volatile nvme_cqe_t *cqe = &q->cq[q->cq_head];
+		uint16_t status = uint16_t_le2host(cqe->status);
+
+		if ((status & NVME_CQE_PHASE) != q->cq_phase)
+			break;
+
+		read_barrier();
+
+		uint16_t cid = uint16_t_le2host(cqe->cid);
+		if (cid < q->nslots) {
+			nvme_slot_t *slot = &q->slots[cid];
+
+			slot->status = NVME_CQE_STATUS(status);
+			slot->result = uint32_t_le2host(cqe->result);
+			slot->done = true;
+		} else {
+			ddf_msg(LVL_WARN, "Bogus command identifier %u on "
+			    "queue %u", (unsigned) cid, (unsigned) q->qid);
+		}
+
+		if (++q->cq_head == q->size) {
+			q->cq_head = 0;
+			q->cq_phase ^= NVME_CQE_PHASE;
+		}
+
+		consumed = true;
+	}
+
+	if (consumed) {
+		pio_write_le32(q->cq_db, q->cq_head);
+		fibril_condvar_broadcast(&q->cv);
+	}
+
+	fibril_mutex_unlock(&q->lock);
+}
+
+static void nvme_irq_handler(ipc_call_t *icall, ddf_dev_t *dev)
+{
+	nvme_ctrl_t *ctrl = (nvme_ctrl_t *) ddf_dev_data_get(dev);
+
+	nvme_queue_poll(&ctrl->admin);
+	for (unsigned i = 0; i < ctrl->nio; i++)
+		nvme_queue_poll(&ctrl->io[i]);
+
+	/* The interrupt has been masked by the interrupt pseudocode */
+	nvme_reg_write32(ctrl, NVME_REG_INTMC, 1);
+}
+
+static errno_t nvme_register_interrupt(nvme_ctrl_t *ctrl)
+{
+	irq_pio_range_t pio_ranges[] = {
+		{
+			.base = ctrl->regs_phys,
+			.size = NVME_REG_INTMC
+		}
+	};
+
+	/*
+	 * There is no interrupt status register for pin-based interrupts.
+	 * Mask the interrupt, the handler unmasks it once it has processed
+	 * the completion queues.
+	 */
+	irq_cmd_t irq_commands[] = {
+		{
+			.cmd = CMD_PIO_WRITE_32,
+			.addr = (void *) (ctrl->regs_phys + NVME_REG_INTMS),
+			.value = host2uint32_t_le(1)
+		},
+		{
+			.cmd = CMD_ACCEPT
+		}
+	};
+
+	irq_code_t irq_code = {
+		.rangecount = sizeof(pio_ranges) / sizeof(irq_pio_range_t),
+		.ranges = pio_ranges,
+		.cmdcount = sizeof(irq_commands) / sizeof(irq_cmd_t),
+		.cmds = irq_commands
+	};
+
+	return register_interrupt_handler(ctrl->dev, ctrl->irq,
+	    nvme_irq_handler, &irq_code, &ctrl->irq_handle);
+}
+
+/** Look up physical address of a buffer byte, faulting its page in. */
+static errno_t nvme_phys_get(uint8_t *ptr, uintptr_t *phys)
+{
+	(void) *((volatile uint8_t *) ptr);
+	return as_get_physical_mapping(ptr, phys);
+}
+
+/** Describe data buffer by the PRP entries of a command.
+ *
+ * @param slot Slot of the command
+ * @param sqe  Command
+ * @param buf  Data buffer, at least dword aligned
+ * @param size Size of the data, at most NVME_XFER_MAX
+ * @return EOK on success or an error code if the physical address of some
+ *         part of the buffer cannot be determined
+ */
+static errno_t nvme_prp_set(nvme_slot_t *slot, nvme_sqe_t *sqe, void *buf,
+    size_t size)
+{
+	uint8_t *ptr = (uint8_t *) buf;
+	uintptr_t phys;
+	errno_t rc;
+
+	/* The first entry may point into the middle of a page */
+	size_t chunk = min(size,
+	    NVME_PAGE_SIZE - ((uintptr_t) ptr & (NVME_PAGE_SIZE - 1)));
+
+	rc = nvme_phys_get(ptr, &phys);
+	if (rc != EOK)
+		return rc;
+
+	sqe->prp1 = host2uint64_t_le(phys);
+	sqe->prp2 = 0;
+	ptr += chunk;
+	size -= chunk;
+
+	if (size == 0)
+		return EOK;
+
+	if (size <= NVME_PAGE_SIZE) {
+		rc = nvme_phys_get(ptr, &phys);
+		if (rc != EOK)
+			return rc;
+
+		sqe->prp2 = host2uint64_t_le(phys);
+		return EOK;
+	}
+
+	/* The rest of the pages is described by the PRP list */
+	for (unsigned i = 0; size > 0; i++) {
+		assert(i < NVME_PAGE_SIZE / sizeof(uint64_t));
+
+		chunk = min(size, NVME_PAGE_SIZE);
+		rc = nvme_phys_get(ptr, &phys);
+		if (rc != EOK)
+			return rc;
+
+		slot->prp_list[i] = host2uint64_t_le(phys);
+		ptr += chunk;
+		size -= chunk;
+	}
+
+	sqe->prp2 = host2uint64_t_le(slot->prp_list_phys);
+	return EOK;
+}
+
+/** Set up data transfer of a read or write command.
+ *
+ * The controller transfers the data to or from the client buffer directly
+ * if possible, otherwise through a bounce buffer.
+ *
+ * @param slot  Slot of the command
+ * @param sqe   Command
+ * @param write Data is written to the device
+ * @param buf   Client buffer
+ * @param size  Size of the data
+ * @return EOK on success or an error code
+ */
+static errno_t nvme_slot_data_set(nvme_slot_t *slot, nvme_sqe_t *sqe,
+    bool write, void *buf, size_t size)
+{
+	uintptr_t phys;
+	errno_t rc;
+
+	slot->size = size;
+
+	if (((uintptr_t) buf & 3) == 0 &&
+	    nvme_prp_set(slot, sqe, buf, size) == EOK)
+		return EOK;
+
+	slot->bounce = AS_AREA_ANY;
+	rc = dmamem_map_anonymous(size, 0, AS_AREA_READ | AS_AREA_WRITE, 0,
+	    &phys, &slot->bounce);
+	if (rc != EOK) {
+		slot->bounce = NULL;
+		return rc;
+	}
+
+	if (write)
+		memcpy(slot->bounce, buf, size);
+	else
+		slot->dest = buf;
+
+	return nvme_prp_set(slot, sqe, slot->bounce, size);
+}
+
+/** Select I/O queue pair for a request.
+ *
+ * Requests handled by different server threads mostly end up in
+ * different queue pairs and do not contend for their locks.
+ */
+static nvme_queue_t *nvme_io_queue_get(nvme_ctrl_t *ctrl)
+{
+	return &ctrl->io[thread_get_id() % ctrl->nio];
+}
+
+/** Execute admin command.
+ *
+ * @param ctrl   Controller
+ * @param sqe    Command
+ * @param result Place to store the command specific result or NULL
+ * @return EOK on success or an error code
+ */
+static errno_t nvme_admin_cmd(nvme_ctrl_t *ctrl, nvme_sqe_t *sqe,
+    uint32_t *result)
+{
+	nvme_queue_t *q = &ctrl->admin;
+	nvme_xfer_t xfer;
+
+	xfer.head = -1;
+	xfer.tail = -1;
+	xfer.rc = EOK;
+
+	fibril_mutex_lock(&q->lock);
+
+	nvme_slot_t *slot = nvme_slot_get(q, &xfer);
+	nvme_cmd_submit(q, slot, sqe);
+
+	while (!slot->done)
+		fibril_condvar_wait(&q->cv, &q->lock);
+
+	if (result != NULL)
+		*result = slot->result;
+
+	errno_t rc = nvme_xfer_wait(q, &xfer);
+	fibril_mutex_unlock(&q->lock);
+
+	return rc;
+}
+
+/** Execute Identify command.
+ *
+ * @param ctrl Controller
+ * @param cns  Controller or Namespace Structure
+ * @param nsid Namespace identifier
+ * @param phys Physical address of a page for the data
+ * @return EOK on success or an error code
+ */
+static errno_t nvme_identify(nvme_ctrl_t *ctrl, uint32_t cns, uint32_t nsid,
+    uintptr_t phys)
+{
+	nvme_sqe_t sqe;
+
+	memset(&sqe, 0, sizeof(sqe));
+	sqe.opcode = NVME_ADMIN_IDENTIFY;
+	sqe.nsid = host2uint32_t_le(nsid);
+	sqe.prp1 = host2uint64_t_le(phys);
+	sqe.cdw10 = host2uint32_t_le(cns);
+
+	return nvme_admin_cmd(ctrl, &sqe, NULL);
+}
+
+/** Execute Set Features command.
+ *
+ * @param ctrl   Controller
+ * @param fid    Feature identifier
+ * @param val    Feature specific value
+ * @param result Place to store the command specific result or NULL
+ * @return EOK on success or an error code
+ */
+static errno_t nvme_set_features(nvme_ctrl_t *ctrl, uint32_t fid,
+    uint32_t val, uint32_t *result)
+{
+	nvme_sqe_t sqe;
+
+	memset(&sqe, 0, sizeof(sqe));
+	sqe.opcode = NVME_ADMIN_SET_FEATURES;
+	sqe.cdw10 = host2uint32_t_le(fid);
+	sqe.cdw11 = host2uint32_t_le(val);
+
+	return nvme_admin_cmd(ctrl, &sqe, result);
+}
+
+/** Create I/O queue pair in the controller.
+ *
+ * @param ctrl Controller
+ * @param q    Queue pair, initialized
+ * @return EOK on success or an error code
+ */
+static errno_t nvme_io_queue_create(nvme_ctrl_t *ctrl, nvme_queue_t *q)
+{
+	nvme_sqe_t sqe;
+	errno_t rc;
+
+	memset(&sqe, 0, sizeof(sqe));
+	sqe.opcode = NVME_ADMIN_CREATE_CQ;
+	sqe.prp1 = host2uint64_t_le(q->cq_phys);
+	sqe.cdw10 = host2uint32_t_le(((uint32_t) (q->size - 1) << 16) |
+	    q->qid);
+	sqe.cdw11 = host2uint32_t_le(NVME_CQ_IEN | NVME_QUEUE_PC);
+
+	rc = nvme_admin_cmd(ctrl, &sqe, NULL);
+	if (rc != EOK)
+		return rc;
+
+	memset(&sqe, 0, sizeof(sqe));
+	sqe.opcode = NVME_ADMIN_CREATE_SQ;
+	sqe.prp1 = host2uint64_t_le(q->sq_phys);
+	sqe.cdw10 = host2uint32_t_le(((uint32_t) (q->size - 1) << 16) |
+	    q->qid);
+	sqe.cdw11 = host2uint32_t_le(((uint32_t) q->qid << 16) |
+	    NVME_QUEUE_PC);
+
+	rc = nvme_admin_cmd(ctrl, &sqe, NULL);
+	if (rc != EOK) {
+		memset(&sqe, 0, sizeof(sqe));
+		sqe.opcode = NVME_ADMIN_DELETE_CQ;
+		sqe.cdw10 = host2uint32_t_le(q->qid);
+		(void) nvme_admin_cmd(ctrl, &sqe, NULL);
+		return rc;
+	}
+
+	return EOK;
+}
+
+/** Determine number of I/O queue pairs to use.
+ *
+ * One queue pair per CPU is requested, within the limits of the driver,
+ * of the doorbell registers mapped and of what the controller grants.
+ */
+static unsigned nvme_io_queues_count(nvme_ctrl_t *ctrl)
+{
+	size_t cpus = 1;
+	stats_cpu_t *stats = stats_get_cpus(&cpus);
+	free(stats);
+
+	unsigned count = max(min(cpus, NVME_IO_QUEUES_MAX), 1);
+
+	size_t dbs = (ctrl->regs_size - NVME_REG_DOORBELL) /
+	    (2 * ctrl->db_stride);
+	if (dbs < 2)
+		return 0;
+
+	/* One pair of doorbells is used by the admin queues */
+	count = min(count, dbs - 1);
+
+	uint32_t granted;
+	uint32_t req = ((count - 1) << 16) | (count - 1);
+	if (nvme_set_features(ctrl, NVME_FEAT_NUM_QUEUES, req,
+	    &granted) != EOK)
+		return 0;
+
+	count = min(count, (granted & 0xffff) + 1);
+	count = min(count, (granted >> 16) + 1);
+	return count;
+}
+
+/** Create I/O queue pairs.
+ *
+ * @param ctrl Controller
+ * @return EOK on success or an error code if no queue pair was created
+ */
+static errno_t nvme_io_queues_create(nvme_ctrl_t *ctrl)
+{
+	uint64_t cap = nvme_reg_read64(ctrl, NVME_REG_CAP);
+	uint16_t size = min(NVME_CAP_MQES(cap) + 1, NVME_IO_QUEUE_SIZE);
+	unsigned count = nvme_io_queues_count(ctrl);
+	errno_t rc = ENOTSUP;
+
+	for (unsigned i = 0; i < count; i++) {
+		nvme_queue_t *q = &ctrl->io[i];
+
+		rc = nvme_queue_init(ctrl, q, i + 1, size);
+		if (rc != EOK)
+			break;
+
+		rc = nvme_io_queue_create(ctrl, q);
+		if (rc != EOK) {
+			nvme_queue_fini(q);
+			break;
+		}
+
+		/* The interrupt handler polls queues below nio */
+		memory_barrier();
+		ctrl->nio++;
+	}
+
+	if (ctrl->nio == 0) {
+		ddf_msg(LVL_ERROR, "Failed creating I/O queues: %s",
+		    str_error(rc));
+		return rc;
+	}
+
+	if (nvme_set_features(ctrl, NVME_FEAT_INT_COALESCE,
+	    (NVME_INT_COALESCE_TIME << 8) | (NVME_INT_COALESCE_THR - 1),
+	    NULL) != EOK)
+		ddf_msg(LVL_NOTE, "Interrupt coalescing not supported");
+
+	ddf_msg(LVL_NOTE, "%u I/O queues of %u entries", ctrl->nio,
+	    (unsigned) size);
+	return EOK;
+}
+
+/** Block device connection handler */
+static void nvme_bd_connection(cap_call_handle_t icall_handle,
+    ipc_call_t *icall, void *arg)
+{
+	nvme_ns_t *ns = (nvme_ns_t *) ddf_fun_data_get((ddf_fun_t *) arg);
+
+	bd_conn(icall_handle, icall, &ns->bds);
+}
+
+/** Create and expose a namespace.
+ *
+ * @param ctrl Controller
+ * @param nsid Namespace identifier
+ * @param id   Identify Namespace data
+ * @return EOK on success or an error code
+ */
+static errno_t nvme_ns_create(nvme_ctrl_t *ctrl, uint32_t nsid,
+    nvme_identify_ns_t *id)
+{
+	nvme_lbaf_t *lbaf = &id->lbaf[id->flbas & 0xf];
+	ddf_fun_t *fun = NULL;
+	char *name = NULL;
+	errno_t rc;
+
+	if (uint16_t_le2host(lbaf->ms) != 0 || lbaf->lbads < 9 ||
+	    lbaf->lbads > NVME_PAGE_SHIFT) {
+		ddf_msg(LVL_WARN, "Namespace %u has unsupported LBA format",
+		    nsid);
+		return ENOTSUP;
+	}
+
+	if (asprintf(&name, "ns%u", nsid) < 0)
+		return ENOMEM;
+
+	fun = ddf_fun_create(ctrl->dev, fun_exposed, name);
+	free(name);
+	if (fun == NULL) {
+		ddf_msg(LVL_ERROR, "Failed creating DDF function.");
+		return ENOMEM;
+	}
+
+	nvme_ns_t *ns = ddf_fun_data_alloc(fun, sizeof(nvme_ns_t));
+	if (ns == NULL) {
+		rc = ENOMEM;
+		goto error;
+	}
+
+	ns->ctrl = ctrl;
+	ns->nsid = nsid;
+	ns->fun = fun;
+	ns->block_size = (size_t) 1 << lbaf->lbads;
+	ns->blocks = uint64_t_le2host(id->nsze);
+
+	bd_srvs_init(&ns->bds);
+	ns->bds.ops = &nvme_bd_ops;
+	ns->bds.sarg = ns;
+
+	ddf_fun_set_conn_handler(fun, nvme_bd_connection);
+
+	rc = ddf_fun_bind(fun);
+	if (rc != EOK) {
+		ddf_msg(LVL_ERROR, "Failed binding DDF function: %s",
+		    str_error(rc));
+		goto error;
+	}
+
+	rc = ddf_fun_add_to_category(fun, "disk");
+	if (rc != EOK) {
+		ddf_msg(LVL_ERROR, "Failed adding function to category");
+		ddf_fun_unbind(fun);
+		goto error;
+	}
+
+	ctrl->ns[ctrl->nns++] = ns;
+
+	ddf_msg(LVL_NOTE, "Namespace %u: %" PRIu64 " blocks of %zu bytes",
+	    nsid, ns->blocks, ns->block_size);
+	return EOK;
+error:
+	ddf_fun_destroy(fun);
+	return rc;
+}
+
+/** Identify the controller and expose its namespaces. */
+static errno_t nvme_ctrl_identify(nvme_ctrl_t *ctrl)
+{
+	uintptr_t phys;
+	void *buf = AS_AREA_ANY;
+	errno_t rc;
+
+	rc = dmamem_map_anonymous(NVME_PAGE_SIZE, 0,
+	    AS_AREA_READ | AS_AREA_WRITE, 0, &phys, &buf);
+	if (rc != EOK)
+		return rc;
+
+	rc = nvme_identify(ctrl, NVME_IDENTIFY_CTRL, 0, phys);
+	if (rc != EOK) {
+		ddf_msg(LVL_ERROR, "Failed identifying controller");
+		goto out;
+	}
+
+	nvme_identify_ctrl_t *idc = (nvme_identify_ctrl_t *) buf;
+	char model[sizeof(idc->mn) + 1];
+
+	str_ncpy(model, sizeof(model), idc->mn, sizeof(idc->mn));
+	str_rtrim(model, ' ');
+	ddf_msg(LVL_NOTE, "Controller %s", model);
+
+	ctrl->vwc = (idc->vwc & 1) != 0;
+	ctrl->dsm = (uint16_t_le2host(idc->oncs) & NVME_ONCS_DSM) != 0;
+	ctrl->max_xfer = NVME_XFER_MAX;
+	if (idc->mdts != 0 && idc->mdts < 32) {
+		/* The page size minimum is NVME_PAGE_SIZE */
+		uint64_t mdts = (uint64_t) NVME_PAGE_SIZE << idc->mdts;
+		ctrl->max_xfer = min(ctrl->max_xfer, mdts);
+	}
+
+	uint32_t nn = min(uint32_t_le2host(idc->nn), NVME_NS_MAX);
+
+	rc = nvme_io_queues_create(ctrl);
+	if (rc != EOK)
+		goto out;
+
+	for (uint32_t nsid = 1; nsid <= nn; nsid++) {
+		nvme_identify_ns_t *ids = (nvme_identify_ns_t *) buf;
+
+		memset(buf, 0, NVME_PAGE_SIZE);
+		if (nvme_identify(ctrl, NVME_IDENTIFY_NS, nsid, phys) != EOK)
+			continue;
+
+		/* Inactive namespace */
+		if (ids->nsze == 0)
+			continue;
+
+		(void) nvme_ns_create(ctrl, nsid, ids);
+	}
+
+	rc = EOK;
+out:
+	dmamem_unmap_anonymous(buf);
+	return rc;
+}
+
+/** Reset the controller and set up the admin queues. */
+static errno_t nvme_ctrl_enable(nvme_ctrl_t *ctrl)
+{
+	uint64_t cap = nvme_reg_read64(ctrl, NVME_REG_CAP);
+	errno_t rc;
+
+	ctrl->db_stride = (size_t) 4 << NVME_CAP_DSTRD(cap);
+	ctrl->timeout = NVME_CAP_TO(cap);
+
+	if (NVME_CAP_MPSMIN(cap) != 0) {
+		ddf_msg(LVL_ERROR, "Unsupported memory page size");
+		return ENOTSUP;
+	}
+
+	uint32_t cc = nvme_reg_read32(ctrl, NVME_REG_CC);
+	if ((cc & NVME_CC_EN) != 0) {
+		nvme_reg_write32(ctrl, NVME_REG_CC, cc & ~NVME_CC_EN);
+		rc = nvme_ctrl_wait_ready(ctrl, false);
+		if (rc != EOK) {
+			ddf_msg(LVL_ERROR, "Controller reset failed");
+			return rc;
+		}
+	}
+
+	uint16_t size = min(NVME_CAP_MQES(cap) + 1, NVME_ADMIN_QUEUE_SIZE);
+	rc = nvme_queue_init(ctrl, &ctrl->admin, 0, size);
+	if (rc != EOK)
+		return rc;
+
+	nvme_reg_write32(ctrl, NVME_REG_AQA,
+	    ((uint32_t) (size - 1) << 16) | (size - 1));
+	nvme_reg_write64(ctrl, NVME_REG_ASQ, ctrl->admin.sq_phys);
+	nvme_reg_write64(ctrl, NVME_REG_ACQ, ctrl->admin.cq_phys);
+
+	nvme_reg_write32(ctrl, NVME_REG_CC, NVME_CC_EN | NVME_CC_CSS_NVM |
+	    NVME_CC_MPS(NVME_PAGE_SHIFT) | NVME_CC_AMS_RR |
+	    NVME_CC_IOSQES(NVME_SQE_SHIFT) | NVME_CC_IOCQES(NVME_CQE_SHIFT));
+
+	rc = nvme_ctrl_wait_ready(ctrl, true);
+	if (rc != EOK) {
+		ddf_msg(LVL_ERROR, "Controller failed to become ready");
+		nvme_reg_write32(ctrl, NVME_REG_CC, 0);
+		nvme_queue_fini(&ctrl->admin);
+		return rc;
+	}
+
+	return EOK;
+}
+
+/** Disable the controller and free the queues. */
+static void nvme_ctrl_disable(nvme_ctrl_t *ctrl)
+{
+	nvme_reg_write32(ctrl, NVME_REG_CC, 0);
+	(void) nvme_ctrl_wait_ready(ctrl, false);
+
+	while (ctrl->nio > 0)
+		nvme_queue_fini(&ctrl->io[--ctrl->nio]);
+	nvme_queue_fini(&ctrl->admin);
+}
+
+static errno_t nvme_rw(nvme_ns_t *ns, bool write, aoff64_t ba, size_t cnt,
+    void *buf, size_t size)
+{
+	nvme_ctrl_t *ctrl = ns->ctrl;
+	nvme_xfer_t xfer;
+	uint8_t *ptr = (uint8_t *) buf;
+	errno_t rc;
+
+	if (size < cnt * ns->block_size)
+		return EINVAL;
+
+	if (ba + cnt < ba || ba + cnt > ns->blocks)
+		return ELIMIT;
+
+	xfer.head = -1;
+	xfer.tail = -1;
+	xfer.rc = EOK;
+
+	size_t cmd_blocks = ctrl->max_xfer / ns->block_size;
+	nvme_queue_t *q = nvme_io_queue_get(ctrl);
+
+	fibril_mutex_lock(&q->lock);
+
+	while (cnt > 0) {
+		size_t nblocks = min(cnt, cmd_blocks);
+		size_t nbytes = nblocks * ns->block_size;
+		nvme_sqe_t sqe;
+
+		nvme_slot_t *slot = nvme_slot_get(q, &xfer);
+
+		memset(&sqe, 0, sizeof(sqe));
+		sqe.opcode = write ? NVME_CMD_WRITE : NVME_CMD_READ;
+		sqe.nsid = host2uint32_t_le(ns->nsid);
+		sqe.cdw10 = host2uint32_t_le(LOWER32(ba));
+		sqe.cdw11 = host2uint32_t_le(UPPER32(ba));
+		sqe.cdw12 = host2uint32_t_le(nblocks - 1);
+
+		rc = nvme_slot_data_set(slot, &sqe, write, ptr, nbytes);
+		if (rc != EOK) {
+			/* Retire the slot without submitting it */
+			slot->done = true;
+			xfer.rc = rc;
+			break;
+		}
+
+		nvme_cmd_submit(q, slot, &sqe);
+
+		ba += nblocks;
+		cnt -= nblocks;
+		ptr += nbytes;
+	}
+
+	rc = nvme_xfer_wait(q, &xfer);
+	fibril_mutex_unlock(&q->lock);
+
+	return rc;
+}
+
+static errno_t nvme_bd_open(bd_srvs_t *bds, bd_srv_t *bd)
+{
+	return EOK;
+}
+
+static errno_t nvme_bd_close(bd_srv_t *bd)
+{
+	return EOK;
+}
+
+static errno_t nvme_bd_read_blocks(bd_srv_t *bd, aoff64_t ba, size_t cnt,
+    void *buf, size_t size)
+{
+	nvme_ns_t *ns = (nvme_ns_t *) bd->srvs->sarg;
+
+	return nvme_rw(ns, false, ba, cnt, buf, size);
+}
+
+static errno_t nvme_bd_write_blocks(bd_srv_t *bd, aoff64_t ba, size_t cnt,
+    const void *buf, size_t size)
+{
+	nvme_ns_t *ns = (nvme_ns_t *) bd->srvs->sarg;
+
+	return nvme_rw(ns, true, ba, cnt, (void *) buf, size);
+}
+
+static errno_t nvme_bd_sync_cache(bd_srv_t *bd, aoff64_t ba, size_t cnt)
+{
+	nvme_ns_t *ns = (nvme_ns_t *) bd->srvs->sarg;
+	nvme_ctrl_t *ctrl = ns->ctrl;
+	nvme_xfer_t xfer;
+	nvme_sqe_t sqe;
+
+	/* Without a volatile write cache all writes are durable */
+	if (!ctrl->vwc)
+		return EOK;
+
+	xfer.head = -1;
+	xfer.tail = -1;
+	xfer.rc = EOK;
+
+	memset(&sqe, 0, sizeof(sqe));
+	sqe.opcode = NVME_CMD_FLUSH;
+	sqe.nsid = host2uint32_t_le(ns->nsid);
+
+	nvme_queue_t *q = nvme_io_queue_get(ctrl);
+
+	fibril_mutex_lock(&q->lock);
+	nvme_slot_t *slot = nvme_slot_get(q, &xfer);
+	nvme_cmd_submit(q, slot, &sqe);
+	errno_t rc = nvme_xfer_wait(q, &xfer);
+	fibril_mutex_unlock(&q->lock);
+
+	return rc;
+}
+
+/** Deallocate blocks using Dataset Management commands.
+ *
+ * Each command carries up to NVME_DSM_RANGES_MAX ranges. Extents longer
+ * than a range can describe are split.
+ */
+static errno_t nvme_bd_discard_blocks(bd_srv_t *bd, const bd_extent_t *ext,
+    size_t cnt)
+{
+	nvme_ns_t *ns = (nvme_ns_t *) bd->srvs->sarg;
+	nvme_ctrl_t *ctrl = ns->ctrl;
+	nvme_xfer_t xfer;
+	nvme_sqe_t sqe;
+	errno_t rc;
+
+	if (!ctrl->dsm)
+		return ENOTSUP;
+
+	for (size_t i = 0; i < cnt; i++) {
+		if (ext[i].ba + ext[i].cnt < ext[i].ba ||
+		    ext[i].ba + ext[i].cnt > ns->blocks)
+			return ELIMIT;
+	}
+
+	size_t rsize = NVME_DSM_RANGES_MAX * sizeof(nvme_dsm_range_t);
+	nvme_dsm_range_t *ranges = malloc(rsize);
+	if (ranges == NULL)
+		return ENOMEM;
+
+	xfer.head = -1;
+	xfer.tail = -1;
+	xfer.rc = EOK;
+
+	nvme_queue_t *q = nvme_io_queue_get(ctrl);
+
+	fibril_mutex_lock(&q->lock);
+
+	size_t i = 0;
+	aoff64_t ba = (cnt > 0) ? ext[0].ba : 0;
+	size_t left = (cnt > 0) ? ext[0].cnt : 0;
+
+	while (i < cnt) {
+		unsigned nr = 0;
+
+		/* Fill in ranges of one command */
+		while (i < cnt && nr < NVME_DSM_RANGES_MAX) {
+			if (left == 0) {
+				if (++i < cnt) {
+					ba = ext[i].ba;
+					left = ext[i].cnt;
+				}
+				continue;
+			}
+
+			uint32_t nlb = min(left, UINT32_MAX);
+			ranges[nr].cattr = 0;
+			ranges[nr].nlb = host2uint32_t_le(nlb);
+			ranges[nr].slba = host2uint64_t_le(ba);
+			nr++;
+
+			ba += nlb;
+			left -= nlb;
+		}
+
+		if (nr == 0)
+			break;
+
+		nvme_slot_t *slot = nvme_slot_get(q, &xfer);
+
+		memset(&sqe, 0, sizeof(sqe));
+		sqe.opcode = NVME_CMD_DSM;
+		sqe.nsid = host2uint32_t_le(ns->nsid);
+		sqe.cdw10 = host2uint32_t_le(nr - 1);
+		sqe.cdw11 = host2uint32_t_le(NVME_DSM_AD);
+
+		/* The ranges are copied to a bounce buffer if needed */
+		rc = nvme_slot_data_set(slot, &sqe, true, ranges,
+		    nr * sizeof(nvme_dsm_range_t));
+		if (rc != EOK) {
+			/* Retire the slot without submitting it */
+			slot->done = true;
+			xfer.rc = rc;
+			break;
+		}
+
+		nvme_cmd_submit(q, slot, &sqe);
+
+		/*
+		 * The controller may read the ranges directly from our
+		 * buffer, so wait before filling it again.
+		 */
+		rc = nvme_xfer_wait(q, &xfer);
+		if (rc != EOK)
+			break;
+	}
+
+	rc = nvme_xfer_wait(q, &xfer);
+	fibril_mutex_unlock(&q->lock);
+
+	free(ranges);
+	return rc;
+}
+
+static errno_t nvme_bd_get_block_size(bd_srv_t *bd, size_t *rsize)
+{
+	nvme_ns_t *ns = (nvme_ns_t *) bd->srvs->sarg;
+
+	*rsize = ns->block_size;
+	return EOK;
+}
+
+static errno_t nvme_bd_get_num_blocks(bd_srv_t *bd, aoff64_t *rnb)
+{
+	nvme_ns_t *ns = (nvme_ns_t *) bd->srvs->sarg;
+
+	*rnb = ns->blocks;
+	return EOK;
+}
+
+static errno_t nvme_dev_add(ddf_dev_t *dev)
+{
+	hw_res_list_parsed_t res;
+	errno_t rc;
+
+	ddf_msg(LVL_NOTE, "%s %s (handle = %zu)", __func__,
+	    ddf_dev_get_name(dev), ddf_dev_get_handle(dev));
+
+	nvme_ctrl_t *ctrl = ddf_dev_data_alloc(dev, sizeof(nvme_ctrl_t));
+	if (ctrl == NULL) {
+		ddf_msg(LVL_ERROR, "Failed allocating soft state.");
+		return ENOMEM;
+	}
+
+	ctrl->dev = dev;
+
+	async_sess_t *parent_sess = ddf_dev_parent_sess_get(dev);
+	if (parent_sess == NULL)
+		return ENOMEM;
+
+	hw_res_list_parsed_init(&res);
+	rc = hw_res_get_list_parsed(parent_sess, &res, 0);
+	if (rc != EOK)
+		return rc;
+
+	if (res.mem_ranges.count < 1 || res.irqs.count < 1 ||
+	    RNGSZ(res.mem_ranges.ranges[0]) <= NVME_REG_DOORBELL) {
+		ddf_msg(LVL_ERROR, "Missing hardware resources.");
+		hw_res_list_parsed_clean(&res);
+		return EINVAL;
+	}
+
+	ctrl->irq = res.irqs.irqs[0];
+	ctrl->regs_phys = RNGABS(res.mem_ranges.ranges[0]);
+	ctrl->regs_size = RNGSZ(res.mem_ranges.ranges[0]);
+
+	rc = pio_enable_range(&res.mem_ranges.ranges[0], &ctrl->regs);
+	hw_res_list_parsed_clean(&res);
+	if (rc != EOK) {
+		ddf_msg(LVL_ERROR, "Failed mapping controller registers.");
+		return rc;
+	}
+
+	rc = nvme_ctrl_enable(ctrl);
+	if (rc != EOK)
+		return rc;
+
+	rc = nvme_register_interrupt(ctrl);
+	if (rc != EOK) {
+		ddf_msg(LVL_ERROR, "Failed registering interrupt handler.");
+		goto disable;
+	}
+
+	rc = hw_res_enable_interrupt(parent_sess, ctrl->irq);
+	if (rc != EOK) {
+		ddf_msg(LVL_ERROR, "Failed enabling interrupt.");
+		goto unregister;
+	}
+
+	ddf_msg(LVL_NOTE, "Registered IRQ %d", ctrl->irq);
+
+	rc = nvme_ctrl_identify(ctrl);
+	if (rc != EOK)
+		goto unregister;
+
+	if (ctrl->nns == 0)
+		ddf_msg(LVL_NOTE, "No usable namespaces.");
+
+	return EOK;
+
+unregister:
+	unregister_interrupt_handler(dev, ctrl->irq_handle);
+disable:
+	nvme_ctrl_disable(ctrl);
+	return rc;
+}
+
+int main(void)
+{
+	printf("%s: HelenOS NVM Express driver\n", NAME);
+
+	(void) ddf_log_init(NAME);
+	return ddf_driver_main(&nvme_driver);
+}
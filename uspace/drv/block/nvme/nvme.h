@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) 2018 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @file
+ * NVM Express driver
+ */
+
+#ifndef _NVME_H_
+#define _NVME_H_
+
+#include <abi/cap.h>
+#include <bd_srv.h>
+#include <ddf/driver.h>
+#include <ddi.h>
+#include <fibril_synch.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "nvme_hw.h"
+
+/** Number of entries of the admin queues */
+#define NVME_ADMIN_QUEUE_SIZE	16
+/** Maximum number of entries of one I/O queue */
+#define NVME_IO_QUEUE_SIZE	64
+/** Maximum number of I/O queue pairs */
+#define NVME_IO_QUEUES_MAX	8
+/** Maximum number of namespaces exposed */
+#define NVME_NS_MAX		16
+
+/** Maximum data transfer of one command */
+#define NVME_XFER_MAX		(256 * 1024)
+
+/** Interrupt coalescing aggregation threshold (completions) */
+#define NVME_INT_COALESCE_THR	8
+/** Interrupt coalescing aggregation time (in 100 us units) */
+#define NVME_INT_COALESCE_TIME	1
+
+struct nvme_ctrl;
+
+/** Command slot */
+typedef struct {
+	/** Command identifier, index of the slot */
+	uint16_t cid;
+	/** Command has been completed by the controller */
+	bool done;
+	/** Status field of the completion */
+	uint16_t status;
+	/** Command specific result of the completion */
+	uint32_t result;
+	/** Next slot in the free list or in a transfer, -1 if none */
+	int next;
+	/** PRP list page */
+	uint64_t *prp_list;
+	uintptr_t prp_list_phys;
+	/** Bounce buffer, NULL if transferring to the client buffer */
+	void *bounce;
+	/** Where to copy data read into the bounce buffer or NULL */
+	void *dest;
+	/** Size of the data transfer */
+	size_t size;
+} nvme_slot_t;
+
+/** Submission and completion queue pair */
+typedef struct {
+	struct nvme_ctrl *ctrl;
+	/** Queue identifier, 0 for the admin queues */
+	uint16_t qid;
+	/** Number of entries of each of the queues */
+	uint16_t size;
+
+	/** Protects the queue pair and its slots */
+	fibril_mutex_t lock;
+	/** Signalled when a command completes or a slot is freed */
+	fibril_condvar_t cv;
+
+	nvme_sqe_t *sq;
+	uintptr_t sq_phys;
+	uint16_t sq_tail;
+	ioport32_t *sq_db;
+
+	nvme_cqe_t *cq;
+	uintptr_t cq_phys;
+	uint16_t cq_head;
+	uint16_t cq_phase;
+	ioport32_t *cq_db;
+
+	/** Command slots */
+	nvme_slot_t *slots;
+	unsigned nslots;
+	int free_head;
+	/** PRP list pages of all slots */
+	void *prp_lists;
+} nvme_queue_t;
+
+/** Transfer consisting of a list of commands */
+typedef struct {
+	/** First and last slot of the transfer, -1 if none */
+	int head;
+	int tail;
+	/** Status of the first failed command or EOK */
+	errno_t rc;
+} nvme_xfer_t;
+
+/** Namespace */
+typedef struct {
+	struct nvme_ctrl *ctrl;
+	uint32_t nsid;
+	ddf_fun_t *fun;
+	bd_srvs_t bds;
+	size_t block_size;
+	uint64_t blocks;
+} nvme_ns_t;
+
+/** NVM Express controller */
+typedef struct nvme_ctrl {
+	ddf_dev_t *dev;
+
+	/** Controller registers */
+	void *regs;
+	size_t regs_size;
+	uintptr_t regs_phys;
+	/** Doorbell stride in bytes */
+	size_t db_stride;
+	/** Doorbell timeout in 500 ms units */
+	unsigned timeout;
+
+	nvme_queue_t admin;
+	nvme_queue_t io[NVME_IO_QUEUES_MAX];
+	unsigned nio;
+
+	/** Maximum data transfer of one command */
+	size_t max_xfer;
+	/** Controller has a volatile write cache */
+	bool vwc;
+	/** Controller supports Dataset Management (deallocate) */
+	bool dsm;
+
+	nvme_ns_t *ns[NVME_NS_MAX];
+	unsigned nns;
+
+	int irq;
+	cap_irq_handle_t irq_handle;
+} nvme_ctrl_t;
+
+#endif
@@ -0,0 +1,221 @@
+/*
+ * Copyright (c) 2018 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @file
+ * NVM Express controller registers and data structures
+ */
+
+#ifndef _NVME_HW_H_
+#define _NVME_HW_H_
+
+#include <stdint.h>
+
+/** Controller register offsets */
+#define NVME_REG_CAP	0x00
+#define NVME_REG_VS	0x08
+#define NVME_REG_INTMS	0x0c
+#define NVME_REG_INTMC	0x10
+#define NVME_REG_CC	0x14
+#define NVME_REG_CSTS	0x1c
+#define NVME_REG_AQA	0x24
+#define NVME_REG_ASQ	0x28
+#define NVME_REG_ACQ	0x30
+
+/** Offset of the first doorbell register */
+#define NVME_REG_DOORBELL	0x1000
+
+/** Maximum Queue Entries Supported (0's based) */
+#define NVME_CAP_MQES(cap)	((unsigned) ((cap) & 0xffff))
+/** Timeout in 500 ms units */
+#define NVME_CAP_TO(cap)	((unsigned) (((cap) >> 24) & 0xff))
+/** Doorbell Stride */
+#define NVME_CAP_DSTRD(cap)	((unsigned) (((cap) >> 32) & 0xf))
+/** Memory Page Size Minimum */
+#define NVME_CAP_MPSMIN(cap)	((unsigned) (((cap) >> 48) & 0xf))
+
+/** Controller Configuration */
+#define NVME_CC_EN		(1U << 0)
+#define NVME_CC_CSS_NVM		(0U << 4)
+#define NVME_CC_MPS(shift)	(((shift) - 12) << 7)
+#define NVME_CC_AMS_RR		(0U << 11)
+#define NVME_CC_IOSQES(shift)	((shift) << 16)
+#define NVME_CC_IOCQES(shift)	((shift) << 20)
+
+/** Controller Status */
+#define NVME_CSTS_RDY	(1U << 0)
+#define NVME_CSTS_CFS	(1U << 1)
+
+/** Memory page size used by the driver */
+#define NVME_PAGE_SHIFT	12
+#define NVME_PAGE_SIZE	(1U << NVME_PAGE_SHIFT)
+
+/** Admin command opcodes */
+#define NVME_ADMIN_DELETE_SQ		0x00
+#define NVME_ADMIN_CREATE_SQ		0x01
+#define NVME_ADMIN_DELETE_CQ		0x04
+#define NVME_ADMIN_CREATE_CQ		0x05
+#define NVME_ADMIN_IDENTIFY		0x06
+#define NVME_ADMIN_SET_FEATURES		0x09
+
+/** NVM command opcodes */
+#define NVME_CMD_FLUSH	0x00
+#define NVME_CMD_WRITE	0x01
+#define NVME_CMD_READ	0x02
+#define NVME_CMD_DSM	0x09
+
+/** Optional NVM Command Support: Dataset Management */
+#define NVME_ONCS_DSM	(1U << 2)
+
+/** Dataset Management attribute: Deallocate */
+#define NVME_DSM_AD	(1U << 2)
+/** Maximum number of ranges of one Dataset Management command */
+#define NVME_DSM_RANGES_MAX	256
+
+/** Identify CNS values */
+#define NVME_IDENTIFY_NS	0x00
+#define NVME_IDENTIFY_CTRL	0x01
+
+/** Feature identifiers */
+#define NVME_FEAT_NUM_QUEUES	0x07
+#define NVME_FEAT_INT_COALESCE	0x08
+
+/** Create I/O Completion/Submission Queue flags */
+#define NVME_QUEUE_PC		(1U << 0)
+#define NVME_CQ_IEN		(1U << 1)
+
+/** Phase tag in the completion queue entry status */
+#define NVME_CQE_PHASE		(1U << 0)
+/** Status field (SC and SCT) of the completion queue entry status */
+#define NVME_CQE_STATUS(status)	(((status) >> 1) & 0x7ff)
+
+/** Submission queue entry */
+typedef struct {
+	/** Opcode, fused operation, PRP or SGL and command identifier */
+	uint8_t opcode;
+	uint8_t flags;
+	uint16_t cid;
+	/** Namespace Identifier */
+	uint32_t nsid;
+	uint32_t cdw2;
+	uint32_t cdw3;
+	/** Metadata Pointer */
+	uint64_t mptr;
+	/** Data Pointer */
+	uint64_t prp1;
+	uint64_t prp2;
+	/** Command specific */
+	uint32_t cdw10;
+	uint32_t cdw11;
+	uint32_t cdw12;
+	uint32_t cdw13;
+	uint32_t cdw14;
+	uint32_t cdw15;
+} __attribute__((packed)) nvme_sqe_t;
+
+/** Size of the submission queue entry as power of two */
+#define NVME_SQE_SHIFT	6
+
+/** Completion queue entry */
+typedef struct {
+	/** Command specific result */
+	uint32_t result;
+	uint32_t reserved;
+	/** Submission Queue Head Pointer */
+	uint16_t sq_head;
+	/** Submission Queue Identifier */
+	uint16_t sq_id;
+	/** Command Identifier */
+	uint16_t cid;
+	/** Phase tag and status field */
+	uint16_t status;
+} __attribute__((packed)) nvme_cqe_t;
+
+/** Size of the completion queue entry as power of two */
+#define NVME_CQE_SHIFT	4
+
+/** Identify Controller data structure (the fields used) */
+typedef struct {
+	uint8_t reserved0[4];
+	/** Serial Number */
+	char sn[20];
+	/** Model Number */
+	char mn[40];
+	/** Firmware Revision */
+	char fr[8];
+	uint8_t reserved72[5];
+	/** Maximum Data Transfer Size as power of two of the minimum page */
+	uint8_t mdts;
+	uint8_t reserved78[438];
+	/** Number of Namespaces */
+	uint32_t nn;
+	/** Optional NVM Command Support */
+	uint16_t oncs;
+	uint8_t reserved522[3];
+	/** Volatile Write Cache */
+	uint8_t vwc;
+	uint8_t reserved526[3570];
+} __attribute__((packed)) nvme_identify_ctrl_t;
+
+/** Dataset Management range */
+typedef struct {
+	/** Context Attributes */
+	uint32_t cattr;
+	/** Length in logical blocks */
+	uint32_t nlb;
+	/** Starting LBA */
+	uint64_t slba;
+} __attribute__((packed)) nvme_dsm_range_t;
+
+/** LBA Format data structure */
+typedef struct {
+	/** Metadata Size */
+	uint16_t ms;
+	/** LBA Data Size as power of two */
+	uint8_t lbads;
+	/** Relative Performance */
+	uint8_t rp;
+} __attribute__((packed)) nvme_lbaf_t;
+
+/** Identify Namespace data structure (the fields used) */
+typedef struct {
+	/** Namespace Size in logical blocks */
+	uint64_t nsze;
+	/** Namespace Capacity */
+	uint64_t ncap;
+	/** Namespace Utilization */
+	uint64_t nuse;
+	uint8_t reserved24[2];
+	/** Formatted LBA Size */
+	uint8_t flbas;
+	uint8_t reserved27[101];
+	/** LBA Formats */
+	nvme_lbaf_t lbaf[16];
+	uint8_t reserved192[3904];
+} __attribute__((packed)) nvme_identify_ns_t;
+
+#endif
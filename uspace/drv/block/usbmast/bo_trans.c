@@ -48,16 +48,8 @@
 #define MASTLOG(format, ...) \
 	usb_log_debug2("USB cl08: " format, ##__VA_ARGS__)
 
-/** Send command via bulk-only transport.
- *
- * @param mfun		Mass storage function
- * @param tag		Command block wrapper tag (automatically compared
- *			with answer)
- * @param cmd		SCSI command
- *
- * @return		Error code
- */
-errno_t usb_massstor_cmd(usbmast_fun_t *mfun, uint32_t tag, scsi_cmd_t *cmd)
+static errno_t usb_massstor_cmd_locked(usbmast_fun_t *mfun, uint32_t tag,
+    scsi_cmd_t *cmd)
 {
 	errno_t rc;
 
@@ -186,6 +178,26 @@ errno_t usb_massstor_cmd(usbmast_fun_t *mfun, uint32_t tag, scsi_cmd_t *cmd)
 	return rc;
 }
 
+/** Send command via bulk-only transport.
+ *
+ * The transport allows only one command at a time, commands issued by
+ * concurrent clients are serialized.
+ *
+ * @param mfun		Mass storage function
+ * @param tag		Command block wrapper tag (automatically compared
+ *			with answer)
+ * @param cmd		SCSI command
+ *
+ * @return		Error code
+ */
+errno_t usb_massstor_cmd(usbmast_fun_t *mfun, uint32_t tag, scsi_cmd_t *cmd)
+{
+	fibril_mutex_lock(&mfun->mdev->bot_guard);
+	const errno_t rc = usb_massstor_cmd_locked(mfun, tag, cmd);
+	fibril_mutex_unlock(&mfun->mdev->bot_guard);
+	return rc;
+}
+
 /** Perform bulk-only mass storage reset.
  *
  * @param mfun		Mass storage function
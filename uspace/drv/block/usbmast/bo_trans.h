@@ -78,9 +78,17 @@ typedef struct {
 	/** Size of input buffer in bytes */
 	size_t data_in_size;
 
+	/** Buffer for sense data, if the transport returns it (optional) */
+	void *sense;
+	/** Size of sense buffer in bytes */
+	size_t sense_size;
+
 	/** Number of bytes actually received */
 	size_t rcvd_size;
 
+	/** Number of sense bytes received along with the status */
+	size_t sense_rcvd;
+
 	/** Status */
 	cmd_status_t status;
 } scsi_cmd_t;
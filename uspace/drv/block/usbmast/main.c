@@ -50,6 +50,7 @@
 #include "cmdw.h"
 #include "bo_trans.h"
 #include "scsi_ms.h"
+#include "uas.h"
 #include "usbmast.h"
 
 #define NAME "usbmast"
@@ -151,15 +152,6 @@ static errno_t usbmast_device_add(usb_device_t *dev)
 	usbmast_dev_t *mdev = NULL;
 	unsigned i;
 
-	usb_endpoint_mapping_t *epm_in =
-	    usb_device_get_mapped_ep_desc(dev, &bulk_in_ep);
-	usb_endpoint_mapping_t *epm_out =
-	    usb_device_get_mapped_ep_desc(dev, &bulk_out_ep);
-	if (!epm_in || !epm_out || !epm_in->present || !epm_out->present) {
-		usb_log_error("Required EPs were not mapped.");
-		return ENOENT;
-	}
-
 	/* Allocate softstate */
 	mdev = usb_device_data_alloc(dev, sizeof(usbmast_dev_t));
 	if (mdev == NULL) {
@@ -168,24 +160,59 @@ static errno_t usbmast_device_add(usb_device_t *dev)
 	}
 
 	mdev->usb_dev = dev;
+	fibril_mutex_initialize(&mdev->bot_guard);
 
 	usb_log_info("Initializing mass storage `%s'.",
 	    usb_device_get_name(dev));
-	usb_log_debug("Bulk in endpoint: %d [%zuB].",
-	    epm_in->pipe.desc.endpoint_no, epm_in->pipe.desc.max_transfer_size);
-	usb_log_debug("Bulk out endpoint: %d [%zuB].",
-	    epm_out->pipe.desc.endpoint_no, epm_out->pipe.desc.max_transfer_size);
 
-	usb_log_debug("Get LUN count...");
-	mdev->lun_count = usb_masstor_get_lun_count(mdev);
+	if (usb_uas_supported(dev)) {
+		rc = usb_uas_init(mdev);
+		if (rc != EOK) {
+			usb_log_warning("UAS unusable, falling back to "
+			    "Bulk-Only Transport: %s.", str_error(rc));
+			rc = usb_device_select_interface(dev, 0, mast_endpoints);
+			if (rc != EOK) {
+				usb_log_error("Failed to select Bulk-Only "
+				    "interface: %s.", str_error(rc));
+				return rc;
+			}
+		}
+	}
+
+	if (mdev->uas) {
+		/* GET MAX LUN is a Bulk-Only request. */
+		mdev->lun_count = 1;
+	} else {
+		usb_endpoint_mapping_t *epm_in =
+		    usb_device_get_mapped_ep_desc(dev, &bulk_in_ep);
+		usb_endpoint_mapping_t *epm_out =
+		    usb_device_get_mapped_ep_desc(dev, &bulk_out_ep);
+		if (!epm_in || !epm_out || !epm_in->present ||
+		    !epm_out->present) {
+			usb_log_error("Required EPs were not mapped.");
+			return ENOENT;
+		}
+
+		usb_log_debug("Bulk in endpoint: %d [%zuB].",
+		    epm_in->pipe.desc.endpoint_no,
+		    epm_in->pipe.desc.max_transfer_size);
+		usb_log_debug("Bulk out endpoint: %d [%zuB].",
+		    epm_out->pipe.desc.endpoint_no,
+		    epm_out->pipe.desc.max_transfer_size);
+
+		mdev->bulk_in_pipe = &epm_in->pipe;
+		mdev->bulk_out_pipe = &epm_out->pipe;
+
+		usb_log_debug("Get LUN count...");
+		mdev->lun_count = usb_masstor_get_lun_count(mdev);
+	}
+
 	mdev->luns = calloc(mdev->lun_count, sizeof(ddf_fun_t *));
 	if (mdev->luns == NULL) {
 		usb_log_error("Failed allocating luns table.");
 		return ENOMEM;
 	}
 
-	mdev->bulk_in_pipe = &epm_in->pipe;
-	mdev->bulk_out_pipe = &epm_out->pipe;
 	for (i = 0; i < mdev->lun_count; i++) {
 		rc = usbmast_fun_create(mdev, i);
 		if (rc != EOK)
@@ -276,7 +303,8 @@ static errno_t usbmast_fun_create(usbmast_dev_t *mdev, unsigned lun)
 	    usbmast_scsi_dev_type_str(inquiry.device_type),
 	    inquiry.removable ? "removable" : "non-removable");
 
-	uint32_t nblocks, block_size;
+	uint64_t nblocks;
+	uint32_t block_size;
 
 	rc = usbmast_read_capacity(mfun, &nblocks, &block_size);
 	if (rc != EOK) {
@@ -286,7 +314,7 @@ static errno_t usbmast_fun_create(usbmast_dev_t *mdev, unsigned lun)
 		goto error;
 	}
 
-	usb_log_info("Read Capacity: nblocks=%" PRIu32 ", "
+	usb_log_info("Read Capacity: nblocks=%" PRIu64 ", "
 	    "block_size=%" PRIu32 "\n", nblocks, block_size);
 
 	mfun->nblocks = nblocks;
@@ -50,8 +50,12 @@
 #include "cmdw.h"
 #include "bo_trans.h"
 #include "scsi_ms.h"
+#include "uas.h"
 #include "usbmast.h"
 
+/** Largest data transfer issued by a single Read or Write command */
+#define USBMAST_MAX_XFER_SIZE  (256 * 1024)
+
 /** Get string representation for SCSI peripheral device type.
  *
  * @param type		SCSI peripheral device type code.
@@ -72,6 +76,15 @@ static void usbmast_dump_sense(scsi_sense_data_t *sense_buf)
 	    sense_buf->additional_cqual);
 }
 
+/** Deliver a SCSI command using the transport the device was set up with. */
+static errno_t usbmast_cmd(usbmast_fun_t *mfun, scsi_cmd_t *cmd)
+{
+	if (mfun->mdev->uas)
+		return usb_uas_cmd(mfun, cmd);
+
+	return usb_massstor_cmd(mfun, 0xDEADBEEF, cmd);
+}
+
 static errno_t usb_massstor_unit_ready(usbmast_fun_t *mfun)
 {
 	scsi_cmd_t cmd;
@@ -85,7 +98,7 @@ static errno_t usb_massstor_unit_ready(usbmast_fun_t *mfun)
 	cmd.cdb = &cdb;
 	cmd.cdb_size = sizeof(cdb);
 
-	rc = usb_massstor_cmd(mfun, 0xDEADBEEF, &cmd);
+	rc = usbmast_cmd(mfun, &cmd);
 
 	if (rc != EOK) {
 		usb_log_error("Test Unit Ready failed on device %s: %s.",
@@ -122,7 +135,11 @@ static errno_t usbmast_run_cmd(usbmast_fun_t *mfun, scsi_cmd_t *cmd)
 			return rc;
 		}
 
-		rc = usb_massstor_cmd(mfun, 0xDEADBEEF, cmd);
+		memset(&sense_buf, 0, sizeof(sense_buf));
+		cmd->sense = &sense_buf;
+		cmd->sense_size = sizeof(sense_buf);
+
+		rc = usbmast_cmd(mfun, cmd);
 		if (rc != EOK) {
 			usb_log_error("Inquiry transport failed, device %s: %s.",
 			    usb_device_get_name(mfun->mdev->usb_dev), str_error(rc));
@@ -135,10 +152,14 @@ static errno_t usbmast_run_cmd(usbmast_fun_t *mfun, scsi_cmd_t *cmd)
 		usb_log_error("SCSI command failed, device %s.",
 		    usb_device_get_name(mfun->mdev->usb_dev));
 
-		rc = usbmast_request_sense(mfun, &sense_buf, sizeof(sense_buf));
-		if (rc != EOK) {
-			usb_log_error("Failed to read sense data.");
-			return EIO;
+		/* UAS delivers sense data along with the status. */
+		if (cmd->sense_rcvd == 0) {
+			rc = usbmast_request_sense(mfun, &sense_buf,
+			    sizeof(sense_buf));
+			if (rc != EOK) {
+				usb_log_error("Failed to read sense data.");
+				return EIO;
+			}
 		}
 
 		/* Dump sense data to log */
@@ -180,7 +201,7 @@ errno_t usbmast_inquiry(usbmast_fun_t *mfun, usbmast_inquiry_data_t *inq_res)
 	cmd.data_in = &inq_data;
 	cmd.data_in_size = sizeof(inq_data);
 
-	rc = usb_massstor_cmd(mfun, 0xDEADBEEF, &cmd);
+	rc = usbmast_cmd(mfun, &cmd);
 
 	if (rc != EOK) {
 		usb_log_error("Inquiry transport failed, device %s: %s.",
@@ -248,7 +269,7 @@ errno_t usbmast_request_sense(usbmast_fun_t *mfun, void *buf, size_t size)
 	cmd.data_in = buf;
 	cmd.data_in_size = size;
 
-	rc = usb_massstor_cmd(mfun, 0xDEADBEEF, &cmd);
+	rc = usbmast_cmd(mfun, &cmd);
 
 	if (rc != EOK || cmd.status != CMDS_GOOD) {
 		usb_log_error("Request Sense failed, device %s: %s.",
@@ -265,7 +286,63 @@ errno_t usbmast_request_sense(usbmast_fun_t *mfun, void *buf, size_t size)
 	return EOK;
 }
 
+/** Perform SCSI Read Capacity (16) command on USB mass storage device.
+ *
+ * @param mfun		Mass storage function
+ * @param nblocks	Output, number of blocks
+ * @param block_size	Output, block size in bytes
+ *
+ * @return		Error code.
+ */
+static errno_t usbmast_read_capacity_16(usbmast_fun_t *mfun, uint64_t *nblocks,
+    uint32_t *block_size)
+{
+	scsi_cmd_t cmd;
+	scsi_cdb_read_capacity_16_t cdb;
+	scsi_read_capacity_16_data_t data;
+	errno_t rc;
+
+	memset(&cdb, 0, sizeof(cdb));
+	cdb.op_code = SCSI_CMD_READ_CAPACITY_16;
+	cdb.service_action = SCSI_SA_READ_CAPACITY_16;
+	cdb.alloc_len = host2uint32_t_be(sizeof(data));
+
+	memset(&cmd, 0, sizeof(cmd));
+	cmd.cdb = &cdb;
+	cmd.cdb_size = sizeof(cdb);
+	cmd.data_in = &data;
+	cmd.data_in_size = sizeof(data);
+
+	rc = usbmast_run_cmd(mfun, &cmd);
+
+	if (rc != EOK) {
+		usb_log_error("Read Capacity (16) transport failed, device %s: %s.",
+		    usb_device_get_name(mfun->mdev->usb_dev), str_error(rc));
+		return rc;
+	}
+
+	if (cmd.status != CMDS_GOOD) {
+		usb_log_error("Read Capacity (16) command failed, device %s.",
+		    usb_device_get_name(mfun->mdev->usb_dev));
+		return EIO;
+	}
+
+	if (cmd.rcvd_size < offsetof(scsi_read_capacity_16_data_t, reserved_12)) {
+		usb_log_error("SCSI Read Capacity (16) response too short (%zu).",
+		    cmd.rcvd_size);
+		return EIO;
+	}
+
+	*nblocks = uint64_t_be2host(data.last_lba) + 1;
+	*block_size = uint32_t_be2host(data.block_size);
+
+	return EOK;
+}
+
 /** Perform SCSI Read Capacity command on USB mass storage device.
+ *
+ * Devices too large for Read Capacity (10) are asked again with
+ * Read Capacity (16) and are addressed with 16-byte CDBs from then on.
  *
  * @param mfun		Mass storage function
  * @param nblocks	Output, number of blocks
@@ -273,7 +350,7 @@ errno_t usbmast_request_sense(usbmast_fun_t *mfun, void *buf, size_t size)
  *
  * @return		Error code.
  */
-errno_t usbmast_read_capacity(usbmast_fun_t *mfun, uint32_t *nblocks,
+errno_t usbmast_read_capacity(usbmast_fun_t *mfun, uint64_t *nblocks,
     uint32_t *block_size)
 {
 	scsi_cmd_t cmd;
@@ -310,58 +387,100 @@ errno_t usbmast_read_capacity(usbmast_fun_t *mfun, uint32_t *nblocks,
 		return EIO;
 	}
 
-	*nblocks = uint32_t_be2host(data.last_lba) + 1;
+	const uint32_t last_lba = uint32_t_be2host(data.last_lba);
+	if (last_lba == UINT32_MAX) {
+		rc = usbmast_read_capacity_16(mfun, nblocks, block_size);
+		if (rc == EOK)
+			mfun->lba64 = true;
+		return rc;
+	}
+
+	*nblocks = (uint64_t) last_lba + 1;
 	*block_size = uint32_t_be2host(data.block_size);
 
 	return EOK;
 }
 
-/** Perform SCSI Read command on USB mass storage device.
+/** Perform a single SCSI Read or Write command on USB mass storage device.
+ *
+ * Read (10) and Write (10) are used while the blocks are addressable by
+ * them, the 16-byte variants otherwise.
  *
  * @param mfun		Mass storage function
  * @param ba		Address of first block
- * @param nblocks	Number of blocks to read
+ * @param nblocks	Number of blocks to transfer
+ * @param in		Destination buffer for read, @c NULL for write
+ * @param out		Data to write, @c NULL for read
  *
  * @return		Error code
  */
-errno_t usbmast_read(usbmast_fun_t *mfun, uint64_t ba, size_t nblocks, void *buf)
+static errno_t usbmast_rw(usbmast_fun_t *mfun, uint64_t ba, size_t nblocks,
+    void *in, const void *out)
 {
+	const char *what = (in != NULL) ? "Read" : "Write";
+	const size_t size = nblocks * mfun->block_size;
+	const bool lba64 = mfun->lba64 || ba + nblocks - 1 > UINT32_MAX ||
+	    nblocks > UINT16_MAX;
 	scsi_cmd_t cmd;
-	scsi_cdb_read_10_t cdb;
+	union {
+		scsi_cdb_read_10_t read_10;
+		scsi_cdb_read_16_t read_16;
+		scsi_cdb_write_10_t write_10;
+		scsi_cdb_write_16_t write_16;
+	} cdb;
 	errno_t rc;
 
-	if (ba > UINT32_MAX)
-		return ELIMIT;
-
-	if (nblocks > UINT16_MAX)
-		return ELIMIT;
-
 	memset(&cdb, 0, sizeof(cdb));
-	cdb.op_code = SCSI_CMD_READ_10;
-	cdb.lba = host2uint32_t_be(ba);
-	cdb.xfer_len = host2uint16_t_be(nblocks);
-
 	memset(&cmd, 0, sizeof(cmd));
 	cmd.cdb = &cdb;
-	cmd.cdb_size = sizeof(cdb);
-	cmd.data_in = buf;
-	cmd.data_in_size = nblocks * mfun->block_size;
+
+	if (in != NULL && lba64) {
+		cdb.read_16.op_code = SCSI_CMD_READ_16;
+		cdb.read_16.lba = host2uint64_t_be(ba);
+		cdb.read_16.xfer_len = host2uint32_t_be(nblocks);
+		cmd.cdb_size = sizeof(cdb.read_16);
+	} else if (in != NULL) {
+		cdb.read_10.op_code = SCSI_CMD_READ_10;
+		cdb.read_10.lba = host2uint32_t_be(ba);
+		cdb.read_10.xfer_len = host2uint16_t_be(nblocks);
+		cmd.cdb_size = sizeof(cdb.read_10);
+	} else if (lba64) {
+		cdb.write_16.op_code = SCSI_CMD_WRITE_16;
+		cdb.write_16.lba = host2uint64_t_be(ba);
+		cdb.write_16.xfer_len = host2uint32_t_be(nblocks);
+		cmd.cdb_size = sizeof(cdb.write_16);
+	} else {
+		cdb.write_10.op_code = SCSI_CMD_WRITE_10;
+		cdb.write_10.lba = host2uint32_t_be(ba);
+		cdb.write_10.xfer_len = host2uint16_t_be(nblocks);
+		cmd.cdb_size = sizeof(cdb.write_10);
+	}
+
+	if (in != NULL) {
+		cmd.data_in = in;
+		cmd.data_in_size = size;
+	} else {
+		cmd.data_out = out;
+		cmd.data_out_size = size;
+	}
 
 	rc = usbmast_run_cmd(mfun, &cmd);
 
 	if (rc != EOK) {
-		usb_log_error("Read (10) transport failed, device %s: %s.",
+		usb_log_error("%s (%d) transport failed, device %s: %s.",
+		    what, lba64 ? 16 : 10,
 		    usb_device_get_name(mfun->mdev->usb_dev), str_error(rc));
 		return rc;
 	}
 
 	if (cmd.status != CMDS_GOOD) {
-		usb_log_error("Read (10) command failed, device %s.",
+		usb_log_error("%s (%d) command failed, device %s.",
+		    what, lba64 ? 16 : 10,
 		    usb_device_get_name(mfun->mdev->usb_dev));
 		return EIO;
 	}
 
-	if (cmd.rcvd_size < nblocks * mfun->block_size) {
+	if (in != NULL && cmd.rcvd_size < size) {
 		usb_log_error("SCSI Read response too short (%zu).",
 		    cmd.rcvd_size);
 		return EIO;
@@ -370,51 +489,73 @@ errno_t usbmast_read(usbmast_fun_t *mfun, uint64_t ba, size_t nblocks, void *buf
 	return EOK;
 }
 
-/** Perform SCSI Write command on USB mass storage device.
+/** Number of blocks moved by one Read or Write command. */
+static size_t usbmast_max_xfer_blocks(usbmast_fun_t *mfun)
+{
+	return max(USBMAST_MAX_XFER_SIZE / mfun->block_size, 1);
+}
+
+/** Perform SCSI Read command on USB mass storage device.
+ *
+ * Large requests are split into commands of at most USBMAST_MAX_XFER_SIZE.
  *
  * @param mfun		Mass storage function
  * @param ba		Address of first block
  * @param nblocks	Number of blocks to read
- * @param data		Data to write
  *
  * @return		Error code
  */
-errno_t usbmast_write(usbmast_fun_t *mfun, uint64_t ba, size_t nblocks,
-    const void *data)
+errno_t usbmast_read(usbmast_fun_t *mfun, uint64_t ba, size_t nblocks, void *buf)
 {
-	scsi_cmd_t cmd;
-	scsi_cdb_write_10_t cdb;
-	errno_t rc;
+	const size_t max_blocks = usbmast_max_xfer_blocks(mfun);
+	uint8_t *dst = buf;
 
-	if (ba > UINT32_MAX)
+	if (ba + nblocks < ba)
 		return ELIMIT;
 
-	if (nblocks > UINT16_MAX)
-		return ELIMIT;
+	while (nblocks > 0) {
+		const size_t cnt = min(nblocks, max_blocks);
+		const errno_t rc = usbmast_rw(mfun, ba, cnt, dst, NULL);
+		if (rc != EOK)
+			return rc;
 
-	memset(&cdb, 0, sizeof(cdb));
-	cdb.op_code = SCSI_CMD_WRITE_10;
-	cdb.lba = host2uint32_t_be(ba);
-	cdb.xfer_len = host2uint16_t_be(nblocks);
+		ba += cnt;
+		nblocks -= cnt;
+		dst += cnt * mfun->block_size;
+	}
 
-	memset(&cmd, 0, sizeof(cmd));
-	cmd.cdb = &cdb;
-	cmd.cdb_size = sizeof(cdb);
-	cmd.data_out = data;
-	cmd.data_out_size = nblocks * mfun->block_size;
+	return EOK;
+}
 
-	rc = usbmast_run_cmd(mfun, &cmd);
+/** Perform SCSI Write command on USB mass storage device.
+ *
+ * Large requests are split into commands of at most USBMAST_MAX_XFER_SIZE.
+ *
+ * @param mfun		Mass storage function
+ * @param ba		Address of first block
+ * @param nblocks	Number of blocks to read
+ * @param data		Data to write
+ *
+ * @return		Error code
+ */
+errno_t usbmast_write(usbmast_fun_t *mfun, uint64_t ba, size_t nblocks,
+    const void *data)
+{
+	const size_t max_blocks = usbmast_max_xfer_blocks(mfun);
+	const uint8_t *src = data;
 
-	if (rc != EOK) {
-		usb_log_error("Write (10) transport failed, device %s: %s.",
-		    usb_device_get_name(mfun->mdev->usb_dev), str_error(rc));
-		return rc;
-	}
+	if (ba + nblocks < ba)
+		return ELIMIT;
 
-	if (cmd.status != CMDS_GOOD) {
-		usb_log_error("Write (10) command failed, device %s.",
-		    usb_device_get_name(mfun->mdev->usb_dev));
-		return EIO;
+	while (nblocks > 0) {
+		const size_t cnt = min(nblocks, max_blocks);
+		const errno_t rc = usbmast_rw(mfun, ba, cnt, NULL, src);
+		if (rc != EOK)
+			return rc;
+
+		ba += cnt;
+		nblocks -= cnt;
+		src += cnt * mfun->block_size;
 	}
 
 	return EOK;
@@ -431,34 +572,41 @@ errno_t usbmast_write(usbmast_fun_t *mfun, uint64_t ba, size_t nblocks,
  */
 errno_t usbmast_sync_cache(usbmast_fun_t *mfun, uint64_t ba, size_t nblocks)
 {
-	if (ba > UINT32_MAX)
-		return ELIMIT;
+	const bool lba64 = mfun->lba64 || ba > UINT32_MAX ||
+	    nblocks > UINT16_MAX;
 
-	if (nblocks > UINT16_MAX)
+	if (nblocks > UINT32_MAX)
 		return ELIMIT;
 
-	const scsi_cdb_sync_cache_10_t cdb = {
+	const scsi_cdb_sync_cache_10_t cdb_10 = {
 		.op_code = SCSI_CMD_SYNC_CACHE_10,
 		.lba = host2uint32_t_be(ba),
 		.numlb = host2uint16_t_be(nblocks),
 	};
 
+	const scsi_cdb_sync_cache_16_t cdb_16 = {
+		.op_code = SCSI_CMD_SYNC_CACHE_16,
+		.lba = host2uint64_t_be(ba),
+		.numlb = host2uint32_t_be(nblocks),
+	};
+
 	scsi_cmd_t cmd = {
-		.cdb = &cdb,
-		.cdb_size = sizeof(cdb),
+		.cdb = lba64 ? (const void *) &cdb_16 : (const void *) &cdb_10,
+		.cdb_size = lba64 ? sizeof(cdb_16) : sizeof(cdb_10),
 	};
 
 	const errno_t rc = usbmast_run_cmd(mfun, &cmd);
 
 	if (rc != EOK) {
-		usb_log_error("Synchronize Cache (10) transport failed, device %s: %s.",
+		usb_log_error("Synchronize Cache (%d) transport failed, "
+		    "device %s: %s.", lba64 ? 16 : 10,
 		    usb_device_get_name(mfun->mdev->usb_dev), str_error(rc));
 		return rc;
 	}
 
 	if (cmd.status != CMDS_GOOD) {
-		usb_log_error("Synchronize Cache (10) command failed, device %s.",
-		    usb_device_get_name(mfun->mdev->usb_dev));
+		usb_log_error("Synchronize Cache (%d) command failed, device %s.",
+		    lba64 ? 16 : 10, usb_device_get_name(mfun->mdev->usb_dev));
 		return EIO;
 	}
 
@@ -0,0 +1,493 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup drvusbmast
+ * @{
+ */
+/** @file
+ * USB Attached SCSI transport.
+ *
+ * Only the SuperSpeed variant is supported: every command gets a tag which
+ * doubles as the stream ID its data and status are moved on, so several
+ * commands can be outstanding at once.
+ */
+
+#include <assert.h>
+#include <byteorder.h>
+#include <errno.h>
+#include <fibril.h>
+#include <macros.h>
+#include <mem.h>
+#include <scsi/spc.h>
+#include <str_error.h>
+#include <usb/classes/classes.h>
+#include <usb/classes/massstor.h>
+#include <usb/debug.h>
+#include <usb/dev/request.h>
+#include "uas.h"
+
+/** Pipe Usage descriptor type */
+#define UAS_DESCTYPE_PIPE_USAGE  0x24
+
+/** Pipe IDs from the Pipe Usage descriptor */
+enum uas_pipe_id {
+	UAS_PIPE_COMMAND = 1,
+	UAS_PIPE_STATUS = 2,
+	UAS_PIPE_DATA_IN = 3,
+	UAS_PIPE_DATA_OUT = 4
+};
+
+/** Information Unit IDs */
+enum uas_iu_id {
+	UAS_IU_COMMAND = 0x01,
+	UAS_IU_SENSE = 0x03,
+	UAS_IU_RESPONSE = 0x04
+};
+
+/** Upper limit on streams requested per pipe (tags must fit uas_tags) */
+#define UAS_MAX_STREAMS  32
+
+/** How long to wait for data after the status has arrived, in usec */
+#define UAS_DATA_GRACE  100000
+
+/** Command IU */
+typedef struct {
+	uint8_t iu_id;
+	uint8_t reserved_1;
+	uint16_t tag;
+	uint8_t prio_attr;
+	uint8_t reserved_5;
+	uint8_t add_cdb_len;
+	uint8_t reserved_7;
+	uint8_t lun[8];
+	uint8_t cdb[16];
+} __attribute__((packed)) uas_command_iu_t;
+
+/** Sense IU */
+typedef struct {
+	uint8_t iu_id;
+	uint8_t reserved_1;
+	uint16_t tag;
+	uint16_t status_qualifier;
+	uint8_t status;
+	uint8_t reserved_7[7];
+	uint16_t sense_len;
+	uint8_t sense[SCSI_SENSE_DATA_MAX_SIZE];
+} __attribute__((packed)) uas_sense_iu_t;
+
+/** Response IU */
+typedef struct {
+	uint8_t iu_id;
+	uint8_t reserved_1;
+	uint16_t tag;
+	uint8_t add_response_info[3];
+	uint8_t response_code;
+} __attribute__((packed)) uas_response_iu_t;
+
+/** Any IU the device may send on the status pipe */
+typedef union {
+	uint8_t iu_id;
+	uas_sense_iu_t sense;
+	uas_response_iu_t response;
+} uas_status_iu_t;
+
+/*
+ * The descriptions must be distinct objects, the mapping is looked up by
+ * description pointer.
+ */
+static const usb_endpoint_description_t uas_cmd_ep = {
+	.transfer_type = USB_TRANSFER_BULK,
+	.direction = USB_DIRECTION_OUT,
+	.interface_class = USB_CLASS_MASS_STORAGE,
+	.interface_subclass = USB_MASSSTOR_SUBCLASS_SCSI,
+	.interface_protocol = USB_MASSSTOR_PROTOCOL_UAS,
+	.flags = 0
+};
+static const usb_endpoint_description_t uas_status_ep = {
+	.transfer_type = USB_TRANSFER_BULK,
+	.direction = USB_DIRECTION_IN,
+	.interface_class = USB_CLASS_MASS_STORAGE,
+	.interface_subclass = USB_MASSSTOR_SUBCLASS_SCSI,
+	.interface_protocol = USB_MASSSTOR_PROTOCOL_UAS,
+	.flags = 0
+};
+static const usb_endpoint_description_t uas_data_in_ep = {
+	.transfer_type = USB_TRANSFER_BULK,
+	.direction = USB_DIRECTION_IN,
+	.interface_class = USB_CLASS_MASS_STORAGE,
+	.interface_subclass = USB_MASSSTOR_SUBCLASS_SCSI,
+	.interface_protocol = USB_MASSSTOR_PROTOCOL_UAS,
+	.flags = 0
+};
+static const usb_endpoint_description_t uas_data_out_ep = {
+	.transfer_type = USB_TRANSFER_BULK,
+	.direction = USB_DIRECTION_OUT,
+	.interface_class = USB_CLASS_MASS_STORAGE,
+	.interface_subclass = USB_MASSSTOR_SUBCLASS_SCSI,
+	.interface_protocol = USB_MASSSTOR_PROTOCOL_UAS,
+	.flags = 0
+};
+
+static const usb_endpoint_description_t *uas_endpoints[] = {
+	&uas_cmd_ep,
+	&uas_status_ep,
+	&uas_data_in_ep,
+	&uas_data_out_ep,
+	NULL
+};
+
+/** Find the alternate setting implementing UAS. */
+static const usb_alternate_interface_descriptors_t *uas_find_alternate(
+    usb_device_t *dev)
+{
+	const usb_alternate_interfaces_t *ifaces =
+	    usb_device_get_alternative_ifaces(dev);
+
+	for (size_t i = 0; i < ifaces->alternative_count; ++i) {
+		const usb_alternate_interface_descriptors_t *alt =
+		    &ifaces->alternatives[i];
+		if (alt->interface->interface_class == USB_CLASS_MASS_STORAGE &&
+		    alt->interface->interface_subclass == USB_MASSSTOR_SUBCLASS_SCSI &&
+		    alt->interface->interface_protocol == USB_MASSSTOR_PROTOCOL_UAS)
+			return alt;
+	}
+	return NULL;
+}
+
+/** Get the pipe ID of an endpoint from its Pipe Usage descriptor.
+ *
+ * @param alt		Alternate setting the endpoint belongs to
+ * @param address	Endpoint address
+ * @return		Pipe ID or -1 if there is none.
+ */
+static int uas_pipe_id(const usb_alternate_interface_descriptors_t *alt,
+    uint8_t address)
+{
+	const uint8_t *d = alt->nested_descriptors;
+	const uint8_t *end = d + alt->nested_descriptors_size;
+	bool ours = false;
+
+	while (d + 2 <= end && d[0] >= 2 && d + d[0] <= end) {
+		if (d[1] == USB_DESCTYPE_ENDPOINT) {
+			ours = d[0] >= 3 && d[2] == address;
+		} else if (d[1] == UAS_DESCTYPE_PIPE_USAGE && ours && d[0] >= 3) {
+			return d[2];
+		}
+		d += d[0];
+	}
+	return -1;
+}
+
+/** Check whether the device can be driven by UAS.
+ *
+ * @param dev	USB device
+ * @return	@c true if the device speaks UAS at SuperSpeed.
+ */
+bool usb_uas_supported(usb_device_t *dev)
+{
+	return usb_device_get_speed(dev) >= USB_SPEED_SUPER &&
+	    uas_find_alternate(dev) != NULL;
+}
+
+/** Switch the device to its UAS alternate setting and set up streams.
+ *
+ * On failure the device may be left in the UAS alternate setting, it is up
+ * to the caller to select the Bulk-Only one again.
+ *
+ * @param mdev	Mass storage device
+ * @return	EOK on success or an error code.
+ */
+errno_t usb_uas_init(usbmast_dev_t *mdev)
+{
+	usb_device_t *dev = mdev->usb_dev;
+	const usb_alternate_interface_descriptors_t *alt =
+	    uas_find_alternate(dev);
+	if (alt == NULL)
+		return ENOTSUP;
+
+	errno_t rc = usb_device_select_interface(dev,
+	    alt->interface->alternate_setting, uas_endpoints);
+	if (rc != EOK) {
+		usb_log_error("Failed to select UAS interface: %s.",
+		    str_error(rc));
+		return rc;
+	}
+
+	usb_endpoint_mapping_t *pipes[UAS_PIPE_DATA_OUT + 1] = { NULL };
+	for (const usb_endpoint_description_t **desc = uas_endpoints;
+	    *desc != NULL; ++desc) {
+		usb_endpoint_mapping_t *epm =
+		    usb_device_get_mapped_ep_desc(dev, *desc);
+		if (epm == NULL || !epm->present)
+			return ENOENT;
+
+		const int id = uas_pipe_id(alt,
+		    epm->descriptor->endpoint_address);
+		if (id < UAS_PIPE_COMMAND || id > UAS_PIPE_DATA_OUT ||
+		    pipes[id] != NULL) {
+			usb_log_error("Missing or bogus UAS pipe usage.");
+			return ENOENT;
+		}
+		pipes[id] = epm;
+	}
+
+	/* Tags double as stream IDs, stream 0 is reserved. */
+	unsigned streams = UAS_MAX_STREAMS;
+	for (int id = UAS_PIPE_STATUS; id <= UAS_PIPE_DATA_OUT; ++id) {
+		if (pipes[id]->companion_descriptor == NULL)
+			return ENOTSUP;
+		streams = min(streams, 1U << USB_SSC_MAX_STREAMS(
+		    *pipes[id]->companion_descriptor));
+	}
+	if (streams < 2)
+		return ENOTSUP;
+
+	for (int id = UAS_PIPE_STATUS; id <= UAS_PIPE_DATA_OUT; ++id) {
+		rc = usb_pipe_request_streams(&pipes[id]->pipe, streams);
+		if (rc != EOK) {
+			usb_log_error("Failed to enable %u streams: %s.",
+			    streams, str_error(rc));
+			return rc;
+		}
+	}
+
+	mdev->uas_cmd_pipe = &pipes[UAS_PIPE_COMMAND]->pipe;
+	mdev->uas_status_pipe = &pipes[UAS_PIPE_STATUS]->pipe;
+	mdev->uas_data_in_pipe = &pipes[UAS_PIPE_DATA_IN]->pipe;
+	mdev->uas_data_out_pipe = &pipes[UAS_PIPE_DATA_OUT]->pipe;
+	mdev->uas_tag_count = streams - 1;
+	mdev->uas_tags = 0;
+	fibril_mutex_initialize(&mdev->uas_guard);
+	fibril_condvar_initialize(&mdev->uas_tag_cv);
+	mdev->uas = true;
+
+	usb_log_info("Mass storage `%s' uses UAS with %u tags.",
+	    usb_device_get_name(dev), mdev->uas_tag_count);
+	return EOK;
+}
+
+/** Take a free tag, waiting for one if all are in use. */
+static unsigned uas_tag_alloc(usbmast_dev_t *mdev)
+{
+	const uint32_t all = (1U << mdev->uas_tag_count) - 1;
+
+	fibril_mutex_lock(&mdev->uas_guard);
+	while ((mdev->uas_tags & all) == all)
+		fibril_condvar_wait(&mdev->uas_tag_cv, &mdev->uas_guard);
+
+	unsigned i = 0;
+	while (mdev->uas_tags & (1U << i))
+		++i;
+	mdev->uas_tags |= 1U << i;
+	fibril_mutex_unlock(&mdev->uas_guard);
+
+	return i + 1;
+}
+
+/** Return a tag taken by uas_tag_alloc. */
+static void uas_tag_free(usbmast_dev_t *mdev, unsigned tag)
+{
+	fibril_mutex_lock(&mdev->uas_guard);
+	mdev->uas_tags &= ~(1U << (tag - 1));
+	fibril_condvar_signal(&mdev->uas_tag_cv);
+	fibril_mutex_unlock(&mdev->uas_guard);
+}
+
+/** Data phase of a command, runs while the issuer waits for the status. */
+typedef struct {
+	usbmast_dev_t *mdev;
+	scsi_cmd_t *cmd;
+	unsigned tag;
+	errno_t rc;
+	bool done;
+	fibril_mutex_t guard;
+	fibril_condvar_t done_cv;
+} uas_data_phase_t;
+
+static errno_t uas_data_phase_fibril(void *arg)
+{
+	uas_data_phase_t *phase = arg;
+	scsi_cmd_t *cmd = phase->cmd;
+	size_t transferred = 0;
+	errno_t rc;
+
+	if (cmd->data_in_size > 0) {
+		rc = usb_pipe_read_stream(phase->mdev->uas_data_in_pipe,
+		    phase->tag, cmd->data_in, cmd->data_in_size, &transferred);
+	} else {
+		rc = usb_pipe_write_stream(phase->mdev->uas_data_out_pipe,
+		    phase->tag, cmd->data_out, cmd->data_out_size);
+		if (rc == EOK)
+			transferred = cmd->data_out_size;
+	}
+
+	fibril_mutex_lock(&phase->guard);
+	cmd->rcvd_size = transferred;
+	phase->rc = rc;
+	phase->done = true;
+	fibril_condvar_broadcast(&phase->done_cv);
+	fibril_mutex_unlock(&phase->guard);
+	return EOK;
+}
+
+/** Send SCSI command via USB Attached SCSI.
+ *
+ * @param mfun		Mass storage function
+ * @param cmd		SCSI command
+ *
+ * @return		Error code
+ */
+errno_t usb_uas_cmd(usbmast_fun_t *mfun, scsi_cmd_t *cmd)
+{
+	usbmast_dev_t *mdev = mfun->mdev;
+	usb_pipe_t *data_pipe = NULL;
+
+	assert(mdev->uas);
+	if (cmd->cdb_size > sizeof(((uas_command_iu_t *) NULL)->cdb))
+		return EINVAL;
+
+	if (cmd->data_in_size > 0)
+		data_pipe = mdev->uas_data_in_pipe;
+	else if (cmd->data_out_size > 0)
+		data_pipe = mdev->uas_data_out_pipe;
+
+	const unsigned tag = uas_tag_alloc(mdev);
+
+	uas_command_iu_t iu;
+	memset(&iu, 0, sizeof(iu));
+	iu.iu_id = UAS_IU_COMMAND;
+	iu.tag = host2uint16_t_be(tag);
+	/* Single level LUN, peripheral device addressing */
+	iu.lun[1] = mfun->lun;
+	memcpy(iu.cdb, cmd->cdb, cmd->cdb_size);
+
+	cmd->rcvd_size = 0;
+	cmd->sense_rcvd = 0;
+
+	uas_data_phase_t phase = {
+		.mdev = mdev,
+		.cmd = cmd,
+		.tag = tag,
+		.rc = EOK,
+		.done = (data_pipe == NULL),
+	};
+	fibril_mutex_initialize(&phase.guard);
+	fibril_condvar_initialize(&phase.done_cv);
+
+	/* Queue the data phase on its stream while the command IU goes out. */
+	if (data_pipe != NULL) {
+		fid_t fid = fibril_create(uas_data_phase_fibril, &phase);
+		if (fid == 0) {
+			uas_tag_free(mdev, tag);
+			return ENOMEM;
+		}
+		fibril_add_ready(fid);
+	}
+
+	errno_t rc = usb_pipe_write(mdev->uas_cmd_pipe, &iu, sizeof(iu));
+	uas_status_iu_t status;
+	size_t status_size = 0;
+	if (rc == EOK) {
+		rc = usb_pipe_read_stream(mdev->uas_status_pipe, tag, &status,
+		    sizeof(status), &status_size);
+	} else {
+		usb_log_error("UAS command IU failed: %s.", str_error(rc));
+	}
+
+	/*
+	 * A failed command may leave the data transfer unfinished. Give the
+	 * data a moment to arrive, then get rid of the transfer.
+	 */
+	fibril_mutex_lock(&phase.guard);
+	if (!phase.done) {
+		fibril_condvar_wait_timeout(&phase.done_cv, &phase.guard,
+		    UAS_DATA_GRACE);
+	}
+	if (!phase.done) {
+		fibril_mutex_unlock(&phase.guard);
+		usb_pipe_clear_halt(usb_device_get_default_pipe(mdev->usb_dev),
+		    data_pipe);
+		fibril_mutex_lock(&phase.guard);
+		while (!phase.done)
+			fibril_condvar_wait(&phase.done_cv, &phase.guard);
+	}
+	fibril_mutex_unlock(&phase.guard);
+
+	if (phase.rc == ESTALL) {
+		usb_pipe_clear_halt(usb_device_get_default_pipe(mdev->usb_dev),
+		    data_pipe);
+	}
+
+	uas_tag_free(mdev, tag);
+
+	if (rc != EOK)
+		return rc;
+
+	if (status_size < sizeof(uas_response_iu_t) ||
+	    uint16_t_be2host(status.sense.tag) != tag) {
+		usb_log_error("Bogus UAS status IU.");
+		return EIO;
+	}
+
+	switch (status.iu_id) {
+	case UAS_IU_SENSE:
+		if (status_size < offsetof(uas_sense_iu_t, sense))
+			return EIO;
+		if (status.sense.status == 0) {
+			cmd->status = CMDS_GOOD;
+			break;
+		}
+
+		cmd->status = CMDS_FAILED;
+		if (cmd->sense != NULL) {
+			size_t len = uint16_t_be2host(status.sense.sense_len);
+			len = min(len, status_size -
+			    offsetof(uas_sense_iu_t, sense));
+			len = min(len, cmd->sense_size);
+			memcpy(cmd->sense, status.sense.sense, len);
+			cmd->sense_rcvd = len;
+		}
+		break;
+	case UAS_IU_RESPONSE:
+		usb_log_error("UAS task management response 0x%02x.",
+		    status.response.response_code);
+		return EIO;
+	default:
+		usb_log_error("Unexpected UAS IU 0x%02x.", status.iu_id);
+		return EIO;
+	}
+
+	if (cmd->status == CMDS_GOOD && phase.rc != EOK)
+		return phase.rc;
+
+	return EOK;
+}
+
+/**
+ * @}
+ */
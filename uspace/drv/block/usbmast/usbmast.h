@@ -37,6 +37,8 @@
 #define USBMAST_H_
 
 #include <bd_srv.h>
+#include <fibril_synch.h>
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <usb/usb.h>
@@ -53,6 +55,27 @@ typedef struct usbmast_dev {
 	usb_pipe_t *bulk_in_pipe;
 	/** Data write pipe */
 	usb_pipe_t *bulk_out_pipe;
+	/** Serializes Bulk-Only Transport commands */
+	fibril_mutex_t bot_guard;
+
+	/** Whether commands are delivered by USB Attached SCSI */
+	bool uas;
+	/** UAS command pipe */
+	usb_pipe_t *uas_cmd_pipe;
+	/** UAS status pipe */
+	usb_pipe_t *uas_status_pipe;
+	/** UAS data-in pipe */
+	usb_pipe_t *uas_data_in_pipe;
+	/** UAS data-out pipe */
+	usb_pipe_t *uas_data_out_pipe;
+	/** Number of UAS tags (stream IDs 1 to uas_tag_count) */
+	unsigned uas_tag_count;
+	/** UAS tags in use, bit i stands for tag i + 1 */
+	uint32_t uas_tags;
+	/** Guards uas_tags */
+	fibril_mutex_t uas_guard;
+	/** Signalled when a UAS tag is released */
+	fibril_condvar_t uas_tag_cv;
 } usbmast_dev_t;
 
 
@@ -71,6 +94,8 @@ typedef struct {
 	uint64_t nblocks;
 	/** Block size in bytes */
 	size_t block_size;
+	/** Whether the LBA does not fit 32 bits, requiring 16-byte CDBs */
+	bool lba64;
 	/** Block device service structure */
 	bd_srvs_t bds;
 } usbmast_fun_t;
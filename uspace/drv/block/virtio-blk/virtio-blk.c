@@ -0,0 +1,815 @@
+/*
+ * Copyright (c) 2018 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @file
+ * VIRTIO block device driver
+ */
+
+#include "virtio-blk.h"
+
+#include <as.h>
+#include <byteorder.h>
+#include <ddf/driver.h>
+#include <ddf/interrupt.h>
+#include <ddf/log.h>
+#include <device/hw_res.h>
+#include <device/hw_res_parsed.h>
+#include <errno.h>
+#include <libarch/barrier.h>
+#include <macros.h>
+#include <mem.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <str_error.h>
+
+#define NAME	"virtio-blk"
+
+#define VIRTIO_BLK_FUN_NAME	"a"
+
+#define VIRTIO_BLK_NUM_QUEUES	1
+
+#define REQ_QUEUE	0
+
+static errno_t virtio_blk_dev_add(ddf_dev_t *);
+
+static driver_ops_t virtio_blk_driver_ops = {
+	.dev_add = virtio_blk_dev_add
+};
+
+static driver_t virtio_blk_driver = {
+	.name = NAME,
+	.driver_ops = &virtio_blk_driver_ops
+};
+
+static errno_t virtio_blk_bd_open(bd_srvs_t *, bd_srv_t *);
+static errno_t virtio_blk_bd_close(bd_srv_t *);
+static errno_t virtio_blk_bd_read_blocks(bd_srv_t *, aoff64_t, size_t, void *,
+    size_t);
+static errno_t virtio_blk_bd_write_blocks(bd_srv_t *, aoff64_t, size_t,
+    const void *, size_t);
+static errno_t virtio_blk_bd_sync_cache(bd_srv_t *, aoff64_t, size_t);
+static errno_t virtio_blk_bd_discard_blocks(bd_srv_t *, const bd_extent_t *,
+    size_t);
+static errno_t virtio_blk_bd_get_block_size(bd_srv_t *, size_t *);
+static errno_t virtio_blk_bd_get_num_blocks(bd_srv_t *, aoff64_t *);
+
+static bd_ops_t virtio_blk_bd_ops = {
+	.open = virtio_blk_bd_open,
+	.close = virtio_blk_bd_close,
+	.read_blocks = virtio_blk_bd_read_blocks,
+	.write_blocks = virtio_blk_bd_write_blocks,
+	.sync_cache = virtio_blk_bd_sync_cache,
+	.discard_blocks = virtio_blk_bd_discard_blocks,
+	.get_block_size = virtio_blk_bd_get_block_size,
+	.get_num_blocks = virtio_blk_bd_get_num_blocks
+};
+
+static void virtio_blk_irq_handler(ipc_call_t *icall, ddf_dev_t *dev)
+{
+	virtio_blk_t *vblk = (virtio_blk_t *) ddf_dev_data_get(dev);
+	virtio_dev_t *vdev = &vblk->virtio_dev;
+	bool completed = false;
+
+	uint16_t descno;
+	uint32_t len;
+
+	fibril_mutex_lock(&vblk->lock);
+	while (virtio_virtq_consume_used(vdev, REQ_QUEUE, &descno, &len)) {
+		unsigned idx = descno / vblk->slot_descs;
+		if (idx >= vblk->nslots) {
+			ddf_msg(LVL_WARN, "Bogus used descriptor %u",
+			    (unsigned) descno);
+			continue;
+		}
+
+		vblk->slots[idx].done = true;
+		completed = true;
+	}
+
+	if (completed)
+		fibril_condvar_broadcast(&vblk->cv);
+	fibril_mutex_unlock(&vblk->lock);
+}
+
+static errno_t virtio_blk_register_interrupt(virtio_blk_t *vblk)
+{
+	virtio_dev_t *vdev = &vblk->virtio_dev;
+	hw_res_list_parsed_t res;
+
+	async_sess_t *parent_sess = ddf_dev_parent_sess_get(vblk->dev);
+	if (parent_sess == NULL)
+		return ENOMEM;
+
+	hw_res_list_parsed_init(&res);
+	errno_t rc = hw_res_get_list_parsed(parent_sess, &res, 0);
+	if (rc != EOK)
+		return rc;
+
+	if (res.irqs.count < 1) {
+		hw_res_list_parsed_clean(&res);
+		return EINVAL;
+	}
+
+	vblk->irq = res.irqs.irqs[0];
+	hw_res_list_parsed_clean(&res);
+
+	irq_pio_range_t pio_ranges[] = {
+		{
+			.base = vdev->isr_phys,
+			.size = sizeof(vdev->isr_phys),
+		}
+	};
+
+	irq_cmd_t irq_commands[] = {
+		{
+			.cmd = CMD_PIO_READ_8,
+			.addr = (void *) vdev->isr_phys,
+			.dstarg = 2
+		},
+		{
+			.cmd = CMD_PREDICATE,
+			.value = 1,
+			.srcarg = 2
+		},
+		{
+			.cmd = CMD_ACCEPT
+		}
+	};
+
+	irq_code_t irq_code = {
+		.rangecount = sizeof(pio_ranges) / sizeof(irq_pio_range_t),
+		.ranges = pio_ranges,
+		.cmdcount = sizeof(irq_commands) / sizeof(irq_cmd_t),
+		.cmds = irq_commands
+	};
+
+	return register_interrupt_handler(vblk->dev, vblk->irq,
+	    virtio_blk_irq_handler, &irq_code, &vblk->irq_handle);
+}
+
+/** Retire the oldest request of a transfer.
+ *
+ * The request must be completed by the device. Received data is copied
+ * to its destination and the slot is returned to the free list.
+ *
+ * @param vblk Virtio block device, locked
+ * @param xfer Transfer
+ */
+static void virtio_blk_xfer_retire(virtio_blk_t *vblk, virtio_blk_xfer_t *xfer)
+{
+	virtio_blk_slot_t *slot = &vblk->slots[xfer->head];
+
+	assert(fibril_mutex_is_locked(&vblk->lock));
+	assert(slot->done);
+
+	read_barrier();
+
+	switch (slot->dma->status) {
+	case VIRTIO_BLK_S_OK:
+		if (slot->dest != NULL)
+			memcpy(slot->dest, slot->buf, slot->size);
+		break;
+	case VIRTIO_BLK_S_UNSUPP:
+		if (xfer->rc == EOK)
+			xfer->rc = ENOTSUP;
+		break;
+	default:
+		if (xfer->rc == EOK)
+			xfer->rc = EIO;
+		break;
+	}
+
+	xfer->head = slot->next;
+	if (xfer->head < 0)
+		xfer->tail = -1;
+
+	slot->done = false;
+	slot->next = vblk->free_head;
+	vblk->free_head = slot->idx;
+
+	fibril_condvar_broadcast(&vblk->cv);
+}
+
+/** Allocate slot for a new request of a transfer.
+ *
+ * If all slots are in use, completed requests of the transfer are retired
+ * while waiting, so that a transfer never waits for its own slots.
+ *
+ * @param vblk Virtio block device, locked
+ * @param xfer Transfer
+ * @return Allocated slot
+ */
+static virtio_blk_slot_t *virtio_blk_slot_get(virtio_blk_t *vblk,
+    virtio_blk_xfer_t *xfer)
+{
+	assert(fibril_mutex_is_locked(&vblk->lock));
+
+	while (vblk->free_head < 0) {
+		if (xfer->head >= 0 && vblk->slots[xfer->head].done)
+			virtio_blk_xfer_retire(vblk, xfer);
+		else
+			fibril_condvar_wait(&vblk->cv, &vblk->lock);
+	}
+
+	virtio_blk_slot_t *slot = &vblk->slots[vblk->free_head];
+	vblk->free_head = slot->next;
+
+	slot->done = false;
+	slot->next = -1;
+	slot->dest = NULL;
+	slot->size = 0;
+
+	if (xfer->tail >= 0)
+		vblk->slots[xfer->tail].next = slot->idx;
+	else
+		xfer->head = slot->idx;
+	xfer->tail = slot->idx;
+
+	return slot;
+}
+
+/** Hand request in a slot over to the device.
+ *
+ * @param vblk   Virtio block device, locked
+ * @param slot   Slot with data filled in
+ * @param type   Request type (VIRTIO_BLK_T_xxx)
+ * @param sector Starting sector
+ */
+static void virtio_blk_slot_submit(virtio_blk_t *vblk, virtio_blk_slot_t *slot,
+    uint32_t type, uint64_t sector)
+{
+	virtio_dev_t *vdev = &vblk->virtio_dev;
+	virtio_blk_req_dma_t *dma = slot->dma;
+	struct {
+		uint64_t addr;
+		uint32_t len;
+		uint16_t flags;
+	} seg[VIRTIO_BLK_REQ_DESCS];
+	unsigned nseg = 0;
+
+	dma->hdr.type = host2uint32_t_le(type);
+	dma->hdr.reserved = 0;
+	dma->hdr.sector = host2uint64_t_le(sector);
+	dma->status = VIRTIO_BLK_S_IOERR;
+
+	/* Device-readable header, data, device-writable status */
+	seg[nseg].addr = slot->dma_p + offsetof(virtio_blk_req_dma_t, hdr);
+	seg[nseg].len = sizeof(virtio_blk_req_hdr_t);
+	seg[nseg++].flags = 0;
+
+	if (slot->size > 0) {
+		seg[nseg].addr = slot->buf_p;
+		seg[nseg].len = slot->size;
+		seg[nseg++].flags = (type == VIRTIO_BLK_T_IN) ?
+		    VIRTQ_DESC_F_WRITE : 0;
+	}
+
+	seg[nseg].addr = slot->dma_p + offsetof(virtio_blk_req_dma_t, status);
+	seg[nseg].len = sizeof(uint8_t);
+	seg[nseg++].flags = VIRTQ_DESC_F_WRITE;
+
+	uint16_t head;
+	if (vblk->slot_descs == 1) {
+		/* Whole request described by one indirect descriptor */
+		for (unsigned i = 0; i < nseg; i++) {
+			virtio_desc_set(&dma->indirect[i], seg[i].addr,
+			    seg[i].len, seg[i].flags |
+			    (i + 1 < nseg ? VIRTQ_DESC_F_NEXT : 0), i + 1);
+		}
+
+		head = slot->idx;
+		virtio_virtq_desc_set(vdev, REQ_QUEUE, head,
+		    slot->dma_p + offsetof(virtio_blk_req_dma_t, indirect),
+		    nseg * sizeof(virtq_desc_t), VIRTQ_DESC_F_INDIRECT, 0);
+	} else {
+		head = slot->idx * VIRTIO_BLK_REQ_DESCS;
+		for (unsigned i = 0; i < nseg; i++) {
+			virtio_virtq_desc_set(vdev, REQ_QUEUE, head + i,
+			    seg[i].addr, seg[i].len, seg[i].flags |
+			    (i + 1 < nseg ? VIRTQ_DESC_F_NEXT : 0),
+			    head + i + 1);
+		}
+	}
+
+	virtio_virtq_produce_available(vdev, REQ_QUEUE, head);
+}
+
+/** Wait until all requests of a transfer are completed and retire them.
+ *
+ * @param vblk Virtio block device, locked
+ * @param xfer Transfer
+ * @return EOK on success or an error code of the first failed request
+ */
+static errno_t virtio_blk_xfer_wait(virtio_blk_t *vblk,
+    virtio_blk_xfer_t *xfer)
+{
+	while (xfer->head >= 0) {
+		if (vblk->slots[xfer->head].done)
+			virtio_blk_xfer_retire(vblk, xfer);
+		else
+			fibril_condvar_wait(&vblk->cv, &vblk->lock);
+	}
+
+	return xfer->rc;
+}
+
+/** Read or write blocks.
+ *
+ * The transfer is split into requests of at most max_xfer bytes which
+ * are all submitted before waiting for the first one to complete.
+ */
+static errno_t virtio_blk_rw(virtio_blk_t *vblk, bool read, aoff64_t ba,
+    size_t cnt, void *buf, size_t size)
+{
+	virtio_blk_xfer_t xfer;
+
+	if (size < cnt * vblk->block_size)
+		return EINVAL;
+
+	if (ba + cnt < ba || ba + cnt > vblk->blocks)
+		return ELIMIT;
+
+	if (!read && vblk->read_only)
+		return EROFS;
+
+	xfer.head = -1;
+	xfer.tail = -1;
+	xfer.rc = EOK;
+
+	size_t xfer_blocks = vblk->max_xfer / vblk->block_size;
+	uint64_t sectors_per_block = vblk->block_size / VIRTIO_BLK_SECTOR_SIZE;
+
+	fibril_mutex_lock(&vblk->lock);
+
+	while (cnt > 0) {
+		size_t nblocks = min(cnt, xfer_blocks);
+		size_t nbytes = nblocks * vblk->block_size;
+
+		virtio_blk_slot_t *slot = virtio_blk_slot_get(vblk, &xfer);
+		slot->size = nbytes;
+		if (read)
+			slot->dest = buf;
+		else
+			memcpy(slot->buf, buf, nbytes);
+
+		virtio_blk_slot_submit(vblk, slot, read ? VIRTIO_BLK_T_IN :
+		    VIRTIO_BLK_T_OUT, ba * sectors_per_block);
+
+		ba += nblocks;
+		cnt -= nblocks;
+		buf += nbytes;
+	}
+
+	errno_t rc = virtio_blk_xfer_wait(vblk, &xfer);
+	fibril_mutex_unlock(&vblk->lock);
+
+	return rc;
+}
+
+static errno_t virtio_blk_bd_open(bd_srvs_t *bds, bd_srv_t *bd)
+{
+	return EOK;
+}
+
+static errno_t virtio_blk_bd_close(bd_srv_t *bd)
+{
+	return EOK;
+}
+
+static errno_t virtio_blk_bd_read_blocks(bd_srv_t *bd, aoff64_t ba,
+    size_t cnt, void *buf, size_t size)
+{
+	virtio_blk_t *vblk = (virtio_blk_t *) bd->srvs->sarg;
+
+	return virtio_blk_rw(vblk, true, ba, cnt, buf, size);
+}
+
+static errno_t virtio_blk_bd_write_blocks(bd_srv_t *bd, aoff64_t ba,
+    size_t cnt, const void *buf, size_t size)
+{
+	virtio_blk_t *vblk = (virtio_blk_t *) bd->srvs->sarg;
+
+	return virtio_blk_rw(vblk, false, ba, cnt, (void *) buf, size);
+}
+
+static errno_t virtio_blk_bd_sync_cache(bd_srv_t *bd, aoff64_t ba, size_t cnt)
+{
+	virtio_blk_t *vblk = (virtio_blk_t *) bd->srvs->sarg;
+	virtio_blk_xfer_t xfer;
+
+	/* Without the flush command the device cache is write-through */
+	if ((vblk->virtio_dev.features & VIRTIO_BLK_F_FLUSH) == 0)
+		return EOK;
+
+	xfer.head = -1;
+	xfer.tail = -1;
+	xfer.rc = EOK;
+
+	fibril_mutex_lock(&vblk->lock);
+	virtio_blk_slot_t *slot = virtio_blk_slot_get(vblk, &xfer);
+	virtio_blk_slot_submit(vblk, slot, VIRTIO_BLK_T_FLUSH, 0);
+	errno_t rc = virtio_blk_xfer_wait(vblk, &xfer);
+	fibril_mutex_unlock(&vblk->lock);
+
+	return rc;
+}
+
+/** Discard blocks.
+ *
+ * The extents are sent as segments of VIRTIO_BLK_T_DISCARD requests
+ * within the limits announced by the device. All requests are submitted
+ * before waiting for the first one to complete.
+ */
+static errno_t virtio_blk_bd_discard_blocks(bd_srv_t *bd,
+    const bd_extent_t *ext, size_t cnt)
+{
+	virtio_blk_t *vblk = (virtio_blk_t *) bd->srvs->sarg;
+	virtio_blk_xfer_t xfer;
+
+	if ((vblk->virtio_dev.features & VIRTIO_BLK_F_DISCARD) == 0)
+		return ENOTSUP;
+
+	if (vblk->read_only)
+		return EROFS;
+
+	for (size_t i = 0; i < cnt; i++) {
+		if (ext[i].ba + ext[i].cnt < ext[i].ba ||
+		    ext[i].ba + ext[i].cnt > vblk->blocks)
+			return ELIMIT;
+	}
+
+	xfer.head = -1;
+	xfer.tail = -1;
+	xfer.rc = EOK;
+
+	uint64_t sectors_per_block = vblk->block_size / VIRTIO_BLK_SECTOR_SIZE;
+	virtio_blk_slot_t *slot = NULL;
+	size_t nseg = 0;
+
+	fibril_mutex_lock(&vblk->lock);
+
+	for (size_t i = 0; i < cnt; i++) {
+		uint64_t sector = ext[i].ba * sectors_per_block;
+		uint64_t left = ext[i].cnt * sectors_per_block;
+
+		while (left > 0) {
+			if (slot == NULL) {
+				slot = virtio_blk_slot_get(vblk, &xfer);
+				nseg = 0;
+			}
+
+			uint32_t n = min(left, vblk->max_discard_sectors);
+			virtio_blk_discard_t *seg =
+			    (virtio_blk_discard_t *) slot->buf + nseg;
+
+			seg->sector = host2uint64_t_le(sector);
+			seg->num_sectors = host2uint32_t_le(n);
+			seg->flags = 0;
+			nseg++;
+
+			sector += n;
+			left -= n;
+
+			if (nseg == vblk->max_discard_seg) {
+				slot->size = nseg * sizeof(virtio_blk_discard_t);
+				virtio_blk_slot_submit(vblk, slot,
+				    VIRTIO_BLK_T_DISCARD, 0);
+				slot = NULL;
+			}
+		}
+	}
+
+	if (slot != NULL) {
+		slot->size = nseg * sizeof(virtio_blk_discard_t);
+		virtio_blk_slot_submit(vblk, slot, VIRTIO_BLK_T_DISCARD, 0);
+	}
+
+	errno_t rc = virtio_blk_xfer_wait(vblk, &xfer);
+	fibril_mutex_unlock(&vblk->lock);
+
+	return rc;
+}
+
+static errno_t virtio_blk_bd_get_block_size(bd_srv_t *bd, size_t *rsize)
+{
+	virtio_blk_t *vblk = (virtio_blk_t *) bd->srvs->sarg;
+
+	*rsize = vblk->block_size;
+	return EOK;
+}
+
+static errno_t virtio_blk_bd_get_num_blocks(bd_srv_t *bd, aoff64_t *rnb)
+{
+	virtio_blk_t *vblk = (virtio_blk_t *) bd->srvs->sarg;
+
+	*rnb = vblk->blocks;
+	return EOK;
+}
+
+/** Allocate DMA memory of the request slots */
+static errno_t virtio_blk_slots_init(virtio_blk_t *vblk)
+{
+	errno_t rc;
+
+	vblk->req_dma = AS_AREA_ANY;
+	rc = dmamem_map_anonymous(vblk->nslots * sizeof(virtio_blk_req_dma_t),
+	    0, AS_AREA_READ | AS_AREA_WRITE, 0, &vblk->req_dma_p,
+	    (void **) &vblk->req_dma);
+	if (rc != EOK) {
+		vblk->req_dma = NULL;
+		return rc;
+	}
+
+	vblk->free_head = -1;
+	for (int i = vblk->nslots - 1; i >= 0; i--) {
+		virtio_blk_slot_t *slot = &vblk->slots[i];
+
+		slot->buf = AS_AREA_ANY;
+		rc = dmamem_map_anonymous(vblk->max_xfer, 0,
+		    AS_AREA_READ | AS_AREA_WRITE, 0, &slot->buf_p,
+		    &slot->buf);
+		if (rc != EOK) {
+			slot->buf = NULL;
+			return rc;
+		}
+
+		slot->idx = i;
+		slot->dma = &vblk->req_dma[i];
+		slot->dma_p = vblk->req_dma_p + i * sizeof(virtio_blk_req_dma_t);
+		slot->next = vblk->free_head;
+		vblk->free_head = i;
+	}
+
+	return EOK;
+}
+
+/** Free DMA memory of the request slots */
+static void virtio_blk_slots_fini(virtio_blk_t *vblk)
+{
+	for (unsigned i = 0; i < vblk->nslots; i++) {
+		if (vblk->slots[i].buf != NULL) {
+			dmamem_unmap_anonymous(vblk->slots[i].buf);
+			vblk->slots[i].buf = NULL;
+		}
+	}
+
+	if (vblk->req_dma != NULL) {
+		dmamem_unmap_anonymous(vblk->req_dma);
+		vblk->req_dma = NULL;
+	}
+}
+
+static errno_t virtio_blk_initialize(virtio_blk_t *vblk)
+{
+	fibril_mutex_initialize(&vblk->lock);
+	fibril_condvar_initialize(&vblk->cv);
+
+	bd_srvs_init(&vblk->bds);
+	vblk->bds.ops = &virtio_blk_bd_ops;
+	vblk->bds.sarg = vblk;
+
+	errno_t rc = virtio_pci_dev_initialize(vblk->dev, &vblk->virtio_dev);
+	if (rc != EOK)
+		return rc;
+
+	virtio_dev_t *vdev = &vblk->virtio_dev;
+	virtio_pci_common_cfg_t *cfg = vdev->common_cfg;
+	virtio_blk_cfg_t *blkcfg = vdev->device_cfg;
+
+	/*
+	 * Register IRQ
+	 */
+	rc = virtio_blk_register_interrupt(vblk);
+	if (rc != EOK)
+		goto fail;
+
+	/* Reset the device and negotiate the feature bits */
+	rc = virtio_device_setup_start(vdev, 0,
+	    VIRTIO_BLK_F_SIZE_MAX | VIRTIO_BLK_F_RO | VIRTIO_BLK_F_BLK_SIZE |
+	    VIRTIO_BLK_F_FLUSH | VIRTIO_BLK_F_DISCARD | VIRTIO_F_INDIRECT_DESC |
+	    VIRTIO_F_EVENT_IDX);
+	if (rc != EOK)
+		goto fail;
+
+	/* Perform device-specific setup */
+
+	vblk->block_size = VIRTIO_BLK_SECTOR_SIZE;
+	if (vdev->features & VIRTIO_BLK_F_BLK_SIZE) {
+		uint32_t blk_size = pio_read_le32(&blkcfg->blk_size);
+		if (blk_size >= VIRTIO_BLK_SECTOR_SIZE &&
+		    blk_size <= VIRTIO_BLK_BUF_SIZE &&
+		    blk_size % VIRTIO_BLK_SECTOR_SIZE == 0)
+			vblk->block_size = blk_size;
+	}
+
+	vblk->blocks = pio_read_le64(&blkcfg->capacity) /
+	    (vblk->block_size / VIRTIO_BLK_SECTOR_SIZE);
+	vblk->read_only = (vdev->features & VIRTIO_BLK_F_RO) != 0;
+
+	vblk->max_xfer = VIRTIO_BLK_BUF_SIZE;
+	if (vdev->features & VIRTIO_BLK_F_SIZE_MAX) {
+		uint32_t size_max = pio_read_le32(&blkcfg->size_max);
+		if (size_max >= vblk->block_size && size_max < vblk->max_xfer)
+			vblk->max_xfer = size_max;
+	}
+	vblk->max_xfer -= vblk->max_xfer % vblk->block_size;
+
+	if (vdev->features & VIRTIO_BLK_F_DISCARD) {
+		vblk->max_discard_sectors =
+		    pio_read_le32(&blkcfg->max_discard_sectors);
+		if (vblk->max_discard_sectors == 0)
+			vblk->max_discard_sectors = UINT32_MAX;
+
+		/* Whole blocks only */
+		vblk->max_discard_sectors -= vblk->max_discard_sectors %
+		    (vblk->block_size / VIRTIO_BLK_SECTOR_SIZE);
+
+		vblk->max_discard_seg = min(
+		    pio_read_le32(&blkcfg->max_discard_seg),
+		    VIRTIO_BLK_BUF_SIZE / sizeof(virtio_blk_discard_t));
+		if (vblk->max_discard_seg == 0)
+			vblk->max_discard_seg = 1;
+	}
+
+	/*
+	 * Discover and configure the virtqueue
+	 */
+	uint16_t num_queues = pio_read_le16(&cfg->num_queues);
+	if (num_queues < VIRTIO_BLK_NUM_QUEUES) {
+		ddf_msg(LVL_NOTE, "Unsupported number of virtqueues: %u",
+		    num_queues);
+		rc = ENOTSUP;
+		goto fail;
+	}
+
+	vdev->queues = calloc(sizeof(virtq_t), num_queues);
+	if (!vdev->queues) {
+		rc = ENOMEM;
+		goto fail;
+	}
+
+	/*
+	 * With indirect descriptors each request takes up just one
+	 * descriptor in the virtqueue, otherwise a chain of three.
+	 */
+	vblk->slot_descs = (vdev->features & VIRTIO_F_INDIRECT_DESC) ? 1 :
+	    VIRTIO_BLK_REQ_DESCS;
+
+	pio_write_le16(&cfg->queue_select, REQ_QUEUE);
+	uint16_t max_size = pio_read_le16(&cfg->queue_size);
+
+	uint16_t qsize = 1;
+	while (qsize < VIRTIO_BLK_SLOTS * vblk->slot_descs && qsize < max_size)
+		qsize *= 2;
+
+	vblk->nslots = min(VIRTIO_BLK_SLOTS, qsize / vblk->slot_descs);
+	if (vblk->nslots == 0) {
+		rc = ENOTSUP;
+		goto fail;
+	}
+
+	rc = virtio_virtq_setup(vdev, REQ_QUEUE, qsize);
+	if (rc != EOK)
+		goto fail;
+
+	/*
+	 * Setup DMA buffers
+	 */
+	rc = virtio_blk_slots_init(vblk);
+	if (rc != EOK)
+		goto fail;
+
+	/*
+	 * Enable IRQ
+	 */
+	rc = hw_res_enable_interrupt(ddf_dev_parent_sess_get(vblk->dev),
+	    vblk->irq);
+	if (rc != EOK) {
+		ddf_msg(LVL_NOTE, "Failed to enable interrupt");
+		goto fail;
+	}
+
+	ddf_msg(LVL_NOTE, "Registered IRQ %d", vblk->irq);
+
+	/* Go live */
+	virtio_device_setup_finalize(vdev);
+
+	ddf_msg(LVL_NOTE, "%" PRIuOFF64 " blocks of %zu bytes, %u requests "
+	    "in flight%s", vblk->blocks, vblk->block_size, vblk->nslots,
+	    vblk->read_only ? ", read-only" : "");
+
+	return EOK;
+
+fail:
+	virtio_blk_slots_fini(vblk);
+	virtio_device_setup_fail(vdev);
+	virtio_pci_dev_cleanup(vdev);
+	return rc;
+}
+
+static void virtio_blk_uninitialize(virtio_blk_t *vblk)
+{
+	virtio_blk_slots_fini(vblk);
+	virtio_device_setup_fail(&vblk->virtio_dev);
+	virtio_pci_dev_cleanup(&vblk->virtio_dev);
+}
+
+/** Block device connection handler */
+static void virtio_blk_bd_connection(cap_call_handle_t icall_handle,
+    ipc_call_t *icall, void *arg)
+{
+	ddf_fun_t *fun = (ddf_fun_t *) arg;
+	virtio_blk_t *vblk;
+
+	vblk = (virtio_blk_t *) ddf_dev_data_get(ddf_fun_get_dev(fun));
+	bd_conn(icall_handle, icall, &vblk->bds);
+}
+
+static errno_t virtio_blk_dev_add(ddf_dev_t *dev)
+{
+	ddf_msg(LVL_NOTE, "%s %s (handle = %zu)", __func__,
+	    ddf_dev_get_name(dev), ddf_dev_get_handle(dev));
+
+	virtio_blk_t *vblk = ddf_dev_data_alloc(dev, sizeof(virtio_blk_t));
+	if (vblk == NULL) {
+		ddf_msg(LVL_ERROR, "Failed allocating soft state.");
+		return ENOMEM;
+	}
+
+	vblk->dev = dev;
+
+	errno_t rc = virtio_blk_initialize(vblk);
+	if (rc != EOK)
+		return rc;
+
+	ddf_fun_t *fun = ddf_fun_create(dev, fun_exposed, VIRTIO_BLK_FUN_NAME);
+	if (fun == NULL) {
+		ddf_msg(LVL_ERROR, "Failed creating DDF function.");
+		rc = ENOMEM;
+		goto uninitialize;
+	}
+
+	ddf_fun_set_conn_handler(fun, virtio_blk_bd_connection);
+
+	rc = ddf_fun_bind(fun);
+	if (rc != EOK) {
+		ddf_msg(LVL_ERROR, "Failed binding DDF function: %s",
+		    str_error(rc));
+		goto destroy;
+	}
+
+	rc = ddf_fun_add_to_category(fun, "disk");
+	if (rc != EOK) {
+		ddf_msg(LVL_ERROR, "Failed adding function to category");
+		goto unbind;
+	}
+
+	vblk->fun = fun;
+
+	ddf_msg(LVL_NOTE, "The %s device has been successfully initialized.",
+	    ddf_dev_get_name(dev));
+
+	return EOK;
+
+unbind:
+	ddf_fun_unbind(fun);
+destroy:
+	ddf_fun_destroy(fun);
+uninitialize:
+	virtio_blk_uninitialize(vblk);
+	return rc;
+}
+
+int main(void)
+{
+	printf("%s: HelenOS virtio-blk driver\n", NAME);
+
+	(void) ddf_log_init(NAME);
+	return ddf_driver_main(&virtio_blk_driver);
+}
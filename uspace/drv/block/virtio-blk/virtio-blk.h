@@ -0,0 +1,194 @@
+/*
+ * Copyright (c) 2018 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _VIRTIO_BLK_H_
+#define _VIRTIO_BLK_H_
+
+#include <virtio-pci.h>
+#include <abi/cap.h>
+#include <bd_srv.h>
+#include <fibril_synch.h>
+
+/** Maximum number of requests in flight */
+#define VIRTIO_BLK_SLOTS	32
+/** Size of the DMA data buffer of one request */
+#define VIRTIO_BLK_BUF_SIZE	(64 * 1024)
+
+/** Size of a sector as used in request headers and device capacity */
+#define VIRTIO_BLK_SECTOR_SIZE	512
+
+/** Maximum segment size is in size_max. */
+#define VIRTIO_BLK_F_SIZE_MAX	(1U << 1)
+/** Device is read-only. */
+#define VIRTIO_BLK_F_RO		(1U << 5)
+/** Block size of the disk is in blk_size. */
+#define VIRTIO_BLK_F_BLK_SIZE	(1U << 6)
+/** Cache flush command is supported. */
+#define VIRTIO_BLK_F_FLUSH	(1U << 9)
+/** Discard command is supported, limits are in the configuration. */
+#define VIRTIO_BLK_F_DISCARD	(1U << 13)
+
+#define VIRTIO_BLK_T_IN		0
+#define VIRTIO_BLK_T_OUT	1
+#define VIRTIO_BLK_T_FLUSH	4
+#define VIRTIO_BLK_T_DISCARD	11
+
+#define VIRTIO_BLK_S_OK		0
+#define VIRTIO_BLK_S_IOERR	1
+#define VIRTIO_BLK_S_UNSUPP	2
+
+/** Device configuration layout */
+typedef struct {
+	ioport64_t capacity;
+	ioport32_t size_max;
+	ioport32_t seg_max;
+	struct {
+		ioport16_t cylinders;
+		ioport8_t heads;
+		ioport8_t sectors;
+	} geometry;
+	ioport32_t blk_size;
+	struct {
+		ioport8_t physical_block_exp;
+		ioport8_t alignment_offset;
+		ioport16_t min_io_size;
+		ioport32_t opt_io_size;
+	} topology;
+	ioport8_t writeback;
+	ioport8_t unused0[3];
+	ioport32_t max_discard_sectors;
+	ioport32_t max_discard_seg;
+	ioport32_t discard_sector_alignment;
+} __attribute__((packed)) virtio_blk_cfg_t;
+
+/** Discard segment, read by the device */
+typedef struct {
+	uint64_t sector;
+	uint32_t num_sectors;
+	uint32_t flags;
+} virtio_blk_discard_t;
+
+/** Request header, read by the device */
+typedef struct {
+	uint32_t type;
+	uint32_t reserved;
+	uint64_t sector;
+} virtio_blk_req_hdr_t;
+
+/** Number of descriptors needed for one request */
+#define VIRTIO_BLK_REQ_DESCS	3
+
+/** Per-request DMA memory other than the data buffer */
+typedef struct {
+	/** Request header */
+	virtio_blk_req_hdr_t hdr;
+	/** Indirect descriptor table, used with VIRTIO_F_INDIRECT_DESC */
+	virtq_desc_t indirect[VIRTIO_BLK_REQ_DESCS];
+	/** Request status, written by the device */
+	uint8_t status;
+} __attribute__((aligned(16))) virtio_blk_req_dma_t;
+
+/** Request slot
+ *
+ * A slot holds one request submitted to the device. Large transfers
+ * are split over several slots which are all in flight at the same time.
+ */
+typedef struct {
+	/** Index of the slot */
+	int idx;
+	/** Request was completed by the device */
+	bool done;
+	/** Next free slot or next slot of the owning transfer, -1 if none */
+	int next;
+
+	/** DMA memory for header, status and indirect descriptors */
+	virtio_blk_req_dma_t *dma;
+	uintptr_t dma_p;
+	/** DMA data buffer */
+	void *buf;
+	uintptr_t buf_p;
+
+	/** Where to copy data read into @c buf or @c NULL */
+	void *dest;
+	/** Number of bytes transferred */
+	size_t size;
+} virtio_blk_slot_t;
+
+/** Transfer consisting of one or more requests */
+typedef struct {
+	/** Oldest slot of the transfer or -1 */
+	int head;
+	/** Newest slot of the transfer or -1 */
+	int tail;
+	/** Error code of the first failed request */
+	errno_t rc;
+} virtio_blk_xfer_t;
+
+typedef struct {
+	virtio_dev_t virtio_dev;
+
+	ddf_dev_t *dev;
+	ddf_fun_t *fun;
+
+	/** Protects slots */
+	fibril_mutex_t lock;
+	/** Signalled when a slot is freed or completed */
+	fibril_condvar_t cv;
+
+	virtio_blk_slot_t slots[VIRTIO_BLK_SLOTS];
+	/** Number of usable slots */
+	unsigned nslots;
+	/** First free slot or -1 */
+	int free_head;
+	/** Descriptors used by one slot in the virtqueue */
+	unsigned slot_descs;
+
+	/** DMA memory for the virtio_blk_req_dma_t of all slots */
+	virtio_blk_req_dma_t *req_dma;
+	uintptr_t req_dma_p;
+
+	/** Block size in bytes */
+	size_t block_size;
+	/** Number of blocks */
+	aoff64_t blocks;
+	/** Maximum number of bytes in one request */
+	size_t max_xfer;
+	/** Device is read-only */
+	bool read_only;
+	/** Maximum number of sectors in one discard segment */
+	uint32_t max_discard_sectors;
+	/** Maximum number of segments in one discard request */
+	size_t max_discard_seg;
+
+	int irq;
+	cap_irq_handle_t irq_handle;
+
+	bd_srvs_t bds;
+} virtio_blk_t;
+
+#endif
@@ -56,6 +56,8 @@
 #include <ops/pio_window.h>
 #include <device/pio_window.h>
 #include <ddi.h>
+#include <sysinfo.h>
+#include <stats.h>
 #include <pci_dev_iface.h>
 
 #include "pci.h"
@@ -113,36 +115,497 @@ static bool pciintel_fun_owns_interrupt(pci_fun_t *fun, int irq)
 	return false;
 }
 
+/** Find the message signalled vector of the function behind an IRQ.
+ *
+ * @param fun PCI function
+ * @param irq IRQ number
+ * @param[out] idx Index of the vector within the function
+ *
+ * @return True if @a irq is one of the function's MSI or MSI-X vectors.
+ */
+static bool pciintel_fun_msi_index(pci_fun_t *fun, int irq, size_t *idx)
+{
+	int first = fun->busptr->msi_inr + (int) fun->msi_first;
+
+	if (fun->msi_count == 0 || irq < first ||
+	    irq >= first + (int) fun->msi_count)
+		return false;
+
+	*idx = irq - first;
+	return true;
+}
+
+/** Mask or unmask a single message signalled vector of the function.
+ *
+ * Plain MSI without per-vector masking cannot be masked at all. The
+ * kernel does not need the vector masked to keep it from firing while
+ * nobody is subscribed, so this is harmless.
+ */
+static void pci_msi_mask(pci_fun_t *fun, size_t idx, bool mask)
+{
+	if (fun->msix) {
+		ioport32_t *ctl = &fun->msix_table[idx * PCI_MSIX_ENTRY_WORDS +
+		    PCI_MSIX_ENTRY_CTL];
+		uint32_t val = pio_read_32(ctl);
+
+		if (mask)
+			val |= PCI_MSIX_ENTRY_CTL_MASK;
+		else
+			val &= ~PCI_MSIX_ENTRY_CTL_MASK;
+		pio_write_32(ctl, val);
+		return;
+	}
+
+	uint16_t ctl = pci_conf_read_16(fun, fun->msi_cap + PCI_MSI_CTL);
+	if ((ctl & PCI_MSI_CTL_MASKABLE) == 0)
+		return;
+
+	int reg = fun->msi_cap + ((ctl & PCI_MSI_CTL_64BIT) ?
+	    PCI_MSI_MASK_64 : PCI_MSI_MASK_32);
+	uint32_t bits = pci_conf_read_32(fun, reg);
+
+	if (mask)
+		bits |= 1U << idx;
+	else
+		bits &= ~(1U << idx);
+	pci_conf_write_32(fun, reg, bits);
+}
+
 static errno_t pciintel_enable_interrupt(ddf_fun_t *fnode, int irq)
 {
 	pci_fun_t *fun = pci_fun(fnode);
+	size_t idx;
 
 	if (!pciintel_fun_owns_interrupt(fun, irq))
 		return EINVAL;
 
+	if (pciintel_fun_msi_index(fun, irq, &idx)) {
+		pci_msi_mask(fun, idx, false);
+		return EOK;
+	}
+
 	return irc_enable_interrupt(irq);
 }
 
 static errno_t pciintel_disable_interrupt(ddf_fun_t *fnode, int irq)
 {
 	pci_fun_t *fun = pci_fun(fnode);
+	size_t idx;
 
 	if (!pciintel_fun_owns_interrupt(fun, irq))
 		return EINVAL;
 
+	if (pciintel_fun_msi_index(fun, irq, &idx)) {
+		pci_msi_mask(fun, idx, true);
+		return EOK;
+	}
+
 	return irc_disable_interrupt(irq);
 }
 
 static errno_t pciintel_clear_interrupt(ddf_fun_t *fnode, int irq)
 {
 	pci_fun_t *fun = pci_fun(fnode);
+	size_t idx;
 
 	if (!pciintel_fun_owns_interrupt(fun, irq))
 		return EINVAL;
 
+	/* Message signalled interrupts are acknowledged by the kernel. */
+	if (pciintel_fun_msi_index(fun, irq, &idx))
+		return EOK;
+
 	return irc_clear_interrupt(irq);
 }
 
+/** Check whether a CPU is up and can receive interrupts. */
+static bool pci_cpu_active(unsigned int cpu)
+{
+	size_t count;
+	stats_cpu_t *stats = stats_get_cpus(&count);
+	bool active = false;
+
+	if (stats != NULL && cpu < count)
+		active = stats[cpu].active;
+
+	free(stats);
+	return active;
+}
+
+/** MSI address targeting a CPU. */
+static uint32_t pci_msi_address(pci_bus_t *bus, unsigned int cpu)
+{
+	if (cpu < bus->msi_cpus)
+		return bus->msi_addresses[cpu];
+
+	return bus->msi_address;
+}
+
+/** Spread vectors round-robin over the active CPUs.
+ *
+ * Without CPU statistics all vectors stay on the bootstrap processor.
+ *
+ * @param bus   PCI bus
+ * @param cpus  Array receiving the target CPU of each vector
+ * @param count Number of vectors
+ */
+static void pci_msi_spread(pci_bus_t *bus, unsigned int *cpus, size_t count)
+{
+	size_t ncpus = 0;
+	stats_cpu_t *stats = stats_get_cpus(&ncpus);
+	size_t i, tries;
+
+	assert(fibril_mutex_is_locked(&bus->msi_mutex));
+
+	for (i = 0; i < count; i++) {
+		cpus[i] = 0;
+
+		for (tries = 0; stats != NULL && tries < ncpus; tries++) {
+			unsigned int cpu = bus->msi_next_cpu++ % ncpus;
+
+			if (stats[cpu].active) {
+				cpus[i] = cpu;
+				break;
+			}
+		}
+	}
+
+	free(stats);
+}
+
+/** Allocate a contiguous range of message signalled vectors.
+ *
+ * @param bus   PCI bus
+ * @param count Number of vectors
+ * @param align Required alignment of the first vector number
+ * @param[out] first Index of the first vector in the bus pool
+ *
+ * @return True on success.
+ */
+static bool pci_msi_alloc_range(pci_bus_t *bus, size_t count, size_t align,
+    size_t *first)
+{
+	size_t base = (align - (size_t) bus->msi_vector % align) % align;
+	size_t i;
+
+	assert(fibril_mutex_is_locked(&bus->msi_mutex));
+
+	for (; base + count <= bus->msi_count; base += align) {
+		for (i = 0; i < count; i++) {
+			if (bus->msi_used[base + i])
+				break;
+		}
+
+		if (i == count) {
+			for (i = 0; i < count; i++)
+				bus->msi_used[base + i] = true;
+			*first = base;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static void pci_msi_free_range(pci_bus_t *bus, size_t first, size_t count)
+{
+	size_t i;
+
+	fibril_mutex_lock(&bus->msi_mutex);
+	for (i = 0; i < count; i++)
+		bus->msi_used[first + i] = false;
+	fibril_mutex_unlock(&bus->msi_mutex);
+}
+
+/** Remove all interrupts from the resource list of the function. */
+static void pci_remove_interrupts(pci_fun_t *fun)
+{
+	hw_resource_list_t *hw_res_list = &fun->hw_resources;
+	size_t i, j;
+
+	for (i = 0, j = 0; i < hw_res_list->count; i++) {
+		if (hw_res_list->resources[i].type != INTERRUPT)
+			hw_res_list->resources[j++] = hw_res_list->resources[i];
+	}
+
+	hw_res_list->count = j;
+}
+
+/** Physical address of a memory BAR, 0 if it is not one. */
+static uint64_t pci_bar_address(pci_fun_t *fun, int bir)
+{
+	int addr = PCI_BASE_ADDR_0 + 4 * bir;
+	uint32_t val = pci_conf_read_32(fun, addr);
+	uint64_t base;
+
+	if ((val & 1) != 0)
+		return 0;
+
+	base = val & 0xfffffff0;
+	if (((val >> 1) & 3) == 2 && bir < 5)
+		base |= (uint64_t) pci_conf_read_32(fun, addr + 4) << 32;
+
+	return base;
+}
+
+/** Program the MSI capability with @a count vectors starting at @a first.
+ *
+ * All vectors of plain MSI share one address, the first CPU is used.
+ */
+static errno_t pci_msi_setup(pci_fun_t *fun, size_t first, size_t count,
+    const unsigned int *cpus)
+{
+	pci_bus_t *bus = fun->busptr;
+	int cap = fun->msi_cap;
+	uint16_t ctl = pci_conf_read_16(fun, cap + PCI_MSI_CTL);
+	uint16_t data = bus->msi_vector + first;
+	unsigned int order = 0;
+
+	while ((1U << order) < count)
+		order++;
+
+	pci_conf_write_32(fun, cap + PCI_MSI_ADDR_LO,
+	    pci_msi_address(bus, cpus[0]));
+	if (ctl & PCI_MSI_CTL_64BIT) {
+		pci_conf_write_32(fun, cap + PCI_MSI_ADDR_HI, 0);
+		pci_conf_write_16(fun, cap + PCI_MSI_DATA_64, data);
+	} else {
+		pci_conf_write_16(fun, cap + PCI_MSI_DATA_32, data);
+	}
+
+	/* Keep the vectors masked until the driver enables them. */
+	if (ctl & PCI_MSI_CTL_MASKABLE) {
+		int reg = cap + ((ctl & PCI_MSI_CTL_64BIT) ?
+		    PCI_MSI_MASK_64 : PCI_MSI_MASK_32);
+		pci_conf_write_32(fun, reg, 0xffffffff);
+	}
+
+	ctl &= ~PCI_MSI_CTL_MME;
+	ctl |= (order << PCI_MSI_CTL_MME_SHIFT) | PCI_MSI_CTL_ENABLE;
+	pci_conf_write_16(fun, cap + PCI_MSI_CTL, ctl);
+
+	return EOK;
+}
+
+/** Program the MSI-X table with @a count vectors starting at @a first. */
+static errno_t pci_msix_setup(pci_fun_t *fun, size_t first, size_t count,
+    const unsigned int *cpus)
+{
+	pci_bus_t *bus = fun->busptr;
+	int cap = fun->msix_cap;
+	uint16_t ctl = pci_conf_read_16(fun, cap + PCI_MSIX_CTL);
+	size_t size = (ctl & PCI_MSIX_CTL_SIZE) + 1;
+	size_t i;
+
+	if (fun->msix_table == NULL) {
+		uint32_t table = pci_conf_read_32(fun, cap + PCI_MSIX_TABLE);
+		uint64_t base = pci_bar_address(fun,
+		    table & PCI_MSIX_TABLE_BIR);
+
+		if (base == 0)
+			return EIO;
+
+		errno_t rc = pio_enable((void *) (uintptr_t) (base +
+		    (table & ~PCI_MSIX_TABLE_BIR)),
+		    size * PCI_MSIX_ENTRY_WORDS * sizeof(uint32_t),
+		    (void **) &fun->msix_table);
+		if (rc != EOK) {
+			ddf_msg(LVL_ERROR, "Failed to map MSI-X table of %s.",
+			    ddf_fun_get_name(fun->fnode));
+			return rc;
+		}
+	}
+
+	/* Hold off all vectors while the table is being rewritten. */
+	pci_conf_write_16(fun, cap + PCI_MSIX_CTL,
+	    ctl | PCI_MSIX_CTL_MASKALL | PCI_MSIX_CTL_ENABLE);
+
+	for (i = 0; i < size; i++) {
+		ioport32_t *entry = &fun->msix_table[i * PCI_MSIX_ENTRY_WORDS];
+
+		pio_write_32(&entry[PCI_MSIX_ENTRY_CTL],
+		    PCI_MSIX_ENTRY_CTL_MASK);
+		if (i >= count)
+			continue;
+
+		pio_write_32(&entry[PCI_MSIX_ENTRY_ADDR_LO],
+		    pci_msi_address(bus, cpus[i]));
+		pio_write_32(&entry[PCI_MSIX_ENTRY_ADDR_HI], 0);
+		pio_write_32(&entry[PCI_MSIX_ENTRY_DATA],
+		    bus->msi_vector + first + i);
+	}
+
+	pci_conf_write_16(fun, cap + PCI_MSIX_CTL,
+	    (ctl & ~PCI_MSIX_CTL_MASKALL) | PCI_MSIX_CTL_ENABLE);
+
+	return EOK;
+}
+
+/** Switch the function to message signalled interrupts.
+ *
+ * MSI-X is preferred over MSI. If the bus pool cannot satisfy the request,
+ * fewer vectors are allocated. The legacy interrupt of the function is
+ * disabled and replaced by the new vectors in its resource list.
+ */
+static errno_t pciintel_alloc_msi(ddf_fun_t *fnode, size_t count,
+    size_t *allocated)
+{
+	pci_fun_t *fun = pci_fun(fnode);
+	pci_bus_t *bus = fun->busptr;
+	unsigned int cpus[PCI_MSI_MAX_VECTORS];
+	bool msix;
+	size_t max;
+	size_t first;
+	size_t i;
+	errno_t rc;
+
+	if (count == 0)
+		return EINVAL;
+
+	if (fun->msi_count != 0)
+		return EBUSY;
+
+	if (bus->msi_count == 0)
+		return ENOTSUP;
+
+	if (fun->msix_cap != 0) {
+		msix = true;
+		max = (pci_conf_read_16(fun, fun->msix_cap + PCI_MSIX_CTL) &
+		    PCI_MSIX_CTL_SIZE) + 1;
+	} else if (fun->msi_cap != 0) {
+		msix = false;
+		max = 1 << ((pci_conf_read_16(fun, fun->msi_cap + PCI_MSI_CTL) &
+		    PCI_MSI_CTL_MMC) >> PCI_MSI_CTL_MMC_SHIFT);
+	} else {
+		return ENOTSUP;
+	}
+
+	count = min(count, max);
+
+	/* Multiple message MSI needs a power of two, naturally aligned. */
+	if (!msix) {
+		size_t pow = 1;
+		while (pow * 2 <= count)
+			pow *= 2;
+		count = pow;
+	}
+
+	fibril_mutex_lock(&bus->msi_mutex);
+	while (!pci_msi_alloc_range(bus, count, msix ? 1 : count, &first)) {
+		if (count == 1) {
+			fibril_mutex_unlock(&bus->msi_mutex);
+			return ENOMEM;
+		}
+		count /= 2;
+	}
+	pci_msi_spread(bus, cpus, count);
+	fibril_mutex_unlock(&bus->msi_mutex);
+
+	fun->msix = msix;
+	rc = msix ? pci_msix_setup(fun, first, count, cpus) :
+	    pci_msi_setup(fun, first, count, cpus);
+	if (rc != EOK) {
+		pci_msi_free_range(bus, first, count);
+		return rc;
+	}
+
+	fun->msi_first = first;
+	fun->msi_count = count;
+
+	fun->command |= PCI_COMMAND_INTX_DISABLE;
+	pci_conf_write_16(fun, PCI_COMMAND, fun->command);
+
+	pci_remove_interrupts(fun);
+	for (i = 0; i < count; i++)
+		pci_add_interrupt(fun, bus->msi_inr + first + i);
+
+	ddf_msg(LVL_NOTE, "Function %s uses %zu %s vectors.",
+	    ddf_fun_get_name(fnode), count, msix ? "MSI-X" : "MSI");
+
+	*allocated = count;
+	return EOK;
+}
+
+/** Deliver a message signalled vector of the function to a single CPU.
+ *
+ * Legacy interrupts are routed by the kernel through the IRQ capability
+ * of the driver, ENOTSUP is returned for them.
+ */
+static errno_t pciintel_set_interrupt_affinity(ddf_fun_t *fnode, int irq,
+    unsigned int cpu)
+{
+	pci_fun_t *fun = pci_fun(fnode);
+	pci_bus_t *bus = fun->busptr;
+	size_t idx;
+
+	if (!pciintel_fun_owns_interrupt(fun, irq))
+		return EINVAL;
+
+	if (!pciintel_fun_msi_index(fun, irq, &idx))
+		return ENOTSUP;
+
+	if (cpu >= bus->msi_cpus || !pci_cpu_active(cpu))
+		return EINVAL;
+
+	if (fun->msix) {
+		ioport32_t *entry = &fun->msix_table[idx * PCI_MSIX_ENTRY_WORDS];
+		uint32_t ctl = pio_read_32(&entry[PCI_MSIX_ENTRY_CTL]);
+
+		pio_write_32(&entry[PCI_MSIX_ENTRY_CTL],
+		    ctl | PCI_MSIX_ENTRY_CTL_MASK);
+		pio_write_32(&entry[PCI_MSIX_ENTRY_ADDR_LO],
+		    bus->msi_addresses[cpu]);
+		pio_write_32(&entry[PCI_MSIX_ENTRY_CTL], ctl);
+	} else {
+		/* All vectors of plain MSI move together. */
+		int cap = fun->msi_cap;
+		uint16_t ctl = pci_conf_read_16(fun, cap + PCI_MSI_CTL);
+
+		pci_conf_write_16(fun, cap + PCI_MSI_CTL,
+		    ctl & ~PCI_MSI_CTL_ENABLE);
+		pci_conf_write_32(fun, cap + PCI_MSI_ADDR_LO,
+		    bus->msi_addresses[cpu]);
+		pci_conf_write_16(fun, cap + PCI_MSI_CTL, ctl);
+	}
+
+	return EOK;
+}
+
+/** Return the function to its legacy interrupt. */
+static errno_t pciintel_free_msi(ddf_fun_t *fnode)
+{
+	pci_fun_t *fun = pci_fun(fnode);
+	uint16_t ctl;
+	size_t i;
+
+	if (fun->msi_count == 0)
+		return ENOENT;
+
+	if (fun->msix) {
+		for (i = 0; i < fun->msi_count; i++)
+			pci_msi_mask(fun, i, true);
+
+		ctl = pci_conf_read_16(fun, fun->msix_cap + PCI_MSIX_CTL);
+		pci_conf_write_16(fun, fun->msix_cap + PCI_MSIX_CTL,
+		    ctl & ~PCI_MSIX_CTL_ENABLE);
+	} else {
+		ctl = pci_conf_read_16(fun, fun->msi_cap + PCI_MSI_CTL);
+		pci_conf_write_16(fun, fun->msi_cap + PCI_MSI_CTL,
+		    ctl & ~PCI_MSI_CTL_ENABLE);
+	}
+
+	pci_msi_free_range(fun->busptr, fun->msi_first, fun->msi_count);
+	fun->msi_count = 0;
+
+	fun->command &= ~PCI_COMMAND_INTX_DISABLE;
+	pci_conf_write_16(fun, PCI_COMMAND, fun->command);
+
+	pci_remove_interrupts(fun);
+	pci_read_interrupt(fun);
+
+	return EOK;
+}
+
 static pio_window_t *pciintel_get_pio_window(ddf_fun_t *fnode)
 {
 	pci_fun_t *fun = pci_fun(fnode);
@@ -212,6 +675,9 @@ static hw_res_ops_t pciintel_hw_res_ops = {
 	.enable_interrupt = &pciintel_enable_interrupt,
 	.disable_interrupt = &pciintel_disable_interrupt,
 	.clear_interrupt = &pciintel_clear_interrupt,
+	.alloc_msi = &pciintel_alloc_msi,
+	.free_msi = &pciintel_free_msi,
+	.set_interrupt_affinity = &pciintel_set_interrupt_affinity,
 };
 
 static pio_window_ops_t pciintel_pio_window_ops = {
@@ -593,6 +1059,71 @@ void pci_read_interrupt(pci_fun_t *fun)
 		pci_add_interrupt(fun, irq);
 }
 
+/** Walk the capability list and remember the MSI and MSI-X capabilities.
+ *
+ * @param fun	PCI function
+ */
+void pci_read_caps(pci_fun_t *fun)
+{
+	/* Each capability takes at least 4 bytes past the standard header. */
+	unsigned int ttl = (256 - 64) / 4;
+	uint8_t ptr;
+
+	fun->msi_cap = 0;
+	fun->msix_cap = 0;
+
+	if ((pci_conf_read_16(fun, PCI_STATUS) & PCI_STATUS_CAP_LIST) == 0)
+		return;
+
+	ptr = pci_conf_read_8(fun, PCI_CAP_PTR) & ~0x3;
+	while (ptr >= 0x40 && ttl-- > 0) {
+		switch (pci_conf_read_8(fun, PCI_CAP_ID(ptr))) {
+		case PCI_CAP_MSI:
+			fun->msi_cap = ptr;
+			break;
+		case PCI_CAP_MSIX:
+			fun->msix_cap = ptr;
+			break;
+		}
+
+		ptr = pci_conf_read_8(fun, PCI_CAP_NEXT(ptr)) & ~0x3;
+	}
+}
+
+/** Pick up the message signalled interrupt vectors published by the kernel.
+ *
+ * @param bus	PCI bus
+ */
+static void pci_msi_init(pci_bus_t *bus)
+{
+	sysarg_t address;
+	sysarg_t vector;
+	sysarg_t inr;
+	sysarg_t count;
+
+	fibril_mutex_initialize(&bus->msi_mutex);
+	bus->msi_count = 0;
+
+	if (sysinfo_get_value("msi.address", &address) != EOK ||
+	    sysinfo_get_value("msi.vector", &vector) != EOK ||
+	    sysinfo_get_value("msi.inr", &inr) != EOK ||
+	    sysinfo_get_value("msi.count", &count) != EOK) {
+		ddf_msg(LVL_NOTE, "Message signalled interrupts not available.");
+		return;
+	}
+
+	bus->msi_address = address;
+	bus->msi_vector = vector;
+	bus->msi_inr = inr;
+	bus->msi_count = min(count, PCI_MSI_MAX_VECTORS);
+
+	/* Without per-CPU addresses everything goes to the bootstrap CPU. */
+	size_t size;
+	bus->msi_addresses = sysinfo_get_data("msi.addresses", &size);
+	if (bus->msi_addresses != NULL)
+		bus->msi_cpus = size / sizeof(uint32_t);
+}
+
 /** Enumerate (recursively) and register the devices connected to a pci bus.
  *
  * @param bus		Host-to-PCI bridge
@@ -652,6 +1183,7 @@ void pci_bus_scan(pci_bus_t *bus, int bus_num)
 			pci_alloc_resource_list(fun);
 			pci_read_bars(fun);
 			pci_read_interrupt(fun);
+			pci_read_caps(fun);
 
 			/* Propagate the PIO window to the function. */
 			fun->pio_window = bus->pio_win;
@@ -791,6 +1323,8 @@ static errno_t pci_dev_add(ddf_dev_t *dnode)
 		goto fail;
 	}
 
+	pci_msi_init(bus);
+
 	/* Enumerate functions. */
 	ddf_msg(LVL_DEBUG, "Scanning the bus");
 	pci_bus_scan(bus, 0);
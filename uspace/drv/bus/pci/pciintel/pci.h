@@ -39,7 +39,10 @@
 #include <ddf/driver.h>
 #include "pci_regs.h"
 
-#define PCI_MAX_HW_RES 10
+/** Most message signalled vectors a bus hands out */
+#define PCI_MSI_MAX_VECTORS 32
+
+#define PCI_MAX_HW_RES (10 + PCI_MSI_MAX_VECTORS)
 
 typedef struct pciintel_bus {
 	/** DDF device node */
@@ -49,6 +52,20 @@ typedef struct pciintel_bus {
 	ioport32_t *conf_space;
 	pio_window_t pio_win;
 	fibril_mutex_t conf_mutex;
+
+	/** Message signalled interrupts provided by the platform */
+	uint32_t msi_address;
+	int msi_vector;
+	int msi_inr;
+	size_t msi_count;
+	/** Address targeting each CPU, indexed by kernel CPU ID */
+	uint32_t *msi_addresses;
+	size_t msi_cpus;
+	/** Vectors handed out to functions, protected by msi_mutex */
+	bool msi_used[PCI_MSI_MAX_VECTORS];
+	/** Next CPU to receive a vector, protected by msi_mutex */
+	unsigned int msi_next_cpu;
+	fibril_mutex_t msi_mutex;
 } pci_bus_t;
 
 typedef struct pci_fun_data {
@@ -68,6 +85,16 @@ typedef struct pci_fun_data {
 	hw_resource_list_t hw_resources;
 	hw_resource_t resources[PCI_MAX_HW_RES];
 	pio_window_t pio_window;
+
+	/** Offsets of the MSI and MSI-X capabilities, 0 if absent */
+	uint8_t msi_cap;
+	uint8_t msix_cap;
+	/** Message signalled vectors in use, msi_count is 0 if none */
+	bool msix;
+	size_t msi_first;
+	size_t msi_count;
+	/** Mapped MSI-X table */
+	ioport32_t *msix_table;
 } pci_fun_t;
 
 extern void pci_fun_create_match_ids(pci_fun_t *);
@@ -83,6 +110,7 @@ extern void pci_add_range(pci_fun_t *, uint64_t, size_t, bool);
 extern int pci_read_bar(pci_fun_t *, int);
 extern void pci_read_interrupt(pci_fun_t *);
 extern void pci_add_interrupt(pci_fun_t *, int);
+extern void pci_read_caps(pci_fun_t *);
 
 extern pci_fun_t *pci_fun_new(pci_bus_t *);
 extern void pci_fun_init(pci_fun_t *, int, int, int);
@@ -107,6 +107,42 @@
 #define PCI_COMMAND_FAST_BACK     0x200
 #define PCI_COMMAND_INTX_DISABLE  0x400
 
+/* MSI capability */
+#define PCI_MSI_CTL       0x02
+#define PCI_MSI_ADDR_LO   0x04
+#define PCI_MSI_ADDR_HI   0x08
+#define PCI_MSI_DATA_32   0x08
+#define PCI_MSI_MASK_32   0x0C
+#define PCI_MSI_DATA_64   0x0C
+#define PCI_MSI_MASK_64   0x10
+
+#define PCI_MSI_CTL_ENABLE    0x0001
+#define PCI_MSI_CTL_MMC       0x000E
+#define PCI_MSI_CTL_MMC_SHIFT 1
+#define PCI_MSI_CTL_MME       0x0070
+#define PCI_MSI_CTL_MME_SHIFT 4
+#define PCI_MSI_CTL_64BIT     0x0080
+#define PCI_MSI_CTL_MASKABLE  0x0100
+
+/* MSI-X capability */
+#define PCI_MSIX_CTL    0x02
+#define PCI_MSIX_TABLE  0x04
+
+#define PCI_MSIX_CTL_SIZE    0x07FF
+#define PCI_MSIX_CTL_MASKALL 0x4000
+#define PCI_MSIX_CTL_ENABLE  0x8000
+
+#define PCI_MSIX_TABLE_BIR   0x7
+
+/* MSI-X table entry, in 32-bit words */
+#define PCI_MSIX_ENTRY_WORDS    4
+#define PCI_MSIX_ENTRY_ADDR_LO  0
+#define PCI_MSIX_ENTRY_ADDR_HI  1
+#define PCI_MSIX_ENTRY_DATA     2
+#define PCI_MSIX_ENTRY_CTL      3
+
+#define PCI_MSIX_ENTRY_CTL_MASK  0x1
+
 #endif
 
 /**
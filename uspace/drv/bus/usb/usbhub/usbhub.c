@@ -200,7 +200,6 @@ err_ddf_fun:
 
 static errno_t usb_hub_cleanup(usb_hub_dev_t *hub)
 {
-	free(hub->polling.buffer);
 	usb_polling_fini(&hub->polling);
 
 	for (size_t port = 0; port < hub->port_count; ++port) {
@@ -282,14 +281,12 @@ static errno_t usb_hub_polling_init(usb_hub_dev_t *hub_dev,
 	polling->device = hub_dev->usb_device;
 	polling->ep_mapping = mapping;
 	polling->request_size = ((hub_dev->port_count + 1 + 7) / 8);
-	polling->buffer = malloc(polling->request_size);
 	polling->on_data = hub_port_changes_callback;
 	polling->on_error = usb_hub_polling_error_callback;
 	polling->arg = hub_dev;
 
 	if ((err = usb_polling_start(polling))) {
 		/* Polling is already initialized. */
-		free(polling->buffer);
 		usb_polling_fini(polling);
 		return err;
 	}
@@ -55,6 +55,7 @@ static const bus_ops_t xhci_bus_ops = {
 	.endpoint_destroy = xhci_endpoint_destroy,
 	.endpoint_register = xhci_endpoint_register,
 	.endpoint_unregister = xhci_endpoint_unregister,
+	.endpoint_request_streams = xhci_endpoint_request_streams,
 
 	.batch_schedule = xhci_transfer_schedule,
 	.batch_create = xhci_transfer_create,
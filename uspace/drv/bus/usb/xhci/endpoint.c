@@ -68,6 +68,7 @@ static errno_t xhci_endpoint_init(xhci_endpoint_t *xhci_ep, device_t *dev,
 	endpoint_init(ep, dev, desc);
 
 	fibril_mutex_initialize(&xhci_ep->guard);
+	list_initialize(&xhci_ep->pending_transfers);
 
 	xhci_ep->max_burst = desc->companion.max_burst + 1;
 
@@ -209,16 +210,13 @@ errno_t xhci_endpoint_register(endpoint_t *ep_base)
 }
 
 /**
- * Abort a transfer on an endpoint.
+ * Abort all transfers on an endpoint.
  */
 static void endpoint_abort(endpoint_t *ep)
 {
 	xhci_device_t *dev = xhci_device_get(ep->device);
 	xhci_endpoint_t *xhci_ep = xhci_endpoint_get(ep);
 
-	/* This function can only abort endpoints without streams. */
-	assert(xhci_ep->primary_stream_data_array == NULL);
-
 	fibril_mutex_lock(&xhci_ep->guard);
 
 	endpoint_set_offline_locked(ep);
@@ -236,8 +234,6 @@ static void endpoint_abort(endpoint_t *ep)
 		return;
 	}
 
-	usb_transfer_batch_t *const batch = ep->active_batch;
-
 	const errno_t err = hc_stop_endpoint(xhci_ep);
 	if (err) {
 		usb_log_error("Failed to stop endpoint %u of device "
@@ -247,10 +243,29 @@ static void endpoint_abort(endpoint_t *ep)
 
 	fibril_mutex_unlock(&xhci_ep->guard);
 
-	batch->error = EINTR;
-	batch->transferred_size = 0;
-	usb_transfer_batch_finish(batch);
-	return;
+	/* The ring is stopped, nothing still queued on it will complete. */
+	xhci_transfer_cancel_pending(xhci_ep, EINTR);
+}
+
+/**
+ * Switch an endpoint to primary streams. Only possible while there are no
+ * transfers pending on it.
+ *
+ * Bus callback.
+ */
+int xhci_endpoint_request_streams(endpoint_t *ep_base, unsigned count)
+{
+	xhci_endpoint_t *ep = xhci_endpoint_get(ep_base);
+	xhci_device_t *dev = xhci_device_get(ep_base->device);
+	xhci_hc_t *hc = bus_to_hc(endpoint_get_bus(ep_base));
+	errno_t err = EBUSY;
+
+	fibril_mutex_lock(&ep->guard);
+	if (list_empty(&ep->pending_transfers))
+		err = xhci_endpoint_request_primary_streams(hc, dev, ep, count);
+	fibril_mutex_unlock(&ep->guard);
+
+	return err;
 }
 
 /**
@@ -474,7 +489,9 @@ void xhci_setup_endpoint_context(xhci_endpoint_t *ep, xhci_ep_ctx_t *ep_ctx)
 
 /**
  * Clear endpoint halt condition by resetting the endpoint and skipping the
- * offending transfer.
+ * offending transfer, along with the ones queued after it.
+ *
+ * Stream ID 0 on an endpoint with streams stands for all of its streams.
  */
 errno_t xhci_endpoint_clear_halt(xhci_endpoint_t *ep, uint32_t stream_id)
 {
@@ -483,9 +500,21 @@ errno_t xhci_endpoint_clear_halt(xhci_endpoint_t *ep, uint32_t stream_id)
 	if ((err = hc_reset_endpoint(ep)))
 		return err;
 
-	if ((err = hc_reset_ring(ep, stream_id)))
+	if (stream_id == 0 && ep->primary_stream_data_size > 0) {
+		/* Stream 0 is reserved. */
+		for (uint32_t id = 1; id < ep->primary_stream_data_size; ++id) {
+			if ((err = hc_reset_ring(ep, id)))
+				return err;
+		}
+	} else if ((err = hc_reset_ring(ep, stream_id))) {
 		return err;
+	}
 
+	/*
+	 * The dequeue pointer was moved to the enqueue pointer, skipping also
+	 * the transfers queued behind the offending one.
+	 */
+	xhci_transfer_cancel_pending(ep, EINTR);
 	return EOK;
 }
 
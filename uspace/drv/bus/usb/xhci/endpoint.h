@@ -72,6 +72,12 @@ typedef struct xhci_endpoint {
 	/** Guarding scheduling of this endpoint. */
 	fibril_mutex_t guard;
 
+	/**
+	 * Transfers enqueued on the ring and not yet completed, in the order
+	 * they were scheduled (xhci_transfer_t.link). Guarded by guard.
+	 */
+	list_t pending_transfers;
+
 	/** Main transfer ring (unused if streams are enabled) */
 	xhci_trb_ring_t ring;
 
@@ -129,6 +135,7 @@ extern endpoint_t *xhci_endpoint_create(device_t *,
     const usb_endpoint_descriptors_t *);
 extern errno_t xhci_endpoint_register(endpoint_t *);
 extern void xhci_endpoint_unregister(endpoint_t *);
+extern int xhci_endpoint_request_streams(endpoint_t *, unsigned);
 extern void xhci_endpoint_destroy(endpoint_t *);
 
 extern void xhci_endpoint_free_transfer_ds(xhci_endpoint_t *);
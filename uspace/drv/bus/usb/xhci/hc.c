@@ -46,6 +46,19 @@
 #include "transfers.h"
 #include "trb_ring.h"
 
+/**
+ * Minimum interval between interrupts from the primary interrupter, in 250 ns
+ * units (i.e. 40 us). Completions arriving in the meantime are coalesced and
+ * handled in a single run of the event ring.
+ */
+#define XHCI_IMOD_INTERVAL 160
+
+/**
+ * Number of events handled before the event ring dequeue pointer is written
+ * back to the xHC, so that it can reuse the consumed TRBs.
+ */
+#define XHCI_ERDP_UPDATE_BATCH 16
+
 /**
  * Default USB Speed ID mapping: Table 157
  */
@@ -494,6 +507,8 @@ errno_t hc_start(xhci_hc_t *hc)
 	const uintptr_t erstba_phys = dma_buffer_phys_base(&hc->event_ring.erst);
 	XHCI_REG_WR(intr0, XHCI_INTR_ERSTBA, erstba_phys);
 
+	XHCI_REG_WR(intr0, XHCI_INTR_IMI, XHCI_IMOD_INTERVAL);
+
 	if (CAP_HANDLE_VALID(hc->base.irq_handle)) {
 		XHCI_REG_SET(intr0, XHCI_INTR_IE, 1);
 		XHCI_REG_SET(hc->op_regs, XHCI_OP_INTE, 1);
@@ -662,6 +677,7 @@ static void hc_run_event_ring(xhci_hc_t *hc, xhci_event_ring_t *event_ring,
 	errno_t err;
 
 	xhci_trb_t trb;
+	unsigned handled = 0;
 	hc->event_handler = fibril_get_id();
 
 	while ((err = xhci_event_ring_dequeue(event_ring, &trb)) != ENOENT) {
@@ -669,7 +685,8 @@ static void hc_run_event_ring(xhci_hc_t *hc, xhci_event_ring_t *event_ring,
 			usb_log_error("Failed to handle event in interrupt: %s", str_error(err));
 		}
 
-		XHCI_REG_WR(intr, XHCI_INTR_ERDP, hc->event_ring.dequeue_ptr);
+		if (++handled % XHCI_ERDP_UPDATE_BATCH == 0)
+			XHCI_REG_WR(intr, XHCI_INTR_ERDP, hc->event_ring.dequeue_ptr);
 	}
 
 	hc->event_handler = 0;
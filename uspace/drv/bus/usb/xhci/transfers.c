@@ -290,6 +290,56 @@ static int schedule_isochronous(xhci_transfer_t *transfer)
 	    isoch_schedule_in(transfer);
 }
 
+/**
+ * Remove a completed transfer from the list of pending transfers and let the
+ * fibrils waiting for ring space (or for the endpoint to drain) continue.
+ *
+ * Call only under endpoint guard.
+ */
+static void transfer_retire_locked(xhci_endpoint_t *ep,
+    xhci_transfer_t *transfer)
+{
+	assert(fibril_mutex_is_locked(&ep->guard));
+
+	list_remove(&transfer->link);
+
+	link_t *first = list_first(&ep->pending_transfers);
+	ep->base.active_batch = first ?
+	    &list_get_instance(first, xhci_transfer_t, link)->batch : NULL;
+
+	fibril_condvar_broadcast(&ep->base.avail);
+}
+
+/**
+ * Finish all transfers pending on an endpoint with an error. Used when the
+ * transfer ring has been stopped or its dequeue pointer moved past them, so
+ * no event will ever arrive for these transfers.
+ *
+ * Must be called without holding the endpoint guard.
+ */
+void xhci_transfer_cancel_pending(xhci_endpoint_t *ep, errno_t error)
+{
+	list_t cancelled;
+	list_initialize(&cancelled);
+
+	fibril_mutex_lock(&ep->guard);
+	list_concat(&cancelled, &ep->pending_transfers);
+	ep->base.active_batch = NULL;
+	fibril_condvar_broadcast(&ep->base.avail);
+	fibril_mutex_unlock(&ep->guard);
+
+	link_t *link;
+	while ((link = list_first(&cancelled))) {
+		list_remove(link);
+
+		xhci_transfer_t *transfer =
+		    list_get_instance(link, xhci_transfer_t, link);
+		transfer->batch.error = error;
+		transfer->batch.transferred_size = 0;
+		usb_transfer_batch_finish(&transfer->batch);
+	}
+}
+
 errno_t xhci_handle_transfer_event(xhci_hc_t *hc, xhci_trb_t *trb)
 {
 	uintptr_t addr = trb->parameter;
@@ -325,6 +375,10 @@ errno_t xhci_handle_transfer_event(xhci_hc_t *hc, xhci_trb_t *trb)
 		xhci_trb_ring_update_dequeue(get_ring(transfer),
 		    transfer->interrupt_trb_phys);
 		batch = &transfer->batch;
+
+		fibril_mutex_lock(&ep->guard);
+		transfer_retire_locked(ep, transfer);
+		fibril_mutex_unlock(&ep->guard);
 	} else {
 		xhci_trb_ring_update_dequeue(&ep->ring, addr);
 
@@ -335,18 +389,26 @@ errno_t xhci_handle_transfer_event(xhci_hc_t *hc, xhci_trb_t *trb)
 			return EOK;
 		}
 
+		/*
+		 * Without streams, the ring is processed in order and only the
+		 * last TRB of a TD interrupts (or the one that failed), so the
+		 * event always belongs to the oldest pending transfer.
+		 */
 		fibril_mutex_lock(&ep->guard);
-		batch = ep->base.active_batch;
-		endpoint_deactivate_locked(&ep->base);
+		link_t *first = list_first(&ep->pending_transfers);
+		transfer = first ?
+		    list_get_instance(first, xhci_transfer_t, link) : NULL;
+		if (transfer)
+			transfer_retire_locked(ep, transfer);
 		fibril_mutex_unlock(&ep->guard);
 
-		if (!batch) {
+		if (!transfer) {
 			/* Dropping temporary reference */
 			endpoint_del_ref(&ep->base);
 			return ENOENT;
 		}
 
-		transfer = xhci_transfer_from_batch(batch);
+		batch = &transfer->batch;
 	}
 
 	const xhci_trb_completion_code_t completion_code = TRB_COMPLETION_CODE(*trb);
@@ -467,8 +529,8 @@ errno_t xhci_transfer_schedule(usb_transfer_batch_t *batch)
 			endpoint_t *halted_ep = bus_find_endpoint(&xhci_dev->base, ep_num, dir);
 			if (halted_ep) {
 				/*
-				 * TODO: Find out how to come up with stream_id. It might be
-				 * possible that we have to clear all of them.
+				 * The request does not name a stream, reset all of
+				 * them.
 				 */
 				const errno_t err = xhci_endpoint_clear_halt(xhci_endpoint_get(halted_ep), 0);
 				endpoint_del_ref(halted_ep);
@@ -492,20 +554,42 @@ errno_t xhci_transfer_schedule(usb_transfer_batch_t *batch)
 	}
 
 
+	/*
+	 * Bulk and interrupt transfers are queued on the ring behind those
+	 * already in flight, so the xHC can move on to the next TD without
+	 * waiting for us to handle the completion of the previous one. Control
+	 * transfers may reconfigure the device, keep them one at a time.
+	 */
 	errno_t err;
 	fibril_mutex_lock(&xhci_ep->guard);
 
-	if ((err = endpoint_activate_locked(ep, batch))) {
-		fibril_mutex_unlock(&xhci_ep->guard);
-		return err;
+	while (true) {
+		if (!ep->online) {
+			err = EINTR;
+			break;
+		}
+
+		const bool busy = !list_empty(&xhci_ep->pending_transfers);
+		if (!busy || type != USB_TRANSFER_CONTROL) {
+			err = transfer_handlers[type](hc, transfer);
+
+			/* Wait for the ring to drain only if it ever will. */
+			if (err != EAGAIN || !busy)
+				break;
+		}
+
+		fibril_condvar_wait(&ep->avail, &xhci_ep->guard);
 	}
 
-	if ((err = transfer_handlers[batch->ep->transfer_type](hc, transfer))) {
-		endpoint_deactivate_locked(ep);
+	if (err) {
 		fibril_mutex_unlock(&xhci_ep->guard);
 		return err;
 	}
 
+	list_append(&transfer->link, &xhci_ep->pending_transfers);
+	if (!ep->active_batch)
+		ep->active_batch = batch;
+
 	hc_ring_ep_doorbell(xhci_ep, batch->target.stream);
 	fibril_mutex_unlock(&xhci_ep->guard);
 	return EOK;
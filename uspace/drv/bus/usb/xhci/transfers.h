@@ -42,9 +42,12 @@
 #include "trb_ring.h"
 
 typedef struct xhci_hc xhci_hc_t;
+typedef struct xhci_endpoint xhci_endpoint_t;
 
 typedef struct {
 	usb_transfer_batch_t batch;
+
+	/** Link in xhci_endpoint_t.pending_transfers */
 	link_t link;
 
 	uint8_t direction;
@@ -57,6 +60,7 @@ extern errno_t xhci_transfer_schedule(usb_transfer_batch_t *);
 
 extern errno_t xhci_handle_transfer_event(xhci_hc_t *, xhci_trb_t *);
 extern void xhci_transfer_destroy(usb_transfer_batch_t *);
+extern void xhci_transfer_cancel_pending(xhci_endpoint_t *, errno_t);
 
 static inline xhci_transfer_t *xhci_transfer_from_batch(
     usb_transfer_batch_t *batch)
@@ -152,19 +152,8 @@ default_connection_handler(ddf_fun_t *fun, cap_call_handle_t icall_handle,
 static const usb_hid_report_field_t *get_mouse_axis_move_field(uint8_t rid, usb_hid_report_t *report,
     int32_t usage)
 {
-	usb_hid_report_path_t *path = usb_hid_report_path();
-	usb_hid_report_path_append_item(path, USB_HIDUT_PAGE_GENERIC_DESKTOP,
-	    usage);
-
-	usb_hid_report_path_set_report_id(path, rid);
-
-	const usb_hid_report_field_t *field = usb_hid_report_get_sibling(
-	    report, NULL, path, USB_HID_PATH_COMPARE_END,
-	    USB_HID_REPORT_TYPE_INPUT);
-
-	usb_hid_report_path_free(path);
-
-	return field;
+	return usb_hid_report_find_field(report, rid,
+	    USB_HID_REPORT_TYPE_INPUT, USB_HIDUT_PAGE_GENERIC_DESKTOP, usage);
 }
 
 static void usb_mouse_process_report(usb_hid_dev_t *hid_dev,
@@ -153,6 +153,9 @@ typedef struct {
 	/** Add VLAN tag to frame */
 	bool vlan_tag_add;
 
+	/** Active offload options (NIC_OFFLOAD_xxx) */
+	uint32_t offload;
+
 	/** Used unicast Receive Address count */
 	unsigned int unicast_ra_count;
 
@@ -197,6 +200,9 @@ static errno_t e1000_autoneg_restart(ddf_fun_t *);
 
 static errno_t e1000_vlan_set_tag(ddf_fun_t *, uint16_t, bool, bool);
 
+static errno_t e1000_offload_probe(ddf_fun_t *, uint32_t *, uint32_t *);
+static errno_t e1000_offload_set(ddf_fun_t *, uint32_t, uint32_t);
+
 /** Network interface options for E1000 card driver */
 static nic_iface_t e1000_nic_iface;
 
@@ -213,6 +219,8 @@ static nic_iface_t e1000_nic_iface = {
 	.vlan_set_tag = &e1000_vlan_set_tag,
 	.defective_get_mode = &e1000_defective_get_mode,
 	.defective_set_mode = &e1000_defective_set_mode,
+	.offload_probe = &e1000_offload_probe,
+	.offload_set = &e1000_offload_set,
 };
 
 /** Basic device operations for E1000 driver */
@@ -235,6 +243,7 @@ static driver_t e1000_driver = {
 static errno_t e1000_on_activating(nic_t *);
 static errno_t e1000_on_stopping(nic_t *);
 static void e1000_send_frame(nic_t *, void *, size_t);
+static void e1000_send_frame_flags(nic_t *, void *, size_t, uint32_t);
 
 /** PIO ranges used in the IRQ code. */
 irq_pio_range_t e1000_irq_pio_ranges[] = {
@@ -328,6 +337,10 @@ static errno_t e1000_get_cable_state(ddf_fun_t *fun, nic_cable_state_t *state)
 
 static uint16_t e1000_calculate_itr_interval_from_usecs(suseconds_t useconds)
 {
+	/* The interval is specified in 256 ns units */
+	if (useconds >= (suseconds_t) (UINT16_MAX / 4))
+		return UINT16_MAX;
+
 	return useconds * 4;
 }
 
@@ -1080,6 +1093,74 @@ static errno_t e1000_vlan_set_tag(ddf_fun_t *fun, uint16_t tag, bool add,
 	return EOK;
 }
 
+/** Offload options supported by E1000 */
+#define E1000_OFFLOAD_SUPPORTED  (NIC_OFFLOAD_TX_CSUM4 | NIC_OFFLOAD_RX_CSUM4)
+
+/** Program receive checksum offload according to active offload options
+ *
+ * @param e1000 E1000 data structure
+ *
+ */
+static void e1000_initialize_rxcsum(e1000_t *e1000)
+{
+	uint32_t rxcsum = E1000_REG_READ(e1000, E1000_RXCSUM);
+
+	if (e1000->offload & NIC_OFFLOAD_RX_CSUM4)
+		rxcsum |= RXCSUM_IPOFL | RXCSUM_TUOFL;
+	else
+		rxcsum &= ~(RXCSUM_IPOFL | RXCSUM_TUOFL);
+
+	E1000_REG_WRITE(e1000, E1000_RXCSUM, rxcsum);
+}
+
+/** Probe offload options
+ *
+ * @param fun       E1000 function
+ * @param supported Supported offload options
+ * @param active    Active offload options
+ *
+ * @return EOK
+ *
+ */
+static errno_t e1000_offload_probe(ddf_fun_t *fun, uint32_t *supported,
+    uint32_t *active)
+{
+	e1000_t *e1000 = DRIVER_DATA_FUN(fun);
+
+	*supported = E1000_OFFLOAD_SUPPORTED;
+	*active = e1000->offload;
+	return EOK;
+}
+
+/** Set offload options
+ *
+ * @param fun    E1000 function
+ * @param mask   Offload options to change
+ * @param active New values of the options in @a mask
+ *
+ * @return EOK
+ * @return ENOTSUP if an unsupported option is to be enabled
+ *
+ */
+static errno_t e1000_offload_set(ddf_fun_t *fun, uint32_t mask,
+    uint32_t active)
+{
+	if (active & mask & ~E1000_OFFLOAD_SUPPORTED)
+		return ENOTSUP;
+
+	e1000_t *e1000 = DRIVER_DATA_FUN(fun);
+
+	fibril_mutex_lock(&e1000->rx_lock);
+	fibril_mutex_lock(&e1000->tx_lock);
+
+	e1000->offload = (e1000->offload & ~mask) | (active & mask);
+	e1000_initialize_rxcsum(e1000);
+
+	fibril_mutex_unlock(&e1000->tx_lock);
+	fibril_mutex_unlock(&e1000->rx_lock);
+	return EOK;
+}
+
 /** Fill receive descriptor with new empty buffer
  *
  * Store frame in e1000->rx_frame_phys
@@ -1167,11 +1248,13 @@ static uint32_t e1000_inc_tail(uint32_t tail, uint32_t descriptors_count)
 static void e1000_receive_frames(nic_t *nic)
 {
 	e1000_t *e1000 = DRIVER_DATA_NIC(nic);
+	nic_frame_list_t *frames = nic_alloc_frame_list();
 
 	fibril_mutex_lock(&e1000->rx_lock);
 
-	uint32_t *tail_addr = E1000_REG_ADDR(e1000, E1000_RDT);
-	uint32_t next_tail = e1000_inc_tail(*tail_addr, E1000_RX_FRAME_COUNT);
+	uint32_t tail = E1000_REG_READ(e1000, E1000_RDT);
+	uint32_t next_tail = e1000_inc_tail(tail, E1000_RX_FRAME_COUNT);
+	bool refilled = false;
 
 	e1000_rx_descriptor_t *rx_descriptor = (e1000_rx_descriptor_t *)
 	    (e1000->rx_ring_virt + next_tail * sizeof(e1000_rx_descriptor_t));
@@ -1179,24 +1262,45 @@ static void e1000_receive_frames(nic_t *nic)
 	while (rx_descriptor->status & 0x01) {
 		uint32_t frame_size = rx_descriptor->length - E1000_CRC_SIZE;
 
-		nic_frame_t *frame = nic_alloc_frame(nic, frame_size);
+		nic_frame_t *frame = NULL;
+		if ((e1000->offload & NIC_OFFLOAD_RX_CSUM4) &&
+		    (rx_descriptor->errors & (RXDESCRIPTOR_ERRORS_TCPE |
+		    RXDESCRIPTOR_ERRORS_IPE))) {
+			/* Bad checksum verified by hardware, drop */
+			nic_report_receive_error(nic, NIC_REC_OTHER, 1);
+		} else {
+			frame = nic_alloc_frame(nic, frame_size);
+			if (frame == NULL)
+				ddf_msg(LVL_ERROR, "Memory allocation failed. "
+				    "Frame dropped.");
+		}
+
 		if (frame != NULL) {
 			memcpy(frame->data, e1000->rx_frame_virt[next_tail], frame_size);
-			nic_received_frame(nic, frame);
-		} else {
-			ddf_msg(LVL_ERROR, "Memory allocation failed. Frame dropped.");
+			if (frames != NULL)
+				nic_frame_list_append(frames, frame);
+			else
+				nic_received_frame(nic, frame);
 		}
 
 		e1000_fill_new_rx_descriptor(nic, next_tail);
+		refilled = true;
 
-		*tail_addr = e1000_inc_tail(*tail_addr, E1000_RX_FRAME_COUNT);
-		next_tail = e1000_inc_tail(*tail_addr, E1000_RX_FRAME_COUNT);
+		tail = next_tail;
+		next_tail = e1000_inc_tail(tail, E1000_RX_FRAME_COUNT);
 
 		rx_descriptor = (e1000_rx_descriptor_t *)
 		    (e1000->rx_ring_virt + next_tail * sizeof(e1000_rx_descriptor_t));
 	}
 
+	/* Hand all refilled descriptors back to the hardware at once */
+	if (refilled)
+		E1000_REG_WRITE(e1000, E1000_RDT, tail);
+
 	fibril_mutex_unlock(&e1000->rx_lock);
+
+	/* Deliver all frames received in this round at once */
+	nic_received_frame_list(nic, frames);
 }
 
 /** Enable E1000 interupts
@@ -1305,7 +1409,9 @@ static void e1000_poll(nic_t *nic)
  */
 static uint16_t e1000_calculate_itr_interval(const struct timeval *period)
 {
-	// TODO: use also tv_sec
+	if (period->tv_sec > 0)
+		return UINT16_MAX;
+
 	return e1000_calculate_itr_interval_from_usecs(period->tv_usec);
 }
 
@@ -1363,6 +1469,8 @@ static void e1000_initialize_rx_registers(e1000_t *e1000)
 
 	/* Set Broadcast Enable Bit */
 	E1000_REG_WRITE(e1000, E1000_RCTL, RCTL_BAM);
+
+	e1000_initialize_rxcsum(e1000);
 }
 
 /** Initialize receive structure
@@ -1892,6 +2000,7 @@ static e1000_t *e1000_create_dev_data(ddf_dev_t *dev)
 
 	nic_set_specific(nic, e1000);
 	nic_set_send_frame_handler(nic, e1000_send_frame);
+	nic_set_send_frame_flags_handler(nic, e1000_send_frame_flags);
 	nic_set_state_change_handlers(nic, e1000_on_activating,
 	    e1000_on_down, e1000_on_stopping);
 	nic_set_filtering_change_handlers(nic,
@@ -1904,6 +2013,13 @@ static e1000_t *e1000_create_dev_data(ddf_dev_t *dev)
 	fibril_mutex_initialize(&e1000->tx_lock);
 	fibril_mutex_initialize(&e1000->eeprom_lock);
 
+	/* Received frames are copied into preallocated buffers */
+	if (nic_frame_pool_init(nic, E1000_RX_FRAME_COUNT,
+	    E1000_MAX_RECEIVE_FRAME_SIZE) != EOK) {
+		nic_unbind_and_destroy(dev);
+		return NULL;
+	}
+
 	return e1000;
 }
 
@@ -2321,23 +2437,83 @@ static void e1000_eeprom_get_address(e1000_t *e1000,
 	*mac4_dest = e1000_eeprom_read(e1000, 2);
 }
 
+/** Find checksum offsets for transmit checksum offload
+ *
+ * @param data   Frame data
+ * @param size   Frame size in bytes
+ * @param css    Place to store offset where checksumming starts
+ * @param cso    Place to store offset of the checksum field
+ *
+ * @return True if the frame is an IPv4 TCP or UDP frame
+ *
+ */
+static bool e1000_tx_csum_offsets(uint8_t *data, size_t size, uint8_t *css,
+    uint8_t *cso)
+{
+	/* Ethernet header followed by IPv4 header (at least 20 bytes) */
+	if (size < E1000_ETH_HEADER_SIZE + 20 ||
+	    ((data[12] << 8) | data[13]) != E1000_ETYPE_IP)
+		return false;
+
+	uint8_t *ip_hdr = data + E1000_ETH_HEADER_SIZE;
+	size_t l4_offs = E1000_ETH_HEADER_SIZE + (ip_hdr[0] & 0x0f) * 4;
+	size_t cs_offs;
+
+	/* Protocol field */
+	switch (ip_hdr[9]) {
+	case E1000_IP_PROTO_TCP:
+		cs_offs = l4_offs + 16;
+		break;
+	case E1000_IP_PROTO_UDP:
+		cs_offs = l4_offs + 6;
+		break;
+	default:
+		return false;
+	}
+
+	if (cs_offs + sizeof(uint16_t) > size || cs_offs > UINT8_MAX)
+		return false;
+
+	*css = l4_offs;
+	*cso = cs_offs;
+	return true;
+}
+
 /** Send frame
  *
  * @param nic    NIC driver data structure
  * @param data   Frame data
  * @param size   Frame size in bytes
  *
- * @return EOK if succeed
- * @return Error code in the case of error
- *
  */
 static void e1000_send_frame(nic_t *nic, void *data, size_t size)
+{
+	e1000_send_frame_flags(nic, data, size, 0);
+}
+
+/** Send frame with frame flags
+ *
+ * @param nic    NIC driver data structure
+ * @param data   Frame data
+ * @param size   Frame size in bytes
+ * @param flags  Frame flags (NIC_FRAME_xxx)
+ *
+ */
+static void e1000_send_frame_flags(nic_t *nic, void *data, size_t size,
+    uint32_t flags)
 {
 	assert(nic);
+	uint8_t css = 0;
+	uint8_t cso = 0;
+	bool insert_csum = false;
 
 	e1000_t *e1000 = DRIVER_DATA_NIC(nic);
 	fibril_mutex_lock(&e1000->tx_lock);
 
+	if ((flags & NIC_FRAME_CSUM_PARTIAL) &&
+	    (e1000->offload & NIC_OFFLOAD_TX_CSUM4))
+		insert_csum = e1000_tx_csum_offsets(data, size, &css, &cso);
+
 	uint32_t tdt = E1000_REG_READ(e1000, E1000_TDT);
 	e1000_tx_descriptor_t *tx_descriptor_addr = (e1000_tx_descriptor_t *)
 	    (e1000->tx_ring_virt + tdt * sizeof(e1000_tx_descriptor_t));
@@ -2371,7 +2547,11 @@ static void e1000_send_frame(nic_t *nic, void *data, size_t size)
 	    TXDESCRIPTOR_COMMAND_IFCS |
 	    TXDESCRIPTOR_COMMAND_EOP;
 
-	tx_descriptor_addr->checksum_offset = 0;
+	/* Let hardware insert TCP/UDP checksum */
+	if (insert_csum)
+		tx_descriptor_addr->command |= TXDESCRIPTOR_COMMAND_IC;
+
+	tx_descriptor_addr->checksum_offset = cso;
 	tx_descriptor_addr->status = 0;
 	if (e1000->vlan_tag_add) {
 		tx_descriptor_addr->special = e1000->vlan_tag;
@@ -2379,7 +2559,7 @@ static void e1000_send_frame(nic_t *nic, void *data, size_t size)
 	} else
 		tx_descriptor_addr->special = 0;
 
-	tx_descriptor_addr->checksum_start_field = 0;
+	tx_descriptor_addr->checksum_start_field = css;
 
 	tdt++;
 	if (tdt == E1000_TX_FRAME_COUNT)
@@ -32,6 +32,7 @@
 #include <stdint.h>
 
 #include <as.h>
+#include <byteorder.h>
 #include <ddf/driver.h>
 #include <ddf/interrupt.h>
 #include <ddf/log.h>
@@ -56,6 +57,11 @@
 #define TX_BUF_SIZE	BUFFER_SIZE
 #define CT_BUF_SIZE	BUFFER_SIZE
 
+#define ETH_HEADER_SIZE	14
+#define ETYPE_IP	0x0800
+#define IP_PROTO_TCP	6
+#define IP_PROTO_UDP	17
+
 static ddf_dev_ops_t virtio_net_dev_ops;
 
 static errno_t virtio_net_dev_add(ddf_dev_t *dev);
@@ -69,15 +75,39 @@ static driver_t virtio_net_driver = {
 	.driver_ops = &virtio_net_driver_ops
 };
 
-static void virtio_net_irq_handler(ipc_call_t *icall, ddf_dev_t *dev)
+/** Return used TX and CT buffers to their free lists. */
+static void virtio_net_reclaim(virtio_net_t *virtio_net)
+{
+	virtio_dev_t *vdev = &virtio_net->virtio_dev;
+	uint16_t descno;
+	uint32_t len;
+
+	while (virtio_virtq_consume_used(vdev, TX_QUEUE_1, &descno, &len)) {
+		virtio_free_desc(vdev, TX_QUEUE_1, &virtio_net->tx_free_head,
+		    descno);
+	}
+	while (virtio_virtq_consume_used(vdev, CT_QUEUE_1, &descno, &len)) {
+		virtio_free_desc(vdev, CT_QUEUE_1, &virtio_net->ct_free_head,
+		    descno);
+	}
+}
+
+/** Deliver received frames to the NIC framework.
+ *
+ * @return @c true if at least one buffer was processed
+ */
+static bool virtio_net_receive(nic_t *nic)
 {
-	nic_t *nic = ddf_dev_data_get(dev);
 	virtio_net_t *virtio_net = nic_get_specific(nic);
 	virtio_dev_t *vdev = &virtio_net->virtio_dev;
+	nic_frame_list_t *frames = nic_alloc_frame_list();
+	bool processed = false;
 
 	uint16_t descno;
 	uint32_t len;
 	while (virtio_virtq_consume_used(vdev, RX_QUEUE_1, &descno, &len)) {
+		processed = true;
+
 		virtio_net_hdr_t *hdr =
 		    (virtio_net_hdr_t *) virtio_net->rx_buf[descno];
 		if (len <= sizeof(*hdr)) {
@@ -91,7 +121,10 @@ static void virtio_net_irq_handler(ipc_call_t *icall, ddf_dev_t *dev)
 		nic_frame_t *frame = nic_alloc_frame(nic, len - sizeof(*hdr));
 		if (frame) {
 			memcpy(frame->data, &hdr[1], len - sizeof(*hdr));
-			nic_received_frame(nic, frame);
+			if (frames != NULL)
+				nic_frame_list_append(frames, frame);
+			else
+				nic_received_frame(nic, frame);
 		} else {
 			ddf_msg(LVL_WARN,
 			    "Cannot allocate RX frame, packet dropped");
@@ -100,13 +133,71 @@ static void virtio_net_irq_handler(ipc_call_t *icall, ddf_dev_t *dev)
 		virtio_virtq_produce_available(vdev, RX_QUEUE_1, descno);
 	}
 
-	while (virtio_virtq_consume_used(vdev, TX_QUEUE_1, &descno, &len)) {
-		virtio_free_desc(vdev, TX_QUEUE_1, &virtio_net->tx_free_head,
-		    descno);
+	/* Deliver all frames received in this round at once */
+	nic_received_frame_list(nic, frames);
+	return processed;
+}
+
+/** Handle interrupt.
+ *
+ * Further RX interrupts are suppressed while the ring is being drained.
+ * They are only enabled again once the ring is found empty, so a busy
+ * queue is served by polling instead of taking an interrupt per frame.
+ */
+static void virtio_net_irq_handler(ipc_call_t *icall, ddf_dev_t *dev)
+{
+	nic_t *nic = ddf_dev_data_get(dev);
+	virtio_net_t *virtio_net = nic_get_specific(nic);
+	virtio_dev_t *vdev = &virtio_net->virtio_dev;
+
+	virtio_virtq_disable_cb(vdev, RX_QUEUE_1);
+
+	while (true) {
+		while (virtio_net_receive(nic))
+			;
+
+		if (!virtio_net->rx_irq)
+			break;
+
+		if (virtio_virtq_enable_cb(vdev, RX_QUEUE_1))
+			break;
+
+		/* More frames arrived meanwhile */
+		virtio_virtq_disable_cb(vdev, RX_QUEUE_1);
 	}
-	while (virtio_virtq_consume_used(vdev, CT_QUEUE_1, &descno, &len)) {
-		virtio_free_desc(vdev, CT_QUEUE_1, &virtio_net->ct_free_head,
-		    descno);
+
+	virtio_net_reclaim(virtio_net);
+}
+
+/** Poll the device, used in NIC_POLL_ON_DEMAND and software periodic mode */
+static void virtio_net_poll(nic_t *nic)
+{
+	virtio_net_t *virtio_net = nic_get_specific(nic);
+
+	while (virtio_net_receive(nic))
+		;
+	virtio_net_reclaim(virtio_net);
+}
+
+static errno_t virtio_net_poll_mode_change(nic_t *nic, nic_poll_mode_t mode,
+    const struct timeval *period)
+{
+	virtio_net_t *virtio_net = nic_get_specific(nic);
+	virtio_dev_t *vdev = &virtio_net->virtio_dev;
+
+	switch (mode) {
+	case NIC_POLL_IMMEDIATE:
+		virtio_net->rx_irq = true;
+		if (!virtio_virtq_enable_cb(vdev, RX_QUEUE_1))
+			virtio_net_poll(nic);
+		return EOK;
+	case NIC_POLL_ON_DEMAND:
+		virtio_net->rx_irq = false;
+		virtio_virtq_disable_cb(vdev, RX_QUEUE_1);
+		return EOK;
+	default:
+		/* NIC framework falls back to software periodic polling */
+		return ENOTSUP;
 	}
 }
 
@@ -197,7 +288,8 @@ static errno_t virtio_net_initialize(ddf_dev_t *dev)
 
 	/* Reset the device and negotiate the feature bits */
 	rc = virtio_device_setup_start(vdev,
-	    VIRTIO_NET_F_MAC | VIRTIO_NET_F_CTRL_VQ);
+	    VIRTIO_NET_F_MAC | VIRTIO_NET_F_CTRL_VQ,
+	    VIRTIO_NET_F_CSUM | VIRTIO_F_EVENT_IDX);
 	if (rc != EOK)
 		goto fail;
 
@@ -271,6 +363,14 @@ static errno_t virtio_net_initialize(ddf_dev_t *dev)
 	virtio_create_desc_free_list(vdev, CT_QUEUE_1, CT_BUFFERS,
 	    &virtio_net->ct_free_head);
 
+	/*
+	 * Used TX and CT buffers are reclaimed when sending or when handling
+	 * an RX interrupt, there is no need to be interrupted for them.
+	 */
+	virtio_virtq_disable_cb(vdev, TX_QUEUE_1);
+	virtio_virtq_disable_cb(vdev, CT_QUEUE_1);
+	virtio_net->rx_irq = true;
+
 	/*
 	 * Read the MAC address
 	 */
@@ -323,18 +423,67 @@ static void virtio_net_uninitialize(ddf_dev_t *dev)
 	virtio_pci_dev_cleanup(&virtio_net->virtio_dev);
 }
 
-static void virtio_net_send(nic_t *nic, void *data, size_t size)
+/** Find TCP/UDP checksum location in an IPv4 frame.
+ *
+ * @param data        Frame data
+ * @param size        Frame size
+ * @param csum_start  Place to store offset where checksumming starts
+ * @param csum_offset Place to store offset of the checksum field
+ *                    relative to @a csum_start
+ * @return @c true if the frame is an IPv4 TCP or UDP frame
+ */
+static bool virtio_net_csum_location(uint8_t *data, size_t size,
+    uint16_t *csum_start, uint16_t *csum_offset)
+{
+	/* Ethernet header followed by IPv4 header (at least 20 bytes) */
+	if (size < ETH_HEADER_SIZE + 20 ||
+	    ((data[12] << 8) | data[13]) != ETYPE_IP)
+		return false;
+
+	uint8_t *ip_hdr = data + ETH_HEADER_SIZE;
+	size_t start = ETH_HEADER_SIZE + (ip_hdr[0] & 0x0f) * 4;
+	size_t offset;
+
+	/* Protocol field */
+	switch (ip_hdr[9]) {
+	case IP_PROTO_TCP:
+		offset = 16;
+		break;
+	case IP_PROTO_UDP:
+		offset = 6;
+		break;
+	default:
+		return false;
+	}
+
+	if (start + offset + sizeof(uint16_t) > size)
+		return false;
+
+	*csum_start = start;
+	*csum_offset = offset;
+	return true;
+}
+
+static void virtio_net_send_flags(nic_t *nic, void *data, size_t size,
+    uint32_t flags)
 {
 	virtio_net_t *virtio_net = nic_get_specific(nic);
 	virtio_dev_t *vdev = &virtio_net->virtio_dev;
+	uint16_t csum_start;
+	uint16_t csum_offset;
 
-	if (size > sizeof(virtio_net) + TX_BUF_SIZE) {
+	if (sizeof(virtio_net_hdr_t) + size > TX_BUF_SIZE) {
 		ddf_msg(LVL_WARN, "TX data too big, frame dropped");
 		return;
 	}
 
 	uint16_t descno = virtio_alloc_desc(vdev, TX_QUEUE_1,
 	    &virtio_net->tx_free_head);
+	if (descno == (uint16_t) -1U) {
+		virtio_net_reclaim(virtio_net);
+		descno = virtio_alloc_desc(vdev, TX_QUEUE_1,
+		    &virtio_net->tx_free_head);
+	}
 	if (descno == (uint16_t) -1U) {
 		ddf_msg(LVL_WARN, "No TX buffers available, frame dropped");
 		return;
@@ -346,6 +495,15 @@ static void virtio_net_send(nic_t *nic, void *data, size_t size)
 	memset(hdr, 0, sizeof(virtio_net_hdr_t));
 	hdr->gso_type = VIRTIO_NET_HDR_GSO_NONE;
 
+	/* Let the device complete TCP/UDP checksum */
+	if ((flags & NIC_FRAME_CSUM_PARTIAL) != 0 &&
+	    (virtio_net->offload & NIC_OFFLOAD_TX_CSUM4) != 0 &&
+	    virtio_net_csum_location(data, size, &csum_start, &csum_offset)) {
+		hdr->flags = VIRTIO_NET_HDR_F_NEEDS_CSUM;
+		hdr->csum_start = host2uint16_t_le(csum_start);
+		hdr->csum_offset = host2uint16_t_le(csum_offset);
+	}
+
 	/* Copy packet data into the buffer just past the header */
 	memcpy(&hdr[1], data, size);
 
@@ -357,6 +515,11 @@ static void virtio_net_send(nic_t *nic, void *data, size_t size)
 	virtio_virtq_produce_available(vdev, TX_QUEUE_1, descno);
 }
 
+static void virtio_net_send(nic_t *nic, void *data, size_t size)
+{
+	virtio_net_send_flags(nic, data, size, 0);
+}
+
 
 static errno_t virtio_net_on_multicast_mode_change(nic_t *nic,
     nic_multicast_mode_t new_mode, const nic_address_t *address_list,
@@ -410,9 +573,12 @@ static errno_t virtio_net_dev_add(ddf_dev_t *dev)
 	ddf_fun_set_ops(fun, &virtio_net_dev_ops);
 
 	nic_set_send_frame_handler(nic, virtio_net_send);
+	nic_set_send_frame_flags_handler(nic, virtio_net_send_flags);
 	nic_set_filtering_change_handlers(nic, NULL,
 	    virtio_net_on_multicast_mode_change,
 	    virtio_net_on_broadcast_mode_change, NULL, NULL);
+	nic_set_poll_handlers(nic, virtio_net_poll_mode_change,
+	    virtio_net_poll);
 
 	rc = ddf_fun_bind(fun);
 	if (rc != EOK) {
@@ -469,10 +635,45 @@ static errno_t virtio_net_get_operation_mode(ddf_fun_t *fun, int *speed,
 	return EOK;
 }
 
+/** Offload options supported by the device. */
+static uint32_t virtio_net_offload_supported(virtio_net_t *virtio_net)
+{
+	if ((virtio_net->virtio_dev.features & VIRTIO_NET_F_CSUM) != 0)
+		return NIC_OFFLOAD_TX_CSUM4;
+
+	return 0;
+}
+
+static errno_t virtio_net_offload_probe(ddf_fun_t *fun, uint32_t *supported,
+    uint32_t *active)
+{
+	nic_t *nic = nic_get_from_ddf_fun(fun);
+	virtio_net_t *virtio_net = nic_get_specific(nic);
+
+	*supported = virtio_net_offload_supported(virtio_net);
+	*active = virtio_net->offload;
+	return EOK;
+}
+
+static errno_t virtio_net_offload_set(ddf_fun_t *fun, uint32_t mask,
+    uint32_t active)
+{
+	nic_t *nic = nic_get_from_ddf_fun(fun);
+	virtio_net_t *virtio_net = nic_get_specific(nic);
+
+	if ((active & mask & ~virtio_net_offload_supported(virtio_net)) != 0)
+		return ENOTSUP;
+
+	virtio_net->offload = (virtio_net->offload & ~mask) | (active & mask);
+	return EOK;
+}
+
 static nic_iface_t virtio_net_nic_iface = {
 	.get_device_info = virtio_net_get_device_info,
 	.get_cable_state = virtio_net_get_cable_state,
 	.get_operation_mode = virtio_net_get_operation_mode,
+	.offload_probe = virtio_net_offload_probe,
+	.offload_set = virtio_net_offload_set,
 };
 
 int main(void)
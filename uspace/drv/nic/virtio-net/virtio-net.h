@@ -33,8 +33,8 @@
 #include <abi/cap.h>
 #include <nic/nic.h>
 
-#define RX_BUFFERS	8
-#define TX_BUFFERS	8
+#define RX_BUFFERS	64
+#define TX_BUFFERS	64
 #define CT_BUFFERS	4
 
 /** Device handles packets with partial checksum. */
@@ -46,6 +46,9 @@
 /** Control channel is available */
 #define VIRTIO_NET_F_CTRL_VQ		(1U << 17)
 
+/** Checksum is to be computed from csum_start and stored at csum_offset */
+#define VIRTIO_NET_HDR_F_NEEDS_CSUM	1
+
 #define VIRTIO_NET_HDR_GSO_NONE 0
 typedef struct {
 	uint8_t flags;
@@ -77,8 +80,14 @@ typedef struct {
 	uint16_t tx_free_head;
 	uint16_t ct_free_head;
 
+	/** Active offload options (NIC_OFFLOAD_xxx) */
+	uint32_t offload;
+
 	int irq;
 	cap_irq_handle_t irq_handle;
+
+	/** Interrupts are used to signal received frames */
+	bool rx_irq;
 } virtio_net_t;
 
 #endif
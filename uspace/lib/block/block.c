@@ -42,10 +42,11 @@
 #include <async.h>
 #include <as.h>
 #include <assert.h>
+#include <atomic.h>
 #include <bd.h>
 #include <fibril_synch.h>
 #include <adt/list.h>
-#include <adt/hash_table.h>
+#include <adt/oa_table.h>
 #include <macros.h>
 #include <mem.h>
 #include <stdlib.h>
@@ -54,25 +55,76 @@
 #include <str_error.h>
 #include <offset.h>
 #include <inttypes.h>
+#include <mem_pressure.h>
 #include "block.h"
 
 #define MAX_WRITE_RETRIES 10
 
+/** Number of blocks read ahead when a sequential pattern is detected. */
+#define READ_AHEAD_MIN	4
+/** Maximum number of blocks read ahead. */
+#define READ_AHEAD_MAX	32
+
+/** Period of the write-behind flusher in microseconds. */
+#define FLUSH_PERIOD	1000000
+/** Maximum number of dirty blocks written back in one flusher pass. */
+#define FLUSH_MAX	64
+
+/** Number of independently locked shards of a block cache. */
+#define CACHE_SHARDS	8
+/** Number of consecutive blocks mapped to the same shard. */
+#define CACHE_SHARD_SPAN	64
+
 /** Lock protecting the device connection list */
 static FIBRIL_MUTEX_INITIALIZE(dcl_lock);
 /** Device connection list head. */
 static LIST_INITIALIZE(dcl);
 
+/** Memory pressure hook shrinking all block caches. */
+static mem_pressure_hook_t cache_pressure_hook;
+/** The memory pressure hook is registered (protected by dcl_lock). */
+static bool cache_pressure_hooked = false;
+/**
+ * Last known memory pressure level. Until the hook is registered,
+ * caches stay small as if there was memory pressure.
+ */
+static mem_pressure_t cache_pressure = MEM_PRESSURE_LOW;
+
 
+/** Shard of a block cache.
+ *
+ * Each shard caches a disjoint set of blocks and has its own lock, hash
+ * table and LRU list of unreferenced blocks.
+ */
 typedef struct {
 	fibril_mutex_t lock;
+	oa_table_t block_hash;
+	list_t free_list;
+	uint64_t hits;            /**< Lookups satisfied from the shard. */
+	uint64_t misses;          /**< Lookups which instantiated a block. */
+	uint64_t evictions;       /**< Blocks recycled or freed. */
+} cache_shard_t;
+
+typedef struct {
 	size_t lblock_size;       /**< Logical block size. */
 	unsigned blocks_cluster;  /**< Physical blocks per block_t */
 	unsigned block_count;     /**< Total number of blocks. */
-	unsigned blocks_cached;   /**< Number of cached blocks. */
-	hash_table_t block_hash;
-	list_t free_list;
+	atomic_t blocks_cached;   /**< Number of cached blocks. */
 	enum cache_mode mode;
+	cache_shard_t shards[CACHE_SHARDS];
+	/** Protects the sequential access detection and the flusher state. */
+	fibril_mutex_t lock;
+	aoff64_t seq_next;        /**< Next block of a sequential read. */
+	unsigned ra_window;       /**< Number of blocks to read ahead. */
+	unsigned ra_min;          /**< Initial read-ahead window. */
+	fibril_condvar_t flush_cv; /**< Wakes up the write-behind flusher. */
+	bool flush_running;       /**< Write-behind flusher is running. */
+	bool flush_stop;          /**< Write-behind flusher should exit. */
+	fibril_condvar_t sync_cv; /**< Signals completion of a cache sync. */
+	bool sync_running;        /**< A cache sync is in progress. */
+	unsigned sync_started;    /**< Generation of the last started sync. */
+	unsigned sync_done;       /**< Generation of the last finished sync. */
+	errno_t sync_rc;          /**< Result of the last finished sync. */
 } cache_t;
 
 typedef struct {
@@ -85,11 +137,32 @@ typedef struct {
 	aoff64_t pblocks;    /**< Number of physical blocks */
 	size_t pblock_size;  /**< Physical block size. */
 	cache_t *cache;
+	/** Protects the pending discards. */
+	fibril_mutex_t discard_lock;
+	/** Discards not yet sent to the device. */
+	bd_extent_t discard[BD_EXTENTS_MAX];
+	/** Number of pending discards. */
+	size_t discard_cnt;
+	/** The device does not support discarding blocks. */
+	bool discard_unsup;
 } devcon_t;
 
 static errno_t read_blocks(devcon_t *, aoff64_t, size_t, void *, size_t);
 static errno_t write_blocks(devcon_t *, aoff64_t, size_t, void *, size_t);
+static errno_t read_blocks_v(devcon_t *, bd_extent_t *, size_t, void *,
+    size_t);
+static errno_t write_blocks_v(devcon_t *, bd_extent_t *, size_t, void *,
+    size_t);
+static errno_t discard_flush(devcon_t *);
 static aoff64_t ba_ltop(devcon_t *, aoff64_t);
+static errno_t block_flusher(void *);
+static void cache_pressure_notify(mem_pressure_t, void *);
+
+/** Get the cache shard holding a logical block. */
+static cache_shard_t *cache_shard(cache_t *cache, aoff64_t lba)
+{
+	return &cache->shards[(lba / CACHE_SHARD_SPAN) % CACHE_SHARDS];
+}
 
 static devcon_t *devcon_search(service_id_t service_id)
 {
@@ -124,6 +197,9 @@ static errno_t devcon_add(service_id_t service_id, async_sess_t *sess,
 	devcon->pblock_size = bsize;
 	devcon->pblocks = dev_size;
 	devcon->cache = NULL;
+	fibril_mutex_initialize(&devcon->discard_lock);
+	devcon->discard_cnt = 0;
+	devcon->discard_unsup = false;
 
 	fibril_mutex_lock(&dcl_lock);
 	list_foreach(dcl, link, devcon_t, d) {
@@ -195,6 +271,10 @@ void block_fini(service_id_t service_id)
 	if (devcon->cache)
 		(void) block_cache_fini(service_id);
 
+	fibril_mutex_lock(&devcon->discard_lock);
+	(void) discard_flush(devcon);
+	fibril_mutex_unlock(&devcon->discard_lock);
+
 	(void)bd_sync_cache(devcon->bd, 0, 0);
 
 	devcon_remove(devcon);
@@ -241,27 +321,27 @@ void *block_bb_get(service_id_t service_id)
 	return devcon->bb_buf;
 }
 
-static size_t cache_key_hash(void *key)
+static size_t cache_key_hash(const void *key)
 {
-	aoff64_t *lba = (aoff64_t *)key;
+	const aoff64_t *lba = (const aoff64_t *)key;
 	return *lba;
 }
 
-static size_t cache_hash(const ht_link_t *item)
+static size_t cache_hash(const void *item)
 {
-	block_t *b = hash_table_get_inst(item, block_t, hash_link);
+	const block_t *b = (const block_t *)item;
 	return b->lba;
 }
 
-static bool cache_key_equal(void *key, const ht_link_t *item)
+static bool cache_key_equal(const void *key, const void *item)
 {
-	aoff64_t *lba = (aoff64_t *)key;
-	block_t *b = hash_table_get_inst(item, block_t, hash_link);
+	const aoff64_t *lba = (const aoff64_t *)key;
+	const block_t *b = (const block_t *)item;
 	return b->lba == *lba;
 }
 
 
-static hash_table_ops_t cache_ops = {
+static oa_table_ops_t cache_ops = {
 	.hash = cache_hash,
 	.key_hash = cache_key_hash,
 	.key_equal = cache_key_equal,
@@ -269,6 +349,24 @@ static hash_table_ops_t cache_ops = {
 	.remove_callback = NULL
 };
 
+/** Insert a block into the hash table of its shard.
+ *
+ * Should the hash table fail to grow, the block is freed.
+ *
+ * Should be called only with the shard lock held.
+ */
+static errno_t cache_insert(cache_t *cache, cache_shard_t *shard, block_t *b)
+{
+	errno_t rc = oa_table_insert(&shard->block_hash, b);
+	if (rc != EOK) {
+		free(b->data);
+		free(b);
+		atomic_dec(&cache->blocks_cached);
+	}
+
+	return rc;
+}
+
 errno_t block_cache_init(service_id_t service_id, size_t size, unsigned blocks,
     enum cache_mode mode)
 {
@@ -283,11 +381,21 @@ errno_t block_cache_init(service_id_t service_id, size_t size, unsigned blocks,
 		return ENOMEM;
 
 	fibril_mutex_initialize(&cache->lock);
-	list_initialize(&cache->free_list);
 	cache->lblock_size = size;
 	cache->block_count = blocks;
-	cache->blocks_cached = 0;
+	atomic_set(&cache->blocks_cached, 0);
 	cache->mode = mode;
+	cache->seq_next = 0;
+	cache->ra_window = 0;
+	cache->ra_min = READ_AHEAD_MIN;
+	fibril_condvar_initialize(&cache->flush_cv);
+	cache->flush_running = false;
+	cache->flush_stop = false;
+	fibril_condvar_initialize(&cache->sync_cv);
+	cache->sync_running = false;
+	cache->sync_started = 0;
+	cache->sync_done = 0;
+	cache->sync_rc = EOK;
 
 	/* Allow 1:1 or small-to-large block size translation */
 	if (cache->lblock_size % devcon->pblock_size != 0) {
@@ -297,12 +405,47 @@ errno_t block_cache_init(service_id_t service_id, size_t size, unsigned blocks,
 
 	cache->blocks_cluster = cache->lblock_size / devcon->pblock_size;
 
-	if (!hash_table_create(&cache->block_hash, 0, 0, &cache_ops)) {
-		free(cache);
-		return ENOMEM;
+	for (unsigned i = 0; i < CACHE_SHARDS; i++) {
+		cache_shard_t *shard = &cache->shards[i];
+
+		fibril_mutex_initialize(&shard->lock);
+		list_initialize(&shard->free_list);
+		shard->hits = 0;
+		shard->misses = 0;
+		shard->evictions = 0;
+
+		if (!oa_table_create(&shard->block_hash, 0, &cache_ops)) {
+			while (i-- > 0)
+				oa_table_destroy(&cache->shards[i].block_hash);
+			free(cache);
+			return ENOMEM;
+		}
 	}
 
+	fibril_mutex_lock(&dcl_lock);
 	devcon->cache = cache;
+	if (!cache_pressure_hooked) {
+		/* Without the hook, the caches just do not grow beyond need. */
+		if (mem_pressure_hook_add(&cache_pressure_hook,
+		    cache_pressure_notify, NULL) == EOK) {
+			cache_pressure_hooked = true;
+			cache_pressure = mem_pressure_level();
+		}
+	}
+	fibril_mutex_unlock(&dcl_lock);
+
+	if (mode == CACHE_MODE_WB) {
+		/*
+		 * Without the flusher, dirty blocks are only written back
+		 * when recycled, so failing to start it is not fatal.
+		 */
+		fid_t fid = fibril_create(block_flusher, devcon);
+		if (fid != 0) {
+			cache->flush_running = true;
+			fibril_add_ready(fid);
+		}
+	}
+
 	return EOK;
 }
 
@@ -318,31 +461,52 @@ errno_t block_cache_fini(service_id_t service_id)
 		return EOK;
 	cache = devcon->cache;
 
+	/* Stop the write-behind flusher. */
+	fibril_mutex_lock(&cache->lock);
+	cache->flush_stop = true;
+	fibril_condvar_broadcast(&cache->flush_cv);
+	while (cache->flush_running)
+		fibril_condvar_wait(&cache->flush_cv, &cache->lock);
+	fibril_mutex_unlock(&cache->lock);
+
+	/* Hide the cache from the memory pressure hook. */
+	fibril_mutex_lock(&dcl_lock);
+	devcon->cache = NULL;
+	fibril_mutex_unlock(&dcl_lock);
+
 	/*
 	 * We are expecting to find all blocks for this device handle on the
 	 * free list, i.e. the block reference count should be zero. Do not
 	 * bother with the cache and block locks because we are single-threaded.
 	 */
-	while (!list_empty(&cache->free_list)) {
-		block_t *b = list_get_instance(list_first(&cache->free_list),
-		    block_t, free_link);
-
-		list_remove(&b->free_link);
-		if (b->dirty) {
-			rc = write_blocks(devcon, b->pba, cache->blocks_cluster,
-			    b->data, b->size);
-			if (rc != EOK)
-				return rc;
-		}
+	for (unsigned i = 0; i < CACHE_SHARDS; i++) {
+		cache_shard_t *shard = &cache->shards[i];
 
-		hash_table_remove_item(&cache->block_hash, &b->hash_link);
+		while (!list_empty(&shard->free_list)) {
+			block_t *b = list_get_instance(
+			    list_first(&shard->free_list), block_t, free_link);
 
-		free(b->data);
-		free(b);
+			list_remove(&b->free_link);
+			if (b->dirty) {
+				rc = write_blocks(devcon, b->pba,
+				    cache->blocks_cluster, b->data, b->size);
+				if (rc != EOK) {
+					fibril_mutex_lock(&dcl_lock);
+					devcon->cache = cache;
+					fibril_mutex_unlock(&dcl_lock);
+					return rc;
+				}
+			}
+
+			oa_table_remove_item(&shard->block_hash, b);
+
+			free(b->data);
+			free(b);
+		}
 	}
 
-	hash_table_destroy(&cache->block_hash);
-	devcon->cache = NULL;
+	for (unsigned i = 0; i < CACHE_SHARDS; i++)
+		oa_table_destroy(&cache->shards[i].block_hash);
 	free(cache);
 
 	return EOK;
@@ -350,15 +514,114 @@ errno_t block_cache_fini(service_id_t service_id)
 
 #define CACHE_LO_WATERMARK	10
 #define CACHE_HI_WATERMARK	20
-static bool cache_can_grow(cache_t *cache)
+/** Number of blocks a cache may grow to while there is no memory pressure. */
+#define CACHE_GROW_WATERMARK	1024
+
+/** Number of cached blocks above which unreferenced blocks are freed. */
+static unsigned cache_hi_watermark(void)
+{
+	switch (cache_pressure) {
+	case MEM_PRESSURE_NONE:
+		return CACHE_GROW_WATERMARK;
+	case MEM_PRESSURE_LOW:
+		return CACHE_HI_WATERMARK;
+	default:
+		return CACHE_LO_WATERMARK;
+	}
+}
+
+static bool cache_can_grow(cache_t *cache, cache_shard_t *shard)
 {
-	if (cache->blocks_cached < CACHE_LO_WATERMARK)
+	unsigned blocks_cached = atomic_get(&cache->blocks_cached);
+
+	if (blocks_cached < CACHE_LO_WATERMARK)
+		return true;
+	/* Grow opportunistically while memory is plentiful. */
+	if ((cache_pressure == MEM_PRESSURE_NONE) &&
+	    (blocks_cached < CACHE_GROW_WATERMARK))
 		return true;
-	if (!list_empty(&cache->free_list))
+	if (!list_empty(&shard->free_list))
 		return false;
 	return true;
 }
 
+/** Free unreferenced clean blocks of a cache
+ *
+ * Blocks are freed in the LRU order of each shard until the cache holds
+ * at most @a target blocks. Dirty blocks are left for the write-behind
+ * flusher, which is woken up to write them back.
+ *
+ * @param cache		Cache to shrink.
+ * @param target	Number of blocks to shrink the cache to.
+ */
+static void cache_shrink(cache_t *cache, unsigned target)
+{
+	bool dirty = false;
+
+	for (unsigned i = 0; i < CACHE_SHARDS; i++) {
+		cache_shard_t *shard = &cache->shards[i];
+
+		fibril_mutex_lock(&shard->lock);
+
+		link_t *link = list_first(&shard->free_list);
+		while ((link != NULL) &&
+		    (atomic_get(&cache->blocks_cached) > target)) {
+			block_t *b = list_get_instance(link, block_t,
+			    free_link);
+			link = list_next(link, &shard->free_list);
+
+			/* Blocks being recycled are locked, skip them. */
+			if (!fibril_mutex_trylock(&b->lock))
+				continue;
+
+			if (b->dirty || (b->refcnt > 0)) {
+				dirty = dirty || b->dirty;
+				fibril_mutex_unlock(&b->lock);
+				continue;
+			}
+
+			list_remove(&b->free_link);
+			oa_table_remove_item(&shard->block_hash, b);
+			fibril_mutex_unlock(&b->lock);
+			free(b->data);
+			free(b);
+			atomic_dec(&cache->blocks_cached);
+			shard->evictions++;
+		}
+
+		fibril_mutex_unlock(&shard->lock);
+	}
+
+	if (dirty && (cache->mode == CACHE_MODE_WB)) {
+		fibril_mutex_lock(&cache->lock);
+		fibril_condvar_broadcast(&cache->flush_cv);
+		fibril_mutex_unlock(&cache->lock);
+	}
+}
+
+/** Memory pressure hook
+ *
+ * Adjust the cache size limits and shrink all caches when memory
+ * is getting short.
+ */
+static void cache_pressure_notify(mem_pressure_t level, void *arg)
+{
+	cache_pressure = level;
+	if (level == MEM_PRESSURE_NONE)
+		return;
+
+	unsigned target = cache_hi_watermark();
+
+	fibril_mutex_lock(&dcl_lock);
+
+	list_foreach(dcl, link, devcon_t, devcon) {
+		if (devcon->cache != NULL)
+			cache_shrink(devcon->cache, target);
+	}
+
+	fibril_mutex_unlock(&dcl_lock);
+}
+
 static void block_initialize(block_t *b)
 {
 	fibril_mutex_initialize(&b->lock);
@@ -370,25 +633,261 @@ static void block_initialize(block_t *b)
 	link_initialize(&b->free_link);
 }
 
+/** Update the sequential access detection with a block being read.
+ *
+ * Each read of the block immediately following the previous one doubles
+ * the read-ahead window, any other read except for a repeated read of
+ * the same block closes it.
+ *
+ * Should be called only with the cache lock held.
+ *
+ * @param cache		Block cache.
+ * @param ba		Logical address of the block being read.
+ *
+ * @return		Number of blocks to read ahead on a miss.
+ */
+static unsigned cache_seq_update(cache_t *cache, aoff64_t ba)
+{
+	if ((cache->seq_next > 0) && (ba == cache->seq_next - 1))
+		return cache->ra_window;
+
+	if (ba == cache->seq_next) {
+		if (cache->ra_window == 0)
+			cache->ra_window = cache->ra_min;
+		else
+			cache->ra_window = min(2 * cache->ra_window,
+			    READ_AHEAD_MAX);
+	} else {
+		cache->ra_window = 0;
+	}
+
+	cache->seq_next = ba + 1;
+	return cache->ra_window;
+}
+
+/** Get a block structure to be filled by read-ahead.
+ *
+ * Unlike block_get(), never writes back a dirty block to make room for
+ * speculatively read data.
+ *
+ * Should be called only with the shard lock held.
+ *
+ * @return		Unlinked block structure or NULL.
+ */
+static block_t *cache_ra_block(cache_t *cache, cache_shard_t *shard)
+{
+	block_t *b;
+
+	if (cache_can_grow(cache, shard)) {
+		b = malloc(sizeof(block_t));
+		if (b != NULL) {
+			b->data = malloc(cache->lblock_size);
+			if (b->data != NULL) {
+				atomic_inc(&cache->blocks_cached);
+				return b;
+			}
+
+			free(b);
+		}
+	}
+
+	if (list_empty(&shard->free_list))
+		return NULL;
+
+	b = list_get_instance(list_first(&shard->free_list), block_t,
+	    free_link);
+	if (b->dirty)
+		return NULL;
+
+	list_remove(&b->free_link);
+	oa_table_remove_item(&shard->block_hash, b);
+	shard->evictions++;
+	return b;
+}
+
+/** Instantiate blocks following a missed block for read-ahead.
+ *
+ * The blocks are instantiated with a reference and locked, so that
+ * concurrent block_get() calls wait until they are read. Blocks which are
+ * already cached are skipped. Stops at the first block which belongs to
+ * another shard or lies beyond the end of the device, or after looking
+ * at @a window blocks.
+ *
+ * Should be called only with the shard lock held.
+ *
+ * @param devcon	Device connection.
+ * @param shard		Shard of the missed block.
+ * @param ba		Logical address of the missed block.
+ * @param window	Maximum number of blocks to read ahead.
+ * @param ra		Array for storing the instantiated blocks.
+ *
+ * @return		Number of instantiated blocks.
+ */
+static size_t cache_ra_prepare(devcon_t *devcon, cache_shard_t *shard,
+    aoff64_t ba, unsigned window, block_t **ra)
+{
+	cache_t *cache = devcon->cache;
+	size_t count = 0;
+
+	/* Keep the whole transfer within the IPC data transfer limit. */
+	window = min(window, DATA_XFER_LIMIT / cache->lblock_size - 1);
+
+	for (aoff64_t lba = ba + 1; lba <= ba + window; lba++) {
+		if (ba_ltop(devcon, lba) + cache->blocks_cluster >
+		    devcon->pblocks)
+			break;
+
+		if (cache_shard(cache, lba) != shard)
+			break;
+
+		if (oa_table_find(&shard->block_hash, &lba) != NULL)
+			continue;
+
+		block_t *b = cache_ra_block(cache, shard);
+		if (b == NULL)
+			break;
+
+		block_initialize(b);
+		b->service_id = devcon->service_id;
+		b->size = cache->lblock_size;
+		b->lba = lba;
+		b->pba = ba_ltop(devcon, lba);
+		if (cache_insert(cache, shard, b) != EOK)
+			break;
+
+		fibril_mutex_lock(&b->lock);
+		ra[count++] = b;
+	}
+
+	return count;
+}
+
+/** Append a cache block to the extents of a vectored transfer.
+ *
+ * The block data is stored right after the data of the previous extents
+ * in the transfer buffer. The block is merged into the last extent if it
+ * follows it on the device.
+ *
+ * @param cache		Block cache.
+ * @param ext		Array of extents.
+ * @param ext_cnt	Number of extents, updated.
+ * @param b		Block to append.
+ */
+static void cache_extent_add(cache_t *cache, bd_extent_t *ext,
+    size_t *ext_cnt, block_t *b)
+{
+	bd_extent_t *last;
+	size_t offset = 0;
+
+	if (*ext_cnt > 0) {
+		last = &ext[*ext_cnt - 1];
+		if (last->ba + last->cnt == b->pba) {
+			last->cnt += cache->blocks_cluster;
+			return;
+		}
+
+		offset = last->offset +
+		    last->cnt / cache->blocks_cluster * cache->lblock_size;
+	}
+
+	ext[*ext_cnt].ba = b->pba;
+	ext[*ext_cnt].cnt = cache->blocks_cluster;
+	ext[*ext_cnt].offset = offset;
+	(*ext_cnt)++;
+}
+
+/** Read a missed block together with the blocks read ahead.
+ *
+ * All blocks are locked by the caller. The read-ahead blocks are unlocked
+ * and their reference is dropped. Blocks which are not adjacent on the
+ * device are fetched in a single vectored request. Should the combined
+ * read fail, the blocks are read one by one.
+ *
+ * @param devcon	Device connection.
+ * @param b		Missed block.
+ * @param ra		Blocks instantiated by cache_ra_prepare().
+ * @param count		Number of read-ahead blocks.
+ *
+ * @return		EOK on success or an error code from reading the
+ *			missed block.
+ */
+static errno_t cache_ra_read(devcon_t *devcon, block_t *b, block_t **ra,
+    size_t count)
+{
+	cache_t *cache = devcon->cache;
+	size_t size = (count + 1) * cache->lblock_size;
+	errno_t rc = ENOMEM;
+	size_t i;
+
+	bd_extent_t ext[READ_AHEAD_MAX + 1];
+	size_t ext_cnt = 0;
+
+	cache_extent_add(cache, ext, &ext_cnt, b);
+	for (i = 0; i < count; i++)
+		cache_extent_add(cache, ext, &ext_cnt, ra[i]);
+
+	void *buf = malloc(size);
+	if (buf != NULL) {
+		if (ext_cnt == 1) {
+			rc = read_blocks(devcon, b->pba,
+			    (count + 1) * cache->blocks_cluster, buf, size);
+		} else {
+			rc = read_blocks_v(devcon, ext, ext_cnt, buf, size);
+		}
+	}
+
+	if (rc == EOK) {
+		memcpy(b->data, buf, cache->lblock_size);
+		for (i = 0; i < count; i++) {
+			memcpy(ra[i]->data, buf + (i + 1) * cache->lblock_size,
+			    cache->lblock_size);
+		}
+	} else {
+		rc = read_blocks(devcon, b->pba, cache->blocks_cluster,
+		    b->data, cache->lblock_size);
+		for (i = 0; i < count; i++) {
+			if (read_blocks(devcon, ra[i]->pba,
+			    cache->blocks_cluster, ra[i]->data,
+			    cache->lblock_size) != EOK)
+				ra[i]->toxic = true;
+		}
+	}
+
+	free(buf);
+
+	for (i = 0; i < count; i++)
+		fibril_mutex_unlock(&ra[i]->lock);
+	for (i = 0; i < count; i++)
+		(void) block_put(ra[i]);
+
+	return rc;
+}
+
 /** Instantiate a block in memory and get a reference to it.
  *
  * @param block			Pointer to where the function will store the
  * 				block pointer on success.
  * @param service_id		Service ID of the block device.
  * @param ba			Block address (logical).
- * @param flags			If BLOCK_FLAGS_NOREAD is specified, block_get()
- * 				will not read the contents of the block from the
- *				device.
+ * @param flags			If BLOCK_FLAGS_NOREAD is specified, the contents
+ *				of the block are not read from the device.
+ * @param prefetch		Number of blocks to read ahead on a miss, zero
+ *				to leave it to the sequential access detection.
  *
  * @return			EOK on success or an error code.
  */
-errno_t block_get(block_t **block, service_id_t service_id, aoff64_t ba, int flags)
+static errno_t cache_get(block_t **block, service_id_t service_id,
+    aoff64_t ba, int flags, unsigned prefetch)
 {
 	devcon_t *devcon;
 	cache_t *cache;
+	cache_shard_t *shard;
 	block_t *b;
 	link_t *link;
 	aoff64_t p_ba;
+	unsigned ra_window;
+	block_t *ra[READ_AHEAD_MAX];
+	size_t ra_count;
 	errno_t rc;
 
 	devcon = devcon_search(service_id);
@@ -409,31 +908,45 @@ errno_t block_get(block_t **block, service_id_t service_id, aoff64_t ba, int fla
 		return EIO;
 	}
 
+	shard = cache_shard(cache, ba);
+
+	/*
+	 * The access detection is a mere heuristic, do not let it serialize
+	 * concurrent requests.
+	 */
+	ra_window = 0;
+	if (prefetch > 0) {
+		ra_window = min(prefetch, READ_AHEAD_MAX);
+	} else if (!(flags & BLOCK_FLAGS_NOREAD) &&
+	    fibril_mutex_trylock(&cache->lock)) {
+		ra_window = cache_seq_update(cache, ba);
+		fibril_mutex_unlock(&cache->lock);
+	}
 
 retry:
 	rc = EOK;
 	b = NULL;
 
-	fibril_mutex_lock(&cache->lock);
-	ht_link_t *hlink = hash_table_find(&cache->block_hash, &ba);
-	if (hlink) {
+	fibril_mutex_lock(&shard->lock);
+	b = oa_table_find(&shard->block_hash, &ba);
+	if (b) {
 	found:
 		/*
 		 * We found the block in the cache.
 		 */
-		b = hash_table_get_inst(hlink, block_t, hash_link);
 		fibril_mutex_lock(&b->lock);
 		if (b->refcnt++ == 0)
 			list_remove(&b->free_link);
 		if (b->toxic)
 			rc = EIO;
 		fibril_mutex_unlock(&b->lock);
-		fibril_mutex_unlock(&cache->lock);
+		shard->hits++;
+		fibril_mutex_unlock(&shard->lock);
 	} else {
 		/*
 		 * The block was not found in the cache.
 		 */
-		if (cache_can_grow(cache)) {
+		if (cache_can_grow(cache, shard)) {
 			/*
 			 * We can grow the cache by allocating new blocks.
 			 * Should the allocation fail, we fail over and try to
@@ -448,18 +961,18 @@ retry:
 				b = NULL;
 				goto recycle;
 			}
-			cache->blocks_cached++;
+			atomic_inc(&cache->blocks_cached);
 		} else {
 			/*
 			 * Try to recycle a block from the free list.
 			 */
 		recycle:
-			if (list_empty(&cache->free_list)) {
-				fibril_mutex_unlock(&cache->lock);
+			if (list_empty(&shard->free_list)) {
+				fibril_mutex_unlock(&shard->lock);
 				rc = ENOMEM;
 				goto out;
 			}
-			link = list_first(&cache->free_list);
+			link = list_first(&shard->free_list);
 			b = list_get_instance(link, block_t, free_link);
 
 			fibril_mutex_lock(&b->lock);
@@ -467,15 +980,15 @@ retry:
 				/*
 				 * The block needs to be written back to the
 				 * device before it changes identity. Do this
-				 * while not holding the cache lock so that
+				 * while not holding the shard lock so that
 				 * concurrency is not impeded. Also move the
 				 * block to the end of the free list so that we
 				 * do not slow down other instances of
 				 * block_get() draining the free list.
 				 */
 				list_remove(&b->free_link);
-				list_append(&b->free_link, &cache->free_list);
-				fibril_mutex_unlock(&cache->lock);
+				list_append(&b->free_link, &shard->free_list);
+				fibril_mutex_unlock(&shard->lock);
 				rc = write_blocks(devcon, b->pba,
 				    cache->blocks_cluster, b->data, b->size);
 				if (rc != EOK) {
@@ -499,7 +1012,7 @@ retry:
 					b->write_failures = 0;
 
 				b->dirty = false;
-				if (!fibril_mutex_trylock(&cache->lock)) {
+				if (!fibril_mutex_trylock(&shard->lock)) {
 					/*
 					 * Somebody is probably racing with us.
 					 * Unlock the block and retry.
@@ -507,18 +1020,20 @@ retry:
 					fibril_mutex_unlock(&b->lock);
 					goto retry;
 				}
-				hlink = hash_table_find(&cache->block_hash, &ba);
-				if (hlink) {
+				block_t *other = oa_table_find(&shard->block_hash,
+				    &ba);
+				if (other) {
 					/*
 					 * Someone else must have already
 					 * instantiated the block while we were
-					 * not holding the cache lock.
+					 * not holding the shard lock.
 					 * Leave the recycled block on the
 					 * freelist and continue as if we
 					 * found the block of interest during
 					 * the first try.
 					 */
 					fibril_mutex_unlock(&b->lock);
+					b = other;
 					goto found;
 				}
 
@@ -530,7 +1045,8 @@ retry:
 			 * table.
 			 */
 			list_remove(&b->free_link);
-			hash_table_remove_item(&cache->block_hash, &b->hash_link);
+			oa_table_remove_item(&shard->block_hash, b);
+			shard->evictions++;
 		}
 
 		block_initialize(b);
@@ -538,23 +1054,41 @@ retry:
 		b->size = cache->lblock_size;
 		b->lba = ba;
 		b->pba = ba_ltop(devcon, b->lba);
-		hash_table_insert(&cache->block_hash, &b->hash_link);
+		rc = cache_insert(cache, shard, b);
+		if (rc != EOK) {
+			fibril_mutex_unlock(&shard->lock);
+			b = NULL;
+			goto out;
+		}
+		shard->misses++;
 
 		/*
-		 * Lock the block before releasing the cache lock. Thus we don't
+		 * Lock the block before releasing the shard lock. Thus we don't
 		 * kill concurrent operations on the cache while doing I/O on
 		 * the block.
 		 */
 		fibril_mutex_lock(&b->lock);
-		fibril_mutex_unlock(&cache->lock);
+
+		ra_count = 0;
+		if (ra_window > 0) {
+			ra_count = cache_ra_prepare(devcon, shard, ba,
+			    ra_window, ra);
+		}
+
+		fibril_mutex_unlock(&shard->lock);
 
 		if (!(flags & BLOCK_FLAGS_NOREAD)) {
 			/*
 			 * The block contains old or no data. We need to read
 			 * the new contents from the device.
 			 */
-			rc = read_blocks(devcon, b->pba, cache->blocks_cluster,
-			    b->data, cache->lblock_size);
+			if (ra_count > 0) {
+				rc = cache_ra_read(devcon, b, ra, ra_count);
+			} else {
+				rc = read_blocks(devcon, b->pba,
+				    cache->blocks_cluster, b->data,
+				    cache->lblock_size);
+			}
 			if (rc != EOK)
 				b->toxic = true;
 		} else
@@ -572,6 +1106,57 @@ out:
 	return rc;
 }
 
+/** Instantiate a block in memory and get a reference to it.
+ *
+ * @param block			Pointer to where the function will store the
+ * 				block pointer on success.
+ * @param service_id		Service ID of the block device.
+ * @param ba			Block address (logical).
+ * @param flags			If BLOCK_FLAGS_NOREAD is specified, block_get()
+ * 				will not read the contents of the block from the
+ *				device.
+ *
+ * @return			EOK on success or an error code.
+ */
+errno_t block_get(block_t **block, service_id_t service_id, aoff64_t ba, int flags)
+{
+	return cache_get(block, service_id, ba, flags, 0);
+}
+
+/** Bring a range of blocks into the block cache.
+ *
+ * Blocks which are not cached yet are read in as few transfers as the
+ * cache allows, so that metadata which is going to be needed soon can be
+ * loaded at once rather than one block at a time.
+ *
+ * @param service_id		Service ID of the block device.
+ * @param ba			Address of the first block (logical).
+ * @param cnt			Number of blocks.
+ *
+ * @return			EOK on success or an error code.
+ */
+errno_t block_prefetch(service_id_t service_id, aoff64_t ba, size_t cnt)
+{
+	block_t *b;
+	errno_t rc;
+
+	while (cnt > 0) {
+		rc = cache_get(&b, service_id, ba, BLOCK_FLAGS_NONE,
+		    min(cnt - 1, READ_AHEAD_MAX));
+		if (rc != EOK)
+			return rc;
+
+		rc = block_put(b);
+		if (rc != EOK)
+			return rc;
+
+		ba++;
+		cnt--;
+	}
+
+	return EOK;
+}
+
 /** Release a reference to a block.
  *
  * If the last reference is dropped, the block is put on the free list.
@@ -584,6 +1169,7 @@ errno_t block_put(block_t *block)
 {
 	devcon_t *devcon = devcon_search(block->service_id);
 	cache_t *cache;
+	cache_shard_t *shard;
 	unsigned blocks_cached;
 	enum cache_mode mode;
 	errno_t rc = EOK;
@@ -593,25 +1179,24 @@ errno_t block_put(block_t *block)
 	assert(block->refcnt >= 1);
 
 	cache = devcon->cache;
+	shard = cache_shard(cache, block->lba);
 
 retry:
-	fibril_mutex_lock(&cache->lock);
-	blocks_cached = cache->blocks_cached;
+	blocks_cached = atomic_get(&cache->blocks_cached);
 	mode = cache->mode;
-	fibril_mutex_unlock(&cache->lock);
 
 	/*
 	 * Determine whether to sync the block. Syncing the block is best done
-	 * when not holding the cache lock as it does not impede concurrency.
-	 * Since the situation may have changed when we unlocked the cache, the
+	 * when not holding the shard lock as it does not impede concurrency.
+	 * Since the situation may have changed in the meantime, the
 	 * blocks_cached and mode variables are mere hints. We will recheck the
-	 * conditions later when the cache lock is held again.
+	 * conditions later when the shard lock is held.
 	 */
 	fibril_mutex_lock(&block->lock);
 	if (block->toxic)
 		block->dirty = false;	/* will not write back toxic block */
 	if (block->dirty && (block->refcnt == 1) &&
-	    (blocks_cached > CACHE_HI_WATERMARK || mode != CACHE_MODE_WB)) {
+	    (blocks_cached > cache_hi_watermark() || mode != CACHE_MODE_WB)) {
 		rc = write_blocks(devcon, block->pba, cache->blocks_cluster,
 		    block->data, block->size);
 		if (rc == EOK)
@@ -620,7 +1205,7 @@ retry:
 	}
 	fibril_mutex_unlock(&block->lock);
 
-	fibril_mutex_lock(&cache->lock);
+	fibril_mutex_lock(&shard->lock);
 	fibril_mutex_lock(&block->lock);
 	if (!--block->refcnt) {
 		/*
@@ -628,7 +1213,7 @@ retry:
 		 * block or put it on the free list. In case of an I/O error,
 		 * free the block.
 		 */
-		if ((cache->blocks_cached > CACHE_HI_WATERMARK) ||
+		if ((atomic_get(&cache->blocks_cached) > cache_hi_watermark()) ||
 		    (rc != EOK)) {
 			/*
 			 * Currently there are too many cached blocks or there
@@ -638,14 +1223,14 @@ retry:
 			if (block->dirty) {
 				/*
 				 * We cannot sync the block while holding the
-				 * cache lock. Release everything and retry.
+				 * shard lock. Release everything and retry.
 				 */
 				block->refcnt++;
 
 				if (block->write_failures < MAX_WRITE_RETRIES) {
 					block->write_failures++;
 					fibril_mutex_unlock(&block->lock);
-					fibril_mutex_unlock(&cache->lock);
+					fibril_mutex_unlock(&shard->lock);
 					goto retry;
 				} else {
 					printf("Too many errors writing block %"
@@ -657,12 +1242,13 @@ retry:
 			/*
 			 * Take the block out of the cache and free it.
 			 */
-			hash_table_remove_item(&cache->block_hash, &block->hash_link);
+			oa_table_remove_item(&shard->block_hash, block);
 			fibril_mutex_unlock(&block->lock);
 			free(block->data);
 			free(block);
-			cache->blocks_cached--;
-			fibril_mutex_unlock(&cache->lock);
+			atomic_dec(&cache->blocks_cached);
+			shard->evictions++;
+			fibril_mutex_unlock(&shard->lock);
 			return rc;
 		}
 		/*
@@ -670,29 +1256,323 @@ retry:
 		 */
 		if (cache->mode != CACHE_MODE_WB && block->dirty) {
 			/*
-			 * We cannot sync the block while holding the cache
+			 * We cannot sync the block while holding the shard
 			 * lock. Release everything and retry.
 			 */
 			block->refcnt++;
 			fibril_mutex_unlock(&block->lock);
-			fibril_mutex_unlock(&cache->lock);
+			fibril_mutex_unlock(&shard->lock);
 			goto retry;
 		}
-		list_append(&block->free_link, &cache->free_list);
+		list_append(&block->free_link, &shard->free_list);
 	}
 	fibril_mutex_unlock(&block->lock);
-	fibril_mutex_unlock(&cache->lock);
+	fibril_mutex_unlock(&shard->lock);
 
 	return rc;
 }
 
-/** Read sequential data from a block device.
+static int block_pba_cmp(const void *a, const void *b)
+{
+	const block_t *ba = *(const block_t **) a;
+	const block_t *bb = *(const block_t **) b;
+
+	if (ba->pba < bb->pba)
+		return -1;
+	if (ba->pba > bb->pba)
+		return 1;
+	return 0;
+}
+
+/** Write back a batch of locked dirty blocks in one request.
  *
- * @param service_id	Service ID of the block device.
- * @param buf		Buffer for holding one block
- * @param bufpos	Pointer to the first unread valid offset within the
- * 			communication buffer.
- * @param buflen	Pointer to the number of unread bytes that are ready in
+ * @param devcon	Device connection.
+ * @param run		Blocks sorted by their physical addresses.
+ * @param count		Number of blocks in the batch.
+ * @param ext		Extents of the batch built by cache_extent_add().
+ * @param ext_cnt	Number of extents, at most BD_EXTENTS_MAX.
+ */
+static errno_t cache_flush_run(devcon_t *devcon, block_t **run, size_t count,
+    bd_extent_t *ext, size_t ext_cnt)
+{
+	cache_t *cache = devcon->cache;
+	size_t size = count * cache->lblock_size;
+	errno_t rc;
+	errno_t ret = EOK;
+	size_t i;
+
+	void *buf = (count > 1) ? malloc(size) : NULL;
+	if (buf != NULL) {
+		for (i = 0; i < count; i++) {
+			memcpy(buf + i * cache->lblock_size, run[i]->data,
+			    cache->lblock_size);
+		}
+
+		if (ext_cnt == 1) {
+			rc = write_blocks(devcon, run[0]->pba,
+			    count * cache->blocks_cluster, buf, size);
+		} else {
+			rc = write_blocks_v(devcon, ext, ext_cnt, buf, size);
+		}
+		free(buf);
+		ret = rc;
+
+		for (i = 0; i < count; i++) {
+			if (rc == EOK) {
+				run[i]->dirty = false;
+				run[i]->write_failures = 0;
+			} else {
+				run[i]->write_failures++;
+			}
+		}
+	} else {
+		for (i = 0; i < count; i++) {
+			rc = write_blocks(devcon, run[i]->pba,
+			    cache->blocks_cluster, run[i]->data, run[i]->size);
+			if (rc == EOK) {
+				run[i]->dirty = false;
+				run[i]->write_failures = 0;
+			} else {
+				run[i]->write_failures++;
+				ret = rc;
+			}
+		}
+	}
+
+	for (i = 0; i < count; i++)
+		fibril_mutex_unlock(&run[i]->lock);
+
+	return ret;
+}
+
+/** Write back dirty blocks, batching them into vectored requests.
+ *
+ * Adjacent blocks are coalesced into one extent and up to BD_EXTENTS_MAX
+ * extents are written in a single request. The blocks are referenced by
+ * the caller. Blocks which are referenced also by someone else might be
+ * modified and are skipped.
+ *
+ * @param devcon	Device connection.
+ * @param dirty		Referenced dirty blocks.
+ * @param count		Number of blocks.
+ *
+ * @return		EOK if all written blocks made it to the device or
+ *			the error code of the last failed write.
+ */
+static errno_t cache_flush(devcon_t *devcon, block_t **dirty, size_t count)
+{
+	cache_t *cache = devcon->cache;
+	size_t run_max = max(DATA_XFER_LIMIT / cache->lblock_size, 1);
+	size_t run_start = 0;
+	size_t run_count = 0;
+	bd_extent_t ext[BD_EXTENTS_MAX];
+	size_t ext_cnt = 0;
+	errno_t rc = EOK;
+	errno_t rc2;
+
+	qsort(dirty, count, sizeof(block_t *), block_pba_cmp);
+
+	for (size_t i = 0; i < count; i++) {
+		block_t *b = dirty[i];
+
+		fibril_mutex_lock(&b->lock);
+		if ((b->refcnt != 1) || !b->dirty || b->toxic) {
+			fibril_mutex_unlock(&b->lock);
+			continue;
+		}
+
+		if ((run_count > 0) &&
+		    (((dirty[run_start + run_count - 1]->pba +
+		    cache->blocks_cluster != b->pba) &&
+		    (ext_cnt == BD_EXTENTS_MAX)) || (run_count == run_max))) {
+			rc2 = cache_flush_run(devcon, &dirty[run_start],
+			    run_count, ext, ext_cnt);
+			if (rc2 != EOK)
+				rc = rc2;
+			run_count = 0;
+			ext_cnt = 0;
+		}
+
+		if (run_count == 0)
+			run_start = i;
+
+		/*
+		 * Keep the batch contiguous in the array, skipping over
+		 * the blocks which are not written back.
+		 */
+		dirty[i] = dirty[run_start + run_count];
+		dirty[run_start + run_count] = b;
+
+		cache_extent_add(cache, ext, &ext_cnt, b);
+		run_count++;
+	}
+
+	if (run_count > 0) {
+		rc2 = cache_flush_run(devcon, &dirty[run_start], run_count,
+		    ext, ext_cnt);
+		if (rc2 != EOK)
+			rc = rc2;
+	}
+
+	for (size_t i = 0; i < count; i++)
+		(void) block_put(dirty[i]);
+
+	return rc;
+}
+
+/** Take references to unreferenced dirty blocks of a cache.
+ *
+ * The blocks are removed from the free lists so that they are not
+ * recycled while being written back.
+ *
+ * @param cache		Block cache.
+ * @param dirty		Array for the referenced blocks.
+ * @param max_count	Size of the array.
+ *
+ * @return		Number of blocks stored in the array.
+ */
+static size_t cache_collect_dirty(cache_t *cache, block_t **dirty,
+    size_t max_count)
+{
+	size_t count = 0;
+
+	for (unsigned i = 0; i < CACHE_SHARDS; i++) {
+		cache_shard_t *shard = &cache->shards[i];
+
+		fibril_mutex_lock(&shard->lock);
+		list_foreach_safe(shard->free_list, cur, next) {
+			if (count == max_count)
+				break;
+
+			block_t *b = list_get_instance(cur, block_t,
+			    free_link);
+
+			fibril_mutex_lock(&b->lock);
+			if (b->dirty && !b->toxic) {
+				b->refcnt++;
+				list_remove(&b->free_link);
+				dirty[count++] = b;
+			}
+			fibril_mutex_unlock(&b->lock);
+		}
+		fibril_mutex_unlock(&shard->lock);
+	}
+
+	return count;
+}
+
+/** Write-behind flusher fibril.
+ *
+ * Periodically writes back dirty blocks sitting unreferenced in the cache
+ * of a device in the write-back mode.
+ *
+ * @param arg		Device connection.
+ *
+ * @return		EOK when asked to exit by block_cache_fini().
+ */
+static errno_t block_flusher(void *arg)
+{
+	devcon_t *devcon = (devcon_t *) arg;
+	cache_t *cache = devcon->cache;
+	block_t *dirty[FLUSH_MAX];
+
+	fibril_mutex_lock(&cache->lock);
+
+	while (!cache->flush_stop) {
+		(void) fibril_condvar_wait_timeout(&cache->flush_cv,
+		    &cache->lock, FLUSH_PERIOD);
+		if (cache->flush_stop)
+			break;
+
+		fibril_mutex_unlock(&cache->lock);
+
+		size_t count = cache_collect_dirty(cache, dirty, FLUSH_MAX);
+		if (count > 0)
+			(void) cache_flush(devcon, dirty, count);
+
+		fibril_mutex_lock(&cache->lock);
+	}
+
+	cache->flush_running = false;
+	fibril_condvar_broadcast(&cache->flush_cv);
+	fibril_mutex_unlock(&cache->lock);
+
+	return EOK;
+}
+
+/** Set the initial read-ahead window of the block cache of a device.
+ *
+ * The window is used as soon as a sequential read is detected and then
+ * grows as usual. Devices with a high access latency, such as optical
+ * drives, are better served by starting with a large window.
+ *
+ * @param service_id	Service ID of the block device.
+ * @param blocks	Number of blocks to read ahead initially.
+ *
+ * @return		EOK on success or an error code.
+ */
+errno_t block_cache_readahead(service_id_t service_id, unsigned blocks)
+{
+	devcon_t *devcon = devcon_search(service_id);
+	cache_t *cache;
+
+	if (!devcon)
+		return ENOENT;
+	if (!devcon->cache)
+		return ENOENT;
+	cache = devcon->cache;
+
+	fibril_mutex_lock(&cache->lock);
+	cache->ra_min = min(max(blocks, 1), READ_AHEAD_MAX);
+	fibril_mutex_unlock(&cache->lock);
+
+	return EOK;
+}
+
+/** Get statistics of the block cache of a device.
+ *
+ * @param service_id	Service ID of the block device.
+ * @param stats		Place to store the statistics.
+ *
+ * @return		EOK on success or an error code.
+ */
+errno_t block_cache_get_stats(service_id_t service_id,
+    block_cache_stats_t *stats)
+{
+	devcon_t *devcon = devcon_search(service_id);
+	cache_t *cache;
+
+	if (!devcon)
+		return ENOENT;
+	if (!devcon->cache)
+		return ENOENT;
+	cache = devcon->cache;
+
+	stats->hits = 0;
+	stats->misses = 0;
+	stats->evictions = 0;
+
+	for (unsigned i = 0; i < CACHE_SHARDS; i++) {
+		cache_shard_t *shard = &cache->shards[i];
+
+		fibril_mutex_lock(&shard->lock);
+		stats->hits += shard->hits;
+		stats->misses += shard->misses;
+		stats->evictions += shard->evictions;
+		fibril_mutex_unlock(&shard->lock);
+	}
+
+	stats->blocks_cached = atomic_get(&cache->blocks_cached);
+	return EOK;
+}
+
+/** Read sequential data from a block device.
+ *
+ * @param service_id	Service ID of the block device.
+ * @param buf		Buffer for holding one block
+ * @param bufpos	Pointer to the first unread valid offset within the
+ * 			communication buffer.
+ * @param buflen	Pointer to the number of unread bytes that are ready in
  * 			the communication buffer.
  * @param pos		Device position to be read.
  * @param dst		Destination buffer.
@@ -770,6 +1650,92 @@ errno_t block_read_direct(service_id_t service_id, aoff64_t ba, size_t cnt, void
 	return read_blocks(devcon, ba, cnt, buf, devcon->pblock_size * cnt);
 }
 
+/** Read logical blocks without bringing them into the cache.
+ *
+ * This is meant for large transfers which would only evict more useful
+ * blocks from the cache. Unlike block_read_direct(), the read is coherent
+ * with the cache, i.e. dirty cached blocks take precedence over the data
+ * stored on the device.
+ *
+ * @param service_id	Service ID of the block device.
+ * @param ba		Address of the first block (logical).
+ * @param cnt		Number of blocks.
+ * @param buf		Buffer for storing the data.
+ *
+ * @return		EOK on success or an error code on failure.
+ */
+errno_t block_read_uncached(service_id_t service_id, aoff64_t ba, size_t cnt,
+    void *buf)
+{
+	devcon_t *devcon;
+	cache_t *cache;
+	errno_t rc;
+
+	devcon = devcon_search(service_id);
+	assert(devcon);
+	assert(devcon->cache);
+
+	cache = devcon->cache;
+
+	if (ba_ltop(devcon, ba + cnt) > devcon->pblocks)
+		return EIO;
+
+	/*
+	 * Snapshot the dirty cached blocks before reading the device. If we
+	 * looked only after the read, a write-back completing in between
+	 * would clear the dirty flag and leave us with the stale device data.
+	 */
+	uint8_t *snap = NULL;
+	bool *snapped = NULL;
+
+	for (size_t i = 0; i < cnt; i++) {
+		aoff64_t lba = ba + i;
+		cache_shard_t *shard = cache_shard(cache, lba);
+
+		fibril_mutex_lock(&shard->lock);
+		block_t *b = oa_table_find(&shard->block_hash, &lba);
+		if (b != NULL) {
+			fibril_mutex_lock(&b->lock);
+			if (b->dirty && !b->toxic) {
+				if (snap == NULL) {
+					snap = malloc(cnt * cache->lblock_size);
+					snapped = calloc(cnt, sizeof(bool));
+					if ((snap == NULL) || (snapped == NULL)) {
+						fibril_mutex_unlock(&b->lock);
+						fibril_mutex_unlock(&shard->lock);
+						free(snap);
+						free(snapped);
+						return ENOMEM;
+					}
+				}
+
+				memcpy(snap + i * cache->lblock_size, b->data,
+				    cache->lblock_size);
+				snapped[i] = true;
+			}
+			fibril_mutex_unlock(&b->lock);
+		}
+		fibril_mutex_unlock(&shard->lock);
+	}
+
+	rc = read_blocks(devcon, ba_ltop(devcon, ba),
+	    cnt * cache->blocks_cluster, buf, cnt * cache->lblock_size);
+
+	if ((rc == EOK) && (snap != NULL)) {
+		for (size_t i = 0; i < cnt; i++) {
+			if (snapped[i]) {
+				memcpy(buf + i * cache->lblock_size,
+				    snap + i * cache->lblock_size,
+				    cache->lblock_size);
+			}
+		}
+	}
+
+	free(snap);
+	free(snapped);
+	return rc;
+}
+
 /** Write blocks directly to device (bypass cache).
  *
  * @param service_id	Service ID of the block device.
@@ -808,6 +1774,163 @@ errno_t block_sync_cache(service_id_t service_id, aoff64_t ba, size_t cnt)
 	return bd_sync_cache(devcon->bd, ba, cnt);
 }
 
+/** Discard blocks which no longer hold useful data.
+ *
+ * The discard is queued and sent to the device in a batch together with
+ * other discards, at the latest before anything is written to the device
+ * or when the cache is synchronized. Adjacent discards are merged.
+ *
+ * Cached copies of the blocks are not affected. A dirty copy which is
+ * written back later simply makes the device allocate the block again.
+ *
+ * @param service_id	Service ID of the block device.
+ * @param ba		Address of first block (physical).
+ * @param cnt		Number of blocks.
+ *
+ * @return		EOK on success, ENOTSUP if the device does not
+ *			support discarding blocks or another error code.
+ */
+errno_t block_discard(service_id_t service_id, aoff64_t ba, size_t cnt)
+{
+	devcon_t *devcon;
+	bd_extent_t *last;
+	errno_t rc = EOK;
+
+	devcon = devcon_search(service_id);
+	assert(devcon);
+
+	if (cnt == 0)
+		return EOK;
+
+	fibril_mutex_lock(&devcon->discard_lock);
+
+	if (devcon->discard_cnt > 0) {
+		last = &devcon->discard[devcon->discard_cnt - 1];
+		if (last->ba + last->cnt == ba) {
+			last->cnt += cnt;
+			goto out;
+		}
+	}
+
+	if (devcon->discard_cnt == BD_EXTENTS_MAX)
+		rc = discard_flush(devcon);
+
+	if (devcon->discard_unsup) {
+		rc = ENOTSUP;
+		goto out;
+	}
+
+	devcon->discard[devcon->discard_cnt].ba = ba;
+	devcon->discard[devcon->discard_cnt].cnt = cnt;
+	devcon->discard[devcon->discard_cnt].offset = 0;
+	devcon->discard_cnt++;
+out:
+	fibril_mutex_unlock(&devcon->discard_lock);
+	return rc;
+}
+
+/** Send queued discards to the device.
+ *
+ * @param service_id	Service ID of the block device.
+ *
+ * @return		EOK on success or an error code on failure.
+ */
+errno_t block_discard_flush(service_id_t service_id)
+{
+	devcon_t *devcon;
+	errno_t rc;
+
+	devcon = devcon_search(service_id);
+	assert(devcon);
+
+	fibril_mutex_lock(&devcon->discard_lock);
+	rc = discard_flush(devcon);
+	fibril_mutex_unlock(&devcon->discard_lock);
+
+	return rc;
+}
+
+/** Write back a whole block cache and flush the device's write cache.
+ *
+ * All dirty blocks which are not referenced at the time of the call are
+ * written to the device, followed by a device cache flush which orders
+ * them before any later writes.
+ *
+ * Concurrent callers are coalesced in the manner of a group commit.
+ * A caller arriving while a sync is in progress waits for it to finish
+ * and then has all the callers that arrived in the meantime served by a
+ * single further sync, rather than each starting its own.
+ *
+ * @param service_id	Service ID of the block device.
+ *
+ * @return		EOK on success or an error code on failure.
+ */
+errno_t block_cache_sync(service_id_t service_id)
+{
+	devcon_t *devcon = devcon_search(service_id);
+	cache_t *cache;
+	block_t *dirty[FLUSH_MAX];
+	errno_t rc, rc2;
+
+	if (!devcon)
+		return ENOENT;
+
+	fibril_mutex_lock(&devcon->discard_lock);
+	(void) discard_flush(devcon);
+	fibril_mutex_unlock(&devcon->discard_lock);
+
+	if (!devcon->cache) {
+		rc = bd_sync_cache(devcon->bd, 0, 0);
+		return (rc == ENOTSUP) ? EOK : rc;
+	}
+	cache = devcon->cache;
+
+	fibril_mutex_lock(&cache->lock);
+
+	/* Only a sync started after this point covers our writes. */
+	unsigned needed = cache->sync_started + 1;
+
+	while (cache->sync_running && cache->sync_done < needed)
+		fibril_condvar_wait(&cache->sync_cv, &cache->lock);
+
+	if (cache->sync_done >= needed) {
+		rc = cache->sync_rc;
+		fibril_mutex_unlock(&cache->lock);
+		return rc;
+	}
+
+	cache->sync_running = true;
+	unsigned gen = ++cache->sync_started;
+	fibril_mutex_unlock(&cache->lock);
+
+	rc = EOK;
+	while (true) {
+		size_t count = cache_collect_dirty(cache, dirty, FLUSH_MAX);
+		if (count == 0)
+			break;
+
+		rc2 = cache_flush(devcon, dirty, count);
+		if (rc2 != EOK) {
+			/* The blocks stay dirty, do not spin on them. */
+			rc = rc2;
+			break;
+		}
+	}
+
+	rc2 = bd_sync_cache(devcon->bd, 0, 0);
+	if (rc == EOK && rc2 != ENOTSUP)
+		rc = rc2;
+
+	fibril_mutex_lock(&cache->lock);
+	cache->sync_running = false;
+	cache->sync_done = gen;
+	cache->sync_rc = rc;
+	fibril_condvar_broadcast(&cache->sync_cv);
+	fibril_mutex_unlock(&cache->lock);
+
+	return rc;
+}
+
 /** Get device block size.
  *
  * @param service_id	Service ID of the block device.
@@ -951,6 +2074,15 @@ static errno_t write_blocks(devcon_t *devcon, aoff64_t ba, size_t cnt, void *dat
 {
 	assert(devcon);
 
+	/*
+	 * A block written after being discarded must not be discarded
+	 * by a pending discard later on. A failed discard does not make
+	 * the write fail.
+	 */
+	fibril_mutex_lock(&devcon->discard_lock);
+	(void) discard_flush(devcon);
+	fibril_mutex_unlock(&devcon->discard_lock);
+
 	errno_t rc = bd_write_blocks(devcon->bd, ba, cnt, data, size);
 	if (rc != EOK) {
 		printf("Error %s writing %zu blocks starting at block %" PRIuOFF64
@@ -963,6 +2095,93 @@ static errno_t write_blocks(devcon_t *devcon, aoff64_t ba, size_t cnt, void *dat
 	return rc;
 }
 
+/** Read several extents of blocks from block device in one request.
+ *
+ * @param devcon	Device connection.
+ * @param ext		Extents to read.
+ * @param ext_cnt	Number of extents, at most BD_EXTENTS_MAX.
+ * @param buf		Buffer for storing the data.
+ * @param size		Size of the buffer.
+ *
+ * @return		EOK on success or an error code on failure.
+ */
+static errno_t read_blocks_v(devcon_t *devcon, bd_extent_t *ext,
+    size_t ext_cnt, void *buf, size_t size)
+{
+	assert(devcon);
+
+	errno_t rc = bd_read_blocks_v(devcon->bd, ext, ext_cnt, buf, size);
+	if (rc != EOK) {
+		printf("Error %s reading %zu extents starting at block %" PRIuOFF64
+		    " from device handle %" PRIun "\n", str_error_name(rc), ext_cnt,
+		    ext[0].ba, devcon->service_id);
+#ifndef NDEBUG
+		stacktrace_print();
+#endif
+	}
+
+	return rc;
+}
+
+/** Write several extents of blocks to block device in one request.
+ *
+ * @param devcon	Device connection.
+ * @param ext		Extents to write.
+ * @param ext_cnt	Number of extents, at most BD_EXTENTS_MAX.
+ * @param data		Buffer containing the data to write.
+ * @param size		Size of the data.
+ *
+ * @return		EOK on success or an error code on failure.
+ */
+static errno_t write_blocks_v(devcon_t *devcon, bd_extent_t *ext,
+    size_t ext_cnt, void *data, size_t size)
+{
+	assert(devcon);
+
+	/* See write_blocks(). */
+	fibril_mutex_lock(&devcon->discard_lock);
+	(void) discard_flush(devcon);
+	fibril_mutex_unlock(&devcon->discard_lock);
+
+	errno_t rc = bd_write_blocks_v(devcon->bd, ext, ext_cnt, data, size);
+	if (rc != EOK) {
+		printf("Error %s writing %zu extents starting at block %" PRIuOFF64
+		    " to device handle %" PRIun "\n", str_error_name(rc), ext_cnt,
+		    ext[0].ba, devcon->service_id);
+#ifndef NDEBUG
+		stacktrace_print();
+#endif
+	}
+
+	return rc;
+}
+
+/** Send pending discards to the device.
+ *
+ * @param devcon	Device connection, its discard lock held.
+ *
+ * @return		EOK on success or an error code on failure.
+ */
+static errno_t discard_flush(devcon_t *devcon)
+{
+	assert(fibril_mutex_is_locked(&devcon->discard_lock));
+
+	if (devcon->discard_cnt == 0)
+		return EOK;
+
+	errno_t rc = bd_discard_blocks(devcon->bd, devcon->discard,
+	    devcon->discard_cnt);
+	devcon->discard_cnt = 0;
+
+	if (rc == ENOTSUP) {
+		/* Do not bother queueing any further discards. */
+		devcon->discard_unsup = true;
+		rc = EOK;
+	}
+
+	return rc;
+}
+
 /** Convert logical block address to physical block address. */
 static aoff64_t ba_ltop(devcon_t *devcon, aoff64_t lba)
 {
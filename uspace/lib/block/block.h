@@ -41,7 +41,6 @@
 #include <offset.h>
 #include <async.h>
 #include <fibril_synch.h>
-#include <adt/hash_table.h>
 #include <adt/list.h>
 #include <loc.h>
 
@@ -84,8 +83,6 @@ typedef struct block {
 	int write_failures;
 	/** Link for placing the block into the free block list. */
 	link_t free_link;
-	/** Link for placing the block into the block hash table. */
-	ht_link_t hash_link;
 	/** Buffer with the block data. */
 	void *data;
 } block_t;
@@ -98,6 +95,18 @@ enum cache_mode {
 	CACHE_MODE_WB
 };
 
+/** Block cache statistics */
+typedef struct {
+	/** Number of block_get() calls satisfied from the cache */
+	uint64_t hits;
+	/** Number of block_get() calls which instantiated a block */
+	uint64_t misses;
+	/** Number of blocks recycled or freed to make room */
+	uint64_t evictions;
+	/** Number of currently cached blocks */
+	size_t blocks_cached;
+} block_cache_stats_t;
+
 extern errno_t block_init(service_id_t, size_t);
 extern void block_fini(service_id_t);
 
@@ -106,9 +115,12 @@ extern void *block_bb_get(service_id_t);
 
 extern errno_t block_cache_init(service_id_t, size_t, unsigned, enum cache_mode);
 extern errno_t block_cache_fini(service_id_t);
+extern errno_t block_cache_readahead(service_id_t, unsigned);
+extern errno_t block_cache_get_stats(service_id_t, block_cache_stats_t *);
 
 extern errno_t block_get(block_t **, service_id_t, aoff64_t, int);
 extern errno_t block_put(block_t *);
+extern errno_t block_prefetch(service_id_t, aoff64_t, size_t);
 
 extern errno_t block_seqread(service_id_t, void *, size_t *, size_t *, aoff64_t *,
     void *, size_t);
@@ -117,9 +129,13 @@ extern errno_t block_get_bsize(service_id_t, size_t *);
 extern errno_t block_get_nblocks(service_id_t, aoff64_t *);
 extern errno_t block_read_toc(service_id_t, uint8_t, void *, size_t);
 extern errno_t block_read_direct(service_id_t, aoff64_t, size_t, void *);
+extern errno_t block_read_uncached(service_id_t, aoff64_t, size_t, void *);
 extern errno_t block_read_bytes_direct(service_id_t, aoff64_t, size_t, void *);
 extern errno_t block_write_direct(service_id_t, aoff64_t, size_t, const void *);
 extern errno_t block_sync_cache(service_id_t, aoff64_t, size_t);
+extern errno_t block_cache_sync(service_id_t);
+extern errno_t block_discard(service_id_t, aoff64_t, size_t);
+extern errno_t block_discard_flush(service_id_t);
 
 #endif
 
@@ -38,6 +38,9 @@
 #define PAGE_WIDTH  12
 #define PAGE_SIZE   (1 << PAGE_WIDTH)
 
+/** The architecture provides its own routines for large memory blocks. */
+#define LIBARCH_MEM_OPS
+
 #define USER_ADDRESS_SPACE_START_ARCH  UINT32_C(0x00000000)
 #define USER_ADDRESS_SPACE_END_ARCH    UINT32_C(0x7fffffff)
 
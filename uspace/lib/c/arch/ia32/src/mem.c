@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup libcia32 ia32
+ * @{
+ */
+/** @file
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "../../../generic/private/mem.h"
+
+/** Enhanced REP MOVSB/STOSB feature bit in CPUID leaf 7, EBX. */
+#define CPUID_ERMS  (1 << 9)
+
+static inline void cpuid(uint32_t leaf, uint32_t subleaf, uint32_t *eax,
+    uint32_t *ebx, uint32_t *ecx, uint32_t *edx)
+{
+	asm volatile (
+	    "cpuid\n"
+	    : "=a" (*eax), "=b" (*ebx), "=c" (*ecx), "=d" (*edx)
+	    : "a" (leaf), "c" (subleaf)
+	);
+}
+
+/** Copy memory block with a single REP MOVSB. */
+static void *memcpy_erms(void *dst, const void *src, size_t n)
+{
+	void *d = dst;
+
+	asm volatile (
+	    "rep movsb\n"
+	    : "+D" (d), "+S" (src), "+c" (n)
+	    :
+	    : "memory"
+	);
+
+	return dst;
+}
+
+/** Fill memory block with a single REP STOSB. */
+static void *memset_erms(void *dst, int b, size_t n)
+{
+	void *d = dst;
+
+	asm volatile (
+	    "rep stosb\n"
+	    : "+D" (d), "+c" (n)
+	    : "a" (b)
+	    : "memory"
+	);
+
+	return dst;
+}
+
+/** Copy memory block by words with REP MOVSL, the tail by bytes. */
+static void *memcpy_rep(void *dst, const void *src, size_t n)
+{
+	void *d = dst;
+	size_t words = n / 4;
+	size_t bytes = n % 4;
+
+	asm volatile (
+	    "rep movsl\n"
+	    "mov %[bytes], %%ecx\n"
+	    "rep movsb\n"
+	    : "+D" (d), "+S" (src), "+c" (words)
+	    : [bytes] "r" ((uint32_t) bytes)
+	    : "memory"
+	);
+
+	return dst;
+}
+
+/** Fill memory block by words with REP STOSL, the tail by bytes. */
+static void *memset_rep(void *dst, int b, size_t n)
+{
+	void *d = dst;
+	unsigned long pattern = (uint8_t) b * (~0UL / 0xff);
+	size_t words = n / 4;
+	size_t bytes = n % 4;
+
+	asm volatile (
+	    "rep stosl\n"
+	    "mov %[bytes], %%ecx\n"
+	    "rep stosb\n"
+	    : "+D" (d), "+c" (words)
+	    : "a" (pattern), [bytes] "r" ((uint32_t) bytes)
+	    : "memory"
+	);
+
+	return dst;
+}
+
+/** Select the string instructions best suited for the processor.
+ *
+ * On processors with fast string operations (ERMS) a single REP MOVSB
+ * or REP STOSB is the fastest way to handle large blocks. The SSE and
+ * AVX registers are not used, since their state is not guaranteed to
+ * be preserved for all tasks.
+ *
+ * @param ops Routines for large memory blocks to fill in.
+ */
+void arch_mem_init(mem_ops_t *ops)
+{
+	uint32_t eax, ebx, ecx, edx;
+	bool erms = false;
+
+	cpuid(0, 0, &eax, &ebx, &ecx, &edx);
+	if (eax >= 7) {
+		cpuid(7, 0, &eax, &ebx, &ecx, &edx);
+		erms = (ebx & CPUID_ERMS) != 0;
+	}
+
+	if (erms) {
+		ops->copy = memcpy_erms;
+		ops->set = memset_erms;
+	} else {
+		ops->copy = memcpy_rep;
+		ops->set = memset_rep;
+	}
+}
+
+/** @}
+ */
@@ -45,11 +45,83 @@
 #include <rtld/rtld_debug.h>
 #include <rtld/rtld_arch.h>
 
+/** Trampoline entered from PLT0 when an unbound PLT entry is called. */
+extern void rtld_plt_trampoline(void);
+
+void *rtld_plt_bind(module_t *, size_t) __attribute__((visibility("hidden")));
+
 void module_process_pre_arch(module_t *m)
 {
 	/* Unused */
 }
 
+/** Prepare the PLT of a module for lazy binding.
+ *
+ * The jump slots initially point back into their PLT entries, which push
+ * the relocation offset and jump to PLT0. PLT0 pushes GOT[1] and jumps to
+ * GOT[2], where we install rtld_plt_trampoline().
+ *
+ * @param m Module
+ * @return @c true if the PLT is set up for lazy binding, @c false if
+ *         the jump slots need to be bound immediately.
+ */
+bool module_plt_lazy_arch(module_t *m)
+{
+	elf_rel_t *rt = m->dyn.jmp_rel;
+	size_t rt_entries = m->dyn.plt_rel_sz / sizeof(elf_rel_t);
+	uint32_t *got = m->dyn.plt_got;
+	size_t i;
+
+	if (m->dyn.plt_rel != DT_REL || got == NULL)
+		return false;
+
+	for (i = 0; i < rt_entries; ++i) {
+		if (ELF32_R_TYPE(rt[i].r_info) != R_386_JUMP_SLOT)
+			return false;
+	}
+
+	for (i = 0; i < rt_entries; ++i) {
+		uint32_t *r_ptr = (uint32_t *)(rt[i].r_offset + m->bias);
+		*r_ptr += m->bias;
+	}
+
+	got[1] = (uint32_t) m;
+	got[2] = (uint32_t) rtld_plt_trampoline;
+
+	return true;
+}
+
+/** Bind a PLT entry on its first call.
+ *
+ * Called from rtld_plt_trampoline().
+ *
+ * @param m Module whose PLT entry was called
+ * @param rel_off Offset of the jump slot relocation in the PLT
+ *                relocation table
+ * @return Address of the symbol definition
+ */
+void *rtld_plt_bind(module_t *m, size_t rel_off)
+{
+	elf_rel_t *rel = (elf_rel_t *)((uint8_t *) m->dyn.jmp_rel + rel_off);
+	elf_symbol_t *sym_table = m->dyn.sym_tab;
+	elf_symbol_t *sym = &sym_table[ELF32_R_SYM(rel->r_info)];
+	const char *name = m->dyn.str_tab + sym->st_name;
+	uint32_t *r_ptr = (uint32_t *)(rel->r_offset + m->bias);
+	elf_symbol_t *sym_def;
+	module_t *dest;
+
+	DPRINTF("rtld_plt_bind('%s', '%s')\n", m->dyn.soname, name);
+
+	sym_def = symbol_def_find(name, m, ssf_none, &dest);
+	if (sym_def == NULL) {
+		printf("Definition of '%s' not found.\n", name);
+		exit(1);
+	}
+
+	*r_ptr = (uint32_t) symbol_get_addr(sym_def, dest, NULL);
+	return (void *) *r_ptr;
+}
+
 
 /**
  * Process (fixup) all relocations in a relocation table.
@@ -103,8 +175,7 @@ void rel_table_process(module_t *m, elf_rel_t *rt, size_t rt_size)
 #if 0
 			DPRINTF("rel_type: %x, rel_offset: 0x%x\n", rel_type, r_offset);
 #endif
-			sym_def = symbol_def_find(str_tab + sym->st_name,
-			    m, ssf_none, &dest);
+			sym_def = symbol_reloc_find(m, sym_idx, &dest);
 			DPRINTF("dest name: '%s'\n", dest->dyn.soname);
 			DPRINTF("dest bias: 0x%x\n", dest->bias);
 			if (sym_def) {
@@ -0,0 +1 @@
+../../../mips32/include/libarch/cycle.h
\ No newline at end of file
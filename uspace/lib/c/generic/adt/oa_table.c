@@ -0,0 +1,520 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup libc
+ * @{
+ */
+/** @file
+ */
+
+/*
+ * This is an implementation of a generic resizable hash table with open
+ * addressing and linear probing, which stores pointers to the items
+ * directly in an array of slots.
+ *
+ * Robin Hood hashing is used to keep the probe sequences short: an item
+ * being inserted takes the slot of any item that is closer to its home
+ * slot. Lookups can therefore stop as soon as they reach an item closer
+ * to its home slot than the key would be. Removal shifts the following
+ * items back instead of leaving tombstones.
+ *
+ * The table grows to twice its size when its load exceeds 3/4. Instead of
+ * rehashing all items at once, the old array is kept and each subsequent
+ * insertion moves a few of its slots to the new one. Lookups and removals
+ * check both arrays until the migration is finished. Items are never
+ * inserted to the old array, so removals from it only mark the slot as
+ * deleted, which keeps the probe sequences of the remaining items intact.
+ */
+
+#include <adt/oa_table.h>
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/* Minimal number of slots. Must be a power of two. */
+#define OA_MIN_SLOTS  16
+
+/* Number of old slots migrated by each insertion during resize. */
+#define OA_MIGRATE_STEP  8
+
+/* Marks a removed or already migrated slot of the old array. */
+#define OA_DELETED  ((void *) UINTPTR_MAX)
+
+/* Dummy do nothing callback to invoke in place of remove_callback == NULL. */
+static void nop_remove_callback(void *item)
+{
+	/* no-op */
+}
+
+/** Scramble the hash so that its lowest bits can be used as slot index. */
+static inline size_t mix_hash(size_t hash)
+{
+	/* Fibonacci hashing with a rotation bringing the best bits down. */
+#ifdef __64_BITS__
+	hash *= 0x9e3779b97f4a7c15UL;
+	return (hash >> 32) | (hash << 32);
+#else
+	hash *= 0x9e3779b9U;
+	return (hash >> 16) | (hash << 16);
+#endif
+}
+
+/** True if the load of the table would be too high with one more item. */
+static inline bool overloaded(size_t item_cnt, size_t slot_cnt)
+{
+	return 4 * (item_cnt + 1) > 3 * slot_cnt;
+}
+
+/** Distance of an item in slot @a pos from its home slot. */
+static inline size_t probe_dist(size_t pos, size_t hash, size_t slot_cnt)
+{
+	return (pos - hash) & (slot_cnt - 1);
+}
+
+/** How find_slot() matches items. */
+typedef enum {
+	/** Item with the given key */
+	MATCH_KEY,
+	/** The given item itself */
+	MATCH_ITEM,
+	/** Item equal to the given item */
+	MATCH_EQUAL
+} match_t;
+
+/** Find a slot.
+ *
+ * @param h     Hash table.
+ * @param slot  Slot array to search.
+ * @param cnt   Number of slots in @a slot.
+ * @param hash  Mixed hash of the key.
+ * @param match How to match items.
+ * @param arg   Key for MATCH_KEY, item otherwise.
+ *
+ * @return Slot containing the item or NULL if not found.
+ */
+static oa_slot_t *find_slot(const oa_table_t *h, oa_slot_t *slot, size_t cnt,
+    size_t hash, match_t match, const void *arg)
+{
+	if (slot == NULL)
+		return NULL;
+
+	size_t pos = hash & (cnt - 1);
+	size_t dist = 0;
+
+	while (true) {
+		oa_slot_t *cur = &slot[pos];
+
+		if (cur->item == NULL || probe_dist(pos, cur->hash, cnt) < dist)
+			return NULL;
+
+		if (cur->hash == hash && cur->item != OA_DELETED) {
+			switch (match) {
+			case MATCH_KEY:
+				if (h->op->key_equal(arg, cur->item))
+					return cur;
+				break;
+			case MATCH_ITEM:
+				if (cur->item == arg)
+					return cur;
+				break;
+			case MATCH_EQUAL:
+				if (h->op->equal(arg, cur->item))
+					return cur;
+				break;
+			}
+		}
+
+		pos = (pos + 1) & (cnt - 1);
+		dist++;
+	}
+}
+
+/** Insert an item into a slot array which has at least one free slot. */
+static void insert_slot(oa_slot_t *slot, size_t cnt, size_t hash, void *item)
+{
+	size_t pos = hash & (cnt - 1);
+	size_t dist = 0;
+
+	while (true) {
+		oa_slot_t *cur = &slot[pos];
+
+		if (cur->item == NULL) {
+			cur->hash = hash;
+			cur->item = item;
+			return;
+		}
+
+		size_t cur_dist = probe_dist(pos, cur->hash, cnt);
+		if (cur_dist < dist) {
+			/* Take the slot of an item closer to home */
+			size_t tmp_hash = cur->hash;
+			void *tmp_item = cur->item;
+
+			cur->hash = hash;
+			cur->item = item;
+
+			hash = tmp_hash;
+			item = tmp_item;
+			dist = cur_dist;
+		}
+
+		pos = (pos + 1) & (cnt - 1);
+		dist++;
+	}
+}
+
+/** Remove an item from the current slot array by shifting back the rest. */
+static void remove_slot(oa_table_t *h, oa_slot_t *cur)
+{
+	size_t mask = h->slot_cnt - 1;
+	size_t pos = cur - h->slot;
+
+	while (true) {
+		size_t next = (pos + 1) & mask;
+		oa_slot_t *next_slot = &h->slot[next];
+
+		if (next_slot->item == NULL ||
+		    probe_dist(next, next_slot->hash, h->slot_cnt) == 0) {
+			h->slot[pos].item = NULL;
+			return;
+		}
+
+		h->slot[pos] = *next_slot;
+		pos = next;
+	}
+}
+
+/** Migrate up to @a steps slots of the old array to the current one. */
+static void migrate(oa_table_t *h, size_t steps)
+{
+	while (h->old_slot != NULL && steps-- > 0) {
+		oa_slot_t *cur = &h->old_slot[h->old_pos];
+
+		if (cur->item != NULL && cur->item != OA_DELETED) {
+			insert_slot(h->slot, h->slot_cnt, cur->hash, cur->item);
+			cur->item = OA_DELETED;
+		}
+
+		if (++h->old_pos == h->old_slot_cnt) {
+			free(h->old_slot);
+			h->old_slot = NULL;
+			h->old_slot_cnt = 0;
+			h->old_pos = 0;
+		}
+	}
+}
+
+/** Start growing the table. False if out of memory. */
+static bool grow(oa_table_t *h)
+{
+	/* Finish the previous resize first */
+	migrate(h, SIZE_MAX);
+
+	oa_slot_t *slot = calloc(2 * h->slot_cnt, sizeof(oa_slot_t));
+	if (slot == NULL)
+		return false;
+
+	h->old_slot = h->slot;
+	h->old_slot_cnt = h->slot_cnt;
+	h->old_pos = 0;
+
+	h->slot = slot;
+	h->slot_cnt *= 2;
+	return true;
+}
+
+/** Find a slot in either array.
+ *
+ * @param h      Hash table.
+ * @param hash   Mixed hash of the key.
+ * @param match  How to match items.
+ * @param arg    Key for MATCH_KEY, item otherwise.
+ * @param in_old Place to store whether the slot is in the old array.
+ *
+ * @return Slot containing the item or NULL if not found.
+ */
+static oa_slot_t *find_any(const oa_table_t *h, size_t hash, match_t match,
+    const void *arg, bool *in_old)
+{
+	oa_slot_t *cur = find_slot(h, h->slot, h->slot_cnt, hash, match, arg);
+	*in_old = (cur == NULL);
+	if (cur == NULL) {
+		cur = find_slot(h, h->old_slot, h->old_slot_cnt, hash, match,
+		    arg);
+	}
+
+	return cur;
+}
+
+/** Remove the item in a slot found by find_any() and notify the user. */
+static void remove_found(oa_table_t *h, oa_slot_t *cur, bool in_old)
+{
+	void *item = cur->item;
+
+	if (in_old)
+		cur->item = OA_DELETED;
+	else
+		remove_slot(h, cur);
+
+	h->item_cnt--;
+	h->op->remove_callback(item);
+}
+
+/** Create open addressing hash table.
+ *
+ * @param h         Hash table structure. Will be initialized by this call.
+ * @param init_size Initial expected number of items. Pass zero if you want
+ *                  the default initial size.
+ * @param op        Hash table operations structure. remove_callback()
+ *                  is optional and can be NULL if no action is to be taken
+ *                  upon removal. equal() is optional if and only if
+ *                  oa_table_insert_unique() will never be invoked.
+ *                  All other operations are mandatory.
+ *
+ * @return True on success
+ *
+ */
+bool oa_table_create(oa_table_t *h, size_t init_size, oa_table_ops_t *op)
+{
+	assert(h);
+	assert(op && op->hash && op->key_hash && op->key_equal);
+
+	/* Check for compulsory ops. */
+	if (!op || !op->hash || !op->key_hash || !op->key_equal)
+		return false;
+
+	h->slot_cnt = OA_MIN_SLOTS;
+	while (overloaded(init_size, h->slot_cnt))
+		h->slot_cnt *= 2;
+
+	h->slot = calloc(h->slot_cnt, sizeof(oa_slot_t));
+	if (h->slot == NULL)
+		return false;
+
+	h->item_cnt = 0;
+	h->op = op;
+	h->old_slot = NULL;
+	h->old_slot_cnt = 0;
+	h->old_pos = 0;
+
+	if (h->op->remove_callback == NULL)
+		h->op->remove_callback = nop_remove_callback;
+
+	return true;
+}
+
+/** Destroy a hash table instance.
+ *
+ * Remaining items are removed from the table.
+ *
+ * @param h Hash table to be destroyed.
+ *
+ */
+void oa_table_destroy(oa_table_t *h)
+{
+	assert(h && h->slot);
+
+	oa_table_clear(h);
+
+	free(h->slot);
+	h->slot = NULL;
+	h->slot_cnt = 0;
+}
+
+/** Returns true if there are no items in the table. */
+bool oa_table_empty(oa_table_t *h)
+{
+	assert(h && h->slot);
+	return h->item_cnt == 0;
+}
+
+/** Returns the number of items in the table. */
+size_t oa_table_size(oa_table_t *h)
+{
+	assert(h && h->slot);
+	return h->item_cnt;
+}
+
+/** Remove all elements from the hash table
+ *
+ * The table keeps its current size.
+ *
+ * @param h Hash table to be cleared
+ */
+void oa_table_clear(oa_table_t *h)
+{
+	assert(h && h->slot);
+
+	migrate(h, SIZE_MAX);
+
+	for (size_t i = 0; i < h->slot_cnt; i++) {
+		void *item = h->slot[i].item;
+
+		if (item != NULL) {
+			h->slot[i].item = NULL;
+			h->op->remove_callback(item);
+		}
+	}
+
+	h->item_cnt = 0;
+}
+
+/** Insert item into the hash table.
+ *
+ * The caller must make sure there is no item with the same key in the
+ * table yet.
+ *
+ * @param h    Hash table.
+ * @param item Item to be inserted into the hash table.
+ *
+ * @return EOK on success, ENOMEM if the table is full and cannot grow.
+ */
+errno_t oa_table_insert(oa_table_t *h, void *item)
+{
+	assert(h && h->slot);
+	assert(item != NULL && item != OA_DELETED);
+
+	migrate(h, OA_MIGRATE_STEP);
+
+	if (overloaded(h->item_cnt, h->slot_cnt) && !grow(h)) {
+		/* Keep at least one slot empty to terminate lookups. */
+		if (h->item_cnt + 1 >= h->slot_cnt)
+			return ENOMEM;
+	}
+
+	insert_slot(h->slot, h->slot_cnt, mix_hash(h->op->hash(item)), item);
+	h->item_cnt++;
+	return EOK;
+}
+
+/** Insert item into the hash table if not already present.
+ *
+ * @param h    Hash table.
+ * @param item Item to be inserted into the hash table.
+ *
+ * @return EOK on success, EEXIST if an equal item is already present,
+ *         ENOMEM if the table is full and cannot grow.
+ */
+errno_t oa_table_insert_unique(oa_table_t *h, void *item)
+{
+	assert(h && h->slot);
+	assert(h->op->equal);
+
+	bool in_old;
+	size_t hash = mix_hash(h->op->hash(item));
+
+	if (find_any(h, hash, MATCH_EQUAL, item, &in_old) != NULL)
+		return EEXIST;
+
+	return oa_table_insert(h, item);
+}
+
+/** Find the item with the given key.
+ *
+ * @param h   Hash table.
+ * @param key Key to look for.
+ *
+ * @return Matching item or NULL if there is none.
+ */
+void *oa_table_find(const oa_table_t *h, const void *key)
+{
+	assert(h && h->slot);
+
+	bool in_old;
+	oa_slot_t *cur = find_any(h, mix_hash(h->op->key_hash(key)), MATCH_KEY,
+	    key, &in_old);
+
+	return (cur != NULL) ? cur->item : NULL;
+}
+
+/** Remove the item with the given key.
+ *
+ * @param h   Hash table.
+ * @param key Key of the item to remove.
+ *
+ * @return True if an item was removed.
+ */
+bool oa_table_remove(oa_table_t *h, const void *key)
+{
+	assert(h && h->slot);
+
+	bool in_old;
+	oa_slot_t *cur = find_any(h, mix_hash(h->op->key_hash(key)), MATCH_KEY,
+	    key, &in_old);
+	if (cur == NULL)
+		return false;
+
+	remove_found(h, cur, in_old);
+	return true;
+}
+
+/** Remove an item that is known to be in the table.
+ *
+ * @param h    Hash table.
+ * @param item Item to remove.
+ */
+void oa_table_remove_item(oa_table_t *h, void *item)
+{
+	assert(h && h->slot);
+
+	bool in_old;
+	oa_slot_t *cur = find_any(h, mix_hash(h->op->hash(item)), MATCH_ITEM,
+	    item, &in_old);
+
+	assert(cur != NULL);
+	if (cur != NULL)
+		remove_found(h, cur, in_old);
+}
+
+/** Apply function to all items in the hash table.
+ *
+ * @param h   Hash table.
+ * @param f   Function to be applied. Return false if no more items
+ *            should be visited. The function must not modify the table.
+ * @param arg Argument to be passed to the function.
+ */
+void oa_table_apply(oa_table_t *h, bool (*f)(void *, void *), void *arg)
+{
+	assert(f);
+	assert(h && h->slot);
+
+	for (size_t i = 0; i < h->slot_cnt; i++) {
+		if (h->slot[i].item != NULL && !f(h->slot[i].item, arg))
+			return;
+	}
+
+	for (size_t i = h->old_pos; i < h->old_slot_cnt; i++) {
+		void *item = h->old_slot[i].item;
+
+		if (item != NULL && item != OA_DELETED && !f(item, arg))
+			return;
+	}
+}
+
+/** @}
+ */
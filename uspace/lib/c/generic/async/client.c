@@ -150,7 +150,7 @@ static void to_event_initialize(to_event_t *to)
 
 	to->inlist = false;
 	to->occurred = false;
-	link_initialize(&to->link);
+	odlink_initialize(&to->link);
 	to->expires = tv;
 }
 
@@ -190,21 +190,49 @@ static void amsg_destroy(amsg_t *msg)
 	free(msg);
 }
 
-/** Mutex protecting inactive_exch_list and avail_phone_cv.
+/** Mutex protecting pooled_sess_list and avail_phone_cv.
+ *
+ * Must not be locked while holding the exch_mutex of a session,
+ * except with fibril_mutex_trylock().
  *
  */
 static FIBRIL_MUTEX_INITIALIZE(async_sess_mutex);
 
-/** List of all currently inactive exchanges.
+/** List of all sessions which have cloned phones.
  *
  */
-static LIST_INITIALIZE(inactive_exch_list);
+static LIST_INITIALIZE(pooled_sess_list);
 
 /** Condition variable to wait for a phone to become available.
  *
  */
 static FIBRIL_CONDVAR_INITIALIZE(avail_phone_cv);
 
+/** Number of fibrils waiting on avail_phone_cv.
+ *
+ */
+static size_t avail_phone_waiters = 0;
+
+/** Initialize exchange management of a new session.
+ *
+ * @param sess Session.
+ *
+ */
+void async_sess_exch_init(async_sess_t *sess)
+{
+	list_initialize(&sess->exch_list);
+	link_initialize(&sess->pool_link);
+	sess->pooled = false;
+	fibril_mutex_initialize(&sess->exch_mutex);
+	fibril_condvar_initialize(&sess->exch_cv);
+	sess->phones = 0;
+	sess->phones_min = 0;
+	sess->phones_max = 0;
+	memset(&sess->stats, 0, sizeof(sess->stats));
+	fibril_mutex_initialize(&sess->mutex);
+	atomic_set(&sess->refcnt, 0);
+}
+
 /** Initialize the async framework.
  *
  */
@@ -220,9 +248,7 @@ void __async_client_init(void)
 	fibril_mutex_initialize(&session_ns.remote_state_mtx);
 	session_ns.remote_state_data = NULL;
 
-	list_initialize(&session_ns.exch_list);
-	fibril_mutex_initialize(&session_ns.mutex);
-	atomic_set(&session_ns.refcnt, 0);
+	async_sess_exch_init(&session_ns);
 }
 
 /** Reply received callback.
@@ -253,8 +279,7 @@ static void reply_received(void *arg, errno_t retval, ipc_call_t *data)
 	write_barrier();
 
 	/* Remove message from timeout list */
-	if (msg->wdata.to_event.inlist)
-		list_remove(&msg->wdata.to_event.link);
+	async_remove_timeout(&msg->wdata);
 
 	msg->done = true;
 
@@ -342,6 +367,49 @@ aid_t async_send_slow(async_exch_t *exch, sysarg_t imethod, sysarg_t arg1,
 	return (aid_t) msg;
 }
 
+/** Send message with an inline payload and return id of the sent message
+ *
+ * The payload of at most IPC_PAYLOAD_MAX bytes is delivered together with
+ * the message, so the server can get it with async_payload_accept() without
+ * the extra round trip of async_data_write_start().
+ *
+ * @param exch    Exchange for sending the message.
+ * @param imethod Service-defined interface and method.
+ * @param arg1    Service-defined payload argument.
+ * @param arg2    Service-defined payload argument.
+ * @param arg3    Service-defined payload argument.
+ * @param arg4    Service-defined payload argument.
+ * @param payload Inline payload.
+ * @param size    Size of the inline payload.
+ * @param dataptr If non-NULL, storage where the reply data will be
+ *                stored.
+ *
+ * @return Hash of the sent message or 0 on error.
+ *
+ */
+aid_t async_send_payload(async_exch_t *exch, sysarg_t imethod, sysarg_t arg1,
+    sysarg_t arg2, sysarg_t arg3, sysarg_t arg4, const void *payload,
+    size_t size, ipc_call_t *dataptr)
+{
+	if (exch == NULL)
+		return 0;
+
+	if (size > IPC_PAYLOAD_MAX)
+		return 0;
+
+	amsg_t *msg = amsg_create();
+	if (msg == NULL)
+		return 0;
+
+	msg->dataptr = dataptr;
+	msg->wdata.active = true;
+
+	ipc_call_async_payload(exch->phone, imethod, arg1, arg2, arg3, arg4, 0,
+	    payload, size, msg, reply_received);
+
+	return (aid_t) msg;
+}
+
 /** Wait for a message sent by the async framework.
  *
  * @param amsgid Hash of the message to wait for.
@@ -755,9 +823,7 @@ async_sess_t *async_connect_me_to(exch_mgmt_t mgmt, async_exch_t *exch,
 	fibril_mutex_initialize(&sess->remote_state_mtx);
 	sess->remote_state_data = NULL;
 
-	list_initialize(&sess->exch_list);
-	fibril_mutex_initialize(&sess->mutex);
-	atomic_set(&sess->refcnt, 0);
+	async_sess_exch_init(sess);
 
 	return sess;
 }
@@ -807,9 +873,7 @@ async_sess_t *async_connect_me_to_iface(async_exch_t *exch, iface_t iface,
 	fibril_mutex_initialize(&sess->remote_state_mtx);
 	sess->remote_state_data = NULL;
 
-	list_initialize(&sess->exch_list);
-	fibril_mutex_initialize(&sess->mutex);
-	atomic_set(&sess->refcnt, 0);
+	async_sess_exch_init(sess);
 
 	return sess;
 }
@@ -880,9 +944,7 @@ async_sess_t *async_connect_me_to_blocking(exch_mgmt_t mgmt, async_exch_t *exch,
 	fibril_mutex_initialize(&sess->remote_state_mtx);
 	sess->remote_state_data = NULL;
 
-	list_initialize(&sess->exch_list);
-	fibril_mutex_initialize(&sess->mutex);
-	atomic_set(&sess->refcnt, 0);
+	async_sess_exch_init(sess);
 
 	return sess;
 }
@@ -932,9 +994,7 @@ async_sess_t *async_connect_me_to_blocking_iface(async_exch_t *exch, iface_t ifa
 	fibril_mutex_initialize(&sess->remote_state_mtx);
 	sess->remote_state_data = NULL;
 
-	list_initialize(&sess->exch_list);
-	fibril_mutex_initialize(&sess->mutex);
-	atomic_set(&sess->refcnt, 0);
+	async_sess_exch_init(sess);
 
 	return sess;
 }
@@ -968,9 +1028,7 @@ async_sess_t *async_connect_kbox(task_id_t id)
 	fibril_mutex_initialize(&sess->remote_state_mtx);
 	sess->remote_state_data = NULL;
 
-	list_initialize(&sess->exch_list);
-	fibril_mutex_initialize(&sess->mutex);
-	atomic_set(&sess->refcnt, 0);
+	async_sess_exch_init(sess);
 
 	return sess;
 }
@@ -997,6 +1055,10 @@ errno_t async_hangup(async_sess_t *sess)
 		return EBUSY;
 
 	fibril_mutex_lock(&async_sess_mutex);
+	if (sess->pooled)
+		list_remove(&sess->pool_link);
+	fibril_mutex_lock(&sess->exch_mutex);
+	fibril_mutex_unlock(&async_sess_mutex);
 
 	errno_t rc = async_hangup_internal(sess->phone);
 
@@ -1006,18 +1068,221 @@ errno_t async_hangup(async_sess_t *sess)
 		    async_exch_t, sess_link);
 
 		list_remove(&exch->sess_link);
-		list_remove(&exch->global_link);
-		async_hangup_internal(exch->phone);
+		if (exch->phone != sess->phone)
+			async_hangup_internal(exch->phone);
 		free(exch);
 	}
 
+	fibril_mutex_unlock(&sess->exch_mutex);
 	free(sess);
 
-	fibril_mutex_unlock(&async_sess_mutex);
-
 	return rc;
 }
 
+/** Take an inactive exchange from a session.
+ *
+ * The exch_mutex of the session must be held.
+ *
+ * @param sess Session.
+ *
+ * @return Exchange or NULL if there is no inactive exchange.
+ *
+ */
+static async_exch_t *async_sess_exch_take(async_sess_t *sess)
+{
+	assert(fibril_mutex_is_locked(&sess->exch_mutex));
+
+	link_t *link = list_first(&sess->exch_list);
+	if (link == NULL)
+		return NULL;
+
+	list_remove(link);
+	return list_get_instance(link, async_exch_t, sess_link);
+}
+
+/** Create an exchange with a new cloned phone.
+ *
+ * @param sess Session.
+ *
+ * @return New exchange or NULL if the phone cannot be cloned.
+ *
+ */
+static async_exch_t *async_sess_exch_connect(async_sess_t *sess)
+{
+	cap_phone_handle_t phone;
+	errno_t rc = async_connect_me_to_internal(sess->phone, sess->arg1,
+	    sess->arg2, sess->arg3, 0, &phone);
+	if (rc != EOK)
+		return NULL;
+
+	async_exch_t *exch = (async_exch_t *) malloc(sizeof(async_exch_t));
+	if (exch == NULL) {
+		async_hangup_internal(phone);
+		return NULL;
+	}
+
+	link_initialize(&exch->sess_link);
+	exch->sess = sess;
+	exch->phone = phone;
+	return exch;
+}
+
+/** Make room for a new phone.
+ *
+ * Look for an inactive exchange of another session which has more cloned
+ * phones than its minimum and hang it up. The async_sess_mutex must be
+ * held. Sessions which are busy are skipped, which is reported so that
+ * the caller does not wait for a wakeup that may have been missed.
+ *
+ * @param self Session which needs the phone.
+ * @param busy Set to true if some session was skipped.
+ *
+ * @return True if a phone was hung up.
+ *
+ */
+static bool async_sess_reclaim_phone(async_sess_t *self, bool *busy)
+{
+	assert(fibril_mutex_is_locked(&async_sess_mutex));
+
+	*busy = false;
+
+	list_foreach(pooled_sess_list, pool_link, async_sess_t, sess) {
+		if (sess == self)
+			continue;
+
+		if (!fibril_mutex_trylock(&sess->exch_mutex)) {
+			*busy = true;
+			continue;
+		}
+
+		async_exch_t *exch = NULL;
+		if (sess->phones > sess->phones_min) {
+			exch = async_sess_exch_take(sess);
+			if (exch != NULL) {
+				sess->phones--;
+				sess->stats.phones_reclaimed++;
+			}
+		}
+
+		fibril_mutex_unlock(&sess->exch_mutex);
+
+		if (exch != NULL) {
+			async_hangup_internal(exch->phone);
+			free(exch);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/** Start new exchange in a session with parallel exchange management.
+ *
+ * Inactive exchanges of the session are reused first. Otherwise a new
+ * phone is cloned unless the session already has its maximum number of
+ * phones. When the kernel runs out of phones, an inactive phone of
+ * another session is hung up to make room.
+ *
+ * @param sess Session.
+ *
+ * @return New exchange.
+ *
+ */
+static async_exch_t *async_exchange_begin_parallel(async_sess_t *sess)
+{
+	struct timeval start;
+	bool waited = false;
+	async_exch_t *exch;
+
+	if (!sess->pooled) {
+		fibril_mutex_lock(&async_sess_mutex);
+		if (!sess->pooled) {
+			list_append(&sess->pool_link, &pooled_sess_list);
+			sess->pooled = true;
+		}
+		fibril_mutex_unlock(&async_sess_mutex);
+	}
+
+	fibril_mutex_lock(&sess->exch_mutex);
+
+	while (true) {
+		exch = async_sess_exch_take(sess);
+		if (exch != NULL)
+			break;
+
+		if ((sess->phones_max != 0) &&
+		    (sess->phones >= sess->phones_max)) {
+			/*
+			 * Wait for an exchange of this session to finish.
+			 */
+			if (!waited) {
+				getuptime(&start);
+				waited = true;
+			}
+
+			fibril_condvar_wait(&sess->exch_cv, &sess->exch_mutex);
+			continue;
+		}
+
+		sess->phones++;
+		fibril_mutex_unlock(&sess->exch_mutex);
+
+		exch = async_sess_exch_connect(sess);
+
+		fibril_mutex_lock(&sess->exch_mutex);
+		if (exch != NULL) {
+			sess->stats.phones_opened++;
+			break;
+		}
+
+		sess->phones--;
+		fibril_mutex_unlock(&sess->exch_mutex);
+
+		/*
+		 * We did not manage to connect a new phone. But we can try
+		 * to close some of the currently inactive connections in
+		 * other sessions and try again. If there is none, wait for
+		 * a phone to become available.
+		 */
+		fibril_mutex_lock(&async_sess_mutex);
+		__atomic_add_fetch(&avail_phone_waiters, 1, __ATOMIC_SEQ_CST);
+
+		bool busy;
+		if (!async_sess_reclaim_phone(sess, &busy)) {
+			if (!waited) {
+				getuptime(&start);
+				waited = true;
+			}
+
+			if (busy) {
+				fibril_mutex_unlock(&async_sess_mutex);
+				fibril_yield();
+				fibril_mutex_lock(&async_sess_mutex);
+			} else {
+				fibril_condvar_wait(&avail_phone_cv,
+				    &async_sess_mutex);
+			}
+		}
+
+		__atomic_sub_fetch(&avail_phone_waiters, 1, __ATOMIC_SEQ_CST);
+		fibril_mutex_unlock(&async_sess_mutex);
+
+		fibril_mutex_lock(&sess->exch_mutex);
+	}
+
+	if (waited) {
+		struct timeval now;
+		getuptime(&now);
+		sess->stats.exch_waited++;
+		sess->stats.wait_usec += tv_sub_diff(&now, &start);
+	}
+
+	sess->stats.exch_begun++;
+	fibril_mutex_unlock(&sess->exch_mutex);
+
+	return exch;
+}
+
 /** Start new exchange in a session.
  *
  * @param session Session.
@@ -1036,78 +1301,25 @@ async_exch_t *async_exchange_begin(async_sess_t *sess)
 
 	async_exch_t *exch = NULL;
 
-	fibril_mutex_lock(&async_sess_mutex);
-
-	if (!list_empty(&sess->exch_list)) {
-		/*
-		 * There are inactive exchanges in the session.
-		 */
-		exch = (async_exch_t *)
-		    list_get_instance(list_first(&sess->exch_list),
-		    async_exch_t, sess_link);
-
-		list_remove(&exch->sess_link);
-		list_remove(&exch->global_link);
-	} else {
-		/*
-		 * There are no available exchanges in the session.
-		 */
+	if (mgmt == EXCHANGE_PARALLEL) {
+		exch = async_exchange_begin_parallel(sess);
+	} else if ((mgmt == EXCHANGE_ATOMIC) ||
+	    (mgmt == EXCHANGE_SERIALIZE)) {
+		fibril_mutex_lock(&sess->exch_mutex);
+		exch = async_sess_exch_take(sess);
+		sess->stats.exch_begun++;
+		fibril_mutex_unlock(&sess->exch_mutex);
 
-		if ((mgmt == EXCHANGE_ATOMIC) ||
-		    (mgmt == EXCHANGE_SERIALIZE)) {
+		if (exch == NULL) {
 			exch = (async_exch_t *) malloc(sizeof(async_exch_t));
 			if (exch != NULL) {
 				link_initialize(&exch->sess_link);
-				link_initialize(&exch->global_link);
 				exch->sess = sess;
 				exch->phone = sess->phone;
 			}
-		} else if (mgmt == EXCHANGE_PARALLEL) {
-			cap_phone_handle_t phone;
-			errno_t rc;
-
-		retry:
-			/*
-			 * Make a one-time attempt to connect a new data phone.
-			 */
-			rc = async_connect_me_to_internal(sess->phone, sess->arg1,
-			    sess->arg2, sess->arg3, 0, &phone);
-			if (rc == EOK) {
-				exch = (async_exch_t *) malloc(sizeof(async_exch_t));
-				if (exch != NULL) {
-					link_initialize(&exch->sess_link);
-					link_initialize(&exch->global_link);
-					exch->sess = sess;
-					exch->phone = phone;
-				} else
-					async_hangup_internal(phone);
-			} else if (!list_empty(&inactive_exch_list)) {
-				/*
-				 * We did not manage to connect a new phone. But we
-				 * can try to close some of the currently inactive
-				 * connections in other sessions and try again.
-				 */
-				exch = (async_exch_t *)
-				    list_get_instance(list_first(&inactive_exch_list),
-				    async_exch_t, global_link);
-
-				list_remove(&exch->sess_link);
-				list_remove(&exch->global_link);
-				async_hangup_internal(exch->phone);
-				free(exch);
-				goto retry;
-			} else {
-				/*
-				 * Wait for a phone to become available.
-				 */
-				fibril_condvar_wait(&avail_phone_cv, &async_sess_mutex);
-				goto retry;
-			}
 		}
 	}
 
-	fibril_mutex_unlock(&async_sess_mutex);
-
 	if (exch != NULL) {
 		atomic_inc(&sess->refcnt);
 
@@ -1140,13 +1352,58 @@ void async_exchange_end(async_exch_t *exch)
 	if (mgmt == EXCHANGE_SERIALIZE)
 		fibril_mutex_unlock(&sess->mutex);
 
-	fibril_mutex_lock(&async_sess_mutex);
-
+	fibril_mutex_lock(&sess->exch_mutex);
 	list_append(&exch->sess_link, &sess->exch_list);
-	list_append(&exch->global_link, &inactive_exch_list);
-	fibril_condvar_signal(&avail_phone_cv);
+	fibril_condvar_signal(&sess->exch_cv);
+	fibril_mutex_unlock(&sess->exch_mutex);
 
-	fibril_mutex_unlock(&async_sess_mutex);
+	/*
+	 * Only take the global mutex if some other session
+	 * is waiting for a phone.
+	 */
+	if ((mgmt == EXCHANGE_PARALLEL) &&
+	    (__atomic_load_n(&avail_phone_waiters, __ATOMIC_SEQ_CST) > 0)) {
+		fibril_mutex_lock(&async_sess_mutex);
+		fibril_condvar_broadcast(&avail_phone_cv);
+		fibril_mutex_unlock(&async_sess_mutex);
+	}
+}
+
+/** Set the limits of the phone pool of a session.
+ *
+ * Applies to sessions with parallel exchange management, which clone
+ * a phone for each concurrent exchange. Up to @a min inactive phones
+ * are kept even when other sessions run out of phones. Once the session
+ * has @a max phones, new exchanges wait for a running one to finish
+ * instead of cloning more phones.
+ *
+ * @param sess Session.
+ * @param min  Number of phones to keep.
+ * @param max  Maximum number of phones or zero for no limit.
+ *
+ */
+void async_sess_pool_set(async_sess_t *sess, size_t min, size_t max)
+{
+	assert((max == 0) || (min <= max));
+
+	fibril_mutex_lock(&sess->exch_mutex);
+	sess->phones_min = min;
+	sess->phones_max = max;
+	fibril_condvar_broadcast(&sess->exch_cv);
+	fibril_mutex_unlock(&sess->exch_mutex);
+}
+
+/** Get exchange statistics of a session.
+ *
+ * @param sess  Session.
+ * @param stats Place to store the statistics.
+ *
+ */
+void async_sess_stats(async_sess_t *sess, async_sess_stats_t *stats)
+{
+	fibril_mutex_lock(&sess->exch_mutex);
+	*stats = sess->stats;
+	fibril_mutex_unlock(&sess->exch_mutex);
 }
 
 /** Wrapper for IPC_M_SHARE_IN calls using the async framework.
@@ -0,0 +1,486 @@
+/*
+ * Copyright (c) 2018 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup libc
+ * @{
+ */
+/** @file
+ * @brief Shared memory ring buffer channel.
+ *
+ * A ring is a single-producer/single-consumer byte queue living in an
+ * address space area shared by two tasks. The area is established once
+ * using the async framework (IPC_M_SHARE_OUT), afterwards the data flows
+ * through the shared memory only.
+ *
+ * Each side sleeps on a futex placed in the shared area (a doorbell) when
+ * it cannot make progress and announces this in a waiting flag. The other
+ * side rings the doorbell only if it finds the flag set, so as long as
+ * neither side has to wait, the transfers require no syscalls at all.
+ *
+ * Note that the doorbells are futexes, not fibril synchronization
+ * primitives, so the blocking functions put the whole calling thread
+ * to sleep. Fibril-based servers should use the non-blocking functions
+ * or call the blocking ones from a dedicated thread.
+ */
+
+#include <async.h>
+#include <async_ring.h>
+#include <as.h>
+#include <abi/mm/as.h>
+#include <align.h>
+#include <errno.h>
+#include <futex.h>
+#include <macros.h>
+#include <mem.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/** Magic number identifying the shared ring header */
+#define RING_MAGIC  0x474e4952
+
+/** Largest supported ring capacity */
+#define RING_SIZE_MAX  ((size_t) 1 << 30)
+
+/** Ring header at the beginning of the shared area */
+typedef struct {
+	uint32_t magic;
+	/** Capacity of the data area (power of two) */
+	uint32_t size;
+
+	/** Producer position (free running), written by the producer only */
+	uint32_t head __attribute__((aligned(64)));
+	/** Producer waits for space */
+	uint32_t writer_waiting;
+	/** Rung by the consumer when the producer is waiting */
+	futex_t space_bell;
+
+	/** Consumer position (free running), written by the consumer only */
+	uint32_t tail __attribute__((aligned(64)));
+	/** Consumer waits for data */
+	uint32_t reader_waiting;
+	/** Rung by the producer when the consumer is waiting */
+	futex_t data_bell;
+
+	/** One of the sides has destroyed the ring */
+	uint32_t closed __attribute__((aligned(64)));
+
+	uint8_t data[] __attribute__((aligned(64)));
+} ring_shm_t;
+
+/** Local view of a ring */
+struct async_ring {
+	/** Shared area */
+	ring_shm_t *shm;
+	/**
+	 * Capacity of the data area. This is a local copy, the peer
+	 * cannot be trusted not to change the shared one.
+	 */
+	uint32_t size;
+};
+
+/** Ring the doorbell if the other side is waiting for it.
+ *
+ * @param waiting Waiting flag of the other side.
+ * @param bell    Doorbell of the other side.
+ */
+static void ring_notify(uint32_t *waiting, futex_t *bell)
+{
+	/* Order the update of the ring with the check of the flag */
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+	uint32_t expected = 1;
+	if (__atomic_compare_exchange_n(waiting, &expected, 0, false,
+	    __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+		futex_up(bell);
+}
+
+/** Sleep on a doorbell unless the condition has become true meanwhile.
+ *
+ * @param ring    Ring.
+ * @param waiting Waiting flag of the calling side.
+ * @param bell    Doorbell of the calling side.
+ * @param ready   Function checking whether the caller can make progress.
+ */
+static void ring_wait(async_ring_t *ring, uint32_t *waiting, futex_t *bell,
+    bool (*ready)(async_ring_t *))
+{
+	__atomic_store_n(waiting, 1, __ATOMIC_SEQ_CST);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+	if (ready(ring)) {
+		/*
+		 * If the other side has cleared the flag in the meantime,
+		 * it has also rung the bell and the token must be consumed.
+		 */
+		uint32_t expected = 1;
+		if (__atomic_compare_exchange_n(waiting, &expected, 0, false,
+		    __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+			return;
+	}
+
+	futex_down(bell);
+}
+
+/** Get the number of bytes in the ring or -1 if the ring is corrupted. */
+static int64_t ring_used(async_ring_t *ring)
+{
+	uint32_t head = __atomic_load_n(&ring->shm->head, __ATOMIC_ACQUIRE);
+	uint32_t tail = __atomic_load_n(&ring->shm->tail, __ATOMIC_ACQUIRE);
+	uint32_t used = head - tail;
+
+	if (used > ring->size)
+		return -1;
+
+	return used;
+}
+
+static bool ring_closed(async_ring_t *ring)
+{
+	return __atomic_load_n(&ring->shm->closed, __ATOMIC_ACQUIRE) != 0;
+}
+
+static bool ring_can_write(async_ring_t *ring)
+{
+	return (ring_used(ring) != ring->size) || (ring_closed(ring));
+}
+
+static bool ring_can_read(async_ring_t *ring)
+{
+	return (ring_used(ring) != 0) || (ring_closed(ring));
+}
+
+/** Create a ring and share it with the other side.
+ *
+ * The call is made over the exchange as IPC_M_SHARE_OUT, the other
+ * side is expected to accept it using async_ring_accept(). Usually
+ * the caller first sends a protocol-specific request over the same
+ * exchange, just like with async_share_out_start().
+ *
+ * @param exch  Exchange for sending the ring.
+ * @param size  Capacity of the ring in bytes (power of two).
+ * @param rring Place to store the new ring to.
+ *
+ * @return EOK on success.
+ * @return EINVAL if the size is not valid.
+ * @return ENOMEM if out of memory.
+ * @return Error code returned by async_share_out_start() otherwise.
+ *
+ */
+errno_t async_ring_create(async_exch_t *exch, size_t size,
+    async_ring_t **rring)
+{
+	if ((size == 0) || (size > RING_SIZE_MAX) || ((size & (size - 1)) != 0))
+		return EINVAL;
+
+	async_ring_t *ring = malloc(sizeof(async_ring_t));
+	if (ring == NULL)
+		return ENOMEM;
+
+	size_t area_size = ALIGN_UP(sizeof(ring_shm_t) + size, PAGE_SIZE);
+	ring_shm_t *shm = as_area_create(AS_AREA_ANY, area_size,
+	    AS_AREA_READ | AS_AREA_WRITE | AS_AREA_CACHEABLE, AS_AREA_UNPAGED);
+	if (shm == AS_MAP_FAILED) {
+		free(ring);
+		return ENOMEM;
+	}
+
+	/* Touch the whole area so that both sides map the same frames */
+	memset(shm, 0, area_size);
+
+	shm->magic = RING_MAGIC;
+	shm->size = size;
+	futex_initialize_shared(&shm->space_bell, 0);
+	futex_initialize_shared(&shm->data_bell, 0);
+
+	errno_t rc = async_share_out_start(exch, shm,
+	    AS_AREA_READ | AS_AREA_WRITE | AS_AREA_CACHEABLE);
+	if (rc != EOK) {
+		as_area_destroy(shm);
+		free(ring);
+		return rc;
+	}
+
+	ring->shm = shm;
+	ring->size = size;
+
+	*rring = ring;
+	return EOK;
+}
+
+/** Accept a ring created by the other side.
+ *
+ * @param rring Place to store the accepted ring to.
+ *
+ * @return EOK on success.
+ * @return EINVAL if the call is not a valid ring.
+ * @return ENOMEM if out of memory.
+ * @return Error code returned by async_share_out_finalize() otherwise.
+ *
+ */
+errno_t async_ring_accept(async_ring_t **rring)
+{
+	cap_call_handle_t chandle;
+	size_t area_size;
+	unsigned int flags;
+
+	if (!async_share_out_receive(&chandle, &area_size, &flags)) {
+		async_answer_0(chandle, EINVAL);
+		return EINVAL;
+	}
+
+	if ((area_size < sizeof(ring_shm_t)) ||
+	    ((flags & (AS_AREA_READ | AS_AREA_WRITE)) !=
+	    (AS_AREA_READ | AS_AREA_WRITE))) {
+		async_answer_0(chandle, EINVAL);
+		return EINVAL;
+	}
+
+	async_ring_t *ring = malloc(sizeof(async_ring_t));
+	if (ring == NULL) {
+		async_answer_0(chandle, ENOMEM);
+		return ENOMEM;
+	}
+
+	ring_shm_t *shm;
+	errno_t rc = async_share_out_finalize(chandle, (void **) &shm);
+	if (rc != EOK) {
+		free(ring);
+		return rc;
+	}
+
+	uint32_t size = shm->size;
+	if ((shm->magic != RING_MAGIC) || (size == 0) ||
+	    ((size & (size - 1)) != 0) ||
+	    (size > area_size - sizeof(ring_shm_t))) {
+		as_area_destroy(shm);
+		free(ring);
+		return EINVAL;
+	}
+
+	ring->shm = shm;
+	ring->size = size;
+
+	*rring = ring;
+	return EOK;
+}
+
+/** Close a ring without destroying the local end.
+ *
+ * The other side is treated as if the ring was destroyed. On the local
+ * side, blocked reads and writes are woken up and, just like further
+ * ones, behave as if the other side has destroyed the ring. This allows
+ * one thread to stop another thread using the ring before destroying it.
+ *
+ * @param ring Ring.
+ */
+void async_ring_close(async_ring_t *ring)
+{
+	ring_shm_t *shm = ring->shm;
+
+	__atomic_store_n(&shm->closed, 1, __ATOMIC_RELEASE);
+	ring_notify(&shm->reader_waiting, &shm->data_bell);
+	ring_notify(&shm->writer_waiting, &shm->space_bell);
+}
+
+/** Destroy the local end of a ring.
+ *
+ * The other side is woken up and its further reads return EPIPE once
+ * the ring is drained, its further writes return EPIPE immediately.
+ *
+ * @param ring Ring.
+ */
+void async_ring_destroy(async_ring_t *ring)
+{
+	async_ring_close(ring);
+
+	as_area_destroy(ring->shm);
+	free(ring);
+}
+
+/** Get the number of bytes that can be written into a ring.
+ *
+ * Since there is only one producer, a subsequent async_ring_try_write()
+ * by the producer is guaranteed to write at least this many bytes
+ * unless the ring gets closed meanwhile.
+ *
+ * @param ring Ring.
+ *
+ * @return Number of free bytes, zero if the ring is closed or corrupted.
+ */
+size_t async_ring_space(async_ring_t *ring)
+{
+	int64_t used = ring_used(ring);
+	if ((used < 0) || (ring_closed(ring)))
+		return 0;
+
+	return ring->size - (size_t) used;
+}
+
+/** Write as much data into a ring as fits without blocking.
+ *
+ * @param ring Ring.
+ * @param buf  Data to write.
+ * @param size Size of the data.
+ *
+ * @return Number of bytes written.
+ */
+size_t async_ring_try_write(async_ring_t *ring, const void *buf, size_t size)
+{
+	ring_shm_t *shm = ring->shm;
+
+	int64_t used = ring_used(ring);
+	if ((used < 0) || (ring_closed(ring)))
+		return 0;
+
+	size_t count = min(size, ring->size - (size_t) used);
+	if (count == 0)
+		return 0;
+
+	uint32_t head = __atomic_load_n(&shm->head, __ATOMIC_RELAXED);
+	size_t pos = head & (ring->size - 1);
+	size_t first = min(count, ring->size - pos);
+
+	memcpy(shm->data + pos, buf, first);
+	memcpy(shm->data, (const uint8_t *) buf + first, count - first);
+
+	__atomic_store_n(&shm->head, head + count, __ATOMIC_RELEASE);
+	ring_notify(&shm->reader_waiting, &shm->data_bell);
+
+	return count;
+}
+
+/** Read as much data from a ring as available without blocking.
+ *
+ * @param ring Ring.
+ * @param buf  Buffer for the data.
+ * @param size Size of the buffer.
+ *
+ * @return Number of bytes read.
+ */
+size_t async_ring_try_read(async_ring_t *ring, void *buf, size_t size)
+{
+	ring_shm_t *shm = ring->shm;
+
+	int64_t used = ring_used(ring);
+	if (used < 0)
+		return 0;
+
+	size_t count = min(size, (size_t) used);
+	if (count == 0)
+		return 0;
+
+	uint32_t tail = __atomic_load_n(&shm->tail, __ATOMIC_RELAXED);
+	size_t pos = tail & (ring->size - 1);
+	size_t first = min(count, ring->size - pos);
+
+	memcpy(buf, shm->data + pos, first);
+	memcpy((uint8_t *) buf + first, shm->data, count - first);
+
+	__atomic_store_n(&shm->tail, tail + count, __ATOMIC_RELEASE);
+	ring_notify(&shm->writer_waiting, &shm->space_bell);
+
+	return count;
+}
+
+/** Write data into a ring, blocking until all of it is written.
+ *
+ * @param ring Ring.
+ * @param buf  Data to write.
+ * @param size Size of the data.
+ *
+ * @return EOK on success.
+ * @return EPIPE if the other side has destroyed the ring.
+ * @return EIO if the ring is corrupted.
+ */
+errno_t async_ring_write(async_ring_t *ring, const void *buf, size_t size)
+{
+	const uint8_t *data = buf;
+
+	while (size > 0) {
+		size_t count = async_ring_try_write(ring, data, size);
+		data += count;
+		size -= count;
+
+		if (size == 0)
+			break;
+
+		if (ring_closed(ring))
+			return EPIPE;
+
+		if (ring_used(ring) < 0)
+			return EIO;
+
+		if (count == 0)
+			ring_wait(ring, &ring->shm->writer_waiting,
+			    &ring->shm->space_bell, ring_can_write);
+	}
+
+	return EOK;
+}
+
+/** Read data from a ring, blocking until at least some data is available.
+ *
+ * @param ring   Ring.
+ * @param buf    Buffer for the data.
+ * @param size   Size of the buffer.
+ * @param nread  Place to store the number of bytes read to.
+ *
+ * @return EOK on success.
+ * @return EPIPE if the other side has destroyed the ring and there
+ *         is no more data.
+ * @return EIO if the ring is corrupted.
+ */
+errno_t async_ring_read(async_ring_t *ring, void *buf, size_t size,
+    size_t *nread)
+{
+	*nread = 0;
+
+	if (size == 0)
+		return EOK;
+
+	while (true) {
+		size_t count = async_ring_try_read(ring, buf, size);
+		if (count > 0) {
+			*nread = count;
+			return EOK;
+		}
+
+		if (ring_used(ring) < 0)
+			return EIO;
+
+		if (ring_closed(ring))
+			return EPIPE;
+
+		ring_wait(ring, &ring->shm->reader_waiting,
+		    &ring->shm->data_bell, ring_can_read);
+	}
+}
+
+/** @}
+ */
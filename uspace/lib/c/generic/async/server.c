@@ -73,6 +73,7 @@
  *
  *   main()
  *   {
+ *     async_create_manager_threads(0);
  *     async_manager();
  *   }
  *
@@ -105,6 +106,7 @@
 #include <futex.h>
 #include <fibril.h>
 #include <adt/hash_table.h>
+#include <adt/cht.h>
 #include <adt/hash.h>
 #include <adt/list.h>
 #include <assert.h>
@@ -116,13 +118,21 @@
 #include <mem.h>
 #include <stdlib.h>
 #include <macros.h>
+#include <sysinfo.h>
+#include <thread.h>
+#include <slab.h>
+#include <abi/sysinfo.h>
 #include <as.h>
 #include <abi/mm/as.h>
+#include <rcu.h>
 #include "../private/libc.h"
 #include "../private/fibril.h"
 
 #define DPRINTF(...)  ((void) 0)
 
+/** Maximum number of calls picked up by the manager in one syscall */
+#define ASYNC_MANAGER_BATCH  8
+
 /** Async framework global futex */
 futex_t async_futex = FUTEX_INITIALIZER;
 
@@ -138,7 +148,7 @@ typedef struct {
 
 /* Client connection data */
 typedef struct {
-	ht_link_t link;
+	cht_link_t link;
 
 	task_id_t in_task_id;
 	atomic_t refcnt;
@@ -204,6 +214,9 @@ typedef struct {
 	list_t msg_list;
 } notification_t;
 
+static SLAB_CACHE_INITIALIZE(msg_cache, "msg_t", sizeof(msg_t), 0, NULL,
+    NULL);
+
 /** Identifier of the incoming connection handled by the current fibril. */
 static fibril_local connection_t *fibril_connection;
 
@@ -233,8 +246,25 @@ void async_set_client_data_destructor(async_client_data_dtor_t dtor)
 	async_client_data_destroy = dtor;
 }
 
-static futex_t client_futex = FUTEX_INITIALIZER;
-static hash_table_t client_hash_table;
+/** Stack size of connection fibrils. */
+static size_t async_connection_stack_size = FIBRIL_DFLT_STK_SIZE;
+
+/** Set the stack size of connection fibrils.
+ *
+ * Servers whose connection handlers are known to use little stack can
+ * save memory by using smaller stacks. Use fibril_stack_stats() to find
+ * out how much stack the handlers actually use.
+ *
+ * @param size Stack size in bytes or FIBRIL_DFLT_STK_SIZE.
+ *
+ */
+void async_set_connection_stack_size(size_t size)
+{
+	async_connection_stack_size = size;
+}
+
+/** Concurrent hash table of clients, looked up without locking. */
+static cht_t client_hash_table;
 
 // TODO: lockfree notification_queue?
 static futex_t notification_futex = FUTEX_INITIALIZER;
@@ -242,15 +272,16 @@ static hash_table_t notification_hash_table;
 static LIST_INITIALIZE(notification_queue);
 static FIBRIL_SEMAPHORE_INITIALIZE(notification_semaphore, 0);
 
-static LIST_INITIALIZE(notification_freelist);
-static long notification_freelist_total = 0;
-static long notification_freelist_used = 0;
+static SLAB_CACHE_INITIALIZE(notification_msg_cache, "notification_msg_t",
+    sizeof(notification_msg_t), 0, NULL, NULL);
 
 static sysarg_t notification_avail = 0;
 
 /* The remaining structures are guarded by async_futex. */
 static hash_table_t conn_hash_table;
-static LIST_INITIALIZE(timeout_list);
+
+/** Pending timeouts ordered by expiration time. */
+static odict_t timeout_odict;
 
 static size_t client_key_hash(void *key)
 {
@@ -258,26 +289,38 @@ static size_t client_key_hash(void *key)
 	return in_task_id;
 }
 
-static size_t client_hash(const ht_link_t *item)
+static size_t client_hash(const cht_link_t *item)
 {
-	client_t *client = hash_table_get_inst(item, client_t, link);
+	client_t *client = cht_get_inst(item, client_t, link);
 	return client_key_hash(&client->in_task_id);
 }
 
-static bool client_key_equal(void *key, const ht_link_t *item)
+static bool client_equal(const cht_link_t *item1, const cht_link_t *item2)
+{
+	client_t *client1 = cht_get_inst(item1, client_t, link);
+	client_t *client2 = cht_get_inst(item2, client_t, link);
+	return client1->in_task_id == client2->in_task_id;
+}
+
+static bool client_key_equal(void *key, const cht_link_t *item)
 {
 	task_id_t in_task_id = *(task_id_t *) key;
-	client_t *client = hash_table_get_inst(item, client_t, link);
+	client_t *client = cht_get_inst(item, client_t, link);
 	return in_task_id == client->in_task_id;
 }
 
+static void client_remove_callback(cht_link_t *item)
+{
+	free(cht_get_inst(item, client_t, link));
+}
+
 /** Operations for the client hash table. */
-static hash_table_ops_t client_hash_table_ops = {
+static cht_ops_t client_hash_table_ops = {
 	.hash = client_hash,
 	.key_hash = client_key_hash,
+	.equal = client_equal,
 	.key_equal = client_key_equal,
-	.equal = NULL,
-	.remove_callback = NULL
+	.remove_callback = client_remove_callback
 };
 
 typedef struct {
@@ -334,51 +377,114 @@ static hash_table_ops_t conn_hash_table_ops = {
 	.remove_callback = NULL
 };
 
+/** Add a reference to a client unless it is being destroyed. */
+static bool async_client_addref(client_t *client)
+{
+	atomic_count_t refcnt;
+
+	do {
+		refcnt = atomic_get(&client->refcnt);
+		if (refcnt == 0)
+			return false;
+	} while (!cas(&client->refcnt, refcnt, refcnt + 1));
+
+	return true;
+}
+
 static client_t *async_client_get(task_id_t client_id, bool create)
 {
 	client_t *client = NULL;
+	client_t *new_client = NULL;
+
+	/* Lookups may come from fibrils which do not use RCU otherwise. */
+	bool registered = rcu_fibril_registered();
+	if (!registered)
+		rcu_register_fibril();
 
-	futex_lock(&client_futex);
-	ht_link_t *link = hash_table_find(&client_hash_table, &client_id);
-	if (link) {
-		client = hash_table_get_inst(link, client_t, link);
-		atomic_inc(&client->refcnt);
-	} else if (create) {
-		// TODO: move the malloc out of critical section
-		client = malloc(sizeof(client_t));
-		if (client) {
-			client->in_task_id = client_id;
-			client->data = async_client_data_create();
-
-			atomic_set(&client->refcnt, 1);
-			hash_table_insert(&client_hash_table, &client->link);
+	while (true) {
+		rcu_read_lock();
+
+		cht_link_t *link = cht_find(&client_hash_table, &client_id);
+		if (link) {
+			client = cht_get_inst(link, client_t, link);
+			bool alive = async_client_addref(client);
+			rcu_read_unlock();
+
+			if (alive)
+				break;
+
+			/* Wait until the dying client is removed from the table. */
+			client = NULL;
+			if (!create)
+				break;
+
+			fibril_yield();
+			continue;
 		}
+
+		rcu_read_unlock();
+
+		if (!create)
+			break;
+
+		if (!new_client) {
+			new_client = malloc(sizeof(client_t));
+			if (!new_client)
+				break;
+
+			new_client->in_task_id = client_id;
+			new_client->data = async_client_data_create();
+			atomic_set(&new_client->refcnt, 1);
+		}
+
+		cht_link_t *dup_item;
+		rcu_read_lock();
+		bool inserted = cht_insert_unique(&client_hash_table,
+		    &new_client->link, &dup_item);
+		rcu_read_unlock();
+
+		if (inserted) {
+			client = new_client;
+			new_client = NULL;
+			break;
+		}
+
+		/* Somebody else created the client in the meantime. */
 	}
 
-	futex_unlock(&client_futex);
+	if (new_client) {
+		if (new_client->data)
+			async_client_data_destroy(new_client->data);
+
+		free(new_client);
+	}
+
+	if (!registered)
+		rcu_deregister_fibril();
+
 	return client;
 }
 
 static void async_client_put(client_t *client)
 {
-	bool destroy;
+	if (atomic_predec(&client->refcnt) != 0)
+		return;
 
-	futex_lock(&client_futex);
+	/* Nobody can get a new reference now. */
+	if (client->data)
+		async_client_data_destroy(client->data);
 
-	if (atomic_predec(&client->refcnt) == 0) {
-		hash_table_remove(&client_hash_table, &client->in_task_id);
-		destroy = true;
-	} else
-		destroy = false;
+	bool registered = rcu_fibril_registered();
+	if (!registered)
+		rcu_register_fibril();
 
-	futex_unlock(&client_futex);
+	/* The client is freed once the current readers are done with it. */
+	rcu_read_lock();
+	cht_remove_item(&client_hash_table, &client->link);
+	rcu_read_unlock();
 
-	if (destroy) {
-		if (client->data)
-			async_client_data_destroy(client->data);
-
-		free(client);
-	}
+	if (!registered)
+		rcu_deregister_fibril();
 }
 
 /** Wrapper for client connection fibril.
@@ -445,7 +551,7 @@ static errno_t connection_fibril(void *arg)
 
 		list_remove(&msg->link);
 		ipc_answer_0(msg->call.cap_handle, EHANGUP);
-		free(msg);
+		slab_free(&msg_cache, msg);
 	}
 
 	/*
@@ -502,7 +608,8 @@ static fid_t async_new_connection(task_id_t in_task_id, sysarg_t in_phone_hash,
 
 	/* We will activate the fibril ASAP */
 	conn->wdata.active = true;
-	conn->wdata.fid = fibril_create(connection_fibril, conn);
+	conn->wdata.fid = fibril_create_generic(connection_fibril, conn,
+	    async_connection_stack_size);
 
 	if (conn->wdata.fid == 0) {
 		free(conn);
@@ -600,7 +707,28 @@ static hash_table_ops_t notification_hash_table_ops = {
 	.remove_callback = NULL
 };
 
+static void *timeout_getkey(odlink_t *odlink)
+{
+	awaiter_t *wd = odict_get_instance(odlink, awaiter_t, to_event.link);
+	return &wd->to_event.expires;
+}
+
+static int timeout_cmp(void *a, void *b)
+{
+	struct timeval *ta = (struct timeval *) a;
+	struct timeval *tb = (struct timeval *) b;
+
+	if (tv_gt(ta, tb))
+		return 1;
+	if (tv_gt(tb, ta))
+		return -1;
+	return 0;
+}
+
 /** Sort in current fibril's timeout request.
+ *
+ * Timeouts with the same expiration time fire in the order in
+ * which they were inserted.
  *
  * @param wd Wait data of the current fibril.
  *
@@ -612,18 +740,24 @@ void async_insert_timeout(awaiter_t *wd)
 	wd->to_event.occurred = false;
 	wd->to_event.inlist = true;
 
-	link_t *tmp = timeout_list.head.next;
-	while (tmp != &timeout_list.head) {
-		awaiter_t *cur =
-		    list_get_instance(tmp, awaiter_t, to_event.link);
+	odict_insert(&wd->to_event.link, &timeout_odict, NULL);
+}
 
-		if (tv_gteq(&cur->to_event.expires, &wd->to_event.expires))
-			break;
+/** Cancel current fibril's timeout request, if there is one.
+ *
+ * The async_futex must be held.
+ *
+ * @param wd Wait data of the current fibril.
+ *
+ */
+void async_remove_timeout(awaiter_t *wd)
+{
+	assert(wd);
 
-		tmp = tmp->next;
+	if (wd->to_event.inlist) {
+		odict_remove(&wd->to_event.link);
+		wd->to_event.inlist = false;
 	}
-
-	list_insert_before(&wd->to_event.link, tmp);
 }
 
 /** Try to route a call to an appropriate connection fibril.
@@ -655,7 +789,7 @@ static bool route_call(ipc_call_t *call)
 
 	connection_t *conn = hash_table_get_inst(link, connection_t, link);
 
-	msg_t *msg = malloc(sizeof(*msg));
+	msg_t *msg = slab_alloc(&msg_cache);
 	if (!msg) {
 		futex_unlock(&async_futex);
 		return false;
@@ -670,11 +804,8 @@ static bool route_call(ipc_call_t *call)
 	/* If the connection fibril is waiting for an event, activate it */
 	if (!conn->wdata.active) {
 
-		/* If in timeout list, remove it */
-		if (conn->wdata.to_event.inlist) {
-			conn->wdata.to_event.inlist = false;
-			list_remove(&conn->wdata.to_event.link);
-		}
+		/* If in timeout dictionary, remove it */
+		async_remove_timeout(&conn->wdata);
 
 		conn->wdata.active = true;
 		fibril_add_ready(conn->wdata.fid);
@@ -711,27 +842,15 @@ static errno_t notification_fibril_func(void *arg)
 		assert(m);
 		ipc_call_t calldata = m->calldata;
 
-		notification_freelist_used--;
-
-		if (notification_freelist_total > 64 &&
-		    notification_freelist_total > 2 * notification_freelist_used) {
-			/* Going to free the structure if we have too much. */
-			notification_freelist_total--;
-		} else {
-			/* Otherwise add to freelist. */
-			list_append(&m->link, &notification_freelist);
-			m = NULL;
-		}
-
 		if (list_empty(&notification->msg_list))
 			list_remove(&notification->qlink);
 
 		futex_unlock(&notification_futex);
 
+		slab_free(&notification_msg_cache, m);
+
 		if (handler)
 			handler(&calldata, arg);
-
-		free(m);
 	}
 
 	/* Not reached. */
@@ -765,38 +884,27 @@ static void queue_notification(ipc_call_t *call)
 {
 	assert(call);
 
-	futex_lock(&notification_futex);
-
-	notification_msg_t *m = list_pop(&notification_freelist,
-	    notification_msg_t, link);
-
+	notification_msg_t *m = slab_alloc(&notification_msg_cache);
 	if (!m) {
-		futex_unlock(&notification_futex);
-		m = malloc(sizeof(notification_msg_t));
-		if (!m) {
-			DPRINTF("Out of memory.\n");
-			abort();
-		}
-
-		futex_lock(&notification_futex);
-		notification_freelist_total++;
+		DPRINTF("Out of memory.\n");
+		abort();
 	}
 
+	futex_lock(&notification_futex);
+
 	ht_link_t *link = hash_table_find(&notification_hash_table,
 	    &IPC_GET_IMETHOD(*call));
 	if (!link) {
 		/* Invalid notification. */
 		// TODO: Make sure this can't happen and turn it into assert.
-		notification_freelist_total--;
 		futex_unlock(&notification_futex);
-		free(m);
+		slab_free(&notification_msg_cache, m);
 		return;
 	}
 
 	notification_t *notification =
 	    hash_table_get_inst(link, notification_t, htlink);
 
-	notification_freelist_used++;
 	m->calldata = *call;
 	list_append(&m->link, &notification->msg_list);
 
@@ -899,6 +1007,37 @@ errno_t async_irq_unsubscribe(cap_irq_handle_t ihandle)
 	return ipc_irq_unsubscribe(ihandle);
 }
 
+/** Coalesce IRQ notifications.
+ *
+ * The notification handler receives the number of interrupts merged into
+ * each notification via IPC_GET_IRQ_COUNT() and the payload arguments of
+ * the latest of them.
+ *
+ * @param ihandle  IRQ capability handle.
+ * @param holdoff  Minimum interval between two notifications, 0 for no
+ *                 rate cap.
+ *
+ * @return Zero on success or an error code.
+ *
+ */
+errno_t async_irq_coalesce(cap_irq_handle_t ihandle, useconds_t holdoff)
+{
+	return ipc_irq_coalesce(ihandle, holdoff);
+}
+
+/** Deliver the interrupt of an IRQ capability to a single CPU.
+ *
+ * @param ihandle  IRQ capability handle.
+ * @param cpu      ID of the target CPU.
+ *
+ * @return Zero on success or an error code.
+ *
+ */
+errno_t async_irq_set_affinity(cap_irq_handle_t ihandle, unsigned int cpu)
+{
+	return ipc_irq_set_affinity(ihandle, cpu);
+}
+
 /** Subscribe to event notifications.
  *
  * @param evno    Event type to subscribe.
@@ -1036,7 +1175,7 @@ cap_call_handle_t async_get_call_timeout(ipc_call_t *call, suseconds_t usecs)
 
 	cap_call_handle_t chandle = msg->call.cap_handle;
 	*call = msg->call;
-	free(msg);
+	slab_free(&msg_cache, msg);
 
 	futex_unlock(&async_futex);
 	return chandle;
@@ -1133,10 +1272,10 @@ static suseconds_t handle_expired_timeouts(unsigned int *flags)
 
 	bool fired = false;
 
-	link_t *cur = list_first(&timeout_list);
+	odlink_t *cur = odict_first(&timeout_odict);
 	while (cur != NULL) {
 		awaiter_t *waiter =
-		    list_get_instance(cur, awaiter_t, to_event.link);
+		    odict_get_instance(cur, awaiter_t, to_event.link);
 
 		if (tv_gt(&waiter->to_event.expires, &tv)) {
 			if (fired) {
@@ -1147,8 +1286,7 @@ static suseconds_t handle_expired_timeouts(unsigned int *flags)
 			return tv_sub_diff(&waiter->to_event.expires, &tv);
 		}
 
-		list_remove(&waiter->to_event.link);
-		waiter->to_event.inlist = false;
+		async_remove_timeout(waiter);
 		waiter->to_event.occurred = true;
 
 		/*
@@ -1161,7 +1299,7 @@ static suseconds_t handle_expired_timeouts(unsigned int *flags)
 			fired = true;
 		}
 
-		cur = list_first(&timeout_list);
+		cur = odict_first(&timeout_odict);
 	}
 
 	if (fired) {
@@ -1179,6 +1317,20 @@ static suseconds_t handle_expired_timeouts(unsigned int *flags)
  */
 static errno_t async_manager_worker(void)
 {
+	/*
+	 * The manager fibril has a small stack, so keep the batch of
+	 * received calls on the heap. Fall back to receiving calls
+	 * one by one if there is no memory.
+	 */
+	ipc_call_t single;
+	ipc_call_t *calls = malloc(sizeof(ipc_call_t) * ASYNC_MANAGER_BATCH);
+	size_t batch = ASYNC_MANAGER_BATCH;
+
+	if (calls == NULL) {
+		calls = &single;
+		batch = 1;
+	}
+
 	while (true) {
 		futex_lock(&async_futex);
 		fibril_switch(FIBRIL_FROM_MANAGER);
@@ -1194,13 +1346,16 @@ static errno_t async_manager_worker(void)
 
 		atomic_inc(&threads_in_ipc_wait);
 
-		ipc_call_t call;
-		errno_t rc = ipc_wait_cycle(&call, next_timeout, flags);
+		size_t received;
+		errno_t rc = ipc_wait_batch(calls, batch, next_timeout, flags,
+		    &received);
 
 		atomic_dec(&threads_in_ipc_wait);
 
 		assert(rc == EOK);
-		handle_call(&call);
+
+		for (size_t i = 0; i < received; i++)
+			handle_call(&calls[i]);
 	}
 
 	return 0;
@@ -1234,12 +1389,64 @@ void async_destroy_manager(void)
 	fibril_remove_manager();
 }
 
+/** Implementing function of an async manager thread.
+ *
+ * @param arg Unused.
+ *
+ */
+static void async_manager_thread(void *arg)
+{
+	async_manager();
+}
+
+/** Create additional threads dispatching fibrils of this task.
+ *
+ * Each of the threads turns into an async manager. All the threads take
+ * ready fibrils from the common ready list, so connection fibrils are
+ * spread across the threads and may run in parallel between blocking
+ * points. Fibril synchronization primitives are safe to use from any of
+ * the threads, but any state not protected by them has to be treated as
+ * shared by concurrently running fibrils.
+ *
+ * @param count Number of threads to create. Zero creates one thread less
+ *              than there are CPUs in the system, as the calling thread is
+ *              expected to enter async_manager() itself.
+ *
+ * @return EOK on success or an error code from thread_create(). Threads
+ *         created before the failure keep running.
+ *
+ */
+errno_t async_create_manager_threads(size_t count)
+{
+	if (count == 0) {
+		size_t size;
+		void *stats = sysinfo_get_data("system.cpus", &size);
+		if (stats == NULL)
+			return ENOENT;
+
+		free(stats);
+
+		size_t cpus = size / sizeof(stats_cpu_t);
+		count = (cpus > 1) ? cpus - 1 : 0;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		thread_id_t tid;
+		errno_t rc = thread_create(async_manager_thread, NULL,
+		    "async_manager", &tid);
+		if (rc != EOK)
+			return rc;
+	}
+
+	return EOK;
+}
+
 /** Initialize the async framework.
  *
  */
 void __async_server_init(void)
 {
-	if (!hash_table_create(&client_hash_table, 0, 0, &client_hash_table_ops))
+	if (!cht_create_simple(&client_hash_table, &client_hash_table_ops))
 		abort();
 
 	if (!hash_table_create(&conn_hash_table, 0, 0, &conn_hash_table_ops))
@@ -1248,6 +1455,8 @@ void __async_server_init(void)
 	if (!hash_table_create(&notification_hash_table, 0, 0,
 	    &notification_hash_table_ops))
 		abort();
+
+	odict_initialize(&timeout_odict, timeout_getkey, timeout_cmp);
 }
 
 errno_t async_answer_0(cap_call_handle_t chandle, errno_t retval)
@@ -1698,6 +1907,66 @@ errno_t async_data_write_accept(void **data, const bool nullterm,
 	return EOK;
 }
 
+/** Receive the inline payload of a call
+ *
+ * This is the counterpart of async_send_payload() and works like
+ * async_data_write_accept(), except that the data already came with
+ * @a call. The call is not answered.
+ *
+ * @param call      Call carrying the payload.
+ * @param data      Pointer to data pointer (which should be later disposed
+ *                  by free()). If the operation fails, the pointer is not
+ *                  touched.
+ * @param nullterm  If true then the received data is always zero terminated.
+ *                  This also causes to allocate one extra byte beyond the
+ *                  raw transmitted data.
+ * @param min_size  Minimum size (in bytes) of the data to receive.
+ * @param max_size  Maximum size (in bytes) of the data to receive. 0 means
+ *                  no limit.
+ * @param received  If not NULL, the size of the received data is stored here.
+ *
+ * @return Zero on success or a value from @ref errno.h on failure.
+ *
+ */
+errno_t async_payload_accept(ipc_call_t *call, void **data, const bool nullterm,
+    const size_t min_size, const size_t max_size, size_t *received)
+{
+	assert(data);
+
+	size_t size = call->payload_size;
+
+	if (size < min_size)
+		return EINVAL;
+
+	if ((max_size > 0) && (size > max_size))
+		return EINVAL;
+
+	void *arg_data;
+
+	if (nullterm)
+		arg_data = malloc(size + 1);
+	else
+		arg_data = malloc(size);
+
+	if (arg_data == NULL)
+		return ENOMEM;
+
+	errno_t rc = ipc_payload_get(call->cap_handle, arg_data, size);
+	if (rc != EOK) {
+		free(arg_data);
+		return rc;
+	}
+
+	if (nullterm)
+		((char *) arg_data)[size] = 0;
+
+	*data = arg_data;
+	if (received != NULL)
+		*received = size;
+
+	return EOK;
+}
+
 /** Wrapper for voiding any data that is about to be received
  *
  * This wrapper can be used to void any pending data
@@ -1789,9 +2058,7 @@ async_sess_t *async_callback_receive(exch_mgmt_t mgmt)
 	fibril_mutex_initialize(&sess->remote_state_mtx);
 	sess->remote_state_data = NULL;
 
-	list_initialize(&sess->exch_list);
-	fibril_mutex_initialize(&sess->mutex);
-	atomic_set(&sess->refcnt, 0);
+	async_sess_exch_init(sess);
 
 	/* Acknowledge the connected phone */
 	async_answer_0(chandle, EOK);
@@ -1835,9 +2102,7 @@ async_sess_t *async_callback_receive_start(exch_mgmt_t mgmt, ipc_call_t *call)
 	fibril_mutex_initialize(&sess->remote_state_mtx);
 	sess->remote_state_data = NULL;
 
-	list_initialize(&sess->exch_list);
-	fibril_mutex_initialize(&sess->mutex);
-	atomic_set(&sess->refcnt, 0);
+	async_sess_exch_init(sess);
 
 	return sess;
 }
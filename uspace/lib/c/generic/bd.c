@@ -106,6 +106,41 @@ errno_t bd_read_blocks(bd_t *bd, aoff64_t ba, size_t cnt, void *data, size_t siz
 	return EOK;
 }
 
+/** Read several discontiguous extents of blocks in one request.
+ *
+ * @param bd		Block device
+ * @param ext		Extents to read
+ * @param ext_cnt	Number of extents, at most BD_EXTENTS_MAX
+ * @param buf		Buffer for the data, each extent is stored at its
+ *			offset
+ * @param size		Size of the buffer
+ *
+ * @return EOK on success or an error code
+ */
+errno_t bd_read_blocks_v(bd_t *bd, const bd_extent_t *ext, size_t ext_cnt,
+    void *buf, size_t size)
+{
+	async_exch_t *exch = async_exchange_begin(bd->sess);
+
+	ipc_call_t answer;
+	aid_t req = async_send_1(exch, BD_READ_BLOCKS_V, ext_cnt, &answer);
+	errno_t rc = async_data_write_start(exch, ext,
+	    ext_cnt * sizeof(bd_extent_t));
+	if (rc == EOK)
+		rc = async_data_read_start(exch, buf, size);
+	async_exchange_end(exch);
+
+	if (rc != EOK) {
+		async_forget(req);
+		return rc;
+	}
+
+	errno_t retval;
+	async_wait_for(req, &retval);
+
+	return retval;
+}
+
 errno_t bd_read_toc(bd_t *bd, uint8_t session, void *buf, size_t size)
 {
 	async_exch_t *exch = async_exchange_begin(bd->sess);
@@ -153,6 +188,40 @@ errno_t bd_write_blocks(bd_t *bd, aoff64_t ba, size_t cnt, const void *data,
 	return EOK;
 }
 
+/** Write several discontiguous extents of blocks in one request.
+ *
+ * @param bd		Block device
+ * @param ext		Extents to write
+ * @param ext_cnt	Number of extents, at most BD_EXTENTS_MAX
+ * @param data		Data to write, each extent is taken from its offset
+ * @param size		Size of the data
+ *
+ * @return EOK on success or an error code
+ */
+errno_t bd_write_blocks_v(bd_t *bd, const bd_extent_t *ext, size_t ext_cnt,
+    const void *data, size_t size)
+{
+	async_exch_t *exch = async_exchange_begin(bd->sess);
+
+	ipc_call_t answer;
+	aid_t req = async_send_1(exch, BD_WRITE_BLOCKS_V, ext_cnt, &answer);
+	errno_t rc = async_data_write_start(exch, ext,
+	    ext_cnt * sizeof(bd_extent_t));
+	if (rc == EOK)
+		rc = async_data_write_start(exch, data, size);
+	async_exchange_end(exch);
+
+	if (rc != EOK) {
+		async_forget(req);
+		return rc;
+	}
+
+	errno_t retval;
+	async_wait_for(req, &retval);
+
+	return retval;
+}
+
 errno_t bd_sync_cache(bd_t *bd, aoff64_t ba, size_t cnt)
 {
 	async_exch_t *exch = async_exchange_begin(bd->sess);
@@ -164,6 +233,40 @@ errno_t bd_sync_cache(bd_t *bd, aoff64_t ba, size_t cnt)
 	return rc;
 }
 
+/** Discard several extents of blocks in one request.
+ *
+ * Tell the device that the blocks no longer hold useful data, so that
+ * it can release the storage. Reading a discarded block returns
+ * undefined data until the block is written again.
+ *
+ * @param bd		Block device
+ * @param ext		Extents to discard, their offsets are ignored
+ * @param ext_cnt	Number of extents, at most BD_EXTENTS_MAX
+ *
+ * @return EOK on success, ENOTSUP if the device does not support
+ *         discarding blocks or another error code
+ */
+errno_t bd_discard_blocks(bd_t *bd, const bd_extent_t *ext, size_t ext_cnt)
+{
+	async_exch_t *exch = async_exchange_begin(bd->sess);
+
+	ipc_call_t answer;
+	aid_t req = async_send_1(exch, BD_DISCARD_BLOCKS, ext_cnt, &answer);
+	errno_t rc = async_data_write_start(exch, ext,
+	    ext_cnt * sizeof(bd_extent_t));
+	async_exchange_end(exch);
+
+	if (rc != EOK) {
+		async_forget(req);
+		return rc;
+	}
+
+	errno_t retval;
+	async_wait_for(req, &retval);
+
+	return retval;
+}
+
 errno_t bd_get_block_size(bd_t *bd, size_t *rbsize)
 {
 	sysarg_t bsize;
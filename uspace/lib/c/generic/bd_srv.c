@@ -60,6 +60,26 @@ static void bd_read_blocks_srv(bd_srv_t *srv, cap_call_handle_t chandle,
 		return;
 	}
 
+	if (srv->srvs->ops->map_blocks != NULL) {
+		size_t msize;
+
+		rc = srv->srvs->ops->map_blocks(srv, ba, cnt, false, &buf,
+		    &msize);
+		if (rc == EOK) {
+			rc = async_data_read_finalize(rcall_handle, buf,
+			    min(size, msize));
+			srv->srvs->ops->unmap_blocks(srv, false);
+			async_answer_0(chandle, rc);
+			return;
+		}
+
+		if (rc != ENOTSUP) {
+			async_answer_0(rcall_handle, rc);
+			async_answer_0(chandle, rc);
+			return;
+		}
+	}
+
 	buf = malloc(size);
 	if (buf == NULL) {
 		async_answer_0(rcall_handle, ENOMEM);
@@ -88,6 +108,129 @@ static void bd_read_blocks_srv(bd_srv_t *srv, cap_call_handle_t chandle,
 	async_answer_0(chandle, EOK);
 }
 
+/** Receive the extents of a vectored request.
+ *
+ * @param srv		Server structure
+ * @param call		Request
+ * @param rext		Place to store the allocated extents
+ * @param rbsize	Place to store the block size
+ *
+ * @return EOK on success or an error code
+ */
+static errno_t bd_extents_receive(bd_srv_t *srv, ipc_call_t *call,
+    bd_extent_t **rext, size_t *rbsize)
+{
+	size_t ext_cnt = IPC_GET_ARG1(*call);
+	bd_extent_t *ext;
+	size_t esize;
+	size_t bsize;
+	errno_t rc;
+
+	if (ext_cnt == 0 || ext_cnt > BD_EXTENTS_MAX)
+		return EINVAL;
+
+	rc = async_data_write_accept((void **) &ext, false,
+	    ext_cnt * sizeof(bd_extent_t), ext_cnt * sizeof(bd_extent_t), 0,
+	    &esize);
+	if (rc != EOK)
+		return rc;
+
+	if (srv->srvs->ops->get_block_size == NULL) {
+		free(ext);
+		return ENOTSUP;
+	}
+
+	rc = srv->srvs->ops->get_block_size(srv, &bsize);
+	if (rc != EOK) {
+		free(ext);
+		return rc;
+	}
+
+	*rext = ext;
+	*rbsize = bsize;
+	return EOK;
+}
+
+/** Check that all extents fit in the transfer buffer. */
+static bool bd_extents_valid(bd_extent_t *ext, size_t ext_cnt, size_t bsize,
+    size_t size)
+{
+	for (size_t i = 0; i < ext_cnt; i++) {
+		if (ext[i].offset > size ||
+		    ext[i].cnt > (size - ext[i].offset) / bsize)
+			return false;
+	}
+
+	return true;
+}
+
+static void bd_read_blocks_v_srv(bd_srv_t *srv, cap_call_handle_t chandle,
+    ipc_call_t *call)
+{
+	size_t ext_cnt = IPC_GET_ARG1(*call);
+	bd_extent_t *ext;
+	size_t bsize;
+	void *buf;
+	size_t size;
+	errno_t rc;
+	cap_call_handle_t rcall_handle;
+
+	rc = bd_extents_receive(srv, call, &ext, &bsize);
+	if (rc != EOK) {
+		async_answer_0(chandle, rc);
+		return;
+	}
+
+	if (!async_data_read_receive(&rcall_handle, &size)) {
+		free(ext);
+		async_answer_0(chandle, EINVAL);
+		return;
+	}
+
+	if (srv->srvs->ops->read_blocks == NULL) {
+		free(ext);
+		async_answer_0(rcall_handle, ENOTSUP);
+		async_answer_0(chandle, ENOTSUP);
+		return;
+	}
+
+	if (!bd_extents_valid(ext, ext_cnt, bsize, size)) {
+		free(ext);
+		async_answer_0(rcall_handle, EINVAL);
+		async_answer_0(chandle, EINVAL);
+		return;
+	}
+
+	buf = calloc(1, size);
+	if (buf == NULL) {
+		free(ext);
+		async_answer_0(rcall_handle, ENOMEM);
+		async_answer_0(chandle, ENOMEM);
+		return;
+	}
+
+	for (size_t i = 0; i < ext_cnt; i++) {
+		rc = srv->srvs->ops->read_blocks(srv, ext[i].ba, ext[i].cnt,
+		    buf + ext[i].offset, ext[i].cnt * bsize);
+		if (rc != EOK)
+			break;
+	}
+
+	free(ext);
+
+	if (rc != EOK) {
+		async_answer_0(rcall_handle, rc);
+		async_answer_0(chandle, rc);
+		free(buf);
+		return;
+	}
+
+	async_data_read_finalize(rcall_handle, buf, size);
+
+	free(buf);
+	async_answer_0(chandle, EOK);
+}
+
 static void bd_read_toc_srv(bd_srv_t *srv, cap_call_handle_t chandle,
     ipc_call_t *call)
 {
@@ -151,6 +294,97 @@ static void bd_sync_cache_srv(bd_srv_t *srv, cap_call_handle_t chandle,
 	async_answer_0(chandle, rc);
 }
 
+static void bd_discard_blocks_srv(bd_srv_t *srv, cap_call_handle_t chandle,
+    ipc_call_t *call)
+{
+	size_t ext_cnt = IPC_GET_ARG1(*call);
+	bd_extent_t *ext;
+	aoff64_t nblocks;
+	size_t bsize;
+	errno_t rc;
+
+	rc = bd_extents_receive(srv, call, &ext, &bsize);
+	if (rc != EOK) {
+		async_answer_0(chandle, rc);
+		return;
+	}
+
+	if (srv->srvs->ops->discard_blocks == NULL ||
+	    srv->srvs->ops->get_num_blocks == NULL) {
+		free(ext);
+		async_answer_0(chandle, ENOTSUP);
+		return;
+	}
+
+	rc = srv->srvs->ops->get_num_blocks(srv, &nblocks);
+	if (rc != EOK) {
+		free(ext);
+		async_answer_0(chandle, rc);
+		return;
+	}
+
+	for (size_t i = 0; i < ext_cnt; i++) {
+		if (ext[i].ba > nblocks || ext[i].cnt > nblocks - ext[i].ba) {
+			free(ext);
+			async_answer_0(chandle, ELIMIT);
+			return;
+		}
+	}
+
+	rc = srv->srvs->ops->discard_blocks(srv, ext, ext_cnt);
+	free(ext);
+	async_answer_0(chandle, rc);
+}
+
+/** Write blocks received from the client directly to device storage. */
+static void bd_write_blocks_mapped_srv(bd_srv_t *srv, cap_call_handle_t chandle,
+    aoff64_t ba, size_t cnt)
+{
+	cap_call_handle_t wcall_handle;
+	void *data;
+	size_t size;
+	size_t msize;
+	errno_t rc;
+
+	if (!async_data_write_receive(&wcall_handle, &size)) {
+		async_answer_0(chandle, EINVAL);
+		return;
+	}
+
+	rc = srv->srvs->ops->map_blocks(srv, ba, cnt, true, &data, &msize);
+	if (rc == EOK) {
+		rc = async_data_write_finalize(wcall_handle, data,
+		    min(size, msize));
+		srv->srvs->ops->unmap_blocks(srv, true);
+		async_answer_0(chandle, rc);
+		return;
+	}
+
+	if (rc != ENOTSUP || srv->srvs->ops->write_blocks == NULL) {
+		async_answer_0(wcall_handle, rc);
+		async_answer_0(chandle, rc);
+		return;
+	}
+
+	data = malloc(size);
+	if (data == NULL) {
+		async_answer_0(wcall_handle, ENOMEM);
+		async_answer_0(chandle, ENOMEM);
+		return;
+	}
+
+	rc = async_data_write_finalize(wcall_handle, data, size);
+	if (rc != EOK) {
+		free(data);
+		async_answer_0(chandle, rc);
+		return;
+	}
+
+	rc = srv->srvs->ops->write_blocks(srv, ba, cnt, data, size);
+	free(data);
+	async_answer_0(chandle, rc);
+}
+
 static void bd_write_blocks_srv(bd_srv_t *srv, cap_call_handle_t chandle,
     ipc_call_t *call)
 {
@@ -163,6 +397,11 @@ static void bd_write_blocks_srv(bd_srv_t *srv, cap_call_handle_t chandle,
 	ba = MERGE_LOUP32(IPC_GET_ARG1(*call), IPC_GET_ARG2(*call));
 	cnt = IPC_GET_ARG3(*call);
 
+	if (srv->srvs->ops->map_blocks != NULL) {
+		bd_write_blocks_mapped_srv(srv, chandle, ba, cnt);
+		return;
+	}
+
 	rc = async_data_write_accept(&data, false, 0, 0, 0, &size);
 	if (rc != EOK) {
 		async_answer_0(chandle, rc);
@@ -179,6 +418,55 @@ static void bd_write_blocks_srv(bd_srv_t *srv, cap_call_handle_t chandle,
 	async_answer_0(chandle, rc);
 }
 
+static void bd_write_blocks_v_srv(bd_srv_t *srv, cap_call_handle_t chandle,
+    ipc_call_t *call)
+{
+	size_t ext_cnt = IPC_GET_ARG1(*call);
+	bd_extent_t *ext;
+	size_t bsize;
+	void *data;
+	size_t size;
+	errno_t rc;
+
+	rc = bd_extents_receive(srv, call, &ext, &bsize);
+	if (rc != EOK) {
+		async_answer_0(chandle, rc);
+		return;
+	}
+
+	rc = async_data_write_accept(&data, false, 0, 0, 0, &size);
+	if (rc != EOK) {
+		free(ext);
+		async_answer_0(chandle, rc);
+		return;
+	}
+
+	if (srv->srvs->ops->write_blocks == NULL) {
+		free(ext);
+		free(data);
+		async_answer_0(chandle, ENOTSUP);
+		return;
+	}
+
+	if (!bd_extents_valid(ext, ext_cnt, bsize, size)) {
+		free(ext);
+		free(data);
+		async_answer_0(chandle, EINVAL);
+		return;
+	}
+
+	for (size_t i = 0; i < ext_cnt; i++) {
+		rc = srv->srvs->ops->write_blocks(srv, ext[i].ba, ext[i].cnt,
+		    data + ext[i].offset, ext[i].cnt * bsize);
+		if (rc != EOK)
+			break;
+	}
+
+	free(ext);
+	free(data);
+	async_answer_0(chandle, rc);
+}
+
 static void bd_get_block_size_srv(bd_srv_t *srv, cap_call_handle_t chandle,
     ipc_call_t *call)
 {
@@ -273,6 +561,15 @@ errno_t bd_conn(cap_call_handle_t icall_handle, ipc_call_t *icall, bd_srvs_t *sr
 		case BD_WRITE_BLOCKS:
 			bd_write_blocks_srv(srv, chandle, &call);
 			break;
+		case BD_READ_BLOCKS_V:
+			bd_read_blocks_v_srv(srv, chandle, &call);
+			break;
+		case BD_WRITE_BLOCKS_V:
+			bd_write_blocks_v_srv(srv, chandle, &call);
+			break;
+		case BD_DISCARD_BLOCKS:
+			bd_discard_blocks_srv(srv, chandle, &call);
+			break;
 		case BD_GET_BLOCK_SIZE:
 			bd_get_block_size_srv(srv, chandle, &call);
 			break;
@@ -160,5 +160,81 @@ errno_t hw_res_dma_channel_remain(async_sess_t *sess, unsigned channel, size_t *
 	return ret;
 }
 
+/** Switch the device to message signalled interrupts.
+ *
+ * On success the legacy interrupt in the resource list of the device is
+ * replaced by one interrupt per allocated vector, in vector order. Each
+ * of them can be subscribed to separately. The vectors are masked until
+ * enabled by hw_res_enable_interrupt().
+ *
+ * @param sess  Session to the parent driver.
+ * @param count Number of vectors requested.
+ * @param[out] allocated Number of vectors actually allocated.
+ *
+ * @return Error code. ENOTSUP if neither the device nor the platform
+ *         support message signalled interrupts.
+ *
+ */
+errno_t hw_res_alloc_msi(async_sess_t *sess, size_t count, size_t *allocated)
+{
+	async_exch_t *exch = async_exchange_begin(sess);
+
+	sysarg_t nvec;
+	const errno_t ret = async_req_2_1(exch, DEV_IFACE_ID(HW_RES_DEV_IFACE),
+	    HW_RES_ALLOC_MSI, count, &nvec);
+
+	async_exchange_end(exch);
+
+	if (ret == EOK)
+		*allocated = nvec;
+
+	return ret;
+}
+
+/** Release message signalled interrupts and return to the legacy one.
+ *
+ * @param sess Session to the parent driver.
+ *
+ * @return Error code.
+ *
+ */
+errno_t hw_res_free_msi(async_sess_t *sess)
+{
+	async_exch_t *exch = async_exchange_begin(sess);
+
+	const errno_t ret = async_req_1_0(exch, DEV_IFACE_ID(HW_RES_DEV_IFACE),
+	    HW_RES_FREE_MSI);
+
+	async_exchange_end(exch);
+
+	return ret;
+}
+
+/** Deliver an interrupt of the device to a single CPU.
+ *
+ * Only interrupts whose destination is programmed in the device itself,
+ * i.e. message signalled ones, are routed by the parent driver. Others
+ * are routed by the kernel through their IRQ capability.
+ *
+ * @param sess Session to the parent driver.
+ * @param irq  IRQ number.
+ * @param cpu  ID of the target CPU.
+ *
+ * @return Error code. ENOTSUP if the parent does not route the interrupt.
+ *
+ */
+errno_t hw_res_set_interrupt_affinity(async_sess_t *sess, int irq,
+    unsigned int cpu)
+{
+	async_exch_t *exch = async_exchange_begin(sess);
+
+	const errno_t ret = async_req_3_0(exch, DEV_IFACE_ID(HW_RES_DEV_IFACE),
+	    HW_RES_SET_INTERRUPT_AFFINITY, irq, cpu);
+
+	async_exchange_end(exch);
+
+	return ret;
+}
+
 /** @}
  */
@@ -38,6 +38,10 @@
 #include <stddef.h>
 #include <errno.h>
 #include <assert.h>
+#include <str.h>
+
+/** Size of the buffer for directory entries read ahead in one batch */
+#define DIRENT_BUF_SIZE  4096
 
 /** Open directory.
  *
@@ -71,9 +75,55 @@ DIR *opendir(const char *dirname)
 
 	dirp->fd = fd;
 	dirp->pos = 0;
+	dirp->buf = NULL;
+	dirp->buf_len = 0;
+	dirp->buf_off = 0;
+	dirp->no_batch = false;
 	return dirp;
 }
 
+/** Get the next directory entry from the read-ahead batch.
+ *
+ * @param dirp Open directory
+ * @param[out] ent Next directory entry
+ *
+ * @return EOK on success, ENOENT if there are no more entries, ENOTSUP
+ *         if the file system cannot read entries in batches or another
+ *         error code
+ */
+static errno_t readdir_batch(DIR *dirp, vfs_dirent_t **ent)
+{
+	errno_t rc;
+
+	if (dirp->no_batch)
+		return ENOTSUP;
+
+	if (dirp->buf_off >= dirp->buf_len) {
+		if (dirp->buf == NULL) {
+			dirp->buf = malloc(DIRENT_BUF_SIZE);
+			if (dirp->buf == NULL)
+				return ENOMEM;
+		}
+
+		dirp->buf_len = 0;
+		dirp->buf_off = 0;
+		rc = vfs_readdir(dirp->fd, dirp->pos, dirp->buf,
+		    DIRENT_BUF_SIZE, &dirp->buf_len);
+		if (rc == ENOTSUP)
+			dirp->no_batch = true;
+		if (rc != EOK)
+			return rc;
+		if (dirp->buf_len == 0)
+			return ENOENT;
+	}
+
+	*ent = (vfs_dirent_t *) ((uint8_t *) dirp->buf + dirp->buf_off);
+	dirp->buf_off += (*ent)->reclen;
+	dirp->pos = (*ent)->next;
+	str_cpy(dirp->res.d_name, NAME_MAX + 1, (*ent)->name);
+	return EOK;
+}
+
 /** Read directory entry.
  *
  * @param dirp Open directory
@@ -84,6 +134,15 @@ struct dirent *readdir(DIR *dirp)
 {
 	errno_t rc;
 	ssize_t len = 0;
+	vfs_dirent_t *ent;
+
+	rc = readdir_batch(dirp, &ent);
+	if (rc == EOK)
+		return &dirp->res;
+	if (rc != ENOTSUP) {
+		errno = rc;
+		return NULL;
+	}
 
 	rc = vfs_read_short(dirp->fd, dirp->pos, &dirp->res.d_name[0],
 	    NAME_MAX + 1, &len);
@@ -97,6 +156,51 @@ struct dirent *readdir(DIR *dirp)
 	return &dirp->res;
 }
 
+/** Read directory entry together with its attributes.
+ *
+ * Unlike calling readdir() followed by vfs_stat_path(), this usually
+ * needs no extra round trip to the file system for the attributes.
+ *
+ * @param dirp Open directory
+ * @param stat Place to store the attributes of the entry
+ * @return Non-NULL pointer to directory entry on success. On error returns
+ *         @c NULL and sets errno.
+ */
+struct dirent *readdir_stat(DIR *dirp, vfs_stat_t *stat)
+{
+	errno_t rc;
+	vfs_dirent_t *ent;
+	int fd;
+
+	rc = readdir_batch(dirp, &ent);
+	if (rc == EOK) {
+		*stat = ent->stat;
+		return &dirp->res;
+	}
+	if (rc != ENOTSUP) {
+		errno = rc;
+		return NULL;
+	}
+
+	if (readdir(dirp) == NULL)
+		return NULL;
+
+	rc = vfs_walk(dirp->fd, dirp->res.d_name, 0, &fd);
+	if (rc != EOK) {
+		errno = rc;
+		return NULL;
+	}
+
+	rc = vfs_stat(fd, stat);
+	vfs_put(fd);
+	if (rc != EOK) {
+		errno = rc;
+		return NULL;
+	}
+
+	return &dirp->res;
+}
+
 /** Rewind directory position to the beginning.
  *
  * @param dirp Open directory
@@ -104,6 +208,8 @@ struct dirent *readdir(DIR *dirp)
 void rewinddir(DIR *dirp)
 {
 	dirp->pos = 0;
+	dirp->buf_len = 0;
+	dirp->buf_off = 0;
 }
 
 /** Close directory.
@@ -114,6 +220,7 @@ void rewinddir(DIR *dirp)
 int closedir(DIR *dirp)
 {
 	errno_t rc = vfs_put(dirp->fd);
+	free(dirp->buf);
 	free(dirp);
 
 	if (rc == EOK) {
@@ -191,5 +191,27 @@ errno_t dnsr_set_srvaddr(inet_addr_t *srvaddr)
 	return retval;
 }
 
+errno_t dnsr_get_cache_stats(dnsr_cache_stats_t *stats)
+{
+	async_exch_t *exch = dnsr_exchange_begin();
+
+	ipc_call_t answer;
+	aid_t req = async_send_0(exch, DNSR_GET_CACHE_STATS, &answer);
+	errno_t rc = async_data_read_start(exch, stats,
+	    sizeof(dnsr_cache_stats_t));
+
+	dnsr_exchange_end(exch);
+
+	if (rc != EOK) {
+		async_forget(req);
+		return rc;
+	}
+
+	errno_t retval;
+	async_wait_for(req, &retval);
+
+	return retval;
+}
+
 /** @}
  */
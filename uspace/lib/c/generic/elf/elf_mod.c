@@ -37,10 +37,11 @@
  * @brief	Userspace ELF module loader.
  *
  * This module allows loading ELF binaries (both executables and
- * shared objects) from VFS. The current implementation allocates
- * anonymous memory, fills it with segment data and then adjusts
- * the memory areas' flags to the final value. In the future,
- * the segments will be mapped directly from the file.
+ * shared objects) from VFS. Read-only segments are mapped directly
+ * from the file, VFS keeps their pages resident and shares them among
+ * all tasks which map the same file. Other segments are loaded into
+ * anonymous memory, which is filled with segment data and then the
+ * memory areas' flags are adjusted to the final value.
  */
 
 #include <errno.h>
@@ -61,6 +62,10 @@
 
 #include <elf/elf_load.h>
 
+#ifdef CONFIG_RTLD
+#include <rtld/elf_dyn.h>
+#endif
+
 #define DPRINTF(...)
 
 static const char *error_codes[] = {
@@ -76,6 +81,8 @@ static const char *error_codes[] = {
 static unsigned int elf_load_module(elf_ld_t *elf);
 static int segment_header(elf_ld_t *elf, elf_segment_header_t *entry);
 static int load_segment(elf_ld_t *elf, elf_segment_header_t *entry);
+static bool has_text_rel(elf_ld_t *elf, elf_segment_header_t *phdr,
+    size_t phnum);
 
 /** Load ELF binary from a file.
  *
@@ -108,10 +115,13 @@ int elf_load_file(int file, eld_flags_t flags, elf_finfo_t *info)
 	elf.fd = ofile;
 	elf.info = info;
 	elf.flags = flags;
+	elf.mapped = false;
 
 	int ret = elf_load_module(&elf);
 
-	vfs_put(ofile);
+	/* Mapped segments are paged in through the file descriptor. */
+	if (!elf.mapped)
+		vfs_put(ofile);
 	return ret;
 }
 
@@ -261,6 +271,13 @@ static unsigned int elf_load_module(elf_ld_t *elf)
 		as_area_destroy(area);
 	}
 
+	/*
+	 * Read-only segments can be shared only if nobody is going
+	 * to modify them.
+	 */
+	elf->map = (elf->flags & ELDF_RW) == 0 ||
+	    !has_text_rel(elf, phdr, header->e_phnum);
+
 	/* Load all loadable segments. */
 	for (i = 0; i < header->e_phnum; i++) {
 		if (phdr[i].p_type != PT_LOAD)
@@ -387,6 +404,63 @@ static int segment_header(elf_ld_t *elf, elf_segment_header_t *entry)
 	return EE_OK;
 }
 
+/** Determine whether the module needs relocations in read-only segments.
+ *
+ * @param elf	Loader state.
+ * @param phdr	Program header table.
+ * @param phnum	Number of entries in the program header table.
+ *
+ * @return True if the module has text relocations or if it cannot
+ *         be determined.
+ */
+static bool has_text_rel(elf_ld_t *elf, elf_segment_header_t *phdr,
+    size_t phnum)
+{
+#ifdef CONFIG_RTLD
+	size_t i;
+
+	for (i = 0; i < phnum; i++) {
+		if (phdr[i].p_type == PT_DYNAMIC)
+			break;
+	}
+
+	/* Nothing to relocate */
+	if (i == phnum)
+		return false;
+
+	size_t size = phdr[i].p_filesz;
+	elf_dyn_t *dyn = malloc(size);
+	if (dyn == NULL)
+		return true;
+
+	aoff64_t pos = phdr[i].p_offset;
+	size_t nr;
+	errno_t rc = vfs_read(elf->fd, &pos, dyn, size, &nr);
+	if (rc != EOK || nr != size) {
+		free(dyn);
+		return true;
+	}
+
+	bool text_rel = false;
+	for (i = 0; i < size / sizeof(elf_dyn_t); i++) {
+		if (dyn[i].d_tag == DT_NULL)
+			break;
+		if (dyn[i].d_tag == DT_TEXTREL ||
+		    (dyn[i].d_tag == DT_FLAGS &&
+		    (dyn[i].d_un.d_val & DF_TEXTREL) != 0)) {
+			text_rel = true;
+			break;
+		}
+	}
+
+	free(dyn);
+	return text_rel;
+#else
+	/* Only the dynamic linker loads modules for relocation. */
+	return true;
+#endif
+}
+
 /** Load segment described by program header entry.
  *
  * @param elf	Loader state.
@@ -439,6 +513,30 @@ int load_segment(elf_ld_t *elf, elf_segment_header_t *entry)
 	base = ALIGN_DOWN(entry->p_vaddr, PAGE_SIZE);
 	mem_sz = entry->p_memsz + (entry->p_vaddr - base);
 
+	/*
+	 * Map read-only segments directly from the file. The area is
+	 * never writeable, so its pages can be shared with other tasks.
+	 */
+	if (elf->map && (entry->p_flags & PF_W) == 0 &&
+	    entry->p_filesz == entry->p_memsz &&
+	    entry->p_offset >= entry->p_vaddr - base) {
+		a = vfs_map(elf->fd, entry->p_offset - (entry->p_vaddr - base),
+		    (uint8_t *) base + bias, mem_sz, flags);
+		if (a != AS_MAP_FAILED) {
+			DPRINTF("vfs_map(%p, %#zx, %d) -> %p\n",
+			    (void *) (base + bias), mem_sz, flags, (void *) a);
+			elf->mapped = true;
+
+			if (flags & AS_AREA_EXEC) {
+				/* Enforce SMC coherence for the segment */
+				if (smc_coherence(seg_ptr, entry->p_filesz))
+					return EE_MEMORY;
+			}
+
+			return EE_OK;
+		}
+	}
+
 	DPRINTF("Map to seg_addr=%p-%p.\n", (void *) seg_addr,
 	    (void *) (entry->p_vaddr + bias +
 	    ALIGN_UP(entry->p_memsz, PAGE_SIZE)));
@@ -26,7 +26,7 @@
  * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
-/** @addtogroup debug
+/** @addtogroup generic
  * @{
  */
 /** @file Handling of ELF symbol tables.
@@ -44,7 +44,9 @@
 #include <str_error.h>
 #include <vfs/vfs.h>
 
-#include "include/symtab.h"
+#include <elf/elf_symtab.h>
+
+#define DPRINTF(...)
 
 static errno_t elf_hdr_check(elf_header_t *hdr);
 static errno_t section_hdr_load(int fd, const elf_header_t *ehdr, int idx,
@@ -85,21 +87,21 @@ errno_t symtab_load(const char *file_name, symtab_t **symtab)
 
 	rc = vfs_lookup_open(file_name, WALK_REGULAR, MODE_READ, &fd);
 	if (rc != EOK) {
-		printf("failed opening file '%s': %s\n", file_name, str_error(rc));
+		DPRINTF("failed opening file '%s': %s\n", file_name, str_error(rc));
 		free(stab);
 		return ENOENT;
 	}
 
 	rc = vfs_read(fd, &pos, &elf_hdr, sizeof(elf_header_t), &nread);
 	if (rc != EOK || nread != sizeof(elf_header_t)) {
-		printf("failed reading elf header\n");
+		DPRINTF("failed reading elf header\n");
 		free(stab);
 		return EIO;
 	}
 
 	rc = elf_hdr_check(&elf_hdr);
 	if (rc != EOK) {
-		printf("failed header check\n");
+		DPRINTF("failed header check\n");
 		free(stab);
 		return ENOTSUP;
 	}
@@ -110,7 +112,7 @@ errno_t symtab_load(const char *file_name, symtab_t **symtab)
 
 	rc = section_hdr_load(fd, &elf_hdr, elf_hdr.e_shstrndx, &sec_hdr);
 	if (rc != EOK) {
-		printf("failed reading shstrt header\n");
+		DPRINTF("failed reading shstrt header\n");
 		free(stab);
 		return ENOTSUP;
 	}
@@ -120,7 +122,7 @@ errno_t symtab_load(const char *file_name, symtab_t **symtab)
 
 	rc = chunk_load(fd, shstrt_start, shstrt_size, (void **) &shstrt);
 	if (rc != EOK) {
-		printf("failed loading shstrt\n");
+		DPRINTF("failed loading shstrt\n");
 		free(stab);
 		return ENOTSUP;
 	}
@@ -171,7 +173,7 @@ errno_t symtab_load(const char *file_name, symtab_t **symtab)
 
 	if (stab->sym == NULL || stab->strtab == NULL) {
 		/* Tables not found. */
-		printf("Symbol table or string table section not found\n");
+		DPRINTF("Symbol table or string table section not found\n");
 		free(stab);
 		return ENOTSUP;
 	}
@@ -335,13 +337,13 @@ static errno_t chunk_load(int fd, off64_t start, size_t size, void **ptr)
 
 	*ptr = malloc(size);
 	if (*ptr == NULL) {
-		printf("failed allocating memory\n");
+		DPRINTF("failed allocating memory\n");
 		return ENOMEM;
 	}
 
 	rc = vfs_read(fd, &pos, *ptr, size, &nread);
 	if (rc != EOK || nread != size) {
-		printf("failed reading chunk\n");
+		DPRINTF("failed reading chunk\n");
 		free(*ptr);
 		*ptr = NULL;
 		return EIO;
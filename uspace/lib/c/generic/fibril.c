@@ -51,9 +51,57 @@
 #include "private/fibril.h"
 
 
+/** Maximum number of threads with their own ready queue. */
+#define FIBRIL_RUNNERS_MAX  64
+
+/** Capacity of a per-thread ready queue. */
+#define FIBRIL_RUNNER_QUEUE  256
+
+/** Number of recycled fibril stacks kept by each thread. */
+#define FIBRIL_STACK_CACHE  8
+
+/** Recycled fibril stack. */
+typedef struct {
+	void *base;
+	size_t size;
+} fibril_stack_t;
+
+/** Per-thread ready queue.
+ *
+ * The queue is a fixed-size Chase-Lev work-stealing deque. Only the owning
+ * thread pushes at the bottom. Fibrils are taken from the top both by the
+ * owner and by idle threads stealing work, so that the order in which the
+ * fibrils were readied is preserved.
+ */
+typedef struct fibril_runner {
+	/** Index of the oldest entry, advanced by compare-and-swap. */
+	size_t top;
+	/** Index of the next free entry, written by the owner only. */
+	size_t bottom;
+	/** True if the runner belongs to a thread. */
+	bool in_use;
+	fibril_t *slots[FIBRIL_RUNNER_QUEUE];
+
+	/** Stacks of dead fibrils, touched by the owner only. */
+	size_t stacks_count;
+	fibril_stack_t stacks[FIBRIL_STACK_CACHE];
+} fibril_runner_t;
+
+static fibril_runner_t runners[FIBRIL_RUNNERS_MAX];
+
+/** Number of runners that have ever been in use. */
+static size_t runners_count = 0;
+
+/** Number of fibrils in ready_list. */
+static size_t ready_count = 0;
+
+/** Stack statistics, updated atomically. */
+static fibril_stack_stats_t stack_stats;
+
 /**
- * This futex serializes access to ready_list,
- * manager_list and fibril_list.
+ * This futex serializes access to ready_list, manager_list and fibril_list.
+ * The ready_list only holds fibrils which did not fit into the ready queue
+ * of a thread or which were readied by a thread without a ready queue.
  */
 static futex_t fibril_futex = FUTEX_INITIALIZER;
 
@@ -61,6 +109,267 @@ static LIST_INITIALIZE(ready_list);
 static LIST_INITIALIZE(manager_list);
 static LIST_INITIALIZE(fibril_list);
 
+/** Append a fibril to the ready queue of a runner.
+ *
+ * Must be called by the thread owning the runner.
+ *
+ * @return False if the queue is full.
+ */
+static bool runner_push(fibril_runner_t *runner, fibril_t *fibril)
+{
+	size_t bottom = __atomic_load_n(&runner->bottom, __ATOMIC_RELAXED);
+	size_t top = __atomic_load_n(&runner->top, __ATOMIC_ACQUIRE);
+
+	if (bottom - top >= FIBRIL_RUNNER_QUEUE)
+		return false;
+
+	__atomic_store_n(&runner->slots[bottom % FIBRIL_RUNNER_QUEUE], fibril,
+	    __ATOMIC_RELAXED);
+	__atomic_store_n(&runner->bottom, bottom + 1, __ATOMIC_RELEASE);
+	return true;
+}
+
+/** Take the oldest fibril from the ready queue of a runner.
+ *
+ * May be called by any thread.
+ *
+ * @return Fibril or NULL if the queue is empty.
+ */
+static fibril_t *runner_take(fibril_runner_t *runner)
+{
+	size_t top = __atomic_load_n(&runner->top, __ATOMIC_ACQUIRE);
+
+	while (true) {
+		size_t bottom = __atomic_load_n(&runner->bottom,
+		    __ATOMIC_ACQUIRE);
+		if (top == bottom)
+			return NULL;
+
+		/*
+		 * The slot may be overwritten by the owner once another
+		 * thread advances top, but then the exchange below fails.
+		 */
+		fibril_t *fibril = __atomic_load_n(
+		    &runner->slots[top % FIBRIL_RUNNER_QUEUE], __ATOMIC_RELAXED);
+
+		if (__atomic_compare_exchange_n(&runner->top, &top, top + 1,
+		    false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+			return fibril;
+	}
+}
+
+/** Put a fibril into the global ready_list. */
+static void ready_list_append(fibril_t *fibril)
+{
+	futex_lock(&fibril_futex);
+	list_append(&fibril->link, &ready_list);
+	__atomic_add_fetch(&ready_count, 1, __ATOMIC_RELEASE);
+	futex_unlock(&fibril_futex);
+}
+
+/** Make a fibril ready on behalf of a runner.
+ *
+ * @param runner Runner of the calling thread or NULL.
+ * @param fibril Fibril to be readied.
+ */
+static void ready_put(fibril_runner_t *runner, fibril_t *fibril)
+{
+	if ((runner == NULL) || !runner_push(runner, fibril))
+		ready_list_append(fibril);
+}
+
+/** Choose the next ready fibril to run on behalf of a runner.
+ *
+ * The global ready_list is served first so that fibrils which overflowed
+ * from some queue are not starved. Then the own queue of the thread is
+ * tried and finally work is stolen from the queues of other threads.
+ *
+ * @param runner Runner of the calling thread or NULL.
+ *
+ * @return Fibril or NULL if there is no ready fibril.
+ */
+static fibril_t *ready_take(fibril_runner_t *runner)
+{
+	fibril_t *fibril = NULL;
+
+	if (__atomic_load_n(&ready_count, __ATOMIC_ACQUIRE) > 0) {
+		futex_lock(&fibril_futex);
+		if (!list_empty(&ready_list)) {
+			fibril = list_get_instance(list_first(&ready_list),
+			    fibril_t, link);
+			list_remove(&fibril->link);
+			__atomic_sub_fetch(&ready_count, 1, __ATOMIC_RELAXED);
+		}
+		futex_unlock(&fibril_futex);
+
+		if (fibril != NULL)
+			return fibril;
+	}
+
+	if (runner != NULL) {
+		fibril = runner_take(runner);
+		if (fibril != NULL)
+			return fibril;
+	}
+
+	size_t count = __atomic_load_n(&runners_count, __ATOMIC_ACQUIRE);
+	for (size_t i = 0; i < count; i++) {
+		if (&runners[i] == runner)
+			continue;
+
+		fibril = runner_take(&runners[i]);
+		if (fibril != NULL)
+			return fibril;
+	}
+
+	return NULL;
+}
+
+/** Get a stack for a new fibril.
+ *
+ * A stack of the same size recycled by the calling thread is reused.
+ * Otherwise a new stack is allocated. The pages of a new stack are only
+ * reserved and backed once touched, below a guard page.
+ *
+ * @param runner Runner of the calling thread or NULL.
+ * @param size   Stack size.
+ *
+ * @return Stack base or NULL if out of memory.
+ */
+static void *stack_get(fibril_runner_t *runner, size_t size)
+{
+	if (runner != NULL) {
+		for (size_t i = 0; i < runner->stacks_count; i++) {
+			if (runner->stacks[i].size != size)
+				continue;
+
+			void *stack = runner->stacks[i].base;
+			runner->stacks[i] = runner->stacks[--runner->stacks_count];
+			__atomic_add_fetch(&stack_stats.stack_reused, 1,
+			    __ATOMIC_RELAXED);
+			return stack;
+		}
+	}
+
+	void *stack = as_area_create(AS_AREA_ANY, size,
+	    AS_AREA_READ | AS_AREA_WRITE | AS_AREA_CACHEABLE | AS_AREA_GUARD |
+	    AS_AREA_LATE_RESERVE, AS_AREA_UNPAGED);
+	if (stack == (void *) -1)
+		return NULL;
+
+	__atomic_add_fetch(&stack_stats.stack_allocated, 1, __ATOMIC_RELAXED);
+	return stack;
+}
+
+/** Recycle the stack of a fibril which is not going to run anymore.
+ *
+ * The stack is kept in the cache of the calling thread if there is room.
+ * Otherwise it is destroyed.
+ *
+ * @param runner Runner of the calling thread or NULL.
+ * @param fibril Dead fibril.
+ */
+static void stack_put(fibril_runner_t *runner, fibril_t *fibril)
+{
+	if (fibril->stack_low != 0) {
+		size_t used = (uintptr_t) fibril->stack + fibril->stack_size -
+		    fibril->stack_low;
+		size_t hwm = __atomic_load_n(&stack_stats.stack_hwm,
+		    __ATOMIC_RELAXED);
+		while ((used > hwm) &&
+		    !__atomic_compare_exchange_n(&stack_stats.stack_hwm, &hwm,
+		    used, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+			;
+	}
+
+	if ((runner != NULL) && (runner->stacks_count < FIBRIL_STACK_CACHE)) {
+		runner->stacks[runner->stacks_count].base = fibril->stack;
+		runner->stacks[runner->stacks_count].size = fibril->stack_size;
+		runner->stacks_count++;
+	} else {
+		as_area_destroy(fibril->stack);
+	}
+
+	fibril->stack = NULL;
+}
+
+/** Get fibril stack statistics.
+ *
+ * The high-water mark is sampled at the points where fibrils switch
+ * away, so it underestimates the real usage by the depth of any calls
+ * made between two switches.
+ *
+ * @param stats Place to store the statistics.
+ */
+void fibril_stack_stats(fibril_stack_stats_t *stats)
+{
+	stats->stack_hwm = __atomic_load_n(&stack_stats.stack_hwm,
+	    __ATOMIC_RELAXED);
+	stats->stack_reused = __atomic_load_n(&stack_stats.stack_reused,
+	    __ATOMIC_RELAXED);
+	stats->stack_allocated = __atomic_load_n(&stack_stats.stack_allocated,
+	    __ATOMIC_RELAXED);
+}
+
+/** Assign a ready queue to the thread running a fibril.
+ *
+ * Called once for the initial fibril of each thread, which also caches
+ * the thread ID. If all queues are taken, the thread uses the global
+ * ready_list only.
+ *
+ * @param fibril Initial fibril of the calling thread.
+ */
+void fibril_runner_enter(fibril_t *fibril)
+{
+	fibril->thread_id = thread_get_id();
+	fibril->running = true;
+
+	for (size_t i = 0; i < FIBRIL_RUNNERS_MAX; i++) {
+		bool expected = false;
+
+		if (__atomic_compare_exchange_n(&runners[i].in_use, &expected,
+		    true, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+			size_t count = __atomic_load_n(&runners_count,
+			    __ATOMIC_RELAXED);
+			while ((count < i + 1) &&
+			    !__atomic_compare_exchange_n(&runners_count, &count,
+			    i + 1, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+				;
+
+			fibril->runner = &runners[i];
+			return;
+		}
+	}
+
+	fibril->runner = NULL;
+}
+
+/** Release the ready queue of the calling thread.
+ *
+ * Fibrils left in the queue are moved to the global ready_list.
+ *
+ * @param fibril Currently running fibril of the exiting thread.
+ */
+void fibril_runner_leave(fibril_t *fibril)
+{
+	fibril->running = false;
+
+	fibril_runner_t *runner = fibril->runner;
+	if (runner == NULL)
+		return;
+
+	fibril->runner = NULL;
+
+	fibril_t *ready;
+	while ((ready = runner_take(runner)) != NULL)
+		ready_list_append(ready);
+
+	while (runner->stacks_count > 0)
+		as_area_destroy(runner->stacks[--runner->stacks_count].base);
+
+	__atomic_store_n(&runner->in_use, false, __ATOMIC_RELEASE);
+}
+
 /** Function that spans the whole life-cycle of a fibril.
  *
  * Each fibril begins execution in this function. Then the function implementing
@@ -70,8 +379,7 @@ static LIST_INITIALIZE(fibril_list);
  */
 static void fibril_main(void)
 {
-	/* fibril_futex and async_futex are locked when a fibril is started. */
-	futex_unlock(&fibril_futex);
+	/* async_futex is locked when a fibril is started. */
 	futex_unlock(&async_futex);
 
 	fibril_t *fibril = fibril_self();
@@ -143,20 +451,20 @@ int fibril_switch(fibril_switch_type_t stype)
 	/* Make sure the async_futex is held. */
 	futex_assert_is_locked(&async_futex);
 
-	futex_lock(&fibril_futex);
-
 	fibril_t *srcf = fibril_self();
-	fibril_t *dstf = NULL;
+	fibril_runner_t *runner = srcf->runner;
 
 	/* Choose a new fibril to run */
-	if (list_empty(&ready_list)) {
+	fibril_t *dstf = ready_take(runner);
+	if (dstf == NULL) {
 		if (stype == FIBRIL_PREEMPT || stype == FIBRIL_FROM_MANAGER) {
 			// FIXME: This means that as long as there is a fibril
 			// that only yields, IPC messages are never retrieved.
-			futex_unlock(&fibril_futex);
 			return 0;
 		}
 
+		futex_lock(&fibril_futex);
+
 		/* If we are going to manager and none exists, create it */
 		while (list_empty(&manager_list)) {
 			futex_unlock(&fibril_futex);
@@ -166,22 +474,25 @@ int fibril_switch(fibril_switch_type_t stype)
 
 		dstf = list_get_instance(list_first(&manager_list),
 		    fibril_t, link);
-	} else {
-		dstf = list_get_instance(list_first(&ready_list), fibril_t,
-		    link);
+		list_remove(&dstf->link);
+
+		futex_unlock(&fibril_futex);
 	}
 
-	list_remove(&dstf->link);
 	if (stype == FIBRIL_FROM_DEAD)
 		dstf->clean_after_me = srcf;
 
-	/* Put the current fibril into the correct run list */
+	/*
+	 * Put the current fibril into the correct run list. Another thread
+	 * cannot resume it before its context is saved below, because it
+	 * would have to take async_futex first.
+	 */
 	switch (stype) {
 	case FIBRIL_PREEMPT:
-		list_append(&srcf->link, &ready_list);
+		ready_put(runner, srcf);
 		break;
 	case FIBRIL_FROM_MANAGER:
-		list_append(&srcf->link, &manager_list);
+		fibril_add_manager((fid_t) srcf);
 		break;
 	case FIBRIL_FROM_DEAD:
 	case FIBRIL_FROM_BLOCKED:
@@ -189,25 +500,32 @@ int fibril_switch(fibril_switch_type_t stype)
 		break;
 	}
 
+	/* The next fibril continues on this thread. */
+	dstf->runner = runner;
+	dstf->thread_id = srcf->thread_id;
+	srcf->running = false;
+	dstf->running = true;
+
 	/* Bookkeeping. */
-	futex_give_to(&fibril_futex, dstf);
 	futex_give_to(&async_futex, dstf);
 
+	if (srcf->stack != NULL) {
+		uintptr_t sp = (uintptr_t) __builtin_frame_address(0);
+		if ((srcf->stack_low == 0) || (sp < srcf->stack_low))
+			srcf->stack_low = sp;
+	}
+
 	/* Swap to the next fibril. */
 	context_swap(&srcf->ctx, &dstf->ctx);
 
 	/* Restored by another fibril! */
 
-	/* Must be after context_swap()! */
-	futex_unlock(&fibril_futex);
-
 	if (srcf->clean_after_me) {
 		/*
 		 * Cleanup after the dead fibril from which we
 		 * restored context here.
 		 */
-		void *stack = srcf->clean_after_me->stack;
-		if (stack) {
+		if (srcf->clean_after_me->stack) {
 			/*
 			 * This check is necessary because a
 			 * thread could have exited like a
@@ -216,9 +534,9 @@ int fibril_switch(fibril_switch_type_t stype)
 			 * case, its fibril will not have the
 			 * stack member filled.
 			 */
-			as_area_destroy(stack);
+			stack_put(srcf->runner, srcf->clean_after_me);
 		}
-		fibril_teardown(srcf->clean_after_me, true);
+		fibril_teardown(srcf->clean_after_me, false);
 		srcf->clean_after_me = NULL;
 	}
 
@@ -244,13 +562,12 @@ fid_t fibril_create_generic(errno_t (*func)(void *), void *arg, size_t stksz)
 
 	size_t stack_size = (stksz == FIBRIL_DFLT_STK_SIZE) ?
 	    stack_size_get() : stksz;
-	fibril->stack = as_area_create(AS_AREA_ANY, stack_size,
-	    AS_AREA_READ | AS_AREA_WRITE | AS_AREA_CACHEABLE | AS_AREA_GUARD |
-	    AS_AREA_LATE_RESERVE, AS_AREA_UNPAGED);
-	if (fibril->stack == (void *) -1) {
+	fibril->stack = stack_get(fibril_self()->runner, stack_size);
+	if (fibril->stack == NULL) {
 		fibril_teardown(fibril, false);
 		return 0;
 	}
+	fibril->stack_size = stack_size;
 
 	fibril->func = func;
 	fibril->arg = arg;
@@ -278,7 +595,7 @@ void fibril_destroy(fid_t fid)
 {
 	fibril_t *fibril = (fibril_t *) fid;
 
-	as_area_destroy(fibril->stack);
+	stack_put(fibril_self()->runner, fibril);
 	fibril_teardown(fibril, false);
 }
 
@@ -292,9 +609,7 @@ void fibril_add_ready(fid_t fid)
 {
 	fibril_t *fibril = (fibril_t *) fid;
 
-	futex_lock(&fibril_futex);
-	list_append(&fibril->link, &ready_list);
-	futex_unlock(&fibril_futex);
+	ready_put(fibril_self()->runner, fibril);
 }
 
 /** Add a fibril to the manager list.
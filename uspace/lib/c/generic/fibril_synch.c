@@ -104,6 +104,40 @@ static void check_for_deadlock(fibril_owner_info_t *oi)
 }
 
 
+/** Maximum number of polls of a contended fibril mutex before blocking. */
+#define FIBRIL_MUTEX_SPIN_MAX  1000
+
+/** Wait a while for a fibril mutex held by a fibril running in another thread.
+ *
+ * Blocking the fibril costs a round trip through the ready queues, which is
+ * much more than a short critical section of the owner. As long as the owner
+ * is executing in another thread, the mutex is therefore polled for a while
+ * before the caller blocks.
+ *
+ * Must be called with async_futex held, which is held again on return.
+ *
+ * @param fm Contended fibril mutex.
+ * @param f  Calling fibril.
+ */
+static void fibril_mutex_spin(fibril_mutex_t *fm, fibril_t *f)
+{
+	fibril_t *owner = fm->oi.owned_by;
+	if ((owner == NULL) || (owner == f) || (!owner->running))
+		return;
+
+	futex_unlock(&async_futex);
+
+	/* The owner must not be dereferenced without async_futex. */
+	for (unsigned int i = 0; i < FIBRIL_MUTEX_SPIN_MAX; i++) {
+		if (__atomic_load_n(&fm->counter, __ATOMIC_RELAXED) > 0)
+			break;
+		if (__atomic_load_n(&fm->oi.owned_by, __ATOMIC_RELAXED) != owner)
+			break;
+	}
+
+	futex_lock(&async_futex);
+}
+
 void fibril_mutex_initialize(fibril_mutex_t *fm)
 {
 	fm->oi.owned_by = NULL;
@@ -116,6 +150,9 @@ void fibril_mutex_lock(fibril_mutex_t *fm)
 	fibril_t *f = (fibril_t *) fibril_get_id();
 
 	futex_lock(&async_futex);
+	if (fm->counter <= 0)
+		fibril_mutex_spin(fm, f);
+
 	if (fm->counter-- <= 0) {
 		awaiter_t wdata;
 
@@ -395,8 +432,7 @@ fibril_condvar_wait_timeout(fibril_condvar_t *fcv, fibril_mutex_t *fm,
 	fibril_mutex_lock(fm);
 
 	futex_lock(&async_futex);
-	if (wdata.to_event.inlist)
-		list_remove(&wdata.to_event.link);
+	async_remove_timeout(&wdata);
 	if (wdata.wu_event.inlist)
 		list_remove(&wdata.wu_event.link);
 	futex_unlock(&async_futex);
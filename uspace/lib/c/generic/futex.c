@@ -53,6 +53,68 @@
 void futex_initialize(futex_t *futex, int val)
 {
 	atomic_set(&futex->val, val);
+	futex->flags = FUTEX_PRIVATE;
+}
+
+/** Initialize futex counter of a futex shared with other tasks.
+ *
+ * Such a futex is looked up by the kernel using the physical address of the
+ * counter, which is slower than for futexes private to the task.
+ *
+ * @param futex Futex.
+ * @param val   Initialization value.
+ *
+ */
+void futex_initialize_shared(futex_t *futex, int val)
+{
+	atomic_set(&futex->val, val);
+	futex->flags = FUTEX_SHARED;
+}
+
+/** Initialize an unlocked futex used as a priority-inheriting lock.
+ *
+ * While a thread sleeps on such a futex, the kernel lends the thread's
+ * priority to the thread holding the futex, provided both belong to the
+ * same task. The futex must not be used as a counting semaphore.
+ *
+ * @param futex Futex.
+ *
+ */
+void futex_initialize_pi(futex_t *futex)
+{
+	atomic_set(&futex->val, 1);
+	futex->flags = FUTEX_PI;
+	futex->holder = 0;
+}
+
+/** Record the calling thread as the holder of a FUTEX_PI futex.
+ *
+ * @param futex Futex which has just been acquired.
+ *
+ */
+void __futex_pi_acquired(futex_t *futex)
+{
+	fibril_t *self = fibril_self();
+	sysarg_t holder = (self != NULL) ? (sysarg_t) self->thread_id : 0;
+
+	__atomic_store_n(&futex->holder, holder, __ATOMIC_RELAXED);
+}
+
+/** Forget the calling thread as the holder of a FUTEX_PI futex.
+ *
+ * The holder is only cleared if it is still the calling thread, as
+ * futex_down_timeout() gives up a failed down by calling futex_up().
+ *
+ * @param futex Futex which is about to be released.
+ *
+ */
+void __futex_pi_released(futex_t *futex)
+{
+	fibril_t *self = fibril_self();
+	sysarg_t holder = (self != NULL) ? (sysarg_t) self->thread_id : 0;
+
+	(void) __atomic_compare_exchange_n(&futex->holder, &holder, 0, false,
+	    __ATOMIC_RELAXED, __ATOMIC_RELAXED);
 }
 
 #ifdef CONFIG_DEBUG_FUTEX
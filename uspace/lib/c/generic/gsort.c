@@ -35,12 +35,13 @@
  * @brief Sorting functions.
  *
  * This files contains functions implementing several sorting
- * algorithms (e.g. quick sort and gnome sort).
+ * algorithms (e.g. merge sort and insertion sort).
  *
  */
 
 #include <gsort.h>
 #include <inttypes.h>
+#include <macros.h>
 #include <mem.h>
 #include <stdlib.h>
 
@@ -57,9 +58,12 @@
  */
 #define INDEX(buf, i, elem_size)  ((buf) + (i) * (elem_size))
 
-/** Gnome sort
+/** Length of runs sorted by insertion sort before merging */
+#define RUN_SIZE  16
+
+/** Insertion sort
  *
- * Apply generic gnome sort algorithm on supplied data,
+ * Apply stable insertion sort on supplied data,
  * using pre-allocated buffer.
  *
  * @param data      Pointer to data to be sorted.
@@ -71,30 +75,127 @@
  *                  elem_size bytes long.
  *
  */
-static void _gsort(void *data, size_t cnt, size_t elem_size, sort_cmp_t cmp,
+static void _isort(void *data, size_t cnt, size_t elem_size, sort_cmp_t cmp,
     void *arg, void *slot)
 {
-	size_t i = 0;
+	for (size_t i = 1; i < cnt; i++) {
+		size_t j = i;
+
+		while ((j > 0) && (cmp(INDEX(data, i, elem_size),
+		    INDEX(data, j - 1, elem_size), arg) < 0))
+			j--;
 
-	while (i < cnt) {
-		if ((i != 0) &&
-		    (cmp(INDEX(data, i, elem_size),
-		    INDEX(data, i - 1, elem_size), arg) == -1)) {
+		if (j != i) {
 			memcpy(slot, INDEX(data, i, elem_size), elem_size);
-			memcpy(INDEX(data, i, elem_size), INDEX(data, i - 1, elem_size),
+			memmove(INDEX(data, j + 1, elem_size), INDEX(data, j, elem_size),
+			    (i - j) * elem_size);
+			memcpy(INDEX(data, j, elem_size), slot, elem_size);
+		}
+	}
+}
+
+/** Merge two adjacent sorted ranges
+ *
+ * Merge ranges [lo, mid) and [mid, hi) of @a src into the same
+ * range of @a dst. Elements of the first range go first when equal,
+ * which keeps the sort stable.
+ *
+ * @param dst       Destination array.
+ * @param src       Source array.
+ * @param lo        Start of the first range.
+ * @param mid       Start of the second range.
+ * @param hi        End of the second range.
+ * @param elem_size Size of one element.
+ * @param cmp       Comparator function.
+ * @param arg       3rd argument passed to cmp.
+ *
+ */
+static void _merge(void *dst, void *src, size_t lo, size_t mid, size_t hi,
+    size_t elem_size, sort_cmp_t cmp, void *arg)
+{
+	size_t i = lo;
+	size_t j = mid;
+	size_t k = lo;
+
+	/* Ranges that are already in order are just copied */
+	if ((i < mid) && (j < hi) && (cmp(INDEX(src, j, elem_size),
+	    INDEX(src, j - 1, elem_size), arg) >= 0)) {
+		memcpy(INDEX(dst, lo, elem_size), INDEX(src, lo, elem_size),
+		    (hi - lo) * elem_size);
+		return;
+	}
+
+	while ((i < mid) && (j < hi)) {
+		if (cmp(INDEX(src, j, elem_size), INDEX(src, i, elem_size), arg) < 0) {
+			memcpy(INDEX(dst, k, elem_size), INDEX(src, j, elem_size),
+			    elem_size);
+			j++;
+		} else {
+			memcpy(INDEX(dst, k, elem_size), INDEX(src, i, elem_size),
 			    elem_size);
-			memcpy(INDEX(data, i - 1, elem_size), slot, elem_size);
-			i--;
-		} else
 			i++;
+		}
+
+		k++;
+	}
+
+	memcpy(INDEX(dst, k, elem_size), INDEX(src, i, elem_size),
+	    (mid - i) * elem_size);
+	k += mid - i;
+	memcpy(INDEX(dst, k, elem_size), INDEX(src, j, elem_size),
+	    (hi - j) * elem_size);
+}
+
+/** Merge sort
+ *
+ * Sort runs of RUN_SIZE elements by insertion sort and then
+ * merge them bottom-up, alternating between @a data and @a buf.
+ *
+ * @param data      Pointer to data to be sorted.
+ * @param cnt       Number of elements to be sorted.
+ * @param elem_size Size of one element.
+ * @param cmp       Comparator function.
+ * @param arg       3rd argument passed to cmp.
+ * @param slot      Pointer to scratch memory buffer
+ *                  elem_size bytes long.
+ * @param buf       Pointer to scratch memory buffer
+ *                  cnt * elem_size bytes long.
+ *
+ */
+static void _msort(void *data, size_t cnt, size_t elem_size, sort_cmp_t cmp,
+    void *arg, void *slot, void *buf)
+{
+	for (size_t lo = 0; lo < cnt; lo += RUN_SIZE) {
+		size_t run = min(RUN_SIZE, cnt - lo);
+		_isort(INDEX(data, lo, elem_size), run, elem_size, cmp, arg, slot);
+	}
+
+	void *src = data;
+	void *dst = buf;
+
+	for (size_t width = RUN_SIZE; width < cnt; width *= 2) {
+		for (size_t lo = 0; lo < cnt; lo += 2 * width) {
+			size_t mid = min(lo + width, cnt);
+			size_t hi = min(lo + 2 * width, cnt);
+
+			_merge(dst, src, lo, mid, hi, elem_size, cmp, arg);
+		}
+
+		void *tmp = src;
+		src = dst;
+		dst = tmp;
 	}
+
+	if (src != data)
+		memcpy(data, src, cnt * elem_size);
 }
 
-/** Gnome sort wrapper
+/** Generic sort
  *
- * This is only a wrapper that takes care of memory
- * allocations for storing the slot element for generic
- * gnome sort algorithm.
+ * Sort the data stably using a merge sort. This takes care
+ * of memory allocations for the slot element and the merge
+ * buffer. If the merge buffer cannot be allocated, insertion
+ * sort is used instead.
  *
  * @param data      Pointer to data to be sorted.
  * @param cnt       Number of elements to be sorted.
@@ -117,7 +218,15 @@ bool gsort(void *data, size_t cnt, size_t elem_size, sort_cmp_t cmp, void *arg)
 	} else
 		slot = (void *) ibuf_slot;
 
-	_gsort(data, cnt, elem_size, cmp, arg, slot);
+	void *buf = NULL;
+	if (cnt > RUN_SIZE)
+		buf = malloc(cnt * elem_size);
+
+	if (buf != NULL) {
+		_msort(data, cnt, elem_size, cmp, arg, slot, buf);
+		free(buf);
+	} else
+		_isort(data, cnt, elem_size, cmp, arg, slot);
 
 	if (elem_size > IBUF_SIZE)
 		free(slot);
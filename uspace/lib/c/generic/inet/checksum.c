@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2018 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup libc
+ * @{
+ */
+/** @file Internet checksum
+ *
+ * One's complement checksum used by IP, ICMP, UDP and TCP (RFC 1071).
+ */
+
+#include <byteorder.h>
+#include <inet/checksum.h>
+#include <mem.h>
+
+/** Fold 64-bit sum of 32-bit words into 16-bit one's complement sum. */
+static uint16_t inet_checksum_fold(uint64_t sum)
+{
+	sum = (sum & 0xffffffff) + (sum >> 32);
+	sum = (sum & 0xffffffff) + (sum >> 32);
+	sum = (sum & 0xffff) + (sum >> 16);
+	sum = (sum & 0xffff) + (sum >> 16);
+	return sum;
+}
+
+/** Compute Internet checksum.
+ *
+ * The data is summed as 32-bit words in native byte order into a 64-bit
+ * accumulator, which defers all carry handling until the end. Since one's
+ * complement addition is byte order independent (RFC 1071 sec. 2), only
+ * the final result needs to be converted.
+ *
+ * If @a size is odd, data is padded with a zero byte. Checksum of data
+ * split into several parts can be computed by passing result of the
+ * previous part as @a ivalue as long as all parts but the last one have
+ * even size.
+ *
+ * @param ivalue Initial value (INET_CHECKSUM_INIT or checksum of previous
+ *               data)
+ * @param data   Data
+ * @param size   Data size in bytes
+ * @return       Checksum
+ */
+uint16_t inet_checksum_calc(uint16_t ivalue, const void *data, size_t size)
+{
+	const uint8_t *bdata = (const uint8_t *) data;
+	uint64_t sum;
+	uint32_t w[4];
+	uint16_t w16;
+	uint8_t last[2];
+
+	sum = host2uint16_t_be((uint16_t) ~ivalue);
+
+	while (size >= sizeof(w)) {
+		memcpy(w, bdata, sizeof(w));
+		sum += (uint64_t) w[0] + w[1] + w[2] + w[3];
+		bdata += sizeof(w);
+		size -= sizeof(w);
+	}
+
+	while (size >= sizeof(w[0])) {
+		memcpy(w, bdata, sizeof(w[0]));
+		sum += w[0];
+		bdata += sizeof(w[0]);
+		size -= sizeof(w[0]);
+	}
+
+	if (size >= sizeof(w16)) {
+		memcpy(&w16, bdata, sizeof(w16));
+		sum += w16;
+		bdata += sizeof(w16);
+		size -= sizeof(w16);
+	}
+
+	if (size != 0) {
+		last[0] = bdata[0];
+		last[1] = 0;
+		memcpy(&w16, last, sizeof(w16));
+		sum += w16;
+	}
+
+	return ~uint16_t_be2host(inet_checksum_fold(sum));
+}
+
+/** Update Internet checksum after 16-bit field has changed.
+ *
+ * Implements RFC 1624 eqn. 3, HC' = ~(~HC + ~m + m').
+ *
+ * @param cs   Original checksum
+ * @param oval Original field value
+ * @param nval New field value
+ * @return     Updated checksum
+ */
+uint16_t inet_checksum_update16(uint16_t cs, uint16_t oval, uint16_t nval)
+{
+	uint32_t sum;
+
+	sum = (uint16_t) ~cs + (uint32_t) (uint16_t) ~oval + nval;
+	sum = (sum & 0xffff) + (sum >> 16);
+	sum = (sum & 0xffff) + (sum >> 16);
+	return ~sum;
+}
+
+/** Update Internet checksum after 32-bit field has changed.
+ *
+ * @param cs   Original checksum
+ * @param oval Original field value
+ * @param nval New field value
+ * @return     Updated checksum
+ */
+uint16_t inet_checksum_update32(uint16_t cs, uint32_t oval, uint32_t nval)
+{
+	cs = inet_checksum_update16(cs, oval >> 16, nval >> 16);
+	return inet_checksum_update16(cs, oval & 0xffff, nval & 0xffff);
+}
+
+/** @}
+ */
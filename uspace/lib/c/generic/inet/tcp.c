@@ -32,6 +32,8 @@
 /** @file TCP API
  */
 
+#include <as.h>
+#include <assert.h>
 #include <errno.h>
 #include <fibril.h>
 #include <inet/endpoint.h>
@@ -262,6 +264,9 @@ void tcp_conn_destroy(tcp_conn_t *conn)
 	errno_t rc = async_req_1_0(exch, TCP_CONN_DESTROY, conn->id);
 	async_exchange_end(exch);
 
+	if (conn->shm != NULL)
+		as_area_destroy(conn->shm);
+
 	free(conn);
 	(void) rc;
 }
@@ -506,6 +511,27 @@ errno_t tcp_conn_push(tcp_conn_t *conn)
 	return rc;
 }
 
+/** Set connection no-delay option.
+ *
+ * With no-delay set, small segments are sent immediately even when
+ * there is unacknowledged data (the Nagle algorithm is disabled).
+ *
+ * @param conn    Connection
+ * @param nodelay @c true to enable no-delay, @c false to disable
+ * @return EOK on success or an error code
+ */
+errno_t tcp_conn_set_nodelay(tcp_conn_t *conn, bool nodelay)
+{
+	async_exch_t *exch;
+
+	exch = async_exchange_begin(conn->tcp->sess);
+	errno_t rc = async_req_2_0(exch, TCP_CONN_SET_NODELAY, conn->id,
+	    nodelay);
+	async_exchange_end(exch);
+
+	return rc;
+}
+
 /** Reset connection.
  *
  * @param conn Connection
@@ -630,6 +656,209 @@ again:
 	return EOK;
 }
 
+/** Get connection statistics.
+ *
+ * @param conn  Connection
+ * @param stats Place to store statistics
+ *
+ * @return EOK on success or an error code
+ */
+errno_t tcp_conn_get_stats(tcp_conn_t *conn, tcp_conn_stats_t *stats)
+{
+	async_exch_t *exch;
+	ipc_call_t answer;
+
+	exch = async_exchange_begin(conn->tcp->sess);
+	aid_t req = async_send_1(exch, TCP_CONN_GET_STATS, conn->id, &answer);
+	errno_t rc = async_data_read_start(exch, stats,
+	    sizeof(tcp_conn_stats_t));
+	async_exchange_end(exch);
+
+	if (rc != EOK) {
+		async_forget(req);
+		return rc;
+	}
+
+	errno_t retval;
+	async_wait_for(req, &retval);
+	return retval;
+}
+
+/** Set up memory shared with TCP server for connection data transfer.
+ *
+ * Create a memory area consisting of a send buffer and a receive buffer,
+ * each of @a bsize bytes, and share it with the TCP server. Data can then
+ * be written directly to the send buffer (see tcp_conn_shm_sbuf()) and
+ * read directly from the receive buffer, only notifying the server via
+ * tcp_conn_shm_send() and tcp_conn_shm_recv(), respectively.
+ *
+ * Any previously set up shared area is replaced.
+ *
+ * @param conn  Connection
+ * @param bsize Size of send and of receive buffer in bytes
+ *
+ * @return EOK on success or an error code
+ */
+errno_t tcp_conn_shm_setup(tcp_conn_t *conn, size_t bsize)
+{
+	async_exch_t *exch;
+	ipc_call_t answer;
+	void *shm;
+
+	if (bsize == 0)
+		return EINVAL;
+
+	shm = as_area_create(AS_AREA_ANY, 2 * bsize,
+	    AS_AREA_READ | AS_AREA_WRITE | AS_AREA_CACHEABLE, AS_AREA_UNPAGED);
+	if (shm == AS_MAP_FAILED)
+		return ENOMEM;
+
+	fibril_mutex_lock(&conn->lock);
+
+	exch = async_exchange_begin(conn->tcp->sess);
+	aid_t req = async_send_2(exch, TCP_CONN_SHM_SETUP, conn->id, bsize,
+	    &answer);
+	errno_t rc = async_share_out_start(exch, shm,
+	    AS_AREA_READ | AS_AREA_WRITE | AS_AREA_CACHEABLE);
+	async_exchange_end(exch);
+
+	if (rc != EOK) {
+		async_forget(req);
+		fibril_mutex_unlock(&conn->lock);
+		as_area_destroy(shm);
+		return rc;
+	}
+
+	errno_t retval;
+	async_wait_for(req, &retval);
+	if (retval != EOK) {
+		fibril_mutex_unlock(&conn->lock);
+		as_area_destroy(shm);
+		return retval;
+	}
+
+	if (conn->shm != NULL)
+		as_area_destroy(conn->shm);
+
+	conn->shm = shm;
+	conn->shm_bsize = bsize;
+	fibril_mutex_unlock(&conn->lock);
+	return EOK;
+}
+
+/** Get shared send buffer.
+ *
+ * @param conn  Connection with shared memory set up
+ * @param bsize Place to store size of the send buffer
+ *
+ * @return Send buffer where data for tcp_conn_shm_send() is to be placed
+ */
+void *tcp_conn_shm_sbuf(tcp_conn_t *conn, size_t *bsize)
+{
+	assert(conn->shm != NULL);
+	*bsize = conn->shm_bsize;
+	return conn->shm;
+}
+
+/** Send data from shared send buffer.
+ *
+ * Send @a size bytes from the start of the shared send buffer. When
+ * the function returns, the buffer can be reused.
+ *
+ * @param conn Connection with shared memory set up
+ * @param size Number of bytes to send
+ *
+ * @return EOK on success or an error code
+ */
+errno_t tcp_conn_shm_send(tcp_conn_t *conn, size_t size)
+{
+	async_exch_t *exch;
+	errno_t rc;
+
+	if (conn->shm == NULL)
+		return EINVAL;
+
+	if (size > conn->shm_bsize)
+		return EINVAL;
+
+	exch = async_exchange_begin(conn->tcp->sess);
+	rc = async_req_2_0(exch, TCP_CONN_SHM_SEND, conn->id, size);
+	async_exchange_end(exch);
+
+	return rc;
+}
+
+/** Receive data into shared receive buffer.
+ *
+ * If any received data is pending on the connection, up to the size of
+ * the shared receive buffer is placed into it. A pointer to the data
+ * is stored in @a *data, it is valid until the next call to this function.
+ *
+ * @param conn  Connection with shared memory set up
+ * @param data  Place to store pointer to received data
+ * @param nrecv Place to store actual number of received bytes
+ *
+ * @return EOK on success, EAGAIN if no received data is pending, or other
+ *         error code in case of other error
+ */
+errno_t tcp_conn_shm_recv(tcp_conn_t *conn, void **data, size_t *nrecv)
+{
+	async_exch_t *exch;
+	sysarg_t size;
+	errno_t rc;
+
+	if (conn->shm == NULL)
+		return EINVAL;
+
+	fibril_mutex_lock(&conn->lock);
+	if (!conn->data_avail) {
+		fibril_mutex_unlock(&conn->lock);
+		return EAGAIN;
+	}
+
+	exch = async_exchange_begin(conn->tcp->sess);
+	rc = async_req_1_1(exch, TCP_CONN_SHM_RECV, conn->id, &size);
+	async_exchange_end(exch);
+
+	if (rc != EOK) {
+		if (rc == EAGAIN)
+			conn->data_avail = false;
+		fibril_mutex_unlock(&conn->lock);
+		return rc;
+	}
+
+	*data = conn->shm + conn->shm_bsize;
+	*nrecv = size;
+	fibril_mutex_unlock(&conn->lock);
+	return EOK;
+}
+
+/** Receive data into shared receive buffer with blocking.
+ *
+ * Like tcp_conn_shm_recv(), but wait for data to become available.
+ *
+ * @param conn  Connection with shared memory set up
+ * @param data  Place to store pointer to received data
+ * @param nrecv Place to store actual number of received bytes
+ *
+ * @return EOK on success or an error code
+ */
+errno_t tcp_conn_shm_recv_wait(tcp_conn_t *conn, void **data, size_t *nrecv)
+{
+	errno_t rc;
+
+	while (true) {
+		fibril_mutex_lock(&conn->lock);
+		while (!conn->data_avail)
+			fibril_condvar_wait(&conn->cv, &conn->lock);
+		fibril_mutex_unlock(&conn->lock);
+
+		rc = tcp_conn_shm_recv(conn, data, nrecv);
+		if (rc != EAGAIN)
+			return rc;
+	}
+}
+
 /** Connection established event.
  *
  * @param tcp           TCP client
@@ -759,6 +988,70 @@ tcp_ev_urg_data(tcp_t *tcp, cap_call_handle_t icall_handle, ipc_call_t *icall)
 	async_answer_0(icall_handle, ENOTSUP);
 }
 
+/** Destroy connection which has no local connection object.
+ *
+ * @param tcp     TCP client
+ * @param conn_id Connection ID
+ */
+static void tcp_conn_id_destroy(tcp_t *tcp, sysarg_t conn_id)
+{
+	async_exch_t *exch;
+
+	exch = async_exchange_begin(tcp->sess);
+	errno_t rc = async_req_1_0(exch, TCP_CONN_DESTROY, conn_id);
+	async_exchange_end(exch);
+
+	(void) rc;
+}
+
+/** Set up incoming connection and hand it over to listener.
+ *
+ * If the connection cannot be set up, it is destroyed so that it is not
+ * left behind in the server.
+ *
+ * @param tcp     TCP client
+ * @param lst     Listener
+ * @param conn_id Connection ID
+ *
+ * @return EOK on success or ENOMEM if out of memory
+ */
+static errno_t tcp_lst_new_conn(tcp_t *tcp, tcp_listener_t *lst,
+    sysarg_t conn_id)
+{
+	tcp_conn_t *conn;
+	fid_t fid;
+	tcp_in_conn_t *cinfo;
+	errno_t rc;
+
+	rc = tcp_conn_new(tcp, conn_id, lst->cb, lst->cb_arg, &conn);
+	if (rc != EOK) {
+		tcp_conn_id_destroy(tcp, conn_id);
+		return ENOMEM;
+	}
+
+	if (lst->lcb != NULL && lst->lcb->new_conn != NULL) {
+		cinfo = calloc(1, sizeof(tcp_in_conn_t));
+		if (cinfo == NULL) {
+			tcp_conn_destroy(conn);
+			return ENOMEM;
+		}
+
+		cinfo->lst = lst;
+		cinfo->conn = conn;
+
+		fid = fibril_create(tcp_conn_fibril, cinfo);
+		if (fid == 0) {
+			free(cinfo);
+			tcp_conn_destroy(conn);
+			return ENOMEM;
+		}
+
+		fibril_add_ready(fid);
+	}
+
+	return EOK;
+}
+
 /** New connection event.
  *
  * @param tcp           TCP client
@@ -769,11 +1062,8 @@ static void
 tcp_ev_new_conn(tcp_t *tcp, cap_call_handle_t icall_handle, ipc_call_t *icall)
 {
 	tcp_listener_t *lst;
-	tcp_conn_t *conn;
 	sysarg_t lst_id;
 	sysarg_t conn_id;
-	fid_t fid;
-	tcp_in_conn_t *cinfo;
 	errno_t rc;
 
 	lst_id = IPC_GET_ARG1(*icall);
@@ -781,35 +1071,69 @@ tcp_ev_new_conn(tcp_t *tcp, cap_call_handle_t icall_handle, ipc_call_t *icall)
 
 	rc = tcp_listener_get(tcp, lst_id, &lst);
 	if (rc != EOK) {
+		tcp_conn_id_destroy(tcp, conn_id);
 		async_answer_0(icall_handle, ENOENT);
 		return;
 	}
 
-	rc = tcp_conn_new(tcp, conn_id, lst->cb, lst->cb_arg, &conn);
+	rc = tcp_lst_new_conn(tcp, lst, conn_id);
+	async_answer_0(icall_handle, rc);
+}
+
+/** Multiple new connections event.
+ *
+ * Connection IDs are transferred in a data write following the call.
+ *
+ * @param tcp           TCP client
+ * @param icall_handle  Call handle
+ * @param icall         Call data
+ */
+static void
+tcp_ev_new_conns(tcp_t *tcp, cap_call_handle_t icall_handle, ipc_call_t *icall)
+{
+	tcp_listener_t *lst;
+	sysarg_t lst_id;
+	sysarg_t *ids;
+	size_t cnt;
+	size_t size;
+	size_t i;
+	errno_t rc;
+
+	lst_id = IPC_GET_ARG1(*icall);
+	cnt = IPC_GET_ARG2(*icall);
+
+	rc = async_data_write_accept((void **) &ids, false, sizeof(sysarg_t),
+	    cnt * sizeof(sysarg_t), sizeof(sysarg_t), &size);
 	if (rc != EOK) {
-		async_answer_0(icall_handle, ENOMEM);
+		async_answer_0(icall_handle, rc);
 		return;
 	}
 
-	if (lst->lcb != NULL && lst->lcb->new_conn != NULL) {
-		cinfo = calloc(1, sizeof(tcp_in_conn_t));
-		if (cinfo == NULL) {
-			async_answer_0(icall_handle, ENOMEM);
-			return;
-		}
-
-		cinfo->lst = lst;
-		cinfo->conn = conn;
+	rc = tcp_listener_get(tcp, lst_id, &lst);
+	if (rc != EOK) {
+		cnt = size / sizeof(sysarg_t);
+		for (i = 0; i < cnt; i++)
+			tcp_conn_id_destroy(tcp, ids[i]);
 
-		fid = fibril_create(tcp_conn_fibril, cinfo);
-		if (fid == 0) {
-			async_answer_0(icall_handle, ENOMEM);
-		}
+		free(ids);
+		async_answer_0(icall_handle, ENOENT);
+		return;
+	}
 
-		fibril_add_ready(fid);
+	/*
+	 * Set up all connections even if some fail, each failed one is
+	 * destroyed by tcp_lst_new_conn(). Report the first error.
+	 */
+	rc = EOK;
+	cnt = size / sizeof(sysarg_t);
+	for (i = 0; i < cnt; i++) {
+		errno_t crc = tcp_lst_new_conn(tcp, lst, ids[i]);
+		if (crc != EOK && rc == EOK)
+			rc = crc;
 	}
 
-	async_answer_0(icall_handle, EOK);
+	free(ids);
+	async_answer_0(icall_handle, rc);
 }
 
 /** Callback connection handler.
@@ -853,6 +1177,9 @@ tcp_cb_conn(cap_call_handle_t icall_handle, ipc_call_t *icall, void *arg)
 		case TCP_EV_NEW_CONN:
 			tcp_ev_new_conn(tcp, chandle, &call);
 			break;
+		case TCP_EV_NEW_CONNS:
+			tcp_ev_new_conns(tcp, chandle, &call);
+			break;
 		default:
 			async_answer_0(chandle, ENOTSUP);
 			break;
@@ -32,14 +32,23 @@
 /** @file UDP API
  */
 
+#include <align.h>
 #include <errno.h>
 #include <inet/endpoint.h>
 #include <inet/udp.h>
 #include <ipc/services.h>
 #include <ipc/udp.h>
 #include <loc.h>
+#include <macros.h>
+#include <mem.h>
 #include <stdlib.h>
 
+/** Size of buffer for receiving message batches */
+#define UDP_RBUF_SIZE DATA_XFER_LIMIT
+
+/** Maximum number of messages passed to one recv_batch callback */
+#define UDP_RMSG_BATCH_MAX 32
+
 static void udp_cb_conn(cap_call_handle_t, ipc_call_t *, void *);
 
 /** Create callback connection from UDP service.
@@ -133,6 +142,7 @@ void udp_destroy(udp_t *udp)
 		fibril_condvar_wait(&udp->cv, &udp->lock);
 	fibril_mutex_unlock(&udp->lock);
 
+	free(udp->rbuf);
 	free(udp);
 }
 
@@ -322,6 +332,14 @@ errno_t udp_rmsg_read(udp_rmsg_t *rmsg, size_t off, void *buf, size_t bsize)
 	async_exch_t *exch;
 	ipc_call_t answer;
 
+	if (rmsg->data != NULL) {
+		if (off > rmsg->size)
+			return EINVAL;
+
+		memcpy(buf, rmsg->data + off, min(rmsg->size - off, bsize));
+		return EOK;
+	}
+
 	exch = async_exchange_begin(rmsg->udp->sess);
 	aid_t req = async_send_1(exch, UDP_RMSG_READ, off, &answer);
 	errno_t rc = async_data_read_start(exch, buf, bsize);
@@ -406,6 +424,47 @@ static errno_t udp_rmsg_info(udp_t *udp, udp_rmsg_t *rmsg)
 	rmsg->assoc_id = IPC_GET_ARG1(answer);
 	rmsg->size = IPC_GET_ARG2(answer);
 	rmsg->remote_ep = ep;
+	rmsg->data = NULL;
+	return EOK;
+}
+
+/** Read and discard a batch of received messages from UDP service.
+ *
+ * @param udp    UDP client
+ * @param rcount Place to store number of messages read
+ * @param rsize  Place to store number of bytes stored in @c udp->rbuf
+ *
+ * @return EOK on success, ENOENT if there are no messages, ELIMIT if
+ *         the next message does not fit into the buffer or an error code
+ */
+static errno_t udp_rmsg_read_batch(udp_t *udp, size_t *rcount, size_t *rsize)
+{
+	async_exch_t *exch;
+	ipc_call_t answer;
+
+	if (udp->rbuf == NULL) {
+		udp->rbuf = malloc(UDP_RBUF_SIZE);
+		if (udp->rbuf == NULL)
+			return ENOMEM;
+	}
+
+	exch = async_exchange_begin(udp->sess);
+	aid_t req = async_send_0(exch, UDP_RMSG_READ_BATCH, &answer);
+	errno_t rc = async_data_read_start(exch, udp->rbuf, UDP_RBUF_SIZE);
+	async_exchange_end(exch);
+
+	if (rc != EOK) {
+		async_forget(req);
+		return rc;
+	}
+
+	errno_t retval;
+	async_wait_for(req, &retval);
+	if (retval != EOK)
+		return retval;
+
+	*rcount = IPC_GET_ARG1(answer);
+	*rsize = IPC_GET_ARG2(answer);
 	return EOK;
 }
 
@@ -445,39 +504,142 @@ static errno_t udp_assoc_get(udp_t *udp, sysarg_t id, udp_assoc_t **rassoc)
 	return EINVAL;
 }
 
-/** Handle 'data' event, i.e. some message(s) arrived.
+/** Deliver received messages to an association.
  *
- * For each received message, get information about it, call @c recv_msg
- * callback and discard it.
+ * @param assoc Association
+ * @param rmsg  Array of received messages
+ * @param count Number of messages
+ */
+static void udp_assoc_deliver(udp_assoc_t *assoc, udp_rmsg_t *rmsg,
+    size_t count)
+{
+	size_t i;
+
+	if (assoc->cb == NULL)
+		return;
+
+	if (assoc->cb->recv_batch != NULL) {
+		assoc->cb->recv_batch(assoc, rmsg, count);
+		return;
+	}
+
+	if (assoc->cb->recv_msg != NULL) {
+		for (i = 0; i < count; i++)
+			assoc->cb->recv_msg(assoc, &rmsg[i]);
+	}
+}
+
+/** Receive and deliver next message one IPC call at a time.
+ *
+ * Get information about the next message, call the association callback
+ * and discard the message.
  *
  * @param udp UDP client
- * @param iid IPC message ID
- * @param icall IPC message
+ * @return EOK on success, ENOENT if there are no more messages or
+ *         an error code
  */
-static void udp_ev_data(udp_t *udp, cap_call_handle_t icall_handle, ipc_call_t *icall)
+static errno_t udp_ev_data_single(udp_t *udp)
 {
 	udp_rmsg_t rmsg;
 	udp_assoc_t *assoc;
 	errno_t rc;
 
-	while (true) {
-		rc = udp_rmsg_info(udp, &rmsg);
-		if (rc != EOK) {
+	rc = udp_rmsg_info(udp, &rmsg);
+	if (rc != EOK)
+		return rc;
+
+	rc = udp_assoc_get(udp, rmsg.assoc_id, &assoc);
+	if (rc == EOK)
+		udp_assoc_deliver(assoc, &rmsg, 1);
+
+	return udp_rmsg_discard(udp);
+}
+
+/** Deliver messages from a batch read into @c udp->rbuf.
+ *
+ * Consecutive messages for the same association are passed to it
+ * in a single call.
+ *
+ * @param udp   UDP client
+ * @param count Number of messages in buffer
+ * @param size  Number of valid bytes in buffer
+ */
+static void udp_ev_data_batch(udp_t *udp, size_t count, size_t size)
+{
+	udp_rmsg_t rmsg[UDP_RMSG_BATCH_MAX];
+	udp_rmsg_hdr_t *hdr;
+	udp_assoc_t *assoc = NULL;
+	size_t n = 0;
+	size_t off = 0;
+	size_t i;
+	errno_t rc;
+
+	for (i = 0; i < count; i++) {
+		if (size - off < sizeof(udp_rmsg_hdr_t))
 			break;
+
+		hdr = (udp_rmsg_hdr_t *) (udp->rbuf + off);
+		if (hdr->size > size - off - sizeof(udp_rmsg_hdr_t))
+			break;
+
+		if (n > 0 && (n == UDP_RMSG_BATCH_MAX ||
+		    rmsg[0].assoc_id != hdr->assoc_id)) {
+			if (assoc != NULL)
+				udp_assoc_deliver(assoc, rmsg, n);
+			n = 0;
 		}
 
-		rc = udp_assoc_get(udp, rmsg.assoc_id, &assoc);
-		if (rc != EOK) {
+		if (n == 0) {
+			rc = udp_assoc_get(udp, hdr->assoc_id, &assoc);
+			if (rc != EOK)
+				assoc = NULL;
+		}
+
+		rmsg[n].udp = udp;
+		rmsg[n].assoc_id = hdr->assoc_id;
+		rmsg[n].size = hdr->size;
+		rmsg[n].remote_ep = hdr->remote_ep;
+		rmsg[n].data = udp->rbuf + off + sizeof(udp_rmsg_hdr_t);
+		++n;
+
+		off = min((size_t) ALIGN_UP(off + sizeof(udp_rmsg_hdr_t) +
+		    hdr->size, sizeof(sysarg_t)), size);
+	}
+
+	if (n > 0 && assoc != NULL)
+		udp_assoc_deliver(assoc, rmsg, n);
+}
+
+/** Handle 'data' event, i.e. some message(s) arrived.
+ *
+ * Read received messages in batches, deliver them to the association
+ * callbacks and keep going until the receive queue is empty. Messages
+ * too large for a batch are received one at a time.
+ *
+ * @param udp UDP client
+ * @param iid IPC message ID
+ * @param icall IPC message
+ */
+static void udp_ev_data(udp_t *udp, cap_call_handle_t icall_handle, ipc_call_t *icall)
+{
+	size_t count;
+	size_t size;
+	errno_t rc;
+
+	while (true) {
+		rc = udp_rmsg_read_batch(udp, &count, &size);
+		if (rc == EOK) {
+			udp_ev_data_batch(udp, count, size);
 			continue;
 		}
 
-		if (assoc->cb != NULL && assoc->cb->recv_msg != NULL)
-			assoc->cb->recv_msg(assoc, &rmsg);
+		if (rc != ELIMIT && rc != ENOMEM)
+			break;
 
-		rc = udp_rmsg_discard(udp);
-		if (rc != EOK) {
+		/* Fall back to receiving a single message */
+		rc = udp_ev_data_single(udp);
+		if (rc != EOK)
 			break;
-		}
 	}
 
 	async_answer_0(icall_handle, EOK);
@@ -38,8 +38,23 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include <as.h>
+#include <mem.h>
 #include <io/chargrid.h>
 
+/** Compute chargrid size.
+ *
+ * @param[in] cols Number of columns.
+ * @param[in] rows Number of rows.
+ *
+ * @return Size of the chargrid including the dirty row bitmap (in bytes).
+ *
+ */
+size_t chargrid_size(sysarg_t cols, sysarg_t rows)
+{
+	return sizeof(chargrid_t) + cols * rows * sizeof(charfield_t) +
+	    (rows + 7) / 8;
+}
+
 /** Create a chargrid.
  *
  * @param[in] cols  Number of columns.
@@ -53,8 +68,7 @@
 chargrid_t *chargrid_create(sysarg_t cols, sysarg_t rows,
     chargrid_flag_t flags)
 {
-	size_t size =
-	    sizeof(chargrid_t) + cols * rows * sizeof(charfield_t);
+	size_t size = chargrid_size(cols, rows);
 	chargrid_t *scrbuf;
 
 	if ((flags & CHARGRID_FLAG_SHARED) == CHARGRID_FLAG_SHARED) {
@@ -79,6 +93,8 @@ chargrid_t *chargrid_create(sysarg_t cols, sysarg_t rows,
 	scrbuf->attrs.val.style = STYLE_NORMAL;
 
 	scrbuf->top_row = 0;
+	scrbuf->dirty_offset =
+	    sizeof(chargrid_t) + cols * rows * sizeof(charfield_t);
 	chargrid_clear(scrbuf);
 
 	return scrbuf;
@@ -150,6 +166,7 @@ sysarg_t chargrid_putwchar(chargrid_t *scrbuf, wchar_t ch, bool update)
 	field->ch = ch;
 	field->attrs = scrbuf->attrs;
 	field->flags |= CHAR_FLAG_DIRTY;
+	chargrid_set_row_dirty(scrbuf, scrbuf->row);
 
 	if (update) {
 		scrbuf->col++;
@@ -249,6 +266,8 @@ void chargrid_clear(chargrid_t *scrbuf)
 		scrbuf->data[pos].flags = CHAR_FLAG_DIRTY;
 	}
 
+	memset(chargrid_dirty_map(scrbuf), 0xff, (scrbuf->rows + 7) / 8);
+
 	scrbuf->col = 0;
 	scrbuf->row = 0;
 }
@@ -309,6 +328,8 @@ void chargrid_clear_row(chargrid_t *scrbuf, sysarg_t row)
 		field->attrs = scrbuf->attrs;
 		field->flags |= CHAR_FLAG_DIRTY;
 	}
+
+	chargrid_set_row_dirty(scrbuf, row);
 }
 
 /** Set chargrid style.
@@ -169,6 +169,47 @@ static void input_ev_button(input_t *input, cap_call_handle_t chandle,
 	async_answer_0(chandle, rc);
 }
 
+static void input_ev_batch(input_t *input, cap_call_handle_t chandle,
+    ipc_call_t *call)
+{
+	input_batch_event_t *events;
+	size_t size;
+
+	errno_t rc = async_data_write_accept((void **) &events, false,
+	    sizeof(input_batch_event_t),
+	    INPUT_BATCH_MAX * sizeof(input_batch_event_t),
+	    sizeof(input_batch_event_t), &size);
+	async_answer_0(chandle, rc);
+	if (rc != EOK)
+		return;
+
+	/* Events are delivered in the order they happened. */
+	for (size_t i = 0; i < size / sizeof(input_batch_event_t); i++) {
+		const sysarg_t *arg = events[i].arg;
+
+		switch (events[i].method) {
+		case INPUT_EVENT_KEY:
+			input->ev_ops->key(input, arg[0], arg[1], arg[2],
+			    arg[3]);
+			break;
+		case INPUT_EVENT_MOVE:
+			input->ev_ops->move(input, (int) arg[0], (int) arg[1]);
+			break;
+		case INPUT_EVENT_ABS_MOVE:
+			input->ev_ops->abs_move(input, arg[0], arg[1], arg[2],
+			    arg[3]);
+			break;
+		case INPUT_EVENT_BUTTON:
+			input->ev_ops->button(input, arg[0], arg[1]);
+			break;
+		default:
+			break;
+		}
+	}
+
+	free(events);
+}
+
 static void input_cb_conn(cap_call_handle_t icall_handle, ipc_call_t *icall, void *arg)
 {
 	input_t *input = (input_t *)arg;
@@ -201,6 +242,9 @@ static void input_cb_conn(cap_call_handle_t icall_handle, ipc_call_t *icall, voi
 		case INPUT_EVENT_BUTTON:
 			input_ev_button(input, chandle, &call);
 			break;
+		case INPUT_EVENT_BATCH:
+			input_ev_batch(input, chandle, &call);
+			break;
 		default:
 			async_answer_0(chandle, ENOTSUP);
 		}
@@ -38,6 +38,7 @@
 #include <errno.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <mem.h>
 #include <async.h>
 #include <io/kio.h>
 #include <vfs/vfs.h>
@@ -49,6 +50,12 @@
 #include "../private/io.h"
 #include "../private/stdio.h"
 
+/** Number of file system blocks in an automatically sized stream buffer */
+#define STDIO_BUF_BLOCKS  8
+
+/** Maximum size of an automatically sized stream buffer */
+#define STDIO_BUF_MAX  (64 * 1024)
+
 static void _ffillbuf(FILE *stream);
 static void _fflushbuf(FILE *stream);
 
@@ -60,6 +67,7 @@ static size_t stdio_vfs_read(void *, size_t, size_t, FILE *);
 static size_t stdio_vfs_write(const void *, size_t, size_t, FILE *);
 
 static int stdio_vfs_flush(FILE *);
+static errno_t stdio_vfs_size(FILE *, aoff64_t *);
 
 /** KIO stream ops */
 static __stream_ops_t stdio_kio_ops = {
@@ -72,7 +80,8 @@ static __stream_ops_t stdio_kio_ops = {
 static __stream_ops_t stdio_vfs_ops = {
 	.read = stdio_vfs_read,
 	.write = stdio_vfs_write,
-	.flush = stdio_vfs_flush
+	.flush = stdio_vfs_flush,
+	.size = stdio_vfs_size
 };
 
 static FILE stdin_null = {
@@ -278,8 +287,29 @@ static void _setvbuf(FILE *stream)
 		setvbuf(stream, NULL, _IONBF, 0);
 		break;
 	default:
-		setvbuf(stream, NULL, _IOFBF, BUFSIZ);
+		/* Buffer size is chosen by _fallocbuf() */
+		setvbuf(stream, NULL, _IOFBF, 0);
+	}
+}
+
+/** Choose stream buffer size.
+ *
+ * The buffer of a file spans several blocks of the file system holding
+ * it so that each transfer to or from the file system is large enough.
+ */
+static size_t _fbufsize(FILE *stream)
+{
+	vfs_statfs_t st;
+	size_t size = BUFSIZ;
+
+	if (stream->ops == &stdio_vfs_ops &&
+	    vfs_statfs(stream->fd, &st) == EOK) {
+		while (size < STDIO_BUF_BLOCKS * (size_t) st.f_bsize &&
+		    size < STDIO_BUF_MAX)
+			size *= 2;
 	}
+
+	return size;
 }
 
 /** Allocate stream buffer. */
@@ -287,6 +317,9 @@ static int _fallocbuf(FILE *stream)
 {
 	assert(stream->buf == NULL);
 
+	if (stream->buf_size == 0)
+		stream->buf_size = _fbufsize(stream);
+
 	stream->buf = malloc(stream->buf_size);
 	if (stream->buf == NULL) {
 		errno = ENOMEM;
@@ -390,6 +423,38 @@ FILE *fdopen(int fd, const char *mode)
 	return stream;
 }
 
+/** Open a stream with custom operations.
+ *
+ * The stream is unbuffered and not associated with any file descriptor.
+ *
+ * @param ops Stream operations.
+ * @param arg Instance argument.
+ *
+ * @return New stream or NULL if out of memory.
+ */
+FILE *__stdio_open(__stream_ops_t *ops, void *arg)
+{
+	FILE *stream = malloc(sizeof(FILE));
+	if (stream == NULL) {
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	stream->fd = -1;
+	stream->pos = 0;
+	stream->error = false;
+	stream->eof = false;
+	stream->ops = ops;
+	stream->arg = arg;
+	stream->sess = NULL;
+	stream->need_sync = false;
+	setvbuf(stream, NULL, _IONBF, 0);
+	stream->ungetc_chars = 0;
+
+	list_append(&stream->link, &files);
+
+	return stream;
+}
 
 static int _fclose_nofree(FILE *stream)
 {
@@ -403,6 +468,9 @@ static int _fclose_nofree(FILE *stream)
 	if (stream->fd >= 0)
 		rc = vfs_put(stream->fd);
 
+	if (stream->ops->close != NULL)
+		stream->ops->close(stream);
+
 	list_remove(&stream->link);
 
 	if (rc != EOK) {
@@ -496,21 +564,13 @@ static size_t _fwrite(const void *buf, size_t size, size_t nmemb, FILE *stream)
  */
 static void _ffillbuf(FILE *stream)
 {
-	errno_t rc;
 	size_t nread;
 
 	stream->buf_head = stream->buf_tail = stream->buf;
 
-	rc = vfs_read(stream->fd, &stream->pos, stream->buf, stream->buf_size,
-	    &nread);
-	if (rc != EOK) {
-		errno = rc;
-		stream->error = true;
-		return;
-	}
-
-	if (nread == 0) {
-		stream->eof = true;
+	nread = _fread(stream->buf, 1, stream->buf_size, stream);
+	if (stream->error || nread == 0) {
+		/* Error or end-of-file indicator was set by _fread() */
 		return;
 	}
 
@@ -560,7 +620,6 @@ size_t fread(void *dest, size_t size, size_t nmemb, FILE *stream)
 	size_t now;
 	size_t data_avail;
 	size_t total_read;
-	size_t i;
 
 	if (size == 0 || nmemb == 0)
 		return 0;
@@ -578,7 +637,7 @@ size_t fread(void *dest, size_t size, size_t nmemb, FILE *stream)
 
 	/* If not buffered stream, read in directly. */
 	if (stream->btype == _IONBF) {
-		total_read += _fread(dest, 1, bytes_left, stream);
+		total_read += _fread(dp, 1, bytes_left, stream);
 		return total_read / size;
 	}
 
@@ -593,8 +652,21 @@ size_t fread(void *dest, size_t size, size_t nmemb, FILE *stream)
 	}
 
 	while ((!stream->error) && (!stream->eof) && (bytes_left > 0)) {
-		if (stream->buf_head == stream->buf_tail)
+		if (stream->buf_head == stream->buf_tail) {
+			if (bytes_left >= stream->buf_size) {
+				/*
+				 * The buffer is empty and the rest would not
+				 * fit into it. Read it in directly.
+				 */
+				now = _fread(dp, 1, bytes_left, stream);
+				dp += now;
+				bytes_left -= now;
+				total_read += now;
+				continue;
+			}
+
 			_ffillbuf(stream);
+		}
 
 		if (stream->error || stream->eof) {
 			/* On error errno was set by _ffillbuf() */
@@ -608,9 +680,7 @@ size_t fread(void *dest, size_t size, size_t nmemb, FILE *stream)
 		else
 			now = bytes_left;
 
-		for (i = 0; i < now; i++) {
-			dp[i] = stream->buf_tail[i];
-		}
+		memcpy(dp, stream->buf_tail, now);
 
 		dp += now;
 		stream->buf_tail += now;
@@ -667,6 +737,26 @@ size_t fwrite(const void *buf, size_t size, size_t nmemb, FILE *stream)
 	need_flush = false;
 
 	while ((!stream->error) && (bytes_left > 0)) {
+		if (stream->buf_head == stream->buf &&
+		    bytes_left >= stream->buf_size) {
+			/*
+			 * The buffer is empty and the rest would not fit
+			 * into it. Write it out directly.
+			 */
+			now = _fwrite(data, 1, bytes_left, stream);
+			if ((stream->btype == _IOLBF) &&
+			    (memchr(data, '\n', now) != NULL))
+				need_flush = true;
+
+			data += now;
+			bytes_left -= now;
+			total_written += now;
+			if (now == 0)
+				break;
+
+			continue;
+		}
+
 		buf_free = stream->buf_size - (stream->buf_head - stream->buf);
 		if (bytes_left > buf_free)
 			now = buf_free;
@@ -835,7 +925,7 @@ int fseek64(FILE *stream, off64_t offset, int whence)
 
 	stream->ungetc_chars = 0;
 
-	vfs_stat_t st;
+	aoff64_t size;
 	switch (whence) {
 	case SEEK_SET:
 		stream->pos = offset;
@@ -844,13 +934,18 @@ int fseek64(FILE *stream, off64_t offset, int whence)
 		stream->pos += offset;
 		break;
 	case SEEK_END:
-		rc = vfs_stat(stream->fd, &st);
+		if (stream->ops->size == NULL) {
+			errno = ESPIPE;
+			return -1;
+		}
+
+		rc = stream->ops->size(stream, &size);
 		if (rc != EOK) {
 			errno = rc;
 			stream->error = true;
 			return -1;
 		}
-		stream->pos = st.size + offset;
+		stream->pos = size + offset;
 		break;
 	}
 
@@ -1046,5 +1141,19 @@ static int stdio_vfs_flush(FILE *stream)
 	return 0;
 }
 
+/** Get size of VFS stream. */
+static errno_t stdio_vfs_size(FILE *stream, aoff64_t *size)
+{
+	vfs_stat_t st;
+	errno_t rc;
+
+	rc = vfs_stat(stream->fd, &st);
+	if (rc != EOK)
+		return rc;
+
+	*size = st.size;
+	return EOK;
+}
+
 /** @}
  */
@@ -38,10 +38,14 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <async.h>
+#include <async_ring.h>
 #include <io/log.h>
 #include <ipc/logger.h>
+#include <macros.h>
 #include <str.h>
 #include <ns.h>
+#include <stdint.h>
+#include <sys/time.h>
 
 /** Id of the first log we create at logger. */
 static sysarg_t default_log_id;
@@ -63,8 +67,105 @@ static const char *log_level_names[] = {
 /** IPC session with the logger service. */
 static async_sess_t *logger_session;
 
+/** Ring for batched delivery of messages (NULL if not attached). */
+static async_ring_t *logger_ring;
+
+/** Serializes writers of the ring. */
+static FIBRIL_MUTEX_INITIALIZE(logger_ring_guard);
+
+/** Number of messages dropped since the last one put into the ring. */
+static uint32_t logger_ring_dropped;
+
+/** Wall clock time when the ring was attached. */
+static struct timeval logger_ring_epoch;
+
+/** Uptime in nanoseconds when the ring was attached. */
+static uint64_t logger_ring_epoch_nsec;
+
 /** Maximum length of a single log message (in bytes). */
-#define MESSAGE_BUFFER_SIZE 4096
+#define MESSAGE_BUFFER_SIZE LOGGER_MESSAGE_MAX
+
+/** Size of the on-stack buffer used for typical (short) messages. */
+#define MESSAGE_STACK_BUFFER_SIZE 256
+
+/** Attach a ring for batched delivery of messages to the logger.
+ *
+ * If the ring cannot be set up, messages are sent using IPC one by one.
+ */
+static void logger_attach_ring(void)
+{
+	async_exch_t *exchange = async_exchange_begin(logger_session);
+	if (exchange == NULL)
+		return;
+
+	async_ring_t *ring;
+	aid_t req = async_send_0(exchange, LOGGER_WRITER_ATTACH_RING, NULL);
+	errno_t rc = async_ring_create(exchange, LOGGER_RING_SIZE, &ring);
+	errno_t req_rc;
+	async_wait_for(req, &req_rc);
+
+	async_exchange_end(exchange);
+
+	if (rc != EOK)
+		return;
+
+	if (req_rc != EOK) {
+		async_ring_destroy(ring);
+		return;
+	}
+
+	/*
+	 * Reading the wall clock may require IPC with the clock driver.
+	 * Timestamps of the records are derived from the uptime instead,
+	 * which is both cheaper and of higher resolution.
+	 */
+	gettimeofday(&logger_ring_epoch, NULL);
+	logger_ring_epoch_nsec = getuptime_nsec();
+
+	logger_ring = ring;
+}
+
+/** Put a message into the ring.
+ *
+ * The message is dropped (and accounted for) rather than waiting
+ * for the logger if there is not enough space in the ring.
+ *
+ * @param log Log to use.
+ * @param level Verbosity level of the message.
+ * @param message The actual message.
+ */
+static void logger_ring_message(log_t log, log_level_t level,
+    const char *message)
+{
+	logger_record_t record;
+	uint64_t usec;
+
+	usec = logger_ring_epoch.tv_usec +
+	    (getuptime_nsec() - logger_ring_epoch_nsec) / 1000;
+
+	record.log = log;
+	record.tv_sec = logger_ring_epoch.tv_sec + usec / 1000000;
+	record.tv_usec = usec % 1000000;
+	record.level = level;
+	record.size = str_size(message);
+
+	fibril_mutex_lock(&logger_ring_guard);
+
+	if (async_ring_space(logger_ring) < sizeof(record) + record.size) {
+		logger_ring_dropped++;
+		fibril_mutex_unlock(&logger_ring_guard);
+		return;
+	}
+
+	record.dropped = logger_ring_dropped;
+	logger_ring_dropped = 0;
+
+	/* There is only one producer, so both writes complete */
+	async_ring_try_write(logger_ring, &record, sizeof(record));
+	async_ring_try_write(logger_ring, message, record.size);
+
+	fibril_mutex_unlock(&logger_ring_guard);
+}
 
 /** Send formatted message to the logger service.
  *
@@ -76,19 +177,35 @@ static async_sess_t *logger_session;
  */
 static errno_t logger_message(async_sess_t *session, log_t log, log_level_t level, char *message)
 {
-	async_exch_t *exchange = async_exchange_begin(session);
-	if (exchange == NULL) {
-		return ENOMEM;
-	}
 	if (log == LOG_DEFAULT)
 		log = default_log_id;
 
 	// FIXME: remove when all USB drivers use libc logging explicitly
 	str_rtrim(message, '\n');
 
-	aid_t reg_msg = async_send_2(exchange, LOGGER_WRITER_MESSAGE,
-	    log, level, NULL);
-	errno_t rc = async_data_write_start(exchange, message, str_size(message));
+	if (logger_ring != NULL) {
+		logger_ring_message(log, level, message);
+		return EOK;
+	}
+
+	async_exch_t *exchange = async_exchange_begin(session);
+	if (exchange == NULL) {
+		return ENOMEM;
+	}
+
+	aid_t reg_msg;
+	errno_t rc = EOK;
+	size_t size = str_size(message);
+
+	/* Short messages travel inline with the request. */
+	if (size > 0 && size <= IPC_PAYLOAD_MAX) {
+		reg_msg = async_send_payload(exchange, LOGGER_WRITER_MESSAGE,
+		    log, level, 0, 0, message, size, NULL);
+	} else {
+		reg_msg = async_send_2(exchange, LOGGER_WRITER_MESSAGE,
+		    log, level, NULL);
+		rc = async_data_write_start(exchange, message, size);
+	}
 	errno_t reg_msg_rc;
 	async_wait_for(reg_msg, &reg_msg_rc);
 
@@ -172,6 +289,8 @@ errno_t log_init(const char *prog_name)
 		return ENOMEM;
 	}
 
+	logger_attach_ring();
+
 	default_log_id = log_create(prog_name, LOG_NO_PARENT);
 
 	return EOK;
@@ -239,11 +358,31 @@ void log_msgv(log_t ctx, log_level_t level, const char *fmt, va_list args)
 {
 	assert(level < LVL_LIMIT);
 
-	char *message_buffer = malloc(MESSAGE_BUFFER_SIZE);
+	/*
+	 * Most messages are short, so format into a stack buffer first and
+	 * only fall back to the heap when the message does not fit.
+	 */
+	char stack_buffer[MESSAGE_STACK_BUFFER_SIZE];
+	va_list args2;
+
+	va_copy(args2, args);
+	int len = vsnprintf(stack_buffer, MESSAGE_STACK_BUFFER_SIZE, fmt, args2);
+	va_end(args2);
+
+	if (len < 0)
+		return;
+
+	if ((size_t) len < MESSAGE_STACK_BUFFER_SIZE) {
+		logger_message(logger_session, ctx, level, stack_buffer);
+		return;
+	}
+
+	size_t size = min((size_t) len + 1, MESSAGE_BUFFER_SIZE);
+	char *message_buffer = malloc(size);
 	if (message_buffer == NULL)
 		return;
 
-	vsnprintf(message_buffer, MESSAGE_BUFFER_SIZE, fmt, args);
+	vsnprintf(message_buffer, size, fmt, args);
 	logger_message(logger_session, ctx, level, message_buffer);
 	free(message_buffer);
 }
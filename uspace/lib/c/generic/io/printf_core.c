@@ -38,7 +38,9 @@
 
 #include <stdio.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <mem.h>
 #include <io/printf_core.h>
 #include <ctype.h>
 #include <str.h>
@@ -87,6 +89,9 @@
  */
 #define PRINT_NUMBER_BUFFER_SIZE  (64 + 5)
 
+/** Longest number field print_number() assembles before writing it out */
+#define PRINT_NUMBER_OUT_SIZE  128
+
 /** Get signed or unsigned integer argument */
 #define PRINTF_GET_INT_ARGUMENT(type, ap, flags) \
 	({ \
@@ -157,10 +162,21 @@ static int get_sign_char(bool negative, uint32_t flags)
 /** Prints count times character ch. */
 static int print_padding(char ch, int count, printf_spec_t *ps)
 {
-	for (int i = 0; i < count; ++i) {
-		if (ps->str_write(&ch, 1, ps->data) < 0) {
+	char pad[32];
+	int left = count;
+
+	if (count <= 0)
+		return 0;
+
+	memset(pad, ch, min(count, (int) sizeof(pad)));
+
+	while (left > 0) {
+		int now = min(left, (int) sizeof(pad));
+
+		if (ps->str_write(pad, now, ps->data) < 0)
 			return -1;
-		}
+
+		left -= now;
 	}
 
 	return count;
@@ -420,6 +436,82 @@ static int print_wstr(wchar_t *str, int width, unsigned int precision,
 	return ((int) counter);
 }
 
+/** Pairs of decimal digits for table-driven conversion. */
+static const char digit_pairs[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+/** Convert a number to digits.
+ *
+ * The digits are stored backwards, ending just before @a end.
+ * Decimal numbers are converted two digits at a time and using native
+ * word arithmetic once they fit. Powers of two are converted by shifts.
+ *
+ * @param num    Number to convert.
+ * @param base   Base to convert the number to (between 2 and 16).
+ * @param digits Digit characters to use.
+ * @param end    End of the buffer.
+ *
+ * @return Pointer to the first digit.
+ *
+ */
+static char *number_to_digits(uint64_t num, int base, const char *digits,
+    char *end)
+{
+	char *ptr = end;
+
+	if (base == 10) {
+		while (num > UINT32_MAX) {
+			unsigned int pair = num % 100;
+			num /= 100;
+			ptr -= 2;
+			ptr[0] = digit_pairs[2 * pair];
+			ptr[1] = digit_pairs[2 * pair + 1];
+		}
+
+		uint32_t num32 = (uint32_t) num;
+		while (num32 >= 100) {
+			unsigned int pair = num32 % 100;
+			num32 /= 100;
+			ptr -= 2;
+			ptr[0] = digit_pairs[2 * pair];
+			ptr[1] = digit_pairs[2 * pair + 1];
+		}
+
+		if (num32 >= 10) {
+			ptr -= 2;
+			ptr[0] = digit_pairs[2 * num32];
+			ptr[1] = digit_pairs[2 * num32 + 1];
+		} else {
+			*--ptr = '0' + num32;
+		}
+	} else if ((base & (base - 1)) == 0) {
+		unsigned int shift = 0;
+		while ((1 << shift) < base)
+			shift++;
+
+		do {
+			*--ptr = digits[num & (base - 1)];
+			num >>= shift;
+		} while (num != 0);
+	} else {
+		do {
+			*--ptr = digits[num % base];
+			num /= base;
+		} while (num != 0);
+	}
+
+	return ptr;
+}
+
 /** Print a number in a given base.
  *
  * Print significant digits of a number in given base.
@@ -448,46 +540,42 @@ static int print_number(uint64_t num, int width, int precision, int base,
 		digits = digits_small;
 
 	char data[PRINT_NUMBER_BUFFER_SIZE];
-	char *ptr = &data[PRINT_NUMBER_BUFFER_SIZE - 1];
-
-	/* Size of number with all prefixes and signs */
-	int size = 0;
+	char *end = &data[PRINT_NUMBER_BUFFER_SIZE - 1];
 
 	/* Put zero at end of string */
-	*ptr-- = 0;
+	*end = 0;
 
-	if (num == 0) {
-		*ptr-- = '0';
-		size++;
-	} else {
-		do {
-			*ptr-- = digits[num % base];
-			size++;
-		} while (num /= base);
-	}
+	char *ptr = number_to_digits(num, base, digits, end);
 
 	/* Size of plain number */
-	int number_size = size;
+	int number_size = end - ptr;
+
+	/* Size of number with all prefixes and signs */
+	int size = number_size;
 
 	/*
 	 * Collect the sum of all prefixes/signs/etc. to calculate padding and
 	 * leading zeroes.
 	 */
+	const char *prefix = "";
 	if (flags & __PRINTF_FLAG_PREFIX) {
 		switch (base) {
 		case 2:
 			/* Binary formating is not standard, but usefull */
-			size += 2;
+			prefix = (flags & __PRINTF_FLAG_BIGCHARS) ? "0B" : "0b";
 			break;
 		case 8:
-			size++;
+			prefix = "o";
 			break;
 		case 16:
-			size += 2;
+			prefix = (flags & __PRINTF_FLAG_BIGCHARS) ? "0X" : "0x";
 			break;
 		}
 	}
 
+	int prefix_size = str_size(prefix);
+	size += prefix_size;
+
 	char sgn = 0;
 	if (flags & __PRINTF_FLAG_SIGNED) {
 		if (flags & __PRINTF_FLAG_NEGATIVE) {
@@ -521,74 +609,77 @@ static int print_number(uint64_t num, int width, int precision, int base,
 	}
 
 	width -= precision + size - number_size;
-	size_t counter = 0;
+	if (width < 0)
+		width = 0;
 
-	if (!(flags & __PRINTF_FLAG_LEFTALIGNED)) {
-		while (width-- > 0) {
-			if (printf_putchar(' ', ps) == 1)
-				counter++;
+	int zeros = precision - number_size;
+	int total = width + size - number_size + precision;
+
+	if (total > PRINT_NUMBER_OUT_SIZE) {
+		/* Too long to assemble, print it piece by piece. */
+		size_t counter = 0;
+		int retval;
+
+		if (!(flags & __PRINTF_FLAG_LEFTALIGNED)) {
+			if ((retval = print_padding(' ', width, ps)) < 0)
+				return retval;
+			counter += retval;
 		}
-	}
 
-	/* Print sign */
-	if (sgn) {
-		if (printf_putchar(sgn, ps) == 1)
-			counter++;
-	}
+		if (sgn) {
+			if ((retval = printf_putnchars(&sgn, 1, ps)) < 0)
+				return retval;
+			counter += retval;
+		}
 
-	/* Print prefix */
-	if (flags & __PRINTF_FLAG_PREFIX) {
-		switch (base) {
-		case 2:
-			/* Binary formating is not standard, but usefull */
-			if (printf_putchar('0', ps) == 1)
-				counter++;
-			if (flags & __PRINTF_FLAG_BIGCHARS) {
-				if (printf_putchar('B', ps) == 1)
-					counter++;
-			} else {
-				if (printf_putchar('b', ps) == 1)
-					counter++;
-			}
-			break;
-		case 8:
-			if (printf_putchar('o', ps) == 1)
-				counter++;
-			break;
-		case 16:
-			if (printf_putchar('0', ps) == 1)
-				counter++;
-			if (flags & __PRINTF_FLAG_BIGCHARS) {
-				if (printf_putchar('X', ps) == 1)
-					counter++;
-			} else {
-				if (printf_putchar('x', ps) == 1)
-					counter++;
-			}
-			break;
+		if ((retval = printf_putnchars(prefix, prefix_size, ps)) < 0)
+			return retval;
+		counter += retval;
+
+		if ((retval = print_padding('0', zeros, ps)) < 0)
+			return retval;
+		counter += retval;
+
+		if ((retval = printf_putnchars(ptr, number_size, ps)) < 0)
+			return retval;
+		counter += retval;
+
+		if (flags & __PRINTF_FLAG_LEFTALIGNED) {
+			if ((retval = print_padding(' ', width, ps)) < 0)
+				return retval;
+			counter += retval;
 		}
+
+		return ((int) counter);
 	}
 
-	/* Print leading zeroes */
-	precision -= number_size;
-	while (precision-- > 0) {
-		if (printf_putchar('0', ps) == 1)
-			counter++;
+	/* Assemble the whole field and write it out at once. */
+	char out[PRINT_NUMBER_OUT_SIZE];
+	char *op = out;
+
+	if (!(flags & __PRINTF_FLAG_LEFTALIGNED)) {
+		memset(op, ' ', width);
+		op += width;
 	}
 
-	/* Print the number itself */
-	int retval;
-	if ((retval = printf_putstr(++ptr, ps)) > 0)
-		counter += retval;
+	if (sgn)
+		*op++ = sgn;
 
-	/* Print trailing spaces */
+	memcpy(op, prefix, prefix_size);
+	op += prefix_size;
 
-	while (width-- > 0) {
-		if (printf_putchar(' ', ps) == 1)
-			counter++;
+	memset(op, '0', zeros);
+	op += zeros;
+
+	memcpy(op, ptr, number_size);
+	op += number_size;
+
+	if (flags & __PRINTF_FLAG_LEFTALIGNED) {
+		memset(op, ' ', width);
+		op += width;
 	}
 
-	return ((int) counter);
+	return printf_putnchars(out, op - out, ps);
 }
 
 /** Prints a special double (ie NaN, infinity) padded to width characters. */
@@ -1342,6 +1433,14 @@ int printf_core(const char *fmt, printf_spec_t *ps, va_list ap)
 	int retval;           /* Return values from nested functions */
 
 	while (true) {
+		/*
+		 * Skip ordinary characters, they are printed in one go.
+		 * Neither '%' nor the terminator can be part of a multibyte
+		 * character, so the bytes need not be decoded.
+		 */
+		while (fmt[nxt] != 0 && fmt[nxt] != '%')
+			nxt++;
+
 		i = nxt;
 		wchar_t uc = str_decode(fmt, &nxt, STR_NO_LIMIT);
 
@@ -115,6 +115,57 @@ errno_t win_resize(async_sess_t *sess, sysarg_t x, sysarg_t y, sysarg_t width,
 	return EOK;
 }
 
+/** Resize a double-buffered window.
+ *
+ * Both buffers are shared with the compositor, which initially shows
+ * @a front. The window then flips between them with win_present().
+ */
+errno_t win_resize_buffered(async_sess_t *sess, sysarg_t x, sysarg_t y,
+    sysarg_t width, sysarg_t height, window_placement_flags_t placement_flags,
+    void *front, void *back)
+{
+	async_exch_t *exch = async_exchange_begin(sess);
+
+	ipc_call_t answer;
+	aid_t req = async_send_5(exch, WINDOW_RESIZE, x, y, width, height,
+	    (sysarg_t) placement_flags, &answer);
+
+	errno_t rc = async_share_out_start(exch, front, AS_AREA_READ | AS_AREA_CACHEABLE);
+	if (rc == EOK)
+		rc = async_share_out_start(exch, back, AS_AREA_READ | AS_AREA_CACHEABLE);
+
+	async_exchange_end(exch);
+
+	errno_t ret;
+	async_wait_for(req, &ret);
+
+	if (rc != EOK)
+		return rc;
+	else if (ret != EOK)
+		return ret;
+
+	return EOK;
+}
+
+/** Make one of the buffers of a double-buffered window visible.
+ *
+ * @param buffer Index of the buffer in the order it was shared by
+ *               win_resize_buffered().
+ *
+ * Once this returns, the compositor no longer reads the previously
+ * presented buffer and the window may paint into it again.
+ */
+errno_t win_present(async_sess_t *sess, sysarg_t buffer,
+    sysarg_t x, sysarg_t y, sysarg_t width, sysarg_t height)
+{
+	async_exch_t *exch = async_exchange_begin(sess);
+	errno_t ret = async_req_5_0(exch, WINDOW_PRESENT, buffer, x, y,
+	    width, height);
+	async_exchange_end(exch);
+
+	return ret;
+}
+
 errno_t win_close(async_sess_t *sess)
 {
 	async_exch_t *exch = async_exchange_begin(sess);
@@ -183,6 +183,145 @@ void ipc_call_async_slow(cap_phone_handle_t phandle, sysarg_t imethod,
 	ipc_finish_async(rc, call);
 }
 
+/** Asynchronous call with an inline payload.
+ *
+ * Like ipc_call_async_slow(), but the call also carries up to
+ * IPC_PAYLOAD_MAX bytes of data which the callee gets by ipc_payload_get().
+ *
+ * Note that this function is a void function.
+ *
+ * @param phandle   Phone handle for the call.
+ * @param imethod   Requested interface and method.
+ * @param arg1      Service-defined payload argument.
+ * @param arg2      Service-defined payload argument.
+ * @param arg3      Service-defined payload argument.
+ * @param arg4      Service-defined payload argument.
+ * @param arg5      Service-defined payload argument.
+ * @param payload   Inline payload.
+ * @param size      Size of the inline payload.
+ * @param private   Argument to be passed to the answer/error callback.
+ * @param callback  Answer or error callback.
+ */
+void ipc_call_async_payload(cap_phone_handle_t phandle, sysarg_t imethod,
+    sysarg_t arg1, sysarg_t arg2, sysarg_t arg3, sysarg_t arg4, sysarg_t arg5,
+    const void *payload, size_t size, void *private,
+    ipc_async_callback_t callback)
+{
+	async_call_t *call = ipc_prepare_async(private, callback);
+	if (!call)
+		return;
+
+	IPC_SET_IMETHOD(call->msg.data, imethod);
+	IPC_SET_ARG1(call->msg.data, arg1);
+	IPC_SET_ARG2(call->msg.data, arg2);
+	IPC_SET_ARG3(call->msg.data, arg3);
+	IPC_SET_ARG4(call->msg.data, arg4);
+	IPC_SET_ARG5(call->msg.data, arg5);
+
+	errno_t rc = (errno_t) __SYSCALL5(SYS_IPC_CALL_ASYNC_PAYLOAD,
+	    CAP_HANDLE_RAW(phandle), (sysarg_t) &call->msg.data,
+	    (sysarg_t) payload, size, (sysarg_t) call);
+
+	ipc_finish_async(rc, call);
+}
+
+/** Get the inline payload of a received call.
+ *
+ * @param chandle  Handle of the received call.
+ * @param buf      Buffer for the payload.
+ * @param size     Size of the buffer.
+ *
+ * @return Zero on success or an error code.
+ */
+errno_t ipc_payload_get(cap_call_handle_t chandle, void *buf, size_t size)
+{
+	return (errno_t) __SYSCALL3(SYS_IPC_PAYLOAD_GET,
+	    CAP_HANDLE_RAW(chandle), (sysarg_t) buf, size);
+}
+
+/** Initialize a batch of asynchronous calls.
+ *
+ * @param batch  Batch to initialize.
+ */
+void ipc_batch_init(ipc_batch_t *batch)
+{
+	batch->count = 0;
+}
+
+/** Add an asynchronous call to a batch.
+ *
+ * The call is made by the next ipc_batch_submit(). If the batch is
+ * already full, it is submitted first.
+ *
+ * During normal operation, answering this call will trigger the callback.
+ * In case of fatal error, the callback handler is called with the proper
+ * error code.
+ *
+ * @param batch     Batch to add the call to.
+ * @param phandle   Phone handle for the call.
+ * @param imethod   Requested interface and method.
+ * @param arg1      Service-defined payload argument.
+ * @param arg2      Service-defined payload argument.
+ * @param arg3      Service-defined payload argument.
+ * @param arg4      Service-defined payload argument.
+ * @param arg5      Service-defined payload argument.
+ * @param private   Argument to be passed to the answer/error callback.
+ * @param callback  Answer or error callback.
+ */
+void ipc_batch_call_async(ipc_batch_t *batch, cap_phone_handle_t phandle,
+    sysarg_t imethod, sysarg_t arg1, sysarg_t arg2, sysarg_t arg3,
+    sysarg_t arg4, sysarg_t arg5, void *private, ipc_async_callback_t callback)
+{
+	async_call_t *call = ipc_prepare_async(private, callback);
+	if (!call)
+		return;
+
+	if (batch->count == IPC_BATCH_MAX)
+		ipc_batch_submit(batch);
+
+	ipc_batch_call_t *bcall = &batch->calls[batch->count++];
+
+	bcall->phone = phandle;
+	bcall->args[0] = imethod;
+	bcall->args[1] = arg1;
+	bcall->args[2] = arg2;
+	bcall->args[3] = arg3;
+	bcall->args[4] = arg4;
+	bcall->args[5] = arg5;
+	bcall->label = (sysarg_t) call;
+}
+
+/** Make all asynchronous calls of a batch.
+ *
+ * The calls are made using as few syscalls as possible. The callbacks of
+ * the calls which could not be made are called with the error code. The
+ * batch is empty afterwards.
+ *
+ * @param batch  Batch to submit.
+ */
+void ipc_batch_submit(ipc_batch_t *batch)
+{
+	size_t done = 0;
+
+	while (done < batch->count) {
+		size_t posted = 0;
+		errno_t rc = (errno_t) __SYSCALL3(SYS_IPC_CALL_ASYNC_BATCH,
+		    (sysarg_t) &batch->calls[done], batch->count - done,
+		    (sysarg_t) &posted);
+
+		done += posted;
+
+		if ((rc != EOK) && (done < batch->count)) {
+			/* Fail the offending call and go on with the rest */
+			ipc_finish_async(rc,
+			    (async_call_t *) batch->calls[done].label);
+			done++;
+		}
+	}
+
+	batch->count = 0;
+}
+
 /** Answer received call (fast version).
  *
  * The fast answer makes use of passing retval and first four arguments in
@@ -274,6 +413,41 @@ errno_t ipc_wait_cycle(ipc_call_t *call, sysarg_t usec, unsigned int flags)
 	return rc;
 }
 
+/** Wait for a batch of IPC calls to come.
+ *
+ * Waits for the first call like ipc_wait_cycle() and then picks up all
+ * calls which are already pending, up to @a count.
+ *
+ * @param[out] calls     Storage for the received calls.
+ * @param[in]  count     Number of calls the storage can hold
+ *                       (at most IPC_BATCH_MAX).
+ * @param[in]  usec      Timeout in microseconds for the first call.
+ * @param[in]  flags     Flags passed to SYS_IPC_WAIT_BATCH (blocking,
+ *                       nonblocking).
+ * @param[out] received  Number of received calls.
+ *
+ * @return  Error code.
+ */
+errno_t ipc_wait_batch(ipc_call_t *calls, size_t count, sysarg_t usec,
+    unsigned int flags, size_t *received)
+{
+	*received = 0;
+
+	errno_t rc = (errno_t) __SYSCALL5(SYS_IPC_WAIT_BATCH, (sysarg_t) calls,
+	    count, usec, flags, (sysarg_t) received);
+	if (rc != EOK)
+		return rc;
+
+	/* Handle received answers */
+	for (size_t i = 0; i < *received; i++) {
+		if ((calls[i].cap_handle == CAP_NIL) &&
+		    (calls[i].flags & IPC_CALL_ANSWERED))
+			handle_answer(&calls[i]);
+	}
+
+	return EOK;
+}
+
 /** Interrupt one thread of this task from waiting for IPC.
  *
  */
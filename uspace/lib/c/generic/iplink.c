@@ -34,14 +34,17 @@
  * @brief IP link client stub
  */
 
+#include <align.h>
 #include <async.h>
 #include <assert.h>
 #include <errno.h>
 #include <inet/iplink.h>
+#include <inet/iplink_srv.h>
 #include <inet/addr.h>
 #include <ipc/iplink.h>
 #include <ipc/services.h>
 #include <loc.h>
+#include <mem.h>
 #include <stdlib.h>
 
 static void iplink_cb_conn(cap_call_handle_t icall_handle, ipc_call_t *icall, void *arg);
@@ -78,19 +81,83 @@ error:
 	return rc;
 }
 
+/** Open IP link provided by a server in the same task.
+ *
+ * Requests and events are passed by direct function calls instead
+ * of IPC.
+ *
+ * @param srv     IP link server (see iplink_srv_local_find())
+ * @param ev_ops  Event operations
+ * @param arg     Argument to event operations
+ * @param riplink Place to store pointer to new IP link
+ *
+ * @return EOK on success, EBUSY if the link is already open or other
+ *         error code
+ */
+errno_t iplink_open_local(iplink_srv_t *srv, iplink_ev_ops_t *ev_ops,
+    void *arg, iplink_t **riplink)
+{
+	errno_t rc;
+
+	iplink_t *iplink = calloc(1, sizeof(iplink_t));
+	if (iplink == NULL)
+		return ENOMEM;
+
+	iplink->ev_ops = ev_ops;
+	iplink->arg = arg;
+	iplink->local_srv = srv;
+
+	fibril_mutex_lock(&srv->lock);
+	if (srv->connected) {
+		fibril_mutex_unlock(&srv->lock);
+		free(iplink);
+		return EBUSY;
+	}
+
+	srv->connected = true;
+	srv->local = iplink;
+	fibril_mutex_unlock(&srv->lock);
+
+	rc = srv->ops->open(srv);
+	if (rc != EOK) {
+		fibril_mutex_lock(&srv->lock);
+		srv->connected = false;
+		srv->local = NULL;
+		fibril_mutex_unlock(&srv->lock);
+		free(iplink);
+		return rc;
+	}
+
+	*riplink = iplink;
+	return EOK;
+}
+
 void iplink_close(iplink_t *iplink)
 {
+	iplink_srv_t *srv = iplink->local_srv;
+
+	if (srv != NULL) {
+		fibril_mutex_lock(&srv->lock);
+		srv->connected = false;
+		srv->local = NULL;
+		fibril_mutex_unlock(&srv->lock);
+		(void) srv->ops->close(srv);
+	}
+
 	/* XXX Synchronize with iplink_cb_conn */
 	free(iplink);
 }
 
 errno_t iplink_send(iplink_t *iplink, iplink_sdu_t *sdu)
 {
+	if (iplink->local_srv != NULL)
+		return iplink->local_srv->ops->send(iplink->local_srv, sdu);
+
 	async_exch_t *exch = async_exchange_begin(iplink->sess);
 
 	ipc_call_t answer;
-	aid_t req = async_send_2(exch, IPLINK_SEND, (sysarg_t) sdu->src,
-	    (sysarg_t) sdu->dest, &answer);
+	aid_t req = async_send_3(exch, IPLINK_SEND, (sysarg_t) sdu->src,
+	    (sysarg_t) sdu->dest, (sysarg_t) sdu->flags, &answer);
 
 	errno_t rc = async_data_write_start(exch, sdu->data, sdu->size);
 
@@ -109,6 +176,9 @@ errno_t iplink_send(iplink_t *iplink, iplink_sdu_t *sdu)
 
 errno_t iplink_send6(iplink_t *iplink, iplink_sdu6_t *sdu)
 {
+	if (iplink->local_srv != NULL)
+		return iplink->local_srv->ops->send6(iplink->local_srv, sdu);
+
 	async_exch_t *exch = async_exchange_begin(iplink->sess);
 
 	ipc_call_t answer;
@@ -138,6 +208,9 @@ errno_t iplink_send6(iplink_t *iplink, iplink_sdu6_t *sdu)
 
 errno_t iplink_get_mtu(iplink_t *iplink, size_t *rmtu)
 {
+	if (iplink->local_srv != NULL)
+		return iplink->local_srv->ops->get_mtu(iplink->local_srv, rmtu);
+
 	async_exch_t *exch = async_exchange_begin(iplink->sess);
 
 	sysarg_t mtu;
@@ -152,8 +225,43 @@ errno_t iplink_get_mtu(iplink_t *iplink, size_t *rmtu)
 	return EOK;
 }
 
+/** Get offload options supported by IP link.
+ *
+ * @param iplink   IP link
+ * @param roffload Place to store offload options (IPLINK_OFFLOAD_xxx)
+ * @return EOK on success or an error code
+ */
+errno_t iplink_get_offload(iplink_t *iplink, uint32_t *roffload)
+{
+	if (iplink->local_srv != NULL) {
+		if (iplink->local_srv->ops->get_offload == NULL) {
+			*roffload = 0;
+			return EOK;
+		}
+
+		return iplink->local_srv->ops->get_offload(iplink->local_srv,
+		    roffload);
+	}
+
+	async_exch_t *exch = async_exchange_begin(iplink->sess);
+
+	sysarg_t offload;
+	errno_t rc = async_req_0_1(exch, IPLINK_GET_OFFLOAD, &offload);
+
+	async_exchange_end(exch);
+
+	if (rc != EOK)
+		return rc;
+
+	*roffload = offload;
+	return EOK;
+}
+
 errno_t iplink_get_mac48(iplink_t *iplink, addr48_t *mac)
 {
+	if (iplink->local_srv != NULL)
+		return iplink->local_srv->ops->get_mac48(iplink->local_srv, mac);
+
 	async_exch_t *exch = async_exchange_begin(iplink->sess);
 
 	ipc_call_t answer;
@@ -176,6 +284,11 @@ errno_t iplink_get_mac48(iplink_t *iplink, addr48_t *mac)
 
 errno_t iplink_set_mac48(iplink_t *iplink, addr48_t mac)
 {
+	if (iplink->local_srv != NULL) {
+		return iplink->local_srv->ops->set_mac48(iplink->local_srv,
+		    (addr48_t *) mac);
+	}
+
 	async_exch_t *exch = async_exchange_begin(iplink->sess);
 
 	ipc_call_t answer;
@@ -199,6 +312,9 @@ errno_t iplink_set_mac48(iplink_t *iplink, addr48_t mac)
 
 errno_t iplink_addr_add(iplink_t *iplink, inet_addr_t *addr)
 {
+	if (iplink->local_srv != NULL)
+		return iplink->local_srv->ops->addr_add(iplink->local_srv, addr);
+
 	async_exch_t *exch = async_exchange_begin(iplink->sess);
 
 	ipc_call_t answer;
@@ -220,6 +336,11 @@ errno_t iplink_addr_add(iplink_t *iplink, inet_addr_t *addr)
 
 errno_t iplink_addr_remove(iplink_t *iplink, inet_addr_t *addr)
 {
+	if (iplink->local_srv != NULL) {
+		return iplink->local_srv->ops->addr_remove(iplink->local_srv,
+		    addr);
+	}
+
 	async_exch_t *exch = async_exchange_begin(iplink->sess);
 
 	ipc_call_t answer;
@@ -244,7 +365,7 @@ void *iplink_get_userptr(iplink_t *iplink)
 	return iplink->arg;
 }
 
-static void iplink_ev_recv(iplink_t *iplink, cap_call_handle_t icall_handle,
+static void iplink_cb_recv(iplink_t *iplink, cap_call_handle_t icall_handle,
     ipc_call_t *icall)
 {
 	iplink_recv_sdu_t sdu;
@@ -263,7 +384,46 @@ static void iplink_ev_recv(iplink_t *iplink, cap_call_handle_t icall_handle,
 	async_answer_0(icall_handle, rc);
 }
 
-static void iplink_ev_change_addr(iplink_t *iplink, cap_call_handle_t icall_handle,
+static void iplink_cb_recv_batch(iplink_t *iplink,
+    cap_call_handle_t icall_handle, ipc_call_t *icall)
+{
+	iplink_batch_sdu_hdr_t hdr;
+	iplink_recv_sdu_t sdu;
+	void *data;
+	size_t size;
+	size_t off;
+	errno_t retval;
+
+	errno_t rc = async_data_write_accept(&data, false, 0, 0, 0, &size);
+	if (rc != EOK) {
+		async_answer_0(icall_handle, rc);
+		return;
+	}
+
+	retval = EOK;
+	off = 0;
+	while (off + sizeof(hdr) <= size) {
+		memcpy(&hdr, data + off, sizeof(hdr));
+		if (hdr.size > size - off - sizeof(hdr)) {
+			retval = EINVAL;
+			break;
+		}
+
+		sdu.data = data + off + sizeof(hdr);
+		sdu.size = hdr.size;
+
+		rc = iplink->ev_ops->recv(iplink, &sdu, hdr.ver);
+		if (rc != EOK)
+			retval = rc;
+
+		off += ALIGN_UP(sizeof(hdr) + hdr.size, IPLINK_BATCH_ALIGN);
+	}
+
+	free(data);
+	async_answer_0(icall_handle, retval);
+}
+
+static void iplink_cb_change_addr(iplink_t *iplink, cap_call_handle_t icall_handle,
     ipc_call_t *icall)
 {
 	addr48_t *addr;
@@ -296,10 +456,13 @@ static void iplink_cb_conn(cap_call_handle_t icall_handle, ipc_call_t *icall, vo
 
 		switch (IPC_GET_IMETHOD(call)) {
 		case IPLINK_EV_RECV:
-			iplink_ev_recv(iplink, chandle, &call);
+			iplink_cb_recv(iplink, chandle, &call);
 			break;
 		case IPLINK_EV_CHANGE_ADDR:
-			iplink_ev_change_addr(iplink, chandle, &call);
+			iplink_cb_change_addr(iplink, chandle, &call);
+			break;
+		case IPLINK_EV_RECV_BATCH:
+			iplink_cb_recv_batch(iplink, chandle, &call);
 			break;
 		default:
 			async_answer_0(chandle, ENOTSUP);
@@ -34,13 +34,19 @@
  * @brief IP link server stub
  */
 
+#include <align.h>
 #include <errno.h>
 #include <ipc/iplink.h>
+#include <mem.h>
 #include <stdlib.h>
 #include <stddef.h>
 #include <inet/addr.h>
 #include <inet/iplink_srv.h>
 
+/** IP link servers that can be used directly from this task */
+static LIST_INITIALIZE(iplink_srv_local_list);
+static FIBRIL_MUTEX_INITIALIZE(iplink_srv_local_lock);
+
 static void iplink_get_mtu_srv(iplink_srv_t *srv, cap_call_handle_t chandle,
     ipc_call_t *call)
 {
@@ -49,6 +55,17 @@ static void iplink_get_mtu_srv(iplink_srv_t *srv, cap_call_handle_t chandle,
 	async_answer_1(chandle, rc, mtu);
 }
 
+static void iplink_get_offload_srv(iplink_srv_t *srv, cap_call_handle_t chandle,
+    ipc_call_t *call)
+{
+	uint32_t offload = 0;
+	errno_t rc = EOK;
+
+	if (srv->ops->get_offload != NULL)
+		rc = srv->ops->get_offload(srv, &offload);
+	async_answer_1(chandle, rc, offload);
+}
+
 static void iplink_get_mac48_srv(iplink_srv_t *srv, cap_call_handle_t icall_handle,
     ipc_call_t *icall)
 {
@@ -169,6 +186,7 @@ static void iplink_send_srv(iplink_srv_t *srv, cap_call_handle_t icall_handle,
 
 	sdu.src = IPC_GET_ARG1(*icall);
 	sdu.dest = IPC_GET_ARG2(*icall);
+	sdu.flags = IPC_GET_ARG3(*icall);
 
 	errno_t rc = async_data_write_accept(&sdu.data, false, 0, 0, 0,
 	    &sdu.size);
@@ -226,6 +244,45 @@ void iplink_srv_init(iplink_srv_t *srv)
 	srv->ops = NULL;
 	srv->arg = NULL;
 	srv->client_sess = NULL;
+	srv->local = NULL;
+	link_initialize(&srv->llocal);
+}
+
+/** Make IP link server available to clients in the same task.
+ *
+ * A client in the same task can then open the link with
+ * iplink_open_local(), bypassing IPC on both the send and the receive
+ * path.
+ *
+ * @param srv IP link server
+ * @param sid Service ID of the IP link
+ */
+void iplink_srv_local_register(iplink_srv_t *srv, service_id_t sid)
+{
+	fibril_mutex_lock(&iplink_srv_local_lock);
+	srv->local_sid = sid;
+	list_append(&srv->llocal, &iplink_srv_local_list);
+	fibril_mutex_unlock(&iplink_srv_local_lock);
+}
+
+/** Find IP link server in the same task.
+ *
+ * @param sid Service ID of the IP link
+ * @return IP link server or @c NULL if the link is not provided by
+ *         this task
+ */
+iplink_srv_t *iplink_srv_local_find(service_id_t sid)
+{
+	fibril_mutex_lock(&iplink_srv_local_lock);
+	list_foreach(iplink_srv_local_list, llocal, iplink_srv_t, srv) {
+		if (srv->local_sid == sid) {
+			fibril_mutex_unlock(&iplink_srv_local_lock);
+			return srv;
+		}
+	}
+
+	fibril_mutex_unlock(&iplink_srv_local_lock);
+	return NULL;
 }
 
 errno_t iplink_conn(cap_call_handle_t icall_handle, ipc_call_t *icall, void *arg)
@@ -274,6 +331,9 @@ errno_t iplink_conn(cap_call_handle_t icall_handle, ipc_call_t *icall, void *arg
 		case IPLINK_GET_MTU:
 			iplink_get_mtu_srv(srv, chandle, &call);
 			break;
+		case IPLINK_GET_OFFLOAD:
+			iplink_get_offload_srv(srv, chandle, &call);
+			break;
 		case IPLINK_GET_MAC48:
 			iplink_get_mac48_srv(srv, chandle, &call);
 			break;
@@ -303,6 +363,9 @@ errno_t iplink_conn(cap_call_handle_t icall_handle, ipc_call_t *icall, void *arg
 /* XXX Version should be part of @a sdu */
 errno_t iplink_ev_recv(iplink_srv_t *srv, iplink_recv_sdu_t *sdu, ip_ver_t ver)
 {
+	if (srv->local != NULL)
+		return srv->local->ev_ops->recv(srv->local, sdu, ver);
+
 	if (srv->client_sess == NULL)
 		return EIO;
 
@@ -328,8 +391,121 @@ errno_t iplink_ev_recv(iplink_srv_t *srv, iplink_recv_sdu_t *sdu, ip_ver_t ver)
 	return EOK;
 }
 
+/** Initialize batch of received SDUs.
+ *
+ * @param batch Batch
+ * @param buf   Buffer to hold batch data
+ * @param bsize Size of @a buf in bytes
+ */
+void iplink_recv_batch_init(iplink_recv_batch_t *batch, void *buf,
+    size_t bsize)
+{
+	batch->buf = buf;
+	batch->bsize = bsize;
+	batch->size = 0;
+	batch->count = 0;
+}
+
+/** Add received SDU to batch.
+ *
+ * @param batch Batch
+ * @param sdu   Received SDU
+ * @param ver   IP version
+ *
+ * @return EOK on success, ENOMEM if the SDU does not fit into the batch
+ */
+errno_t iplink_recv_batch_add(iplink_recv_batch_t *batch,
+    iplink_recv_sdu_t *sdu, ip_ver_t ver)
+{
+	iplink_batch_sdu_hdr_t hdr;
+	size_t rsize;
+
+	rsize = ALIGN_UP(sizeof(hdr) + sdu->size, IPLINK_BATCH_ALIGN);
+	if (rsize > batch->bsize - batch->size)
+		return ENOMEM;
+
+	hdr.size = sdu->size;
+	hdr.ver = ver;
+
+	memcpy(batch->buf + batch->size, &hdr, sizeof(hdr));
+	memcpy(batch->buf + batch->size + sizeof(hdr), sdu->data, sdu->size);
+	memset(batch->buf + batch->size + sizeof(hdr) + sdu->size, 0,
+	    rsize - sizeof(hdr) - sdu->size);
+
+	batch->size += rsize;
+	++batch->count;
+	return EOK;
+}
+
+/** Deliver batch of received SDUs to client.
+ *
+ * The batch is emptied afterwards.
+ *
+ * @param srv   IP link server
+ * @param batch Batch
+ *
+ * @return EOK on success or an error code
+ */
+errno_t iplink_ev_recv_batch(iplink_srv_t *srv, iplink_recv_batch_t *batch)
+{
+	iplink_batch_sdu_hdr_t hdr;
+	iplink_recv_sdu_t sdu;
+	size_t size;
+	size_t off;
+	errno_t rc;
+
+	if (srv->local == NULL && srv->client_sess == NULL)
+		return EIO;
+
+	if (batch->count == 0)
+		return EOK;
+
+	size = batch->size;
+	batch->size = 0;
+	batch->count = 0;
+
+	if (srv->local != NULL) {
+		/* Client in the same task, deliver SDUs directly */
+		rc = EOK;
+		off = 0;
+		while (off < size) {
+			memcpy(&hdr, batch->buf + off, sizeof(hdr));
+			sdu.data = batch->buf + off + sizeof(hdr);
+			sdu.size = hdr.size;
+
+			if (iplink_ev_recv(srv, &sdu, hdr.ver) != EOK)
+				rc = EIO;
+
+			off += ALIGN_UP(sizeof(hdr) + hdr.size,
+			    IPLINK_BATCH_ALIGN);
+		}
+
+		return rc;
+	}
+
+	async_exch_t *exch = async_exchange_begin(srv->client_sess);
+
+	ipc_call_t answer;
+	aid_t req = async_send_0(exch, IPLINK_EV_RECV_BATCH, &answer);
+
+	rc = async_data_write_start(exch, batch->buf, size);
+	async_exchange_end(exch);
+
+	if (rc != EOK) {
+		async_forget(req);
+		return rc;
+	}
+
+	errno_t retval;
+	async_wait_for(req, &retval);
+	return retval;
+}
+
 errno_t iplink_ev_change_addr(iplink_srv_t *srv, addr48_t *addr)
 {
+	if (srv->local != NULL)
+		return srv->local->ev_ops->change_addr(srv->local, *addr);
+
 	if (srv->client_sess == NULL)
 		return EIO;
 
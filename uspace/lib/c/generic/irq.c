@@ -85,5 +85,37 @@ errno_t ipc_irq_unsubscribe(cap_irq_handle_t cap)
 	    CAP_HANDLE_RAW(cap));
 }
 
+/** Coalesce IRQ notifications.
+ *
+ * Interrupts arriving while a notification is still queued are merged into
+ * it. A non-zero holdoff also caps the notification rate.
+ *
+ * @param cap      IRQ capability handle.
+ * @param holdoff  Minimum interval between two notifications, 0 for no
+ *                 rate cap.
+ *
+ * @return Value returned by the kernel.
+ *
+ */
+errno_t ipc_irq_coalesce(cap_irq_handle_t cap, useconds_t holdoff)
+{
+	return (errno_t) __SYSCALL2(SYS_IPC_IRQ_COALESCE,
+	    CAP_HANDLE_RAW(cap), (sysarg_t) holdoff);
+}
+
+/** Deliver the interrupt of an IRQ capability to a single CPU.
+ *
+ * @param cap  IRQ capability handle.
+ * @param cpu  ID of the target CPU.
+ *
+ * @return Value returned by the kernel.
+ *
+ */
+errno_t ipc_irq_set_affinity(cap_irq_handle_t cap, unsigned int cpu)
+{
+	return (errno_t) __SYSCALL2(SYS_IPC_IRQ_SET_AFFINITY,
+	    CAP_HANDLE_RAW(cap), (sysarg_t) cpu);
+}
+
 /** @}
  */
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup libc
+ * @{
+ */
+/** @file
+ */
+
+#include <libc.h>
+#include <ktrace.h>
+
+/** Start recording kernel trace events.
+ *
+ * @param mask Mask of ktrace_event_t events to record.
+ *
+ * @return EOK on success, EPERM if the task lacks the memory manager
+ *         permission, ENOTSUP if kernel tracing is not available.
+ */
+errno_t ktrace_enable(uint32_t mask)
+{
+	return (errno_t) __SYSCALL2(SYS_KTRACE, KTRACE_ENABLE, mask);
+}
+
+/** Stop recording kernel trace events.
+ *
+ * @return EOK on success or an error code.
+ */
+errno_t ktrace_disable(void)
+{
+	return (errno_t) __SYSCALL2(SYS_KTRACE, KTRACE_DISABLE, 0);
+}
+
+/** Start sampling the interrupted code on all processors.
+ *
+ * The samples are recorded as KTRACE_SAMPLE events.
+ *
+ * @param period Number of CPU cycles between two samples.
+ *
+ * @return EOK on success, ENOTSUP if the platform has no usable
+ *         performance counters, EINVAL if the period is too short.
+ */
+errno_t ktrace_sample_start(uint32_t period)
+{
+	return (errno_t) __SYSCALL2(SYS_KTRACE, KTRACE_SAMPLE_START, period);
+}
+
+/** Stop sampling.
+ *
+ * @return EOK on success or an error code.
+ */
+errno_t ktrace_sample_stop(void)
+{
+	return (errno_t) __SYSCALL2(SYS_KTRACE, KTRACE_SAMPLE_STOP, 0);
+}
+
+/** Look up the name of a kernel function.
+ *
+ * @param addr Kernel address.
+ * @param buf  Buffer for the name, truncated to fit.
+ * @param size Size of the buffer.
+ *
+ * @return EOK on success, ENOENT if no function contains the address,
+ *         ENOTSUP if the kernel has no symbol table.
+ */
+errno_t ktrace_symbol(uintptr_t addr, char *buf, size_t size)
+{
+	return (errno_t) __SYSCALL4(SYS_KTRACE, KTRACE_SYMBOL, addr,
+	    (sysarg_t) buf, size);
+}
+
+/** @}
+ */
@@ -53,6 +53,7 @@
 #include "private/libc.h"
 #include "private/async.h"
 #include "private/malloc.h"
+#include "private/mem.h"
 #include "private/io.h"
 #include "private/fibril.h"
 
@@ -66,6 +67,7 @@ static bool env_setup = false;
 void __libc_main(void *pcb_ptr)
 {
 	/* Initialize user task run-time environment */
+	__mem_init();
 	__malloc_init();
 
 	/* Save the PCB pointer */
@@ -85,6 +87,7 @@ void __libc_main(void *pcb_ptr)
 		abort();
 
 	__tcb_set(fibril->tcb);
+	fibril_runner_enter(fibril);
 
 	__async_server_init();
 	__async_client_init();
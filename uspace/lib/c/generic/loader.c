@@ -43,6 +43,7 @@
 #include <errno.h>
 #include <vfs/vfs.h>
 #include <loader/loader.h>
+#include <macros.h>
 #include "private/loader.h"
 
 /** Connect to a new program loader.
@@ -299,6 +300,123 @@ errno_t loader_add_inbox(loader_t *ldr, const char *name, int file)
 	return (errno_t) rc;
 }
 
+/** Set up and load the program in a single request.
+ *
+ * This is equivalent to setting the current working directory, the
+ * program, the arguments and the inbox entries and then loading the
+ * program, but takes only one round trip to the loader.
+ *
+ * @param ldr         Loader connection structure.
+ * @param path        Program path.
+ * @param argv        NULL-terminated array of pointers to arguments.
+ * @param inbox_names Identifications of the inbox files.
+ * @param inbox_files The inbox files' descriptors.
+ * @param inbox_cnt   Number of inbox files.
+ * @param task_id     Place to store the ID of the new task.
+ *
+ * @return Zero on success or an error code.
+ *
+ */
+errno_t loader_prepare(loader_t *ldr, const char *path,
+    const char *const argv[], const char *const inbox_names[],
+    const int inbox_files[], size_t inbox_cnt, task_id_t *task_id)
+{
+	const char *name = str_rchr(path, '/');
+	if (name == NULL) {
+		name = path;
+	} else {
+		name++;
+	}
+
+	char *cwd = (char *) malloc(MAX_PATH_LEN + 1);
+	if (!cwd)
+		return ENOMEM;
+
+	if (vfs_cwd_get(cwd, MAX_PATH_LEN + 1) != EOK)
+		str_cpy(cwd, MAX_PATH_LEN + 1, "/");
+
+	/*
+	 * Serialize the strings into a single buffer. First
+	 * compute size of the buffer needed.
+	 */
+	size_t buffer_size = str_size(cwd) + 1 + str_size(name) + 1;
+	size_t argc = 0;
+	size_t i;
+
+	while (argv[argc] != NULL) {
+		buffer_size += str_size(argv[argc]) + 1;
+		argc++;
+	}
+
+	for (i = 0; i < inbox_cnt; i++)
+		buffer_size += str_size(inbox_names[i]) + 1;
+
+	char *buf = malloc(buffer_size);
+	if (buf == NULL) {
+		free(cwd);
+		return ENOMEM;
+	}
+
+	/* Now fill the buffer with null-terminated strings */
+	char *dp = buf;
+
+	str_cpy(dp, buffer_size - (dp - buf), cwd);
+	dp += str_size(cwd) + 1;
+	str_cpy(dp, buffer_size - (dp - buf), name);
+	dp += str_size(name) + 1;
+
+	for (i = 0; i < argc; i++) {
+		str_cpy(dp, buffer_size - (dp - buf), argv[i]);
+		dp += str_size(argv[i]) + 1;
+	}
+
+	for (i = 0; i < inbox_cnt; i++) {
+		str_cpy(dp, buffer_size - (dp - buf), inbox_names[i]);
+		dp += str_size(inbox_names[i]) + 1;
+	}
+
+	free(cwd);
+
+	int fd;
+	errno_t rc = vfs_lookup(path, 0, &fd);
+	if (rc != EOK) {
+		free(buf);
+		return rc;
+	}
+
+	async_exch_t *exch = async_exchange_begin(ldr->sess);
+	async_exch_t *vfs_exch = vfs_exchange_begin();
+
+	ipc_call_t answer;
+	aid_t req = async_send_2(exch, LOADER_PREPARE, argc, inbox_cnt,
+	    &answer);
+
+	rc = async_data_write_start(exch, buf, buffer_size);
+	if (rc == EOK)
+		rc = vfs_pass_handle(vfs_exch, fd, exch);
+
+	for (i = 0; rc == EOK && i < inbox_cnt; i++)
+		rc = vfs_pass_handle(vfs_exch, inbox_files[i], exch);
+
+	vfs_exchange_end(vfs_exch);
+	async_exchange_end(exch);
+	free(buf);
+	vfs_put(fd);
+
+	if (rc != EOK) {
+		async_forget(req);
+		return (errno_t) rc;
+	}
+
+	async_wait_for(req, &rc);
+	if (rc != EOK)
+		return (errno_t) rc;
+
+	*task_id = (task_id_t) MERGE_LOUP32(IPC_GET_ARG1(answer),
+	    IPC_GET_ARG2(answer));
+	return EOK;
+}
+
 /** Instruct loader to load the program.
  *
  * If this function succeeds, the program has been successfully loaded
@@ -126,6 +126,40 @@
 	((heap_block_foot_t *) \
 	    (((uintptr_t) (head)) + (head)->size - sizeof(heap_block_foot_t)))
 
+/** Number of size classes of small blocks.
+ *
+ * Small blocks are cached in per-class free lists. The size classes are
+ * BASE_ALIGN bytes apart, starting at BASE_ALIGN.
+ *
+ */
+#define CACHE_CLASSES  16
+
+/** Maximum net size of a cached small block. */
+#define CACHE_MAX_SIZE  (CACHE_CLASSES * BASE_ALIGN)
+
+/** Number of independent small block caches.
+ *
+ * Threads allocating concurrently pick different caches, so
+ * that they do not contend on a single lock.
+ *
+ */
+#define CACHE_ARENAS  4
+
+/** Maximum number of blocks kept in a free list of a cache. */
+#define CACHE_LIMIT  16
+
+/** Number of blocks taken from the heap at once to refill a free list. */
+#define CACHE_BATCH  8
+
+/** Link to the next block in a free list of a cache.
+ *
+ * Stored in the first word of the block payload.
+ *
+ */
+#define CACHE_NEXT(head) \
+	(*((heap_block_head_t **) (((uintptr_t) (head)) + \
+	    sizeof(heap_block_head_t))))
+
 /** Heap area.
  *
  * The memory managed by the heap allocator is divided into
@@ -183,6 +217,24 @@ typedef struct {
 	uint32_t magic;
 } heap_block_foot_t;
 
+/** Cache of small blocks
+ *
+ * The cached blocks are regular heap blocks which remain marked as used
+ * in the heap, so it is not necessary to take the heap lock to allocate
+ * or free them.
+ *
+ */
+typedef struct {
+	/** Futex protecting the cache */
+	futex_t futex;
+
+	/** Free lists of the size classes */
+	heap_block_head_t *blocks[CACHE_CLASSES];
+
+	/** Number of blocks in the free lists */
+	size_t count[CACHE_CLASSES];
+} heap_arena_t;
+
 /** First heap area */
 static heap_area_t *first_heap_area = NULL;
 
@@ -195,6 +247,16 @@ static heap_block_head_t *next_fit = NULL;
 /** Futex for thread-safe heap manipulation */
 static futex_t malloc_futex = FUTEX_INITIALIZER;
 
+/** Small block caches */
+static heap_arena_t arenas[CACHE_ARENAS] = {
+	[0 ... CACHE_ARENAS - 1] = {
+		.futex = FUTEX_INITIALIZER
+	}
+};
+
+/** Cache to try first when looking for an unlocked one */
+static size_t arena_hint = 0;
+
 #define malloc_assert(expr) safe_assert(expr)
 
 #ifdef FUTEX_UPGRADABLE
@@ -239,6 +301,29 @@ static inline void heap_unlock(void)
 	}
 }
 
+/** Try to lock a small block cache. */
+static inline bool arena_trylock(heap_arena_t *arena)
+{
+	if (multithreaded)
+		return futex_trydown(&arena->futex);
+
+	return true;
+}
+
+/** Lock a small block cache. */
+static inline void arena_lock(heap_arena_t *arena)
+{
+	if (multithreaded)
+		futex_down(&arena->futex);
+}
+
+/** Unlock a small block cache. */
+static inline void arena_unlock(heap_arena_t *arena)
+{
+	if (multithreaded)
+		futex_up(&arena->futex);
+}
+
 #else
 
 /** Makes accesses to the heap thread safe. */
@@ -258,6 +343,24 @@ static inline void heap_unlock(void)
 {
 	futex_up(&malloc_futex);
 }
+
+/** Try to lock a small block cache. */
+static inline bool arena_trylock(heap_arena_t *arena)
+{
+	return futex_trydown(&arena->futex);
+}
+
+/** Lock a small block cache. */
+static inline void arena_lock(heap_arena_t *arena)
+{
+	futex_down(&arena->futex);
+}
+
+/** Unlock a small block cache. */
+static inline void arena_unlock(heap_arena_t *arena)
+{
+	futex_up(&arena->futex);
+}
 #endif
 
 
@@ -806,6 +909,130 @@ static void *malloc_internal(const size_t size, const size_t align)
 	return heap_grow_and_alloc(gross_size, falign);
 }
 
+/** Pick and lock a small block cache
+ *
+ * Prefer a cache which is not locked by another thread and remember it
+ * as the first candidate for the next time.
+ *
+ * @return Locked cache.
+ *
+ */
+static heap_arena_t *arena_get(void)
+{
+	size_t hint = __atomic_load_n(&arena_hint, __ATOMIC_RELAXED);
+
+	for (size_t i = 0; i < CACHE_ARENAS; i++) {
+		heap_arena_t *arena = &arenas[(hint + i) % CACHE_ARENAS];
+
+		if (arena_trylock(arena)) {
+			if (i > 0) {
+				__atomic_store_n(&arena_hint, hint + i,
+				    __ATOMIC_RELAXED);
+			}
+
+			return arena;
+		}
+	}
+
+	heap_arena_t *arena = &arenas[hint % CACHE_ARENAS];
+	arena_lock(arena);
+	return arena;
+}
+
+/** Refill a free list of a small block cache from the heap
+ *
+ * Should be called only with the cache locked.
+ *
+ * @param arena Small block cache.
+ * @param cls   Size class to refill.
+ *
+ */
+static void cache_refill(heap_arena_t *arena, size_t cls)
+{
+	heap_lock();
+
+	for (size_t i = 0; i < CACHE_BATCH; i++) {
+		void *addr = malloc_internal((cls + 1) * BASE_ALIGN,
+		    BASE_ALIGN);
+		if (addr == NULL)
+			break;
+
+		heap_block_head_t *head =
+		    (heap_block_head_t *) (addr - sizeof(heap_block_head_t));
+
+		CACHE_NEXT(head) = arena->blocks[cls];
+		arena->blocks[cls] = head;
+		arena->count[cls]++;
+	}
+
+	heap_unlock();
+}
+
+/** Allocate a small block from a cache
+ *
+ * @param size Number of bytes to allocate (at most CACHE_MAX_SIZE).
+ *
+ * @return Allocated memory or NULL.
+ *
+ */
+static void *cache_alloc(const size_t size)
+{
+	size_t cls = (size > 0) ?
+	    (ALIGN_UP(size, BASE_ALIGN) / BASE_ALIGN) - 1 : 0;
+	heap_arena_t *arena = arena_get();
+
+	if (arena->blocks[cls] == NULL)
+		cache_refill(arena, cls);
+
+	heap_block_head_t *head = arena->blocks[cls];
+	void *addr = NULL;
+
+	if (head != NULL) {
+		block_check(head);
+		malloc_assert(!head->free);
+
+		arena->blocks[cls] = CACHE_NEXT(head);
+		arena->count[cls]--;
+
+		addr = ((void *) head) + sizeof(heap_block_head_t);
+	}
+
+	arena_unlock(arena);
+	return addr;
+}
+
+/** Return a block to a small block cache
+ *
+ * A block is put into the free list of the largest size class it can
+ * satisfy.
+ *
+ * @param head Header of a used block.
+ *
+ * @return True if the block was cached, false if it has to be freed
+ *         to the heap.
+ *
+ */
+static bool cache_free(heap_block_head_t *head)
+{
+	size_t net_size = NET_SIZE(head->size);
+
+	if ((net_size < BASE_ALIGN) || (net_size > CACHE_MAX_SIZE))
+		return false;
+
+	size_t cls = (net_size / BASE_ALIGN) - 1;
+	heap_arena_t *arena = arena_get();
+
+	bool cached = (arena->count[cls] < CACHE_LIMIT);
+	if (cached) {
+		CACHE_NEXT(head) = arena->blocks[cls];
+		arena->blocks[cls] = head;
+		arena->count[cls]++;
+	}
+
+	arena_unlock(arena);
+	return cached;
+}
+
 /** Allocate memory by number of elements
  *
  * @param nmemb Number of members to allocate.
@@ -835,6 +1062,9 @@ void *calloc(const size_t nmemb, const size_t size)
  */
 void *malloc(const size_t size)
 {
+	if (size <= CACHE_MAX_SIZE)
+		return cache_alloc(size);
+
 	heap_lock();
 	void *block = malloc_internal(size, BASE_ALIGN);
 	heap_unlock();
@@ -858,6 +1088,9 @@ void *memalign(const size_t align, const size_t size)
 	size_t palign =
 	    1 << (fnzb(max(sizeof(void *), align) - 1) + 1);
 
+	if ((palign <= BASE_ALIGN) && (size <= CACHE_MAX_SIZE))
+		return cache_alloc(size);
+
 	heap_lock();
 	void *block = malloc_internal(size, palign);
 	heap_unlock();
@@ -992,8 +1225,6 @@ void free(void *const addr)
 	if (addr == NULL)
 		return;
 
-	heap_lock();
-
 	/* Calculate the position of the header. */
 	heap_block_head_t *head =
 	    (heap_block_head_t *) (addr - sizeof(heap_block_head_t));
@@ -1001,6 +1232,11 @@ void free(void *const addr)
 	block_check(head);
 	malloc_assert(!head->free);
 
+	if (cache_free(head))
+		return;
+
+	heap_lock();
+
 	heap_area_t *area = head->area;
 
 	area_check(area);
@@ -1042,6 +1278,35 @@ void free(void *const addr)
 
 void *heap_check(void)
 {
+	/* Walk all cached blocks */
+	for (size_t i = 0; i < CACHE_ARENAS; i++) {
+		heap_arena_t *arena = &arenas[i];
+
+		arena_lock(arena);
+
+		for (size_t cls = 0; cls < CACHE_CLASSES; cls++) {
+			for (heap_block_head_t *head = arena->blocks[cls];
+			    head != NULL; head = CACHE_NEXT(head)) {
+				/* Check cached block consistency */
+				if ((head->magic != HEAP_BLOCK_HEAD_MAGIC) ||
+				    (head->free)) {
+					arena_unlock(arena);
+					return (void *) head;
+				}
+
+				heap_block_foot_t *foot = BLOCK_FOOT(head);
+
+				if ((foot->magic != HEAP_BLOCK_FOOT_MAGIC) ||
+				    (head->size != foot->size)) {
+					arena_unlock(arena);
+					return (void *) foot;
+				}
+			}
+		}
+
+		arena_unlock(arena);
+	}
+
 	heap_lock();
 
 	if (first_heap_area == NULL) {
@@ -37,6 +37,24 @@
 #include <stdlib.h>
 #include <stddef.h>
 #include <stdint.h>
+#include "private/mem.h"
+
+/** Routines for large blocks, NULL if the generic code should be used. */
+static mem_ops_t mem_ops = {
+	.copy = NULL,
+	.set = NULL
+};
+
+/** Select the routines for large memory blocks.
+ *
+ * Called at startup before any other thread exists.
+ */
+void __mem_init(void)
+{
+#ifdef LIBARCH_MEM_OPS
+	arch_mem_init(&mem_ops);
+#endif
+}
 
 /** Fill memory block with a constant value. */
 void *memset(void *dest, int b, size_t n)
@@ -50,6 +68,9 @@ void *memset(void *dest, int b, size_t n)
 	size_t i;
 	size_t fill;
 
+	if (n >= MEM_LARGE_MIN && mem_ops.set != NULL)
+		return mem_ops.set(dest, b, n);
+
 	/* Fill initial segment. */
 	word_size = sizeof(unsigned long);
 	fill = word_size - ((uintptr_t) dest & (word_size - 1));
@@ -79,6 +100,15 @@ void *memset(void *dest, int b, size_t n)
 
 	/* Fill aligned segment. */
 	i = n_words;
+	while (i >= 4) {
+		pw[0] = pattern;
+		pw[1] = pattern;
+		pw[2] = pattern;
+		pw[3] = pattern;
+		pw += 4;
+		i -= 4;
+	}
+
 	while (i-- != 0)
 		*pw++ = pattern;
 
@@ -125,6 +155,9 @@ void *memcpy(void *dst, const void *src, size_t n)
 	const uint8_t *srcb;
 	uint8_t *dstb;
 
+	if (n >= MEM_LARGE_MIN && mem_ops.copy != NULL)
+		return mem_ops.copy(dst, src, n);
+
 	word_size = sizeof(unsigned long);
 
 	/*
@@ -172,6 +205,22 @@ void *memcpy(void *dst, const void *src, size_t n)
 
 	/* "Fast" copy. */
 	i = n_words;
+	while (i >= 4) {
+		unsigned long w0 = srcw[0];
+		unsigned long w1 = srcw[1];
+		unsigned long w2 = srcw[2];
+		unsigned long w3 = srcw[3];
+
+		dstw[0] = w0;
+		dstw[1] = w1;
+		dstw[2] = w2;
+		dstw[3] = w3;
+
+		srcw += 4;
+		dstw += 4;
+		i -= 4;
+	}
+
 	while (i-- != 0)
 		*dstw++ = *srcw++;
 
@@ -239,8 +288,31 @@ int memcmp(const void *s1, const void *s2, size_t len)
 {
 	uint8_t *u1 = (uint8_t *) s1;
 	uint8_t *u2 = (uint8_t *) s2;
+	size_t word_size = sizeof(unsigned long);
 	size_t i;
 
+	/*
+	 * If the areas are congruent modulo word_size, skip the equal
+	 * words and find the differing byte in the first unequal word.
+	 */
+	if (((uintptr_t) u1 & (word_size - 1)) ==
+	    ((uintptr_t) u2 & (word_size - 1))) {
+		while (len > 0 && ((uintptr_t) u1 & (word_size - 1)) != 0) {
+			if (*u1 != *u2)
+				return (int)(*u1) - (int)(*u2);
+			++u1;
+			++u2;
+			--len;
+		}
+
+		while (len >= word_size &&
+		    *(unsigned long *) u1 == *(unsigned long *) u2) {
+			u1 += word_size;
+			u2 += word_size;
+			len -= word_size;
+		}
+	}
+
 	for (i = 0; i < len; i++) {
 		if (*u1 != *u2)
 			return (int)(*u1) - (int)(*u2);
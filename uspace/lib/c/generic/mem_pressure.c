@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup libc
+ * @{
+ */
+/**
+ * @file
+ * @brief Memory pressure notifications.
+ *
+ * Caches can register a hook which is called whenever the kernel reports
+ * a change of the memory pressure level, and periodically while memory
+ * stays short. Caches are expected to grow opportunistically while the
+ * level is MEM_PRESSURE_NONE and to shrink when notified about a higher
+ * level.
+ */
+
+#include <mem_pressure.h>
+#include <async.h>
+#include <fibril_synch.h>
+#include <sysinfo.h>
+#include <abi/ipc/event.h>
+
+/** Protects the list of hooks and the subscription. */
+static FIBRIL_MUTEX_INITIALIZE(hooks_lock);
+static LIST_INITIALIZE(hooks);
+static bool subscribed = false;
+
+/** Last memory pressure level reported by the kernel. */
+static mem_pressure_t level = MEM_PRESSURE_NONE;
+
+static void mem_pressure_notification(ipc_call_t *call, void *arg)
+{
+	mem_pressure_t new_level = (mem_pressure_t) IPC_GET_ARG1(*call);
+
+	fibril_mutex_lock(&hooks_lock);
+
+	__atomic_store_n(&level, new_level, __ATOMIC_RELAXED);
+
+	list_foreach(hooks, link, mem_pressure_hook_t, hook)
+		hook->fn(new_level, hook->arg);
+
+	fibril_mutex_unlock(&hooks_lock);
+}
+
+/** Register a memory pressure hook
+ *
+ * The hook must not add or remove hooks itself.
+ *
+ * @param hook Hook structure, must stay valid until removed.
+ * @param fn   Function called when the memory pressure level is reported.
+ * @param arg  Argument passed to @a fn.
+ *
+ * @return EOK on success or an error code from subscribing the kernel
+ *         memory pressure event.
+ */
+errno_t mem_pressure_hook_add(mem_pressure_hook_t *hook, mem_pressure_fn_t fn,
+    void *arg)
+{
+	fibril_mutex_lock(&hooks_lock);
+
+	if (!subscribed) {
+		errno_t rc = async_event_task_subscribe(EVENT_TASK_MEM_PRESSURE,
+		    mem_pressure_notification, NULL);
+		if (rc != EOK) {
+			fibril_mutex_unlock(&hooks_lock);
+			return rc;
+		}
+
+		subscribed = true;
+
+		/* Pick up the level reported before we subscribed. */
+		sysarg_t val;
+		if (sysinfo_get_value("system.mem_pressure", &val) == EOK)
+			__atomic_store_n(&level, (mem_pressure_t) val,
+			    __ATOMIC_RELAXED);
+	}
+
+	link_initialize(&hook->link);
+	hook->fn = fn;
+	hook->arg = arg;
+	list_append(&hook->link, &hooks);
+
+	fibril_mutex_unlock(&hooks_lock);
+	return EOK;
+}
+
+/** Unregister a memory pressure hook
+ *
+ * The event stays subscribed, notifications without hooks are ignored.
+ *
+ * @param hook Hook previously registered by mem_pressure_hook_add().
+ */
+void mem_pressure_hook_remove(mem_pressure_hook_t *hook)
+{
+	fibril_mutex_lock(&hooks_lock);
+	list_remove(&hook->link);
+	fibril_mutex_unlock(&hooks_lock);
+}
+
+/** Get the last memory pressure level reported by the kernel
+ *
+ * @return Level known when the first hook was registered if no
+ *         notification has been received since.
+ */
+mem_pressure_t mem_pressure_level(void)
+{
+	return __atomic_load_n(&level, __ATOMIC_RELAXED);
+}
+
+/** @}
+ */
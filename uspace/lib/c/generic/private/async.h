@@ -37,6 +37,7 @@
 
 #include <async.h>
 #include <adt/list.h>
+#include <adt/odict.h>
 #include <fibril.h>
 #include <fibril_synch.h>
 #include <sys/time.h>
@@ -44,11 +45,11 @@
 
 /** Structures of this type are used to track the timeout events. */
 typedef struct {
-	/** If true, this struct is in the timeout list. */
+	/** If true, this struct is in the timeout dictionary. */
 	bool inlist;
 
-	/** Timeout list link. */
-	link_t link;
+	/** Timeout dictionary link, ordered by expiration time. */
+	odlink_t link;
 
 	/** If true, we have timed out. */
 	bool occurred;
@@ -85,6 +86,30 @@ struct async_sess {
 	/** List of inactive exchanges */
 	list_t exch_list;
 
+	/** Link into the list of sessions with cloned phones */
+	link_t pool_link;
+
+	/** Session is in the list of sessions with cloned phones */
+	bool pooled;
+
+	/** Protects exch_list, the phone counts and the statistics */
+	fibril_mutex_t exch_mutex;
+
+	/** Signalled when an exchange becomes inactive */
+	fibril_condvar_t exch_cv;
+
+	/** Number of phones cloned for parallel exchanges */
+	size_t phones;
+
+	/** Number of cloned phones never hung up for other sessions */
+	size_t phones_min;
+
+	/** Maximum number of cloned phones or zero for no limit */
+	size_t phones_max;
+
+	/** Exchange statistics */
+	async_sess_stats_t stats;
+
 	/** Session interface */
 	iface_t iface;
 
@@ -121,9 +146,6 @@ struct async_exch {
 	/** Link into list of inactive exchanges */
 	link_t sess_link;
 
-	/** Link into global list of inactive exchanges */
-	link_t global_link;
-
 	/** Session pointer */
 	async_sess_t *sess;
 
@@ -132,11 +154,13 @@ struct async_exch {
 };
 
 extern void awaiter_initialize(awaiter_t *);
+extern void async_sess_exch_init(async_sess_t *);
 
 extern void __async_server_init(void);
 extern void __async_client_init(void);
 extern void __async_ports_init(void);
 extern void async_insert_timeout(awaiter_t *);
+extern void async_remove_timeout(awaiter_t *);
 
 extern errno_t async_create_port_internal(iface_t, async_port_handler_t,
     void *, port_id_t *);
@@ -33,9 +33,12 @@
 #include <context.h>
 #include <libarch/tls.h>
 #include <abi/proc/uarg.h>
+#include <abi/proc/thread.h>
 #include <atomic.h>
 #include <futex.h>
 
+struct fibril_runner;
+
 struct fibril {
 	// XXX: The first two fields must not move (for taskdump).
 	link_t all_link;
@@ -43,6 +46,9 @@ struct fibril {
 
 	link_t link;
 	void *stack;
+	size_t stack_size;
+	/** Lowest stack address observed when the fibril switched away. */
+	uintptr_t stack_low;
 	void *arg;
 	errno_t (*func)(void *);
 	tcb_t *tcb;
@@ -52,6 +58,13 @@ struct fibril {
 
 	fibril_owner_info_t *waits_for;
 
+	/** Runner of the thread currently executing the fibril. */
+	struct fibril_runner *runner;
+	/** ID of the thread currently executing the fibril. */
+	thread_id_t thread_id;
+	/** True while the fibril is executing in some thread. */
+	bool running;
+
 	atomic_t futex_locks;
 	bool is_writer : 1;
 };
@@ -65,6 +78,8 @@ typedef enum {
 
 extern fibril_t *fibril_setup(void);
 extern void fibril_teardown(fibril_t *f, bool locked);
+extern void fibril_runner_enter(fibril_t *f);
+extern void fibril_runner_leave(fibril_t *f);
 extern int fibril_switch(fibril_switch_type_t stype);
 extern void fibril_add_manager(fid_t fid);
 extern void fibril_remove_manager(void);
@@ -38,6 +38,8 @@
 #include <adt/list.h>
 #include <stdio.h>
 #include <async.h>
+#include <errno.h>
+#include <offset.h>
 #include <stddef.h>
 
 /** Maximum characters that can be pushed back by ungetc() */
@@ -52,6 +54,10 @@ typedef struct {
 	    FILE *stream);
 	/** Flush stream */
 	int (*flush)(FILE *stream);
+	/** Get stream size for seeking from its end (optional) */
+	errno_t (*size)(FILE *stream, aoff64_t *size);
+	/** Release instance data on close (optional) */
+	void (*close)(FILE *stream);
 } __stream_ops_t;
 
 struct _IO_FILE {
@@ -110,6 +116,8 @@ struct _IO_FILE {
 	int ungetc_chars;
 };
 
+extern FILE *__stdio_open(__stream_ops_t *, void *);
+
 #endif
 
 /** @}
@@ -33,11 +33,19 @@
 /**
  * @file
  * @brief Quicksort.
+ *
+ * Introsort: quicksort with median-of-three pivot selection that falls
+ * back to heapsort when the recursion gets too deep and leaves small
+ * ranges to insertion sort.
  */
 
 #include <qsort.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
+
+/** Ranges with fewer elements are sorted by insertion sort */
+#define INSERTION_SORT_MAX  16
 
 /** Quicksort spec */
 typedef struct {
@@ -46,6 +54,8 @@ typedef struct {
 	size_t size;
 	int (*compar)(const void *, const void *, void *);
 	void *arg;
+	/** Elements can be swapped by machine words */
+	bool word_swap;
 } qs_spec_t;
 
 /** Comparison function wrapper.
@@ -85,6 +95,8 @@ static bool elem_lt(qs_spec_t *qs, size_t i, size_t j)
 }
 
 /** Swap two elements.
+ *
+ * Elements are swapped by machine words if the array allows it.
  *
  * @param qs Quicksort spec
  * @param i First element index
@@ -92,21 +104,121 @@ static bool elem_lt(qs_spec_t *qs, size_t i, size_t j)
  */
 static void elem_swap(qs_spec_t *qs, size_t i, size_t j)
 {
-	char *a;
-	char *b;
-	char t;
 	size_t k;
 
-	a = qs->base + i * qs->size;
-	b = qs->base + j * qs->size;
+	if (qs->word_swap) {
+		unsigned long *a;
+		unsigned long *b;
+		unsigned long t;
+
+		a = qs->base + i * qs->size;
+		b = qs->base + j * qs->size;
+
+		for (k = 0; k < qs->size / sizeof(unsigned long); k++) {
+			t = a[k];
+			a[k] = b[k];
+			b[k] = t;
+		}
+	} else {
+		char *a;
+		char *b;
+		char t;
+
+		a = qs->base + i * qs->size;
+		b = qs->base + j * qs->size;
+
+		for (k = 0; k < qs->size; k++) {
+			t = a[k];
+			a[k] = b[k];
+			b[k] = t;
+		}
+	}
+}
+
+/** Sort a small range of indices using insertion sort.
+ *
+ * @param qs Quicksort spec
+ * @param lo Lower bound (inclusive)
+ * @param hi Upper bound (inclusive)
+ */
+static void insertion_sort(qs_spec_t *qs, size_t lo, size_t hi)
+{
+	size_t i, j;
+
+	for (i = lo + 1; i <= hi; i++) {
+		for (j = i; j > lo && elem_lt(qs, j, j - 1); j--)
+			elem_swap(qs, j, j - 1);
+	}
+}
+
+/** Restore the heap property below a node.
+ *
+ * @param qs Quicksort spec
+ * @param lo Index of the heap root
+ * @param node Node index relative to @a lo
+ * @param cnt Number of heap nodes
+ */
+static void sift_down(qs_spec_t *qs, size_t lo, size_t node, size_t cnt)
+{
+	size_t child;
+
+	while ((child = 2 * node + 1) < cnt) {
+		if (child + 1 < cnt && elem_lt(qs, lo + child, lo + child + 1))
+			child++;
+
+		if (!elem_lt(qs, lo + node, lo + child))
+			return;
+
+		elem_swap(qs, lo + node, lo + child);
+		node = child;
+	}
+}
+
+/** Sort a range of indices using heapsort.
+ *
+ * @param qs Quicksort spec
+ * @param lo Lower bound (inclusive)
+ * @param hi Upper bound (inclusive)
+ */
+static void heap_sort(qs_spec_t *qs, size_t lo, size_t hi)
+{
+	size_t cnt = hi - lo + 1;
+	size_t i;
+
+	for (i = cnt / 2; i > 0; i--)
+		sift_down(qs, lo, i - 1, cnt);
 
-	for (k = 0; k < qs->size; k++) {
-		t = a[k];
-		a[k] = b[k];
-		b[k] = t;
+	for (i = cnt - 1; i > 0; i--) {
+		elem_swap(qs, lo, lo + i);
+		sift_down(qs, lo, 0, i);
 	}
 }
 
+/** Move the median of the first, middle and last element to the middle.
+ *
+ * This also guarantees that the first and the last element serve as
+ * sentinels for the partitioning.
+ *
+ * @param qs Quicksort spec
+ * @param lo Lower bound (inclusive)
+ * @param hi Upper bound (inclusive)
+ * @return Pivot index
+ */
+static size_t median_of_three(qs_spec_t *qs, size_t lo, size_t hi)
+{
+	size_t mid = lo + (hi - lo) / 2;
+
+	if (elem_lt(qs, mid, lo))
+		elem_swap(qs, mid, lo);
+	if (elem_lt(qs, hi, mid)) {
+		elem_swap(qs, hi, mid);
+		if (elem_lt(qs, mid, lo))
+			elem_swap(qs, mid, lo);
+	}
+
+	return mid;
+}
+
 /** Partition a range of indices.
  *
  * @param qs Quicksort spec
@@ -119,7 +231,7 @@ static size_t partition(qs_spec_t *qs, size_t lo, size_t hi)
 	size_t pivot;
 	size_t i, j;
 
-	pivot = lo + (hi - lo) / 2;
+	pivot = median_of_three(qs, lo, hi);
 	i = lo;
 	j = hi;
 	while (true) {
@@ -145,20 +257,60 @@ static size_t partition(qs_spec_t *qs, size_t lo, size_t hi)
 }
 
 /** Sort a range of indices.
+ *
+ * Quicksort recurses into the smaller part only, which bounds the
+ * stack depth. When partitioning degenerates, the rest of the range
+ * is sorted by heapsort. Small ranges are left to insertion sort.
  *
  * @param qs Quicksort spec
  * @param lo Lower bound (inclusive)
  * @param hi Upper bound (inclusive)
+ * @param depth Number of partitioning steps left before falling back
+ *              to heapsort
  */
-static void quicksort(qs_spec_t *qs, size_t lo, size_t hi)
+static void quicksort(qs_spec_t *qs, size_t lo, size_t hi, unsigned depth)
 {
 	size_t p;
 
-	if (lo < hi) {
+	while (hi - lo >= INSERTION_SORT_MAX) {
+		if (depth == 0) {
+			heap_sort(qs, lo, hi);
+			return;
+		}
+
+		depth--;
 		p = partition(qs, lo, hi);
-		quicksort(qs, lo, p);
-		quicksort(qs, p + 1, hi);
+
+		if (p - lo < hi - p) {
+			quicksort(qs, lo, p, depth);
+			lo = p + 1;
+		} else {
+			quicksort(qs, p + 1, hi, depth);
+			hi = p;
+		}
 	}
+
+	if (lo < hi)
+		insertion_sort(qs, lo, hi);
+}
+
+/** Start sorting an array.
+ *
+ * @param qs Quicksort spec
+ */
+static void introsort(qs_spec_t *qs)
+{
+	unsigned depth = 0;
+	size_t n;
+
+	/* Allow 2 * log2(nmemb) partitioning steps */
+	for (n = qs->nmemb; n > 1; n /= 2)
+		depth += 2;
+
+	qs->word_swap = ((uintptr_t) qs->base % sizeof(unsigned long) == 0) &&
+	    (qs->size % sizeof(unsigned long) == 0);
+
+	quicksort(qs, 0, qs->nmemb - 1, depth);
 }
 
 /** Quicksort.
@@ -182,7 +334,7 @@ void qsort(void *base, size_t nmemb, size_t size, int (*compar)(const void *,
 	qs.compar = compar_wrap;
 	qs.arg = compar;
 
-	quicksort(&qs, 0, nmemb - 1);
+	introsort(&qs);
 }
 
 /** Quicksort with extra argument to comparison function.
@@ -207,7 +359,7 @@ void qsort_r(void *base, size_t nmemb, size_t size, int (*compar)(const void *,
 	qs.compar = compar;
 	qs.arg = arg;
 
-	quicksort(&qs, 0, nmemb - 1);
+	introsort(&qs);
 }
 
 /** @}
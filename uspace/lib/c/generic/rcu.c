@@ -50,6 +50,13 @@
  * Only then does it flip the reader group and wait for preexisting
  * readers of the old reader group (invariant of SRCU [2, 3]).
  *
+ * Updaters which do not need to wait for the grace period use rcu_call().
+ * Callbacks are queued and a single fibril runs one grace period for
+ * all callbacks queued in the meantime, so that the cost of the grace
+ * period is shared by the whole batch. Updaters which have to wait
+ * can use rcu_synchronize_expedite(), which polls readers without
+ * sleeping for long.
+ *
  *
  * [1] User-level implementations of read-copy update,
  *     2012, appendix
@@ -87,6 +94,11 @@
 /** RCU sleeps for RCU_SLEEP_MS before polling an active RCU reader again. */
 #define RCU_SLEEP_MS        10
 
+/** Expedited RCU yields RCU_EXPEDITE_YIELDS times before it starts sleeping. */
+#define RCU_EXPEDITE_YIELDS  100
+/** Expedited RCU sleeps for RCU_EXPEDITE_SLEEP_US between polls afterwards. */
+#define RCU_EXPEDITE_SLEEP_US  100
+
 #define RCU_NESTING_SHIFT   1
 #define RCU_NESTING_INC     (1 << RCU_NESTING_SHIFT)
 #define RCU_GROUP_BIT_MASK  (size_t)(RCU_NESTING_INC - 1)
@@ -114,6 +126,14 @@ typedef struct rcu_data {
 		size_t blocked_thread_cnt;
 		futex_t futex_blocking_threads;
 	} sync_lock;
+	struct {
+		futex_t futex;
+		/** Callbacks waiting for the next grace period. */
+		rcu_item_t *head;
+		rcu_item_t **tail;
+		/** The callback fibril is running. */
+		bool running;
+	} cb;
 } rcu_data_t;
 
 typedef struct blocked_fibril {
@@ -146,16 +166,23 @@ static rcu_data_t rcu = {
 		.blocked_thread_cnt = 0,
 		.futex_blocking_threads = FUTEX_INITIALIZE(0),
 	},
+	.cb = {
+		.futex = FUTEX_INITIALIZER,
+		.head = NULL,
+		.tail = &rcu.cb.head,
+		.running = false,
+	},
 };
 
 
-static void wait_for_readers(size_t reader_group);
+static void _rcu_synchronize(bool expedite);
+static void wait_for_readers(size_t reader_group, bool expedite);
 static void force_mb_in_all_threads(void);
 static bool is_preexisting_reader(const fibril_rcu_data_t *fib, size_t group);
 
 static void lock_sync(void);
 static void unlock_sync(void);
-static void sync_sleep(void);
+static void sync_sleep(bool expedite, size_t *polls);
 
 static bool is_in_group(size_t nesting_cnt, size_t group);
 static bool is_in_reader_section(size_t nesting_cnt);
@@ -234,6 +261,12 @@ void rcu_read_unlock(void)
 	fibril_rcu.nesting_cnt -= RCU_NESTING_INC;
 }
 
+/** Returns true if the current fibril is registered with RCU. */
+bool rcu_fibril_registered(void)
+{
+	return fibril_rcu.registered;
+}
+
 /** Returns true if the current fibril is in an RCU reader section. */
 bool rcu_read_locked(void)
 {
@@ -242,6 +275,118 @@ bool rcu_read_locked(void)
 
 /** Blocks until all preexisting readers exit their critical sections. */
 void rcu_synchronize(void)
+{
+	_rcu_synchronize(false);
+}
+
+/** Blocks until all preexisting readers exit their critical sections.
+ *
+ * Unlike rcu_synchronize(), polls the readers without sleeping for long
+ * at the expense of more CPU time spent waiting.
+ */
+void rcu_synchronize_expedite(void)
+{
+	_rcu_synchronize(true);
+}
+
+/** Runs callbacks queued by rcu_call() after a grace period elapses. */
+static errno_t rcu_cb_fibril(void *arg)
+{
+	while (true) {
+		futex_lock(&rcu.cb.futex);
+
+		rcu_item_t *batch = rcu.cb.head;
+		if (batch == NULL) {
+			rcu.cb.running = false;
+			futex_unlock(&rcu.cb.futex);
+			return EOK;
+		}
+
+		rcu.cb.head = NULL;
+		rcu.cb.tail = &rcu.cb.head;
+		futex_unlock(&rcu.cb.futex);
+
+		/* One grace period for all the callbacks in the batch. */
+		_rcu_synchronize(false);
+
+		while (batch != NULL) {
+			rcu_item_t *next = batch->next;
+			batch->func(batch);
+			batch = next;
+		}
+	}
+}
+
+/** Invokes @a func after all preexisting readers exit their critical sections.
+ *
+ * Unlike rcu_synchronize(), does not block. The callback is invoked
+ * in a separate fibril, together with other callbacks queued during
+ * the same grace period.
+ *
+ * @param item Item to link the callback with. May be freed by @a func.
+ * @param func Callback to invoke.
+ */
+void rcu_call(rcu_item_t *item, rcu_func_t func)
+{
+	item->func = func;
+	item->next = NULL;
+
+	futex_lock(&rcu.cb.futex);
+
+	*rcu.cb.tail = item;
+	rcu.cb.tail = &item->next;
+
+	bool start = !rcu.cb.running;
+	rcu.cb.running = true;
+
+	futex_unlock(&rcu.cb.futex);
+
+	if (!start)
+		return;
+
+	fid_t fid = fibril_create(rcu_cb_fibril, NULL);
+	if (fid == 0) {
+		/* The callbacks stay queued until the next rcu_call(). */
+		futex_lock(&rcu.cb.futex);
+		rcu.cb.running = false;
+		futex_unlock(&rcu.cb.futex);
+		return;
+	}
+
+	fibril_add_ready(fid);
+}
+
+/** Barrier item queued by rcu_barrier(). */
+typedef struct {
+	rcu_item_t item;
+	volatile bool done;
+} rcu_barrier_item_t;
+
+static void rcu_barrier_cb(rcu_item_t *item)
+{
+	rcu_barrier_item_t *barrier =
+	    member_to_inst(item, rcu_barrier_item_t, item);
+
+	barrier->done = true;
+}
+
+/** Waits for all callbacks queued by rcu_call() so far to complete. */
+void rcu_barrier(void)
+{
+	assert(!rcu_read_locked());
+
+	rcu_barrier_item_t barrier = {
+		.done = false
+	};
+
+	/* Callbacks are invoked in the order they were queued. */
+	rcu_call(&barrier.item, rcu_barrier_cb);
+
+	while (!barrier.done)
+		async_usleep(RCU_SLEEP_MS * 1000);
+}
+
+static void _rcu_synchronize(bool expedite)
 {
 	assert(!rcu_read_locked());
 
@@ -299,7 +444,7 @@ void rcu_synchronize(void)
 	read_barrier(); /* MB_B */
 
 	size_t new_reader_group = get_other_group(rcu.reader_group);
-	wait_for_readers(new_reader_group);
+	wait_for_readers(new_reader_group, expedite);
 
 	/* Separates waiting for readers in new_reader_group from group flip. */
 	memory_barrier();
@@ -311,7 +456,7 @@ void rcu_synchronize(void)
 	/* Flip the group before waiting for preexisting readers in the old group.*/
 	memory_barrier();
 
-	wait_for_readers(old_reader_group);
+	wait_for_readers(old_reader_group, expedite);
 
 	/* MB_FORCE_U  */
 	force_mb_in_all_threads(); /* MB_FORCE_U */
@@ -331,8 +476,10 @@ static void force_mb_in_all_threads(void)
 }
 
 /** Waits for readers of reader_group to exit their readers sections. */
-static void wait_for_readers(size_t reader_group)
+static void wait_for_readers(size_t reader_group, bool expedite)
 {
+	size_t polls = 0;
+
 	futex_lock(&rcu.list_futex);
 
 	list_t quiescent_fibrils;
@@ -345,7 +492,7 @@ static void wait_for_readers(size_t reader_group)
 
 			if (is_preexisting_reader(fib, reader_group)) {
 				futex_unlock(&rcu.list_futex);
-				sync_sleep();
+				sync_sleep(expedite, &polls);
 				futex_lock(&rcu.list_futex);
 				/* Break to while loop. */
 				break;
@@ -414,7 +561,7 @@ static void unlock_sync(void)
 	}
 }
 
-static void sync_sleep(void)
+static void sync_sleep(bool expedite, size_t *polls)
 {
 	assert(rcu.sync_lock.locked);
 	/*
@@ -422,7 +569,17 @@ static void sync_sleep(void)
 	 * but keep sync locked.
 	 */
 	futex_unlock(&rcu.sync_lock.futex);
-	async_usleep(RCU_SLEEP_MS * 1000);
+
+	if (!expedite) {
+		async_usleep(RCU_SLEEP_MS * 1000);
+	} else if (*polls < RCU_EXPEDITE_YIELDS) {
+		/* Let readers in fibrils of this thread make progress. */
+		++*polls;
+		fibril_yield();
+	} else {
+		async_usleep(RCU_EXPEDITE_SLEEP_US);
+	}
+
 	futex_lock(&rcu.sync_lock.futex);
 }
 
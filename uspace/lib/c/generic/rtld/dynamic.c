@@ -77,6 +77,9 @@ void dynamic_parse(elf_dyn_t *dyn_ptr, size_t bias, dyn_info_t *info)
 		case DT_HASH:
 			info->hash = d_ptr;
 			break;
+		case DT_GNU_HASH:
+			info->gnu_hash = d_ptr;
+			break;
 		case DT_STRTAB:
 			info->str_tab = d_ptr;
 			break;
@@ -134,6 +137,14 @@ void dynamic_parse(elf_dyn_t *dyn_ptr, size_t bias, dyn_info_t *info)
 		case DT_BIND_NOW:
 			info->bind_now = true;
 			break;
+		case DT_FLAGS:
+			if ((d_val & DF_SYMBOLIC) != 0)
+				info->symbolic = true;
+			if ((d_val & DF_TEXTREL) != 0)
+				info->text_rel = true;
+			if ((d_val & DF_BIND_NOW) != 0)
+				info->bind_now = true;
+			break;
 
 		default:
 			if (dp->d_tag >= DT_LOPROC && dp->d_tag <= DT_HIPROC)
@@ -155,6 +166,7 @@ void dynamic_parse(elf_dyn_t *dyn_ptr, size_t bias, dyn_info_t *info)
 	DPRINTF("soname='%s'\n", info->soname);
 	DPRINTF("rpath='%s'\n", info->rpath);
 	DPRINTF("hash=0x%" PRIxPTR "\n", (uintptr_t)info->hash);
+	DPRINTF("gnu_hash=0x%" PRIxPTR "\n", (uintptr_t)info->gnu_hash);
 	DPRINTF("dt_rela=0x%" PRIxPTR "\n", (uintptr_t)info->rela);
 	DPRINTF("dt_rela_sz=0x%" PRIxPTR "\n", (uintptr_t)info->rela_sz);
 	DPRINTF("dt_rel=0x%" PRIxPTR "\n", (uintptr_t)info->rel);
@@ -49,6 +49,7 @@
 #include <rtld/dynamic.h>
 #include <rtld/rtld_arch.h>
 #include <rtld/module.h>
+#include <rtld/symbol.h>
 
 /** Create module for static executable.
  *
@@ -94,9 +95,11 @@ errno_t module_create_static_exec(rtld_t *rtld, module_t **rmodule)
 	return EOK;
 }
 
-/** (Eagerly) process all relocation tables in a module.
+/** Process all relocation tables in a module.
  *
- * Currently works as if LD_BIND_NOW was specified.
+ * PLT relocations are bound lazily on the first call, unless the module
+ * requests immediate binding (DT_BIND_NOW) or the architecture does not
+ * support lazy binding.
  */
 void module_process_relocs(module_t *m)
 {
@@ -107,11 +110,14 @@ void module_process_relocs(module_t *m)
 		return;
 
 	module_process_pre_arch(m);
+	symbol_cache_init(m);
 
 	/* jmp_rel table */
 	if (m->dyn.jmp_rel != NULL) {
 		DPRINTF("jmp_rel table\n");
-		if (m->dyn.plt_rel == DT_REL) {
+		if (!m->dyn.bind_now && module_plt_lazy_arch(m)) {
+			DPRINTF("jmp_rel table bound lazily\n");
+		} else if (m->dyn.plt_rel == DT_REL) {
 			DPRINTF("jmp_rel table type DT_REL\n");
 			rel_table_process(m, m->dyn.jmp_rel, m->dyn.plt_rel_sz);
 		} else {
@@ -133,6 +139,7 @@ void module_process_relocs(module_t *m)
 		rela_table_process(m, m->dyn.rela, m->dyn.rela_sz);
 	}
 
+	symbol_cache_fini(m);
 	m->relocated = true;
 }
 
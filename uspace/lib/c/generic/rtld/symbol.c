@@ -44,6 +44,23 @@
 #include <rtld/rtld_debug.h>
 #include <rtld/symbol.h>
 
+/** Symbol name together with its precomputed hash values. */
+typedef struct {
+	const char *name;
+	/** SysV ELF hash of the name */
+	elf_word hash;
+	/** GNU hash of the name */
+	elf_word gnu_hash;
+} symbol_key_t;
+
+/** Definition cached during relocation processing. */
+struct symbol_cache_entry {
+	/** Symbol definition, NULL if not resolved yet */
+	elf_symbol_t *sym;
+	/** Module containing the definition */
+	module_t *mod;
+};
+
 /*
  * Hash tables are 32-bit (elf_word) even for 64-bit ELF files.
  */
@@ -62,38 +79,120 @@ static elf_word elf_hash(const unsigned char *name)
 	return h;
 }
 
-static elf_symbol_t *def_find_in_module(const char *name, module_t *m)
+static elf_word elf_gnu_hash(const unsigned char *name)
+{
+	elf_word h = 5381;
+
+	while (*name)
+		h = (h << 5) + h + *name++;
+
+	return h;
+}
+
+static void symbol_key_init(symbol_key_t *key, const char *name)
+{
+	key->name = name;
+	key->hash = elf_hash((const unsigned char *) name);
+	key->gnu_hash = elf_gnu_hash((const unsigned char *) name);
+}
+
+/** Look up a symbol using the SysV hash table (DT_HASH). */
+static elf_symbol_t *hash_find(const symbol_key_t *key, module_t *m)
 {
 	elf_symbol_t *sym_table;
-	elf_symbol_t *s, *sym;
+	elf_symbol_t *s;
 	elf_word nbucket;
 	/*elf_word nchain;*/
 	elf_word i;
 	char *s_name;
 	elf_word bucket;
 
-	DPRINTF("def_find_in_module('%s', %s)\n", name, m->dyn.soname);
-
 	sym_table = m->dyn.sym_tab;
 	nbucket = m->dyn.hash[0];
 	/*nchain = m->dyn.hash[1]; XXX Use to check HT range*/
 
-	bucket = elf_hash((unsigned char *)name) % nbucket;
+	bucket = key->hash % nbucket;
 	i = m->dyn.hash[2 + bucket];
 
-	sym = NULL;
 	while (i != STN_UNDEF) {
 		s = &sym_table[i];
 		s_name = m->dyn.str_tab + s->st_name;
 
-		if (str_cmp(name, s_name) == 0) {
-			sym = s;
-			break;
-		}
+		if (str_cmp(key->name, s_name) == 0)
+			return s;
 
 		i = m->dyn.hash[2 + nbucket + i];
 	}
 
+	return NULL;
+}
+
+/** Look up a symbol using the GNU hash table (DT_GNU_HASH).
+ *
+ * The table starts with a header of four words (number of buckets,
+ * index of the first hashed symbol, number of Bloom filter words and
+ * the Bloom filter shift), followed by the Bloom filter made of native
+ * sized words, the buckets and the hash value chains.
+ */
+static elf_symbol_t *gnu_hash_find(const symbol_key_t *key, module_t *m)
+{
+	elf_word *table = m->dyn.gnu_hash;
+	elf_word nbucket = table[0];
+	elf_word symoffset = table[1];
+	elf_word bloom_size = table[2];
+	elf_word bloom_shift = table[3];
+	const uintptr_t *bloom = (const uintptr_t *) &table[4];
+	const elf_word *buckets = (const elf_word *) &bloom[bloom_size];
+	const elf_word *chain = &buckets[nbucket];
+	const unsigned bits = sizeof(uintptr_t) * 8;
+	elf_symbol_t *sym_table = m->dyn.sym_tab;
+	elf_word h = key->gnu_hash;
+
+	/* Most lookups for undefined names end at the Bloom filter */
+	uintptr_t word = bloom[(h / bits) % bloom_size];
+	uintptr_t mask = ((uintptr_t) 1 << (h % bits)) |
+	    ((uintptr_t) 1 << ((h >> bloom_shift) % bits));
+	if ((word & mask) != mask)
+		return NULL;
+
+	elf_word i = buckets[h % nbucket];
+	if (i < symoffset)
+		return NULL;
+
+	while (true) {
+		elf_word ch = chain[i - symoffset];
+
+		/* The lowest bit marks the end of the chain */
+		if ((h | 1) == (ch | 1)) {
+			elf_symbol_t *s = &sym_table[i];
+			char *s_name = m->dyn.str_tab + s->st_name;
+
+			if (str_cmp(key->name, s_name) == 0)
+				return s;
+		}
+
+		if ((ch & 1) != 0)
+			break;
+
+		++i;
+	}
+
+	return NULL;
+}
+
+static elf_symbol_t *def_find_in_module(const symbol_key_t *key, module_t *m)
+{
+	elf_symbol_t *sym;
+
+	DPRINTF("def_find_in_module('%s', %s)\n", key->name, m->dyn.soname);
+
+	if (m->dyn.gnu_hash != NULL)
+		sym = gnu_hash_find(key, m);
+	else if (m->dyn.hash != NULL)
+		sym = hash_find(key, m);
+	else
+		sym = NULL;
+
 	if (!sym)
 		return NULL;	/* Not found */
 
@@ -122,8 +221,11 @@ elf_symbol_t *symbol_bfs_find(const char *name, module_t *start,
 	module_t *m, *dm;
 	elf_symbol_t *sym, *s;
 	list_t queue;
+	symbol_key_t key;
 	size_t i;
 
+	symbol_key_init(&key, name);
+
 	/*
 	 * Do a BFS using the queue_link and bfs_tag fields.
 	 * Vertices (modules) are tagged the moment they are inserted
@@ -149,7 +251,7 @@ elf_symbol_t *symbol_bfs_find(const char *name, module_t *start,
 		list_remove(&m->queue_link);
 
 		/* If ssf_noroot is specified, do not look in start module */
-		s = def_find_in_module(name, m);
+		s = def_find_in_module(&key, m);
 		if (s != NULL) {
 			/* Symbol found */
 			sym = s;
@@ -200,16 +302,21 @@ elf_symbol_t *symbol_def_find(const char *name, module_t *origin,
     symbol_search_flags_t flags, module_t **mod)
 {
 	elf_symbol_t *s;
+	symbol_key_t key;
 
 	DPRINTF("symbol_def_find('%s', origin='%s'\n",
 	    name, origin->dyn.soname);
+
+	/* Hash the name only once for all the modules searched */
+	symbol_key_init(&key, name);
+
 	if (origin->dyn.symbolic && (!origin->exec || (flags & ssf_noexec) == 0)) {
 		DPRINTF("symbolic->find '%s' in module '%s'\n", name, origin->dyn.soname);
 		/*
 		 * Origin module has a DT_SYMBOLIC flag.
 		 * Try this module first
 		 */
-		s = def_find_in_module(name, origin);
+		s = def_find_in_module(&key, origin);
 		if (s != NULL) {
 			/* Found */
 			*mod = origin;
@@ -223,7 +330,7 @@ elf_symbol_t *symbol_def_find(const char *name, module_t *origin,
 		DPRINTF("module '%s' local?\n", m->dyn.soname);
 		if (!m->local && (!m->exec || (flags & ssf_noexec) == 0)) {
 			DPRINTF("!local->find '%s' in module '%s'\n", name, m->dyn.soname);
-			s = def_find_in_module(name, m);
+			s = def_find_in_module(&key, m);
 			if (s != NULL) {
 				/* Found */
 				*mod = m;
@@ -238,7 +345,7 @@ elf_symbol_t *symbol_def_find(const char *name, module_t *origin,
 	    origin->dyn.soname);
 
 	if (!origin->exec || (flags & ssf_noexec) == 0) {
-		s = def_find_in_module(name, origin);
+		s = def_find_in_module(&key, origin);
 		if (s != NULL) {
 			/* Found */
 			*mod = origin;
@@ -250,6 +357,115 @@ elf_symbol_t *symbol_def_find(const char *name, module_t *origin,
 	return NULL;
 }
 
+/** Get the number of entries in the dynamic symbol table of a module.
+ *
+ * The dynamic section does not record the size of the symbol table,
+ * it has to be derived from the hash table.
+ */
+static size_t symbol_count(module_t *m)
+{
+	if (m->dyn.hash != NULL) {
+		/* nchain equals the number of symbol table entries */
+		return m->dyn.hash[1];
+	}
+
+	if (m->dyn.gnu_hash == NULL)
+		return 0;
+
+	elf_word *table = m->dyn.gnu_hash;
+	elf_word nbucket = table[0];
+	elf_word symoffset = table[1];
+	elf_word bloom_size = table[2];
+	const uintptr_t *bloom = (const uintptr_t *) &table[4];
+	const elf_word *buckets = (const elf_word *) &bloom[bloom_size];
+	const elf_word *chain = &buckets[nbucket];
+
+	/* Find the highest bucket start and walk its chain to the end */
+	elf_word last = 0;
+	for (elf_word i = 0; i < nbucket; i++) {
+		if (buckets[i] > last)
+			last = buckets[i];
+	}
+
+	if (last < symoffset)
+		return symoffset;
+
+	while ((chain[last - symoffset] & 1) == 0)
+		++last;
+
+	return last + 1;
+}
+
+/** Set up caching of symbol definitions for relocation processing.
+ *
+ * Relocation tables typically refer to the same symbol from many
+ * entries. The definitions found by symbol_reloc_find() are remembered
+ * until symbol_cache_fini() is called. Failure to allocate the cache is
+ * not fatal, the definitions are just looked up every time.
+ *
+ * @param m Module whose relocations are going to be processed
+ */
+void symbol_cache_init(module_t *m)
+{
+	size_t count = symbol_count(m);
+
+	m->sym_cache = NULL;
+	m->sym_cache_len = 0;
+
+	if (count == 0)
+		return;
+
+	m->sym_cache = calloc(count, sizeof(struct symbol_cache_entry));
+	if (m->sym_cache != NULL)
+		m->sym_cache_len = count;
+}
+
+/** Free the cache of symbol definitions.
+ *
+ * @param m Module
+ */
+void symbol_cache_fini(module_t *m)
+{
+	free(m->sym_cache);
+	m->sym_cache = NULL;
+	m->sym_cache_len = 0;
+}
+
+/** Find the definition of a symbol referenced by a relocation.
+ *
+ * Same as symbol_def_find() with @c ssf_none, but the result is cached
+ * by symbol table index during relocation processing.
+ *
+ * @param m		Module containing the relocation.
+ * @param sym_idx	Index of the referenced symbol in the symbol table
+ *			of @a m.
+ * @param mod		(output) Will be filled with a pointer to the module
+ *			that contains the symbol.
+ */
+elf_symbol_t *symbol_reloc_find(module_t *m, elf_word sym_idx,
+    module_t **mod)
+{
+	elf_symbol_t *sym_table = m->dyn.sym_tab;
+	const char *name = m->dyn.str_tab + sym_table[sym_idx].st_name;
+	struct symbol_cache_entry *entry = NULL;
+
+	if (sym_idx < m->sym_cache_len) {
+		entry = &m->sym_cache[sym_idx];
+		if (entry->sym != NULL) {
+			*mod = entry->mod;
+			return entry->sym;
+		}
+	}
+
+	elf_symbol_t *sym = symbol_def_find(name, m, ssf_none, mod);
+	if (sym != NULL && entry != NULL) {
+		entry->sym = sym;
+		entry->mod = *mod;
+	}
+
+	return sym;
+}
+
 /** Get symbol address.
  *
  * @param sym Symbol
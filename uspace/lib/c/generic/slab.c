@@ -0,0 +1,373 @@
+/*
+ * Copyright (c) 2018 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup libc
+ * @{
+ */
+/** @file Object caches.
+ *
+ * A userspace counterpart of the kernel slab allocator. Each cache keeps
+ * constructed objects in magazines held by a few magazine slots. A thread
+ * uses the first slot it can lock without waiting, so that threads using
+ * the same cache concurrently do not serialize on one lock. Slots exchange
+ * full and empty magazines with a depot shared by the whole cache and the
+ * depot gets new objects from slabs allocated on the heap.
+ *
+ * Unlike in the kernel, the magazines are not bound to processors or
+ * threads, because thread-local storage belongs to fibrils in libc.
+ */
+
+#include <slab.h>
+#include <align.h>
+#include <as.h>
+#include <assert.h>
+#include <macros.h>
+#include <malloc.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/** Minimum number of objects in a slab. */
+#define SLAB_MIN_OBJECTS  8
+
+/** Maximum number of full magazines in the depot of a cache. */
+#define SLAB_DEPOT_MAX  8
+
+struct slab_magazine {
+	/** Link to the depot */
+	link_t link;
+	/** Number of objects in the magazine */
+	size_t count;
+	void *objs[SLAB_MAG_SIZE];
+};
+
+/** Slab header, stored at the beginning of each slab. */
+typedef struct {
+	/** Link to slab_cache_t.slabs */
+	link_t link;
+	/** Number of free objects in the slab */
+	size_t available;
+	/** List of free objects linked through their first word */
+	void *free;
+} slab_t;
+
+/** Size of a slab header including the padding before the first object. */
+static size_t slab_header_size(slab_cache_t *cache)
+{
+	return ALIGN_UP(sizeof(slab_t), cache->align);
+}
+
+/** Compute the slab geometry of a cache.
+ *
+ * The slab size is a power of two at least one page large, so that the
+ * slab of an object can be found by aligning its address down.
+ */
+static void slab_geometry(slab_cache_t *cache)
+{
+	/* Make room for the free list link in each object. */
+	cache->align = max(cache->align, sizeof(void *));
+	cache->size = ALIGN_UP(max(cache->size, sizeof(void *)), cache->align);
+
+	size_t size = slab_header_size(cache) + SLAB_MIN_OBJECTS * cache->size;
+
+	cache->slab_size = PAGE_SIZE;
+	while (cache->slab_size < size)
+		cache->slab_size <<= 1;
+
+	cache->objects = (cache->slab_size - slab_header_size(cache)) /
+	    cache->size;
+}
+
+/** Find the slab containing an object. */
+static slab_t *slab_of(slab_cache_t *cache, void *obj)
+{
+	return (slab_t *) ALIGN_DOWN((uintptr_t) obj, cache->slab_size);
+}
+
+/** Take a free object from the slabs of a cache.
+ *
+ * Should be called only with the cache futex held.
+ *
+ * @return Unconstructed object or NULL if out of memory.
+ */
+static void *slab_obj_get(slab_cache_t *cache)
+{
+	if (cache->slab_size == 0)
+		slab_geometry(cache);
+
+	slab_t *slab;
+
+	if (list_empty(&cache->slabs)) {
+		slab = memalign(cache->slab_size, cache->slab_size);
+		if (slab == NULL)
+			return NULL;
+
+		slab->available = cache->objects;
+		slab->free = NULL;
+
+		/* Link the objects so that they are handed out in order. */
+		uintptr_t base = (uintptr_t) slab + slab_header_size(cache);
+		for (size_t i = cache->objects; i > 0; i--) {
+			void *obj = (void *) (base + (i - 1) * cache->size);
+			*((void **) obj) = slab->free;
+			slab->free = obj;
+		}
+
+		list_append(&slab->link, &cache->slabs);
+	} else {
+		slab = list_get_instance(list_first(&cache->slabs), slab_t,
+		    link);
+	}
+
+	void *obj = slab->free;
+	slab->free = *((void **) obj);
+	slab->available--;
+
+	if (slab->available == 0)
+		list_remove(&slab->link);
+
+	return obj;
+}
+
+/** Return an object to its slab.
+ *
+ * The slab is freed once all its objects are returned.
+ * Should be called only with the cache futex held.
+ */
+static void slab_obj_put(slab_cache_t *cache, void *obj)
+{
+	slab_t *slab = slab_of(cache, obj);
+
+	*((void **) obj) = slab->free;
+	slab->free = obj;
+	slab->available++;
+
+	if (slab->available == 1)
+		list_append(&slab->link, &cache->slabs);
+
+	if (slab->available == cache->objects) {
+		list_remove(&slab->link);
+		free(slab);
+	}
+}
+
+/** Destroy an object and return it to its slab. */
+static void slab_obj_destroy(slab_cache_t *cache, void *obj)
+{
+	if (cache->destructor != NULL)
+		cache->destructor(obj);
+
+	futex_down(&cache->futex);
+	slab_obj_put(cache, obj);
+	futex_up(&cache->futex);
+}
+
+/** Allocate and construct a new object. */
+static void *slab_obj_create(slab_cache_t *cache)
+{
+	futex_down(&cache->futex);
+	void *obj = slab_obj_get(cache);
+	futex_up(&cache->futex);
+
+	if ((obj != NULL) && (cache->constructor != NULL) &&
+	    (cache->constructor(obj) != EOK)) {
+		futex_down(&cache->futex);
+		slab_obj_put(cache, obj);
+		futex_up(&cache->futex);
+		return NULL;
+	}
+
+	return obj;
+}
+
+/** Pick and lock a magazine slot of a cache. */
+static slab_mag_slot_t *slab_slot_get(slab_cache_t *cache)
+{
+	size_t hint = __atomic_load_n(&cache->hint, __ATOMIC_RELAXED);
+
+	for (size_t i = 0; i < SLAB_MAG_SLOTS; i++) {
+		slab_mag_slot_t *slot =
+		    &cache->slots[(hint + i) % SLAB_MAG_SLOTS];
+
+		if (futex_trydown(&slot->futex)) {
+			if (i > 0) {
+				__atomic_store_n(&cache->hint, hint + i,
+				    __ATOMIC_RELAXED);
+			}
+
+			return slot;
+		}
+	}
+
+	slab_mag_slot_t *slot = &cache->slots[hint % SLAB_MAG_SLOTS];
+	futex_down(&slot->futex);
+	return slot;
+}
+
+/** Create an object cache.
+ *
+ * @param name  Name of the cache used for debugging.
+ * @param size  Size of the objects.
+ * @param align Alignment of the objects or zero for the default.
+ * @param ctor  Object constructor or NULL.
+ * @param dtor  Object destructor or NULL.
+ *
+ * @return New cache or NULL if out of memory.
+ */
+slab_cache_t *slab_cache_create(const char *name, size_t size, size_t align,
+    errno_t (*ctor)(void *), void (*dtor)(void *))
+{
+	slab_cache_t *cache = malloc(sizeof(slab_cache_t));
+	if (cache == NULL)
+		return NULL;
+
+	*cache = (slab_cache_t) SLAB_CACHE_INITIALIZER(*cache, name, size,
+	    align, ctor, dtor);
+	return cache;
+}
+
+/** Destroy an object cache.
+ *
+ * All objects allocated from the cache must have been freed.
+ *
+ * @param cache Cache created by slab_cache_create().
+ */
+void slab_cache_destroy(slab_cache_t *cache)
+{
+	for (size_t i = 0; i < SLAB_MAG_SLOTS; i++) {
+		slab_magazine_t *mag = cache->slots[i].current;
+		if (mag == NULL)
+			continue;
+
+		while (mag->count > 0)
+			slab_obj_destroy(cache, mag->objs[--mag->count]);
+
+		free(mag);
+	}
+
+	slab_magazine_t *mag;
+	while ((mag = list_pop(&cache->magazines, slab_magazine_t,
+	    link)) != NULL) {
+		while (mag->count > 0)
+			slab_obj_destroy(cache, mag->objs[--mag->count]);
+
+		free(mag);
+	}
+
+	assert(list_empty(&cache->slabs));
+	free(cache);
+}
+
+/** Allocate an object from a cache.
+ *
+ * @param cache Object cache.
+ *
+ * @return Constructed object or NULL if out of memory or if the
+ *         constructor failed.
+ */
+void *slab_alloc(slab_cache_t *cache)
+{
+	slab_mag_slot_t *slot = slab_slot_get(cache);
+	slab_magazine_t *mag = slot->current;
+
+	if ((mag == NULL) || (mag->count == 0)) {
+		/* Exchange the empty magazine for a full one from the depot. */
+		futex_down(&cache->futex);
+		slab_magazine_t *full = list_pop(&cache->magazines,
+		    slab_magazine_t, link);
+		if (full != NULL)
+			cache->magazine_count--;
+		futex_up(&cache->futex);
+
+		if (full != NULL) {
+			free(mag);
+			slot->current = mag = full;
+		}
+	}
+
+	if ((mag != NULL) && (mag->count > 0)) {
+		void *obj = mag->objs[--mag->count];
+		futex_up(&slot->futex);
+		return obj;
+	}
+
+	futex_up(&slot->futex);
+	return slab_obj_create(cache);
+}
+
+/** Return an object to a cache.
+ *
+ * @param cache Object cache the object was allocated from.
+ * @param obj   Object to free or NULL.
+ */
+void slab_free(slab_cache_t *cache, void *obj)
+{
+	if (obj == NULL)
+		return;
+
+	slab_mag_slot_t *slot = slab_slot_get(cache);
+	slab_magazine_t *mag = slot->current;
+
+	if ((mag != NULL) && (mag->count == SLAB_MAG_SIZE)) {
+		/* Move the full magazine to the depot if there is room. */
+		futex_down(&cache->futex);
+		bool moved = (cache->magazine_count < SLAB_DEPOT_MAX);
+		if (moved) {
+			list_append(&mag->link, &cache->magazines);
+			cache->magazine_count++;
+		}
+		futex_up(&cache->futex);
+
+		if (!moved) {
+			futex_up(&slot->futex);
+			slab_obj_destroy(cache, obj);
+			return;
+		}
+
+		slot->current = mag = NULL;
+	}
+
+	if (mag == NULL) {
+		mag = malloc(sizeof(slab_magazine_t));
+		if (mag == NULL) {
+			futex_up(&slot->futex);
+			slab_obj_destroy(cache, obj);
+			return;
+		}
+
+		link_initialize(&mag->link);
+		mag->count = 0;
+		slot->current = mag;
+	}
+
+	mag->objs[mag->count++] = obj;
+	futex_up(&slot->futex);
+}
+
+/** @}
+ */
@@ -81,6 +81,91 @@ stats_cpu_t *stats_get_cpus(size_t *count)
 	return stats_cpus;
 }
 
+/** Get interrupt statistics
+ *
+ * @param count Number of records returned.
+ *
+ * @return Array of stats_irq_t structures, one for each INR
+ *         handled by each CPU. If non-NULL then it should be
+ *         eventually freed by free().
+ *
+ */
+stats_irq_t *stats_get_irqs(size_t *count)
+{
+	size_t size = 0;
+	stats_irq_t *stats_irqs =
+	    (stats_irq_t *) sysinfo_get_data("system.irqs", &size);
+
+	if ((size % sizeof(stats_irq_t)) != 0) {
+		if (stats_irqs != NULL)
+			free(stats_irqs);
+		*count = 0;
+		return NULL;
+	}
+
+	*count = size / sizeof(stats_irq_t);
+	return stats_irqs;
+}
+
+/** Get slab cache statistics
+ *
+ * @param count Number of records returned.
+ *
+ * @return Array of stats_slab_t structures.
+ *         If non-NULL then it should be eventually freed
+ *         by free().
+ *
+ */
+stats_slab_t *stats_get_slabs(size_t *count)
+{
+	size_t size = 0;
+	stats_slab_t *stats_slabs =
+	    (stats_slab_t *) sysinfo_get_data("system.slabs", &size);
+
+	if ((size % sizeof(stats_slab_t)) != 0) {
+		if (stats_slabs != NULL)
+			free(stats_slabs);
+		*count = 0;
+		return NULL;
+	}
+
+	*count = size / sizeof(stats_slab_t);
+	return stats_slabs;
+}
+
+/** Get slab cache statistics of a single CPU
+ *
+ * The magazine counters (hits, misses and contention) are those
+ * of the given CPU only.
+ *
+ * @param cpu   CPU ID.
+ * @param count Number of records returned.
+ *
+ * @return Array of stats_slab_t structures.
+ *         If non-NULL then it should be eventually freed
+ *         by free().
+ *
+ */
+stats_slab_t *stats_get_slabs_cpu(unsigned int cpu, size_t *count)
+{
+	char name[SYSINFO_STATS_MAX_PATH];
+	snprintf(name, SYSINFO_STATS_MAX_PATH, "system.slabs.%u", cpu);
+
+	size_t size = 0;
+	stats_slab_t *stats_slabs =
+	    (stats_slab_t *) sysinfo_get_data(name, &size);
+
+	if ((size % sizeof(stats_slab_t)) != 0) {
+		if (stats_slabs != NULL)
+			free(stats_slabs);
+		*count = 0;
+		return NULL;
+	}
+
+	*count = size / sizeof(stats_slab_t);
+	return stats_slabs;
+}
+
 /** Get physical memory statistics
  *
  *
@@ -157,6 +242,36 @@ stats_task_t *stats_get_task(task_id_t task_id)
 	return stats_task;
 }
 
+/** Get phone statistics of a task
+ *
+ * @param task_id Task ID we are interested in.
+ * @param count   Number of records returned.
+ *
+ * @return Array of stats_phone_t structures.
+ *         If non-NULL then it should be eventually freed
+ *         by free().
+ *
+ */
+stats_phone_t *stats_get_phones(task_id_t task_id, size_t *count)
+{
+	char name[SYSINFO_STATS_MAX_PATH];
+	snprintf(name, SYSINFO_STATS_MAX_PATH, "system.phones.%" PRIu64, task_id);
+
+	size_t size = 0;
+	stats_phone_t *stats_phones =
+	    (stats_phone_t *) sysinfo_get_data(name, &size);
+
+	if ((size % sizeof(stats_phone_t)) != 0) {
+		if (stats_phones != NULL)
+			free(stats_phones);
+		*count = 0;
+		return NULL;
+	}
+
+	*count = size / sizeof(stats_phone_t);
+	return stats_phones;
+}
+
 /** Get thread statistics.
  *
  * @param count Number of records returned.
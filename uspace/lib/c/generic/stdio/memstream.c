@@ -0,0 +1,344 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup libc
+ * @{
+ */
+/** @file Memory streams.
+ *
+ * fmemopen() streams work within a fixed buffer, open_memstream()
+ * streams grow their buffer as needed. Both keep the data terminated
+ * by a null character whenever there is room for it.
+ */
+
+#include <errno.h>
+#include <macros.h>
+#include <mem.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <str.h>
+#include "../private/stdio.h"
+
+/** Memory stream instance */
+typedef struct {
+	/** Buffer */
+	char *buf;
+	/** Buffer size (a dynamic buffer has one more byte for the terminator) */
+	size_t capacity;
+	/** Size of the data in the buffer */
+	size_t size;
+	/** Stream can be read from */
+	bool read;
+	/** Stream can be written to */
+	bool write;
+	/** Writes always go to the end of the data */
+	bool append;
+	/** Buffer was allocated by fmemopen() */
+	bool own_buf;
+	/** Buffer is grown as needed (open_memstream()) */
+	bool dynamic;
+	/** Where to publish the buffer of a dynamic stream */
+	char **pbuf;
+	/** Where to publish the data size of a dynamic stream */
+	size_t *psize;
+} memstream_t;
+
+static size_t stdio_mem_read(void *, size_t, size_t, FILE *);
+static size_t stdio_mem_write(const void *, size_t, size_t, FILE *);
+static int stdio_mem_flush(FILE *);
+static errno_t stdio_mem_size(FILE *, aoff64_t *);
+static void stdio_mem_close(FILE *);
+
+static __stream_ops_t stdio_mem_ops = {
+	.read = stdio_mem_read,
+	.write = stdio_mem_write,
+	.flush = stdio_mem_flush,
+	.size = stdio_mem_size,
+	.close = stdio_mem_close
+};
+
+/** Read from memory stream. */
+static size_t stdio_mem_read(void *buf, size_t size, size_t nmemb,
+    FILE *stream)
+{
+	memstream_t *ms = (memstream_t *) stream->arg;
+
+	if (!ms->read) {
+		errno = EBADF;
+		stream->error = true;
+		return 0;
+	}
+
+	size_t avail = (stream->pos < ms->size) ? ms->size - stream->pos : 0;
+	size_t nread = min(size * nmemb, avail);
+
+	if (nread == 0) {
+		stream->eof = true;
+		return 0;
+	}
+
+	memcpy(buf, ms->buf + stream->pos, nread);
+	stream->pos += nread;
+
+	return nread / size;
+}
+
+/** Make room for @a need bytes in a dynamic memory stream. */
+static errno_t stdio_mem_grow(memstream_t *ms, size_t need)
+{
+	if (need <= ms->capacity)
+		return EOK;
+
+	size_t capacity = max(2 * ms->capacity, need);
+
+	/* One more byte for the null terminator */
+	char *buf = realloc(ms->buf, capacity + 1);
+	if (buf == NULL)
+		return ENOMEM;
+
+	ms->buf = buf;
+	ms->capacity = capacity;
+	return EOK;
+}
+
+/** Write to memory stream. */
+static size_t stdio_mem_write(const void *buf, size_t size, size_t nmemb,
+    FILE *stream)
+{
+	memstream_t *ms = (memstream_t *) stream->arg;
+	size_t bytes = size * nmemb;
+
+	if (!ms->write) {
+		errno = EBADF;
+		stream->error = true;
+		return 0;
+	}
+
+	if (ms->append)
+		stream->pos = ms->size;
+
+	if (ms->dynamic && stream->pos + bytes > ms->capacity) {
+		errno_t rc = stdio_mem_grow(ms, stream->pos + bytes);
+		if (rc != EOK) {
+			errno = rc;
+			stream->error = true;
+			return 0;
+		}
+	}
+
+	if (stream->pos > ms->capacity) {
+		errno = ENOSPC;
+		stream->error = true;
+		return 0;
+	}
+
+	size_t nwritten = min(bytes, ms->capacity - stream->pos);
+
+	/* Fill a gap left by seeking beyond the end of data with zeros */
+	if (stream->pos > ms->size)
+		memset(ms->buf + ms->size, 0, stream->pos - ms->size);
+
+	memcpy(ms->buf + stream->pos, buf, nwritten);
+	stream->pos += nwritten;
+
+	if (stream->pos > ms->size) {
+		ms->size = stream->pos;
+
+		if (ms->dynamic || ms->size < ms->capacity)
+			ms->buf[ms->size] = '\0';
+	}
+
+	if (nwritten < bytes) {
+		errno = ENOSPC;
+		stream->error = true;
+	}
+
+	return nwritten / size;
+}
+
+/** Flush memory stream.
+ *
+ * Publishes the buffer and the data size of a dynamic stream.
+ */
+static int stdio_mem_flush(FILE *stream)
+{
+	memstream_t *ms = (memstream_t *) stream->arg;
+
+	if (ms->dynamic) {
+		*ms->pbuf = ms->buf;
+		*ms->psize = min(stream->pos, ms->size);
+	}
+
+	return 0;
+}
+
+/** Get size of memory stream. */
+static errno_t stdio_mem_size(FILE *stream, aoff64_t *size)
+{
+	memstream_t *ms = (memstream_t *) stream->arg;
+
+	*size = ms->size;
+	return EOK;
+}
+
+/** Close memory stream. */
+static void stdio_mem_close(FILE *stream)
+{
+	memstream_t *ms = (memstream_t *) stream->arg;
+
+	if (ms->dynamic)
+		(void) stdio_mem_flush(stream);
+
+	if (ms->own_buf)
+		free(ms->buf);
+
+	free(ms);
+}
+
+/** Open a stream backed by a memory buffer.
+ *
+ * @param buf  Buffer or NULL to allocate one which is freed by fclose().
+ * @param size Size of the buffer.
+ * @param mode Mode string, (r|w|a)[b][+].
+ *
+ * @return New stream or NULL on error (errno is set).
+ */
+FILE *fmemopen(void *buf, size_t size, const char *mode)
+{
+	if (size == 0 || (mode[0] != 'r' && mode[0] != 'w' &&
+	    mode[0] != 'a')) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	memstream_t *ms = calloc(1, sizeof(memstream_t));
+	if (ms == NULL) {
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	bool plus = (str_chr(mode, '+') != NULL);
+
+	ms->read = (mode[0] == 'r') || plus;
+	ms->write = (mode[0] != 'r') || plus;
+	ms->append = (mode[0] == 'a');
+	ms->capacity = size;
+
+	if (buf == NULL) {
+		buf = calloc(1, size);
+		if (buf == NULL) {
+			free(ms);
+			errno = ENOMEM;
+			return NULL;
+		}
+
+		ms->own_buf = true;
+	}
+
+	ms->buf = buf;
+
+	switch (mode[0]) {
+	case 'r':
+		ms->size = size;
+		break;
+	case 'w':
+		ms->size = 0;
+		ms->buf[0] = '\0';
+		break;
+	case 'a':
+		ms->size = str_nsize(ms->buf, size);
+		break;
+	}
+
+	FILE *stream = __stdio_open(&stdio_mem_ops, ms);
+	if (stream == NULL) {
+		if (ms->own_buf)
+			free(ms->buf);
+		free(ms);
+		return NULL;
+	}
+
+	stream->pos = ms->append ? ms->size : 0;
+	return stream;
+}
+
+/** Open a stream writing to a dynamically growing buffer.
+ *
+ * After each fflush() and on fclose(), @a *ptr points to the buffer
+ * and @a *sizeloc holds the size of the data written. The data are
+ * always null-terminated. The caller frees the buffer after closing
+ * the stream.
+ *
+ * @param ptr     Place to store the buffer pointer.
+ * @param sizeloc Place to store the data size.
+ *
+ * @return New stream or NULL on error (errno is set).
+ */
+FILE *open_memstream(char **ptr, size_t *sizeloc)
+{
+	if (ptr == NULL || sizeloc == NULL) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	memstream_t *ms = calloc(1, sizeof(memstream_t));
+	if (ms == NULL) {
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	ms->buf = malloc(BUFSIZ + 1);
+	if (ms->buf == NULL) {
+		free(ms);
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	ms->buf[0] = '\0';
+	ms->capacity = BUFSIZ;
+	ms->write = true;
+	ms->dynamic = true;
+	ms->pbuf = ptr;
+	ms->psize = sizeloc;
+
+	*ptr = ms->buf;
+	*sizeloc = 0;
+
+	FILE *stream = __stdio_open(&stdio_mem_ops, ms);
+	if (stream == NULL) {
+		free(ms->buf);
+		free(ms);
+		return NULL;
+	}
+
+	return stream;
+}
+
+/** @}
+ */
@@ -65,6 +65,73 @@
 /** Number of data bits in a UTF-8 continuation byte */
 #define CONT_BITS  6
 
+/** Machine word used for scanning strings word at a time
+ *
+ * Aligned word reads never cross a page boundary, so reading the whole
+ * word that contains the NULL-terminator is safe.
+ */
+typedef unsigned long __attribute__((may_alias)) str_word_t;
+
+/** Word with all bytes set to 0x01 */
+#define WORD_ONES  (~((str_word_t) 0) / 0xff)
+
+/** Word with all bytes set to 0x80 */
+#define WORD_HIGHS  (WORD_ONES * 0x80)
+
+/** Non-zero iff some byte of the word is zero */
+#define WORD_HAS_ZERO(w)  (((w) - WORD_ONES) & ~(w) & WORD_HIGHS)
+
+/** Non-zero iff some byte of the word is not plain ASCII */
+#define WORD_HAS_HIGH(w)  ((w) & WORD_HIGHS)
+
+#define WORD_ALIGNED(ptr)  (((uintptr_t) (ptr) & (sizeof(str_word_t) - 1)) == 0)
+
+/** Get the length of the common plain ASCII prefix of two strings.
+ *
+ * The prefix ends at a character boundary in both strings, so
+ * decoding can continue at the returned offset. It does not include
+ * the NULL-terminator.
+ *
+ * @param s1 First string.
+ * @param s2 Second string.
+ *
+ * @return Length of the common prefix in bytes (and characters).
+ *
+ */
+static size_t str_ascii_prefix(const char *s1, const char *s2)
+{
+	size_t off = 0;
+
+	if (((uintptr_t) s1 & (sizeof(str_word_t) - 1)) ==
+	    ((uintptr_t) s2 & (sizeof(str_word_t) - 1))) {
+		while (!WORD_ALIGNED(s1 + off)) {
+			uint8_t b = (uint8_t) s1[off];
+			if (b == 0 || b >= 0x80 || b != (uint8_t) s2[off])
+				return off;
+
+			off++;
+		}
+
+		while (true) {
+			str_word_t w1 = *((const str_word_t *) (s1 + off));
+			str_word_t w2 = *((const str_word_t *) (s2 + off));
+
+			if (w1 != w2 || WORD_HAS_ZERO(w1) || WORD_HAS_HIGH(w1))
+				break;
+
+			off += sizeof(str_word_t);
+		}
+	}
+
+	while (true) {
+		uint8_t b = (uint8_t) s1[off];
+		if (b == 0 || b >= 0x80 || b != (uint8_t) s2[off])
+			return off;
+
+		off++;
+	}
+}
+
 /** Decode a single character from a string.
  *
  * Decode a single character from a string of size @a size. Decoding starts
@@ -88,6 +155,10 @@ wchar_t str_decode(const char *str, size_t *offset, size_t size)
 	/* First byte read from string */
 	uint8_t b0 = (uint8_t) str[(*offset)++];
 
+	/* Plain ASCII is by far the most common case */
+	if ((b0 & 0x80) == 0)
+		return b0;
+
 	/* Determine code length */
 
 	unsigned int b0_bits;  /* Data bits in first byte */
@@ -261,12 +332,24 @@ errno_t chr_encode(const wchar_t ch, char *str, size_t *offset, size_t size)
  */
 size_t str_size(const char *str)
 {
-	size_t size = 0;
+	const char *ptr = str;
 
-	while (*str++ != 0)
-		size++;
+	while (!WORD_ALIGNED(ptr)) {
+		if (*ptr == 0)
+			return ptr - str;
 
-	return size;
+		ptr++;
+	}
+
+	const str_word_t *word = (const str_word_t *) ptr;
+	while (!WORD_HAS_ZERO(*word))
+		word++;
+
+	ptr = (const char *) word;
+	while (*ptr != 0)
+		ptr++;
+
+	return ptr - str;
 }
 
 /** Get size of wide string.
@@ -519,8 +602,8 @@ int str_cmp(const char *s1, const char *s2)
 	wchar_t c1 = 0;
 	wchar_t c2 = 0;
 
-	size_t off1 = 0;
-	size_t off2 = 0;
+	size_t off1 = str_ascii_prefix(s1, s2);
+	size_t off2 = off1;
 
 	while (true) {
 		c1 = str_decode(s1, &off1, STR_NO_LIMIT);
@@ -566,10 +649,14 @@ int str_lcmp(const char *s1, const char *s2, size_t max_len)
 	wchar_t c1 = 0;
 	wchar_t c2 = 0;
 
-	size_t off1 = 0;
-	size_t off2 = 0;
+	/* The common ASCII prefix has as many characters as bytes */
+	size_t off1 = str_ascii_prefix(s1, s2);
+	if (off1 > max_len)
+		off1 = max_len;
 
-	size_t len = 0;
+	size_t off2 = off1;
+
+	size_t len = off1;
 
 	while (true) {
 		if (len >= max_len)
@@ -1127,7 +1214,36 @@ char *str_chr(const char *str, wchar_t ch)
 {
 	wchar_t acc;
 	size_t off = 0;
-	size_t last = 0;
+
+	if (ch > 0 && ch < 0x80) {
+		/*
+		 * Skip plain ASCII characters other than @a ch word at a
+		 * time. Anything else is left to the decoding loop below.
+		 */
+		while (!WORD_ALIGNED(str + off)) {
+			uint8_t b = (uint8_t) str[off];
+			if (b == 0 || b >= 0x80 || b == ch)
+				break;
+
+			off++;
+		}
+
+		if (WORD_ALIGNED(str + off)) {
+			str_word_t pattern = WORD_ONES * (str_word_t) ch;
+
+			while (true) {
+				str_word_t word = *((const str_word_t *) (str + off));
+
+				if (WORD_HAS_ZERO(word) || WORD_HAS_HIGH(word) ||
+				    WORD_HAS_ZERO(word ^ pattern))
+					break;
+
+				off += sizeof(str_word_t);
+			}
+		}
+	}
+
+	size_t last = off;
 
 	while ((acc = str_decode(str, &off, STR_NO_LIMIT)) != 0) {
 		if (acc == ch)
@@ -77,6 +77,20 @@ errno_t task_set_name(const char *name)
 	return (errno_t) __SYSCALL2(SYS_TASK_SET_NAME, (sysarg_t) name, str_size(name));
 }
 
+/** Set CPU affinity of the current task.
+ *
+ * The affinity applies to all existing threads of the task and is
+ * inherited by the threads created later.
+ *
+ * @param set Set of allowed CPUs.
+ *
+ * @return EOK on success, EINVAL if the set contains no active CPU.
+ */
+errno_t task_set_affinity(const cpuset_t *set)
+{
+	return (errno_t) __SYSCALL1(SYS_TASK_SET_AFFINITY, (sysarg_t) set);
+}
+
 /** Kill a task.
  *
  * @param task_id ID of task to kill.
@@ -155,56 +169,41 @@ errno_t task_spawnvf(task_id_t *id, task_wait_t *wait, const char *path,
 
 	bool wait_initialized = false;
 
-	/* Get task ID. */
-	task_id_t task_id;
-	errno_t rc = loader_get_task_id(ldr, &task_id);
-	if (rc != EOK)
-		goto error;
-
-	/* Send spawner's current working directory. */
-	rc = loader_set_cwd(ldr);
-	if (rc != EOK)
-		goto error;
-
-	/* Send program binary. */
-	rc = loader_set_program_path(ldr, path);
-	if (rc != EOK)
-		goto error;
-
-	/* Send arguments. */
-	rc = loader_set_args(ldr, args);
-	if (rc != EOK)
-		goto error;
+	/* Collect files */
+	const char *inbox_names[4];
+	int inbox_files[4];
+	size_t inbox_cnt = 0;
 
-	/* Send files */
 	int root = vfs_root();
 	if (root >= 0) {
-		rc = loader_add_inbox(ldr, "root", root);
-		vfs_put(root);
-		if (rc != EOK)
-			goto error;
+		inbox_names[inbox_cnt] = "root";
+		inbox_files[inbox_cnt++] = root;
 	}
 
 	if (fd_stdin >= 0) {
-		rc = loader_add_inbox(ldr, "stdin", fd_stdin);
-		if (rc != EOK)
-			goto error;
+		inbox_names[inbox_cnt] = "stdin";
+		inbox_files[inbox_cnt++] = fd_stdin;
 	}
 
 	if (fd_stdout >= 0) {
-		rc = loader_add_inbox(ldr, "stdout", fd_stdout);
-		if (rc != EOK)
-			goto error;
+		inbox_names[inbox_cnt] = "stdout";
+		inbox_files[inbox_cnt++] = fd_stdout;
 	}
 
 	if (fd_stderr >= 0) {
-		rc = loader_add_inbox(ldr, "stderr", fd_stderr);
-		if (rc != EOK)
-			goto error;
+		inbox_names[inbox_cnt] = "stderr";
+		inbox_files[inbox_cnt++] = fd_stderr;
 	}
 
-	/* Load the program. */
-	rc = loader_load_program(ldr);
+	/*
+	 * Send working directory, program binary, arguments and files
+	 * and load the program.
+	 */
+	task_id_t task_id;
+	errno_t rc = loader_prepare(ldr, path, args, inbox_names, inbox_files,
+	    inbox_cnt, &task_id);
+	if (root >= 0)
+		vfs_put(root);
 	if (rc != EOK)
 		goto error;
 
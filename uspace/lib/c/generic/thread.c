@@ -63,6 +63,7 @@ void __thread_main(uspace_arg_t *uarg)
 		thread_exit(0);
 
 	__tcb_set(fibril->tcb);
+	fibril_runner_enter(fibril);
 
 	uarg->uspace_thread_function(uarg->uspace_thread_arg);
 	/*
@@ -75,6 +76,7 @@ void __thread_main(uspace_arg_t *uarg)
 	/* If there is a manager, destroy it */
 	async_destroy_manager();
 
+	fibril_runner_leave(fibril);
 	fibril_teardown(fibril, false);
 
 	thread_exit(0);
@@ -184,6 +186,22 @@ thread_id_t thread_get_id(void)
 	return thread_id;
 }
 
+/** Set CPU affinity of a thread.
+ *
+ * The thread will only be scheduled on the CPUs from the set.
+ *
+ * @param thread_id ID of a thread of the current task.
+ * @param set       Set of allowed CPUs.
+ *
+ * @return EOK on success, ENOENT if there is no such thread in the
+ *         current task, EINVAL if the set contains no active CPU.
+ */
+errno_t thread_set_affinity(thread_id_t thread_id, const cpuset_t *set)
+{
+	return (errno_t) __SYSCALL2(SYS_THREAD_SET_AFFINITY,
+	    (sysarg_t) &thread_id, (sysarg_t) set);
+}
+
 /** Wait unconditionally for specified number of microseconds
  *
  */
@@ -38,6 +38,7 @@
 #include <time.h>
 #include <stdbool.h>
 #include <libarch/barrier.h>
+#include <libarch/cycle.h>
 #include <macros.h>
 #include <errno.h>
 #include <sysinfo.h>
@@ -57,6 +58,8 @@
 #define MINS_PER_HOUR  60
 #define SECS_PER_MIN   60
 #define USECS_PER_SEC  1000000
+#define NSECS_PER_USEC 1000
+#define NSECS_PER_SEC  1000000000
 #define MINS_PER_DAY   (MINS_PER_HOUR * HOURS_PER_DAY)
 #define SECS_PER_HOUR  (SECS_PER_MIN * MINS_PER_HOUR)
 #define SECS_PER_DAY   (SECS_PER_HOUR * HOURS_PER_DAY)
@@ -66,6 +69,12 @@ struct {
 	volatile sysarg_t seconds1;
 	volatile sysarg_t useconds;
 	volatile sysarg_t seconds2;
+
+	volatile sysarg_t cycle_seq;
+	volatile uint32_t cycle_mult;
+	volatile uint32_t cycle_shift;
+	volatile uint64_t cycles;
+	volatile uint64_t nseconds;
 } *ktime = NULL;
 
 static async_sess_t *clock_conn = NULL;
@@ -628,26 +637,102 @@ fallback:
 	getuptime(tv);
 }
 
-void getuptime(struct timeval *tv)
+/** Map the kernel uptime page if not yet mapped. */
+static errno_t ktime_map(void)
 {
-	if (ktime == NULL) {
-		uintptr_t faddr;
-		errno_t rc = sysinfo_get_value("clock.faddr", &faddr);
-		if (rc != EOK) {
-			errno = rc;
-			goto fallback;
-		}
+	if (ktime != NULL)
+		return EOK;
 
-		void *addr = AS_AREA_ANY;
-		rc = physmem_map(faddr, 1, AS_AREA_READ | AS_AREA_CACHEABLE,
-		    &addr);
-		if (rc != EOK) {
-			as_area_destroy(addr);
-			errno = rc;
-			goto fallback;
-		}
+	uintptr_t faddr;
+	errno_t rc = sysinfo_get_value("clock.faddr", &faddr);
+	if (rc != EOK)
+		return rc;
+
+	void *addr = AS_AREA_ANY;
+	rc = physmem_map(faddr, 1, AS_AREA_READ | AS_AREA_CACHEABLE,
+	    &addr);
+	if (rc != EOK) {
+		as_area_destroy(addr);
+		return rc;
+	}
+
+	ktime = addr;
+	return EOK;
+}
+
+/** Compute the uptime from the cycle counter.
+ *
+ * @param nsec Place to store the uptime in nanoseconds.
+ *
+ * @return True if the kernel published a calibrated cycle counter.
+ *
+ */
+static bool ktime_cycle_uptime(uint64_t *nsec)
+{
+	if (ktime->cycle_mult == 0)
+		return false;
+
+	sysarg_t seq;
+	uint64_t base;
+	uint64_t cycles;
+	uint64_t now;
+
+	do {
+		seq = ktime->cycle_seq;
+		read_barrier();
+
+		base = ktime->nseconds;
+		cycles = ktime->cycles;
+		now = get_cycle();
+
+		read_barrier();
+	} while (((seq & 1) != 0) || (seq != ktime->cycle_seq));
+
+	/* The counter of another processor may lag slightly behind */
+	if (now < cycles)
+		now = cycles;
+
+	*nsec = base + (((now - cycles) * ktime->cycle_mult) >>
+	    ktime->cycle_shift);
+	return true;
+}
+
+/** Get the uptime in nanoseconds.
+ *
+ * The resolution is given by the cycle counter if the kernel published
+ * its calibration, otherwise by the kernel clock tick. No system call
+ * is needed in either case once the uptime page has been mapped.
+ *
+ * @return Nanoseconds since the kernel clock was initialized.
+ *
+ */
+uint64_t getuptime_nsec(void)
+{
+	uint64_t nsec;
+
+	if (ktime_map() == EOK && ktime_cycle_uptime(&nsec))
+		return nsec;
+
+	struct timeval tv;
+	getuptime(&tv);
+
+	return (uint64_t) tv.tv_sec * NSECS_PER_SEC +
+	    (uint64_t) tv.tv_usec * NSECS_PER_USEC;
+}
+
+void getuptime(struct timeval *tv)
+{
+	errno_t rc = ktime_map();
+	if (rc != EOK) {
+		errno = rc;
+		goto fallback;
+	}
 
-		ktime = addr;
+	uint64_t nsec;
+	if (ktime_cycle_uptime(&nsec)) {
+		tv->tv_sec = nsec / NSECS_PER_SEC;
+		tv->tv_usec = (nsec % NSECS_PER_SEC) / NSECS_PER_USEC;
+		return;
 	}
 
 	sysarg_t s2 = ktime->seconds2;
@@ -56,6 +56,75 @@ errno_t udebug_set_evmask(async_sess_t *sess, udebug_evmask_t mask)
 	return async_req_2_0(exch, IPC_M_DEBUG, UDEBUG_M_SET_EVMASK, mask);
 }
 
+/** Set the syscall event filter.
+ *
+ * @param sess   Debugging session.
+ * @param filter Filter or NULL to let all syscall events pass.
+ *
+ * @return EOK on success or an error code.
+ */
+errno_t udebug_set_filter(async_sess_t *sess, const udebug_filter_t *filter)
+{
+	async_exch_t *exch = async_exchange_begin(sess);
+	return async_req_2_0(exch, IPC_M_DEBUG, UDEBUG_M_SET_FILTER,
+	    (sysarg_t) filter);
+}
+
+/** Switch the debugged task to the log mode.
+ *
+ * @param sess     Debugging session.
+ * @param capacity Capacity of the event log in entries.
+ *
+ * @return EOK on success, EBUSY if some thread is not stopped
+ *         or an error code.
+ */
+errno_t udebug_log_start(async_sess_t *sess, size_t capacity)
+{
+	async_exch_t *exch = async_exchange_begin(sess);
+	return async_req_2_0(exch, IPC_M_DEBUG, UDEBUG_M_LOG_START, capacity);
+}
+
+/** Switch the debugged task back to the stop mode.
+ *
+ * @param sess Debugging session.
+ *
+ * @return EOK on success or an error code.
+ */
+errno_t udebug_log_stop(async_sess_t *sess)
+{
+	async_exch_t *exch = async_exchange_begin(sess);
+	return async_req_1_0(exch, IPC_M_DEBUG, UDEBUG_M_LOG_STOP);
+}
+
+/** Read and remove entries from the event log.
+ *
+ * Does not block if the log is empty.
+ *
+ * @param sess    Debugging session.
+ * @param entries Buffer for the entries.
+ * @param n       Size of the buffer in entries.
+ * @param copied  Place to store the number of entries read.
+ * @param lost    Place to store the number of events lost to a full log
+ *                since the last read.
+ *
+ * @return EOK on success or an error code.
+ */
+errno_t udebug_log_read(async_sess_t *sess, udebug_log_entry_t *entries,
+    size_t n, size_t *copied, size_t *lost)
+{
+	sysarg_t a_copied, a_lost;
+
+	async_exch_t *exch = async_exchange_begin(sess);
+	errno_t rc = async_req_3_3(exch, IPC_M_DEBUG, UDEBUG_M_LOG_READ,
+	    (sysarg_t) entries, n * sizeof(udebug_log_entry_t), NULL,
+	    &a_copied, &a_lost);
+
+	*copied = (size_t) a_copied / sizeof(udebug_log_entry_t);
+	*lost = (size_t) a_lost;
+
+	return rc;
+}
+
 errno_t udebug_thread_read(async_sess_t *sess, void *buffer, size_t n,
     size_t *copied, size_t *needed)
 {
@@ -278,6 +278,38 @@ errno_t vbd_part_get_info(vbd_t *vbd, vbd_part_id_t part, vbd_part_info_t *pinfo
 	return EOK;
 }
 
+/** Get partition I/O statistics.
+ *
+ * @param vbd Virtual block device service
+ * @param part Partition
+ * @param pstats Place to store the statistics
+ * @return EOK on success or an error code
+ */
+errno_t vbd_part_get_stats(vbd_t *vbd, vbd_part_id_t part,
+    vbd_part_stats_t *pstats)
+{
+	async_exch_t *exch;
+	errno_t retval;
+	ipc_call_t answer;
+
+	exch = async_exchange_begin(vbd->sess);
+	aid_t req = async_send_1(exch, VBD_PART_GET_STATS, part, &answer);
+	errno_t rc = async_data_read_start(exch, pstats,
+	    sizeof(vbd_part_stats_t));
+	async_exchange_end(exch);
+
+	if (rc != EOK) {
+		async_forget(req);
+		return EIO;
+	}
+
+	async_wait_for(req, &retval);
+	if (retval != EOK)
+		return EIO;
+
+	return EOK;
+}
+
 errno_t vbd_part_create(vbd_t *vbd, service_id_t disk, vbd_part_spec_t *pspec,
     vbd_part_id_t *rpart)
 {
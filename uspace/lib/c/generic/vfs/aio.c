@@ -0,0 +1,270 @@
+/*
+ * Copyright (c) 2018 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup libc
+ * @{
+ */
+/** @file Asynchronous file I/O
+ *
+ * Requests are submitted in batches to an I/O context and their
+ * completions are later reaped from it. Each request is carried out by its
+ * own fibril, so that all requests of a context are outstanding at VFS at
+ * the same time. Since the VFS interface uses parallel exchanges, VFS
+ * serves them concurrently as well.
+ */
+
+#include <adt/list.h>
+#include <errno.h>
+#include <fibril.h>
+#include <fibril_synch.h>
+#include <stdlib.h>
+#include <vfs/aio.h>
+#include <vfs/vfs.h>
+
+/** Asynchronous I/O context */
+struct vfs_aio {
+	/** Protects the context */
+	fibril_mutex_t lock;
+	/** Signalled when a request completes */
+	fibril_condvar_t cv;
+	/** Maximum number of outstanding requests */
+	size_t depth;
+	/** Number of requests which were submitted but not reaped */
+	size_t pending;
+	/** Completed requests, vfs_aio_req_t */
+	list_t completed;
+};
+
+/** Asynchronous I/O request in flight */
+typedef struct {
+	/** Link to vfs_aio_t.completed */
+	link_t link;
+	/** Containing context */
+	vfs_aio_t *aio;
+	/** Submitted request */
+	vfs_aio_sqe_t sqe;
+	/** Completion */
+	vfs_aio_cqe_t cqe;
+} vfs_aio_req_t;
+
+/** Create asynchronous I/O context.
+ *
+ * @param depth Maximum number of outstanding requests
+ * @param raio Place to store pointer to the new context
+ *
+ * @return EOK on success, EINVAL if @a depth is zero, ENOMEM if out of
+ *         memory
+ */
+errno_t vfs_aio_create(size_t depth, vfs_aio_t **raio)
+{
+	vfs_aio_t *aio;
+
+	if (depth == 0)
+		return EINVAL;
+
+	aio = calloc(1, sizeof(vfs_aio_t));
+	if (aio == NULL)
+		return ENOMEM;
+
+	fibril_mutex_initialize(&aio->lock);
+	fibril_condvar_initialize(&aio->cv);
+	aio->depth = depth;
+	list_initialize(&aio->completed);
+
+	*raio = aio;
+	return EOK;
+}
+
+/** Destroy asynchronous I/O context.
+ *
+ * Waits for all outstanding requests, their completions are discarded.
+ *
+ * @param aio Context
+ */
+void vfs_aio_destroy(vfs_aio_t *aio)
+{
+	fibril_mutex_lock(&aio->lock);
+	while (aio->pending > 0) {
+		while (list_empty(&aio->completed))
+			fibril_condvar_wait(&aio->cv, &aio->lock);
+
+		vfs_aio_req_t *req = list_get_instance(
+		    list_first(&aio->completed), vfs_aio_req_t, link);
+		list_remove(&req->link);
+		aio->pending--;
+		free(req);
+	}
+	fibril_mutex_unlock(&aio->lock);
+
+	free(aio);
+}
+
+/** Carry out one asynchronous I/O request. */
+static errno_t vfs_aio_fibril(void *arg)
+{
+	vfs_aio_req_t *req = (vfs_aio_req_t *) arg;
+	vfs_aio_t *aio = req->aio;
+	aoff64_t pos = req->sqe.pos;
+
+	req->cqe.arg = req->sqe.arg;
+	req->cqe.nbytes = 0;
+
+	switch (req->sqe.op) {
+	case VFS_AIO_READ:
+		req->cqe.rc = vfs_read(req->sqe.file, &pos, req->sqe.buf,
+		    req->sqe.size, &req->cqe.nbytes);
+		break;
+	case VFS_AIO_WRITE:
+		req->cqe.rc = vfs_write(req->sqe.file, &pos, req->sqe.buf,
+		    req->sqe.size, &req->cqe.nbytes);
+		break;
+	case VFS_AIO_SYNC:
+		req->cqe.rc = vfs_sync(req->sqe.file);
+		break;
+	default:
+		req->cqe.rc = EINVAL;
+		break;
+	}
+
+	fibril_mutex_lock(&aio->lock);
+	list_append(&req->link, &aio->completed);
+	fibril_condvar_broadcast(&aio->cv);
+	fibril_mutex_unlock(&aio->lock);
+
+	return EOK;
+}
+
+/** Submit asynchronous I/O requests.
+ *
+ * Requests are submitted in order until the context is full.
+ *
+ * @param aio Context
+ * @param sqe Requests
+ * @param cnt Number of requests
+ *
+ * @return Number of submitted requests
+ */
+size_t vfs_aio_submit(vfs_aio_t *aio, const vfs_aio_sqe_t *sqe, size_t cnt)
+{
+	size_t i;
+
+	fibril_mutex_lock(&aio->lock);
+
+	for (i = 0; i < cnt && aio->pending < aio->depth; i++) {
+		vfs_aio_req_t *req = malloc(sizeof(vfs_aio_req_t));
+		if (req == NULL)
+			break;
+
+		link_initialize(&req->link);
+		req->aio = aio;
+		req->sqe = sqe[i];
+
+		fid_t fid = fibril_create(vfs_aio_fibril, req);
+		if (fid == 0) {
+			free(req);
+			break;
+		}
+
+		aio->pending++;
+		fibril_add_ready(fid);
+	}
+
+	fibril_mutex_unlock(&aio->lock);
+	return i;
+}
+
+/** Reap completions without waiting.
+ *
+ * Must be called with the context locked.
+ */
+static size_t vfs_aio_reap(vfs_aio_t *aio, vfs_aio_cqe_t *cqe, size_t max)
+{
+	size_t n = 0;
+
+	while (n < max && !list_empty(&aio->completed)) {
+		vfs_aio_req_t *req = list_get_instance(
+		    list_first(&aio->completed), vfs_aio_req_t, link);
+		list_remove(&req->link);
+		aio->pending--;
+		cqe[n++] = req->cqe;
+		free(req);
+	}
+
+	return n;
+}
+
+/** Reap completed asynchronous I/O requests without waiting.
+ *
+ * @param aio Context
+ * @param cqe Array for storing the completions
+ * @param max Size of the array
+ *
+ * @return Number of reaped completions
+ */
+size_t vfs_aio_poll(vfs_aio_t *aio, vfs_aio_cqe_t *cqe, size_t max)
+{
+	fibril_mutex_lock(&aio->lock);
+	size_t n = vfs_aio_reap(aio, cqe, max);
+	fibril_mutex_unlock(&aio->lock);
+
+	return n;
+}
+
+/** Wait for completed asynchronous I/O requests.
+ *
+ * Waits until at least one request completes and reaps all completions
+ * which fit in @a cqe.
+ *
+ * @param aio Context
+ * @param cqe Array for storing the completions
+ * @param max Size of the array, must not be zero
+ * @param rcnt Place to store the number of reaped completions
+ *
+ * @return EOK on success, ENOENT if there are no outstanding requests
+ */
+errno_t vfs_aio_wait(vfs_aio_t *aio, vfs_aio_cqe_t *cqe, size_t max,
+    size_t *rcnt)
+{
+	fibril_mutex_lock(&aio->lock);
+
+	if (aio->pending == 0) {
+		fibril_mutex_unlock(&aio->lock);
+		return ENOENT;
+	}
+
+	while (list_empty(&aio->completed))
+		fibril_condvar_wait(&aio->cv, &aio->lock);
+
+	*rcnt = vfs_aio_reap(aio, cqe, max);
+	fibril_mutex_unlock(&aio->lock);
+
+	return EOK;
+}
+
+/** @}
+ */
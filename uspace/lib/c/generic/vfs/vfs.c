@@ -37,6 +37,7 @@
 #include <vfs/vfs_mtab.h>
 #include <vfs/vfs_sess.h>
 #include <macros.h>
+#include <as.h>
 #include <stdlib.h>
 #include <stddef.h>
 #include <stdint.h>
@@ -311,11 +312,115 @@ errno_t vfs_cwd_set(const char *path)
 	return EOK;
 }
 
-/** Start an async exchange on the VFS session
+/** Open a direct read session to the file system server of a file
  *
- * @return      New exchange
+ * Reads through the direct session go straight to the file system server
+ * without involving VFS, which makes them suitable for streaming reads of
+ * large files. VFS only checks that @a file is a regular file opened for
+ * reading. The reads bypass the VFS page cache.
+ *
+ * @param file          File handle of a regular file opened for reading
+ * @param[out] rdirect  Place to store pointer to the new direct session
+ *
+ * @return              EOK on success or an error code
  */
-async_exch_t *vfs_exchange_begin(void)
+errno_t vfs_direct_open(int file, vfs_direct_t **rdirect)
+{
+	vfs_stat_t stat;
+	errno_t rc;
+
+	rc = vfs_stat(file, &stat);
+	if (rc != EOK)
+		return rc;
+
+	vfs_direct_t *direct = calloc(1, sizeof(vfs_direct_t));
+	if (direct == NULL)
+		return ENOMEM;
+
+	async_exch_t *exch = vfs_exchange_begin();
+	direct->sess = async_connect_me_to_iface(exch, INTERFACE_VFS_DIRECT,
+	    file, 0);
+	vfs_exchange_end(exch);
+
+	if (direct->sess == NULL) {
+		rc = errno;
+		free(direct);
+		return rc;
+	}
+
+	direct->service_id = stat.service_id;
+	direct->index = stat.index;
+
+	*rdirect = direct;
+	return EOK;
+}
+
+/** Close a direct read session
+ *
+ * @param direct        Direct session
+ */
+void vfs_direct_close(vfs_direct_t *direct)
+{
+	async_hangup(direct->sess);
+	free(direct);
+}
+
+/** Read bytes through a direct read session
+ *
+ * Read up to @a nbyte bytes from the file. Performs as many reads as
+ * necessary, stopping only at end of file or on an error.
+ *
+ * @param direct        Direct session
+ * @param[in,out] pos   Position to read from, updated by the number of bytes
+ *                      read
+ * @param buf           Buffer to read into
+ * @param nbyte         Maximum number of bytes to read
+ * @param[out] nread    Actual number of bytes read (0 or more)
+ *
+ * @return              EOK on success or an error code
+ */
+errno_t vfs_direct_read(vfs_direct_t *direct, aoff64_t *pos, void *buf,
+    size_t nbyte, size_t *nread)
+{
+	uint8_t *bp = (uint8_t *) buf;
+	size_t nr = 0;
+	errno_t rc = EOK;
+
+	while (nr < nbyte) {
+		ipc_call_t answer;
+		size_t cnt = min(nbyte - nr, DATA_XFER_LIMIT);
+
+		async_exch_t *exch = async_exchange_begin(direct->sess);
+		aid_t req = async_send_4(exch, VFS_OUT_READ, direct->service_id,
+		    direct->index, LOWER32(*pos), UPPER32(*pos), &answer);
+		rc = async_data_read_start(exch, bp + nr, cnt);
+		async_exchange_end(exch);
+
+		if (rc == EOK)
+			async_wait_for(req, &rc);
+		else
+			async_forget(req);
+
+		if (rc != EOK)
+			break;
+
+		cnt = IPC_GET_ARG1(answer);
+		if (cnt == 0)
+			break;
+
+		nr += cnt;
+		*pos += cnt;
+	}
+
+	*nread = nr;
+	return rc;
+}
+
+/** Get the VFS session, connecting to VFS if necessary
+ *
+ * @return      VFS session
+ */
+static async_sess_t *vfs_session(void)
 {
 	fibril_mutex_lock(&vfs_mutex);
 
@@ -326,7 +431,16 @@ async_exch_t *vfs_exchange_begin(void)
 
 	fibril_mutex_unlock(&vfs_mutex);
 
-	return async_exchange_begin(vfs_sess);
+	return vfs_sess;
+}
+
+/** Start an async exchange on the VFS session
+ *
+ * @return      New exchange
+ */
+async_exch_t *vfs_exchange_begin(void)
+{
+	return async_exchange_begin(vfs_session());
 }
 
 /** Finish an async exchange on the VFS session
@@ -603,6 +717,129 @@ errno_t vfs_lookup_open(const char *path, int flags, int mode, int *handle)
 	return EOK;
 }
 
+/** Lookup a path relative to the local root and read the file
+ *
+ * This function is a convenience combo for vfs_lookup(), vfs_open() and
+ * vfs_read() done in a single request, see vfs_walk_read().
+ *
+ * @param path          Path to be looked up
+ * @param buf           Buffer for the data
+ * @param nbyte         Maximum number of bytes to read
+ * @param[out] nread    Actual number of bytes read
+ * @param[out] size     Size of the file, may be NULL
+ * @param[out] handle   File handle of the file opened for reading or NULL
+ *                      if the file is to be closed
+ *
+ * @return              EOK on success or an error code
+ */
+errno_t vfs_lookup_read(const char *path, void *buf, size_t nbyte,
+    size_t *nread, aoff64_t *size, int *handle)
+{
+	size_t psize;
+	char *p = vfs_absolutize(path, &psize);
+	if (!p)
+		return ENOMEM;
+
+	int root = vfs_root();
+	if (root < 0) {
+		free(p);
+		return ENOENT;
+	}
+
+	errno_t rc = vfs_walk_read(root, p, buf, nbyte, nread, size, handle);
+	vfs_put(root);
+	free(p);
+	return rc;
+}
+
+/** Map a file into the address space
+ *
+ * Create an address space area whose pages are read from the file on
+ * demand. The file handle must stay open as long as the area exists and
+ * its contents must not change, otherwise further page faults in the area
+ * fail.
+ *
+ * Pages of read-only areas are shared with other tasks mapping the same
+ * part of the file and stay resident in VFS, so that mapping frequently
+ * used files, such as executables, is cheap. Writable areas get private
+ * copies of the pages, changes to them never reach the file.
+ *
+ * @param file          File handle opened for reading
+ * @param pos           Page-aligned position in the file where the area
+ *                      starts
+ * @param base          Starting virtual address of the area or AS_AREA_ANY
+ * @param size          Size of the area
+ * @param flags         Flags of the area
+ *
+ * @return              Address of the area on success or AS_MAP_FAILED
+ */
+void *vfs_map(int file, aoff64_t pos, void *base, size_t size,
+    unsigned int flags)
+{
+	if (pos % PAGE_SIZE != 0 || pos != (sysarg_t) pos)
+		return AS_MAP_FAILED;
+
+	return async_as_area_create(base, size, flags, vfs_session(), file,
+	    (sysarg_t) pos, (flags & AS_AREA_WRITE) ? VFS_MAP_WRITE : 0);
+}
+
+/** Map a file into the address space as a shared mapping
+ *
+ * Unlike vfs_map(), pages of the area always show the contents of the file
+ * at the time they are faulted in, even if the file changed after it was
+ * mapped. Changes of a writable area are written back to the file by
+ * vfs_map_sync().
+ *
+ * @param file          File handle opened for reading and also for writing
+ *                      if the area is writable
+ * @param pos           Page-aligned position in the file where the area
+ *                      starts
+ * @param base          Starting virtual address of the area or AS_AREA_ANY
+ * @param size          Size of the area
+ * @param flags         Flags of the area
+ *
+ * @return              Address of the area on success or AS_MAP_FAILED
+ */
+void *vfs_map_shared(int file, aoff64_t pos, void *base, size_t size,
+    unsigned int flags)
+{
+	if (pos % PAGE_SIZE != 0 || pos != (sysarg_t) pos)
+		return AS_MAP_FAILED;
+
+	return async_as_area_create(base, size, flags, vfs_session(), file,
+	    (sysarg_t) pos, VFS_MAP_SHARED |
+	    ((flags & AS_AREA_WRITE) ? VFS_MAP_WRITE : 0));
+}
+
+/** Write changes of a shared file mapping back to the file
+ *
+ * The part of the range that lies beyond the end of the file is not
+ * written, so the file never grows.
+ *
+ * @param file          File handle the area was mapped with
+ * @param pos           Position in the file corresponding to @a addr
+ * @param addr          Start of the range in the area to write back
+ * @param size          Size of the range
+ *
+ * @return              EOK on success or an error code
+ */
+errno_t vfs_map_sync(int file, aoff64_t pos, const void *addr, size_t size)
+{
+	vfs_stat_t st;
+	errno_t rc = vfs_stat(file, &st);
+	if (rc != EOK)
+		return rc;
+
+	if (pos >= st.size)
+		return EOK;
+
+	if (st.size - pos < size)
+		size = st.size - pos;
+
+	size_t nwritten;
+	return vfs_write(file, &pos, addr, size, &nwritten);
+}
+
 /** Mount a file system
  *
  * @param[in] mp                File handle representing the mount-point
@@ -762,6 +999,36 @@ errno_t vfs_open(int file, int mode)
 	return rc;
 }
 
+/** Create a pipe
+ *
+ * The two file handles are already open, the first one for reading and the
+ * second one for writing. Reads block until data are written to the pipe
+ * and return zero bytes once all handles of the write end, including those
+ * passed to other tasks, are put. Writes block while the pipe is full and
+ * fail with EPIPE once there is no handle of the read end.
+ *
+ * @param[out] rfile  Place to store the file handle of the read end
+ * @param[out] wfile  Place to store the file handle of the write end
+ *
+ * @return      EOK on success or an error code
+ */
+errno_t vfs_pipe(int *rfile, int *wfile)
+{
+	sysarg_t rfd;
+	sysarg_t wfd;
+
+	async_exch_t *exch = vfs_exchange_begin();
+	errno_t rc = async_req_0_2(exch, VFS_IN_PIPE, &rfd, &wfd);
+	vfs_exchange_end(exch);
+
+	if (rc != EOK)
+		return rc;
+
+	*rfile = (int) rfd;
+	*wfile = (int) wfd;
+	return EOK;
+}
+
 /** Pass a file handle to another VFS client
  *
  * @param vfs_exch      Donor's VFS exchange
@@ -908,6 +1175,52 @@ errno_t vfs_read_short(int file, aoff64_t pos, void *buf, size_t nbyte,
 	return EOK;
 }
 
+/** Read a batch of directory entries together with their attributes
+ *
+ * Fills the buffer with as many vfs_dirent_t records as fit in it. Reading
+ * continues from the position stored in the @c next field of the last
+ * record returned.
+ *
+ * @param file          Handle of an open directory
+ * @param pos           Directory position to start reading from
+ * @param buf           Buffer for the directory entries
+ * @param size          Size of the buffer
+ * @param[out] nread    Number of bytes filled in the buffer, zero when
+ *                      there are no more entries
+ *
+ * @return              EOK on success, ENOTSUP if the file system does not
+ *                      support batched reading, or another error code
+ */
+errno_t vfs_readdir(int file, aoff64_t pos, void *buf, size_t size,
+    size_t *nread)
+{
+	errno_t rc;
+	ipc_call_t answer;
+	aid_t req;
+
+	if (size > DATA_XFER_LIMIT)
+		size = DATA_XFER_LIMIT;
+
+	async_exch_t *exch = vfs_exchange_begin();
+
+	req = async_send_3(exch, VFS_IN_READDIR, file, LOWER32(pos),
+	    UPPER32(pos), &answer);
+	rc = async_data_read_start(exch, buf, size);
+
+	vfs_exchange_end(exch);
+
+	if (rc == EOK)
+		async_wait_for(req, &rc);
+	else
+		async_forget(req);
+
+	if (rc != EOK)
+		return rc;
+
+	*nread = IPC_GET_ARG1(answer);
+	return EOK;
+}
+
 /** Rename a file or directory
  *
  * There is no file-handle-based variant to disallow attempts to introduce loops
@@ -1271,8 +1584,18 @@ errno_t vfs_walk(int parent, const char *path, int flags, int *handle)
 	async_exch_t *exch = vfs_exchange_begin();
 
 	ipc_call_t answer;
-	aid_t req = async_send_2(exch, VFS_IN_WALK, parent, flags, &answer);
-	errno_t rc = async_data_write_start(exch, path, str_size(path));
+	aid_t req;
+	errno_t rc = EOK;
+	size_t size = str_size(path);
+
+	/* Short paths travel inline with the request. */
+	if (size > 0 && size <= IPC_PAYLOAD_MAX) {
+		req = async_send_payload(exch, VFS_IN_WALK, parent, flags, 0, 0,
+		    path, size, &answer);
+	} else {
+		req = async_send_2(exch, VFS_IN_WALK, parent, flags, &answer);
+		rc = async_data_write_start(exch, path, size);
+	}
 	vfs_exchange_end(exch);
 
 	errno_t rc_orig;
@@ -1288,6 +1611,72 @@ errno_t vfs_walk(int parent, const char *path, int flags, int *handle)
 	return EOK;
 }
 
+/** Walk a path to a regular file and read its beginning
+ *
+ * Walks the path, opens the file for reading and reads up to @a nbyte bytes
+ * from its beginning in a single request, which is cheaper than separate
+ * vfs_walk(), vfs_open() and vfs_read() calls for small files. If the file
+ * is larger than @a nbyte, the returned size tells how much is left.
+ *
+ * @param parent        File handle of the parent node where the walk starts
+ * @param path          Parent-relative path to be walked
+ * @param buf           Buffer for the data
+ * @param nbyte         Maximum number of bytes to read
+ * @param[out] nread    Actual number of bytes read
+ * @param[out] size     Size of the file, may be NULL
+ * @param[out] handle   File handle of the file opened for reading or NULL
+ *                      if the file is to be closed
+ *
+ * @return              EOK on success or an error code
+ */
+errno_t vfs_walk_read(int parent, const char *path, void *buf, size_t nbyte,
+    size_t *nread, aoff64_t *size, int *handle)
+{
+	if (nbyte > DATA_XFER_LIMIT)
+		nbyte = DATA_XFER_LIMIT;
+
+	async_exch_t *exch = vfs_exchange_begin();
+
+	ipc_call_t answer;
+	aid_t req;
+	errno_t rc = EOK;
+	size_t psize = str_size(path);
+
+	if (psize > 0 && psize <= IPC_PAYLOAD_MAX) {
+		req = async_send_payload(exch, VFS_IN_WALK_READ, parent,
+		    handle != NULL, 0, 0, path, psize, &answer);
+	} else {
+		req = async_send_2(exch, VFS_IN_WALK_READ, parent,
+		    handle != NULL, &answer);
+		rc = async_data_write_start(exch, path, psize);
+	}
+	if (rc == EOK)
+		rc = async_data_read_start(exch, buf, nbyte);
+	vfs_exchange_end(exch);
+
+	errno_t rc_orig;
+	async_wait_for(req, &rc_orig);
+
+	if (rc_orig != EOK)
+		return (errno_t) rc_orig;
+
+	if (rc != EOK) {
+		/* The request itself succeeded, do not leak the handle. */
+		if (handle != NULL)
+			vfs_put((int) IPC_GET_ARG1(answer));
+		return (errno_t) rc;
+	}
+
+	*nread = IPC_GET_ARG2(answer);
+	if (size != NULL) {
+		*size = MERGE_LOUP32(IPC_GET_ARG3(answer),
+		    IPC_GET_ARG4(answer));
+	}
+	if (handle != NULL)
+		*handle = (int) IPC_GET_ARG1(answer);
+	return EOK;
+}
+
 /** Write data
  *
  * This function fails if it cannot write exactly @a len bytes to the file.
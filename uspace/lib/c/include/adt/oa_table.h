@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup libc
+ * @{
+ */
+/** @file
+ */
+
+#ifndef LIBC_OA_TABLE_H_
+#define LIBC_OA_TABLE_H_
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/** Set of operations for open addressing hash table. */
+typedef struct {
+	/** Returns the hash of the key stored in the item (ie its lookup key). */
+	size_t (*hash)(const void *item);
+
+	/** Returns the hash of the key. */
+	size_t (*key_hash)(const void *key);
+
+	/** True if the items are equal (have the same lookup keys). */
+	bool (*equal)(const void *item1, const void *item2);
+
+	/** Returns true if the key is equal to the item's lookup key. */
+	bool (*key_equal)(const void *key, const void *item);
+
+	/** Hash table item removal callback.
+	 *
+	 * Must not invoke any mutating functions of the hash table.
+	 *
+	 * @param item Item that was removed from the hash table.
+	 */
+	void (*remove_callback)(void *item);
+} oa_table_ops_t;
+
+/** Open addressing hash table slot. */
+typedef struct {
+	/** Hash of the item's key */
+	size_t hash;
+	/** Item or NULL if the slot is empty */
+	void *item;
+} oa_slot_t;
+
+/** Open addressing hash table structure. */
+typedef struct {
+	oa_table_ops_t *op;
+	oa_slot_t *slot;
+	size_t slot_cnt;
+	size_t item_cnt;
+
+	/** Table being migrated to @c slot or NULL */
+	oa_slot_t *old_slot;
+	size_t old_slot_cnt;
+	/** Index of the next slot of @c old_slot to migrate */
+	size_t old_pos;
+} oa_table_t;
+
+extern bool oa_table_create(oa_table_t *, size_t, oa_table_ops_t *);
+extern void oa_table_destroy(oa_table_t *);
+
+extern bool oa_table_empty(oa_table_t *);
+extern size_t oa_table_size(oa_table_t *);
+
+extern void oa_table_clear(oa_table_t *);
+extern errno_t oa_table_insert(oa_table_t *, void *);
+extern errno_t oa_table_insert_unique(oa_table_t *, void *);
+extern void *oa_table_find(const oa_table_t *, const void *);
+extern bool oa_table_remove(oa_table_t *, const void *);
+extern void oa_table_remove_item(oa_table_t *, void *);
+extern void oa_table_apply(oa_table_t *, bool (*)(void *, void *), void *);
+
+#endif
+
+/** @}
+ */
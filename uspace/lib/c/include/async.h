@@ -109,6 +109,20 @@ struct async_sess;
 typedef struct async_sess async_sess_t;
 typedef struct async_exch async_exch_t;
 
+/** Session exchange statistics */
+typedef struct {
+	/** Number of exchanges begun */
+	size_t exch_begun;
+	/** Number of exchanges which had to wait for a phone */
+	size_t exch_waited;
+	/** Total time spent waiting for a phone (in microseconds) */
+	uint64_t wait_usec;
+	/** Number of phones cloned for parallel exchanges */
+	size_t phones_opened;
+	/** Number of idle phones hung up for other sessions */
+	size_t phones_reclaimed;
+} async_sess_stats_t;
+
 extern __noreturn void async_manager(void);
 
 #define async_get_call(data) \
@@ -140,6 +154,8 @@ extern aid_t async_send_fast(async_exch_t *, sysarg_t, sysarg_t, sysarg_t,
     sysarg_t, sysarg_t, ipc_call_t *);
 extern aid_t async_send_slow(async_exch_t *, sysarg_t, sysarg_t, sysarg_t,
     sysarg_t, sysarg_t, sysarg_t, ipc_call_t *);
+extern aid_t async_send_payload(async_exch_t *, sysarg_t, sysarg_t, sysarg_t,
+    sysarg_t, sysarg_t, const void *, size_t, ipc_call_t *);
 
 extern void async_wait_for(aid_t, errno_t *);
 extern errno_t async_wait_timeout(aid_t, errno_t *, suseconds_t);
@@ -150,9 +166,11 @@ extern void async_sleep(unsigned int);
 
 extern void async_create_manager(void);
 extern void async_destroy_manager(void);
+extern errno_t async_create_manager_threads(size_t);
 
 extern void async_set_client_data_constructor(async_client_data_ctor_t);
 extern void async_set_client_data_destructor(async_client_data_dtor_t);
+extern void async_set_connection_stack_size(size_t);
 extern void *async_get_client_data(void);
 extern void *async_get_client_data_by_id(task_id_t);
 extern void async_put_client_data_by_id(task_id_t);
@@ -166,6 +184,8 @@ extern errno_t async_create_callback_port(async_exch_t *, iface_t, sysarg_t,
 extern errno_t async_irq_subscribe(int, async_notification_handler_t, void *,
     const irq_code_t *, cap_irq_handle_t *);
 extern errno_t async_irq_unsubscribe(cap_irq_handle_t);
+extern errno_t async_irq_coalesce(cap_irq_handle_t, useconds_t);
+extern errno_t async_irq_set_affinity(cap_irq_handle_t, unsigned int);
 
 extern errno_t async_event_subscribe(event_type_t, async_notification_handler_t,
     void *);
@@ -358,6 +378,9 @@ extern void async_poke(void);
 extern async_exch_t *async_exchange_begin(async_sess_t *);
 extern void async_exchange_end(async_exch_t *);
 
+extern void async_sess_pool_set(async_sess_t *, size_t, size_t);
+extern void async_sess_stats(async_sess_t *, async_sess_stats_t *);
+
 /*
  * FIXME These functions just work around problems with parallel exchange
  * management. Proper solution needs to be implemented.
@@ -467,6 +490,8 @@ extern errno_t async_data_write_finalize(cap_call_handle_t, void *, size_t);
 
 extern errno_t async_data_write_accept(void **, const bool, const size_t,
     const size_t, const size_t, size_t *);
+extern errno_t async_payload_accept(ipc_call_t *, void **, const bool,
+    const size_t, const size_t, size_t *);
 extern void async_data_write_void(errno_t);
 
 extern errno_t async_data_write_forward_fast(async_exch_t *, sysarg_t, sysarg_t,
@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2018 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup libc
+ * @{
+ */
+/** @file
+ * @brief Shared memory ring buffer channel.
+ */
+
+#ifndef LIBC_ASYNC_RING_H_
+#define LIBC_ASYNC_RING_H_
+
+#include <async.h>
+#include <errno.h>
+#include <stddef.h>
+
+/** Single-producer/single-consumer ring shared between two tasks */
+typedef struct async_ring async_ring_t;
+
+extern errno_t async_ring_create(async_exch_t *, size_t, async_ring_t **);
+extern errno_t async_ring_accept(async_ring_t **);
+extern void async_ring_close(async_ring_t *);
+extern void async_ring_destroy(async_ring_t *);
+
+extern size_t async_ring_space(async_ring_t *);
+
+extern size_t async_ring_try_write(async_ring_t *, const void *, size_t);
+extern size_t async_ring_try_read(async_ring_t *, void *, size_t);
+extern errno_t async_ring_write(async_ring_t *, const void *, size_t);
+extern errno_t async_ring_read(async_ring_t *, void *, size_t, size_t *);
+
+#endif
+
+/** @}
+ */
@@ -36,6 +36,7 @@
 #define LIBC_BD_H_
 
 #include <async.h>
+#include <ipc/bd.h>
 #include <offset.h>
 
 typedef struct {
@@ -45,9 +46,14 @@ typedef struct {
 extern errno_t bd_open(async_sess_t *, bd_t **);
 extern void bd_close(bd_t *);
 extern errno_t bd_read_blocks(bd_t *, aoff64_t, size_t, void *, size_t);
+extern errno_t bd_read_blocks_v(bd_t *, const bd_extent_t *, size_t, void *,
+    size_t);
 extern errno_t bd_read_toc(bd_t *, uint8_t, void *, size_t);
 extern errno_t bd_write_blocks(bd_t *, aoff64_t, size_t, const void *, size_t);
+extern errno_t bd_write_blocks_v(bd_t *, const bd_extent_t *, size_t,
+    const void *, size_t);
 extern errno_t bd_sync_cache(bd_t *, aoff64_t, size_t);
+extern errno_t bd_discard_blocks(bd_t *, const bd_extent_t *, size_t);
 extern errno_t bd_get_block_size(bd_t *, size_t *);
 extern errno_t bd_get_num_blocks(bd_t *, aoff64_t *);
 
@@ -38,6 +38,7 @@
 #include <adt/list.h>
 #include <async.h>
 #include <fibril_synch.h>
+#include <ipc/bd.h>
 #include <stdbool.h>
 #include <offset.h>
 
@@ -65,6 +66,25 @@ struct bd_ops {
 	errno_t (*write_blocks)(bd_srv_t *, aoff64_t, size_t, const void *, size_t);
 	errno_t (*get_block_size)(bd_srv_t *, size_t *);
 	errno_t (*get_num_blocks)(bd_srv_t *, aoff64_t *);
+
+	/** Map blocks for a transfer without an intermediate buffer.
+	 *
+	 * Optional. Returns a pointer to the device's own storage of the
+	 * blocks and its size, for reading or writing. The pointer stays
+	 * valid until @c unmap_blocks is called. If this returns ENOTSUP,
+	 * @c read_blocks or @c write_blocks is used instead.
+	 */
+	errno_t (*map_blocks)(bd_srv_t *, aoff64_t, size_t, bool, void **,
+	    size_t *);
+	void (*unmap_blocks)(bd_srv_t *, bool);
+
+	/** Discard blocks which no longer hold useful data.
+	 *
+	 * Optional. The extents are within the device, their offsets
+	 * are meaningless. The contents of discarded blocks are undefined
+	 * until they are written again.
+	 */
+	errno_t (*discard_blocks)(bd_srv_t *, const bd_extent_t *, size_t);
 };
 
 extern void bd_srvs_init(bd_srvs_t *);
@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2018 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup libc
+ * @{
+ */
+/** @file
+ * @brief CPU sets.
+ */
+
+#ifndef LIBC_CPUSET_H_
+#define LIBC_CPUSET_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <abi/proc/thread.h>
+
+/** Remove all CPUs from a CPU set.
+ *
+ * @param set CPU set.
+ */
+static inline void cpuset_clear(cpuset_t *set)
+{
+	for (unsigned int i = 0; i < CPUSET_MAX_CPUS / 32; i++)
+		set->mask[i] = 0;
+}
+
+/** Add a CPU to a CPU set.
+ *
+ * @param set CPU set.
+ * @param cpu_id CPU ID (smaller than CPUSET_MAX_CPUS).
+ */
+static inline void cpuset_add(cpuset_t *set, unsigned int cpu_id)
+{
+	set->mask[cpu_id / 32] |= UINT32_C(1) << (cpu_id % 32);
+}
+
+/** Remove a CPU from a CPU set.
+ *
+ * @param set CPU set.
+ * @param cpu_id CPU ID (smaller than CPUSET_MAX_CPUS).
+ */
+static inline void cpuset_remove(cpuset_t *set, unsigned int cpu_id)
+{
+	set->mask[cpu_id / 32] &= ~(UINT32_C(1) << (cpu_id % 32));
+}
+
+/** Determine whether a CPU set contains a CPU.
+ *
+ * @param set CPU set.
+ * @param cpu_id CPU ID (smaller than CPUSET_MAX_CPUS).
+ *
+ * @return True iff the CPU is a member of the set.
+ */
+static inline bool cpuset_contains(const cpuset_t *set, unsigned int cpu_id)
+{
+	return (set->mask[cpu_id / 32] & (UINT32_C(1) << (cpu_id % 32))) != 0;
+}
+
+#endif
+
+/** @}
+ */
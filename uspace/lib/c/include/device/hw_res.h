@@ -55,6 +55,9 @@ typedef enum {
 	HW_RES_CLEAR_INTERRUPT,
 	HW_RES_DMA_CHANNEL_SETUP,
 	HW_RES_DMA_CHANNEL_REMAIN,
+	HW_RES_ALLOC_MSI,
+	HW_RES_FREE_MSI,
+	HW_RES_SET_INTERRUPT_AFFINITY,
 } hw_res_method_t;
 
 /** HW resource types */
@@ -124,6 +127,11 @@ extern errno_t hw_res_dma_channel_setup(async_sess_t *, unsigned int, uint32_t,
     uint32_t, uint8_t);
 extern errno_t hw_res_dma_channel_remain(async_sess_t *, unsigned, size_t *);
 
+extern errno_t hw_res_alloc_msi(async_sess_t *, size_t, size_t *);
+extern errno_t hw_res_free_msi(async_sess_t *);
+extern errno_t hw_res_set_interrupt_affinity(async_sess_t *, int,
+    unsigned int);
+
 #endif
 
 /** @}
@@ -38,19 +38,31 @@
 #define NAME_MAX  256
 
 #include <offset.h>
+#include <stdbool.h>
+#include <stddef.h>
 
 struct dirent {
 	char d_name[NAME_MAX + 1];
 };
 
+struct vfs_stat;
+
 typedef struct {
 	int fd;
 	struct dirent res;
 	aoff64_t pos;
+
+	/** Batch of entries read ahead by vfs_readdir(). */
+	void *buf;
+	size_t buf_len;
+	size_t buf_off;
+	/** The file system cannot read entries in batches. */
+	bool no_batch;
 } DIR;
 
 extern DIR *opendir(const char *);
 extern struct dirent *readdir(DIR *);
+extern struct dirent *readdir_stat(DIR *, struct vfs_stat *);
 extern void rewinddir(DIR *);
 extern int closedir(DIR *);
 
@@ -38,6 +38,7 @@
 #define ELF_MOD_H_
 
 #include <elf/elf.h>
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <loader/pcb.h>
@@ -105,6 +106,12 @@ typedef struct {
 	/** Flags passed to the ELF loader. */
 	eld_flags_t flags;
 
+	/** Read-only segments may be mapped from the file. */
+	bool map;
+
+	/** Some segments have been mapped from the file. */
+	bool mapped;
+
 	/** Store extracted info here */
 	elf_finfo_t *info;
 } elf_ld_t;
@@ -26,16 +26,17 @@
  * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
-/** @addtogroup debug
+/** @addtogroup generic
  * @{
  */
 /** @file
  */
 
-#ifndef SYMTAB_H_
-#define SYMTAB_H_
+#ifndef LIBC_ELF_SYMTAB_H_
+#define LIBC_ELF_SYMTAB_H_
 
 #include <elf/elf.h>
+#include <errno.h>
 #include <stddef.h>
 
 typedef struct {
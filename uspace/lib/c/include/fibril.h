@@ -50,11 +50,22 @@ typedef sysarg_t fid_t;
 
 #define FIBRIL_DFLT_STK_SIZE	0
 
+/** Fibril stack statistics. */
+typedef struct {
+	/** Largest stack usage observed in a finished fibril. */
+	size_t stack_hwm;
+	/** Number of stacks taken from a stack cache. */
+	size_t stack_reused;
+	/** Number of stacks freshly allocated. */
+	size_t stack_allocated;
+} fibril_stack_stats_t;
+
 extern fid_t fibril_create_generic(errno_t (*func)(void *), void *arg, size_t);
 extern void fibril_destroy(fid_t fid);
 extern void fibril_add_ready(fid_t fid);
 extern fid_t fibril_get_id(void);
 extern void fibril_yield(void);
+extern void fibril_stack_stats(fibril_stack_stats_t *);
 
 static inline fid_t fibril_create(errno_t (*func)(void *), void *arg)
 {
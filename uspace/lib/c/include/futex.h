@@ -40,19 +40,32 @@
 #include <errno.h>
 #include <libc.h>
 #include <time.h>
+#include <abi/synch.h>
 
 typedef struct futex {
 	atomic_t val;
 #ifdef CONFIG_DEBUG_FUTEX
 	void *owner;
 #endif
+	/** FUTEX_PRIVATE unless the futex lives in memory shared by tasks. */
+	sysarg_t flags;
+	/** Thread ID of the holder of a FUTEX_PI futex or zero. */
+	sysarg_t holder;
 } futex_t;
 
 extern void futex_initialize(futex_t *futex, int value);
+extern void futex_initialize_shared(futex_t *futex, int value);
+extern void futex_initialize_pi(futex_t *futex);
+
+extern void __futex_pi_acquired(futex_t *);
+extern void __futex_pi_released(futex_t *);
+
+/** Static initializer of an unlocked futex used as a priority-inheriting lock. */
+#define FUTEX_INITIALIZE_PI  { .val = { 1 }, .flags = FUTEX_PI }
 
 #ifdef CONFIG_DEBUG_FUTEX
 
-#define FUTEX_INITIALIZE(val) {{ (val) }, NULL }
+#define FUTEX_INITIALIZE(value) { .val = { (value) }, .owner = NULL }
 #define FUTEX_INITIALIZER     FUTEX_INITIALIZE(1)
 
 void __futex_assert_is_locked(futex_t *, const char *);
@@ -72,7 +85,7 @@ void __futex_give_to(futex_t *, void *, const char *);
 
 #else
 
-#define FUTEX_INITIALIZE(val) {{ (val) }}
+#define FUTEX_INITIALIZE(value) { .val = { (value) } }
 #define FUTEX_INITIALIZER     FUTEX_INITIALIZE(1)
 
 #define futex_lock(fut)     (void) futex_down((fut))
@@ -95,7 +108,13 @@ void __futex_give_to(futex_t *, void *, const char *);
  */
 static inline bool futex_trydown(futex_t *futex)
 {
-	return cas(&futex->val, 1, 0);
+	if (!cas(&futex->val, 1, 0))
+		return false;
+
+	if (futex->flags & FUTEX_PI)
+		__futex_pi_acquired(futex);
+
+	return true;
 }
 
 /** Down the futex with timeout, composably.
@@ -134,8 +153,20 @@ static inline errno_t futex_down_composable(futex_t *futex, struct timeval *expi
 		assert(timeout > 0);
 	}
 
-	if ((atomic_signed_t) atomic_predec(&futex->val) < 0)
-		return (errno_t) __SYSCALL2(SYS_FUTEX_SLEEP, (sysarg_t) &futex->val.count, (sysarg_t) timeout);
+	if ((atomic_signed_t) atomic_predec(&futex->val) < 0) {
+		/*
+		 * The holder may not have been recorded yet, in which case
+		 * the kernel simply does not lend our priority to anyone.
+		 */
+		sysarg_t holder = __atomic_load_n(&futex->holder, __ATOMIC_RELAXED);
+		errno_t rc = (errno_t) __SYSCALL4(SYS_FUTEX_SLEEP, (sysarg_t) &futex->val.count, (sysarg_t) timeout, futex->flags, holder);
+		if ((rc == EOK) && (futex->flags & FUTEX_PI))
+			__futex_pi_acquired(futex);
+		return rc;
+	}
+
+	if (futex->flags & FUTEX_PI)
+		__futex_pi_acquired(futex);
 
 	return EOK;
 }
@@ -151,8 +182,11 @@ static inline errno_t futex_down_composable(futex_t *futex, struct timeval *expi
  */
 static inline errno_t futex_up(futex_t *futex)
 {
+	if (futex->flags & FUTEX_PI)
+		__futex_pi_released(futex);
+
 	if ((atomic_signed_t) atomic_postinc(&futex->val) < 0)
-		return (errno_t) __SYSCALL1(SYS_FUTEX_WAKEUP, (sysarg_t) &futex->val.count);
+		return (errno_t) __SYSCALL2(SYS_FUTEX_WAKEUP, (sysarg_t) &futex->val.count, futex->flags);
 
 	return EOK;
 }
@@ -39,13 +39,29 @@
 #include <inet/addr.h>
 
 struct iplink_ev_ops;
+struct iplink_srv;
 
-typedef struct {
+typedef struct iplink {
 	async_sess_t *sess;
 	struct iplink_ev_ops *ev_ops;
 	void *arg;
+	/** IP link server in the same task or @c NULL */
+	struct iplink_srv *local_srv;
 } iplink_t;
 
+/** IP link can complete TCP/UDP checksums of IPv4 packets */
+#define IPLINK_OFFLOAD_TX_CSUM4  0x0001
+
+/** SDU flags */
+enum {
+	/**
+	 * TCP/UDP checksum field of the packet only contains the pseudo-header
+	 * sum, the link must complete it. Only allowed if the link reports
+	 * IPLINK_OFFLOAD_TX_CSUM4.
+	 */
+	IPLINK_SDU_CSUM_PARTIAL = 0x0001
+};
+
 /** IPv4 link Service Data Unit */
 typedef struct {
 	/** Local source address */
@@ -56,6 +72,8 @@ typedef struct {
 	void *data;
 	/** Size of @c data in bytes */
 	size_t size;
+	/** SDU flags (IPLINK_SDU_xxx) */
+	uint32_t flags;
 } iplink_sdu_t;
 
 /** IPv6 link Service Data Unit */
@@ -82,12 +100,15 @@ typedef struct iplink_ev_ops {
 } iplink_ev_ops_t;
 
 extern errno_t iplink_open(async_sess_t *, iplink_ev_ops_t *, void *, iplink_t **);
+extern errno_t iplink_open_local(struct iplink_srv *, iplink_ev_ops_t *, void *,
+    iplink_t **);
 extern void iplink_close(iplink_t *);
 extern errno_t iplink_send(iplink_t *, iplink_sdu_t *);
 extern errno_t iplink_send6(iplink_t *, iplink_sdu6_t *);
 extern errno_t iplink_addr_add(iplink_t *, inet_addr_t *);
 extern errno_t iplink_addr_remove(iplink_t *, inet_addr_t *);
 extern errno_t iplink_get_mtu(iplink_t *, size_t *);
+extern errno_t iplink_get_offload(iplink_t *, uint32_t *);
 extern errno_t iplink_get_mac48(iplink_t *, addr48_t *);
 extern errno_t iplink_set_mac48(iplink_t *, addr48_t);
 extern void *iplink_get_userptr(iplink_t *);
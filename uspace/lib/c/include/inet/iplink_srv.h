@@ -35,20 +35,28 @@
 #ifndef LIBC_INET_IPLINK_SRV_H_
 #define LIBC_INET_IPLINK_SRV_H_
 
+#include <adt/list.h>
 #include <async.h>
 #include <fibril_synch.h>
+#include <ipc/loc.h>
 #include <stdbool.h>
 #include <inet/addr.h>
 #include <inet/iplink.h>
 
 struct iplink_ops;
 
-typedef struct {
+typedef struct iplink_srv {
 	fibril_mutex_t lock;
 	bool connected;
 	struct iplink_ops *ops;
 	void *arg;
 	async_sess_t *client_sess;
+	/** Client in the same task or @c NULL */
+	iplink_t *local;
+	/** Link to list of IP link servers in this task */
+	link_t llocal;
+	/** Service ID under which the server is available in this task */
+	service_id_t local_sid;
 } iplink_srv_t;
 
 typedef struct iplink_ops {
@@ -57,16 +65,35 @@ typedef struct iplink_ops {
 	errno_t (*send)(iplink_srv_t *, iplink_sdu_t *);
 	errno_t (*send6)(iplink_srv_t *, iplink_sdu6_t *);
 	errno_t (*get_mtu)(iplink_srv_t *, size_t *);
+	errno_t (*get_offload)(iplink_srv_t *, uint32_t *);
 	errno_t (*get_mac48)(iplink_srv_t *, addr48_t *);
 	errno_t (*set_mac48)(iplink_srv_t *, addr48_t *);
 	errno_t (*addr_add)(iplink_srv_t *, inet_addr_t *);
 	errno_t (*addr_remove)(iplink_srv_t *, inet_addr_t *);
 } iplink_ops_t;
 
+/** Batch of received SDUs to be delivered with a single event */
+typedef struct {
+	/** Buffer */
+	void *buf;
+	/** Buffer size */
+	size_t bsize;
+	/** Used size of buffer */
+	size_t size;
+	/** Number of SDUs in batch */
+	size_t count;
+} iplink_recv_batch_t;
+
 extern void iplink_srv_init(iplink_srv_t *);
+extern void iplink_srv_local_register(iplink_srv_t *, service_id_t);
+extern iplink_srv_t *iplink_srv_local_find(service_id_t);
 
 extern errno_t iplink_conn(cap_call_handle_t, ipc_call_t *, void *);
 extern errno_t iplink_ev_recv(iplink_srv_t *, iplink_recv_sdu_t *, ip_ver_t);
+extern void iplink_recv_batch_init(iplink_recv_batch_t *, void *, size_t);
+extern errno_t iplink_recv_batch_add(iplink_recv_batch_t *,
+    iplink_recv_sdu_t *, ip_ver_t);
+extern errno_t iplink_ev_recv_batch(iplink_srv_t *, iplink_recv_batch_t *);
 extern errno_t iplink_ev_change_addr(iplink_srv_t *, addr48_t *);
 
 #endif
@@ -39,6 +39,7 @@
 #include <inet/addr.h>
 #include <inet/endpoint.h>
 #include <inet/inet.h>
+#include <ipc/tcp.h>
 
 /** TCP connection */
 typedef struct {
@@ -54,6 +55,10 @@ typedef struct {
 	bool connected;
 	bool conn_failed;
 	bool conn_reset;
+	/** Memory area shared with TCP server or @c NULL */
+	void *shm;
+	/** Size of send and of receive buffer in shared area */
+	size_t shm_bsize;
 } tcp_conn_t;
 
 /** TCP connection listener */
@@ -112,10 +117,18 @@ extern errno_t tcp_conn_wait_connected(tcp_conn_t *);
 extern errno_t tcp_conn_send(tcp_conn_t *, const void *, size_t);
 extern errno_t tcp_conn_send_fin(tcp_conn_t *);
 extern errno_t tcp_conn_push(tcp_conn_t *);
+extern errno_t tcp_conn_set_nodelay(tcp_conn_t *, bool);
 extern errno_t tcp_conn_reset(tcp_conn_t *);
 
 extern errno_t tcp_conn_recv(tcp_conn_t *, void *, size_t, size_t *);
 extern errno_t tcp_conn_recv_wait(tcp_conn_t *, void *, size_t, size_t *);
+extern errno_t tcp_conn_get_stats(tcp_conn_t *, tcp_conn_stats_t *);
+
+extern errno_t tcp_conn_shm_setup(tcp_conn_t *, size_t);
+extern void *tcp_conn_shm_sbuf(tcp_conn_t *, size_t *);
+extern errno_t tcp_conn_shm_send(tcp_conn_t *, size_t);
+extern errno_t tcp_conn_shm_recv(tcp_conn_t *, void **, size_t *);
+extern errno_t tcp_conn_shm_recv_wait(tcp_conn_t *, void **, size_t *);
 
 
 #endif
@@ -54,6 +54,8 @@ typedef struct {
 	sysarg_t assoc_id;
 	size_t size;
 	inet_ep_t remote_ep;
+	/** Message data if already transferred to the client, or @c NULL */
+	void *data;
 } udp_rmsg_t;
 
 /** UDP received error */
@@ -72,6 +74,8 @@ typedef struct {
 /** UDP callbacks */
 typedef struct udp_cb {
 	void (*recv_msg)(udp_assoc_t *, udp_rmsg_t *);
+	/** Several messages received (optional, overrides @c recv_msg) */
+	void (*recv_batch)(udp_assoc_t *, udp_rmsg_t *, size_t);
 	void (*recv_err)(udp_assoc_t *, udp_rerr_t *);
 	void (*link_state)(udp_assoc_t *, udp_link_state_t);
 } udp_cb_t;
@@ -88,6 +92,8 @@ typedef struct udp {
 	fibril_condvar_t cv;
 	/** Set to @a true when callback connection handler has terminated */
 	bool cb_done;
+	/** Buffer for receiving message batches */
+	void *rbuf;
 } udp_t;
 
 extern errno_t udp_create(udp_t **);
@@ -39,6 +39,8 @@
 #include <io/charfield.h>
 #include <types/common.h>
 #include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
 
 typedef enum {
 	CHARGRID_FLAG_NONE = 0,
@@ -59,6 +61,7 @@ typedef struct {
 	char_attrs_t attrs;     /**< Current attributes */
 
 	sysarg_t top_row;       /**< The first row in the cyclic buffer */
+	size_t dirty_offset;    /**< Offset of the dirty row bitmap */
 	charfield_t data[];     /**< Screen contents (cyclic buffer) */
 } chargrid_t;
 
@@ -70,6 +73,37 @@ static inline charfield_t *chargrid_charfield_at(chargrid_t *chargrid,
 	    col;
 }
 
+/** Dirty row bitmap
+ *
+ * The bitmap is indexed by rows of the cyclic buffer (not by
+ * screen rows), so it stays valid when the chargrid scrolls.
+ *
+ */
+static inline uint8_t *chargrid_dirty_map(chargrid_t *chargrid)
+{
+	return ((uint8_t *) chargrid) + chargrid->dirty_offset;
+}
+
+static inline void chargrid_set_row_dirty(chargrid_t *chargrid, sysarg_t row)
+{
+	sysarg_t brow = (row + chargrid->top_row) % chargrid->rows;
+	chargrid_dirty_map(chargrid)[brow / 8] |= 1 << (brow % 8);
+}
+
+static inline void chargrid_clear_row_dirty(chargrid_t *chargrid,
+    sysarg_t row)
+{
+	sysarg_t brow = (row + chargrid->top_row) % chargrid->rows;
+	chargrid_dirty_map(chargrid)[brow / 8] &= ~(1 << (brow % 8));
+}
+
+static inline bool chargrid_row_dirty(chargrid_t *chargrid, sysarg_t row)
+{
+	sysarg_t brow = (row + chargrid->top_row) % chargrid->rows;
+	return (chargrid_dirty_map(chargrid)[brow / 8] & (1 << (brow % 8))) != 0;
+}
+
+extern size_t chargrid_size(sysarg_t, sysarg_t);
 extern chargrid_t *chargrid_create(sysarg_t, sysarg_t,
     chargrid_flag_t);
 extern void chargrid_destroy(chargrid_t *);
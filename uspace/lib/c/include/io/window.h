@@ -44,7 +44,8 @@
 typedef enum {
 	WINDOW_MAIN = 1,
 	WINDOW_DECORATED = 2,
-	WINDOW_RESIZEABLE = 4
+	WINDOW_RESIZEABLE = 4,
+	WINDOW_DOUBLE_BUFFERED = 8
 } window_flags_t;
 
 typedef enum {
@@ -121,6 +122,10 @@ extern errno_t win_damage(async_sess_t *, sysarg_t, sysarg_t, sysarg_t, sysarg_t
 extern errno_t win_grab(async_sess_t *, sysarg_t, sysarg_t);
 extern errno_t win_resize(async_sess_t *, sysarg_t, sysarg_t, sysarg_t, sysarg_t,
     window_placement_flags_t, void *);
+extern errno_t win_resize_buffered(async_sess_t *, sysarg_t, sysarg_t, sysarg_t,
+    sysarg_t, window_placement_flags_t, void *, void *);
+extern errno_t win_present(async_sess_t *, sysarg_t, sysarg_t, sysarg_t,
+    sysarg_t, sysarg_t);
 extern errno_t win_close(async_sess_t *);
 extern errno_t win_close_request(async_sess_t *);
 
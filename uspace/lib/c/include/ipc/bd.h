@@ -36,6 +36,11 @@
 #define LIBC_IPC_BD_H_
 
 #include <ipc/common.h>
+#include <offset.h>
+#include <stddef.h>
+
+/** Maximum number of extents in a vectored block request */
+#define BD_EXTENTS_MAX 64
 
 typedef enum {
 	BD_GET_BLOCK_SIZE = IPC_FIRST_USER_METHOD,
@@ -43,9 +48,22 @@ typedef enum {
 	BD_READ_BLOCKS,
 	BD_SYNC_CACHE,
 	BD_WRITE_BLOCKS,
-	BD_READ_TOC
+	BD_READ_TOC,
+	BD_READ_BLOCKS_V,
+	BD_WRITE_BLOCKS_V,
+	BD_DISCARD_BLOCKS
 } bd_request_t;
 
+/** Extent of a vectored block request */
+typedef struct {
+	/** Address of the first block */
+	aoff64_t ba;
+	/** Number of blocks */
+	size_t cnt;
+	/** Offset of the extent data in the transfer buffer (unused by discard) */
+	size_t offset;
+} bd_extent_t;
+
 #endif
 
 /** @}
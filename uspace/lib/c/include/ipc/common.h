@@ -52,6 +52,8 @@ typedef struct {
 	unsigned int flags;
 	struct async_call *label;
 	cap_call_handle_t cap_handle;
+	/** Size of the inline payload of a request, 0 if there is none */
+	size_t payload_size;
 } ipc_call_t;
 
 extern futex_t async_futex;
@@ -47,9 +47,24 @@ typedef enum {
 	INPUT_EVENT_KEY,
 	INPUT_EVENT_MOVE,
 	INPUT_EVENT_ABS_MOVE,
-	INPUT_EVENT_BUTTON
+	INPUT_EVENT_BUTTON,
+	INPUT_EVENT_BATCH
 } input_notif_t;
 
+/** Maximum number of events in one INPUT_EVENT_BATCH */
+#define INPUT_BATCH_MAX  64
+
+/** Event carried by INPUT_EVENT_BATCH.
+ *
+ * The arguments are those of the individual notification of the same
+ * method (INPUT_EVENT_KEY, INPUT_EVENT_MOVE, INPUT_EVENT_ABS_MOVE or
+ * INPUT_EVENT_BUTTON).
+ */
+typedef struct {
+	sysarg_t method;
+	sysarg_t arg[4];
+} input_batch_event_t;
+
 #endif
 
 /**
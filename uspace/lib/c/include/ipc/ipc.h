@@ -47,7 +47,15 @@
 
 typedef void (*ipc_async_callback_t)(void *, errno_t, ipc_call_t *);
 
+/** Batch of asynchronous calls made by a single syscall */
+typedef struct {
+	size_t count;
+	ipc_batch_call_t calls[IPC_BATCH_MAX];
+} ipc_batch_t;
+
 extern errno_t ipc_wait_cycle(ipc_call_t *, sysarg_t, unsigned int);
+extern errno_t ipc_wait_batch(ipc_call_t *, size_t, sysarg_t, unsigned int,
+    size_t *);
 extern void ipc_poke(void);
 
 #define ipc_wait_for_call(data) \
@@ -113,6 +121,16 @@ extern void ipc_call_async_fast(cap_phone_handle_t, sysarg_t, sysarg_t,
     sysarg_t, sysarg_t, void *, ipc_async_callback_t);
 extern void ipc_call_async_slow(cap_phone_handle_t, sysarg_t, sysarg_t,
     sysarg_t, sysarg_t, sysarg_t, sysarg_t, void *, ipc_async_callback_t);
+extern void ipc_call_async_payload(cap_phone_handle_t, sysarg_t, sysarg_t,
+    sysarg_t, sysarg_t, sysarg_t, sysarg_t, const void *, size_t, void *,
+    ipc_async_callback_t);
+extern errno_t ipc_payload_get(cap_call_handle_t, void *, size_t);
+
+extern void ipc_batch_init(ipc_batch_t *);
+extern void ipc_batch_call_async(ipc_batch_t *, cap_phone_handle_t, sysarg_t,
+    sysarg_t, sysarg_t, sysarg_t, sysarg_t, sysarg_t, void *,
+    ipc_async_callback_t);
+extern void ipc_batch_submit(ipc_batch_t *);
 
 extern errno_t ipc_hangup(cap_phone_handle_t);
 
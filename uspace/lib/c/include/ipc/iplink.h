@@ -36,6 +36,7 @@
 #define LIBC_IPC_IPLINK_H_
 
 #include <ipc/common.h>
+#include <stdint.h>
 
 typedef enum {
 	IPLINK_GET_MTU = IPC_FIRST_USER_METHOD,
@@ -44,14 +45,31 @@ typedef enum {
 	IPLINK_SEND,
 	IPLINK_SEND6,
 	IPLINK_ADDR_ADD,
-	IPLINK_ADDR_REMOVE
+	IPLINK_ADDR_REMOVE,
+	IPLINK_GET_OFFLOAD
 } iplink_request_t;
 
 typedef enum {
 	IPLINK_EV_RECV = IPC_FIRST_USER_METHOD,
 	IPLINK_EV_CHANGE_ADDR,
+	IPLINK_EV_RECV_BATCH
 } iplink_event_t;
 
+/** Header of an SDU in IPLINK_EV_RECV_BATCH data.
+ *
+ * Each header is followed by SDU data. Header and data together are
+ * padded to a multiple of IPLINK_BATCH_ALIGN bytes.
+ */
+typedef struct {
+	/** SDU size in bytes */
+	uint32_t size;
+	/** IP version (ip_ver_t) */
+	uint32_t ver;
+} iplink_batch_sdu_hdr_t;
+
+/** Alignment of SDUs in IPLINK_EV_RECV_BATCH data */
+#define IPLINK_BATCH_ALIGN  sizeof(uint32_t)
+
 #endif
 
 /**
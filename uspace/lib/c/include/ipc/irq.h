@@ -38,10 +38,16 @@
 #include <types/common.h>
 #include <abi/ddi/irq.h>
 #include <abi/cap.h>
+#include <sys/time.h>
+
+/** Number of interrupts coalesced into an IRQ notification. */
+#define IPC_GET_IRQ_COUNT(call)  ((size_t) (call).in_task_id)
 
 extern errno_t ipc_irq_subscribe(int, sysarg_t, const irq_code_t *,
     cap_irq_handle_t *);
 extern errno_t ipc_irq_unsubscribe(cap_irq_handle_t);
+extern errno_t ipc_irq_coalesce(cap_irq_handle_t, useconds_t);
+extern errno_t ipc_irq_set_affinity(cap_irq_handle_t, unsigned int);
 
 #endif
 
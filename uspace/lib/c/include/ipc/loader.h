@@ -45,7 +45,8 @@ typedef enum {
 	LOADER_SET_ARGS,
 	LOADER_ADD_INBOX,
 	LOADER_LOAD,
-	LOADER_RUN
+	LOADER_RUN,
+	LOADER_PREPARE
 } loader_request_t;
 
 #endif
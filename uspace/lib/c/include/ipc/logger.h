@@ -34,6 +34,7 @@
 #define LIBC_IPC_LOGGER_H_
 
 #include <ipc/common.h>
+#include <stdint.h>
 
 typedef enum {
 	/** Set (global) default displayed logging level.
@@ -71,9 +72,42 @@ typedef enum {
 	 * Returns: error code
 	 * Followed by: string with the message.
 	 */
-	LOGGER_WRITER_MESSAGE
+	LOGGER_WRITER_MESSAGE,
+	/** Attach a ring for batched message delivery.
+	 *
+	 * Returns: error code
+	 * Followed by: async_ring_create() with a ring of
+	 * LOGGER_RING_SIZE bytes carrying logger_record_t records.
+	 */
+	LOGGER_WRITER_ATTACH_RING
 } logger_writer_request_t;
 
+/** Size of the ring used for batched message delivery. */
+#define LOGGER_RING_SIZE  65536
+
+/** Maximum length of a message (in bytes). */
+#define LOGGER_MESSAGE_MAX  4096
+
+/** Header of a message record in the writer ring.
+ *
+ * The header is immediately followed by @c size bytes of message text
+ * (without the terminating zero).
+ */
+typedef struct {
+	/** Log id as returned by LOGGER_WRITER_CREATE_LOG */
+	uint64_t log;
+	/** Time of the message (seconds) */
+	int64_t tv_sec;
+	/** Time of the message (microseconds) */
+	uint32_t tv_usec;
+	/** Message severity level (log_level_t) */
+	uint32_t level;
+	/** Number of records the client dropped since the previous one */
+	uint32_t dropped;
+	/** Length of the message text */
+	uint32_t size;
+} logger_record_t;
+
 #endif
 
 /** @}
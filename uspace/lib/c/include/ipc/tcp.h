@@ -36,6 +36,7 @@
 #define LIBC_IPC_TCP_H_
 
 #include <ipc/common.h>
+#include <stdint.h>
 
 typedef enum {
 	TCP_CALLBACK_CREATE = IPC_FIRST_USER_METHOD,
@@ -48,7 +49,12 @@ typedef enum {
 	TCP_CONN_PUSH,
 	TCP_CONN_RESET,
 	TCP_CONN_RECV,
-	TCP_CONN_RECV_WAIT
+	TCP_CONN_RECV_WAIT,
+	TCP_CONN_GET_STATS,
+	TCP_CONN_SET_NODELAY,
+	TCP_CONN_SHM_SETUP,
+	TCP_CONN_SHM_SEND,
+	TCP_CONN_SHM_RECV
 } tcp_request_t;
 
 typedef enum {
@@ -57,9 +63,40 @@ typedef enum {
 	TCP_EV_CONN_RESET,
 	TCP_EV_DATA,
 	TCP_EV_URG_DATA,
-	TCP_EV_NEW_CONN
+	TCP_EV_NEW_CONN,
+	TCP_EV_NEW_CONNS
 } tcp_event_t;
 
+/** TCP connection statistics */
+typedef struct {
+	/** Smoothed round-trip time in microseconds */
+	uint32_t srtt;
+	/** Round-trip time variation in microseconds */
+	uint32_t rttvar;
+	/** Retransmission timeout in microseconds */
+	uint32_t rto;
+	/** Congestion window in bytes */
+	uint32_t cwnd;
+	/** Slow start threshold in bytes */
+	uint32_t ssthresh;
+	/** Send window advertised by peer in bytes */
+	uint32_t snd_wnd;
+	/** Receive window in bytes */
+	uint32_t rcv_wnd;
+	/** Number of segments sent (including retransmissions) */
+	uint64_t segs_sent;
+	/** Number of segments received */
+	uint64_t segs_rcvd;
+	/** Number of data bytes acknowledged by peer */
+	uint64_t bytes_acked;
+	/** Number of segments retransmitted */
+	uint64_t retransmits;
+	/** Number of fast retransmits */
+	uint64_t fast_retransmits;
+	/** Number of retransmission timeouts */
+	uint64_t timeouts;
+} tcp_conn_stats_t;
+
 #endif
 
 /** @}
@@ -35,6 +35,7 @@
 #ifndef LIBC_IPC_UDP_H_
 #define LIBC_IPC_UDP_H_
 
+#include <inet/endpoint.h>
 #include <ipc/common.h>
 
 typedef enum {
@@ -45,13 +46,28 @@ typedef enum {
 	UDP_ASSOC_SEND_MSG,
 	UDP_RMSG_INFO,
 	UDP_RMSG_READ,
-	UDP_RMSG_DISCARD
+	UDP_RMSG_DISCARD,
+	UDP_RMSG_READ_BATCH
 } udp_request_t;
 
 typedef enum {
 	UDP_EV_DATA = IPC_FIRST_USER_METHOD
 } udp_event_t;
 
+/** Header of a message record returned by UDP_RMSG_READ_BATCH.
+ *
+ * Each header is followed by @c size bytes of message data. The next
+ * record starts at the following multiple of @c sizeof(sysarg_t).
+ */
+typedef struct {
+	/** Association ID */
+	sysarg_t assoc_id;
+	/** Message size */
+	size_t size;
+	/** Remote endpoint */
+	inet_ep_t remote_ep;
+} udp_rmsg_hdr_t;
+
 #endif
 
 /** @}
@@ -44,7 +44,8 @@ typedef enum {
 	VBD_PART_GET_INFO,
 	VBD_PART_CREATE,
 	VBD_PART_DELETE,
-	VBD_SUGGEST_PTYPE
+	VBD_SUGGEST_PTYPE,
+	VBD_PART_GET_STATS
 } vbd_request_t;
 
 #endif
@@ -61,6 +61,11 @@ typedef struct {
 	unsigned int instance;
 	bool concurrent_read_write;
 	bool write_retains_size;
+	/**
+	 * File contents and names change only through VFS, so VFS can keep
+	 * file data in its page cache and lookup results in its lookup cache.
+	 */
+	bool cacheable;
 } vfs_info_t;
 
 /** Data returned by filesystem probe regarding a specific volume. */
@@ -75,8 +80,10 @@ typedef enum {
 	VFS_IN_FSTYPES,
 	VFS_IN_MOUNT,
 	VFS_IN_OPEN,
+	VFS_IN_PIPE,
 	VFS_IN_PUT,
 	VFS_IN_READ,
+	VFS_IN_READDIR,
 	VFS_IN_REGISTER,
 	VFS_IN_RENAME,
 	VFS_IN_RESIZE,
@@ -87,6 +94,7 @@ typedef enum {
 	VFS_IN_UNMOUNT,
 	VFS_IN_WAIT_HANDLE,
 	VFS_IN_WALK,
+	VFS_IN_WALK_READ,
 	VFS_IN_WRITE,
 } vfs_in_request_t;
 
@@ -99,7 +107,9 @@ typedef enum {
 	VFS_OUT_LOOKUP,
 	VFS_OUT_MOUNTED,
 	VFS_OUT_OPEN_NODE,
+	VFS_OUT_OPEN_READ,
 	VFS_OUT_READ,
+	VFS_OUT_READDIR,
 	VFS_OUT_STAT,
 	VFS_OUT_STATFS,
 	VFS_OUT_SYNC,
@@ -190,6 +200,16 @@ enum {
 	MODE_APPEND = 4,
 };
 
+/*
+ * File mapping flags passed to the VFS pager.
+ */
+enum {
+	/** Changes of the file are visible in the mapping. */
+	VFS_MAP_SHARED = 1,
+	/** The mapping is writable and needs its own copies of the pages. */
+	VFS_MAP_WRITE = 2,
+};
+
 #endif
 
 /** @}
@@ -44,7 +44,8 @@ typedef enum {
 	WINDOW_GRAB,
 	WINDOW_RESIZE,
 	WINDOW_CLOSE,
-	WINDOW_CLOSE_REQUEST
+	WINDOW_CLOSE_REQUEST,
+	WINDOW_PRESENT
 } window_request_t;
 
 #endif
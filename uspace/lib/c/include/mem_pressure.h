@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup libc
+ * @{
+ */
+/** @file
+ */
+
+#ifndef LIBC_MEM_PRESSURE_H_
+#define LIBC_MEM_PRESSURE_H_
+
+#include <abi/mm/pressure.h>
+#include <adt/list.h>
+#include <errno.h>
+
+/** Memory pressure callback
+ *
+ * @param level New memory pressure level.
+ * @param arg   Argument passed to mem_pressure_hook_add().
+ */
+typedef void (*mem_pressure_fn_t)(mem_pressure_t, void *);
+
+/** Registered memory pressure callback */
+typedef struct {
+	link_t link;
+	mem_pressure_fn_t fn;
+	void *arg;
+} mem_pressure_hook_t;
+
+extern errno_t mem_pressure_hook_add(mem_pressure_hook_t *, mem_pressure_fn_t,
+    void *);
+extern void mem_pressure_hook_remove(mem_pressure_hook_t *);
+extern mem_pressure_t mem_pressure_level(void);
+
+#endif
+
+/** @}
+ */
@@ -75,6 +75,19 @@
 #define NIC_DEFECTIVE_BAD_TCP_CHECKSUM   0x0080
 #define NIC_DEFECTIVE_BAD_UDP_CHECKSUM   0x0100
 
+/** NIC computes TCP and UDP checksums over IPv4 on transmit */
+#define NIC_OFFLOAD_TX_CSUM4  0x0001
+/** NIC verifies IPv4, TCP and UDP checksums on receive */
+#define NIC_OFFLOAD_RX_CSUM4  0x0002
+
+/**
+ * Frame flag for nic_send_frame(). The TCP or UDP checksum field of
+ * the frame only holds the pseudo-header checksum (not complemented)
+ * and the NIC should complete it. Only valid if NIC_OFFLOAD_TX_CSUM4
+ * is active.
+ */
+#define NIC_FRAME_CSUM_PARTIAL  0x0001
+
 /**
  * The bitmap uses single bit for each of the 2^12 = 4096 possible VLAN tags.
  * This means its size is 4096/8 = 512 bytes.
@@ -91,8 +91,20 @@
  */
 #define rcu_access(ptr) ACCESS_ONCE(ptr)
 
+struct rcu_item;
+
+/** RCU callback type. The passed rcu_item_t may be freed. */
+typedef void (*rcu_func_t)(struct rcu_item *);
+
+/** Item to be embedded in the data reclaimed by rcu_call(). */
+typedef struct rcu_item {
+	rcu_func_t func;
+	struct rcu_item *next;
+} rcu_item_t;
+
 extern void rcu_register_fibril(void);
 extern void rcu_deregister_fibril(void);
+extern bool rcu_fibril_registered(void);
 
 extern void rcu_read_lock(void);
 extern void rcu_read_unlock(void);
@@ -100,6 +112,9 @@ extern void rcu_read_unlock(void);
 extern bool rcu_read_locked(void);
 
 extern void rcu_synchronize(void);
+extern void rcu_synchronize_expedite(void);
+extern void rcu_call(rcu_item_t *, rcu_func_t);
+extern void rcu_barrier(void);
 
 #endif
 
@@ -50,6 +50,9 @@ typedef enum {
 extern elf_symbol_t *symbol_bfs_find(const char *, module_t *, module_t **);
 extern elf_symbol_t *symbol_def_find(const char *, module_t *,
     symbol_search_flags_t, module_t **);
+extern void symbol_cache_init(module_t *);
+extern void symbol_cache_fini(module_t *);
+extern elf_symbol_t *symbol_reloc_find(module_t *, elf_word, module_t **);
 extern void *symbol_get_addr(elf_symbol_t *, module_t *, tcb_t *);
 
 #endif
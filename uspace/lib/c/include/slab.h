@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2018 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup libc
+ * @{
+ */
+/** @file
+ */
+
+#ifndef LIBC_SLAB_H_
+#define LIBC_SLAB_H_
+
+#include <adt/list.h>
+#include <errno.h>
+#include <futex.h>
+#include <stddef.h>
+
+/** Number of objects in a magazine. */
+#define SLAB_MAG_SIZE  16
+
+/** Number of magazine slots of a cache.
+ *
+ * Threads allocating concurrently from one cache pick different slots,
+ * so that they do not contend on a single lock.
+ */
+#define SLAB_MAG_SLOTS  4
+
+typedef struct slab_magazine slab_magazine_t;
+
+/** Magazine slot of a cache. */
+typedef struct {
+	futex_t futex;
+	/** Magazine with constructed objects or NULL */
+	slab_magazine_t *current;
+} slab_mag_slot_t;
+
+/** Object cache.
+ *
+ * Objects are carved from slabs allocated on the heap and constructed
+ * when they first leave the slab. Freed objects stay constructed in
+ * magazines and are handed out again without running the constructor.
+ */
+typedef struct {
+	/** Name used for debugging */
+	const char *name;
+	/** Object size */
+	size_t size;
+	/** Object alignment */
+	size_t align;
+	/** Object constructor or NULL */
+	errno_t (*constructor)(void *);
+	/** Object destructor or NULL */
+	void (*destructor)(void *);
+
+	/** Protects the depot and the slabs */
+	futex_t futex;
+	/** Depot of full magazines */
+	list_t magazines;
+	/** Number of magazines in the depot */
+	size_t magazine_count;
+	/** Slabs with free objects */
+	list_t slabs;
+	/** Size of a slab, computed when the first slab is created */
+	size_t slab_size;
+	/** Number of objects in a slab */
+	size_t objects;
+
+	slab_mag_slot_t slots[SLAB_MAG_SLOTS];
+	/** Slot to try first */
+	size_t hint;
+} slab_cache_t;
+
+#define SLAB_CACHE_INITIALIZER(cache, cname, csize, calign, ctor, dtor) \
+	{ \
+		.name = (cname), \
+		.size = (csize), \
+		.align = (calign), \
+		.constructor = (ctor), \
+		.destructor = (dtor), \
+		.futex = FUTEX_INITIALIZER, \
+		.magazines = LIST_INITIALIZER((cache).magazines), \
+		.slabs = LIST_INITIALIZER((cache).slabs), \
+		.slots = { \
+			[0 ... SLAB_MAG_SLOTS - 1] = { \
+				.futex = FUTEX_INITIALIZER \
+			} \
+		} \
+	}
+
+#define SLAB_CACHE_INITIALIZE(name, cname, csize, calign, ctor, dtor) \
+	slab_cache_t name = SLAB_CACHE_INITIALIZER(name, cname, csize, \
+	    calign, ctor, dtor)
+
+extern slab_cache_t *slab_cache_create(const char *, size_t, size_t,
+    errno_t (*)(void *), void (*)(void *));
+extern void slab_cache_destroy(slab_cache_t *);
+extern void *slab_alloc(slab_cache_t *);
+extern void slab_free(slab_cache_t *, void *);
+
+#endif
+
+/** @}
+ */
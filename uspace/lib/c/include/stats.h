@@ -45,11 +45,15 @@
 #define LOAD_UNIT  65536
 
 extern stats_cpu_t *stats_get_cpus(size_t *);
+extern stats_irq_t *stats_get_irqs(size_t *);
 extern stats_physmem_t *stats_get_physmem(void);
+extern stats_slab_t *stats_get_slabs(size_t *);
+extern stats_slab_t *stats_get_slabs_cpu(unsigned int, size_t *);
 extern load_t *stats_get_load(size_t *);
 
 extern stats_task_t *stats_get_tasks(size_t *);
 extern stats_task_t *stats_get_task(task_id_t);
+extern stats_phone_t *stats_get_phones(task_id_t, size_t *);
 
 extern stats_thread_t *stats_get_threads(size_t *);
 extern stats_thread_t *stats_get_thread(thread_id_t);
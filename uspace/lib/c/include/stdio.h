@@ -203,6 +203,8 @@ extern int vprintf_size(const char *, va_list);
 extern int printf_size(const char *, ...)
     _HELENOS_PRINTF_ATTRIBUTE(1, 2);
 extern FILE *fdopen(int, const char *);
+extern FILE *fmemopen(void *, size_t, const char *);
+extern FILE *open_memstream(char **, size_t *);
 extern int fileno(FILE *);
 
 #include <offset.h>
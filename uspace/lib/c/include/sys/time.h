@@ -83,6 +83,7 @@ extern int tv_gt(const struct timeval *, const struct timeval *);
 extern int tv_gteq(const struct timeval *, const struct timeval *);
 extern void gettimeofday(struct timeval *, struct timezone *);
 extern void getuptime(struct timeval *);
+extern uint64_t getuptime_nsec(void);
 
 extern void udelay(useconds_t);
 extern errno_t usleep(useconds_t);
@@ -48,6 +48,7 @@ extern errno_t thread_join(thread_id_t);
 extern thread_id_t thread_get_id(void);
 extern int thread_usleep(useconds_t);
 extern unsigned int thread_sleep(unsigned int);
+extern errno_t thread_set_affinity(thread_id_t, const cpuset_t *);
 
 #endif
 
@@ -57,7 +57,13 @@ typedef struct {
 } inet_ev_ops_t;
 
 typedef enum {
-	INET_DF = 1
+	/** Do not fragment */
+	INET_DF = 1,
+	/**
+	 * TCP/UDP checksum field only holds the pseudo-header sum, the sum
+	 * over the payload is completed by inetsrv or by the NIC
+	 */
+	INET_CSUM_PARTIAL = 2
 } inet_df_t;
 
 #endif
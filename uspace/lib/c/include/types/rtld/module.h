@@ -73,6 +73,13 @@ typedef struct module {
 
 	/** True iff relocations have already been processed in this module. */
 	bool relocated;
+	/**
+	 * Definitions resolved while processing relocations, indexed by
+	 * symbol table index. Only valid in module_process_relocs().
+	 */
+	struct symbol_cache_entry *sym_cache;
+	/** Number of entries in sym_cache */
+	size_t sym_cache_len;
 
 	/** Link to list of all modules in runtime environment */
 	link_t modules_link;
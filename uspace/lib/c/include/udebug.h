@@ -45,6 +45,11 @@ typedef sysarg_t thash_t;
 extern errno_t udebug_begin(async_sess_t *);
 extern errno_t udebug_end(async_sess_t *);
 extern errno_t udebug_set_evmask(async_sess_t *, udebug_evmask_t);
+extern errno_t udebug_set_filter(async_sess_t *, const udebug_filter_t *);
+extern errno_t udebug_log_start(async_sess_t *, size_t);
+extern errno_t udebug_log_stop(async_sess_t *);
+extern errno_t udebug_log_read(async_sess_t *, udebug_log_entry_t *, size_t,
+    size_t *, size_t *);
 extern errno_t udebug_thread_read(async_sess_t *, void *, size_t, size_t *,
     size_t *);
 extern errno_t udebug_name_read(async_sess_t *, void *, size_t, size_t *,
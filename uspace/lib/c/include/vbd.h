@@ -92,6 +92,30 @@ typedef struct {
 	service_id_t svc_id;
 } vbd_part_info_t;
 
+/** Partition I/O statistics */
+typedef struct {
+	/** Number of completed read requests */
+	uint64_t reads;
+	/** Number of completed write requests */
+	uint64_t writes;
+	/** Number of blocks read */
+	uint64_t rblocks;
+	/** Number of blocks written */
+	uint64_t wblocks;
+	/** Number of requests merged into a transfer of another request */
+	uint64_t merged;
+	/** Number of failed requests */
+	uint64_t errors;
+	/** Number of requests queued or in progress */
+	size_t qdepth;
+	/** Maximum number of requests queued or in progress */
+	size_t max_qdepth;
+	/** Sum of request latencies in microseconds */
+	uint64_t total_latency;
+	/** Maximum request latency in microseconds */
+	uint64_t max_latency;
+} vbd_part_stats_t;
+
 typedef sysarg_t vbd_part_id_t;
 
 extern errno_t vbd_create(vbd_t **);
@@ -103,6 +127,7 @@ extern errno_t vbd_label_delete(vbd_t *, service_id_t);
 extern errno_t vbd_label_get_parts(vbd_t *, service_id_t, service_id_t **,
     size_t *);
 extern errno_t vbd_part_get_info(vbd_t *, vbd_part_id_t, vbd_part_info_t *);
+extern errno_t vbd_part_get_stats(vbd_t *, vbd_part_id_t, vbd_part_stats_t *);
 extern errno_t vbd_part_create(vbd_t *, service_id_t, vbd_part_spec_t *,
     vbd_part_id_t *);
 extern errno_t vbd_part_delete(vbd_t *, vbd_part_id_t);
@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2018 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup libc
+ * @{
+ */
+/** @file Asynchronous file I/O
+ */
+
+#ifndef LIBC_VFS_AIO_H_
+#define LIBC_VFS_AIO_H_
+
+#include <errno.h>
+#include <offset.h>
+#include <stddef.h>
+
+/** Asynchronous I/O operation */
+typedef enum {
+	/** Read into the buffer */
+	VFS_AIO_READ,
+	/** Write the buffer */
+	VFS_AIO_WRITE,
+	/** Synchronize the file, buffer and position are ignored */
+	VFS_AIO_SYNC
+} vfs_aio_op_t;
+
+/** Submitted asynchronous I/O request */
+typedef struct {
+	/** Operation */
+	vfs_aio_op_t op;
+	/** File handle */
+	int file;
+	/** Position in the file */
+	aoff64_t pos;
+	/** Data buffer, must remain valid until the request completes */
+	void *buf;
+	/** Size of the buffer */
+	size_t size;
+	/** User argument passed back in the completion */
+	void *arg;
+} vfs_aio_sqe_t;
+
+/** Completion of an asynchronous I/O request */
+typedef struct {
+	/** User argument of the request */
+	void *arg;
+	/** Return code of the operation */
+	errno_t rc;
+	/** Number of bytes transferred */
+	size_t nbytes;
+} vfs_aio_cqe_t;
+
+struct vfs_aio;
+typedef struct vfs_aio vfs_aio_t;
+
+extern errno_t vfs_aio_create(size_t, vfs_aio_t **);
+extern void vfs_aio_destroy(vfs_aio_t *);
+extern size_t vfs_aio_submit(vfs_aio_t *, const vfs_aio_sqe_t *, size_t);
+extern size_t vfs_aio_poll(vfs_aio_t *, vfs_aio_cqe_t *, size_t);
+extern errno_t vfs_aio_wait(vfs_aio_t *, vfs_aio_cqe_t *, size_t, size_t *);
+
+#endif
+
+/** @}
+ */
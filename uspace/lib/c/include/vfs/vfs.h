@@ -56,7 +56,7 @@ typedef enum {
 } vfs_file_kind_t;
 
 
-typedef struct {
+typedef struct vfs_stat {
 	fs_handle_t fs_handle;
 	service_id_t service_id;
 	fs_index_t index;
@@ -67,6 +67,24 @@ typedef struct {
 	service_id_t service;
 } vfs_stat_t;
 
+/** Directory entry as returned by vfs_readdir()
+ *
+ * The entries are packed one after another in the caller's buffer, each
+ * followed by its NUL-terminated name and padded to VFS_DIRENT_ALIGN.
+ */
+typedef struct {
+	/** Size of the record including the name and the padding */
+	size_t reclen;
+	/** Directory position of the entry following this one */
+	aoff64_t next;
+	/** Attributes of the entry */
+	vfs_stat_t stat;
+	/** Name of the entry */
+	char name[];
+} vfs_dirent_t;
+
+#define VFS_DIRENT_ALIGN  8
+
 typedef struct {
 	char fs_name[FS_NAME_MAXLEN + 1];
 	uint32_t f_bsize;    /* fundamental file system block size */
@@ -74,6 +92,13 @@ typedef struct {
 	uint64_t f_bfree;    /* free blocks in fs */
 } vfs_statfs_t;
 
+/** Direct read session to the file system server of a file */
+typedef struct {
+	async_sess_t *sess;
+	service_id_t service_id;
+	fs_index_t index;
+} vfs_direct_t;
+
 /** List of file system types */
 typedef struct {
 	char **fstypes;
@@ -84,6 +109,10 @@ typedef struct {
 extern errno_t vfs_fhandle(FILE *, int *);
 
 extern char *vfs_absolutize(const char *, size_t *);
+extern errno_t vfs_direct_open(int, vfs_direct_t **);
+extern void vfs_direct_close(vfs_direct_t *);
+extern errno_t vfs_direct_read(vfs_direct_t *, aoff64_t *, void *, size_t,
+    size_t *);
 extern errno_t vfs_clone(int, int, bool, int *);
 extern errno_t vfs_cwd_get(char *path, size_t);
 extern errno_t vfs_cwd_set(const char *path);
@@ -96,15 +125,22 @@ extern errno_t vfs_link(int, const char *, vfs_file_kind_t, int *);
 extern errno_t vfs_link_path(const char *, vfs_file_kind_t, int *);
 extern errno_t vfs_lookup(const char *, int, int *);
 extern errno_t vfs_lookup_open(const char *, int, int, int *);
+extern errno_t vfs_lookup_read(const char *, void *, size_t, size_t *,
+    aoff64_t *, int *);
+extern void *vfs_map(int, aoff64_t, void *, size_t, unsigned int);
+extern void *vfs_map_shared(int, aoff64_t, void *, size_t, unsigned int);
+extern errno_t vfs_map_sync(int, aoff64_t, const void *, size_t);
 extern errno_t vfs_mount_path(const char *, const char *, const char *,
     const char *, unsigned int, unsigned int);
 extern errno_t vfs_mount(int, const char *, service_id_t, const char *, unsigned,
     unsigned, int *);
 extern errno_t vfs_open(int, int);
 extern errno_t vfs_pass_handle(async_exch_t *, int, async_exch_t *);
+extern errno_t vfs_pipe(int *, int *);
 extern errno_t vfs_put(int);
 extern errno_t vfs_read(int, aoff64_t *, void *, size_t, size_t *);
 extern errno_t vfs_read_short(int, aoff64_t, void *, size_t, ssize_t *);
+extern errno_t vfs_readdir(int, aoff64_t, void *, size_t, size_t *);
 extern errno_t vfs_receive_handle(bool, int *);
 extern errno_t vfs_rename_path(const char *, const char *);
 extern errno_t vfs_resize(int, aoff64_t);
@@ -120,6 +156,8 @@ extern errno_t vfs_unlink_path(const char *);
 extern errno_t vfs_unmount(int);
 extern errno_t vfs_unmount_path(const char *);
 extern errno_t vfs_walk(int, const char *, int, int *);
+extern errno_t vfs_walk_read(int, const char *, void *, size_t, size_t *,
+    aoff64_t *, int *);
 extern errno_t vfs_write(int, aoff64_t *, const void *, size_t, size_t *);
 extern errno_t vfs_write_short(int, aoff64_t, const void *, size_t, ssize_t *);
 
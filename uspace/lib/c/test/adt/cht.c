@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <adt/cht.h>
+#include <pcut/pcut.h>
+#include <rcu.h>
+#include <stdlib.h>
+
+PCUT_INIT;
+
+PCUT_TEST_SUITE(cht);
+
+enum {
+	/** Enough items to make the table grow. */
+	item_count = 1024
+};
+
+typedef struct {
+	cht_link_t link;
+	int key;
+} test_item_t;
+
+static size_t removed;
+
+static size_t test_key_hash(void *key)
+{
+	return *(int *) key;
+}
+
+static size_t test_hash(const cht_link_t *item)
+{
+	test_item_t *titem = cht_get_inst(item, test_item_t, link);
+	return test_key_hash(&titem->key);
+}
+
+static bool test_equal(const cht_link_t *item1, const cht_link_t *item2)
+{
+	return cht_get_inst(item1, test_item_t, link)->key ==
+	    cht_get_inst(item2, test_item_t, link)->key;
+}
+
+static bool test_key_equal(void *key, const cht_link_t *item)
+{
+	return cht_get_inst(item, test_item_t, link)->key == *(int *) key;
+}
+
+static void test_remove_callback(cht_link_t *item)
+{
+	free(cht_get_inst(item, test_item_t, link));
+	removed++;
+}
+
+static cht_ops_t test_ops = {
+	.hash = test_hash,
+	.key_hash = test_key_hash,
+	.equal = test_equal,
+	.key_equal = test_key_equal,
+	.remove_callback = test_remove_callback
+};
+
+PCUT_TEST_BEFORE
+{
+	rcu_register_fibril();
+	removed = 0;
+}
+
+PCUT_TEST_AFTER
+{
+	rcu_deregister_fibril();
+}
+
+static test_item_t *test_item_create(int key)
+{
+	test_item_t *item = malloc(sizeof(test_item_t));
+	PCUT_ASSERT_NOT_NULL(item);
+	item->key = key;
+	return item;
+}
+
+/** Insert, find and remove a single item. */
+PCUT_TEST(insert_find_remove)
+{
+	cht_t h;
+	int key = 42;
+
+	PCUT_ASSERT_TRUE(cht_create_simple(&h, &test_ops));
+
+	rcu_read_lock();
+	PCUT_ASSERT_NULL(cht_find(&h, &key));
+	rcu_read_unlock();
+
+	cht_insert(&h, &test_item_create(key)->link);
+
+	rcu_read_lock();
+	cht_link_t *link = cht_find(&h, &key);
+	PCUT_ASSERT_NOT_NULL(link);
+	PCUT_ASSERT_INT_EQUALS(key, cht_get_inst(link, test_item_t, link)->key);
+	rcu_read_unlock();
+
+	PCUT_ASSERT_INT_EQUALS(1, cht_remove_key(&h, &key));
+
+	rcu_read_lock();
+	PCUT_ASSERT_NULL(cht_find(&h, &key));
+	rcu_read_unlock();
+
+	cht_destroy(&h);
+	PCUT_ASSERT_INT_EQUALS(1, removed);
+}
+
+/** Unique insertion reports the existing item. */
+PCUT_TEST(insert_unique)
+{
+	cht_t h;
+	cht_link_t *dup;
+	test_item_t *item = test_item_create(7);
+	test_item_t *other = test_item_create(7);
+
+	PCUT_ASSERT_TRUE(cht_create_simple(&h, &test_ops));
+
+	rcu_read_lock();
+	PCUT_ASSERT_TRUE(cht_insert_unique(&h, &item->link, &dup));
+	PCUT_ASSERT_FALSE(cht_insert_unique(&h, &other->link, &dup));
+	PCUT_ASSERT_TRUE(dup == &item->link);
+	rcu_read_unlock();
+
+	free(other);
+
+	rcu_read_lock();
+	PCUT_ASSERT_TRUE(cht_remove_item(&h, &item->link));
+	rcu_read_unlock();
+
+	cht_destroy(&h);
+	PCUT_ASSERT_INT_EQUALS(1, removed);
+}
+
+/** All items remain reachable while the table grows and shrinks. */
+PCUT_TEST(resize)
+{
+	cht_t h;
+	int key;
+
+	PCUT_ASSERT_TRUE(cht_create(&h, 0, 0, 2, &test_ops));
+
+	for (key = 0; key < item_count; key++)
+		cht_insert(&h, &test_item_create(key)->link);
+
+	rcu_read_lock();
+	for (key = 0; key < item_count; key++)
+		PCUT_ASSERT_NOT_NULL(cht_find(&h, &key));
+	rcu_read_unlock();
+
+	for (key = 0; key < item_count; key++)
+		PCUT_ASSERT_INT_EQUALS(1, cht_remove_key(&h, &key));
+
+	rcu_read_lock();
+	for (key = 0; key < item_count; key++)
+		PCUT_ASSERT_NULL(cht_find(&h, &key));
+	rcu_read_unlock();
+
+	cht_destroy(&h);
+	PCUT_ASSERT_INT_EQUALS(item_count, removed);
+}
+
+PCUT_EXPORT(cht);
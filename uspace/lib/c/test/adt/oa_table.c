@@ -0,0 +1,185 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <adt/oa_table.h>
+#include <pcut/pcut.h>
+#include <stdint.h>
+
+PCUT_INIT;
+
+PCUT_TEST_SUITE(oa_table);
+
+enum {
+	/** Number of test items, enough to make the table grow a few times */
+	item_cnt = 1000
+};
+
+typedef struct {
+	int key;
+	bool present;
+} test_item_t;
+
+static test_item_t items[item_cnt];
+static size_t removed_cnt;
+
+static size_t test_hash(const void *item)
+{
+	/* Poor hash on purpose to get long probe sequences */
+	return ((const test_item_t *) item)->key % 10;
+}
+
+static size_t test_key_hash(const void *key)
+{
+	return *(const int *) key % 10;
+}
+
+static bool test_equal(const void *item1, const void *item2)
+{
+	return ((const test_item_t *) item1)->key ==
+	    ((const test_item_t *) item2)->key;
+}
+
+static bool test_key_equal(const void *key, const void *item)
+{
+	return *(const int *) key == ((const test_item_t *) item)->key;
+}
+
+static void test_remove_callback(void *item)
+{
+	((test_item_t *) item)->present = false;
+	removed_cnt++;
+}
+
+static oa_table_ops_t test_ops = {
+	.hash = test_hash,
+	.key_hash = test_key_hash,
+	.equal = test_equal,
+	.key_equal = test_key_equal,
+	.remove_callback = test_remove_callback
+};
+
+static bool count_item(void *item, void *arg)
+{
+	(*(size_t *) arg)++;
+	return true;
+}
+
+PCUT_TEST_BEFORE
+{
+	for (int i = 0; i < item_cnt; i++) {
+		items[i].key = i;
+		items[i].present = false;
+	}
+
+	removed_cnt = 0;
+}
+
+/** Insert, find and remove items while the table grows. */
+PCUT_TEST(insert_find_remove)
+{
+	oa_table_t table;
+	errno_t rc;
+	int i;
+
+	PCUT_ASSERT_TRUE(oa_table_create(&table, 0, &test_ops));
+	PCUT_ASSERT_TRUE(oa_table_empty(&table));
+
+	for (i = 0; i < item_cnt; i++) {
+		rc = oa_table_insert(&table, &items[i]);
+		PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+		items[i].present = true;
+
+		/* Items inserted so far must be found during the resize */
+		int key = i / 2;
+		PCUT_ASSERT_EQUALS(&items[key], oa_table_find(&table, &key));
+	}
+
+	PCUT_ASSERT_INT_EQUALS(item_cnt, oa_table_size(&table));
+
+	rc = oa_table_insert_unique(&table, &items[item_cnt / 2]);
+	PCUT_ASSERT_ERRNO_VAL(EEXIST, rc);
+
+	/* Remove every other item, alternating by key and by item */
+	for (i = 0; i < item_cnt; i += 2) {
+		if (i % 4 == 0) {
+			PCUT_ASSERT_TRUE(oa_table_remove(&table, &i));
+		} else {
+			oa_table_remove_item(&table, &items[i]);
+		}
+
+		PCUT_ASSERT_FALSE(items[i].present);
+		PCUT_ASSERT_FALSE(oa_table_remove(&table, &i));
+	}
+
+	PCUT_ASSERT_INT_EQUALS(item_cnt / 2, removed_cnt);
+	PCUT_ASSERT_INT_EQUALS(item_cnt / 2, oa_table_size(&table));
+
+	for (i = 0; i < item_cnt; i++) {
+		if (i % 2 == 0)
+			PCUT_ASSERT_NULL(oa_table_find(&table, &i));
+		else
+			PCUT_ASSERT_EQUALS(&items[i], oa_table_find(&table, &i));
+	}
+
+	size_t visited = 0;
+	oa_table_apply(&table, count_item, &visited);
+	PCUT_ASSERT_INT_EQUALS(item_cnt / 2, visited);
+
+	oa_table_destroy(&table);
+	PCUT_ASSERT_INT_EQUALS(item_cnt, removed_cnt);
+
+	for (i = 0; i < item_cnt; i++)
+		PCUT_ASSERT_FALSE(items[i].present);
+}
+
+/** Clear the table in the middle of a resize. */
+PCUT_TEST(clear)
+{
+	oa_table_t table;
+	errno_t rc;
+	int i;
+
+	PCUT_ASSERT_TRUE(oa_table_create(&table, 0, &test_ops));
+
+	for (i = 0; i < item_cnt; i++) {
+		rc = oa_table_insert_unique(&table, &items[i]);
+		PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+		items[i].present = true;
+	}
+
+	oa_table_clear(&table);
+	PCUT_ASSERT_TRUE(oa_table_empty(&table));
+	PCUT_ASSERT_INT_EQUALS(item_cnt, removed_cnt);
+
+	i = 0;
+	PCUT_ASSERT_NULL(oa_table_find(&table, &i));
+
+	oa_table_destroy(&table);
+}
+
+PCUT_EXPORT(oa_table);
@@ -0,0 +1,220 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <adt/hash.h>
+#include <adt/hash_table.h>
+#include <adt/odict.h>
+#include <mem.h>
+#include <pcut/pcut.h>
+#include <qsort.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <str.h>
+
+/*
+ * Benchmarks of libc hot paths.
+ *
+ * The statistics of every benchmark are part of the test report so
+ * that changes to the library can be compared against earlier runs.
+ */
+
+enum {
+	/** Number of entries in the searched containers */
+	bench_items = 1024,
+	/** Number of integers sorted by the qsort benchmark */
+	bench_sort_len = 256,
+	/** Size of the small allocation */
+	bench_small_size = 32,
+	/** Size of the large allocation */
+	bench_large_size = 64 * 1024
+};
+
+/** Benchmark entry stored both in the hash table and the dictionary */
+typedef struct {
+	ht_link_t link;
+	odlink_t odict;
+	int key;
+} bench_entry_t;
+
+static bench_entry_t entries[bench_items];
+static hash_table_t table;
+static odict_t odict;
+static int sort_template[bench_sort_len];
+static int sort_data[bench_sort_len];
+static char str_buf[128];
+static int next_key;
+
+static const char *str_a =
+    "The quick brown fox jumps over the lazy dog, 0123456789";
+static const char *str_b =
+    "The quick brown fox jumps over the lazy dog, 0123456780";
+
+static size_t bench_hash(const ht_link_t *item)
+{
+	bench_entry_t *e = hash_table_get_inst(item, bench_entry_t, link);
+	return hash_mix(e->key);
+}
+
+static size_t bench_key_hash(void *key)
+{
+	return hash_mix(*(int *) key);
+}
+
+static bool bench_key_equal(void *key, const ht_link_t *item)
+{
+	bench_entry_t *e = hash_table_get_inst(item, bench_entry_t, link);
+	return e->key == *(int *) key;
+}
+
+static hash_table_ops_t bench_ops = {
+	.hash = bench_hash,
+	.key_hash = bench_key_hash,
+	.key_equal = bench_key_equal,
+	.equal = NULL,
+	.remove_callback = NULL
+};
+
+static void *bench_getkey(odlink_t *odlink)
+{
+	return &odict_get_instance(odlink, bench_entry_t, odict)->key;
+}
+
+static int bench_cmp(void *a, void *b)
+{
+	return *(int *) a - *(int *) b;
+}
+
+static int bench_int_cmp(const void *a, const void *b)
+{
+	return *(const int *) a - *(const int *) b;
+}
+
+/** Return key of the next entry to look up */
+static int bench_next_key(void)
+{
+	next_key = (next_key + 7) % bench_items;
+	return next_key;
+}
+
+PCUT_INIT;
+
+PCUT_TEST_SUITE(bench);
+
+PCUT_TEST_BEFORE
+{
+	int i;
+
+	PCUT_ASSERT_TRUE(hash_table_create(&table, 0, 0, &bench_ops));
+	odict_initialize(&odict, bench_getkey, bench_cmp);
+
+	for (i = 0; i < bench_items; i++) {
+		entries[i].key = i;
+		hash_table_insert(&table, &entries[i].link);
+		odict_insert(&entries[i].odict, &odict, NULL);
+	}
+
+	/* Deterministic pseudo-random sequence */
+	for (i = 0; i < bench_sort_len; i++)
+		sort_template[i] = (i * 7919 + 13) % 1009;
+
+	next_key = 0;
+}
+
+PCUT_TEST_AFTER
+{
+	int i;
+
+	for (i = 0; i < bench_items; i++)
+		odict_remove(&entries[i].odict);
+
+	hash_table_destroy(&table);
+}
+
+/** Small allocation and deallocation */
+PCUT_BENCHMARK(malloc_free_small)
+{
+	void *p = malloc(bench_small_size);
+	PCUT_ASSERT_NOT_NULL(p);
+	free(p);
+}
+
+/** Large allocation and deallocation */
+PCUT_BENCHMARK(malloc_free_large)
+{
+	void *p = malloc(bench_large_size);
+	PCUT_ASSERT_NOT_NULL(p);
+	free(p);
+}
+
+/** Hash table lookup */
+PCUT_BENCHMARK(hash_table_find)
+{
+	int key = bench_next_key();
+	PCUT_ASSERT_NOT_NULL(hash_table_find(&table, &key));
+}
+
+/** Ordered dictionary lookup */
+PCUT_BENCHMARK(odict_find_eq)
+{
+	int key = bench_next_key();
+	PCUT_ASSERT_NOT_NULL(odict_find_eq(&odict, &key, NULL));
+}
+
+/** String comparison differing in the last character */
+PCUT_BENCHMARK(str_cmp)
+{
+	PCUT_ASSERT_TRUE(str_cmp(str_a, str_b) != 0);
+}
+
+/** String length */
+PCUT_BENCHMARK(str_length)
+{
+	PCUT_ASSERT_TRUE(str_length(str_a) > 0);
+}
+
+/** String copy */
+PCUT_BENCHMARK(str_cpy)
+{
+	str_cpy(str_buf, sizeof(str_buf), str_a);
+}
+
+/** Formatting of integers and strings */
+PCUT_BENCHMARK(snprintf)
+{
+	snprintf(str_buf, sizeof(str_buf), "%d %s %x %zu", next_key, "fox",
+	    0xbeef, sizeof(str_buf));
+}
+
+/** Sorting of a short integer sequence (includes copying the input) */
+PCUT_BENCHMARK(qsort)
+{
+	memcpy(sort_data, sort_template, sizeof(sort_data));
+	qsort(sort_data, bench_sort_len, sizeof(int), bench_int_cmp);
+}
+
+PCUT_EXPORT(bench);
@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <fibril.h>
+#include <pcut/pcut.h>
+#include <stdbool.h>
+
+PCUT_INIT;
+
+PCUT_TEST_SUITE(fibril_stack);
+
+enum {
+	/** Stack size not used by any other fibril */
+	test_stack_size = 5 * 4096
+};
+
+static errno_t test_fibril_fn(void *arg)
+{
+	bool *done = (bool *) arg;
+
+	*done = true;
+	return EOK;
+}
+
+/** Stack of a destroyed fibril is reused by the next fibril */
+PCUT_TEST(stack_reuse)
+{
+	fibril_stack_stats_t before;
+	fibril_stack_stats_t after;
+	fid_t fid;
+
+	fid = fibril_create_generic(test_fibril_fn, NULL, test_stack_size);
+	PCUT_ASSERT_TRUE(fid != 0);
+	fibril_destroy(fid);
+
+	fibril_stack_stats(&before);
+
+	fid = fibril_create_generic(test_fibril_fn, NULL, test_stack_size);
+	PCUT_ASSERT_TRUE(fid != 0);
+
+	fibril_stack_stats(&after);
+	PCUT_ASSERT_INT_EQUALS(before.stack_reused + 1, after.stack_reused);
+	PCUT_ASSERT_INT_EQUALS(before.stack_allocated, after.stack_allocated);
+
+	fibril_destroy(fid);
+}
+
+/** Stack usage of a finished fibril is reported */
+PCUT_TEST(stack_hwm)
+{
+	fibril_stack_stats_t stats;
+	bool done = false;
+	fid_t fid;
+
+	fid = fibril_create_generic(test_fibril_fn, &done, test_stack_size);
+	PCUT_ASSERT_TRUE(fid != 0);
+	fibril_add_ready(fid);
+
+	while (!done)
+		fibril_yield();
+
+	/* Let the dead fibril be cleaned up */
+	fibril_yield();
+
+	fibril_stack_stats(&stats);
+	PCUT_ASSERT_TRUE(stats.stack_hwm > 0);
+	PCUT_ASSERT_TRUE(stats.stack_hwm <= test_stack_size);
+}
+
+PCUT_EXPORT(fibril_stack);
@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2018 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <inet/checksum.h>
+#include <pcut/pcut.h>
+#include <stdint.h>
+
+enum {
+	/** Size of test data */
+	test_data_size = 1031
+};
+
+/** Reference checksum implementation processing one 16-bit word at a time.
+ *
+ * @param ivalue Initial value
+ * @param data   Data
+ * @param size   Data size
+ * @return Checksum
+ */
+static uint16_t test_checksum_ref(uint16_t ivalue, const uint8_t *data,
+    size_t size)
+{
+	uint32_t sum;
+	size_t i;
+
+	sum = (uint16_t) ~ivalue;
+
+	for (i = 0; i + 1 < size; i += 2) {
+		sum += ((uint16_t) data[i] << 8) | data[i + 1];
+		sum = (sum & 0xffff) + (sum >> 16);
+	}
+
+	if (size % 2 != 0) {
+		sum += (uint16_t) data[size - 1] << 8;
+		sum = (sum & 0xffff) + (sum >> 16);
+	}
+
+	return ~sum;
+}
+
+/** Fill buffer with test pattern */
+static void test_fill(uint8_t *data, size_t size)
+{
+	uint32_t x = 12345;
+	size_t i;
+
+	for (i = 0; i < size; i++) {
+		x = x * 1103515245 + 12345;
+		data[i] = x >> 16;
+	}
+}
+
+PCUT_INIT;
+
+PCUT_TEST_SUITE(inet_checksum);
+
+/** Checksum of known data (RFC 1071 sec. 3 example) */
+PCUT_TEST(example)
+{
+	uint8_t data[] = { 0x00, 0x01, 0xf2, 0x03, 0xf4, 0xf5, 0xf6, 0xf7 };
+
+	PCUT_ASSERT_INT_EQUALS((uint16_t) ~0xddf2,
+	    inet_checksum_calc(INET_CHECKSUM_INIT, data, sizeof(data)));
+}
+
+/** Checksum matches reference implementation for all sizes and alignments */
+PCUT_TEST(sizes)
+{
+	uint8_t data[test_data_size];
+	size_t offs;
+	size_t size;
+
+	test_fill(data, sizeof(data));
+
+	for (offs = 0; offs < 8; offs++) {
+		for (size = 0; size + offs <= sizeof(data); size += 7) {
+			PCUT_ASSERT_INT_EQUALS(
+			    test_checksum_ref(INET_CHECKSUM_INIT, data + offs,
+			    size),
+			    inet_checksum_calc(INET_CHECKSUM_INIT, data + offs,
+			    size));
+		}
+	}
+}
+
+/** Checksum can be computed in parts */
+PCUT_TEST(parts)
+{
+	uint8_t data[test_data_size];
+	uint16_t cs;
+
+	test_fill(data, sizeof(data));
+
+	cs = inet_checksum_calc(INET_CHECKSUM_INIT, data, 12);
+	cs = inet_checksum_calc(cs, data + 12, 100);
+	cs = inet_checksum_calc(cs, data + 112, sizeof(data) - 112);
+
+	PCUT_ASSERT_INT_EQUALS(inet_checksum_calc(INET_CHECKSUM_INIT, data,
+	    sizeof(data)), cs);
+}
+
+/** Incremental update gives the same result as computing checksum again */
+PCUT_TEST(update)
+{
+	uint8_t data[64];
+	uint16_t cs;
+	uint16_t o16;
+	uint32_t o32;
+
+	test_fill(data, sizeof(data));
+	cs = inet_checksum_calc(INET_CHECKSUM_INIT, data, sizeof(data));
+
+	o16 = ((uint16_t) data[8] << 8) | data[9];
+	data[8] = 0x12;
+	data[9] = 0x34;
+	cs = inet_checksum_update16(cs, o16, 0x1234);
+	PCUT_ASSERT_INT_EQUALS(inet_checksum_calc(INET_CHECKSUM_INIT, data,
+	    sizeof(data)), cs);
+
+	o32 = ((uint32_t) data[12] << 24) | ((uint32_t) data[13] << 16) |
+	    ((uint32_t) data[14] << 8) | data[15];
+	data[12] = 0xfe;
+	data[13] = 0xdc;
+	data[14] = 0xba;
+	data[15] = 0x98;
+	cs = inet_checksum_update32(cs, o32, 0xfedcba98);
+	PCUT_ASSERT_INT_EQUALS(inet_checksum_calc(INET_CHECKSUM_INIT, data,
+	    sizeof(data)), cs);
+}
+
+PCUT_EXPORT(inet_checksum);
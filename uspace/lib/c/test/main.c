@@ -31,16 +31,26 @@
 
 PCUT_INIT;
 
+PCUT_IMPORT(bench);
 PCUT_IMPORT(circ_buf);
+PCUT_IMPORT(cht);
+PCUT_IMPORT(oa_table);
+PCUT_IMPORT(fibril_stack);
 PCUT_IMPORT(fibril_timer);
+PCUT_IMPORT(inet_checksum);
 PCUT_IMPORT(mem);
 PCUT_IMPORT(odict);
 PCUT_IMPORT(qsort);
 PCUT_IMPORT(scanf);
+PCUT_IMPORT(slab);
 PCUT_IMPORT(sprintf);
 PCUT_IMPORT(stdio);
 PCUT_IMPORT(stdlib);
 PCUT_IMPORT(str);
 PCUT_IMPORT(table);
+PCUT_IMPORT(time);
+PCUT_IMPORT(vfs_aio);
+PCUT_IMPORT(vfs_direct);
+PCUT_IMPORT(vfs_walk_read);
 
 PCUT_MAIN();
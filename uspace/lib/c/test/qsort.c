@@ -33,7 +33,9 @@
 
 enum {
 	/** Length of test number sequences */
-	test_seq_len = 5
+	test_seq_len = 5,
+	/** Length of long test number sequences */
+	test_long_seq_len = 1000
 };
 
 /** Test compare function.
@@ -50,6 +52,17 @@ static int test_cmp(const void *a, const void *b)
 	return *ia - *ib;
 }
 
+/** Test compare function for characters.
+ *
+ * @param a First key
+ * @param b Second key
+ * @return <0, 0, >0 if @a a is less than, equal or greater than @a b
+ */
+static int test_cmp_char(const void *a, const void *b)
+{
+	return *(const char *)a - *(const char *)b;
+}
+
 static void bubble_sort(int *seq, size_t nmemb)
 {
 	size_t i;
@@ -171,4 +184,56 @@ PCUT_TEST(pseudorandom_seq)
 	free(seq2);
 }
 
+/** Test sorting long sequences that defeat naive pivot selection. */
+PCUT_TEST(long_seq)
+{
+	int *seq;
+	int i;
+
+	seq = calloc(test_long_seq_len, sizeof(int));
+	PCUT_ASSERT_NOT_NULL(seq);
+
+	/* Organ pipe */
+	for (i = 0; i < test_long_seq_len; i++)
+		seq[i] = (i % 2 == 0) ? i : test_long_seq_len - i;
+
+	qsort(seq, test_long_seq_len, sizeof(int), test_cmp);
+
+	for (i = 1; i < test_long_seq_len; i++)
+		PCUT_ASSERT_TRUE(seq[i - 1] <= seq[i]);
+
+	/* Many duplicates */
+	for (i = 0; i < test_long_seq_len; i++)
+		seq[i] = seq_next(i + 1) % 7;
+
+	qsort(seq, test_long_seq_len, sizeof(int), test_cmp);
+
+	for (i = 1; i < test_long_seq_len; i++)
+		PCUT_ASSERT_TRUE(seq[i - 1] <= seq[i]);
+
+	free(seq);
+}
+
+/** Test sorting elements whose size is not a multiple of word size. */
+PCUT_TEST(odd_size_seq)
+{
+	char seq[3 * test_long_seq_len];
+	int i;
+
+	for (i = 0; i < test_long_seq_len; i++) {
+		seq[3 * i] = seq_next(i + 1) % 100;
+		seq[3 * i + 1] = seq[3 * i];
+		seq[3 * i + 2] = seq[3 * i];
+	}
+
+	qsort(seq, test_long_seq_len, 3, test_cmp_char);
+
+	for (i = 0; i < test_long_seq_len; i++) {
+		PCUT_ASSERT_INT_EQUALS(seq[3 * i], seq[3 * i + 1]);
+		PCUT_ASSERT_INT_EQUALS(seq[3 * i], seq[3 * i + 2]);
+		if (i > 0)
+			PCUT_ASSERT_TRUE(seq[3 * (i - 1)] <= seq[3 * i]);
+	}
+}
+
 PCUT_EXPORT(qsort);
@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2018 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <pcut/pcut.h>
+#include <slab.h>
+#include <stdint.h>
+
+enum {
+	/** Number of objects allocated at once */
+	test_obj_count = 100
+};
+
+typedef struct {
+	uint32_t magic;
+	uint8_t data[40];
+} test_obj_t;
+
+static size_t test_ctor_count;
+static size_t test_dtor_count;
+
+static errno_t test_ctor(void *obj)
+{
+	((test_obj_t *) obj)->magic = 0x5ab1e;
+	test_ctor_count++;
+	return EOK;
+}
+
+static void test_dtor(void *obj)
+{
+	test_dtor_count++;
+}
+
+PCUT_INIT;
+
+PCUT_TEST_SUITE(slab);
+
+/** Objects are constructed once and destroyed with the cache */
+PCUT_TEST(ctor_dtor)
+{
+	test_obj_t *objs[test_obj_count];
+	slab_cache_t *cache;
+	size_t i;
+
+	test_ctor_count = 0;
+	test_dtor_count = 0;
+
+	cache = slab_cache_create("test_obj_t", sizeof(test_obj_t), 0,
+	    test_ctor, test_dtor);
+	PCUT_ASSERT_NOT_NULL(cache);
+
+	for (i = 0; i < test_obj_count; i++) {
+		objs[i] = slab_alloc(cache);
+		PCUT_ASSERT_NOT_NULL(objs[i]);
+		PCUT_ASSERT_INT_EQUALS(0x5ab1e, objs[i]->magic);
+	}
+
+	PCUT_ASSERT_INT_EQUALS(test_obj_count, test_ctor_count);
+
+	for (i = 0; i < test_obj_count; i++)
+		slab_free(cache, objs[i]);
+
+	/* Cached objects are reused without construction. */
+	for (i = 0; i < test_obj_count; i++) {
+		objs[i] = slab_alloc(cache);
+		PCUT_ASSERT_NOT_NULL(objs[i]);
+	}
+
+	PCUT_ASSERT_INT_EQUALS(test_obj_count, test_ctor_count);
+
+	for (i = 0; i < test_obj_count; i++)
+		slab_free(cache, objs[i]);
+
+	slab_cache_destroy(cache);
+	PCUT_ASSERT_INT_EQUALS(test_ctor_count, test_dtor_count);
+}
+
+/** Simultaneously allocated objects do not overlap and are aligned */
+PCUT_TEST(distinct_aligned)
+{
+	void *objs[test_obj_count];
+	slab_cache_t *cache;
+	size_t i, j;
+
+	cache = slab_cache_create("test_aligned", 24, 32, NULL, NULL);
+	PCUT_ASSERT_NOT_NULL(cache);
+
+	for (i = 0; i < test_obj_count; i++) {
+		objs[i] = slab_alloc(cache);
+		PCUT_ASSERT_NOT_NULL(objs[i]);
+		PCUT_ASSERT_INT_EQUALS(0, (uintptr_t) objs[i] % 32);
+
+		for (j = 0; j < i; j++)
+			PCUT_ASSERT_FALSE(objs[i] == objs[j]);
+	}
+
+	for (i = 0; i < test_obj_count; i++)
+		slab_free(cache, objs[i]);
+
+	slab_cache_destroy(cache);
+}
+
+PCUT_EXPORT(slab);
@@ -37,6 +37,7 @@
 #include <errno.h>
 #include <pcut/pcut.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <str.h>
 #include <tmpfile.h>
 #include <vfs/vfs.h>
@@ -224,4 +225,125 @@ PCUT_TEST(perror_msg)
 	perror("This is a test");
 }
 
+/** Large transfers bypassing the stream buffer */
+PCUT_TEST(fread_fwrite_large)
+{
+	size_t size = 3 * BUFSIZ * 16 + 7;
+	uint8_t *wbuf;
+	uint8_t *rbuf;
+	size_t i;
+	size_t n;
+	FILE *f;
+
+	wbuf = malloc(size);
+	PCUT_ASSERT_NOT_NULL(wbuf);
+	rbuf = malloc(size);
+	PCUT_ASSERT_NOT_NULL(rbuf);
+
+	for (i = 0; i < size; i++)
+		wbuf[i] = i % 251;
+
+	f = tmpfile();
+	PCUT_ASSERT_NOT_NULL(f);
+
+	/* Small write followed by a large one */
+	n = fwrite(wbuf, 1, 5, f);
+	PCUT_ASSERT_INT_EQUALS(5, n);
+	n = fwrite(wbuf + 5, 1, size - 5, f);
+	PCUT_ASSERT_INT_EQUALS(size - 5, n);
+
+	rewind(f);
+
+	/* Small read followed by a large one */
+	n = fread(rbuf, 1, 3, f);
+	PCUT_ASSERT_INT_EQUALS(3, n);
+	n = fread(rbuf + 3, 1, size - 3, f);
+	PCUT_ASSERT_INT_EQUALS(size - 3, n);
+
+	PCUT_ASSERT_INT_EQUALS(0, memcmp(wbuf, rbuf, size));
+
+	n = fread(rbuf, 1, 1, f);
+	PCUT_ASSERT_INT_EQUALS(0, n);
+	PCUT_ASSERT_TRUE(feof(f));
+
+	(void) fclose(f);
+	free(wbuf);
+	free(rbuf);
+}
+
+/** fmemopen function */
+PCUT_TEST(fmemopen)
+{
+	char buf[16];
+	char rbuf[16];
+	size_t n;
+	FILE *f;
+
+	str_cpy(buf, sizeof(buf), "hello");
+
+	f = fmemopen(buf, sizeof(buf), "a+");
+	PCUT_ASSERT_NOT_NULL(f);
+
+	n = fwrite(" world", 1, 6, f);
+	PCUT_ASSERT_INT_EQUALS(6, n);
+	PCUT_ASSERT_STR_EQUALS("hello world", buf);
+
+	rewind(f);
+	n = fread(rbuf, 1, sizeof(rbuf), f);
+	PCUT_ASSERT_INT_EQUALS(11, n);
+	PCUT_ASSERT_INT_EQUALS(0, memcmp(rbuf, "hello world", 11));
+
+	PCUT_ASSERT_INT_EQUALS(0, fseek(f, -5, SEEK_END));
+	PCUT_ASSERT_INT_EQUALS('w', fgetc(f));
+
+	/* Writes beyond the buffer are cut short */
+	n = fwrite("0123456789", 1, 10, f);
+	PCUT_ASSERT_INT_EQUALS(5, n);
+	PCUT_ASSERT_TRUE(ferror(f));
+
+	(void) fclose(f);
+
+	/* Buffer allocated by fmemopen() */
+	f = fmemopen(NULL, 8, "w+");
+	PCUT_ASSERT_NOT_NULL(f);
+	PCUT_ASSERT_INT_EQUALS(3, fwrite("abc", 1, 3, f));
+	rewind(f);
+	PCUT_ASSERT_INT_EQUALS('a', fgetc(f));
+	(void) fclose(f);
+}
+
+/** open_memstream function */
+PCUT_TEST(open_memstream)
+{
+	char *ptr;
+	size_t size;
+	size_t i;
+	FILE *f;
+	int rc;
+
+	f = open_memstream(&ptr, &size);
+	PCUT_ASSERT_NOT_NULL(f);
+
+	rc = fputs("abc", f);
+	PCUT_ASSERT_TRUE(rc >= 0);
+
+	rc = fflush(f);
+	PCUT_ASSERT_INT_EQUALS(0, rc);
+	PCUT_ASSERT_INT_EQUALS(3, size);
+	PCUT_ASSERT_STR_EQUALS("abc", ptr);
+
+	/* Grow well beyond the initial buffer */
+	for (i = 0; i < 2 * BUFSIZ; i++) {
+		rc = fputc('x', f);
+		PCUT_ASSERT_INT_EQUALS('x', rc);
+	}
+
+	(void) fclose(f);
+
+	PCUT_ASSERT_INT_EQUALS(3 + 2 * BUFSIZ, size);
+	PCUT_ASSERT_INT_EQUALS(3 + 2 * BUFSIZ, str_size(ptr));
+	PCUT_ASSERT_INT_EQUALS('x', ptr[size - 1]);
+	free(ptr);
+}
+
 PCUT_EXPORT(stdio);
@@ -87,5 +87,72 @@ PCUT_TEST(ltrim)
 	EQ("AAAšš", buffer);
 }
 
+PCUT_TEST(size_unaligned)
+{
+	const char *text = "/usr/share/doc/helenos/šíleně/readme.txt";
+	size_t len = 0;
+
+	while (text[len] != 0)
+		len++;
+
+	for (size_t shift = 0; shift < 8; shift++) {
+		SET_BUFFER("");
+		snprintf(buffer + shift, BUFFER_SIZE - shift, "%s", text);
+		PCUT_ASSERT_INT_EQUALS(len, str_size(buffer + shift));
+		PCUT_ASSERT_INT_EQUALS(0, str_size(buffer + shift + len));
+	}
+}
+
+PCUT_TEST(cmp_ascii_and_utf8)
+{
+	PCUT_ASSERT_INT_EQUALS(0, str_cmp("", ""));
+	PCUT_ASSERT_INT_EQUALS(0, str_cmp("/data/web/index.html",
+	    "/data/web/index.html"));
+	PCUT_ASSERT_INT_EQUALS(-1, str_cmp("/data/web/index.htm",
+	    "/data/web/index.html"));
+	PCUT_ASSERT_INT_EQUALS(1, str_cmp("/data/web/index.html",
+	    "/data/web/index.htm"));
+	PCUT_ASSERT_INT_EQUALS(-1, str_cmp("/data/web/indea.html",
+	    "/data/web/index.html"));
+
+	/* Difference right after a long common ASCII prefix */
+	PCUT_ASSERT_INT_EQUALS(-1, str_cmp("Content-Type: text/plain",
+	    "Content-Type: text/plaiš"));
+	PCUT_ASSERT_INT_EQUALS(1, str_cmp("Content-Type: text/plaiš",
+	    "Content-Type: text/plain"));
+	PCUT_ASSERT_INT_EQUALS(-1, str_cmp("Content-Type: š", "Content-Type: ž"));
+
+	/* Same strings at different alignments */
+	SET_BUFFER("x/usr/share/fonts/ščř");
+	PCUT_ASSERT_INT_EQUALS(0, str_cmp(buffer + 1, "/usr/share/fonts/ščř"));
+	PCUT_ASSERT_INT_EQUALS(1, str_cmp(buffer + 1, "/usr/share/fonts/šc"));
+
+	PCUT_ASSERT_INT_EQUALS(0, str_lcmp("/usr/share", "/usr/local", 5));
+	PCUT_ASSERT_INT_EQUALS(1, str_lcmp("/usr/share", "/usr/local", 6));
+	PCUT_ASSERT_INT_EQUALS(0, str_lcmp("/usr/šare", "/usr/šárka", 6));
+	PCUT_ASSERT_INT_EQUALS(-1, str_lcmp("/usr/šare", "/usr/šárka", 7));
+}
+
+PCUT_TEST(chr_ascii_and_utf8)
+{
+	SET_BUFFER("GET /index.html HTTP/1.1");
+	PCUT_ASSERT_EQUALS(buffer + 3, str_chr(buffer, ' '));
+	PCUT_ASSERT_EQUALS(buffer + 4, str_chr(buffer, '/'));
+	PCUT_ASSERT_EQUALS(buffer + 21, str_chr(buffer, '1'));
+	PCUT_ASSERT_NULL(str_chr(buffer, '?'));
+
+	for (size_t shift = 0; shift < 8; shift++) {
+		SET_BUFFER("");
+		snprintf(buffer + shift, BUFFER_SIZE - shift, "%s",
+		    "abcdefghijklmnopqrstuvwxyz/šířka");
+		PCUT_ASSERT_EQUALS(buffer + shift + 26,
+		    str_chr(buffer + shift, '/'));
+		PCUT_ASSERT_EQUALS(buffer + shift + 29,
+		    str_chr(buffer + shift, L'í'));
+		PCUT_ASSERT_EQUALS(buffer + shift + 33,
+		    str_chr(buffer + shift, 'k'));
+		PCUT_ASSERT_NULL(str_chr(buffer + shift, '.'));
+	}
+}
 
 PCUT_EXPORT(str);
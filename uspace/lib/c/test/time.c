@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <pcut/pcut.h>
+#include <stdint.h>
+#include <sys/time.h>
+
+PCUT_INIT;
+
+PCUT_TEST_SUITE(time);
+
+/** Uptime in nanoseconds never goes backwards */
+PCUT_TEST(uptime_nsec_monotonic)
+{
+	uint64_t prev = getuptime_nsec();
+
+	for (unsigned int i = 0; i < 1000; i++) {
+		uint64_t now = getuptime_nsec();
+		PCUT_ASSERT_TRUE(now >= prev);
+		prev = now;
+	}
+}
+
+/** Uptime in nanoseconds agrees with the microsecond uptime */
+PCUT_TEST(uptime_nsec_getuptime)
+{
+	struct timeval tv;
+
+	uint64_t before = getuptime_nsec();
+	getuptime(&tv);
+	uint64_t after = getuptime_nsec();
+
+	uint64_t usec = (uint64_t) tv.tv_sec * 1000000 + tv.tv_usec;
+
+	/* Allow for the tick resolution of the fallback path */
+	PCUT_ASSERT_TRUE(usec + 1000000 >= before / 1000);
+	PCUT_ASSERT_TRUE(usec <= after / 1000 + 1000000);
+}
+
+/** Sleeping is reflected in the uptime in nanoseconds */
+PCUT_TEST(uptime_nsec_sleep)
+{
+	uint64_t start = getuptime_nsec();
+	usleep(20000);
+	uint64_t end = getuptime_nsec();
+
+	PCUT_ASSERT_TRUE(end - start >= 10000000);
+}
+
+PCUT_EXPORT(time);
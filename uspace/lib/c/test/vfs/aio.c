@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2018 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <pcut/pcut.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vfs/aio.h>
+#include <vfs/vfs.h>
+
+PCUT_INIT;
+
+PCUT_TEST_SUITE(vfs_aio);
+
+enum {
+	test_chunks = 4,
+	test_chunk_size = 1024
+};
+
+/** Wait for @a cnt completions and check that they succeeded. */
+static void wait_all(vfs_aio_t *aio, size_t cnt, size_t nbytes)
+{
+	vfs_aio_cqe_t cqe[test_chunks];
+	size_t done = 0;
+	size_t n;
+	errno_t rc;
+
+	while (done < cnt) {
+		rc = vfs_aio_wait(aio, cqe, test_chunks, &n);
+		PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+		for (size_t i = 0; i < n; i++) {
+			PCUT_ASSERT_ERRNO_VAL(EOK, cqe[i].rc);
+			PCUT_ASSERT_INT_EQUALS(nbytes, cqe[i].nbytes);
+		}
+		done += n;
+	}
+
+	PCUT_ASSERT_INT_EQUALS(cnt, done);
+}
+
+PCUT_TEST(create_destroy)
+{
+	vfs_aio_t *aio;
+	vfs_aio_cqe_t cqe;
+	size_t n;
+	errno_t rc;
+
+	rc = vfs_aio_create(0, &aio);
+	PCUT_ASSERT_ERRNO_VAL(EINVAL, rc);
+
+	rc = vfs_aio_create(1, &aio);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	PCUT_ASSERT_INT_EQUALS(0, vfs_aio_poll(aio, &cqe, 1));
+	rc = vfs_aio_wait(aio, &cqe, 1, &n);
+	PCUT_ASSERT_ERRNO_VAL(ENOENT, rc);
+
+	vfs_aio_destroy(aio);
+}
+
+PCUT_TEST(write_read)
+{
+	char name[L_tmpnam];
+	vfs_aio_sqe_t sqe[test_chunks];
+	vfs_aio_t *aio;
+	char *wbuf;
+	char *rbuf;
+	int fd;
+	errno_t rc;
+
+	wbuf = malloc(test_chunks * test_chunk_size);
+	PCUT_ASSERT_NOT_NULL(wbuf);
+	rbuf = calloc(test_chunks, test_chunk_size);
+	PCUT_ASSERT_NOT_NULL(rbuf);
+
+	for (size_t i = 0; i < test_chunks * test_chunk_size; i++)
+		wbuf[i] = i % 251;
+
+	PCUT_ASSERT_NOT_NULL(tmpnam(name));
+	rc = vfs_lookup_open(name, WALK_REGULAR | WALK_MAY_CREATE,
+	    MODE_READ | MODE_WRITE, &fd);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	rc = vfs_aio_create(test_chunks, &aio);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	/* Write the chunks in reverse order */
+	for (size_t i = 0; i < test_chunks; i++) {
+		size_t c = test_chunks - 1 - i;
+
+		sqe[i].op = VFS_AIO_WRITE;
+		sqe[i].file = fd;
+		sqe[i].pos = c * test_chunk_size;
+		sqe[i].buf = wbuf + c * test_chunk_size;
+		sqe[i].size = test_chunk_size;
+		sqe[i].arg = NULL;
+	}
+
+	PCUT_ASSERT_INT_EQUALS(test_chunks,
+	    vfs_aio_submit(aio, sqe, test_chunks));
+	wait_all(aio, test_chunks, test_chunk_size);
+
+	sqe[0].op = VFS_AIO_SYNC;
+	PCUT_ASSERT_INT_EQUALS(1, vfs_aio_submit(aio, sqe, 1));
+	wait_all(aio, 1, 0);
+
+	for (size_t i = 0; i < test_chunks; i++) {
+		sqe[i].op = VFS_AIO_READ;
+		sqe[i].pos = i * test_chunk_size;
+		sqe[i].buf = rbuf + i * test_chunk_size;
+	}
+
+	PCUT_ASSERT_INT_EQUALS(test_chunks,
+	    vfs_aio_submit(aio, sqe, test_chunks));
+	wait_all(aio, test_chunks, test_chunk_size);
+
+	for (size_t i = 0; i < test_chunks * test_chunk_size; i++)
+		PCUT_ASSERT_INT_EQUALS(wbuf[i], rbuf[i]);
+
+	vfs_aio_destroy(aio);
+	vfs_put(fd);
+	rc = vfs_unlink_path(name);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	free(wbuf);
+	free(rbuf);
+}
+
+PCUT_EXPORT(vfs_aio);
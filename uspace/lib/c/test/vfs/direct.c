@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2018 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <mem.h>
+#include <pcut/pcut.h>
+#include <stdio.h>
+#include <vfs/vfs.h>
+
+PCUT_INIT;
+
+PCUT_TEST_SUITE(vfs_direct);
+
+/** Reading through a direct session returns what was written via VFS */
+PCUT_TEST(read)
+{
+	char name[L_tmpnam];
+	char wbuf[100];
+	char rbuf[sizeof(wbuf) + 1];
+	vfs_direct_t *direct;
+	aoff64_t pos;
+	size_t n;
+	int fd;
+	errno_t rc;
+
+	for (size_t i = 0; i < sizeof(wbuf); i++)
+		wbuf[i] = 'a' + i % 26;
+
+	PCUT_ASSERT_NOT_NULL(tmpnam(name));
+	rc = vfs_lookup_open(name, WALK_REGULAR | WALK_MAY_CREATE,
+	    MODE_READ | MODE_WRITE, &fd);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	pos = 0;
+	rc = vfs_write(fd, &pos, wbuf, sizeof(wbuf), &n);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(sizeof(wbuf), n);
+
+	rc = vfs_direct_open(fd, &direct);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	/* Read in two parts, the second one hits the end of file */
+	pos = 0;
+	rc = vfs_direct_read(direct, &pos, rbuf, 10, &n);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(10, n);
+	PCUT_ASSERT_INT_EQUALS(10, pos);
+
+	rc = vfs_direct_read(direct, &pos, rbuf + 10, sizeof(rbuf) - 10, &n);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(sizeof(wbuf) - 10, n);
+	PCUT_ASSERT_INT_EQUALS(0, memcmp(wbuf, rbuf, sizeof(wbuf)));
+
+	vfs_direct_close(direct);
+	vfs_put(fd);
+
+	rc = vfs_unlink_path(name);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+}
+
+PCUT_EXPORT(vfs_direct);
@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <mem.h>
+#include <pcut/pcut.h>
+#include <stdio.h>
+#include <vfs/vfs.h>
+
+PCUT_INIT;
+
+PCUT_TEST_SUITE(vfs_walk_read);
+
+/** Create a temporary file with the given contents */
+static void create_file(char *name, const void *data, size_t size)
+{
+	aoff64_t pos = 0;
+	size_t n;
+	int fd;
+	errno_t rc;
+
+	PCUT_ASSERT_NOT_NULL(tmpnam(name));
+	rc = vfs_lookup_open(name, WALK_REGULAR | WALK_MAY_CREATE,
+	    MODE_WRITE, &fd);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	rc = vfs_write(fd, &pos, data, size, &n);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(size, n);
+
+	vfs_put(fd);
+}
+
+/** A small file is read whole by a single request */
+PCUT_TEST(whole)
+{
+	char name[L_tmpnam];
+	char wbuf[100];
+	char rbuf[200];
+	aoff64_t size;
+	size_t n;
+	errno_t rc;
+
+	for (size_t i = 0; i < sizeof(wbuf); i++)
+		wbuf[i] = 'a' + i % 26;
+	create_file(name, wbuf, sizeof(wbuf));
+
+	rc = vfs_lookup_read(name, rbuf, sizeof(rbuf), &n, &size, NULL);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(sizeof(wbuf), n);
+	PCUT_ASSERT_INT_EQUALS(sizeof(wbuf), size);
+	PCUT_ASSERT_INT_EQUALS(0, memcmp(wbuf, rbuf, sizeof(wbuf)));
+
+	rc = vfs_unlink_path(name);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+}
+
+/** The file can be kept open to read the rest of it */
+PCUT_TEST(keep_open)
+{
+	char name[L_tmpnam];
+	char wbuf[100];
+	char rbuf[sizeof(wbuf)];
+	aoff64_t size;
+	aoff64_t pos;
+	size_t n;
+	int fd;
+	errno_t rc;
+
+	for (size_t i = 0; i < sizeof(wbuf); i++)
+		wbuf[i] = 'a' + i % 26;
+	create_file(name, wbuf, sizeof(wbuf));
+
+	rc = vfs_lookup_read(name, rbuf, 10, &n, &size, &fd);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(10, n);
+	PCUT_ASSERT_INT_EQUALS(sizeof(wbuf), size);
+
+	pos = n;
+	rc = vfs_read(fd, &pos, rbuf + n, sizeof(rbuf) - n, &n);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(sizeof(wbuf) - 10, n);
+	PCUT_ASSERT_INT_EQUALS(0, memcmp(wbuf, rbuf, sizeof(wbuf)));
+
+	vfs_put(fd);
+
+	rc = vfs_unlink_path(name);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+}
+
+/** Reading a file that does not exist fails */
+PCUT_TEST(noent)
+{
+	char name[L_tmpnam];
+	char rbuf[10];
+	size_t n;
+	errno_t rc;
+
+	PCUT_ASSERT_NOT_NULL(tmpnam(name));
+	rc = vfs_lookup_read(name, rbuf, sizeof(rbuf), &n, NULL, NULL);
+	PCUT_ASSERT_ERRNO_VAL(ENOENT, rc);
+}
+
+PCUT_EXPORT(vfs_walk_read);
@@ -0,0 +1,1177 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @file
+ * @brief Implementation of deflate compression
+ *
+ * A deflate compressor (RFC 1951) producing the stream incrementally.
+ * The input is collected in a sliding window of twice the maximum
+ * distance, matches are found using hash chains of 3-byte prefixes.
+ * Low levels take the first good match (greedy matching), higher levels
+ * check whether a longer match starts at the next byte before committing
+ * (lazy matching).
+ *
+ * Symbols are collected into blocks and each block is emitted with
+ * whichever of the stored, fixed and dynamic Huffman encodings is the
+ * shortest.
+ *
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <mem.h>
+#include <macros.h>
+#include <stdlib.h>
+#include "deflate.h"
+
+/** Maximum back-reference distance */
+#define WINDOW_SIZE  32768
+#define WINDOW_MASK  (WINDOW_SIZE - 1)
+
+#define MIN_MATCH  3
+#define MAX_MATCH  258
+
+/** Input needed ahead of the current position to find the longest match */
+#define MIN_LOOKAHEAD  (MAX_MATCH + MIN_MATCH + 1)
+
+/** Maximum distance used, so that matches never reach a slid out window */
+#define MAX_DISTANCE  (WINDOW_SIZE - MIN_LOOKAHEAD)
+
+/** Shortest matches are not worth it over longer distances */
+#define TOO_FAR  4096
+
+#define HASH_BITS  15
+#define HASH_SIZE  (1 << HASH_BITS)
+#define HASH_MASK  (HASH_SIZE - 1)
+
+/** Hash chain terminator (position 0 is never matched) */
+#define NIL  0
+
+/** Highest level using greedy matching */
+#define MAX_GREEDY_LEVEL  3
+
+/** Number of symbols collected before a block is emitted */
+#define SYMBOLS_SIZE  16384
+
+/** Size of the output buffer */
+#define OUTPUT_SIZE  16384
+
+/** Maximum size of a stored block */
+#define MAX_STORED  65535
+
+/** Maximum bits in the Huffman code */
+#define MAX_HUFFMAN_BIT  15
+/** Maximum bits in the code length code */
+#define MAX_LENGTH_BIT  7
+
+/** Number of literal/length codes */
+#define MAX_LITLEN  286
+/** Number of fixed literal/length codes */
+#define MAX_FIXED_LITLEN  288
+/** Number of distance codes */
+#define MAX_DIST    30
+/** Number of code length codes */
+#define MAX_ORDER   19
+/** Number of length codes */
+#define MAX_LEN     29
+
+/** End of block symbol */
+#define END_BLOCK  256
+
+/** Block types */
+#define BLOCK_STORED   0
+#define BLOCK_FIXED    1
+#define BLOCK_DYNAMIC  2
+
+/** Compression level parameters
+ *
+ */
+typedef struct {
+	uint16_t good;   /**< Reduce the search above this match length */
+	uint16_t lazy;   /**< Do not search further above this match length */
+	uint16_t nice;   /**< Stop the search at this match length */
+	uint16_t chain;  /**< Maximum number of hash chain steps */
+} deflate_config_t;
+
+/** Parameters of levels 1 to 9
+ *
+ * Levels up to MAX_GREEDY_LEVEL match greedily and use the lazy field as
+ * the longest match whose positions are still entered into the hash
+ * chains.
+ *
+ */
+static const deflate_config_t configs[] = {
+	{ 4, 4, 8, 4 },
+	{ 4, 5, 16, 8 },
+	{ 4, 6, 32, 32 },
+	{ 4, 4, 16, 16 },
+	{ 8, 16, 32, 32 },
+	{ 8, 16, 128, 128 },
+	{ 8, 32, 128, 256 },
+	{ 32, 128, 258, 1024 },
+	{ 32, 258, 258, 4096 }
+};
+
+/** Huffman code
+ *
+ */
+typedef struct {
+	uint16_t code;  /**< Code, bit-reversed for output */
+	uint8_t len;    /**< Code length (zero if unused) */
+} huffman_code_t;
+
+/** Deflate compressor state
+ *
+ */
+struct deflate {
+	deflate_sink_t sink;  /**< Output sink */
+	void *sink_arg;       /**< Output sink argument */
+	errno_t rc;           /**< First error returned by the sink */
+
+	unsigned int level;
+	const deflate_config_t *config;
+
+	uint8_t *window;   /**< Input window (twice the window size) */
+	uint16_t *head;    /**< Most recent position of each hash */
+	uint16_t *prev;    /**< Previous position with the same hash */
+
+	size_t strstart;     /**< Current position in the window */
+	size_t lookahead;    /**< Valid bytes from the current position */
+	size_t block_start;  /**< Window position where the block begins */
+
+	size_t match_start;      /**< Start of the last match found */
+	size_t match_length;     /**< Length of the match at current position */
+	size_t match_dist;       /**< Distance of the match at current position */
+	bool match_available;    /**< Previous byte is not emitted yet */
+
+	uint8_t *sym_len;    /**< Literals or match lengths minus MIN_MATCH */
+	uint16_t *sym_dist;  /**< Match distances (zero for literals) */
+	size_t sym_cnt;      /**< Number of collected symbols */
+
+	uint16_t litlen_freq[MAX_LITLEN];
+	uint16_t dist_freq[MAX_DIST];
+
+	uint8_t *output;     /**< Output buffer */
+	size_t output_cnt;   /**< Bytes in the output buffer */
+	uint32_t bitbuf;     /**< Bits not yet written to the output buffer */
+	size_t bitlen;       /**< Number of bits in the bit buffer */
+
+	uint8_t length_code[MAX_MATCH - MIN_MATCH + 1];
+	uint8_t dist_code[512];
+};
+
+/** Length code base values */
+static const uint16_t lens[MAX_LEN] = {
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+	35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+
+/** Length code extra bits */
+static const uint8_t lens_ext[MAX_LEN] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+	3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+
+/** Distance code base values */
+static const uint16_t dists[MAX_DIST] = {
+	1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+	257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+	8193, 12289, 16385, 24577
+};
+
+/** Distance code extra bits */
+static const uint8_t dists_ext[MAX_DIST] = {
+	0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+	7, 7, 8, 8, 9, 9, 10, 10, 11, 11,
+	12, 12, 13, 13
+};
+
+/** Order of the code length code lengths */
+static const uint8_t order[MAX_ORDER] = {
+	16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+/** Fill the length and distance code lookup tables
+ *
+ * Distances up to 256 are looked up directly, longer ones by their
+ * value shifted by 7 bits in the upper half of the table.
+ *
+ * @param deflate Deflate state.
+ *
+ */
+static void deflate_tables_init(deflate_t *deflate)
+{
+	for (size_t code = 0; code < MAX_LEN; code++) {
+		size_t end = (code + 1 < MAX_LEN) ? lens[code + 1] :
+		    MAX_MATCH + 1;
+
+		for (size_t len = lens[code]; len < end; len++)
+			deflate->length_code[len - MIN_MATCH] = code;
+	}
+
+	for (size_t code = 0; code < MAX_DIST; code++) {
+		size_t end = dists[code] + (1 << dists_ext[code]);
+
+		for (size_t dist = dists[code]; dist < end; dist++) {
+			if (dist <= 256)
+				deflate->dist_code[dist - 1] = code;
+			else
+				deflate->dist_code[256 + ((dist - 1) >> 7)] = code;
+		}
+	}
+}
+
+/** Get the distance code of a distance
+ *
+ * @param deflate Deflate state.
+ * @param dist    Match distance.
+ *
+ * @return Distance code.
+ *
+ */
+static inline uint8_t get_dist_code(deflate_t *deflate, size_t dist)
+{
+	if (dist <= 256)
+		return deflate->dist_code[dist - 1];
+
+	return deflate->dist_code[256 + ((dist - 1) >> 7)];
+}
+
+/** Pass the output buffer to the sink
+ *
+ * @param deflate Deflate state.
+ *
+ */
+static void flush_output(deflate_t *deflate)
+{
+	if ((deflate->output_cnt > 0) && (deflate->rc == EOK))
+		deflate->rc = deflate->sink(deflate->sink_arg, deflate->output,
+		    deflate->output_cnt);
+
+	deflate->output_cnt = 0;
+}
+
+/** Write an output byte
+ *
+ * @param deflate Deflate state.
+ * @param byte    Byte to write.
+ *
+ */
+static inline void put_byte(deflate_t *deflate, uint8_t byte)
+{
+	deflate->output[deflate->output_cnt] = byte;
+	deflate->output_cnt++;
+
+	if (deflate->output_cnt == OUTPUT_SIZE)
+		flush_output(deflate);
+}
+
+/** Write bits to the output
+ *
+ * @param deflate Deflate state.
+ * @param value   Bits to write (least significant bit first).
+ * @param cnt     Number of bits (at most 16).
+ *
+ */
+static inline void put_bits(deflate_t *deflate, uint32_t value, size_t cnt)
+{
+	deflate->bitbuf |= value << deflate->bitlen;
+	deflate->bitlen += cnt;
+
+	while (deflate->bitlen >= 8) {
+		put_byte(deflate, (uint8_t) deflate->bitbuf);
+		deflate->bitbuf >>= 8;
+		deflate->bitlen -= 8;
+	}
+}
+
+/** Pad the output to a byte boundary
+ *
+ * @param deflate Deflate state.
+ *
+ */
+static void align_bits(deflate_t *deflate)
+{
+	if (deflate->bitlen > 0)
+		put_bits(deflate, 0, 8 - deflate->bitlen);
+}
+
+/** Compute Huffman code lengths
+ *
+ * The two least frequent subtrees are merged repeatedly. The leaves are
+ * sorted first and the merged nodes are created in order of frequency,
+ * so the two least frequent are always at the heads of the two queues.
+ * If the code is too long, the frequencies are flattened and the code
+ * is built again.
+ *
+ * @param freq    Symbol frequencies.
+ * @param n       Number of symbols.
+ * @param max_len Maximum code length.
+ * @param length  Resulting code lengths.
+ *
+ */
+static void huffman_lengths(const uint16_t *freq, size_t n, size_t max_len,
+    uint8_t *length)
+{
+	uint32_t weight[2 * MAX_LITLEN];
+	uint16_t leaf[MAX_LITLEN];
+	uint16_t parent[2 * MAX_LITLEN];
+	uint32_t scale = 0;
+
+	while (true) {
+		/* Sort used symbols by weight (insertion sort, n is small) */
+		size_t leaves = 0;
+		for (size_t symbol = 0; symbol < n; symbol++) {
+			length[symbol] = 0;
+			if (freq[symbol] == 0)
+				continue;
+
+			weight[symbol] = ((freq[symbol] - 1) >> scale) + 1;
+
+			size_t pos = leaves;
+			while ((pos > 0) && (weight[leaf[pos - 1]] > weight[symbol])) {
+				leaf[pos] = leaf[pos - 1];
+				pos--;
+			}
+
+			leaf[pos] = symbol;
+			leaves++;
+		}
+
+		if (leaves == 0)
+			return;
+
+		if (leaves == 1) {
+			/* Decoders expect a complete code, add a dummy symbol */
+			length[leaf[0]] = 1;
+			length[(leaf[0] == 0) ? 1 : 0] = 1;
+			return;
+		}
+
+		/* Internal nodes are numbered from n */
+		size_t next_leaf = 0;
+		size_t next_node = n;
+		size_t nodes = n;
+
+		for (size_t merge = 0; merge < leaves - 1; merge++) {
+			size_t child[2];
+
+			for (size_t i = 0; i < 2; i++) {
+				if ((next_leaf < leaves) && ((next_node == nodes) ||
+				    (weight[leaf[next_leaf]] <= weight[next_node]))) {
+					child[i] = leaf[next_leaf];
+					next_leaf++;
+				} else {
+					child[i] = next_node;
+					next_node++;
+				}
+			}
+
+			weight[nodes] = weight[child[0]] + weight[child[1]];
+			parent[child[0]] = nodes;
+			parent[child[1]] = nodes;
+			nodes++;
+		}
+
+		/* Depth of a node is one more than the depth of its parent */
+		uint8_t depth[2 * MAX_LITLEN];
+		depth[nodes - 1] = 0;
+
+		size_t longest = 0;
+		for (size_t node = nodes - 1; node-- > n;)
+			depth[node] = depth[parent[node]] + 1;
+
+		for (size_t i = 0; i < leaves; i++) {
+			size_t symbol = leaf[i];
+			length[symbol] = depth[parent[symbol]] + 1;
+			longest = max(longest, (size_t) length[symbol]);
+		}
+
+		if (longest <= max_len)
+			return;
+
+		scale++;
+	}
+}
+
+/** Assign canonical codes to code lengths
+ *
+ * @param length Code lengths.
+ * @param n      Number of symbols.
+ * @param code   Resulting codes.
+ *
+ */
+static void huffman_codes(const uint8_t *length, size_t n,
+    huffman_code_t *code)
+{
+	uint16_t count[MAX_HUFFMAN_BIT + 1];
+	uint16_t next[MAX_HUFFMAN_BIT + 1];
+
+	memset(count, 0, sizeof(count));
+	for (size_t symbol = 0; symbol < n; symbol++)
+		count[length[symbol]]++;
+
+	count[0] = 0;
+	uint16_t value = 0;
+	for (size_t len = 1; len <= MAX_HUFFMAN_BIT; len++) {
+		value = (value + count[len - 1]) << 1;
+		next[len] = value;
+	}
+
+	for (size_t symbol = 0; symbol < n; symbol++) {
+		size_t len = length[symbol];
+		code[symbol].len = len;
+		if (len == 0)
+			continue;
+
+		/* The code is sent starting from its most significant bit */
+		uint16_t val = next[len]++;
+		uint16_t rev = 0;
+		for (size_t bit = 0; bit < len; bit++)
+			rev |= ((val >> bit) & 1) << (len - 1 - bit);
+
+		code[symbol].code = rev;
+	}
+}
+
+/** Code length code representation of the block code lengths
+ *
+ */
+typedef struct {
+	uint8_t symbol[MAX_LITLEN + MAX_DIST];  /**< Code length symbols */
+	uint8_t extra[MAX_LITLEN + MAX_DIST];   /**< Repeat counts */
+	size_t cnt;                             /**< Number of symbols */
+	uint16_t freq[MAX_ORDER];               /**< Symbol frequencies */
+} length_rle_t;
+
+/** Run-length encode code lengths
+ *
+ * @param length Code lengths of literal/length and distance codes.
+ * @param n      Number of lengths.
+ * @param rle    Resulting code length code symbols.
+ *
+ */
+static void lengths_rle(const uint8_t *length, size_t n, length_rle_t *rle)
+{
+	rle->cnt = 0;
+	memset(rle->freq, 0, sizeof(rle->freq));
+
+	size_t i = 0;
+	while (i < n) {
+		size_t run = 1;
+		while ((i + run < n) && (length[i + run] == length[i]))
+			run++;
+
+		size_t left = run;
+		if (length[i] == 0) {
+			while (left >= 3) {
+				size_t rep = min(left, (size_t) 138);
+				uint8_t symbol = (rep >= 11) ? 18 : 17;
+				rle->symbol[rle->cnt] = symbol;
+				rle->extra[rle->cnt] = rep - ((symbol == 18) ? 11 : 3);
+				rle->cnt++;
+				rle->freq[symbol]++;
+				left -= rep;
+			}
+		} else {
+			rle->symbol[rle->cnt] = length[i];
+			rle->extra[rle->cnt] = 0;
+			rle->cnt++;
+			rle->freq[length[i]]++;
+			left--;
+
+			while (left >= 3) {
+				size_t rep = min(left, (size_t) 6);
+				rle->symbol[rle->cnt] = 16;
+				rle->extra[rle->cnt] = rep - 3;
+				rle->cnt++;
+				rle->freq[16]++;
+				left -= rep;
+			}
+		}
+
+		while (left > 0) {
+			rle->symbol[rle->cnt] = length[i];
+			rle->extra[rle->cnt] = 0;
+			rle->cnt++;
+			rle->freq[length[i]]++;
+			left--;
+		}
+
+		i += run;
+	}
+}
+
+/** Extra bits of a code length code symbol
+ *
+ */
+static inline size_t rle_extra_bits(uint8_t symbol)
+{
+	switch (symbol) {
+	case 16:
+		return 2;
+	case 17:
+		return 3;
+	case 18:
+		return 7;
+	default:
+		return 0;
+	}
+}
+
+/** Compute the size of the collected symbols using given codes
+ *
+ * @return Size in bits (without the block header).
+ *
+ */
+static size_t symbols_size(deflate_t *deflate, const huffman_code_t *litlen,
+    const huffman_code_t *dist)
+{
+	size_t bits = litlen[END_BLOCK].len;
+
+	for (size_t symbol = 0; symbol < MAX_LITLEN; symbol++) {
+		size_t len = litlen[symbol].len;
+		if (symbol > END_BLOCK)
+			len += lens_ext[symbol - END_BLOCK - 1];
+
+		bits += deflate->litlen_freq[symbol] * len;
+	}
+
+	for (size_t symbol = 0; symbol < MAX_DIST; symbol++)
+		bits += deflate->dist_freq[symbol] *
+		    (dist[symbol].len + dists_ext[symbol]);
+
+	return bits;
+}
+
+/** Write the collected symbols
+ *
+ * @param deflate Deflate state.
+ * @param litlen  Literal/length code.
+ * @param dist    Distance code.
+ *
+ */
+static void write_symbols(deflate_t *deflate, const huffman_code_t *litlen,
+    const huffman_code_t *dist)
+{
+	for (size_t i = 0; i < deflate->sym_cnt; i++) {
+		size_t match_dist = deflate->sym_dist[i];
+
+		if (match_dist == 0) {
+			uint8_t literal = deflate->sym_len[i];
+			put_bits(deflate, litlen[literal].code, litlen[literal].len);
+			continue;
+		}
+
+		size_t len = deflate->sym_len[i];
+		uint8_t code = deflate->length_code[len];
+		size_t symbol = END_BLOCK + 1 + code;
+
+		put_bits(deflate, litlen[symbol].code, litlen[symbol].len);
+		if (lens_ext[code] > 0)
+			put_bits(deflate, len + MIN_MATCH - lens[code],
+			    lens_ext[code]);
+
+		code = get_dist_code(deflate, match_dist);
+		put_bits(deflate, dist[code].code, dist[code].len);
+		if (dists_ext[code] > 0)
+			put_bits(deflate, match_dist - dists[code], dists_ext[code]);
+	}
+
+	put_bits(deflate, litlen[END_BLOCK].code, litlen[END_BLOCK].len);
+}
+
+/** Write the current block as stored blocks
+ *
+ * @param deflate Deflate state.
+ * @param last    Whether this is the last block of the stream.
+ *
+ */
+static void write_stored(deflate_t *deflate, bool last)
+{
+	const uint8_t *data = deflate->window + deflate->block_start;
+	size_t size = deflate->strstart - deflate->block_start;
+
+	do {
+		size_t chunk = min(size, (size_t) MAX_STORED);
+		bool final = last && (chunk == size);
+
+		put_bits(deflate, (final ? 1 : 0) | (BLOCK_STORED << 1), 3);
+		align_bits(deflate);
+
+		put_bits(deflate, chunk, 16);
+		put_bits(deflate, (~chunk) & 0xffff, 16);
+
+		for (size_t i = 0; i < chunk; i++)
+			put_byte(deflate, data[i]);
+
+		data += chunk;
+		size -= chunk;
+	} while (size > 0);
+}
+
+/** Emit the collected symbols as a block
+ *
+ * @param deflate Deflate state.
+ * @param last    Whether this is the last block of the stream.
+ *
+ */
+static void flush_block(deflate_t *deflate, bool last)
+{
+	size_t stored_len = deflate->strstart - deflate->block_start;
+
+	/* Stored blocks need 5 bytes of header each after the alignment */
+	size_t stored_bits = 8 * (stored_len +
+	    5 * (stored_len / MAX_STORED + 1)) + 7;
+
+	if (deflate->level == DEFLATE_LEVEL_NONE) {
+		write_stored(deflate, last);
+		goto done;
+	}
+
+	deflate->litlen_freq[END_BLOCK] = 1;
+
+	/* Fixed codes (the two unused symbols still take part) */
+	huffman_code_t fixed_litlen[MAX_FIXED_LITLEN];
+	huffman_code_t fixed_dist[MAX_DIST];
+	uint8_t length[MAX_FIXED_LITLEN + MAX_DIST];
+
+	for (size_t symbol = 0; symbol < MAX_FIXED_LITLEN; symbol++) {
+		if (symbol < 144)
+			length[symbol] = 8;
+		else if (symbol < 256)
+			length[symbol] = 9;
+		else if (symbol < 280)
+			length[symbol] = 7;
+		else
+			length[symbol] = 8;
+	}
+
+	huffman_codes(length, MAX_FIXED_LITLEN, fixed_litlen);
+
+	for (size_t symbol = 0; symbol < MAX_DIST; symbol++)
+		length[symbol] = 5;
+
+	huffman_codes(length, MAX_DIST, fixed_dist);
+
+	size_t fixed_bits = 3 + symbols_size(deflate, fixed_litlen, fixed_dist);
+
+	/*
+	 * Dynamic codes. At least two distance codes are always
+	 * defined to keep decoders happy with blocks of literals only.
+	 */
+	huffman_code_t litlen[MAX_LITLEN];
+	huffman_code_t dist[MAX_DIST];
+
+	uint16_t dist_freq[MAX_DIST];
+	memcpy(dist_freq, deflate->dist_freq, sizeof(dist_freq));
+	size_t dist_used = 0;
+	for (size_t symbol = 0; symbol < MAX_DIST; symbol++) {
+		if (dist_freq[symbol] != 0)
+			dist_used++;
+	}
+
+	for (size_t symbol = 0; (dist_used < 2) && (symbol < 2); symbol++) {
+		if (dist_freq[symbol] == 0) {
+			dist_freq[symbol] = 1;
+			dist_used++;
+		}
+	}
+
+	huffman_lengths(deflate->litlen_freq, MAX_LITLEN, MAX_HUFFMAN_BIT,
+	    length);
+	huffman_lengths(dist_freq, MAX_DIST, MAX_HUFFMAN_BIT,
+	    length + MAX_LITLEN);
+
+	size_t nlen = MAX_LITLEN;
+	while ((nlen > END_BLOCK + 1) && (length[nlen - 1] == 0))
+		nlen--;
+
+	size_t ndist = MAX_DIST;
+	while ((ndist > 1) && (length[MAX_LITLEN + ndist - 1] == 0))
+		ndist--;
+
+	huffman_codes(length, MAX_LITLEN, litlen);
+	huffman_codes(length + MAX_LITLEN, MAX_DIST, dist);
+
+	/* Lengths are sent back to back */
+	memmove(length + nlen, length + MAX_LITLEN, ndist);
+
+	length_rle_t rle;
+	lengths_rle(length, nlen + ndist, &rle);
+
+	uint8_t rle_length[MAX_ORDER];
+	huffman_code_t rle_code[MAX_ORDER];
+	huffman_lengths(rle.freq, MAX_ORDER, MAX_LENGTH_BIT, rle_length);
+	huffman_codes(rle_length, MAX_ORDER, rle_code);
+
+	size_t ncode = MAX_ORDER;
+	while ((ncode > 4) && (rle_length[order[ncode - 1]] == 0))
+		ncode--;
+
+	size_t dynamic_bits = 3 + 5 + 5 + 4 + 3 * ncode +
+	    symbols_size(deflate, litlen, dist);
+	for (size_t i = 0; i < MAX_ORDER; i++)
+		dynamic_bits += rle.freq[i] * (rle_length[i] + rle_extra_bits(i));
+
+	if ((stored_bits <= fixed_bits) && (stored_bits <= dynamic_bits)) {
+		write_stored(deflate, last);
+	} else if (fixed_bits <= dynamic_bits) {
+		put_bits(deflate, (last ? 1 : 0) | (BLOCK_FIXED << 1), 3);
+		write_symbols(deflate, fixed_litlen, fixed_dist);
+	} else {
+		put_bits(deflate, (last ? 1 : 0) | (BLOCK_DYNAMIC << 1), 3);
+		put_bits(deflate, nlen - 257, 5);
+		put_bits(deflate, ndist - 1, 5);
+		put_bits(deflate, ncode - 4, 4);
+
+		for (size_t i = 0; i < ncode; i++)
+			put_bits(deflate, rle_length[order[i]], 3);
+
+		for (size_t i = 0; i < rle.cnt; i++) {
+			uint8_t symbol = rle.symbol[i];
+			put_bits(deflate, rle_code[symbol].code, rle_code[symbol].len);
+			if (rle_extra_bits(symbol) > 0)
+				put_bits(deflate, rle.extra[i], rle_extra_bits(symbol));
+		}
+
+		write_symbols(deflate, litlen, dist);
+	}
+
+done:
+	deflate->block_start = deflate->strstart;
+	deflate->sym_cnt = 0;
+	memset(deflate->litlen_freq, 0, sizeof(deflate->litlen_freq));
+	memset(deflate->dist_freq, 0, sizeof(deflate->dist_freq));
+}
+
+/** Record a literal
+ *
+ * @param deflate Deflate state.
+ * @param literal Literal byte.
+ *
+ */
+static inline void tally_literal(deflate_t *deflate, uint8_t literal)
+{
+	deflate->sym_len[deflate->sym_cnt] = literal;
+	deflate->sym_dist[deflate->sym_cnt] = 0;
+	deflate->sym_cnt++;
+	deflate->litlen_freq[literal]++;
+}
+
+/** Record a match
+ *
+ * @param deflate Deflate state.
+ * @param dist    Match distance.
+ * @param len     Match length.
+ *
+ */
+static inline void tally_match(deflate_t *deflate, size_t dist, size_t len)
+{
+	deflate->sym_len[deflate->sym_cnt] = len - MIN_MATCH;
+	deflate->sym_dist[deflate->sym_cnt] = dist;
+	deflate->sym_cnt++;
+	deflate->litlen_freq[END_BLOCK + 1 +
+	    deflate->length_code[len - MIN_MATCH]]++;
+	deflate->dist_freq[get_dist_code(deflate, dist)]++;
+}
+
+/** Insert the string at a position into the hash chains
+ *
+ * @param deflate Deflate state.
+ * @param pos     Window position (at least MIN_MATCH bytes available).
+ *
+ * @return Previous position with the same hash or NIL.
+ *
+ */
+static inline size_t insert_string(deflate_t *deflate, size_t pos)
+{
+	const uint8_t *str = deflate->window + pos;
+	size_t hash = ((str[0] << 10) ^ (str[1] << 5) ^ str[2]) & HASH_MASK;
+
+	size_t prev = deflate->head[hash];
+	deflate->prev[pos & WINDOW_MASK] = prev;
+	deflate->head[hash] = pos;
+
+	return prev;
+}
+
+/** Find the longest match along a hash chain
+ *
+ * @param deflate   Deflate state.
+ * @param cur_match Most recent position with the same hash.
+ * @param prev_len  Length of the match to improve on.
+ *
+ * @return Length of the best match found, prev_len if none is longer.
+ *
+ */
+static size_t longest_match(deflate_t *deflate, size_t cur_match,
+    size_t prev_len)
+{
+	const uint8_t *window = deflate->window;
+	const uint8_t *scan = window + deflate->strstart;
+
+	size_t chain = deflate->config->chain;
+	if (prev_len >= deflate->config->good)
+		chain >>= 2;
+
+	size_t max_len = min((size_t) MAX_MATCH, deflate->lookahead);
+	size_t nice = min((size_t) deflate->config->nice, max_len);
+	size_t limit = (deflate->strstart > MAX_DISTANCE) ?
+	    deflate->strstart - MAX_DISTANCE : NIL;
+
+	size_t best = prev_len;
+	if (best >= max_len)
+		return best;
+
+	do {
+		const uint8_t *match = window + cur_match;
+
+		/* Quickly skip matches which cannot be longer */
+		if ((match[best] != scan[best]) || (match[0] != scan[0]) ||
+		    (match[1] != scan[1]))
+			continue;
+
+		size_t len = 2;
+		while ((len < max_len) && (match[len] == scan[len]))
+			len++;
+
+		if (len > best) {
+			deflate->match_start = cur_match;
+			best = len;
+			if (len >= nice)
+				break;
+		}
+	} while (((cur_match = deflate->prev[cur_match & WINDOW_MASK]) > limit) &&
+	    (--chain != 0));
+
+	return best;
+}
+
+/** Compress with greedy matching
+ *
+ * @param deflate Deflate state.
+ * @param flush   Process all input (otherwise keep enough lookahead).
+ *
+ */
+static void deflate_fast(deflate_t *deflate, bool flush)
+{
+	while ((deflate->lookahead >= MIN_LOOKAHEAD) ||
+	    (flush && (deflate->lookahead > 0))) {
+		size_t hash_head = NIL;
+		if (deflate->lookahead >= MIN_MATCH)
+			hash_head = insert_string(deflate, deflate->strstart);
+
+		size_t match_len = 0;
+		if ((hash_head != NIL) &&
+		    (deflate->strstart - hash_head <= MAX_DISTANCE))
+			match_len = longest_match(deflate, hash_head, MIN_MATCH - 1);
+
+		if (match_len >= MIN_MATCH) {
+			tally_match(deflate, deflate->strstart - deflate->match_start,
+			    match_len);
+			deflate->lookahead -= match_len;
+
+			if ((match_len <= deflate->config->lazy) &&
+			    (deflate->lookahead >= MIN_MATCH)) {
+				/* Enter the positions inside the match as well */
+				while (--match_len > 0) {
+					deflate->strstart++;
+					insert_string(deflate, deflate->strstart);
+				}
+
+				deflate->strstart++;
+			} else {
+				deflate->strstart += match_len;
+			}
+		} else {
+			tally_literal(deflate, deflate->window[deflate->strstart]);
+			deflate->lookahead--;
+			deflate->strstart++;
+		}
+
+		if (deflate->sym_cnt == SYMBOLS_SIZE)
+			flush_block(deflate, false);
+	}
+}
+
+/** Compress with lazy matching
+ *
+ * A match is emitted only if the next position does not start a longer
+ * one, otherwise a literal is emitted and the longer match is used.
+ *
+ * @param deflate Deflate state.
+ * @param flush   Process all input (otherwise keep enough lookahead).
+ *
+ */
+static void deflate_slow(deflate_t *deflate, bool flush)
+{
+	while ((deflate->lookahead >= MIN_LOOKAHEAD) ||
+	    (flush && (deflate->lookahead > 0))) {
+		size_t hash_head = NIL;
+		if (deflate->lookahead >= MIN_MATCH)
+			hash_head = insert_string(deflate, deflate->strstart);
+
+		size_t prev_len = deflate->match_length;
+		size_t prev_dist = deflate->match_dist;
+		deflate->match_length = MIN_MATCH - 1;
+
+		if ((hash_head != NIL) && (prev_len < deflate->config->lazy) &&
+		    (deflate->strstart - hash_head <= MAX_DISTANCE)) {
+			size_t len = longest_match(deflate, hash_head, prev_len);
+			if (len > prev_len) {
+				size_t dist = deflate->strstart - deflate->match_start;
+				if ((len > MIN_MATCH) || (dist <= TOO_FAR)) {
+					deflate->match_length = len;
+					deflate->match_dist = dist;
+				}
+			}
+		}
+
+		if ((prev_len >= MIN_MATCH) &&
+		    (deflate->match_length <= prev_len)) {
+			/* The match started at the previous position */
+			size_t max_insert = deflate->strstart + deflate->lookahead -
+			    MIN_MATCH;
+
+			tally_match(deflate, prev_dist, prev_len);
+			deflate->lookahead -= prev_len - 1;
+
+			for (size_t i = 0; i < prev_len - 2; i++) {
+				deflate->strstart++;
+				if (deflate->strstart <= max_insert)
+					insert_string(deflate, deflate->strstart);
+			}
+
+			deflate->match_available = false;
+			deflate->match_length = MIN_MATCH - 1;
+			deflate->strstart++;
+		} else {
+			if (deflate->match_available)
+				tally_literal(deflate,
+				    deflate->window[deflate->strstart - 1]);
+
+			deflate->match_available = true;
+			deflate->strstart++;
+			deflate->lookahead--;
+		}
+
+		if (deflate->sym_cnt >= SYMBOLS_SIZE - 1) {
+			/* Keep the pending literal in the next block */
+			if (deflate->match_available) {
+				deflate->strstart--;
+				flush_block(deflate, false);
+				deflate->strstart++;
+			} else {
+				flush_block(deflate, false);
+			}
+		}
+	}
+
+	if (flush && deflate->match_available) {
+		tally_literal(deflate, deflate->window[deflate->strstart - 1]);
+		deflate->match_available = false;
+	}
+}
+
+/** Compress the input in the window
+ *
+ * @param deflate Deflate state.
+ * @param flush   Process all input (otherwise keep enough lookahead).
+ *
+ */
+static void deflate_process(deflate_t *deflate, bool flush)
+{
+	if (deflate->level == DEFLATE_LEVEL_NONE) {
+		deflate->strstart += deflate->lookahead;
+		deflate->lookahead = 0;
+	} else if (deflate->level <= MAX_GREEDY_LEVEL) {
+		deflate_fast(deflate, flush);
+	} else {
+		deflate_slow(deflate, flush);
+	}
+}
+
+/** Slide the window by its half
+ *
+ * The data of the current block are emitted first if they would be
+ * discarded.
+ *
+ * @param deflate Deflate state.
+ *
+ */
+static void slide_window(deflate_t *deflate)
+{
+	if (deflate->block_start < WINDOW_SIZE) {
+		if (deflate->match_available) {
+			/* The pending literal stays in the next block */
+			deflate->strstart--;
+			flush_block(deflate, false);
+			deflate->strstart++;
+		} else {
+			flush_block(deflate, false);
+		}
+	}
+
+	memcpy(deflate->window, deflate->window + WINDOW_SIZE, WINDOW_SIZE);
+	deflate->strstart -= WINDOW_SIZE;
+	deflate->block_start -= WINDOW_SIZE;
+
+	for (size_t i = 0; i < HASH_SIZE; i++) {
+		size_t pos = deflate->head[i];
+		deflate->head[i] = (pos >= WINDOW_SIZE) ? pos - WINDOW_SIZE : NIL;
+	}
+
+	for (size_t i = 0; i < WINDOW_SIZE; i++) {
+		size_t pos = deflate->prev[i];
+		deflate->prev[i] = (pos >= WINDOW_SIZE) ? pos - WINDOW_SIZE : NIL;
+	}
+}
+
+/** Create a deflate compressor
+ *
+ * @param level   Compression level (0 to 9).
+ * @param sink    Function receiving the compressed data.
+ * @param arg     Argument passed to the sink.
+ * @param rdeflate Place to store the compressor.
+ *
+ * @return EOK on success.
+ * @return EINVAL on invalid compression level.
+ * @return ENOMEM on out of memory.
+ *
+ */
+errno_t deflate_create(unsigned int level, deflate_sink_t sink, void *arg,
+    deflate_t **rdeflate)
+{
+	if (level > DEFLATE_LEVEL_BEST)
+		return EINVAL;
+
+	deflate_t *deflate = calloc(1, sizeof(deflate_t));
+	if (deflate == NULL)
+		return ENOMEM;
+
+	deflate->sink = sink;
+	deflate->sink_arg = arg;
+	deflate->rc = EOK;
+	deflate->level = level;
+	deflate->config = (level > 0) ? &configs[level - 1] : NULL;
+	deflate->match_length = MIN_MATCH - 1;
+
+	deflate->window = malloc(2 * WINDOW_SIZE);
+	deflate->head = calloc(HASH_SIZE, sizeof(uint16_t));
+	deflate->prev = calloc(WINDOW_SIZE, sizeof(uint16_t));
+	deflate->sym_len = malloc(SYMBOLS_SIZE);
+	deflate->sym_dist = malloc(SYMBOLS_SIZE * sizeof(uint16_t));
+	deflate->output = malloc(OUTPUT_SIZE);
+
+	if ((deflate->window == NULL) || (deflate->head == NULL) ||
+	    (deflate->prev == NULL) || (deflate->sym_len == NULL) ||
+	    (deflate->sym_dist == NULL) || (deflate->output == NULL)) {
+		deflate_destroy(deflate);
+		return ENOMEM;
+	}
+
+	deflate_tables_init(deflate);
+
+	*rdeflate = deflate;
+	return EOK;
+}
+
+/** Compress data
+ *
+ * The compressed data is passed to the sink as it becomes available,
+ * some of the input is retained until more data is written or the
+ * stream is finished.
+ *
+ * @param deflate Deflate compressor.
+ * @param data    Data to compress.
+ * @param size    Size of the data (bytes).
+ *
+ * @return EOK on success or an error code returned by the sink.
+ *
+ */
+errno_t deflate_write(deflate_t *deflate, const void *data, size_t size)
+{
+	const uint8_t *src = (const uint8_t *) data;
+
+	while ((size > 0) && (deflate->rc == EOK)) {
+		size_t end = deflate->strstart + deflate->lookahead;
+		if (end == 2 * WINDOW_SIZE) {
+			slide_window(deflate);
+			end -= WINDOW_SIZE;
+		}
+
+		size_t chunk = min(size, 2 * WINDOW_SIZE - end);
+		memcpy(deflate->window + end, src, chunk);
+		deflate->lookahead += chunk;
+		src += chunk;
+		size -= chunk;
+
+		deflate_process(deflate, false);
+	}
+
+	return deflate->rc;
+}
+
+/** Finish the compressed stream
+ *
+ * All retained input is compressed and the last block is emitted.
+ * No more data can be written afterwards.
+ *
+ * @param deflate Deflate compressor.
+ *
+ * @return EOK on success or an error code returned by the sink.
+ *
+ */
+errno_t deflate_finish(deflate_t *deflate)
+{
+	deflate_process(deflate, true);
+	flush_block(deflate, true);
+	align_bits(deflate);
+	flush_output(deflate);
+
+	return deflate->rc;
+}
+
+/** Destroy a deflate compressor
+ *
+ * @param deflate Deflate compressor.
+ *
+ */
+void deflate_destroy(deflate_t *deflate)
+{
+	free(deflate->window);
+	free(deflate->head);
+	free(deflate->prev);
+	free(deflate->sym_len);
+	free(deflate->sym_dist);
+	free(deflate->output);
+	free(deflate);
+}
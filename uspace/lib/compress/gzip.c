@@ -31,7 +31,9 @@
 #include <errno.h>
 #include <mem.h>
 #include <byteorder.h>
+#include <macros.h>
 #include <stdlib.h>
+#include <adt/checksum.h>
 #include "gzip.h"
 #include "inflate.h"
 
@@ -46,6 +48,8 @@
 #define GZIP_FLAG_FNAME     UINT8_C(1 << 3)
 #define GZIP_FLAG_FCOMMENT  UINT8_C(1 << 4)
 
+#define GZIP_OS_UNKNOWN  UINT8_C(255)
+
 typedef struct {
 	uint8_t id1;
 	uint8_t id2;
@@ -61,30 +65,31 @@ typedef struct {
 	uint32_t size;
 } __attribute__((packed)) gzip_footer_t;
 
-/** Expand GZIP compressed data
- *
- * The routine allocates the output buffer based
- * on the size encoded in the input stream. This
- * effectively limits the size of the uncompressed
- * data to 4 GiB (expanding input streams that actually
- * encode more data will always fail).
+/** Streaming GZIP writer
  *
- * So far, no CRC is perfomed.
+ */
+struct gzip_writer {
+	deflate_t *deflate;   /**< Compressor of the data */
+	deflate_sink_t sink;  /**< Output sink */
+	void *sink_arg;       /**< Output sink argument */
+	uint32_t crc32;       /**< CRC of the uncompressed data so far */
+	uint32_t size;        /**< Uncompressed size (modulo 2^32) */
+};
+
+/** Locate the deflate stream in GZIP compressed data
  *
- * @param[in]  src     Source data buffer.
- * @param[in]  srclen  Source buffer size (bytes).
- * @param[out] dest    Destination data buffer.
- * @param[out] destlen Destination buffer size (bytes).
+ * @param[in]  src            Source data buffer.
+ * @param[in]  srclen         Source buffer size (bytes).
+ * @param[out] pstream        Start of the deflate stream.
+ * @param[out] pstream_length Size of the deflate stream (bytes).
+ * @param[out] size           Uncompressed size recorded in the footer.
  *
  * @return EOK on success.
- * @return ENOENT on distance too large.
- * @return EINVAL on invalid Huffman code, invalid deflate data,
- *                   invalid compression method or invalid stream.
- * @return ELIMIT on input buffer overrun.
- * @return ENOMEM on output buffer overrun.
+ * @return EINVAL on invalid compression method or invalid stream.
  *
  */
-errno_t gzip_expand(void *src, size_t srclen, void **dest, size_t *destlen)
+static errno_t gzip_parse(void *src, size_t srclen, void **pstream,
+    size_t *pstream_length, size_t *size)
 {
 	gzip_header_t header;
 	gzip_footer_t footer;
@@ -103,7 +108,7 @@ errno_t gzip_expand(void *src, size_t srclen, void **dest, size_t *destlen)
 	    ((header.flags & (~GZIP_FLAGS_MASK)) != 0))
 		return EINVAL;
 
-	*destlen = uint32_t_le2host(footer.size);
+	*size = uint32_t_le2host(footer.size);
 
 	/* Ignore extra metadata */
 
@@ -167,17 +172,330 @@ errno_t gzip_expand(void *src, size_t srclen, void **dest, size_t *destlen)
 		stream_length -= 2;
 	}
 
+	*pstream = stream;
+	*pstream_length = stream_length;
+	return EOK;
+}
+
+/** Expand GZIP compressed data
+ *
+ * The routine allocates the output buffer based
+ * on the size encoded in the input stream. This
+ * effectively limits the size of the uncompressed
+ * data to 4 GiB (expanding input streams that actually
+ * encode more data will always fail).
+ *
+ * So far, no CRC is perfomed.
+ *
+ * @param[in]  src     Source data buffer.
+ * @param[in]  srclen  Source buffer size (bytes).
+ * @param[out] dest    Destination data buffer.
+ * @param[out] destlen Destination buffer size (bytes).
+ *
+ * @return EOK on success.
+ * @return ENOENT on distance too large.
+ * @return EINVAL on invalid Huffman code, invalid deflate data,
+ *                   invalid compression method or invalid stream.
+ * @return ELIMIT on input buffer overrun.
+ * @return ENOMEM on output buffer overrun.
+ *
+ */
+errno_t gzip_expand(void *src, size_t srclen, void **dest, size_t *destlen)
+{
+	void *stream;
+	size_t stream_length;
+
+	errno_t ret = gzip_parse(src, srclen, &stream, &stream_length, destlen);
+	if (ret != EOK)
+		return ret;
+
 	/* Allocate output buffer and inflate the data */
 
 	*dest = malloc(*destlen);
 	if (*dest == NULL)
 		return ENOMEM;
 
-	errno_t ret = inflate(stream, stream_length, *dest, *destlen);
+	ret = inflate(stream, stream_length, *dest, *destlen);
 	if (ret != EOK) {
-		free(dest);
+		free(*dest);
 		return ret;
 	}
 
 	return EOK;
 }
+
+/** Expand GZIP compressed data into a sink
+ *
+ * Unlike gzip_expand(), no buffer for the whole uncompressed
+ * data is allocated. The data is passed to the sink in chunks
+ * as it is being decompressed.
+ *
+ * So far, no CRC is perfomed.
+ *
+ * @param[in] src    Source data buffer.
+ * @param[in] srclen Source buffer size (bytes).
+ * @param[in] sink   Function receiving the decompressed data.
+ * @param[in] arg    Argument passed to the sink.
+ *
+ * @return EOK on success.
+ * @return ENOENT on distance too large.
+ * @return EINVAL on invalid Huffman code, invalid deflate data,
+ *                   invalid compression method or invalid stream.
+ * @return ELIMIT on input buffer overrun.
+ * @return ENOMEM on out of memory.
+ * @return Error code returned by the sink.
+ *
+ */
+errno_t gzip_expand_stream(void *src, size_t srclen, inflate_sink_t sink,
+    void *arg)
+{
+	void *stream;
+	size_t stream_length;
+	size_t size;
+
+	errno_t ret = gzip_parse(src, srclen, &stream, &stream_length, &size);
+	if (ret != EOK)
+		return ret;
+
+	return inflate_stream(stream, stream_length, sink, arg);
+}
+
+/** Read exactly the given number of bytes from a source
+ *
+ * @param[in]  source Function providing the data.
+ * @param[in]  arg    Argument passed to the source.
+ * @param[out] buf    Destination buffer.
+ * @param[in]  size   Number of bytes to read.
+ *
+ * @return EOK on success.
+ * @return EINVAL on premature end of input.
+ * @return Error code returned by the source.
+ *
+ */
+static errno_t gzip_read(inflate_source_t source, void *arg, void *buf,
+    size_t size)
+{
+	while (size > 0) {
+		size_t nread;
+		errno_t rc = source(arg, buf, size, &nread);
+		if (rc != EOK)
+			return rc;
+
+		if (nread == 0)
+			return EINVAL;
+
+		buf += nread;
+		size -= nread;
+	}
+
+	return EOK;
+}
+
+/** Skip a zero-terminated string in a source
+ *
+ * @param[in] source Function providing the data.
+ * @param[in] arg    Argument passed to the source.
+ *
+ * @return EOK on success or an error code.
+ *
+ */
+static errno_t gzip_skip_string(inflate_source_t source, void *arg)
+{
+	uint8_t c;
+
+	do {
+		errno_t rc = gzip_read(source, arg, &c, sizeof(c));
+		if (rc != EOK)
+			return rc;
+	} while (c != 0);
+
+	return EOK;
+}
+
+/** Expand GZIP compressed data from a source into a sink
+ *
+ * Neither the compressed nor the uncompressed data need to
+ * be held in memory as a whole. The footer is not read.
+ *
+ * So far, no CRC is perfomed.
+ *
+ * @param[in] source     Function providing the compressed data.
+ * @param[in] source_arg Argument passed to the source.
+ * @param[in] sink       Function receiving the decompressed data.
+ * @param[in] sink_arg   Argument passed to the sink.
+ *
+ * @return EOK on success.
+ * @return ENOENT on distance too large.
+ * @return EINVAL on invalid Huffman code, invalid deflate data,
+ *                   invalid compression method or invalid stream.
+ * @return ELIMIT on premature end of input.
+ * @return ENOMEM on out of memory.
+ * @return Error code returned by the source or the sink.
+ *
+ */
+errno_t gzip_expand_pipe(inflate_source_t source, void *source_arg,
+    inflate_sink_t sink, void *sink_arg)
+{
+	gzip_header_t header;
+
+	errno_t ret = gzip_read(source, source_arg, &header, sizeof(header));
+	if (ret != EOK)
+		return ret;
+
+	if ((header.id1 != GZIP_ID1) ||
+	    (header.id2 != GZIP_ID2) ||
+	    (header.method != GZIP_METHOD_DEFLATE) ||
+	    ((header.flags & (~GZIP_FLAGS_MASK)) != 0))
+		return EINVAL;
+
+	/* Ignore extra metadata */
+
+	if ((header.flags & GZIP_FLAG_FEXTRA) != 0) {
+		uint16_t extra_length;
+
+		ret = gzip_read(source, source_arg, &extra_length,
+		    sizeof(extra_length));
+		if (ret != EOK)
+			return ret;
+
+		extra_length = uint16_t_le2host(extra_length);
+		while (extra_length > 0) {
+			uint8_t skip[64];
+			size_t size = min(extra_length, sizeof(skip));
+
+			ret = gzip_read(source, source_arg, skip, size);
+			if (ret != EOK)
+				return ret;
+
+			extra_length -= size;
+		}
+	}
+
+	if ((header.flags & GZIP_FLAG_FNAME) != 0) {
+		ret = gzip_skip_string(source, source_arg);
+		if (ret != EOK)
+			return ret;
+	}
+
+	if ((header.flags & GZIP_FLAG_FCOMMENT) != 0) {
+		ret = gzip_skip_string(source, source_arg);
+		if (ret != EOK)
+			return ret;
+	}
+
+	if ((header.flags & GZIP_FLAG_FHCRC) != 0) {
+		uint16_t hcrc;
+
+		ret = gzip_read(source, source_arg, &hcrc, sizeof(hcrc));
+		if (ret != EOK)
+			return ret;
+	}
+
+	return inflate_pipe(source, source_arg, sink, sink_arg);
+}
+
+/** Create a streaming GZIP writer
+ *
+ * The GZIP header is passed to the sink immediately, the compressed
+ * data follow as they are written.
+ *
+ * @param[in]  level   Compression level (0 to 9).
+ * @param[in]  sink    Function receiving the GZIP stream.
+ * @param[in]  arg     Argument passed to the sink.
+ * @param[out] rwriter Place to store the writer.
+ *
+ * @return EOK on success.
+ * @return EINVAL on invalid compression level.
+ * @return ENOMEM on out of memory.
+ * @return Error code returned by the sink.
+ *
+ */
+errno_t gzip_writer_create(unsigned int level, deflate_sink_t sink, void *arg,
+    gzip_writer_t **rwriter)
+{
+	gzip_writer_t *writer = malloc(sizeof(gzip_writer_t));
+	if (writer == NULL)
+		return ENOMEM;
+
+	errno_t ret = deflate_create(level, sink, arg, &writer->deflate);
+	if (ret != EOK) {
+		free(writer);
+		return ret;
+	}
+
+	writer->sink = sink;
+	writer->sink_arg = arg;
+	writer->crc32 = 0;
+	writer->size = 0;
+
+	gzip_header_t header;
+
+	header.id1 = GZIP_ID1;
+	header.id2 = GZIP_ID2;
+	header.method = GZIP_METHOD_DEFLATE;
+	header.flags = 0;
+	header.mtime = 0;
+	header.extra_flags = 0;
+	header.os = GZIP_OS_UNKNOWN;
+
+	ret = sink(arg, &header, sizeof(header));
+	if (ret != EOK) {
+		gzip_writer_destroy(writer);
+		return ret;
+	}
+
+	*rwriter = writer;
+	return EOK;
+}
+
+/** Compress data into the GZIP stream
+ *
+ * @param[in] writer GZIP writer.
+ * @param[in] data   Data to compress.
+ * @param[in] size   Size of the data (bytes).
+ *
+ * @return EOK on success or an error code returned by the sink.
+ *
+ */
+errno_t gzip_writer_write(gzip_writer_t *writer, const void *data, size_t size)
+{
+	writer->crc32 = compute_crc32_seed((uint8_t *) data, size,
+	    writer->crc32);
+	writer->size += size;
+
+	return deflate_write(writer->deflate, data, size);
+}
+
+/** Finish the GZIP stream
+ *
+ * The remaining compressed data and the footer are passed to the sink.
+ *
+ * @param[in] writer GZIP writer.
+ *
+ * @return EOK on success or an error code returned by the sink.
+ *
+ */
+errno_t gzip_writer_finish(gzip_writer_t *writer)
+{
+	errno_t ret = deflate_finish(writer->deflate);
+	if (ret != EOK)
+		return ret;
+
+	gzip_footer_t footer;
+
+	footer.crc32 = host2uint32_t_le(writer->crc32);
+	footer.size = host2uint32_t_le(writer->size);
+
+	return writer->sink(writer->sink_arg, &footer, sizeof(footer));
+}
+
+/** Destroy a GZIP writer
+ *
+ * @param[in] writer GZIP writer.
+ *
+ */
+void gzip_writer_destroy(gzip_writer_t *writer)
+{
+	deflate_destroy(writer->deflate);
+	free(writer);
+}
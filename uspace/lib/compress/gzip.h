@@ -30,7 +30,20 @@
 #define LIBCOMPRESS_GZIP_H_
 
 #include <stddef.h>
+#include "inflate.h"
+#include "deflate.h"
+
+typedef struct gzip_writer gzip_writer_t;
 
 extern errno_t gzip_expand(void *, size_t, void **, size_t *);
+extern errno_t gzip_expand_stream(void *, size_t, inflate_sink_t, void *);
+extern errno_t gzip_expand_pipe(inflate_source_t, void *, inflate_sink_t,
+    void *);
+
+extern errno_t gzip_writer_create(unsigned int, deflate_sink_t, void *,
+    gzip_writer_t **);
+extern errno_t gzip_writer_write(gzip_writer_t *, const void *, size_t);
+extern errno_t gzip_writer_finish(gzip_writer_t *);
+extern void gzip_writer_destroy(gzip_writer_t *);
 
 #endif
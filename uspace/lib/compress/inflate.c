@@ -31,11 +31,13 @@
  * @brief Implementation of inflate decompression
  *
  * A simple inflate implementation (decompression of `deflate' stream as
- * described by RFC 1951) based on puff.c by Mark Adler. This code is
- * currently not optimized for speed but for readability.
+ * described by RFC 1951) based on puff.c by Mark Adler. The structure
+ * follows puff.c, but Huffman codes of up to FAST_BITS bits are decoded
+ * by a single table lookup instead of bit by bit.
  *
- * All dynamically allocated memory memory is taken from the stack. The
- * stack usage should be typically bounded by 2 KB.
+ * Apart from the window and the input buffer used when streaming, all
+ * memory is taken from the stack. The stack usage should be typically
+ * bounded by 8 KB.
  *
  * Original copyright notice:
  *
@@ -68,6 +70,8 @@
 #include <stdbool.h>
 #include <errno.h>
 #include <mem.h>
+#include <macros.h>
+#include <stdlib.h>
 #include "inflate.h"
 
 /** Maximum bits in the Huffman code */
@@ -87,6 +91,30 @@
 /** Number of all codes */
 #define MAX_CODE  (MAX_LITLEN + MAX_DIST)
 
+/** Number of bits decoded by a single lookup in the fast table */
+#define FAST_BITS  9
+#define FAST_SIZE  (1 << FAST_BITS)
+#define FAST_MASK  (FAST_SIZE - 1)
+
+/** Fast table entry: code length above the symbol, zero length if absent */
+#define FAST_SYMBOL_BITS  9
+#define FAST_SYMBOL_MASK  ((1 << FAST_SYMBOL_BITS) - 1)
+
+/** Size of the input buffer used by streaming inflate */
+#define INPUT_SIZE  16384
+
+/** Maximum back-reference distance */
+#define WINDOW_SIZE  32768
+
+/** Size of the ring buffer used by streaming inflate
+ *
+ * Twice the window, so that a full window of history is always
+ * available while the other half is being handed to the sink.
+ *
+ */
+#define RING_SIZE  (2 * WINDOW_SIZE)
+#define RING_MASK  (RING_SIZE - 1)
+
 /** Check for input buffer overrun condition */
 #define CHECK_OVERRUN(state) \
 	do { \
@@ -99,18 +127,30 @@
  *
  */
 typedef struct {
-	uint8_t *dest;    /**< Output buffer */
+	uint8_t *dest;    /**< Output buffer (ring buffer when streaming) */
 	size_t destlen;   /**< Output buffer size */
 	size_t destcnt;   /**< Position in the output buffer */
 
+	inflate_sink_t sink;  /**< Output sink (NULL if not streaming) */
+	void *sink_arg;       /**< Output sink argument */
+	size_t flushed;       /**< Output bytes already passed to the sink */
+
 	uint8_t *src;     /**< Input buffer */
 	size_t srclen;    /**< Input buffer size */
 	size_t srccnt;    /**< Position in the input buffer */
 
-	uint16_t bitbuf;  /**< Bit buffer */
+	inflate_source_t source;  /**< Input source (NULL if not streaming) */
+	void *source_arg;         /**< Input source argument */
+	errno_t source_rc;        /**< Error returned by the input source */
+
+	uint32_t bitbuf;  /**< Bit buffer */
 	size_t bitlen;    /**< Number of bits in the bit buffer */
 
 	bool overrun;     /**< Overrun condition */
+
+	bool fixed_ready;                   /**< Fixed fast tables built */
+	uint16_t fixed_len_fast[FAST_SIZE];   /**< Fixed literal/length table */
+	uint16_t fixed_dist_fast[FAST_SIZE];  /**< Fixed distance table */
 } inflate_state_t;
 
 /** Huffman code description
@@ -119,6 +159,7 @@ typedef struct {
 typedef struct {
 	uint16_t *count;   /**< Array of symbol counts */
 	uint16_t *symbol;  /**< Array of symbols */
+	uint16_t *fast;    /**< Lookup table for codes of up to FAST_BITS */
 } huffman_t;
 
 /** Length codes
@@ -211,21 +252,54 @@ static uint16_t dist_symbol[MAX_DIST] = {
 	16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29
 };
 
-/** Huffman code for lengths
+/** Refill the input buffer from the source
+ *
+ * @param state Inflate state.
+ *
+ * @return True if more input is available.
  *
  */
-static huffman_t len_code = {
-	.count = len_count,
-	.symbol = len_symbol
-};
+static bool fill_input(inflate_state_t *state)
+{
+	if ((state->source == NULL) || (state->source_rc != EOK))
+		return false;
+
+	size_t nread;
+	errno_t rc = state->source(state->source_arg, state->src, INPUT_SIZE,
+	    &nread);
+	if (rc != EOK) {
+		state->source_rc = rc;
+		return false;
+	}
+
+	if (nread == 0)
+		return false;
+
+	state->srclen = nread;
+	state->srccnt = 0;
+	return true;
+}
 
-/** Huffman code for distances
+/** Load bits into the bit buffer without consuming them
+ *
+ * Fewer bits are loaded if the input ends earlier.
+ *
+ * @param state Inflate state.
+ * @param cnt   Number of bits to have in the bit buffer (at most 24).
  *
  */
-static huffman_t dist_code = {
-	.count = dist_count,
-	.symbol = dist_symbol
-};
+static inline void load_bits(inflate_state_t *state, size_t cnt)
+{
+	while (state->bitlen < cnt) {
+		if ((state->srccnt == state->srclen) && (!fill_input(state)))
+			return;
+
+		state->bitbuf |= ((uint32_t) state->src[state->srccnt]) <<
+		    state->bitlen;
+		state->srccnt++;
+		state->bitlen += 8;
+	}
+}
 
 /** Get bits from the bit buffer
  *
@@ -237,26 +311,135 @@ static huffman_t dist_code = {
  */
 static inline uint16_t get_bits(inflate_state_t *state, size_t cnt)
 {
-	/* Bit accumulator for at least 20 bits */
-	uint32_t val = state->bitbuf;
-
-	while (state->bitlen < cnt) {
-		if (state->srccnt == state->srclen) {
-			state->overrun = true;
-			return 0;
-		}
-
-		/* Load 8 more bits */
-		val |= ((uint32_t) state->src[state->srccnt]) << state->bitlen;
-		state->srccnt++;
-		state->bitlen += 8;
+	load_bits(state, cnt);
+	if (state->bitlen < cnt) {
+		state->overrun = true;
+		return 0;
 	}
 
+	uint16_t val = (uint16_t) (state->bitbuf & ((1 << cnt) - 1));
+
 	/* Update bits in the buffer */
-	state->bitbuf = (uint16_t) (val >> cnt);
+	state->bitbuf >>= cnt;
 	state->bitlen -= cnt;
 
-	return ((uint16_t) (val & ((1 << cnt) - 1)));
+	return val;
+}
+
+/** Pass pending output to the sink
+ *
+ * @param state Inflate state.
+ *
+ * @return EOK on success or an error code returned by the sink.
+ *
+ */
+static errno_t flush_output(inflate_state_t *state)
+{
+	while (state->flushed < state->destcnt) {
+		size_t start = state->flushed & RING_MASK;
+		size_t size = state->destcnt - state->flushed;
+
+		if (start + size > RING_SIZE)
+			size = RING_SIZE - start;
+
+		errno_t rc = state->sink(state->sink_arg, state->dest + start, size);
+		if (rc != EOK)
+			return rc;
+
+		state->flushed += size;
+	}
+
+	return EOK;
+}
+
+/** Write an output byte
+ *
+ * @param state Inflate state.
+ * @param byte  Byte to write.
+ *
+ * @return EOK on success.
+ * @return ENOMEM on output buffer overrun.
+ *
+ */
+static inline errno_t put_byte(inflate_state_t *state, uint8_t byte)
+{
+	if (state->sink == NULL) {
+		if (state->destcnt == state->destlen)
+			return ENOMEM;
+
+		state->dest[state->destcnt] = byte;
+		state->destcnt++;
+		return EOK;
+	}
+
+	if (state->destcnt - state->flushed == WINDOW_SIZE) {
+		errno_t rc = flush_output(state);
+		if (rc != EOK)
+			return rc;
+	}
+
+	state->dest[state->destcnt & RING_MASK] = byte;
+	state->destcnt++;
+	return EOK;
+}
+
+/** Read an already written output byte
+ *
+ * @param state Inflate state.
+ * @param dist  Distance back from the current output position.
+ *
+ * @return Output byte.
+ *
+ */
+static inline uint8_t get_byte(inflate_state_t *state, size_t dist)
+{
+	if (state->sink == NULL)
+		return state->dest[state->destcnt - dist];
+
+	return state->dest[(state->destcnt - dist) & RING_MASK];
+}
+
+/** Write a block of output bytes
+ *
+ * @param state Inflate state.
+ * @param data  Bytes to write.
+ * @param size  Number of bytes.
+ *
+ * @return EOK on success.
+ * @return ENOMEM on output buffer overrun.
+ *
+ */
+static errno_t put_block(inflate_state_t *state, const uint8_t *data,
+    size_t size)
+{
+	if (state->sink == NULL) {
+		if (state->destcnt + size > state->destlen)
+			return ENOMEM;
+
+		memcpy(state->dest + state->destcnt, data, size);
+		state->destcnt += size;
+		return EOK;
+	}
+
+	while (size > 0) {
+		if (state->destcnt - state->flushed == WINDOW_SIZE) {
+			errno_t rc = flush_output(state);
+			if (rc != EOK)
+				return rc;
+		}
+
+		size_t pos = state->destcnt & RING_MASK;
+		size_t chunk = min(size, WINDOW_SIZE -
+		    (state->destcnt - state->flushed));
+		chunk = min(chunk, RING_SIZE - pos);
+
+		memcpy(state->dest + pos, data, chunk);
+		state->destcnt += chunk;
+		data += chunk;
+		size -= chunk;
+	}
+
+	return EOK;
 }
 
 /** Decode `stored' block
@@ -271,36 +454,46 @@ static inline uint16_t get_bits(inflate_state_t *state, size_t cnt)
  */
 static errno_t inflate_stored(inflate_state_t *state)
 {
-	/* Discard bits in the bit buffer */
-	state->bitbuf = 0;
-	state->bitlen = 0;
+	/* Discard bits up to the byte boundary */
+	size_t skip = state->bitlen & 7;
+	state->bitbuf >>= skip;
+	state->bitlen -= skip;
 
-	if (state->srccnt + 4 > state->srclen)
-		return ELIMIT;
+	uint16_t len = get_bits(state, 16);
+	CHECK_OVERRUN(*state);
 
-	uint16_t len =
-	    state->src[state->srccnt] | (state->src[state->srccnt + 1] << 8);
-	uint16_t len_compl =
-	    state->src[state->srccnt + 2] | (state->src[state->srccnt + 3] << 8);
+	uint16_t len_compl = get_bits(state, 16);
+	CHECK_OVERRUN(*state);
 
 	/* Check block length and its complement */
-	if (((int16_t) len) != ~((int16_t) len_compl))
+	if ((len ^ len_compl) != 0xffff)
 		return EINVAL;
 
-	state->srccnt += 4;
+	if ((state->sink == NULL) && (state->destcnt + len > state->destlen))
+		return ENOMEM;
 
-	/* Check input buffer size */
-	if (state->srccnt + len > state->srclen)
-		return ELIMIT;
+	/* Whole bytes which are already in the bit buffer */
+	while ((len > 0) && (state->bitlen > 0)) {
+		errno_t rc = put_byte(state, (uint8_t) get_bits(state, 8));
+		if (rc != EOK)
+			return rc;
 
-	/* Check output buffer size */
-	if (state->destcnt + len > state->destlen)
-		return ENOMEM;
+		len--;
+	}
 
 	/* Copy data */
-	memcpy(state->dest + state->destcnt, state->src + state->srccnt, len);
-	state->srccnt += len;
-	state->destcnt += len;
+	while (len > 0) {
+		if ((state->srccnt == state->srclen) && (!fill_input(state)))
+			return ELIMIT;
+
+		size_t chunk = min(len, state->srclen - state->srccnt);
+		errno_t rc = put_block(state, state->src + state->srccnt, chunk);
+		if (rc != EOK)
+			return rc;
+
+		state->srccnt += chunk;
+		len -= chunk;
+	}
 
 	return EOK;
 }
@@ -318,6 +511,18 @@ static errno_t inflate_stored(inflate_state_t *state)
 static errno_t huffman_decode(inflate_state_t *state, huffman_t *huffman,
     uint16_t *symbol)
 {
+	/* Short codes are resolved by a single lookup */
+	load_bits(state, FAST_BITS);
+
+	uint16_t entry = huffman->fast[state->bitbuf & FAST_MASK];
+	size_t fast_len = entry >> FAST_SYMBOL_BITS;
+	if ((fast_len != 0) && (fast_len <= state->bitlen)) {
+		state->bitbuf >>= fast_len;
+		state->bitlen -= fast_len;
+		*symbol = entry & FAST_SYMBOL_MASK;
+		return EOK;
+	}
+
 	/* Decode bits */
 	uint16_t code = 0;
 
@@ -355,6 +560,39 @@ static errno_t huffman_decode(inflate_state_t *state, huffman_t *huffman,
 	return EINVAL;
 }
 
+/** Fill the fast lookup table of a Huffman code
+ *
+ * The bits of a code are read starting from its most significant bit,
+ * so each code is entered bit-reversed and replicated for all values
+ * of the bits following it.
+ *
+ * @param huffman Huffman code with valid counts and symbols.
+ *
+ */
+static void huffman_fast(huffman_t *huffman)
+{
+	uint16_t code = 0;
+	size_t index = 0;
+
+	for (size_t len = 1; len <= FAST_BITS; len++) {
+		for (size_t i = 0; i < huffman->count[len]; i++) {
+			uint16_t rev = 0;
+			for (size_t bit = 0; bit < len; bit++)
+				rev |= ((code >> bit) & 1) << (len - 1 - bit);
+
+			uint16_t entry = (len << FAST_SYMBOL_BITS) |
+			    huffman->symbol[index];
+			for (size_t fill = rev; fill < FAST_SIZE; fill += 1 << len)
+				huffman->fast[fill] = entry;
+
+			code++;
+			index++;
+		}
+
+		code <<= 1;
+	}
+}
+
 /** Construct Huffman tables from canonical Huffman code
  *
  * @param huffman Constructed Huffman tables.
@@ -368,6 +606,8 @@ static errno_t huffman_decode(inflate_state_t *state, huffman_t *huffman,
  */
 static int16_t huffman_construct(huffman_t *huffman, uint16_t *length, size_t n)
 {
+	memset(huffman->fast, 0, FAST_SIZE * sizeof(uint16_t));
+
 	/* Count number of codes for each length */
 	size_t len;
 	for (len = 0; len <= MAX_HUFFMAN_BIT; len++)
@@ -408,6 +648,7 @@ static int16_t huffman_construct(huffman_t *huffman, uint16_t *length, size_t n)
 		}
 	}
 
+	huffman_fast(huffman);
 	return left;
 }
 
@@ -440,11 +681,9 @@ static errno_t inflate_codes(inflate_state_t *state, huffman_t *len_code,
 
 		if (symbol < 256) {
 			/* Write out literal */
-			if (state->destcnt == state->destlen)
-				return ENOMEM;
-
-			state->dest[state->destcnt] = (uint8_t) symbol;
-			state->destcnt++;
+			err = put_byte(state, (uint8_t) symbol);
+			if (err != EOK)
+				return err;
 		} else if (symbol > 256) {
 			/* Compute length */
 			symbol -= 257;
@@ -460,17 +699,19 @@ static errno_t inflate_codes(inflate_state_t *state, huffman_t *len_code,
 				return err;
 
 			size_t dist = dists[symbol] + get_bits(state, dists_ext[symbol]);
-			if (dist > state->destcnt)
+			if ((dist > state->destcnt) || (dist > WINDOW_SIZE))
 				return ENOENT;
 
-			if (state->destcnt + len > state->destlen)
+			if ((state->sink == NULL) &&
+			    (state->destcnt + len > state->destlen))
 				return ENOMEM;
 
 			while (len > 0) {
 				/* Copy len bytes from distance bytes back */
-				state->dest[state->destcnt] =
-				    state->dest[state->destcnt - dist];
-				state->destcnt++;
+				err = put_byte(state, get_byte(state, dist));
+				if (err != EOK)
+					return err;
+
 				len--;
 			}
 		}
@@ -481,9 +722,7 @@ static errno_t inflate_codes(inflate_state_t *state, huffman_t *len_code,
 
 /** Decode `fixed codes' block
  *
- * @param state     Inflate state.
- * @param len_code  Huffman code for literal/length.
- * @param dist_code Huffman code for distance.
+ * @param state Inflate state.
  *
  * @return EOK on success.
  * @return ENOENT on distance too large.
@@ -492,10 +731,27 @@ static errno_t inflate_codes(inflate_state_t *state, huffman_t *len_code,
  * @return ENOMEM on output buffer overrun.
  *
  */
-static errno_t inflate_fixed(inflate_state_t *state, huffman_t *len_code,
-    huffman_t *dist_code)
+static errno_t inflate_fixed(inflate_state_t *state)
 {
-	return inflate_codes(state, len_code, dist_code);
+	huffman_t len_code = {
+		.count = len_count,
+		.symbol = len_symbol,
+		.fast = state->fixed_len_fast
+	};
+
+	huffman_t dist_code = {
+		.count = dist_count,
+		.symbol = dist_symbol,
+		.fast = state->fixed_dist_fast
+	};
+
+	if (!state->fixed_ready) {
+		huffman_fast(&len_code);
+		huffman_fast(&dist_code);
+		state->fixed_ready = true;
+	}
+
+	return inflate_codes(state, &len_code, &dist_code);
 }
 
 /** Decode `dynamic codes' block
@@ -516,14 +772,18 @@ static errno_t inflate_dynamic(inflate_state_t *state)
 	uint16_t dyn_len_symbol[MAX_LITLEN];
 	uint16_t dyn_dist_count[MAX_HUFFMAN_BIT + 1];
 	uint16_t dyn_dist_symbol[MAX_DIST];
+	uint16_t dyn_len_fast[FAST_SIZE];
+	uint16_t dyn_dist_fast[FAST_SIZE];
 	huffman_t dyn_len_code;
 	huffman_t dyn_dist_code;
 
 	dyn_len_code.count = dyn_len_count;
 	dyn_len_code.symbol = dyn_len_symbol;
+	dyn_len_code.fast = dyn_len_fast;
 
 	dyn_dist_code.count = dyn_dist_count;
 	dyn_dist_code.symbol = dyn_dist_symbol;
+	dyn_dist_code.fast = dyn_dist_fast;
 
 	/* Get number of bits in each table */
 	uint16_t nlen = get_bits(state, 5) + 257;
@@ -561,7 +821,7 @@ static errno_t inflate_dynamic(inflate_state_t *state)
 		uint16_t symbol;
 		errno_t err = huffman_decode(state, &dyn_len_code, &symbol);
 		if (err != EOK)
-			return EOK;
+			return err;
 
 		if (symbol < 16) {
 			length[index] = symbol;
@@ -612,6 +872,82 @@ static errno_t inflate_dynamic(inflate_state_t *state)
 	return inflate_codes(state, &dyn_len_code, &dyn_dist_code);
 }
 
+/** Inflate all blocks of a deflate stream
+ *
+ * @param state Initialized inflate state.
+ *
+ * @return EOK on success or an error code.
+ *
+ */
+static errno_t inflate_blocks(inflate_state_t *state)
+{
+	uint16_t last;
+	errno_t ret = EOK;
+
+	do {
+		/* Last block is indicated by a non-zero bit */
+		last = get_bits(state, 1);
+		CHECK_OVERRUN(*state);
+
+		/* Block type */
+		uint16_t type = get_bits(state, 2);
+		CHECK_OVERRUN(*state);
+
+		switch (type) {
+		case 0:
+			ret = inflate_stored(state);
+			break;
+		case 1:
+			ret = inflate_fixed(state);
+			break;
+		case 2:
+			ret = inflate_dynamic(state);
+			break;
+		default:
+			ret = EINVAL;
+		}
+	} while ((!last) && (ret == 0));
+
+	/* Running out of input is reported as the source error, if any */
+	if ((ret == ELIMIT) && (state->source_rc != EOK))
+		return state->source_rc;
+
+	return ret;
+}
+
+/** Initialize inflate state
+ *
+ * @param state  Inflate state.
+ * @param src    Source data buffer.
+ * @param srclen Source buffer size (bytes).
+ *
+ */
+static void inflate_state_init(inflate_state_t *state, void *src,
+    size_t srclen)
+{
+	state->dest = NULL;
+	state->destlen = 0;
+	state->destcnt = 0;
+
+	state->sink = NULL;
+	state->sink_arg = NULL;
+	state->flushed = 0;
+
+	state->src = (uint8_t *) src;
+	state->srclen = srclen;
+	state->srccnt = 0;
+
+	state->source = NULL;
+	state->source_arg = NULL;
+	state->source_rc = EOK;
+
+	state->bitbuf = 0;
+	state->bitlen = 0;
+
+	state->overrun = false;
+	state->fixed_ready = false;
+}
+
 /** Inflate data
  *
  * @param src     Source data buffer.
@@ -628,48 +964,109 @@ static errno_t inflate_dynamic(inflate_state_t *state)
  */
 errno_t inflate(void *src, size_t srclen, void *dest, size_t destlen)
 {
-	/* Initialize the state */
 	inflate_state_t state;
 
+	inflate_state_init(&state, src, srclen);
 	state.dest = (uint8_t *) dest;
 	state.destlen = destlen;
-	state.destcnt = 0;
 
-	state.src = (uint8_t *) src;
-	state.srclen = srclen;
-	state.srccnt = 0;
+	return inflate_blocks(&state);
+}
 
-	state.bitbuf = 0;
-	state.bitlen = 0;
+/** Inflate data into a sink
+ *
+ * The decompressed data is not collected into a single buffer.
+ * Instead, it is passed to the sink in chunks of at most 32 KiB
+ * as the decoding progresses, so the caller can consume it
+ * (e.g. decode an image row by row) without ever holding the
+ * whole uncompressed stream in memory.
+ *
+ * @param src     Source data buffer.
+ * @param srclen  Source buffer size (bytes).
+ * @param sink    Function receiving the decompressed data.
+ * @param arg     Argument passed to the sink.
+ *
+ * @return EOK on success.
+ * @return ENOENT on distance too large.
+ * @return EINVAL on invalid Huffman code or invalid deflate data.
+ * @return ELIMIT on input buffer overrun.
+ * @return ENOMEM on out of memory.
+ * @return Error code returned by the sink.
+ *
+ */
+errno_t inflate_stream(void *src, size_t srclen, inflate_sink_t sink,
+    void *arg)
+{
+	inflate_state_t state;
 
-	state.overrun = false;
+	inflate_state_init(&state, src, srclen);
+	state.sink = sink;
+	state.sink_arg = arg;
+	state.dest = malloc(RING_SIZE);
+	if (state.dest == NULL)
+		return ENOMEM;
 
-	uint16_t last;
-	errno_t ret = EOK;
+	state.destlen = RING_SIZE;
 
-	do {
-		/* Last block is indicated by a non-zero bit */
-		last = get_bits(&state, 1);
-		CHECK_OVERRUN(state);
+	errno_t ret = inflate_blocks(&state);
+	if (ret == EOK)
+		ret = flush_output(&state);
 
-		/* Block type */
-		uint16_t type = get_bits(&state, 2);
-		CHECK_OVERRUN(state);
+	free(state.dest);
+	return ret;
+}
 
-		switch (type) {
-		case 0:
-			ret = inflate_stored(&state);
-			break;
-		case 1:
-			ret = inflate_fixed(&state, &len_code, &dist_code);
-			break;
-		case 2:
-			ret = inflate_dynamic(&state);
-			break;
-		default:
-			ret = EINVAL;
-		}
-	} while ((!last) && (ret == 0));
+/** Inflate data from a source into a sink
+ *
+ * Neither the compressed nor the decompressed data need to be held in
+ * memory as a whole. The input is pulled from the source in chunks
+ * of at most 16 KiB and the output is passed to the sink in chunks of
+ * at most 32 KiB.
+ *
+ * The input may be read ahead past the end of the deflate stream,
+ * such data are lost.
+ *
+ * @param source     Function providing the compressed data.
+ * @param source_arg Argument passed to the source.
+ * @param sink       Function receiving the decompressed data.
+ * @param sink_arg   Argument passed to the sink.
+ *
+ * @return EOK on success.
+ * @return ENOENT on distance too large.
+ * @return EINVAL on invalid Huffman code or invalid deflate data.
+ * @return ELIMIT on premature end of input.
+ * @return ENOMEM on out of memory.
+ * @return Error code returned by the source or the sink.
+ *
+ */
+errno_t inflate_pipe(inflate_source_t source, void *source_arg,
+    inflate_sink_t sink, void *sink_arg)
+{
+	inflate_state_t state;
+
+	inflate_state_init(&state, NULL, 0);
+	state.source = source;
+	state.source_arg = source_arg;
+	state.sink = sink;
+	state.sink_arg = sink_arg;
+
+	state.src = malloc(INPUT_SIZE);
+	if (state.src == NULL)
+		return ENOMEM;
+
+	state.dest = malloc(RING_SIZE);
+	if (state.dest == NULL) {
+		free(state.src);
+		return ENOMEM;
+	}
+
+	state.destlen = RING_SIZE;
+
+	errno_t ret = inflate_blocks(&state);
+	if (ret == EOK)
+		ret = flush_output(&state);
 
+	free(state.dest);
+	free(state.src);
 	return ret;
 }
@@ -31,6 +31,31 @@
 
 #include <stddef.h>
 
+/** Inflate output sink
+ *
+ * @param arg  Sink argument.
+ * @param data Decompressed data.
+ * @param size Size of the decompressed data (bytes).
+ *
+ * @return EOK to continue decompression, error code to abort it.
+ *
+ */
+typedef errno_t (*inflate_sink_t)(void *, const void *, size_t);
+
+/** Inflate input source
+ *
+ * @param arg   Source argument.
+ * @param buf   Buffer for the compressed data.
+ * @param size  Size of the buffer (bytes).
+ * @param nread Number of bytes stored, zero at the end of input.
+ *
+ * @return EOK on success, error code to abort decompression.
+ *
+ */
+typedef errno_t (*inflate_source_t)(void *, void *, size_t, size_t *);
+
 extern errno_t inflate(void *, size_t, void *, size_t);
+extern errno_t inflate_stream(void *, size_t, inflate_sink_t, void *);
+extern errno_t inflate_pipe(inflate_source_t, void *, inflate_sink_t, void *);
 
 #endif
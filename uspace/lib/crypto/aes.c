@@ -28,426 +28,731 @@
 
 /** @file aes.c
  *
- * Implementation of AES-128 symmetric cipher cryptographic algorithm.
+ * Implementation of AES symmetric cipher cryptographic algorithm
+ * and its block cipher modes.
  *
- * Based on FIPS 197.
+ * Based on FIPS 197. The key is expanded once into an aes_key_t which is
+ * then reused for any number of blocks. Blocks are processed using
+ * tables combining the byte substitution with the column mixing, or
+ * using the AES instructions of the CPU where available (amd64).
+ *
+ * The modes follow NIST SP 800-38A (CBC, CTR), SP 800-38C (CCM) and
+ * SP 800-38D (GCM).
  */
 
 #include <stdbool.h>
 #include <errno.h>
 #include <mem.h>
+#include <macros.h>
 #include "crypto.h"
 
-/* Number of elements in rows/columns in AES arrays. */
-#define ELEMS  4
-
-/* Number of elements (words) in cipher. */
-#define CIPHER_ELEMS  4
-
 /* Length of AES block. */
-#define BLOCK_LEN  16
+#define BLOCK_LEN  AES_BLOCK_LENGTH
 
-/* Number of iterations in AES algorithm. */
-#define ROUNDS  10
+/* Number of words in a round key. */
+#define ELEMS  4
 
-/** Irreducible polynomial used in AES algorithm.
- *
- * NOTE: x^8 + x^4 + x^3 + x + 1.
- *
- */
-#define AES_IP  0x1b
+/* Number of blocks processed together by the bulk modes. */
+#define BULK_BLOCKS  16
 
 /** Precomputed values for AES sub_byte transformation. */
-static const uint8_t sbox[BLOCK_LEN][BLOCK_LEN] = {
-	{
-		0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5,
-		0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76
-	},
-	{
-		0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0,
-		0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0
-	},
-	{
-		0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc,
-		0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15
-	},
-	{
-		0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a,
-		0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75
-	},
-	{
-		0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0,
-		0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84
-	},
-	{
-		0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b,
-		0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf
-	},
-	{
-		0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85,
-		0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8
-	},
-	{
-		0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5,
-		0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2
-	},
-	{
-		0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17,
-		0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73
-	},
-	{
-		0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88,
-		0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb
-	},
-	{
-		0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c,
-		0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79
-	},
-	{
-		0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9,
-		0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08
-	},
-	{
-		0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6,
-		0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a
-	},
-	{
-		0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e,
-		0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e
-	},
-	{
-		0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94,
-		0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf
-	},
-	{
-		0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68,
-		0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16
-	}
+static const uint8_t sbox[256] = {
+	0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5,
+	0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+	0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0,
+	0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+	0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc,
+	0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+	0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a,
+	0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+	0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0,
+	0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+	0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b,
+	0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+	0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85,
+	0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+	0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5,
+	0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+	0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17,
+	0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+	0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88,
+	0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+	0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c,
+	0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+	0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9,
+	0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+	0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6,
+	0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+	0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e,
+	0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+	0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94,
+	0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+	0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68,
+	0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16
 };
 
 /** Precomputed values for AES inv_sub_byte transformation. */
-static uint8_t inv_sbox[BLOCK_LEN][BLOCK_LEN] = {
-	{
-		0x52, 0x09, 0x6a, 0xd5, 0x30, 0x36, 0xa5, 0x38,
-		0xbf, 0x40, 0xa3, 0x9e, 0x81, 0xf3, 0xd7, 0xfb
-	},
-	{
-		0x7c, 0xe3, 0x39, 0x82, 0x9b, 0x2f, 0xff, 0x87,
-		0x34, 0x8e, 0x43, 0x44, 0xc4, 0xde, 0xe9, 0xcb
-	},
-	{
-		0x54, 0x7b, 0x94, 0x32, 0xa6, 0xc2, 0x23, 0x3d,
-		0xee, 0x4c, 0x95, 0x0b, 0x42, 0xfa, 0xc3, 0x4e
-	},
-	{
-		0x08, 0x2e, 0xa1, 0x66, 0x28, 0xd9, 0x24, 0xb2,
-		0x76, 0x5b, 0xa2, 0x49, 0x6d, 0x8b, 0xd1, 0x25
-	},
-	{
-		0x72, 0xf8, 0xf6, 0x64, 0x86, 0x68, 0x98, 0x16,
-		0xd4, 0xa4, 0x5c, 0xcc, 0x5d, 0x65, 0xb6, 0x92
-	},
-	{
-		0x6c, 0x70, 0x48, 0x50, 0xfd, 0xed, 0xb9, 0xda,
-		0x5e, 0x15, 0x46, 0x57, 0xa7, 0x8d, 0x9d, 0x84
-	},
-	{
-		0x90, 0xd8, 0xab, 0x00, 0x8c, 0xbc, 0xd3, 0x0a,
-		0xf7, 0xe4, 0x58, 0x05, 0xb8, 0xb3, 0x45, 0x06
-	},
-	{
-		0xd0, 0x2c, 0x1e, 0x8f, 0xca, 0x3f, 0x0f, 0x02,
-		0xc1, 0xaf, 0xbd, 0x03, 0x01, 0x13, 0x8a, 0x6b
-	},
-	{
-		0x3a, 0x91, 0x11, 0x41, 0x4f, 0x67, 0xdc, 0xea,
-		0x97, 0xf2, 0xcf, 0xce, 0xf0, 0xb4, 0xe6, 0x73
-	},
-	{
-		0x96, 0xac, 0x74, 0x22, 0xe7, 0xad, 0x35, 0x85,
-		0xe2, 0xf9, 0x37, 0xe8, 0x1c, 0x75, 0xdf, 0x6e
-	},
-	{
-		0x47, 0xf1, 0x1a, 0x71, 0x1d, 0x29, 0xc5, 0x89,
-		0x6f, 0xb7, 0x62, 0x0e, 0xaa, 0x18, 0xbe, 0x1b
-	},
-	{
-		0xfc, 0x56, 0x3e, 0x4b, 0xc6, 0xd2, 0x79, 0x20,
-		0x9a, 0xdb, 0xc0, 0xfe, 0x78, 0xcd, 0x5a, 0xf4
-	},
-	{
-		0x1f, 0xdd, 0xa8, 0x33, 0x88, 0x07, 0xc7, 0x31,
-		0xb1, 0x12, 0x10, 0x59, 0x27, 0x80, 0xec, 0x5f
-	},
-	{
-		0x60, 0x51, 0x7f, 0xa9, 0x19, 0xb5, 0x4a, 0x0d,
-		0x2d, 0xe5, 0x7a, 0x9f, 0x93, 0xc9, 0x9c, 0xef
-	},
-	{
-		0xa0, 0xe0, 0x3b, 0x4d, 0xae, 0x2a, 0xf5, 0xb0,
-		0xc8, 0xeb, 0xbb, 0x3c, 0x83, 0x53, 0x99, 0x61
-	},
-	{
-		0x17, 0x2b, 0x04, 0x7e, 0xba, 0x77, 0xd6, 0x26,
-		0xe1, 0x69, 0x14, 0x63, 0x55, 0x21, 0x0c, 0x7d
-	}
+static const uint8_t inv_sbox[256] = {
+	0x52, 0x09, 0x6a, 0xd5, 0x30, 0x36, 0xa5, 0x38,
+	0xbf, 0x40, 0xa3, 0x9e, 0x81, 0xf3, 0xd7, 0xfb,
+	0x7c, 0xe3, 0x39, 0x82, 0x9b, 0x2f, 0xff, 0x87,
+	0x34, 0x8e, 0x43, 0x44, 0xc4, 0xde, 0xe9, 0xcb,
+	0x54, 0x7b, 0x94, 0x32, 0xa6, 0xc2, 0x23, 0x3d,
+	0xee, 0x4c, 0x95, 0x0b, 0x42, 0xfa, 0xc3, 0x4e,
+	0x08, 0x2e, 0xa1, 0x66, 0x28, 0xd9, 0x24, 0xb2,
+	0x76, 0x5b, 0xa2, 0x49, 0x6d, 0x8b, 0xd1, 0x25,
+	0x72, 0xf8, 0xf6, 0x64, 0x86, 0x68, 0x98, 0x16,
+	0xd4, 0xa4, 0x5c, 0xcc, 0x5d, 0x65, 0xb6, 0x92,
+	0x6c, 0x70, 0x48, 0x50, 0xfd, 0xed, 0xb9, 0xda,
+	0x5e, 0x15, 0x46, 0x57, 0xa7, 0x8d, 0x9d, 0x84,
+	0x90, 0xd8, 0xab, 0x00, 0x8c, 0xbc, 0xd3, 0x0a,
+	0xf7, 0xe4, 0x58, 0x05, 0xb8, 0xb3, 0x45, 0x06,
+	0xd0, 0x2c, 0x1e, 0x8f, 0xca, 0x3f, 0x0f, 0x02,
+	0xc1, 0xaf, 0xbd, 0x03, 0x01, 0x13, 0x8a, 0x6b,
+	0x3a, 0x91, 0x11, 0x41, 0x4f, 0x67, 0xdc, 0xea,
+	0x97, 0xf2, 0xcf, 0xce, 0xf0, 0xb4, 0xe6, 0x73,
+	0x96, 0xac, 0x74, 0x22, 0xe7, 0xad, 0x35, 0x85,
+	0xe2, 0xf9, 0x37, 0xe8, 0x1c, 0x75, 0xdf, 0x6e,
+	0x47, 0xf1, 0x1a, 0x71, 0x1d, 0x29, 0xc5, 0x89,
+	0x6f, 0xb7, 0x62, 0x0e, 0xaa, 0x18, 0xbe, 0x1b,
+	0xfc, 0x56, 0x3e, 0x4b, 0xc6, 0xd2, 0x79, 0x20,
+	0x9a, 0xdb, 0xc0, 0xfe, 0x78, 0xcd, 0x5a, 0xf4,
+	0x1f, 0xdd, 0xa8, 0x33, 0x88, 0x07, 0xc7, 0x31,
+	0xb1, 0x12, 0x10, 0x59, 0x27, 0x80, 0xec, 0x5f,
+	0x60, 0x51, 0x7f, 0xa9, 0x19, 0xb5, 0x4a, 0x0d,
+	0x2d, 0xe5, 0x7a, 0x9f, 0x93, 0xc9, 0x9c, 0xef,
+	0xa0, 0xe0, 0x3b, 0x4d, 0xae, 0x2a, 0xf5, 0xb0,
+	0xc8, 0xeb, 0xbb, 0x3c, 0x83, 0x53, 0x99, 0x61,
+	0x17, 0x2b, 0x04, 0x7e, 0xba, 0x77, 0xd6, 0x26,
+	0xe1, 0x69, 0x14, 0x63, 0x55, 0x21, 0x0c, 0x7d
 };
 
-/** Precomputed values of powers of 2 in GF(2^8) left shifted by 24b. */
-static const uint32_t r_con_array[] = {
-	0x01000000, 0x02000000, 0x04000000, 0x08000000,
-	0x10000000, 0x20000000, 0x40000000, 0x80000000,
-	0x1b000000, 0x36000000
+/** Combined sub_bytes and mix_columns of a byte in the first row.
+ *
+ * The column is stored with the first row in the least significant byte,
+ * the other rows are obtained by rotating the word.
+ * */
+static const uint32_t enc_table[256] = {
+	0xa56363c6, 0x847c7cf8, 0x997777ee, 0x8d7b7bf6,
+	0x0df2f2ff, 0xbd6b6bd6, 0xb16f6fde, 0x54c5c591,
+	0x50303060, 0x03010102, 0xa96767ce, 0x7d2b2b56,
+	0x19fefee7, 0x62d7d7b5, 0xe6abab4d, 0x9a7676ec,
+	0x45caca8f, 0x9d82821f, 0x40c9c989, 0x877d7dfa,
+	0x15fafaef, 0xeb5959b2, 0xc947478e, 0x0bf0f0fb,
+	0xecadad41, 0x67d4d4b3, 0xfda2a25f, 0xeaafaf45,
+	0xbf9c9c23, 0xf7a4a453, 0x967272e4, 0x5bc0c09b,
+	0xc2b7b775, 0x1cfdfde1, 0xae93933d, 0x6a26264c,
+	0x5a36366c, 0x413f3f7e, 0x02f7f7f5, 0x4fcccc83,
+	0x5c343468, 0xf4a5a551, 0x34e5e5d1, 0x08f1f1f9,
+	0x937171e2, 0x73d8d8ab, 0x53313162, 0x3f15152a,
+	0x0c040408, 0x52c7c795, 0x65232346, 0x5ec3c39d,
+	0x28181830, 0xa1969637, 0x0f05050a, 0xb59a9a2f,
+	0x0907070e, 0x36121224, 0x9b80801b, 0x3de2e2df,
+	0x26ebebcd, 0x6927274e, 0xcdb2b27f, 0x9f7575ea,
+	0x1b090912, 0x9e83831d, 0x742c2c58, 0x2e1a1a34,
+	0x2d1b1b36, 0xb26e6edc, 0xee5a5ab4, 0xfba0a05b,
+	0xf65252a4, 0x4d3b3b76, 0x61d6d6b7, 0xceb3b37d,
+	0x7b292952, 0x3ee3e3dd, 0x712f2f5e, 0x97848413,
+	0xf55353a6, 0x68d1d1b9, 0x00000000, 0x2cededc1,
+	0x60202040, 0x1ffcfce3, 0xc8b1b179, 0xed5b5bb6,
+	0xbe6a6ad4, 0x46cbcb8d, 0xd9bebe67, 0x4b393972,
+	0xde4a4a94, 0xd44c4c98, 0xe85858b0, 0x4acfcf85,
+	0x6bd0d0bb, 0x2aefefc5, 0xe5aaaa4f, 0x16fbfbed,
+	0xc5434386, 0xd74d4d9a, 0x55333366, 0x94858511,
+	0xcf45458a, 0x10f9f9e9, 0x06020204, 0x817f7ffe,
+	0xf05050a0, 0x443c3c78, 0xba9f9f25, 0xe3a8a84b,
+	0xf35151a2, 0xfea3a35d, 0xc0404080, 0x8a8f8f05,
+	0xad92923f, 0xbc9d9d21, 0x48383870, 0x04f5f5f1,
+	0xdfbcbc63, 0xc1b6b677, 0x75dadaaf, 0x63212142,
+	0x30101020, 0x1affffe5, 0x0ef3f3fd, 0x6dd2d2bf,
+	0x4ccdcd81, 0x140c0c18, 0x35131326, 0x2fececc3,
+	0xe15f5fbe, 0xa2979735, 0xcc444488, 0x3917172e,
+	0x57c4c493, 0xf2a7a755, 0x827e7efc, 0x473d3d7a,
+	0xac6464c8, 0xe75d5dba, 0x2b191932, 0x957373e6,
+	0xa06060c0, 0x98818119, 0xd14f4f9e, 0x7fdcdca3,
+	0x66222244, 0x7e2a2a54, 0xab90903b, 0x8388880b,
+	0xca46468c, 0x29eeeec7, 0xd3b8b86b, 0x3c141428,
+	0x79dedea7, 0xe25e5ebc, 0x1d0b0b16, 0x76dbdbad,
+	0x3be0e0db, 0x56323264, 0x4e3a3a74, 0x1e0a0a14,
+	0xdb494992, 0x0a06060c, 0x6c242448, 0xe45c5cb8,
+	0x5dc2c29f, 0x6ed3d3bd, 0xefacac43, 0xa66262c4,
+	0xa8919139, 0xa4959531, 0x37e4e4d3, 0x8b7979f2,
+	0x32e7e7d5, 0x43c8c88b, 0x5937376e, 0xb76d6dda,
+	0x8c8d8d01, 0x64d5d5b1, 0xd24e4e9c, 0xe0a9a949,
+	0xb46c6cd8, 0xfa5656ac, 0x07f4f4f3, 0x25eaeacf,
+	0xaf6565ca, 0x8e7a7af4, 0xe9aeae47, 0x18080810,
+	0xd5baba6f, 0x887878f0, 0x6f25254a, 0x722e2e5c,
+	0x241c1c38, 0xf1a6a657, 0xc7b4b473, 0x51c6c697,
+	0x23e8e8cb, 0x7cdddda1, 0x9c7474e8, 0x211f1f3e,
+	0xdd4b4b96, 0xdcbdbd61, 0x868b8b0d, 0x858a8a0f,
+	0x907070e0, 0x423e3e7c, 0xc4b5b571, 0xaa6666cc,
+	0xd8484890, 0x05030306, 0x01f6f6f7, 0x120e0e1c,
+	0xa36161c2, 0x5f35356a, 0xf95757ae, 0xd0b9b969,
+	0x91868617, 0x58c1c199, 0x271d1d3a, 0xb99e9e27,
+	0x38e1e1d9, 0x13f8f8eb, 0xb398982b, 0x33111122,
+	0xbb6969d2, 0x70d9d9a9, 0x898e8e07, 0xa7949433,
+	0xb69b9b2d, 0x221e1e3c, 0x92878715, 0x20e9e9c9,
+	0x49cece87, 0xff5555aa, 0x78282850, 0x7adfdfa5,
+	0x8f8c8c03, 0xf8a1a159, 0x80898909, 0x170d0d1a,
+	0xdabfbf65, 0x31e6e6d7, 0xc6424284, 0xb86868d0,
+	0xc3414182, 0xb0999929, 0x772d2d5a, 0x110f0f1e,
+	0xcbb0b07b, 0xfc5454a8, 0xd6bbbb6d, 0x3a16162c
 };
 
-/** Perform substitution transformation on given byte.
+/** Combined inv_sub_bytes and inv_mix_columns of a byte in the first row.
+ * */
+static const uint32_t dec_table[256] = {
+	0x50a7f451, 0x5365417e, 0xc3a4171a, 0x965e273a,
+	0xcb6bab3b, 0xf1459d1f, 0xab58faac, 0x9303e34b,
+	0x55fa3020, 0xf66d76ad, 0x9176cc88, 0x254c02f5,
+	0xfcd7e54f, 0xd7cb2ac5, 0x80443526, 0x8fa362b5,
+	0x495ab1de, 0x671bba25, 0x980eea45, 0xe1c0fe5d,
+	0x02752fc3, 0x12f04c81, 0xa397468d, 0xc6f9d36b,
+	0xe75f8f03, 0x959c9215, 0xeb7a6dbf, 0xda595295,
+	0x2d83bed4, 0xd3217458, 0x2969e049, 0x44c8c98e,
+	0x6a89c275, 0x78798ef4, 0x6b3e5899, 0xdd71b927,
+	0xb64fe1be, 0x17ad88f0, 0x66ac20c9, 0xb43ace7d,
+	0x184adf63, 0x82311ae5, 0x60335197, 0x457f5362,
+	0xe07764b1, 0x84ae6bbb, 0x1ca081fe, 0x942b08f9,
+	0x58684870, 0x19fd458f, 0x876cde94, 0xb7f87b52,
+	0x23d373ab, 0xe2024b72, 0x578f1fe3, 0x2aab5566,
+	0x0728ebb2, 0x03c2b52f, 0x9a7bc586, 0xa50837d3,
+	0xf2872830, 0xb2a5bf23, 0xba6a0302, 0x5c8216ed,
+	0x2b1ccf8a, 0x92b479a7, 0xf0f207f3, 0xa1e2694e,
+	0xcdf4da65, 0xd5be0506, 0x1f6234d1, 0x8afea6c4,
+	0x9d532e34, 0xa055f3a2, 0x32e18a05, 0x75ebf6a4,
+	0x39ec830b, 0xaaef6040, 0x069f715e, 0x51106ebd,
+	0xf98a213e, 0x3d06dd96, 0xae053edd, 0x46bde64d,
+	0xb58d5491, 0x055dc471, 0x6fd40604, 0xff155060,
+	0x24fb9819, 0x97e9bdd6, 0xcc434089, 0x779ed967,
+	0xbd42e8b0, 0x888b8907, 0x385b19e7, 0xdbeec879,
+	0x470a7ca1, 0xe90f427c, 0xc91e84f8, 0x00000000,
+	0x83868009, 0x48ed2b32, 0xac70111e, 0x4e725a6c,
+	0xfbff0efd, 0x5638850f, 0x1ed5ae3d, 0x27392d36,
+	0x64d90f0a, 0x21a65c68, 0xd1545b9b, 0x3a2e3624,
+	0xb1670a0c, 0x0fe75793, 0xd296eeb4, 0x9e919b1b,
+	0x4fc5c080, 0xa220dc61, 0x694b775a, 0x161a121c,
+	0x0aba93e2, 0xe52aa0c0, 0x43e0223c, 0x1d171b12,
+	0x0b0d090e, 0xadc78bf2, 0xb9a8b62d, 0xc8a91e14,
+	0x8519f157, 0x4c0775af, 0xbbdd99ee, 0xfd607fa3,
+	0x9f2601f7, 0xbcf5725c, 0xc53b6644, 0x347efb5b,
+	0x7629438b, 0xdcc623cb, 0x68fcedb6, 0x63f1e4b8,
+	0xcadc31d7, 0x10856342, 0x40229713, 0x2011c684,
+	0x7d244a85, 0xf83dbbd2, 0x1132f9ae, 0x6da129c7,
+	0x4b2f9e1d, 0xf330b2dc, 0xec52860d, 0xd0e3c177,
+	0x6c16b32b, 0x99b970a9, 0xfa489411, 0x2264e947,
+	0xc48cfca8, 0x1a3ff0a0, 0xd82c7d56, 0xef903322,
+	0xc74e4987, 0xc1d138d9, 0xfea2ca8c, 0x360bd498,
+	0xcf81f5a6, 0x28de7aa5, 0x268eb7da, 0xa4bfad3f,
+	0xe49d3a2c, 0x0d927850, 0x9bcc5f6a, 0x62467e54,
+	0xc2138df6, 0xe8b8d890, 0x5ef7392e, 0xf5afc382,
+	0xbe805d9f, 0x7c93d069, 0xa92dd56f, 0xb31225cf,
+	0x3b99acc8, 0xa77d1810, 0x6e639ce8, 0x7bbb3bdb,
+	0x097826cd, 0xf418596e, 0x01b79aec, 0xa89a4f83,
+	0x656e95e6, 0x7ee6ffaa, 0x08cfbc21, 0xe6e815ef,
+	0xd99be7ba, 0xce366f4a, 0xd4099fea, 0xd67cb029,
+	0xafb2a431, 0x31233f2a, 0x3094a5c6, 0xc066a235,
+	0x37bc4e74, 0xa6ca82fc, 0xb0d090e0, 0x15d8a733,
+	0x4a9804f1, 0xf7daec41, 0x0e50cd7f, 0x2ff69117,
+	0x8dd64d76, 0x4db0ef43, 0x544daacc, 0xdf0496e4,
+	0xe3b5d19e, 0x1b886a4c, 0xb81f2cc1, 0x7f516546,
+	0x04ea5e9d, 0x5d358c01, 0x737487fa, 0x2e410bfb,
+	0x5a1d67b3, 0x52d2db92, 0x335610e9, 0x1347d66d,
+	0x8c61d79a, 0x7a0ca137, 0x8e14f859, 0x893c13eb,
+	0xee27a9ce, 0x35c961b7, 0xede51ce1, 0x3cb1477a,
+	0x59dfd29c, 0x3f73f255, 0x79ce1418, 0xbf37c773,
+	0xeacdf753, 0x5baafd5f, 0x146f3ddf, 0x86db4478,
+	0x81f3afca, 0x3ec468b9, 0x2c342438, 0x5f40a3c2,
+	0x72c31d16, 0x0c25e2bc, 0x8b493c28, 0x41950dff,
+	0x7101a839, 0xdeb30c08, 0x9ce4b4d8, 0x90c15664,
+	0x6184cb7b, 0x70b632d5, 0x745c6c48, 0x4257b8d0
+};
+
+/** Round constants (powers of 2 in GF(2^8)). */
+static const uint8_t r_con_array[] = {
+	0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1b, 0x36
+};
+
+/** Load a column stored with the first row at the lowest address.
  *
- * @param byte Input byte.
- * @param inv  Flag indicating whether to use inverse table.
+ * @param data Source bytes.
  *
- * @return Substituted value.
+ * @return Column word (first row in the least significant byte).
  *
  */
-static uint8_t sub_byte(uint8_t byte, bool inv)
+static inline uint32_t load_column(const uint8_t *data)
 {
-	uint8_t i = byte >> 4;
-	uint8_t j = byte & 0xF;
+	return ((uint32_t) data[0]) | ((uint32_t) data[1] << 8) |
+	    ((uint32_t) data[2] << 16) | ((uint32_t) data[3] << 24);
+}
 
-	if (!inv)
-		return sbox[i][j];
+/** Store a column word.
+ *
+ * @param data Destination bytes.
+ * @param col  Column word.
+ *
+ */
+static inline void store_column(uint8_t *data, uint32_t col)
+{
+	data[0] = col;
+	data[1] = col >> 8;
+	data[2] = col >> 16;
+	data[3] = col >> 24;
+}
 
-	return inv_sbox[i][j];
+/** Perform substitution transformation on given word.
+ *
+ * @param word Input word.
+ *
+ * @return Substituted word.
+ *
+ */
+static uint32_t sub_word(uint32_t word)
+{
+	return ((uint32_t) sbox[word & 0xff]) |
+	    ((uint32_t) sbox[(word >> 8) & 0xff] << 8) |
+	    ((uint32_t) sbox[(word >> 16) & 0xff] << 16) |
+	    ((uint32_t) sbox[word >> 24] << 24);
 }
 
-/** Perform substitution transformation on state table.
+/** Perform rotation by one byte on given word.
  *
- * @param state State table to be modified.
- * @param inv   Flag indicating whether to use inverse table.
+ * The second row moves to the first one.
+ *
+ * @param word Input word.
+ *
+ * @return Rotated word.
  *
  */
-static void sub_bytes(uint8_t state[ELEMS][ELEMS], bool inv)
+static uint32_t rot_word(uint32_t word)
 {
-	uint8_t val;
+	return rotr_uint32(word, 8);
+}
 
-	for (size_t i = 0; i < ELEMS; i++) {
-		for (size_t j = 0; j < ELEMS; j++) {
-			val = state[i][j];
-			state[i][j] = sub_byte(val, inv);
-		}
-	}
+/** Perform inverted mix columns transformation on a round key word.
+ *
+ * @param word Input word.
+ *
+ * @return Transformed word.
+ *
+ */
+static uint32_t inv_mix_column(uint32_t word)
+{
+	return dec_table[sbox[word & 0xff]] ^
+	    rotl_uint32(dec_table[sbox[(word >> 8) & 0xff]], 8) ^
+	    rotl_uint32(dec_table[sbox[(word >> 16) & 0xff]], 16) ^
+	    rotl_uint32(dec_table[sbox[word >> 24]], 24);
 }
 
-/** Perform shift rows transformation on state table.
+#ifdef __x86_64__
+
+typedef long long aes_vec_t __attribute__((vector_size(16)));
+
+/** Check whether the CPU implements the AES instructions.
  *
- * @param state State table to be modified.
+ * @return True if AES-NI is available.
  *
  */
-static void shift_rows(uint8_t state[ELEMS][ELEMS])
+static bool aesni_available(void)
 {
-	uint8_t temp[ELEMS];
+	uint32_t eax = 1;
+	uint32_t ebx;
+	uint32_t ecx;
+	uint32_t edx;
 
-	for (size_t i = 1; i < ELEMS; i++) {
-		memcpy(temp, state[i], i);
-		memcpy(state[i], state[i] + i, ELEMS - i);
-		memcpy(state[i] + ELEMS - i, temp, i);
-	}
+	asm volatile (
+	    "cpuid\n"
+	    : "+a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx)
+	);
+
+	/* CPUID.01H:ECX.AESNI[bit 25] */
+	return (ecx & (1 << 25)) != 0;
 }
 
-/** Perform inverted shift rows transformation on state table.
+/** Load round keys for the AES instructions.
  *
- * @param state State table to be modified.
+ * @param words Round key words.
+ * @param rk    Loaded round keys.
+ * @param cnt   Number of round keys.
  *
  */
-static void inv_shift_rows(uint8_t state[ELEMS][ELEMS])
+static inline void aesni_load_keys(const uint32_t *words, aes_vec_t *rk,
+    size_t cnt)
 {
-	uint8_t temp[ELEMS];
-
-	for (size_t i = 1; i < ELEMS; i++) {
-		memcpy(temp, state[i], ELEMS - i);
-		memcpy(state[i], state[i] + ELEMS - i, i);
-		memcpy(state[i] + i, temp, ELEMS - i);
-	}
+	memcpy(rk, words, cnt * BLOCK_LEN);
 }
 
-/** Multiplication in GF(2^8).
+/** Encrypt blocks using the AES instructions.
  *
- * @param x First factor.
- * @param y Second factor.
+ * Four blocks are kept in flight to hide the instruction latency.
  *
- * @return Multiplication of given factors in GF(2^8).
+ * @param key    Expanded key.
+ * @param input  Input blocks.
+ * @param output Output blocks.
+ * @param cnt    Number of blocks.
  *
  */
-static uint8_t galois_mult(uint8_t x, uint8_t y)
+static void aesni_encrypt(const aes_key_t *key, const uint8_t *input,
+    uint8_t *output, size_t cnt)
 {
-	uint8_t result = 0;
-	uint8_t f_bith;
+	aes_vec_t rk[AES_MAX_ROUNDS + 1];
+	size_t rounds = key->rounds;
+
+	aesni_load_keys(key->enc, rk, rounds + 1);
 
-	for (size_t i = 0; i < 8; i++) {
-		if (y & 1)
-			result ^= x;
+	for (; cnt >= 4; cnt -= 4) {
+		aes_vec_t s[4];
+		memcpy(s, input, sizeof(s));
 
-		f_bith = (x & 0x80);
-		x <<= 1;
+		for (size_t i = 0; i < 4; i++)
+			s[i] ^= rk[0];
 
-		if (f_bith)
-			x ^= AES_IP;
+		for (size_t r = 1; r < rounds; r++) {
+			asm ("aesenc %4, %0\n"
+			    "aesenc %4, %1\n"
+			    "aesenc %4, %2\n"
+			    "aesenc %4, %3\n"
+			    : "+x" (s[0]), "+x" (s[1]), "+x" (s[2]), "+x" (s[3])
+			    : "x" (rk[r]));
+		}
+
+		asm ("aesenclast %4, %0\n"
+		    "aesenclast %4, %1\n"
+		    "aesenclast %4, %2\n"
+		    "aesenclast %4, %3\n"
+		    : "+x" (s[0]), "+x" (s[1]), "+x" (s[2]), "+x" (s[3])
+		    : "x" (rk[rounds]));
 
-		y >>= 1;
+		memcpy(output, s, sizeof(s));
+		input += sizeof(s);
+		output += sizeof(s);
 	}
 
-	return result;
+	for (; cnt > 0; cnt--) {
+		aes_vec_t s;
+		memcpy(&s, input, BLOCK_LEN);
+
+		s ^= rk[0];
+		for (size_t r = 1; r < rounds; r++)
+			asm ("aesenc %1, %0\n" : "+x" (s) : "x" (rk[r]));
+
+		asm ("aesenclast %1, %0\n" : "+x" (s) : "x" (rk[rounds]));
+
+		memcpy(output, &s, BLOCK_LEN);
+		input += BLOCK_LEN;
+		output += BLOCK_LEN;
+	}
 }
 
-/** Perform mix columns transformation on state table.
+/** Decrypt blocks using the AES instructions.
  *
- * @param state State table to be modified.
+ * @param key    Expanded key.
+ * @param input  Input blocks.
+ * @param output Output blocks.
+ * @param cnt    Number of blocks.
  *
  */
-static void mix_columns(uint8_t state[ELEMS][ELEMS])
+static void aesni_decrypt(const aes_key_t *key, const uint8_t *input,
+    uint8_t *output, size_t cnt)
 {
-	uint8_t orig_state[ELEMS][ELEMS];
-	memcpy(orig_state, state, BLOCK_LEN);
+	aes_vec_t rk[AES_MAX_ROUNDS + 1];
+	size_t rounds = key->rounds;
+
+	aesni_load_keys(key->dec, rk, rounds + 1);
+
+	for (; cnt >= 4; cnt -= 4) {
+		aes_vec_t s[4];
+		memcpy(s, input, sizeof(s));
+
+		for (size_t i = 0; i < 4; i++)
+			s[i] ^= rk[0];
 
-	for (size_t j = 0; j < ELEMS; j++) {
-		state[0][j] =
-		    galois_mult(0x2, orig_state[0][j]) ^
-		    galois_mult(0x3, orig_state[1][j]) ^
-		    orig_state[2][j] ^
-		    orig_state[3][j];
-		state[1][j] =
-		    orig_state[0][j] ^
-		    galois_mult(0x2, orig_state[1][j]) ^
-		    galois_mult(0x3, orig_state[2][j]) ^
-		    orig_state[3][j];
-		state[2][j] =
-		    orig_state[0][j] ^
-		    orig_state[1][j] ^
-		    galois_mult(0x2, orig_state[2][j]) ^
-		    galois_mult(0x3, orig_state[3][j]);
-		state[3][j] =
-		    galois_mult(0x3, orig_state[0][j]) ^
-		    orig_state[1][j] ^
-		    orig_state[2][j] ^
-		    galois_mult(0x2, orig_state[3][j]);
+		for (size_t r = 1; r < rounds; r++) {
+			asm ("aesdec %4, %0\n"
+			    "aesdec %4, %1\n"
+			    "aesdec %4, %2\n"
+			    "aesdec %4, %3\n"
+			    : "+x" (s[0]), "+x" (s[1]), "+x" (s[2]), "+x" (s[3])
+			    : "x" (rk[r]));
+		}
+
+		asm ("aesdeclast %4, %0\n"
+		    "aesdeclast %4, %1\n"
+		    "aesdeclast %4, %2\n"
+		    "aesdeclast %4, %3\n"
+		    : "+x" (s[0]), "+x" (s[1]), "+x" (s[2]), "+x" (s[3])
+		    : "x" (rk[rounds]));
+
+		memcpy(output, s, sizeof(s));
+		input += sizeof(s);
+		output += sizeof(s);
 	}
-}
 
-/** Perform inverted mix columns transformation on state table.
- *
- * @param state State table to be modified.
- *
- */
-static void inv_mix_columns(uint8_t state[ELEMS][ELEMS])
-{
-	uint8_t orig_state[ELEMS][ELEMS];
-	memcpy(orig_state, state, BLOCK_LEN);
-
-	for (size_t j = 0; j < ELEMS; j++) {
-		state[0][j] =
-		    galois_mult(0x0e, orig_state[0][j]) ^
-		    galois_mult(0x0b, orig_state[1][j]) ^
-		    galois_mult(0x0d, orig_state[2][j]) ^
-		    galois_mult(0x09, orig_state[3][j]);
-		state[1][j] =
-		    galois_mult(0x09, orig_state[0][j]) ^
-		    galois_mult(0x0e, orig_state[1][j]) ^
-		    galois_mult(0x0b, orig_state[2][j]) ^
-		    galois_mult(0x0d, orig_state[3][j]);
-		state[2][j] =
-		    galois_mult(0x0d, orig_state[0][j]) ^
-		    galois_mult(0x09, orig_state[1][j]) ^
-		    galois_mult(0x0e, orig_state[2][j]) ^
-		    galois_mult(0x0b, orig_state[3][j]);
-		state[3][j] =
-		    galois_mult(0x0b, orig_state[0][j]) ^
-		    galois_mult(0x0d, orig_state[1][j]) ^
-		    galois_mult(0x09, orig_state[2][j]) ^
-		    galois_mult(0x0e, orig_state[3][j]);
+	for (; cnt > 0; cnt--) {
+		aes_vec_t s;
+		memcpy(&s, input, BLOCK_LEN);
+
+		s ^= rk[0];
+		for (size_t r = 1; r < rounds; r++)
+			asm ("aesdec %1, %0\n" : "+x" (s) : "x" (rk[r]));
+
+		asm ("aesdeclast %1, %0\n" : "+x" (s) : "x" (rk[rounds]));
+
+		memcpy(output, &s, BLOCK_LEN);
+		input += BLOCK_LEN;
+		output += BLOCK_LEN;
 	}
 }
 
-/** Perform round key transformation on state table.
+#else
+
+static bool aesni_available(void)
+{
+	return false;
+}
+
+static void aesni_encrypt(const aes_key_t *key, const uint8_t *input,
+    uint8_t *output, size_t cnt)
+{
+}
+
+static void aesni_decrypt(const aes_key_t *key, const uint8_t *input,
+    uint8_t *output, size_t cnt)
+{
+}
+
+#endif
+
+/** Encrypt one block using the tables.
  *
- * @param state     State table to be modified.
- * @param round_key Round key to be applied on state table.
+ * @param key    Expanded key.
+ * @param input  Input block.
+ * @param output Output block.
  *
  */
-static void add_round_key(uint8_t state[ELEMS][ELEMS], uint32_t *round_key)
+static void table_encrypt(const aes_key_t *key, const uint8_t *input,
+    uint8_t *output)
 {
-	uint8_t byte_round;
-	uint8_t shift;
-	uint32_t mask = 0xff;
+	const uint32_t *rk = key->enc;
 
-	for (size_t j = 0; j < ELEMS; j++) {
-		for (size_t i = 0; i < ELEMS; i++) {
-			shift = 24 - 8 * i;
-			byte_round = (round_key[j] & (mask << shift)) >> shift;
-			state[i][j] = state[i][j] ^ byte_round;
-		}
+	uint32_t s0 = load_column(input) ^ rk[0];
+	uint32_t s1 = load_column(input + 4) ^ rk[1];
+	uint32_t s2 = load_column(input + 8) ^ rk[2];
+	uint32_t s3 = load_column(input + 12) ^ rk[3];
+
+	for (size_t r = 1; r < key->rounds; r++) {
+		rk += ELEMS;
+
+		uint32_t t0 = enc_table[s0 & 0xff] ^
+		    rotl_uint32(enc_table[(s1 >> 8) & 0xff], 8) ^
+		    rotl_uint32(enc_table[(s2 >> 16) & 0xff], 16) ^
+		    rotl_uint32(enc_table[s3 >> 24], 24) ^ rk[0];
+		uint32_t t1 = enc_table[s1 & 0xff] ^
+		    rotl_uint32(enc_table[(s2 >> 8) & 0xff], 8) ^
+		    rotl_uint32(enc_table[(s3 >> 16) & 0xff], 16) ^
+		    rotl_uint32(enc_table[s0 >> 24], 24) ^ rk[1];
+		uint32_t t2 = enc_table[s2 & 0xff] ^
+		    rotl_uint32(enc_table[(s3 >> 8) & 0xff], 8) ^
+		    rotl_uint32(enc_table[(s0 >> 16) & 0xff], 16) ^
+		    rotl_uint32(enc_table[s1 >> 24], 24) ^ rk[2];
+		uint32_t t3 = enc_table[s3 & 0xff] ^
+		    rotl_uint32(enc_table[(s0 >> 8) & 0xff], 8) ^
+		    rotl_uint32(enc_table[(s1 >> 16) & 0xff], 16) ^
+		    rotl_uint32(enc_table[s2 >> 24], 24) ^ rk[3];
+
+		s0 = t0;
+		s1 = t1;
+		s2 = t2;
+		s3 = t3;
 	}
+
+	/* Last round has no mix columns transformation. */
+	rk += ELEMS;
+
+	store_column(output, (sbox[s0 & 0xff] |
+	    (sbox[(s1 >> 8) & 0xff] << 8) |
+	    (sbox[(s2 >> 16) & 0xff] << 16) |
+	    ((uint32_t) sbox[s3 >> 24] << 24)) ^ rk[0]);
+	store_column(output + 4, (sbox[s1 & 0xff] |
+	    (sbox[(s2 >> 8) & 0xff] << 8) |
+	    (sbox[(s3 >> 16) & 0xff] << 16) |
+	    ((uint32_t) sbox[s0 >> 24] << 24)) ^ rk[1]);
+	store_column(output + 8, (sbox[s2 & 0xff] |
+	    (sbox[(s3 >> 8) & 0xff] << 8) |
+	    (sbox[(s0 >> 16) & 0xff] << 16) |
+	    ((uint32_t) sbox[s1 >> 24] << 24)) ^ rk[2]);
+	store_column(output + 12, (sbox[s3 & 0xff] |
+	    (sbox[(s0 >> 8) & 0xff] << 8) |
+	    (sbox[(s1 >> 16) & 0xff] << 16) |
+	    ((uint32_t) sbox[s2 >> 24] << 24)) ^ rk[3]);
 }
 
-/** Perform substitution transformation on given word.
+/** Decrypt one block using the tables.
  *
- * @param byte Input word.
+ * The decryption round keys are prepared for the equivalent inverse
+ * cipher, so the structure mirrors encryption.
  *
- * @return Substituted word.
+ * @param key    Expanded key.
+ * @param input  Input block.
+ * @param output Output block.
  *
  */
-static uint32_t sub_word(uint32_t word)
+static void table_decrypt(const aes_key_t *key, const uint8_t *input,
+    uint8_t *output)
 {
-	uint32_t temp = word;
-	uint8_t *start = (uint8_t *) &temp;
+	const uint32_t *rk = key->dec;
+
+	uint32_t s0 = load_column(input) ^ rk[0];
+	uint32_t s1 = load_column(input + 4) ^ rk[1];
+	uint32_t s2 = load_column(input + 8) ^ rk[2];
+	uint32_t s3 = load_column(input + 12) ^ rk[3];
+
+	for (size_t r = 1; r < key->rounds; r++) {
+		rk += ELEMS;
+
+		uint32_t t0 = dec_table[s0 & 0xff] ^
+		    rotl_uint32(dec_table[(s3 >> 8) & 0xff], 8) ^
+		    rotl_uint32(dec_table[(s2 >> 16) & 0xff], 16) ^
+		    rotl_uint32(dec_table[s1 >> 24], 24) ^ rk[0];
+		uint32_t t1 = dec_table[s1 & 0xff] ^
+		    rotl_uint32(dec_table[(s0 >> 8) & 0xff], 8) ^
+		    rotl_uint32(dec_table[(s3 >> 16) & 0xff], 16) ^
+		    rotl_uint32(dec_table[s2 >> 24], 24) ^ rk[1];
+		uint32_t t2 = dec_table[s2 & 0xff] ^
+		    rotl_uint32(dec_table[(s1 >> 8) & 0xff], 8) ^
+		    rotl_uint32(dec_table[(s0 >> 16) & 0xff], 16) ^
+		    rotl_uint32(dec_table[s3 >> 24], 24) ^ rk[2];
+		uint32_t t3 = dec_table[s3 & 0xff] ^
+		    rotl_uint32(dec_table[(s2 >> 8) & 0xff], 8) ^
+		    rotl_uint32(dec_table[(s1 >> 16) & 0xff], 16) ^
+		    rotl_uint32(dec_table[s0 >> 24], 24) ^ rk[3];
+
+		s0 = t0;
+		s1 = t1;
+		s2 = t2;
+		s3 = t3;
+	}
 
-	for (size_t i = 0; i < 4; i++)
-		*(start + i) = sub_byte(*(start + i), false);
+	/* Last round has no inverted mix columns transformation. */
+	rk += ELEMS;
 
-	return temp;
+	store_column(output, (inv_sbox[s0 & 0xff] |
+	    (inv_sbox[(s3 >> 8) & 0xff] << 8) |
+	    (inv_sbox[(s2 >> 16) & 0xff] << 16) |
+	    ((uint32_t) inv_sbox[s1 >> 24] << 24)) ^ rk[0]);
+	store_column(output + 4, (inv_sbox[s1 & 0xff] |
+	    (inv_sbox[(s0 >> 8) & 0xff] << 8) |
+	    (inv_sbox[(s3 >> 16) & 0xff] << 16) |
+	    ((uint32_t) inv_sbox[s2 >> 24] << 24)) ^ rk[1]);
+	store_column(output + 8, (inv_sbox[s2 & 0xff] |
+	    (inv_sbox[(s1 >> 8) & 0xff] << 8) |
+	    (inv_sbox[(s0 >> 16) & 0xff] << 16) |
+	    ((uint32_t) inv_sbox[s3 >> 24] << 24)) ^ rk[2]);
+	store_column(output + 12, (inv_sbox[s3 & 0xff] |
+	    (inv_sbox[(s2 >> 8) & 0xff] << 8) |
+	    (inv_sbox[(s1 >> 16) & 0xff] << 16) |
+	    ((uint32_t) inv_sbox[s0 >> 24] << 24)) ^ rk[3]);
 }
 
-/** Perform left rotation by one byte on given word.
+/** Key expansion procedure for AES algorithm.
  *
- * @param byte Input word.
+ * @param key     Expanded key to initialize.
+ * @param data    Input key.
+ * @param size    Length of the input key (16, 24 or 32 bytes).
  *
- * @return Rotated word.
+ * @return EINVAL on unsupported key length, otherwise EOK.
  *
  */
-static uint32_t rot_word(uint32_t word)
+errno_t aes_key_init(aes_key_t *key, const uint8_t *data, size_t size)
 {
-	return (word << 8 | word >> 24);
+	if (!key || !data)
+		return EINVAL;
+
+	size_t nk = size / 4;
+	if ((size != 16) && (size != 24) && (size != 32))
+		return EINVAL;
+
+	key->rounds = nk + 6;
+
+	size_t words = ELEMS * (key->rounds + 1);
+	uint32_t *ek = key->enc;
+
+	for (size_t i = 0; i < nk; i++)
+		ek[i] = load_column(data + 4 * i);
+
+	for (size_t i = nk; i < words; i++) {
+		uint32_t temp = ek[i - 1];
+
+		if ((i % nk) == 0)
+			temp = sub_word(rot_word(temp)) ^ r_con_array[i / nk - 1];
+		else if ((nk > 6) && ((i % nk) == 4))
+			temp = sub_word(temp);
+
+		ek[i] = ek[i - nk] ^ temp;
+	}
+
+	/* Round keys of the equivalent inverse cipher, in reverse order. */
+	uint32_t *dk = key->dec;
+
+	for (size_t r = 0; r <= key->rounds; r++) {
+		const uint32_t *src = ek + ELEMS * (key->rounds - r);
+
+		for (size_t i = 0; i < ELEMS; i++) {
+			if ((r == 0) || (r == key->rounds))
+				dk[ELEMS * r + i] = src[i];
+			else
+				dk[ELEMS * r + i] = inv_mix_column(src[i]);
+		}
+	}
+
+	key->aesni = aesni_available();
+	return EOK;
 }
 
-/** Key expansion procedure for AES algorithm.
+/** Encrypt blocks (ECB).
  *
- * @param key     Input key.
- * @param key_exp Result key expansion.
+ * @param key    Expanded key.
+ * @param input  Input blocks.
+ * @param output Output blocks (may be the same as input).
+ * @param cnt    Number of blocks.
  *
  */
-static void key_expansion(uint8_t *key, uint32_t *key_exp)
+void aes_encrypt_blocks(const aes_key_t *key, const uint8_t *input,
+    uint8_t *output, size_t cnt)
 {
-	uint32_t temp;
-
-	for (size_t i = 0; i < CIPHER_ELEMS; i++) {
-		key_exp[i] =
-		    (key[4 * i] << 24) +
-		    (key[4 * i + 1] << 16) +
-		    (key[4 * i + 2] << 8) +
-		    (key[4 * i + 3]);
+	if (key->aesni) {
+		aesni_encrypt(key, input, output, cnt);
+		return;
 	}
 
-	for (size_t i = CIPHER_ELEMS; i < ELEMS * (ROUNDS + 1); i++) {
-		temp = key_exp[i - 1];
-
-		if ((i % CIPHER_ELEMS) == 0) {
-			temp = sub_word(rot_word(temp)) ^
-			    r_con_array[i / CIPHER_ELEMS - 1];
-		}
+	for (size_t i = 0; i < cnt; i++)
+		table_encrypt(key, input + i * BLOCK_LEN, output + i * BLOCK_LEN);
+}
 
-		key_exp[i] = key_exp[i - CIPHER_ELEMS] ^ temp;
+/** Decrypt blocks (ECB).
+ *
+ * @param key    Expanded key.
+ * @param input  Input blocks.
+ * @param output Output blocks (may be the same as input).
+ * @param cnt    Number of blocks.
+ *
+ */
+void aes_decrypt_blocks(const aes_key_t *key, const uint8_t *input,
+    uint8_t *output, size_t cnt)
+{
+	if (key->aesni) {
+		aesni_decrypt(key, input, output, cnt);
+		return;
 	}
+
+	for (size_t i = 0; i < cnt; i++)
+		table_decrypt(key, input + i * BLOCK_LEN, output + i * BLOCK_LEN);
 }
 
 /** AES-128 encryption algorithm.
+ *
+ * The key is expanded on every call, use aes_key_init() and
+ * aes_encrypt_blocks() to encrypt more blocks with the same key.
  *
  * @param key    Input key.
  * @param input  Input data sequence to be encrypted.
@@ -466,40 +771,19 @@ errno_t aes_encrypt(uint8_t *key, uint8_t *input, uint8_t *output)
 	if (!output)
 		return ENOMEM;
 
-	/* Create key expansion. */
-	uint32_t key_exp[ELEMS * (ROUNDS + 1)];
-	key_expansion(key, key_exp);
-
-	/* Copy input into state array. */
-	uint8_t state[ELEMS][ELEMS];
-	for (size_t i = 0; i < ELEMS; i++) {
-		for (size_t j = 0; j < ELEMS; j++)
-			state[i][j] = input[i + ELEMS * j];
-	}
-
-	/* Processing loop. */
-	add_round_key(state, key_exp);
-
-	for (size_t k = 1; k <= ROUNDS; k++) {
-		sub_bytes(state, false);
-		shift_rows(state);
-
-		if (k < ROUNDS)
-			mix_columns(state);
-
-		add_round_key(state, key_exp + k * ELEMS);
-	}
-
-	/* Copy state array into output. */
-	for (size_t i = 0; i < ELEMS; i++) {
-		for (size_t j = 0; j < ELEMS; j++)
-			output[i + j * ELEMS] = state[i][j];
-	}
+	aes_key_t exp_key;
+	errno_t rc = aes_key_init(&exp_key, key, AES_CIPHER_LENGTH);
+	if (rc != EOK)
+		return rc;
 
+	aes_encrypt_blocks(&exp_key, input, output, 1);
 	return EOK;
 }
 
 /** AES-128 decryption algorithm.
+ *
+ * The key is expanded on every call, use aes_key_init() and
+ * aes_decrypt_blocks() to decrypt more blocks with the same key.
  *
  * @param key    Input key.
  * @param input  Input data sequence to be decrypted.
@@ -518,34 +802,652 @@ errno_t aes_decrypt(uint8_t *key, uint8_t *input, uint8_t *output)
 	if (!output)
 		return ENOMEM;
 
-	/* Create key expansion. */
-	uint32_t key_exp[ELEMS * (ROUNDS + 1)];
-	key_expansion(key, key_exp);
+	aes_key_t exp_key;
+	errno_t rc = aes_key_init(&exp_key, key, AES_CIPHER_LENGTH);
+	if (rc != EOK)
+		return rc;
+
+	aes_decrypt_blocks(&exp_key, input, output, 1);
+	return EOK;
+}
+
+/** XOR a block into another one.
+ *
+ * @param dest Block to be modified.
+ * @param src  Block to be added.
+ * @param size Number of bytes.
+ *
+ */
+static inline void xor_block(uint8_t *dest, const uint8_t *src, size_t size)
+{
+	for (size_t i = 0; i < size; i++)
+		dest[i] ^= src[i];
+}
+
+/** CBC mode encryption.
+ *
+ * @param key    Expanded key.
+ * @param iv     Initialization vector, updated for a following call.
+ * @param input  Input data.
+ * @param output Output data (may be the same as input).
+ * @param size   Length of the data (multiple of the block length).
+ *
+ * @return EINVAL on invalid length, otherwise EOK.
+ *
+ */
+errno_t aes_cbc_encrypt(const aes_key_t *key, uint8_t *iv,
+    const uint8_t *input, uint8_t *output, size_t size)
+{
+	if ((size % BLOCK_LEN) != 0)
+		return EINVAL;
+
+	/* Each block depends on the previous one. */
+	for (size_t i = 0; i < size; i += BLOCK_LEN) {
+		xor_block(iv, input + i, BLOCK_LEN);
+		aes_encrypt_blocks(key, iv, iv, 1);
+		memcpy(output + i, iv, BLOCK_LEN);
+	}
+
+	return EOK;
+}
+
+/** CBC mode decryption.
+ *
+ * Blocks are decrypted in bulk before the chaining is undone.
+ *
+ * @param key    Expanded key.
+ * @param iv     Initialization vector, updated for a following call.
+ * @param input  Input data.
+ * @param output Output data (may be the same as input).
+ * @param size   Length of the data (multiple of the block length).
+ *
+ * @return EINVAL on invalid length, otherwise EOK.
+ *
+ */
+errno_t aes_cbc_decrypt(const aes_key_t *key, uint8_t *iv,
+    const uint8_t *input, uint8_t *output, size_t size)
+{
+	if ((size % BLOCK_LEN) != 0)
+		return EINVAL;
+
+	uint8_t work[BULK_BLOCKS * BLOCK_LEN];
+	uint8_t prev[BLOCK_LEN];
+
+	while (size > 0) {
+		size_t chunk = min(size, sizeof(work));
+
+		aes_decrypt_blocks(key, input, work, chunk / BLOCK_LEN);
+
+		for (size_t i = 0; i < chunk; i += BLOCK_LEN) {
+			/* Keep the ciphertext in case of in-place operation. */
+			memcpy(prev, input + i, BLOCK_LEN);
+			xor_block(work + i, iv, BLOCK_LEN);
+			memcpy(iv, prev, BLOCK_LEN);
+		}
+
+		memcpy(output, work, chunk);
+		input += chunk;
+		output += chunk;
+		size -= chunk;
+	}
+
+	return EOK;
+}
+
+/** Increment a big-endian counter.
+ *
+ * @param counter Counter bytes.
+ * @param size    Number of the lowest bytes taking part.
+ *
+ */
+static inline void counter_inc(uint8_t *counter, size_t size)
+{
+	for (size_t i = BLOCK_LEN; i > BLOCK_LEN - size; i--) {
+		if (++counter[i - 1] != 0)
+			break;
+	}
+}
+
+/** Encrypt or decrypt data in counter mode.
+ *
+ * @param key     Expanded key.
+ * @param counter Counter block, advanced by the number of blocks used.
+ * @param ctr_len Number of the lowest counter bytes being incremented.
+ * @param input   Input data.
+ * @param output  Output data (may be the same as input).
+ * @param size    Length of the data.
+ *
+ */
+static void ctr_crypt(const aes_key_t *key, uint8_t *counter, size_t ctr_len,
+    const uint8_t *input, uint8_t *output, size_t size)
+{
+	uint8_t stream[BULK_BLOCKS * BLOCK_LEN];
+
+	while (size > 0) {
+		size_t chunk = min(size, sizeof(stream));
+		size_t blocks = (chunk + BLOCK_LEN - 1) / BLOCK_LEN;
+
+		for (size_t i = 0; i < blocks; i++) {
+			memcpy(stream + i * BLOCK_LEN, counter, BLOCK_LEN);
+			counter_inc(counter, ctr_len);
+		}
+
+		aes_encrypt_blocks(key, stream, stream, blocks);
+
+		for (size_t i = 0; i < chunk; i++)
+			output[i] = input[i] ^ stream[i];
+
+		input += chunk;
+		output += chunk;
+		size -= chunk;
+	}
+}
+
+/** CTR mode encryption and decryption.
+ *
+ * A partial last block consumes a whole counter value, so only the last
+ * call for a message may have a length which is not a multiple of the
+ * block length.
+ *
+ * @param key     Expanded key.
+ * @param counter Initial counter block, advanced for a following call.
+ * @param input   Input data.
+ * @param output  Output data (may be the same as input).
+ * @param size    Length of the data.
+ *
+ */
+void aes_ctr(const aes_key_t *key, uint8_t *counter, const uint8_t *input,
+    uint8_t *output, size_t size)
+{
+	ctr_crypt(key, counter, BLOCK_LEN, input, output, size);
+}
+
+/** Compute CCM authentication tag.
+ *
+ * @param key       Expanded key.
+ * @param nonce     Nonce.
+ * @param nonce_len Length of the nonce (7 to 13 bytes).
+ * @param aad       Additional authenticated data.
+ * @param aad_len   Length of the additional data.
+ * @param data      Plaintext.
+ * @param size      Length of the plaintext.
+ * @param tag_len   Length of the tag.
+ * @param mac       Resulting unencrypted tag (one block).
+ *
+ */
+static void ccm_mac(const aes_key_t *key, const uint8_t *nonce,
+    size_t nonce_len, const uint8_t *aad, size_t aad_len,
+    const uint8_t *data, size_t size, size_t tag_len, uint8_t *mac)
+{
+	size_t q = BLOCK_LEN - 1 - nonce_len;
+
+	/* First block: flags, nonce and message length. */
+	mac[0] = ((aad_len > 0) ? 0x40 : 0) | (((tag_len - 2) / 2) << 3) |
+	    (q - 1);
+	memcpy(mac + 1, nonce, nonce_len);
+
+	size_t len = size;
+	for (size_t i = BLOCK_LEN; i > BLOCK_LEN - q; i--) {
+		mac[i - 1] = len & 0xff;
+		len >>= 8;
+	}
+
+	aes_encrypt_blocks(key, mac, mac, 1);
+
+	if (aad_len > 0) {
+		uint8_t block[BLOCK_LEN];
+		size_t pos;
+
+		/* Length of the additional data is encoded first. */
+		memset(block, 0, BLOCK_LEN);
+		if (aad_len < 0xff00) {
+			block[0] = aad_len >> 8;
+			block[1] = aad_len;
+			pos = 2;
+		} else {
+			block[0] = 0xff;
+			block[1] = 0xfe;
+			block[2] = aad_len >> 24;
+			block[3] = aad_len >> 16;
+			block[4] = aad_len >> 8;
+			block[5] = aad_len;
+			pos = 6;
+		}
+
+		while (aad_len > 0) {
+			size_t chunk = min(aad_len, BLOCK_LEN - pos);
+			memcpy(block + pos, aad, chunk);
+			aad += chunk;
+			aad_len -= chunk;
+
+			xor_block(mac, block, BLOCK_LEN);
+			aes_encrypt_blocks(key, mac, mac, 1);
+
+			memset(block, 0, BLOCK_LEN);
+			pos = 0;
+		}
+	}
+
+	while (size > 0) {
+		size_t chunk = min(size, (size_t) BLOCK_LEN);
+
+		xor_block(mac, data, chunk);
+		aes_encrypt_blocks(key, mac, mac, 1);
+
+		data += chunk;
+		size -= chunk;
+	}
+}
+
+/** Prepare the first CCM counter block.
+ *
+ * @param counter   Counter block to initialize (counter value zero).
+ * @param nonce     Nonce.
+ * @param nonce_len Length of the nonce.
+ *
+ */
+static void ccm_counter(uint8_t *counter, const uint8_t *nonce,
+    size_t nonce_len)
+{
+	size_t q = BLOCK_LEN - 1 - nonce_len;
+
+	memset(counter, 0, BLOCK_LEN);
+	counter[0] = q - 1;
+	memcpy(counter + 1, nonce, nonce_len);
+}
+
+/** Check CCM parameters.
+ *
+ * @return True if the parameters are valid.
+ *
+ */
+static bool ccm_valid(size_t nonce_len, size_t size, size_t tag_len)
+{
+	if ((nonce_len < 7) || (nonce_len > 13))
+		return false;
+
+	if ((tag_len < 4) || (tag_len > 16) || ((tag_len % 2) != 0))
+		return false;
+
+	/* Message length must fit into the remaining bytes. */
+	size_t q = BLOCK_LEN - 1 - nonce_len;
+	if ((q < sizeof(size_t)) && ((size >> (8 * q)) != 0))
+		return false;
+
+	return true;
+}
+
+/** CCM mode encryption.
+ *
+ * Used by IEEE 802.11 CCMP with 13 byte nonce and 8 byte tag.
+ *
+ * @param key       Expanded key.
+ * @param nonce     Nonce.
+ * @param nonce_len Length of the nonce (7 to 13 bytes).
+ * @param aad       Additional authenticated data.
+ * @param aad_len   Length of the additional data.
+ * @param input     Plaintext.
+ * @param output    Ciphertext (may be the same as input).
+ * @param size      Length of the data.
+ * @param tag       Resulting authentication tag.
+ * @param tag_len   Length of the tag (4 to 16 bytes, even).
+ *
+ * @return EINVAL on invalid parameters, otherwise EOK.
+ *
+ */
+errno_t aes_ccm_encrypt(const aes_key_t *key, const uint8_t *nonce,
+    size_t nonce_len, const uint8_t *aad, size_t aad_len,
+    const uint8_t *input, uint8_t *output, size_t size, uint8_t *tag,
+    size_t tag_len)
+{
+	if (!ccm_valid(nonce_len, size, tag_len))
+		return EINVAL;
+
+	uint8_t mac[BLOCK_LEN];
+	ccm_mac(key, nonce, nonce_len, aad, aad_len, input, size, tag_len, mac);
+
+	uint8_t counter[BLOCK_LEN];
+	uint8_t s0[BLOCK_LEN];
+	ccm_counter(counter, nonce, nonce_len);
+	ctr_crypt(key, counter, BLOCK_LEN - 1 - nonce_len, mac, s0, BLOCK_LEN);
+	ctr_crypt(key, counter, BLOCK_LEN - 1 - nonce_len, input, output, size);
+
+	memcpy(tag, s0, tag_len);
+	return EOK;
+}
+
+/** Compare two buffers in time independent of their contents.
+ *
+ * @return True if the buffers are equal.
+ *
+ */
+static bool tag_equal(const uint8_t *a, const uint8_t *b, size_t size)
+{
+	uint8_t diff = 0;
+
+	for (size_t i = 0; i < size; i++)
+		diff |= a[i] ^ b[i];
+
+	return diff == 0;
+}
+
+/** CCM mode decryption.
+ *
+ * @param key       Expanded key.
+ * @param nonce     Nonce.
+ * @param nonce_len Length of the nonce (7 to 13 bytes).
+ * @param aad       Additional authenticated data.
+ * @param aad_len   Length of the additional data.
+ * @param input     Ciphertext.
+ * @param output    Plaintext (may be the same as input).
+ * @param size      Length of the data.
+ * @param tag       Authentication tag to be verified.
+ * @param tag_len   Length of the tag (4 to 16 bytes, even).
+ *
+ * @return EINVAL on invalid parameters, EBADCHECKSUM if the tag does not
+ *         match (output is cleared), otherwise EOK.
+ *
+ */
+errno_t aes_ccm_decrypt(const aes_key_t *key, const uint8_t *nonce,
+    size_t nonce_len, const uint8_t *aad, size_t aad_len,
+    const uint8_t *input, uint8_t *output, size_t size, const uint8_t *tag,
+    size_t tag_len)
+{
+	if (!ccm_valid(nonce_len, size, tag_len))
+		return EINVAL;
+
+	uint8_t counter[BLOCK_LEN];
+	uint8_t s0[BLOCK_LEN];
+	uint8_t zero[BLOCK_LEN];
+	memset(zero, 0, BLOCK_LEN);
+
+	ccm_counter(counter, nonce, nonce_len);
+	ctr_crypt(key, counter, BLOCK_LEN - 1 - nonce_len, zero, s0, BLOCK_LEN);
+	ctr_crypt(key, counter, BLOCK_LEN - 1 - nonce_len, input, output, size);
+
+	uint8_t mac[BLOCK_LEN];
+	ccm_mac(key, nonce, nonce_len, aad, aad_len, output, size, tag_len, mac);
+	xor_block(mac, s0, tag_len);
+
+	if (!tag_equal(mac, tag, tag_len)) {
+		memset(output, 0, size);
+		return EBADCHECKSUM;
+	}
+
+	return EOK;
+}
+
+/** Load a big-endian 64-bit value.
+ *
+ */
+static inline uint64_t load_be64(const uint8_t *data)
+{
+	uint64_t val = 0;
 
-	/* Copy input into state array. */
-	uint8_t state[ELEMS][ELEMS];
-	for (size_t i = 0; i < ELEMS; i++) {
-		for (size_t j = 0; j < ELEMS; j++)
-			state[i][j] = input[i + ELEMS * j];
+	for (size_t i = 0; i < 8; i++)
+		val = (val << 8) | data[i];
+
+	return val;
+}
+
+/** Store a big-endian 64-bit value.
+ *
+ */
+static inline void store_be64(uint8_t *data, uint64_t val)
+{
+	for (size_t i = 8; i > 0; i--) {
+		data[i - 1] = val & 0xff;
+		val >>= 8;
 	}
+}
+
+/** Reduction of the 4 bits shifted out during GHASH multiplication. */
+static const uint16_t ghash_last4[16] = {
+	0x0000, 0x1c20, 0x3840, 0x2460, 0x7080, 0x6ca0, 0x48c0, 0x54e0,
+	0xe100, 0xfd20, 0xd940, 0xc560, 0x9180, 0x8da0, 0xa9c0, 0xb5e0
+};
+
+/** Initialize GCM context.
+ *
+ * The multiples of the hash subkey by all 4-bit values are precomputed,
+ * so the GHASH multiplication proceeds by nibbles.
+ *
+ * @param gcm  GCM context to initialize.
+ * @param data Input key.
+ * @param size Length of the input key (16, 24 or 32 bytes).
+ *
+ * @return EINVAL on unsupported key length, otherwise EOK.
+ *
+ */
+errno_t aes_gcm_init(aes_gcm_t *gcm, const uint8_t *data, size_t size)
+{
+	errno_t rc = aes_key_init(&gcm->key, data, size);
+	if (rc != EOK)
+		return rc;
+
+	uint8_t h[BLOCK_LEN];
+	memset(h, 0, BLOCK_LEN);
+	aes_encrypt_blocks(&gcm->key, h, h, 1);
+
+	uint64_t vh = load_be64(h);
+	uint64_t vl = load_be64(h + 8);
+
+	gcm->hh[8] = vh;
+	gcm->hl[8] = vl;
+	gcm->hh[0] = 0;
+	gcm->hl[0] = 0;
+
+	for (size_t i = 4; i > 0; i >>= 1) {
+		uint64_t t = (vl & 1) * 0xe1000000U;
+		vl = (vh << 63) | (vl >> 1);
+		vh = (vh >> 1) ^ (t << 32);
+		gcm->hh[i] = vh;
+		gcm->hl[i] = vl;
+	}
+
+	for (size_t i = 2; i <= 8; i *= 2) {
+		vh = gcm->hh[i];
+		vl = gcm->hl[i];
+		for (size_t j = 1; j < i; j++) {
+			gcm->hh[i + j] = vh ^ gcm->hh[j];
+			gcm->hl[i + j] = vl ^ gcm->hl[j];
+		}
+	}
+
+	return EOK;
+}
+
+/** Multiply a block by the hash subkey in GF(2^128).
+ *
+ * @param gcm GCM context.
+ * @param x   Block to be multiplied in place.
+ *
+ */
+static void ghash_mult(const aes_gcm_t *gcm, uint8_t *x)
+{
+	uint8_t lo = x[15] & 0xf;
+	uint64_t zh = gcm->hh[lo];
+	uint64_t zl = gcm->hl[lo];
+
+	for (size_t i = BLOCK_LEN; i > 0; i--) {
+		lo = x[i - 1] & 0xf;
+		uint8_t hi = x[i - 1] >> 4;
+		uint8_t rem;
+
+		if (i != BLOCK_LEN) {
+			rem = zl & 0xf;
+			zl = (zh << 60) | (zl >> 4);
+			zh = (zh >> 4) ^ ((uint64_t) ghash_last4[rem] << 48);
+			zh ^= gcm->hh[lo];
+			zl ^= gcm->hl[lo];
+		}
+
+		rem = zl & 0xf;
+		zl = (zh << 60) | (zl >> 4);
+		zh = (zh >> 4) ^ ((uint64_t) ghash_last4[rem] << 48);
+		zh ^= gcm->hh[hi];
+		zl ^= gcm->hl[hi];
+	}
+
+	store_be64(x, zh);
+	store_be64(x + 8, zl);
+}
 
-	/* Processing loop. */
-	add_round_key(state, key_exp + ROUNDS * ELEMS);
+/** Add data to GHASH, padding the last block with zeros.
+ *
+ * @param gcm  GCM context.
+ * @param hash Running hash value.
+ * @param data Data to be hashed.
+ * @param size Length of the data.
+ *
+ */
+static void ghash_update(const aes_gcm_t *gcm, uint8_t *hash,
+    const uint8_t *data, size_t size)
+{
+	while (size > 0) {
+		size_t chunk = min(size, (size_t) BLOCK_LEN);
 
-	for (int k = ROUNDS - 1; k >= 0; k--) {
-		inv_shift_rows(state);
-		sub_bytes(state, true);
-		add_round_key(state, key_exp + k * ELEMS);
+		xor_block(hash, data, chunk);
+		ghash_mult(gcm, hash);
 
-		if (k > 0)
-			inv_mix_columns(state);
+		data += chunk;
+		size -= chunk;
 	}
+}
+
+/** Prepare the initial GCM counter block.
+ *
+ * @param gcm    GCM context.
+ * @param iv     Initialization vector.
+ * @param iv_len Length of the initialization vector.
+ * @param j0     Resulting counter block.
+ *
+ */
+static void gcm_start(const aes_gcm_t *gcm, const uint8_t *iv, size_t iv_len,
+    uint8_t *j0)
+{
+	memset(j0, 0, BLOCK_LEN);
 
-	/* Copy state array into output. */
-	for (size_t i = 0; i < ELEMS; i++) {
-		for (size_t j = 0; j < ELEMS; j++)
-			output[i + j * ELEMS] = state[i][j];
+	if (iv_len == 12) {
+		memcpy(j0, iv, iv_len);
+		j0[15] = 1;
+		return;
 	}
 
+	uint8_t len_block[BLOCK_LEN];
+	memset(len_block, 0, BLOCK_LEN);
+	store_be64(len_block + 8, (uint64_t) iv_len * 8);
+
+	ghash_update(gcm, j0, iv, iv_len);
+	ghash_update(gcm, j0, len_block, BLOCK_LEN);
+}
+
+/** Finish the GCM tag.
+ *
+ * @param gcm     GCM context.
+ * @param hash    Running hash value over the data.
+ * @param j0      Initial counter block.
+ * @param aad_len Length of the additional data.
+ * @param size    Length of the ciphertext.
+ * @param tag     Resulting tag (one block).
+ *
+ */
+static void gcm_finish(const aes_gcm_t *gcm, uint8_t *hash, const uint8_t *j0,
+    size_t aad_len, size_t size, uint8_t *tag)
+{
+	uint8_t len_block[BLOCK_LEN];
+	store_be64(len_block, (uint64_t) aad_len * 8);
+	store_be64(len_block + 8, (uint64_t) size * 8);
+	ghash_update(gcm, hash, len_block, BLOCK_LEN);
+
+	aes_encrypt_blocks(&gcm->key, j0, tag, 1);
+	xor_block(tag, hash, BLOCK_LEN);
+}
+
+/** GCM mode encryption.
+ *
+ * @param gcm     GCM context.
+ * @param iv      Initialization vector (12 bytes recommended).
+ * @param iv_len  Length of the initialization vector.
+ * @param aad     Additional authenticated data.
+ * @param aad_len Length of the additional data.
+ * @param input   Plaintext.
+ * @param output  Ciphertext (may be the same as input).
+ * @param size    Length of the data.
+ * @param tag     Resulting authentication tag.
+ * @param tag_len Length of the tag (at most 16 bytes).
+ *
+ * @return EINVAL on invalid parameters, otherwise EOK.
+ *
+ */
+errno_t aes_gcm_encrypt(const aes_gcm_t *gcm, const uint8_t *iv,
+    size_t iv_len, const uint8_t *aad, size_t aad_len, const uint8_t *input,
+    uint8_t *output, size_t size, uint8_t *tag, size_t tag_len)
+{
+	if ((iv_len == 0) || (tag_len > BLOCK_LEN))
+		return EINVAL;
+
+	uint8_t j0[BLOCK_LEN];
+	uint8_t counter[BLOCK_LEN];
+	uint8_t hash[BLOCK_LEN];
+	uint8_t full_tag[BLOCK_LEN];
+
+	gcm_start(gcm, iv, iv_len, j0);
+	memcpy(counter, j0, BLOCK_LEN);
+	counter_inc(counter, 4);
+
+	memset(hash, 0, BLOCK_LEN);
+	ghash_update(gcm, hash, aad, aad_len);
+
+	ctr_crypt(&gcm->key, counter, 4, input, output, size);
+	ghash_update(gcm, hash, output, size);
+
+	gcm_finish(gcm, hash, j0, aad_len, size, full_tag);
+	memcpy(tag, full_tag, tag_len);
+	return EOK;
+}
+
+/** GCM mode decryption.
+ *
+ * @param gcm     GCM context.
+ * @param iv      Initialization vector.
+ * @param iv_len  Length of the initialization vector.
+ * @param aad     Additional authenticated data.
+ * @param aad_len Length of the additional data.
+ * @param input   Ciphertext.
+ * @param output  Plaintext (may be the same as input).
+ * @param size    Length of the data.
+ * @param tag     Authentication tag to be verified.
+ * @param tag_len Length of the tag (at most 16 bytes).
+ *
+ * @return EINVAL on invalid parameters, EBADCHECKSUM if the tag does not
+ *         match (output is cleared), otherwise EOK.
+ *
+ */
+errno_t aes_gcm_decrypt(const aes_gcm_t *gcm, const uint8_t *iv,
+    size_t iv_len, const uint8_t *aad, size_t aad_len, const uint8_t *input,
+    uint8_t *output, size_t size, const uint8_t *tag, size_t tag_len)
+{
+	if ((iv_len == 0) || (tag_len > BLOCK_LEN))
+		return EINVAL;
+
+	uint8_t j0[BLOCK_LEN];
+	uint8_t counter[BLOCK_LEN];
+	uint8_t hash[BLOCK_LEN];
+	uint8_t full_tag[BLOCK_LEN];
+
+	gcm_start(gcm, iv, iv_len, j0);
+	memcpy(counter, j0, BLOCK_LEN);
+	counter_inc(counter, 4);
+
+	memset(hash, 0, BLOCK_LEN);
+	ghash_update(gcm, hash, aad, aad_len);
+	ghash_update(gcm, hash, input, size);
+
+	gcm_finish(gcm, hash, j0, aad_len, size, full_tag);
+	if (!tag_equal(full_tag, tag, tag_len))
+		return EBADCHECKSUM;
+
+	ctr_crypt(&gcm->key, counter, 4, input, output, size);
 	return EOK;
 }
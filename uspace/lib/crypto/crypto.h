@@ -30,12 +30,21 @@
 #define LIBCRYPTO_H
 
 #include <errno.h>
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
 #define AES_CIPHER_LENGTH  16
+#define AES_BLOCK_LENGTH   16
+#define AES_MAX_ROUNDS     14
 #define PBKDF2_KEY_LENGTH  32
 
+/** Length of the block processed by the hash functions. */
+#define HASH_BLOCK_LENGTH  64
+
+/** Length of the longest hash result. */
+#define HASH_MAX_LENGTH  32
+
 /* Left rotation for uint32_t. */
 #define rotl_uint32(val, shift) \
 	(((val) << shift) | ((val) >> (32 - shift)))
@@ -47,12 +56,94 @@
 /** Hash function selector and also result hash length indicator. */
 typedef enum {
 	HASH_MD5 =  16,
-	HASH_SHA1 = 20
+	HASH_SHA1 = 20,
+	HASH_SHA256 = 32
 } hash_func_t;
 
+/** Hash compression procedure (interim hash, input blocks, block count). */
+typedef void (*hash_compress_t)(uint32_t *, const uint8_t *, size_t);
+
+/** Incremental hash computation context. */
+typedef struct {
+	/** Hash function. */
+	hash_func_t func;
+	/** Compression procedure. */
+	hash_compress_t compress;
+	/** Interim hash parts values. */
+	uint32_t h[8];
+	/** Number of bytes hashed. */
+	uint64_t length;
+	/** Partial block. */
+	uint8_t block[HASH_BLOCK_LENGTH];
+	/** Number of bytes in the partial block. */
+	size_t fill;
+} hash_ctx_t;
+
+/** HMAC computation context. */
+typedef struct {
+	/** Hash state after the inner key pad. */
+	hash_ctx_t inner_key;
+	/** Hash state after the outer key pad. */
+	hash_ctx_t outer_key;
+	/** Inner hash of the current message. */
+	hash_ctx_t inner;
+} hmac_ctx_t;
+
+/** Expanded AES key. */
+typedef struct {
+	/** Encryption round keys. */
+	uint32_t enc[4 * (AES_MAX_ROUNDS + 1)] __attribute__((aligned(16)));
+	/** Round keys of the equivalent inverse cipher. */
+	uint32_t dec[4 * (AES_MAX_ROUNDS + 1)] __attribute__((aligned(16)));
+	/** Number of rounds (10, 12 or 14). */
+	size_t rounds;
+	/** Use the AES instructions of the CPU. */
+	bool aesni;
+} aes_key_t;
+
+/** AES-GCM context. */
+typedef struct {
+	/** Expanded cipher key. */
+	aes_key_t key;
+	/** Multiples of the hash subkey (high halves). */
+	uint64_t hh[16];
+	/** Multiples of the hash subkey (low halves). */
+	uint64_t hl[16];
+} aes_gcm_t;
+
 extern errno_t rc4(uint8_t *, size_t, uint8_t *, size_t, size_t, uint8_t *);
 extern errno_t aes_encrypt(uint8_t *, uint8_t *, uint8_t *);
 extern errno_t aes_decrypt(uint8_t *, uint8_t *, uint8_t *);
+extern errno_t aes_key_init(aes_key_t *, const uint8_t *, size_t);
+extern void aes_encrypt_blocks(const aes_key_t *, const uint8_t *, uint8_t *,
+    size_t);
+extern void aes_decrypt_blocks(const aes_key_t *, const uint8_t *, uint8_t *,
+    size_t);
+extern errno_t aes_cbc_encrypt(const aes_key_t *, uint8_t *, const uint8_t *,
+    uint8_t *, size_t);
+extern errno_t aes_cbc_decrypt(const aes_key_t *, uint8_t *, const uint8_t *,
+    uint8_t *, size_t);
+extern void aes_ctr(const aes_key_t *, uint8_t *, const uint8_t *, uint8_t *,
+    size_t);
+extern errno_t aes_ccm_encrypt(const aes_key_t *, const uint8_t *, size_t,
+    const uint8_t *, size_t, const uint8_t *, uint8_t *, size_t, uint8_t *,
+    size_t);
+extern errno_t aes_ccm_decrypt(const aes_key_t *, const uint8_t *, size_t,
+    const uint8_t *, size_t, const uint8_t *, uint8_t *, size_t,
+    const uint8_t *, size_t);
+extern errno_t aes_gcm_init(aes_gcm_t *, const uint8_t *, size_t);
+extern errno_t aes_gcm_encrypt(const aes_gcm_t *, const uint8_t *, size_t,
+    const uint8_t *, size_t, const uint8_t *, uint8_t *, size_t, uint8_t *,
+    size_t);
+extern errno_t aes_gcm_decrypt(const aes_gcm_t *, const uint8_t *, size_t,
+    const uint8_t *, size_t, const uint8_t *, uint8_t *, size_t,
+    const uint8_t *, size_t);
+extern errno_t hash_init(hash_ctx_t *, hash_func_t);
+extern void hash_update(hash_ctx_t *, const void *, size_t);
+extern void hash_final(hash_ctx_t *, uint8_t *);
+extern errno_t hmac_init(hmac_ctx_t *, const uint8_t *, size_t, hash_func_t);
+extern void hmac_update(hmac_ctx_t *, const void *, size_t);
+extern void hmac_final(hmac_ctx_t *, uint8_t *);
 extern errno_t create_hash(uint8_t *, size_t, uint8_t *, hash_func_t);
 extern errno_t hmac(uint8_t *, size_t, uint8_t *, size_t, uint8_t *, hash_func_t);
 extern errno_t pbkdf2(uint8_t *, size_t, uint8_t *, size_t, uint8_t *);
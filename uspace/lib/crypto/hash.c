@@ -0,0 +1,702 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @file hash.c
+ *
+ * Incremental MD5, SHA-1 and SHA-256 cryptographic hash functions.
+ *
+ * Based on RFC 1321 and FIPS 180-4. Data can be added to a hash context
+ * in pieces of arbitrary size, whole blocks are compressed directly from
+ * the caller's buffer. On amd64 the SHA extensions of the CPU are used
+ * for SHA-256 where available.
+ */
+
+#include <mem.h>
+#include <macros.h>
+#include <errno.h>
+#include "crypto.h"
+
+/** Load a big-endian word. */
+static inline uint32_t load_be32(const uint8_t *data)
+{
+	return ((uint32_t) data[0] << 24) | ((uint32_t) data[1] << 16) |
+	    ((uint32_t) data[2] << 8) | ((uint32_t) data[3]);
+}
+
+/** Load a little-endian word. */
+static inline uint32_t load_le32(const uint8_t *data)
+{
+	return ((uint32_t) data[0]) | ((uint32_t) data[1] << 8) |
+	    ((uint32_t) data[2] << 16) | ((uint32_t) data[3] << 24);
+}
+
+/** Store a big-endian word. */
+static inline void store_be32(uint8_t *data, uint32_t val)
+{
+	data[0] = val >> 24;
+	data[1] = val >> 16;
+	data[2] = val >> 8;
+	data[3] = val;
+}
+
+/** Store a little-endian word. */
+static inline void store_le32(uint8_t *data, uint32_t val)
+{
+	data[0] = val;
+	data[1] = val >> 8;
+	data[2] = val >> 16;
+	data[3] = val >> 24;
+}
+
+/** Init values used in MD5 function. */
+static const uint32_t md5_init[] = {
+	0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476
+};
+
+/** Init values used in SHA-1 function. */
+static const uint32_t sha1_init[] = {
+	0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0
+};
+
+/** Init values used in SHA-256 function. */
+static const uint32_t sha256_init[] = {
+	0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+	0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+/** Round constants of SHA-256 algorithm. */
+static const uint32_t sha256_k[64] __attribute__((aligned(16))) = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+	0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+	0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+	0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+	0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+	0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+	0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+	0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+	0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+/* Auxiliary functions of MD5 algorithm. */
+#define MD5_F(x, y, z)  ((z) ^ ((x) & ((y) ^ (z))))
+#define MD5_G(x, y, z)  ((y) ^ ((z) & ((x) ^ (y))))
+#define MD5_H(x, y, z)  ((x) ^ (y) ^ (z))
+#define MD5_I(x, y, z)  ((y) ^ ((x) | ~(z)))
+
+#define MD5_STEP(f, a, b, c, d, x, t, s) \
+	do { \
+		(a) += f((b), (c), (d)) + (x) + (t); \
+		(a) = rotl_uint32((a), s) + (b); \
+	} while (0)
+
+/** Compression procedure of MD5 cryptographic hash function.
+ *
+ * @param h      Working array with interim hash parts values.
+ * @param data   Input blocks.
+ * @param blocks Number of input blocks.
+ *
+ */
+static void md5_compress(uint32_t *h, const uint8_t *data, size_t blocks)
+{
+	uint32_t x[16];
+
+	for (; blocks > 0; blocks--, data += HASH_BLOCK_LENGTH) {
+		for (size_t i = 0; i < 16; i++)
+			x[i] = load_le32(data + 4 * i);
+
+		uint32_t a = h[0];
+		uint32_t b = h[1];
+		uint32_t c = h[2];
+		uint32_t d = h[3];
+
+		MD5_STEP(MD5_F, a, b, c, d, x[0], 0xd76aa478, 7);
+		MD5_STEP(MD5_F, d, a, b, c, x[1], 0xe8c7b756, 12);
+		MD5_STEP(MD5_F, c, d, a, b, x[2], 0x242070db, 17);
+		MD5_STEP(MD5_F, b, c, d, a, x[3], 0xc1bdceee, 22);
+		MD5_STEP(MD5_F, a, b, c, d, x[4], 0xf57c0faf, 7);
+		MD5_STEP(MD5_F, d, a, b, c, x[5], 0x4787c62a, 12);
+		MD5_STEP(MD5_F, c, d, a, b, x[6], 0xa8304613, 17);
+		MD5_STEP(MD5_F, b, c, d, a, x[7], 0xfd469501, 22);
+		MD5_STEP(MD5_F, a, b, c, d, x[8], 0x698098d8, 7);
+		MD5_STEP(MD5_F, d, a, b, c, x[9], 0x8b44f7af, 12);
+		MD5_STEP(MD5_F, c, d, a, b, x[10], 0xffff5bb1, 17);
+		MD5_STEP(MD5_F, b, c, d, a, x[11], 0x895cd7be, 22);
+		MD5_STEP(MD5_F, a, b, c, d, x[12], 0x6b901122, 7);
+		MD5_STEP(MD5_F, d, a, b, c, x[13], 0xfd987193, 12);
+		MD5_STEP(MD5_F, c, d, a, b, x[14], 0xa679438e, 17);
+		MD5_STEP(MD5_F, b, c, d, a, x[15], 0x49b40821, 22);
+
+		MD5_STEP(MD5_G, a, b, c, d, x[1], 0xf61e2562, 5);
+		MD5_STEP(MD5_G, d, a, b, c, x[6], 0xc040b340, 9);
+		MD5_STEP(MD5_G, c, d, a, b, x[11], 0x265e5a51, 14);
+		MD5_STEP(MD5_G, b, c, d, a, x[0], 0xe9b6c7aa, 20);
+		MD5_STEP(MD5_G, a, b, c, d, x[5], 0xd62f105d, 5);
+		MD5_STEP(MD5_G, d, a, b, c, x[10], 0x02441453, 9);
+		MD5_STEP(MD5_G, c, d, a, b, x[15], 0xd8a1e681, 14);
+		MD5_STEP(MD5_G, b, c, d, a, x[4], 0xe7d3fbc8, 20);
+		MD5_STEP(MD5_G, a, b, c, d, x[9], 0x21e1cde6, 5);
+		MD5_STEP(MD5_G, d, a, b, c, x[14], 0xc33707d6, 9);
+		MD5_STEP(MD5_G, c, d, a, b, x[3], 0xf4d50d87, 14);
+		MD5_STEP(MD5_G, b, c, d, a, x[8], 0x455a14ed, 20);
+		MD5_STEP(MD5_G, a, b, c, d, x[13], 0xa9e3e905, 5);
+		MD5_STEP(MD5_G, d, a, b, c, x[2], 0xfcefa3f8, 9);
+		MD5_STEP(MD5_G, c, d, a, b, x[7], 0x676f02d9, 14);
+		MD5_STEP(MD5_G, b, c, d, a, x[12], 0x8d2a4c8a, 20);
+
+		MD5_STEP(MD5_H, a, b, c, d, x[5], 0xfffa3942, 4);
+		MD5_STEP(MD5_H, d, a, b, c, x[8], 0x8771f681, 11);
+		MD5_STEP(MD5_H, c, d, a, b, x[11], 0x6d9d6122, 16);
+		MD5_STEP(MD5_H, b, c, d, a, x[14], 0xfde5380c, 23);
+		MD5_STEP(MD5_H, a, b, c, d, x[1], 0xa4beea44, 4);
+		MD5_STEP(MD5_H, d, a, b, c, x[4], 0x4bdecfa9, 11);
+		MD5_STEP(MD5_H, c, d, a, b, x[7], 0xf6bb4b60, 16);
+		MD5_STEP(MD5_H, b, c, d, a, x[10], 0xbebfbc70, 23);
+		MD5_STEP(MD5_H, a, b, c, d, x[13], 0x289b7ec6, 4);
+		MD5_STEP(MD5_H, d, a, b, c, x[0], 0xeaa127fa, 11);
+		MD5_STEP(MD5_H, c, d, a, b, x[3], 0xd4ef3085, 16);
+		MD5_STEP(MD5_H, b, c, d, a, x[6], 0x04881d05, 23);
+		MD5_STEP(MD5_H, a, b, c, d, x[9], 0xd9d4d039, 4);
+		MD5_STEP(MD5_H, d, a, b, c, x[12], 0xe6db99e5, 11);
+		MD5_STEP(MD5_H, c, d, a, b, x[15], 0x1fa27cf8, 16);
+		MD5_STEP(MD5_H, b, c, d, a, x[2], 0xc4ac5665, 23);
+
+		MD5_STEP(MD5_I, a, b, c, d, x[0], 0xf4292244, 6);
+		MD5_STEP(MD5_I, d, a, b, c, x[7], 0x432aff97, 10);
+		MD5_STEP(MD5_I, c, d, a, b, x[14], 0xab9423a7, 15);
+		MD5_STEP(MD5_I, b, c, d, a, x[5], 0xfc93a039, 21);
+		MD5_STEP(MD5_I, a, b, c, d, x[12], 0x655b59c3, 6);
+		MD5_STEP(MD5_I, d, a, b, c, x[3], 0x8f0ccc92, 10);
+		MD5_STEP(MD5_I, c, d, a, b, x[10], 0xffeff47d, 15);
+		MD5_STEP(MD5_I, b, c, d, a, x[1], 0x85845dd1, 21);
+		MD5_STEP(MD5_I, a, b, c, d, x[8], 0x6fa87e4f, 6);
+		MD5_STEP(MD5_I, d, a, b, c, x[15], 0xfe2ce6e0, 10);
+		MD5_STEP(MD5_I, c, d, a, b, x[6], 0xa3014314, 15);
+		MD5_STEP(MD5_I, b, c, d, a, x[13], 0x4e0811a1, 21);
+		MD5_STEP(MD5_I, a, b, c, d, x[4], 0xf7537e82, 6);
+		MD5_STEP(MD5_I, d, a, b, c, x[11], 0xbd3af235, 10);
+		MD5_STEP(MD5_I, c, d, a, b, x[2], 0x2ad7d2bb, 15);
+		MD5_STEP(MD5_I, b, c, d, a, x[9], 0xeb86d391, 21);
+
+		h[0] += a;
+		h[1] += b;
+		h[2] += c;
+		h[3] += d;
+	}
+}
+
+/* Auxiliary functions of SHA-1 algorithm. */
+#define SHA1_CH(x, y, z)      ((z) ^ ((x) & ((y) ^ (z))))
+#define SHA1_PARITY(x, y, z)  ((x) ^ (y) ^ (z))
+#define SHA1_MAJ(x, y, z)     (((x) & (y)) | ((z) & ((x) | (y))))
+
+/* Message schedule of SHA-1 kept in a ring of 16 words. */
+#define SHA1_W(w, t) \
+	((t) < 16 ? (w)[(t)] : ((w)[(t) & 15] = rotl_uint32( \
+	    (w)[((t) + 13) & 15] ^ (w)[((t) + 8) & 15] ^ \
+	    (w)[((t) + 2) & 15] ^ (w)[(t) & 15], 1)))
+
+#define SHA1_STEP(f, k, a, b, c, d, e, w, t) \
+	do { \
+		(e) += rotl_uint32((a), 5) + f((b), (c), (d)) + (k) + \
+		    SHA1_W((w), (t)); \
+		(b) = rotl_uint32((b), 30); \
+	} while (0)
+
+/* Five steps rotate the working variables back into place. */
+#define SHA1_STEP5(f, k, a, b, c, d, e, w, t) \
+	do { \
+		SHA1_STEP(f, k, a, b, c, d, e, w, (t)); \
+		SHA1_STEP(f, k, e, a, b, c, d, w, (t) + 1); \
+		SHA1_STEP(f, k, d, e, a, b, c, w, (t) + 2); \
+		SHA1_STEP(f, k, c, d, e, a, b, w, (t) + 3); \
+		SHA1_STEP(f, k, b, c, d, e, a, w, (t) + 4); \
+	} while (0)
+
+/** Compression procedure of SHA-1 cryptographic hash function.
+ *
+ * @param h      Working array with interim hash parts values.
+ * @param data   Input blocks.
+ * @param blocks Number of input blocks.
+ *
+ */
+static void sha1_compress(uint32_t *h, const uint8_t *data, size_t blocks)
+{
+	uint32_t w[16];
+
+	for (; blocks > 0; blocks--, data += HASH_BLOCK_LENGTH) {
+		for (size_t i = 0; i < 16; i++)
+			w[i] = load_be32(data + 4 * i);
+
+		uint32_t a = h[0];
+		uint32_t b = h[1];
+		uint32_t c = h[2];
+		uint32_t d = h[3];
+		uint32_t e = h[4];
+
+		for (size_t t = 0; t < 20; t += 5)
+			SHA1_STEP5(SHA1_CH, 0x5a827999, a, b, c, d, e, w, t);
+
+		for (size_t t = 20; t < 40; t += 5)
+			SHA1_STEP5(SHA1_PARITY, 0x6ed9eba1, a, b, c, d, e, w, t);
+
+		for (size_t t = 40; t < 60; t += 5)
+			SHA1_STEP5(SHA1_MAJ, 0x8f1bbcdc, a, b, c, d, e, w, t);
+
+		for (size_t t = 60; t < 80; t += 5)
+			SHA1_STEP5(SHA1_PARITY, 0xca62c1d6, a, b, c, d, e, w, t);
+
+		h[0] += a;
+		h[1] += b;
+		h[2] += c;
+		h[3] += d;
+		h[4] += e;
+	}
+}
+
+/* Auxiliary functions of SHA-256 algorithm. */
+#define SHA256_CH(x, y, z)   ((z) ^ ((x) & ((y) ^ (z))))
+#define SHA256_MAJ(x, y, z)  (((x) & (y)) | ((z) & ((x) | (y))))
+#define SHA256_S0(x) \
+	(rotr_uint32((x), 2) ^ rotr_uint32((x), 13) ^ rotr_uint32((x), 22))
+#define SHA256_S1(x) \
+	(rotr_uint32((x), 6) ^ rotr_uint32((x), 11) ^ rotr_uint32((x), 25))
+#define SHA256_s0(x) \
+	(rotr_uint32((x), 7) ^ rotr_uint32((x), 18) ^ ((x) >> 3))
+#define SHA256_s1(x) \
+	(rotr_uint32((x), 17) ^ rotr_uint32((x), 19) ^ ((x) >> 10))
+
+/* Message schedule of SHA-256 kept in a ring of 16 words. */
+#define SHA256_W(w, t) \
+	((t) < 16 ? (w)[(t)] : ((w)[(t) & 15] += \
+	    SHA256_s1((w)[((t) + 14) & 15]) + (w)[((t) + 9) & 15] + \
+	    SHA256_s0((w)[((t) + 1) & 15])))
+
+#define SHA256_STEP(a, b, c, d, e, f, g, h, w, t) \
+	do { \
+		uint32_t t1 = (h) + SHA256_S1((e)) + SHA256_CH((e), (f), (g)) + \
+		    sha256_k[(t)] + SHA256_W((w), (t)); \
+		(d) += t1; \
+		(h) = t1 + SHA256_S0((a)) + SHA256_MAJ((a), (b), (c)); \
+	} while (0)
+
+/** Compression procedure of SHA-256 cryptographic hash function.
+ *
+ * @param h      Working array with interim hash parts values.
+ * @param data   Input blocks.
+ * @param blocks Number of input blocks.
+ *
+ */
+static void sha256_compress(uint32_t *h, const uint8_t *data, size_t blocks)
+{
+	uint32_t w[16];
+
+	for (; blocks > 0; blocks--, data += HASH_BLOCK_LENGTH) {
+		for (size_t i = 0; i < 16; i++)
+			w[i] = load_be32(data + 4 * i);
+
+		uint32_t a = h[0];
+		uint32_t b = h[1];
+		uint32_t c = h[2];
+		uint32_t d = h[3];
+		uint32_t e = h[4];
+		uint32_t f = h[5];
+		uint32_t g = h[6];
+		uint32_t hh = h[7];
+
+		/* Eight steps rotate the working variables back into place. */
+		for (size_t t = 0; t < 64; t += 8) {
+			SHA256_STEP(a, b, c, d, e, f, g, hh, w, t);
+			SHA256_STEP(hh, a, b, c, d, e, f, g, w, t + 1);
+			SHA256_STEP(g, hh, a, b, c, d, e, f, w, t + 2);
+			SHA256_STEP(f, g, hh, a, b, c, d, e, w, t + 3);
+			SHA256_STEP(e, f, g, hh, a, b, c, d, w, t + 4);
+			SHA256_STEP(d, e, f, g, hh, a, b, c, w, t + 5);
+			SHA256_STEP(c, d, e, f, g, hh, a, b, w, t + 6);
+			SHA256_STEP(b, c, d, e, f, g, hh, a, w, t + 7);
+		}
+
+		h[0] += a;
+		h[1] += b;
+		h[2] += c;
+		h[3] += d;
+		h[4] += e;
+		h[5] += f;
+		h[6] += g;
+		h[7] += hh;
+	}
+}
+
+#ifdef __x86_64__
+
+typedef uint32_t sha_vec_t __attribute__((vector_size(16)));
+
+/** Byte order reversal of the words in a vector (for pshufb). */
+static const uint8_t sha_bswap_mask[16] __attribute__((aligned(16))) = {
+	3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12
+};
+
+/** Check whether the CPU implements the SHA extensions.
+ *
+ * @return True if the SHA instructions are available.
+ *
+ */
+static bool sha_ni_available(void)
+{
+	uint32_t eax = 0;
+	uint32_t ebx;
+	uint32_t ecx = 0;
+	uint32_t edx;
+
+	asm volatile (
+	    "cpuid\n"
+	    : "+a" (eax), "=b" (ebx), "+c" (ecx), "=d" (edx)
+	);
+
+	if (eax < 7)
+		return false;
+
+	eax = 7;
+	ecx = 0;
+	asm volatile (
+	    "cpuid\n"
+	    : "+a" (eax), "=b" (ebx), "+c" (ecx), "=d" (edx)
+	);
+
+	/* CPUID.(EAX=07H,ECX=0):EBX.SHA[bit 29] */
+	return (ebx & (1 << 29)) != 0;
+}
+
+/** Compression procedure of SHA-256 using the SHA extensions.
+ *
+ * The state is kept in two registers as ABEF and CDGH, each
+ * sha256rnds2 instruction performs two rounds.
+ *
+ * @param h      Working array with interim hash parts values.
+ * @param data   Input blocks.
+ * @param blocks Number of input blocks.
+ *
+ */
+static void sha256_compress_ni(uint32_t *h, const uint8_t *data,
+    size_t blocks)
+{
+	sha_vec_t mask;
+	sha_vec_t tmp;
+	sha_vec_t state0;
+	sha_vec_t state1;
+
+	memcpy(&mask, sha_bswap_mask, sizeof(mask));
+	memcpy(&tmp, h, sizeof(tmp));
+	memcpy(&state1, h + 4, sizeof(state1));
+
+	/* DCBA, HGFE -> ABEF, CDGH */
+	asm ("pshufd $0xb1, %0, %0\n"
+	    "pshufd $0x1b, %1, %1\n"
+	    "movdqa %0, %2\n"
+	    "palignr $8, %1, %2\n"
+	    "pblendw $0xf0, %0, %1\n"
+	    : "+x" (tmp), "+x" (state1), "=&x" (state0));
+
+	for (; blocks > 0; blocks--, data += HASH_BLOCK_LENGTH) {
+		sha_vec_t abef = state0;
+		sha_vec_t cdgh = state1;
+		sha_vec_t msg[4];
+
+		memcpy(msg, data, sizeof(msg));
+
+		for (size_t i = 0; i < 16; i++) {
+			sha_vec_t *cur = &msg[i & 3];
+
+			if (i < 4) {
+				asm ("pshufb %1, %0\n" : "+x" (*cur) : "x" (mask));
+			} else {
+				/* W[i] from W[i - 4], W[i - 3], W[i - 2], W[i - 1] */
+				sha_vec_t w7 = msg[(i - 1) & 3];
+
+				asm ("palignr $4, %1, %0\n"
+				    : "+x" (w7) : "x" (msg[(i - 2) & 3]));
+				asm ("sha256msg1 %1, %0\n"
+				    : "+x" (*cur) : "x" (msg[(i - 3) & 3]));
+				*cur += w7;
+				asm ("sha256msg2 %1, %0\n"
+				    : "+x" (*cur) : "x" (msg[(i - 1) & 3]));
+			}
+
+			sha_vec_t k;
+			memcpy(&k, sha256_k + 4 * i, sizeof(k));
+
+			sha_vec_t wk = *cur + k;
+			asm ("sha256rnds2 %2, %1, %0\n"
+			    : "+x" (state1) : "x" (state0), "Yz" (wk));
+			asm ("pshufd $0x0e, %0, %0\n" : "+x" (wk));
+			asm ("sha256rnds2 %2, %1, %0\n"
+			    : "+x" (state0) : "x" (state1), "Yz" (wk));
+		}
+
+		state0 += abef;
+		state1 += cdgh;
+	}
+
+	/* ABEF, CDGH -> DCBA, HGFE */
+	asm ("pshufd $0x1b, %0, %0\n"
+	    "pshufd $0xb1, %1, %1\n"
+	    "movdqa %0, %2\n"
+	    "pblendw $0xf0, %1, %2\n"
+	    "palignr $8, %0, %1\n"
+	    : "+x" (state0), "+x" (state1), "=&x" (tmp));
+
+	memcpy(h, &tmp, sizeof(tmp));
+	memcpy(h + 4, &state1, sizeof(state1));
+}
+
+/** Select SHA-256 compression procedure.
+ *
+ * @return Fastest procedure supported by the CPU.
+ *
+ */
+static hash_compress_t sha256_select(void)
+{
+	/* The result does not change, a racing update is harmless. */
+	static hash_compress_t compress = NULL;
+
+	if (compress == NULL)
+		compress = sha_ni_available() ? sha256_compress_ni : sha256_compress;
+
+	return compress;
+}
+
+#else
+
+static hash_compress_t sha256_select(void)
+{
+	return sha256_compress;
+}
+
+#endif
+
+/** Initialize hash context.
+ *
+ * @param ctx      Hash context.
+ * @param hash_sel Hash function selector.
+ *
+ * @return EINVAL when the hash function is not supported, otherwise EOK.
+ *
+ */
+errno_t hash_init(hash_ctx_t *ctx, hash_func_t hash_sel)
+{
+	switch (hash_sel) {
+	case HASH_MD5:
+		memcpy(ctx->h, md5_init, sizeof(md5_init));
+		ctx->compress = md5_compress;
+		break;
+	case HASH_SHA1:
+		memcpy(ctx->h, sha1_init, sizeof(sha1_init));
+		ctx->compress = sha1_compress;
+		break;
+	case HASH_SHA256:
+		memcpy(ctx->h, sha256_init, sizeof(sha256_init));
+		ctx->compress = sha256_select();
+		break;
+	default:
+		return EINVAL;
+	}
+
+	ctx->func = hash_sel;
+	ctx->length = 0;
+	ctx->fill = 0;
+	return EOK;
+}
+
+/** Add data to hash.
+ *
+ * @param ctx  Hash context.
+ * @param data Input data.
+ * @param size Length of the input data.
+ *
+ */
+void hash_update(hash_ctx_t *ctx, const void *data, size_t size)
+{
+	const uint8_t *input = data;
+
+	ctx->length += size;
+
+	if (ctx->fill > 0) {
+		size_t chunk = min(size, HASH_BLOCK_LENGTH - ctx->fill);
+
+		memcpy(ctx->block + ctx->fill, input, chunk);
+		ctx->fill += chunk;
+		input += chunk;
+		size -= chunk;
+
+		if (ctx->fill < HASH_BLOCK_LENGTH)
+			return;
+
+		ctx->compress(ctx->h, ctx->block, 1);
+		ctx->fill = 0;
+	}
+
+	/* Whole blocks are compressed without copying. */
+	size_t blocks = size / HASH_BLOCK_LENGTH;
+	if (blocks > 0) {
+		ctx->compress(ctx->h, input, blocks);
+		input += blocks * HASH_BLOCK_LENGTH;
+		size -= blocks * HASH_BLOCK_LENGTH;
+	}
+
+	memcpy(ctx->block, input, size);
+	ctx->fill = size;
+}
+
+/** Finish hash computation.
+ *
+ * The context has to be initialized again before it is reused.
+ *
+ * @param ctx    Hash context.
+ * @param output Result hash (length given by the hash function selector).
+ *
+ */
+void hash_final(hash_ctx_t *ctx, uint8_t *output)
+{
+	uint64_t bits = ctx->length * 8;
+
+	ctx->block[ctx->fill++] = 0x80;
+	if (ctx->fill > HASH_BLOCK_LENGTH - 8) {
+		memset(ctx->block + ctx->fill, 0, HASH_BLOCK_LENGTH - ctx->fill);
+		ctx->compress(ctx->h, ctx->block, 1);
+		ctx->fill = 0;
+	}
+
+	memset(ctx->block + ctx->fill, 0, HASH_BLOCK_LENGTH - 8 - ctx->fill);
+
+	uint8_t *len = ctx->block + HASH_BLOCK_LENGTH - 8;
+	if (ctx->func == HASH_MD5) {
+		store_le32(len, bits);
+		store_le32(len + 4, bits >> 32);
+	} else {
+		store_be32(len, bits >> 32);
+		store_be32(len + 4, bits);
+	}
+
+	ctx->compress(ctx->h, ctx->block, 1);
+
+	for (size_t i = 0; i < ctx->func / 4; i++) {
+		if (ctx->func == HASH_MD5)
+			store_le32(output + 4 * i, ctx->h[i]);
+		else
+			store_be32(output + 4 * i, ctx->h[i]);
+	}
+}
+
+/** Initialize HMAC context.
+ *
+ * The hash states after the inner and outer key pads are computed once
+ * and kept, so each message costs only the compressions of its own data
+ * and the outer hash.
+ *
+ * @param ctx      HMAC context.
+ * @param key      Cryptographic key sequence.
+ * @param key_size Size of key sequence.
+ * @param hash_sel Hash function selector.
+ *
+ * @return EINVAL when the hash function is not supported, otherwise EOK.
+ *
+ */
+errno_t hmac_init(hmac_ctx_t *ctx, const uint8_t *key, size_t key_size,
+    hash_func_t hash_sel)
+{
+	uint8_t work_key[HASH_BLOCK_LENGTH];
+	uint8_t pad[HASH_BLOCK_LENGTH];
+
+	errno_t rc = hash_init(&ctx->inner_key, hash_sel);
+	if (rc != EOK)
+		return rc;
+
+	memset(work_key, 0, HASH_BLOCK_LENGTH);
+
+	if (key_size > HASH_BLOCK_LENGTH) {
+		hash_update(&ctx->inner_key, key, key_size);
+		hash_final(&ctx->inner_key, work_key);
+		hash_init(&ctx->inner_key, hash_sel);
+	} else {
+		memcpy(work_key, key, key_size);
+	}
+
+	hash_init(&ctx->outer_key, hash_sel);
+
+	for (size_t i = 0; i < HASH_BLOCK_LENGTH; i++)
+		pad[i] = work_key[i] ^ 0x36;
+
+	hash_update(&ctx->inner_key, pad, HASH_BLOCK_LENGTH);
+
+	for (size_t i = 0; i < HASH_BLOCK_LENGTH; i++)
+		pad[i] = work_key[i] ^ 0x5c;
+
+	hash_update(&ctx->outer_key, pad, HASH_BLOCK_LENGTH);
+
+	ctx->inner = ctx->inner_key;
+	return EOK;
+}
+
+/** Add message data to HMAC.
+ *
+ * @param ctx  HMAC context.
+ * @param data Message data.
+ * @param size Length of the message data.
+ *
+ */
+void hmac_update(hmac_ctx_t *ctx, const void *data, size_t size)
+{
+	hash_update(&ctx->inner, data, size);
+}
+
+/** Finish HMAC computation.
+ *
+ * The context is reset to the keyed state afterwards, so another
+ * message can be authenticated with the same key.
+ *
+ * @param ctx    HMAC context.
+ * @param output Result hash (length given by the hash function selector).
+ *
+ */
+void hmac_final(hmac_ctx_t *ctx, uint8_t *output)
+{
+	uint8_t inner_hash[HASH_MAX_LENGTH];
+	hash_ctx_t outer = ctx->outer_key;
+
+	hash_final(&ctx->inner, inner_hash);
+	hash_update(&outer, inner_hash, ctx->inner.func);
+	hash_final(&outer, output);
+
+	ctx->inner = ctx->inner_key;
+}
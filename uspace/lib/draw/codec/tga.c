@@ -38,7 +38,8 @@
 #include <byteorder.h>
 #include <align.h>
 #include <stdbool.h>
-#include <pixconv.h>
+#include <stdint.h>
+#include <mem.h>
 #include "tga.h"
 
 typedef struct {
@@ -75,6 +76,14 @@ typedef enum {
 	IMG_GRAY_RLE = 11
 } img_type_t;
 
+/** Image descriptor direction bits (after shifting) */
+#define IMG_DIR_RIGHT_TO_LEFT  0x01
+#define IMG_DIR_TOP_DOWN       0x02
+
+/** RLE packet header bits */
+#define RLE_REPEAT       0x80
+#define RLE_COUNT_MASK   0x7f
+
 typedef struct {
 	cmap_type_t cmap_type;
 	img_type_t img_type;
@@ -91,41 +100,65 @@ typedef struct {
 	uint8_t img_alpha_bpp;
 	uint8_t img_alpha_dir;
 
-	void *id_data;
 	size_t id_length;
-
-	void *cmap_data;
 	size_t cmap_length;
-
-	void *img_data;
-	size_t img_length;
 } tga_t;
 
+typedef enum {
+	/** Reading the fixed-size header */
+	TGA_STAGE_HEADER,
+	/** Skipping the image ID and color map */
+	TGA_STAGE_SKIP,
+	/** Decoding pixel data */
+	TGA_STAGE_PIXELS,
+	/** All pixels decoded, remaining input is ignored */
+	TGA_STAGE_DONE
+} tga_stage_t;
+
+/** Incremental TGA decoder
+ *
+ * The input can be fed in arbitrarily sized chunks (e.g. straight
+ * from a decompressor). Pixels are converted directly into the rows
+ * of the destination surface, no copy of the encoded or decoded
+ * image is kept.
+ *
+ */
+struct tga_decoder {
+	surface_flags_t flags;
+	tga_stage_t stage;
+
+	uint8_t header[sizeof(tga_header_t)];
+	size_t header_fill;
+	size_t skip;
+
+	tga_t tga;
+	bool rle;
+	size_t pixel_size;
+
+	surface_t *surface;
+	pixelmap_t *pixmap;
+	pixel_t *row;
+	sysarg_t col;
+	sysarg_t rows;
+
+	size_t packet_left;
+	bool packet_repeat;
+
+	uint8_t pixel[4];
+	size_t pixel_fill;
+};
+
 /** Decode Truevision TGA header
  *
- * @param[in]  data Memory representation of TGA.
- * @param[in]  size Size of the representation (in bytes).
+ * @param[in]  head Memory representation of TGA header.
  * @param[out] tga  Decoded TGA.
  *
- * @return True on succesful decoding.
- * @return False on failure.
- *
  */
-static bool decode_tga_header(void *data, size_t size, tga_t *tga)
+static void decode_tga_header(const tga_header_t *head, tga_t *tga)
 {
-	/* Header sanity check */
-	if (size < sizeof(tga_header_t))
-		return false;
-
-	tga_header_t *head = (tga_header_t *) data;
-
 	/* Image ID field */
-	tga->id_data = data + sizeof(tga_header_t);
 	tga->id_length = head->id_length;
 
-	if (size < sizeof(tga_header_t) + tga->id_length)
-		return false;
-
 	/* Color map type */
 	tga->cmap_type = head->cmap_type;
 
@@ -136,13 +169,8 @@ static bool decode_tga_header(void *data, size_t size, tga_t *tga)
 	tga->cmap_first_entry = uint16_t_le2host(head->cmap_first_entry);
 	tga->cmap_entries = uint16_t_le2host(head->cmap_entries);
 	tga->cmap_bpp = head->cmap_bpp;
-	tga->cmap_data = tga->id_data + tga->id_length;
 	tga->cmap_length = ALIGN_UP(tga->cmap_entries * tga->cmap_bpp, 8) >> 3;
 
-	if (size < sizeof(tga_header_t) + tga->id_length +
-	    tga->cmap_length)
-		return false;
-
 	/* Image specification */
 	tga->startx = uint16_t_le2host(head->startx);
 	tga->starty = uint16_t_le2host(head->starty);
@@ -151,110 +179,422 @@ static bool decode_tga_header(void *data, size_t size, tga_t *tga)
 	tga->img_bpp = head->img_bpp;
 	tga->img_alpha_bpp = head->img_descr & 0x0f;
 	tga->img_alpha_dir = (head->img_descr & 0xf0) >> 4;
-	tga->img_data = tga->cmap_data + tga->cmap_length;
-	tga->img_length = ALIGN_UP(tga->width * tga->height * tga->img_bpp, 8) >> 3;
+}
 
-	if (size < sizeof(tga_header_t) + tga->id_length +
-	    tga->cmap_length + tga->img_length)
-		return false;
+/** Create incremental TGA decoder
+ *
+ * @param flags Flags of the surface to be created.
+ *
+ * @return New decoder or NULL if out of memory.
+ *
+ */
+tga_decoder_t *tga_decoder_create(surface_flags_t flags)
+{
+	tga_decoder_t *dec = calloc(1, sizeof(tga_decoder_t));
+	if (dec == NULL)
+		return NULL;
 
-	return true;
+	dec->flags = flags;
+	dec->stage = TGA_STAGE_HEADER;
+	return dec;
 }
 
-/** Decode Truevision TGA format
+/** Start decoding a new destination row
  *
- * Decode Truevision TGA format and create a surface
- * from it. The supported variants of TGA are currently
- * limited to uncompressed 24 bit true-color images without
- * alpha channel.
+ * TGA is encoded in a bottom-up manner unless the top-down
+ * bit of the image descriptor is set.
  *
- * @param[in] data  Memory representation of TGA.
- * @param[in] size  Size of the representation (in bytes).
- * @param[in] flags Surface creation flags.
+ * @param dec Decoder.
  *
- * @return Newly allocated surface with the decoded content.
- * @return NULL on error or unsupported format.
+ */
+static void tga_start_row(tga_decoder_t *dec)
+{
+	if (dec->rows == dec->tga.height) {
+		dec->stage = TGA_STAGE_DONE;
+		return;
+	}
+
+	sysarg_t y = dec->rows;
+	if ((dec->tga.img_alpha_dir & IMG_DIR_TOP_DOWN) == 0)
+		y = dec->tga.height - dec->rows - 1;
+
+	dec->row = dec->pixmap->data + y * dec->pixmap->width + dec->tga.startx;
+	dec->col = 0;
+}
+
+/** Finish the current destination row if it is complete
+ *
+ * @param dec Decoder.
  *
  */
-surface_t *decode_tga(void *data, size_t size, surface_flags_t flags)
+static inline void tga_end_row(tga_decoder_t *dec)
 {
-	tga_t tga;
-	if (!decode_tga_header(data, size, &tga))
-		return NULL;
+	if (dec->col == dec->tga.width) {
+		dec->rows++;
+		tga_start_row(dec);
+	}
+}
+
+/** Check the decoded header and create the destination surface
+ *
+ * @param dec Decoder with a complete header.
+ *
+ * @return EOK on success.
+ * @return ENOTSUP on unsupported format.
+ * @return ENOMEM if out of memory.
+ *
+ */
+static errno_t tga_decoder_start(tga_decoder_t *dec)
+{
+	tga_t *tga = &dec->tga;
+	decode_tga_header((tga_header_t *) dec->header, tga);
 
 	/*
-	 * Check for unsupported features.
+	 * Check for unsupported features. A color map is skipped
+	 * if present, color-mapped images are not supported.
 	 */
 
-	switch (tga.cmap_type) {
+	switch (tga->cmap_type) {
 	case CMAP_NOT_PRESENT:
+	case CMAP_PRESENT:
 		break;
 	default:
 		/* Unsupported */
-		return NULL;
+		return ENOTSUP;
 	}
 
-	switch (tga.img_type) {
+	switch (tga->img_type) {
 	case IMG_BGRA:
-		if (tga.img_bpp != 24)
-			return NULL;
+	case IMG_BGRA_RLE:
+		if ((tga->img_bpp != 24) && (tga->img_bpp != 32))
+			return ENOTSUP;
 		break;
 	case IMG_GRAY:
-		if (tga.img_bpp != 8)
-			return NULL;
+	case IMG_GRAY_RLE:
+		if (tga->img_bpp != 8)
+			return ENOTSUP;
 		break;
 	default:
 		/* Unsupported */
-		return NULL;
+		return ENOTSUP;
 	}
 
-	if (tga.img_alpha_bpp != 0)
-		return NULL;
+	if ((tga->img_alpha_bpp != 0) &&
+	    ((tga->img_alpha_bpp != 8) || (tga->img_bpp != 32)))
+		return ENOTSUP;
 
-	sysarg_t twidth = tga.startx + tga.width;
-	sysarg_t theight = tga.starty + tga.height;
+	if ((tga->img_alpha_dir & IMG_DIR_RIGHT_TO_LEFT) != 0)
+		return ENOTSUP;
 
-	surface_t *surface = surface_create(twidth, theight, NULL, flags);
-	if (surface == NULL)
-		return NULL;
+	if ((tga->width == 0) || (tga->height == 0))
+		return ENOTSUP;
+
+	dec->rle = (tga->img_type == IMG_BGRA_RLE) ||
+	    (tga->img_type == IMG_GRAY_RLE);
+	dec->pixel_size = tga->img_bpp >> 3;
 
 	/*
-	 * TGA is encoded in a bottom-up manner, the true-color
-	 * variant is in BGR 8:8:8 encoding.
+	 * Uncompressed data is handled as a single raw packet
+	 * spanning the whole image.
 	 */
+	if (!dec->rle)
+		dec->packet_left = (size_t) tga->width * tga->height;
 
-	switch (tga.img_type) {
-	case IMG_BGRA:
-		for (sysarg_t y = tga.starty; y < theight; y++) {
-			for (sysarg_t x = tga.startx; x < twidth; x++) {
-				size_t offset =
-				    ((y - tga.starty) * tga.width + (x - tga.startx)) * 3;
-
-				pixel_t pixel =
-				    bgr_888_2pixel(((uint8_t *) tga.img_data) + offset);
-				surface_put_pixel(surface, x, theight - y - 1, pixel);
+	dec->surface = surface_create(tga->startx + tga->width,
+	    tga->starty + tga->height, NULL, dec->flags);
+	if (dec->surface == NULL)
+		return ENOMEM;
+
+	dec->pixmap = surface_pixmap_access(dec->surface);
+
+	dec->skip = tga->id_length + tga->cmap_length;
+	dec->stage = TGA_STAGE_SKIP;
+	return EOK;
+}
+
+/** Convert a single encoded pixel
+ *
+ * @param dec Decoder.
+ * @param src Encoded pixel.
+ *
+ * @return Decoded pixel.
+ *
+ */
+static inline pixel_t tga_pixel(tga_decoder_t *dec, const uint8_t *src)
+{
+	switch (dec->pixel_size) {
+	case 1:
+		return PIXEL(255, src[0], src[0], src[0]);
+	case 3:
+		return PIXEL(255, src[2], src[1], src[0]);
+	default:
+		return PIXEL(dec->tga.img_alpha_bpp != 0 ? src[3] : 255,
+		    src[2], src[1], src[0]);
+	}
+}
+
+/** Store a run of identical pixels
+ *
+ * @param dec   Decoder.
+ * @param pixel Pixel to store.
+ * @param count Number of pixels to store.
+ *
+ */
+static void tga_fill(tga_decoder_t *dec, pixel_t pixel, size_t count)
+{
+	while ((count > 0) && (dec->stage == TGA_STAGE_PIXELS)) {
+		size_t n = dec->tga.width - dec->col;
+		if (n > count)
+			n = count;
+
+		pixel_t *dst = dec->row + dec->col;
+		for (size_t i = 0; i < n; i++)
+			dst[i] = pixel;
+
+		dec->col += n;
+		count -= n;
+		tga_end_row(dec);
+	}
+}
+
+/** Convert a run of encoded pixels
+ *
+ * @param dec   Decoder.
+ * @param src   Encoded pixels.
+ * @param count Number of pixels to convert.
+ *
+ */
+static void tga_put(tga_decoder_t *dec, const uint8_t *src, size_t count)
+{
+	while ((count > 0) && (dec->stage == TGA_STAGE_PIXELS)) {
+		size_t n = dec->tga.width - dec->col;
+		if (n > count)
+			n = count;
+
+		pixel_t *dst = dec->row + dec->col;
+
+		switch (dec->pixel_size) {
+		case 1:
+			for (size_t i = 0; i < n; i++, src++)
+				dst[i] = PIXEL(255, src[0], src[0], src[0]);
+			break;
+		case 3:
+			for (size_t i = 0; i < n; i++, src += 3)
+				dst[i] = PIXEL(255, src[2], src[1], src[0]);
+			break;
+		default:
+			if (dec->tga.img_alpha_bpp != 0) {
+				for (size_t i = 0; i < n; i++, src += 4)
+					dst[i] = PIXEL(src[3], src[2], src[1], src[0]);
+			} else {
+				for (size_t i = 0; i < n; i++, src += 4)
+					dst[i] = PIXEL(255, src[2], src[1], src[0]);
 			}
+			break;
 		}
-		break;
-	case IMG_GRAY:
-		for (sysarg_t y = tga.starty; y < theight; y++) {
-			for (sysarg_t x = tga.startx; x < twidth; x++) {
-				size_t offset =
-				    (y - tga.starty) * tga.width + (x - tga.startx);
-
-				pixel_t pixel =
-				    gray_8_2pixel(((uint8_t *) tga.img_data) + offset);
-				surface_put_pixel(surface, x, theight - y - 1, pixel);
+
+		dec->col += n;
+		count -= n;
+		tga_end_row(dec);
+	}
+}
+
+/** Decode pixel data
+ *
+ * @param dec  Decoder.
+ * @param src  Encoded data.
+ * @param size Size of the encoded data (in bytes).
+ *
+ * @return Number of bytes consumed.
+ *
+ */
+static size_t tga_decode_pixels(tga_decoder_t *dec, const uint8_t *src,
+    size_t size)
+{
+	size_t left = size;
+
+	while ((left > 0) && (dec->stage == TGA_STAGE_PIXELS)) {
+		if (dec->packet_left == 0) {
+			/* Only reached for RLE data */
+			dec->packet_repeat = (*src & RLE_REPEAT) != 0;
+			dec->packet_left = (*src & RLE_COUNT_MASK) + 1;
+			src++;
+			left--;
+			continue;
+		}
+
+		if ((dec->pixel_fill > 0) || (left < dec->pixel_size)) {
+			/* Pixel split across input chunks */
+			size_t n = dec->pixel_size - dec->pixel_fill;
+			if (n > left)
+				n = left;
+
+			memcpy(dec->pixel + dec->pixel_fill, src, n);
+			dec->pixel_fill += n;
+			src += n;
+			left -= n;
+
+			if (dec->pixel_fill < dec->pixel_size)
+				break;
+
+			dec->pixel_fill = 0;
+
+			size_t count = dec->packet_repeat ? dec->packet_left : 1;
+			tga_fill(dec, tga_pixel(dec, dec->pixel), count);
+			dec->packet_left -= count;
+			continue;
+		}
+
+		if (dec->packet_repeat) {
+			tga_fill(dec, tga_pixel(dec, src), dec->packet_left);
+			src += dec->pixel_size;
+			left -= dec->pixel_size;
+			dec->packet_left = 0;
+			continue;
+		}
+
+		size_t count = left / dec->pixel_size;
+		if (count > dec->packet_left)
+			count = dec->packet_left;
+
+		tga_put(dec, src, count);
+		src += count * dec->pixel_size;
+		left -= count * dec->pixel_size;
+		dec->packet_left -= count;
+	}
+
+	return size - left;
+}
+
+/** Feed encoded data to incremental TGA decoder
+ *
+ * @param dec  Decoder.
+ * @param data Next chunk of the memory representation of TGA.
+ * @param size Size of the chunk (in bytes).
+ *
+ * @return EOK on success.
+ * @return ENOTSUP on unsupported format.
+ * @return ENOMEM if out of memory.
+ *
+ */
+errno_t tga_decoder_feed(tga_decoder_t *dec, const void *data, size_t size)
+{
+	const uint8_t *src = (const uint8_t *) data;
+
+	while (size > 0) {
+		size_t n;
+
+		switch (dec->stage) {
+		case TGA_STAGE_HEADER:
+			n = sizeof(tga_header_t) - dec->header_fill;
+			if (n > size)
+				n = size;
+
+			memcpy(dec->header + dec->header_fill, src, n);
+			dec->header_fill += n;
+
+			if (dec->header_fill == sizeof(tga_header_t)) {
+				errno_t rc = tga_decoder_start(dec);
+				if (rc != EOK)
+					return rc;
 			}
+			break;
+		case TGA_STAGE_SKIP:
+			n = dec->skip;
+			if (n > size)
+				n = size;
+
+			dec->skip -= n;
+			break;
+		case TGA_STAGE_PIXELS:
+			n = tga_decode_pixels(dec, src, size);
+			break;
+		case TGA_STAGE_DONE:
+		default:
+			/* Ignore trailing data (footer, extension area) */
+			return EOK;
+		}
+
+		src += n;
+		size -= n;
+
+		if ((dec->stage == TGA_STAGE_SKIP) && (dec->skip == 0)) {
+			dec->stage = TGA_STAGE_PIXELS;
+			tga_start_row(dec);
 		}
-		break;
-	default:
-		break;
 	}
 
+	return EOK;
+}
+
+/** Sink adapter for tga_decoder_feed()
+ *
+ * @param arg  Decoder.
+ * @param data Next chunk of the memory representation of TGA.
+ * @param size Size of the chunk (in bytes).
+ *
+ * @return Result of tga_decoder_feed().
+ *
+ */
+errno_t tga_decoder_sink(void *arg, const void *data, size_t size)
+{
+	return tga_decoder_feed((tga_decoder_t *) arg, data, size);
+}
+
+/** Finish incremental TGA decoding
+ *
+ * The decoder is destroyed.
+ *
+ * @param dec Decoder.
+ *
+ * @return Newly allocated surface with the decoded content.
+ * @return NULL if the image data was incomplete.
+ *
+ */
+surface_t *tga_decoder_finish(tga_decoder_t *dec)
+{
+	surface_t *surface = dec->surface;
+
+	if (dec->stage != TGA_STAGE_DONE) {
+		if (surface != NULL)
+			surface_destroy(surface);
+
+		surface = NULL;
+	} else {
+		surface_add_damaged_region(surface, dec->tga.startx, 0,
+		    dec->tga.width, dec->tga.height);
+	}
+
+	free(dec);
 	return surface;
 }
 
+/** Decode Truevision TGA format
+ *
+ * Decode Truevision TGA format and create a surface
+ * from it. The supported variants of TGA are currently
+ * limited to uncompressed or RLE compressed 24 bit and
+ * 32 bit true-color images (with optional 8 bit alpha
+ * channel) and 8 bit gray-scale images.
+ *
+ * @param[in] data  Memory representation of TGA.
+ * @param[in] size  Size of the representation (in bytes).
+ * @param[in] flags Surface creation flags.
+ *
+ * @return Newly allocated surface with the decoded content.
+ * @return NULL on error or unsupported format.
+ *
+ */
+surface_t *decode_tga(void *data, size_t size, surface_flags_t flags)
+{
+	tga_decoder_t *dec = tga_decoder_create(flags);
+	if (dec == NULL)
+		return NULL;
+
+	(void) tga_decoder_feed(dec, data, size);
+	return tga_decoder_finish(dec);
+}
+
 /** Encode Truevision TGA format
  *
  * Encode Truevision TGA format into an array.
@@ -35,7 +35,6 @@
 
 #include <errno.h>
 #include <gzip.h>
-#include <stdlib.h>
 #include "tga.gz.h"
 #include "tga.h"
 
@@ -45,6 +44,9 @@
  * from it. The supported variants of TGA are limited those
  * supported by decode_tga().
  *
+ * The data is decoded while it is being decompressed, the
+ * uncompressed TGA is never held in memory as a whole.
+ *
  * @param[in] data  Memory representation of gzipped TGA.
  * @param[in] size  Size of the representation (in bytes).
  * @param[in] flags Surface creation flags.
@@ -55,17 +57,12 @@
  */
 surface_t *decode_tga_gz(void *data, size_t size, surface_flags_t flags)
 {
-	void *data_expanded;
-	size_t size_expanded;
-
-	errno_t ret = gzip_expand(data, size, &data_expanded, &size_expanded);
-	if (ret != EOK)
+	tga_decoder_t *dec = tga_decoder_create(flags);
+	if (dec == NULL)
 		return NULL;
 
-	surface_t *surface = decode_tga(data_expanded, size_expanded, flags);
-
-	free(data_expanded);
-	return surface;
+	(void) gzip_expand_stream(data, size, tga_decoder_sink, dec);
+	return tga_decoder_finish(dec);
 }
 
 /** Encode gzipped Truevision TGA format
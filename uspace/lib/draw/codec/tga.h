@@ -38,8 +38,17 @@
 #define DRAW_CODEC_TGA_H_
 
 #include <stddef.h>
+#include <errno.h>
 #include "../surface.h"
 
+struct tga_decoder;
+typedef struct tga_decoder tga_decoder_t;
+
+extern tga_decoder_t *tga_decoder_create(surface_flags_t);
+extern errno_t tga_decoder_feed(tga_decoder_t *, const void *, size_t);
+extern errno_t tga_decoder_sink(void *, const void *, size_t);
+extern surface_t *tga_decoder_finish(tga_decoder_t *);
+
 extern surface_t *decode_tga(void *, size_t, surface_flags_t);
 extern bool encode_tga(surface_t *, void **, size_t *);
 
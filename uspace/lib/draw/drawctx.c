@@ -35,9 +35,12 @@
 
 #include <assert.h>
 #include <adt/list.h>
+#include <macros.h>
+#include <mem.h>
 #include <stdlib.h>
 
 #include "drawctx.h"
+#include "raster.h"
 
 void drawctx_init(drawctx_t *context, surface_t *surface)
 {
@@ -121,6 +124,37 @@ void drawctx_set_font(drawctx_t *context, font_t *font)
 	context->font = font;
 }
 
+/** Number of pixels composed at once by drawctx_transfer(). */
+#define TRANSFER_SPAN  256
+
+/** Transfer pixels one by one, honoring the clipping and the mask. */
+static void drawctx_transfer_pixels(drawctx_t *context,
+    sysarg_t x, sysarg_t y, sysarg_t width, sysarg_t height)
+{
+	bool clipped = false;
+	bool masked = false;
+	for (sysarg_t _y = y; _y < y + height; ++_y) {
+		for (sysarg_t _x = x; _x < x + width; ++_x) {
+			if (context->shall_clip) {
+				clipped = _x < context->clip_x && _x >= context->clip_width &&
+				    _y < context->clip_y && _y >= context->clip_height;
+			}
+
+			if (context->mask) {
+				pixel_t p = surface_get_pixel(context->mask, _x, _y);
+				masked = p > 0 ? false : true;
+			}
+
+			if (!clipped && !masked) {
+				pixel_t p_src = source_determine_pixel(context->source, _x, _y);
+				pixel_t p_dst = surface_get_pixel(context->surface, _x, _y);
+				pixel_t p_res = context->compose(p_src, p_dst);
+				surface_put_pixel(context->surface, _x, _y, p_res);
+			}
+		}
+	}
+}
+
 void drawctx_transfer(drawctx_t *context,
     sysarg_t x, sysarg_t y, sysarg_t width, sysarg_t height)
 {
@@ -139,39 +173,167 @@ void drawctx_transfer(drawctx_t *context,
 			pixel_t *src = source_direct_access(context->source, x, _y);
 			pixel_t *dst = pixelmap_pixel_at(surface_pixmap_access(context->surface), x, _y);
 			if (src && dst) {
-				sysarg_t count = width;
-				while (count-- != 0) {
-					*dst++ = *src++;
-				}
+				memcpy(dst, src, width * sizeof(pixel_t));
 			}
 		}
 		surface_add_damaged_region(context->surface, x, y, width, height);
+		return;
+	}
 
-	} else {
+	compose_span_t compose_span_fn = compose_span(context->compose);
+	if (context->shall_clip || context->mask || !compose_span_fn) {
+		drawctx_transfer_pixels(context, x, y, width, height);
+		return;
+	}
 
-		bool clipped = false;
-		bool masked = false;
-		for (sysarg_t _y = y; _y < y + height; ++_y) {
-			for (sysarg_t _x = x; _x < x + width; ++_x) {
-				if (context->shall_clip) {
-					clipped = _x < context->clip_x && _x >= context->clip_width &&
-					    _y < context->clip_y && _y >= context->clip_height;
-				}
+	/* Compose whole spans of the destination rows. */
+	pixelmap_t *pixmap = surface_pixmap_access(context->surface);
+	if (x >= pixmap->width || y >= pixmap->height)
+		return;
+	if (width > pixmap->width - x)
+		width = pixmap->width - x;
+	if (height > pixmap->height - y)
+		height = pixmap->height - y;
+
+	pixel_t buf[TRANSFER_SPAN];
+	for (sysarg_t _y = y; _y < y + height; ++_y) {
+		pixel_t *dst = pixelmap_pixel_at(pixmap, x, _y);
+		for (sysarg_t done = 0; done < width; done += TRANSFER_SPAN) {
+			size_t count = min(width - done, TRANSFER_SPAN);
+			const pixel_t *src = source_determine_span(context->source,
+			    x + done, _y, count, buf);
+			compose_span_fn(dst + done, src, count);
+		}
+	}
+
+	if (width > 0 && height > 0)
+		surface_add_damaged_region(context->surface, x, y, width, height);
+}
+
+/** Width of stroked lines in pixels. */
+#define STROKE_WIDTH  1.0
+
+/** Composition of rasterized spans. */
+typedef struct {
+	drawctx_t *context;
+	pixelmap_t *pixmap;
+	/** Span variant of the compose function or NULL for per-pixel transfer */
+	compose_span_t compose_span_fn;
+	/** Blend partially covered pixels instead of thresholding them */
+	bool antialias;
+	/** Bounding box of the composed spans */
+	bool damaged;
+	sysarg_t dmg_x1;
+	sysarg_t dmg_y1;
+	sysarg_t dmg_x2;
+	sysarg_t dmg_y2;
+} drawctx_raster_t;
+
+/** Compose one span of rasterized coverage.
+ *
+ * Wholly covered runs go straight to the span compose function. Partially
+ * covered pixels get their source alpha scaled by the coverage and are
+ * composed over the destination. Where that would not be meaningful, or
+ * with a mask, pixels at least half covered are transferred as they are.
+ */
+static void drawctx_raster_span(void *arg, sysarg_t x, sysarg_t y,
+    size_t count, const uint8_t *coverage)
+{
+	drawctx_raster_t *dr = (drawctx_raster_t *) arg;
+	drawctx_t *context = dr->context;
+	pixel_t buf[TRANSFER_SPAN];
+	pixel_t blend[TRANSFER_SPAN];
+	size_t i = 0;
+
+	while (i < count) {
+		bool full = coverage[i] == 255;
+		size_t end = i + 1;
+		while (end < count && end - i < TRANSFER_SPAN &&
+		    (coverage[end] == 255) == full)
+			end++;
+
+		size_t n = end - i;
+
+		if (dr->compose_span_fn == NULL) {
+			for (size_t j = i; j < end; j++) {
+				if (coverage[j] >= 128)
+					drawctx_transfer_pixels(context, x + j, y, 1, 1);
+			}
+		} else {
+			pixel_t *dst = pixelmap_pixel_at(dr->pixmap, x + i, y);
+			const pixel_t *src = source_determine_span(context->source,
+			    x + i, y, n, buf);
 
-				if (context->mask) {
-					pixel_t p = surface_get_pixel(context->mask, _x, _y);
-					masked = p > 0 ? false : true;
+			if (full) {
+				dr->compose_span_fn(dst, src, n);
+			} else if (dr->antialias) {
+				for (size_t j = 0; j < n; j++) {
+					pixel_t p = src[j];
+					blend[j] = PIXEL(ALPHA(p) * coverage[i + j] / 255,
+					    RED(p), GREEN(p), BLUE(p));
 				}
 
-				if (!clipped && !masked) {
-					pixel_t p_src = source_determine_pixel(context->source, _x, _y);
-					pixel_t p_dst = surface_get_pixel(context->surface, _x, _y);
-					pixel_t p_res = context->compose(p_src, p_dst);
-					surface_put_pixel(context->surface, _x, _y, p_res);
+				compose_span_over(dst, blend, n);
+			} else {
+				for (size_t j = 0; j < n; j++) {
+					if (coverage[i + j] >= 128)
+						dr->compose_span_fn(dst + j, src + j, 1);
 				}
 			}
 		}
 
+		i = end;
+	}
+
+	if (!dr->damaged) {
+		dr->dmg_x1 = x;
+		dr->dmg_y1 = y;
+		dr->dmg_x2 = x + count;
+		dr->dmg_y2 = y + 1;
+		dr->damaged = true;
+	} else {
+		dr->dmg_x1 = min(dr->dmg_x1, x);
+		dr->dmg_y1 = min(dr->dmg_y1, y);
+		dr->dmg_x2 = max(dr->dmg_x2, x + count);
+		dr->dmg_y2 = max(dr->dmg_y2, y + 1);
+	}
+}
+
+/** Render rasterized polygon with the current source. */
+static void drawctx_rasterize(drawctx_t *context, raster_t *raster)
+{
+	drawctx_raster_t dr;
+	sysarg_t x1, y1, x2, y2;
+
+	dr.context = context;
+	dr.pixmap = surface_pixmap_access(context->surface);
+	dr.compose_span_fn = context->mask ? NULL :
+	    compose_span(context->compose);
+	dr.antialias = dr.compose_span_fn == compose_span_src ||
+	    dr.compose_span_fn == compose_span_over;
+	dr.damaged = false;
+
+	/* Clip to the surface and the clipping rectangle. */
+	x1 = 0;
+	y1 = 0;
+	x2 = dr.pixmap->width;
+	y2 = dr.pixmap->height;
+	if (context->shall_clip) {
+		x1 = max(x1, context->clip_x);
+		y1 = max(y1, context->clip_y);
+		x2 = min(x2, context->clip_x + context->clip_width);
+		y2 = min(y2, context->clip_y + context->clip_height);
+	}
+
+	if (x1 >= x2 || y1 >= y2)
+		return;
+
+	(void) raster_render(raster, x1, y1, x2 - x1, y2 - y1,
+	    drawctx_raster_span, &dr);
+
+	if (dr.damaged) {
+		surface_add_damaged_region(context->surface, dr.dmg_x1,
+		    dr.dmg_y1, dr.dmg_x2 - dr.dmg_x1, dr.dmg_y2 - dr.dmg_y1);
 	}
 }
 
@@ -181,26 +343,35 @@ void drawctx_stroke(drawctx_t *context, path_t *path)
 		return;
 	}
 
-	/*
-	 * Note:
-	 * Antialiasing could be achieved by up-scaling path coordinates and
-	 * rendering into temporary higher-resolution surface. Then, the temporary
-	 * surface would be set as a source and its damaged region would be
-	 * transferred to the original surface.
-	 */
+	raster_t raster;
+	double cur_x = 0;
+	double cur_y = 0;
+	errno_t rc = EOK;
+
+	raster_init(&raster);
 
 	list_foreach(*((list_t *) path), link, path_step_t, step) {
 		switch (step->type) {
 		case PATH_STEP_MOVETO:
-			// TODO
 			break;
 		case PATH_STEP_LINETO:
-			// TODO
+			if (rc == EOK) {
+				rc = raster_add_stroke(&raster, cur_x, cur_y,
+				    step->to_x, step->to_y, STROKE_WIDTH);
+			}
 			break;
 		default:
 			break;
 		}
+
+		cur_x = step->to_x;
+		cur_y = step->to_y;
 	}
+
+	if (rc == EOK)
+		drawctx_rasterize(context, &raster);
+
+	raster_fini(&raster);
 }
 
 void drawctx_fill(drawctx_t *context, path_t *path)
@@ -209,7 +380,47 @@ void drawctx_fill(drawctx_t *context, path_t *path)
 		return;
 	}
 
-	// TODO
+	raster_t raster;
+	double start_x = 0;
+	double start_y = 0;
+	double cur_x = 0;
+	double cur_y = 0;
+	errno_t rc = EOK;
+
+	raster_init(&raster);
+
+	/* Every subpath is closed implicitly. */
+	list_foreach(*((list_t *) path), link, path_step_t, step) {
+		switch (step->type) {
+		case PATH_STEP_MOVETO:
+			if (rc == EOK) {
+				rc = raster_add_line(&raster, cur_x, cur_y,
+				    start_x, start_y);
+			}
+			start_x = step->to_x;
+			start_y = step->to_y;
+			break;
+		case PATH_STEP_LINETO:
+			if (rc == EOK) {
+				rc = raster_add_line(&raster, cur_x, cur_y,
+				    step->to_x, step->to_y);
+			}
+			break;
+		default:
+			break;
+		}
+
+		cur_x = step->to_x;
+		cur_y = step->to_y;
+	}
+
+	if (rc == EOK)
+		rc = raster_add_line(&raster, cur_x, cur_y, start_x, start_y);
+
+	if (rc == EOK)
+		drawctx_rasterize(context, &raster);
+
+	raster_fini(&raster);
 }
 
 void drawctx_print(drawctx_t *context, const char *text, sysarg_t x, sysarg_t y)
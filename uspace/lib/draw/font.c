@@ -37,6 +37,8 @@
 #include <errno.h>
 #include <stdlib.h>
 #include <str.h>
+#include <macros.h>
+#include <compose.h>
 
 #include "font.h"
 #include "font/embedded.h"
@@ -83,6 +85,15 @@ errno_t font_render_glyph(font_t *font, drawctx_t *context, source_t *source,
 	    x, y, glyph_id);
 }
 
+errno_t font_get_glyph_mask(font_t *font, glyph_id_t glyph_id,
+    glyph_mask_t *mask)
+{
+	if (font->backend->get_glyph_mask == NULL)
+		return ENOTSUP;
+
+	return font->backend->get_glyph_mask(font->backend_data, glyph_id, mask);
+}
+
 /* TODO this is bad interface */
 errno_t font_get_box(font_t *font, char *text, sysarg_t *width, sysarg_t *height)
 {
@@ -121,6 +132,9 @@ errno_t font_get_box(font_t *font, char *text, sysarg_t *width, sysarg_t *height
 	return EOK;
 }
 
+/** Number of glyph pixels composed at once by font_draw_text(). */
+#define TEXT_SPAN  64
+
 /* TODO this is bad interface */
 errno_t font_draw_text(font_t *font, drawctx_t *context, source_t *source,
     const char *text, sysarg_t sx, sysarg_t sy)
@@ -136,6 +150,21 @@ errno_t font_draw_text(font_t *font, drawctx_t *context, source_t *source,
 	native_t baseline = sy + fm.ascender;
 	native_t x = sx;
 
+	/*
+	 * Plain colored text is composed directly from the cached glyph masks
+	 * and the whole run is reported as a single damaged region.
+	 */
+	bool use_masks = (source->texture == NULL) && (context->mask == NULL) &&
+	    (!context->shall_clip) && (font->backend->get_glyph_mask != NULL);
+	pixelmap_t *pixmap = surface_pixmap_access(context->surface);
+	compose_span_t compose_span_fn = compose_span(compose_over);
+	pixel_t color = source->color;
+	bool damaged = false;
+	native_t dmg_x1 = 0;
+	native_t dmg_y1 = 0;
+	native_t dmg_x2 = 0;
+	native_t dmg_y2 = 0;
+
 	size_t off = 0;
 	while (true) {
 		wchar_t c = str_decode(text, &off, STR_NO_LIMIT);
@@ -156,15 +185,71 @@ errno_t font_draw_text(font_t *font, drawctx_t *context, source_t *source,
 		if (rc != EOK)
 			return rc;
 
-		rc = font_render_glyph(font, context, source, x, baseline,
-		    glyph_id);
-		if (rc != EOK)
-			return rc;
+		glyph_mask_t mask;
+		if ((use_masks) &&
+		    (font_get_glyph_mask(font, glyph_id, &mask) == EOK)) {
+			native_t gx = x + glyph_metrics.left_side_bearing;
+			native_t gy = baseline - glyph_metrics.ascender;
+			native_t gw = min(mask.width, (sysarg_t) glyph_metrics.width);
+			native_t gh = min(mask.height, (sysarg_t) glyph_metrics.height);
+
+			/* Clip the glyph to the surface. */
+			native_t x1 = max(gx, 0);
+			native_t y1 = max(gy, 0);
+			native_t x2 = min(gx + gw, (native_t) pixmap->width);
+			native_t y2 = min(gy + gh, (native_t) pixmap->height);
+
+			for (native_t py = y1; py < y2; py++) {
+				const uint8_t *alpha = mask.alpha + (py - gy) * mask.width;
+				pixel_t *dst = pixelmap_pixel_at(pixmap, x1, py);
+
+				for (native_t px = x1; px < x2; px += TEXT_SPAN) {
+					size_t count = min(x2 - px, TEXT_SPAN);
+					pixel_t span[TEXT_SPAN];
+
+					for (size_t i = 0; i < count; i++) {
+						unsigned int a = alpha[px - gx + i];
+						if (a == 255)
+							span[i] = color;
+						else
+							span[i] = PIXEL(a * ALPHA(color) / 255,
+							    RED(color), GREEN(color), BLUE(color));
+					}
+
+					compose_span_fn(dst + (px - x1), span, count);
+				}
+			}
+
+			if ((x1 < x2) && (y1 < y2)) {
+				if (!damaged) {
+					dmg_x1 = x1;
+					dmg_y1 = y1;
+					dmg_x2 = x2;
+					dmg_y2 = y2;
+					damaged = true;
+				} else {
+					dmg_x1 = min(dmg_x1, x1);
+					dmg_y1 = min(dmg_y1, y1);
+					dmg_x2 = max(dmg_x2, x2);
+					dmg_y2 = max(dmg_y2, y2);
+				}
+			}
+		} else {
+			rc = font_render_glyph(font, context, source, x, baseline,
+			    glyph_id);
+			if (rc != EOK)
+				return rc;
+		}
 
 		x += glyph_metrics_get_advancement(&glyph_metrics);
 
 	}
 
+	if (damaged) {
+		surface_add_damaged_region(context->surface, dmg_x1, dmg_y1,
+		    dmg_x2 - dmg_x1, dmg_y2 - dmg_y1);
+	}
+
 	drawctx_restore(context);
 	source_set_mask(source, NULL, false);
 
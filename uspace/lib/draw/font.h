@@ -93,12 +93,21 @@ typedef struct {
 
 typedef uint32_t glyph_id_t;
 
+/** Pre-rasterized glyph coverage, one alpha value per pixel. */
+typedef struct {
+	sysarg_t width;
+	sysarg_t height;
+	const uint8_t *alpha;
+} glyph_mask_t;
+
 typedef struct {
 	errno_t (*get_font_metrics)(void *, font_metrics_t *);
 	errno_t (*resolve_glyph)(void *, wchar_t, glyph_id_t *);
 	errno_t (*get_glyph_metrics)(void *, glyph_id_t, glyph_metrics_t *);
 	errno_t (*render_glyph)(void *, drawctx_t *, source_t *, sysarg_t,
 	    sysarg_t, glyph_id_t);
+	/* Optional, lets plain colored text bypass render_glyph */
+	errno_t (*get_glyph_mask)(void *, glyph_id_t, glyph_mask_t *);
 	void (*release)(void *);
 } font_backend_t;
 
@@ -113,6 +122,7 @@ extern errno_t font_resolve_glyph(font_t *, wchar_t, glyph_id_t *);
 extern errno_t font_get_glyph_metrics(font_t *, glyph_id_t, glyph_metrics_t *);
 extern errno_t font_render_glyph(font_t *, drawctx_t *, source_t *,
     sysarg_t, sysarg_t, glyph_id_t);
+extern errno_t font_get_glyph_mask(font_t *, glyph_id_t, glyph_mask_t *);
 extern void font_release(font_t *);
 
 extern errno_t font_get_box(font_t *, char *, sysarg_t *, sysarg_t *);
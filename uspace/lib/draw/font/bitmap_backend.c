@@ -43,6 +43,7 @@
 
 typedef struct {
 	surface_t *surface;
+	uint8_t *mask;
 	glyph_metrics_t metrics;
 	bool metrics_loaded;
 } glyph_cache_item_t;
@@ -136,6 +137,7 @@ static errno_t get_glyph_surface(bitmap_backend_data_t *data, glyph_id_t glyph_i
 	surface_get_resolution(raw_surface, &w, &h);
 
 	if (!data->scale) {
+		data->glyph_cache[glyph_id].surface = raw_surface;
 		*result = raw_surface;
 		return EOK;
 	}
@@ -201,6 +203,42 @@ static errno_t bb_render_glyph(void *backend_data, drawctx_t *context,
 	return EOK;
 }
 
+static errno_t bb_get_glyph_mask(void *backend_data, glyph_id_t glyph_id,
+    glyph_mask_t *mask)
+{
+	bitmap_backend_data_t *data = (bitmap_backend_data_t *) backend_data;
+
+	surface_t *glyph_surface;
+	errno_t rc = get_glyph_surface(data, glyph_id, &glyph_surface);
+	if (rc != EOK)
+		return rc;
+
+	sysarg_t w;
+	sysarg_t h;
+	surface_get_resolution(glyph_surface, &w, &h);
+
+	/* Keep only the alpha of the rendered glyph. */
+	if (data->glyph_cache[glyph_id].mask == NULL) {
+		uint8_t *alpha = malloc(w * h);
+		if (alpha == NULL)
+			return ENOMEM;
+
+		for (sysarg_t y = 0; y < h; ++y) {
+			for (sysarg_t x = 0; x < w; ++x) {
+				alpha[y * w + x] =
+				    ALPHA(surface_get_pixel(glyph_surface, x, y));
+			}
+		}
+
+		data->glyph_cache[glyph_id].mask = alpha;
+	}
+
+	mask->width = w;
+	mask->height = h;
+	mask->alpha = data->glyph_cache[glyph_id].mask;
+	return EOK;
+}
+
 static void bb_release(void *backend_data)
 {
 	bitmap_backend_data_t *data = (bitmap_backend_data_t *) backend_data;
@@ -209,6 +247,8 @@ static void bb_release(void *backend_data)
 		if (data->glyph_cache[i].surface) {
 			surface_destroy(data->glyph_cache[i].surface);
 		}
+
+		free(data->glyph_cache[i].mask);
 	}
 	free(data->glyph_cache);
 
@@ -220,6 +260,7 @@ font_backend_t bitmap_backend = {
 	.resolve_glyph = bb_resolve_glyph,
 	.get_glyph_metrics = bb_get_glyph_metrics,
 	.render_glyph = bb_render_glyph,
+	.get_glyph_mask = bb_get_glyph_mask,
 	.release = bb_release
 };
 
@@ -264,6 +305,7 @@ errno_t bitmap_font_create(bitmap_font_decoder_t *decoder, void *decoder_data,
 
 	for (size_t i = 0; i < data->glyph_count; ++i) {
 		data->glyph_cache[i].surface = NULL;
+		data->glyph_cache[i].mask = NULL;
 		data->glyph_cache[i].metrics_loaded = false;
 	}
 
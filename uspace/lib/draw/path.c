@@ -44,6 +44,21 @@ struct path {
 	double cur_y;
 };
 
+path_t *path_create(void)
+{
+	path_t *path = (path_t *) malloc(sizeof(path_t));
+	if (path)
+		path_init(path);
+
+	return path;
+}
+
+void path_destroy(path_t *path)
+{
+	path_clear(path);
+	free(path);
+}
+
 void path_init(path_t *path)
 {
 	list_initialize(&path->list);
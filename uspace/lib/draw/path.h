@@ -53,6 +53,9 @@ typedef struct {
 struct path;
 typedef struct path path_t;
 
+extern path_t *path_create(void);
+extern void path_destroy(path_t *);
+
 extern void path_init(path_t *);
 extern void path_clear(path_t *);
 
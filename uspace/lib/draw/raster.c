@@ -0,0 +1,406 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup draw
+ * @{
+ */
+/**
+ * @file
+ * @brief Scanline polygon rasterizer.
+ *
+ * Polygons are kept as a list of non-horizontal edges and filled with the
+ * non-zero winding rule. The edges are sorted by their top end and swept
+ * by an active edge table, RASTER_SUBSAMPLES sub-scanlines per row of
+ * pixels. The horizontal extent of each interval covered on a sub-scanline
+ * is accumulated exactly, with partial pixels at both ends and a running
+ * sum for the pixels in between, so a row costs time proportional to the
+ * number of edges crossing it and to its width, never to the area of the
+ * polygon times the number of samples.
+ *
+ * The coverage of each row is handed over as spans of pixels with non-zero
+ * coverage, leaving the composition to the caller.
+ */
+
+#include <macros.h>
+#include <math.h>
+#include <mem.h>
+#include <stdlib.h>
+
+#include "raster.h"
+
+/** Number of sub-scanlines per row of pixels */
+#define RASTER_SUBSAMPLES  4
+
+/** Coverage of a whole pixel by one sub-scanline */
+#define RASTER_UNIT  (256 / RASTER_SUBSAMPLES)
+
+/** Initial number of edges allocated */
+#define RASTER_EDGES_INIT  16
+
+/** Edge crossing a sub-scanline. */
+typedef struct {
+	double x;
+	int dir;
+} raster_cross_t;
+
+void raster_init(raster_t *raster)
+{
+	raster->edges = NULL;
+	raster->size = 0;
+	raster_clear(raster);
+}
+
+void raster_fini(raster_t *raster)
+{
+	free(raster->edges);
+	raster->edges = NULL;
+	raster->size = 0;
+	raster->count = 0;
+}
+
+/** Remove all edges, keeping the memory for reuse. */
+void raster_clear(raster_t *raster)
+{
+	raster->count = 0;
+	raster->x_min = 0;
+	raster->y_min = 0;
+	raster->x_max = 0;
+	raster->y_max = 0;
+}
+
+/** Add polygon edge.
+ *
+ * @param raster Rasterizer.
+ * @param x0     X coordinate of the starting point.
+ * @param y0     Y coordinate of the starting point.
+ * @param x1     X coordinate of the ending point.
+ * @param y1     Y coordinate of the ending point.
+ *
+ * @return EOK on success or ENOMEM.
+ */
+errno_t raster_add_line(raster_t *raster, double x0, double y0, double x1,
+    double y1)
+{
+	/* Horizontal edges never cross a sub-scanline. */
+	if (y0 == y1)
+		return EOK;
+
+	if (raster->count == raster->size) {
+		size_t nsize = raster->size > 0 ?
+		    2 * raster->size : RASTER_EDGES_INIT;
+		raster_edge_t *nedges = realloc(raster->edges,
+		    nsize * sizeof(raster_edge_t));
+		if (nedges == NULL)
+			return ENOMEM;
+
+		raster->edges = nedges;
+		raster->size = nsize;
+	}
+
+	if (raster->count == 0) {
+		raster->x_min = raster->x_max = x0;
+		raster->y_min = raster->y_max = y0;
+	}
+
+	raster->x_min = min(raster->x_min, min(x0, x1));
+	raster->x_max = max(raster->x_max, max(x0, x1));
+	raster->y_min = min(raster->y_min, min(y0, y1));
+	raster->y_max = max(raster->y_max, max(y0, y1));
+
+	raster_edge_t *edge = &raster->edges[raster->count++];
+	edge->dxdy = (x1 - x0) / (y1 - y0);
+	if (y0 < y1) {
+		edge->y_top = y0;
+		edge->y_bottom = y1;
+		edge->x_top = x0;
+		edge->dir = 1;
+	} else {
+		edge->y_top = y1;
+		edge->y_bottom = y0;
+		edge->x_top = x1;
+		edge->dir = -1;
+	}
+
+	return EOK;
+}
+
+/** Add stroke of a line segment.
+ *
+ * The segment is widened to a rectangle of the given width, extended by
+ * half the width beyond both ends so that consecutive segments join without
+ * gaps. All the rectangles have the same orientation, so overlapping ones
+ * merge under the non-zero winding rule.
+ *
+ * @param raster Rasterizer.
+ * @param x0     X coordinate of the starting point.
+ * @param y0     Y coordinate of the starting point.
+ * @param x1     X coordinate of the ending point.
+ * @param y1     Y coordinate of the ending point.
+ * @param width  Width of the stroke.
+ *
+ * @return EOK on success or ENOMEM.
+ */
+errno_t raster_add_stroke(raster_t *raster, double x0, double y0, double x1,
+    double y1, double width)
+{
+	double dx = x1 - x0;
+	double dy = y1 - y0;
+	double len = sqrt(dx * dx + dy * dy);
+	double ux, uy;
+
+	if (len > 0) {
+		ux = dx * width / (2 * len);
+		uy = dy * width / (2 * len);
+	} else {
+		/* Square dot */
+		ux = width / 2;
+		uy = 0;
+	}
+
+	/* Corners of the rectangle */
+	double ax = x0 - ux - uy;
+	double ay = y0 - uy + ux;
+	double bx = x1 + ux - uy;
+	double by = y1 + uy + ux;
+	double cx = x1 + ux + uy;
+	double cy = y1 + uy - ux;
+	double dx2 = x0 - ux + uy;
+	double dy2 = y0 - uy - ux;
+
+	errno_t rc = raster_add_line(raster, ax, ay, bx, by);
+	if (rc == EOK)
+		rc = raster_add_line(raster, bx, by, cx, cy);
+	if (rc == EOK)
+		rc = raster_add_line(raster, cx, cy, dx2, dy2);
+	if (rc == EOK)
+		rc = raster_add_line(raster, dx2, dy2, ax, ay);
+
+	return rc;
+}
+
+static int raster_edge_cmp(const void *a, const void *b)
+{
+	const raster_edge_t *ea = (const raster_edge_t *) a;
+	const raster_edge_t *eb = (const raster_edge_t *) b;
+
+	return (ea->y_top > eb->y_top) - (ea->y_top < eb->y_top);
+}
+
+/** Accumulate coverage of the interval [a, b) of one sub-scanline.
+ *
+ * @param area  Coverage of partially covered pixels.
+ * @param delta Changes of the running coverage of wholly covered pixels.
+ * @param width Width of the row.
+ * @param a     Start of the interval relative to the row.
+ * @param b     End of the interval relative to the row.
+ * @param touch Range of pixels touched so far, updated.
+ */
+static void raster_accumulate(int *area, int *delta, size_t width,
+    double a, double b, size_t touch[2])
+{
+	a = max(a, 0.0);
+	b = min(b, (double) width);
+	if (b <= a)
+		return;
+
+	size_t ia = (size_t) a;
+	size_t ib = (size_t) b;
+
+	if (ia == ib) {
+		area[ia] += (int) ((b - a) * RASTER_UNIT + 0.5);
+	} else {
+		area[ia] += (int) ((ia + 1 - a) * RASTER_UNIT + 0.5);
+		delta[ia + 1] += RASTER_UNIT;
+		delta[ib] -= RASTER_UNIT;
+		if (ib < width)
+			area[ib] += (int) ((b - ib) * RASTER_UNIT + 0.5);
+	}
+
+	touch[0] = min(touch[0], ia);
+	touch[1] = max(touch[1], min(ib + 1, width));
+}
+
+/** Render the polygon.
+ *
+ * Only the pixels inside the clipping rectangle are rendered.
+ *
+ * @param raster Rasterizer.
+ * @param clip_x Left edge of the clipping rectangle.
+ * @param clip_y Top edge of the clipping rectangle.
+ * @param clip_w Width of the clipping rectangle.
+ * @param clip_h Height of the clipping rectangle.
+ * @param span   Function receiving the rendered spans, row by row.
+ * @param arg    Argument passed to @a span.
+ *
+ * @return EOK on success or ENOMEM.
+ */
+errno_t raster_render(raster_t *raster, sysarg_t clip_x, sysarg_t clip_y,
+    sysarg_t clip_w, sysarg_t clip_h, raster_span_t span, void *arg)
+{
+	if (raster->count == 0 || clip_w == 0 || clip_h == 0)
+		return EOK;
+
+	if (raster->x_max <= clip_x || raster->x_min >= clip_x + clip_w ||
+	    raster->y_max <= clip_y || raster->y_min >= clip_y + clip_h)
+		return EOK;
+
+	/* Pixels the polygon can touch */
+	sysarg_t x0 = clip_x;
+	sysarg_t y0 = clip_y;
+	sysarg_t x1 = clip_x + clip_w;
+	sysarg_t y1 = clip_y + clip_h;
+
+	if (raster->x_min > x0)
+		x0 = (sysarg_t) raster->x_min;
+	if (raster->y_min > y0)
+		y0 = (sysarg_t) raster->y_min;
+	if (raster->x_max + 1 < x1)
+		x1 = (sysarg_t) raster->x_max + 1;
+	if (raster->y_max + 1 < y1)
+		y1 = (sysarg_t) raster->y_max + 1;
+
+	size_t width = x1 - x0;
+
+	int *area = calloc(2 * (width + 1), sizeof(int));
+	uint8_t *coverage = malloc(width);
+	size_t *active = malloc(raster->count * sizeof(size_t));
+	raster_cross_t *cross = malloc(raster->count * sizeof(raster_cross_t));
+
+	if (area == NULL || coverage == NULL || active == NULL ||
+	    cross == NULL) {
+		free(area);
+		free(coverage);
+		free(active);
+		free(cross);
+		return ENOMEM;
+	}
+
+	int *delta = area + width + 1;
+
+	qsort(raster->edges, raster->count, sizeof(raster_edge_t),
+	    raster_edge_cmp);
+
+	size_t next = 0;
+	size_t nactive = 0;
+
+	for (sysarg_t py = y0; py < y1; py++) {
+		size_t touch[2] = { width, 0 };
+
+		for (unsigned int s = 0; s < RASTER_SUBSAMPLES; s++) {
+			double y = py + (s + 0.5) / RASTER_SUBSAMPLES;
+
+			/* Activate edges starting above the sub-scanline. */
+			while (next < raster->count &&
+			    raster->edges[next].y_top <= y)
+				active[nactive++] = next++;
+
+			/*
+			 * Retire finished edges and find the crossings. The
+			 * crossings rarely change order between sub-scanlines,
+			 * so insertion sort is cheap.
+			 */
+			size_t ncross = 0;
+			size_t keep = 0;
+			for (size_t i = 0; i < nactive; i++) {
+				raster_edge_t *edge = &raster->edges[active[i]];
+				if (edge->y_bottom <= y)
+					continue;
+
+				active[keep++] = active[i];
+
+				double x = edge->x_top +
+				    (y - edge->y_top) * edge->dxdy;
+				size_t j = ncross++;
+				while (j > 0 && cross[j - 1].x > x) {
+					cross[j] = cross[j - 1];
+					j--;
+				}
+
+				cross[j].x = x;
+				cross[j].dir = edge->dir;
+			}
+
+			nactive = keep;
+
+			/* Fill intervals of non-zero winding. */
+			int wind = 0;
+			double start = 0;
+			for (size_t i = 0; i < ncross; i++) {
+				int prev = wind;
+				wind += cross[i].dir;
+
+				if (prev == 0 && wind != 0) {
+					start = cross[i].x;
+				} else if (prev != 0 && wind == 0) {
+					raster_accumulate(area, delta, width,
+					    start - x0, cross[i].x - x0, touch);
+				}
+			}
+		}
+
+		if (touch[0] >= touch[1])
+			continue;
+
+		/* Resolve the coverage and clear the accumulators. */
+		int run = 0;
+		for (size_t x = touch[0]; x < touch[1]; x++) {
+			run += delta[x];
+			int cov = run + area[x];
+			coverage[x] = (uint8_t) max(min(cov, 255), 0);
+			area[x] = 0;
+			delta[x] = 0;
+		}
+
+		delta[touch[1]] = 0;
+
+		/* Hand over the spans of covered pixels. */
+		size_t x = touch[0];
+		while (x < touch[1]) {
+			if (coverage[x] == 0) {
+				x++;
+				continue;
+			}
+
+			size_t end = x + 1;
+			while (end < touch[1] && coverage[end] != 0)
+				end++;
+
+			span(arg, x0 + x, py, end - x, coverage + x);
+			x = end;
+		}
+	}
+
+	free(area);
+	free(coverage);
+	free(active);
+	free(cross);
+	return EOK;
+}
+
+/** @}
+ */
@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup draw
+ * @{
+ */
+/**
+ * @file
+ */
+
+#ifndef DRAW_RASTER_H_
+#define DRAW_RASTER_H_
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <types/common.h>
+
+/** Polygon edge. */
+typedef struct {
+	/** Top end of the edge */
+	double y_top;
+	/** Bottom end of the edge */
+	double y_bottom;
+	/** X coordinate at the top end */
+	double x_top;
+	/** Change of X per unit of Y */
+	double dxdy;
+	/** Winding direction (+1 downwards, -1 upwards) */
+	int dir;
+} raster_edge_t;
+
+/** Scanline rasterizer. */
+typedef struct {
+	raster_edge_t *edges;
+	size_t count;
+	size_t size;
+	/** Bounding box of the edges */
+	double x_min;
+	double y_min;
+	double x_max;
+	double y_max;
+} raster_t;
+
+/** Receive a span of a rendered row.
+ *
+ * @param arg      Argument passed to raster_render().
+ * @param x        First pixel of the span.
+ * @param y        Row of the span.
+ * @param count    Number of pixels in the span.
+ * @param coverage Coverage of the pixels, 0 (outside) to 255 (inside).
+ */
+typedef void (*raster_span_t)(void *, sysarg_t, sysarg_t, size_t,
+    const uint8_t *);
+
+extern void raster_init(raster_t *);
+extern void raster_fini(raster_t *);
+extern void raster_clear(raster_t *);
+
+extern errno_t raster_add_line(raster_t *, double, double, double, double);
+extern errno_t raster_add_stroke(raster_t *, double, double, double, double,
+    double);
+
+extern errno_t raster_render(raster_t *, sysarg_t, sysarg_t, sysarg_t,
+    sysarg_t, raster_span_t, void *);
+
+#endif
+
+/** @}
+ */
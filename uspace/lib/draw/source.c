@@ -110,12 +110,9 @@ pixel_t *source_direct_access(source_t *source, double x, double y)
 	    surface_pixmap_access(source->texture), (sysarg_t) _x, (sysarg_t) _y);
 }
 
-pixel_t source_determine_pixel(source_t *source, double x, double y)
+/** Determine the source pixel at already transformed coordinates. */
+static pixel_t source_pixel_at(source_t *source, double x, double y)
 {
-	if (source->mask || source->texture) {
-		transform_apply_affine(&source->transform, &x, &y);
-	}
-
 	pixel_t mask_pix;
 	if (source->mask) {
 		mask_pix = source->filter(
@@ -148,5 +145,113 @@ pixel_t source_determine_pixel(source_t *source, double x, double y)
 	}
 }
 
+pixel_t source_determine_pixel(source_t *source, double x, double y)
+{
+	if (source->mask || source->texture) {
+		transform_apply_affine(&source->transform, &x, &y);
+	}
+
+	return source_pixel_at(source, x, y);
+}
+
+/** Determine a horizontal span of source pixels.
+ *
+ * Textures under an integer translation are read row by row without
+ * filtering, other sources are sampled at coordinates stepped along the
+ * transformed row.
+ *
+ * @param source Source to read.
+ * @param x      Horizontal coordinate of the first pixel.
+ * @param y      Vertical coordinate of the span.
+ * @param count  Number of pixels.
+ * @param buf    Buffer for @a count pixels.
+ *
+ * @return Pointer to @a count source pixels. It points either to @a buf
+ *         or directly to the texture if the source pixels are the texture
+ *         pixels.
+ */
+const pixel_t *source_determine_span(source_t *source, sysarg_t x,
+    sysarg_t y, size_t count, pixel_t *buf)
+{
+	if (!source->mask && !source->texture) {
+		pixel_t pix = source_pixel_at(source, x, y);
+		for (size_t i = 0; i < count; i++)
+			buf[i] = pix;
+		return buf;
+	}
+
+	/*
+	 * Both filters sample exactly the texture pixel at integer
+	 * coordinates.
+	 */
+	if (!source->mask && transform_is_fast(&source->transform) &&
+	    (source->filter == filter_nearest ||
+	    source->filter == filter_bilinear)) {
+		pixelmap_t *pixmap = surface_pixmap_access(source->texture);
+		native_t tx = (native_t) x +
+		    (native_t) source->transform.matrix[0][2];
+		native_t ty = (native_t) y +
+		    (native_t) source->transform.matrix[1][2];
+		unsigned alpha = ALPHA(source->alpha);
+
+		if (alpha == 0) {
+			for (size_t i = 0; i < count; i++)
+				buf[i] = 0;
+			return buf;
+		}
+
+		if (alpha == 255 && tx >= 0 && ty >= 0 &&
+		    (sysarg_t) ty < pixmap->height &&
+		    (sysarg_t) tx + count <= pixmap->width)
+			return pixelmap_pixel_at(pixmap, tx, ty);
+
+		for (size_t i = 0; i < count; i++) {
+			pixel_t pix = pixelmap_get_extended_pixel(pixmap,
+			    tx + (native_t) i, ty, source->texture_extend);
+			if (alpha < 255) {
+				pix = PIXEL(alpha * ALPHA(pix) / 255, RED(pix),
+				    GREEN(pix), BLUE(pix));
+			}
+			buf[i] = pix;
+		}
+
+		return buf;
+	}
+
+	/* Step along the row in the source coordinates. */
+	double sx = x;
+	double sy = y;
+	transform_apply_affine(&source->transform, &sx, &sy);
+	double dx = source->transform.matrix[0][0];
+	double dy = source->transform.matrix[1][0];
+
+	/* Scaled textures stay on one source row, filter them as a span. */
+	if (!source->mask && dy == 0) {
+		unsigned alpha = ALPHA(source->alpha);
+		if (alpha == 0) {
+			for (size_t i = 0; i < count; i++)
+				buf[i] = 0;
+			return buf;
+		}
+
+		filter_span(source->filter, surface_pixmap_access(source->texture),
+		    sx, sy, dx, count, source->texture_extend, buf);
+
+		if (alpha < 255) {
+			for (size_t i = 0; i < count; i++) {
+				buf[i] = PIXEL(alpha * ALPHA(buf[i]) / 255,
+				    RED(buf[i]), GREEN(buf[i]), BLUE(buf[i]));
+			}
+		}
+
+		return buf;
+	}
+
+	for (size_t i = 0; i < count; i++)
+		buf[i] = source_pixel_at(source, sx + i * dx, sy + i * dy);
+
+	return buf;
+}
+
 /** @}
  */
@@ -73,6 +73,8 @@ extern void source_set_mask(source_t *, surface_t *, pixelmap_extend_t);
 extern bool source_is_fast(source_t *);
 extern pixel_t *source_direct_access(source_t *, double, double);
 extern pixel_t source_determine_pixel(source_t *, double, double);
+extern const pixel_t *source_determine_span(source_t *, sysarg_t, sysarg_t,
+    size_t, pixel_t *);
 
 #endif
 
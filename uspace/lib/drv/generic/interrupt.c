@@ -38,6 +38,7 @@
 #include <async.h>
 #include <errno.h>
 #include <macros.h>
+#include <device/hw_res.h>
 
 #include "ddf/interrupt.h"
 #include "private/driver.h"
@@ -55,6 +56,28 @@ errno_t unregister_interrupt_handler(ddf_dev_t *dev, cap_irq_handle_t handle)
 	return async_irq_unsubscribe(handle);
 }
 
+errno_t coalesce_interrupt_handler(ddf_dev_t *dev, cap_irq_handle_t handle,
+    useconds_t holdoff)
+{
+	return async_irq_coalesce(handle, holdoff);
+}
+
+errno_t set_interrupt_handler_affinity(ddf_dev_t *dev, int irq,
+    cap_irq_handle_t handle, unsigned int cpu)
+{
+	async_sess_t *sess = ddf_dev_parent_sess_get(dev);
+	errno_t rc = ENOTSUP;
+
+	/* Message signalled interrupts are routed by the parent driver. */
+	if (sess != NULL)
+		rc = hw_res_set_interrupt_affinity(sess, irq, cpu);
+
+	if (rc == ENOTSUP)
+		rc = async_irq_set_affinity(handle, cpu);
+
+	return rc;
+}
+
 /**
  * @}
  */
@@ -47,7 +47,8 @@ typedef enum {
 	IPC_M_AHCI_GET_NUM_BLOCKS,
 	IPC_M_AHCI_GET_BLOCK_SIZE,
 	IPC_M_AHCI_READ_BLOCKS,
-	IPC_M_AHCI_WRITE_BLOCKS
+	IPC_M_AHCI_WRITE_BLOCKS,
+	IPC_M_AHCI_DISCARD_BLOCKS
 } ahci_iface_funcs_t;
 
 #define MAX_NAME_LENGTH  1024
@@ -181,6 +182,30 @@ errno_t ahci_write_blocks(async_sess_t *sess, uint64_t blocknum, size_t count,
 	return rc;
 }
 
+errno_t ahci_discard_blocks(async_sess_t *sess, const bd_extent_t *ext,
+    size_t cnt)
+{
+	async_exch_t *exch = async_exchange_begin(sess);
+	if (!exch)
+		return EINVAL;
+
+	aid_t req = async_send_2(exch, DEV_IFACE_ID(AHCI_DEV_IFACE),
+	    IPC_M_AHCI_DISCARD_BLOCKS, cnt, NULL);
+
+	errno_t rc = async_data_write_start(exch, ext, cnt * sizeof(bd_extent_t));
+
+	async_exchange_end(exch);
+
+	if (rc != EOK) {
+		async_forget(req);
+		return rc;
+	}
+
+	async_wait_for(req, &rc);
+
+	return rc;
+}
+
 static void remote_ahci_get_sata_device_name(ddf_fun_t *, void *, cap_call_handle_t,
     ipc_call_t *);
 static void remote_ahci_get_num_blocks(ddf_fun_t *, void *, cap_call_handle_t,
@@ -191,6 +216,8 @@ static void remote_ahci_read_blocks(ddf_fun_t *, void *, cap_call_handle_t,
     ipc_call_t *);
 static void remote_ahci_write_blocks(ddf_fun_t *, void *, cap_call_handle_t,
     ipc_call_t *);
+static void remote_ahci_discard_blocks(ddf_fun_t *, void *, cap_call_handle_t,
+    ipc_call_t *);
 
 /** Remote AHCI interface operations. */
 static const remote_iface_func_ptr_t remote_ahci_iface_ops [] = {
@@ -198,7 +225,8 @@ static const remote_iface_func_ptr_t remote_ahci_iface_ops [] = {
 	[IPC_M_AHCI_GET_NUM_BLOCKS] = remote_ahci_get_num_blocks,
 	[IPC_M_AHCI_GET_BLOCK_SIZE] = remote_ahci_get_block_size,
 	[IPC_M_AHCI_READ_BLOCKS] = remote_ahci_read_blocks,
-	[IPC_M_AHCI_WRITE_BLOCKS] = remote_ahci_write_blocks
+	[IPC_M_AHCI_WRITE_BLOCKS] = remote_ahci_write_blocks,
+	[IPC_M_AHCI_DISCARD_BLOCKS] = remote_ahci_discard_blocks
 };
 
 /** Remote AHCI interface structure.
@@ -296,7 +324,11 @@ void remote_ahci_read_blocks(ddf_fun_t *fun, void *iface,
 	async_share_out_receive(&call_handle, &maxblock_size, &flags);
 
 	void *buf;
-	async_share_out_finalize(call_handle, &buf);
+	errno_t rc = async_share_out_finalize(call_handle, &buf);
+	if (rc != EOK) {
+		async_answer_0(chandle, rc);
+		return;
+	}
 
 	const uint64_t blocknum =
 	    (((uint64_t) (DEV_IPC_GET_ARG1(*call))) << 32) |
@@ -305,6 +337,9 @@ void remote_ahci_read_blocks(ddf_fun_t *fun, void *iface,
 
 	const errno_t ret = ahci_iface->read_blocks(fun, blocknum, cnt, buf);
 
+	/* The area is shared anew for each request */
+	as_area_destroy(buf);
+
 	async_answer_0(chandle, ret);
 }
 
@@ -325,7 +360,11 @@ void remote_ahci_write_blocks(ddf_fun_t *fun, void *iface, cap_call_handle_t cha
 	async_share_out_receive(&call_handle, &maxblock_size, &flags);
 
 	void *buf;
-	async_share_out_finalize(call_handle, &buf);
+	errno_t rc = async_share_out_finalize(call_handle, &buf);
+	if (rc != EOK) {
+		async_answer_0(chandle, rc);
+		return;
+	}
 
 	const uint64_t blocknum =
 	    (((uint64_t)(DEV_IPC_GET_ARG1(*call))) << 32) |
@@ -334,6 +373,40 @@ void remote_ahci_write_blocks(ddf_fun_t *fun, void *iface, cap_call_handle_t cha
 
 	const errno_t ret = ahci_iface->write_blocks(fun, blocknum, cnt, buf);
 
+	/* The area is shared anew for each request */
+	as_area_destroy(buf);
+
+	async_answer_0(chandle, ret);
+}
+
+void remote_ahci_discard_blocks(ddf_fun_t *fun, void *iface,
+    cap_call_handle_t chandle, ipc_call_t *call)
+{
+	const ahci_iface_t *ahci_iface = (ahci_iface_t *) iface;
+	const size_t cnt = (size_t) DEV_IPC_GET_ARG1(*call);
+
+	if ((cnt == 0) || (cnt > BD_EXTENTS_MAX)) {
+		async_answer_0(chandle, EINVAL);
+		return;
+	}
+
+	bd_extent_t *ext;
+	errno_t rc = async_data_write_accept((void **) &ext, false,
+	    cnt * sizeof(bd_extent_t), cnt * sizeof(bd_extent_t), 0, NULL);
+	if (rc != EOK) {
+		async_answer_0(chandle, rc);
+		return;
+	}
+
+	if (ahci_iface->discard_blocks == NULL) {
+		free(ext);
+		async_answer_0(chandle, ENOTSUP);
+		return;
+	}
+
+	const errno_t ret = ahci_iface->discard_blocks(fun, ext, cnt);
+
+	free(ext);
 	async_answer_0(chandle, ret);
 }
 
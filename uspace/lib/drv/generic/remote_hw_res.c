@@ -52,6 +52,12 @@ static void remote_hw_res_dma_channel_setup(ddf_fun_t *, void *, cap_call_handle
     ipc_call_t *);
 static void remote_hw_res_dma_channel_remain(ddf_fun_t *, void *, cap_call_handle_t,
     ipc_call_t *);
+static void remote_hw_res_alloc_msi(ddf_fun_t *, void *, cap_call_handle_t,
+    ipc_call_t *);
+static void remote_hw_res_free_msi(ddf_fun_t *, void *, cap_call_handle_t,
+    ipc_call_t *);
+static void remote_hw_res_set_interrupt_affinity(ddf_fun_t *, void *,
+    cap_call_handle_t, ipc_call_t *);
 
 static const remote_iface_func_ptr_t remote_hw_res_iface_ops [] = {
 	[HW_RES_GET_RESOURCE_LIST] = &remote_hw_res_get_resource_list,
@@ -60,6 +66,9 @@ static const remote_iface_func_ptr_t remote_hw_res_iface_ops [] = {
 	[HW_RES_CLEAR_INTERRUPT] = &remote_hw_res_clear_interrupt,
 	[HW_RES_DMA_CHANNEL_SETUP] = &remote_hw_res_dma_channel_setup,
 	[HW_RES_DMA_CHANNEL_REMAIN] = &remote_hw_res_dma_channel_remain,
+	[HW_RES_ALLOC_MSI] = &remote_hw_res_alloc_msi,
+	[HW_RES_FREE_MSI] = &remote_hw_res_free_msi,
+	[HW_RES_SET_INTERRUPT_AFFINITY] = &remote_hw_res_set_interrupt_affinity,
 };
 
 const remote_iface_t remote_hw_res_iface = {
@@ -171,6 +180,49 @@ static void remote_hw_res_dma_channel_remain(ddf_fun_t *fun, void *ops,
 	const errno_t ret = hw_res_ops->dma_channel_remain(fun, channel, &remain);
 	async_answer_1(chandle, ret, remain);
 }
+
+static void remote_hw_res_alloc_msi(ddf_fun_t *fun, void *ops,
+    cap_call_handle_t chandle, ipc_call_t *call)
+{
+	hw_res_ops_t *hw_res_ops = ops;
+
+	if (hw_res_ops->alloc_msi == NULL) {
+		async_answer_0(chandle, ENOTSUP);
+		return;
+	}
+	const size_t count = DEV_IPC_GET_ARG1(*call);
+	size_t allocated = 0;
+	const errno_t ret = hw_res_ops->alloc_msi(fun, count, &allocated);
+	async_answer_1(chandle, ret, allocated);
+}
+
+static void remote_hw_res_free_msi(ddf_fun_t *fun, void *ops,
+    cap_call_handle_t chandle, ipc_call_t *call)
+{
+	hw_res_ops_t *hw_res_ops = ops;
+
+	if (hw_res_ops->free_msi == NULL) {
+		async_answer_0(chandle, ENOTSUP);
+		return;
+	}
+	const errno_t ret = hw_res_ops->free_msi(fun);
+	async_answer_0(chandle, ret);
+}
+
+static void remote_hw_res_set_interrupt_affinity(ddf_fun_t *fun, void *ops,
+    cap_call_handle_t chandle, ipc_call_t *call)
+{
+	hw_res_ops_t *hw_res_ops = ops;
+
+	if (hw_res_ops->set_interrupt_affinity == NULL) {
+		async_answer_0(chandle, ENOTSUP);
+		return;
+	}
+	const int irq = DEV_IPC_GET_ARG1(*call);
+	const unsigned int cpu = DEV_IPC_GET_ARG2(*call);
+	const errno_t ret = hw_res_ops->set_interrupt_affinity(fun, irq, cpu);
+	async_answer_0(chandle, ret);
+}
 /**
  * @}
  */
@@ -93,17 +93,19 @@ typedef enum {
  * @param[in] dev_sess
  * @param[in] data     Frame data
  * @param[in] size     Frame size in bytes
+ * @param[in] flags    Frame flags (NIC_FRAME_*)
  *
  * @return EOK If the operation was successfully completed
  *
  */
-errno_t nic_send_frame(async_sess_t *dev_sess, void *data, size_t size)
+errno_t nic_send_frame(async_sess_t *dev_sess, void *data, size_t size,
+    uint32_t flags)
 {
 	async_exch_t *exch = async_exchange_begin(dev_sess);
 
 	ipc_call_t answer;
-	aid_t req = async_send_1(exch, DEV_IFACE_ID(NIC_DEV_IFACE),
-	    NIC_SEND_MESSAGE, &answer);
+	aid_t req = async_send_2(exch, DEV_IFACE_ID(NIC_DEV_IFACE),
+	    NIC_SEND_MESSAGE, (sysarg_t) flags, &answer);
 	errno_t retval = async_data_write_start(exch, data, size);
 
 	async_exchange_end(exch);
@@ -1244,7 +1246,7 @@ errno_t nic_offload_set(async_sess_t *dev_sess, uint32_t mask, uint32_t active)
 {
 	async_exch_t *exch = async_exchange_begin(dev_sess);
 	errno_t rc = async_req_3_0(exch, DEV_IFACE_ID(NIC_DEV_IFACE),
-	    NIC_AUTONEG_RESTART, (sysarg_t) mask, (sysarg_t) active);
+	    NIC_OFFLOAD_SET, (sysarg_t) mask, (sysarg_t) active);
 	async_exchange_end(exch);
 
 	return rc;
@@ -1343,15 +1345,18 @@ static void remote_nic_send_frame(ddf_fun_t *dev, void *iface,
 
 	void *data;
 	size_t size;
+	uint32_t flags;
 	errno_t rc;
 
+	flags = (uint32_t) IPC_GET_ARG2(*call);
+
 	rc = async_data_write_accept(&data, false, 0, 0, 0, &size);
 	if (rc != EOK) {
 		async_answer_0(chandle, EINVAL);
 		return;
 	}
 
-	rc = nic_iface->send_frame(dev, data, size);
+	rc = nic_iface->send_frame(dev, data, size, flags);
 	async_answer_0(chandle, rc);
 	free(data);
 }
@@ -51,6 +51,7 @@ typedef enum {
 	IPC_M_USB_REGISTER_ENDPOINT,
 	IPC_M_USB_UNREGISTER_ENDPOINT,
 	IPC_M_USB_TRANSFER,
+	IPC_M_USB_REQUEST_STREAMS,
 } usbhc_iface_funcs_t;
 
 /** Reserve default USB address.
@@ -177,6 +178,42 @@ errno_t usbhc_unregister_endpoint(async_exch_t *exch, const usb_pipe_desc_t *pip
 	return (errno_t) opening_request_rc;
 }
 
+/**
+ * Enable streams on a registered (SuperSpeed bulk) endpoint. Transfers on the
+ * endpoint then have to target one of the streams 1 to count.
+ *
+ * @param[in] exch IPC communication exchange
+ * @param[in] pipe_desc Description of the endpoint pipe
+ * @param[in] count Number of streams, a power of two
+ * @return Error code.
+ */
+errno_t usbhc_request_streams(async_exch_t *exch,
+    const usb_pipe_desc_t *pipe_desc, unsigned count)
+{
+	if (!exch)
+		return EBADMEM;
+
+	aid_t opening_request = async_send_2(exch,
+	    DEV_IFACE_ID(USBHC_DEV_IFACE), IPC_M_USB_REQUEST_STREAMS, count,
+	    NULL);
+
+	if (opening_request == 0) {
+		return ENOMEM;
+	}
+
+	const errno_t ret = async_data_write_start(exch, pipe_desc, sizeof(*pipe_desc));
+	if (ret != EOK) {
+		async_forget(opening_request);
+		return ret;
+	}
+
+	/* Wait for the answer. */
+	errno_t opening_request_rc;
+	async_wait_for(opening_request, &opening_request_rc);
+
+	return (errno_t) opening_request_rc;
+}
+
 /**
  * Issue a USB transfer with a data contained in memory area. That area is
  * temporarily shared with the HC.
@@ -232,6 +269,7 @@ static void remote_usbhc_device_remove(ddf_fun_t *, void *, cap_call_handle_t, i
 static void remote_usbhc_register_endpoint(ddf_fun_t *, void *, cap_call_handle_t, ipc_call_t *);
 static void remote_usbhc_unregister_endpoint(ddf_fun_t *, void *, cap_call_handle_t, ipc_call_t *);
 static void remote_usbhc_transfer(ddf_fun_t *fun, void *iface, cap_call_handle_t chandle, ipc_call_t *call);
+static void remote_usbhc_request_streams(ddf_fun_t *, void *, cap_call_handle_t, ipc_call_t *);
 
 /** Remote USB interface operations. */
 static const remote_iface_func_ptr_t remote_usbhc_iface_ops [] = {
@@ -241,6 +279,7 @@ static const remote_iface_func_ptr_t remote_usbhc_iface_ops [] = {
 	[IPC_M_USB_REGISTER_ENDPOINT] = remote_usbhc_register_endpoint,
 	[IPC_M_USB_UNREGISTER_ENDPOINT] = remote_usbhc_unregister_endpoint,
 	[IPC_M_USB_TRANSFER] = remote_usbhc_transfer,
+	[IPC_M_USB_REQUEST_STREAMS] = remote_usbhc_request_streams,
 };
 
 /** Remote USB interface structure.
@@ -368,6 +407,37 @@ static void remote_usbhc_unregister_endpoint(ddf_fun_t *fun, void *iface,
 	async_answer_0(chandle, rc);
 }
 
+static void remote_usbhc_request_streams(ddf_fun_t *fun, void *iface,
+    cap_call_handle_t chandle, ipc_call_t *call)
+{
+	assert(fun);
+	assert(iface);
+	assert(call);
+
+	const usbhc_iface_t *usbhc_iface = iface;
+
+	if (!usbhc_iface->request_streams) {
+		async_answer_0(chandle, ENOTSUP);
+		return;
+	}
+
+	const unsigned count = DEV_IPC_GET_ARG1(*call);
+
+	usb_pipe_desc_t pipe_desc;
+	cap_call_handle_t data_chandle;
+	size_t len;
+
+	if (!async_data_write_receive(&data_chandle, &len) ||
+	    len != sizeof(pipe_desc)) {
+		async_answer_0(chandle, EINVAL);
+		return;
+	}
+	async_data_write_finalize(data_chandle, &pipe_desc, sizeof(pipe_desc));
+
+	const errno_t rc = usbhc_iface->request_streams(fun, &pipe_desc, count);
+	async_answer_0(chandle, rc);
+}
+
 static void async_transaction_destroy(async_transaction_t *trans)
 {
 	if (trans == NULL) {
@@ -52,6 +52,10 @@ typedef void interrupt_handler_t(ipc_call_t *, ddf_dev_t *);
 extern errno_t register_interrupt_handler(ddf_dev_t *, int, interrupt_handler_t *,
     const irq_code_t *, cap_irq_handle_t *);
 extern errno_t unregister_interrupt_handler(ddf_dev_t *, cap_irq_handle_t);
+extern errno_t coalesce_interrupt_handler(ddf_dev_t *, cap_irq_handle_t,
+    useconds_t);
+extern errno_t set_interrupt_handler_affinity(ddf_dev_t *, int,
+    cap_irq_handle_t, unsigned int);
 
 #endif
 
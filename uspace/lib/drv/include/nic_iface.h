@@ -43,10 +43,26 @@
 typedef enum {
 	NIC_EV_ADDR_CHANGED = IPC_FIRST_USER_METHOD,
 	NIC_EV_RECEIVED,
-	NIC_EV_DEVICE_STATE
+	NIC_EV_DEVICE_STATE,
+	NIC_EV_RECEIVED_BATCH
 } nic_event_t;
 
-extern errno_t nic_send_frame(async_sess_t *, void *, size_t);
+/** Header of a frame in NIC_EV_RECEIVED_BATCH data.
+ *
+ * Each header is followed by frame data. Header and data together are
+ * padded to a multiple of NIC_BATCH_ALIGN bytes.
+ */
+typedef struct {
+	/** Frame size in bytes */
+	uint32_t size;
+} nic_batch_frame_hdr_t;
+
+/** Alignment of frames in NIC_EV_RECEIVED_BATCH data */
+#define NIC_BATCH_ALIGN  sizeof(nic_batch_frame_hdr_t)
+/** Maximum size of NIC_EV_RECEIVED_BATCH data */
+#define NIC_BATCH_SIZE_MAX  65536
+
+extern errno_t nic_send_frame(async_sess_t *, void *, size_t, uint32_t);
 extern errno_t nic_callback_create(async_sess_t *, async_port_handler_t, void *);
 extern errno_t nic_get_state(async_sess_t *, nic_device_state_t *);
 extern errno_t nic_set_state(async_sess_t *, nic_device_state_t);
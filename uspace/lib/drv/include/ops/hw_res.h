@@ -48,6 +48,9 @@ typedef struct {
 	errno_t (*clear_interrupt)(ddf_fun_t *, int);
 	errno_t (*dma_channel_setup)(ddf_fun_t *, unsigned, uint32_t, uint32_t, uint8_t);
 	errno_t (*dma_channel_remain)(ddf_fun_t *, unsigned, size_t *);
+	errno_t (*alloc_msi)(ddf_fun_t *, size_t, size_t *);
+	errno_t (*free_msi)(ddf_fun_t *);
+	errno_t (*set_interrupt_affinity)(ddf_fun_t *, int, unsigned int);
 } hw_res_ops_t;
 
 #endif
@@ -43,7 +43,7 @@
 
 typedef struct nic_iface {
 	/** Mandatory methods */
-	errno_t (*send_frame)(ddf_fun_t *, void *, size_t);
+	errno_t (*send_frame)(ddf_fun_t *, void *, size_t, uint32_t);
 	errno_t (*callback_create)(ddf_fun_t *);
 	errno_t (*get_state)(ddf_fun_t *, nic_device_state_t *);
 	errno_t (*set_state)(ddf_fun_t *, nic_device_state_t);
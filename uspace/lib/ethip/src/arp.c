@@ -46,9 +46,6 @@
 #include "pdu.h"
 #include "std.h"
 
-/** Time to wait for ARP reply in microseconds */
-#define ARP_REQUEST_TIMEOUT (3 * 1000 * 1000)
-
 static errno_t arp_send_packet(ethip_nic_t *nic, arp_eth_packet_t *packet);
 
 void arp_received(ethip_nic_t *nic, eth_frame_t *frame)
@@ -77,7 +74,7 @@ void arp_received(ethip_nic_t *nic, eth_frame_t *frame)
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "Request/reply to my address");
 
-	(void) atrans_add(packet.sender_proto_addr,
+	(void) atrans_add(nic, laddr_v4, packet.sender_proto_addr,
 	    packet.sender_hw_addr);
 
 	if (packet.opcode == aop_request) {
@@ -93,32 +90,55 @@ void arp_received(ethip_nic_t *nic, eth_frame_t *frame)
 	}
 }
 
-errno_t arp_translate(ethip_nic_t *nic, addr32_t src_addr, addr32_t ip_addr,
-    addr48_t mac_addr)
+/** Send ARP request.
+ *
+ * @param nic       NIC
+ * @param src_addr  Source IP address
+ * @param ip_addr   IP address to translate
+ * @param target_hw Destination MAC address (broadcast if not known)
+ */
+errno_t arp_request(ethip_nic_t *nic, addr32_t src_addr, addr32_t ip_addr,
+    const addr48_t target_hw)
 {
-	/* Broadcast address */
-	if (ip_addr == addr32_broadcast_all_hosts) {
-		addr48(addr48_broadcast, mac_addr);
-		return EOK;
-	}
-
-	errno_t rc = atrans_lookup(ip_addr, mac_addr);
-	if (rc == EOK)
-		return EOK;
-
 	arp_eth_packet_t packet;
 
 	packet.opcode = aop_request;
 	addr48(nic->mac_addr, packet.sender_hw_addr);
 	packet.sender_proto_addr = src_addr;
-	addr48(addr48_broadcast, packet.target_hw_addr);
+	addr48(target_hw, packet.target_hw_addr);
 	packet.target_proto_addr = ip_addr;
 
-	rc = arp_send_packet(nic, &packet);
-	if (rc != EOK)
-		return rc;
+	return arp_send_packet(nic, &packet);
+}
+
+/** Send Ethernet frame to IP address.
+ *
+ * Destination MAC address of the frame is filled in from the address
+ * translation table. If the translation is not known yet, the frame is
+ * queued and sent once the ARP reply arrives.
+ *
+ * @param nic      NIC
+ * @param src_addr Source IP address
+ * @param ip_addr  Destination IP address
+ * @param data     Encoded Ethernet frame
+ * @param size     Frame size
+ * @param flags    Frame flags (NIC_FRAME_xxx)
+ */
+errno_t arp_send_frame(ethip_nic_t *nic, addr32_t src_addr, addr32_t ip_addr,
+    void *data, size_t size, uint32_t flags)
+{
+	eth_header_t *hdr = (eth_header_t *) data;
+
+	/* Broadcast address */
+	if (ip_addr == addr32_broadcast_all_hosts) {
+		addr48(addr48_broadcast, hdr->dest);
+		return ethip_nic_send(nic, data, size, flags);
+	}
+
+	if (atrans_lookup(ip_addr, hdr->dest) == EOK)
+		return ethip_nic_send(nic, data, size, flags);
 
-	return atrans_lookup_timeout(ip_addr, ARP_REQUEST_TIMEOUT, mac_addr);
+	return atrans_enqueue(nic, src_addr, ip_addr, data, size, flags);
 }
 
 static errno_t arp_send_packet(ethip_nic_t *nic, arp_eth_packet_t *packet)
@@ -149,7 +169,7 @@ static errno_t arp_send_packet(ethip_nic_t *nic, arp_eth_packet_t *packet)
 		return rc;
 	}
 
-	rc = ethip_nic_send(nic, fdata, fsize);
+	rc = ethip_nic_send(nic, fdata, fsize, 0);
 	free(fdata);
 	free(pdata);
 
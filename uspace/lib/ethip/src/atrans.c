@@ -0,0 +1,492 @@
+/*
+ * Copyright (c) 2012 Jiri Svoboda
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup inet
+ * @{
+ */
+/**
+ * @file
+ * @brief
+ */
+
+#include <adt/hash_table.h>
+#include <adt/list.h>
+#include <errno.h>
+#include <fibril_synch.h>
+#include <inet/iplink_srv.h>
+#include <io/log.h>
+#include <mem.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include "arp.h"
+#include "atrans.h"
+#include "ethip.h"
+#include "ethip_nic.h"
+#include "std.h"
+
+/** Interval of address translation table maintenance in microseconds */
+#define ATRANS_TICK (1000 * 1000)
+
+/** Time translation stays reachable after confirmation in microseconds */
+#define ATRANS_REACHABLE_TIME (30 * 1000 * 1000)
+
+/** Time before expiry when refresh of used translation starts */
+#define ATRANS_REFRESH_TIME (5 * 1000 * 1000)
+
+/** Time after which stale translation is removed if not used */
+#define ATRANS_STALE_TIME (60 * 1000 * 1000)
+
+/** Time to wait for ARP reply before retrying */
+#define ATRANS_RETRANS_TIME (1000 * 1000)
+
+/** Maximum number of ARP requests sent before giving up */
+#define ATRANS_MAX_REQUESTS 3
+
+/** Maximum number of frames queued per unresolved address */
+#define ATRANS_MAX_FRAMES 4
+
+/** Address translation table (of ethip_atrans_t) */
+static FIBRIL_MUTEX_INITIALIZE(atrans_list_lock);
+static hash_table_t atrans_table;
+static fibril_timer_t *atrans_timer;
+static bool atrans_timer_active;
+
+static void atrans_timer_func(void *);
+
+static size_t atrans_hash(const ht_link_t *item)
+{
+	ethip_atrans_t *atrans = hash_table_get_inst(item, ethip_atrans_t,
+	    atrans_link);
+	return atrans->ip_addr;
+}
+
+static size_t atrans_key_hash(void *key)
+{
+	return *(addr32_t *) key;
+}
+
+static bool atrans_equal(const ht_link_t *item1, const ht_link_t *item2)
+{
+	ethip_atrans_t *atrans1 = hash_table_get_inst(item1, ethip_atrans_t,
+	    atrans_link);
+	ethip_atrans_t *atrans2 = hash_table_get_inst(item2, ethip_atrans_t,
+	    atrans_link);
+	return atrans1->ip_addr == atrans2->ip_addr;
+}
+
+static bool atrans_key_equal(void *key, const ht_link_t *item)
+{
+	ethip_atrans_t *atrans = hash_table_get_inst(item, ethip_atrans_t,
+	    atrans_link);
+	return atrans->ip_addr == *(addr32_t *) key;
+}
+
+static hash_table_ops_t atrans_hash_ops = {
+	.hash = atrans_hash,
+	.key_hash = atrans_key_hash,
+	.equal = atrans_equal,
+	.key_equal = atrans_key_equal,
+	.remove_callback = NULL
+};
+
+/** Initialize address translation table.
+ *
+ * @return EOK on success, ENOMEM if out of memory
+ */
+errno_t atrans_init(void)
+{
+	if (!hash_table_create(&atrans_table, 0, 0, &atrans_hash_ops))
+		return ENOMEM;
+
+	atrans_timer = fibril_timer_create(&atrans_list_lock);
+	if (atrans_timer == NULL) {
+		hash_table_destroy(&atrans_table);
+		return ENOMEM;
+	}
+
+	return EOK;
+}
+
+static ethip_atrans_t *atrans_find(addr32_t ip_addr)
+{
+	ht_link_t *link;
+
+	link = hash_table_find(&atrans_table, &ip_addr);
+	if (link == NULL)
+		return NULL;
+
+	return hash_table_get_inst(link, ethip_atrans_t, atrans_link);
+}
+
+/** Create address translation entry and insert it into the table.
+ *
+ * @param nic     NIC used for sending ARP requests
+ * @param src_addr Source address used for sending ARP requests
+ * @param ip_addr IP address
+ * @return        New entry or @c NULL if out of memory
+ */
+static ethip_atrans_t *atrans_create_locked(ethip_nic_t *nic,
+    addr32_t src_addr, addr32_t ip_addr)
+{
+	ethip_atrans_t *atrans;
+
+	assert(fibril_mutex_is_locked(&atrans_list_lock));
+
+	atrans = calloc(1, sizeof(ethip_atrans_t));
+	if (atrans == NULL)
+		return NULL;
+
+	atrans->ip_addr = ip_addr;
+	atrans->nic = nic;
+	atrans->src_addr = src_addr;
+	atrans->state = ats_incomplete;
+	list_initialize(&atrans->frames);
+
+	hash_table_insert(&atrans_table, &atrans->atrans_link);
+
+	if (!atrans_timer_active) {
+		fibril_timer_set_locked(atrans_timer, ATRANS_TICK,
+		    atrans_timer_func, NULL);
+		atrans_timer_active = true;
+	}
+
+	return atrans;
+}
+
+/** Remove address translation entry from the table and destroy it.
+ *
+ * Frames waiting for the translation are discarded.
+ */
+static void atrans_destroy_locked(ethip_atrans_t *atrans)
+{
+	assert(fibril_mutex_is_locked(&atrans_list_lock));
+
+	hash_table_remove_item(&atrans_table, &atrans->atrans_link);
+
+	list_foreach_safe(atrans->frames, cur, next) {
+		ethip_atrans_frame_t *frame = list_get_instance(cur,
+		    ethip_atrans_frame_t, link);
+		list_remove(&frame->link);
+		free(frame->data);
+		free(frame);
+	}
+
+	free(atrans);
+}
+
+/** Set deadline of address translation entry.
+ *
+ * @param atrans Address translation
+ * @param delay  Time from now in microseconds
+ */
+static void atrans_set_deadline(ethip_atrans_t *atrans, suseconds_t delay)
+{
+	getuptime(&atrans->deadline);
+	tv_add_diff(&atrans->deadline, delay);
+}
+
+/** Send frames waiting for address translation.
+ *
+ * @param nic      NIC
+ * @param frames   List of ethip_atrans_frame_t, emptied
+ * @param mac_addr Destination MAC address
+ */
+static void atrans_send_frames(ethip_nic_t *nic, list_t *frames,
+    addr48_t mac_addr)
+{
+	eth_header_t *hdr;
+
+	list_foreach_safe(*frames, cur, next) {
+		ethip_atrans_frame_t *frame = list_get_instance(cur,
+		    ethip_atrans_frame_t, link);
+
+		hdr = (eth_header_t *) frame->data;
+		addr48(mac_addr, hdr->dest);
+		(void) ethip_nic_send(nic, frame->data, frame->size,
+		    frame->flags);
+
+		list_remove(&frame->link);
+		free(frame->data);
+		free(frame);
+	}
+}
+
+/** Add or confirm address translation.
+ *
+ * The translation becomes reachable and frames waiting for it are sent.
+ *
+ * @param nic      NIC on which the translation was received
+ * @param src_addr Local address
+ * @param ip_addr  IP address
+ * @param mac_addr MAC address
+ * @return         EOK on success, ENOMEM if out of memory
+ */
+errno_t atrans_add(ethip_nic_t *nic, addr32_t src_addr, addr32_t ip_addr,
+    addr48_t mac_addr)
+{
+	ethip_atrans_t *atrans;
+	list_t frames;
+
+	list_initialize(&frames);
+
+	fibril_mutex_lock(&atrans_list_lock);
+	atrans = atrans_find(ip_addr);
+	if (atrans == NULL) {
+		atrans = atrans_create_locked(nic, src_addr, ip_addr);
+		if (atrans == NULL) {
+			fibril_mutex_unlock(&atrans_list_lock);
+			return ENOMEM;
+		}
+	}
+
+	addr48(mac_addr, atrans->mac_addr);
+	atrans->state = ats_reachable;
+	atrans->nreq = 0;
+	atrans->used = false;
+	atrans_set_deadline(atrans, ATRANS_REACHABLE_TIME -
+	    ATRANS_REFRESH_TIME);
+
+	list_concat(&frames, &atrans->frames);
+	atrans->nframes = 0;
+	nic = atrans->nic;
+	fibril_mutex_unlock(&atrans_list_lock);
+
+	atrans_send_frames(nic, &frames, mac_addr);
+	return EOK;
+}
+
+errno_t atrans_remove(addr32_t ip_addr)
+{
+	ethip_atrans_t *atrans;
+
+	fibril_mutex_lock(&atrans_list_lock);
+	atrans = atrans_find(ip_addr);
+	if (atrans == NULL) {
+		fibril_mutex_unlock(&atrans_list_lock);
+		return ENOENT;
+	}
+
+	atrans_destroy_locked(atrans);
+	fibril_mutex_unlock(&atrans_list_lock);
+
+	return EOK;
+}
+
+/** Look up address translation.
+ *
+ * Stale translation can still be used, but it will be re-confirmed.
+ *
+ * @param ip_addr  IP address
+ * @param mac_addr Place to store MAC address
+ * @return         EOK on success, ENOENT if translation is not known
+ */
+errno_t atrans_lookup(addr32_t ip_addr, addr48_t mac_addr)
+{
+	ethip_atrans_t *atrans;
+
+	fibril_mutex_lock(&atrans_list_lock);
+	atrans = atrans_find(ip_addr);
+	if (atrans == NULL || atrans->state == ats_incomplete) {
+		fibril_mutex_unlock(&atrans_list_lock);
+		return ENOENT;
+	}
+
+	if (atrans->state == ats_stale) {
+		/* Probe at next tick */
+		atrans->state = ats_probe;
+		atrans->nreq = 0;
+		atrans_set_deadline(atrans, 0);
+	}
+
+	atrans->used = true;
+	addr48(atrans->mac_addr, mac_addr);
+	fibril_mutex_unlock(&atrans_list_lock);
+
+	return EOK;
+}
+
+/** Queue frame until address translation is known.
+ *
+ * If translation is not in progress yet, ARP request is sent. If too many
+ * frames are waiting for the translation, the oldest one is discarded.
+ *
+ * @param nic      NIC
+ * @param src_addr Source IP address
+ * @param ip_addr  Destination IP address
+ * @param data     Ethernet frame, destination address is filled in later
+ * @param size     Frame size
+ * @param flags    Frame flags (NIC_FRAME_xxx)
+ * @return         EOK on success, ENOMEM if out of memory
+ */
+errno_t atrans_enqueue(ethip_nic_t *nic, addr32_t src_addr, addr32_t ip_addr,
+    void *data, size_t size, uint32_t flags)
+{
+	ethip_atrans_t *atrans;
+	ethip_atrans_frame_t *frame;
+	addr48_t mac_addr;
+	eth_header_t *hdr;
+	bool send_req;
+
+	frame = calloc(1, sizeof(ethip_atrans_frame_t));
+	if (frame == NULL)
+		return ENOMEM;
+
+	frame->data = malloc(size);
+	if (frame->data == NULL) {
+		free(frame);
+		return ENOMEM;
+	}
+
+	memcpy(frame->data, data, size);
+	frame->size = size;
+	frame->flags = flags;
+
+	fibril_mutex_lock(&atrans_list_lock);
+
+	atrans = atrans_find(ip_addr);
+	if (atrans != NULL && atrans->state != ats_incomplete) {
+		/* Translation arrived in the meantime */
+		atrans->used = true;
+		addr48(atrans->mac_addr, mac_addr);
+		fibril_mutex_unlock(&atrans_list_lock);
+
+		hdr = (eth_header_t *) frame->data;
+		addr48(mac_addr, hdr->dest);
+		errno_t rc = ethip_nic_send(nic, frame->data, frame->size,
+		    frame->flags);
+		free(frame->data);
+		free(frame);
+		return rc;
+	}
+
+	send_req = false;
+	if (atrans == NULL) {
+		atrans = atrans_create_locked(nic, src_addr, ip_addr);
+		if (atrans == NULL) {
+			fibril_mutex_unlock(&atrans_list_lock);
+			free(frame->data);
+			free(frame);
+			return ENOMEM;
+		}
+
+		atrans->nreq = 1;
+		atrans_set_deadline(atrans, ATRANS_RETRANS_TIME);
+		send_req = true;
+	}
+
+	list_append(&frame->link, &atrans->frames);
+	if (++atrans->nframes > ATRANS_MAX_FRAMES) {
+		frame = list_get_instance(list_first(&atrans->frames),
+		    ethip_atrans_frame_t, link);
+		list_remove(&frame->link);
+		free(frame->data);
+		free(frame);
+		--atrans->nframes;
+	}
+
+	fibril_mutex_unlock(&atrans_list_lock);
+
+	if (send_req)
+		return arp_request(nic, src_addr, ip_addr, addr48_broadcast);
+
+	return EOK;
+}
+
+/** Advance address translation state when its deadline has passed.
+ *
+ * @param link Hash table link
+ * @param arg  Current time (struct timeval *)
+ * @return     @c true to continue walking the table
+ */
+static bool atrans_age(ht_link_t *link, void *arg)
+{
+	ethip_atrans_t *atrans = hash_table_get_inst(link, ethip_atrans_t,
+	    atrans_link);
+	struct timeval *now = (struct timeval *) arg;
+
+	if (!tv_gteq(now, &atrans->deadline))
+		return true;
+
+	switch (atrans->state) {
+	case ats_reachable:
+		if (!atrans->used) {
+			atrans->state = ats_stale;
+			atrans_set_deadline(atrans, ATRANS_STALE_TIME);
+			break;
+		}
+
+		/* Translation is in use, refresh it before it expires */
+		atrans->state = ats_probe;
+		atrans->nreq = 0;
+		/* Fallthrough */
+	case ats_probe:
+	case ats_incomplete:
+		if (atrans->nreq >= ATRANS_MAX_REQUESTS) {
+			log_msg(LOG_DEFAULT, LVL_DEBUG, "No ARP reply from "
+			    "0x%" PRIx32 ".", atrans->ip_addr);
+			atrans_destroy_locked(atrans);
+			break;
+		}
+
+		/* Known neighbor is probed using unicast request */
+		(void) arp_request(atrans->nic, atrans->src_addr,
+		    atrans->ip_addr, atrans->state == ats_probe ?
+		    atrans->mac_addr : addr48_broadcast);
+		++atrans->nreq;
+		atrans_set_deadline(atrans, ATRANS_RETRANS_TIME);
+		break;
+	case ats_stale:
+		atrans_destroy_locked(atrans);
+		break;
+	}
+
+	return true;
+}
+
+static void atrans_timer_func(void *arg)
+{
+	struct timeval now;
+
+	fibril_mutex_lock(&atrans_list_lock);
+
+	getuptime(&now);
+	hash_table_apply(&atrans_table, atrans_age, &now);
+
+	if (!hash_table_empty(&atrans_table)) {
+		fibril_timer_set_locked(atrans_timer, ATRANS_TICK,
+		    atrans_timer_func, NULL);
+	} else {
+		atrans_timer_active = false;
+	}
+
+	fibril_mutex_unlock(&atrans_list_lock);
+}
+
+/** @}
+ */
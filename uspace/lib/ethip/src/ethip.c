@@ -0,0 +1,383 @@
+/*
+ * Copyright (c) 2012 Jiri Svoboda
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup ethip
+ * @{
+ */
+/**
+ * @file
+ * @brief IP link provider for Ethernet
+ *
+ * Based on the IETF RFC 894 standard.
+ */
+
+#include <async.h>
+#include <errno.h>
+#include <ethip/ethip.h>
+#include <inet/iplink_srv.h>
+#include <io/log.h>
+#include <loc.h>
+#include <mem.h>
+#include <nic/nic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "arp.h"
+#include "atrans.h"
+#include "ethip.h"
+#include "ethip_nic.h"
+#include "pdu.h"
+#include "std.h"
+
+static errno_t ethip_open(iplink_srv_t *srv);
+static errno_t ethip_close(iplink_srv_t *srv);
+static errno_t ethip_send(iplink_srv_t *srv, iplink_sdu_t *sdu);
+static errno_t ethip_send6(iplink_srv_t *srv, iplink_sdu6_t *sdu);
+static errno_t ethip_get_mtu(iplink_srv_t *srv, size_t *mtu);
+static errno_t ethip_get_offload(iplink_srv_t *srv, uint32_t *offload);
+static errno_t ethip_get_mac48(iplink_srv_t *srv, addr48_t *mac);
+static errno_t ethip_set_mac48(iplink_srv_t *srv, addr48_t *mac);
+static errno_t ethip_addr_add(iplink_srv_t *srv, inet_addr_t *addr);
+static errno_t ethip_addr_remove(iplink_srv_t *srv, inet_addr_t *addr);
+
+static void ethip_client_conn(cap_call_handle_t icall_handle, ipc_call_t *icall, void *arg);
+
+static iplink_ops_t ethip_iplink_ops = {
+	.open = ethip_open,
+	.close = ethip_close,
+	.send = ethip_send,
+	.send6 = ethip_send6,
+	.get_mtu = ethip_get_mtu,
+	.get_offload = ethip_get_offload,
+	.get_mac48 = ethip_get_mac48,
+	.set_mac48 = ethip_set_mac48,
+	.addr_add = ethip_addr_add,
+	.addr_remove = ethip_addr_remove
+};
+
+/** Start IP over Ethernet.
+ *
+ * Start discovering NICs and providing IP links over them. The calling
+ * task must already be registered as a server with location service.
+ * Clients in the same task can open the IP links directly, see
+ * iplink_open_local().
+ *
+ * @return EOK on success or an error code
+ */
+errno_t ethip_start(void)
+{
+	errno_t rc;
+
+	rc = atrans_init();
+	if (rc != EOK)
+		return rc;
+
+	async_set_fallback_port_handler(ethip_client_conn, NULL);
+
+	return ethip_nic_discovery_start();
+}
+
+errno_t ethip_iplink_init(ethip_nic_t *nic)
+{
+	errno_t rc;
+	service_id_t sid;
+	category_id_t iplink_cat;
+	static unsigned link_num = 0;
+	char *svc_name = NULL;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "ethip_iplink_init()");
+
+	iplink_srv_init(&nic->iplink);
+	nic->iplink.ops = &ethip_iplink_ops;
+	nic->iplink.arg = nic;
+
+	if (asprintf(&svc_name, "net/eth%u", ++link_num) < 0) {
+		log_msg(LOG_DEFAULT, LVL_ERROR, "Out of memory.");
+		rc = ENOMEM;
+		goto error;
+	}
+
+	rc = loc_service_register(svc_name, &sid);
+	if (rc != EOK) {
+		log_msg(LOG_DEFAULT, LVL_ERROR, "Failed registering service %s.", svc_name);
+		goto error;
+	}
+
+	nic->iplink_sid = sid;
+	iplink_srv_local_register(&nic->iplink, sid);
+
+	rc = loc_category_get_id("iplink", &iplink_cat, IPC_FLAG_BLOCKING);
+	if (rc != EOK) {
+		log_msg(LOG_DEFAULT, LVL_ERROR, "Failed resolving category 'iplink'.");
+		goto error;
+	}
+
+	rc = loc_service_add_to_cat(sid, iplink_cat);
+	if (rc != EOK) {
+		log_msg(LOG_DEFAULT, LVL_ERROR, "Failed adding %s to category.", svc_name);
+		goto error;
+	}
+
+	return EOK;
+
+error:
+	if (svc_name != NULL)
+		free(svc_name);
+	return rc;
+}
+
+static void ethip_client_conn(cap_call_handle_t icall_handle, ipc_call_t *icall, void *arg)
+{
+	ethip_nic_t *nic;
+	service_id_t sid;
+
+	sid = (service_id_t) IPC_GET_ARG2(*icall);
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "ethip_client_conn(%u)", (unsigned)sid);
+	nic = ethip_nic_find_by_iplink_sid(sid);
+	if (nic == NULL) {
+		log_msg(LOG_DEFAULT, LVL_WARN, "Uknown service ID.");
+		return;
+	}
+
+	iplink_conn(icall_handle, icall, &nic->iplink);
+}
+
+static errno_t ethip_open(iplink_srv_t *srv)
+{
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "ethip_open()");
+	return EOK;
+}
+
+static errno_t ethip_close(iplink_srv_t *srv)
+{
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "ethip_close()");
+	return EOK;
+}
+
+static errno_t ethip_send(iplink_srv_t *srv, iplink_sdu_t *sdu)
+{
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "ethip_send()");
+
+	ethip_nic_t *nic = (ethip_nic_t *) srv->arg;
+	eth_frame_t frame;
+
+	/* Destination address is filled in by arp_send_frame() */
+	memset(frame.dest, 0, sizeof(frame.dest));
+	addr48(nic->mac_addr, frame.src);
+	frame.etype_len = ETYPE_IP;
+	frame.data = sdu->data;
+	frame.size = sdu->size;
+
+	void *data;
+	size_t size;
+	errno_t rc = eth_pdu_encode(&frame, &data, &size);
+	if (rc != EOK)
+		return rc;
+
+	uint32_t flags = 0;
+	if ((sdu->flags & IPLINK_SDU_CSUM_PARTIAL) != 0)
+		flags |= NIC_FRAME_CSUM_PARTIAL;
+
+	rc = arp_send_frame(nic, sdu->src, sdu->dest, data, size, flags);
+	free(data);
+
+	return rc;
+}
+
+static errno_t ethip_send6(iplink_srv_t *srv, iplink_sdu6_t *sdu)
+{
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "ethip_send6()");
+
+	ethip_nic_t *nic = (ethip_nic_t *) srv->arg;
+	eth_frame_t frame;
+
+	addr48(sdu->dest, frame.dest);
+	addr48(nic->mac_addr, frame.src);
+	frame.etype_len = ETYPE_IPV6;
+	frame.data = sdu->data;
+	frame.size = sdu->size;
+
+	void *data;
+	size_t size;
+	errno_t rc = eth_pdu_encode(&frame, &data, &size);
+	if (rc != EOK)
+		return rc;
+
+	rc = ethip_nic_send(nic, data, size, 0);
+	free(data);
+
+	return rc;
+}
+
+/** Deliver received SDU to IP link client.
+ *
+ * @param srv   IP link server
+ * @param sdu   Received SDU
+ * @param ver   IP version
+ * @param batch Batch to add SDU to or @c NULL to deliver it immediately
+ *
+ * @return EOK on success or an error code
+ */
+static errno_t ethip_deliver(iplink_srv_t *srv, iplink_recv_sdu_t *sdu,
+    ip_ver_t ver, iplink_recv_batch_t *batch)
+{
+	errno_t rc;
+
+	/* Batching does not pay off if the client is in the same task */
+	if (batch == NULL || srv->local != NULL)
+		return iplink_ev_recv(srv, sdu, ver);
+
+	rc = iplink_recv_batch_add(batch, sdu, ver);
+	if (rc != ENOMEM)
+		return rc;
+
+	/* Batch is full, flush it */
+	rc = iplink_ev_recv_batch(srv, batch);
+	if (rc != EOK)
+		log_msg(LOG_DEFAULT, LVL_DEBUG, " - iplink_ev_recv_batch failed");
+
+	rc = iplink_recv_batch_add(batch, sdu, ver);
+	if (rc == ENOMEM)
+		return iplink_ev_recv(srv, sdu, ver);
+
+	return rc;
+}
+
+errno_t ethip_received(iplink_srv_t *srv, void *data, size_t size)
+{
+	return ethip_received_batch(srv, data, size, NULL);
+}
+
+/** Process received Ethernet frame.
+ *
+ * @param srv   IP link server
+ * @param data  Frame data
+ * @param size  Frame size in bytes
+ * @param batch Batch to add received IP SDU to or @c NULL to deliver
+ *              it immediately
+ *
+ * @return EOK on success or an error code
+ */
+errno_t ethip_received_batch(iplink_srv_t *srv, void *data, size_t size,
+    iplink_recv_batch_t *batch)
+{
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "ethip_received(): srv=%p", srv);
+	ethip_nic_t *nic = (ethip_nic_t *) srv->arg;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, " - eth_pdu_decode");
+
+	eth_frame_t frame;
+	errno_t rc = eth_pdu_decode(data, size, &frame);
+	if (rc != EOK) {
+		log_msg(LOG_DEFAULT, LVL_DEBUG, " - eth_pdu_decode failed");
+		return rc;
+	}
+
+	iplink_recv_sdu_t sdu;
+
+	switch (frame.etype_len) {
+	case ETYPE_ARP:
+		arp_received(nic, &frame);
+		break;
+	case ETYPE_IP:
+		log_msg(LOG_DEFAULT, LVL_DEBUG, " - construct SDU");
+		sdu.data = frame.data;
+		sdu.size = frame.size;
+		log_msg(LOG_DEFAULT, LVL_DEBUG, " - call iplink_ev_recv");
+		rc = ethip_deliver(&nic->iplink, &sdu, ip_v4, batch);
+		break;
+	case ETYPE_IPV6:
+		log_msg(LOG_DEFAULT, LVL_DEBUG, " - construct SDU IPv6");
+		sdu.data = frame.data;
+		sdu.size = frame.size;
+		log_msg(LOG_DEFAULT, LVL_DEBUG, " - call iplink_ev_recv");
+		rc = ethip_deliver(&nic->iplink, &sdu, ip_v6, batch);
+		break;
+	default:
+		log_msg(LOG_DEFAULT, LVL_DEBUG, "Unknown ethertype 0x%" PRIx16,
+		    frame.etype_len);
+	}
+
+	free(frame.data);
+	return rc;
+}
+
+static errno_t ethip_get_mtu(iplink_srv_t *srv, size_t *mtu)
+{
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "ethip_get_mtu()");
+	*mtu = 1500;
+	return EOK;
+}
+
+static errno_t ethip_get_offload(iplink_srv_t *srv, uint32_t *offload)
+{
+	ethip_nic_t *nic = (ethip_nic_t *) srv->arg;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "ethip_get_offload()");
+
+	*offload = 0;
+	if ((nic->offload & NIC_OFFLOAD_TX_CSUM4) != 0)
+		*offload |= IPLINK_OFFLOAD_TX_CSUM4;
+	return EOK;
+}
+
+static errno_t ethip_get_mac48(iplink_srv_t *srv, addr48_t *mac)
+{
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "ethip_get_mac48()");
+
+	ethip_nic_t *nic = (ethip_nic_t *) srv->arg;
+	addr48(nic->mac_addr, *mac);
+
+	return EOK;
+}
+
+static errno_t ethip_set_mac48(iplink_srv_t *srv, addr48_t *mac)
+{
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "ethip_set_mac48()");
+
+	ethip_nic_t *nic = (ethip_nic_t *) srv->arg;
+	addr48(*mac, nic->mac_addr);
+
+	return EOK;
+}
+
+static errno_t ethip_addr_add(iplink_srv_t *srv, inet_addr_t *addr)
+{
+	ethip_nic_t *nic = (ethip_nic_t *) srv->arg;
+
+	return ethip_nic_addr_add(nic, addr);
+}
+
+static errno_t ethip_addr_remove(iplink_srv_t *srv, inet_addr_t *addr)
+{
+	ethip_nic_t *nic = (ethip_nic_t *) srv->arg;
+
+	return ethip_nic_addr_remove(nic, addr);
+}
+
+/** @}
+ */
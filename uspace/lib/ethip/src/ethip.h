@@ -37,6 +37,7 @@
 #ifndef ETHIP_H_
 #define ETHIP_H_
 
+#include <adt/hash_table.h>
 #include <adt/list.h>
 #include <async.h>
 #include <inet/iplink_srv.h>
@@ -44,6 +45,7 @@
 #include <loc.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <sys/time.h>
 
 typedef struct {
 	link_t link;
@@ -61,6 +63,8 @@ typedef struct ethip_nic {
 
 	/** MAC address */
 	addr48_t mac_addr;
+	/** Active NIC offload options (NIC_OFFLOAD_xxx) */
+	uint32_t offload;
 
 	/**
 	 * List of IP addresses configured on this link
@@ -108,15 +112,53 @@ typedef struct {
 	addr32_t target_proto_addr;
 } arp_eth_packet_t;
 
+/** Address translation state */
+typedef enum {
+	/** ARP request sent, no reply yet */
+	ats_incomplete,
+	/** Translation recently confirmed */
+	ats_reachable,
+	/** Translation not confirmed for some time */
+	ats_stale,
+	/** Translation usable, ARP request sent to re-confirm it */
+	ats_probe
+} ethip_atrans_state_t;
+
+/** Frame waiting for address translation */
+typedef struct {
+	link_t link;
+	void *data;
+	size_t size;
+	/** Frame flags (NIC_FRAME_xxx) */
+	uint32_t flags;
+} ethip_atrans_frame_t;
+
 /** Address translation table element */
 typedef struct {
-	link_t atrans_list;
+	ht_link_t atrans_link;
 	addr32_t ip_addr;
 	addr48_t mac_addr;
+	ethip_atrans_state_t state;
+	/** NIC used for sending ARP requests */
+	ethip_nic_t *nic;
+	/** Source address used for sending ARP requests */
+	addr32_t src_addr;
+	/** Time of next state transition */
+	struct timeval deadline;
+	/** Number of ARP requests sent in current state */
+	unsigned nreq;
+	/** Translation has been used since it was last confirmed */
+	bool used;
+	/** Frames waiting for the translation (of ethip_atrans_frame_t) */
+	list_t frames;
+	/** Number of frames in @c frames */
+	size_t nframes;
 } ethip_atrans_t;
 
 extern errno_t ethip_iplink_init(ethip_nic_t *);
 extern errno_t ethip_received(iplink_srv_t *, void *, size_t);
+extern errno_t ethip_received_batch(iplink_srv_t *, void *, size_t,
+    iplink_recv_batch_t *);
 
 #endif
 
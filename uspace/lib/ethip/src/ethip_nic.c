@@ -35,11 +35,13 @@
  */
 
 #include <adt/list.h>
+#include <align.h>
 #include <async.h>
 #include <stdbool.h>
 #include <errno.h>
 #include <str_error.h>
 #include <fibril_synch.h>
+#include <inttypes.h>
 #include <inet/iplink_srv.h>
 #include <io/log.h>
 #include <loc.h>
@@ -146,6 +148,38 @@ static void ethip_link_addr_delete(ethip_link_addr_t *laddr)
 	free(laddr);
 }
 
+/** Enable checksum offload options supported by the NIC.
+ *
+ * Failure is not fatal, the checksums are then computed in software.
+ *
+ * @param nic NIC
+ */
+static void ethip_nic_offload_init(ethip_nic_t *nic)
+{
+	uint32_t supported;
+	uint32_t active;
+	uint32_t wanted;
+	errno_t rc;
+
+	nic->offload = 0;
+
+	rc = nic_offload_probe(nic->sess, &supported, &active);
+	if (rc != EOK)
+		return;
+
+	wanted = supported & (NIC_OFFLOAD_TX_CSUM4 | NIC_OFFLOAD_RX_CSUM4);
+	if (wanted != active) {
+		rc = nic_offload_set(nic->sess, NIC_OFFLOAD_TX_CSUM4 |
+		    NIC_OFFLOAD_RX_CSUM4, wanted);
+		if (rc != EOK)
+			return;
+	}
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "NIC '%s' offload options 0x%" PRIx32,
+	    nic->svc_name, wanted);
+	nic->offload = wanted;
+}
+
 static errno_t ethip_nic_open(service_id_t sid)
 {
 	bool in_list = false;
@@ -181,6 +215,8 @@ static errno_t ethip_nic_open(service_id_t sid)
 	list_append(&nic->link, &ethip_nic_list);
 	in_list = true;
 
+	ethip_nic_offload_init(nic);
+
 	rc = ethip_iplink_init(nic);
 	if (rc != EOK)
 		goto error;
@@ -284,6 +320,64 @@ static void ethip_nic_received(ethip_nic_t *nic, cap_call_handle_t chandle,
 	async_answer_0(chandle, rc);
 }
 
+static void ethip_nic_received_batch(ethip_nic_t *nic, cap_call_handle_t chandle,
+    ipc_call_t *call)
+{
+	nic_batch_frame_hdr_t hdr;
+	iplink_recv_batch_t batch;
+	void *bbuf;
+	errno_t rc;
+	errno_t retval;
+	void *data;
+	size_t size;
+	size_t off;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "ethip_nic_received_batch() nic=%p",
+	    nic);
+
+	rc = async_data_write_accept(&data, false, 0, 0, 0, &size);
+	if (rc != EOK) {
+		log_msg(LOG_DEFAULT, LVL_DEBUG, "data_write_accept() failed");
+		async_answer_0(chandle, rc);
+		return;
+	}
+
+	/*
+	 * IP SDUs are smaller than the Ethernet frames carrying them, so
+	 * a buffer of the same size as the NIC batch is sufficient.
+	 */
+	bbuf = malloc(size);
+	iplink_recv_batch_init(&batch, bbuf, bbuf != NULL ? size : 0);
+
+	retval = EOK;
+	off = 0;
+	while (off + sizeof(hdr) <= size) {
+		memcpy(&hdr, data + off, sizeof(hdr));
+		if (hdr.size > size - off - sizeof(hdr)) {
+			retval = EINVAL;
+			break;
+		}
+
+		rc = ethip_received_batch(&nic->iplink, data + off + sizeof(hdr),
+		    hdr.size, &batch);
+		if (rc != EOK)
+			retval = rc;
+
+		off += ALIGN_UP(sizeof(hdr) + hdr.size, NIC_BATCH_ALIGN);
+	}
+
+	rc = iplink_ev_recv_batch(&nic->iplink, &batch);
+	if (rc != EOK)
+		retval = rc;
+
+	free(bbuf);
+	free(data);
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "ethip_nic_received_batch() done, "
+	    "rc=%s", str_error_name(retval));
+	async_answer_0(chandle, retval);
+}
+
 static void ethip_nic_device_state(ethip_nic_t *nic, cap_call_handle_t chandle,
     ipc_call_t *call)
 {
@@ -313,6 +407,9 @@ static void ethip_nic_cb_conn(cap_call_handle_t icall_handle, ipc_call_t *icall,
 		case NIC_EV_RECEIVED:
 			ethip_nic_received(nic, chandle, &call);
 			break;
+		case NIC_EV_RECEIVED_BATCH:
+			ethip_nic_received_batch(nic, chandle, &call);
+			break;
 		case NIC_EV_DEVICE_STATE:
 			ethip_nic_device_state(nic, chandle, &call);
 			break;
@@ -352,11 +449,12 @@ ethip_nic_t *ethip_nic_find_by_iplink_sid(service_id_t iplink_sid)
 	return NULL;
 }
 
-errno_t ethip_nic_send(ethip_nic_t *nic, void *data, size_t size)
+errno_t ethip_nic_send(ethip_nic_t *nic, void *data, size_t size,
+    uint32_t flags)
 {
 	errno_t rc;
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "ethip_nic_send(size=%zu)", size);
-	rc = nic_send_frame(nic->sess, data, size);
+	rc = nic_send_frame(nic->sess, data, size, flags);
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "nic_send_frame -> %s", str_error_name(rc));
 	return rc;
 }
@@ -60,7 +60,13 @@ extern void ext4_extent_header_set_depth(ext4_extent_header_t *, uint16_t);
 extern uint32_t ext4_extent_header_get_generation(ext4_extent_header_t *);
 extern void ext4_extent_header_set_generation(ext4_extent_header_t *, uint32_t);
 
+extern errno_t ext4_extent_cache_init(ext4_filesystem_t *);
+extern void ext4_extent_cache_fini(ext4_filesystem_t *);
+extern void ext4_extent_cache_invalidate(ext4_filesystem_t *, uint32_t);
+
 extern errno_t ext4_extent_find_block(ext4_inode_ref_t *, uint32_t, uint32_t *);
+extern errno_t ext4_extent_find_run(ext4_inode_ref_t *, uint32_t, uint32_t *,
+    uint32_t *);
 extern errno_t ext4_extent_release_blocks_from(ext4_inode_ref_t *, uint32_t);
 
 extern errno_t ext4_extent_append_block(ext4_inode_ref_t *, uint32_t *, uint32_t *,
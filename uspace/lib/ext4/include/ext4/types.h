@@ -34,7 +34,10 @@
 #ifndef LIBEXT4_TYPES_H_
 #define LIBEXT4_TYPES_H_
 
+#include <adt/hash_table.h>
+#include <adt/list.h>
 #include <block.h>
+#include <fibril_synch.h>
 
 /*
  * Structure of the super block
@@ -224,11 +227,41 @@ typedef struct ext4_superblock {
 	EXT4_FEATURE_RO_COMPAT_GDT_CSUM | \
 	EXT4_FEATURE_RO_COMPAT_EXTRA_ISIZE)
 
+/*
+ * In-memory cache of recently used extents of recently used i-nodes
+ */
+typedef struct ext4_extent_cache {
+	fibril_mutex_t lock;
+	hash_table_t nodes;  /* Cached i-nodes by i-node index */
+	list_t lru;          /* Cached i-nodes, least recently used first */
+	size_t count;        /* Number of cached i-nodes */
+	unsigned stamp;      /* Clock for replacing cached extents */
+} ext4_extent_cache_t;
+
+/*
+ * In-memory block allocation state of a block group
+ */
+typedef struct ext4_balloc_group {
+	uint32_t next;    /* Index where the search for a new run starts */
+	bool fragmented;  /* No free run found since the last release */
+	bool checked;     /* Descriptor checksum has been verified */
+	bool corrupt;     /* Descriptor checksum mismatch, do not allocate */
+} ext4_balloc_group_t;
+
 typedef struct ext4_filesystem {
 	service_id_t device;
 	ext4_superblock_t *superblock;
 	aoff64_t inode_block_limits[4];
 	aoff64_t inode_blocks_per_level[4];
+	ext4_extent_cache_t extent_cache;
+	ext4_balloc_group_t *balloc_groups;
+	/** Device blocks per filesystem block, 0 if freed blocks are not discarded */
+	uint32_t discard_blocks;
+	/** Protects the state of the metadata prefetch fibril */
+	fibril_mutex_t prefetch_lock;
+	fibril_condvar_t prefetch_cv;
+	bool prefetch_running;
+	bool prefetch_stop;
 } ext4_filesystem_t;
 
 
@@ -34,9 +34,11 @@
  * @brief Physical block allocator.
  */
 
+#include <block.h>
 #include <errno.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include "ext4/balloc.h"
 #include "ext4/bitmap.h"
 #include "ext4/block_group.h"
@@ -45,6 +47,121 @@
 #include "ext4/superblock.h"
 #include "ext4/types.h"
 
+/**
+ * Number of free blocks looked for when a file cannot continue its last run
+ * of blocks. The blocks following the first one are left to the file to grow
+ * into, other files start their runs after them.
+ */
+#define EXT4_BALLOC_RUN  32
+
+/** Initialize in-memory block allocation state.
+ *
+ * @param fs Filesystem
+ *
+ * @return Error code
+ *
+ */
+errno_t ext4_balloc_init(ext4_filesystem_t *fs)
+{
+	uint32_t count = ext4_superblock_get_block_group_count(fs->superblock);
+
+	fs->balloc_groups = calloc(count, sizeof(ext4_balloc_group_t));
+	if (fs->balloc_groups == NULL)
+		return ENOMEM;
+
+	uint32_t block_size = ext4_superblock_get_block_size(fs->superblock);
+	size_t phys_block_size;
+
+	fs->discard_blocks = 0;
+	if (block_get_bsize(fs->device, &phys_block_size) == EOK &&
+	    block_size % phys_block_size == 0)
+		fs->discard_blocks = block_size / phys_block_size;
+
+	return EOK;
+}
+
+/** Release in-memory block allocation state.
+ *
+ * @param fs Filesystem
+ *
+ */
+void ext4_balloc_fini(ext4_filesystem_t *fs)
+{
+	free(fs->balloc_groups);
+	fs->balloc_groups = NULL;
+}
+
+/** Discard released blocks on the device.
+ *
+ * Discarding is given up on for good once the device turns out not to
+ * support it.
+ *
+ * @param fs    Filesystem
+ * @param first Absolute address of the first released block
+ * @param count Number of released blocks
+ *
+ */
+static void ext4_balloc_discard(ext4_filesystem_t *fs, uint32_t first,
+    uint32_t count)
+{
+	if (fs->discard_blocks == 0)
+		return;
+
+	errno_t rc = block_discard(fs->device,
+	    (aoff64_t) first * fs->discard_blocks,
+	    (size_t) count * fs->discard_blocks);
+	if (rc == ENOTSUP)
+		fs->discard_blocks = 0;
+}
+
+/** Find a run of free blocks in a block group.
+ *
+ * The search starts after the previously found run, so that files allocated
+ * in parallel do not interleave, and wraps to the first data block of the
+ * group. Groups without any such run are remembered until some blocks in them
+ * get released.
+ *
+ * @param fs     Filesystem
+ * @param bgid   Index of block group
+ * @param bitmap Block bitmap of the block group
+ * @param goal   Preferred index in group to start searching at
+ * @param first  Index of the first data block in group
+ * @param max    Number of blocks in group
+ * @param index  Output value - index in group of the first block of the run
+ *
+ * @return Error code
+ *
+ */
+static errno_t ext4_balloc_find_run(ext4_filesystem_t *fs, uint32_t bgid,
+    uint8_t *bitmap, uint32_t goal, uint32_t first, uint32_t max,
+    uint32_t *index)
+{
+	ext4_balloc_group_t *group = &fs->balloc_groups[bgid];
+	errno_t rc;
+
+	if (group->fragmented)
+		return ENOSPC;
+
+	uint32_t start = goal > group->next ? goal : group->next;
+	if (start < first || start >= max)
+		start = first;
+
+	rc = ext4_bitmap_find_free_run(bitmap, start, EXT4_BALLOC_RUN, index,
+	    max);
+	if (rc != EOK && start > first) {
+		rc = ext4_bitmap_find_free_run(bitmap, first, EXT4_BALLOC_RUN,
+		    index, max);
+	}
+
+	if (rc != EOK) {
+		group->fragmented = true;
+		return rc;
+	}
+
+	group->next = *index + EXT4_BALLOC_RUN;
+	return EOK;
+}
+
 /** Free block.
  *
  * @param inode_ref  Inode, where the block is allocated
@@ -82,6 +199,8 @@ errno_t ext4_balloc_free_block(ext4_inode_ref_t *inode_ref, uint32_t block_addr)
 	/* Modify bitmap */
 	ext4_bitmap_free_bit(bitmap_block->data, index_in_group);
 	bitmap_block->dirty = true;
+	fs->balloc_groups[block_group].fragmented = false;
+	ext4_balloc_discard(fs, block_addr, 1);
 
 	/* Release block with bitmap */
 	rc = block_put(bitmap_block);
@@ -155,6 +274,8 @@ static errno_t ext4_balloc_free_blocks_internal(ext4_inode_ref_t *inode_ref,
 	/* Modify bitmap */
 	ext4_bitmap_free_bits(bitmap_block->data, index_in_group_first, count);
 	bitmap_block->dirty = true;
+	fs->balloc_groups[block_group_first].fragmented = false;
+	ext4_balloc_discard(fs, first, count);
 
 	/* Release block with bitmap */
 	rc = block_put(bitmap_block);
@@ -377,8 +498,9 @@ errno_t ext4_balloc_alloc_block(ext4_inode_ref_t *inode_ref, uint32_t *fblock)
 
 	free_blocks =
 	    ext4_block_group_get_free_blocks_count(bg_ref->block_group, sb);
-	if (free_blocks == 0) {
-		/* This group has no free blocks */
+	if (free_blocks == 0 ||
+	    inode_ref->fs->balloc_groups[block_group].corrupt) {
+		/* This group has no free blocks or cannot be trusted */
 		goto goal_failed;
 	}
 
@@ -423,6 +545,26 @@ errno_t ext4_balloc_alloc_block(ext4_inode_ref_t *inode_ref, uint32_t *fblock)
 	uint32_t blocks_in_group =
 	    ext4_superblock_get_blocks_in_group(sb, block_group);
 
+	/* Start a new run of blocks with room for the file to grow */
+	rc = ext4_balloc_find_run(inode_ref->fs, block_group,
+	    bitmap_block->data, index_in_group, first_in_group_index,
+	    blocks_in_group, &rel_block_idx);
+	if (rc == EOK) {
+		ext4_bitmap_set_bit(bitmap_block->data, rel_block_idx);
+		bitmap_block->dirty = true;
+		rc = block_put(bitmap_block);
+		if (rc != EOK) {
+			ext4_filesystem_put_block_group_ref(bg_ref);
+			return rc;
+		}
+
+		allocated_block =
+		    ext4_filesystem_index_in_group2blockaddr(sb, rel_block_idx,
+		    block_group);
+
+		goto success;
+	}
+
 	uint32_t end_idx = (index_in_group + 63) & ~63;
 	if (end_idx > blocks_in_group)
 		end_idx = blocks_in_group;
@@ -504,8 +646,9 @@ goal_failed:
 
 		free_blocks =
 		    ext4_block_group_get_free_blocks_count(bg_ref->block_group, sb);
-		if (free_blocks == 0) {
-			/* This group has no free blocks */
+		if (free_blocks == 0 ||
+		    inode_ref->fs->balloc_groups[bgid].corrupt) {
+			/* This group has no free blocks or cannot be trusted */
 			goto next_group;
 		}
 
@@ -533,6 +676,26 @@ goal_failed:
 		if (index_in_group < first_in_group_index)
 			index_in_group = first_in_group_index;
 
+		/* Try to find a run of free blocks */
+		rc = ext4_balloc_find_run(inode_ref->fs, bgid,
+		    bitmap_block->data, index_in_group, first_in_group_index,
+		    blocks_in_group, &rel_block_idx);
+		if (rc == EOK) {
+			ext4_bitmap_set_bit(bitmap_block->data, rel_block_idx);
+			bitmap_block->dirty = true;
+			rc = block_put(bitmap_block);
+			if (rc != EOK) {
+				ext4_filesystem_put_block_group_ref(bg_ref);
+				return rc;
+			}
+
+			allocated_block =
+			    ext4_filesystem_index_in_group2blockaddr(sb, rel_block_idx,
+			    bgid);
+
+			goto success;
+		}
+
 		/* Try to find free byte in bitmap */
 		rc = ext4_bitmap_find_free_byte_and_set_bit(bitmap_block->data,
 		    index_in_group, &rel_block_idx, blocks_in_group);
@@ -264,6 +264,46 @@ errno_t ext4_bitmap_find_free_bit_and_set(uint8_t *bitmap, uint32_t start_idx,
 	return ENOSPC;
 }
 
+/** Try to find a run of free bits.
+ *
+ * @param bitmap Pointer to bitmap
+ * @param start  Index of bit, where the algorithm will begin
+ * @param len    Number of free bits in the run
+ * @param index  Output value - index of the first bit of the run (if found)
+ * @param max    Maximum index of bit in bitmap
+ *
+ * @return Error code
+ *
+ */
+errno_t ext4_bitmap_find_free_run(uint8_t *bitmap, uint32_t start,
+    uint32_t len, uint32_t *index, uint32_t max)
+{
+	uint32_t idx = start;
+	uint32_t run = 0;
+
+	while (idx < max) {
+		/* Skip whole used bytes (255 = 11111111 binary) */
+		if ((idx % 8) == 0 && idx + 8 <= max && bitmap[idx / 8] == 255) {
+			run = 0;
+			idx += 8;
+			continue;
+		}
+
+		if (ext4_bitmap_is_free_bit(bitmap, idx)) {
+			if (++run == len) {
+				*index = idx + 1 - len;
+				return EOK;
+			}
+		} else {
+			run = 0;
+		}
+
+		++idx;
+	}
+
+	return ENOSPC;
+}
+
 /**
  * @}
  */
@@ -442,6 +442,23 @@ errno_t ext4_directory_add_entry(ext4_inode_ref_t *parent, const char *name,
 			return EOK;
 	}
 
+	/*
+	 * No free space found. Index the directory instead of growing it
+	 * linearly once it does not fit into a single block.
+	 */
+	if ((ext4_superblock_has_feature_compatible(fs->superblock,
+	    EXT4_FEATURE_COMPAT_DIR_INDEX)) && (total_blocks == 1)) {
+		errno_t rc = ext4_directory_dx_convert(parent);
+		if (rc == EOK) {
+			ext4_inode_set_flag(parent->inode, EXT4_INODE_FLAG_INDEX);
+			parent->dirty = true;
+			return ext4_directory_dx_add_entry(parent, child, name);
+		}
+
+		if (rc != ENOTSUP)
+			return rc;
+	}
+
 	/* No free block found - needed to allocate next data block */
 
 	iblock = 0;
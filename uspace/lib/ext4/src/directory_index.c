@@ -228,31 +228,26 @@ void ext4_directory_dx_entry_set_block(ext4_directory_dx_entry_t *entry,
 	entry->block = host2uint32_t_le(block);
 }
 
-/** Initialize index structure of new directory.
- *
- * @param dir Pointer to directory i-node
+/** Initialize index root following the dot entries in block 0.
  *
- * @return Error code
+ * @param dir    Pointer to directory i-node
+ * @param block  Block 0 of the directory
+ * @param iblock Logical block number of the only leaf of the index
  *
  */
-errno_t ext4_directory_dx_init(ext4_inode_ref_t *dir)
+static void ext4_directory_dx_init_root(ext4_inode_ref_t *dir, block_t *block,
+    uint32_t iblock)
 {
-	/* Load block 0, where will be index root located */
-	uint32_t fblock;
-	errno_t rc = ext4_filesystem_get_inode_data_block_index(dir, 0,
-	    &fblock);
-	if (rc != EOK)
-		return rc;
-
-	block_t *block;
-	rc = block_get(&block, dir->fs->device, fblock, BLOCK_FLAGS_NONE);
-	if (rc != EOK)
-		return rc;
-
 	/* Initialize pointers to data structures */
 	ext4_directory_dx_root_t *root = block->data;
 	ext4_directory_dx_root_info_t *info = &(root->info);
 
+	uint32_t block_size =
+	    ext4_superblock_get_block_size(dir->fs->superblock);
+
+	/* Clear the space covered by the dot-dot entry */
+	memset(info, 0, block_size - sizeof(root->dots));
+
 	/* Initialize root info structure */
 	uint8_t hash_version =
 	    ext4_superblock_get_default_hash_version(dir->fs->superblock);
@@ -266,14 +261,43 @@ errno_t ext4_directory_dx_init(ext4_inode_ref_t *dir)
 	    (ext4_directory_dx_countlimit_t *) &root->entries;
 	ext4_directory_dx_countlimit_set_count(countlimit, 1);
 
-	uint32_t block_size =
-	    ext4_superblock_get_block_size(dir->fs->superblock);
 	uint32_t entry_space =
 	    block_size - 2 * sizeof(ext4_directory_dx_dot_entry_t) -
 	    sizeof(ext4_directory_dx_root_info_t);
 	uint16_t root_limit = entry_space / sizeof(ext4_directory_dx_entry_t);
 	ext4_directory_dx_countlimit_set_limit(countlimit, root_limit);
 
+	/* Connect the leaf block to the only entry in index */
+	ext4_directory_dx_entry_t *entry = root->entries;
+	ext4_directory_dx_entry_set_block(entry, iblock);
+
+	block->dirty = true;
+}
+
+/** Initialize index structure of new directory.
+ *
+ * @param dir Pointer to directory i-node
+ *
+ * @return Error code
+ *
+ */
+errno_t ext4_directory_dx_init(ext4_inode_ref_t *dir)
+{
+	/* Load block 0, where will be index root located */
+	uint32_t fblock;
+	errno_t rc = ext4_filesystem_get_inode_data_block_index(dir, 0,
+	    &fblock);
+	if (rc != EOK)
+		return rc;
+
+	block_t *block;
+	rc = block_get(&block, dir->fs->device, fblock, BLOCK_FLAGS_NONE);
+	if (rc != EOK)
+		return rc;
+
+	uint32_t block_size =
+	    ext4_superblock_get_block_size(dir->fs->superblock);
+
 	/* Append new block, where will be new entries inserted in the future */
 	uint32_t iblock;
 	rc = ext4_filesystem_append_inode_block(dir, &fblock, &iblock);
@@ -301,11 +325,135 @@ errno_t ext4_directory_dx_init(ext4_inode_ref_t *dir)
 		return rc;
 	}
 
-	/* Connect new block to the only entry in index */
-	ext4_directory_dx_entry_t *entry = root->entries;
-	ext4_directory_dx_entry_set_block(entry, iblock);
+	ext4_directory_dx_init_root(dir, block, iblock);
 
-	block->dirty = true;
+	return block_put(block);
+}
+
+/** Check whether a directory entry is a dot entry of a new directory.
+ *
+ * @param sb     Superblock
+ * @param dentry Directory entry
+ * @param name   Expected name, "." or ".."
+ *
+ * @return True if the entry is the dot entry
+ *
+ */
+static bool ext4_directory_dx_is_dot_entry(ext4_superblock_t *sb,
+    ext4_directory_entry_ll_t *dentry, const char *name)
+{
+	size_t name_len = str_size(name);
+
+	return ext4_directory_entry_ll_get_inode(dentry) != 0 &&
+	    ext4_directory_entry_ll_get_name_length(sb, dentry) == name_len &&
+	    memcmp(dentry->name, name, name_len) == 0;
+}
+
+/** Convert a full linear directory of a single block to an indexed one.
+ *
+ * The entries following the dot entries are moved to a new block, which
+ * becomes the only leaf of the index. The index root replaces the moved
+ * entries in block 0. The caller must set the index flag of the i-node.
+ *
+ * @param dir Pointer to directory i-node
+ *
+ * @return Error code, ENOTSUP if block 0 does not start with the dot entries
+ *         in the layout required by the index root
+ *
+ */
+errno_t ext4_directory_dx_convert(ext4_inode_ref_t *dir)
+{
+	ext4_superblock_t *sb = dir->fs->superblock;
+	uint32_t block_size = ext4_superblock_get_block_size(sb);
+	uint16_t dot_len = sizeof(ext4_directory_dx_dot_entry_t);
+
+	uint32_t fblock;
+	errno_t rc = ext4_filesystem_get_inode_data_block_index(dir, 0,
+	    &fblock);
+	if (rc != EOK)
+		return rc;
+
+	block_t *block;
+	rc = block_get(&block, dir->fs->device, fblock, BLOCK_FLAGS_NONE);
+	if (rc != EOK)
+		return rc;
+
+	ext4_directory_entry_ll_t *dot = block->data;
+	ext4_directory_entry_ll_t *dotdot = block->data + dot_len;
+	if (!ext4_directory_dx_is_dot_entry(sb, dot, ".") ||
+	    ext4_directory_entry_ll_get_entry_length(dot) != dot_len ||
+	    !ext4_directory_dx_is_dot_entry(sb, dotdot, "..")) {
+		block_put(block);
+		return ENOTSUP;
+	}
+
+	/* Allocate the leaf before block 0 gets modified */
+	uint32_t iblock;
+	uint32_t leaf_fblock;
+	rc = ext4_filesystem_append_inode_block(dir, &leaf_fblock, &iblock);
+	if (rc != EOK) {
+		block_put(block);
+		return rc;
+	}
+
+	block_t *leaf;
+	rc = block_get(&leaf, dir->fs->device, leaf_fblock, BLOCK_FLAGS_NOREAD);
+	if (rc != EOK) {
+		block_put(block);
+		return rc;
+	}
+
+	memset(leaf->data, 0, block_size);
+
+	/* Move the other entries to the leaf, without gaps */
+	ext4_directory_entry_ll_t *last = NULL;
+	uint32_t src = dot_len + ext4_directory_entry_ll_get_entry_length(dotdot);
+	uint32_t dst = 0;
+
+	while (src < block_size) {
+		ext4_directory_entry_ll_t *dentry = block->data + src;
+		uint16_t rec_len = ext4_directory_entry_ll_get_entry_length(dentry);
+		if (rec_len == 0)
+			break;
+
+		if (ext4_directory_entry_ll_get_inode(dentry) != 0) {
+			uint16_t name_len =
+			    ext4_directory_entry_ll_get_name_length(sb, dentry);
+			uint16_t len = sizeof(ext4_fake_directory_entry_t) +
+			    name_len;
+			if ((len % 4) != 0)
+				len += 4 - (len % 4);
+
+			last = leaf->data + dst;
+			memcpy(last, dentry, len);
+			ext4_directory_entry_ll_set_entry_length(last, len);
+			dst += len;
+		}
+
+		src += rec_len;
+	}
+
+	/* The last entry spans the rest of the block */
+	if (last != NULL) {
+		ext4_directory_entry_ll_set_entry_length(last,
+		    ext4_directory_entry_ll_get_entry_length(last) +
+		    block_size - dst);
+	} else {
+		last = leaf->data;
+		ext4_directory_entry_ll_set_entry_length(last, block_size);
+		ext4_directory_entry_ll_set_inode(last, 0);
+	}
+
+	leaf->dirty = true;
+	rc = block_put(leaf);
+	if (rc != EOK) {
+		block_put(block);
+		return rc;
+	}
+
+	/* Hide the index root from linear readers */
+	ext4_directory_entry_ll_set_entry_length(dotdot, block_size - dot_len);
+	ext4_directory_dx_init_root(dir, block, iblock);
 
 	return block_put(block);
 }
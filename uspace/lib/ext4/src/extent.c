@@ -36,6 +36,7 @@
 
 #include <byteorder.h>
 #include <errno.h>
+#include <macros.h>
 #include <mem.h>
 #include <stdlib.h>
 #include "ext4/balloc.h"
@@ -43,6 +44,33 @@
 #include "ext4/inode.h"
 #include "ext4/superblock.h"
 
+/** Maximum number of i-nodes in the extent cache */
+#define EXT4_EXTENT_CACHE_NODES  64
+
+/** Maximum number of cached extents of one i-node */
+#define EXT4_EXTENT_CACHE_ITEMS  32
+
+/*
+ * Extent in the extent cache
+ */
+typedef struct {
+	uint32_t first;   /* First logical block of the extent */
+	uint32_t count;   /* Number of blocks of the extent */
+	uint64_t start;   /* First physical block of the extent */
+	unsigned stamp;   /* Time of the last use */
+} ext4_extent_cache_item_t;
+
+/*
+ * Cached extents of one i-node, sorted by the first logical block
+ */
+typedef struct {
+	ht_link_t link;
+	link_t lru_link;
+	uint32_t index;
+	size_t count;
+	ext4_extent_cache_item_t items[EXT4_EXTENT_CACHE_ITEMS];
+} ext4_extent_cache_node_t;
+
 /** Get logical number of the block covered by extent.
  *
  * @param extent Extent to load number from
@@ -360,6 +388,223 @@ static void ext4_extent_binsearch(ext4_extent_header_t *header,
 	*extent = l - 1;
 }
 
+static size_t ext4_extent_cache_key_hash(void *key)
+{
+	return *(uint32_t *) key;
+}
+
+static size_t ext4_extent_cache_hash(const ht_link_t *item)
+{
+	ext4_extent_cache_node_t *node =
+	    hash_table_get_inst(item, ext4_extent_cache_node_t, link);
+	return node->index;
+}
+
+static bool ext4_extent_cache_key_equal(void *key, const ht_link_t *item)
+{
+	ext4_extent_cache_node_t *node =
+	    hash_table_get_inst(item, ext4_extent_cache_node_t, link);
+	return node->index == *(uint32_t *) key;
+}
+
+static void ext4_extent_cache_remove_callback(ht_link_t *item)
+{
+	ext4_extent_cache_node_t *node =
+	    hash_table_get_inst(item, ext4_extent_cache_node_t, link);
+	list_remove(&node->lru_link);
+	free(node);
+}
+
+static hash_table_ops_t ext4_extent_cache_ops = {
+	.hash = ext4_extent_cache_hash,
+	.key_hash = ext4_extent_cache_key_hash,
+	.key_equal = ext4_extent_cache_key_equal,
+	.equal = NULL,
+	.remove_callback = ext4_extent_cache_remove_callback
+};
+
+/** Initialize the extent cache of a filesystem.
+ *
+ * @param fs Filesystem
+ *
+ * @return Error code
+ *
+ */
+errno_t ext4_extent_cache_init(ext4_filesystem_t *fs)
+{
+	ext4_extent_cache_t *cache = &fs->extent_cache;
+
+	if (!hash_table_create(&cache->nodes, 0, 0, &ext4_extent_cache_ops))
+		return ENOMEM;
+
+	fibril_mutex_initialize(&cache->lock);
+	list_initialize(&cache->lru);
+	cache->count = 0;
+	cache->stamp = 0;
+
+	return EOK;
+}
+
+/** Release the extent cache of a filesystem.
+ *
+ * @param fs Filesystem
+ *
+ */
+void ext4_extent_cache_fini(ext4_filesystem_t *fs)
+{
+	hash_table_destroy(&fs->extent_cache.nodes);
+}
+
+/** Forget cached extents of an i-node.
+ *
+ * Must be called whenever the extent tree of the i-node changes.
+ *
+ * @param fs    Filesystem
+ * @param index Index of the i-node
+ *
+ */
+void ext4_extent_cache_invalidate(ext4_filesystem_t *fs, uint32_t index)
+{
+	ext4_extent_cache_t *cache = &fs->extent_cache;
+
+	fibril_mutex_lock(&cache->lock);
+	if (hash_table_remove(&cache->nodes, &index) > 0)
+		cache->count--;
+	fibril_mutex_unlock(&cache->lock);
+}
+
+/** Look up a logical block in the extent cache.
+ *
+ * @param inode_ref I-node to look up the block for
+ * @param iblock    Logical block number
+ * @param item      Output value for the cached extent containing iblock
+ *
+ * @return True if the block is covered by a cached extent
+ *
+ */
+static bool ext4_extent_cache_find(ext4_inode_ref_t *inode_ref,
+    uint32_t iblock, ext4_extent_cache_item_t *item)
+{
+	ext4_extent_cache_t *cache = &inode_ref->fs->extent_cache;
+	bool found = false;
+
+	fibril_mutex_lock(&cache->lock);
+
+	ht_link_t *link = hash_table_find(&cache->nodes, &inode_ref->index);
+	if (link == NULL)
+		goto out;
+
+	ext4_extent_cache_node_t *node =
+	    hash_table_get_inst(link, ext4_extent_cache_node_t, link);
+
+	size_t l = 0;
+	size_t r = node->count;
+	while (l < r) {
+		size_t m = l + (r - l) / 2;
+		if (iblock < node->items[m].first)
+			r = m;
+		else
+			l = m + 1;
+	}
+
+	if (l > 0) {
+		ext4_extent_cache_item_t *it = &node->items[l - 1];
+		if (iblock - it->first < it->count) {
+			it->stamp = ++cache->stamp;
+			*item = *it;
+			found = true;
+		}
+	}
+
+	list_remove(&node->lru_link);
+	list_append(&node->lru_link, &cache->lru);
+
+out:
+	fibril_mutex_unlock(&cache->lock);
+	return found;
+}
+
+/** Insert an extent into the extent cache.
+ *
+ * The cache is best effort, failures are silently ignored.
+ *
+ * @param inode_ref I-node owning the extent
+ * @param extent    Extent to insert
+ *
+ */
+static void ext4_extent_cache_insert(ext4_inode_ref_t *inode_ref,
+    ext4_extent_t *extent)
+{
+	ext4_extent_cache_t *cache = &inode_ref->fs->extent_cache;
+	ext4_extent_cache_node_t *node;
+	uint32_t first = ext4_extent_get_first_block(extent);
+	size_t i;
+
+	fibril_mutex_lock(&cache->lock);
+
+	ht_link_t *link = hash_table_find(&cache->nodes, &inode_ref->index);
+	if (link != NULL) {
+		node = hash_table_get_inst(link, ext4_extent_cache_node_t,
+		    link);
+	} else {
+		if (cache->count == EXT4_EXTENT_CACHE_NODES) {
+			node = list_get_instance(list_first(&cache->lru),
+			    ext4_extent_cache_node_t, lru_link);
+			hash_table_remove_item(&cache->nodes, &node->link);
+			cache->count--;
+		}
+
+		node = malloc(sizeof(ext4_extent_cache_node_t));
+		if (node == NULL)
+			goto out;
+
+		node->index = inode_ref->index;
+		node->count = 0;
+		link_initialize(&node->lru_link);
+		list_append(&node->lru_link, &cache->lru);
+		hash_table_insert(&cache->nodes, &node->link);
+		cache->count++;
+	}
+
+	/* Keep the extents sorted */
+	for (i = 0; i < node->count; i++) {
+		if (node->items[i].first >= first)
+			break;
+	}
+
+	if (i < node->count && node->items[i].first == first)
+		goto set;
+
+	if (node->count == EXT4_EXTENT_CACHE_ITEMS) {
+		/* Replace the least recently used extent */
+		size_t victim = 0;
+		for (size_t j = 1; j < node->count; j++) {
+			if (node->items[j].stamp < node->items[victim].stamp)
+				victim = j;
+		}
+
+		memmove(&node->items[victim], &node->items[victim + 1],
+		    (node->count - victim - 1) *
+		    sizeof(ext4_extent_cache_item_t));
+		node->count--;
+		if (victim < i)
+			i--;
+	}
+
+	memmove(&node->items[i + 1], &node->items[i],
+	    (node->count - i) * sizeof(ext4_extent_cache_item_t));
+	node->count++;
+
+set:
+	node->items[i].first = first;
+	node->items[i].count = ext4_extent_get_block_count(extent);
+	node->items[i].start = ext4_extent_get_start(extent);
+	node->items[i].stamp = ++cache->stamp;
+
+out:
+	fibril_mutex_unlock(&cache->lock);
+}
+
 /** Find physical block in the extent tree by logical block number.
  *
  * There is no need to save path in the tree during this algorithm.
@@ -390,6 +635,12 @@ errno_t ext4_extent_find_block(ext4_inode_ref_t *inode_ref, uint32_t iblock,
 		return EOK;
 	}
 
+	ext4_extent_cache_item_t item;
+	if (ext4_extent_cache_find(inode_ref, iblock, &item)) {
+		*fblock = item.start + iblock - item.first;
+		return EOK;
+	}
+
 	block_t *block = NULL;
 
 	/* Walk through extent tree */
@@ -432,6 +683,9 @@ errno_t ext4_extent_find_block(ext4_inode_ref_t *inode_ref, uint32_t iblock,
 		phys_block = ext4_extent_get_start(extent) + iblock - first;
 
 		*fblock = phys_block;
+
+		if (iblock - first < ext4_extent_get_block_count(extent))
+			ext4_extent_cache_insert(inode_ref, extent);
 	}
 
 	/* Cleanup */
@@ -441,6 +695,91 @@ errno_t ext4_extent_find_block(ext4_inode_ref_t *inode_ref, uint32_t iblock,
 	return rc;
 }
 
+/** Find a run of physically contiguous blocks in the extent tree.
+ *
+ * Works like ext4_extent_find_block(), but also returns the number of
+ * blocks following iblock within the same extent.
+ *
+ * @param inode_ref I-node to load blocks from
+ * @param iblock    Logical block number to find
+ * @param fblock    Output value for physical block number, zero for holes
+ * @param count     Output value for number of blocks in the run, at least one
+ *
+ * @return Error code
+ *
+ */
+errno_t ext4_extent_find_run(ext4_inode_ref_t *inode_ref, uint32_t iblock,
+    uint32_t *fblock, uint32_t *count)
+{
+	errno_t rc = EOK;
+	uint64_t inode_size =
+	    ext4_inode_get_size(inode_ref->fs->superblock, inode_ref->inode);
+
+	uint32_t block_size =
+	    ext4_superblock_get_block_size(inode_ref->fs->superblock);
+
+	uint32_t last_idx = (inode_size - 1) / block_size;
+
+	*fblock = 0;
+	*count = 1;
+
+	if (iblock > last_idx)
+		return EOK;
+
+	ext4_extent_cache_item_t item;
+	if (ext4_extent_cache_find(inode_ref, iblock, &item)) {
+		*fblock = item.start + iblock - item.first;
+		*count = min(item.first + item.count - iblock,
+		    last_idx - iblock + 1);
+		return EOK;
+	}
+
+	block_t *block = NULL;
+
+	ext4_extent_header_t *header =
+	    ext4_inode_get_extent_header(inode_ref->inode);
+
+	while (ext4_extent_header_get_depth(header) != 0) {
+		ext4_extent_index_t *index;
+		ext4_extent_binsearch_idx(header, &index, iblock);
+
+		uint64_t child = ext4_extent_index_get_leaf(index);
+
+		if (block != NULL) {
+			rc = block_put(block);
+			if (rc != EOK)
+				return rc;
+		}
+
+		rc = block_get(&block, inode_ref->fs->device, child,
+		    BLOCK_FLAGS_NONE);
+		if (rc != EOK)
+			return rc;
+
+		header = (ext4_extent_header_t *)block->data;
+	}
+
+	ext4_extent_t *extent = NULL;
+	ext4_extent_binsearch(header, &extent, iblock);
+
+	if (extent != NULL) {
+		uint32_t first = ext4_extent_get_first_block(extent);
+		uint16_t length = ext4_extent_get_block_count(extent);
+
+		if (iblock - first < length) {
+			*fblock = ext4_extent_get_start(extent) + iblock - first;
+			*count = min(first + length - iblock,
+			    last_idx - iblock + 1);
+			ext4_extent_cache_insert(inode_ref, extent);
+		}
+	}
+
+	if (block != NULL)
+		rc = block_put(block);
+
+	return rc;
+}
+
 /** Find extent for specified iblock.
  *
  * This function is used for finding block in the extent tree with
@@ -750,6 +1089,8 @@ cleanup:
 	/* Destroy temporary data structure */
 	free(path);
 
+	ext4_extent_cache_invalidate(inode_ref->fs, inode_ref->index);
+
 	return rc;
 }
 
@@ -1105,6 +1446,9 @@ finish:
 	/* Destroy temporary data structure */
 	free(path);
 
+	/* The last extent might have been modified or a new one added */
+	ext4_extent_cache_invalidate(inode_ref->fs, inode_ref->index);
+
 	return rc;
 }
 
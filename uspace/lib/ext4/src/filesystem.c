@@ -35,14 +35,20 @@
  * @brief More complex filesystem operations.
  */
 
+#include <assert.h>
 #include <byteorder.h>
 #include <errno.h>
 #include <mem.h>
 #include <align.h>
 #include <crypto.h>
+#include <fibril.h>
+#include <fibril_synch.h>
 #include <ipc/vfs.h>
 #include <libfs.h>
+#include <macros.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <sys/time.h>
 #include "ext4/balloc.h"
 #include "ext4/bitmap.h"
 #include "ext4/block_group.h"
@@ -53,7 +59,15 @@
 #include "ext4/ops.h"
 #include "ext4/superblock.h"
 
+/** Number of descriptor table blocks prefetched in one request */
+#define EXT4_PREFETCH_GDT_CHUNK  64
+
+/** Number of block groups whose bitmaps are prefetched after mount */
+#define EXT4_PREFETCH_GROUPS  32
+
 static errno_t ext4_filesystem_check_features(ext4_filesystem_t *, bool *);
+static uint16_t ext4_filesystem_bg_checksum(ext4_superblock_t *, uint32_t,
+    ext4_block_group_t *);
 
 /** Initialize filesystem for opening.
  *
@@ -96,6 +110,12 @@ static errno_t ext4_filesystem_init(ext4_filesystem_t *fs, service_id_t service_
 	if (rc != EOK)
 		goto err_1;
 
+	rc = ext4_extent_cache_init(fs);
+	if (rc != EOK) {
+		block_cache_fini(fs->device);
+		goto err_1;
+	}
+
 	/* Compute limits for indirect block levels */
 	uint32_t block_ids_per_block = block_size / sizeof(uint32_t);
 	fs->inode_block_limits[0] = EXT4_INODE_DIRECT_BLOCK_COUNT;
@@ -130,8 +150,18 @@ static errno_t ext4_filesystem_init(ext4_filesystem_t *fs, service_id_t service_
 	if (rc != EOK)
 		goto err_2;
 
+	rc = ext4_balloc_init(fs);
+	if (rc != EOK)
+		goto err_2;
+
+	fibril_mutex_initialize(&fs->prefetch_lock);
+	fibril_condvar_initialize(&fs->prefetch_cv);
+	fs->prefetch_running = false;
+	fs->prefetch_stop = false;
+
 	return EOK;
 err_2:
+	ext4_extent_cache_fini(fs);
 	block_cache_fini(fs->device);
 err_1:
 	block_fini(fs->device);
@@ -148,14 +178,196 @@ err:
  */
 static void ext4_filesystem_fini(ext4_filesystem_t *fs)
 {
+	/* Wait for the metadata prefetch to notice it should stop */
+	fibril_mutex_lock(&fs->prefetch_lock);
+	fs->prefetch_stop = true;
+	while (fs->prefetch_running)
+		fibril_condvar_wait(&fs->prefetch_cv, &fs->prefetch_lock);
+	fibril_mutex_unlock(&fs->prefetch_lock);
+
 	/* Release memory space for superblock */
 	free(fs->superblock);
 
+	ext4_extent_cache_fini(fs);
+	ext4_balloc_fini(fs);
+
 	/* Finish work with block library */
 	block_cache_fini(fs->device);
 	block_fini(fs->device);
 }
 
+/** Check whether the metadata prefetch fibril was asked to stop. */
+static bool ext4_filesystem_prefetch_stopped(ext4_filesystem_t *fs)
+{
+	fibril_mutex_lock(&fs->prefetch_lock);
+	bool stop = fs->prefetch_stop;
+	fibril_mutex_unlock(&fs->prefetch_lock);
+
+	return stop;
+}
+
+/** Prefetch runs of adjacent blocks from a list of block addresses.
+ *
+ * @param fs    Filesystem
+ * @param addrs Block addresses in the order they were collected
+ * @param cnt   Number of addresses
+ *
+ * @return Number of blocks prefetched
+ *
+ */
+static size_t ext4_filesystem_prefetch_runs(ext4_filesystem_t *fs,
+    const uint64_t *addrs, size_t cnt)
+{
+	size_t done = 0;
+	size_t i = 0;
+
+	while (i < cnt && !ext4_filesystem_prefetch_stopped(fs)) {
+		size_t run = 1;
+		while (i + run < cnt && addrs[i + run] == addrs[i] + run)
+			run++;
+
+		if (block_prefetch(fs->device, addrs[i], run) != EOK)
+			break;
+
+		done += run;
+		i += run;
+	}
+
+	return done;
+}
+
+/** Metadata prefetch fibril.
+ *
+ * Mounting reads just the superblock and the root i-node. The block group
+ * descriptor table is brought into the block cache here in large requests,
+ * followed by the bitmaps of the groups the i-node allocator is going to
+ * look at first. Descriptors are read directly from the cached table
+ * blocks so that no uninitialized group is modified behind the back of
+ * the allocators.
+ *
+ * @param arg Filesystem
+ *
+ * @return Always EOK
+ *
+ */
+static errno_t ext4_filesystem_prefetch_fibril(void *arg)
+{
+	ext4_filesystem_t *fs = (ext4_filesystem_t *) arg;
+	ext4_superblock_t *sb = fs->superblock;
+	uint64_t start = getuptime_nsec();
+
+	uint32_t bg_count = ext4_superblock_get_block_group_count(sb);
+	uint32_t desc_size = ext4_superblock_get_desc_size(sb);
+	uint32_t descriptors_per_block =
+	    ext4_superblock_get_block_size(sb) / desc_size;
+	uint32_t gdt_blocks =
+	    (bg_count + descriptors_per_block - 1) / descriptors_per_block;
+	aoff64_t gdt_start = ext4_superblock_get_first_data_block(sb) + 1;
+	uint32_t avg_free_inodes =
+	    ext4_superblock_get_free_inodes_count(sb) / bg_count;
+
+	uint64_t bitmaps[2 * EXT4_PREFETCH_GROUPS];
+	size_t bitmap_cnt = 0;
+	unsigned groups = 0;
+	uint32_t gdt_done = 0;
+
+	while (gdt_done < gdt_blocks && !ext4_filesystem_prefetch_stopped(fs)) {
+		uint32_t cnt = min(gdt_blocks - gdt_done,
+		    (uint32_t) EXT4_PREFETCH_GDT_CHUNK);
+
+		if (block_prefetch(fs->device, gdt_start + gdt_done, cnt) != EOK)
+			break;
+
+		/* Pick the groups the i-node allocator is going to try first */
+		for (uint32_t i = gdt_done; i < gdt_done + cnt &&
+		    groups < EXT4_PREFETCH_GROUPS; i++) {
+			block_t *block;
+			if (block_get(&block, fs->device, gdt_start + i,
+			    BLOCK_FLAGS_NONE) != EOK)
+				break;
+
+			for (uint32_t j = 0; j < descriptors_per_block &&
+			    groups < EXT4_PREFETCH_GROUPS; j++) {
+				uint32_t bgid = i * descriptors_per_block + j;
+				if (bgid >= bg_count)
+					break;
+
+				ext4_block_group_t *bg = block->data + j * desc_size;
+				uint32_t free_inodes =
+				    ext4_block_group_get_free_inodes_count(bg, sb);
+				uint32_t free_blocks =
+				    ext4_block_group_get_free_blocks_count(bg, sb);
+
+				if (((free_inodes < avg_free_inodes) &&
+				    (bgid != bg_count - 1)) || (free_blocks == 0))
+					continue;
+
+				if (!ext4_block_group_has_flag(bg,
+				    EXT4_BLOCK_GROUP_INODE_UNINIT))
+					bitmaps[bitmap_cnt++] =
+					    ext4_block_group_get_inode_bitmap(bg, sb);
+				if (!ext4_block_group_has_flag(bg,
+				    EXT4_BLOCK_GROUP_BLOCK_UNINIT))
+					bitmaps[bitmap_cnt++] =
+					    ext4_block_group_get_block_bitmap(bg, sb);
+
+				groups++;
+			}
+
+			block_put(block);
+		}
+
+		gdt_done += cnt;
+	}
+
+	/* Collected as inode/block pairs, adjacent in flex_bg layouts */
+	uint64_t sorted[2 * EXT4_PREFETCH_GROUPS];
+	size_t sorted_cnt = 0;
+	for (size_t i = 0; i < bitmap_cnt; i++) {
+		size_t k = sorted_cnt++;
+		while (k > 0 && sorted[k - 1] > bitmaps[i]) {
+			sorted[k] = sorted[k - 1];
+			k--;
+		}
+		sorted[k] = bitmaps[i];
+	}
+
+	size_t prefetched = ext4_filesystem_prefetch_runs(fs, sorted,
+	    sorted_cnt);
+
+	printf("ext4: prefetched %" PRIu32 "/%" PRIu32 " descriptor blocks, "
+	    "%zu bitmaps of %u groups in %" PRIu64 " us\n", gdt_done,
+	    gdt_blocks, prefetched, groups,
+	    (getuptime_nsec() - start) / 1000);
+
+	fibril_mutex_lock(&fs->prefetch_lock);
+	fs->prefetch_running = false;
+	fibril_condvar_broadcast(&fs->prefetch_cv);
+	fibril_mutex_unlock(&fs->prefetch_lock);
+
+	return EOK;
+}
+
+/** Start prefetching metadata in the background.
+ *
+ * Failure to start the fibril only costs the prefetch, so it is ignored.
+ *
+ * @param fs Filesystem
+ *
+ */
+static void ext4_filesystem_prefetch_start(ext4_filesystem_t *fs)
+{
+	fid_t fid = fibril_create(ext4_filesystem_prefetch_fibril, fs);
+	if (fid == 0)
+		return;
+
+	fibril_mutex_lock(&fs->prefetch_lock);
+	fs->prefetch_running = true;
+	fibril_mutex_unlock(&fs->prefetch_lock);
+
+	fibril_add_ready(fid);
+}
+
 /** Probe filesystem.
  *
  * @param service_id Block device to probe
@@ -200,6 +412,7 @@ errno_t ext4_filesystem_open(ext4_instance_t *inst, service_id_t service_id,
 	ext4_filesystem_t *fs = NULL;
 	fs_node_t *root_node = NULL;
 	errno_t rc;
+	uint64_t start = getuptime_nsec();
 
 	fs = calloc(1, sizeof(ext4_filesystem_t));
 	if (fs == NULL) {
@@ -211,8 +424,14 @@ errno_t ext4_filesystem_open(ext4_instance_t *inst, service_id_t service_id,
 
 	/* Initialize the file system for opening */
 	rc = ext4_filesystem_init(fs, service_id, cmode);
-	if (rc != EOK)
+	if (rc != EOK) {
+		/* Nothing to finalize */
+		free(fs);
+		fs = NULL;
 		goto error;
+	}
+
+	uint64_t sb_done = getuptime_nsec();
 
 	/* Read root node */
 	rc = ext4_node_get_core(&root_node, inst, EXT4_INODE_ROOT_INDEX);
@@ -233,6 +452,15 @@ errno_t ext4_filesystem_open(ext4_instance_t *inst, service_id_t service_id,
 	*size = ext4_inode_get_size(fs->superblock, enode->inode_ref->inode);
 
 	ext4_node_put(root_node);
+
+	uint64_t end = getuptime_nsec();
+	printf("ext4: mounted in %" PRIu64 " us (superblock %" PRIu64
+	    " us, root i-node %" PRIu64 " us)\n", (end - start) / 1000,
+	    (sb_done - start) / 1000, (end - sb_done) / 1000);
+
+	/* Descriptors and bitmaps are loaded lazily, warm the cache meanwhile */
+	ext4_filesystem_prefetch_start(fs);
+
 	*rfs = fs;
 	return EOK;
 error:
@@ -579,6 +807,22 @@ errno_t ext4_filesystem_get_block_group_ref(ext4_filesystem_t *fs, uint32_t bgid
 	newref->index = bgid;
 	newref->dirty = false;
 
+	/* Descriptors are verified lazily, on their first use */
+	ext4_balloc_group_t *group = &fs->balloc_groups[bgid];
+	if (!group->checked) {
+		group->checked = true;
+
+		if (ext4_superblock_has_feature_read_only(fs->superblock,
+		    EXT4_FEATURE_RO_COMPAT_GDT_CSUM) &&
+		    ext4_block_group_get_checksum(newref->block_group) !=
+		    ext4_filesystem_bg_checksum(fs->superblock, bgid,
+		    newref->block_group)) {
+			printf("ext4: block group %" PRIu32 " descriptor checksum "
+			    "mismatch, not allocating from it\n", bgid);
+			group->corrupt = true;
+		}
+	}
+
 	*ref = newref;
 
 	if (ext4_block_group_has_flag(newref->block_group,
@@ -1036,6 +1280,7 @@ errno_t ext4_filesystem_free_inode(ext4_inode_ref_t *inode_ref)
 	    EXT4_FEATURE_INCOMPAT_EXTENTS)) &&
 	    (ext4_inode_has_flag(inode_ref->inode, EXT4_INODE_FLAG_EXTENTS))) {
 		/* Data structures are released during truncate operation... */
+		ext4_extent_cache_invalidate(fs, inode_ref->index);
 		goto finish;
 	}
 
@@ -1350,6 +1595,73 @@ errno_t ext4_filesystem_get_inode_data_block_index(ext4_inode_ref_t *inode_ref,
 	return EOK;
 }
 
+/** Get a run of physically contiguous data blocks of an i-node.
+ *
+ * @param inode_ref I-node to read block addresses from
+ * @param iblock    Logical index of the first block
+ * @param max       Maximum number of blocks to return
+ * @param fblock    Output pointer for the physical address of the first block,
+ *                  zero if the block is not allocated
+ * @param count     Output pointer for the number of blocks in the run, at
+ *                  least one
+ *
+ * @return Error code
+ *
+ */
+errno_t ext4_filesystem_get_inode_data_block_run(ext4_inode_ref_t *inode_ref,
+    aoff64_t iblock, uint32_t max, uint32_t *fblock, uint32_t *count)
+{
+	ext4_filesystem_t *fs = inode_ref->fs;
+	errno_t rc;
+
+	assert(max > 0);
+
+	if ((ext4_superblock_has_feature_incompatible(fs->superblock,
+	    EXT4_FEATURE_INCOMPAT_EXTENTS)) &&
+	    (ext4_inode_has_flag(inode_ref->inode, EXT4_INODE_FLAG_EXTENTS))) {
+		if (ext4_inode_get_size(fs->superblock, inode_ref->inode) == 0) {
+			*fblock = 0;
+			*count = 1;
+			return EOK;
+		}
+
+		rc = ext4_extent_find_run(inode_ref, iblock, fblock, count);
+		if (rc != EOK)
+			return rc;
+
+		*count = min(*count, max);
+		return EOK;
+	}
+
+	/*
+	 * Block maps do not describe runs, look up the following blocks one by
+	 * one. The indirect blocks are likely to be cached.
+	 */
+	rc = ext4_filesystem_get_inode_data_block_index(inode_ref, iblock,
+	    fblock);
+	if (rc != EOK)
+		return rc;
+
+	*count = 1;
+	if (*fblock == 0)
+		return EOK;
+
+	while (*count < max) {
+		uint32_t next;
+
+		rc = ext4_filesystem_get_inode_data_block_index(inode_ref,
+		    iblock + *count, &next);
+		if (rc != EOK)
+			return rc;
+
+		if (next != *fblock + *count)
+			break;
+		(*count)++;
+	}
+
+	return EOK;
+}
+
 /** Set physical block address for the block logical address into the i-node.
  *
  * @param inode_ref I-node to set block address to
@@ -208,10 +208,11 @@ errno_t ext4_ialloc_alloc_inode(ext4_filesystem_t *fs, uint32_t *index, bool is_
 		 * have less than the average number of free inodes,
 		 * but it still needs to be taken as a candidate
 		 * because the previous block groups have zero free
-		 * blocks.
+		 * blocks. Groups whose descriptor failed the checksum
+		 * check are never used.
 		 */
 		if (((free_inodes >= avg_free_inodes) || (bgid == bg_count - 1)) &&
-		    (free_blocks > 0)) {
+		    (free_blocks > 0) && !fs->balloc_groups[bgid].corrupt) {
 			/* Load block with bitmap */
 			uint32_t bitmap_block_addr = ext4_block_group_get_inode_bitmap(
 			    bg_ref->block_group, sb);
@@ -55,6 +55,15 @@
 #include "ext4/fstypes.h"
 #include "ext4/superblock.h"
 
+/**
+ * Reads of at least this many bytes are served by reading whole runs of
+ * contiguous blocks from the device, bypassing the block cache.
+ */
+#define EXT4_DIRECT_READ_MIN	(16 * 1024)
+
+/** Maximum size of a single read bypassing the block cache. */
+#define EXT4_DIRECT_READ_MAX	(64 * 1024)
+
 /* Forward declarations of auxiliary functions */
 
 static errno_t ext4_read_directory(cap_call_handle_t, aoff64_t, size_t,
@@ -1172,6 +1181,70 @@ errno_t ext4_read_directory(cap_call_handle_t chandle, aoff64_t pos, size_t size
 	}
 }
 
+/** Read data from file bypassing the block cache.
+ *
+ * Maps a run of physically contiguous blocks starting at pos and reads it
+ * with a single request to the block device.
+ *
+ * @param chandle   IPC id of call (for communication)
+ * @param pos       Position to start reading from, must be within the file
+ * @param size      How many bytes to read
+ * @param inst      Filesystem instance
+ * @param inode_ref Node to read data from
+ * @param rbytes    Output value to return real number of bytes was read
+ *
+ * @return Error code, ENOENT without answering the call if the data at pos
+ *         is not stored in a run of more than one block
+ *
+ */
+static errno_t ext4_read_file_direct(cap_call_handle_t chandle, aoff64_t pos,
+    size_t size, ext4_instance_t *inst, ext4_inode_ref_t *inode_ref,
+    size_t *rbytes)
+{
+	ext4_superblock_t *sb = inst->filesystem->superblock;
+	uint64_t file_size = ext4_inode_get_size(sb, inode_ref->inode);
+	uint32_t block_size = ext4_superblock_get_block_size(sb);
+	aoff64_t file_block = pos / block_size;
+	uint32_t offset_in_block = pos % block_size;
+
+	size = min(size, EXT4_DIRECT_READ_MAX - offset_in_block);
+	if (pos + size > file_size)
+		size = file_size - pos;
+
+	uint32_t max = (offset_in_block + size + block_size - 1) / block_size;
+	uint32_t fs_block;
+	uint32_t count;
+	errno_t rc = ext4_filesystem_get_inode_data_block_run(inode_ref,
+	    file_block, max, &fs_block, &count);
+	if (rc != EOK) {
+		async_answer_0(chandle, rc);
+		return rc;
+	}
+
+	if (fs_block == 0 || count < 2)
+		return ENOENT;
+
+	uint8_t *buffer = malloc(count * block_size);
+	if (buffer == NULL)
+		return ENOENT;
+
+	rc = block_read_uncached(inst->service_id, fs_block, count, buffer);
+	if (rc != EOK) {
+		free(buffer);
+		async_answer_0(chandle, rc);
+		return rc;
+	}
+
+	size_t bytes = min(size, count * block_size - offset_in_block);
+	rc = async_data_read_finalize(chandle, buffer + offset_in_block, bytes);
+	free(buffer);
+	if (rc != EOK)
+		return rc;
+
+	*rbytes = bytes;
+	return EOK;
+}
+
 /** Read data from file.
  *
  * @param chandle    IPC id of call (for communication)
@@ -1197,10 +1270,18 @@ errno_t ext4_read_file(cap_call_handle_t chandle, aoff64_t pos, size_t size,
 		return EOK;
 	}
 
-	/* For now, we only read data from one block at a time */
 	uint32_t block_size = ext4_superblock_get_block_size(sb);
 	aoff64_t file_block = pos / block_size;
 	uint32_t offset_in_block = pos % block_size;
+
+	if (size >= EXT4_DIRECT_READ_MIN && block_size <= EXT4_DIRECT_READ_MAX) {
+		errno_t rc = ext4_read_file_direct(chandle, pos, size, inst,
+		    inode_ref, rbytes);
+		if (rc != ENOENT)
+			return rc;
+	}
+
+	/* Otherwise we only read data from one block at a time */
 	uint32_t bytes = min(block_size - offset_in_block, size);
 
 	/* Handle end of file */
@@ -1474,7 +1555,11 @@ static errno_t ext4_sync(service_id_t service_id, fs_index_t index)
 	ext4_node_t *enode = EXT4_NODE(fn);
 	enode->inode_ref->dirty = true;
 
-	return ext4_node_put(fn);
+	rc = ext4_node_put(fn);
+	if (rc != EOK)
+		return rc;
+
+	return block_cache_sync(service_id);
 }
 
 /** VFS operations
@@ -39,6 +39,7 @@
 #include <errno.h>
 #include <async.h>
 #include <as.h>
+#include <align.h>
 #include <assert.h>
 #include <dirent.h>
 #include <mem.h>
@@ -80,6 +81,8 @@ static void libfs_open_node(libfs_ops_t *, fs_handle_t, cap_call_handle_t,
     ipc_call_t *);
 static void libfs_statfs(libfs_ops_t *, fs_handle_t, cap_call_handle_t,
     ipc_call_t *);
+static void libfs_readdir(libfs_ops_t *, fs_handle_t, cap_call_handle_t,
+    ipc_call_t *);
 
 static void vfs_out_fsprobe(cap_call_handle_t req_handle, ipc_call_t *req)
 {
@@ -236,11 +239,67 @@ static void vfs_out_open_node(cap_call_handle_t req_handle, ipc_call_t *req)
 	libfs_open_node(libfs_ops, reg.fs_handle, req_handle, req);
 }
 
+/** Open a node and read from it in one request.
+ *
+ * Combines VFS_OUT_OPEN_NODE with a VFS_OUT_READ at the given position so
+ * that VFS can open and read a small file in a single round trip. The
+ * IPC_M_DATA_READ for the data follows the request. If the read fails, the
+ * node is closed again.
+ */
+static void vfs_out_open_read(cap_call_handle_t req_handle, ipc_call_t *req)
+{
+	service_id_t service_id = (service_id_t) IPC_GET_ARG1(*req);
+	fs_index_t index = (fs_index_t) IPC_GET_ARG2(*req);
+	aoff64_t pos = (aoff64_t) MERGE_LOUP32(IPC_GET_ARG3(*req),
+	    IPC_GET_ARG4(*req));
+	cap_call_handle_t chandle;
+	size_t rbytes = 0;
+	size_t len;
+	fs_node_t *fn;
+	errno_t rc;
+
+	rc = libfs_ops->node_get(&fn, service_id, index);
+	if (rc == EOK && fn == NULL)
+		rc = ENOENT;
+	if (rc != EOK) {
+		if (async_data_read_receive(&chandle, &len))
+			async_answer_0(chandle, rc);
+		async_answer_0(req_handle, rc);
+		return;
+	}
+
+	rc = libfs_ops->node_open(fn);
+	if (rc != EOK) {
+		if (async_data_read_receive(&chandle, &len))
+			async_answer_0(chandle, rc);
+		async_answer_0(req_handle, rc);
+		(void) libfs_ops->node_put(fn);
+		return;
+	}
+
+	rc = vfs_out_ops->read(service_id, index, pos, &rbytes);
+	if (rc != EOK)
+		(void) vfs_out_ops->close(service_id, index);
+
+	aoff64_t size = libfs_ops->size_get(fn);
+	async_answer_5(req_handle, rc, LOWER32(size), UPPER32(size),
+	    libfs_ops->lnkcnt_get(fn),
+	    (libfs_ops->is_file(fn) ? L_FILE : 0) |
+	    (libfs_ops->is_directory(fn) ? L_DIRECTORY : 0), rbytes);
+
+	(void) libfs_ops->node_put(fn);
+}
+
 static void vfs_out_stat(cap_call_handle_t req_handle, ipc_call_t *req)
 {
 	libfs_stat(libfs_ops, reg.fs_handle, req_handle, req);
 }
 
+static void vfs_out_readdir(cap_call_handle_t req_handle, ipc_call_t *req)
+{
+	libfs_readdir(libfs_ops, reg.fs_handle, req_handle, req);
+}
+
 static void vfs_out_sync(cap_call_handle_t req_handle, ipc_call_t *req)
 {
 	service_id_t service_id = (service_id_t) IPC_GET_ARG1(*req);
@@ -317,6 +376,9 @@ static void vfs_connection(cap_call_handle_t icall_handle, ipc_call_t *icall,
 		case VFS_OUT_READ:
 			vfs_out_read(chandle, &call);
 			break;
+		case VFS_OUT_READDIR:
+			vfs_out_readdir(chandle, &call);
+			break;
 		case VFS_OUT_WRITE:
 			vfs_out_write(chandle, &call);
 			break;
@@ -332,6 +394,9 @@ static void vfs_connection(cap_call_handle_t icall_handle, ipc_call_t *icall,
 		case VFS_OUT_OPEN_NODE:
 			vfs_out_open_node(chandle, &call);
 			break;
+		case VFS_OUT_OPEN_READ:
+			vfs_out_open_read(chandle, &call);
+			break;
 		case VFS_OUT_STAT:
 			vfs_out_stat(chandle, &call);
 			break;
@@ -351,6 +416,43 @@ static void vfs_connection(cap_call_handle_t icall_handle, ipc_call_t *icall,
 	}
 }
 
+/** Serve a direct read session forwarded by VFS.
+ *
+ * VFS forwards the connection request only for a regular file opened for
+ * reading and fills in the service ID and index of its node. The session
+ * can read that node and nothing else.
+ */
+static void vfs_direct_connection(cap_call_handle_t icall_handle,
+    ipc_call_t *icall, void *arg)
+{
+	service_id_t service_id = (service_id_t) IPC_GET_ARG2(*icall);
+	fs_index_t index = (fs_index_t) IPC_GET_ARG3(*icall);
+
+	async_answer_0(icall_handle, EOK);
+
+	while (true) {
+		ipc_call_t call;
+		cap_call_handle_t chandle = async_get_call(&call);
+
+		if (!IPC_GET_IMETHOD(call))
+			return;
+
+		switch (IPC_GET_IMETHOD(call)) {
+		case VFS_OUT_READ:
+			if (((service_id_t) IPC_GET_ARG1(call) != service_id) ||
+			    ((fs_index_t) IPC_GET_ARG2(call) != index)) {
+				async_answer_0(chandle, EPERM);
+				break;
+			}
+			vfs_out_read(chandle, &call);
+			break;
+		default:
+			async_answer_0(chandle, ENOTSUP);
+			break;
+		}
+	}
+}
+
 /** Register file system server.
  *
  * This function abstracts away the tedious registration protocol from
@@ -400,9 +502,21 @@ errno_t fs_register(async_sess_t *sess, vfs_info_t *info, vfs_out_ops_t *vops,
 	str_cpy(fs_name, sizeof(fs_name), info->name);
 
 	/*
-	 * Ask VFS for callback connection.
+	 * Direct read sessions forwarded by VFS must not reach the full
+	 * VFS_OUT interface served by the fallback handler.
 	 */
 	port_id_t port;
+	rc = async_create_port(INTERFACE_VFS_DIRECT, vfs_direct_connection,
+	    NULL, &port);
+	if (rc != EOK) {
+		async_exchange_end(exch);
+		async_forget(req);
+		return rc;
+	}
+
+	/*
+	 * Ask VFS for callback connection.
+	 */
 	rc = async_create_callback_port(exch, INTERFACE_VFS_DRIVER_CB, 0, 0,
 	    vfs_connection, NULL, &port);
 
@@ -723,6 +837,22 @@ out:
 		(void) ops->node_put(tmp);
 }
 
+static void libfs_stat_fill(libfs_ops_t *ops, fs_handle_t fs_handle,
+    service_id_t service_id, fs_index_t index, fs_node_t *fn,
+    vfs_stat_t *stat)
+{
+	memset(stat, 0, sizeof(vfs_stat_t));
+
+	stat->fs_handle = fs_handle;
+	stat->service_id = service_id;
+	stat->index = index;
+	stat->lnkcnt = ops->lnkcnt_get(fn);
+	stat->is_file = ops->is_file(fn);
+	stat->is_directory = ops->is_directory(fn);
+	stat->size = ops->size_get(fn);
+	stat->service = ops->service_get(fn);
+}
+
 void libfs_stat(libfs_ops_t *ops, fs_handle_t fs_handle,
     cap_call_handle_t req_handle, ipc_call_t *request)
 {
@@ -744,16 +874,7 @@ void libfs_stat(libfs_ops_t *ops, fs_handle_t fs_handle,
 	}
 
 	vfs_stat_t stat;
-	memset(&stat, 0, sizeof(vfs_stat_t));
-
-	stat.fs_handle = fs_handle;
-	stat.service_id = service_id;
-	stat.index = index;
-	stat.lnkcnt = ops->lnkcnt_get(fn);
-	stat.is_file = ops->is_file(fn);
-	stat.is_directory = ops->is_directory(fn);
-	stat.size = ops->size_get(fn);
-	stat.service = ops->service_get(fn);
+	libfs_stat_fill(ops, fs_handle, service_id, index, fn, &stat);
 
 	ops->node_put(fn);
 
@@ -762,6 +883,127 @@ void libfs_stat(libfs_ops_t *ops, fs_handle_t fs_handle,
 	async_answer_0(req_handle, EOK);
 }
 
+/** State of a batched directory read in progress */
+typedef struct {
+	libfs_ops_t *ops;
+	fs_handle_t fs_handle;
+	service_id_t service_id;
+	uint8_t *buf;
+	size_t size;
+	size_t used;
+	errno_t rc;
+} libfs_readdir_t;
+
+static bool libfs_readdir_cb(void *arg, const char *name, fs_index_t index,
+    aoff64_t next)
+{
+	libfs_readdir_t *rd = (libfs_readdir_t *) arg;
+	size_t reclen = ALIGN_UP(sizeof(vfs_dirent_t) + str_size(name) + 1,
+	    VFS_DIRENT_ALIGN);
+
+	if (rd->used + reclen > rd->size) {
+		if (rd->used == 0)
+			rd->rc = EOVERFLOW;
+		return false;
+	}
+
+	fs_node_t *fn;
+	rd->rc = rd->ops->node_get(&fn, rd->service_id, index);
+	if (rd->rc == EOK && fn == NULL)
+		rd->rc = ENOENT;
+	if (rd->rc != EOK)
+		return false;
+
+	vfs_dirent_t *ent = (vfs_dirent_t *) (rd->buf + rd->used);
+	ent->reclen = reclen;
+	ent->next = next;
+	libfs_stat_fill(rd->ops, rd->fs_handle, rd->service_id, index, fn,
+	    &ent->stat);
+	str_cpy(ent->name, reclen - sizeof(vfs_dirent_t), name);
+
+	rd->rc = rd->ops->node_put(fn);
+	if (rd->rc != EOK)
+		return false;
+
+	rd->used += reclen;
+	return true;
+}
+
+/** Read a batch of directory entries along with their attributes.
+ *
+ * The entries are enumerated by the file system's readdir operation, the
+ * attributes are filled in the same way as by libfs_stat(). File systems
+ * that do not implement readdir get ENOTSUP and the client falls back to
+ * reading the entries one by one.
+ */
+void libfs_readdir(libfs_ops_t *ops, fs_handle_t fs_handle,
+    cap_call_handle_t req_handle, ipc_call_t *request)
+{
+	service_id_t service_id = (service_id_t) IPC_GET_ARG1(*request);
+	fs_index_t index = (fs_index_t) IPC_GET_ARG2(*request);
+	aoff64_t pos = MERGE_LOUP32(IPC_GET_ARG3(*request),
+	    IPC_GET_ARG4(*request));
+
+	cap_call_handle_t chandle;
+	size_t size;
+	if (!async_data_read_receive(&chandle, &size)) {
+		async_answer_0(chandle, EINVAL);
+		async_answer_0(req_handle, EINVAL);
+		return;
+	}
+
+	if (ops->readdir == NULL) {
+		async_answer_0(chandle, ENOTSUP);
+		async_answer_0(req_handle, ENOTSUP);
+		return;
+	}
+
+	fs_node_t *fn;
+	errno_t rc = ops->node_get(&fn, service_id, index);
+	if (rc == EOK && fn == NULL)
+		rc = ENOENT;
+	if (rc == EOK && !ops->is_directory(fn)) {
+		ops->node_put(fn);
+		rc = ENOTDIR;
+	}
+	if (rc != EOK) {
+		async_answer_0(chandle, rc);
+		async_answer_0(req_handle, rc);
+		return;
+	}
+
+	libfs_readdir_t rd;
+	rd.ops = ops;
+	rd.fs_handle = fs_handle;
+	rd.service_id = service_id;
+	rd.size = min(size, DATA_XFER_LIMIT);
+	rd.used = 0;
+	rd.rc = EOK;
+	rd.buf = malloc(rd.size);
+	if (rd.buf == NULL) {
+		ops->node_put(fn);
+		async_answer_0(chandle, ENOMEM);
+		async_answer_0(req_handle, ENOMEM);
+		return;
+	}
+
+	rc = ops->readdir(fn, pos, libfs_readdir_cb, &rd);
+	if (rc == EOK)
+		rc = rd.rc;
+	ops->node_put(fn);
+
+	if (rc != EOK) {
+		free(rd.buf);
+		async_answer_0(chandle, rc);
+		async_answer_0(req_handle, rc);
+		return;
+	}
+
+	async_data_read_finalize(chandle, rd.buf, rd.used);
+	free(rd.buf);
+	async_answer_1(req_handle, EOK, rd.used);
+}
+
 void libfs_statfs(libfs_ops_t *ops, fs_handle_t fs_handle,
     cap_call_handle_t req_handle, ipc_call_t *request)
 {
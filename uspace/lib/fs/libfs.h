@@ -58,6 +58,15 @@ typedef struct {
 	void *data;         /**< Data of the file system implementation. */
 } fs_node_t;
 
+/** Callback invoked by the readdir operation for each directory entry.
+ *
+ * Receives the name and index of the entry and the directory position of
+ * the entry that follows it. Returns false if the iteration should stop
+ * without consuming the entry.
+ */
+typedef bool (*libfs_readdir_cb_t)(void *, const char *, fs_index_t,
+    aoff64_t);
+
 typedef struct {
 	/*
 	 * The first set of methods are functions that return an integer error
@@ -74,6 +83,12 @@ typedef struct {
 	errno_t (*link)(fs_node_t *, fs_node_t *, const char *);
 	errno_t (*unlink)(fs_node_t *, fs_node_t *, const char *);
 	errno_t (*has_children)(bool *, fs_node_t *);
+	/*
+	 * Optional. Iterates over the entries of a directory starting at the
+	 * given position, calling the callback for each of them until it
+	 * returns false. Reaching the end of the directory is not an error.
+	 */
+	errno_t (*readdir)(fs_node_t *, aoff64_t, libfs_readdir_cb_t, void *);
 	/*
 	 * The second set of methods are usually mere getters that do not
 	 * return an integer error code.
@@ -156,7 +156,7 @@ bool update_canvas(canvas_t *canvas, surface_t *surface)
 	if (surface != NULL)
 		canvas->surface = surface;
 
-	canvas_repaint(&canvas->widget);
+	widget_invalidate(&canvas->widget);
 	return true;
 }
 
@@ -92,7 +92,7 @@ static void on_rewrite(widget_t *widget, void *data)
 		lbl->widget.width_ideal = lbl->widget.width_min;
 		lbl->widget.height_ideal = lbl->widget.height_min;
 
-		window_refresh(lbl->widget.window);
+		widget_invalidate(&lbl->widget);
 	}
 }
 
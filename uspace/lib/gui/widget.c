@@ -34,6 +34,7 @@
  */
 
 #include "widget.h"
+#include "window.h"
 
 /** Link widget with parent and initialize default position and size. */
 void widget_init(widget_t *widget, widget_t *parent, const void *data)
@@ -63,6 +64,9 @@ void widget_init(widget_t *widget, widget_t *parent, const void *data)
 	widget->height_ideal = 0;
 	widget->width_max = SIZE_MAX;
 	widget->height_max = SIZE_MAX;
+
+	widget->dirty = false;
+	widget->dirty_children = false;
 }
 
 /** Change position and size of the widget. */
@@ -81,6 +85,53 @@ const void *widget_get_data(widget_t *widget)
 	return widget->data;
 }
 
+/** Mark widget to be repainted.
+ *
+ * The widget and its descendants are repainted by the next window refresh,
+ * while the rest of the window is left alone and is not damaged. The refresh
+ * is posted unless the widget is already waiting for one.
+ */
+void widget_invalidate(widget_t *widget)
+{
+	if (widget->dirty)
+		return;
+
+	widget->dirty = true;
+	for (widget_t *anc = widget->parent; anc != NULL; anc = anc->parent)
+		anc->dirty_children = true;
+
+	if (widget->window)
+		window_refresh(widget->window);
+}
+
+/** Clear repaint marks of a subtree. */
+static void widget_clean(widget_t *widget)
+{
+	widget->dirty = false;
+
+	if (widget->dirty_children) {
+		widget->dirty_children = false;
+		list_foreach(widget->children, link, widget_t, child) {
+			widget_clean(child);
+		}
+	}
+}
+
+/** Repaint invalidated widgets of a subtree in top-bottom order. */
+void widget_update(widget_t *widget)
+{
+	if (widget->dirty) {
+		/* Repainting the widget repaints all its descendants as well. */
+		widget_clean(widget);
+		widget->repaint(widget);
+	} else if (widget->dirty_children) {
+		widget->dirty_children = false;
+		list_foreach(widget->children, link, widget_t, child) {
+			widget_update(child);
+		}
+	}
+}
+
 /** Unlink widget from its parent. */
 void widget_deinit(widget_t *widget)
 {
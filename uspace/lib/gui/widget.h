@@ -38,6 +38,7 @@
 
 #include <adt/list.h>
 #include <io/window.h>
+#include <stdbool.h>
 
 struct window;
 typedef struct window window_t;
@@ -68,6 +69,9 @@ struct widget {
 	sysarg_t width_max;
 	sysarg_t height_max;
 
+	bool dirty;          /**< Widget has to be repainted. */
+	bool dirty_children; /**< Some descendant has to be repainted. */
+
 	/**
 	 * Virtual destructor. Apart from deallocating the resources specific for
 	 * the particular widget, each widget shall remove itself from parents
@@ -97,9 +101,11 @@ struct widget {
 
 	/**
 	 * As a reaction to window refresh event, widget hierarchy is traversed
-	 * in top-bottom order and repaint() is called on each widget. Widget shall
-	 * either paint itself or copy its private buffer onto window surface.
-	 * Widget shall also post damage event into window event loop.
+	 * in top-bottom order and repaint() is called on each widget invalidated
+	 * by widget_invalidate(). Widget shall either paint itself or copy its
+	 * private buffer onto window surface and then call repaint() on each of
+	 * its children. Widget shall also post damage event into window event
+	 * loop.
 	 */
 	void (*repaint)(widget_t *);
 
@@ -107,7 +113,7 @@ struct widget {
 	 * Keyboard events are delivered to widgets that have keyboard focus. As a
 	 * reaction to the event, widget might call reconfigure() on its parent or
 	 * rearrange() on its children. If the widget wants to change its visual
-	 * information, refresh event should be posted to the window event loop.
+	 * information, it should call widget_invalidate() on itself.
 	 */
 	void (*handle_keyboard_event)(widget_t *, kbd_event_t);
 
@@ -115,8 +121,8 @@ struct widget {
 	 * Position events are delivered to those widgets that have mouse grab or
 	 * those that intersects with cursor. As a reaction to the event, widget
 	 * might call reconfigure() on its parent or rearrange() on its children.
-	 * If the widget wants to change its visual information, refresh event
-	 * should be posted to the window event loop. If the widget accepts
+	 * If the widget wants to change its visual information, it should call
+	 * widget_invalidate() on itself. If the widget accepts
 	 * keyboard events, it should take ownership of keyboard focus. Widget can
 	 * also acquire or release mouse grab.
 	 */
@@ -138,6 +144,9 @@ extern void widget_modify(widget_t *, sysarg_t, sysarg_t, sysarg_t, sysarg_t);
 extern const void *widget_get_data(widget_t *);
 extern void widget_deinit(widget_t *);
 
+extern void widget_invalidate(widget_t *);
+extern void widget_update(widget_t *);
+
 #endif
 
 /** @}
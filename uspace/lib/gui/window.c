@@ -41,6 +41,7 @@
 #include <as.h>
 #include <stdlib.h>
 #include <str.h>
+#include <mem.h>
 
 #include <fibril.h>
 #include <task.h>
@@ -386,10 +387,24 @@ static void handle_resize(window_t *win, sysarg_t offset_x, sysarg_t offset_y,
 	if (!new_surface)
 		return;
 
+	/*
+	 * The second buffer is what widgets paint into once the first one
+	 * is presented by the compositor.
+	 */
+	surface_t *new_back = surface_create(width, height, NULL,
+	    SURFACE_FLAG_SHARED);
+	if (!new_back) {
+		surface_destroy(new_surface);
+		return;
+	}
+
 	/* Switch new and old surface. */
 	fibril_mutex_lock(&win->guard);
 	surface_t *old_surface = win->surface;
+	surface_t *old_front = win->front;
+	sysarg_t old_back = win->back;
 	win->surface = new_surface;
+	win->front = NULL;
 	fibril_mutex_unlock(&win->guard);
 
 	/*
@@ -400,11 +415,14 @@ static void handle_resize(window_t *win, sysarg_t offset_x, sysarg_t offset_y,
 
 	fibril_mutex_lock(&win->guard);
 	surface_reset_damaged_region(win->surface);
+	memcpy(surface_direct_access(new_back),
+	    surface_direct_access(new_surface), width * height * sizeof(pixel_t));
 	fibril_mutex_unlock(&win->guard);
 
 	/* Inform compositor about new surface. */
-	errno_t rc = win_resize(win->osess, offset_x, offset_y, width, height,
-	    placement_flags, surface_direct_access(new_surface));
+	errno_t rc = win_resize_buffered(win->osess, offset_x, offset_y, width,
+	    height, placement_flags, surface_direct_access(new_surface),
+	    surface_direct_access(new_back));
 
 	if (rc != EOK) {
 		/* Rollback to old surface. Reverse all changes. */
@@ -417,6 +435,8 @@ static void handle_resize(window_t *win, sysarg_t offset_x, sysarg_t offset_y,
 		fibril_mutex_lock(&win->guard);
 		new_surface = win->surface;
 		win->surface = old_surface;
+		win->front = old_front;
+		win->back = old_back;
 		fibril_mutex_unlock(&win->guard);
 
 		win->root.rearrange(&win->root, 0, 0, old_width, old_height);
@@ -428,16 +448,57 @@ static void handle_resize(window_t *win, sysarg_t offset_x, sysarg_t offset_y,
 		}
 
 		surface_destroy(new_surface);
+		surface_destroy(new_back);
 	} else {
+		/* The compositor shows the first buffer, paint into the second. */
+		fibril_mutex_lock(&win->guard);
+		win->front = win->surface;
+		win->surface = new_back;
+		win->back = 1;
+		fibril_mutex_unlock(&win->guard);
+
 		/* Deallocate old surface. */
 		if (old_surface)
 			surface_destroy(old_surface);
+		if (old_front)
+			surface_destroy(old_front);
 	}
 }
 
 static void handle_refresh(window_t *win)
 {
-	win->root.repaint(&win->root);
+	widget_update(&win->root);
+}
+
+/** Repaint window decoration after change of focus or caption. */
+static void handle_decoration(window_t *win)
+{
+	if (win->is_decorated) {
+		paint_internal(&win->root);
+		window_damage(win);
+	}
+}
+
+/** Copy rectangle between two surfaces of the same resolution. */
+static void copy_region(surface_t *dst, surface_t *src, sysarg_t x,
+    sysarg_t y, sysarg_t width, sysarg_t height)
+{
+	pixelmap_t *dst_pixmap = surface_pixmap_access(dst);
+	pixelmap_t *src_pixmap = surface_pixmap_access(src);
+
+	if ((x >= src_pixmap->width) || (y >= src_pixmap->height))
+		return;
+
+	if (width > src_pixmap->width - x)
+		width = src_pixmap->width - x;
+	if (height > src_pixmap->height - y)
+		height = src_pixmap->height - y;
+
+	for (sysarg_t row = y; row < y + height; row++) {
+		memcpy(pixelmap_pixel_at(dst_pixmap, x, row),
+		    pixelmap_pixel_at(src_pixmap, x, row),
+		    width * sizeof(pixel_t));
+	}
 }
 
 static void handle_damage(window_t *win)
@@ -446,12 +507,40 @@ static void handle_damage(window_t *win)
 	fibril_mutex_lock(&win->guard);
 	surface_get_damaged_region(win->surface, &x, &y, &width, &height);
 	surface_reset_damaged_region(win->surface);
-	fibril_mutex_unlock(&win->guard);
 
-	if (width > 0 && height > 0) {
-		/* Notify compositor. */
-		win_damage(win->osess, x, y, width, height);
+	if ((width == 0) || (height == 0)) {
+		fibril_mutex_unlock(&win->guard);
+		return;
+	}
+
+	if (win->front) {
+		/*
+		 * Flip the buffers. The compositor stops reading the old front
+		 * buffer before it answers, so that one becomes the new back
+		 * buffer and only needs the freshly presented region to catch up.
+		 */
+		errno_t rc = win_present(win->osess, win->back, x, y, width,
+		    height);
+		if (rc == EOK) {
+			surface_t *presented = win->surface;
+			win->surface = win->front;
+			win->front = presented;
+			win->back = 1 - win->back;
+
+			copy_region(win->surface, win->front, x, y, width, height);
+		} else {
+			/* Keep painting into the same buffer. */
+			surface_add_damaged_region(win->surface, x, y, width, height);
+		}
+
+		fibril_mutex_unlock(&win->guard);
+		return;
 	}
+
+	fibril_mutex_unlock(&win->guard);
+
+	/* Notify compositor. */
+	win_damage(win->osess, x, y, width, height);
 }
 
 static void destroy_children(widget_t *widget)
@@ -486,6 +575,10 @@ static void handle_close(window_t *win)
 		surface_destroy(win->surface);
 	}
 
+	if (win->front) {
+		surface_destroy(win->front);
+	}
+
 	free(win->caption);
 
 	free(win);
@@ -508,7 +601,7 @@ static errno_t event_loop(void *arg)
 		case ET_POSITION_EVENT:
 			if (!win->is_focused) {
 				win->is_focused = true;
-				handle_refresh(win);
+				handle_decoration(win);
 			}
 			deliver_position_event(win, event->data.pos);
 			break;
@@ -523,13 +616,13 @@ static errno_t event_loop(void *arg)
 		case ET_WINDOW_FOCUS:
 			if (!win->is_focused) {
 				win->is_focused = true;
-				handle_refresh(win);
+				handle_decoration(win);
 			}
 			break;
 		case ET_WINDOW_UNFOCUS:
 			if (win->is_focused) {
 				win->is_focused = false;
-				handle_refresh(win);
+				handle_decoration(win);
 			}
 			break;
 		case ET_WINDOW_REFRESH:
@@ -615,6 +708,8 @@ window_t *window_open(const char *winreg, const void *data,
 	win->grab = NULL;
 	win->focus = NULL;
 	win->surface = NULL;
+	win->front = NULL;
+	win->back = 0;
 
 	service_id_t reg_dsid;
 	errno_t rc = loc_service_get_id(winreg, &reg_dsid, 0);
@@ -632,7 +727,8 @@ window_t *window_open(const char *winreg, const void *data,
 
 	service_id_t in_dsid;
 	service_id_t out_dsid;
-	rc = win_register(reg_sess, flags, &in_dsid, &out_dsid);
+	rc = win_register(reg_sess, flags | WINDOW_DOUBLE_BUFFERED, &in_dsid,
+	    &out_dsid);
 	async_hangup(reg_sess);
 	if (rc != EOK) {
 		free(win);
@@ -691,7 +787,7 @@ errno_t window_set_caption(window_t *win, const char *caption)
 	}
 
 	win->is_focused = false;
-	handle_refresh(win);
+	handle_decoration(win);
 
 	return EOK;
 }
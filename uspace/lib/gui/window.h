@@ -58,6 +58,8 @@ struct window {
 	widget_t *focus; /**< Widget owning the keyboard or NULL. */
 	fibril_mutex_t guard; /**< Mutex guarding window surface. */
 	surface_t *surface; /**< Window surface shared with compositor. */
+	surface_t *front; /**< Buffer currently presented by compositor. */
+	sysarg_t back; /**< Compositor index of the buffer being painted. */
 };
 
 /**
@@ -81,10 +83,12 @@ extern void window_resize(window_t *, sysarg_t, sysarg_t, sysarg_t, sysarg_t,
 extern errno_t window_set_caption(window_t *, const char *);
 
 /**
- * Post refresh event into event loop. Widget tree is traversed and all widgets
- * are asked to repaint themselves in top-bottom order. Should be called by
- * widget after such change of its internal state that does not need resizing
- * of neither parent nor children ().
+ * Post refresh event into event loop. Widget tree is traversed and widgets
+ * marked by widget_invalidate() are asked to repaint themselves in top-bottom
+ * order. Widgets normally do not call this directly, but invalidate themselves
+ * after such change of their internal state that does not need resizing of
+ * neither parent nor children. Invalidate the root widget to repaint the whole
+ * window.
  */
 extern void window_refresh(window_t *);
 
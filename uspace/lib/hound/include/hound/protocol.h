@@ -52,6 +52,8 @@ typedef enum {
 	HOUND_STREAM_DRAIN_ON_EXIT = 0x1,
 	HOUND_STREAM_IGNORE_UNDERFLOW = 0x2,
 	HOUND_STREAM_IGNORE_OVERFLOW = 0x4,
+	HOUND_STREAM_RESAMPLE_LINEAR = 0x8,
+	HOUND_STREAM_RESAMPLE_HIGH = 0x10,
 } hound_flags_t;
 
 typedef async_sess_t hound_sess_t;
@@ -119,6 +121,10 @@ typedef struct hound_server_iface {
 	errno_t (*drain_stream)(void *);
 	/** Write new data to the stream */
 	errno_t (*stream_data_write)(void *, void *, size_t);
+	/** Get stream buffer space to receive new data into (optional) */
+	errno_t (*stream_data_reserve)(void *, size_t, void **);
+	/** Make data received into the reserved space available */
+	errno_t (*stream_data_commit)(void *, size_t);
 	/** Read data from the stream */
 	errno_t (*stream_data_read)(void *, void *, size_t);
 	void *server;
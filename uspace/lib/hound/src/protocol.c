@@ -650,6 +650,21 @@ static void hound_server_read_data(void *stream)
 			continue;
 		}
 
+		/* receive straight into the stream buffer if possible */
+		void *region;
+		if (server_iface->stream_data_reserve &&
+		    server_iface->stream_data_commit &&
+		    server_iface->stream_data_reserve(stream, size,
+		    &region) == EOK) {
+			const errno_t ret =
+			    async_data_write_finalize(chandle, region, size);
+			if (ret == EOK) {
+				ret_answer = server_iface->stream_data_commit(
+				    stream, size);
+			}
+			continue;
+		}
+
 		char *buffer = malloc(size);
 		if (!buffer) {
 			async_answer_0(chandle, ENOMEM);
@@ -660,6 +675,8 @@ static void hound_server_read_data(void *stream)
 			/* push data to stream */
 			ret_answer = server_iface->stream_data_write(
 			    stream, buffer, size);
+		} else {
+			free(buffer);
 		}
 	}
 	const errno_t ret = IPC_GET_IMETHOD(call) == IPC_M_HOUND_STREAM_EXIT ?
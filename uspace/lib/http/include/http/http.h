@@ -63,6 +63,8 @@ typedef struct {
 	link_t link;
 	char *name;
 	char *value;
+	/** Name and value are stored in the same block as the header */
+	bool inplace;
 } http_header_t;
 
 typedef struct {
@@ -75,6 +77,19 @@ typedef struct {
 	http_headers_t headers;
 } http_request_t;
 
+/** Reader of a response body */
+typedef struct {
+	receive_buffer_t *rb;
+	/** Body uses chunked transfer coding */
+	bool chunked;
+	/** Body length is not known, read until the connection closes */
+	bool until_close;
+	/** Bytes left in the body or in the current chunk */
+	uint64_t remaining;
+	/** Whole body has been read */
+	bool done;
+} http_body_reader_t;
+
 typedef struct {
 	http_version_t version;
 	uint16_t status;
@@ -131,6 +146,9 @@ extern errno_t http_receive_status(receive_buffer_t *, http_version_t *, uint16_
 extern errno_t http_receive_response(receive_buffer_t *, http_response_t **,
     size_t, unsigned);
 extern void http_response_destroy(http_response_t *);
+extern errno_t http_body_init(http_body_reader_t *, receive_buffer_t *,
+    http_response_t *);
+extern errno_t http_body_read(http_body_reader_t *, void *, size_t, size_t *);
 extern errno_t http_close(http_t *);
 extern void http_destroy(http_t *);
 
@@ -87,6 +87,7 @@ extern errno_t recv_discard_str(receive_buffer_t *, const char *, size_t *);
 extern errno_t recv_while(receive_buffer_t *, char_class_func_t);
 extern errno_t recv_eol(receive_buffer_t *, size_t *);
 extern errno_t recv_line(receive_buffer_t *, char *, size_t, size_t *);
+extern errno_t recv_line_ref(receive_buffer_t *, char **, size_t *);
 
 #endif
 
@@ -36,6 +36,7 @@
 #include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <mem.h>
 #include <str.h>
 #include <macros.h>
 
@@ -49,6 +50,7 @@ void http_header_init(http_header_t *header)
 	link_initialize(&header->link);
 	header->name = NULL;
 	header->value = NULL;
+	header->inplace = false;
 }
 
 http_header_t *http_header_create(const char *name, const char *value)
@@ -74,10 +76,41 @@ http_header_t *http_header_create(const char *name, const char *value)
 	return header;
 }
 
+/** Create header with name and value stored in the same block
+ *
+ * @param name Header name, need not be terminated
+ * @param name_len Length of the name
+ * @param value Header value, need not be terminated
+ * @param value_len Length of the value
+ * @return New header or NULL if out of memory
+ */
+static http_header_t *http_header_create_inplace(const char *name,
+    size_t name_len, const char *value, size_t value_len)
+{
+	http_header_t *header = malloc(sizeof(http_header_t) + name_len +
+	    value_len + 2);
+	if (header == NULL)
+		return NULL;
+	http_header_init(header);
+
+	header->name = (char *) (header + 1);
+	memcpy(header->name, name, name_len);
+	header->name[name_len] = '\0';
+
+	header->value = header->name + name_len + 1;
+	memcpy(header->value, value, value_len);
+	header->value[value_len] = '\0';
+
+	header->inplace = true;
+	return header;
+}
+
 void http_header_destroy(http_header_t *header)
 {
-	free(header->name);
-	free(header->value);
+	if (!header->inplace) {
+		free(header->name);
+		free(header->value);
+	}
 	free(header);
 }
 
@@ -304,6 +337,18 @@ errno_t http_headers_set(http_headers_t *headers, const char *name,
 	if (rc == HTTP_EMISSING_HEADER)
 		return http_headers_append(headers, name, value);
 
+	if (header->inplace) {
+		http_header_t *new_header = http_header_create(header->name,
+		    value);
+		if (new_header == NULL)
+			return ENOMEM;
+
+		list_insert_before(&new_header->link, &header->link);
+		http_headers_remove(headers, header);
+		http_header_destroy(header);
+		return EOK;
+	}
+
 	char *new_value = str_dup(value);
 	if (new_value == NULL)
 		return ENOMEM;
@@ -324,40 +369,115 @@ errno_t http_headers_get(http_headers_t *headers, const char *name, char **value
 	return EOK;
 }
 
+/** Append a folded line to the value of a received header
+ *
+ * @return EOK on success, ENOMEM if out of memory
+ */
+static errno_t http_header_fold(http_headers_t *headers,
+    http_header_t *header, const char *cont, size_t cont_len)
+{
+	size_t name_len = str_size(header->name);
+	size_t value_len = str_size(header->value);
+
+	http_header_t *new_header = http_header_create_inplace(header->name,
+	    name_len, header->value, value_len + 1 + cont_len);
+	if (new_header == NULL)
+		return ENOMEM;
+
+	new_header->value[value_len] = ' ';
+	memcpy(new_header->value + value_len + 1, cont, cont_len);
+	new_header->value[value_len + 1 + cont_len] = '\0';
+
+	list_insert_before(&new_header->link, &header->link);
+	http_headers_remove(headers, header);
+	http_header_destroy(header);
+	return EOK;
+}
+
+/** Receive header lines up to and including the empty line ending them
+ *
+ * Each line is parsed directly in the receive buffer and the header is
+ * allocated as a single block holding both name and value.
+ *
+ * @param limit_alloc Maximum total size of header names and values or 0
+ * @param limit_count Maximum number of headers or 0
+ * @return EOK on success or an error code
+ */
 errno_t http_headers_receive(receive_buffer_t *rb, http_headers_t *headers,
     size_t limit_alloc, unsigned limit_count)
 {
 	errno_t rc = EOK;
 	unsigned added = 0;
+	size_t used = 0;
 
 	while (true) {
-		char c = 0;
-		rc = recv_char(rb, &c, false);
+		char *line;
+		size_t len;
+		rc = recv_line_ref(rb, &line, &len);
 		if (rc != EOK)
 			goto error;
 
-		if (c == '\n' || c == '\r')
+		if (len == 0)
 			break;
 
+		if (line[0] == ' ' || line[0] == '\t') {
+			/* Continuation of the previous header value */
+			if (added == 0) {
+				rc = HTTP_EPARSE;
+				goto error;
+			}
+
+			size_t skip = 0;
+			while (skip < len && is_lws(line[skip]))
+				skip++;
+
+			used += len - skip + 1;
+			if (limit_alloc > 0 && used > limit_alloc) {
+				rc = ELIMIT;
+				goto error;
+			}
+
+			link_t *link = list_last(&headers->list);
+			rc = http_header_fold(headers,
+			    list_get_instance(link, http_header_t, link),
+			    line + skip, len - skip);
+			if (rc != EOK)
+				goto error;
+			continue;
+		}
+
 		if (limit_count > 0 && added >= limit_count) {
 			rc = ELIMIT;
 			goto error;
 		}
 
-		http_header_t *header = malloc(sizeof(http_header_t));
-		if (header == NULL) {
-			rc = ENOMEM;
+		size_t name_len = 0;
+		while (name_len < len && is_token(line[name_len]))
+			name_len++;
+
+		if (name_len == 0 || name_len == len || line[name_len] != ':') {
+			rc = EINVAL;
 			goto error;
 		}
-		http_header_init(header);
 
-		size_t header_size;
-		rc = http_header_receive(rb, header, limit_alloc, &header_size);
-		if (rc != EOK) {
-			free(header);
+		size_t value_start = name_len + 1;
+		while (value_start < len &&
+		    (line[value_start] == ' ' || line[value_start] == '\t'))
+			value_start++;
+
+		size_t value_len = len - value_start;
+		used += name_len + value_len;
+		if (limit_alloc > 0 && used > limit_alloc) {
+			rc = ELIMIT;
+			goto error;
+		}
+
+		http_header_t *header = http_header_create_inplace(line,
+		    name_len, line + value_start, value_len);
+		if (header == NULL) {
+			rc = ENOMEM;
 			goto error;
 		}
-		limit_alloc -= header_size;
 
 		http_headers_append_header(headers, header);
 		added++;
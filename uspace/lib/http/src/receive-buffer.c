@@ -35,11 +35,13 @@
  */
 
 #include <stdlib.h>
+#include <mem.h>
 #include <str.h>
 #include <errno.h>
 #include <macros.h>
 #include <adt/list.h>
 
+#include <http/http.h>
 #include <http/receive-buffer.h>
 
 errno_t recv_buffer_init(receive_buffer_t *rb, size_t buffer_size,
@@ -145,35 +147,55 @@ errno_t recv_cut_str(receive_buffer_t *rb, receive_buffer_mark_t *a, receive_buf
 }
 
 
+/** Receive more data behind the buffered ones.
+ *
+ * Data before the lowest mark (or before @c out if there is no mark) are
+ * dropped to make room if the buffer is full.
+ *
+ * @param nrecv Place to store number of bytes received, zero at end of stream
+ * @return EOK on success, ELIMIT if the buffer cannot take more data
+ */
+static errno_t recv_fill(receive_buffer_t *rb, size_t *nrecv)
+{
+	size_t free = rb->size - rb->in;
+	if (free == 0) {
+		size_t min_mark = rb->out;
+		list_foreach(rb->marks, link, receive_buffer_mark_t, mark) {
+			min_mark = min(min_mark, mark->offset);
+		}
+
+		if (min_mark == 0)
+			return ELIMIT;
+
+		size_t new_in = rb->in - min_mark;
+		memmove(rb->buffer, rb->buffer + min_mark, new_in);
+		rb->in = new_in;
+		rb->out -= min_mark;
+		free = rb->size - rb->in;
+		list_foreach(rb->marks, link, receive_buffer_mark_t, mark) {
+			mark->offset -= min_mark;
+		}
+	}
+
+	errno_t rc = rb->receive(rb->client_data, rb->buffer + rb->in, free,
+	    nrecv);
+	if (rc != EOK)
+		return rc;
+
+	rb->in += *nrecv;
+	return EOK;
+}
+
 /** Receive one character (with buffering) */
 errno_t recv_char(receive_buffer_t *rb, char *c, bool consume)
 {
 	if (rb->out == rb->in) {
-		size_t free = rb->size - rb->in;
-		if (free == 0) {
-			size_t min_mark = rb->size;
-			list_foreach(rb->marks, link, receive_buffer_mark_t, mark) {
-				min_mark = min(min_mark, mark->offset);
-			}
-
-			if (min_mark == 0)
-				return ELIMIT;
-
-			size_t new_in = rb->in - min_mark;
-			memmove(rb->buffer, rb->buffer + min_mark, new_in);
-			rb->out = rb->in = new_in;
-			free = rb->size - rb->in;
-			list_foreach(rb->marks, link, receive_buffer_mark_t, mark) {
-				mark->offset -= min_mark;
-			}
-		}
-
 		size_t nrecv;
-		errno_t rc = rb->receive(rb->client_data, rb->buffer + rb->in, free, &nrecv);
+		errno_t rc = recv_fill(rb, &nrecv);
 		if (rc != EOK)
 			return rc;
-
-		rb->in = nrecv;
+		if (nrecv == 0)
+			return HTTP_EPARSE;
 	}
 
 	*c = rb->buffer[rb->out];
@@ -182,6 +204,46 @@ errno_t recv_char(receive_buffer_t *rb, char *c, bool consume)
 	return EOK;
 }
 
+/** Receive a line without copying it.
+ *
+ * The buffered data are scanned in bulk for the end of line. The line is
+ * terminated in place and the returned pointer refers to the receive
+ * buffer, so it is valid only until the next receive operation.
+ *
+ * @param line Place to store pointer to the line (without the line end)
+ * @param len Place to store length of the line
+ * @return EOK on success, ELIMIT if the line does not fit the buffer
+ */
+errno_t recv_line_ref(receive_buffer_t *rb, char **line, size_t *len)
+{
+	size_t scanned = 0;
+
+	while (true) {
+		char *start = rb->buffer + rb->out;
+		char *nl = memchr(start + scanned, '\n',
+		    rb->in - rb->out - scanned);
+		if (nl != NULL) {
+			size_t n = nl - start;
+			rb->out += n + 1;
+			if (n > 0 && start[n - 1] == '\r')
+				n--;
+			start[n] = '\0';
+			*line = start;
+			*len = n;
+			return EOK;
+		}
+
+		scanned = rb->in - rb->out;
+
+		size_t nrecv;
+		errno_t rc = recv_fill(rb, &nrecv);
+		if (rc != EOK)
+			return rc;
+		if (nrecv == 0)
+			return HTTP_EPARSE;
+	}
+}
+
 errno_t recv_buffer(receive_buffer_t *rb, char *buf, size_t buf_size,
     size_t *nrecv)
 {
@@ -46,143 +46,71 @@ static bool is_digit(char c)
 	return (c >= '0' && c <= '9');
 }
 
-static errno_t receive_number(receive_buffer_t *rb, char **str)
-{
-	receive_buffer_mark_t start;
-	receive_buffer_mark_t end;
-
-	recv_mark(rb, &start);
-	errno_t rc = recv_while(rb, is_digit);
-	if (rc != EOK) {
-		recv_unmark(rb, &start);
-		return rc;
-	}
-	recv_mark(rb, &end);
-
-	rc = recv_cut_str(rb, &start, &end, str);
-	recv_unmark(rb, &start);
-	recv_unmark(rb, &end);
-	return rc;
-}
-
-static errno_t receive_uint8_t(receive_buffer_t *rb, uint8_t *out_value)
-{
-	char *str = NULL;
-	errno_t rc = receive_number(rb, &str);
-
-	if (rc != EOK)
-		return rc;
-
-	rc = str_uint8_t(str, NULL, 10, true, out_value);
-	free(str);
-
-	return rc;
-}
-
-static errno_t receive_uint16_t(receive_buffer_t *rb, uint16_t *out_value)
+/** Parse a decimal number at the start of a status line field
+ *
+ * @param str Pointer to the field, advanced past the number
+ * @param delim Character that must follow the number
+ * @param max Maximum value of the number
+ * @return Number or -1 if the field is malformed
+ */
+static int parse_number(char **str, char delim, int max)
 {
-	char *str = NULL;
-	errno_t rc = receive_number(rb, &str);
+	char *p = *str;
+	int value = 0;
 
-	if (rc != EOK)
-		return rc;
+	if (!is_digit(*p))
+		return -1;
 
-	rc = str_uint16_t(str, NULL, 10, true, out_value);
-	free(str);
+	while (is_digit(*p)) {
+		value = value * 10 + (*p - '0');
+		if (value > max)
+			return -1;
+		p++;
+	}
 
-	return rc;
-}
+	if (*p != delim)
+		return -1;
 
-static errno_t expect(receive_buffer_t *rb, const char *expect)
-{
-	size_t ndisc;
-	errno_t rc = recv_discard_str(rb, expect, &ndisc);
-	if (rc != EOK)
-		return rc;
-	if (ndisc < str_length(expect))
-		return HTTP_EPARSE;
-	return EOK;
-}
-
-static bool is_not_newline(char c)
-{
-	return (c != '\n' && c != '\r');
+	*str = p + 1;
+	return value;
 }
 
 errno_t http_receive_status(receive_buffer_t *rb, http_version_t *out_version,
     uint16_t *out_status, char **out_message)
 {
-	http_version_t version;
-	uint16_t status;
-	char *message = NULL;
-
-	errno_t rc = expect(rb, "HTTP/");
-	if (rc != EOK)
-		return rc;
-
-	rc = receive_uint8_t(rb, &version.major);
-	if (rc != EOK)
-		return rc;
-
-	rc = expect(rb, ".");
-	if (rc != EOK)
-		return rc;
-
-	rc = receive_uint8_t(rb, &version.minor);
-	if (rc != EOK)
-		return rc;
-
-	rc = expect(rb, " ");
-	if (rc != EOK)
-		return rc;
-
-	rc = receive_uint16_t(rb, &status);
-	if (rc != EOK)
-		return rc;
-
-	rc = expect(rb, " ");
+	char *line;
+	size_t len;
+	errno_t rc = recv_line_ref(rb, &line, &len);
 	if (rc != EOK)
 		return rc;
 
-	receive_buffer_mark_t msg_start;
-	recv_mark(rb, &msg_start);
-
-	rc = recv_while(rb, is_not_newline);
-	if (rc != EOK) {
-		recv_unmark(rb, &msg_start);
-		return rc;
-	}
+	if (str_lcmp(line, "HTTP/", 5) != 0)
+		return HTTP_EPARSE;
 
-	receive_buffer_mark_t msg_end;
-	recv_mark(rb, &msg_end);
+	char *p = line + 5;
+	int major = parse_number(&p, '.', UINT8_MAX);
+	if (major < 0)
+		return HTTP_EPARSE;
+	int minor = parse_number(&p, ' ', UINT8_MAX);
+	if (minor < 0)
+		return HTTP_EPARSE;
+	int status = parse_number(&p, ' ', UINT16_MAX);
+	if (status < 0)
+		return HTTP_EPARSE;
 
 	if (out_message) {
-		rc = recv_cut_str(rb, &msg_start, &msg_end, &message);
-		if (rc != EOK) {
-			recv_unmark(rb, &msg_start);
-			recv_unmark(rb, &msg_end);
-			return rc;
-		}
+		char *message = str_dup(p);
+		if (message == NULL)
+			return ENOMEM;
+		*out_message = message;
 	}
 
-	recv_unmark(rb, &msg_start);
-	recv_unmark(rb, &msg_end);
-
-	size_t nrecv;
-	rc = recv_eol(rb, &nrecv);
-	if (rc == EOK && nrecv == 0)
-		rc = HTTP_EPARSE;
-	if (rc != EOK) {
-		free(message);
-		return rc;
+	if (out_version) {
+		out_version->major = major;
+		out_version->minor = minor;
 	}
-
-	if (out_version)
-		*out_version = version;
 	if (out_status)
 		*out_status = status;
-	if (out_message)
-		*out_message = message;
 	return EOK;
 }
 
@@ -205,13 +133,6 @@ errno_t http_receive_response(receive_buffer_t *rb, http_response_t **out_respon
 	if (rc != EOK)
 		goto error;
 
-	size_t nrecv;
-	rc = recv_eol(rb, &nrecv);
-	if (rc == EOK && nrecv == 0)
-		rc = HTTP_EPARSE;
-	if (rc != EOK)
-		goto error;
-
 	*out_response = resp;
 
 	return EOK;
@@ -227,5 +148,149 @@ void http_response_destroy(http_response_t *resp)
 	free(resp);
 }
 
+/** Prepare reading of a response body
+ *
+ * The body length is taken from Transfer-Encoding or Content-Length, if
+ * neither is present the body extends to the end of the connection.
+ *
+ * @param reader Reader to initialize
+ * @param rb Receive buffer positioned just after the response headers
+ * @param resp Received response
+ * @return EOK on success, HTTP_EPARSE if the headers are malformed
+ */
+errno_t http_body_init(http_body_reader_t *reader, receive_buffer_t *rb,
+    http_response_t *resp)
+{
+	char *value;
+
+	reader->rb = rb;
+	reader->chunked = false;
+	reader->until_close = false;
+	reader->remaining = 0;
+	reader->done = false;
+
+	errno_t rc = http_headers_get(&resp->headers, "Transfer-Encoding",
+	    &value);
+	if (rc == EOK && str_casecmp(value, "identity") != 0) {
+		reader->chunked = true;
+		return EOK;
+	}
+
+	rc = http_headers_get(&resp->headers, "Content-Length", &value);
+	if (rc == EOK) {
+		rc = str_uint64_t(value, NULL, 10, true, &reader->remaining);
+		if (rc != EOK)
+			return HTTP_EPARSE;
+		reader->done = (reader->remaining == 0);
+		return EOK;
+	}
+
+	if (rc != HTTP_EMISSING_HEADER)
+		return rc;
+
+	reader->until_close = true;
+	return EOK;
+}
+
+/** Receive the size line of the next chunk
+ *
+ * The terminating zero-size chunk also consumes any trailer lines.
+ */
+static errno_t http_body_next_chunk(http_body_reader_t *reader)
+{
+	char *line;
+	size_t len;
+	errno_t rc = recv_line_ref(reader->rb, &line, &len);
+	if (rc != EOK)
+		return rc;
+
+	/* Chunk extensions are ignored */
+	char *ext = str_chr(line, ';');
+	if (ext != NULL)
+		*ext = '\0';
+
+	const char *end;
+	rc = str_uint64_t(line, &end, 16, false, &reader->remaining);
+	if (rc != EOK || end == line)
+		return HTTP_EPARSE;
+
+	if (reader->remaining > 0)
+		return EOK;
+
+	/* Last chunk, skip the trailer */
+	do {
+		rc = recv_line_ref(reader->rb, &line, &len);
+		if (rc != EOK)
+			return rc;
+	} while (len > 0);
+
+	reader->done = true;
+	return EOK;
+}
+
+/** Read part of a response body
+ *
+ * Chunked transfer coding is decoded as the data pass through, without
+ * collecting the body first.
+ *
+ * @param reader Body reader
+ * @param buf Buffer to store the data
+ * @param size Size of the buffer
+ * @param nrecv Place to store number of bytes read, zero at end of body
+ * @return EOK on success or an error code
+ */
+errno_t http_body_read(http_body_reader_t *reader, void *buf, size_t size,
+    size_t *nrecv)
+{
+	errno_t rc;
+
+	if (reader->done || size == 0) {
+		*nrecv = 0;
+		return EOK;
+	}
+
+	if (reader->until_close) {
+		rc = recv_buffer(reader->rb, buf, size, nrecv);
+		if (rc == EOK && *nrecv == 0)
+			reader->done = true;
+		return rc;
+	}
+
+	if (reader->chunked && reader->remaining == 0) {
+		rc = http_body_next_chunk(reader);
+		if (rc != EOK)
+			return rc;
+		if (reader->done) {
+			*nrecv = 0;
+			return EOK;
+		}
+	}
+
+	rc = recv_buffer(reader->rb, buf, min(size, reader->remaining), nrecv);
+	if (rc != EOK)
+		return rc;
+	if (*nrecv == 0)
+		return HTTP_EPARSE;
+
+	reader->remaining -= *nrecv;
+	if (reader->remaining > 0)
+		return EOK;
+
+	if (reader->chunked) {
+		/* Consume the line end following the chunk data */
+		char *line;
+		size_t len;
+		rc = recv_line_ref(reader->rb, &line, &len);
+		if (rc != EOK)
+			return rc;
+		if (len != 0)
+			return HTTP_EPARSE;
+	} else {
+		reader->done = true;
+	}
+
+	return EOK;
+}
+
 /** @}
  */
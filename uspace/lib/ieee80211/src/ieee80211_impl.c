@@ -226,6 +226,11 @@ errno_t ieee80211_aes_key_unwrap(uint8_t *kek, uint8_t *data, size_t data_size,
 	if (!output)
 		return ENOMEM;
 
+	aes_key_t key;
+	errno_t rc = aes_key_init(&key, kek, AES_CIPHER_LENGTH);
+	if (rc != EOK)
+		return rc;
+
 	uint32_t n = data_size / 8 - 1;
 	uint8_t work_data[n * 8];
 	uint8_t work_input[AES_CIPHER_LENGTH];
@@ -250,7 +255,7 @@ errno_t ieee80211_aes_key_unwrap(uint8_t *kek, uint8_t *data, size_t data_size,
 			work_block = work_data + (i - 1) * 8;
 			memcpy(work_input, a, 8);
 			memcpy(work_input + 8, work_block, 8);
-			aes_decrypt(kek, work_input, work_output);
+			aes_decrypt_blocks(&key, work_input, work_output, 1);
 			memcpy(a, work_output, 8);
 			memcpy(work_data + (i - 1) * 8, work_output + 8, 8);
 		}
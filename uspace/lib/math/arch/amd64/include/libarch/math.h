@@ -62,6 +62,9 @@
 
 #define HUGE_VAL FLOAT64_INF
 
+/** vsqrt_f32() and vsqrt_f64() are implemented using SSE2 */
+#define LIBARCH_VSQRT
+
 static inline float64_t acos_f64(float64_t val)
 {
 	return float64_acos(val);
@@ -245,15 +248,8 @@ static inline float32_t sinh_f32(float32_t val)
 	return float32_sinh(val);
 }
 
-static inline float64_t sqrt_f64(float64_t val)
-{
-	return float64_sqrt(val);
-}
-
-static inline float32_t sqrt_f32(float32_t val)
-{
-	return float32_sqrt(val);
-}
+extern float64_t sqrt_f64(float64_t);
+extern float32_t sqrt_f32(float32_t);
 
 static inline float64_t tan_f64(float64_t val)
 {
@@ -245,15 +245,8 @@ static inline float32_t sinh_f32(float32_t val)
 	return float32_sinh(val);
 }
 
-static inline float64_t sqrt_f64(float64_t val)
-{
-	return float64_sqrt(val);
-}
-
-static inline float32_t sqrt_f32(float32_t val)
-{
-	return float32_sqrt(val);
-}
+extern float64_t sqrt_f64(float64_t);
+extern float32_t sqrt_f32(float32_t);
 
 static inline float64_t tan_f64(float64_t val)
 {
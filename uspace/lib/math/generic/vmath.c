@@ -0,0 +1,185 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup libmath
+ * @{
+ */
+/** @file Batch versions of mathematical functions.
+ *
+ * The element kernels are free of branches and table lookups so that
+ * the compiler can vectorize the loops using the SIMD instructions of
+ * the target (e.g. SSE2 or NEON). Architectures with a more suitable
+ * native implementation of a function provide it instead and define
+ * the respective LIBARCH_V* macro in libarch/math.h.
+ */
+
+#include <math.h>
+#include <vmath.h>
+
+/** ln(2) split into a part exactly multipliable by small integers and the rest */
+#define LN2_HI_32  6.93145751953125e-01f
+#define LN2_LO_32  1.42860676533018704e-06f
+#define LN2_HI_64  6.93147180369123816490e-01
+#define LN2_LO_64  1.90821492927058770002e-10
+
+/*
+ * Arguments beyond these bounds overflow to infinity or underflow
+ * to zero anyway, clamping them keeps the exponents in range.
+ */
+#define EXP_MIN_32  -104.0f
+#define EXP_MAX_32  89.0f
+#define EXP_MIN_64  -746.0
+#define EXP_MAX_64  710.0
+
+/** Exponential kernel (32-bit floating point)
+ *
+ * The argument is reduced to r = arg - n * ln(2) with |r| <= ln(2) / 2,
+ * e^r is approximated by a polynomial and the result is scaled by 2^n.
+ * The scaling is done in two steps, so that the intermediate scale
+ * factors are always normal numbers.
+ *
+ * @param arg Exponential argument.
+ *
+ * @return Exponential value.
+ *
+ */
+static inline float32_t exp_kernel_f32(float32_t arg)
+{
+	/*
+	 * NaN passes through the clamping and propagates to the result
+	 * through the polynomial, whatever the scale factors turn out to be.
+	 */
+	float32_t x = (arg > EXP_MAX_32) ? EXP_MAX_32 : arg;
+	x = (x < EXP_MIN_32) ? EXP_MIN_32 : x;
+
+	float32_t t = x * (float32_t) M_LOG2E;
+	int32_t n = (int32_t) (t + ((t < 0) ? -0.5f : 0.5f));
+	float32_t r = x - (float32_t) n * LN2_HI_32 -
+	    (float32_t) n * LN2_LO_32;
+
+	float32_t p = 1.0f + r * (1.0f + r * (1.0f / 2 + r * (1.0f / 6 +
+	    r * (1.0f / 24 + r * (1.0f / 120 + r * (1.0f / 720 +
+	    r * (1.0f / 5040)))))));
+
+	int32_t a = n / 2;
+	float32_u sa;
+	float32_u sb;
+	sa.data.bin = (uint32_t) (a + 127) << FLOAT32_FRACTION_SIZE;
+	sb.data.bin = (uint32_t) (n - a + 127) << FLOAT32_FRACTION_SIZE;
+
+	return p * sa.val * sb.val;
+}
+
+/** Exponential kernel (64-bit floating point)
+ *
+ * @see exp_kernel_f32()
+ *
+ * @param arg Exponential argument.
+ *
+ * @return Exponential value.
+ *
+ */
+static inline float64_t exp_kernel_f64(float64_t arg)
+{
+	float64_t x = (arg > EXP_MAX_64) ? EXP_MAX_64 : arg;
+	x = (x < EXP_MIN_64) ? EXP_MIN_64 : x;
+
+	float64_t t = x * M_LOG2E;
+	int32_t n = (int32_t) (t + ((t < 0) ? -0.5 : 0.5));
+	float64_t r = x - (float64_t) n * LN2_HI_64 -
+	    (float64_t) n * LN2_LO_64;
+
+	float64_t p = 1.0 + r * (1.0 + r * (1.0 / 2 + r * (1.0 / 6 +
+	    r * (1.0 / 24 + r * (1.0 / 120 + r * (1.0 / 720 +
+	    r * (1.0 / 5040 + r * (1.0 / 40320 + r * (1.0 / 362880 +
+	    r * (1.0 / 3628800 + r * (1.0 / 39916800 +
+	    r * (1.0 / 479001600 + r * (1.0 / 6227020800.0)))))))))))));
+
+	int32_t a = n / 2;
+	float64_u sa;
+	float64_u sb;
+	sa.data.bin = (uint64_t) (a + 1023) << FLOAT64_FRACTION_SIZE;
+	sb.data.bin = (uint64_t) (n - a + 1023) << FLOAT64_FRACTION_SIZE;
+
+	return p * sa.val * sb.val;
+}
+
+/** Exponential of vector elements (32-bit floating point)
+ *
+ * @param vec   Vector.
+ * @param count Number of elements.
+ *
+ */
+void vexp_f32(float32_t *vec, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+		vec[i] = exp_kernel_f32(vec[i]);
+}
+
+/** Exponential of vector elements (64-bit floating point)
+ *
+ * @param vec   Vector.
+ * @param count Number of elements.
+ *
+ */
+void vexp_f64(float64_t *vec, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+		vec[i] = exp_kernel_f64(vec[i]);
+}
+
+#ifndef LIBARCH_VSQRT
+
+/** Square root of vector elements (32-bit floating point)
+ *
+ * @param vec   Vector.
+ * @param count Number of elements.
+ *
+ */
+void vsqrt_f32(float32_t *vec, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+		vec[i] = sqrt_f32(vec[i]);
+}
+
+/** Square root of vector elements (64-bit floating point)
+ *
+ * @param vec   Vector.
+ * @param count Number of elements.
+ *
+ */
+void vsqrt_f64(float64_t *vec, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+		vec[i] = sqrt_f64(vec[i]);
+}
+
+#endif
+
+/** @}
+ */
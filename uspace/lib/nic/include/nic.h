@@ -68,6 +68,8 @@ typedef struct {
 	link_t link;
 	void *data;
 	size_t size;
+	/** The frame belongs to the frame pool of the NIC */
+	bool pooled;
 } nic_frame_t;
 
 typedef list_t nic_frame_list_t;
@@ -84,6 +86,16 @@ typedef list_t nic_frame_list_t;
  */
 typedef void (*send_frame_handler)(nic_t *, void *, size_t);
 
+/**
+ * Handler for sending frames which need additional processing by the NIC.
+ *
+ * @param nic_data
+ * @param data		Pointer to frame data
+ * @param size		Size of frame data in bytes
+ * @param flags		Frame flags (NIC_FRAME_*), never zero
+ */
+typedef void (*send_frame_flags_handler)(nic_t *, void *, size_t, uint32_t);
+
 /**
  * The handler for transitions between driver states.
  * If the handler returns error code, the transition between
@@ -218,6 +230,8 @@ extern void nic_driver_implement(driver_ops_t *, ddf_dev_ops_t *,
 extern errno_t nic_get_resources(nic_t *, hw_res_list_parsed_t *);
 extern void nic_set_specific(nic_t *, void *);
 extern void nic_set_send_frame_handler(nic_t *, send_frame_handler);
+extern void nic_set_send_frame_flags_handler(nic_t *,
+    send_frame_flags_handler);
 extern void nic_set_state_change_handlers(nic_t *,
     state_change_handler, state_change_handler, state_change_handler);
 extern void nic_set_filtering_change_handlers(nic_t *,
@@ -257,6 +271,7 @@ extern nic_frame_t *nic_alloc_frame(nic_t *, size_t);
 extern nic_frame_list_t *nic_alloc_frame_list(void);
 extern void nic_frame_list_append(nic_frame_list_t *, nic_frame_t *);
 extern void nic_release_frame(nic_t *, nic_frame_t *);
+extern errno_t nic_frame_pool_init(nic_t *, size_t, size_t);
 
 /* RXC query and report functions */
 extern void nic_report_hw_filtering(nic_t *, int, int, int);
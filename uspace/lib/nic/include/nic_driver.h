@@ -126,6 +126,12 @@ struct nic {
 	 * Called with the main_lock locked for reading.
 	 */
 	send_frame_handler send_frame;
+	/**
+	 * Function sending frames with frame flags. Optional, needed only
+	 * if the driver supports some offload options. Called with the
+	 * main_lock locked for reading.
+	 */
+	send_frame_flags_handler send_frame_flags;
 	/**
 	 * Event handler called when device goes to the ACTIVE state.
 	 * The implementation is optional.
@@ -194,6 +200,14 @@ struct nic {
 	 * The implementation is optional.
 	 */
 	poll_request_handler on_poll_request;
+	/** Preallocated frames, see nic_frame_pool_init() */
+	list_t frame_pool;
+	/** Number of frames owned by the frame pool */
+	size_t frame_pool_count;
+	/** Size of the data buffers of the pooled frames */
+	size_t frame_pool_buffer_size;
+	/** Lock for the frame pool */
+	fibril_mutex_t frame_pool_lock;
 	/** Data specific for particular driver */
 	void *specific;
 };
@@ -36,10 +36,15 @@
  * @brief Internal implementation of general NIC operations
  */
 
+#include <align.h>
 #include <assert.h>
 #include <fibril_synch.h>
+#include <macros.h>
+#include <mem.h>
+#include <nic_iface.h>
 #include <ns.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <str_error.h>
 #include <sysinfo.h>
 #include <as.h>
@@ -160,6 +165,20 @@ void nic_set_send_frame_handler(nic_t *nic_data, send_frame_handler sffunc)
 	nic_data->send_frame = sffunc;
 }
 
+/**
+ * Setup handler for sending frames with frame flags (NIC_FRAME_*). This
+ * should be called in the add_device handler by drivers supporting offload
+ * options that require frame flags.
+ *
+ * @param nic_data
+ * @param sffunc	Function handling frames with frame flags
+ */
+void nic_set_send_frame_flags_handler(nic_t *nic_data,
+    send_frame_flags_handler sffunc)
+{
+	nic_data->send_frame_flags = sffunc;
+}
+
 /**
  * Setup event handlers for transitions between driver states.
  * This function can be called only in the add_device handler.
@@ -264,6 +283,21 @@ errno_t nic_get_resources(nic_t *nic_data, hw_res_list_parsed_t *resources)
 nic_frame_t *nic_alloc_frame(nic_t *nic_data, size_t size)
 {
 	nic_frame_t *frame;
+
+	if (size <= nic_data->frame_pool_buffer_size) {
+		fibril_mutex_lock(&nic_data->frame_pool_lock);
+		link_t *first = list_first(&nic_data->frame_pool);
+		if (first != NULL) {
+			list_remove(first);
+			fibril_mutex_unlock(&nic_data->frame_pool_lock);
+
+			frame = list_get_instance(first, nic_frame_t, link);
+			frame->size = size;
+			return frame;
+		}
+		fibril_mutex_unlock(&nic_data->frame_pool_lock);
+	}
+
 	fibril_mutex_lock(&nic_globals.lock);
 	if (nic_globals.frame_cache_size > 0) {
 		link_t *first = list_first(&nic_globals.frame_cache);
@@ -287,6 +321,7 @@ nic_frame_t *nic_alloc_frame(nic_t *nic_data, size_t size)
 	}
 
 	frame->size = size;
+	frame->pooled = false;
 	return frame;
 }
 
@@ -300,6 +335,14 @@ void nic_release_frame(nic_t *nic_data, nic_frame_t *frame)
 	if (!frame)
 		return;
 
+	if (frame->pooled) {
+		/* Keep the buffer for the next frame */
+		fibril_mutex_lock(&nic_data->frame_pool_lock);
+		list_prepend(&frame->link, &nic_data->frame_pool);
+		fibril_mutex_unlock(&nic_data->frame_pool_lock);
+		return;
+	}
+
 	if (frame->data != NULL) {
 		free(frame->data);
 		frame->data = NULL;
@@ -317,6 +360,76 @@ void nic_release_frame(nic_t *nic_data, nic_frame_t *frame)
 	}
 }
 
+/** Free the frames of the frame pool
+ *
+ * All pooled frames must have been released already.
+ *
+ * @param nic_data	The NIC driver data
+ */
+static void nic_frame_pool_fini(nic_t *nic_data)
+{
+	link_t *link;
+
+	while ((link = list_first(&nic_data->frame_pool)) != NULL) {
+		nic_frame_t *frame = list_get_instance(link, nic_frame_t, link);
+
+		list_remove(link);
+		free(frame->data);
+		free(frame);
+		nic_data->frame_pool_count--;
+	}
+
+	assert(nic_data->frame_pool_count == 0);
+	nic_data->frame_pool_buffer_size = 0;
+}
+
+/** Preallocate frames for the NIC
+ *
+ * Frames of up to the given size are then taken from the pool by
+ * nic_alloc_frame() and returned to it by nic_release_frame(), without
+ * allocating their data buffers each time. Larger frames and frames
+ * needed while the pool is empty are allocated as usual.
+ *
+ * Can be called only once, typically from the add_device handler.
+ *
+ * @param nic_data	The NIC driver data
+ * @param count		Number of frames to preallocate
+ * @param size		Size of the data buffer of each frame
+ *
+ * @return EOK on success
+ * @return ENOMEM if there is not enough memory
+ */
+errno_t nic_frame_pool_init(nic_t *nic_data, size_t count, size_t size)
+{
+	assert(nic_data->frame_pool_count == 0);
+
+	for (size_t i = 0; i < count; i++) {
+		nic_frame_t *frame = malloc(sizeof(nic_frame_t));
+		if (frame == NULL)
+			goto error;
+
+		frame->data = malloc(size);
+		if (frame->data == NULL) {
+			free(frame);
+			goto error;
+		}
+
+		link_initialize(&frame->link);
+		frame->size = 0;
+		frame->pooled = true;
+
+		list_append(&frame->link, &nic_data->frame_pool);
+		nic_data->frame_pool_count++;
+	}
+
+	nic_data->frame_pool_buffer_size = size;
+	return EOK;
+
+error:
+	nic_frame_pool_fini(nic_data);
+	return ENOMEM;
+}
+
 /**
  * Allocate a new frame list
  *
@@ -508,19 +621,15 @@ void nic_set_tx_busy(nic_t *nic_data, int busy)
 }
 
 /**
- * This is the function that the driver should call when it receives a frame.
- * The frame is checked by filters and then sent up to the NIL layer or
- * discarded. The frame is released.
+ * Check received frame by filters and update statistics.
  *
  * @param nic_data
  * @param frame		The received frame
+ * @return		@c true if the frame should be sent up to the NIL layer,
+ *			@c false if it should be discarded
  */
-void nic_received_frame(nic_t *nic_data, nic_frame_t *frame)
+static bool nic_received_frame_check(nic_t *nic_data, nic_frame_t *frame)
 {
-	/*
-	 * Note: this function must not lock main lock, because loopback driver
-	 * 		 calls it inside send_frame handler (with locked main lock)
-	 */
 	fibril_rwlock_read_lock(&nic_data->rxc_lock);
 	nic_frame_type_t frame_type;
 	bool check = nic_rxc_check(&nic_data->rx_control, frame->data,
@@ -543,8 +652,7 @@ void nic_received_frame(nic_t *nic_data, nic_frame_t *frame)
 			break;
 		}
 		fibril_rwlock_write_unlock(&nic_data->stats_lock);
-		nic_ev_received(nic_data->client_session, frame->data,
-		    frame->size);
+		return true;
 	} else {
 		switch (frame_type) {
 		case NIC_FRAME_UNICAST:
@@ -558,10 +666,38 @@ void nic_received_frame(nic_t *nic_data, nic_frame_t *frame)
 			break;
 		}
 		fibril_rwlock_write_unlock(&nic_data->stats_lock);
+		return false;
+	}
+}
+
+/**
+ * This is the function that the driver should call when it receives a frame.
+ * The frame is checked by filters and then sent up to the NIL layer or
+ * discarded. The frame is released.
+ *
+ * @param nic_data
+ * @param frame		The received frame
+ */
+void nic_received_frame(nic_t *nic_data, nic_frame_t *frame)
+{
+	/*
+	 * Note: this function must not lock main lock, because loopback driver
+	 * 		 calls it inside send_frame handler (with locked main lock)
+	 */
+	if (nic_received_frame_check(nic_data, frame)) {
+		nic_ev_received(nic_data->client_session, frame->data,
+		    frame->size);
 	}
 	nic_release_frame(nic_data, frame);
 }
 
+/** Size of frame in NIC_EV_RECEIVED_BATCH data, including header */
+static size_t nic_batch_frame_size(nic_frame_t *frame)
+{
+	return ALIGN_UP(sizeof(nic_batch_frame_hdr_t) + frame->size,
+	    NIC_BATCH_ALIGN);
+}
+
 /**
  * Some NICs can receive multiple frames during single interrupt. These can
  * send them in whole list of frames (actually nic_frame_t structures), then
@@ -573,15 +709,71 @@ void nic_received_frame(nic_t *nic_data, nic_frame_t *frame)
  */
 void nic_received_frame_list(nic_t *nic_data, nic_frame_list_t *frames)
 {
+	nic_batch_frame_hdr_t hdr;
+	size_t bsize;
+	size_t boff;
+	size_t bcount;
+	size_t fsize;
+	void *batch;
+
 	if (frames == NULL)
 		return;
+
+	/* Determine size of the batch buffer */
+	bsize = 0;
+	list_foreach(*frames, link, nic_frame_t, frame) {
+		fsize = nic_batch_frame_size(frame);
+		if (fsize <= NIC_BATCH_SIZE_MAX)
+			bsize = min(bsize + fsize, NIC_BATCH_SIZE_MAX);
+	}
+
+	/* Single frame or out of memory: deliver frames one by one */
+	batch = NULL;
+	if (list_count(frames) > 1)
+		batch = malloc(bsize);
+
+	boff = 0;
+	bcount = 0;
 	while (!list_empty(frames)) {
 		nic_frame_t *frame =
 		    list_get_instance(list_first(frames), nic_frame_t, link);
 
 		list_remove(&frame->link);
-		nic_received_frame(nic_data, frame);
+
+		fsize = nic_batch_frame_size(frame);
+		if (batch == NULL || fsize > bsize) {
+			nic_received_frame(nic_data, frame);
+			continue;
+		}
+
+		if (nic_received_frame_check(nic_data, frame)) {
+			/* Flush the batch if the frame does not fit */
+			if (boff + fsize > bsize) {
+				nic_ev_received_batch(nic_data->client_session,
+				    batch, boff, bcount);
+				boff = 0;
+				bcount = 0;
+			}
+
+			hdr.size = frame->size;
+			memcpy(batch + boff, &hdr, sizeof(hdr));
+			memcpy(batch + boff + sizeof(hdr), frame->data,
+			    frame->size);
+			memset(batch + boff + sizeof(hdr) + frame->size, 0,
+			    fsize - sizeof(hdr) - frame->size);
+			boff += fsize;
+			++bcount;
+		}
+
+		nic_release_frame(nic_data, frame);
+	}
+
+	if (bcount > 0) {
+		nic_ev_received_batch(nic_data->client_session, batch, boff,
+		    bcount);
 	}
+
+	free(batch);
 	nic_driver_release_frame_list(frames);
 }
 
@@ -612,11 +804,17 @@ static nic_t *nic_create(ddf_dev_t *dev)
 	nic_data->poll_mode = NIC_POLL_IMMEDIATE;
 	nic_data->default_poll_mode = NIC_POLL_IMMEDIATE;
 	nic_data->send_frame = NULL;
+	nic_data->send_frame_flags = NULL;
 	nic_data->on_activating = NULL;
 	nic_data->on_going_down = NULL;
 	nic_data->on_stopping = NULL;
 	nic_data->specific = NULL;
 
+	list_initialize(&nic_data->frame_pool);
+	nic_data->frame_pool_count = 0;
+	nic_data->frame_pool_buffer_size = 0;
+	fibril_mutex_initialize(&nic_data->frame_pool_lock);
+
 	fibril_rwlock_initialize(&nic_data->main_lock);
 	fibril_rwlock_initialize(&nic_data->stats_lock);
 	fibril_rwlock_initialize(&nic_data->rxc_lock);
@@ -658,6 +856,7 @@ nic_t *nic_create_and_bind(ddf_dev_t *device)
  */
 static void nic_destroy(nic_t *nic_data)
 {
+	nic_frame_pool_fini(nic_data);
 	free(nic_data->specific);
 }
 
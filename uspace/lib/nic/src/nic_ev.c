@@ -93,5 +93,32 @@ errno_t nic_ev_received(async_sess_t *sess, void *data, size_t size)
 	return retval;
 }
 
+/** Batch of frames received.
+ *
+ * @param sess  Client session
+ * @param data  Frames, each preceded by nic_batch_frame_hdr_t
+ * @param size  Size of @a data in bytes
+ * @param count Number of frames in batch
+ */
+errno_t nic_ev_received_batch(async_sess_t *sess, void *data, size_t size,
+    size_t count)
+{
+	async_exch_t *exch = async_exchange_begin(sess);
+
+	ipc_call_t answer;
+	aid_t req = async_send_1(exch, NIC_EV_RECEIVED_BATCH, count, &answer);
+	errno_t retval = async_data_write_start(exch, data, size);
+
+	async_exchange_end(exch);
+
+	if (retval != EOK) {
+		async_forget(req);
+		return retval;
+	}
+
+	async_wait_for(req, &retval);
+	return retval;
+}
+
 /** @}
  */
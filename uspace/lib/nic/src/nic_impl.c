@@ -165,21 +165,30 @@ errno_t nic_set_state_impl(ddf_fun_t *fun, nic_device_state_t state)
  * @param	fun
  * @param	data	Frame data
  * @param 	size	Frame size in bytes
+ * @param	flags	Frame flags (NIC_FRAME_*)
  *
  * @return EOK		If the message was sent
  * @return EBUSY	If the device is not in state when the frame can be sent.
+ * @return ENOTSUP	If the driver does not support the frame flags.
  */
-errno_t nic_send_frame_impl(ddf_fun_t *fun, void *data, size_t size)
+errno_t nic_send_frame_impl(ddf_fun_t *fun, void *data, size_t size,
+    uint32_t flags)
 {
 	nic_t *nic_data = nic_get_from_ddf_fun(fun);
 
+	if (flags != 0 && nic_data->send_frame_flags == NULL)
+		return ENOTSUP;
+
 	fibril_rwlock_read_lock(&nic_data->main_lock);
 	if (nic_data->state != NIC_STATE_ACTIVE || nic_data->tx_busy) {
 		fibril_rwlock_read_unlock(&nic_data->main_lock);
 		return EBUSY;
 	}
 
-	nic_data->send_frame(nic_data, data, size);
+	if (flags != 0)
+		nic_data->send_frame_flags(nic_data, data, size, flags);
+	else
+		nic_data->send_frame(nic_data, data, size);
 	fibril_rwlock_read_unlock(&nic_data->main_lock);
 	return EOK;
 }
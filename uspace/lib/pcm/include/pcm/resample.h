@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup audio
+ * @brief HelenOS sound server
+ * @{
+ */
+/** @file
+ */
+
+#ifndef PCM_RESAMPLE_H_
+#define PCM_RESAMPLE_H_
+
+#include <errno.h>
+#include <stddef.h>
+#include <pcm/format.h>
+
+/** Sample rate conversion quality */
+typedef enum {
+	/** Linear interpolation, cheapest and lowest quality */
+	PCM_RESAMPLE_LINEAR,
+	/** Short windowed sinc filter */
+	PCM_RESAMPLE_MEDIUM,
+	/** Long windowed sinc filter */
+	PCM_RESAMPLE_HIGH,
+} pcm_resample_quality_t;
+
+typedef struct pcm_resampler pcm_resampler_t;
+
+errno_t pcm_resampler_create(const pcm_format_t *sf, const pcm_format_t *df,
+    pcm_resample_quality_t quality, pcm_resampler_t **resampler);
+void pcm_resampler_destroy(pcm_resampler_t *resampler);
+size_t pcm_resampler_mix(pcm_resampler_t *resampler, void *dst,
+    size_t dst_size, const void *src, size_t src_size, size_t *src_used);
+
+#endif
+
+/**
+ * @}
+ */
@@ -37,9 +37,11 @@
 #include <byteorder.h>
 #include <errno.h>
 #include <macros.h>
+#include <stdint.h>
 #include <stdio.h>
 
 #include "format.h"
+#include "kernels.h"
 
 // TODO float endian?
 #define float_le2host(x) (x)
@@ -51,6 +53,17 @@
 #define from(x, type, endian) (float)(type ## _ ## endian ## 2host(x))
 #define to(x, type, endian) (float)(host2 ## type ## _ ## endian(x))
 
+/** Number of samples converted at once by the generic mixing kernel */
+#define MIX_BLOCK  256
+
+/**
+ * Add samples of the same format.
+ * @param out Destination samples.
+ * @param in Source samples.
+ * @param count Number of samples.
+ */
+typedef void (*pcm_add_t)(void *out, const void *in, size_t count);
+
 /** Default linear PCM format */
 const pcm_format_t AUDIO_FORMAT_DEFAULT = {
 	.channels = 2,
@@ -162,6 +175,215 @@ errno_t pcm_format_mix(void *dst, const void *src, size_t size, const pcm_format
 	return pcm_format_convert_and_mix(dst, size, src, size, f, f);
 }
 
+/** Saturate a sum of two 32-bit samples. */
+static inline int32_t sat32(int64_t value)
+{
+	if (value > INT32_MAX)
+		return INT32_MAX;
+	if (value < INT32_MIN)
+		return INT32_MIN;
+	return (int32_t) value;
+}
+
+/*
+ * Integer samples are converted by placing them into the top bits of
+ * a 32-bit value. Unsigned samples are made signed by flipping the top
+ * bit. This avoids both the per-sample format switch and the round trip
+ * through float. The loops have no data dependent branches so that the
+ * compiler can vectorize them where the target supports it.
+ */
+#define DEFINE_INT_KERNELS(name, utype, endian, shift, bias) \
+static void load_ ## name(int32_t *out, const void *in, size_t count) \
+{ \
+	const utype *src = in; \
+	for (size_t i = 0; i < count; ++i) { \
+		out[i] = (int32_t) ((uint32_t) (utype) \
+		    (utype ## _ ## endian ## 2host(src[i]) ^ (bias)) << (shift)); \
+	} \
+} \
+\
+static void store_ ## name(void *out, const int32_t *in, size_t count) \
+{ \
+	utype *dst = out; \
+	for (size_t i = 0; i < count; ++i) { \
+		const int32_t d = (int32_t) ((uint32_t) (utype) \
+		    (utype ## _ ## endian ## 2host(dst[i]) ^ (bias)) << (shift)); \
+		const uint32_t s = (uint32_t) sat32((int64_t) d + in[i]); \
+		dst[i] = host2 ## utype ## _ ## endian( \
+		    (utype) ((s >> (shift)) ^ (bias))); \
+	} \
+}
+
+DEFINE_INT_KERNELS(u8, uint8_t, le, 24, UINT8_C(0x80))
+DEFINE_INT_KERNELS(s8, uint8_t, le, 24, 0)
+DEFINE_INT_KERNELS(u16le, uint16_t, le, 16, UINT16_C(0x8000))
+DEFINE_INT_KERNELS(s16le, uint16_t, le, 16, 0)
+DEFINE_INT_KERNELS(u16be, uint16_t, be, 16, UINT16_C(0x8000))
+DEFINE_INT_KERNELS(s16be, uint16_t, be, 16, 0)
+DEFINE_INT_KERNELS(u32le, uint32_t, le, 0, UINT32_C(0x80000000))
+DEFINE_INT_KERNELS(s32le, uint32_t, le, 0, 0)
+DEFINE_INT_KERNELS(u32be, uint32_t, be, 0, UINT32_C(0x80000000))
+DEFINE_INT_KERNELS(s32be, uint32_t, be, 0, 0)
+
+#undef DEFINE_INT_KERNELS
+
+static void load_f32(int32_t *out, const void *in, size_t count)
+{
+	const float *src = in;
+	for (size_t i = 0; i < count; ++i) {
+		float f = float_le2host(src[i]);
+		if (f < -1.0f)
+			f = -1.0f;
+		if (f > 1.0f)
+			f = 1.0f;
+		out[i] = (int32_t) (f * 2147483647.0f);
+	}
+}
+
+static void store_f32(void *out, const int32_t *in, size_t count)
+{
+	float *dst = out;
+	for (size_t i = 0; i < count; ++i) {
+		float f = float_le2host(dst[i]) + (float) in[i] / 2147483648.0f;
+		if (f < -1.0f)
+			f = -1.0f;
+		if (f > 1.0f)
+			f = 1.0f;
+		dst[i] = host2float_le(f);
+	}
+}
+
+/** Mix signed 16-bit little endian samples directly. */
+static void add_s16le(void *out, const void *in, size_t count)
+{
+	uint16_t *dst = out;
+	const uint16_t *src = in;
+	for (size_t i = 0; i < count; ++i) {
+		int32_t s = (int16_t) uint16_t_le2host(dst[i]) +
+		    (int16_t) uint16_t_le2host(src[i]);
+		if (s > INT16_MAX)
+			s = INT16_MAX;
+		if (s < INT16_MIN)
+			s = INT16_MIN;
+		dst[i] = host2uint16_t_le((uint16_t) s);
+	}
+}
+
+/** Mix signed 32-bit little endian samples directly. */
+static void add_s32le(void *out, const void *in, size_t count)
+{
+	uint32_t *dst = out;
+	const uint32_t *src = in;
+	for (size_t i = 0; i < count; ++i) {
+		const int64_t s = (int64_t) (int32_t) uint32_t_le2host(dst[i]) +
+		    (int32_t) uint32_t_le2host(src[i]);
+		dst[i] = host2uint32_t_le((uint32_t) sat32(s));
+	}
+}
+
+/** Mix float samples directly. */
+static void add_f32(void *out, const void *in, size_t count)
+{
+	float *dst = out;
+	const float *src = in;
+	for (size_t i = 0; i < count; ++i) {
+		float f = float_le2host(dst[i]) + float_le2host(src[i]);
+		if (f < -1.0f)
+			f = -1.0f;
+		if (f > 1.0f)
+			f = 1.0f;
+		dst[i] = host2float_le(f);
+	}
+}
+
+/** Conversion from each sample format (NULL if not supported) */
+const pcm_load_t pcm_load[PCM_SAMPLE_FORMAT_LAST + 1] = {
+	[PCM_SAMPLE_UINT8] = load_u8,
+	[PCM_SAMPLE_SINT8] = load_s8,
+	[PCM_SAMPLE_UINT16_LE] = load_u16le,
+	[PCM_SAMPLE_SINT16_LE] = load_s16le,
+	[PCM_SAMPLE_UINT16_BE] = load_u16be,
+	[PCM_SAMPLE_SINT16_BE] = load_s16be,
+	[PCM_SAMPLE_UINT24_32_LE] = load_u32le,
+	[PCM_SAMPLE_UINT32_LE] = load_u32le,
+	[PCM_SAMPLE_SINT24_32_LE] = load_s32le,
+	[PCM_SAMPLE_SINT32_LE] = load_s32le,
+	[PCM_SAMPLE_UINT24_32_BE] = load_u32be,
+	[PCM_SAMPLE_UINT32_BE] = load_u32be,
+	[PCM_SAMPLE_SINT24_32_BE] = load_s32be,
+	[PCM_SAMPLE_SINT32_BE] = load_s32be,
+	[PCM_SAMPLE_FLOAT32] = load_f32
+};
+
+/** Mixing into each sample format (NULL if not supported) */
+const pcm_store_t pcm_store[PCM_SAMPLE_FORMAT_LAST + 1] = {
+	[PCM_SAMPLE_UINT8] = store_u8,
+	[PCM_SAMPLE_SINT8] = store_s8,
+	[PCM_SAMPLE_UINT16_LE] = store_u16le,
+	[PCM_SAMPLE_SINT16_LE] = store_s16le,
+	[PCM_SAMPLE_UINT16_BE] = store_u16be,
+	[PCM_SAMPLE_SINT16_BE] = store_s16be,
+	[PCM_SAMPLE_UINT24_32_LE] = store_u32le,
+	[PCM_SAMPLE_UINT32_LE] = store_u32le,
+	[PCM_SAMPLE_SINT24_32_LE] = store_s32le,
+	[PCM_SAMPLE_SINT32_LE] = store_s32le,
+	[PCM_SAMPLE_UINT24_32_BE] = store_u32be,
+	[PCM_SAMPLE_UINT32_BE] = store_u32be,
+	[PCM_SAMPLE_SINT24_32_BE] = store_s32be,
+	[PCM_SAMPLE_SINT32_BE] = store_s32be,
+	[PCM_SAMPLE_FLOAT32] = store_f32
+};
+
+/** Direct mixing of samples of the same format (NULL if not available) */
+static const pcm_add_t pcm_add[PCM_SAMPLE_FORMAT_LAST + 1] = {
+	[PCM_SAMPLE_SINT16_LE] = add_s16le,
+	[PCM_SAMPLE_SINT32_LE] = add_s32le,
+	[PCM_SAMPLE_FLOAT32] = add_f32
+};
+
+/**
+ * Add and mix audio data using the specialized kernels.
+ * @param dst Destination audio buffer
+ * @param src Source audio buffer
+ * @param count Number of samples to mix.
+ * @param sf Source sample format.
+ * @param df Destination sample format.
+ * @return True if the formats are supported by the kernels.
+ */
+static bool mix_kernels(void *dst, const void *src, size_t count,
+    pcm_sample_format_t sf, pcm_sample_format_t df)
+{
+	if ((sf > PCM_SAMPLE_FORMAT_LAST) || (df > PCM_SAMPLE_FORMAT_LAST))
+		return false;
+
+	if ((sf == df) && (pcm_add[df] != NULL)) {
+		pcm_add[df](dst, src, count);
+		return true;
+	}
+
+	const pcm_load_t load = pcm_load[sf];
+	const pcm_store_t store = pcm_store[df];
+	if ((load == NULL) || (store == NULL))
+		return false;
+
+	const size_t src_sample_size = pcm_sample_format_size(sf);
+	const size_t dst_sample_size = pcm_sample_format_size(df);
+	int32_t block[MIX_BLOCK];
+
+	while (count > 0) {
+		const size_t n = min(count, MIX_BLOCK);
+
+		load(block, src, n);
+		store(dst, block, n);
+
+		src += n * src_sample_size;
+		dst += n * dst_sample_size;
+		count -= n;
+	}
+
+	return true;
+}
+
 /**
  * Add and mix audio data.
  * @param dst Destination audio buffer
@@ -188,6 +410,20 @@ errno_t pcm_format_convert_and_mix(void *dst, size_t dst_size, const void *src,
 	if ((dst_size % dst_frame_size) != 0)
 		return EINVAL;
 
+	/*
+	 * Streams with the same channel layout are mixed sample by sample
+	 * without the per-sample format dispatch below. Missing source
+	 * frames are silence, which leaves the destination as it is.
+	 */
+	if (sf->channels == df->channels) {
+		const size_t frames = min(dst_size / dst_frame_size,
+		    src_size / src_frame_size);
+
+		if (mix_kernels(dst, src, frames * df->channels,
+		    sf->sample_format, df->sample_format))
+			return EOK;
+	}
+
 	/*
 	 * This is so ugly it eats kittens, and puppies, and ducklings,
 	 * and all little fluffy things...
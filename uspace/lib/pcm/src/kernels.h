@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup audio
+ * @brief HelenOS sound server
+ * @{
+ */
+/** @file
+ * Sample conversion kernels shared by the libpcm modules.
+ */
+
+#ifndef PCM_KERNELS_H_
+#define PCM_KERNELS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pcm/sample_format.h>
+
+/**
+ * Convert samples to signed 32-bit values using the full range.
+ * @param out Converted samples.
+ * @param in Samples in the source format.
+ * @param count Number of samples.
+ */
+typedef void (*pcm_load_t)(int32_t *out, const void *in, size_t count);
+
+/**
+ * Add signed 32-bit samples to samples in the destination format.
+ * @param out Samples in the destination format.
+ * @param in Samples to add.
+ * @param count Number of samples.
+ */
+typedef void (*pcm_store_t)(void *out, const int32_t *in, size_t count);
+
+extern const pcm_load_t pcm_load[PCM_SAMPLE_FORMAT_LAST + 1];
+extern const pcm_store_t pcm_store[PCM_SAMPLE_FORMAT_LAST + 1];
+
+#endif
+
+/**
+ * @}
+ */
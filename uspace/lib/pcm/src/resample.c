@@ -0,0 +1,442 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup audio
+ * @brief HelenOS sound server
+ * @{
+ */
+/** @file
+ * Polyphase sample rate conversion.
+ *
+ * The conversion ratio is reduced to out/in = up/down. Every output frame
+ * lies at a position within the input described by an integer frame index
+ * and a fraction in units of 1/up. The fraction selects one phase of a
+ * windowed sinc filter from a precomputed table, the output is the dot
+ * product of that phase with the surrounding input frames. Ratios with
+ * more than MAX_PHASES phases use the nearest stored phase.
+ *
+ * Input frames are converted to float and kept in a per-channel history
+ * so that the filter runs over contiguous memory. The inner loop uses
+ * independent accumulators and no data dependent branches to let the
+ * compiler vectorize it.
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <macros.h>
+#include <math.h>
+#include <mem.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "format.h"
+#include "resample.h"
+#include "kernels.h"
+
+/** Maximum number of filter phases stored in the coefficient table */
+#define MAX_PHASES  256
+
+/** Maximum filter length in input frames */
+#define MAX_TAPS  256
+
+/** Number of input frames buffered on top of the filter length */
+#define HISTORY_FRAMES  256
+
+/** Number of samples converted at once */
+#define RESAMPLE_BLOCK  256
+
+/** Sample rate converter state */
+struct pcm_resampler {
+	/** Number of channels */
+	unsigned channels;
+	/** Input frame size */
+	size_t in_frame_size;
+	/** Output frame size */
+	size_t out_frame_size;
+	/** Conversion from the input sample format */
+	pcm_load_t load;
+	/** Mixing into the output sample format */
+	pcm_store_t store;
+
+	/** Interpolation factor */
+	unsigned up;
+	/** Decimation factor */
+	unsigned down;
+	/** Filter length */
+	unsigned taps;
+	/** Number of phases in the coefficient table */
+	unsigned phases;
+	/** Filter coefficients, phases * taps */
+	float *coefs;
+
+	/** Input history, capacity frames for every channel */
+	float *history;
+	/** History capacity in frames */
+	size_t capacity;
+	/** Number of frames in the history */
+	size_t fill;
+	/** History frame where the next output frame's filter starts */
+	size_t pos;
+	/** Position fraction of the next output frame in 1/up units */
+	unsigned frac;
+};
+
+/** Greatest common divisor. */
+static unsigned gcd(unsigned a, unsigned b)
+{
+	while (b != 0) {
+		const unsigned t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+/**
+ * Filter window.
+ * @param quality Conversion quality.
+ * @param u Position within the window, <0,1>.
+ * @return Window value.
+ */
+static double window(pcm_resample_quality_t quality, double u)
+{
+	const double a = 2 * M_PI * u;
+	if (quality == PCM_RESAMPLE_HIGH) {
+		/* Blackman-Harris */
+		return 0.35875 - 0.48829 * cos(a) + 0.14128 * cos(2 * a) -
+		    0.01168 * cos(3 * a);
+	}
+	/* Blackman */
+	return 0.42 - 0.5 * cos(a) + 0.08 * cos(2 * a);
+}
+
+/**
+ * Fill the coefficient table.
+ * @param rs The resampler.
+ * @param quality Conversion quality.
+ * @param cutoff Cutoff frequency relative to the input sampling rate.
+ *
+ * Every phase is normalized to unity gain so that a constant signal
+ * passes unchanged.
+ */
+static void design_filter(pcm_resampler_t *rs, pcm_resample_quality_t quality,
+    double cutoff)
+{
+	const unsigned taps = rs->taps;
+	const double center = taps / 2 - 1;
+
+	for (unsigned p = 0; p < rs->phases; ++p) {
+		float *h = rs->coefs + p * taps;
+		const double x = (double) p / rs->phases;
+
+		if (quality == PCM_RESAMPLE_LINEAR) {
+			h[0] = 1.0 - x;
+			h[1] = x;
+			continue;
+		}
+
+		double coef[MAX_TAPS];
+		double sum = 0.0;
+		for (unsigned k = 0; k < taps; ++k) {
+			const double t = k - center - x;
+			double v = (t == 0.0) ? 2 * cutoff :
+			    sin(2 * M_PI * cutoff * t) / (M_PI * t);
+			v *= window(quality, (t + taps / 2.0) / taps);
+			coef[k] = v;
+			sum += v;
+		}
+		for (unsigned k = 0; k < taps; ++k)
+			h[k] = coef[k] / sum;
+	}
+}
+
+/**
+ * Create sample rate converter.
+ * @param sf Source format.
+ * @param df Destination format.
+ * @param quality Conversion quality.
+ * @param resampler Place to store the new converter.
+ * @return Error code.
+ *
+ * Both formats need to have the same number of channels.
+ */
+errno_t pcm_resampler_create(const pcm_format_t *sf, const pcm_format_t *df,
+    pcm_resample_quality_t quality, pcm_resampler_t **resampler)
+{
+	assert(sf);
+	assert(df);
+	assert(resampler);
+
+	if (sf->channels != df->channels || sf->channels == 0 ||
+	    sf->channels > RESAMPLE_BLOCK)
+		return EINVAL;
+	if (sf->sampling_rate == 0 || df->sampling_rate == 0)
+		return EINVAL;
+	if (sf->sample_format > PCM_SAMPLE_FORMAT_LAST ||
+	    df->sample_format > PCM_SAMPLE_FORMAT_LAST)
+		return ENOTSUP;
+	if (!pcm_load[sf->sample_format] || !pcm_store[df->sample_format])
+		return ENOTSUP;
+
+	pcm_resampler_t *rs = calloc(1, sizeof(pcm_resampler_t));
+	if (!rs)
+		return ENOMEM;
+
+	const unsigned g = gcd(sf->sampling_rate, df->sampling_rate);
+	rs->channels = sf->channels;
+	rs->in_frame_size = pcm_format_frame_size(sf);
+	rs->out_frame_size = pcm_format_frame_size(df);
+	rs->load = pcm_load[sf->sample_format];
+	rs->store = pcm_store[df->sample_format];
+	rs->up = df->sampling_rate / g;
+	rs->down = sf->sampling_rate / g;
+	rs->phases = min(rs->up, MAX_PHASES);
+
+	/*
+	 * Decimation lowers the cutoff below the output Nyquist frequency,
+	 * the filter is made longer to keep the same transition band.
+	 */
+	double cutoff = 0.5;
+	unsigned taps = 2;
+	switch (quality) {
+	case PCM_RESAMPLE_LINEAR:
+		break;
+	case PCM_RESAMPLE_MEDIUM:
+		cutoff = 0.45;
+		taps = 16;
+		break;
+	case PCM_RESAMPLE_HIGH:
+		cutoff = 0.475;
+		taps = 48;
+		break;
+	default:
+		free(rs);
+		return EINVAL;
+	}
+	if (rs->down > rs->up && quality != PCM_RESAMPLE_LINEAR) {
+		cutoff = cutoff * rs->up / rs->down;
+		const uint64_t scaled =
+		    ((uint64_t) taps * rs->down + rs->up - 1) / rs->up;
+		taps = min(scaled + (scaled & 1), MAX_TAPS);
+	}
+	rs->taps = taps;
+
+	rs->capacity = taps + HISTORY_FRAMES;
+	rs->coefs = malloc(sizeof(float) * rs->phases * taps);
+	rs->history = calloc(rs->channels * rs->capacity, sizeof(float));
+	if (!rs->coefs || !rs->history) {
+		pcm_resampler_destroy(rs);
+		return ENOMEM;
+	}
+	design_filter(rs, quality, cutoff);
+
+	/* Silence before the first frame keeps the output aligned */
+	rs->fill = taps / 2 - 1;
+
+	*resampler = rs;
+	return EOK;
+}
+
+/**
+ * Destroy sample rate converter.
+ * @param resampler The converter to destroy.
+ */
+void pcm_resampler_destroy(pcm_resampler_t *resampler)
+{
+	if (resampler) {
+		free(resampler->coefs);
+		free(resampler->history);
+		free(resampler);
+	}
+}
+
+/** Apply one filter phase. */
+static inline float dot(const float *__restrict__ a,
+    const float *__restrict__ b, unsigned count)
+{
+	float s0 = 0.0f, s1 = 0.0f, s2 = 0.0f, s3 = 0.0f;
+	unsigned i = 0;
+	for (; i + 4 <= count; i += 4) {
+		s0 += a[i] * b[i];
+		s1 += a[i + 1] * b[i + 1];
+		s2 += a[i + 2] * b[i + 2];
+		s3 += a[i + 3] * b[i + 3];
+	}
+	for (; i < count; ++i)
+		s0 += a[i] * b[i];
+	return (s0 + s1) + (s2 + s3);
+}
+
+/** Saturate filter output to a 32-bit sample. */
+static inline int32_t to_sample(float value)
+{
+	if (value >= 2147483648.0f)
+		return INT32_MAX;
+	if (value <= -2147483648.0f)
+		return INT32_MIN;
+	return (int32_t) value;
+}
+
+/**
+ * Compute output frames from the buffered history.
+ * @param rs The resampler.
+ * @param out Interleaved output samples.
+ * @param frames Maximum number of frames to compute.
+ * @return Number of frames computed.
+ */
+static size_t produce(pcm_resampler_t *rs, int32_t *out, size_t frames)
+{
+	const unsigned channels = rs->channels;
+	const unsigned step = rs->down / rs->up;
+	const unsigned step_frac = rs->down % rs->up;
+	size_t done = 0;
+
+	while (done < frames && rs->pos + rs->taps <= rs->fill) {
+		const unsigned phase =
+		    (uint64_t) rs->frac * rs->phases / rs->up;
+		const float *h = rs->coefs + phase * rs->taps;
+
+		for (unsigned c = 0; c < channels; ++c) {
+			const float *x =
+			    rs->history + c * rs->capacity + rs->pos;
+			*out++ = to_sample(dot(x, h, rs->taps));
+		}
+
+		rs->pos += step;
+		rs->frac += step_frac;
+		if (rs->frac >= rs->up) {
+			rs->frac -= rs->up;
+			++rs->pos;
+		}
+		++done;
+	}
+	return done;
+}
+
+/**
+ * Drop history frames that no output frame needs any more.
+ * @param rs The resampler.
+ */
+static void drop_history(pcm_resampler_t *rs)
+{
+	const size_t drop = min(rs->pos, rs->fill);
+	if (drop == 0)
+		return;
+
+	for (unsigned c = 0; c < rs->channels; ++c) {
+		float *x = rs->history + c * rs->capacity;
+		memmove(x, x + drop, (rs->fill - drop) * sizeof(float));
+	}
+	rs->fill -= drop;
+	rs->pos -= drop;
+}
+
+/**
+ * Append input frames to the history.
+ * @param rs The resampler.
+ * @param src Input frames.
+ * @param frames Number of input frames.
+ * @return Number of frames appended, limited by the history space.
+ */
+static size_t fill_history(pcm_resampler_t *rs, const void *src, size_t frames)
+{
+	const unsigned channels = rs->channels;
+	const size_t block_frames = RESAMPLE_BLOCK / channels;
+	int32_t block[RESAMPLE_BLOCK];
+
+	frames = min(frames, rs->capacity - rs->fill);
+	size_t done = 0;
+	while (done < frames) {
+		const size_t n = min(frames - done, block_frames);
+		rs->load(block, src, n * channels);
+
+		for (unsigned c = 0; c < channels; ++c) {
+			float *x = rs->history + c * rs->capacity + rs->fill;
+			for (size_t i = 0; i < n; ++i)
+				x[i] = (float) block[i * channels + c];
+		}
+
+		rs->fill += n;
+		done += n;
+		src += n * rs->in_frame_size;
+	}
+	return frames;
+}
+
+/**
+ * Convert sample rate and mix into the destination buffer.
+ * @param resampler The converter.
+ * @param dst Destination audio buffer.
+ * @param dst_size Size of the destination buffer.
+ * @param src Source audio buffer.
+ * @param src_size Size of the source buffer.
+ * @param src_used Place to store the number of source bytes consumed.
+ * @return Number of destination bytes mixed.
+ *
+ * Consumed source frames are kept by the converter, the stream continues
+ * with the next call. Less than @p dst_size is mixed only if the source
+ * runs out of data.
+ */
+size_t pcm_resampler_mix(pcm_resampler_t *resampler, void *dst,
+    size_t dst_size, const void *src, size_t src_size, size_t *src_used)
+{
+	assert(resampler);
+	pcm_resampler_t *rs = resampler;
+	const size_t out_frames = dst_size / rs->out_frame_size;
+	const size_t in_frames = src_size / rs->in_frame_size;
+	const size_t block_frames = RESAMPLE_BLOCK / rs->channels;
+	int32_t block[RESAMPLE_BLOCK];
+	size_t mixed = 0;
+	size_t used = 0;
+
+	while (mixed < out_frames) {
+		const size_t n =
+		    produce(rs, block, min(out_frames - mixed, block_frames));
+		if (n > 0) {
+			rs->store(dst, block, n * rs->channels);
+			dst += n * rs->out_frame_size;
+			mixed += n;
+			continue;
+		}
+
+		drop_history(rs);
+		const size_t loaded = fill_history(rs, src, in_frames - used);
+		if (loaded == 0)
+			break;
+		src += loaded * rs->in_frame_size;
+		used += loaded;
+	}
+
+	if (src_used)
+		*src_used = used * rs->in_frame_size;
+	return mixed * rs->out_frame_size;
+}
+
+/**
+ * @}
+ */
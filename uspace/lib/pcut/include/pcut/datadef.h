@@ -59,6 +59,10 @@ enum {
 enum {
 	PCUT_EXTRA_TIMEOUT,
 	PCUT_EXTRA_SKIP,
+	PCUT_EXTRA_BENCHMARK_WARMUP,
+	PCUT_EXTRA_BENCHMARK_ROUNDS,
+	PCUT_EXTRA_BENCHMARK_BASELINE,
+	PCUT_EXTRA_BENCHMARK_TOLERANCE,
 	PCUT_EXTRA_LAST
 };
 
@@ -93,6 +97,8 @@ struct pcut_extra {
 	int type;
 	/** Test-specific time-out in seconds. */
 	int timeout;
+	/** Benchmark parameter (iterations, nanoseconds or percents). */
+	unsigned long benchmark_value;
 };
 
 /** @copydoc pcut_main_extra_t */
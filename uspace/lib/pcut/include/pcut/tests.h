@@ -150,20 +150,20 @@
  * @param time_out Time-out value in seconds.
  */
 #define PCUT_TEST_SET_TIMEOUT(time_out) \
-	{ PCUT_EXTRA_TIMEOUT, (time_out) }
+	{ PCUT_EXTRA_TIMEOUT, (time_out), 0 }
 
 /** Skip current test.
  *
  * Use as argument to PCUT_TEST().
  */
 #define PCUT_TEST_SKIP \
-	{ PCUT_EXTRA_SKIP, 0 }
+	{ PCUT_EXTRA_SKIP, 0, 0 }
 
 
 /** @cond devel */
 
 /** Terminate list of extra test options. */
-#define PCUT_TEST_EXTRA_LAST { PCUT_EXTRA_LAST, 0 }
+#define PCUT_TEST_EXTRA_LAST { PCUT_EXTRA_LAST, 0, 0 }
 
 /** Define a new test with given name and given item number.
  *
@@ -203,6 +203,102 @@
 
 
 
+/*
+ * Benchmark related macros
+ * ------------------------
+ */
+
+/** Set number of warm-up iterations of a benchmark.
+ *
+ * Use as argument to PCUT_BENCHMARK().
+ *
+ * @param count Number of iterations executed before the measurement.
+ */
+#define PCUT_BENCHMARK_WARMUP(count) \
+	{ PCUT_EXTRA_BENCHMARK_WARMUP, 0, (count) }
+
+/** Set number of measured rounds of a benchmark.
+ *
+ * Use as argument to PCUT_BENCHMARK().
+ *
+ * @param count Number of rounds the statistics are computed from.
+ */
+#define PCUT_BENCHMARK_ROUNDS(count) \
+	{ PCUT_EXTRA_BENCHMARK_ROUNDS, 0, (count) }
+
+/** Set expected duration of one benchmark iteration.
+ *
+ * Use as argument to PCUT_BENCHMARK(). The benchmark fails when
+ * the median duration of an iteration exceeds the baseline by more
+ * than the tolerance.
+ *
+ * @param ns Expected duration of one iteration in nanoseconds.
+ */
+#define PCUT_BENCHMARK_BASELINE(ns) \
+	{ PCUT_EXTRA_BENCHMARK_BASELINE, 0, (ns) }
+
+/** Set tolerance of the baseline comparison.
+ *
+ * Use as argument to PCUT_BENCHMARK().
+ *
+ * @param percent Allowed slow-down against the baseline in percents.
+ */
+#define PCUT_BENCHMARK_TOLERANCE(percent) \
+	{ PCUT_EXTRA_BENCHMARK_TOLERANCE, 0, (percent) }
+
+/** @cond devel */
+
+void pcut_run_benchmark(pcut_extra_t *extras, pcut_test_func_t body);
+
+/** Define a new benchmark with given name and given item number.
+ *
+ * The benchmark is an ordinary test whose function repeatedly
+ * executes the body and measures its duration.
+ *
+ * @param benchname A valid C identifier name (not quoted).
+ * @param number Number of the item describing this benchmark.
+ * @param ... Extra benchmark properties.
+ */
+#define PCUT_BENCHMARK_WITH_NUMBER(number, benchname, ...) \
+	PCUT_ITEM_COUNTER_INCREMENT \
+	static pcut_extra_t PCUT_ITEM_EXTRAS_NAME(number)[] = { \
+		__VA_ARGS__ \
+	}; \
+	static int PCUT_CC_UNUSED_VARIABLE(PCUT_JOIN(benchname, 0_test_name_missing_or_duplicated), 0); \
+	static void PCUT_JOIN(bench_, benchname)(void); \
+	static void PCUT_JOIN(test_, benchname)(void) \
+	{ \
+		pcut_run_benchmark(PCUT_ITEM_EXTRAS_NAME(number), \
+		    PCUT_JOIN(bench_, benchname)); \
+	} \
+	PCUT_ADD_ITEM(number, PCUT_KIND_TEST, \
+		PCUT_QUOTE(benchname), \
+		PCUT_JOIN(test_, benchname), \
+		NULL, NULL, \
+		PCUT_ITEM_EXTRAS_NAME(number), \
+		NULL, NULL \
+	); \
+	void PCUT_JOIN(bench_, benchname)(void)
+
+/** @endcond */
+
+/** Define a new benchmark with given name.
+ *
+ * The body of the benchmark is a single iteration of the measured
+ * operation. Set-up and tear-down functions of the suite are executed
+ * once around the whole measurement.
+ *
+ * @param ... Benchmark name (C identifier) followed by extra properties.
+ */
+#define PCUT_BENCHMARK(...) \
+	PCUT_BENCHMARK_WITH_NUMBER(PCUT_ITEM_COUNTER, \
+		PCUT_VARG_GET_FIRST(__VA_ARGS__, this_arg_is_ignored), \
+		PCUT_VARG_SKIP_FIRST(__VA_ARGS__, PCUT_TEST_EXTRA_LAST) \
+	)
+
+
+
+
 /*
  * Test suite related macros
  * -------------------------
@@ -0,0 +1,244 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ * Execution of benchmarks and computation of their statistics.
+ *
+ * As with assertions, only static buffers are used so that the
+ * framework does not disturb benchmarks of the memory allocator.
+ */
+
+#include "internal.h"
+#include <stdio.h>
+
+/** Default number of warm-up iterations. */
+#define DEFAULT_WARMUP 100
+
+/** Default number of measured rounds. */
+#define DEFAULT_ROUNDS 10
+
+/** Maximum number of measured rounds. */
+#define MAX_ROUNDS 100
+
+/** Default allowed slow-down against the baseline (in percents). */
+#define DEFAULT_TOLERANCE 20
+
+/** Minimal duration of one measured round in nanoseconds.
+ *
+ * Several iterations are batched in one round so that the resolution
+ * of the system clock does not affect the results.
+ */
+#define MIN_ROUND_NS 10000000ULL
+
+/** Maximum number of iterations in one round. */
+#define MAX_ROUND_ITERATIONS (1UL << 30)
+
+/** Maximum length of the regression message. */
+#define MAX_MESSAGE_LENGTH 256
+
+/** Durations of single iterations (in nanoseconds) in each round. */
+static unsigned long long round_ns[MAX_ROUNDS];
+
+/** Buffer for the regression message. */
+static char message_buffer[MAX_MESSAGE_LENGTH + 1];
+
+/** Run the benchmark body given number of times.
+ *
+ * @param body Benchmark body.
+ * @param iterations Number of iterations.
+ * @return Elapsed time in nanoseconds.
+ */
+static unsigned long long run_iterations(pcut_test_func_t body,
+    unsigned long iterations)
+{
+	unsigned long long start = pcut_get_time_ns();
+	unsigned long i;
+
+	for (i = 0; i < iterations; i++) {
+		body();
+	}
+
+	return pcut_get_time_ns() - start;
+}
+
+/** Find number of iterations that fill one round.
+ *
+ * @param body Benchmark body.
+ * @return Number of iterations per round.
+ */
+static unsigned long calibrate(pcut_test_func_t body)
+{
+	unsigned long iterations = 1;
+
+	while (iterations < MAX_ROUND_ITERATIONS) {
+		unsigned long long elapsed = run_iterations(body, iterations);
+		if (elapsed >= MIN_ROUND_NS) {
+			break;
+		}
+
+		/* Aim directly at the round length once the clock ticked. */
+		if ((elapsed > 0) && (elapsed * 8 >= MIN_ROUND_NS)) {
+			iterations = (unsigned long)
+			    (iterations * MIN_ROUND_NS / elapsed + 1);
+			break;
+		}
+
+		iterations *= 2;
+	}
+
+	if (iterations > MAX_ROUND_ITERATIONS) {
+		iterations = MAX_ROUND_ITERATIONS;
+	}
+
+	return iterations;
+}
+
+/** Integer square root.
+ *
+ * @param value Number to take square root of.
+ * @return Floor of the square root.
+ */
+static unsigned long long isqrt(unsigned long long value)
+{
+	unsigned long long x = value;
+	unsigned long long y = (x + 1) / 2;
+
+	while (y < x) {
+		x = y;
+		y = (x + value / x) / 2;
+	}
+
+	return x;
+}
+
+/** Sort durations of the rounds in ascending order.
+ *
+ * @param count Number of rounds.
+ */
+static void sort_rounds(int count)
+{
+	int i;
+	int j;
+
+	for (i = 1; i < count; i++) {
+		unsigned long long val = round_ns[i];
+		for (j = i; (j > 0) && (round_ns[j - 1] > val); j--) {
+			round_ns[j] = round_ns[j - 1];
+		}
+		round_ns[j] = val;
+	}
+}
+
+/** Run a benchmark and report its statistics.
+ *
+ * The body is first run for the warm-up iterations. Then the number
+ * of iterations per round is calibrated and the rounds are measured.
+ * The statistics are printed to the standard output (which is part
+ * of the test report) and the median is compared with the baseline
+ * if one was specified.
+ *
+ * @warning This function calls pcut_failed_assertion() when
+ * a regression is detected and does not return in such case.
+ *
+ * @param extras Extra benchmark properties.
+ * @param body Benchmark body executing a single iteration.
+ */
+void pcut_run_benchmark(pcut_extra_t *extras, pcut_test_func_t body)
+{
+	unsigned long warmup = DEFAULT_WARMUP;
+	unsigned long rounds = DEFAULT_ROUNDS;
+	unsigned long baseline = 0;
+	unsigned long tolerance = DEFAULT_TOLERANCE;
+	unsigned long iterations;
+	unsigned long long sum = 0;
+	unsigned long long variance = 0;
+	unsigned long long mean;
+	unsigned long long median;
+	int count;
+	int i;
+
+	while (extras->type != PCUT_EXTRA_LAST) {
+		switch (extras->type) {
+		case PCUT_EXTRA_BENCHMARK_WARMUP:
+			warmup = extras->benchmark_value;
+			break;
+		case PCUT_EXTRA_BENCHMARK_ROUNDS:
+			rounds = extras->benchmark_value;
+			break;
+		case PCUT_EXTRA_BENCHMARK_BASELINE:
+			baseline = extras->benchmark_value;
+			break;
+		case PCUT_EXTRA_BENCHMARK_TOLERANCE:
+			tolerance = extras->benchmark_value;
+			break;
+		default:
+			break;
+		}
+		extras++;
+	}
+
+	if (rounds < 1) {
+		rounds = 1;
+	}
+	if (rounds > MAX_ROUNDS) {
+		rounds = MAX_ROUNDS;
+	}
+	count = (int) rounds;
+
+	run_iterations(body, warmup);
+	iterations = calibrate(body);
+
+	for (i = 0; i < count; i++) {
+		round_ns[i] = run_iterations(body, iterations) / iterations;
+		sum += round_ns[i];
+	}
+
+	mean = sum / count;
+	for (i = 0; i < count; i++) {
+		unsigned long long diff = round_ns[i] > mean ?
+		    round_ns[i] - mean : mean - round_ns[i];
+		variance += diff * diff;
+	}
+	variance /= count;
+
+	sort_rounds(count);
+	median = round_ns[count / 2];
+
+	printf("%d rounds of %lu iterations: min %llu ns, median %llu ns, "
+	    "mean %llu ns (stddev %llu ns), max %llu ns\n", count, iterations,
+	    round_ns[0], median, mean, isqrt(variance), round_ns[count - 1]);
+
+	if ((baseline > 0) &&
+	    (median * 100 > (unsigned long long) baseline * (100 + tolerance))) {
+		snprintf(message_buffer, MAX_MESSAGE_LENGTH,
+		    "Performance regression: median %llu ns exceeds baseline "
+		    "%lu ns by more than %lu%%", median, baseline, tolerance);
+		pcut_failed_assertion(message_buffer);
+	}
+}
@@ -104,6 +104,8 @@ int pcut_run_test_single(pcut_item_t *test);
 
 int pcut_get_test_timeout(pcut_item_t *test);
 
+unsigned long long pcut_get_time_ns(void);
+
 void pcut_failed_assertion(const char *message);
 void pcut_print_fail_message(const char *msg);
 
@@ -38,6 +38,7 @@
 #include <assert.h>
 #include <stdio.h>
 #include <task.h>
+#include <sys/time.h>
 #include <fibril_synch.h>
 #include <vfs/vfs.h>
 #include "../internal.h"
@@ -82,6 +83,17 @@ void pcut_str_error(errno_t error, char *buffer, int size)
 }
 
 
+/* Time measurement. */
+
+unsigned long long pcut_get_time_ns(void)
+{
+	struct timeval tv;
+	getuptime(&tv);
+	return (unsigned long long) tv.tv_sec * 1000000000ULL +
+	    (unsigned long long) tv.tv_usec * 1000ULL;
+}
+
+
 /* Forking-mode related functions. */
 
 /** Maximum width of a test number. */
@@ -32,6 +32,7 @@
  */
 
 #include <string.h>
+#include <time.h>
 #include "../internal.h"
 
 int pcut_str_equals(const char *a, const char *b)
@@ -69,3 +70,8 @@ void pcut_str_error(int error, char *buffer, int size)
 	/* Ensure correct termination. */
 	buffer[size - 1] = 0;
 }
+
+unsigned long long pcut_get_time_ns(void)
+{
+	return (unsigned long long) clock() * 1000000000ULL / CLOCKS_PER_SEC;
+}
@@ -33,26 +33,45 @@
 #define POSIX_PTHREAD_H_
 
 #include "libc/thread.h"
+#include "stddef.h"
 #include "time.h"
 
 typedef thread_id_t pthread_t;
 
+#define PTHREAD_CREATE_JOINABLE 0
+#define PTHREAD_CREATE_DETACHED 1
+
 typedef struct {
-	int dummy;
+	int detachstate;
 } pthread_attr_t;
 
 typedef int pthread_key_t;
 
+#define PTHREAD_KEYS_MAX 64
+#define PTHREAD_DESTRUCTOR_ITERATIONS 4
+
+#define PTHREAD_MUTEX_NORMAL 0
 #define PTHREAD_MUTEX_RECURSIVE 1
+#define PTHREAD_MUTEX_ERRORCHECK 2
+#define PTHREAD_MUTEX_DEFAULT PTHREAD_MUTEX_NORMAL
+
+/*
+ * The synchronization objects are allocated on first use, so that
+ * the static initializers do not depend on the libc internals.
+ */
+struct __posix_mutex;
+struct __posix_cond;
+struct __posix_rwlock;
 
 typedef struct pthread_mutex {
-	int dummy;
+	struct __posix_mutex *impl;
+	int type;
 } pthread_mutex_t;
 
-#define PTHREAD_MUTEX_INITIALIZER { 0 }
+#define PTHREAD_MUTEX_INITIALIZER { NULL, PTHREAD_MUTEX_DEFAULT }
 
 typedef struct {
-	int dummy;
+	int type;
 } pthread_mutexattr_t;
 
 typedef struct {
@@ -60,10 +79,20 @@ typedef struct {
 } pthread_condattr_t;
 
 typedef struct {
-	int dummy;
+	struct __posix_cond *impl;
 } pthread_cond_t;
 
-#define PTHREAD_COND_INITIALIZER { 0 }
+#define PTHREAD_COND_INITIALIZER { NULL }
+
+typedef struct {
+	int dummy;
+} pthread_rwlockattr_t;
+
+typedef struct {
+	struct __posix_rwlock *impl;
+} pthread_rwlock_t;
+
+#define PTHREAD_RWLOCK_INITIALIZER { NULL }
 
 extern pthread_t pthread_self(void);
 extern int pthread_equal(pthread_t, pthread_t);
@@ -74,6 +103,10 @@ extern int pthread_detach(pthread_t);
 
 extern int pthread_attr_init(pthread_attr_t *);
 extern int pthread_attr_destroy(pthread_attr_t *);
+extern int pthread_attr_getdetachstate(const pthread_attr_t *, int *);
+extern int pthread_attr_setdetachstate(pthread_attr_t *, int);
+
+extern int pthread_setaffinity_np(pthread_t, size_t, const cpuset_t *);
 
 extern int pthread_mutex_init(pthread_mutex_t *__restrict__,
     const pthread_mutexattr_t *__restrict__);
@@ -101,6 +134,18 @@ extern int pthread_cond_wait(pthread_cond_t *__restrict__,
 extern int pthread_condattr_destroy(pthread_condattr_t *);
 extern int pthread_condattr_init(pthread_condattr_t *);
 
+extern int pthread_rwlock_init(pthread_rwlock_t *__restrict__,
+    const pthread_rwlockattr_t *__restrict__);
+extern int pthread_rwlock_destroy(pthread_rwlock_t *);
+extern int pthread_rwlock_rdlock(pthread_rwlock_t *);
+extern int pthread_rwlock_tryrdlock(pthread_rwlock_t *);
+extern int pthread_rwlock_wrlock(pthread_rwlock_t *);
+extern int pthread_rwlock_trywrlock(pthread_rwlock_t *);
+extern int pthread_rwlock_unlock(pthread_rwlock_t *);
+
+extern int pthread_rwlockattr_init(pthread_rwlockattr_t *);
+extern int pthread_rwlockattr_destroy(pthread_rwlockattr_t *);
+
 extern void *pthread_getspecific(pthread_key_t);
 extern int pthread_setspecific(pthread_key_t, const void *);
 extern int pthread_key_delete(pthread_key_t);
@@ -55,9 +55,14 @@
 #define PROT_WRITE AS_AREA_WRITE
 #define PROT_EXEC  AS_AREA_EXEC
 
+#define MS_ASYNC       (1 << 0)
+#define MS_SYNC        (1 << 1)
+#define MS_INVALIDATE  (1 << 2)
+
 extern void *mmap(void *start, size_t length, int prot, int flags, int fd,
     off_t offset);
 extern int munmap(void *start, size_t length);
+extern int msync(void *addr, size_t len, int flags);
 
 
 #endif /* POSIX_SYS_MMAN_H_ */
@@ -33,61 +33,182 @@
  */
 
 #include "posix/pthread.h"
+#include "posix/stdlib.h"
 #include "errno.h"
+#include "libc/futex.h"
+#include "libc/sys/time.h"
 #include "../internal/common.h"
 
+/*
+ * The waiters sleep on a counting futex, each signal posts one wakeup
+ * for one of the waiters counted so far. A waiter whose wait times out
+ * while a wakeup is being posted for it leaves the wakeup behind, which
+ * results in a spurious wakeup of a later waiter, as allowed by POSIX.
+ */
+struct __posix_cond {
+	/** Protects @c waiters. */
+	futex_t guard;
+	/** Waiters sleep here. */
+	futex_t sleep;
+	/** Number of waiters not woken up yet. */
+	unsigned int waiters;
+};
+
+/** Get the condition variable object, allocating it on first use. */
+static struct __posix_cond *cond_get(pthread_cond_t *condvar)
+{
+	struct __posix_cond *impl =
+	    __atomic_load_n(&condvar->impl, __ATOMIC_ACQUIRE);
+	if (impl != NULL)
+		return impl;
+
+	struct __posix_cond *new_impl = malloc(sizeof(struct __posix_cond));
+	if (new_impl == NULL)
+		return NULL;
+
+	futex_initialize(&new_impl->guard, 1);
+	futex_initialize(&new_impl->sleep, 0);
+	new_impl->waiters = 0;
+
+	if (!__atomic_compare_exchange_n(&condvar->impl, &impl, new_impl,
+	    false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+		free(new_impl);
+		return impl;
+	}
+
+	return new_impl;
+}
+
 int pthread_cond_init(pthread_cond_t *restrict condvar,
     const pthread_condattr_t *restrict attr)
 {
-	not_implemented();
-	return ENOTSUP;
+	condvar->impl = NULL;
+	return EOK;
 }
 
 int pthread_cond_destroy(pthread_cond_t *condvar)
 {
-	not_implemented();
-	return ENOTSUP;
+	struct __posix_cond *impl = condvar->impl;
+	if (impl != NULL) {
+		if (impl->waiters > 0)
+			return EBUSY;
+
+		free(impl);
+		condvar->impl = NULL;
+	}
+
+	return EOK;
+}
+
+static int cond_wake(pthread_cond_t *condvar, bool all)
+{
+	struct __posix_cond *impl = __atomic_load_n(&condvar->impl,
+	    __ATOMIC_ACQUIRE);
+
+	/* Nobody could have waited for a condition variable never used */
+	if (impl == NULL)
+		return EOK;
+
+	futex_lock(&impl->guard);
+
+	while (impl->waiters > 0) {
+		impl->waiters--;
+		futex_up(&impl->sleep);
+
+		if (!all)
+			break;
+	}
+
+	futex_unlock(&impl->guard);
+	return EOK;
 }
 
 int pthread_cond_broadcast(pthread_cond_t *condvar)
 {
-	not_implemented();
-	return ENOTSUP;
+	return cond_wake(condvar, true);
 }
 
 int pthread_cond_signal(pthread_cond_t *condvar)
 {
-	not_implemented();
-	return ENOTSUP;
+	return cond_wake(condvar, false);
+}
+
+/** Wait for a condition variable.
+ *
+ * @param condvar Condition variable.
+ * @param mutex   Mutex held by the caller.
+ * @param expires Uptime when the wait times out or NULL.
+ */
+static int cond_wait(pthread_cond_t *condvar, pthread_mutex_t *mutex,
+    struct timeval *expires)
+{
+	struct __posix_cond *impl = cond_get(condvar);
+	if (impl == NULL)
+		return ENOMEM;
+
+	futex_lock(&impl->guard);
+	impl->waiters++;
+	futex_unlock(&impl->guard);
+
+	int rc = pthread_mutex_unlock(mutex);
+	if (rc != EOK) {
+		futex_lock(&impl->guard);
+		impl->waiters--;
+		futex_unlock(&impl->guard);
+		return rc;
+	}
+
+	errno_t frc = futex_down_timeout(&impl->sleep, expires);
+	if (frc != EOK) {
+		/*
+		 * If no waiter is counted any more, a wakeup has been
+		 * posted for us meanwhile and it stays behind instead.
+		 */
+		futex_lock(&impl->guard);
+		if (impl->waiters > 0)
+			impl->waiters--;
+		futex_unlock(&impl->guard);
+	}
+
+	pthread_mutex_lock(mutex);
+	return (frc == EOK) ? EOK : ETIMEDOUT;
 }
 
 int pthread_cond_timedwait(pthread_cond_t *restrict condvar,
     pthread_mutex_t *restrict mutex, const struct timespec *restrict timeout)
 {
-	not_implemented();
-	return ENOTSUP;
+	/* Convert the absolute real time to uptime */
+	struct timeval now;
+	gettimeofday(&now, NULL);
+
+	struct timeval deadline;
+	deadline.tv_sec = timeout->tv_sec;
+	deadline.tv_usec = timeout->tv_nsec / 1000;
+
+	struct timeval expires;
+	getuptime(&expires);
+
+	if (tv_gt(&deadline, &now))
+		tv_add_diff(&expires, tv_sub_diff(&deadline, &now));
+
+	return cond_wait(condvar, mutex, &expires);
 }
 
 int pthread_cond_wait(pthread_cond_t *restrict condvar,
     pthread_mutex_t *restrict mutex)
 {
-	not_implemented();
-	return ENOTSUP;
+	return cond_wait(condvar, mutex, NULL);
 }
 
-
 int pthread_condattr_init(pthread_condattr_t *attr)
 {
-	not_implemented();
-	return ENOTSUP;
+	return EOK;
 }
 
 int pthread_condattr_destroy(pthread_condattr_t *attr)
 {
-	not_implemented();
-	return ENOTSUP;
+	return EOK;
 }
 
-
 /** @}
  */
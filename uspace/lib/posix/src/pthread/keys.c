@@ -35,31 +35,123 @@
 #include "posix/stdlib.h"
 #include "posix/pthread.h"
 #include <errno.h>
+#include "libc/fibril.h"
+#include "libc/futex.h"
 #include "../internal/common.h"
+#include "internal.h"
 
+/** Destructors of allocated keys (NULL if none). */
+static void (*key_destructors[PTHREAD_KEYS_MAX])(void *);
+static bool key_allocated[PTHREAD_KEYS_MAX];
+/** Incremented whenever a key is allocated. */
+static unsigned int key_generations[PTHREAD_KEYS_MAX];
+static futex_t keys_futex = FUTEX_INITIALIZER;
+
+/** Thread specific value. */
+typedef struct {
+	void *value;
+	/**
+	 * Generation of the key the value was set for. A value left over
+	 * from a deleted key does not match the generation of a key reusing
+	 * the slot, which thus reads as NULL in all threads.
+	 */
+	unsigned int generation;
+} key_value_t;
+
+/** Thread specific values, in the thread local storage. */
+static fibril_local key_value_t key_values[PTHREAD_KEYS_MAX];
+
+static unsigned int key_generation(pthread_key_t key)
+{
+	return __atomic_load_n(&key_generations[key], __ATOMIC_RELAXED);
+}
 
 void *pthread_getspecific(pthread_key_t key)
 {
-	not_implemented();
-	return NULL;
+	if ((key < 0) || (key >= PTHREAD_KEYS_MAX))
+		return NULL;
+
+	if (key_values[key].generation != key_generation(key))
+		return NULL;
+
+	return key_values[key].value;
 }
 
 int pthread_setspecific(pthread_key_t key, const void *data)
 {
-	not_implemented();
-	return ENOTSUP;
+	if ((key < 0) || (key >= PTHREAD_KEYS_MAX))
+		return EINVAL;
+
+	key_values[key].value = (void *) data;
+	key_values[key].generation = key_generation(key);
+	return EOK;
 }
 
 int pthread_key_delete(pthread_key_t key)
 {
-	not_implemented();
-	return ENOTSUP;
+	if ((key < 0) || (key >= PTHREAD_KEYS_MAX))
+		return EINVAL;
+
+	futex_lock(&keys_futex);
+
+	if (!key_allocated[key]) {
+		futex_unlock(&keys_futex);
+		return EINVAL;
+	}
+
+	key_allocated[key] = false;
+	key_destructors[key] = NULL;
+
+	futex_unlock(&keys_futex);
+	return EOK;
 }
 
 int pthread_key_create(pthread_key_t *key, void (*destructor)(void *))
 {
-	not_implemented();
-	return ENOTSUP;
+	futex_lock(&keys_futex);
+
+	for (pthread_key_t i = 0; i < PTHREAD_KEYS_MAX; i++) {
+		if (!key_allocated[i]) {
+			key_allocated[i] = true;
+			key_destructors[i] = destructor;
+			__atomic_store_n(&key_generations[i],
+			    key_generations[i] + 1, __ATOMIC_RELAXED);
+			futex_unlock(&keys_futex);
+
+			*key = i;
+			return EOK;
+		}
+	}
+
+	futex_unlock(&keys_futex);
+	return EAGAIN;
+}
+
+/** Call destructors of the thread specific values of a terminating thread. */
+void __pthread_keys_destroy(void)
+{
+	for (int iter = 0; iter < PTHREAD_DESTRUCTOR_ITERATIONS; iter++) {
+		bool called = false;
+
+		for (pthread_key_t i = 0; i < PTHREAD_KEYS_MAX; i++) {
+			void *value = pthread_getspecific(i);
+			if (value == NULL)
+				continue;
+
+			futex_lock(&keys_futex);
+			void (*destructor)(void *) = key_destructors[i];
+			futex_unlock(&keys_futex);
+
+			key_values[i].value = NULL;
+			if (destructor != NULL) {
+				destructor(value);
+				called = true;
+			}
+		}
+
+		if (!called)
+			break;
+	}
 }
 
 /** @}
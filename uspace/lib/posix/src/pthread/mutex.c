@@ -33,67 +33,182 @@
  */
 
 #include "posix/pthread.h"
+#include "posix/stdlib.h"
 #include <errno.h>
+#include "libc/futex.h"
 #include "../internal/common.h"
+#include "internal.h"
 
+struct __posix_mutex {
+	futex_t futex;
+	int type;
+	/** Holder of a recursive or error checking mutex. */
+	pthread_t owner;
+	/** Recursion depth of a recursive mutex. */
+	unsigned int count;
+};
+
+/** Get the mutex object, allocating it on first use.
+ *
+ * Mutexes initialized by PTHREAD_MUTEX_INITIALIZER have no object yet.
+ * If more threads race to allocate it, only one of the objects is used.
+ */
+static struct __posix_mutex *mutex_get(pthread_mutex_t *mutex)
+{
+	struct __posix_mutex *impl =
+	    __atomic_load_n(&mutex->impl, __ATOMIC_ACQUIRE);
+	if (impl != NULL)
+		return impl;
+
+	struct __posix_mutex *new_impl = malloc(sizeof(struct __posix_mutex));
+	if (new_impl == NULL)
+		return NULL;
+
+	futex_initialize(&new_impl->futex, 1);
+	new_impl->type = mutex->type;
+	new_impl->owner = 0;
+	new_impl->count = 0;
+
+	if (!__atomic_compare_exchange_n(&mutex->impl, &impl, new_impl, false,
+	    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+		free(new_impl);
+		return impl;
+	}
+
+	return new_impl;
+}
+
+static pthread_t mutex_owner(struct __posix_mutex *impl)
+{
+	return __atomic_load_n(&impl->owner, __ATOMIC_RELAXED);
+}
 
 int pthread_mutex_init(pthread_mutex_t *restrict mutex,
     const pthread_mutexattr_t *restrict attr)
 {
-	not_implemented();
-	return ENOTSUP;
+	mutex->impl = NULL;
+	mutex->type = (attr != NULL) ? attr->type : PTHREAD_MUTEX_DEFAULT;
+	return EOK;
 }
 
 int pthread_mutex_destroy(pthread_mutex_t *mutex)
 {
-	not_implemented();
-	return ENOTSUP;
+	struct __posix_mutex *impl = mutex->impl;
+	if (impl != NULL) {
+		if (futex_trydown(&impl->futex) == false)
+			return EBUSY;
+
+		free(impl);
+		mutex->impl = NULL;
+	}
+
+	return EOK;
+}
+
+/** Check whether the caller already holds a recursive or error checking mutex. */
+static bool mutex_is_owner(struct __posix_mutex *impl)
+{
+	return (impl->type != PTHREAD_MUTEX_NORMAL) &&
+	    (mutex_owner(impl) == __pthread_self());
+}
+
+static void mutex_set_owner(struct __posix_mutex *impl)
+{
+	if (impl->type == PTHREAD_MUTEX_NORMAL)
+		return;
+
+	__atomic_store_n(&impl->owner, __pthread_self(), __ATOMIC_RELAXED);
+	impl->count = 1;
 }
 
 int pthread_mutex_lock(pthread_mutex_t *mutex)
 {
-	not_implemented();
-	return ENOTSUP;
+	struct __posix_mutex *impl = mutex_get(mutex);
+	if (impl == NULL)
+		return ENOMEM;
+
+	if (mutex_is_owner(impl)) {
+		if (impl->type == PTHREAD_MUTEX_ERRORCHECK)
+			return EDEADLK;
+
+		impl->count++;
+		return EOK;
+	}
+
+	futex_lock(&impl->futex);
+	mutex_set_owner(impl);
+	return EOK;
 }
 
 int pthread_mutex_trylock(pthread_mutex_t *mutex)
 {
-	not_implemented();
-	return ENOTSUP;
+	struct __posix_mutex *impl = mutex_get(mutex);
+	if (impl == NULL)
+		return ENOMEM;
+
+	if (mutex_is_owner(impl)) {
+		if (impl->type == PTHREAD_MUTEX_ERRORCHECK)
+			return EBUSY;
+
+		impl->count++;
+		return EOK;
+	}
+
+	if (!futex_trydown(&impl->futex))
+		return EBUSY;
+
+	mutex_set_owner(impl);
+	return EOK;
 }
 
 int pthread_mutex_unlock(pthread_mutex_t *mutex)
 {
-	not_implemented();
-	return ENOTSUP;
+	struct __posix_mutex *impl = mutex->impl;
+	if (impl == NULL)
+		return EPERM;
+
+	if (impl->type != PTHREAD_MUTEX_NORMAL) {
+		if (mutex_owner(impl) != __pthread_self())
+			return EPERM;
+
+		if (--impl->count > 0)
+			return EOK;
+
+		__atomic_store_n(&impl->owner, 0, __ATOMIC_RELAXED);
+	}
+
+	futex_unlock(&impl->futex);
+	return EOK;
 }
 
 int pthread_mutexattr_init(pthread_mutexattr_t *attr)
 {
-	not_implemented();
-	return ENOTSUP;
+	attr->type = PTHREAD_MUTEX_DEFAULT;
+	return EOK;
 }
 
 int pthread_mutexattr_destroy(pthread_mutexattr_t *attr)
 {
-	not_implemented();
-	return ENOTSUP;
+	return EOK;
 }
 
 int pthread_mutexattr_gettype(const pthread_mutexattr_t *restrict attr,
     int *restrict type)
 {
-	not_implemented();
-	return ENOTSUP;
+	*type = attr->type;
+	return EOK;
 }
 
 int pthread_mutexattr_settype(pthread_mutexattr_t *attr, int type)
 {
-	not_implemented();
-	return ENOTSUP;
-}
-
+	if ((type != PTHREAD_MUTEX_NORMAL) &&
+	    (type != PTHREAD_MUTEX_RECURSIVE) &&
+	    (type != PTHREAD_MUTEX_ERRORCHECK))
+		return EINVAL;
 
+	attr->type = type;
+	return EOK;
+}
 
 /** @}
  */
@@ -0,0 +1,259 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup libposix
+ * @{
+ */
+/** @file Pthread: read-write locks.
+ */
+
+#include "posix/pthread.h"
+#include "posix/stdlib.h"
+#include "errno.h"
+#include "libc/futex.h"
+#include "../internal/common.h"
+#include "internal.h"
+
+/*
+ * Writers are preferred: once a writer waits, new readers wait as well.
+ * The thread releasing the lock hands it over to the waiting writer or
+ * to all the waiting readers directly, the woken up threads already
+ * own the lock.
+ */
+struct __posix_rwlock {
+	/** Protects the rest of the structure. */
+	futex_t guard;
+	/** Waiting readers sleep here. */
+	futex_t readers_sleep;
+	/** Waiting writers sleep here. */
+	futex_t writers_sleep;
+	/** Number of readers holding the lock. */
+	unsigned int readers;
+	/** Number of readers waiting for the lock. */
+	unsigned int readers_waiting;
+	/** Number of writers waiting for the lock. */
+	unsigned int writers_waiting;
+	/** Writer holding the lock or zero. */
+	pthread_t writer;
+};
+
+/** Get the lock object, allocating it on first use. */
+static struct __posix_rwlock *rwlock_get(pthread_rwlock_t *rwlock)
+{
+	struct __posix_rwlock *impl =
+	    __atomic_load_n(&rwlock->impl, __ATOMIC_ACQUIRE);
+	if (impl != NULL)
+		return impl;
+
+	struct __posix_rwlock *new_impl =
+	    malloc(sizeof(struct __posix_rwlock));
+	if (new_impl == NULL)
+		return NULL;
+
+	futex_initialize(&new_impl->guard, 1);
+	futex_initialize(&new_impl->readers_sleep, 0);
+	futex_initialize(&new_impl->writers_sleep, 0);
+	new_impl->readers = 0;
+	new_impl->readers_waiting = 0;
+	new_impl->writers_waiting = 0;
+	new_impl->writer = 0;
+
+	if (!__atomic_compare_exchange_n(&rwlock->impl, &impl, new_impl,
+	    false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+		free(new_impl);
+		return impl;
+	}
+
+	return new_impl;
+}
+
+int pthread_rwlock_init(pthread_rwlock_t *restrict rwlock,
+    const pthread_rwlockattr_t *restrict attr)
+{
+	rwlock->impl = NULL;
+	return EOK;
+}
+
+int pthread_rwlock_destroy(pthread_rwlock_t *rwlock)
+{
+	struct __posix_rwlock *impl = rwlock->impl;
+	if (impl != NULL) {
+		if ((impl->readers > 0) || (impl->writer != 0))
+			return EBUSY;
+
+		free(impl);
+		rwlock->impl = NULL;
+	}
+
+	return EOK;
+}
+
+static int rwlock_rdlock(pthread_rwlock_t *rwlock, bool wait)
+{
+	struct __posix_rwlock *impl = rwlock_get(rwlock);
+	if (impl == NULL)
+		return ENOMEM;
+
+	futex_lock(&impl->guard);
+
+	if ((impl->writer == 0) && (impl->writers_waiting == 0)) {
+		impl->readers++;
+		futex_unlock(&impl->guard);
+		return EOK;
+	}
+
+	if (impl->writer == __pthread_self()) {
+		futex_unlock(&impl->guard);
+		return EDEADLK;
+	}
+
+	if (!wait) {
+		futex_unlock(&impl->guard);
+		return EBUSY;
+	}
+
+	impl->readers_waiting++;
+	futex_unlock(&impl->guard);
+
+	/* The lock is handed over to us */
+	futex_down(&impl->readers_sleep);
+	return EOK;
+}
+
+static int rwlock_wrlock(pthread_rwlock_t *rwlock, bool wait)
+{
+	struct __posix_rwlock *impl = rwlock_get(rwlock);
+	if (impl == NULL)
+		return ENOMEM;
+
+	pthread_t self = __pthread_self();
+
+	futex_lock(&impl->guard);
+
+	if ((impl->writer == 0) && (impl->readers == 0)) {
+		impl->writer = self;
+		futex_unlock(&impl->guard);
+		return EOK;
+	}
+
+	if (impl->writer == self) {
+		futex_unlock(&impl->guard);
+		return EDEADLK;
+	}
+
+	if (!wait) {
+		futex_unlock(&impl->guard);
+		return EBUSY;
+	}
+
+	impl->writers_waiting++;
+	futex_unlock(&impl->guard);
+
+	/* The lock is handed over to us, but the owner is not known yet */
+	futex_down(&impl->writers_sleep);
+
+	futex_lock(&impl->guard);
+	impl->writer = self;
+	futex_unlock(&impl->guard);
+
+	return EOK;
+}
+
+int pthread_rwlock_rdlock(pthread_rwlock_t *rwlock)
+{
+	return rwlock_rdlock(rwlock, true);
+}
+
+int pthread_rwlock_tryrdlock(pthread_rwlock_t *rwlock)
+{
+	return rwlock_rdlock(rwlock, false);
+}
+
+int pthread_rwlock_wrlock(pthread_rwlock_t *rwlock)
+{
+	return rwlock_wrlock(rwlock, true);
+}
+
+int pthread_rwlock_trywrlock(pthread_rwlock_t *rwlock)
+{
+	return rwlock_wrlock(rwlock, false);
+}
+
+int pthread_rwlock_unlock(pthread_rwlock_t *rwlock)
+{
+	struct __posix_rwlock *impl = rwlock->impl;
+	if (impl == NULL)
+		return EPERM;
+
+	futex_lock(&impl->guard);
+
+	if (impl->writer != 0) {
+		if (impl->writer != __pthread_self()) {
+			futex_unlock(&impl->guard);
+			return EPERM;
+		}
+
+		impl->writer = 0;
+	} else if (impl->readers > 0) {
+		impl->readers--;
+	} else {
+		futex_unlock(&impl->guard);
+		return EPERM;
+	}
+
+	if ((impl->writer == 0) && (impl->readers == 0)) {
+		if (impl->writers_waiting > 0) {
+			/* Mark the lock held until the writer records itself */
+			impl->writer = (pthread_t) -1;
+			impl->writers_waiting--;
+			futex_up(&impl->writers_sleep);
+		} else {
+			while (impl->readers_waiting > 0) {
+				impl->readers_waiting--;
+				impl->readers++;
+				futex_up(&impl->readers_sleep);
+			}
+		}
+	}
+
+	futex_unlock(&impl->guard);
+	return EOK;
+}
+
+int pthread_rwlockattr_init(pthread_rwlockattr_t *attr)
+{
+	return EOK;
+}
+
+int pthread_rwlockattr_destroy(pthread_rwlockattr_t *attr)
+{
+	return EOK;
+}
+
+/** @}
+ */
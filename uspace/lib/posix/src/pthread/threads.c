@@ -35,12 +35,79 @@
 #include "posix/pthread.h"
 #include "errno.h"
 #include "posix/stdlib.h"
+#include "libc/adt/list.h"
+#include "libc/fibril.h"
+#include "libc/futex.h"
 #include "libc/thread.h"
 #include "../internal/common.h"
+#include "internal.h"
+
+/** Thread created by pthread_create(). */
+typedef struct {
+	link_t link;
+	pthread_t id;
+	void *(*start_routine)(void *);
+	void *arg;
+	void *ret_val;
+	/** Upped when the thread terminates */
+	futex_t done;
+	bool detached;
+	bool joining;
+	bool exited;
+} posix_thread_t;
+
+/** Threads which have not been joined or detached yet. */
+static LIST_INITIALIZE(threads);
+static futex_t threads_futex = FUTEX_INITIALIZER;
+
+/** Cached ID of the current thread (zero if not known yet). */
+static fibril_local pthread_t self_id;
+
+/** Get the ID of the current thread without a syscall if possible. */
+pthread_t __pthread_self(void)
+{
+	if (self_id == 0)
+		self_id = thread_get_id();
+
+	return self_id;
+}
+
+static posix_thread_t *thread_find(pthread_t id)
+{
+	list_foreach(threads, link, posix_thread_t, thread) {
+		if (thread->id == id)
+			return thread;
+	}
+
+	return NULL;
+}
+
+static void thread_main(void *arg)
+{
+	posix_thread_t *thread = (posix_thread_t *) arg;
+
+	self_id = thread_get_id();
+	void *ret_val = thread->start_routine(thread->arg);
+	__pthread_keys_destroy();
+
+	futex_lock(&threads_futex);
+
+	thread->ret_val = ret_val;
+	thread->exited = true;
+
+	if (thread->detached) {
+		list_remove(&thread->link);
+		free(thread);
+	} else {
+		futex_up(&thread->done);
+	}
+
+	futex_unlock(&threads_futex);
+}
 
 pthread_t pthread_self(void)
 {
-	return thread_get_id();
+	return __pthread_self();
 }
 
 int pthread_equal(pthread_t thread1, pthread_t thread2)
@@ -48,35 +115,142 @@ int pthread_equal(pthread_t thread1, pthread_t thread2)
 	return thread1 == thread2;
 }
 
+/** Create a new thread.
+ *
+ * Each thread is a separate kernel thread, so the threads of a task
+ * can run in parallel on multiple CPUs.
+ */
 int pthread_create(pthread_t *thread_id, const pthread_attr_t *attributes,
     void *(*start_routine)(void *), void *arg)
 {
-	not_implemented();
-	return ENOTSUP;
+	posix_thread_t *thread = calloc(1, sizeof(posix_thread_t));
+	if (thread == NULL)
+		return EAGAIN;
+
+	thread->start_routine = start_routine;
+	thread->arg = arg;
+	thread->detached = (attributes != NULL) &&
+	    (attributes->detachstate == PTHREAD_CREATE_DETACHED);
+	futex_initialize(&thread->done, 0);
+
+	/*
+	 * The thread is registered before it is started, so that it can
+	 * unregister itself whenever it terminates. Until its ID is known,
+	 * the lock also keeps others from looking for it.
+	 */
+	futex_lock(&threads_futex);
+	list_append(&thread->link, &threads);
+
+	thread_id_t id;
+	errno_t rc = thread_create(thread_main, thread, "pthread", &id);
+	if (rc != EOK) {
+		list_remove(&thread->link);
+		futex_unlock(&threads_futex);
+		free(thread);
+		return EAGAIN;
+	}
+
+	thread->id = id;
+	futex_unlock(&threads_futex);
+
+	*thread_id = id;
+	return EOK;
 }
 
-int pthread_join(pthread_t thread, void **ret_val)
+int pthread_join(pthread_t thread_id, void **ret_val)
 {
-	not_implemented();
-	return ENOTSUP;
+	if (thread_id == __pthread_self())
+		return EDEADLK;
+
+	futex_lock(&threads_futex);
+
+	posix_thread_t *thread = thread_find(thread_id);
+	if (thread == NULL) {
+		futex_unlock(&threads_futex);
+		return ESRCH;
+	}
+
+	if ((thread->detached) || (thread->joining)) {
+		futex_unlock(&threads_futex);
+		return EINVAL;
+	}
+
+	thread->joining = true;
+	futex_unlock(&threads_futex);
+
+	futex_down(&thread->done);
+
+	futex_lock(&threads_futex);
+	list_remove(&thread->link);
+	futex_unlock(&threads_futex);
+
+	if (ret_val != NULL)
+		*ret_val = thread->ret_val;
+
+	free(thread);
+	return EOK;
 }
 
-int pthread_detach(pthread_t thread)
+int pthread_detach(pthread_t thread_id)
 {
-	not_implemented();
-	return ENOTSUP;
+	futex_lock(&threads_futex);
+
+	posix_thread_t *thread = thread_find(thread_id);
+	if (thread == NULL) {
+		futex_unlock(&threads_futex);
+		return ESRCH;
+	}
+
+	if ((thread->detached) || (thread->joining)) {
+		futex_unlock(&threads_futex);
+		return EINVAL;
+	}
+
+	if (thread->exited) {
+		list_remove(&thread->link);
+		free(thread);
+	} else {
+		thread->detached = true;
+	}
+
+	futex_unlock(&threads_futex);
+	return EOK;
 }
 
 int pthread_attr_init(pthread_attr_t *attr)
 {
-	not_implemented();
-	return ENOTSUP;
+	attr->detachstate = PTHREAD_CREATE_JOINABLE;
+	return EOK;
 }
 
 int pthread_attr_destroy(pthread_attr_t *attr)
 {
-	not_implemented();
-	return ENOTSUP;
+	return EOK;
+}
+
+int pthread_attr_getdetachstate(const pthread_attr_t *attr, int *detachstate)
+{
+	*detachstate = attr->detachstate;
+	return EOK;
+}
+
+int pthread_attr_setdetachstate(pthread_attr_t *attr, int detachstate)
+{
+	if ((detachstate != PTHREAD_CREATE_JOINABLE) &&
+	    (detachstate != PTHREAD_CREATE_DETACHED))
+		return EINVAL;
+
+	attr->detachstate = detachstate;
+	return EOK;
+}
+
+int pthread_setaffinity_np(pthread_t thread_id, size_t cpusetsize,
+    const cpuset_t *cpuset)
+{
+	if (cpusetsize < sizeof(cpuset_t))
+		return EINVAL;
+
+	return thread_set_affinity(thread_id, cpuset);
 }
 
 /** @}
@@ -35,33 +35,165 @@
 #include "../internal/common.h"
 #include <posix/sys/mman.h>
 #include <posix/sys/types.h>
+#include <posix/stdlib.h>
 #include <libc/as.h>
+#include <libc/adt/list.h>
+#include <libc/futex.h>
+#include <libc/ipc/vfs.h>
+#include <libc/vfs/vfs.h>
 #include <posix/unistd.h>
 
+/** Mapping of a file. */
+typedef struct {
+	link_t link;
+	void *base;
+	size_t size;
+	/** Private handle of the file, open as long as the mapping exists. */
+	int file;
+	/** Position in the file where the mapping starts. */
+	aoff64_t pos;
+	/** Changes of the mapping are written back to the file. */
+	bool write_back;
+} file_mapping_t;
+
+static LIST_INITIALIZE(file_mappings);
+static futex_t file_mappings_futex = FUTEX_INITIALIZER;
+
+/** Find the file mapping containing a range. Called with the futex held. */
+static file_mapping_t *file_mapping_find(void *addr, size_t len)
+{
+	list_foreach(file_mappings, link, file_mapping_t, m) {
+		if ((uintptr_t) addr >= (uintptr_t) m->base &&
+		    (uintptr_t) addr - (uintptr_t) m->base + len <= m->size)
+			return m;
+	}
+
+	return NULL;
+}
+
 void *mmap(void *start, size_t length, int prot, int flags, int fd,
     off_t offset)
 {
 	if (!start)
 		start = AS_AREA_ANY;
 
-#if 0
-	if (!((flags & MAP_SHARED) ^ (flags & MAP_PRIVATE)))
+	if (flags & MAP_ANONYMOUS) {
+		return as_area_create(start, length,
+		    prot | AS_AREA_CACHEABLE, AS_AREA_UNPAGED);
+	}
+
+	bool shared = (flags & MAP_SHARED) != 0;
+	if (length == 0 || shared == ((flags & MAP_PRIVATE) != 0) ||
+	    offset < 0 || offset % PAGE_SIZE != 0) {
+		errno = EINVAL;
 		return MAP_FAILED;
-#endif
+	}
 
-	if (!(flags & MAP_ANONYMOUS))
+	file_mapping_t *m = malloc(sizeof(file_mapping_t));
+	if (m == NULL) {
+		errno = ENOMEM;
 		return MAP_FAILED;
+	}
 
-	return as_area_create(start, length, prot, AS_AREA_UNPAGED);
+	/*
+	 * The mapping keeps its own handle of the file, so that it survives
+	 * closing fd. Writing the changes back needs the handle to be open
+	 * for writing.
+	 */
+	m->write_back = shared && (prot & PROT_WRITE);
+	if (failed(vfs_clone(fd, -1, false, &m->file))) {
+		free(m);
+		return MAP_FAILED;
+	}
+
+	if (failed(vfs_open(m->file,
+	    MODE_READ | (m->write_back ? MODE_WRITE : 0)))) {
+		if (errno == EINVAL)
+			errno = EACCES;
+		vfs_put(m->file);
+		free(m);
+		return MAP_FAILED;
+	}
+
+	if (shared) {
+		m->base = vfs_map_shared(m->file, offset, start, length,
+		    prot | AS_AREA_CACHEABLE);
+	} else {
+		m->base = vfs_map(m->file, offset, start, length,
+		    prot | AS_AREA_CACHEABLE);
+	}
+
+	if (m->base == AS_MAP_FAILED) {
+		vfs_put(m->file);
+		free(m);
+		errno = ENOMEM;
+		return MAP_FAILED;
+	}
+
+	m->size = length;
+	m->pos = offset;
+
+	futex_lock(&file_mappings_futex);
+	list_append(&m->link, &file_mappings);
+	futex_unlock(&file_mappings_futex);
+
+	return m->base;
 }
 
 int munmap(void *start, size_t length)
 {
-	int rc = as_area_destroy(start);
-	if (rc != EOK) {
-		errno = rc;
+	futex_lock(&file_mappings_futex);
+	file_mapping_t *m = file_mapping_find(start, 0);
+	if (m != NULL && m->base == start)
+		list_remove(&m->link);
+	else
+		m = NULL;
+	futex_unlock(&file_mappings_futex);
+
+	errno_t rc = EOK;
+	if (m != NULL && m->write_back)
+		rc = vfs_map_sync(m->file, m->pos, m->base, m->size);
+
+	errno_t rc1 = as_area_destroy(start);
+	if (rc == EOK)
+		rc = rc1;
+
+	if (m != NULL) {
+		vfs_put(m->file);
+		free(m);
+	}
+
+	if (failed(rc))
+		return -1;
+	return 0;
+}
+
+int msync(void *addr, size_t len, int flags)
+{
+	if ((flags & MS_SYNC) && (flags & MS_ASYNC)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	futex_lock(&file_mappings_futex);
+	file_mapping_t *m = file_mapping_find(addr, len);
+	if (m == NULL) {
+		futex_unlock(&file_mappings_futex);
+		errno = ENOMEM;
 		return -1;
 	}
+
+	errno_t rc = EOK;
+	if (m->write_back) {
+		rc = vfs_map_sync(m->file,
+		    m->pos + ((uintptr_t) addr - (uintptr_t) m->base), addr, len);
+		if (rc == EOK && (flags & MS_SYNC))
+			rc = vfs_sync(m->file);
+	}
+	futex_unlock(&file_mappings_futex);
+
+	if (failed(rc))
+		return -1;
 	return 0;
 }
 
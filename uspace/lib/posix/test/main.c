@@ -30,6 +30,8 @@
 
 PCUT_INIT;
 
+PCUT_IMPORT(mman);
+PCUT_IMPORT(pthread);
 PCUT_IMPORT(stdio);
 PCUT_IMPORT(stdlib);
 PCUT_IMPORT(unistd);
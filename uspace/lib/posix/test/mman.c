@@ -0,0 +1,177 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <as.h>
+#include <stdio.h>
+#include "posix/errno.h"
+#include <pcut/pcut.h>
+#include "posix/fcntl.h"
+#include "posix/stdlib.h"
+#include "posix/string.h"
+#include "posix/sys/mman.h"
+#include "posix/unistd.h"
+
+PCUT_INIT;
+
+PCUT_TEST_SUITE(mman);
+
+#define TEST_PAGES 40
+
+/** Create a temporary file of TEST_PAGES pages, each filled with its index */
+static int create_file(char *name)
+{
+	char page[PAGE_SIZE];
+	char *p;
+	int file;
+
+	p = tmpnam(name);
+	PCUT_ASSERT_NOT_NULL(p);
+
+	file = open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+	PCUT_ASSERT_TRUE(file >= 0);
+
+	for (int i = 0; i < TEST_PAGES; i++) {
+		memset(page, i, PAGE_SIZE);
+		PCUT_ASSERT_INT_EQUALS(PAGE_SIZE, write(file, page, PAGE_SIZE));
+	}
+
+	return file;
+}
+
+/** Anonymous mapping */
+PCUT_TEST(anonymous)
+{
+	char *p;
+
+	p = mmap(NULL, PAGE_SIZE, PROT_READ | PROT_WRITE,
+	    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	PCUT_ASSERT_FALSE(p == MAP_FAILED);
+
+	p[0] = 'a';
+	PCUT_ASSERT_INT_EQUALS('a', p[0]);
+	PCUT_ASSERT_INT_EQUALS(0, munmap(p, PAGE_SIZE));
+}
+
+/** Private read-only mapping sees the file, also after fd is closed */
+PCUT_TEST(file_private)
+{
+	char name[L_tmpnam];
+	int file;
+	char *p;
+
+	file = create_file(name);
+	p = mmap(NULL, (TEST_PAGES - 2) * PAGE_SIZE, PROT_READ, MAP_PRIVATE,
+	    file, 2 * PAGE_SIZE);
+	PCUT_ASSERT_FALSE(p == MAP_FAILED);
+	close(file);
+
+	/* Sequential faults read ahead, the last ones hit resident pages */
+	for (int i = 0; i < TEST_PAGES - 2; i++) {
+		PCUT_ASSERT_INT_EQUALS(i + 2, p[i * PAGE_SIZE]);
+		PCUT_ASSERT_INT_EQUALS(i + 2, p[(i + 1) * PAGE_SIZE - 1]);
+	}
+
+	PCUT_ASSERT_INT_EQUALS(0, munmap(p, (TEST_PAGES - 2) * PAGE_SIZE));
+	(void) unlink(name);
+}
+
+/** Changes of a private writable mapping do not reach the file */
+PCUT_TEST(file_private_write)
+{
+	char name[L_tmpnam];
+	int file;
+	char *p;
+	char c;
+
+	file = create_file(name);
+	p = mmap(NULL, TEST_PAGES * PAGE_SIZE, PROT_READ | PROT_WRITE,
+	    MAP_PRIVATE, file, 0);
+	PCUT_ASSERT_FALSE(p == MAP_FAILED);
+
+	PCUT_ASSERT_INT_EQUALS(1, p[PAGE_SIZE]);
+	p[PAGE_SIZE] = 'x';
+	PCUT_ASSERT_INT_EQUALS('x', p[PAGE_SIZE]);
+	PCUT_ASSERT_INT_EQUALS(0, msync(p, TEST_PAGES * PAGE_SIZE, MS_SYNC));
+	PCUT_ASSERT_INT_EQUALS(0, munmap(p, TEST_PAGES * PAGE_SIZE));
+
+	PCUT_ASSERT_INT_EQUALS(PAGE_SIZE, lseek(file, PAGE_SIZE, SEEK_SET));
+	PCUT_ASSERT_INT_EQUALS(1, read(file, &c, 1));
+	PCUT_ASSERT_INT_EQUALS(1, c);
+
+	close(file);
+	(void) unlink(name);
+}
+
+/** Changes of a shared mapping are written back by msync */
+PCUT_TEST(file_shared_write)
+{
+	char name[L_tmpnam];
+	int file;
+	char *p;
+	char c;
+
+	file = create_file(name);
+	p = mmap(NULL, TEST_PAGES * PAGE_SIZE, PROT_READ | PROT_WRITE,
+	    MAP_SHARED, file, 0);
+	PCUT_ASSERT_FALSE(p == MAP_FAILED);
+
+	p[3 * PAGE_SIZE + 7] = 'y';
+	PCUT_ASSERT_INT_EQUALS(0, msync(p + 3 * PAGE_SIZE, PAGE_SIZE,
+	    MS_SYNC));
+
+	PCUT_ASSERT_INT_EQUALS(3 * PAGE_SIZE + 7,
+	    lseek(file, 3 * PAGE_SIZE + 7, SEEK_SET));
+	PCUT_ASSERT_INT_EQUALS(1, read(file, &c, 1));
+	PCUT_ASSERT_INT_EQUALS('y', c);
+
+	/* The mapping still works after the file has changed */
+	PCUT_ASSERT_INT_EQUALS(9, p[9 * PAGE_SIZE]);
+
+	p[20 * PAGE_SIZE] = 'z';
+	PCUT_ASSERT_INT_EQUALS(0, munmap(p, TEST_PAGES * PAGE_SIZE));
+
+	PCUT_ASSERT_INT_EQUALS(20 * PAGE_SIZE,
+	    lseek(file, 20 * PAGE_SIZE, SEEK_SET));
+	PCUT_ASSERT_INT_EQUALS(1, read(file, &c, 1));
+	PCUT_ASSERT_INT_EQUALS('z', c);
+
+	close(file);
+	(void) unlink(name);
+}
+
+/** msync of a range which is not mapped fails */
+PCUT_TEST(msync_unmapped)
+{
+	int rc;
+
+	rc = msync((void *) PAGE_SIZE, PAGE_SIZE, MS_SYNC);
+	PCUT_ASSERT_INT_EQUALS(-1, rc);
+	PCUT_ASSERT_INT_EQUALS(ENOMEM, errno);
+}
+
+PCUT_EXPORT(mman);
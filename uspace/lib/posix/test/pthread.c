@@ -0,0 +1,265 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <pcut/pcut.h>
+#include "posix/pthread.h"
+#include "posix/errno.h"
+#include "posix/stdint.h"
+
+PCUT_INIT;
+
+PCUT_TEST_SUITE(pthread);
+
+#define THREADS 4
+#define ITERATIONS 10000
+
+static pthread_mutex_t counter_mutex = PTHREAD_MUTEX_INITIALIZER;
+static unsigned int counter;
+
+static void *counter_thread(void *arg)
+{
+	for (unsigned int i = 0; i < ITERATIONS; i++) {
+		pthread_mutex_lock(&counter_mutex);
+		counter++;
+		pthread_mutex_unlock(&counter_mutex);
+	}
+
+	return arg;
+}
+
+/** Threads are joined with their return value */
+PCUT_TEST(create_join)
+{
+	pthread_t threads[THREADS];
+	int rc;
+
+	counter = 0;
+
+	for (uintptr_t i = 0; i < THREADS; i++) {
+		rc = pthread_create(&threads[i], NULL, counter_thread,
+		    (void *) i);
+		PCUT_ASSERT_INT_EQUALS(0, rc);
+	}
+
+	for (uintptr_t i = 0; i < THREADS; i++) {
+		void *ret_val;
+		rc = pthread_join(threads[i], &ret_val);
+		PCUT_ASSERT_INT_EQUALS(0, rc);
+		PCUT_ASSERT_EQUALS((void *) i, ret_val);
+	}
+
+	PCUT_ASSERT_INT_EQUALS(THREADS * ITERATIONS, counter);
+
+	/* A joined thread cannot be joined again */
+	rc = pthread_join(threads[0], NULL);
+	PCUT_ASSERT_INT_EQUALS(ESRCH, rc);
+}
+
+/** Recursive mutex can be locked by its holder repeatedly */
+PCUT_TEST(mutex_recursive)
+{
+	pthread_mutexattr_t attr;
+	pthread_mutex_t mutex;
+
+	pthread_mutexattr_init(&attr);
+	PCUT_ASSERT_INT_EQUALS(0,
+	    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE));
+	PCUT_ASSERT_INT_EQUALS(0, pthread_mutex_init(&mutex, &attr));
+
+	PCUT_ASSERT_INT_EQUALS(0, pthread_mutex_lock(&mutex));
+	PCUT_ASSERT_INT_EQUALS(0, pthread_mutex_lock(&mutex));
+	PCUT_ASSERT_INT_EQUALS(0, pthread_mutex_trylock(&mutex));
+	PCUT_ASSERT_INT_EQUALS(0, pthread_mutex_unlock(&mutex));
+	PCUT_ASSERT_INT_EQUALS(0, pthread_mutex_unlock(&mutex));
+	PCUT_ASSERT_INT_EQUALS(0, pthread_mutex_unlock(&mutex));
+	PCUT_ASSERT_INT_EQUALS(EPERM, pthread_mutex_unlock(&mutex));
+
+	PCUT_ASSERT_INT_EQUALS(0, pthread_mutex_destroy(&mutex));
+	pthread_mutexattr_destroy(&attr);
+}
+
+/** Error checking mutex detects relocking and unlocking by others */
+PCUT_TEST(mutex_errorcheck)
+{
+	pthread_mutexattr_t attr;
+	pthread_mutex_t mutex;
+
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_ERRORCHECK);
+	pthread_mutex_init(&mutex, &attr);
+
+	PCUT_ASSERT_INT_EQUALS(EPERM, pthread_mutex_unlock(&mutex));
+	PCUT_ASSERT_INT_EQUALS(0, pthread_mutex_lock(&mutex));
+	PCUT_ASSERT_INT_EQUALS(EDEADLK, pthread_mutex_lock(&mutex));
+	PCUT_ASSERT_INT_EQUALS(EBUSY, pthread_mutex_trylock(&mutex));
+	PCUT_ASSERT_INT_EQUALS(EBUSY, pthread_mutex_destroy(&mutex));
+	PCUT_ASSERT_INT_EQUALS(0, pthread_mutex_unlock(&mutex));
+
+	PCUT_ASSERT_INT_EQUALS(0, pthread_mutex_destroy(&mutex));
+	pthread_mutexattr_destroy(&attr);
+}
+
+static pthread_mutex_t queue_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t queue_cv = PTHREAD_COND_INITIALIZER;
+static unsigned int queue_items;
+static unsigned int queue_consumed;
+
+static void *consumer_thread(void *arg)
+{
+	pthread_mutex_lock(&queue_mutex);
+
+	for (unsigned int i = 0; i < ITERATIONS / 10; i++) {
+		while (queue_items == 0)
+			pthread_cond_wait(&queue_cv, &queue_mutex);
+
+		queue_items--;
+		queue_consumed++;
+	}
+
+	pthread_mutex_unlock(&queue_mutex);
+	return NULL;
+}
+
+/** Producer and consumers synchronize using a condition variable */
+PCUT_TEST(cond_producer_consumer)
+{
+	pthread_t threads[THREADS];
+
+	for (unsigned int i = 0; i < THREADS; i++) {
+		PCUT_ASSERT_INT_EQUALS(0,
+		    pthread_create(&threads[i], NULL, consumer_thread, NULL));
+	}
+
+	for (unsigned int i = 0; i < THREADS * ITERATIONS / 10; i++) {
+		pthread_mutex_lock(&queue_mutex);
+		queue_items++;
+		pthread_cond_signal(&queue_cv);
+		pthread_mutex_unlock(&queue_mutex);
+	}
+
+	for (unsigned int i = 0; i < THREADS; i++)
+		PCUT_ASSERT_INT_EQUALS(0, pthread_join(threads[i], NULL));
+
+	PCUT_ASSERT_INT_EQUALS(THREADS * ITERATIONS / 10, queue_consumed);
+	PCUT_ASSERT_INT_EQUALS(0, queue_items);
+}
+
+/** Waiting for a condition variable times out */
+PCUT_TEST(cond_timedwait)
+{
+	pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+	pthread_cond_t cv = PTHREAD_COND_INITIALIZER;
+	struct timespec ts;
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	ts.tv_nsec += 10000000;
+	if (ts.tv_nsec >= 1000000000) {
+		ts.tv_sec++;
+		ts.tv_nsec -= 1000000000;
+	}
+
+	pthread_mutex_lock(&mutex);
+	PCUT_ASSERT_INT_EQUALS(ETIMEDOUT,
+	    pthread_cond_timedwait(&cv, &mutex, &ts));
+	PCUT_ASSERT_INT_EQUALS(0, pthread_mutex_unlock(&mutex));
+
+	pthread_cond_destroy(&cv);
+	pthread_mutex_destroy(&mutex);
+}
+
+static pthread_key_t key;
+static unsigned int destructor_calls;
+
+static void key_destructor(void *value)
+{
+	__atomic_add_fetch(&destructor_calls, 1, __ATOMIC_SEQ_CST);
+}
+
+static void *key_thread(void *arg)
+{
+	if (pthread_getspecific(key) != NULL)
+		return (void *) 1;
+
+	pthread_setspecific(key, arg);
+	if (pthread_getspecific(key) != arg)
+		return (void *) 1;
+
+	return NULL;
+}
+
+/** Thread specific values are private to threads and destroyed on exit */
+PCUT_TEST(keys)
+{
+	pthread_t threads[THREADS];
+	void *ret_val;
+
+	destructor_calls = 0;
+	PCUT_ASSERT_INT_EQUALS(0, pthread_key_create(&key, key_destructor));
+	pthread_setspecific(key, &key);
+
+	for (uintptr_t i = 0; i < THREADS; i++) {
+		PCUT_ASSERT_INT_EQUALS(0, pthread_create(&threads[i], NULL,
+		    key_thread, (void *) (i + 1)));
+	}
+
+	for (unsigned int i = 0; i < THREADS; i++) {
+		PCUT_ASSERT_INT_EQUALS(0, pthread_join(threads[i], &ret_val));
+		PCUT_ASSERT_NULL(ret_val);
+	}
+
+	PCUT_ASSERT_INT_EQUALS(THREADS, destructor_calls);
+	PCUT_ASSERT_EQUALS(&key, pthread_getspecific(key));
+	PCUT_ASSERT_INT_EQUALS(0, pthread_key_delete(key));
+
+	/* A new key starts with no value */
+	PCUT_ASSERT_INT_EQUALS(0, pthread_key_create(&key, NULL));
+	PCUT_ASSERT_NULL(pthread_getspecific(key));
+	PCUT_ASSERT_INT_EQUALS(0, pthread_key_delete(key));
+}
+
+/** Readers share a read-write lock, writers hold it exclusively */
+PCUT_TEST(rwlock)
+{
+	pthread_rwlock_t rwlock = PTHREAD_RWLOCK_INITIALIZER;
+
+	PCUT_ASSERT_INT_EQUALS(0, pthread_rwlock_rdlock(&rwlock));
+	PCUT_ASSERT_INT_EQUALS(0, pthread_rwlock_tryrdlock(&rwlock));
+	PCUT_ASSERT_INT_EQUALS(EBUSY, pthread_rwlock_trywrlock(&rwlock));
+	PCUT_ASSERT_INT_EQUALS(0, pthread_rwlock_unlock(&rwlock));
+	PCUT_ASSERT_INT_EQUALS(0, pthread_rwlock_unlock(&rwlock));
+
+	PCUT_ASSERT_INT_EQUALS(0, pthread_rwlock_wrlock(&rwlock));
+	PCUT_ASSERT_INT_EQUALS(EBUSY, pthread_rwlock_tryrdlock(&rwlock));
+	PCUT_ASSERT_INT_EQUALS(EDEADLK, pthread_rwlock_wrlock(&rwlock));
+	PCUT_ASSERT_INT_EQUALS(0, pthread_rwlock_unlock(&rwlock));
+
+	PCUT_ASSERT_INT_EQUALS(EPERM, pthread_rwlock_unlock(&rwlock));
+	PCUT_ASSERT_INT_EQUALS(0, pthread_rwlock_destroy(&rwlock));
+}
+
+PCUT_EXPORT(pthread);
@@ -58,6 +58,11 @@ enum scsi_cmd_sbc {
 	SCSI_CMD_WRITE_16		= 0x8a
 };
 
+/** Service actions of SCSI_CMD_READ_CAPACITY_16 (Service Action In (16)) */
+enum scsi_sa_sbc {
+	SCSI_SA_READ_CAPACITY_16	= 0x10
+};
+
 /** SCSI Read (10) command */
 typedef struct {
 	/** Operation code (SCSI_CMD_READ_10) */
@@ -133,6 +138,35 @@ typedef struct {
 	uint32_t block_size;
 } scsi_read_capacity_10_data_t;
 
+/** SCSI Read Capacity (16) command */
+typedef struct {
+	/** Operation code (SCSI_CMD_READ_CAPACITY_16) */
+	uint8_t op_code;
+	/** Reserved, Service action (SCSI_SA_READ_CAPACITY_16) */
+	uint8_t service_action;
+	/** Logical block address (obsolete) */
+	uint64_t lba;
+	/** Allocation length */
+	uint32_t alloc_len;
+	/** Reserved, Obsolete */
+	uint8_t pmi;
+	/** Control */
+	uint8_t control;
+} __attribute__((packed)) scsi_cdb_read_capacity_16_t;
+
+/** Read Capacity (16) parameter data.
+ *
+ * Returned for Read Capacity (16) command.
+ */
+typedef struct {
+	/** Logical address of last block */
+	uint64_t last_lba;
+	/** Size of block in bytes */
+	uint32_t block_size;
+	/** Protection, logical blocks per physical block, alignment */
+	uint8_t reserved_12[20];
+} __attribute__((packed)) scsi_read_capacity_16_data_t;
+
 /** SCSI Synchronize Cache (10) command */
 typedef struct {
 	/** Operation code (SCSI_CMD_SYNC_CACHE_10) */
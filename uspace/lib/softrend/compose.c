@@ -33,6 +33,7 @@
  * @file
  */
 
+#include <mem.h>
 #include "compose.h"
 
 pixel_t compose_clr(pixel_t fg, pixel_t bg)
@@ -101,5 +102,61 @@ pixel_t compose_add(pixel_t fg, pixel_t bg)
 	return 0;
 }
 
+void compose_span_clr(pixel_t *dst, const pixel_t *src, size_t count)
+{
+	memset(dst, 0, count * sizeof(pixel_t));
+}
+
+void compose_span_src(pixel_t *dst, const pixel_t *src, size_t count)
+{
+	memcpy(dst, src, count * sizeof(pixel_t));
+}
+
+void compose_span_dst(pixel_t *dst, const pixel_t *src, size_t count)
+{
+}
+
+/** Compose a span with compose_over().
+ *
+ * Transparent source pixels leave the destination untouched and opaque
+ * source pixels over opaque destination pixels are copied, so that mostly
+ * opaque or mostly transparent spans reduce to a blit.
+ */
+void compose_span_over(pixel_t *dst, const pixel_t *src, size_t count)
+{
+	for (size_t i = 0; i < count; i++) {
+		pixel_t fg = src[i];
+
+		if (ALPHA(fg) == 0)
+			continue;
+
+		if (ALPHA(fg) == 255 && ALPHA(dst[i]) == 255)
+			dst[i] = fg;
+		else
+			dst[i] = compose_over(fg, dst[i]);
+	}
+}
+
+/** Find the span variant of a compose function.
+ *
+ * @param compose Compose function.
+ *
+ * @return Function composing whole spans with the same result as
+ *         @a compose or NULL if there is none.
+ */
+compose_span_t compose_span(compose_t compose)
+{
+	if (compose == compose_clr)
+		return compose_span_clr;
+	if (compose == compose_src)
+		return compose_span_src;
+	if (compose == compose_dst)
+		return compose_span_dst;
+	if (compose == compose_over)
+		return compose_span_over;
+
+	return NULL;
+}
+
 /** @}
  */
@@ -37,9 +37,13 @@
 #define SOFTREND_COMPOSE_H_
 
 #include <io/pixel.h>
+#include <stddef.h>
 
 typedef pixel_t (*compose_t)(pixel_t, pixel_t);
 
+/** Compose a span of source pixels onto a span of destination pixels. */
+typedef void (*compose_span_t)(pixel_t *, const pixel_t *, size_t);
+
 extern pixel_t compose_clr(pixel_t, pixel_t);
 extern pixel_t compose_src(pixel_t, pixel_t);
 extern pixel_t compose_dst(pixel_t, pixel_t);
@@ -51,6 +55,13 @@ extern pixel_t compose_atop(pixel_t, pixel_t);
 extern pixel_t compose_xor(pixel_t, pixel_t);
 extern pixel_t compose_add(pixel_t, pixel_t);
 
+extern void compose_span_clr(pixel_t *, const pixel_t *, size_t);
+extern void compose_span_src(pixel_t *, const pixel_t *, size_t);
+extern void compose_span_dst(pixel_t *, const pixel_t *, size_t);
+extern void compose_span_over(pixel_t *, const pixel_t *, size_t);
+
+extern compose_span_t compose_span(compose_t);
+
 #endif
 
 /** @}
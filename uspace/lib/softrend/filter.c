@@ -34,6 +34,8 @@
  * @file
  */
 
+#include <stdbool.h>
+#include <stdint.h>
 #include "filter.h"
 #include <io/pixel.h>
 
@@ -51,19 +53,68 @@ static long _floor(double val)
 	return lval;
 }
 
-static long _ceil(double val)
+
+/** Fixed-point weights are in 1/FILTER_ONE units. */
+#define FILTER_SHIFT  8
+#define FILTER_ONE    (1 << FILTER_SHIFT)
+
+/** Span positions are stepped in 16.16 fixed point. */
+#define POS_SHIFT  16
+
+/** Number of taps of the widest filter. */
+#define TAPS_MAX  4
+
+/** Catmull-Rom weights for each fractional position, summing to FILTER_ONE. */
+static int32_t bicubic_weights[FILTER_ONE][4];
+static bool bicubic_weights_ready = false;
+
+static void bicubic_weights_init(void)
 {
-	long lval = (long) val;
-	if (val > 0 && lval != val)
-		return lval + 1;
-	return lval;
+	for (unsigned int i = 0; i < FILTER_ONE; i++) {
+		double t = ((double) i) / FILTER_ONE;
+		double t2 = t * t;
+		double t3 = t2 * t;
+
+		bicubic_weights[i][0] = _round(FILTER_ONE * (-t3 + 2 * t2 - t) / 2);
+		bicubic_weights[i][2] = _round(FILTER_ONE * (-3 * t3 + 4 * t2 + t) / 2);
+		bicubic_weights[i][3] = _round(FILTER_ONE * (t3 - t2) / 2);
+		bicubic_weights[i][1] = FILTER_ONE - bicubic_weights[i][0] -
+		    bicubic_weights[i][2] - bicubic_weights[i][3];
+	}
+
+	bicubic_weights_ready = true;
 }
 
+/** Get the weights of the filter taps for a fractional position. */
+static void filter_weights(unsigned int taps, unsigned int frac,
+    int32_t *weights)
+{
+	if (taps == 2) {
+		weights[0] = FILTER_ONE - frac;
+		weights[1] = frac;
+	} else {
+		if (!bicubic_weights_ready)
+			bicubic_weights_init();
+
+		for (unsigned int i = 0; i < 4; i++)
+			weights[i] = bicubic_weights[frac][i];
+	}
+}
 
-static inline pixel_t blend_pixels(size_t count, float *weights,
-    pixel_t *pixels)
+static inline uint8_t clamp_channel(int32_t val, unsigned int shift)
 {
-	float alpha = 0, red = 0, green = 0, blue = 0;
+	val = (val + (1 << (shift - 1))) >> shift;
+	if (val < 0)
+		return 0;
+	if (val > 255)
+		return 255;
+	return val;
+}
+
+static inline pixel_t blend_pixels(size_t count, int32_t *weights,
+    pixel_t *pixels, unsigned int shift)
+{
+	int32_t alpha = 0, red = 0, green = 0, blue = 0;
 	for (size_t index = 0; index < count; index++) {
 		alpha += weights[index] * ALPHA(pixels[index]);
 		red   += weights[index] *   RED(pixels[index]);
@@ -71,8 +122,19 @@ static inline pixel_t blend_pixels(size_t count, float *weights,
 		blue  += weights[index] *  BLUE(pixels[index]);
 	}
 
-	return PIXEL((uint8_t) alpha, (uint8_t) red, (uint8_t) green,
-	    (uint8_t) blue);
+	return PIXEL(clamp_channel(alpha, shift), clamp_channel(red, shift),
+	    clamp_channel(green, shift), clamp_channel(blue, shift));
+}
+
+/** Split a coordinate into its integer part and fixed-point fraction. */
+static void filter_split(double val, long *ival, unsigned int *frac)
+{
+	*ival = _floor(val);
+	*frac = _round((val - *ival) * FILTER_ONE);
+	if (*frac == FILTER_ONE) {
+		(*ival)++;
+		*frac = 0;
+	}
 }
 
 pixel_t filter_nearest(pixelmap_t *pixmap, double x, double y,
@@ -84,39 +146,202 @@ pixel_t filter_nearest(pixelmap_t *pixmap, double x, double y,
 pixel_t filter_bilinear(pixelmap_t *pixmap, double x, double y,
     pixelmap_extend_t extend)
 {
-	long x1 = _floor(x);
-	long x2 = _ceil(x);
-	long y1 = _floor(y);
-	long y2 = _ceil(y);
-
-	if (y1 == y2 && x1 == x2) {
-		return pixelmap_get_extended_pixel(pixmap,
-		    (sysarg_t) x1, (sysarg_t) y1, extend);
-	}
+	long x1;
+	long y1;
+	unsigned int x_frac;
+	unsigned int y_frac;
+	filter_split(x, &x1, &x_frac);
+	filter_split(y, &y1, &y_frac);
 
-	double x_delta = x - x1;
-	double y_delta = y - y1;
+	if (x_frac == 0 && y_frac == 0) {
+		return pixelmap_get_extended_pixel(pixmap, x1, y1, extend);
+	}
 
 	pixel_t pixels[4];
 	pixels[0] = pixelmap_get_extended_pixel(pixmap, x1, y1, extend);
-	pixels[1] = pixelmap_get_extended_pixel(pixmap, x2, y1, extend);
-	pixels[2] = pixelmap_get_extended_pixel(pixmap, x1, y2, extend);
-	pixels[3] = pixelmap_get_extended_pixel(pixmap, x2, y2, extend);
+	pixels[1] = pixelmap_get_extended_pixel(pixmap, x1 + 1, y1, extend);
+	pixels[2] = pixelmap_get_extended_pixel(pixmap, x1, y1 + 1, extend);
+	pixels[3] = pixelmap_get_extended_pixel(pixmap, x1 + 1, y1 + 1, extend);
 
-	float weights[4];
-	weights[0] = (1 - x_delta) * (1 - y_delta);
-	weights[1] = x_delta       * (1 - y_delta);
-	weights[2] = (1 - x_delta) * y_delta;
-	weights[3] = x_delta       * y_delta;
+	int32_t weights[4];
+	weights[0] = (FILTER_ONE - x_frac) * (FILTER_ONE - y_frac);
+	weights[1] = x_frac                * (FILTER_ONE - y_frac);
+	weights[2] = (FILTER_ONE - x_frac) * y_frac;
+	weights[3] = x_frac                * y_frac;
 
-	return blend_pixels(4, weights, pixels);
+	return blend_pixels(4, weights, pixels, 2 * FILTER_SHIFT);
 }
 
 pixel_t filter_bicubic(pixelmap_t *pixmap, double x, double y,
     pixelmap_extend_t extend)
 {
-	// TODO
-	return 0;
+	long x1;
+	long y1;
+	unsigned int x_frac;
+	unsigned int y_frac;
+	filter_split(x, &x1, &x_frac);
+	filter_split(y, &y1, &y_frac);
+
+	if (x_frac == 0 && y_frac == 0) {
+		return pixelmap_get_extended_pixel(pixmap, x1, y1, extend);
+	}
+
+	int32_t x_weights[4];
+	int32_t y_weights[4];
+	filter_weights(4, x_frac, x_weights);
+	filter_weights(4, y_frac, y_weights);
+
+	pixel_t pixels[16];
+	int32_t weights[16];
+	for (unsigned int j = 0; j < 4; j++) {
+		for (unsigned int i = 0; i < 4; i++) {
+			pixels[j * 4 + i] = pixelmap_get_extended_pixel(pixmap,
+			    x1 + i - 1, y1 + j - 1, extend);
+			weights[j * 4 + i] = x_weights[i] * y_weights[j];
+		}
+	}
+
+	return blend_pixels(16, weights, pixels, 2 * FILTER_SHIFT);
+}
+
+/** Vertically filtered source column, channels scaled by FILTER_ONE. */
+typedef struct {
+	int32_t alpha;
+	int32_t red;
+	int32_t green;
+	int32_t blue;
+} filter_column_t;
+
+static void filter_column(pixelmap_t *pixmap, long x, long y,
+    unsigned int taps, int32_t *weights, pixel_t **rows,
+    pixelmap_extend_t extend, filter_column_t *column)
+{
+	column->alpha = 0;
+	column->red = 0;
+	column->green = 0;
+	column->blue = 0;
+
+	bool inside = (x >= 0) && ((sysarg_t) x < pixmap->width);
+
+	for (unsigned int k = 0; k < taps; k++) {
+		pixel_t pixel = ((inside) && (rows[k] != NULL)) ? rows[k][x] :
+		    pixelmap_get_extended_pixel(pixmap, x, y + k, extend);
+
+		column->alpha += weights[k] * ALPHA(pixel);
+		column->red   += weights[k] *   RED(pixel);
+		column->green += weights[k] * GREEN(pixel);
+		column->blue  += weights[k] *  BLUE(pixel);
+	}
+}
+
+/** Sample a horizontal run of pixels.
+ *
+ * Computes the same pixels as calling @a filter for (x + i * dx, y) with
+ * i < count. The vertical weights and the source rows are determined only
+ * once, the horizontal position advances in fixed point and vertically
+ * filtered columns are reused as long as the taps overlap.
+ *
+ * @param filter Filter to apply.
+ * @param pixmap Source pixel map.
+ * @param x      Horizontal source coordinate of the first pixel.
+ * @param y      Vertical source coordinate of the span.
+ * @param dx     Horizontal source step between the pixels.
+ * @param count  Number of pixels.
+ * @param extend Handling of pixels outside of @a pixmap.
+ * @param buf    Buffer for @a count pixels.
+ */
+void filter_span(filter_t filter, pixelmap_t *pixmap, double x, double y,
+    double dx, size_t count, pixelmap_extend_t extend, pixel_t *buf)
+{
+	unsigned int taps;
+	if (filter == filter_bilinear) {
+		taps = 2;
+	} else if (filter == filter_bicubic) {
+		taps = 4;
+	} else if (filter == filter_nearest) {
+		taps = 1;
+	} else {
+		for (size_t i = 0; i < count; i++)
+			buf[i] = filter(pixmap, x + i * dx, y, extend);
+		return;
+	}
+
+	int64_t pos = _round(x * (1 << POS_SHIFT));
+	int64_t step = _round(dx * (1 << POS_SHIFT));
+
+	if (taps == 1) {
+		long yi = _round(y);
+		int64_t half = 1 << (POS_SHIFT - 1);
+		for (size_t i = 0; i < count; i++, pos += step) {
+			/* Round half away from zero like _round(). */
+			native_t xi = (pos >= 0) ? ((pos + half) >> POS_SHIFT) :
+			    -((-pos + half) >> POS_SHIFT);
+			buf[i] = pixelmap_get_extended_pixel(pixmap, xi, yi, extend);
+		}
+		return;
+	}
+
+	/* Taps start one pixel before the sample for bicubic. */
+	long offset = taps / 2 - 1;
+
+	long y1;
+	unsigned int y_frac;
+	filter_split(y, &y1, &y_frac);
+	y1 -= offset;
+
+	int32_t y_weights[TAPS_MAX];
+	filter_weights(taps, y_frac, y_weights);
+
+	pixel_t *rows[TAPS_MAX];
+	for (unsigned int k = 0; k < taps; k++) {
+		long row = y1 + (long) k;
+		rows[k] = ((row >= 0) && ((sysarg_t) row < pixmap->height)) ?
+		    pixelmap_pixel_at(pixmap, 0, row) : NULL;
+	}
+
+	filter_column_t columns[TAPS_MAX];
+	long base = 0;
+	bool have_columns = false;
+
+	for (size_t i = 0; i < count; i++, pos += step) {
+		long x1 = (long) (pos >> POS_SHIFT) - offset;
+		unsigned int x_frac =
+		    (pos >> (POS_SHIFT - FILTER_SHIFT)) & (FILTER_ONE - 1);
+
+		if ((!have_columns) || (x1 != base)) {
+			unsigned int reuse = 0;
+			if ((have_columns) && (x1 > base) &&
+			    (x1 - base < (long) taps)) {
+				reuse = taps - (x1 - base);
+				for (unsigned int j = 0; j < reuse; j++)
+					columns[j] = columns[j + (x1 - base)];
+			}
+
+			for (unsigned int j = reuse; j < taps; j++) {
+				filter_column(pixmap, x1 + j, y1, taps, y_weights,
+				    rows, extend, &columns[j]);
+			}
+
+			base = x1;
+			have_columns = true;
+		}
+
+		int32_t x_weights[TAPS_MAX];
+		filter_weights(taps, x_frac, x_weights);
+
+		int32_t alpha = 0, red = 0, green = 0, blue = 0;
+		for (unsigned int j = 0; j < taps; j++) {
+			alpha += x_weights[j] * columns[j].alpha;
+			red   += x_weights[j] * columns[j].red;
+			green += x_weights[j] * columns[j].green;
+			blue  += x_weights[j] * columns[j].blue;
+		}
+
+		buf[i] = PIXEL(clamp_channel(alpha, 2 * FILTER_SHIFT),
+		    clamp_channel(red, 2 * FILTER_SHIFT),
+		    clamp_channel(green, 2 * FILTER_SHIFT),
+		    clamp_channel(blue, 2 * FILTER_SHIFT));
+	}
 }
 
 /** @}
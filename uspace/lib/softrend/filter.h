@@ -44,6 +44,9 @@ extern pixel_t filter_nearest(pixelmap_t *, double, double, pixelmap_extend_t);
 extern pixel_t filter_bilinear(pixelmap_t *, double, double, pixelmap_extend_t);
 extern pixel_t filter_bicubic(pixelmap_t *, double, double, pixelmap_extend_t);
 
+extern void filter_span(filter_t, pixelmap_t *, double, double, double, size_t,
+    pixelmap_extend_t, pixel_t *);
+
 #endif
 
 /** @}
@@ -0,0 +1,253 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup softrend
+ * @{
+ */
+/**
+ * @file
+ */
+
+#include <mem.h>
+#include <stdlib.h>
+#include "rectangle.h"
+#include "region.h"
+
+void region_init(region_t *region)
+{
+	region->rects = NULL;
+	region->count = 0;
+	region->size = 0;
+}
+
+void region_fini(region_t *region)
+{
+	free(region->rects);
+	region_init(region);
+}
+
+void region_clear(region_t *region)
+{
+	region->count = 0;
+}
+
+void region_swap(region_t *a, region_t *b)
+{
+	region_t tmp = *a;
+	*a = *b;
+	*b = tmp;
+}
+
+bool region_empty(const region_t *region)
+{
+	return region->count == 0;
+}
+
+/** Determine the bounding rectangle of a region.
+ *
+ * The bounding rectangle of an empty region is empty.
+ */
+void region_bounds(const region_t *region,
+    sysarg_t *x_out, sysarg_t *y_out, sysarg_t *w_out, sysarg_t *h_out)
+{
+	if (region->count == 0) {
+		*x_out = 0;
+		*y_out = 0;
+		*w_out = 0;
+		*h_out = 0;
+		return;
+	}
+
+	const region_rect_t *r = &region->rects[0];
+	sysarg_t x = r->x;
+	sysarg_t y = r->y;
+	sysarg_t w = r->w;
+	sysarg_t h = r->h;
+
+	for (size_t i = 1; i < region->count; i++) {
+		r = &region->rects[i];
+		rectangle_union(x, y, w, h, r->x, r->y, r->w, r->h,
+		    &x, &y, &w, &h);
+	}
+
+	*x_out = x;
+	*y_out = y;
+	*w_out = w;
+	*h_out = h;
+}
+
+/** Make room for a number of rectangles in addition to the present ones. */
+static errno_t region_reserve(region_t *region, size_t count)
+{
+	if (region->count + count <= region->size)
+		return EOK;
+
+	size_t size = region->size > 0 ? region->size : 8;
+	while (size < region->count + count)
+		size *= 2;
+
+	region_rect_t *rects = realloc(region->rects,
+	    size * sizeof(region_rect_t));
+	if (rects == NULL)
+		return ENOMEM;
+
+	region->rects = rects;
+	region->size = size;
+	return EOK;
+}
+
+static void region_append(region_t *region,
+    sysarg_t x, sysarg_t y, sysarg_t w, sysarg_t h)
+{
+	region_rect_t *r = &region->rects[region->count++];
+	r->x = x;
+	r->y = y;
+	r->w = w;
+	r->h = h;
+}
+
+/** Remove a rectangle from a region.
+ *
+ * Each rectangle of the region overlapping the removed one is replaced by
+ * up to four rectangles covering the rest of it.
+ *
+ * @return EOK on success, ENOMEM if there is not enough memory, in which
+ *         case the region is unchanged.
+ */
+errno_t region_subtract(region_t *region,
+    sysarg_t x, sysarg_t y, sysarg_t w, sysarg_t h)
+{
+	errno_t rc = region_reserve(region, 3 * region->count);
+	if (rc != EOK)
+		return rc;
+
+	size_t count = region->count;
+	size_t i = 0;
+	while (i < count) {
+		region_rect_t r = region->rects[i];
+		sysarg_t il, it, iw, ih;
+
+		if (!rectangle_intersect(r.x, r.y, r.w, r.h, x, y, w, h,
+		    &il, &it, &iw, &ih)) {
+			i++;
+			continue;
+		}
+
+		/* Replace the rectangle by the last one not yet examined. */
+		region->rects[i] = region->rects[count - 1];
+		region->rects[count - 1] = region->rects[region->count - 1];
+		region->count--;
+		count--;
+
+		if (it > r.y)
+			region_append(region, r.x, r.y, r.w, it - r.y);
+		if (it + ih < r.y + r.h) {
+			region_append(region, r.x, it + ih, r.w,
+			    r.y + r.h - (it + ih));
+		}
+		if (il > r.x)
+			region_append(region, r.x, it, il - r.x, ih);
+		if (il + iw < r.x + r.w) {
+			region_append(region, il + iw, it,
+			    r.x + r.w - (il + iw), ih);
+		}
+	}
+
+	return EOK;
+}
+
+/** Add a rectangle to a region.
+ *
+ * @return EOK on success, ENOMEM if there is not enough memory, in which
+ *         case the region is unchanged.
+ */
+errno_t region_add(region_t *region,
+    sysarg_t x, sysarg_t y, sysarg_t w, sysarg_t h)
+{
+	if (w == 0 || h == 0)
+		return EOK;
+
+	errno_t rc = region_reserve(region, 3 * region->count + 1);
+	if (rc != EOK)
+		return rc;
+
+	rc = region_subtract(region, x, y, w, h);
+	if (rc != EOK)
+		return rc;
+
+	region_append(region, x, y, w, h);
+	return EOK;
+}
+
+/** Copy a region.
+ *
+ * @return EOK on success or ENOMEM if there is not enough memory.
+ */
+errno_t region_copy(region_t *dst, const region_t *src)
+{
+	region_clear(dst);
+
+	errno_t rc = region_reserve(dst, src->count);
+	if (rc != EOK)
+		return rc;
+
+	memcpy(dst->rects, src->rects, src->count * sizeof(region_rect_t));
+	dst->count = src->count;
+	return EOK;
+}
+
+/** Intersect a region with a rectangle.
+ *
+ * @param dst Region to store the intersection to.
+ * @param src Region to intersect.
+ *
+ * @return EOK on success or ENOMEM if there is not enough memory.
+ */
+errno_t region_intersect(region_t *dst, const region_t *src,
+    sysarg_t x, sysarg_t y, sysarg_t w, sysarg_t h)
+{
+	region_clear(dst);
+
+	errno_t rc = region_reserve(dst, src->count);
+	if (rc != EOK)
+		return rc;
+
+	for (size_t i = 0; i < src->count; i++) {
+		const region_rect_t *r = &src->rects[i];
+		sysarg_t il, it, iw, ih;
+
+		if (rectangle_intersect(r->x, r->y, r->w, r->h, x, y, w, h,
+		    &il, &it, &iw, &ih))
+			region_append(dst, il, it, iw, ih);
+	}
+
+	return EOK;
+}
+
+/** @}
+ */
@@ -32,14 +32,67 @@
 /** @file
  */
 
+#include <adt/list.h>
+#include <errno.h>
+#include <fibril.h>
+#include <fibril_synch.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdarg.h>
+#include <str.h>
 #include <str_error.h>
 #include <vfs/vfs.h>
 #include "private/tar.h"
 #include "untar.h"
 
+/** Size of a chunk of file data read from the archive at once */
+#define UNTAR_CHUNK_SIZE (64 * 1024)
+
+/** Number of chunks in flight between the reader and the writer */
+#define UNTAR_CHUNKS 4
+
+/** Chunk of file data waiting to be written. */
+typedef struct {
+	link_t link;
+	/** Destination file */
+	int fd;
+	/** Position in destination file */
+	aoff64_t pos;
+	/** Number of valid bytes in @c data */
+	size_t size;
+	/** Close destination file after this chunk has been written */
+	bool last;
+	/** Destination file name (for error reporting) */
+	char filename[sizeof(((tar_header_t *) NULL)->filename)];
+	uint8_t data[UNTAR_CHUNK_SIZE];
+} untar_chunk_t;
+
+/** Extraction state.
+ *
+ * The archive is read by the caller's fibril while a writer fibril
+ * writes out file data, so reading (and possibly decompressing) the
+ * archive overlaps with writing the files.
+ */
+typedef struct {
+	tar_file_t *tar;
+	/** Protects the fields below */
+	fibril_mutex_t lock;
+	/** Signalled when a chunk is queued or freed or the writer exits */
+	fibril_condvar_t cv;
+	/** Free chunks */
+	list_t free_chunks;
+	/** Chunks waiting to be written */
+	list_t queue;
+	/** No more chunks will be queued */
+	bool quit;
+	/** Writer fibril has terminated */
+	bool writer_done;
+	/** First write error */
+	errno_t write_rc;
+	/** Most recently created (or verified) directory */
+	char last_dir[sizeof(((tar_header_t *) NULL)->filename)];
+} untar_t;
+
 static size_t get_block_count(size_t bytes)
 {
 	return (bytes + TAR_BLOCK_SIZE - 1) / TAR_BLOCK_SIZE;
@@ -70,13 +123,108 @@ static void tar_report(tar_file_t *tar, const char *fmt, ...)
 	va_end(args);
 }
 
-static errno_t tar_skip_blocks(tar_file_t *tar, size_t valid_data_size)
+/** Writer fibril.
+ *
+ * Write out queued chunks in order, closing each file after its last
+ * chunk. After an error the remaining chunks are discarded.
+ *
+ * @param arg Extraction state
+ * @return EOK
+ */
+static errno_t untar_writer_fibril(void *arg)
+{
+	untar_t *untar = (untar_t *) arg;
+	untar_chunk_t *chunk;
+	size_t nwr;
+	errno_t rc;
+
+	fibril_mutex_lock(&untar->lock);
+
+	while (true) {
+		while (list_empty(&untar->queue) && !untar->quit)
+			fibril_condvar_wait(&untar->cv, &untar->lock);
+
+		if (list_empty(&untar->queue))
+			break;
+
+		chunk = list_get_instance(list_first(&untar->queue),
+		    untar_chunk_t, link);
+		list_remove(&chunk->link);
+		rc = untar->write_rc;
+		fibril_mutex_unlock(&untar->lock);
+
+		if (rc == EOK && chunk->size > 0) {
+			rc = vfs_write(chunk->fd, &chunk->pos, chunk->data,
+			    chunk->size, &nwr);
+			if (rc == EOK && nwr != chunk->size)
+				rc = EIO;
+			if (rc != EOK) {
+				tar_report(untar->tar, "Failed to write to %s: %s.\n",
+				    chunk->filename, str_error(rc));
+			}
+		}
+
+		if (chunk->last)
+			vfs_put(chunk->fd);
+
+		fibril_mutex_lock(&untar->lock);
+		if (rc != EOK && untar->write_rc == EOK)
+			untar->write_rc = rc;
+		list_append(&chunk->link, &untar->free_chunks);
+		fibril_condvar_broadcast(&untar->cv);
+	}
+
+	untar->writer_done = true;
+	fibril_condvar_broadcast(&untar->cv);
+	fibril_mutex_unlock(&untar->lock);
+	return EOK;
+}
+
+/** Get a free chunk, waiting for the writer if necessary.
+ *
+ * @param untar Extraction state
+ * @param rchunk Place to store pointer to chunk
+ * @return EOK on success or the error the writer has encountered
+ */
+static errno_t untar_chunk_get(untar_t *untar, untar_chunk_t **rchunk)
+{
+	errno_t rc;
+
+	fibril_mutex_lock(&untar->lock);
+	while (list_empty(&untar->free_chunks) && untar->write_rc == EOK)
+		fibril_condvar_wait(&untar->cv, &untar->lock);
+
+	rc = untar->write_rc;
+	if (rc == EOK) {
+		*rchunk = list_get_instance(list_first(&untar->free_chunks),
+		    untar_chunk_t, link);
+		list_remove(&(*rchunk)->link);
+	}
+
+	fibril_mutex_unlock(&untar->lock);
+	return rc;
+}
+
+/** Pass a chunk to the writer.
+ *
+ * @param untar Extraction state
+ * @param chunk Filled chunk
+ */
+static void untar_chunk_queue(untar_t *untar, untar_chunk_t *chunk)
+{
+	fibril_mutex_lock(&untar->lock);
+	list_append(&chunk->link, &untar->queue);
+	fibril_condvar_broadcast(&untar->cv);
+	fibril_mutex_unlock(&untar->lock);
+}
+
+static errno_t tar_skip_blocks(untar_t *untar, size_t valid_data_size)
 {
 	size_t blocks_to_read = get_block_count(valid_data_size);
 
 	while (blocks_to_read > 0) {
 		uint8_t block[TAR_BLOCK_SIZE];
-		size_t actually_read = tar_read(tar, block, TAR_BLOCK_SIZE);
+		size_t actually_read = tar_read(untar->tar, block, TAR_BLOCK_SIZE);
 		if (actually_read != TAR_BLOCK_SIZE)
 			return errno;
 
@@ -86,74 +234,266 @@ static errno_t tar_skip_blocks(tar_file_t *tar, size_t valid_data_size)
 	return EOK;
 }
 
-static errno_t tar_handle_normal_file(tar_file_t *tar,
+/** Create a directory unless it already exists.
+ *
+ * @param untar Extraction state
+ * @param path Directory path
+ * @return EOK on success or an error code
+ */
+static errno_t untar_mkdir(untar_t *untar, const char *path)
+{
+	errno_t rc = vfs_link_path(path, KIND_DIRECTORY, NULL);
+	if (rc != EOK && rc != EEXIST) {
+		tar_report(untar->tar, "Failed to create directory %s: %s.\n",
+		    path, str_error(rc));
+		return rc;
+	}
+
+	return EOK;
+}
+
+/** Make sure all parent directories of a path exist.
+ *
+ * Archive members are usually grouped by directory, so the most
+ * recently verified directory is remembered and files going to the
+ * same directory need no directory operations at all.
+ *
+ * @param untar Extraction state
+ * @param path Path of a file or directory to be created
+ * @return EOK on success or an error code
+ */
+static errno_t untar_mkdir_parents(untar_t *untar, const char *path)
+{
+	char dir[sizeof(untar->last_dir)];
+	char *slash;
+	char *p;
+	errno_t rc;
+
+	str_cpy(dir, sizeof(dir), path);
+	slash = str_rchr(dir, '/');
+	if (slash == NULL || slash == dir)
+		return EOK;
+
+	*slash = '\0';
+	if (str_cmp(dir, untar->last_dir) == 0)
+		return EOK;
+
+	for (p = dir + 1; *p != '\0'; p++) {
+		if (*p != '/')
+			continue;
+
+		*p = '\0';
+		rc = untar_mkdir(untar, dir);
+		*p = '/';
+		if (rc != EOK)
+			return rc;
+	}
+
+	rc = untar_mkdir(untar, dir);
+	if (rc != EOK)
+		return rc;
+
+	str_cpy(untar->last_dir, sizeof(untar->last_dir), dir);
+	return EOK;
+}
+
+static errno_t tar_handle_normal_file(untar_t *untar,
     const tar_header_t *header)
 {
-	// FIXME: create the directory first
+	tar_file_t *tar = untar->tar;
+	untar_chunk_t *chunk;
+	aoff64_t pos = 0;
+	size_t bytes_remaining = header->size;
+	size_t to_read;
+	size_t actually_read;
+	int fd;
+	errno_t rc;
+
+	rc = untar_mkdir_parents(untar, header->filename);
+	if (rc != EOK)
+		return rc;
 
-	FILE *file = fopen(header->filename, "wb");
-	if (file == NULL) {
+	rc = vfs_lookup_open(header->filename, WALK_REGULAR | WALK_MAY_CREATE,
+	    MODE_WRITE, &fd);
+	if (rc == EOK) {
+		rc = vfs_resize(fd, 0);
+		if (rc != EOK)
+			vfs_put(fd);
+	}
+
+	if (rc != EOK) {
 		tar_report(tar, "Failed to create %s: %s.\n", header->filename,
-		    str_error(errno));
-		return errno;
+		    str_error(rc));
+		return rc;
 	}
 
-	errno_t rc = EOK;
-	size_t bytes_remaining = header->size;
-	size_t blocks = get_block_count(bytes_remaining);
+	if (bytes_remaining == 0) {
+		vfs_put(fd);
+		return EOK;
+	}
 
-	while (blocks > 0) {
-		uint8_t block[TAR_BLOCK_SIZE];
-		size_t actually_read = tar_read(tar, block, TAR_BLOCK_SIZE);
-		if (actually_read != TAR_BLOCK_SIZE) {
-			rc = errno;
-			tar_report(tar, "Failed to read block for %s: %s.\n",
-			    header->filename, str_error(rc));
-			break;
+	while (bytes_remaining > 0) {
+		rc = untar_chunk_get(untar, &chunk);
+		if (rc != EOK) {
+			vfs_put(fd);
+			return rc;
 		}
 
-		size_t to_write = TAR_BLOCK_SIZE;
-		if (bytes_remaining < TAR_BLOCK_SIZE)
-			to_write = bytes_remaining;
+		/* Read whole blocks, the padding is overwritten later */
+		to_read = get_block_count(bytes_remaining) * TAR_BLOCK_SIZE;
+		if (to_read > UNTAR_CHUNK_SIZE)
+			to_read = UNTAR_CHUNK_SIZE;
+
+		actually_read = tar_read(tar, chunk->data, to_read);
 
-		size_t actually_written = fwrite(block, 1, to_write, file);
-		if (actually_written != to_write) {
+		chunk->fd = fd;
+		chunk->pos = pos;
+		str_cpy(chunk->filename, sizeof(chunk->filename),
+		    header->filename);
+
+		if (actually_read != to_read) {
 			rc = errno;
-			tar_report(tar, "Failed to write to %s: %s.\n",
+			tar_report(tar, "Failed to read data for %s: %s.\n",
 			    header->filename, str_error(rc));
-			break;
+
+			/* Let the writer close the file after queued data */
+			chunk->size = 0;
+			chunk->last = true;
+			untar_chunk_queue(untar, chunk);
+			return rc;
 		}
 
-		blocks--;
-		bytes_remaining -= TAR_BLOCK_SIZE;
+		chunk->size = to_read < bytes_remaining ? to_read :
+		    bytes_remaining;
+		chunk->last = (chunk->size == bytes_remaining);
+
+		pos += chunk->size;
+		bytes_remaining -= chunk->size;
+		untar_chunk_queue(untar, chunk);
 	}
 
-	fclose(file);
-	return rc;
+	return EOK;
 }
 
-static errno_t tar_handle_directory(tar_file_t *tar, const tar_header_t *header)
+static errno_t tar_handle_directory(untar_t *untar, const tar_header_t *header)
 {
-	errno_t rc = vfs_link_path(header->filename, KIND_DIRECTORY, NULL);
-	if (rc != EOK) {
-		if (rc != EEXIST) {
-			tar_report(tar, "Failed to create directory %s: %s.\n",
-			    header->filename, str_error(rc));
-			return rc;
+	char dir[sizeof(untar->last_dir)];
+	size_t len;
+	errno_t rc;
+
+	rc = untar_mkdir_parents(untar, header->filename);
+	if (rc != EOK)
+		return rc;
+
+	/* Directory names may carry a trailing slash */
+	str_cpy(dir, sizeof(dir), header->filename);
+	len = str_size(dir);
+	if (len > 1 && dir[len - 1] == '/')
+		dir[len - 1] = '\0';
+
+	rc = untar_mkdir(untar, dir);
+	if (rc != EOK)
+		return rc;
+
+	str_cpy(untar->last_dir, sizeof(untar->last_dir), dir);
+	return tar_skip_blocks(untar, header->size);
+}
+
+/** Initialize extraction state and start the writer fibril.
+ *
+ * @param untar Extraction state
+ * @param tar Archive
+ * @return EOK on success, ENOMEM if out of memory
+ */
+static errno_t untar_init(untar_t *untar, tar_file_t *tar)
+{
+	untar_chunk_t *chunk;
+	fid_t fid;
+	int i;
+
+	untar->tar = tar;
+	fibril_mutex_initialize(&untar->lock);
+	fibril_condvar_initialize(&untar->cv);
+	list_initialize(&untar->free_chunks);
+	list_initialize(&untar->queue);
+	untar->quit = false;
+	untar->writer_done = false;
+	untar->write_rc = EOK;
+	untar->last_dir[0] = '\0';
+
+	for (i = 0; i < UNTAR_CHUNKS; i++) {
+		chunk = malloc(sizeof(untar_chunk_t));
+		if (chunk == NULL)
+			break;
+
+		list_append(&chunk->link, &untar->free_chunks);
+	}
+
+	/* One chunk is enough to make progress */
+	if (list_empty(&untar->free_chunks))
+		return ENOMEM;
+
+	fid = fibril_create(untar_writer_fibril, untar);
+	if (fid == 0) {
+		while (!list_empty(&untar->free_chunks)) {
+			chunk = list_get_instance(list_first(&untar->free_chunks),
+			    untar_chunk_t, link);
+			list_remove(&chunk->link);
+			free(chunk);
 		}
+
+		return ENOMEM;
+	}
+
+	fibril_add_ready(fid);
+	return EOK;
+}
+
+/** Wait for the writer to finish and free extraction state.
+ *
+ * @param untar Extraction state
+ * @return EOK or the first write error
+ */
+static errno_t untar_fini(untar_t *untar)
+{
+	untar_chunk_t *chunk;
+	errno_t rc;
+
+	fibril_mutex_lock(&untar->lock);
+	untar->quit = true;
+	fibril_condvar_broadcast(&untar->cv);
+	while (!untar->writer_done)
+		fibril_condvar_wait(&untar->cv, &untar->lock);
+	rc = untar->write_rc;
+	fibril_mutex_unlock(&untar->lock);
+
+	while (!list_empty(&untar->free_chunks)) {
+		chunk = list_get_instance(list_first(&untar->free_chunks),
+		    untar_chunk_t, link);
+		list_remove(&chunk->link);
+		free(chunk);
 	}
 
-	return tar_skip_blocks(tar, header->size);
+	return rc;
 }
 
 int untar(tar_file_t *tar)
 {
+	untar_t untar;
+
 	int rc = tar_open(tar);
 	if (rc != EOK) {
 		tar_report(tar, "Failed to open: %s.\n", str_error(rc));
 		return rc;
 	}
-	
+
+	rc = untar_init(&untar, tar);
+	if (rc != EOK) {
+		tar_report(tar, "Failed to initialize: %s.\n", str_error(rc));
+		tar_close(tar);
+		return rc;
+	}
+
 	while (true) {
 		tar_header_raw_t header_raw;
 		size_t header_ok = tar_read(tar, &header_raw, sizeof(header_raw));
@@ -172,13 +512,13 @@ int untar(tar_file_t *tar)
 
 		switch (header.type) {
 		case TAR_TYPE_DIRECTORY:
-			rc = tar_handle_directory(tar, &header);
+			rc = tar_handle_directory(&untar, &header);
 			break;
 		case TAR_TYPE_NORMAL:
-			rc = tar_handle_normal_file(tar, &header);
+			rc = tar_handle_normal_file(&untar, &header);
 			break;
 		default:
-			rc = tar_skip_blocks(tar, header.size);
+			rc = tar_skip_blocks(&untar, header.size);
 			break;
 		}
 
@@ -186,6 +526,7 @@ int untar(tar_file_t *tar)
 			break;
 	}
 
+	(void) untar_fini(&untar);
 	tar_close(tar);
 	return EOK;
 }
@@ -51,6 +51,7 @@
 #include <as.h>
 #include <bitops.h>
 #include <errno.h>
+#include <fibril_synch.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <usbhc_iface.h>
@@ -109,6 +110,41 @@ static inline bool dma_buffer_is_set(const dma_buffer_t *db)
 	return !!db->virt;
 }
 
+/**
+ * A cache of equally sized DMA buffers. Mapping fresh DMA memory takes a trip
+ * to the kernel, which is too expensive to do for every transfer. Buffers
+ * returned to the pool are kept for reuse, up to a limit.
+ */
+typedef struct {
+	fibril_mutex_t guard;
+	/** Size of every buffer in the pool */
+	size_t size;
+	/** Policy the buffers are allocated with */
+	dma_policy_t policy;
+	/** Maximum number of idle buffers kept */
+	size_t max_idle;
+	/** Number of idle buffers */
+	size_t idle_count;
+	/** Idle buffers, linked through their first word */
+	void *idle;
+} dma_buffer_pool_t;
+
+#define DMA_BUFFER_POOL_INITIALIZER(name, buf_size, buf_policy, max) \
+	{ \
+		.guard = FIBRIL_MUTEX_INITIALIZER((name).guard), \
+		.size = (buf_size), \
+		.policy = (buf_policy), \
+		.max_idle = (max), \
+		.idle_count = 0, \
+		.idle = NULL, \
+	}
+
+extern void dma_buffer_pool_init(dma_buffer_pool_t *, size_t, dma_policy_t,
+    size_t);
+extern void dma_buffer_pool_fini(dma_buffer_pool_t *);
+extern errno_t dma_buffer_pool_alloc(dma_buffer_pool_t *, dma_buffer_t *);
+extern void dma_buffer_pool_free(dma_buffer_pool_t *, dma_buffer_t *);
+
 #endif
 /**
  * @}
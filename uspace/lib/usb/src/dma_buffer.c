@@ -243,6 +243,103 @@ void dma_buffer_release(dma_buffer_t *db)
 	cache_evict(db->virt);
 }
 
+/**
+ * Initialize a pool of DMA buffers.
+ *
+ * @param[in] pool Pool to initialize
+ * @param[in] size Size of every buffer in the pool
+ * @param[in] policy dma_policy_t flags to allocate the buffers with
+ * @param[in] max_idle How many returned buffers to keep for reuse
+ */
+void dma_buffer_pool_init(dma_buffer_pool_t *pool, size_t size,
+    dma_policy_t policy, size_t max_idle)
+{
+	assert(pool);
+	assert(size >= sizeof(void *));
+
+	fibril_mutex_initialize(&pool->guard);
+	pool->size = size;
+	pool->policy = policy;
+	pool->max_idle = max_idle;
+	pool->idle_count = 0;
+	pool->idle = NULL;
+}
+
+/**
+ * Free all idle buffers of a pool. Buffers still allocated from the pool
+ * shall be freed with dma_buffer_free.
+ */
+void dma_buffer_pool_fini(dma_buffer_pool_t *pool)
+{
+	fibril_mutex_lock(&pool->guard);
+
+	while (pool->idle) {
+		dma_buffer_t db = { .virt = pool->idle };
+		pool->idle = *(void **) pool->idle;
+		dma_buffer_free(&db);
+	}
+	pool->idle_count = 0;
+
+	fibril_mutex_unlock(&pool->guard);
+}
+
+/**
+ * Allocate a DMA buffer from a pool. The buffer is at least pool->size large.
+ *
+ * @param[in] pool Pool to allocate from
+ * @param[in] db dma_buffer_t structure to fill
+ * @return Error code.
+ */
+errno_t dma_buffer_pool_alloc(dma_buffer_pool_t *pool, dma_buffer_t *db)
+{
+	assert(pool);
+	assert(db);
+
+	fibril_mutex_lock(&pool->guard);
+	void *const idle = pool->idle;
+	if (idle) {
+		pool->idle = *(void **) idle;
+		pool->idle_count--;
+	}
+	fibril_mutex_unlock(&pool->guard);
+
+	if (!idle)
+		return dma_buffer_alloc_policy(db, pool->size, pool->policy);
+
+	db->virt = idle;
+	db->policy = dma_policy_create(pool->policy, 0);
+	return EOK;
+}
+
+/**
+ * Return a DMA buffer allocated from a pool. If the pool already keeps enough
+ * idle buffers, the buffer is freed.
+ *
+ * @param[in] pool Pool the buffer was allocated from
+ * @param[in] db dma_buffer_t structure buffer of which will be returned
+ */
+void dma_buffer_pool_free(dma_buffer_pool_t *pool, dma_buffer_t *db)
+{
+	assert(pool);
+	assert(db);
+
+	if (!db->virt)
+		return;
+
+	fibril_mutex_lock(&pool->guard);
+	if (pool->idle_count < pool->max_idle) {
+		*(void **) db->virt = pool->idle;
+		pool->idle = db->virt;
+		pool->idle_count++;
+
+		db->virt = NULL;
+		db->policy = 0;
+	}
+	fibril_mutex_unlock(&pool->guard);
+
+	dma_buffer_free(db);
+}
+
 /**
  * @}
  */
@@ -44,7 +44,19 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <fibril_synch.h>
-
+#include <sys/time.h>
+
+/** Accounting of a polled endpoint. */
+typedef struct {
+	/** Number of successful transfers. */
+	size_t transfers;
+	/** Number of failed transfers. */
+	size_t failures;
+	/** Total number of bytes received. */
+	size_t bytes;
+	/** Time spent in the on_data callback, in microseconds. */
+	suseconds_t busy_usec;
+} usb_polling_stats_t;
 
 /** USB automated polling. */
 typedef struct usb_polling {
@@ -61,7 +73,8 @@ typedef struct usb_polling {
 
 	/**
 	 * Data buffer of at least `request_size`. User is responsible for its
-	 * allocation.
+	 * allocation. If left NULL, the data is received directly into a DMA
+	 * buffer allocated for the lifetime of the polling fibril.
 	 */
 	uint8_t *buffer;
 
@@ -96,7 +109,8 @@ typedef struct usb_polling {
 	size_t max_failures;
 
 	/** Delay between poll requests in milliseconds.
-	 * By default, value from endpoint descriptor used.
+	 * By default (0), requests are issued back to back and the host
+	 * controller paces them by the endpoint interval.
 	 */
 	int delay;
 
@@ -145,6 +159,9 @@ typedef struct usb_polling {
 	/** Synchronization primitives for joining polling end. */
 	fibril_mutex_t guard;
 	fibril_condvar_t cv;
+
+	/** Accounting, guarded by @c guard. */
+	usb_polling_stats_t stats;
 } usb_polling_t;
 
 errno_t usb_polling_init(usb_polling_t *);
@@ -152,6 +169,7 @@ void usb_polling_fini(usb_polling_t *);
 
 errno_t usb_polling_start(usb_polling_t *);
 errno_t usb_polling_join(usb_polling_t *);
+void usb_polling_get_stats(usb_polling_t *, usb_polling_stats_t *);
 
 #endif
 /**
@@ -48,12 +48,18 @@
 #include <errno.h>
 #include <fibril.h>
 #include <fibril_synch.h>
+#include <macros.h>
 #include <stdbool.h>
 #include <stdlib.h>
 #include <str_error.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <sys/time.h>
 
+/** Delay before retrying after the first failure, in milliseconds. */
+#define POLLING_BACKOFF_MIN  8
+/** Upper limit of the retry delay, in milliseconds. */
+#define POLLING_BACKOFF_MAX  1024
 
 /** Initialize the polling data structure, its internals and configuration
  *  with default values.
@@ -76,7 +82,7 @@ int usb_polling_init(usb_polling_t *polling)
 
 	/* Default configuration. */
 	polling->auto_clear_halt = true;
-	polling->delay = -1;
+	polling->delay = 0;
 	polling->max_failures = 3;
 
 	return EOK;
@@ -127,17 +133,36 @@ static errno_t polling_fibril(void *arg)
 	}
 
 	size_t failed_attempts = 0;
+
+	/*
+	 * Without a user supplied buffer, receive the data directly into a DMA
+	 * buffer, so the reports need not be copied.
+	 */
+	uint8_t *dma_buffer = NULL;
+	if (!polling->buffer) {
+		dma_buffer = usb_pipe_alloc_buffer(pipe, polling->request_size);
+		if (!dma_buffer) {
+			usb_log_error("Poll (%p): failed to allocate buffer.",
+			    polling);
+			failed_attempts = polling->max_failures + 1;
+		}
+	}
+	uint8_t *const buffer = dma_buffer ? dma_buffer : polling->buffer;
+
 	while (failed_attempts <= polling->max_failures) {
 		size_t actual_size;
-		const errno_t rc = usb_pipe_read(pipe, polling->buffer,
-		    polling->request_size, &actual_size);
+		const errno_t rc = dma_buffer ?
+		    usb_pipe_read_dma(pipe, dma_buffer, dma_buffer,
+		    polling->request_size, &actual_size) :
+		    usb_pipe_read(pipe, buffer, polling->request_size,
+		    &actual_size);
 
 		if (rc == EOK) {
 			if (polling->debug > 1) {
 				usb_log_debug(
 				    "Poll%p: received: '%s' (%zuB).\n",
 				    polling,
-				    usb_debug_str_buffer(polling->buffer,
+				    usb_debug_str_buffer(buffer,
 				    actual_size, 16),
 				    actual_size);
 			}
@@ -159,6 +184,10 @@ static errno_t polling_fibril(void *arg)
 
 		if (rc != EOK) {
 			++failed_attempts;
+			fibril_mutex_lock(&polling->guard);
+			++polling->stats.failures;
+			fibril_mutex_unlock(&polling->guard);
+
 			const bool carry_on = !polling->on_error ? true :
 			    polling->on_error(polling->device, rc, polling->arg);
 
@@ -167,13 +196,32 @@ static errno_t polling_fibril(void *arg)
 				failed_attempts = 0;
 				break;
 			}
+
+			/*
+			 * Back off exponentially, a failing device would
+			 * otherwise be hammered with requests.
+			 */
+			if (failed_attempts <= polling->max_failures) {
+				const size_t shift = min(failed_attempts - 1, 7);
+				async_usleep(min(POLLING_BACKOFF_MIN << shift,
+				    POLLING_BACKOFF_MAX) * 1000);
+			}
 			continue;
 		}
 
 		/* We have the data, execute the callback now. */
 		assert(polling->on_data);
+		struct timeval start, end;
+		getuptime(&start);
 		const bool carry_on = polling->on_data(polling->device,
-		    polling->buffer, actual_size, polling->arg);
+		    buffer, actual_size, polling->arg);
+		getuptime(&end);
+
+		fibril_mutex_lock(&polling->guard);
+		++polling->stats.transfers;
+		polling->stats.bytes += actual_size;
+		polling->stats.busy_usec += tv_sub_diff(&end, &start);
+		fibril_mutex_unlock(&polling->guard);
 
 		if (!carry_on) {
 			/* This is user requested abort, erases failures. */
@@ -184,20 +232,27 @@ static errno_t polling_fibril(void *arg)
 		/* Reset as something might be only a temporary problem. */
 		failed_attempts = 0;
 
-		/* Take a rest before next request. */
-
-		// FIXME TODO: This is broken, the time is in ms not us.
-		// but first we need to fix drivers to actually stop using this,
-		// since polling delay should be implemented in HC schedule
-		async_usleep(polling->delay);
+		/*
+		 * The host controller already serves the endpoint once per its
+		 * interval, an extra delay is only taken when asked for.
+		 */
+		if (polling->delay > 0)
+			async_usleep(polling->delay * 1000);
 	}
 
 	const bool failed = failed_attempts > 0;
 
+	if (dma_buffer)
+		usb_pipe_free_buffer(pipe, dma_buffer);
+
 	if (polling->on_polling_end)
 		polling->on_polling_end(polling->device, failed, polling->arg);
 
 	if (polling->debug > 0) {
+		usb_log_debug("Poll (%p): %zu transfers (%zuB), %zu failures, "
+		    "%ld us in callbacks.\n", polling, polling->stats.transfers,
+		    polling->stats.bytes, polling->stats.failures,
+		    (long) polling->stats.busy_usec);
 		if (failed) {
 			usb_log_error("Polling of device `%s' terminated: "
 			    "recurring failures.\n",
@@ -244,10 +299,6 @@ errno_t usb_polling_start(usb_polling_t *polling)
 	    (polling->ep_mapping->pipe.desc.direction != USB_DIRECTION_IN))
 		return EINVAL;
 
-	/* Negative value means use descriptor provided value. */
-	if (polling->delay < 0)
-		polling->delay = polling->ep_mapping->descriptor->poll_interval;
-
 	polling->fibril = fibril_create(polling_fibril, polling);
 	if (!polling->fibril)
 		return ENOMEM;
@@ -298,6 +349,21 @@ errno_t usb_polling_join(usb_polling_t *polling)
 	return EOK;
 }
 
+/** Get accounting of the polled endpoint.
+ *
+ * @param polling Polling data structure.
+ * @param stats Where to store the snapshot.
+ */
+void usb_polling_get_stats(usb_polling_t *polling, usb_polling_stats_t *stats)
+{
+	assert(polling);
+	assert(stats);
+
+	fibril_mutex_lock(&polling->guard);
+	*stats = polling->stats;
+	fibril_mutex_unlock(&polling->guard);
+}
+
 /**
  * @}
  */
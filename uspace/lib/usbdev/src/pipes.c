@@ -130,6 +130,26 @@ static void setup_dma_buffer(transfer_t *t, void *base, void *ptr, size_t size)
 	t->req.size = size;
 }
 
+/*
+ * Bounce buffers for transfers without preallocated buffer. They are
+ * allocated with the strictest policy, which satisfies any pipe. Small
+ * transfers (requests, CBW/CSW, reports) and typical block transfers are
+ * served from the pools, only the larger ones map fresh memory.
+ */
+static dma_buffer_pool_t small_buffers =
+    DMA_BUFFER_POOL_INITIALIZER(small_buffers, PAGE_SIZE, DMA_POLICY_STRICT, 16);
+static dma_buffer_pool_t large_buffers =
+    DMA_BUFFER_POOL_INITIALIZER(large_buffers, 256 * 1024, DMA_POLICY_STRICT, 4);
+
+static dma_buffer_pool_t *wrap_buffer_pool(size_t size)
+{
+	if (size <= small_buffers.size)
+		return &small_buffers;
+	if (size <= large_buffers.size)
+		return &large_buffers;
+	return NULL;
+}
+
 /**
  * Compatibility wrapper for reads/writes without preallocated buffer.
  */
@@ -140,18 +160,28 @@ static errno_t transfer_wrap_dma(transfer_t *t, void *buf, size_t size)
 		return transfer_common(t);
 	}
 
-	void *dma_buf = usb_pipe_alloc_buffer(t->pipe, size);
-	setup_dma_buffer(t, dma_buf, dma_buf, size);
+	dma_buffer_pool_t *const pool = wrap_buffer_pool(size);
+
+	dma_buffer_t db;
+	errno_t err = pool ? dma_buffer_pool_alloc(pool, &db) :
+	    dma_buffer_alloc_policy(&db, size, t->pipe->desc.transfer_buffer_policy);
+	if (err)
+		return err;
+
+	setup_dma_buffer(t, db.virt, db.virt, size);
 
 	if (t->dir == USB_DIRECTION_OUT)
-		memcpy(dma_buf, buf, size);
+		memcpy(db.virt, buf, size);
 
-	const errno_t err = transfer_common(t);
+	err = transfer_common(t);
 
 	if (!err && t->dir == USB_DIRECTION_IN)
-		memcpy(buf, dma_buf, t->transferred_size);
+		memcpy(buf, db.virt, t->transferred_size);
 
-	usb_pipe_free_buffer(t->pipe, dma_buf);
+	if (pool)
+		dma_buffer_pool_free(pool, &db);
+	else
+		dma_buffer_free(&db);
 	return err;
 }
 
@@ -297,6 +327,56 @@ errno_t usb_pipe_write(usb_pipe_t *pipe, const void *buffer, size_t size)
 	return transfer_wrap_dma(&transfer, (void *) buffer, size);
 }
 
+/** Request a read (in) transfer on a stream of an endpoint pipe.
+ *
+ * @param[in] pipe Pipe used for the transfer.
+ * @param[in] stream Stream ID, enabled by usb_pipe_request_streams.
+ * @param[out] buffer Buffer where to store the data.
+ * @param[in] size Size of the buffer (in bytes).
+ * @param[out] size_transferred Number of bytes that were actually transferred.
+ * @return Error code.
+ */
+errno_t usb_pipe_read_stream(usb_pipe_t *pipe, usb_stream_t stream,
+    void *buffer, size_t size, size_t *size_transferred)
+{
+	assert(pipe);
+	errno_t err;
+	transfer_t transfer = {
+		.pipe = pipe,
+		.dir = USB_DIRECTION_IN,
+		.req.stream = stream,
+	};
+
+	if ((err = transfer_wrap_dma(&transfer, buffer, size)))
+		return err;
+
+	if (size_transferred)
+		*size_transferred = transfer.transferred_size;
+
+	return EOK;
+}
+
+/** Request a write (out) transfer on a stream of an endpoint pipe.
+ *
+ * @param[in] pipe Pipe used for the transfer.
+ * @param[in] stream Stream ID, enabled by usb_pipe_request_streams.
+ * @param[in] buffer Buffer with data to transfer.
+ * @param[in] size Size of the buffer (in bytes).
+ * @return Error code.
+ */
+errno_t usb_pipe_write_stream(usb_pipe_t *pipe, usb_stream_t stream,
+    const void *buffer, size_t size)
+{
+	assert(pipe);
+	transfer_t transfer = {
+		.pipe = pipe,
+		.dir = USB_DIRECTION_OUT,
+		.req.stream = stream,
+	};
+
+	return transfer_wrap_dma(&transfer, (void *) buffer, size);
+}
+
 /**
  * Request a read (in) transfer on an endpoint pipe, declaring that buffer
  * is pointing to a memory area previously allocated by usb_pipe_alloc_buffer.
@@ -457,6 +537,29 @@ errno_t usb_pipe_unregister(usb_pipe_t *pipe)
 	return ret;
 }
 
+/** Enable streams on a registered bulk endpoint.
+ *
+ * Transfers on the pipe then have to use one of the streams 1 to @p count,
+ * see usb_pipe_read_stream and usb_pipe_write_stream.
+ *
+ * @param pipe Pipe of a SuperSpeed bulk endpoint.
+ * @param count Number of streams, a power of two.
+ * @return Error code.
+ */
+errno_t usb_pipe_request_streams(usb_pipe_t *pipe, unsigned count)
+{
+	assert(pipe);
+	assert(pipe->bus_session);
+	async_exch_t *exch = async_exchange_begin(pipe->bus_session);
+	if (!exch)
+		return ENOMEM;
+
+	const errno_t ret = usbhc_request_streams(exch, &pipe->desc, count);
+
+	async_exchange_end(exch);
+	return ret;
+}
+
 /**
  * @}
  */
@@ -58,6 +58,10 @@ usb_hid_report_description_t *usb_hid_report_find_description(
     const usb_hid_report_t *report, uint8_t report_id,
     usb_hid_report_type_t type);
 
+usb_hid_report_field_t *usb_hid_report_find_field(usb_hid_report_t *report,
+    uint8_t report_id, usb_hid_report_type_t type, uint16_t usage_page,
+    uint16_t usage);
+
 int usb_hid_report_parse_tag(uint8_t tag, uint8_t class, const uint8_t *data,
     size_t item_size, usb_hid_report_item_t *report_item,
     usb_hid_report_path_t *usage_path);
@@ -35,7 +35,9 @@
 #ifndef LIBUSB_HIDTYPES_H_
 #define LIBUSB_HIDTYPES_H_
 
+#include <stdbool.h>
 #include <stdint.h>
+#include <adt/hash_table.h>
 #include <adt/list.h>
 
 
@@ -110,6 +112,12 @@ typedef struct {
 	/** Report id of last parsed report. */
 	uint8_t last_report_id;
 
+	/** Variable fields indexed by report and usage. */
+	hash_table_t field_index;
+
+	/** Whether the report descriptor was compiled (field_index is valid). */
+	bool compiled;
+
 } usb_hid_report_t;
 
 
@@ -132,6 +140,12 @@ typedef struct {
 	/** List of report items in report */
 	list_t report_items;
 
+	/** Non-constant report items in report order. */
+	struct usb_hid_report_field **fields;
+
+	/** Number of entries in fields. */
+	size_t field_count;
+
 	/** Link to usb_hid_report_t.reports list. */
 	link_t reports_link;
 } usb_hid_report_description_t;
@@ -140,7 +154,7 @@ typedef struct {
 /**
  * Description of one field/item in report
  */
-typedef struct {
+typedef struct usb_hid_report_field {
 	/** Bit offset of the field */
 	int offset;
 
@@ -198,6 +212,15 @@ typedef struct {
 	/** Parsed value */
 	int32_t value;
 
+	/** Precomputed ratio between logical and physical values */
+	int32_t resolution;
+
+	/** Report the field belongs to */
+	usb_hid_report_description_t *report_des;
+
+	/** Link to usb_hid_report_t.field_index */
+	ht_link_t index_link;
+
 	/** Link to usb_hid_report_description_t.report_items list */
 	link_t ritems_link;
 } usb_hid_report_field_t;
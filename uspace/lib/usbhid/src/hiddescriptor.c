@@ -40,6 +40,7 @@
 #include <usb/debug.h>
 #include <assert.h>
 #include <stdlib.h>
+#include <adt/hash_table.h>
 
 
 /*
@@ -329,6 +330,194 @@ usb_hid_report_description_t *usb_hid_report_find_description(
 }
 
 
+/** Lookup key of usb_hid_report_t.field_index. */
+typedef struct {
+	uint8_t report_id;
+	usb_hid_report_type_t type;
+	uint16_t usage_page;
+	uint16_t usage;
+} usb_hid_field_key_t;
+
+static size_t field_key_hash(const usb_hid_field_key_t *key)
+{
+	return (key->report_id << 24) ^ (key->type << 20) ^
+	    (key->usage_page << 16) ^ key->usage;
+}
+
+static void field_key_get(const usb_hid_report_field_t *field,
+    usb_hid_field_key_t *key)
+{
+	key->report_id = field->report_des->report_id;
+	key->type = field->report_des->type;
+	key->usage_page = field->usage_page;
+	key->usage = field->usage;
+}
+
+static size_t field_index_hash(const ht_link_t *item)
+{
+	usb_hid_field_key_t key;
+	field_key_get(hash_table_get_inst(item, usb_hid_report_field_t,
+	    index_link), &key);
+	return field_key_hash(&key);
+}
+
+static size_t field_index_key_hash(void *key)
+{
+	return field_key_hash(key);
+}
+
+static bool field_index_key_equal(void *arg, const ht_link_t *item)
+{
+	const usb_hid_field_key_t *key = arg;
+	usb_hid_field_key_t other;
+	field_key_get(hash_table_get_inst(item, usb_hid_report_field_t,
+	    index_link), &other);
+	return key->report_id == other.report_id && key->type == other.type &&
+	    key->usage_page == other.usage_page && key->usage == other.usage;
+}
+
+static bool field_index_equal(const ht_link_t *item1, const ht_link_t *item2)
+{
+	usb_hid_field_key_t key;
+	field_key_get(hash_table_get_inst(item1, usb_hid_report_field_t,
+	    index_link), &key);
+	return field_index_key_equal(&key, item2);
+}
+
+static void field_index_remove_callback(ht_link_t *item)
+{
+	/* Fields are owned by their report description. */
+}
+
+static hash_table_ops_t field_index_ops = {
+	.hash = field_index_hash,
+	.key_hash = field_index_key_hash,
+	.equal = field_index_equal,
+	.key_equal = field_index_key_equal,
+	.remove_callback = field_index_remove_callback
+};
+
+/** Precompute the translation of field values.
+ *
+ * @param field Report field
+ */
+static void usb_hid_report_field_prepare(usb_hid_report_field_t *field)
+{
+	if ((field->physical_minimum == 0) && (field->physical_maximum == 0)) {
+		field->physical_minimum = field->logical_minimum;
+		field->physical_maximum = field->logical_maximum;
+	}
+
+	field->resolution = 1;
+	if (field->physical_maximum != field->physical_minimum) {
+		int32_t scale = field->physical_maximum -
+		    field->physical_minimum;
+		for (uint32_t i = 0; i < field->unit_exponent; ++i)
+			scale *= 10;
+
+		if (scale != 0) {
+			field->resolution = (field->logical_maximum -
+			    field->logical_minimum) / scale;
+		}
+		if (field->resolution == 0)
+			field->resolution = 1;
+	}
+}
+
+/** Compile parsed report descriptor for fast report processing.
+ *
+ * Each report gets a flat table of its data fields, so that a report is
+ * processed in a single pass, and variable fields are indexed by usage.
+ *
+ * @param report Report structure with all fields appended
+ * @return Error code
+ */
+static errno_t usb_hid_report_compile(usb_hid_report_t *report)
+{
+	if (report->compiled) {
+		hash_table_clear(&report->field_index);
+	} else {
+		if (!hash_table_create(&report->field_index, 0, 0,
+		    &field_index_ops))
+			return ENOMEM;
+		report->compiled = true;
+	}
+
+	list_foreach(report->reports, reports_link,
+	    usb_hid_report_description_t, report_des) {
+		size_t count = 0;
+		list_foreach(report_des->report_items, ritems_link,
+		    usb_hid_report_field_t, field) {
+			if (USB_HID_ITEM_FLAG_CONSTANT(field->item_flags) == 0)
+				++count;
+		}
+
+		free(report_des->fields);
+		report_des->field_count = 0;
+		report_des->fields = calloc(max(count, 1),
+		    sizeof(usb_hid_report_field_t *));
+		if (report_des->fields == NULL)
+			return ENOMEM;
+
+		list_foreach(report_des->report_items, ritems_link,
+		    usb_hid_report_field_t, field) {
+			field->report_des = report_des;
+			usb_hid_report_field_prepare(field);
+
+			if (USB_HID_ITEM_FLAG_CONSTANT(field->item_flags) != 0)
+				continue;
+
+			report_des->fields[report_des->field_count++] = field;
+
+			/* Array fields change their usage with every report. */
+			if (USB_HID_ITEM_FLAG_VARIABLE(field->item_flags) != 0) {
+				hash_table_insert(&report->field_index,
+				    &field->index_link);
+			}
+		}
+	}
+
+	return EOK;
+}
+
+/** Find the first variable field with given usage.
+ *
+ * @param report Parsed report descriptor
+ * @param report_id Report id, zero stands for the first report of the type
+ * @param type Report type
+ * @param usage_page Usage page of the field
+ * @param usage Usage of the field
+ * @return The field or NULL if there is none
+ */
+usb_hid_report_field_t *usb_hid_report_find_field(usb_hid_report_t *report,
+    uint8_t report_id, usb_hid_report_type_t type, uint16_t usage_page,
+    uint16_t usage)
+{
+	if (report == NULL || !report->compiled)
+		return NULL;
+
+	if (report_id == 0 && report->use_report_ids != 0) {
+		const usb_hid_report_description_t *report_des =
+		    usb_hid_report_find_description(report, 0, type);
+		if (report_des == NULL)
+			return NULL;
+		report_id = report_des->report_id;
+	}
+
+	usb_hid_field_key_t key = {
+		.report_id = report_id,
+		.type = type,
+		.usage_page = usage_page,
+		.usage = usage
+	};
+
+	ht_link_t *item = hash_table_find(&report->field_index, &key);
+	if (item == NULL)
+		return NULL;
+
+	return hash_table_get_inst(item, usb_hid_report_field_t, index_link);
+}
+
 /** Parse HID report descriptor.
  *
  * @param parser Opaque HID report parser structure.
@@ -512,7 +701,7 @@ errno_t usb_hid_parse_report_descriptor(usb_hid_report_t *report,
 
 	}
 
-	return EOK;
+	return usb_hid_report_compile(report);
 }
 
 
@@ -948,6 +1137,11 @@ void usb_hid_report_deinit(usb_hid_report_t *report)
 		return;
 	}
 
+	if (report->compiled) {
+		hash_table_destroy(&report->field_index);
+		report->compiled = false;
+	}
+
 	// free collection paths
 	link_t *path_link;
 	usb_hid_report_path_t *path;
@@ -968,6 +1162,7 @@ void usb_hid_report_deinit(usb_hid_report_t *report)
 		    usb_hid_report_description_t, reports_link);
 
 		list_remove(&report_des->reports_link);
+		free(report_des->fields);
 
 		while (!list_empty(&report_des->report_items)) {
 			field = list_get_instance(
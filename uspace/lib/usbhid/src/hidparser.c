@@ -56,22 +56,6 @@ uint32_t usb_hid_translate_data_reverse(usb_hid_report_field_t *item,
 
 
 
-static int usb_pow(int a, int b)
-{
-	switch (b) {
-	case 0:
-		return 1;
-		break;
-	case 1:
-		return a;
-		break;
-	default:
-		return a * usb_pow(a, b - 1);
-		break;
-	}
-}
-
-
 /** Returns size of report of specified report id and type in items
  *
  * @param parser Opaque report parser structure
@@ -152,39 +136,36 @@ errno_t usb_hid_parse_report(const usb_hid_report_t *report, const uint8_t *data
 		return EINVAL;
 	}
 
-	/* read data */
-	list_foreach(report_des->report_items, ritems_link,
-	    usb_hid_report_field_t, item) {
-
-		if (USB_HID_ITEM_FLAG_CONSTANT(item->item_flags) == 0) {
-
-			if (USB_HID_ITEM_FLAG_VARIABLE(item->item_flags) == 0) {
-				/* array */
-				item->value =
-				    usb_hid_translate_data(item, data);
-
-				item->usage = USB_HID_EXTENDED_USAGE(
-				    item->usages[item->value -
-				    item->physical_minimum]);
-
-				item->usage_page =
-				    USB_HID_EXTENDED_USAGE_PAGE(
-				    item->usages[item->value -
-				    item->physical_minimum]);
-
-				usb_hid_report_set_last_item(
-				    item->collection_path,
-				    USB_HID_TAG_CLASS_GLOBAL,
-				    item->usage_page);
-
-				usb_hid_report_set_last_item(
-				    item->collection_path,
-				    USB_HID_TAG_CLASS_LOCAL, item->usage);
-			} else {
-				/* variable item */
-				item->value = usb_hid_translate_data(item,
-				    data);
-			}
+	/* read data, the table holds only non-constant fields */
+	const size_t bits = size * 8;
+	for (size_t i = 0; i < report_des->field_count; ++i) {
+		usb_hid_report_field_t *item = report_des->fields[i];
+
+		/* Fields missing from a short report keep their value. */
+		if ((size_t) item->offset + item->size > bits)
+			continue;
+
+		item->value = usb_hid_translate_data(item, data);
+
+		if (USB_HID_ITEM_FLAG_VARIABLE(item->item_flags) == 0) {
+			/* array */
+			item->usage = USB_HID_EXTENDED_USAGE(
+			    item->usages[item->value -
+			    item->physical_minimum]);
+
+			item->usage_page =
+			    USB_HID_EXTENDED_USAGE_PAGE(
+			    item->usages[item->value -
+			    item->physical_minimum]);
+
+			usb_hid_report_set_last_item(
+			    item->collection_path,
+			    USB_HID_TAG_CLASS_GLOBAL,
+			    item->usage_page);
+
+			usb_hid_report_set_last_item(
+			    item->collection_path,
+			    USB_HID_TAG_CLASS_LOCAL, item->usage);
 		}
 	}
 
@@ -206,19 +187,8 @@ int usb_hid_translate_data(usb_hid_report_field_t *item, const uint8_t *data)
 		return 0;
 	}
 
-	if ((item->physical_minimum == 0) && (item->physical_maximum == 0)) {
-		item->physical_minimum = item->logical_minimum;
-		item->physical_maximum = item->logical_maximum;
-	}
-
-	int resolution;
-	if (item->physical_maximum == item->physical_minimum) {
-		resolution = 1;
-	} else {
-		resolution = (item->logical_maximum - item->logical_minimum) /
-		    ((item->physical_maximum - item->physical_minimum) *
-		    (usb_pow(10, (item->unit_exponent))));
-	}
+	/* Physical range and resolution were set up when compiling. */
+	const int resolution = item->resolution;
 
 	int32_t value = 0;
 
@@ -426,19 +396,8 @@ uint32_t usb_hid_translate_data_reverse(usb_hid_report_field_t *item,
 		return item->logical_minimum;
 	}
 
-	if ((item->physical_minimum == 0) && (item->physical_maximum == 0)) {
-		item->physical_minimum = item->logical_minimum;
-		item->physical_maximum = item->logical_maximum;
-	}
-
 	/* variable item */
-	if (item->physical_maximum == item->physical_minimum) {
-		resolution = 1;
-	} else {
-		resolution = (item->logical_maximum - item->logical_minimum) /
-		    ((item->physical_maximum - item->physical_minimum) *
-		    (usb_pow(10, (item->unit_exponent))));
-	}
+	resolution = item->resolution;
 
 	ret = ((value - item->physical_minimum) * resolution) +
 	    item->logical_minimum;
@@ -117,6 +117,7 @@ struct bus_ops {
 	int (*endpoint_register)(endpoint_t *);
 	void (*endpoint_unregister)(endpoint_t *);
 	void (*endpoint_destroy)(endpoint_t *);			/**< Optional */
+	int (*endpoint_request_streams)(endpoint_t *, unsigned);	/**< Optional */
 	usb_transfer_batch_t *(*batch_create)(endpoint_t *);	/**< Optional */
 
 	/* Operations on batch */
@@ -181,6 +182,7 @@ errno_t bus_device_send_batch_sync(device_t *, usb_target_t,
 int bus_endpoint_add(device_t *, const usb_endpoint_descriptors_t *, endpoint_t **);
 endpoint_t *bus_find_endpoint(device_t *, usb_endpoint_t, usb_direction_t);
 int bus_endpoint_remove(endpoint_t *);
+int bus_endpoint_request_streams(endpoint_t *, unsigned);
 
 int bus_reserve_default_address(bus_t *, device_t *);
 void bus_release_default_address(bus_t *, device_t *);
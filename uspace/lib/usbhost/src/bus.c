@@ -521,6 +521,28 @@ int bus_endpoint_remove(endpoint_t *ep)
 	return EOK;
 }
 
+/**
+ * Enable streams on an endpoint, if the HC supports them.
+ */
+int bus_endpoint_request_streams(endpoint_t *ep, unsigned count)
+{
+	assert(ep);
+
+	device_t *device = ep->device;
+	if (!device)
+		return ENOENT;
+
+	bus_t *bus = device->bus;
+
+	if (!bus->ops->endpoint_request_streams)
+		return ENOTSUP;
+
+	usb_log_debug("Request %u streams on endpoint %d:%d %s.", count,
+	    device->address, ep->endpoint, usb_str_direction(ep->direction));
+
+	return bus->ops->endpoint_request_streams(ep, count);
+}
+
 /**
  * Reserve the default address on the bus for the specified device (hub).
  */
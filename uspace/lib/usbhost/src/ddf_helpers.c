@@ -118,6 +118,32 @@ static errno_t unregister_endpoint(ddf_fun_t *fun, const usb_pipe_desc_t *pipe_d
 	return err;
 }
 
+/**
+ * DDF usbhc_iface callback. Enable streams on the endpoint that makes the
+ * other end of the pipe described.
+ *
+ * @param fun DDF function of the device in question.
+ * @param pipe_desc Pipe description.
+ * @param count Number of streams requested.
+ * @return Error code.
+ */
+static errno_t request_streams(ddf_fun_t *fun, const usb_pipe_desc_t *pipe_desc,
+    unsigned count)
+{
+	assert(fun);
+	device_t *dev = ddf_fun_data_get(fun);
+	assert(dev);
+
+	endpoint_t *ep = bus_find_endpoint(dev, pipe_desc->endpoint_no, pipe_desc->direction);
+	if (!ep)
+		return ENOENT;
+
+	const errno_t err = bus_endpoint_request_streams(ep, count);
+
+	endpoint_del_ref(ep);
+	return err;
+}
+
 /**
  * DDF usbhc_iface callback. Calls the respective bus operation directly.
  *
@@ -330,6 +356,7 @@ static usbhc_iface_t usbhc_iface = {
 
 	.register_endpoint = register_endpoint,
 	.unregister_endpoint = unregister_endpoint,
+	.request_streams = request_streams,
 
 	.transfer = transfer,
 };
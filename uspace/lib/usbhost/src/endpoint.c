@@ -269,7 +269,12 @@ errno_t endpoint_send_batch(endpoint_t *ep, const transfer_request_t *req)
 
 	dma_buffer_acquire(&batch->dma_buffer);
 
-	if (batch->offset != 0) {
+	/*
+	 * HCs that cope with buffers split into chunks also handle the buffer
+	 * starting at an offset. For the rest, the data has to be moved.
+	 */
+	if (batch->offset != 0 &&
+	    ep->required_transfer_buffer_policy == DMA_POLICY_STRICT) {
 		usb_log_debug("A transfer with nonzero offset requested.");
 		usb_transfer_batch_bounce(batch);
 	}
@@ -60,6 +60,11 @@
 
 #define VIRTIO_FEATURES_0_31	0
 
+/** Driver can use descriptors with the VIRTQ_DESC_F_INDIRECT flag set */
+#define VIRTIO_F_INDIRECT_DESC	(1U << 28)
+/** Driver and device use the used_event and avail_event ring fields */
+#define VIRTIO_F_EVENT_IDX	(1U << 29)
+
 /** Common configuration structure layout according to VIRTIO version 1.0 */
 typedef struct virtio_pci_common_cfg {
 	ioport32_t device_feature_select;
@@ -148,6 +153,11 @@ typedef struct {
 	virtq_used_t *used;
 	uint16_t used_last_idx;
 
+	/** The used_event field at the end of the available ring */
+	ioport16_t *used_event;
+	/** The avail_event field at the end of the used ring */
+	ioport16_t *avail_event;
+
 	/** Address of the queue's notification register */
 	ioport16_t *notify;
 } virtq_t;
@@ -176,6 +186,9 @@ typedef struct {
 	/** Device-specific configuration */
 	void *device_cfg;
 
+	/** Negotiated feature flags */
+	uint32_t features;
+
 	/** Virtqueues */
 	virtq_t *queues;
 } virtio_dev_t;
@@ -184,6 +197,8 @@ extern errno_t virtio_setup_dma_bufs(unsigned int, size_t, bool, void *[],
     uintptr_t []);
 extern void virtio_teardown_dma_bufs(void *[]);
 
+extern void virtio_desc_set(virtq_desc_t *, uint64_t, uint32_t, uint16_t,
+    uint16_t);
 extern void virtio_virtq_desc_set(virtio_dev_t *vdev, uint16_t, uint16_t,
     uint64_t, uint32_t, uint16_t, uint16_t);
 extern uint16_t virtio_virtq_desc_get_next(virtio_dev_t *vdev, uint16_t,
@@ -197,11 +212,13 @@ extern void virtio_free_desc(virtio_dev_t *, uint16_t, uint16_t *, uint16_t);
 extern void virtio_virtq_produce_available(virtio_dev_t *, uint16_t, uint16_t);
 extern bool virtio_virtq_consume_used(virtio_dev_t *, uint16_t, uint16_t *,
     uint32_t *);
+extern void virtio_virtq_disable_cb(virtio_dev_t *, uint16_t);
+extern bool virtio_virtq_enable_cb(virtio_dev_t *, uint16_t);
 
 extern errno_t virtio_virtq_setup(virtio_dev_t *, uint16_t, uint16_t);
 extern void virtio_virtq_teardown(virtio_dev_t *, uint16_t);
 
-extern errno_t virtio_device_setup_start(virtio_dev_t *, uint32_t);
+extern errno_t virtio_device_setup_start(virtio_dev_t *, uint32_t, uint32_t);
 extern void virtio_device_setup_fail(virtio_dev_t *);
 extern void virtio_device_setup_finalize(virtio_dev_t *);
 
@@ -92,16 +92,27 @@ extern void virtio_teardown_dma_bufs(void *buf[])
 	}
 }
 
-void virtio_virtq_desc_set(virtio_dev_t *vdev, uint16_t num, uint16_t descno,
-    uint64_t addr, uint32_t len, uint16_t flags, uint16_t next)
+/** Fill in a descriptor
+ *
+ * Besides the descriptors in the virtqueue, this can be used to fill in
+ * descriptors in an indirect descriptor table (VIRTQ_DESC_F_INDIRECT).
+ */
+void virtio_desc_set(virtq_desc_t *d, uint64_t addr, uint32_t len,
+    uint16_t flags, uint16_t next)
 {
-	virtq_desc_t *d = &vdev->queues[num].desc[descno];
 	pio_write_le64(&d->addr, addr);
 	pio_write_le32(&d->len, len);
 	pio_write_le16(&d->flags, flags);
 	pio_write_le16(&d->next, next);
 }
 
+void virtio_virtq_desc_set(virtio_dev_t *vdev, uint16_t num, uint16_t descno,
+    uint64_t addr, uint32_t len, uint16_t flags, uint16_t next)
+{
+	virtio_desc_set(&vdev->queues[num].desc[descno], addr, len, flags,
+	    next);
+}
+
 uint16_t virtio_virtq_desc_get_next(virtio_dev_t *vdev, uint16_t num,
     uint16_t descno)
 {
@@ -169,18 +180,48 @@ void virtio_free_desc(virtio_dev_t *vdev, uint16_t num, uint16_t *head,
 }
 
 
+/** Determine whether an event index was crossed
+ *
+ * @param event  Event index set by the other side
+ * @param new    New ring index
+ * @param old    Ring index at the time of the previous event
+ *
+ * @return  True if @a event lies in the interval [old, new).
+ */
+static bool virtio_need_event(uint16_t event, uint16_t new, uint16_t old)
+{
+	return (uint16_t) (new - event - 1) < (uint16_t) (new - old);
+}
+
+/** Put descriptor into the available ring and notify the device
+ *
+ * The notification is skipped if the device asked not to be notified,
+ * either with VIRTQ_USED_F_NO_NOTIFY or, if VIRTIO_F_EVENT_IDX was
+ * negotiated, by not reaching its avail_event index.
+ */
 void virtio_virtq_produce_available(virtio_dev_t *vdev, uint16_t num,
     uint16_t descno)
 {
 	virtq_t *q = &vdev->queues[num];
+	bool notify;
 
 	fibril_mutex_lock(&q->lock);
 	uint16_t idx = pio_read_le16(&q->avail->idx);
 	pio_write_le16(&q->avail->ring[idx % q->queue_size], descno);
 	write_barrier();
 	pio_write_le16(&q->avail->idx, idx + 1);
-	write_barrier();
-	pio_write_le16(q->notify, num);
+	memory_barrier();
+
+	if (vdev->features & VIRTIO_F_EVENT_IDX) {
+		notify = virtio_need_event(pio_read_le16(q->avail_event),
+		    idx + 1, idx);
+	} else {
+		notify = !(pio_read_le16(&q->used->flags) &
+		    VIRTQ_USED_F_NO_NOTIFY);
+	}
+
+	if (notify)
+		pio_write_le16(q->notify, num);
 	fibril_mutex_unlock(&q->lock);
 }
 
@@ -205,6 +246,54 @@ bool virtio_virtq_consume_used(virtio_dev_t *vdev, uint16_t num,
 	return true;
 }
 
+/** Ask the device not to interrupt on used buffers of a virtqueue
+ *
+ * This is only a hint, the device may still send interrupts.
+ *
+ * @param vdev[in]  VIRTIO device
+ * @param num[in]   Index of the virtqueue
+ */
+void virtio_virtq_disable_cb(virtio_dev_t *vdev, uint16_t num)
+{
+	virtq_t *q = &vdev->queues[num];
+
+	fibril_mutex_lock(&q->lock);
+	if (vdev->features & VIRTIO_F_EVENT_IDX) {
+		/* Event index the device will not reach before wrapping */
+		pio_write_le16(q->used_event, q->used_last_idx - 1);
+	} else {
+		pio_write_le16(&q->avail->flags, VIRTQ_AVAIL_F_NO_INTERRUPT);
+	}
+	fibril_mutex_unlock(&q->lock);
+}
+
+/** Let the device interrupt on used buffers of a virtqueue again
+ *
+ * A buffer may have been used while the interrupts were disabled, so the
+ * caller must check for used buffers once more if this returns false.
+ *
+ * @param vdev[in]  VIRTIO device
+ * @param num[in]   Index of the virtqueue
+ *
+ * @return  True if there are no pending used buffers, false otherwise.
+ */
+bool virtio_virtq_enable_cb(virtio_dev_t *vdev, uint16_t num)
+{
+	virtq_t *q = &vdev->queues[num];
+
+	fibril_mutex_lock(&q->lock);
+	if (vdev->features & VIRTIO_F_EVENT_IDX)
+		pio_write_le16(q->used_event, q->used_last_idx);
+	else
+		pio_write_le16(&q->avail->flags, 0);
+	memory_barrier();
+
+	bool empty = q->used_last_idx == pio_read_le16(&q->used->idx);
+	fibril_mutex_unlock(&q->lock);
+
+	return empty;
+}
+
 errno_t virtio_virtq_setup(virtio_dev_t *vdev, uint16_t num, uint16_t size)
 {
 	virtq_t *q = &vdev->queues[num];
@@ -257,6 +346,8 @@ errno_t virtio_virtq_setup(virtio_dev_t *vdev, uint16_t num, uint16_t size)
 	q->avail = q->virt + avail_offset;
 	q->used = q->virt + used_offset;
 	q->used_last_idx = 0;
+	q->used_event = &q->avail->ring[size];
+	q->avail_event = (ioport16_t *) &q->used->ring[size];
 
 	memset(q->virt, 0, q->size);
 
@@ -298,8 +389,13 @@ void virtio_virtq_teardown(virtio_dev_t *vdev, uint16_t num)
 /**
  * Perform device initialization as described in section 3.1.1 of the
  * specification, steps 1 - 6.
+ *
+ * Features in @a features are required, features in @a optional are
+ * accepted only if offered by the device. The negotiated features are
+ * stored in @c vdev->features.
  */
-errno_t virtio_device_setup_start(virtio_dev_t *vdev, uint32_t features)
+errno_t virtio_device_setup_start(virtio_dev_t *vdev, uint32_t features,
+    uint32_t optional)
 {
 	virtio_pci_common_cfg_t *cfg = vdev->common_cfg;
 
@@ -323,7 +419,7 @@ errno_t virtio_device_setup_start(virtio_dev_t *vdev, uint32_t features)
 
 	if (features != (features & device_features))
 		return ENOTSUP;
-	features &= device_features;
+	features |= optional & device_features;
 
 	/* 4. Write the accepted feature flags */
 	pio_write_le32(&cfg->driver_feature_select, VIRTIO_FEATURES_0_31);
@@ -340,6 +436,7 @@ errno_t virtio_device_setup_start(virtio_dev_t *vdev, uint32_t features)
 	if (!(status & VIRTIO_DEV_STATUS_FEATURES_OK))
 		return ENOTSUP;
 
+	vdev->features = features;
 	return EOK;
 }
 
@@ -34,7 +34,9 @@
  */
 
 #include <macros.h>
+#include <mem.h>
 #include <stdlib.h>
+#include <libarch/barrier.h>
 
 #include "audio_data.h"
 #include "log.h"
@@ -309,6 +311,199 @@ size_t audio_pipe_mix_data(audio_pipe_t *pipe, void *data,
 	return copied_size;
 }
 
+/* Audio Ring */
+
+/**
+ * Initialize audio ring buffer.
+ * @param ring The ring structure to initialize.
+ * @param size Requested capacity, rounded down to whole frames.
+ * @param format Format of the audio data.
+ * @return Error code.
+ */
+errno_t audio_ring_init(audio_ring_t *ring, size_t size, pcm_format_t format)
+{
+	assert(ring);
+	const size_t frame_size = pcm_format_frame_size(&format);
+	if (frame_size == 0)
+		return EINVAL;
+
+	size -= size % frame_size;
+	if (size == 0)
+		size = frame_size;
+
+	ring->buffer = malloc(size);
+	if (!ring->buffer)
+		return ENOMEM;
+	ring->size = size;
+	ring->head = 0;
+	ring->tail = 0;
+	ring->format = format;
+	return EOK;
+}
+
+/**
+ * Release audio ring buffer storage.
+ * @param ring The ring to clean.
+ */
+void audio_ring_fini(audio_ring_t *ring)
+{
+	assert(ring);
+	free(ring->buffer);
+	ring->buffer = NULL;
+	ring->size = 0;
+}
+
+/**
+ * Get contiguous free space at the write position (producer side).
+ * @param ring The target ring.
+ * @param region Place to store pointer to the free space.
+ * @return Size of the contiguous free space.
+ *
+ * Data written to the region becomes visible after audio_ring_produce().
+ */
+size_t audio_ring_write_region(audio_ring_t *ring, void **region)
+{
+	assert(ring);
+	assert(region);
+	const size_t pos = ring->head % ring->size;
+	*region = ring->buffer + pos;
+	return min(audio_ring_space(ring), ring->size - pos);
+}
+
+/**
+ * Publish data written to the ring (producer side).
+ * @param ring The target ring.
+ * @param size Number of bytes written.
+ */
+void audio_ring_produce(audio_ring_t *ring, size_t size)
+{
+	assert(ring);
+	assert(size <= audio_ring_space(ring));
+	/* Make the data visible before the new head */
+	write_barrier();
+	ring->head += size;
+}
+
+/**
+ * Copy data to the ring (producer side).
+ * @param ring The target ring.
+ * @param data Source data.
+ * @param size Size of the source data.
+ * @return Number of bytes written, limited by the free space.
+ */
+size_t audio_ring_write(audio_ring_t *ring, const void *data, size_t size)
+{
+	assert(ring);
+	size_t written = 0;
+	while (written < size) {
+		void *region;
+		const size_t n =
+		    min(audio_ring_write_region(ring, &region), size - written);
+		if (n == 0)
+			break;
+		memcpy(region, data + written, n);
+		audio_ring_produce(ring, n);
+		written += n;
+	}
+	return written;
+}
+
+/**
+ * Mix data stored in the ring into the provided buffer (consumer side).
+ * @param ring The ring that should provide data.
+ * @param data Target buffer.
+ * @param size Target buffer size.
+ * @param f Target data format.
+ * @return Size of the target buffer used.
+ *
+ * Data is converted and mixed straight from the ring storage.
+ */
+size_t audio_ring_mix_data(audio_ring_t *ring, void *data, size_t size,
+    const pcm_format_t *f)
+{
+	assert(ring);
+
+	const size_t dst_frame_size = pcm_format_frame_size(f);
+	const size_t src_frame_size = pcm_format_frame_size(&ring->format);
+	size_t needed_frames = pcm_format_size_to_frames(size, f);
+	size_t copied_size = 0;
+
+	/* Read the head before the data it covers */
+	size_t available_frames = audio_ring_frames(ring);
+	read_barrier();
+
+	while (needed_frames > 0 && available_frames > 0) {
+		const size_t pos = ring->tail % ring->size;
+		const size_t contiguous_frames = (ring->size - pos) / src_frame_size;
+		const size_t copy_frames = min(min(available_frames,
+		    needed_frames), contiguous_frames);
+		const size_t dst_copy_size = copy_frames * dst_frame_size;
+		const size_t src_copy_size = copy_frames * src_frame_size;
+
+		pcm_format_convert_and_mix(data, dst_copy_size,
+		    ring->buffer + pos, src_copy_size, &ring->format, f);
+
+		needed_frames -= copy_frames;
+		available_frames -= copy_frames;
+		copied_size += dst_copy_size;
+		data += dst_copy_size;
+
+		/* Finish reading the data before releasing it */
+		memory_barrier();
+		ring->tail += src_copy_size;
+	}
+	return copied_size;
+}
+
+/**
+ * Convert sample rate of the ring data and mix it into the provided buffer.
+ * @param ring The ring that should provide data.
+ * @param resampler Converter from the ring format to the target format.
+ * @param data Target buffer.
+ * @param size Target buffer size.
+ * @param f Target data format.
+ * @return Size of the target buffer used.
+ *
+ * The converter keeps the last few source frames, so the ring needs to be
+ * consumed through the same converter until the target format changes.
+ */
+size_t audio_ring_resample_data(audio_ring_t *ring,
+    pcm_resampler_t *resampler, void *data, size_t size,
+    const pcm_format_t *f)
+{
+	assert(ring);
+	assert(resampler);
+
+	const size_t dst_frame_size = pcm_format_frame_size(f);
+	const size_t src_frame_size = pcm_format_frame_size(&ring->format);
+	size -= size % dst_frame_size;
+	size_t copied_size = 0;
+
+	/* Read the head before the data it covers */
+	size_t available = audio_ring_frames(ring) * src_frame_size;
+	read_barrier();
+
+	while (copied_size < size) {
+		const size_t pos = ring->tail % ring->size;
+		const size_t src_size = min(available, ring->size - pos);
+		size_t used = 0;
+
+		const size_t mixed = pcm_resampler_mix(resampler, data,
+		    size - copied_size, ring->buffer + pos, src_size, &used);
+		if (mixed == 0 && used == 0)
+			break;
+
+		available -= used;
+		copied_size += mixed;
+		data += mixed;
+
+		/* Finish reading the data before releasing it */
+		memory_barrier();
+		ring->tail += used;
+	}
+	return copied_size;
+}
+
 /**
  * @}
  */
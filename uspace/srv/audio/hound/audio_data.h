@@ -40,7 +40,9 @@
 #include <atomic.h>
 #include <errno.h>
 #include <fibril_synch.h>
+#include <stdint.h>
 #include <pcm/format.h>
+#include <pcm/resample.h>
 
 /** Reference counted audio buffer */
 typedef struct {
@@ -54,6 +56,25 @@ typedef struct {
 	atomic_t refcount;
 } audio_data_t;
 
+/** Single producer, single consumer audio ring buffer
+ *
+ * The producer only advances head, the consumer only advances tail,
+ * so data can be passed without taking a lock. The capacity is a
+ * multiple of the frame size so that frames never wrap around.
+ */
+typedef struct {
+	/** Ring storage */
+	uint8_t *buffer;
+	/** Ring capacity */
+	size_t size;
+	/** Total number of bytes produced */
+	volatile size_t head;
+	/** Total number of bytes consumed */
+	volatile size_t tail;
+	/** Format of the audio data */
+	pcm_format_t format;
+} audio_ring_t;
+
 /** Audio data pipe structure */
 typedef struct {
 	/** List of audio data buffers */
@@ -80,6 +101,50 @@ audio_data_t *audio_pipe_pop(audio_pipe_t *pipe);
 size_t audio_pipe_mix_data(audio_pipe_t *pipe, void *buffer, size_t size,
     const pcm_format_t *f);
 
+errno_t audio_ring_init(audio_ring_t *ring, size_t size, pcm_format_t format);
+void audio_ring_fini(audio_ring_t *ring);
+size_t audio_ring_write_region(audio_ring_t *ring, void **region);
+void audio_ring_produce(audio_ring_t *ring, size_t size);
+size_t audio_ring_write(audio_ring_t *ring, const void *data, size_t size);
+size_t audio_ring_mix_data(audio_ring_t *ring, void *buffer, size_t size,
+    const pcm_format_t *f);
+size_t audio_ring_resample_data(audio_ring_t *ring,
+    pcm_resampler_t *resampler, void *buffer, size_t size,
+    const pcm_format_t *f);
+
+/**
+ * Ring buffer used size getter.
+ * @param ring The audio ring.
+ * @return Number of bytes stored in the ring.
+ */
+static inline size_t audio_ring_bytes(audio_ring_t *ring)
+{
+	assert(ring);
+	return ring->head - ring->tail;
+}
+
+/**
+ * Ring buffer free space getter.
+ * @param ring The audio ring.
+ * @return Number of bytes that can be written to the ring.
+ */
+static inline size_t audio_ring_space(audio_ring_t *ring)
+{
+	assert(ring);
+	return ring->size - audio_ring_bytes(ring);
+}
+
+/**
+ * Ring buffer frames getter.
+ * @param ring The audio ring.
+ * @return Number of complete frames stored in the ring.
+ */
+static inline size_t audio_ring_frames(audio_ring_t *ring)
+{
+	assert(ring);
+	return audio_ring_bytes(ring) / pcm_format_frame_size(&ring->format);
+}
+
 /**
  * Total bytes getter.
  * @param pipe The audio pipe.
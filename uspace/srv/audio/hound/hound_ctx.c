@@ -45,8 +45,13 @@
 #include "log.h"
 
 static errno_t update_data(audio_source_t *source, size_t size);
+static errno_t mix_data(audio_source_t *source, void *data, size_t size,
+    const pcm_format_t *f);
 static errno_t new_data(audio_sink_t *sink);
 
+/** Stream buffer size used if the client does not limit it */
+#define STREAM_DEFAULT_BUFFER_SIZE  (64 * 1024)
+
 /**
  * Allocate and initialize hound context structure.
  * @param name String identifier.
@@ -105,6 +110,7 @@ hound_ctx_t *hound_playback_ctx_get(const char *name)
 			free(ctx);
 			return NULL;
 		}
+		ctx->source->mix_data = mix_data;
 	}
 	return ctx;
 }
@@ -158,8 +164,8 @@ bool hound_ctx_is_record(hound_ctx_t *ctx)
 typedef struct hound_ctx_stream {
 	/** Hound context streams link */
 	link_t link;
-	/** Audio data pipe */
-	audio_pipe_t fifo;
+	/** Audio data ring (client is the producer for playback streams) */
+	audio_ring_t ring;
 	/** Parent context */
 	hound_ctx_t *ctx;
 	/** Stream data format */
@@ -168,7 +174,11 @@ typedef struct hound_ctx_stream {
 	int flags;
 	/** Maximum allowed buffer size */
 	size_t allowed_size;
-	/** Fifo access synchronization */
+	/** Sample rate converter to the mixing format, NULL if not needed */
+	pcm_resampler_t *resampler;
+	/** Format the sample rate converter produces */
+	pcm_format_t resample_format;
+	/** Used only to wait for the ring status change */
 	fibril_mutex_t guard;
 	/** buffer status change condition */
 	fibril_condvar_t change;
@@ -207,19 +217,15 @@ static errno_t stream_push_data(hound_ctx_stream_t *stream, audio_data_t *adata)
 		return EINVAL;
 
 	fibril_mutex_lock(&stream->guard);
-	if (stream->allowed_size &&
-	    (audio_pipe_bytes(&stream->fifo) + adata->size >
-	    stream->allowed_size)) {
+	if (adata->size > audio_ring_space(&stream->ring)) {
 		fibril_mutex_unlock(&stream->guard);
 		return EOVERFLOW;
-
 	}
 
-	const errno_t ret = audio_pipe_push(&stream->fifo, adata);
+	audio_ring_write(&stream->ring, adata->data, adata->size);
+	fibril_condvar_signal(&stream->change);
 	fibril_mutex_unlock(&stream->guard);
-	if (ret == EOK)
-		fibril_condvar_signal(&stream->change);
-	return ret;
+	return EOK;
 }
 
 /**
@@ -250,7 +256,13 @@ hound_ctx_stream_t *hound_ctx_create_stream(hound_ctx_t *ctx, int flags,
 	assert(ctx);
 	hound_ctx_stream_t *stream = malloc(sizeof(hound_ctx_stream_t));
 	if (stream) {
-		audio_pipe_init(&stream->fifo);
+		const errno_t ret = audio_ring_init(&stream->ring,
+		    buffer_size ? buffer_size : STREAM_DEFAULT_BUFFER_SIZE,
+		    format);
+		if (ret != EOK) {
+			free(stream);
+			return NULL;
+		}
 		link_initialize(&stream->link);
 		fibril_mutex_initialize(&stream->guard);
 		fibril_condvar_initialize(&stream->change);
@@ -258,6 +270,8 @@ hound_ctx_stream_t *hound_ctx_create_stream(hound_ctx_t *ctx, int flags,
 		stream->flags = flags;
 		stream->format = format;
 		stream->allowed_size = buffer_size;
+		stream->resampler = NULL;
+		stream->resample_format = AUDIO_FORMAT_ANY;
 		stream_append(ctx, stream);
 		log_verbose("CTX: %p added stream; flags:%#x ch: %u r:%u f:%s",
 		    ctx, flags, format.channels, format.sampling_rate,
@@ -276,15 +290,16 @@ void hound_ctx_destroy_stream(hound_ctx_stream_t *stream)
 {
 	if (stream) {
 		stream_remove(stream->ctx, stream);
-		if (audio_pipe_bytes(&stream->fifo))
+		if (audio_ring_bytes(&stream->ring))
 			log_warning("Destroying stream with non empty buffer");
 		log_verbose("CTX: %p remove stream (%zu/%zu); "
 		    "flags:%#x ch: %u r:%u f:%s",
-		    stream->ctx, audio_pipe_bytes(&stream->fifo),
+		    stream->ctx, audio_ring_bytes(&stream->ring),
 		    stream->allowed_size, stream->flags,
 		    stream->format.channels, stream->format.sampling_rate,
 		    pcm_sample_format_str(stream->format.sample_format));
-		audio_pipe_fini(&stream->fifo);
+		pcm_resampler_destroy(stream->resampler);
+		audio_ring_fini(&stream->ring);
 		free(stream);
 	}
 }
@@ -292,7 +307,7 @@ void hound_ctx_destroy_stream(hound_ctx_stream_t *stream)
 /**
  * Write new data to a stream.
  * @param stream The destination stream.
- * @param data audio data buffer.
+ * @param data audio data buffer. The memory passed will be freed.
  * @param size size of the @p data buffer.
  * @return Error code.
  */
@@ -301,22 +316,66 @@ errno_t hound_ctx_stream_write(hound_ctx_stream_t *stream, void *data,
 {
 	assert(stream);
 
-	if (stream->allowed_size && size > stream->allowed_size)
+	if (stream->allowed_size && size > stream->allowed_size) {
+		free(data);
 		return EINVAL;
+	}
 
+	size_t written = 0;
 	fibril_mutex_lock(&stream->guard);
-	while (stream->allowed_size &&
-	    (audio_pipe_bytes(&stream->fifo) + size > stream->allowed_size)) {
-		fibril_condvar_wait(&stream->change, &stream->guard);
-
+	while (written < size) {
+		while (audio_ring_space(&stream->ring) == 0)
+			fibril_condvar_wait(&stream->change, &stream->guard);
+		written += audio_ring_write(&stream->ring, data + written,
+		    size - written);
 	}
+	fibril_mutex_unlock(&stream->guard);
+	free(data);
+	return EOK;
+}
+
+/**
+ * Get stream buffer space to receive new data into.
+ * @param stream The destination stream.
+ * @param size Size of the new data.
+ * @param buffer Place to store pointer to the space.
+ * @return Error code.
+ *
+ * Blocks until there is enough free space. Fails with ELIMIT if the
+ * free space would not be contiguous, the data then need to be written
+ * by hound_ctx_stream_write().
+ */
+errno_t hound_ctx_stream_reserve(hound_ctx_stream_t *stream, size_t size,
+    void **buffer)
+{
+	assert(stream);
+	assert(buffer);
+
+	if (size > stream->ring.size)
+		return ELIMIT;
 
-	const errno_t ret =
-	    audio_pipe_push_data(&stream->fifo, data, size, stream->format);
+	fibril_mutex_lock(&stream->guard);
+	while (audio_ring_space(&stream->ring) < size)
+		fibril_condvar_wait(&stream->change, &stream->guard);
 	fibril_mutex_unlock(&stream->guard);
-	if (ret == EOK)
-		fibril_condvar_signal(&stream->change);
-	return ret;
+
+	/* Only this fibril produces data, the space cannot shrink */
+	if (audio_ring_write_region(&stream->ring, buffer) < size)
+		return ELIMIT;
+	return EOK;
+}
+
+/**
+ * Make data received into the reserved space available.
+ * @param stream The destination stream.
+ * @param size Size of the new data.
+ * @return Error code.
+ */
+errno_t hound_ctx_stream_commit(hound_ctx_stream_t *stream, size_t size)
+{
+	assert(stream);
+	audio_ring_produce(&stream->ring, size);
+	return EOK;
 }
 
 /**
@@ -333,22 +392,71 @@ errno_t hound_ctx_stream_read(hound_ctx_stream_t *stream, void *data, size_t siz
 	if (stream->allowed_size && size > stream->allowed_size)
 		return EINVAL;
 
+	if (size > stream->ring.size)
+		return EINVAL;
+
 	fibril_mutex_lock(&stream->guard);
-	while (audio_pipe_bytes(&stream->fifo) < size) {
+	while (audio_ring_bytes(&stream->ring) < size) {
 		fibril_condvar_wait(&stream->change, &stream->guard);
 	}
+	fibril_mutex_unlock(&stream->guard);
 
 	pcm_format_silence(data, size, &stream->format);
 	const size_t ret =
-	    audio_pipe_mix_data(&stream->fifo, data, size, &stream->format);
-	fibril_mutex_unlock(&stream->guard);
+	    audio_ring_mix_data(&stream->ring, data, size, &stream->format);
 	if (ret > 0) {
+		fibril_mutex_lock(&stream->guard);
 		fibril_condvar_signal(&stream->change);
+		fibril_mutex_unlock(&stream->guard);
 		return EOK;
 	}
 	return EEMPTY;
 }
 
+/**
+ * Get sample rate converter for mixing stream data.
+ * @param stream The source stream.
+ * @param f Destination data format.
+ * @return Converter to @p f, NULL if the sampling rates match or the
+ * conversion is not supported.
+ *
+ * The converter is created on first use and recreated if the destination
+ * format changes. The quality is selected by the stream flags.
+ */
+static pcm_resampler_t *stream_resampler(hound_ctx_stream_t *stream,
+    const pcm_format_t *f)
+{
+	if (stream->format.sampling_rate == f->sampling_rate ||
+	    stream->format.channels != f->channels)
+		return NULL;
+
+	if (stream->resampler && pcm_format_same(&stream->resample_format, f))
+		return stream->resampler;
+
+	pcm_resampler_destroy(stream->resampler);
+	stream->resampler = NULL;
+
+	pcm_resample_quality_t quality = PCM_RESAMPLE_MEDIUM;
+	if (stream->flags & HOUND_STREAM_RESAMPLE_LINEAR)
+		quality = PCM_RESAMPLE_LINEAR;
+	if (stream->flags & HOUND_STREAM_RESAMPLE_HIGH)
+		quality = PCM_RESAMPLE_HIGH;
+
+	const errno_t ret = pcm_resampler_create(&stream->format, f, quality,
+	    &stream->resampler);
+	if (ret != EOK) {
+		log_warning("Failed to create resampler %uHz -> %uHz: %s",
+		    stream->format.sampling_rate, f->sampling_rate,
+		    str_error(ret));
+		stream->resampler = NULL;
+		return NULL;
+	}
+	stream->resample_format = *f;
+	log_verbose("Resampling stream %uHz -> %uHz",
+	    stream->format.sampling_rate, f->sampling_rate);
+	return stream->resampler;
+}
+
 /**
  * Add (mix) stream data to the destination buffer.
  * @param stream The source stream.
@@ -361,8 +469,12 @@ size_t hound_ctx_stream_add_self(hound_ctx_stream_t *stream, void *data,
     size_t size, const pcm_format_t *f)
 {
 	assert(stream);
+	pcm_resampler_t *resampler = stream_resampler(stream, f);
+	const size_t ret = resampler ?
+	    audio_ring_resample_data(&stream->ring, resampler, data, size, f) :
+	    audio_ring_mix_data(&stream->ring, data, size, f);
+	/* The lock only orders the wake up with the waiters' checks */
 	fibril_mutex_lock(&stream->guard);
-	const size_t ret = audio_pipe_mix_data(&stream->fifo, data, size, f);
 	fibril_condvar_signal(&stream->change);
 	fibril_mutex_unlock(&stream->guard);
 	return ret;
@@ -377,7 +489,7 @@ void hound_ctx_stream_drain(hound_ctx_stream_t *stream)
 	assert(stream);
 	log_debug("Draining stream");
 	fibril_mutex_lock(&stream->guard);
-	while (audio_pipe_bytes(&stream->fifo))
+	while (audio_ring_bytes(&stream->ring))
 		fibril_condvar_wait(&stream->change, &stream->guard);
 	fibril_mutex_unlock(&stream->guard);
 }
@@ -424,6 +536,34 @@ errno_t update_data(audio_source_t *source, size_t size)
 	return EOK;
 }
 
+/**
+ * Mix context data straight into a destination buffer.
+ * @param source Source abstraction.
+ * @param data Destination audio buffer.
+ * @param size Size of the @p data buffer.
+ * @param f Destination data format.
+ * @return error code.
+ *
+ * Used when the context has a single connection, so the streams are
+ * mixed directly into the device buffer without an intermediate copy.
+ */
+errno_t mix_data(audio_source_t *source, void *data, size_t size,
+    const pcm_format_t *f)
+{
+	assert(source);
+	assert(source->private_data);
+	hound_ctx_t *ctx = source->private_data;
+	fibril_mutex_lock(&ctx->guard);
+	list_foreach(ctx->streams, link, hound_ctx_stream_t, stream) {
+		const size_t copied =
+		    hound_ctx_stream_add_self(stream, data, size, f);
+		if (copied != size)
+			log_warning("Not enough data in stream buffer");
+	}
+	fibril_mutex_unlock(&ctx->guard);
+	return EOK;
+}
+
 errno_t new_data(audio_sink_t *sink)
 {
 	assert(sink);
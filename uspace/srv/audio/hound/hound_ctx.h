@@ -73,6 +73,9 @@ void hound_ctx_destroy_stream(hound_ctx_stream_t *stream);
 
 errno_t hound_ctx_stream_write(hound_ctx_stream_t *stream, void *buffer,
     size_t size);
+errno_t hound_ctx_stream_reserve(hound_ctx_stream_t *stream, size_t size,
+    void **buffer);
+errno_t hound_ctx_stream_commit(hound_ctx_stream_t *stream, size_t size);
 errno_t hound_ctx_stream_read(hound_ctx_stream_t *stream, void *buffer, size_t size);
 size_t hound_ctx_stream_add_self(hound_ctx_stream_t *stream, void *data,
     size_t size, const pcm_format_t *f);
@@ -151,6 +151,17 @@ static errno_t iface_stream_data_write(void *stream, void *buffer, size_t size)
 	return hound_ctx_stream_write(stream, buffer, size);
 }
 
+static errno_t iface_stream_data_reserve(void *stream, size_t size,
+    void **buffer)
+{
+	return hound_ctx_stream_reserve(stream, size, buffer);
+}
+
+static errno_t iface_stream_data_commit(void *stream, size_t size)
+{
+	return hound_ctx_stream_commit(stream, size);
+}
+
 hound_server_iface_t hound_iface = {
 	.add_context = iface_add_context,
 	.rem_context = iface_rem_context,
@@ -162,6 +173,8 @@ hound_server_iface_t hound_iface = {
 	.rem_stream = iface_rem_stream,
 	.drain_stream = iface_drain_stream,
 	.stream_data_write = iface_stream_data_write,
+	.stream_data_reserve = iface_stream_data_reserve,
+	.stream_data_commit = iface_stream_data_commit,
 	.stream_data_read = iface_stream_data_read,
 	.server = NULL,
 };
@@ -36,14 +36,24 @@
  *
  * Allows accessing a file as a block device. Useful for, e.g., mounting
  * a disk image.
+ *
+ * Requests are queued sorted by block address. Adjacent requests in the same
+ * direction are merged and several transfers are kept in flight against the
+ * backing file using asynchronous file I/O. Optionally, recently used blocks
+ * are kept in a write-through cache.
  */
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <adt/hash_table.h>
+#include <adt/list.h>
 #include <async.h>
 #include <as.h>
 #include <bd_srv.h>
+#include <fibril.h>
 #include <fibril_synch.h>
 #include <loc.h>
+#include <mem.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <errno.h>
@@ -52,18 +62,85 @@
 #include <task.h>
 #include <macros.h>
 #include <str.h>
+#include <vfs/aio.h>
+#include <vfs/vfs.h>
 
 #define NAME "file_bd"
 
 #define DEFAULT_BLOCK_SIZE 512
 
+/** Maximum number of transfers in flight against the backing file */
+#define FILE_BD_DEPTH 8
+
+/** Maximum size of a transfer merged from adjacent requests */
+#define FILE_BD_MERGE_MAX (128 * 1024)
+
+/** Block request */
+typedef struct {
+	/** Link to pending or to file_bd_xfer_t.reqs */
+	link_t lreqs;
+	bool write;
+	/** Address of the first block */
+	aoff64_t ba;
+	/** Number of blocks */
+	size_t cnt;
+	/** Client data buffer */
+	void *buf;
+	errno_t rc;
+	bool done;
+} file_bd_req_t;
+
+/** Transfer to or from the backing file */
+typedef struct {
+	/** Merged requests sorted by block address */
+	list_t reqs; /* of file_bd_req_t */
+	bool write;
+	/** Address of the first block */
+	aoff64_t ba;
+	/** Number of blocks */
+	size_t cnt;
+	/** Data buffer */
+	void *buf;
+	/** @c buf was allocated because more than one request is merged */
+	bool own_buf;
+} file_bd_xfer_t;
+
+/** Cached block */
+typedef struct {
+	/** Link to cache */
+	ht_link_t lcache;
+	/** Link to cache_lru */
+	link_t llru;
+	/** Block address */
+	aoff64_t ba;
+	/** Block data */
+	uint8_t data[];
+} file_bd_cblock_t;
+
 static size_t block_size;
 static aoff64_t num_blocks;
-static FILE *img;
+static int img_fd;
+static vfs_aio_t *img_aio;
 
 static service_id_t service_id;
 static bd_srvs_t bd_srvs;
+
+/** Protects the request queue and the block cache */
 static fibril_mutex_t dev_lock;
+/** Signalled when requests complete */
+static fibril_condvar_t done_cv;
+/** Signalled when a transfer is submitted */
+static fibril_condvar_t submit_cv;
+/** Requests not yet submitted, sorted by block address */
+static list_t pending; /* of file_bd_req_t */
+/** Number of transfers in flight */
+static size_t inflight;
+
+/** Maximum number of cached blocks, zero disables the cache */
+static size_t cache_size;
+static hash_table_t cache;
+/** Cached blocks, most recently used first */
+static list_t cache_lru; /* of file_bd_cblock_t */
 
 static void print_usage(void);
 static errno_t file_bd_init(const char *fname);
@@ -85,6 +162,49 @@ static bd_ops_t file_bd_ops = {
 	.get_num_blocks = file_bd_get_num_blocks
 };
 
+static size_t cache_key_hash(void *key)
+{
+	aoff64_t ba = *(aoff64_t *) key;
+	return (size_t) (ba ^ (ba >> 32));
+}
+
+static size_t cache_hash(const ht_link_t *item)
+{
+	file_bd_cblock_t *cb = hash_table_get_inst(item, file_bd_cblock_t,
+	    lcache);
+	return cache_key_hash(&cb->ba);
+}
+
+static bool cache_key_equal(void *key, const ht_link_t *item)
+{
+	file_bd_cblock_t *cb = hash_table_get_inst(item, file_bd_cblock_t,
+	    lcache);
+	return cb->ba == *(aoff64_t *) key;
+}
+
+static bool cache_equal(const ht_link_t *item1, const ht_link_t *item2)
+{
+	file_bd_cblock_t *cb = hash_table_get_inst(item1, file_bd_cblock_t,
+	    lcache);
+	return cache_key_equal(&cb->ba, item2);
+}
+
+static void cache_remove_callback(ht_link_t *item)
+{
+	file_bd_cblock_t *cb = hash_table_get_inst(item, file_bd_cblock_t,
+	    lcache);
+	list_remove(&cb->llru);
+	free(cb);
+}
+
+static hash_table_ops_t cache_ops = {
+	.hash = cache_hash,
+	.key_hash = cache_key_hash,
+	.key_equal = cache_key_equal,
+	.equal = cache_equal,
+	.remove_callback = cache_remove_callback
+};
+
 int main(int argc, char **argv)
 {
 	errno_t rc;
@@ -95,6 +215,7 @@ int main(int argc, char **argv)
 	printf(NAME ": File-backed block device driver\n");
 
 	block_size = DEFAULT_BLOCK_SIZE;
+	cache_size = 0;
 
 	++argv;
 	--argc;
@@ -115,6 +236,21 @@ int main(int argc, char **argv)
 			}
 			++argv;
 			--argc;
+		} else if (str_cmp(*argv, "-c") == 0) {
+			if (argc < 2) {
+				printf("Argument missing.\n");
+				print_usage();
+				return -1;
+			}
+
+			rc = str_size_t(argv[1], NULL, 10, true, &cache_size);
+			if (rc != EOK) {
+				printf("Invalid cache size '%s'.\n", argv[1]);
+				print_usage();
+				return -1;
+			}
+			++argv;
+			--argc;
 		} else {
 			printf("Invalid option '%s'.\n", *argv);
 			print_usage();
@@ -166,40 +302,390 @@ int main(int argc, char **argv)
 
 static void print_usage(void)
 {
-	printf("Usage: " NAME " [-b <block_size>] <image_file> <device_name>\n");
+	printf("Usage: " NAME " [-b <block_size>] [-c <cached_blocks>] "
+	    "<image_file> <device_name>\n");
+}
+
+/** Look up a block in the cache, marking it as recently used. */
+static file_bd_cblock_t *file_bd_cache_find(aoff64_t ba)
+{
+	ht_link_t *link;
+	file_bd_cblock_t *cb;
+
+	if (cache_size == 0)
+		return NULL;
+
+	link = hash_table_find(&cache, &ba);
+	if (link == NULL)
+		return NULL;
+
+	cb = hash_table_get_inst(link, file_bd_cblock_t, lcache);
+	list_remove(&cb->llru);
+	list_prepend(&cb->llru, &cache_lru);
+	return cb;
+}
+
+/** Put blocks into the cache.
+ *
+ * @param ba		Address of the first block
+ * @param cnt		Number of blocks
+ * @param data		Block data
+ * @param update	Overwrite blocks which are already cached
+ */
+static void file_bd_cache_put(aoff64_t ba, size_t cnt, const uint8_t *data,
+    bool update)
+{
+	file_bd_cblock_t *cb;
+	link_t *link;
+	size_t i;
+
+	for (i = 0; i < cnt; i++) {
+		cb = file_bd_cache_find(ba + i);
+		if (cb != NULL) {
+			if (update)
+				memcpy(cb->data, data + i * block_size,
+				    block_size);
+			continue;
+		}
+
+		if (cache_size == 0)
+			return;
+
+		if (hash_table_size(&cache) >= cache_size) {
+			/* Evict the least recently used block */
+			link = list_last(&cache_lru);
+			cb = list_get_instance(link, file_bd_cblock_t, llru);
+			hash_table_remove_item(&cache, &cb->lcache);
+		}
+
+		cb = malloc(sizeof(file_bd_cblock_t) + block_size);
+		if (cb == NULL)
+			return;
+
+		cb->ba = ba + i;
+		memcpy(cb->data, data + i * block_size, block_size);
+		list_prepend(&cb->llru, &cache_lru);
+		hash_table_insert(&cache, &cb->lcache);
+	}
+}
+
+/** Drop blocks from the cache. */
+static void file_bd_cache_drop(aoff64_t ba, size_t cnt)
+{
+	size_t i;
+
+	if (cache_size == 0)
+		return;
+
+	for (i = 0; i < cnt; i++) {
+		aoff64_t key = ba + i;
+		(void) hash_table_remove(&cache, &key);
+	}
+}
+
+/** Read blocks from the cache if all of them are cached. */
+static bool file_bd_cache_read(aoff64_t ba, size_t cnt, uint8_t *buf)
+{
+	file_bd_cblock_t *cb;
+	aoff64_t key;
+	size_t i;
+
+	if (cache_size == 0)
+		return false;
+
+	for (i = 0; i < cnt; i++) {
+		key = ba + i;
+		if (hash_table_find(&cache, &key) == NULL)
+			return false;
+	}
+
+	for (i = 0; i < cnt; i++) {
+		cb = file_bd_cache_find(ba + i);
+		memcpy(buf + i * block_size, cb->data, block_size);
+	}
+
+	return true;
+}
+
+/** Finish a transfer.
+ *
+ * Must be called with dev_lock held.
+ *
+ * @param xfer	Transfer
+ * @param rc	Result of the transfer
+ */
+static void file_bd_xfer_done(file_bd_xfer_t *xfer, errno_t rc)
+{
+	file_bd_req_t *req;
+	uint8_t *bp;
+
+	if (xfer->write && rc != EOK) {
+		/* The cache must not keep data which is not in the file */
+		file_bd_cache_drop(xfer->ba, xfer->cnt);
+	}
+
+	if (!xfer->write && rc == EOK)
+		file_bd_cache_put(xfer->ba, xfer->cnt, xfer->buf, false);
+
+	bp = xfer->buf;
+	while (!list_empty(&xfer->reqs)) {
+		req = list_get_instance(list_first(&xfer->reqs), file_bd_req_t,
+		    lreqs);
+		list_remove(&req->lreqs);
+
+		if (!xfer->write && rc == EOK && xfer->own_buf)
+			memcpy(req->buf, bp, req->cnt * block_size);
+		bp += req->cnt * block_size;
+
+		req->rc = rc;
+		req->done = true;
+	}
+
+	fibril_condvar_broadcast(&done_cv);
+
+	if (xfer->own_buf)
+		free(xfer->buf);
+	free(xfer);
+}
+
+/** Submit pending requests while there is room for more transfers.
+ *
+ * Must be called with dev_lock held.
+ */
+static void file_bd_submit(void)
+{
+	file_bd_xfer_t *xfer;
+	file_bd_req_t *req;
+	file_bd_req_t *next;
+	vfs_aio_sqe_t sqe;
+	size_t max_cnt;
+	size_t nreqs;
+	link_t *link;
+	uint8_t *bp;
+	size_t cnt;
+
+	max_cnt = max(FILE_BD_MERGE_MAX / block_size, 1);
+
+	while (inflight < FILE_BD_DEPTH && !list_empty(&pending)) {
+		req = list_get_instance(list_first(&pending), file_bd_req_t,
+		    lreqs);
+
+		xfer = malloc(sizeof(file_bd_xfer_t));
+		if (xfer == NULL) {
+			list_remove(&req->lreqs);
+			req->rc = ENOMEM;
+			req->done = true;
+			fibril_condvar_broadcast(&done_cv);
+			continue;
+		}
+
+		list_initialize(&xfer->reqs);
+		xfer->write = req->write;
+		xfer->ba = req->ba;
+
+		/* Find adjacent requests which can be merged */
+		nreqs = 1;
+		cnt = req->cnt;
+		link = list_next(&req->lreqs, &pending);
+		while (link != NULL) {
+			next = list_get_instance(link, file_bd_req_t, lreqs);
+			if (next->write != req->write ||
+			    next->ba != req->ba + cnt ||
+			    cnt + next->cnt > max_cnt)
+				break;
+
+			cnt += next->cnt;
+			++nreqs;
+			link = list_next(link, &pending);
+		}
+
+		xfer->buf = req->buf;
+		xfer->own_buf = false;
+		if (nreqs > 1) {
+			xfer->buf = malloc(cnt * block_size);
+			if (xfer->buf != NULL) {
+				xfer->own_buf = true;
+			} else {
+				/* Transfer the first request alone */
+				xfer->buf = req->buf;
+				nreqs = 1;
+				cnt = req->cnt;
+			}
+		}
+
+		xfer->cnt = cnt;
+
+		bp = xfer->buf;
+		while (nreqs-- > 0) {
+			next = list_get_instance(list_first(&pending),
+			    file_bd_req_t, lreqs);
+			list_remove(&next->lreqs);
+			list_append(&next->lreqs, &xfer->reqs);
+
+			if (next->write && xfer->own_buf)
+				memcpy(bp, next->buf, next->cnt * block_size);
+			bp += next->cnt * block_size;
+		}
+
+		if (xfer->write)
+			file_bd_cache_put(xfer->ba, xfer->cnt, xfer->buf, true);
+
+		sqe.op = xfer->write ? VFS_AIO_WRITE : VFS_AIO_READ;
+		sqe.file = img_fd;
+		sqe.pos = xfer->ba * block_size;
+		sqe.buf = xfer->buf;
+		sqe.size = xfer->cnt * block_size;
+		sqe.arg = xfer;
+
+		if (vfs_aio_submit(img_aio, &sqe, 1) != 1) {
+			file_bd_xfer_done(xfer, ENOMEM);
+			continue;
+		}
+
+		++inflight;
+		fibril_condvar_signal(&submit_cv);
+	}
+}
+
+/** Collect completed transfers and submit further requests. */
+static errno_t file_bd_reaper_fibril(void *arg)
+{
+	vfs_aio_cqe_t cqe[FILE_BD_DEPTH];
+	file_bd_xfer_t *xfer;
+	size_t n;
+	size_t i;
+	errno_t rc;
+
+	while (true) {
+		fibril_mutex_lock(&dev_lock);
+		while (inflight == 0)
+			fibril_condvar_wait(&submit_cv, &dev_lock);
+		fibril_mutex_unlock(&dev_lock);
+
+		rc = vfs_aio_wait(img_aio, cqe, FILE_BD_DEPTH, &n);
+		if (rc != EOK)
+			continue;
+
+		fibril_mutex_lock(&dev_lock);
+
+		for (i = 0; i < n; i++) {
+			xfer = (file_bd_xfer_t *) cqe[i].arg;
+			rc = cqe[i].rc;
+			if (rc == EOK && cqe[i].nbytes < xfer->cnt * block_size)
+				rc = EIO;
+
+			file_bd_xfer_done(xfer, rc);
+			--inflight;
+		}
+
+		file_bd_submit();
+		fibril_mutex_unlock(&dev_lock);
+	}
+
+	return EOK;
+}
+
+/** Transfer blocks through the request queue.
+ *
+ * @param write		@c true to write, @c false to read
+ * @param ba		Address of the first block
+ * @param cnt		Number of blocks
+ * @param buf		Data buffer
+ *
+ * @return EOK on success or an error code
+ */
+static errno_t file_bd_xfer(bool write, aoff64_t ba, size_t cnt, void *buf)
+{
+	file_bd_req_t req;
+
+	fibril_mutex_lock(&dev_lock);
+
+	if (!write && file_bd_cache_read(ba, cnt, buf)) {
+		fibril_mutex_unlock(&dev_lock);
+		return EOK;
+	}
+
+	link_initialize(&req.lreqs);
+	req.write = write;
+	req.ba = ba;
+	req.cnt = cnt;
+	req.buf = buf;
+	req.rc = EOK;
+	req.done = false;
+
+	list_foreach(pending, lreqs, file_bd_req_t, r) {
+		if (ba < r->ba) {
+			list_insert_before(&req.lreqs, &r->lreqs);
+			goto queued;
+		}
+	}
+
+	list_append(&req.lreqs, &pending);
+queued:
+	file_bd_submit();
+
+	while (!req.done)
+		fibril_condvar_wait(&done_cv, &dev_lock);
+
+	fibril_mutex_unlock(&dev_lock);
+	return req.rc;
 }
 
 static errno_t file_bd_init(const char *fname)
 {
+	vfs_stat_t stat;
+	fid_t fid;
+	errno_t rc;
+
 	bd_srvs_init(&bd_srvs);
 	bd_srvs.ops = &file_bd_ops;
 
 	async_set_fallback_port_handler(file_bd_connection, NULL);
-	errno_t rc = loc_server_register(NAME);
+	rc = loc_server_register(NAME);
 	if (rc != EOK) {
 		printf("%s: Unable to register driver.\n", NAME);
 		return rc;
 	}
 
-	img = fopen(fname, "rb+");
-	if (img == NULL)
+	rc = vfs_lookup_open(fname, WALK_REGULAR, MODE_READ | MODE_WRITE,
+	    &img_fd);
+	if (rc != EOK)
 		return EINVAL;
 
-	if (fseek(img, 0, SEEK_END) != 0) {
-		fclose(img);
+	rc = vfs_stat(img_fd, &stat);
+	if (rc != EOK) {
+		vfs_put(img_fd);
 		return EIO;
 	}
 
-	off64_t img_size = ftell(img);
-	if (img_size < 0) {
-		fclose(img);
-		return EIO;
-	}
+	num_blocks = stat.size / block_size;
 
-	num_blocks = img_size / block_size;
+	rc = vfs_aio_create(FILE_BD_DEPTH, &img_aio);
+	if (rc != EOK) {
+		vfs_put(img_fd);
+		return rc;
+	}
 
 	fibril_mutex_initialize(&dev_lock);
+	fibril_condvar_initialize(&done_cv);
+	fibril_condvar_initialize(&submit_cv);
+	list_initialize(&pending);
+	list_initialize(&cache_lru);
+	inflight = 0;
+
+	if (cache_size > 0 && !hash_table_create(&cache, 0, 0, &cache_ops)) {
+		printf("%s: Unable to create block cache.\n", NAME);
+		cache_size = 0;
+	}
 
+	fid = fibril_create(file_bd_reaper_fibril, NULL);
+	if (fid == 0) {
+		vfs_aio_destroy(img_aio);
+		vfs_put(img_fd);
+		return ENOMEM;
+	}
+
+	fibril_add_ready(fid);
 	return EOK;
 }
 
@@ -224,8 +710,6 @@ static errno_t file_bd_close(bd_srv_t *bd)
 static errno_t file_bd_read_blocks(bd_srv_t *bd, uint64_t ba, size_t cnt, void *buf,
     size_t size)
 {
-	size_t n_rd;
-
 	if (size < cnt * block_size)
 		return EINVAL;
 
@@ -237,35 +721,16 @@ static errno_t file_bd_read_blocks(bd_srv_t *bd, uint64_t ba, size_t cnt, void *
 		return ELIMIT;
 	}
 
-	fibril_mutex_lock(&dev_lock);
-
-	clearerr(img);
-	if (fseek(img, ba * block_size, SEEK_SET) < 0) {
-		fibril_mutex_unlock(&dev_lock);
-		return EIO;
-	}
-
-	n_rd = fread(buf, block_size, cnt, img);
-
-	if (ferror(img)) {
-		fibril_mutex_unlock(&dev_lock);
-		return EIO;	/* Read error */
-	}
-
-	fibril_mutex_unlock(&dev_lock);
-
-	if (n_rd < cnt)
-		return EINVAL;	/* Read beyond end of device */
+	if (cnt == 0)
+		return EOK;
 
-	return EOK;
+	return file_bd_xfer(false, ba, cnt, buf);
 }
 
 /** Write blocks to the device. */
 static errno_t file_bd_write_blocks(bd_srv_t *bd, uint64_t ba, size_t cnt,
     const void *buf, size_t size)
 {
-	size_t n_wr;
-
 	if (size < cnt * block_size)
 		return EINVAL;
 
@@ -277,29 +742,10 @@ static errno_t file_bd_write_blocks(bd_srv_t *bd, uint64_t ba, size_t cnt,
 		return ELIMIT;
 	}
 
-	fibril_mutex_lock(&dev_lock);
-
-	clearerr(img);
-	if (fseek(img, ba * block_size, SEEK_SET) < 0) {
-		fibril_mutex_unlock(&dev_lock);
-		return EIO;
-	}
-
-	n_wr = fwrite(buf, block_size, cnt, img);
-
-	if (ferror(img) || n_wr < cnt) {
-		fibril_mutex_unlock(&dev_lock);
-		return EIO;	/* Write error */
-	}
+	if (cnt == 0)
+		return EOK;
 
-	if (fflush(img) != 0) {
-		fibril_mutex_unlock(&dev_lock);
-		return EIO;
-	}
-
-	fibril_mutex_unlock(&dev_lock);
-
-	return EOK;
+	return file_bd_xfer(true, ba, cnt, (void *) buf);
 }
 
 /** Get device block size. */
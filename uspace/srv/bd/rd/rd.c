@@ -72,6 +72,9 @@ static errno_t rd_read_blocks(bd_srv_t *, aoff64_t, size_t, void *, size_t);
 static errno_t rd_write_blocks(bd_srv_t *, aoff64_t, size_t, const void *, size_t);
 static errno_t rd_get_block_size(bd_srv_t *, size_t *);
 static errno_t rd_get_num_blocks(bd_srv_t *, aoff64_t *);
+static errno_t rd_map_blocks(bd_srv_t *, aoff64_t, size_t, bool, void **,
+    size_t *);
+static void rd_unmap_blocks(bd_srv_t *, bool);
 
 /** This rwlock protects the ramdisk's data.
  *
@@ -88,7 +91,9 @@ static bd_ops_t rd_bd_ops = {
 	.read_blocks = rd_read_blocks,
 	.write_blocks = rd_write_blocks,
 	.get_block_size = rd_get_block_size,
-	.get_num_blocks = rd_get_num_blocks
+	.get_num_blocks = rd_get_num_blocks,
+	.map_blocks = rd_map_blocks,
+	.unmap_blocks = rd_unmap_blocks
 };
 
 static bd_srvs_t bd_srvs;
@@ -142,6 +147,38 @@ static errno_t rd_write_blocks(bd_srv_t *bd, aoff64_t ba, size_t cnt,
 	return EOK;
 }
 
+/** Map blocks of the image for a direct transfer to or from the client.
+ *
+ * This saves copying the data through an intermediate buffer. The image
+ * stays locked until rd_unmap_blocks() is called.
+ */
+static errno_t rd_map_blocks(bd_srv_t *bd, aoff64_t ba, size_t cnt,
+    bool write, void **rbuf, size_t *rsize)
+{
+	if ((ba + cnt) * block_size > rd_size) {
+		/* Transfer past the end of the device. */
+		return ELIMIT;
+	}
+
+	if (write)
+		fibril_rwlock_write_lock(&rd_lock);
+	else
+		fibril_rwlock_read_lock(&rd_lock);
+
+	*rbuf = rd_addr + ba * block_size;
+	*rsize = cnt * block_size;
+	return EOK;
+}
+
+/** Unmap blocks mapped by rd_map_blocks(). */
+static void rd_unmap_blocks(bd_srv_t *bd, bool write)
+{
+	if (write)
+		fibril_rwlock_write_unlock(&rd_lock);
+	else
+		fibril_rwlock_read_unlock(&rd_lock);
+}
+
 /** Prepare the ramdisk image for operation. */
 static bool rd_init(void)
 {
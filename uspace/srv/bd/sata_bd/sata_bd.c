@@ -36,6 +36,7 @@
  *
  */
 
+#include <as.h>
 #include <stddef.h>
 #include <bd_srv.h>
 #include <devman.h>
@@ -45,6 +46,7 @@
 #include <str.h>
 #include <loc.h>
 #include <macros.h>
+#include <mem.h>
 #include <task.h>
 
 #include <ahci_iface.h>
@@ -63,6 +65,7 @@ static errno_t sata_bd_open(bd_srvs_t *, bd_srv_t *);
 static errno_t sata_bd_close(bd_srv_t *);
 static errno_t sata_bd_read_blocks(bd_srv_t *, aoff64_t, size_t, void *, size_t);
 static errno_t sata_bd_write_blocks(bd_srv_t *, aoff64_t, size_t, const void *, size_t);
+static errno_t sata_bd_discard_blocks(bd_srv_t *, const bd_extent_t *, size_t);
 static errno_t sata_bd_get_block_size(bd_srv_t *, size_t *);
 static errno_t sata_bd_get_num_blocks(bd_srv_t *, aoff64_t *);
 
@@ -71,6 +74,7 @@ static bd_ops_t sata_bd_ops = {
 	.close = sata_bd_close,
 	.read_blocks = sata_bd_read_blocks,
 	.write_blocks = sata_bd_write_blocks,
+	.discard_blocks = sata_bd_discard_blocks,
 	.get_block_size = sata_bd_get_block_size,
 	.get_num_blocks = sata_bd_get_num_blocks
 };
@@ -200,16 +204,45 @@ static errno_t sata_bd_close(bd_srv_t *bd)
 	return EOK;
 }
 
+/** Allocate transfer buffer to share with the AHCI driver.
+ *
+ * The whole address space area containing the buffer is shared, so the
+ * buffer must start at the beginning of its own area. The driver can
+ * then transfer the data to or from the area directly.
+ */
+static void *sata_bd_xfer_buf_alloc(size_t size)
+{
+	void *xbuf = as_area_create(AS_AREA_ANY, size,
+	    AS_AREA_READ | AS_AREA_WRITE | AS_AREA_CACHEABLE, AS_AREA_UNPAGED);
+	if (xbuf == AS_MAP_FAILED)
+		return NULL;
+
+	return xbuf;
+}
+
 /** Read blocks from partition. */
 static errno_t sata_bd_read_blocks(bd_srv_t *bd, aoff64_t ba, size_t cnt, void *buf,
     size_t size)
 {
 	sata_bd_dev_t *sbd = bd_srv_sata(bd);
+	size_t xsize = cnt * sbd->block_size;
 
-	if (size < cnt * sbd->block_size)
+	if (size < xsize)
 		return EINVAL;
 
-	return ahci_read_blocks(sbd->sess, ba, cnt, buf);
+	if (cnt == 0)
+		return EOK;
+
+	void *xbuf = sata_bd_xfer_buf_alloc(xsize);
+	if (xbuf == NULL)
+		return ENOMEM;
+
+	errno_t rc = ahci_read_blocks(sbd->sess, ba, cnt, xbuf);
+	if (rc == EOK)
+		memcpy(buf, xbuf, xsize);
+
+	as_area_destroy(xbuf);
+	return rc;
 }
 
 /** Write blocks to partition. */
@@ -217,11 +250,32 @@ static errno_t sata_bd_write_blocks(bd_srv_t *bd, aoff64_t ba, size_t cnt,
     const void *buf, size_t size)
 {
 	sata_bd_dev_t *sbd = bd_srv_sata(bd);
+	size_t xsize = cnt * sbd->block_size;
 
-	if (size < cnt * sbd->block_size)
+	if (size < xsize)
 		return EINVAL;
 
-	return ahci_write_blocks(sbd->sess, ba, cnt, (void *)buf);
+	if (cnt == 0)
+		return EOK;
+
+	void *xbuf = sata_bd_xfer_buf_alloc(xsize);
+	if (xbuf == NULL)
+		return ENOMEM;
+
+	memcpy(xbuf, buf, xsize);
+	errno_t rc = ahci_write_blocks(sbd->sess, ba, cnt, xbuf);
+
+	as_area_destroy(xbuf);
+	return rc;
+}
+
+/** Discard blocks of partition. */
+static errno_t sata_bd_discard_blocks(bd_srv_t *bd, const bd_extent_t *ext,
+    size_t cnt)
+{
+	sata_bd_dev_t *sbd = bd_srv_sata(bd);
+
+	return ahci_discard_blocks(sbd->sess, ext, cnt);
 }
 
 /** Get device block size. */
@@ -48,6 +48,7 @@
 #include <vbd.h>
 
 #include "disk.h"
+#include "ioq.h"
 #include "types/vbd.h"
 
 static fibril_mutex_t vbds_disks_lock;
@@ -66,6 +67,7 @@ static errno_t vbds_bd_read_blocks(bd_srv_t *, aoff64_t, size_t, void *, size_t)
 static errno_t vbds_bd_sync_cache(bd_srv_t *, aoff64_t, size_t);
 static errno_t vbds_bd_write_blocks(bd_srv_t *, aoff64_t, size_t, const void *,
     size_t);
+static errno_t vbds_bd_discard_blocks(bd_srv_t *, const bd_extent_t *, size_t);
 static errno_t vbds_bd_get_block_size(bd_srv_t *, size_t *);
 static errno_t vbds_bd_get_num_blocks(bd_srv_t *, aoff64_t *);
 
@@ -89,6 +91,7 @@ static bd_ops_t vbds_bd_ops = {
 	.read_blocks = vbds_bd_read_blocks,
 	.sync_cache = vbds_bd_sync_cache,
 	.write_blocks = vbds_bd_write_blocks,
+	.discard_blocks = vbds_bd_discard_blocks,
 	.get_block_size = vbds_bd_get_block_size,
 	.get_num_blocks = vbds_bd_get_num_blocks
 };
@@ -320,6 +323,7 @@ static errno_t vbds_part_add(vbds_disk_t *disk, label_part_t *lpart,
 	}
 
 	fibril_rwlock_initialize(&part->lock);
+	vbds_ioq_part_init(part);
 
 	part->lpart = lpart;
 	part->disk = disk;
@@ -488,6 +492,7 @@ errno_t vbds_disk_add(service_id_t sid)
 
 	/* Must be set before calling label_open */
 	disk->svc_id = sid;
+	vbds_ioq_init(&disk->ioq);
 
 	rc = loc_service_get_name(sid, &disk->svc_name);
 	if (rc != EOK) {
@@ -811,6 +816,23 @@ errno_t vbds_part_get_info(vbds_part_id_t partid, vbd_part_info_t *pinfo)
 	return EOK;
 }
 
+errno_t vbds_part_get_stats(vbds_part_id_t partid, vbd_part_stats_t *pstats)
+{
+	vbds_part_t *part;
+	errno_t rc;
+
+	rc = vbds_part_by_pid(partid, &part);
+	if (rc != EOK)
+		return rc;
+
+	fibril_rwlock_read_lock(&part->lock);
+	vbds_ioq_part_get_stats(part, pstats);
+	fibril_rwlock_read_unlock(&part->lock);
+	vbds_part_del_ref(part);
+
+	return EOK;
+}
+
 errno_t vbds_part_create(service_id_t sid, vbd_part_spec_t *pspec,
     vbds_part_id_t *rpart)
 {
@@ -988,7 +1010,7 @@ static errno_t vbds_bd_read_blocks(bd_srv_t *bd, aoff64_t ba, size_t cnt,
 		return ELIMIT;
 	}
 
-	rc = block_read_direct(part->disk->svc_id, gba, cnt, buf);
+	rc = vbds_ioq_xfer(part, false, gba, cnt, buf);
 	fibril_rwlock_read_unlock(&part->lock);
 
 	return rc;
@@ -1038,7 +1060,37 @@ static errno_t vbds_bd_write_blocks(bd_srv_t *bd, aoff64_t ba, size_t cnt,
 		return ELIMIT;
 	}
 
-	rc = block_write_direct(part->disk->svc_id, gba, cnt, buf);
+	rc = vbds_ioq_xfer(part, true, gba, cnt, (void *) buf);
+	fibril_rwlock_read_unlock(&part->lock);
+	return rc;
+}
+
+static errno_t vbds_bd_discard_blocks(bd_srv_t *bd, const bd_extent_t *ext,
+    size_t ext_cnt)
+{
+	vbds_part_t *part = bd_srv_part(bd);
+	aoff64_t gba;
+	size_t i;
+	errno_t rc;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG2, "vbds_bd_discard_blocks()");
+	fibril_rwlock_read_lock(&part->lock);
+
+	for (i = 0; i < ext_cnt; i++) {
+		if (vbds_bsa_translate(part, ext[i].ba, ext[i].cnt,
+		    &gba) != EOK) {
+			fibril_rwlock_read_unlock(&part->lock);
+			return ELIMIT;
+		}
+
+		rc = block_discard(part->disk->svc_id, gba, ext[i].cnt);
+		if (rc != EOK) {
+			fibril_rwlock_read_unlock(&part->lock);
+			return rc;
+		}
+	}
+
+	rc = block_discard_flush(part->disk->svc_id);
 	fibril_rwlock_read_unlock(&part->lock);
 	return rc;
 }
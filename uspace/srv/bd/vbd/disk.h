@@ -51,6 +51,7 @@ extern errno_t vbds_get_parts(service_id_t, service_id_t *, size_t, size_t *);
 extern errno_t vbds_label_create(service_id_t, label_type_t);
 extern errno_t vbds_label_delete(service_id_t);
 extern errno_t vbds_part_get_info(vbds_part_id_t, vbd_part_info_t *);
+extern errno_t vbds_part_get_stats(vbds_part_id_t, vbd_part_stats_t *);
 extern errno_t vbds_part_create(service_id_t, vbd_part_spec_t *, vbds_part_id_t *);
 extern errno_t vbds_part_delete(vbds_part_id_t);
 extern errno_t vbds_suggest_ptype(service_id_t, label_pcnt_t, label_ptype_t *);
@@ -0,0 +1,417 @@
+/*
+ * Copyright (c) 2018 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup vbd
+ * @{
+ */
+/**
+ * @file I/O scheduler
+ *
+ * Requests submitted to the partitions of a disk are queued and dispatched
+ * to the disk by the fibrils waiting for them. Each partition has its own
+ * queue, sorted by block address. Partitions with pending requests take
+ * turns, each dispatching up to a quantum of requests in ascending block
+ * order. Requests waiting longer than their deadline are dispatched first.
+ * Adjacent requests of one partition are merged into a single transfer.
+ */
+
+#include <adt/list.h>
+#include <block.h>
+#include <errno.h>
+#include <fibril_synch.h>
+#include <io/log.h>
+#include <macros.h>
+#include <mem.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include "ioq.h"
+#include "types/vbd.h"
+
+enum {
+	/** Maximum number of disk transfers in progress */
+	vbds_ioq_depth = 2,
+	/** Number of requests a partition dispatches in its turn */
+	vbds_ioq_quantum = 4,
+	/** Maximum size of a merged transfer in bytes */
+	vbds_ioq_merge_max = 128 * 1024
+};
+
+enum {
+	/** Read deadline in microseconds */
+	vbds_ioq_read_expire = 500 * 1000,
+	/** Write deadline in microseconds */
+	vbds_ioq_write_expire = 5000 * 1000
+};
+
+/** Initialize disk I/O queue.
+ *
+ * @param ioq I/O queue
+ */
+void vbds_ioq_init(vbds_ioq_t *ioq)
+{
+	fibril_mutex_initialize(&ioq->lock);
+	fibril_condvar_initialize(&ioq->cv);
+	list_initialize(&ioq->active);
+	list_initialize(&ioq->fifo);
+	ioq->inflight = 0;
+	ioq->quantum = vbds_ioq_quantum;
+}
+
+/** Initialize I/O queue state of a partition.
+ *
+ * @param part Partition
+ */
+void vbds_ioq_part_init(vbds_part_t *part)
+{
+	link_initialize(&part->lioq);
+	list_initialize(&part->ioq_reqs);
+	part->ioq_pos = 0;
+	memset(&part->stats, 0, sizeof(part->stats));
+}
+
+/** Insert request into the queues.
+ *
+ * @param ioq I/O queue
+ * @param req Request
+ */
+static void vbds_ioq_insert(vbds_ioq_t *ioq, vbds_ioq_req_t *req)
+{
+	vbds_part_t *part = req->part;
+
+	list_append(&req->lfifo, &ioq->fifo);
+
+	if (list_empty(&part->ioq_reqs))
+		list_append(&part->lioq, &ioq->active);
+
+	list_foreach(part->ioq_reqs, lpart, vbds_ioq_req_t, r) {
+		if (req->ba < r->ba) {
+			list_insert_before(&req->lpart, &r->lpart);
+			return;
+		}
+	}
+
+	list_append(&req->lpart, &part->ioq_reqs);
+}
+
+/** Remove request from the queues.
+ *
+ * @param ioq I/O queue
+ * @param req Request
+ */
+static void vbds_ioq_remove(vbds_ioq_t *ioq, vbds_ioq_req_t *req)
+{
+	vbds_part_t *part = req->part;
+
+	list_remove(&req->lfifo);
+	list_remove(&req->lpart);
+
+	if (list_empty(&part->ioq_reqs)) {
+		/* The partition's turn is over */
+		if (list_first(&ioq->active) == &part->lioq)
+			ioq->quantum = vbds_ioq_quantum;
+		list_remove(&part->lioq);
+	}
+}
+
+/** Pick the next request to dispatch.
+ *
+ * @param ioq I/O queue, must not be empty
+ * @return Request
+ */
+static vbds_ioq_req_t *vbds_ioq_next(vbds_ioq_t *ioq)
+{
+	vbds_ioq_req_t *req;
+	vbds_part_t *part;
+	struct timeval now;
+
+	/* Oldest request that missed its deadline comes first */
+	req = list_get_instance(list_first(&ioq->fifo), vbds_ioq_req_t, lfifo);
+	getuptime(&now);
+	if (tv_gteq(&now, &req->deadline))
+		return req;
+
+	/* Take turns between partitions */
+	if (ioq->quantum == 0) {
+		part = list_get_instance(list_first(&ioq->active), vbds_part_t,
+		    lioq);
+		list_remove(&part->lioq);
+		list_append(&part->lioq, &ioq->active);
+		ioq->quantum = vbds_ioq_quantum;
+	}
+
+	part = list_get_instance(list_first(&ioq->active), vbds_part_t, lioq);
+	--ioq->quantum;
+
+	/* Continue in ascending order from the last dispatched request */
+	list_foreach(part->ioq_reqs, lpart, vbds_ioq_req_t, r) {
+		if (r->ba >= part->ioq_pos)
+			return r;
+	}
+
+	return list_get_instance(list_first(&part->ioq_reqs), vbds_ioq_req_t,
+	    lpart);
+}
+
+/** Execute a disk transfer.
+ *
+ * @param disk Disk
+ * @param write @c true to write, @c false to read
+ * @param ba Disk address of the first block
+ * @param cnt Number of blocks
+ * @param buf Data buffer
+ * @return EOK on success or an error code
+ */
+static errno_t vbds_ioq_disk_xfer(vbds_disk_t *disk, bool write, aoff64_t ba,
+    size_t cnt, void *buf)
+{
+	if (write)
+		return block_write_direct(disk->svc_id, ba, cnt, buf);
+	else
+		return block_read_direct(disk->svc_id, ba, cnt, buf);
+}
+
+/** Execute a batch of adjacent requests.
+ *
+ * @param disk Disk
+ * @param batch List of requests, sorted by block address
+ * @param cnt Total number of blocks
+ */
+static void vbds_ioq_batch_xfer(vbds_disk_t *disk, list_t *batch, size_t cnt)
+{
+	vbds_ioq_req_t *first;
+	uint8_t *buf;
+	uint8_t *bp;
+	errno_t rc;
+
+	first = list_get_instance(list_first(batch), vbds_ioq_req_t, lpart);
+
+	if (list_count(batch) == 1) {
+		first->rc = vbds_ioq_disk_xfer(disk, first->write, first->ba,
+		    first->cnt, first->buf);
+		return;
+	}
+
+	buf = malloc(cnt * disk->block_size);
+	if (buf == NULL) {
+		/* Fall back to transferring the requests one by one */
+		list_foreach(*batch, lpart, vbds_ioq_req_t, r) {
+			r->rc = vbds_ioq_disk_xfer(disk, r->write, r->ba,
+			    r->cnt, r->buf);
+		}
+
+		return;
+	}
+
+	if (first->write) {
+		bp = buf;
+		list_foreach(*batch, lpart, vbds_ioq_req_t, r) {
+			memcpy(bp, r->buf, r->cnt * disk->block_size);
+			bp += r->cnt * disk->block_size;
+		}
+	}
+
+	rc = vbds_ioq_disk_xfer(disk, first->write, first->ba, cnt, buf);
+
+	bp = buf;
+	list_foreach(*batch, lpart, vbds_ioq_req_t, r) {
+		if (rc == EOK && !r->write)
+			memcpy(r->buf, bp, r->cnt * disk->block_size);
+		bp += r->cnt * disk->block_size;
+		r->rc = rc;
+	}
+
+	free(buf);
+}
+
+/** Update partition statistics with a completed request.
+ *
+ * @param req Request
+ */
+static void vbds_ioq_account(vbds_ioq_req_t *req)
+{
+	vbd_part_stats_t *stats = &req->part->stats;
+	struct timeval now;
+	uint64_t latency;
+
+	getuptime(&now);
+	latency = tv_sub_diff(&now, &req->submitted);
+
+	if (req->write) {
+		++stats->writes;
+		stats->wblocks += req->cnt;
+	} else {
+		++stats->reads;
+		stats->rblocks += req->cnt;
+	}
+
+	if (req->rc != EOK)
+		++stats->errors;
+
+	--stats->qdepth;
+	stats->total_latency += latency;
+	if (latency > stats->max_latency)
+		stats->max_latency = latency;
+}
+
+/** Dispatch one disk transfer.
+ *
+ * Picks the next request and merges following adjacent requests of the
+ * same partition in the same direction.
+ *
+ * Must be called with @c ioq->lock held. The lock is dropped while
+ * the transfer is executing.
+ *
+ * @param disk Disk
+ */
+static void vbds_ioq_dispatch(vbds_disk_t *disk)
+{
+	vbds_ioq_t *ioq = &disk->ioq;
+	vbds_ioq_req_t *req;
+	vbds_ioq_req_t *next;
+	vbds_part_t *part;
+	link_t *link;
+	list_t batch;
+	size_t max_cnt;
+	size_t cnt;
+
+	list_initialize(&batch);
+	max_cnt = max(vbds_ioq_merge_max / disk->block_size, 1);
+
+	req = vbds_ioq_next(ioq);
+	part = req->part;
+	cnt = req->cnt;
+
+	link = list_next(&req->lpart, &part->ioq_reqs);
+	vbds_ioq_remove(ioq, req);
+	list_append(&req->lpart, &batch);
+
+	while (link != NULL) {
+		next = list_get_instance(link, vbds_ioq_req_t, lpart);
+		if (next->write != req->write || next->ba != req->ba + cnt ||
+		    cnt + next->cnt > max_cnt)
+			break;
+
+		link = list_next(&next->lpart, &part->ioq_reqs);
+		vbds_ioq_remove(ioq, next);
+		list_append(&next->lpart, &batch);
+		cnt += next->cnt;
+		++part->stats.merged;
+	}
+
+	part->ioq_pos = req->ba + cnt;
+	++ioq->inflight;
+	fibril_mutex_unlock(&ioq->lock);
+
+	vbds_ioq_batch_xfer(disk, &batch, cnt);
+
+	fibril_mutex_lock(&ioq->lock);
+	--ioq->inflight;
+
+	while (!list_empty(&batch)) {
+		req = list_get_instance(list_first(&batch), vbds_ioq_req_t,
+		    lpart);
+		list_remove(&req->lpart);
+
+		vbds_ioq_account(req);
+		req->done = true;
+	}
+
+	fibril_condvar_broadcast(&ioq->cv);
+}
+
+/** Transfer blocks of a partition through the disk I/O queue.
+ *
+ * The calling fibril dispatches requests (not necessarily its own) while
+ * the disk is not busy and waits for its request to complete.
+ *
+ * @param part Partition
+ * @param write @c true to write, @c false to read
+ * @param ba Disk address of the first block
+ * @param cnt Number of blocks
+ * @param buf Data buffer
+ * @return EOK on success or an error code
+ */
+errno_t vbds_ioq_xfer(vbds_part_t *part, bool write, aoff64_t ba, size_t cnt,
+    void *buf)
+{
+	vbds_ioq_t *ioq = &part->disk->ioq;
+	vbds_ioq_req_t req;
+
+	link_initialize(&req.lpart);
+	link_initialize(&req.lfifo);
+	req.part = part;
+	req.write = write;
+	req.ba = ba;
+	req.cnt = cnt;
+	req.buf = buf;
+	req.rc = EOK;
+	req.done = false;
+
+	getuptime(&req.submitted);
+	req.deadline = req.submitted;
+	tv_add_diff(&req.deadline, write ? vbds_ioq_write_expire :
+	    vbds_ioq_read_expire);
+
+	fibril_mutex_lock(&ioq->lock);
+
+	vbds_ioq_insert(ioq, &req);
+	++part->stats.qdepth;
+	if (part->stats.qdepth > part->stats.max_qdepth)
+		part->stats.max_qdepth = part->stats.qdepth;
+
+	while (!req.done) {
+		if (ioq->inflight < vbds_ioq_depth &&
+		    !list_empty(&ioq->fifo)) {
+			vbds_ioq_dispatch(part->disk);
+			continue;
+		}
+
+		fibril_condvar_wait(&ioq->cv, &ioq->lock);
+	}
+
+	fibril_mutex_unlock(&ioq->lock);
+	return req.rc;
+}
+
+/** Get partition I/O statistics.
+ *
+ * @param part Partition
+ * @param stats Place to store the statistics
+ */
+void vbds_ioq_part_get_stats(vbds_part_t *part, vbd_part_stats_t *stats)
+{
+	vbds_ioq_t *ioq = &part->disk->ioq;
+
+	fibril_mutex_lock(&ioq->lock);
+	*stats = part->stats;
+	fibril_mutex_unlock(&ioq->lock);
+}
+
+/** @}
+ */
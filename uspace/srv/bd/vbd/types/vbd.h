@@ -44,7 +44,9 @@
 #include <loc.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <sys/time.h>
 #include <types/label.h>
+#include <vbd.h>
 
 typedef sysarg_t vbds_part_id_t;
 
@@ -55,8 +57,50 @@ typedef enum {
 	vrf_force = 0x1
 } vbds_rem_flag_t;
 
-/** Partition */
+/** Disk I/O queue */
+typedef struct {
+	/** Protects the queue and partition I/O statistics */
+	fibril_mutex_t lock;
+	/** Signalled when a request completes */
+	fibril_condvar_t cv;
+	/** Partitions with pending requests in round-robin order */
+	list_t active; /* of vbds_part_t */
+	/** Pending requests in order of arrival */
+	list_t fifo; /* of vbds_ioq_req_t */
+	/** Number of disk transfers in progress */
+	unsigned inflight;
+	/** Requests left in the time slice of the first active partition */
+	unsigned quantum;
+} vbds_ioq_t;
+
+/** I/O request */
 typedef struct {
+	/** Link to vbds_part_t.ioq_reqs */
+	link_t lpart;
+	/** Link to vbds_ioq_t.fifo */
+	link_t lfifo;
+	/** Partition the request was submitted to */
+	struct vbds_part *part;
+	/** @c true for write, @c false for read */
+	bool write;
+	/** Disk address of the first block */
+	aoff64_t ba;
+	/** Number of blocks */
+	size_t cnt;
+	/** Data buffer */
+	void *buf;
+	/** Time of submission */
+	struct timeval submitted;
+	/** Time by which the request should be dispatched */
+	struct timeval deadline;
+	/** Result */
+	errno_t rc;
+	/** Request has completed */
+	bool done;
+} vbds_ioq_req_t;
+
+/** Partition */
+typedef struct vbds_part {
 	/** Reader held during I/O */
 	fibril_rwlock_t lock;
 	/** Disk this partition belongs to */
@@ -83,6 +127,14 @@ typedef struct {
 	aoff64_t nblocks;
 	/** Reference count */
 	atomic_t refcnt;
+	/** Link to vbds_ioq_t.active */
+	link_t lioq;
+	/** Pending requests sorted by block address */
+	list_t ioq_reqs; /* of vbds_ioq_req_t */
+	/** Disk address following the last dispatched request */
+	aoff64_t ioq_pos;
+	/** I/O statistics */
+	vbd_part_stats_t stats;
 } vbds_part_t;
 
 /** Disk */
@@ -103,6 +155,8 @@ typedef struct vbds_disk {
 	aoff64_t nblocks;
 	/** Used to mark disks still present during re-discovery */
 	bool present;
+	/** I/O queue */
+	vbds_ioq_t ioq;
 } vbds_disk_t;
 
 #endif
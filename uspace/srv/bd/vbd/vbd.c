@@ -264,6 +264,46 @@ static void vbds_part_get_info_srv(cap_call_handle_t icall_handle, ipc_call_t *i
 	async_answer_0(icall_handle, EOK);
 }
 
+static void vbds_part_get_stats_srv(cap_call_handle_t icall_handle,
+    ipc_call_t *icall)
+{
+	vbds_part_id_t part;
+	vbd_part_stats_t pstats;
+	errno_t rc;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "vbds_part_get_stats_srv()");
+
+	part = IPC_GET_ARG1(*icall);
+	rc = vbds_part_get_stats(part, &pstats);
+	if (rc != EOK) {
+		async_answer_0(icall_handle, rc);
+		return;
+	}
+
+	cap_call_handle_t chandle;
+	size_t size;
+	if (!async_data_read_receive(&chandle, &size)) {
+		async_answer_0(chandle, EREFUSED);
+		async_answer_0(icall_handle, EREFUSED);
+		return;
+	}
+
+	if (size != sizeof(vbd_part_stats_t)) {
+		async_answer_0(chandle, EINVAL);
+		async_answer_0(icall_handle, EINVAL);
+		return;
+	}
+
+	rc = async_data_read_finalize(chandle, &pstats, size);
+	if (rc != EOK) {
+		async_answer_0(chandle, rc);
+		async_answer_0(icall_handle, rc);
+		return;
+	}
+
+	async_answer_0(icall_handle, EOK);
+}
+
 static void vbds_part_create_srv(cap_call_handle_t icall_handle, ipc_call_t *icall)
 {
 	service_id_t disk_sid;
@@ -396,6 +436,9 @@ static void vbds_ctl_conn(cap_call_handle_t icall_handle, ipc_call_t *icall, voi
 		case VBD_PART_GET_INFO:
 			vbds_part_get_info_srv(chandle, &call);
 			break;
+		case VBD_PART_GET_STATS:
+			vbds_part_get_stats_srv(chandle, &call);
+			break;
 		case VBD_PART_CREATE:
 			vbds_part_create_srv(chandle, &call);
 			break;
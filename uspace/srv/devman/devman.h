@@ -91,6 +91,16 @@ typedef struct driver {
 	fibril_mutex_t driver_mutex;
 } driver_t;
 
+/** Entry of the index of driver match IDs. */
+typedef struct {
+	/** Link in driver_list_t.match_index */
+	ht_link_t link;
+	/** Driver match ID (owned by the driver) */
+	match_id_t *match_id;
+	/** Driver */
+	struct driver *driver;
+} driver_match_t;
+
 /** The list of drivers. */
 typedef struct driver_list {
 	/** List of drivers */
@@ -99,6 +109,10 @@ typedef struct driver_list {
 	fibril_mutex_t drivers_mutex;
 	/** Next free handle */
 	devman_handle_t next_handle;
+	/** Match ID to driver index (of driver_match_t) */
+	hash_table_t match_index;
+	/** Index covers all drivers in the list */
+	bool match_indexed;
 } driver_list_t;
 
 /** Device state */
@@ -30,6 +30,8 @@
  * @{
  */
 
+#include <adt/hash.h>
+#include <assert.h>
 #include <dirent.h>
 #include <errno.h>
 #include <io/log.h>
@@ -43,6 +45,46 @@
 #include "devman.h"
 #include "driver.h"
 #include "match.h"
+#include "snapshot.h"
+
+/* Match ID index operations */
+
+static size_t match_id_key_hash(void *key)
+{
+	const char *id = (const char *) key;
+	size_t hash = 0;
+
+	while (*id != '\0')
+		hash = hash_combine(hash, (uint8_t) *id++);
+
+	return hash;
+}
+
+static size_t driver_match_hash(const ht_link_t *item)
+{
+	driver_match_t *match = hash_table_get_inst(item, driver_match_t, link);
+	return match_id_key_hash(match->match_id->id);
+}
+
+static bool driver_match_key_equal(void *key, const ht_link_t *item)
+{
+	driver_match_t *match = hash_table_get_inst(item, driver_match_t, link);
+	return str_cmp(match->match_id->id, (const char *) key) == 0;
+}
+
+static void driver_match_remove(ht_link_t *item)
+{
+	driver_match_t *match = hash_table_get_inst(item, driver_match_t, link);
+	free(match);
+}
+
+static hash_table_ops_t driver_match_ops = {
+	.hash = driver_match_hash,
+	.key_hash = match_id_key_hash,
+	.key_equal = driver_match_key_equal,
+	.equal = NULL,
+	.remove_callback = driver_match_remove
+};
 
 /**
  * Initialize the list of device driver's.
@@ -57,6 +99,47 @@ void init_driver_list(driver_list_t *drv_list)
 	list_initialize(&drv_list->drivers);
 	fibril_mutex_initialize(&drv_list->drivers_mutex);
 	drv_list->next_handle = 1;
+
+	drv_list->match_indexed = hash_table_create(&drv_list->match_index,
+	    0, 0, &driver_match_ops);
+	if (!drv_list->match_indexed) {
+		log_msg(LOG_DEFAULT, LVL_WARN, "Failed creating driver match "
+		    "index, falling back to linear search.");
+	}
+}
+
+/** Add match IDs of a driver to the match ID index.
+ *
+ * If memory runs out, the index is abandoned and driver lookup falls back
+ * to scoring every driver.
+ *
+ * @param drivers_list	List of drivers, with drivers_mutex held.
+ * @param drv		Driver structure.
+ */
+static void driver_index_match_ids(driver_list_t *drivers_list,
+    driver_t *drv)
+{
+	driver_match_t *match;
+
+	assert(fibril_mutex_is_locked(&drivers_list->drivers_mutex));
+
+	if (!drivers_list->match_indexed)
+		return;
+
+	list_foreach(drv->match_ids.ids, link, match_id_t, mid) {
+		match = malloc(sizeof(driver_match_t));
+		if (match == NULL) {
+			log_msg(LOG_DEFAULT, LVL_WARN, "Out of memory, "
+			    "disabling driver match index.");
+			hash_table_destroy(&drivers_list->match_index);
+			drivers_list->match_indexed = false;
+			return;
+		}
+
+		match->match_id = mid;
+		match->driver = drv;
+		hash_table_insert(&drivers_list->match_index, &match->link);
+	}
 }
 
 /** Allocate and initialize a new driver structure.
@@ -81,6 +164,7 @@ void add_driver(driver_list_t *drivers_list, driver_t *drv)
 	fibril_mutex_lock(&drivers_list->drivers_mutex);
 	list_append(&drv->drivers, &drivers_list->drivers);
 	drv->handle = drivers_list->next_handle++;
+	driver_index_match_ids(drivers_list, drv);
 	fibril_mutex_unlock(&drivers_list->drivers_mutex);
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "Driver `%s' was added to the list of available "
@@ -118,6 +202,23 @@ bool get_driver_info(const char *base_path, const char *name, driver_t *drv)
 	char *match_path = NULL;
 	size_t name_size = 0;
 
+	/* Initialize path with driver's binary. */
+	drv->binary_path = get_abs_path(base_path, name, "");
+	if (drv->binary_path == NULL)
+		goto cleanup;
+
+	/*
+	 * Check whether the driver's binary exists. Do this before reading
+	 * the configuration file, so that directory entries which are not
+	 * drivers are skipped cheaply.
+	 */
+	vfs_stat_t s;
+	if (vfs_stat_path(drv->binary_path, &s) != EOK) {
+		log_msg(LOG_DEFAULT, LVL_ERROR, "Driver not found at path `%s'.",
+		    drv->binary_path);
+		goto cleanup;
+	}
+
 	/* Read the list of match ids from the driver's configuration file. */
 	match_path = get_abs_path(base_path, name, MATCH_EXT);
 	if (match_path == NULL)
@@ -133,19 +234,6 @@ bool get_driver_info(const char *base_path, const char *name, driver_t *drv)
 		goto cleanup;
 	str_cpy(drv->name, name_size, name);
 
-	/* Initialize path with driver's binary. */
-	drv->binary_path = get_abs_path(base_path, name, "");
-	if (drv->binary_path == NULL)
-		goto cleanup;
-
-	/* Check whether the driver's binary exists. */
-	vfs_stat_t s;
-	if (vfs_stat_path(drv->binary_path, &s) != EOK) {
-		log_msg(LOG_DEFAULT, LVL_ERROR, "Driver not found at path `%s'.",
-		    drv->binary_path);
-		goto cleanup;
-	}
-
 	suc = true;
 
 cleanup:
@@ -202,6 +290,10 @@ int lookup_available_drivers(driver_list_t *drivers_list, const char *dir_path)
  * The best matching driver for a device is the driver with the highest score
  * of the match between the device and the driver.
  *
+ * The device's match ids are looked up in the index of driver match ids,
+ * so only drivers sharing at least one match id with the device are
+ * scored. Among drivers with equal score the one added first wins.
+ *
  * @param drivers_list	The list of drivers, where we look for the driver
  *			suitable for handling the device.
  * @param node		The device node structure of the device.
@@ -212,14 +304,40 @@ driver_t *find_best_match_driver(driver_list_t *drivers_list, dev_node_t *node)
 {
 	driver_t *best_drv = NULL;
 	int best_score = 0, score = 0;
+	ht_link_t *first;
+	ht_link_t *cur;
+	driver_match_t *match;
 
 	fibril_mutex_lock(&drivers_list->drivers_mutex);
 
-	list_foreach(drivers_list->drivers, drivers, driver_t, drv) {
-		score = get_match_score(drv, node);
-		if (score > best_score) {
-			best_score = score;
-			best_drv = drv;
+	if (!drivers_list->match_indexed) {
+		list_foreach(drivers_list->drivers, drivers, driver_t, drv) {
+			score = get_match_score(drv, node);
+			if (score > best_score) {
+				best_score = score;
+				best_drv = drv;
+			}
+		}
+
+		fibril_mutex_unlock(&drivers_list->drivers_mutex);
+		return best_drv;
+	}
+
+	list_foreach(node->pfun->match_ids.ids, link, match_id_t, dev_id) {
+		first = hash_table_find(&drivers_list->match_index, dev_id->id);
+		cur = first;
+		while (cur != NULL) {
+			match = hash_table_get_inst(cur, driver_match_t, link);
+			score = match->match_id->score * dev_id->score;
+			if (score > best_score || (score == best_score &&
+			    best_drv != NULL &&
+			    match->driver->handle < best_drv->handle)) {
+				best_score = score;
+				best_drv = match->driver;
+			}
+
+			cur = hash_table_find_next(&drivers_list->match_index,
+			    first, cur);
 		}
 	}
 
@@ -537,6 +655,7 @@ bool assign_driver(dev_node_t *dev, driver_list_t *drivers_list,
 
 	/* Attach the driver to the device. */
 	attach_driver(tree, dev, drv);
+	snapshot_record(dev->pfun, drv);
 
 	fibril_mutex_lock(&drv->driver_mutex);
 	if (drv->state == DRIVER_NOT_STARTED) {
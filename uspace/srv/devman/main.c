@@ -59,6 +59,7 @@
 #include "driver.h"
 #include "fun.h"
 #include "loc.h"
+#include "snapshot.h"
 
 #define DRIVER_DEFAULT_STORE  "/drv"
 
@@ -294,6 +295,10 @@ static bool devman_init(void)
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "devman_init - list of drivers has been initialized.");
 
+	/* Start drivers expected from the previous boot. */
+	snapshot_init();
+	snapshot_start_drivers(&drivers_list);
+
 	/* Create root device node. */
 	if (!init_device_tree(&device_tree, &drivers_list)) {
 		log_msg(LOG_DEFAULT, LVL_FATAL, "Failed to initialize device tree.");
@@ -35,11 +35,15 @@
 #include <str.h>
 #include <str_error.h>
 #include <stddef.h>
+#include <stdlib.h>
 #include <vfs/vfs.h>
 
 #include "devman.h"
 #include "match.h"
 
+/** Size of the first read of a match id file. */
+#define MATCH_READ_SIZE	512
+
 #define COMMENT	'#'
 
 /** Compute compound score of driver and device.
@@ -195,45 +199,41 @@ bool read_match_ids(const char *conf_path, match_id_list_t *ids)
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "read_match_ids(conf_path=\"%s\")", conf_path);
 
 	bool suc = false;
+	size_t len = MATCH_READ_SIZE;
 	char *buf = NULL;
-	bool opened = false;
-	int fd;
-	size_t len = 0;
-	vfs_stat_t st;
-
-	errno_t rc = vfs_lookup_open(conf_path, WALK_REGULAR, MODE_READ, &fd);
-	if (rc != EOK) {
-		log_msg(LOG_DEFAULT, LVL_ERROR, "Unable to open `%s' for reading: %s.",
-		    conf_path, str_error(rc));
-		goto cleanup;
-	}
-	opened = true;
+	size_t read_bytes;
+	aoff64_t size;
+	errno_t rc;
 
-	rc = vfs_stat(fd, &st);
-	if (rc != EOK) {
-		log_msg(LOG_DEFAULT, LVL_ERROR, "Unable to fstat %d: %s.", fd,
-		    str_error(rc));
-		goto cleanup;
-	}
-	len = st.size;
-	if (len == 0) {
-		log_msg(LOG_DEFAULT, LVL_ERROR, "Configuration file '%s' is empty.",
-		    conf_path);
-		goto cleanup;
-	}
+	/*
+	 * Match id files are small, so most of them are read by the first
+	 * request. A larger file is read again with a buffer that fits.
+	 */
+	while (true) {
+		char *nbuf = realloc(buf, len + 1);
+		if (nbuf == NULL) {
+			log_msg(LOG_DEFAULT, LVL_ERROR, "Memory allocation failed when "
+			    "parsing file '%s'.", conf_path);
+			goto cleanup;
+		}
+		buf = nbuf;
+
+		rc = vfs_lookup_read(conf_path, buf, len, &read_bytes, &size,
+		    NULL);
+		if (rc != EOK) {
+			log_msg(LOG_DEFAULT, LVL_ERROR, "Unable to read file '%s': %s.",
+			    conf_path, str_error(rc));
+			goto cleanup;
+		}
 
-	buf = malloc(len + 1);
-	if (buf == NULL) {
-		log_msg(LOG_DEFAULT, LVL_ERROR, "Memory allocation failed when parsing file "
-		    "'%s'.", conf_path);
-		goto cleanup;
+		if (size <= len || read_bytes < len)
+			break;
+		len = size;
 	}
 
-	size_t read_bytes;
-	rc = vfs_read(fd, (aoff64_t []) { 0 }, buf, len, &read_bytes);
-	if (rc != EOK) {
-		log_msg(LOG_DEFAULT, LVL_ERROR, "Unable to read file '%s': %s.", conf_path,
-		    str_error(rc));
+	if (read_bytes == 0) {
+		log_msg(LOG_DEFAULT, LVL_ERROR, "Configuration file '%s' is empty.",
+		    conf_path);
 		goto cleanup;
 	}
 	buf[read_bytes] = 0;
@@ -243,9 +243,6 @@ bool read_match_ids(const char *conf_path, match_id_list_t *ids)
 cleanup:
 	free(buf);
 
-	if (opened)
-		vfs_put(fd);
-
 	return suc;
 }
 
@@ -0,0 +1,420 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup devman
+ * @{
+ */
+
+/** @file Boot snapshot of driver assignments.
+ *
+ * The snapshot records which driver was assigned to which function during
+ * enumeration. On the next boot the drivers listed in the snapshot are
+ * started speculatively, before enumeration reaches their devices, so that
+ * they are already running when their devices are passed to them.
+ *
+ * Enumeration still proceeds normally and acts as verification. Once no new
+ * assignments have been made for SNAPSHOT_SETTLE_USEC, the hash of the
+ * current assignments is compared with the stored one and the snapshot is
+ * rewritten if they differ.
+ */
+
+#include <adt/hash.h>
+#include <adt/list.h>
+#include <assert.h>
+#include <errno.h>
+#include <fibril_synch.h>
+#include <io/log.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <str.h>
+#include <str_error.h>
+#include <vfs/vfs.h>
+
+#include "devman.h"
+#include "driver.h"
+#include "snapshot.h"
+
+#define SNAPSHOT_PATH		"/cfg/devman.snap"
+#define SNAPSHOT_MAGIC		"devman-snapshot"
+#define SNAPSHOT_SETTLE_USEC	(2 * 1000 * 1000)
+
+/** Function to driver assignment */
+typedef struct {
+	link_t link;
+	/** Function path name */
+	char *fun_path;
+	/** Driver name */
+	char *drv_name;
+} snapshot_entry_t;
+
+/** Assignments read from the stored snapshot */
+static LIST_INITIALIZE(stored_entries);
+static size_t stored_hash;
+static size_t stored_count;
+
+/** Assignments made during this boot */
+static LIST_INITIALIZE(cur_entries);
+static size_t cur_hash;
+static size_t cur_count;
+
+static FIBRIL_MUTEX_INITIALIZE(snapshot_lock);
+static fibril_timer_t *snapshot_timer;
+
+/** Compute hash of one assignment.
+ *
+ * The snapshot hash is the sum of the hashes of its assignments, so that it
+ * does not depend on the order in which devices were enumerated.
+ */
+static size_t snapshot_entry_hash(const char *fun_path, const char *drv_name)
+{
+	size_t hash = 0;
+
+	while (*fun_path != '\0')
+		hash = hash_combine(hash, (uint8_t) *fun_path++);
+	hash = hash_combine(hash, 0);
+	while (*drv_name != '\0')
+		hash = hash_combine(hash, (uint8_t) *drv_name++);
+
+	return hash;
+}
+
+static snapshot_entry_t *snapshot_entry_create(const char *fun_path,
+    const char *drv_name)
+{
+	snapshot_entry_t *entry;
+
+	entry = calloc(1, sizeof(snapshot_entry_t));
+	if (entry == NULL)
+		return NULL;
+
+	entry->fun_path = str_dup(fun_path);
+	entry->drv_name = str_dup(drv_name);
+	if (entry->fun_path == NULL || entry->drv_name == NULL) {
+		free(entry->fun_path);
+		free(entry->drv_name);
+		free(entry);
+		return NULL;
+	}
+
+	return entry;
+}
+
+static void snapshot_entries_clear(list_t *entries)
+{
+	link_t *link;
+	snapshot_entry_t *entry;
+
+	while ((link = list_first(entries)) != NULL) {
+		entry = list_get_instance(link, snapshot_entry_t, link);
+		list_remove(&entry->link);
+		free(entry->fun_path);
+		free(entry->drv_name);
+		free(entry);
+	}
+}
+
+/** Parse snapshot file contents.
+ *
+ * @param buf	Null-terminated file contents (modified)
+ * @return	EOK on success, EINVAL if the snapshot is malformed or its
+ *		hash does not match, ENOMEM if out of memory.
+ */
+static errno_t snapshot_parse(char *buf)
+{
+	char *state;
+	char *line;
+	char *sep;
+	const char *endp;
+	size_t count = 0;
+	size_t hash = 0;
+	uint64_t val;
+	snapshot_entry_t *entry;
+
+	/* Header: magic, number of entries, hash */
+	line = str_tok(buf, "\n", &state);
+	if (line == NULL)
+		return EINVAL;
+
+	sep = str_chr(line, ' ');
+	if (sep == NULL)
+		return EINVAL;
+	*sep++ = '\0';
+	if (str_cmp(line, SNAPSHOT_MAGIC) != 0)
+		return EINVAL;
+
+	if (str_size_t(sep, &endp, 10, false, &stored_count) != EOK ||
+	    *endp != ' ')
+		return EINVAL;
+	if (str_uint64_t(endp + 1, NULL, 16, true, &val) != EOK)
+		return EINVAL;
+	stored_hash = (size_t) val;
+
+	/* Assignments: function path, driver name */
+	while ((line = str_tok(NULL, "\n", &state)) != NULL) {
+		sep = str_rchr(line, ' ');
+		if (sep == NULL)
+			return EINVAL;
+		*sep++ = '\0';
+
+		entry = snapshot_entry_create(line, sep);
+		if (entry == NULL)
+			return ENOMEM;
+
+		list_append(&entry->link, &stored_entries);
+		hash += snapshot_entry_hash(entry->fun_path, entry->drv_name);
+		++count;
+	}
+
+	if (count != stored_count || hash != stored_hash)
+		return EINVAL;
+
+	return EOK;
+}
+
+/** Read the stored snapshot. */
+static errno_t snapshot_load(void)
+{
+	vfs_stat_t st;
+	char *buf = NULL;
+	size_t nread;
+	int fd;
+	errno_t rc;
+
+	rc = vfs_lookup_open(SNAPSHOT_PATH, WALK_REGULAR, MODE_READ, &fd);
+	if (rc != EOK)
+		return rc;
+
+	rc = vfs_stat(fd, &st);
+	if (rc != EOK)
+		goto out;
+
+	buf = malloc(st.size + 1);
+	if (buf == NULL) {
+		rc = ENOMEM;
+		goto out;
+	}
+
+	rc = vfs_read(fd, (aoff64_t []) { 0 }, buf, st.size, &nread);
+	if (rc != EOK)
+		goto out;
+	buf[nread] = '\0';
+
+	rc = snapshot_parse(buf);
+out:
+	if (rc != EOK) {
+		snapshot_entries_clear(&stored_entries);
+		stored_count = 0;
+		stored_hash = 0;
+	}
+
+	free(buf);
+	vfs_put(fd);
+	return rc;
+}
+
+/** Write assignments made during this boot as the new snapshot.
+ *
+ * @param text	Snapshot file contents
+ */
+static errno_t snapshot_store(const char *text)
+{
+	size_t size = str_size(text);
+	size_t nwr;
+	int fd;
+	errno_t rc;
+
+	rc = vfs_lookup_open(SNAPSHOT_PATH, WALK_REGULAR | WALK_MAY_CREATE,
+	    MODE_WRITE, &fd);
+	if (rc != EOK)
+		return rc;
+
+	rc = vfs_resize(fd, 0);
+	if (rc == EOK)
+		rc = vfs_write(fd, (aoff64_t []) { 0 }, text, size, &nwr);
+
+	vfs_put(fd);
+	return rc;
+}
+
+/** Format assignments made during this boot.
+ *
+ * @return Newly allocated snapshot file contents or NULL if out of memory.
+ */
+static char *snapshot_format(void)
+{
+	size_t size;
+	char *text;
+	char *p;
+
+	assert(fibril_mutex_is_locked(&snapshot_lock));
+
+	/* Header with 64-bit hash in hex, entries with separator and newline */
+	size = str_size(SNAPSHOT_MAGIC) + 1 + 20 + 1 + 16 + 1;
+	list_foreach(cur_entries, link, snapshot_entry_t, entry) {
+		size += str_size(entry->fun_path) + 1 +
+		    str_size(entry->drv_name) + 1;
+	}
+
+	text = malloc(size + 1);
+	if (text == NULL)
+		return NULL;
+
+	p = text;
+	p += snprintf(p, size + 1 - (p - text), "%s %zu %zx\n",
+	    SNAPSHOT_MAGIC, cur_count, cur_hash);
+	list_foreach(cur_entries, link, snapshot_entry_t, entry) {
+		p += snprintf(p, size + 1 - (p - text), "%s %s\n",
+		    entry->fun_path, entry->drv_name);
+	}
+
+	return text;
+}
+
+/** Enumeration has settled, verify and possibly update the snapshot. */
+static void snapshot_settled(void *arg)
+{
+	char *text;
+	errno_t rc;
+
+	(void) arg;
+
+	fibril_mutex_lock(&snapshot_lock);
+
+	if (cur_count == stored_count && cur_hash == stored_hash) {
+		fibril_mutex_unlock(&snapshot_lock);
+		log_msg(LOG_DEFAULT, LVL_DEBUG, "Boot snapshot verified "
+		    "(%zu assignments).", cur_count);
+		return;
+	}
+
+	text = snapshot_format();
+	if (text == NULL) {
+		fibril_mutex_unlock(&snapshot_lock);
+		return;
+	}
+
+	/* Do not rewrite the same snapshot again. */
+	stored_count = cur_count;
+	stored_hash = cur_hash;
+	fibril_mutex_unlock(&snapshot_lock);
+
+	log_msg(LOG_DEFAULT, LVL_NOTE, "Device tree differs from boot "
+	    "snapshot, updating `%s'.", SNAPSHOT_PATH);
+
+	rc = snapshot_store(text);
+	if (rc != EOK) {
+		log_msg(LOG_DEFAULT, LVL_WARN, "Failed writing `%s': %s.",
+		    SNAPSHOT_PATH, str_error(rc));
+	}
+
+	free(text);
+}
+
+/** Initialize boot snapshot.
+ *
+ * Reads the stored snapshot, if any. A missing or damaged snapshot simply
+ * means no drivers are started speculatively.
+ */
+void snapshot_init(void)
+{
+	errno_t rc;
+
+	snapshot_timer = fibril_timer_create(&snapshot_lock);
+	if (snapshot_timer == NULL) {
+		log_msg(LOG_DEFAULT, LVL_WARN, "Out of memory, boot snapshot "
+		    "disabled.");
+		return;
+	}
+
+	rc = snapshot_load();
+	if (rc == ENOENT) {
+		log_msg(LOG_DEFAULT, LVL_DEBUG, "No boot snapshot found.");
+	} else if (rc != EOK) {
+		log_msg(LOG_DEFAULT, LVL_WARN, "Ignoring boot snapshot `%s': "
+		    "%s.", SNAPSHOT_PATH, str_error(rc));
+	}
+}
+
+/** Speculatively start drivers listed in the boot snapshot.
+ *
+ * @param drivers_list	List of available drivers
+ */
+void snapshot_start_drivers(driver_list_t *drivers_list)
+{
+	driver_t *drv;
+	size_t started = 0;
+
+	list_foreach(stored_entries, link, snapshot_entry_t, entry) {
+		drv = driver_find_by_name(drivers_list, entry->drv_name);
+		if (drv == NULL)
+			continue;
+
+		fibril_mutex_lock(&drv->driver_mutex);
+		if (drv->state == DRIVER_NOT_STARTED && start_driver(drv))
+			++started;
+		fibril_mutex_unlock(&drv->driver_mutex);
+	}
+
+	if (started > 0) {
+		log_msg(LOG_DEFAULT, LVL_NOTE, "Started %zu drivers from boot "
+		    "snapshot.", started);
+	}
+
+	/* Entries are only needed for the speculative start. */
+	snapshot_entries_clear(&stored_entries);
+}
+
+/** Record assignment of a driver to a function.
+ *
+ * @param fun	Function whose child device the driver was assigned to
+ * @param drv	Driver
+ */
+void snapshot_record(fun_node_t *fun, driver_t *drv)
+{
+	snapshot_entry_t *entry;
+
+	if (snapshot_timer == NULL)
+		return;
+
+	entry = snapshot_entry_create(fun->pathname, drv->name);
+	if (entry == NULL)
+		return;
+
+	fibril_mutex_lock(&snapshot_lock);
+	list_append(&entry->link, &cur_entries);
+	cur_hash += snapshot_entry_hash(entry->fun_path, entry->drv_name);
+	++cur_count;
+
+	/* Postpone verification until enumeration settles. */
+	fibril_timer_set_locked(snapshot_timer, SNAPSHOT_SETTLE_USEC,
+	    snapshot_settled, NULL);
+	fibril_mutex_unlock(&snapshot_lock);
+}
+
+/** @}
+ */
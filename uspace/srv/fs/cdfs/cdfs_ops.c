@@ -61,6 +61,9 @@
 
 #define NODE_CACHE_SIZE 200
 
+/** Initial read-ahead window in blocks, optical media are slow to seek */
+#define READ_AHEAD  32
+
 /** All root nodes have index 0 */
 #define CDFS_SOME_ROOT  0
 
@@ -216,10 +219,13 @@ typedef enum {
 	CDFS_DIRECTORY
 } cdfs_dentry_type_t;
 
+struct cdfs_node;
+
 typedef struct {
-	link_t link;       /**< Siblings list link */
-	fs_index_t index;  /**< Node index */
-	char *name;        /**< Dentry name */
+	ht_link_t dh_link;         /**< Dentries hash table link */
+	struct cdfs_node *parent;  /**< Parent directory */
+	fs_index_t index;          /**< Node index */
+	char *name;                /**< Dentry name */
 } cdfs_dentry_t;
 
 typedef uint32_t cdfs_lba_t;
@@ -231,7 +237,7 @@ typedef struct {
 	char *vol_ident;	  /**< Volume identifier */
 } cdfs_t;
 
-typedef struct {
+typedef struct cdfs_node {
 	fs_node_t *fs_node;       /**< FS node */
 	fs_index_t index;         /**< Node index */
 	cdfs_t *fs;		  /**< File system */
@@ -242,7 +248,8 @@ typedef struct {
 	unsigned int lnkcnt;      /**< Link count */
 	uint32_t size;            /**< File size if type is CDFS_FILE */
 
-	list_t cs_list;           /**< Child's siblings list */
+	cdfs_dentry_t **dentries; /**< Children in directory order */
+	size_t dentry_cnt;        /**< Number of children */
 	cdfs_lba_t lba;           /**< LBA of data on disk */
 	bool processed;           /**< If all children have been read */
 	unsigned int opened;      /**< Opened count */
@@ -275,6 +282,9 @@ static size_t nodes_cached = 0;
 /** Hash table of all cdfs nodes */
 static hash_table_t nodes;
 
+/** Hash table of children of all read directories, by parent and name */
+static hash_table_t dentries;
+
 /*
  * Hash table support functions.
  */
@@ -308,15 +318,15 @@ static void nodes_remove_callback(ht_link_t *item)
 {
 	cdfs_node_t *node = hash_table_get_inst(item, cdfs_node_t, nh_link);
 
-	if (node->type == CDFS_DIRECTORY) {
-		link_t *link;
-		while ((link = list_first(&node->cs_list)) != NULL) {
-			cdfs_dentry_t *dentry = list_get_instance(link, cdfs_dentry_t, link);
-			list_remove(&dentry->link);
-			free(dentry);
-		}
+	for (size_t i = 0; i < node->dentry_cnt; i++) {
+		cdfs_dentry_t *dentry = node->dentries[i];
+
+		hash_table_remove_item(&dentries, &dentry->dh_link);
+		free(dentry->name);
+		free(dentry);
 	}
 
+	free(node->dentries);
 	free(node->fs_node);
 	free(node);
 }
@@ -330,6 +340,53 @@ static hash_table_ops_t nodes_ops = {
 	.remove_callback = nodes_remove_callback
 };
 
+typedef struct {
+	struct cdfs_node *parent;
+	const char *name;
+} dentry_key_t;
+
+static size_t dentries_name_hash(struct cdfs_node *parent, const char *name)
+{
+	size_t hash = hash_mix((uintptr_t) parent);
+
+	while (*name != '\0')
+		hash = hash_combine(hash, (uint8_t) *name++);
+
+	return hash;
+}
+
+static size_t dentries_key_hash(void *k)
+{
+	dentry_key_t *key = (dentry_key_t *) k;
+	return dentries_name_hash(key->parent, key->name);
+}
+
+static size_t dentries_hash(const ht_link_t *item)
+{
+	cdfs_dentry_t *dentry =
+	    hash_table_get_inst(item, cdfs_dentry_t, dh_link);
+	return dentries_name_hash(dentry->parent, dentry->name);
+}
+
+static bool dentries_key_equal(void *k, const ht_link_t *item)
+{
+	cdfs_dentry_t *dentry =
+	    hash_table_get_inst(item, cdfs_dentry_t, dh_link);
+	dentry_key_t *key = (dentry_key_t *) k;
+
+	return key->parent == dentry->parent &&
+	    str_cmp(key->name, dentry->name) == 0;
+}
+
+/** Dentries hash table operations */
+static hash_table_ops_t dentries_ops = {
+	.hash = dentries_hash,
+	.key_hash = dentries_key_hash,
+	.key_equal = dentries_key_equal,
+	.equal = NULL,
+	.remove_callback = NULL
+};
+
 static errno_t cdfs_node_get(fs_node_t **rfn, service_id_t service_id,
     fs_index_t index)
 {
@@ -366,8 +423,8 @@ static void cdfs_node_initialize(cdfs_node_t *node)
 	node->lba = 0;
 	node->processed = false;
 	node->opened = 0;
-
-	list_initialize(&node->cs_list);
+	node->dentries = NULL;
+	node->dentry_cnt = 0;
 }
 
 static errno_t create_node(fs_node_t **rfn, cdfs_t *fs, int lflag,
@@ -424,9 +481,24 @@ static errno_t link_node(fs_node_t *pfn, fs_node_t *fn, const char *name)
 	assert(parent->type == CDFS_DIRECTORY);
 
 	/* Check for duplicate entries */
-	list_foreach(parent->cs_list, link, cdfs_dentry_t, dentry) {
-		if (str_cmp(dentry->name, name) == 0)
-			return EEXIST;
+	dentry_key_t key = {
+		.parent = parent,
+		.name = name
+	};
+
+	if (hash_table_find(&dentries, &key) != NULL)
+		return EEXIST;
+
+	/* Grow the array of children whenever the count reaches a power of two */
+	if ((parent->dentry_cnt & (parent->dentry_cnt - 1)) == 0) {
+		size_t cap = (parent->dentry_cnt > 0) ?
+		    2 * parent->dentry_cnt : 1;
+		cdfs_dentry_t **array = realloc(parent->dentries,
+		    cap * sizeof(cdfs_dentry_t *));
+		if (!array)
+			return ENOMEM;
+
+		parent->dentries = array;
 	}
 
 	/* Allocate and initialize the dentry */
@@ -441,11 +513,12 @@ static errno_t link_node(fs_node_t *pfn, fs_node_t *fn, const char *name)
 		return ENOMEM;
 	}
 
-	link_initialize(&dentry->link);
+	dentry->parent = parent;
 	dentry->index = node->index;
 
 	node->lnkcnt++;
-	list_append(&dentry->link, &parent->cs_list);
+	parent->dentries[parent->dentry_cnt++] = dentry;
+	hash_table_insert(&dentries, &dentry->dh_link);
 
 	return EOK;
 }
@@ -707,11 +780,18 @@ static errno_t cdfs_match(fs_node_t **fn, fs_node_t *pfn, const char *component)
 			return rc;
 	}
 
-	list_foreach(parent->cs_list, link, cdfs_dentry_t, dentry) {
-		if (str_cmp(dentry->name, component) == 0) {
-			*fn = get_cached_node(parent->fs, dentry->index);
-			return EOK;
-		}
+	dentry_key_t key = {
+		.parent = parent,
+		.name = component
+	};
+
+	ht_link_t *link = hash_table_find(&dentries, &key);
+	if (link != NULL) {
+		cdfs_dentry_t *dentry =
+		    hash_table_get_inst(link, cdfs_dentry_t, dh_link);
+
+		*fn = get_cached_node(parent->fs, dentry->index);
+		return EOK;
 	}
 
 	*fn = NULL;
@@ -766,7 +846,7 @@ static errno_t cdfs_has_children(bool *has_children, fs_node_t *fn)
 	if ((node->type == CDFS_DIRECTORY) && (!node->processed))
 		cdfs_readdir(node->fs, fn);
 
-	*has_children = !list_empty(&node->cs_list);
+	*has_children = node->dentry_cnt > 0;
 	return EOK;
 }
 
@@ -1178,6 +1258,8 @@ static errno_t cdfs_mounted(service_id_t service_id, const char *opts,
 		return rc;
 	}
 
+	(void) block_cache_readahead(service_id, READ_AHEAD);
+
 	/* Check if this device is not already mounted */
 	fs_node_t *rootfn;
 	rc = cdfs_root_get(&rootfn, service_id);
@@ -1305,14 +1387,12 @@ static errno_t cdfs_read(service_id_t service_id, fs_index_t index, aoff64_t pos
 				return rc;
 		}
 	} else {
-		link_t *link = list_nth(&node->cs_list, pos);
-		if (link == NULL) {
+		if (pos >= node->dentry_cnt) {
 			async_answer_0(chandle, ENOENT);
 			return ENOENT;
 		}
 
-		cdfs_dentry_t *dentry =
-		    list_get_instance(link, cdfs_dentry_t, link);
+		cdfs_dentry_t *dentry = node->dentries[pos];
 
 		*rbytes = 1;
 		async_data_read_finalize(chandle, dentry->name,
@@ -1344,33 +1424,50 @@ static errno_t cdfs_truncate(service_id_t service_id, fs_index_t index,
 	return ENOTSUP;
 }
 
+typedef struct {
+	size_t remove_cnt;  /**< Number of nodes yet to be removed */
+	bool dirs;          /**< Directories may be removed as well */
+} cache_remove_t;
+
 static bool cache_remove_closed(ht_link_t *item, void *arg)
 {
-	size_t *premove_cnt = (size_t *)arg;
+	cache_remove_t *remove = (cache_remove_t *)arg;
 
 	/* Some nodes were requested to be removed from the cache. */
-	if (0 < *premove_cnt) {
+	if (0 < remove->remove_cnt) {
 		cdfs_node_t *node = hash_table_get_inst(item, cdfs_node_t, nh_link);
 
-		if (!node->opened) {
+		if (!node->opened &&
+		    (remove->dirs || node->type != CDFS_DIRECTORY)) {
 			hash_table_remove_item(&nodes, item);
 
 			--nodes_cached;
-			--*premove_cnt;
+			--remove->remove_cnt;
 		}
 	}
 
 	/* Only continue if more nodes were requested to be removed. */
-	return 0 < *premove_cnt;
+	return 0 < remove->remove_cnt;
 }
 
 static void cleanup_cache(service_id_t service_id)
 {
 	if (nodes_cached > NODE_CACHE_SIZE) {
-		size_t remove_cnt = nodes_cached - NODE_CACHE_SIZE;
+		cache_remove_t remove = {
+			.remove_cnt = nodes_cached - NODE_CACHE_SIZE,
+			.dirs = false
+		};
+
+		/*
+		 * Directories hold the entries read from the disc,
+		 * remove them only if there are not enough files.
+		 */
+		hash_table_apply(&nodes, cache_remove_closed, &remove);
 
-		if (0 < remove_cnt)
-			hash_table_apply(&nodes, cache_remove_closed, &remove_cnt);
+		if (0 < remove.remove_cnt) {
+			remove.dirs = true;
+			hash_table_apply(&nodes, cache_remove_closed, &remove);
+		}
 	}
 }
 
@@ -1440,6 +1537,11 @@ bool cdfs_init(void)
 	if (!hash_table_create(&nodes, 0, 0, &nodes_ops))
 		return false;
 
+	if (!hash_table_create(&dentries, 0, 0, &dentries_ops)) {
+		hash_table_destroy(&nodes);
+		return false;
+	}
+
 	return true;
 }
 
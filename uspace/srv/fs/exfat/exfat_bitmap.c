@@ -44,175 +44,425 @@
 #include <align.h>
 #include <assert.h>
 #include <fibril_synch.h>
+#include <adt/list.h>
+#include <macros.h>
+#include <stdlib.h>
 #include <mem.h>
 
+/**
+ * Number of clusters left free behind a newly allocated contiguous run
+ * whenever possible, so that the file can later grow without having to
+ * fall back to a FAT chain.
+ */
+#define EXFAT_PREALLOC_CLUSTERS	64
 
-errno_t exfat_bitmap_is_free(exfat_bs_t *bs, service_id_t service_id,
-    exfat_cluster_t clst)
+/**
+ * Each instance of this type holds an in-memory copy of the Allocation
+ * Bitmap of one mounted file system. The copy is authoritative for all
+ * lookups, modifications are written through to the on-disk bitmap.
+ */
+typedef struct {
+	link_t link;
+	service_id_t service_id;
+
+	/** Mutex protecting the contents of the structure. */
+	fibril_mutex_t lock;
+	/** Copy of the Allocation Bitmap, one bit per data cluster. */
+	uint8_t *map;
+	/** Number of data clusters covered by the bitmap. */
+	exfat_cluster_t clusters;
+	/** Bit index where the search for a new contiguous run starts. */
+	exfat_cluster_t next;
+} exfat_bitmap_cache_t;
+
+/** Mutex protecting the list of bitmap caches. */
+static FIBRIL_MUTEX_INITIALIZE(bitmap_cache_lock);
+
+/** List of bitmap caches. */
+static LIST_INITIALIZE(bitmap_cache_list);
+
+/** Find and lock the bitmap cache of a file system. */
+static exfat_bitmap_cache_t *bitmap_cache_get(service_id_t service_id)
 {
-	fs_node_t *fn;
-	block_t *b = NULL;
-	exfat_node_t *bitmapp;
-	uint8_t *bitmap;
-	errno_t rc;
-	bool alloc;
+	fibril_mutex_lock(&bitmap_cache_lock);
+	list_foreach(bitmap_cache_list, link, exfat_bitmap_cache_t, bc) {
+		if (bc->service_id == service_id) {
+			fibril_mutex_lock(&bc->lock);
+			fibril_mutex_unlock(&bitmap_cache_lock);
+			return bc;
+		}
+	}
+	fibril_mutex_unlock(&bitmap_cache_lock);
+	return NULL;
+}
 
-	clst -= EXFAT_CLST_FIRST;
+static void bitmap_cache_put(exfat_bitmap_cache_t *bc)
+{
+	fibril_mutex_unlock(&bc->lock);
+}
 
-	rc = exfat_bitmap_get(&fn, service_id);
-	if (rc != EOK)
-		return rc;
-	bitmapp = EXFAT_NODE(fn);
+static inline bool bitmap_test(exfat_bitmap_cache_t *bc, exfat_cluster_t bit)
+{
+	return bc->map[bit / 8] & (1 << (bit % 8));
+}
 
-	aoff64_t offset = clst / 8;
-	rc = exfat_block_get(&b, bs, bitmapp, offset / BPS(bs), BLOCK_FLAGS_NONE);
-	if (rc != EOK) {
-		(void) exfat_node_put(fn);
-		return rc;
+static void bitmap_fill(exfat_bitmap_cache_t *bc, exfat_cluster_t first,
+    exfat_cluster_t count, bool alloc)
+{
+	exfat_cluster_t bit;
+
+	for (bit = first; bit < first + count; bit++) {
+		if (alloc)
+			bc->map[bit / 8] |= 1 << (bit % 8);
+		else
+			bc->map[bit / 8] &= ~(1 << (bit % 8));
 	}
-	bitmap = (uint8_t *)b->data;
-	alloc = bitmap[offset % BPS(bs)] & (1 << (clst % 8));
+}
 
-	rc = block_put(b);
-	if (rc != EOK) {
-		(void) exfat_node_put(fn);
-		return rc;
+/** Check whether a range of bits lies within the bitmap and is all clear. */
+static bool bitmap_range_free(exfat_bitmap_cache_t *bc, exfat_cluster_t first,
+    exfat_cluster_t count)
+{
+	exfat_cluster_t bit;
+
+	if (first >= bc->clusters || count > bc->clusters - first)
+		return false;
+
+	for (bit = first; bit < first + count; bit++) {
+		if (bit % 8 == 0 && first + count - bit >= 8 &&
+		    bc->map[bit / 8] == 0) {
+			bit += 7;
+			continue;
+		}
+		if (bitmap_test(bc, bit))
+			return false;
 	}
-	rc = exfat_node_put(fn);
-	if (rc != EOK)
-		return rc;
 
-	if (alloc)
-		return ENOENT;
+	return true;
+}
 
-	return EOK;
+/** Find the first run of count clear bits starting at or after from. */
+static bool bitmap_find_run(exfat_bitmap_cache_t *bc, exfat_cluster_t from,
+    exfat_cluster_t count, exfat_cluster_t *start)
+{
+	exfat_cluster_t bit = from;
+	exfat_cluster_t run = 0;
+
+	while (bit < bc->clusters) {
+		if (run == 0 && bit % 8 == 0 && bc->map[bit / 8] == 0xff) {
+			/* Skip fully allocated bytes at once */
+			bit += 8;
+			continue;
+		}
+
+		if (bitmap_test(bc, bit)) {
+			run = 0;
+		} else if (++run == count) {
+			*start = bit + 1 - count;
+			return true;
+		}
+		bit++;
+	}
+
+	return false;
 }
 
-errno_t exfat_bitmap_set_cluster(exfat_bs_t *bs, service_id_t service_id,
-    exfat_cluster_t clst)
+/** Write a range of the in-memory bitmap to the on-disk bitmap. */
+static errno_t bitmap_sync(exfat_bs_t *bs, exfat_bitmap_cache_t *bc,
+    exfat_cluster_t first, exfat_cluster_t count)
 {
 	fs_node_t *fn;
-	block_t *b = NULL;
 	exfat_node_t *bitmapp;
-	uint8_t *bitmap;
+	block_t *b;
+	aoff64_t fbyte, lbyte, sector;
 	errno_t rc;
 
-	clst -= EXFAT_CLST_FIRST;
-
-	rc = exfat_bitmap_get(&fn, service_id);
+	rc = exfat_bitmap_get(&fn, bc->service_id);
 	if (rc != EOK)
 		return rc;
 	bitmapp = EXFAT_NODE(fn);
 
-	aoff64_t offset = clst / 8;
-	rc = exfat_block_get(&b, bs, bitmapp, offset / BPS(bs), BLOCK_FLAGS_NONE);
-	if (rc != EOK) {
-		(void) exfat_node_put(fn);
-		return rc;
-	}
-	bitmap = (uint8_t *)b->data;
-	bitmap[offset % BPS(bs)] |= (1 << (clst % 8));
+	fbyte = first / 8;
+	lbyte = (first + count - 1) / 8;
 
-	b->dirty = true;
-	rc = block_put(b);
-	if (rc != EOK) {
-		(void) exfat_node_put(fn);
-		return rc;
+	for (sector = fbyte / BPS(bs); sector <= lbyte / BPS(bs); sector++) {
+		aoff64_t from = max(fbyte, sector * BPS(bs));
+		aoff64_t to = min(lbyte, (sector + 1) * BPS(bs) - 1);
+
+		rc = exfat_block_get(&b, bs, bitmapp, sector,
+		    BLOCK_FLAGS_NONE);
+		if (rc != EOK) {
+			(void) exfat_node_put(fn);
+			return rc;
+		}
+
+		memcpy((uint8_t *) b->data + from % BPS(bs), bc->map + from,
+		    to - from + 1);
+
+		b->dirty = true;
+		rc = block_put(b);
+		if (rc != EOK) {
+			(void) exfat_node_put(fn);
+			return rc;
+		}
 	}
 
 	return exfat_node_put(fn);
 }
 
-errno_t exfat_bitmap_clear_cluster(exfat_bs_t *bs, service_id_t service_id,
-    exfat_cluster_t clst)
+/** Mark a range of bits and write the change to disk.
+ *
+ * The in-memory bitmap is restored if the on-disk bitmap cannot be
+ * updated.
+ */
+static errno_t bitmap_update(exfat_bs_t *bs, exfat_bitmap_cache_t *bc,
+    exfat_cluster_t first, exfat_cluster_t count, bool alloc)
+{
+	errno_t rc;
+
+	if (first >= bc->clusters || count > bc->clusters - first)
+		return ELIMIT;
+	if (count == 0)
+		return EOK;
+
+	bitmap_fill(bc, first, count, alloc);
+	rc = bitmap_sync(bs, bc, first, count);
+	if (rc != EOK)
+		bitmap_fill(bc, first, count, !alloc);
+
+	return rc;
+}
+
+/** Load the Allocation Bitmap of a file system into memory.
+ *
+ * @param bs		Buffer holding the boot sector of the file system.
+ * @param service_id	Service ID of the file system.
+ *
+ * @return		EOK on success or an error code.
+ */
+errno_t exfat_bitmap_init_by_service_id(exfat_bs_t *bs,
+    service_id_t service_id)
 {
+	exfat_bitmap_cache_t *bc;
 	fs_node_t *fn;
-	block_t *b = NULL;
 	exfat_node_t *bitmapp;
-	uint8_t *bitmap;
+	block_t *b;
+	size_t size, sector, sectors;
 	errno_t rc;
 
-	clst -= EXFAT_CLST_FIRST;
+	bc = malloc(sizeof(exfat_bitmap_cache_t));
+	if (!bc)
+		return ENOMEM;
+
+	link_initialize(&bc->link);
+	fibril_mutex_initialize(&bc->lock);
+	bc->service_id = service_id;
+	bc->clusters = DATA_CNT(bs);
+	bc->next = 0;
+
+	size = ROUND_UP(bc->clusters, 8) / 8;
+	bc->map = malloc(size);
+	if (!bc->map) {
+		free(bc);
+		return ENOMEM;
+	}
 
 	rc = exfat_bitmap_get(&fn, service_id);
 	if (rc != EOK)
-		return rc;
+		goto error;
 	bitmapp = EXFAT_NODE(fn);
 
-	aoff64_t offset = clst / 8;
-	rc = exfat_block_get(&b, bs, bitmapp, offset / BPS(bs),
-	    BLOCK_FLAGS_NONE);
-	if (rc != EOK) {
-		(void) exfat_node_put(fn);
-		return rc;
+	sectors = ROUND_UP(size, BPS(bs)) / BPS(bs);
+	for (sector = 0; sector < sectors; sector++) {
+		rc = exfat_block_get(&b, bs, bitmapp, sector,
+		    BLOCK_FLAGS_NONE);
+		if (rc != EOK) {
+			(void) exfat_node_put(fn);
+			goto error;
+		}
+
+		memcpy(bc->map + sector * BPS(bs), b->data,
+		    min(BPS(bs), size - sector * BPS(bs)));
+
+		rc = block_put(b);
+		if (rc != EOK) {
+			(void) exfat_node_put(fn);
+			goto error;
+		}
 	}
-	bitmap = (uint8_t *)b->data;
-	bitmap[offset % BPS(bs)] &= ~(1 << (clst % 8));
 
-	b->dirty = true;
-	rc = block_put(b);
-	if (rc != EOK) {
-		(void) exfat_node_put(fn);
-		return rc;
+	rc = exfat_node_put(fn);
+	if (rc != EOK)
+		goto error;
+
+	fibril_mutex_lock(&bitmap_cache_lock);
+	list_append(&bc->link, &bitmap_cache_list);
+	fibril_mutex_unlock(&bitmap_cache_lock);
+
+	return EOK;
+
+error:
+	free(bc->map);
+	free(bc);
+	return rc;
+}
+
+/** Release the in-memory Allocation Bitmap of a file system.
+ *
+ * @param service_id	Service ID of the file system.
+ */
+void exfat_bitmap_fini_by_service_id(service_id_t service_id)
+{
+	exfat_bitmap_cache_t *bc;
+
+	fibril_mutex_lock(&bitmap_cache_lock);
+	list_foreach(bitmap_cache_list, link, exfat_bitmap_cache_t, cur) {
+		if (cur->service_id == service_id) {
+			bc = cur;
+			list_remove(&bc->link);
+			fibril_mutex_unlock(&bitmap_cache_lock);
+
+			/* Wait for any user of the cache to finish */
+			fibril_mutex_lock(&bc->lock);
+			fibril_mutex_unlock(&bc->lock);
+			free(bc->map);
+			free(bc);
+			return;
+		}
 	}
+	fibril_mutex_unlock(&bitmap_cache_lock);
+}
 
-	return exfat_node_put(fn);
+/** Count the free clusters of a file system.
+ *
+ * @param bs		Buffer holding the boot sector of the file system.
+ * @param service_id	Service ID of the file system.
+ * @param count		Output parameter for the number of free clusters.
+ *
+ * @return		EOK on success or an error code.
+ */
+errno_t exfat_bitmap_count_free(exfat_bs_t *bs, service_id_t service_id,
+    uint64_t *count)
+{
+	exfat_bitmap_cache_t *bc;
+	exfat_cluster_t bit;
+	uint64_t free_count = 0;
+
+	bc = bitmap_cache_get(service_id);
+	if (!bc)
+		return ENOENT;
+
+	for (bit = 0; bit < bc->clusters; bit++) {
+		if (bit % 8 == 0 && bc->clusters - bit >= 8 &&
+		    bc->map[bit / 8] == 0xff) {
+			bit += 7;
+			continue;
+		}
+		if (!bitmap_test(bc, bit))
+			free_count++;
+	}
+
+	bitmap_cache_put(bc);
+	*count = free_count;
+	return EOK;
+}
+
+errno_t exfat_bitmap_is_free(exfat_bs_t *bs, service_id_t service_id,
+    exfat_cluster_t clst)
+{
+	exfat_bitmap_cache_t *bc;
+	bool alloc;
+
+	bc = bitmap_cache_get(service_id);
+	if (!bc)
+		return ENOENT;
+
+	clst -= EXFAT_CLST_FIRST;
+	alloc = clst >= bc->clusters || bitmap_test(bc, clst);
+	bitmap_cache_put(bc);
+
+	if (alloc)
+		return ENOENT;
+
+	return EOK;
+}
+
+errno_t exfat_bitmap_set_cluster(exfat_bs_t *bs, service_id_t service_id,
+    exfat_cluster_t clst)
+{
+	return exfat_bitmap_set_clusters(bs, service_id, clst, 1);
+}
+
+errno_t exfat_bitmap_clear_cluster(exfat_bs_t *bs, service_id_t service_id,
+    exfat_cluster_t clst)
+{
+	return exfat_bitmap_clear_clusters(bs, service_id, clst, 1);
 }
 
 errno_t exfat_bitmap_set_clusters(exfat_bs_t *bs, service_id_t service_id,
     exfat_cluster_t firstc, exfat_cluster_t count)
 {
+	exfat_bitmap_cache_t *bc;
 	errno_t rc;
-	exfat_cluster_t clst;
-	clst = firstc;
 
-	while (clst < firstc + count) {
-		rc = exfat_bitmap_set_cluster(bs, service_id, clst);
-		if (rc != EOK) {
-			if (clst - firstc > 0)
-				(void) exfat_bitmap_clear_clusters(bs, service_id,
-				    firstc, clst - firstc);
-			return rc;
-		}
-		clst++;
-	}
-	return EOK;
+	bc = bitmap_cache_get(service_id);
+	if (!bc)
+		return ENOENT;
+
+	rc = bitmap_update(bs, bc, firstc - EXFAT_CLST_FIRST, count, true);
+	bitmap_cache_put(bc);
+	return rc;
 }
 
 errno_t exfat_bitmap_clear_clusters(exfat_bs_t *bs, service_id_t service_id,
     exfat_cluster_t firstc, exfat_cluster_t count)
 {
+	exfat_bitmap_cache_t *bc;
 	errno_t rc;
-	exfat_cluster_t clst;
-	clst = firstc;
 
-	while (clst < firstc + count) {
-		rc = exfat_bitmap_clear_cluster(bs, service_id, clst);
-		if (rc != EOK)
-			return rc;
-		clst++;
-	}
-	return EOK;
+	bc = bitmap_cache_get(service_id);
+	if (!bc)
+		return ENOENT;
+
+	rc = bitmap_update(bs, bc, firstc - EXFAT_CLST_FIRST, count, false);
+	bitmap_cache_put(bc);
+	return rc;
 }
 
+/** Allocate a contiguous run of clusters.
+ *
+ * The run is preferably placed so that EXFAT_PREALLOC_CLUSTERS free
+ * clusters follow it, which lets a growing file stay contiguous.
+ */
 errno_t exfat_bitmap_alloc_clusters(exfat_bs_t *bs, service_id_t service_id,
     exfat_cluster_t *firstc, exfat_cluster_t count)
 {
-	exfat_cluster_t startc, endc;
-	startc = EXFAT_CLST_FIRST;
-
-	while (startc < DATA_CNT(bs) + 2) {
-		endc = startc;
-		while (exfat_bitmap_is_free(bs, service_id, endc) == EOK) {
-			if ((endc - startc) + 1 == count) {
-				*firstc = startc;
-				return exfat_bitmap_set_clusters(bs, service_id, startc, count);
-			} else
-				endc++;
+	exfat_bitmap_cache_t *bc;
+	exfat_cluster_t start;
+	exfat_cluster_t slack = EXFAT_PREALLOC_CLUSTERS;
+	errno_t rc;
+
+	bc = bitmap_cache_get(service_id);
+	if (!bc)
+		return ENOENT;
+
+	if (!bitmap_find_run(bc, bc->next, count + slack, &start) &&
+	    !bitmap_find_run(bc, 0, count + slack, &start)) {
+		slack = 0;
+		if (!bitmap_find_run(bc, 0, count, &start)) {
+			bitmap_cache_put(bc);
+			return ENOSPC;
 		}
-		startc = endc + 1;
 	}
-	return ENOSPC;
+
+	rc = bitmap_update(bs, bc, start, count, true);
+	if (rc == EOK) {
+		*firstc = start + EXFAT_CLST_FIRST;
+		bc->next = start + count + slack;
+	}
+
+	bitmap_cache_put(bc);
+	return rc;
 }
 
 
@@ -223,18 +473,25 @@ errno_t exfat_bitmap_append_clusters(exfat_bs_t *bs, exfat_node_t *nodep,
 		return exfat_bitmap_alloc_clusters(bs, nodep->idx->service_id,
 		    &nodep->firstc, count);
 	} else {
-		exfat_cluster_t lastc, clst;
+		exfat_bitmap_cache_t *bc;
+		exfat_cluster_t lastc;
+		errno_t rc;
+
 		lastc = nodep->firstc + ROUND_UP(nodep->size, BPC(bs)) / BPC(bs) - 1;
 
-		clst = lastc + 1;
-		while (exfat_bitmap_is_free(bs, nodep->idx->service_id, clst) == EOK) {
-			if (clst - lastc == count) {
-				return exfat_bitmap_set_clusters(bs, nodep->idx->service_id,
-				    lastc + 1, count);
-			} else
-				clst++;
+		bc = bitmap_cache_get(nodep->idx->service_id);
+		if (!bc)
+			return ENOENT;
+
+		if (!bitmap_range_free(bc, lastc + 1 - EXFAT_CLST_FIRST, count)) {
+			bitmap_cache_put(bc);
+			return ENOSPC;
 		}
-		return ENOSPC;
+
+		rc = bitmap_update(bs, bc, lastc + 1 - EXFAT_CLST_FIRST, count,
+		    true);
+		bitmap_cache_put(bc);
+		return rc;
 	}
 }
 
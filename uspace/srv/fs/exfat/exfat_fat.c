@@ -133,30 +133,37 @@ exfat_block_get(block_t **block, exfat_bs_t *bs, exfat_node_t *nodep,
 	if (!nodep->size)
 		return ELIMIT;
 
-	if (nodep->fragmented) {
-		if (((((nodep->size - 1) / BPS(bs)) / SPC(bs)) == bn / SPC(bs)) &&
-		    nodep->lastc_cached_valid) {
-			/*
-			 * This is a request to read a block within the last cluster
-			 * when fortunately we have the last cluster number cached.
-			 */
-			return block_get(block, nodep->idx->service_id, DATA_FS(bs) +
-			    (nodep->lastc_cached_value - EXFAT_CLST_FIRST) * SPC(bs) +
-			    (bn % SPC(bs)), flags);
-		}
+	if (!nodep->fragmented) {
+		/*
+		 * Contiguous files need neither FAT lookups nor the "current"
+		 * cluster cache, the block is computed directly.
+		 */
+		return exfat_block_get_by_clst(block, bs,
+		    nodep->idx->service_id, false, firstc, NULL, bn, flags);
+	}
 
-		if (nodep->currc_cached_valid && bn >= nodep->currc_cached_bn) {
-			/*
-			 * We can start with the cluster cached by the previous call to
-			 * fat_block_get().
-			 */
-			firstc = nodep->currc_cached_value;
-			relbn -= (nodep->currc_cached_bn / SPC(bs)) * SPC(bs);
-		}
+	if (((((nodep->size - 1) / BPS(bs)) / SPC(bs)) == bn / SPC(bs)) &&
+	    nodep->lastc_cached_valid) {
+		/*
+		 * This is a request to read a block within the last cluster
+		 * when fortunately we have the last cluster number cached.
+		 */
+		return block_get(block, nodep->idx->service_id, DATA_FS(bs) +
+		    (nodep->lastc_cached_value - EXFAT_CLST_FIRST) * SPC(bs) +
+		    (bn % SPC(bs)), flags);
+	}
+
+	if (nodep->currc_cached_valid && bn >= nodep->currc_cached_bn) {
+		/*
+		 * We can start with the cluster cached by the previous call to
+		 * fat_block_get().
+		 */
+		firstc = nodep->currc_cached_value;
+		relbn -= (nodep->currc_cached_bn / SPC(bs)) * SPC(bs);
 	}
 
 	rc = exfat_block_get_by_clst(block, bs, nodep->idx->service_id,
-	    nodep->fragmented, firstc, &currc, relbn, flags);
+	    true, firstc, &currc, relbn, flags);
 	if (rc != EOK)
 		return rc;
 
@@ -935,61 +935,10 @@ errno_t exfat_total_block_count(service_id_t service_id, uint64_t *count)
 
 errno_t exfat_free_block_count(service_id_t service_id, uint64_t *count)
 {
-	fs_node_t *node = NULL;
-	exfat_node_t *bmap_node;
 	exfat_bs_t *bs;
-	uint64_t free_block_count = 0;
-	uint64_t block_count;
-	unsigned sector;
-	errno_t rc;
-
-	rc = exfat_total_block_count(service_id, &block_count);
-	if (rc != EOK)
-		goto exit;
 
 	bs = block_bb_get(service_id);
-	rc = exfat_bitmap_get(&node, service_id);
-	if (rc != EOK)
-		goto exit;
-
-	bmap_node = (exfat_node_t *) node->data;
-
-	unsigned const bmap_sectors = ROUND_UP(bmap_node->size, BPS(bs)) /
-	    BPS(bs);
-
-	for (sector = 0; sector < bmap_sectors; ++sector) {
-
-		block_t *block;
-		uint8_t *bitmap;
-		unsigned bit;
-
-		rc = exfat_block_get(&block, bs, bmap_node, sector,
-		    BLOCK_FLAGS_NONE);
-		if (rc != EOK) {
-			free_block_count = 0;
-			goto exit;
-		}
-
-		bitmap = (uint8_t *) block->data;
-
-		for (bit = 0; bit < BPS(bs) * 8 && block_count > 0;
-		    ++bit, --block_count) {
-			if (!(bitmap[bit / 8] & (1 << (bit % 8))))
-				++free_block_count;
-		}
-
-		block_put(block);
-
-		if (block_count == 0) {
-			/* Reached the end of the bitmap */
-			goto exit;
-		}
-	}
-
-exit:
-	exfat_node_put(node);
-	*count = free_block_count;
-	return rc;
+	return exfat_bitmap_count_free(bs, service_id, count);
 }
 
 /** libfs operations */
@@ -1303,6 +1252,13 @@ exfat_mounted(service_id_t service_id, const char *opts, fs_index_t *index,
 	if (rc != EOK)
 		return rc;
 
+	rc = exfat_bitmap_init_by_service_id(block_bb_get(service_id),
+	    service_id);
+	if (rc != EOK) {
+		exfat_fs_close(service_id, rfn);
+		return rc;
+	}
+
 	*index = ridxp->index;
 	*size = EXFAT_NODE(rfn)->size;
 
@@ -1319,6 +1275,7 @@ static errno_t exfat_unmounted(service_id_t service_id)
 		return rc;
 
 	exfat_fs_close(service_id, rfn);
+	exfat_bitmap_fini_by_service_id(service_id);
 	return EOK;
 }
 
@@ -1461,7 +1418,10 @@ static errno_t exfat_sync(service_id_t service_id, fs_index_t index)
 	rc = exfat_node_sync(nodep);
 
 	exfat_node_put(fn);
-	return rc;
+	if (rc != EOK)
+		return rc;
+
+	return block_cache_sync(service_id);
 }
 
 static errno_t
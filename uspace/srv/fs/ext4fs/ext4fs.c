@@ -49,6 +49,7 @@
 
 vfs_info_t ext4fs_vfs_info = {
 	.name = NAME,
+	.cacheable = true,
 	.instance = 0
 };
 
@@ -36,6 +36,7 @@
 
 #include "fat_fat.h"
 #include <fibril_synch.h>
+#include <adt/hash_table.h>
 #include <libfs.h>
 #include <atomic.h>
 #include <stdint.h>
@@ -223,6 +224,16 @@ typedef struct {
 } fat_idx_t;
 
 /** FAT in-core node. */
+/** Run of physically contiguous clusters of a node. */
+typedef struct {
+	/** Logical cluster number of the first cluster in the run. */
+	uint32_t	lcn;
+	/** Cluster number of the first cluster in the run. */
+	fat_cluster_t	pcn;
+	/** Number of clusters in the run. */
+	uint32_t	count;
+} fat_extent_t;
+
 typedef struct fat_node {
 	/** Back pointer to the FS node. */
 	fs_node_t		*bp;
@@ -244,16 +255,32 @@ typedef struct fat_node {
 	bool			dirty;
 
 	/*
-	 * Cache of the node's last and "current" cluster to avoid some
-	 * unnecessary FAT walks.
+	 * Cache of the node's last cluster to avoid some unnecessary FAT
+	 * walks.
 	 */
-	/* Node's last cluster in FAT. */
 	bool		lastc_cached_valid;
 	fat_cluster_t	lastc_cached_value;
-	/* Node's "current" cluster, i.e. where the last I/O took place. */
-	bool		currc_cached_valid;
-	aoff64_t	currc_cached_bn;
-	fat_cluster_t	currc_cached_value;
+
+	/*
+	 * Extent map of the beginning of the node's cluster chain. It is
+	 * populated lazily as the node is accessed and sorted by the logical
+	 * cluster number.
+	 */
+	fat_extent_t	*extents;
+	/* Number of valid entries in extents. */
+	size_t		extents_count;
+	/* Number of allocated entries in extents. */
+	size_t		extents_size;
+	/* Number of clusters covered by extents. */
+	uint32_t	extents_clusters;
+
+	/*
+	 * Name lookup cache of a directory node. It maps names to dentry
+	 * positions, is built lazily by fat_match() and is dropped whenever
+	 * the directory is modified.
+	 */
+	fibril_mutex_t	dcache_lock;
+	hash_table_t	*dcache;
 } fat_node_t;
 
 typedef struct {
@@ -44,6 +44,10 @@
 #include <str.h>
 #include <align.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <adt/hash.h>
+#include <adt/hash_table.h>
 
 errno_t fat_directory_open(fat_node_t *nodep, fat_directory_t *di)
 {
@@ -249,6 +253,7 @@ errno_t fat_directory_erase(fat_directory_t *di)
 
 	d->name[0] = FAT_DENTRY_ERASED;
 	di->b->dirty = true;
+	fat_directory_cache_invalidate(di->nodep);
 
 	while (!flag && fat_directory_prev(di) == EOK) {
 		if (fat_directory_get(di, &d) == EOK &&
@@ -266,7 +271,8 @@ errno_t fat_directory_erase(fat_directory_t *di)
 	return EOK;
 }
 
-errno_t fat_directory_write(fat_directory_t *di, const char *name, fat_dentry_t *de)
+static errno_t fat_directory_write_name(fat_directory_t *di, const char *name,
+    fat_dentry_t *de)
 {
 	errno_t rc;
 	void *data;
@@ -347,6 +353,20 @@ errno_t fat_directory_write(fat_directory_t *di, const char *name, fat_dentry_t
 	return ENOTSUP;
 }
 
+errno_t fat_directory_write(fat_directory_t *di, const char *name, fat_dentry_t *de)
+{
+	errno_t rc;
+
+	rc = fat_directory_write_name(di, name, de);
+
+	/*
+	 * Drop the name cache only after the dentries are in place so that a
+	 * lookup racing with the update cannot leave a stale cache behind.
+	 */
+	fat_directory_cache_invalidate(di->nodep);
+	return rc;
+}
+
 errno_t fat_directory_create_sfn(fat_directory_t *di, fat_dentry_t *de,
     const char *lname)
 {
@@ -420,8 +440,8 @@ errno_t fat_directory_expand(fat_directory_t *di)
 		/* Can't grow the root directory on FAT12/16. */
 		return ENOSPC;
 	}
-	rc = fat_alloc_clusters(di->bs, di->nodep->idx->service_id, 1, &mcl,
-	    &lcl);
+	rc = fat_alloc_clusters(di->bs, di->nodep->idx->service_id, 1,
+	    FAT_CLST_RES0, &mcl, &lcl);
 	if (rc != EOK)
 		return rc;
 	rc = fat_zero_cluster(di->bs, di->nodep->idx->service_id, mcl);
@@ -561,6 +581,190 @@ errno_t fat_directory_vollabel_get(fat_directory_t *di, char *label)
 	return ENOENT;
 }
 
+/*
+ * Directory name cache.
+ *
+ * Names are matched by fat_dentry_namecmp(), i.e. case-insensitively and with
+ * an optional trailing dot for names without an extension. The hash function
+ * folds names the same way so that all names considered equal share a bucket.
+ */
+
+typedef struct {
+	ht_link_t link;
+	/** Name as returned by fat_directory_read(). */
+	char *name;
+	/** Absolute position of the short name dentry. */
+	aoff64_t pos;
+} fat_dcache_entry_t;
+
+static size_t dcache_key_hash(void *key)
+{
+	const char *name = (const char *) key;
+	size_t size = str_size(name);
+	size_t off = 0;
+	size_t hash = 0;
+	wchar_t c;
+
+	/* "NAME." and "NAME" are the same name. */
+	if (size > 0 && name[size - 1] == '.' &&
+	    str_chr(name, '.') == &name[size - 1])
+		size--;
+
+	while ((c = str_decode(name, &off, size)) != 0)
+		hash = hash_combine(hash, tolower(c));
+
+	return hash;
+}
+
+static size_t dcache_hash(const ht_link_t *item)
+{
+	fat_dcache_entry_t *entry = hash_table_get_inst(item,
+	    fat_dcache_entry_t, link);
+	return dcache_key_hash(entry->name);
+}
+
+static bool dcache_key_equal(void *key, const ht_link_t *item)
+{
+	fat_dcache_entry_t *entry = hash_table_get_inst(item,
+	    fat_dcache_entry_t, link);
+	char name[FAT_LFN_NAME_SIZE];
+
+	/* fat_dentry_namecmp() may append a dot to the name. */
+	str_cpy(name, sizeof(name), entry->name);
+	return fat_dentry_namecmp(name, (const char *) key) == 0;
+}
+
+static void dcache_remove_callback(ht_link_t *item)
+{
+	fat_dcache_entry_t *entry = hash_table_get_inst(item,
+	    fat_dcache_entry_t, link);
+	free(entry->name);
+	free(entry);
+}
+
+/** FAT directory name cache operations. */
+static hash_table_ops_t dcache_ops = {
+	.hash = dcache_hash,
+	.key_hash = dcache_key_hash,
+	.key_equal = dcache_key_equal,
+	.equal = NULL,
+	.remove_callback = dcache_remove_callback
+};
+
+static void fat_directory_cache_destroy(hash_table_t *dcache)
+{
+	hash_table_destroy(dcache);
+	free(dcache);
+}
+
+/** Read all names of a directory into a new name cache. */
+static errno_t fat_directory_cache_build(fat_node_t *nodep,
+    hash_table_t **rdcache)
+{
+	char name[FAT_LFN_NAME_SIZE];
+	fat_directory_t di;
+	fat_dentry_t *d;
+	hash_table_t *dcache;
+	errno_t rc;
+
+	dcache = malloc(sizeof(hash_table_t));
+	if (!dcache)
+		return ENOMEM;
+	if (!hash_table_create(dcache, 0, 0, &dcache_ops)) {
+		free(dcache);
+		return ENOMEM;
+	}
+
+	rc = fat_directory_open(nodep, &di);
+	if (rc != EOK) {
+		fat_directory_cache_destroy(dcache);
+		return rc;
+	}
+
+	while ((rc = fat_directory_read(&di, name, &d)) == EOK) {
+		/*
+		 * Keep only the first of the names that compare equal, the
+		 * same one a linear scan of the directory would find.
+		 */
+		if (!hash_table_find(dcache, name)) {
+			fat_dcache_entry_t *entry;
+
+			entry = malloc(sizeof(fat_dcache_entry_t));
+			if (entry)
+				entry->name = str_dup(name);
+			if (!entry || !entry->name) {
+				free(entry);
+				rc = ENOMEM;
+				break;
+			}
+			entry->pos = di.pos;
+			hash_table_insert(dcache, &entry->link);
+		}
+
+		rc = fat_directory_next(&di);
+		if (rc != EOK)
+			break;
+	}
+
+	(void) fat_directory_close(&di);
+	if (rc != EOK && rc != ENOENT) {
+		fat_directory_cache_destroy(dcache);
+		return rc;
+	}
+
+	*rdcache = dcache;
+	return EOK;
+}
+
+/** Look up a name in a directory using the directory name cache.
+ *
+ * The cache is built on the first lookup and kept for as long as the node
+ * stays in memory and the directory is not modified.
+ *
+ * @param nodep		Directory node.
+ * @param component	Name to look up.
+ * @param pos		Place to store the absolute position of the short
+ *			name dentry.
+ *
+ * @return EOK if the name was found, ENOENT if it was not found, other error
+ *         code if the cache could not be built.
+ */
+errno_t fat_directory_cache_lookup(fat_node_t *nodep, const char *component,
+    aoff64_t *pos)
+{
+	fat_dcache_entry_t *entry;
+	ht_link_t *link;
+	errno_t rc = EOK;
+
+	fibril_mutex_lock(&nodep->dcache_lock);
+	if (!nodep->dcache)
+		rc = fat_directory_cache_build(nodep, &nodep->dcache);
+	if (rc == EOK) {
+		link = hash_table_find(nodep->dcache, (void *) component);
+		if (link) {
+			entry = hash_table_get_inst(link, fat_dcache_entry_t,
+			    link);
+			*pos = entry->pos;
+		} else {
+			rc = ENOENT;
+		}
+	}
+	fibril_mutex_unlock(&nodep->dcache_lock);
+
+	return rc;
+}
+
+/** Drop the name cache of a directory node. */
+void fat_directory_cache_invalidate(fat_node_t *nodep)
+{
+	fibril_mutex_lock(&nodep->dcache_lock);
+	if (nodep->dcache) {
+		fat_directory_cache_destroy(nodep->dcache);
+		nodep->dcache = NULL;
+	}
+	fibril_mutex_unlock(&nodep->dcache_lock);
+}
+
 /**
  * @}
  */
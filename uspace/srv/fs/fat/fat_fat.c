@@ -46,19 +46,70 @@
 #include <byteorder.h>
 #include <align.h>
 #include <assert.h>
+#include <fibril.h>
 #include <fibril_synch.h>
+#include <adt/list.h>
 #include <mem.h>
 #include <stdlib.h>
+#include <macros.h>
 
 #define IS_ODD(number)	(number & 0x1)
 
+/** Number of clusters scanned by the bitmap builder at a time. */
+#define FAT_BITMAP_CHUNK	1024
+
+/**
+ * Number of clusters reserved after the chain allocated for a file that does
+ * not continue its previous run. Other files get allocated beyond the reserved
+ * clusters so that files written in parallel do not interleave.
+ */
+#define FAT_PREALLOC_CLUSTERS	64
+
+/**
+ * In-memory map of the free clusters of a mounted file system. The map is
+ * built by a background fibril. Until the map is complete, clusters are
+ * allocated by scanning the FAT.
+ */
+typedef struct {
+	link_t link;
+	service_id_t service_id;
+	fat_bs_t *bs;
+
+	/** One bit per cluster, set if the cluster is in use. */
+	uint32_t *map;
+	/** Number of clusters in the map. */
+	uint32_t count;
+	/** Number of clusters already scanned by the builder. */
+	uint32_t scanned;
+	/** Map index where the next search for free clusters starts. */
+	uint32_t next;
+
+	/** The builder fibril is running. */
+	bool running;
+	/** The builder fibril should terminate. */
+	bool stop;
+	/** Signalled when the builder fibril terminates. */
+	fibril_condvar_t done_cv;
+} fat_bitmap_t;
+
 /**
  * The fat_alloc_lock mutex protects all copies of the File Allocation Table
- * during allocation of clusters. The lock does not have to be held durring
- * deallocation of clusters.
+ * during allocation of clusters and the free cluster bitmaps. The lock does
+ * not have to be held durring deallocation of clusters, except for updating
+ * the bitmap.
  */
 static FIBRIL_MUTEX_INITIALIZE(fat_alloc_lock);
 
+/** List of free cluster bitmaps, protected by fat_alloc_lock. */
+static LIST_INITIALIZE(fat_bitmap_list);
+
+/**
+ * Maximum number of extents cached for a node. Clusters of more fragmented
+ * nodes beyond the cached extents are found by walking the FAT from the end
+ * of the last cached extent.
+ */
+#define FAT_EXTENTS_MAX		4096
+
 /** Walk the cluster chain.
  *
  * @param bs		Buffer holding the boot sector for the file.
@@ -112,6 +163,129 @@ fat_cluster_walk(fat_bs_t *bs, service_id_t service_id, fat_cluster_t firstc,
 	return EOK;
 }
 
+/** Record a cluster at the end of the node's extent map.
+ *
+ * @param nodep		FAT node.
+ * @param c		Cluster following the last mapped cluster of the node.
+ *
+ * @return		True if the cluster was recorded, false if the map
+ *			cannot grow any further.
+ */
+static bool fat_extent_append(fat_node_t *nodep, fat_cluster_t c)
+{
+	fat_extent_t *last = NULL;
+
+	if (nodep->extents_count > 0) {
+		last = &nodep->extents[nodep->extents_count - 1];
+		if (last->pcn + last->count == c) {
+			last->count++;
+			nodep->extents_clusters++;
+			return true;
+		}
+	}
+
+	if (nodep->extents_count == nodep->extents_size) {
+		if (nodep->extents_size == FAT_EXTENTS_MAX)
+			return false;
+
+		size_t nsize = max(nodep->extents_size * 2, 8);
+		nsize = min(nsize, FAT_EXTENTS_MAX);
+		fat_extent_t *nextents = realloc(nodep->extents,
+		    nsize * sizeof(fat_extent_t));
+		if (!nextents)
+			return false;
+		nodep->extents = nextents;
+		nodep->extents_size = nsize;
+	}
+
+	fat_extent_t *e = &nodep->extents[nodep->extents_count++];
+	e->lcn = nodep->extents_clusters++;
+	e->pcn = c;
+	e->count = 1;
+	return true;
+}
+
+/** Find the cluster holding a logical cluster of a node.
+ *
+ * Clusters covered by the node's extent map are found by a binary search.
+ * Otherwise the FAT chain is followed from the end of the map, extending the
+ * map with the clusters visited.
+ *
+ * @param bs		Buffer holding the boot sector of the file system.
+ * @param nodep		FAT node.
+ * @param lcn		Logical cluster number within the node.
+ * @param clp		Place to store the cluster number.
+ *
+ * @return		EOK on success or an error code.
+ */
+static errno_t fat_extent_lookup(fat_bs_t *bs, fat_node_t *nodep,
+    uint32_t lcn, fat_cluster_t *clp)
+{
+	fat_cluster_t clst_last1 = FAT_CLST_LAST1(bs);
+	fat_cluster_t c;
+	uint32_t n;
+	errno_t rc;
+
+	if (lcn < nodep->extents_clusters) {
+		size_t lo = 0;
+		size_t hi = nodep->extents_count;
+
+		while (hi - lo > 1) {
+			size_t mid = lo + (hi - lo) / 2;
+			if (nodep->extents[mid].lcn <= lcn)
+				lo = mid;
+			else
+				hi = mid;
+		}
+
+		fat_extent_t *e = &nodep->extents[lo];
+		assert(lcn >= e->lcn && lcn < e->lcn + e->count);
+		*clp = e->pcn + (lcn - e->lcn);
+		return EOK;
+	}
+
+	if (nodep->extents_count == 0) {
+		c = nodep->firstc;
+	} else {
+		fat_extent_t *last = &nodep->extents[nodep->extents_count - 1];
+		rc = fat_get_cluster(bs, nodep->idx->service_id, FAT1,
+		    last->pcn + last->count - 1, &c);
+		if (rc != EOK)
+			return rc;
+	}
+
+	for (n = nodep->extents_clusters; ; n++) {
+		if (c < FAT_CLST_FIRST || c >= clst_last1)
+			return EIO;
+
+		if (n == nodep->extents_clusters)
+			(void) fat_extent_append(nodep, c);
+
+		if (n == lcn)
+			break;
+
+		rc = fat_get_cluster(bs, nodep->idx->service_id, FAT1, c, &c);
+		if (rc != EOK)
+			return rc;
+	}
+
+	*clp = c;
+	return EOK;
+}
+
+/** Forget the extent map of a node.
+ *
+ * @param nodep		FAT node.
+ */
+void fat_extents_free(fat_node_t *nodep)
+{
+	free(nodep->extents);
+	nodep->extents = NULL;
+	nodep->extents_count = 0;
+	nodep->extents_size = 0;
+	nodep->extents_clusters = 0;
+}
+
 /** Read block from file located on a FAT file system.
  *
  * @param block		Pointer to a block pointer for storing result.
@@ -126,16 +300,16 @@ errno_t
 fat_block_get(block_t **block, struct fat_bs *bs, fat_node_t *nodep,
     aoff64_t bn, int flags)
 {
-	fat_cluster_t firstc = nodep->firstc;
-	fat_cluster_t currc = 0;
-	aoff64_t relbn = bn;
+	fat_cluster_t c;
 	errno_t rc;
 
 	if (!nodep->size)
 		return ELIMIT;
 
-	if (!FAT_IS_FAT32(bs) && nodep->firstc == FAT_CLST_ROOT)
-		goto fall_through;
+	if (!FAT_IS_FAT32(bs) && nodep->firstc == FAT_CLST_ROOT) {
+		return _fat_block_get(block, bs, nodep->idx->service_id,
+		    nodep->firstc, NULL, bn, flags);
+	}
 
 	if (((((nodep->size - 1) / BPS(bs)) / SPC(bs)) == bn / SPC(bs)) &&
 	    nodep->lastc_cached_valid) {
@@ -147,29 +321,12 @@ fat_block_get(block_t **block, struct fat_bs *bs, fat_node_t *nodep,
 		    CLBN2PBN(bs, nodep->lastc_cached_value, bn), flags);
 	}
 
-	if (nodep->currc_cached_valid && bn >= nodep->currc_cached_bn) {
-		/*
-		 * We can start with the cluster cached by the previous call to
-		 * fat_block_get().
-		 */
-		firstc = nodep->currc_cached_value;
-		relbn -= (nodep->currc_cached_bn / SPC(bs)) * SPC(bs);
-	}
-
-fall_through:
-	rc = _fat_block_get(block, bs, nodep->idx->service_id, firstc,
-	    &currc, relbn, flags);
+	rc = fat_extent_lookup(bs, nodep, bn / SPC(bs), &c);
 	if (rc != EOK)
 		return rc;
 
-	/*
-	 * Update the "current" cluster cache.
-	 */
-	nodep->currc_cached_valid = true;
-	nodep->currc_cached_bn = bn;
-	nodep->currc_cached_value = currc;
-
-	return rc;
+	return block_get(block, nodep->idx->service_id, CLBN2PBN(bs, c, bn),
+	    flags);
 }
 
 /** Read block from file located on a FAT file system.
@@ -655,6 +812,261 @@ errno_t fat_alloc_shadow_clusters(fat_bs_t *bs, service_id_t service_id,
 	return EOK;
 }
 
+static fat_bitmap_t *fat_bitmap_find(service_id_t service_id)
+{
+	assert(fibril_mutex_is_locked(&fat_alloc_lock));
+
+	list_foreach(fat_bitmap_list, link, fat_bitmap_t, bm) {
+		if (bm->service_id == service_id)
+			return bm;
+	}
+
+	return NULL;
+}
+
+static inline bool fat_bitmap_test(fat_bitmap_t *bm, uint32_t i)
+{
+	return (bm->map[i / 32] & (1U << (i % 32))) != 0;
+}
+
+static inline void fat_bitmap_set(fat_bitmap_t *bm, fat_cluster_t clst,
+    bool used)
+{
+	uint32_t i = clst - FAT_CLST_FIRST;
+
+	assert(i < bm->count);
+	if (used)
+		bm->map[i / 32] |= 1U << (i % 32);
+	else
+		bm->map[i / 32] &= ~(1U << (i % 32));
+}
+
+/** Fibril building the free cluster bitmap from FAT1. */
+static errno_t fat_bitmap_builder(void *arg)
+{
+	fat_bitmap_t *bm = (fat_bitmap_t *) arg;
+	fat_cluster_t value;
+	errno_t rc;
+
+	fibril_mutex_lock(&fat_alloc_lock);
+	while (!bm->stop && bm->scanned < bm->count) {
+		uint32_t end = min(bm->scanned + FAT_BITMAP_CHUNK, bm->count);
+
+		while (bm->scanned < end) {
+			fat_cluster_t clst = bm->scanned + FAT_CLST_FIRST;
+
+			rc = fat_get_cluster(bm->bs, bm->service_id, FAT1,
+			    clst, &value);
+			if (rc != EOK) {
+				/* Leave the bitmap incomplete and unused. */
+				bm->stop = true;
+				break;
+			}
+
+			fat_bitmap_set(bm, clst, value != FAT_CLST_RES0);
+			bm->scanned++;
+		}
+
+		/* Let allocations proceed between chunks. */
+		fibril_mutex_unlock(&fat_alloc_lock);
+		fibril_yield();
+		fibril_mutex_lock(&fat_alloc_lock);
+	}
+
+	bm->running = false;
+	fibril_condvar_broadcast(&bm->done_cv);
+	fibril_mutex_unlock(&fat_alloc_lock);
+
+	return EOK;
+}
+
+/** Start building the free cluster bitmap of a file system.
+ *
+ * The bitmap is an optimization only. If it cannot be created, clusters are
+ * allocated by scanning the FAT.
+ *
+ * @param bs		Buffer holding the boot sector of the file system.
+ * @param service_id	Device service ID of the file system.
+ */
+void fat_bitmap_init_by_service_id(fat_bs_t *bs, service_id_t service_id)
+{
+	fat_bitmap_t *bm;
+
+	bm = (fat_bitmap_t *) malloc(sizeof(fat_bitmap_t));
+	if (!bm)
+		return;
+
+	link_initialize(&bm->link);
+	bm->service_id = service_id;
+	bm->bs = bs;
+	bm->count = CC(bs);
+	bm->scanned = 0;
+	bm->next = 0;
+	bm->running = true;
+	bm->stop = false;
+	fibril_condvar_initialize(&bm->done_cv);
+
+	bm->map = calloc((bm->count + 31) / 32, sizeof(uint32_t));
+	if (!bm->map) {
+		free(bm);
+		return;
+	}
+
+	fid_t fid = fibril_create(fat_bitmap_builder, bm);
+	if (fid == 0) {
+		free(bm->map);
+		free(bm);
+		return;
+	}
+
+	fibril_mutex_lock(&fat_alloc_lock);
+	list_append(&bm->link, &fat_bitmap_list);
+	fibril_mutex_unlock(&fat_alloc_lock);
+
+	fibril_add_ready(fid);
+}
+
+/** Destroy the free cluster bitmap of a file system.
+ *
+ * @param service_id	Device service ID of the file system.
+ */
+void fat_bitmap_fini_by_service_id(service_id_t service_id)
+{
+	fat_bitmap_t *bm;
+
+	fibril_mutex_lock(&fat_alloc_lock);
+	bm = fat_bitmap_find(service_id);
+	if (!bm) {
+		fibril_mutex_unlock(&fat_alloc_lock);
+		return;
+	}
+
+	list_remove(&bm->link);
+	bm->stop = true;
+	while (bm->running)
+		fibril_condvar_wait(&bm->done_cv, &fat_alloc_lock);
+	fibril_mutex_unlock(&fat_alloc_lock);
+
+	free(bm->map);
+	free(bm);
+}
+
+/** Find a run of free clusters in the bitmap.
+ *
+ * The search starts at the next-fit position and wraps around.
+ *
+ * @param bm		Free cluster bitmap.
+ * @param len		Length of the run.
+ * @param start		Place to store the map index of the run.
+ *
+ * @return		True if such run was found.
+ */
+static bool fat_bitmap_find_run(fat_bitmap_t *bm, uint32_t len,
+    uint32_t *start)
+{
+	uint32_t first = bm->next < bm->count ? bm->next : 0;
+	uint32_t i = first;
+	uint32_t run = 0;
+	bool wrapped = false;
+
+	while (!wrapped || i < first) {
+		if (i == bm->count) {
+			/* Runs do not wrap around the end of the map. */
+			i = 0;
+			run = 0;
+			wrapped = true;
+			continue;
+		}
+
+		if (i % 32 == 0 && i + 32 <= bm->count &&
+		    bm->map[i / 32] == (uint32_t) -1) {
+			/* Skip a fully used word. */
+			i += 32;
+			run = 0;
+			continue;
+		}
+
+		if (fat_bitmap_test(bm, i)) {
+			run = 0;
+		} else if (++run == len) {
+			*start = i + 1 - len;
+			return true;
+		}
+		i++;
+	}
+
+	return false;
+}
+
+/** Pick free clusters from the bitmap and mark them as used.
+ *
+ * The clusters are returned in the order used by fat_alloc_clusters(), i.e.
+ * the last cluster of the chain first.
+ *
+ * @param bm		Complete free cluster bitmap.
+ * @param nclsts	Number of clusters to pick.
+ * @param hint		Preferred first cluster or FAT_CLST_RES0.
+ * @param lifo		Array for storing the clusters.
+ *
+ * @return		EOK on success, ENOSPC if there are not enough free
+ *			clusters.
+ */
+static errno_t fat_bitmap_alloc(fat_bitmap_t *bm, unsigned nclsts,
+    fat_cluster_t hint, fat_cluster_t *lifo)
+{
+	uint32_t start;
+	unsigned c;
+
+	/* Continue the run preferred by the caller if possible. */
+	if (hint >= FAT_CLST_FIRST && hint - FAT_CLST_FIRST < bm->count &&
+	    bm->count - (hint - FAT_CLST_FIRST) >= nclsts) {
+		start = hint - FAT_CLST_FIRST;
+		for (c = 0; c < nclsts; c++) {
+			if (fat_bitmap_test(bm, start + c))
+				break;
+		}
+		if (c == nclsts)
+			goto found;
+	}
+
+	/* Start a new run with some room for the file to grow. */
+	if (hint != FAT_CLST_RES0 && nclsts < FAT_PREALLOC_CLUSTERS &&
+	    fat_bitmap_find_run(bm, FAT_PREALLOC_CLUSTERS, &start)) {
+		bm->next = start + FAT_PREALLOC_CLUSTERS;
+		goto found;
+	}
+
+	if (fat_bitmap_find_run(bm, nclsts, &start)) {
+		bm->next = start + nclsts;
+		goto found;
+	}
+
+	/* Fall back to any free clusters. */
+	uint32_t i = bm->next < bm->count ? bm->next : 0;
+	uint32_t seen;
+	c = 0;
+	for (seen = 0; seen < bm->count && c < nclsts; seen++) {
+		if (!fat_bitmap_test(bm, i))
+			lifo[nclsts - 1 - c++] = i + FAT_CLST_FIRST;
+		if (++i == bm->count)
+			i = 0;
+	}
+	if (c < nclsts)
+		return ENOSPC;
+
+	bm->next = i;
+	for (c = 0; c < nclsts; c++)
+		fat_bitmap_set(bm, lifo[c], true);
+	return EOK;
+
+found:
+	for (c = 0; c < nclsts; c++) {
+		lifo[nclsts - 1 - c] = start + c + FAT_CLST_FIRST;
+		fat_bitmap_set(bm, start + c + FAT_CLST_FIRST, true);
+	}
+	return EOK;
+}
+
 /** Allocate clusters in all copies of FAT.
  *
  * This function will attempt to allocate the requested number of clusters in
@@ -665,6 +1077,9 @@ errno_t fat_alloc_shadow_clusters(fat_bs_t *bs, service_id_t service_id,
  * @param bs		Buffer holding the boot sector of the file system.
  * @param service_id	Device service ID of the file system.
  * @param nclsts	Number of clusters to allocate.
+ * @param hint		Preferred first cluster of the chain, usually the one
+ *			following the last cluster of the file being extended.
+ *			FAT_CLST_RES0 if the chain will not hold file data.
  * @param mcl		Output parameter where the first cluster in the chain
  *			will be returned.
  * @param lcl		Output parameter where the last cluster in the chain
@@ -674,23 +1089,42 @@ errno_t fat_alloc_shadow_clusters(fat_bs_t *bs, service_id_t service_id,
  */
 errno_t
 fat_alloc_clusters(fat_bs_t *bs, service_id_t service_id, unsigned nclsts,
-    fat_cluster_t *mcl, fat_cluster_t *lcl)
+    fat_cluster_t hint, fat_cluster_t *mcl, fat_cluster_t *lcl)
 {
 	fat_cluster_t *lifo;    /* stack for storing free cluster numbers */
 	unsigned found = 0;     /* top of the free cluster number stack */
+	unsigned picked = 0;	/* number of clusters marked in the bitmap */
 	fat_cluster_t clst;
 	fat_cluster_t value = 0;
 	fat_cluster_t clst_last1 = FAT_CLST_LAST1(bs);
+	fat_bitmap_t *bm;
 	errno_t rc = EOK;
 
 	lifo = (fat_cluster_t *) malloc(nclsts * sizeof(fat_cluster_t));
 	if (!lifo)
 		return ENOMEM;
 
+	fibril_mutex_lock(&fat_alloc_lock);
+	bm = fat_bitmap_find(service_id);
+	if (bm && bm->scanned == bm->count) {
+		/*
+		 * Pick the clusters from the bitmap and link them in FAT1.
+		 */
+		rc = fat_bitmap_alloc(bm, nclsts, hint, lifo);
+		if (rc == EOK)
+			picked = nclsts;
+		for (; rc == EOK && found < nclsts; found++) {
+			rc = fat_set_cluster(bs, service_id, FAT1, lifo[found],
+			    (found == 0) ?  clst_last1 : lifo[found - 1]);
+		}
+		if (rc != EOK && found > 0)
+			found--;
+		goto done;
+	}
+
 	/*
 	 * Search FAT1 for unused clusters.
 	 */
-	fibril_mutex_lock(&fat_alloc_lock);
 	for (clst = FAT_CLST_FIRST; clst < CC(bs) + 2 && found < nclsts;
 	    clst++) {
 		rc = fat_get_cluster(bs, service_id, FAT1, clst, &value);
@@ -708,10 +1142,14 @@ fat_alloc_clusters(fat_bs_t *bs, service_id_t service_id, unsigned nclsts,
 			if (rc != EOK)
 				break;
 
+			if (bm)
+				fat_bitmap_set(bm, clst, true);
 			found++;
+			picked++;
 		}
 	}
 
+done:
 	if (rc == EOK && found == nclsts) {
 		rc = fat_alloc_shadow_clusters(bs, service_id, lifo, nclsts);
 		if (rc == EOK) {
@@ -728,6 +1166,10 @@ fat_alloc_clusters(fat_bs_t *bs, service_id_t service_id, unsigned nclsts,
 		(void) fat_set_cluster(bs, service_id, FAT1, lifo[found],
 		    FAT_CLST_RES0);
 	}
+	if (bm) {
+		while (picked--)
+			fat_bitmap_set(bm, lifo[picked], false);
+	}
 
 	free(lifo);
 	fibril_mutex_unlock(&fat_alloc_lock);
@@ -736,6 +1178,9 @@ fat_alloc_clusters(fat_bs_t *bs, service_id_t service_id, unsigned nclsts,
 }
 
 /** Free clusters forming a cluster chain in all copies of FAT.
+ *
+ * The freed clusters are also discarded on the underlying device, if
+ * it supports that.
  *
  * @param bs		Buffer hodling the boot sector of the file system.
  * @param service_id	Device service ID of the file system.
@@ -749,8 +1194,14 @@ fat_free_clusters(fat_bs_t *bs, service_id_t service_id, fat_cluster_t firstc)
 	unsigned fatno;
 	fat_cluster_t nextc = 0;
 	fat_cluster_t clst_bad = FAT_CLST_BAD(bs);
+	fat_bitmap_t *bm;
+	size_t bsize;
+	bool discard;
 	errno_t rc;
 
+	discard = (block_get_bsize(service_id, &bsize) == EOK) &&
+	    (BPS(bs) % bsize == 0);
+
 	/* Mark all clusters in the chain as free in all copies of FAT. */
 	while (firstc < FAT_CLST_LAST1(bs)) {
 		assert(firstc >= FAT_CLST_FIRST && firstc < clst_bad);
@@ -766,6 +1217,20 @@ fat_free_clusters(fat_bs_t *bs, service_id_t service_id, fat_cluster_t firstc)
 				return rc;
 		}
 
+		fibril_mutex_lock(&fat_alloc_lock);
+		bm = fat_bitmap_find(service_id);
+		if (bm)
+			fat_bitmap_set(bm, firstc, false);
+		fibril_mutex_unlock(&fat_alloc_lock);
+
+		if (discard) {
+			rc = block_discard(service_id,
+			    (aoff64_t) CLBN2PBN(bs, firstc, 0) * (BPS(bs) / bsize),
+			    SPC(bs) * (BPS(bs) / bsize));
+			if (rc == ENOTSUP)
+				discard = false;
+		}
+
 		firstc = nextc;
 	}
 
@@ -812,6 +1277,10 @@ errno_t fat_append_clusters(fat_bs_t *bs, fat_node_t *nodep, fat_cluster_t mcl,
 		}
 	}
 
+	/*
+	 * The extent map only covers clusters preceding the appended chain, so
+	 * it remains valid.
+	 */
 	nodep->lastc_cached_valid = true;
 	nodep->lastc_cached_value = lcl;
 
@@ -838,8 +1307,7 @@ errno_t fat_chop_clusters(fat_bs_t *bs, fat_node_t *nodep, fat_cluster_t lcl)
 	 * Invalidate cached cluster numbers.
 	 */
 	nodep->lastc_cached_valid = false;
-	if (nodep->currc_cached_value != lcl)
-		nodep->currc_cached_valid = false;
+	fat_extents_free(nodep);
 
 	if (lcl == FAT_CLST_RES0) {
 		/* The node will have zero size and no clusters allocated. */
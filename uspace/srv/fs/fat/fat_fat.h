@@ -115,12 +115,16 @@ extern errno_t fat_block_get(block_t **, struct fat_bs *, struct fat_node *,
 extern errno_t _fat_block_get(block_t **, struct fat_bs *, service_id_t,
     fat_cluster_t, fat_cluster_t *, aoff64_t, int);
 
+extern void fat_extents_free(struct fat_node *);
+
 extern errno_t fat_append_clusters(struct fat_bs *, struct fat_node *,
     fat_cluster_t, fat_cluster_t);
 extern errno_t fat_chop_clusters(struct fat_bs *, struct fat_node *,
     fat_cluster_t);
+extern void fat_bitmap_init_by_service_id(struct fat_bs *, service_id_t);
+extern void fat_bitmap_fini_by_service_id(service_id_t);
 extern errno_t fat_alloc_clusters(struct fat_bs *, service_id_t, unsigned,
-    fat_cluster_t *, fat_cluster_t *);
+    fat_cluster_t, fat_cluster_t *, fat_cluster_t *);
 extern errno_t fat_free_clusters(struct fat_bs *, service_id_t, fat_cluster_t);
 extern errno_t fat_alloc_shadow_clusters(struct fat_bs *, service_id_t,
     fat_cluster_t *, unsigned);
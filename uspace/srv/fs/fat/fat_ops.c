@@ -82,6 +82,7 @@ static errno_t fat_destroy_node(fs_node_t *);
 static errno_t fat_link(fs_node_t *, fs_node_t *, const char *);
 static errno_t fat_unlink(fs_node_t *, fs_node_t *, const char *);
 static errno_t fat_has_children(bool *, fs_node_t *);
+static errno_t fat_readdir(fs_node_t *, aoff64_t, libfs_readdir_cb_t, void *);
 static fs_index_t fat_index_get(fs_node_t *);
 static aoff64_t fat_size_get(fs_node_t *);
 static unsigned fat_lnkcnt_get(fs_node_t *);
@@ -108,9 +109,12 @@ static void fat_node_initialize(fat_node_t *node)
 	node->dirty = false;
 	node->lastc_cached_valid = false;
 	node->lastc_cached_value = 0;
-	node->currc_cached_valid = false;
-	node->currc_cached_bn = 0;
-	node->currc_cached_value = 0;
+	node->extents = NULL;
+	node->extents_count = 0;
+	node->extents_size = 0;
+	node->extents_clusters = 0;
+	fibril_mutex_initialize(&node->dcache_lock);
+	node->dcache = NULL;
 }
 
 static errno_t fat_node_sync(fat_node_t *node)
@@ -192,6 +196,8 @@ restart:
 				return rc;
 		}
 		nodep->idx->nodep = NULL;
+		fat_extents_free(nodep);
+		fat_directory_cache_invalidate(nodep);
 		free(nodep->bp);
 		free(nodep);
 
@@ -230,6 +236,8 @@ static errno_t fat_node_get_new(fat_node_t **nodepp)
 				idxp_tmp->nodep = NULL;
 				fibril_mutex_unlock(&nodep->lock);
 				fibril_mutex_unlock(&idxp_tmp->lock);
+				fat_extents_free(nodep);
+				fat_directory_cache_invalidate(nodep);
 				free(nodep->bp);
 				free(nodep);
 				return rc;
@@ -238,6 +246,8 @@ static errno_t fat_node_get_new(fat_node_t **nodepp)
 		idxp_tmp->nodep = NULL;
 		fibril_mutex_unlock(&nodep->lock);
 		fibril_mutex_unlock(&idxp_tmp->lock);
+		fat_extents_free(nodep);
+		fat_directory_cache_invalidate(nodep);
 		fn = FS_NODE(nodep);
 	} else {
 	skip_cache:
@@ -375,12 +385,36 @@ errno_t fat_match(fs_node_t **rfn, fs_node_t *pfn, const char *component)
 	char name[FAT_LFN_NAME_SIZE];
 	fat_dentry_t *d;
 	service_id_t service_id;
+	aoff64_t pos;
 	errno_t rc;
 
 	fibril_mutex_lock(&parentp->idx->lock);
 	service_id = parentp->idx->service_id;
 	fibril_mutex_unlock(&parentp->idx->lock);
 
+	rc = fat_directory_cache_lookup(parentp, component, &pos);
+	if (rc == ENOENT) {
+		*rfn = NULL;
+		return EOK;
+	}
+	if (rc == EOK) {
+		fat_node_t *nodep;
+		fat_idx_t *idx = fat_idx_get_by_pos(service_id,
+		    parentp->firstc, pos);
+		if (!idx)
+			return ENOMEM;
+		rc = fat_node_get_core(&nodep, idx);
+		fibril_mutex_unlock(&idx->lock);
+		if (rc != EOK)
+			return rc;
+		*rfn = FS_NODE(nodep);
+		return EOK;
+	}
+
+	/*
+	 * The name cache could not be built, fall back to scanning the
+	 * directory.
+	 */
 	fat_directory_t di;
 	rc = fat_directory_open(parentp, &di);
 	if (rc != EOK)
@@ -476,6 +510,8 @@ errno_t fat_node_put(fs_node_t *fn)
 	}
 	fibril_mutex_unlock(&nodep->lock);
 	if (destroy) {
+		fat_extents_free(nodep);
+		fat_directory_cache_invalidate(nodep);
 		free(nodep->bp);
 		free(nodep);
 	}
@@ -493,7 +529,8 @@ errno_t fat_create_node(fs_node_t **rfn, service_id_t service_id, int flags)
 	bs = block_bb_get(service_id);
 	if (flags & L_DIRECTORY) {
 		/* allocate a cluster */
-		rc = fat_alloc_clusters(bs, service_id, 1, &mcl, &lcl);
+		rc = fat_alloc_clusters(bs, service_id, 1, FAT_CLST_RES0,
+		    &mcl, &lcl);
 		if (rc != EOK)
 			return rc;
 		/* populate the new cluster with unused dentries */
@@ -569,6 +606,8 @@ errno_t fat_destroy_node(fs_node_t *fn)
 	}
 
 	fat_idx_destroy(nodep->idx);
+	fat_extents_free(nodep);
+	fat_directory_cache_invalidate(nodep);
 	free(nodep->bp);
 	free(nodep);
 	return rc;
@@ -812,6 +851,59 @@ errno_t fat_has_children(bool *has_children, fs_node_t *fn)
 }
 
 
+errno_t fat_readdir(fs_node_t *fn, aoff64_t pos, libfs_readdir_cb_t cb,
+    void *arg)
+{
+	fat_node_t *nodep = FAT_NODE(fn);
+	char name[FAT_LFN_NAME_SIZE];
+	fat_dentry_t *d;
+	service_id_t service_id;
+	errno_t rc;
+
+	assert(nodep->type == FAT_DIRECTORY);
+
+	fibril_mutex_lock(&nodep->idx->lock);
+	service_id = nodep->idx->service_id;
+	fibril_mutex_unlock(&nodep->idx->lock);
+
+	fat_directory_t di;
+	rc = fat_directory_open(nodep, &di);
+	if (rc != EOK)
+		return rc;
+	rc = fat_directory_seek(&di, pos);
+	if (rc != EOK) {
+		(void) fat_directory_close(&di);
+		return rc;
+	}
+
+	while ((rc = fat_directory_read(&di, name, &d)) == EOK) {
+		/* Same index as fat_match() would give to the entry. */
+		aoff64_t o = di.pos % (BPS(di.bs) / sizeof(fat_dentry_t));
+		fat_idx_t *idx = fat_idx_get_by_pos(service_id, nodep->firstc,
+		    di.bnum * DPS(di.bs) + o);
+		if (!idx) {
+			rc = ENOMEM;
+			break;
+		}
+		fs_index_t index = idx->index;
+		fibril_mutex_unlock(&idx->lock);
+
+		/* Positions have the same meaning as in fat_read(). */
+		if (!cb(arg, name, index, di.pos + 1))
+			break;
+
+		rc = fat_directory_next(&di);
+		if (rc != EOK)
+			break;
+	}
+
+	if (rc == ENOENT)
+		rc = EOK;
+
+	errno_t rc2 = fat_directory_close(&di);
+	return rc != EOK ? rc : rc2;
+}
+
 fs_index_t fat_index_get(fs_node_t *fn)
 {
 	return FAT_NODE(fn)->idx->index;
@@ -898,6 +990,7 @@ libfs_ops_t fat_libfs_ops = {
 	.link = fat_link,
 	.unlink = fat_unlink,
 	.has_children = fat_has_children,
+	.readdir = fat_readdir,
 	.index_get = fat_index_get,
 	.size_get = fat_size_get,
 	.lnkcnt_get = fat_lnkcnt_get,
@@ -1025,6 +1118,7 @@ static errno_t fat_fs_open(service_id_t service_id, enum cache_mode cmode,
 
 static void fat_fs_close(service_id_t service_id, fs_node_t *rfn)
 {
+	fat_bitmap_fini_by_service_id(service_id);
 	free(rfn->data);
 	free(rfn);
 	(void) block_cache_fini(service_id);
@@ -1118,6 +1212,8 @@ fat_mounted(service_id_t service_id, const char *opts, fs_index_t *index,
 
 	fibril_mutex_unlock(&ridxp->lock);
 
+	fat_bitmap_init_by_service_id(block_bb_get(service_id), service_id);
+
 	*index = ridxp->index;
 	*size = FAT_NODE(rfn)->size;
 
@@ -1400,11 +1496,23 @@ fat_write(service_id_t service_id, fs_index_t index, aoff64_t pos,
 		 * clusters for the node and zero them out.
 		 */
 		unsigned nclsts;
-		fat_cluster_t mcl, lcl;
+		fat_cluster_t mcl, lcl, hint;
+
+		/*
+		 * Try to continue right after the node's last cluster so that
+		 * sequentially written files stay contiguous. New files can
+		 * start anywhere.
+		 */
+		if (nodep->lastc_cached_valid &&
+		    nodep->lastc_cached_value >= FAT_CLST_FIRST)
+			hint = nodep->lastc_cached_value + 1;
+		else
+			hint = FAT_CLST_FIRST;
 
 		nclsts = (ROUND_UP(pos + bytes, BPC(bs)) - boundary) / BPC(bs);
 		/* create an independent chain of nclsts clusters in all FATs */
-		rc = fat_alloc_clusters(bs, service_id, nclsts, &mcl, &lcl);
+		rc = fat_alloc_clusters(bs, service_id, nclsts, hint, &mcl,
+		    &lcl);
 		if (rc != EOK) {
 			/* could not allocate a chain of nclsts clusters */
 			(void) fat_node_put(fn);
@@ -1556,7 +1664,10 @@ static errno_t fat_sync(service_id_t service_id, fs_index_t index)
 	rc = fat_node_sync(nodep);
 
 	fat_node_put(fn);
-	return rc;
+	if (rc != EOK)
+		return rc;
+
+	return block_cache_sync(service_id);
 }
 
 vfs_out_ops_t fat_ops = {
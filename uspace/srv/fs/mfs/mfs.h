@@ -67,6 +67,12 @@
 #define MFS_BMAP_SIZE_BLOCKS(sbi, bid) \
     ((bid) == BMAP_ZONE ? (sbi)->zbmap_blocks : (sbi)->ibmap_blocks)
 
+/*
+ * Number of modified bitmap blocks after which the in-core bitmap
+ * is written back to the block cache.
+ */
+#define MFS_BMAP_FLUSH_BATCH	16
+
 typedef uint32_t bitchunk_t;
 
 typedef enum {
@@ -80,6 +86,20 @@ typedef enum {
 	MFS_VERSION_V3
 } mfs_version_t;
 
+/* In-core copy of an allocation bitmap */
+struct mfs_bitmap {
+	/* Bitmap contents, in the on-disk byte order */
+	bitchunk_t *data;
+	/* Number of free bits in each bitmap block */
+	uint32_t *nfree;
+	/* Blocks modified since the last write back */
+	bool *dirty;
+	unsigned long ndirty;
+	unsigned long nblocks;
+	/* Index of the last usable bit */
+	uint32_t limit;
+};
+
 /* Generic MinixFS superblock */
 struct mfs_sb_info {
 	uint32_t ninodes;
@@ -116,6 +136,9 @@ struct mfs_sb_info {
 	 * is invoked.
 	 */
 	unsigned nfree_zones;
+
+	/* In-core copies of the inode and zone bitmaps, indexed by bmap_id_t */
+	struct mfs_bitmap bmap[2];
 };
 
 /* Generic MinixFS inode */
@@ -228,6 +251,15 @@ mfs_count_free_zones(struct mfs_instance *inst, uint32_t *zones);
 extern errno_t
 mfs_count_free_inodes(struct mfs_instance *inst, uint32_t *inodes);
 
+extern errno_t
+mfs_bitmaps_load(struct mfs_instance *inst);
+
+extern errno_t
+mfs_bitmaps_flush(struct mfs_instance *inst);
+
+extern void
+mfs_bitmaps_free(struct mfs_sb_info *sbi);
+
 
 /* mfs_utils.c */
 extern uint16_t
@@ -33,10 +33,6 @@
 #include <stdlib.h>
 #include "mfs.h"
 
-static int
-find_free_bit_and_set(bitchunk_t *b, const int bsize,
-    const bool native, unsigned start_bit);
-
 static errno_t
 mfs_free_bit(struct mfs_instance *inst, uint32_t idx, bmap_id_t bid);
 
@@ -46,6 +42,15 @@ mfs_alloc_bit(struct mfs_instance *inst, uint32_t *idx, bmap_id_t bid);
 static errno_t
 mfs_count_free_bits(struct mfs_instance *inst, bmap_id_t bid, uint32_t *free);
 
+static errno_t
+mfs_bitmap_load(struct mfs_instance *inst, bmap_id_t bid);
+
+static errno_t
+mfs_bitmap_flush(struct mfs_instance *inst, bmap_id_t bid);
+
+static void
+mfs_bitmap_free(struct mfs_bitmap *bmap);
+
 
 /**Allocate a new inode.
  *
@@ -100,6 +105,9 @@ mfs_alloc_zone(struct mfs_instance *inst, uint32_t *zone)
 }
 
 /**Free a zone.
+ *
+ * The zone is also discarded on the underlying device, if it supports
+ * that.
  *
  * @param inst		Pointer to the filesystem instance.
  * @param zone		Index of the zone to free.
@@ -110,6 +118,9 @@ errno_t
 mfs_free_zone(struct mfs_instance *inst, uint32_t zone)
 {
 	errno_t r;
+	/* The device block size is checked to be 512 bytes on mount */
+	size_t dev_blocks = inst->sbi->block_size / 512;
+	aoff64_t ba = (aoff64_t) zone * dev_blocks;
 
 	zone -= inst->sbi->firstdatazone - 1;
 
@@ -117,6 +128,8 @@ mfs_free_zone(struct mfs_instance *inst, uint32_t zone)
 	if (r != EOK)
 		return r;
 
+	(void) block_discard(inst->service_id, ba, dev_blocks);
+
 	/* Update the cached number of free zones */
 	struct mfs_sb_info *sbi = inst->sbi;
 	if (sbi->nfree_zones_valid)
@@ -154,6 +167,67 @@ mfs_count_free_inodes(struct mfs_instance *inst, uint32_t *inodes)
 	return mfs_count_free_bits(inst, BMAP_INODE, inodes);
 }
 
+/** Load the inode and zone bitmaps into memory
+ *
+ * The bitmaps are kept in core for the whole lifetime of the instance.
+ * Besides the bitmap contents, the number of free bits in every bitmap
+ * block is remembered, so that full blocks can be skipped without
+ * looking at them and the free counts can be computed without a scan.
+ *
+ * @param inst          Pointer to the instance structure.
+ *
+ * @return              EOK on success or an error code.
+ */
+errno_t
+mfs_bitmaps_load(struct mfs_instance *inst)
+{
+	errno_t r;
+
+	r = mfs_bitmap_load(inst, BMAP_INODE);
+	if (r != EOK)
+		return r;
+
+	r = mfs_bitmap_load(inst, BMAP_ZONE);
+	if (r != EOK) {
+		mfs_bitmap_free(&inst->sbi->bmap[BMAP_INODE]);
+		return r;
+	}
+
+	return EOK;
+}
+
+/** Write all the modified bitmap blocks back to the block cache
+ *
+ * @param inst          Pointer to the instance structure.
+ *
+ * @return              EOK on success or an error code.
+ */
+errno_t
+mfs_bitmaps_flush(struct mfs_instance *inst)
+{
+	errno_t r;
+
+	r = mfs_bitmap_flush(inst, BMAP_INODE);
+	if (r != EOK)
+		return r;
+
+	return mfs_bitmap_flush(inst, BMAP_ZONE);
+}
+
+/** Release the in-core copies of the bitmaps
+ *
+ * Modified blocks are not written back, mfs_bitmaps_flush() has to be
+ * called first if they are to be preserved.
+ *
+ * @param sbi           Pointer to the superblock info structure.
+ */
+void
+mfs_bitmaps_free(struct mfs_sb_info *sbi)
+{
+	mfs_bitmap_free(&sbi->bmap[BMAP_INODE]);
+	mfs_bitmap_free(&sbi->bmap[BMAP_ZONE]);
+}
+
 /** Count the number of free bits in a bitmap
  *
  * @param inst          Pointer to the instance structure.
@@ -166,55 +240,172 @@ mfs_count_free_inodes(struct mfs_instance *inst, uint32_t *inodes)
 static errno_t
 mfs_count_free_bits(struct mfs_instance *inst, bmap_id_t bid, uint32_t *free)
 {
-	errno_t r;
+	struct mfs_bitmap *bmap = &inst->sbi->bmap[bid];
+	unsigned long block;
+	uint32_t free_bits = 0;
+
+	for (block = 0; block < bmap->nblocks; ++block)
+		free_bits += bmap->nfree[block];
+
+	*free = free_bits;
+	return EOK;
+}
+
+/** Load one bitmap into memory
+ *
+ * @param inst          Pointer to the instance structure.
+ * @param bid           Type of the bitmap (inode or zone).
+ *
+ * @return              EOK on success or an error code.
+ */
+static errno_t
+mfs_bitmap_load(struct mfs_instance *inst, bmap_id_t bid)
+{
+	struct mfs_sb_info *sbi = inst->sbi;
+	struct mfs_bitmap *bmap = &sbi->bmap[bid];
+	const size_t chunk_bits = sizeof(bitchunk_t) * 8;
+	const size_t chunks_per_block = sbi->block_size / sizeof(bitchunk_t);
 	unsigned start_block;
-	unsigned long nblocks;
-	unsigned long nbits;
 	unsigned long block;
-	unsigned long free_bits = 0;
-	bitchunk_t chunk;
-	size_t const bitchunk_bits = sizeof(bitchunk_t) * 8;
+	uint32_t bit = 0;
 	block_t *b;
-	struct mfs_sb_info *sbi = inst->sbi;
+	errno_t r;
 
 	start_block = MFS_BMAP_START_BLOCK(sbi, bid);
-	nblocks = MFS_BMAP_SIZE_BLOCKS(sbi, bid);
-	nbits = MFS_BMAP_SIZE_BITS(sbi, bid);
+	bmap->nblocks = MFS_BMAP_SIZE_BLOCKS(sbi, bid);
+	bmap->limit = MFS_BMAP_SIZE_BITS(sbi, bid);
+	bmap->ndirty = 0;
+
+	bmap->data = malloc(bmap->nblocks * sbi->block_size);
+	bmap->nfree = calloc(bmap->nblocks, sizeof(uint32_t));
+	bmap->dirty = calloc(bmap->nblocks, sizeof(bool));
+	if (!bmap->data || !bmap->nfree || !bmap->dirty) {
+		r = ENOMEM;
+		goto out_err;
+	}
 
-	for (block = 0; block < nblocks; ++block) {
+	for (block = 0; block < bmap->nblocks; ++block) {
 		r = block_get(&b, inst->service_id, block + start_block,
 		    BLOCK_FLAGS_NONE);
 		if (r != EOK)
-			return r;
+			goto out_err;
 
-		size_t i;
-		bitchunk_t *data = (bitchunk_t *) b->data;
+		bitchunk_t *data = bmap->data + block * chunks_per_block;
+		memcpy(data, b->data, sbi->block_size);
+
+		r = block_put(b);
+		if (r != EOK)
+			goto out_err;
 
 		/*
-		 * Read the bitmap block, chunk per chunk,
-		 * counting the zero bits.
+		 * Count the zero bits of the block, the ones beyond
+		 * the end of the bitmap are not usable.
 		 */
-		for (i = 0; i < sbi->block_size / sizeof(bitchunk_t); ++i) {
-			chunk = conv32(sbi->native, data[i]);
-
-			size_t bit;
-			for (bit = 0; bit < bitchunk_bits && nbits > 0;
-			    ++bit, --nbits) {
-				if (!(chunk & (1 << bit)))
-					free_bits++;
+		size_t i;
+		for (i = 0; i < chunks_per_block && bit <= bmap->limit; ++i) {
+			bitchunk_t chunk = conv32(sbi->native, data[i]);
+
+			size_t j;
+			for (j = 0; j < chunk_bits && bit <= bmap->limit;
+			    ++j, ++bit) {
+				if (!(chunk & (1 << j)))
+					bmap->nfree[block]++;
 			}
-
-			if (nbits == 0)
-				break;
 		}
+	}
+
+	return EOK;
+
+out_err:
+	mfs_bitmap_free(bmap);
+	return r;
+}
+
+/** Write the modified blocks of a bitmap back to the block cache
+ *
+ * @param inst          Pointer to the instance structure.
+ * @param bid           Type of the bitmap (inode or zone).
+ *
+ * @return              EOK on success or an error code.
+ */
+static errno_t
+mfs_bitmap_flush(struct mfs_instance *inst, bmap_id_t bid)
+{
+	struct mfs_sb_info *sbi = inst->sbi;
+	struct mfs_bitmap *bmap = &sbi->bmap[bid];
+	const size_t chunks_per_block = sbi->block_size / sizeof(bitchunk_t);
+	unsigned start_block;
+	unsigned long block;
+	block_t *b;
+	errno_t r;
+
+	start_block = MFS_BMAP_START_BLOCK(sbi, bid);
+
+	for (block = 0; block < bmap->nblocks && bmap->ndirty > 0; ++block) {
+		if (!bmap->dirty[block])
+			continue;
+
+		r = block_get(&b, inst->service_id, block + start_block,
+		    BLOCK_FLAGS_NOREAD);
+		if (r != EOK)
+			return r;
+
+		memcpy(b->data, bmap->data + block * chunks_per_block,
+		    sbi->block_size);
+		b->dirty = true;
 
 		r = block_put(b);
 		if (r != EOK)
 			return r;
+
+		bmap->dirty[block] = false;
+		bmap->ndirty--;
 	}
 
-	*free = free_bits;
-	assert(nbits == 0);
+	return EOK;
+}
+
+/** Release the in-core copy of a bitmap
+ *
+ * @param bmap          Pointer to the bitmap structure.
+ */
+static void
+mfs_bitmap_free(struct mfs_bitmap *bmap)
+{
+	free(bmap->data);
+	free(bmap->nfree);
+	free(bmap->dirty);
+	bmap->data = NULL;
+	bmap->nfree = NULL;
+	bmap->dirty = NULL;
+	bmap->nblocks = 0;
+	bmap->ndirty = 0;
+}
+
+/** Mark a bitmap block as modified
+ *
+ * Modified blocks are written back in batches of MFS_BMAP_FLUSH_BATCH
+ * blocks rather than one by one on every allocation.
+ *
+ * @param inst          Pointer to the instance structure.
+ * @param bid           Type of the bitmap (inode or zone).
+ * @param block         Index of the modified block within the bitmap.
+ *
+ * @return              EOK on success or an error code.
+ */
+static errno_t
+mfs_bitmap_set_dirty(struct mfs_instance *inst, bmap_id_t bid,
+    unsigned long block)
+{
+	struct mfs_bitmap *bmap = &inst->sbi->bmap[bid];
+
+	if (!bmap->dirty[block]) {
+		bmap->dirty[block] = true;
+		bmap->ndirty++;
+	}
+
+	if (bmap->ndirty >= MFS_BMAP_FLUSH_BATCH)
+		return mfs_bitmap_flush(inst, bid);
 
 	return EOK;
 }
@@ -232,14 +423,11 @@ static errno_t
 mfs_free_bit(struct mfs_instance *inst, uint32_t idx, bmap_id_t bid)
 {
 	struct mfs_sb_info *sbi;
-	errno_t r;
-	unsigned start_block;
+	struct mfs_bitmap *bmap;
 	unsigned *search;
-	block_t *b;
 
 	sbi = inst->sbi;
-
-	start_block = MFS_BMAP_START_BLOCK(sbi, bid);
+	bmap = &sbi->bmap[bid];
 
 	if (bid == BMAP_ZONE) {
 		search = &sbi->zsearch;
@@ -259,30 +447,26 @@ mfs_free_bit(struct mfs_instance *inst, uint32_t idx, bmap_id_t bid)
 	}
 
 	/* Compute the bitmap block */
-	uint32_t block = idx / (sbi->block_size * 8) + start_block;
-
-	r = block_get(&b, inst->service_id, block, BLOCK_FLAGS_NONE);
-	if (r != EOK)
-		goto out_err;
+	unsigned long block = idx / (sbi->block_size * 8);
+	if (block >= bmap->nblocks)
+		return EIO;
 
-	/* Compute the bit index in the block */
-	idx %= (sbi->block_size * 8);
-	bitchunk_t *ptr = b->data;
+	bitchunk_t *ptr = bmap->data;
 	bitchunk_t chunk;
 	const size_t chunk_bits = sizeof(bitchunk_t) * 8;
 
 	chunk = conv32(sbi->native, ptr[idx / chunk_bits]);
-	chunk &= ~(1 << (idx % chunk_bits));
-	ptr[idx / chunk_bits] = conv32(sbi->native, chunk);
-
-	b->dirty = true;
-	r = block_put(b);
+	if (chunk & (1 << (idx % chunk_bits))) {
+		chunk &= ~(1 << (idx % chunk_bits));
+		ptr[idx / chunk_bits] = conv32(sbi->native, chunk);
+		if (idx <= bmap->limit)
+			bmap->nfree[block]++;
+	}
 
 	if (*search > idx)
 		*search = idx;
 
-out_err:
-	return r;
+	return mfs_bitmap_set_dirty(inst, bid, block);
 }
 
 /**Search a free bit in a bitmap and mark it as used.
@@ -299,18 +483,15 @@ static errno_t
 mfs_alloc_bit(struct mfs_instance *inst, uint32_t *idx, bmap_id_t bid)
 {
 	struct mfs_sb_info *sbi;
-	uint32_t limit;
-	unsigned long nblocks;
-	unsigned *search, i, start_block;
+	struct mfs_bitmap *bmap;
+	unsigned long block;
+	unsigned *search;
 	unsigned bits_per_block;
-	errno_t r;
-	int freebit;
+	const size_t chunk_bits = sizeof(bitchunk_t) * 8;
+	size_t chunks_per_block, i, j;
 
 	sbi = inst->sbi;
-
-	start_block = MFS_BMAP_START_BLOCK(sbi, bid);
-	limit = MFS_BMAP_SIZE_BITS(sbi, bid);
-	nblocks = MFS_BMAP_SIZE_BLOCKS(sbi, bid);
+	bmap = &sbi->bmap[bid];
 
 	if (bid == BMAP_ZONE) {
 		search = &sbi->zsearch;
@@ -319,46 +500,49 @@ mfs_alloc_bit(struct mfs_instance *inst, uint32_t *idx, bmap_id_t bid)
 		search = &sbi->isearch;
 	}
 	bits_per_block = sbi->block_size * 8;
-
-	block_t *b;
+	chunks_per_block = sbi->block_size / sizeof(bitchunk_t);
 
 retry:
 
-	for (i = *search / bits_per_block; i < nblocks; ++i) {
-		r = block_get(&b, inst->service_id, i + start_block,
-		    BLOCK_FLAGS_NONE);
-
-		if (r != EOK)
-			goto out;
-
-		unsigned tmp = *search % bits_per_block;
-
-		freebit = find_free_bit_and_set(b->data, sbi->block_size,
-		    sbi->native, tmp);
-		if (freebit == -1) {
+	for (block = *search / bits_per_block; block < bmap->nblocks;
+	    ++block) {
+		if (bmap->nfree[block] == 0) {
 			/* No free bit in this block */
-			r = block_put(b);
-			if (r != EOK)
-				goto out;
 			continue;
 		}
 
-		/* Free bit found in this block, compute the real index */
-		*idx = freebit + bits_per_block * i;
-		if (*idx > limit) {
-			/* Index is beyond the limit, it is invalid */
-			r = block_put(b);
-			if (r != EOK)
-				goto out;
-			break;
-		}
+		bitchunk_t *data = bmap->data + block * chunks_per_block;
 
-		*search = *idx;
-		b->dirty = true;
-		r = block_put(b);
-		goto out;
+		i = 0;
+		if (block == *search / bits_per_block)
+			i = (*search % bits_per_block) / chunk_bits;
+
+		for (; i < chunks_per_block; ++i) {
+			if (!(~data[i])) {
+				/* No free bit in this chunk */
+				continue;
+			}
+
+			bitchunk_t chunk = conv32(sbi->native, data[i]);
+			for (j = 0; chunk & (1 << j); ++j)
+				;
+
+			*idx = block * bits_per_block + i * chunk_bits + j;
+			if (*idx > bmap->limit) {
+				/* Index is beyond the limit, it is invalid */
+				goto nospace;
+			}
+
+			chunk |= 1 << j;
+			data[i] = conv32(sbi->native, chunk);
+			bmap->nfree[block]--;
+
+			*search = *idx;
+			return mfs_bitmap_set_dirty(inst, bid, block);
+		}
 	}
 
+nospace:
 	if (*search > 0) {
 		/* Repeat the search from the first bitmap block */
 		*search = 0;
@@ -367,41 +551,6 @@ retry:
 
 	/* Free bit not found, return error */
 	return ENOSPC;
-
-out:
-	return r;
-}
-
-static int
-find_free_bit_and_set(bitchunk_t *b, const int bsize,
-    const bool native, unsigned start_bit)
-{
-	int r = -1;
-	unsigned i, j;
-	bitchunk_t chunk;
-	const size_t chunk_bits = sizeof(bitchunk_t) * 8;
-
-	for (i = start_bit / chunk_bits;
-	    i < bsize / sizeof(bitchunk_t); ++i) {
-
-		if (!(~b[i])) {
-			/* No free bit in this chunk */
-			continue;
-		}
-
-		chunk = conv32(native, b[i]);
-
-		for (j = 0; j < chunk_bits; ++j) {
-			if (!(chunk & (1 << j))) {
-				r = i * chunk_bits + j;
-				chunk |= 1 << j;
-				b[i] = conv32(native, chunk);
-				goto found;
-			}
-		}
-	}
-found:
-	return r;
 }
 
 /**
@@ -338,8 +338,17 @@ mfs_mounted(service_id_t service_id, const char *opts, fs_index_t *index,
 	instance->service_id = service_id;
 	instance->sbi = sbi;
 	instance->open_nodes_cnt = 0;
+
+	rc = mfs_bitmaps_load(instance);
+	if (rc != EOK) {
+		block_cache_fini(service_id);
+		mfsdebug("bitmap loading failed\n");
+		goto out_error;
+	}
+
 	rc = fs_instance_create(service_id, instance);
 	if (rc != EOK) {
+		mfs_bitmaps_free(sbi);
 		block_cache_fini(service_id);
 		mfsdebug("fs instance creation failed\n");
 		goto out_error;
@@ -380,11 +389,13 @@ mfs_unmounted(service_id_t service_id)
 	if (inst->open_nodes_cnt != 0)
 		return EBUSY;
 
+	(void) mfs_bitmaps_flush(inst);
 	(void) block_cache_fini(service_id);
 	block_fini(service_id);
 
 	/* Remove and destroy the instance */
 	(void) fs_instance_destroy(service_id);
+	mfs_bitmaps_free(inst->sbi);
 	free(inst->sbi);
 	free(inst);
 	return EOK;
@@ -1173,7 +1184,17 @@ mfs_sync(service_id_t service_id, fs_index_t index)
 	struct mfs_node *mnode = fn->data;
 	mnode->ino_i->dirty = true;
 
-	return mfs_node_put(fn);
+	rc = mfs_bitmaps_flush(mnode->instance);
+	if (rc != EOK) {
+		mfs_node_put(fn);
+		return rc;
+	}
+
+	rc = mfs_node_put(fn);
+	if (rc != EOK)
+		return rc;
+
+	return block_cache_sync(service_id);
 }
 
 /** Check if a given number is a power of two.
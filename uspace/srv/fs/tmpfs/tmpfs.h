@@ -38,6 +38,10 @@
 #include <stddef.h>
 #include <stdbool.h>
 #include <adt/hash_table.h>
+#include <as.h>
+
+/** Size of a page of file contents. */
+#define TMPFS_PAGE_SIZE		PAGE_SIZE
 
 #define TMPFS_NODE(node)	((node) ? (tmpfs_node_t *)(node)->data : NULL)
 #define FS_NODE(node)		((node) ? (node)->bp : NULL)
@@ -53,6 +57,7 @@ struct tmpfs_node;
 
 typedef struct tmpfs_dentry {
 	link_t link;		/**< Linkage for the list of siblings. */
+	ht_link_t hlink;	/**< Linkage for the parent's dentry index. */
 	struct tmpfs_node *node;/**< Back pointer to TMPFS node. */
 	char *name;		/**< Name of dentry. */
 } tmpfs_dentry_t;
@@ -65,8 +70,22 @@ typedef struct tmpfs_node {
 	tmpfs_dentry_type_t type;
 	unsigned lnkcnt;	/**< Link count. */
 	size_t size;		/**< File size if type is TMPFS_FILE. */
-	void *data;		/**< File content's if type is TMPFS_FILE. */
+	/**
+	 * Pages of the file contents if type is TMPFS_FILE. Holes in sparse
+	 * files have no pages allocated.
+	 */
+	void **pages;
+	size_t pages_count;	/**< Number of entries in pages. */
 	list_t cs_list;		/**< Child's siblings list. */
+	size_t cs_count;	/**< Number of entries in cs_list. */
+	/**
+	 * Index of cs_list by name, created once the directory grows beyond
+	 * TMPFS_DENTRY_INDEX_THRESHOLD entries. The list keeps the readdir
+	 * order.
+	 */
+	hash_table_t *cs_index;
+	link_t *rd_link;	/**< Last dentry returned by readdir. */
+	aoff64_t rd_pos;	/**< Position of rd_link in cs_list. */
 } tmpfs_node_t;
 
 extern vfs_out_ops_t tmpfs_ops;
@@ -55,6 +55,8 @@
 
 /** All root nodes have index 0. */
 #define TMPFS_SOME_ROOT		0
+/** Number of entries from which directory entries are looked up by hash. */
+#define TMPFS_DENTRY_INDEX_THRESHOLD	16
 /** Global counter for assigning node indices. Shared by all instances. */
 fs_index_t tmpfs_next_index = 1;
 
@@ -84,6 +86,49 @@ static errno_t tmpfs_has_children(bool *has_children, fs_node_t *fn)
 	return EOK;
 }
 
+/** Find the dentry at a position in the list of children.
+ *
+ * Directories are usually read sequentially, so the position of the last
+ * dentry returned is remembered and the walk continues from there.
+ */
+static link_t *tmpfs_dentry_nth(tmpfs_node_t *nodep, aoff64_t pos)
+{
+	link_t *lnk;
+
+	if (nodep->rd_link != NULL && nodep->rd_pos <= pos) {
+		lnk = nodep->rd_link;
+		for (aoff64_t i = nodep->rd_pos; i < pos && lnk != NULL; i++)
+			lnk = list_next(lnk, &nodep->cs_list);
+	} else {
+		lnk = list_nth(&nodep->cs_list, pos);
+	}
+
+	nodep->rd_link = lnk;
+	nodep->rd_pos = pos;
+	return lnk;
+}
+
+static errno_t tmpfs_readdir(fs_node_t *fn, aoff64_t pos,
+    libfs_readdir_cb_t cb, void *arg)
+{
+	tmpfs_node_t *nodep = TMPFS_NODE(fn);
+	link_t *lnk;
+
+	/* The position is the index of the dentry in the list of children. */
+	for (lnk = tmpfs_dentry_nth(nodep, pos); lnk != NULL;
+	    lnk = list_next(lnk, &nodep->cs_list)) {
+		tmpfs_dentry_t *dentryp = list_get_instance(lnk,
+		    tmpfs_dentry_t, link);
+
+		nodep->rd_link = lnk;
+		nodep->rd_pos = pos;
+		if (!cb(arg, dentryp->name, dentryp->node->index, ++pos))
+			break;
+	}
+
+	return EOK;
+}
+
 static fs_index_t tmpfs_index_get(fs_node_t *fn)
 {
 	return TMPFS_NODE(fn)->index;
@@ -126,6 +171,7 @@ libfs_ops_t tmpfs_libfs_ops = {
 	.link = tmpfs_link_node,
 	.unlink = tmpfs_unlink_node,
 	.has_children = tmpfs_has_children,
+	.readdir = tmpfs_readdir,
 	.index_get = tmpfs_index_get,
 	.size_get = tmpfs_size_get,
 	.lnkcnt_get = tmpfs_lnkcnt_get,
@@ -170,18 +216,26 @@ static void nodes_remove_callback(ht_link_t *item)
 {
 	tmpfs_node_t *nodep = hash_table_get_inst(item, tmpfs_node_t, nh_link);
 
+	if (nodep->cs_index != NULL) {
+		hash_table_destroy(nodep->cs_index);
+		free(nodep->cs_index);
+	}
+
 	while (!list_empty(&nodep->cs_list)) {
 		tmpfs_dentry_t *dentryp = list_get_instance(
 		    list_first(&nodep->cs_list), tmpfs_dentry_t, link);
 
 		assert(nodep->type == TMPFS_DIRECTORY);
 		list_remove(&dentryp->link);
+		free(dentryp->name);
 		free(dentryp);
 	}
 
-	if (nodep->data) {
+	if (nodep->pages) {
 		assert(nodep->type == TMPFS_FILE);
-		free(nodep->data);
+		for (size_t i = 0; i < nodep->pages_count; i++)
+			free(nodep->pages[i]);
+		free(nodep->pages);
 	}
 	free(nodep->bp);
 	free(nodep);
@@ -196,6 +250,44 @@ hash_table_ops_t nodes_ops = {
 	.remove_callback = nodes_remove_callback
 };
 
+/*
+ * Implementation of hash table interface for the directory entry indices.
+ */
+
+static size_t dentries_key_hash(void *key)
+{
+	const char *name = (const char *) key;
+	size_t hash = 0;
+
+	while (*name != '\0')
+		hash = hash_combine(hash, (uint8_t) *name++);
+
+	return hash;
+}
+
+static size_t dentries_hash(const ht_link_t *item)
+{
+	tmpfs_dentry_t *dentryp = hash_table_get_inst(item, tmpfs_dentry_t,
+	    hlink);
+	return dentries_key_hash(dentryp->name);
+}
+
+static bool dentries_key_equal(void *key, const ht_link_t *item)
+{
+	tmpfs_dentry_t *dentryp = hash_table_get_inst(item, tmpfs_dentry_t,
+	    hlink);
+	return str_cmp(dentryp->name, (const char *) key) == 0;
+}
+
+/** TMPFS directory entry index operations. */
+static hash_table_ops_t dentries_ops = {
+	.hash = dentries_hash,
+	.key_hash = dentries_key_hash,
+	.key_equal = dentries_key_equal,
+	.equal = NULL,
+	.remove_callback = NULL
+};
+
 static void tmpfs_node_initialize(tmpfs_node_t *nodep)
 {
 	nodep->bp = NULL;
@@ -204,8 +296,122 @@ static void tmpfs_node_initialize(tmpfs_node_t *nodep)
 	nodep->type = TMPFS_NONE;
 	nodep->lnkcnt = 0;
 	nodep->size = 0;
-	nodep->data = NULL;
+	nodep->pages = NULL;
+	nodep->pages_count = 0;
 	list_initialize(&nodep->cs_list);
+	nodep->cs_count = 0;
+	nodep->cs_index = NULL;
+	nodep->rd_link = NULL;
+	nodep->rd_pos = 0;
+}
+
+/** Page holding zeros for reading holes in sparse files. */
+static uint8_t tmpfs_zero_page[TMPFS_PAGE_SIZE];
+
+/** Make sure a file has page entries for the given number of pages.
+ *
+ * The page array grows geometrically so that appending to a file does not
+ * need to copy the page array on every write.
+ */
+static errno_t tmpfs_pages_reserve(tmpfs_node_t *nodep, size_t count)
+{
+	if (count <= nodep->pages_count)
+		return EOK;
+
+	size_t ncount = max(count, 2 * nodep->pages_count);
+	void **npages = realloc(nodep->pages, ncount * sizeof(void *));
+	if (!npages)
+		return ENOMEM;
+
+	memset(npages + nodep->pages_count, 0,
+	    (ncount - nodep->pages_count) * sizeof(void *));
+	nodep->pages = npages;
+	nodep->pages_count = ncount;
+	return EOK;
+}
+
+/** Allocate the pages backing a range of a file.
+ *
+ * @param nodep		File node.
+ * @param pos		Start of the range.
+ * @param size		Size of the range, must not be zero.
+ */
+static errno_t tmpfs_pages_alloc(tmpfs_node_t *nodep, aoff64_t pos,
+    size_t size)
+{
+	size_t first = pos / TMPFS_PAGE_SIZE;
+	size_t last = (pos + size - 1) / TMPFS_PAGE_SIZE;
+
+	errno_t rc = tmpfs_pages_reserve(nodep, last + 1);
+	if (rc != EOK)
+		return rc;
+
+	for (size_t i = first; i <= last; i++) {
+		if (nodep->pages[i] != NULL)
+			continue;
+
+		nodep->pages[i] = calloc(1, TMPFS_PAGE_SIZE);
+		if (!nodep->pages[i])
+			return ENOMEM;
+	}
+
+	return EOK;
+}
+
+/** Copy file contents to a buffer, reading holes as zeros. */
+static void tmpfs_pages_read(tmpfs_node_t *nodep, aoff64_t pos, void *buf,
+    size_t size)
+{
+	while (size > 0) {
+		size_t page = pos / TMPFS_PAGE_SIZE;
+		size_t off = pos % TMPFS_PAGE_SIZE;
+		size_t n = min(size, TMPFS_PAGE_SIZE - off);
+
+		if (page < nodep->pages_count && nodep->pages[page] != NULL)
+			memcpy(buf, nodep->pages[page] + off, n);
+		else
+			memset(buf, 0, n);
+
+		buf += n;
+		pos += n;
+		size -= n;
+	}
+}
+
+/** Copy a buffer to file contents. The pages must be allocated. */
+static void tmpfs_pages_write(tmpfs_node_t *nodep, aoff64_t pos,
+    const void *buf, size_t size)
+{
+	while (size > 0) {
+		size_t page = pos / TMPFS_PAGE_SIZE;
+		size_t off = pos % TMPFS_PAGE_SIZE;
+		size_t n = min(size, TMPFS_PAGE_SIZE - off);
+
+		memcpy(nodep->pages[page] + off, buf, n);
+
+		buf += n;
+		pos += n;
+		size -= n;
+	}
+}
+
+/** Drop the file contents beyond a new, smaller file size. */
+static void tmpfs_pages_truncate(tmpfs_node_t *nodep, size_t size)
+{
+	size_t keep = (size + TMPFS_PAGE_SIZE - 1) / TMPFS_PAGE_SIZE;
+
+	for (size_t i = keep; i < nodep->pages_count; i++) {
+		free(nodep->pages[i]);
+		nodep->pages[i] = NULL;
+	}
+
+	/* Clear the tail of the last page in order to emulate gaps. */
+	size_t off = size % TMPFS_PAGE_SIZE;
+	if (off != 0 && keep <= nodep->pages_count &&
+	    nodep->pages[keep - 1] != NULL) {
+		memset(nodep->pages[keep - 1] + off, 0,
+		    TMPFS_PAGE_SIZE - off);
+	}
 }
 
 static void tmpfs_dentry_initialize(tmpfs_dentry_t *dentryp)
@@ -215,6 +421,73 @@ static void tmpfs_dentry_initialize(tmpfs_dentry_t *dentryp)
 	dentryp->node = NULL;
 }
 
+/** Find a child of a directory by name. */
+static tmpfs_dentry_t *tmpfs_dentry_find(tmpfs_node_t *parentp,
+    const char *name)
+{
+	if (parentp->cs_index != NULL) {
+		ht_link_t *lnk = hash_table_find(parentp->cs_index,
+		    (void *) name);
+		if (lnk == NULL)
+			return NULL;
+		return hash_table_get_inst(lnk, tmpfs_dentry_t, hlink);
+	}
+
+	list_foreach(parentp->cs_list, link, tmpfs_dentry_t, dentryp) {
+		if (!str_cmp(dentryp->name, name))
+			return dentryp;
+	}
+
+	return NULL;
+}
+
+/** Index the children of a directory that has grown large.
+ *
+ * Failing to allocate the index is not fatal, the directory is then
+ * searched linearly and another attempt is made with the next link.
+ */
+static void tmpfs_dentry_index(tmpfs_node_t *parentp)
+{
+	hash_table_t *index = malloc(sizeof(hash_table_t));
+	if (index == NULL)
+		return;
+
+	if (!hash_table_create(index, 0, 0, &dentries_ops)) {
+		free(index);
+		return;
+	}
+
+	list_foreach(parentp->cs_list, link, tmpfs_dentry_t, dentryp)
+		hash_table_insert(index, &dentryp->hlink);
+
+	parentp->cs_index = index;
+}
+
+/** Append a dentry to the children of a directory. */
+static void tmpfs_dentry_link(tmpfs_node_t *parentp, tmpfs_dentry_t *dentryp)
+{
+	list_append(&dentryp->link, &parentp->cs_list);
+	parentp->cs_count++;
+
+	if (parentp->cs_index != NULL)
+		hash_table_insert(parentp->cs_index, &dentryp->hlink);
+	else if (parentp->cs_count > TMPFS_DENTRY_INDEX_THRESHOLD)
+		tmpfs_dentry_index(parentp);
+}
+
+/** Remove a dentry from the children of a directory. */
+static void tmpfs_dentry_unlink(tmpfs_node_t *parentp, tmpfs_dentry_t *dentryp)
+{
+	if (parentp->cs_index != NULL)
+		hash_table_remove_item(parentp->cs_index, &dentryp->hlink);
+
+	/* Positions of the following dentries change. */
+	parentp->rd_link = NULL;
+
+	list_remove(&dentryp->link);
+	parentp->cs_count--;
+}
+
 bool tmpfs_init(void)
 {
 	if (!hash_table_create(&nodes, 0, 0, &nodes_ops))
@@ -254,15 +527,9 @@ static void tmpfs_instance_done(service_id_t service_id)
 errno_t tmpfs_match(fs_node_t **rfn, fs_node_t *pfn, const char *component)
 {
 	tmpfs_node_t *parentp = TMPFS_NODE(pfn);
+	tmpfs_dentry_t *dentryp = tmpfs_dentry_find(parentp, component);
 
-	list_foreach(parentp->cs_list, link, tmpfs_dentry_t, dentryp) {
-		if (!str_cmp(dentryp->name, component)) {
-			*rfn = FS_NODE(dentryp->node);
-			return EOK;
-		}
-	}
-
-	*rfn = NULL;
+	*rfn = (dentryp != NULL) ? FS_NODE(dentryp->node) : NULL;
 	return EOK;
 }
 
@@ -359,10 +626,8 @@ errno_t tmpfs_link_node(fs_node_t *pfn, fs_node_t *cfn, const char *nm)
 	assert(parentp->type == TMPFS_DIRECTORY);
 
 	/* Check for duplicit entries. */
-	list_foreach(parentp->cs_list, link, tmpfs_dentry_t, dp) {
-		if (!str_cmp(dp->name, nm))
-			return EEXIST;
-	}
+	if (tmpfs_dentry_find(parentp, nm) != NULL)
+		return EEXIST;
 
 	/* Allocate and initialize the dentry. */
 	dentryp = malloc(sizeof(tmpfs_dentry_t));
@@ -380,7 +645,7 @@ errno_t tmpfs_link_node(fs_node_t *pfn, fs_node_t *cfn, const char *nm)
 	str_cpy(dentryp->name, size + 1, nm);
 	dentryp->node = childp;
 	childp->lnkcnt++;
-	list_append(&dentryp->link, &parentp->cs_list);
+	tmpfs_dentry_link(parentp, dentryp);
 
 	return EOK;
 }
@@ -388,28 +653,24 @@ errno_t tmpfs_link_node(fs_node_t *pfn, fs_node_t *cfn, const char *nm)
 errno_t tmpfs_unlink_node(fs_node_t *pfn, fs_node_t *cfn, const char *nm)
 {
 	tmpfs_node_t *parentp = TMPFS_NODE(pfn);
-	tmpfs_node_t *childp = NULL;
+	tmpfs_node_t *childp;
 	tmpfs_dentry_t *dentryp;
 
 	if (!parentp)
 		return EBUSY;
 
-	list_foreach(parentp->cs_list, link, tmpfs_dentry_t, dp) {
-		if (!str_cmp(dp->name, nm)) {
-			dentryp = dp;
-			childp = dentryp->node;
-			assert(FS_NODE(childp) == cfn);
-			break;
-		}
-	}
-
-	if (!childp)
+	dentryp = tmpfs_dentry_find(parentp, nm);
+	if (!dentryp)
 		return ENOENT;
 
+	childp = dentryp->node;
+	assert(FS_NODE(childp) == cfn);
+
 	if ((childp->lnkcnt == 1) && !list_empty(&childp->cs_list))
 		return ENOTEMPTY;
 
-	list_remove(&dentryp->link);
+	tmpfs_dentry_unlink(parentp, dentryp);
+	free(dentryp->name);
 	free(dentryp);
 	childp->lnkcnt--;
 
@@ -488,21 +749,35 @@ static errno_t tmpfs_read(service_id_t service_id, fs_index_t index, aoff64_t po
 
 	size_t bytes;
 	if (nodep->type == TMPFS_FILE) {
-		bytes = min(nodep->size - pos, size);
-		(void) async_data_read_finalize(chandle, nodep->data + pos,
-		    bytes);
+		bytes = (pos < nodep->size) ? min(nodep->size - pos, size) : 0;
+
+		size_t page = pos / TMPFS_PAGE_SIZE;
+		size_t off = pos % TMPFS_PAGE_SIZE;
+		if (off + bytes <= TMPFS_PAGE_SIZE) {
+			/* Answer directly from a single page. */
+			void *src = tmpfs_zero_page;
+			if (page < nodep->pages_count &&
+			    nodep->pages[page] != NULL)
+				src = nodep->pages[page];
+			(void) async_data_read_finalize(chandle, src + off,
+			    bytes);
+		} else {
+			void *buf = malloc(bytes);
+			if (!buf) {
+				async_answer_0(chandle, ENOMEM);
+				return ENOMEM;
+			}
+			tmpfs_pages_read(nodep, pos, buf, bytes);
+			(void) async_data_read_finalize(chandle, buf, bytes);
+			free(buf);
+		}
 	} else {
 		tmpfs_dentry_t *dentryp;
 		link_t *lnk;
 
 		assert(nodep->type == TMPFS_DIRECTORY);
 
-		/*
-		 * Yes, we really use O(n) algorithm here.
-		 * If it bothers someone, it could be fixed by introducing a
-		 * hash table.
-		 */
-		lnk = list_nth(&nodep->cs_list, pos);
+		lnk = tmpfs_dentry_nth(nodep, pos);
 
 		if (lnk == NULL) {
 			async_answer_0(chandle, ENOENT);
@@ -549,34 +824,47 @@ tmpfs_write(service_id_t service_id, fs_index_t index, aoff64_t pos,
 		return EINVAL;
 	}
 
-	/*
-	 * Check whether the file needs to grow.
-	 */
-	if (pos + size <= nodep->size) {
-		/* The file size is not changing. */
-		(void) async_data_write_finalize(chandle, nodep->data + pos,
-		    size);
+	if (size == 0) {
+		(void) async_data_write_finalize(chandle, NULL, 0);
 		goto out;
 	}
-	size_t delta = (pos + size) - nodep->size;
+
+	if (pos + size > SIZE_MAX) {
+		async_answer_0(chandle, ENOMEM);
+		size = 0;
+		goto out;
+	}
+
 	/*
-	 * At this point, we are deliberately extremely straightforward and
-	 * simply realloc the contents of the file on every write that grows the
-	 * file. In the end, the situation might not be as bad as it may look:
-	 * our heap allocator can save us and just grow the block whenever
-	 * possible.
+	 * Only the pages covered by the write are allocated. Any gap between
+	 * the old end of the file and the written range stays a hole.
 	 */
-	void *newdata = realloc(nodep->data, nodep->size + delta);
-	if (!newdata) {
+	if (tmpfs_pages_alloc(nodep, pos, size) != EOK) {
 		async_answer_0(chandle, ENOMEM);
 		size = 0;
 		goto out;
 	}
-	/* Clear any newly allocated memory in order to emulate gaps. */
-	memset(newdata + nodep->size, 0, delta);
-	nodep->size += delta;
-	nodep->data = newdata;
-	(void) async_data_write_finalize(chandle, nodep->data + pos, size);
+
+	size_t page = pos / TMPFS_PAGE_SIZE;
+	size_t off = pos % TMPFS_PAGE_SIZE;
+	if (off + size <= TMPFS_PAGE_SIZE) {
+		/* Receive directly into a single page. */
+		(void) async_data_write_finalize(chandle,
+		    nodep->pages[page] + off, size);
+	} else {
+		void *buf = malloc(size);
+		if (!buf) {
+			async_answer_0(chandle, ENOMEM);
+			size = 0;
+			goto out;
+		}
+		(void) async_data_write_finalize(chandle, buf, size);
+		tmpfs_pages_write(nodep, pos, buf, size);
+		free(buf);
+	}
+
+	if (pos + size > nodep->size)
+		nodep->size = pos + size;
 
 out:
 	*wbytes = size;
@@ -606,17 +894,11 @@ static errno_t tmpfs_truncate(service_id_t service_id, fs_index_t index,
 	if (size > SIZE_MAX)
 		return ENOMEM;
 
-	void *newdata = realloc(nodep->data, size);
-	if (!newdata && size)
-		return ENOMEM;
-
-	if (size > nodep->size) {
-		size_t delta = size - nodep->size;
-		memset(newdata + nodep->size, 0, delta);
-	}
+	/* Growing the file just creates a hole. */
+	if (size < nodep->size)
+		tmpfs_pages_truncate(nodep, size);
 
 	nodep->size = size;
-	nodep->data = newdata;
 	return EOK;
 }
 
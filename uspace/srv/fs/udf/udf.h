@@ -43,6 +43,7 @@
 #include "../../vfs/vfs.h"
 #include "udf_types.h"
 #include <adt/hash_table.h>
+#include <adt/list.h>
 
 #define UDF_NODE(node) \
 	((node) ? (udf_node_t *) (node)->data : NULL)
@@ -65,6 +66,12 @@
 #define SPACE_TABLE   0
 #define SPACE_BITMAP  1
 
+/** Number of unreferenced nodes kept in memory */
+#define UDF_FREE_NODES_MAX  128
+
+/** Initial read-ahead window in blocks, optical media are slow to seek */
+#define UDF_READ_AHEAD  32
+
 typedef struct udf_partition {
 	/* Partition info */
 	uint16_t number;
@@ -98,8 +105,15 @@ typedef struct {
 typedef struct udf_allocator {
 	uint32_t length;
 	uint32_t position;
+	uint64_t offset;  /* Offset of the extent in the file */
 } udf_allocator_t;
 
+/** Cached directory entry */
+typedef struct udf_dirent {
+	char *name;
+	fs_index_t index;  /* ICB position of the entry */
+} udf_dirent_t;
+
 typedef struct udf_node {
 	udf_instance_t *instance;
 	fs_node_t *fs_node;
@@ -107,6 +121,7 @@ typedef struct udf_node {
 
 	fs_index_t index;  /* FID logical block */
 	ht_link_t link;
+	link_t ffn_link;  /* Link in the list of unreferenced nodes */
 	size_t ref_cnt;
 	size_t link_cnt;
 
@@ -115,6 +130,12 @@ typedef struct udf_node {
 	uint8_t *data;
 	udf_allocator_t *allocators;
 	size_t alloc_size;
+	size_t alloc_cap;
+
+	/* Directory entries, valid once the directory has been read */
+	udf_dirent_t *dirents;
+	size_t dirent_cnt;
+	bool dirents_valid;
 } udf_node_t;
 
 extern vfs_out_ops_t udf_ops;
@@ -34,18 +34,53 @@
  * @brief Implementation of file operations. Reading and writing functions.
  */
 
+#include <align.h>
 #include <block.h>
 #include <libfs.h>
 #include <errno.h>
 #include <stdlib.h>
 #include <inttypes.h>
 #include <io/log.h>
+#include <macros.h>
 #include <mem.h>
+#include <str.h>
 #include "udf.h"
 #include "udf_file.h"
 #include "udf_cksum.h"
+#include "udf_osta.h"
 #include "udf_volume.h"
 
+/** Append an extent to the allocators of a node
+ *
+ * @param node     UDF node
+ * @param length   Length of the extent in bytes
+ * @param position Absolute position of the extent (sector)
+ *
+ * @return EOK on success or an error code.
+ *
+ */
+static errno_t udf_node_add_allocator(udf_node_t *node, uint32_t length,
+    uint32_t position)
+{
+	if (node->alloc_size == node->alloc_cap) {
+		size_t cap = (node->alloc_cap > 0) ? 2 * node->alloc_cap : 8;
+		udf_allocator_t *allocators = realloc(node->allocators,
+		    cap * sizeof(udf_allocator_t));
+		if (allocators == NULL)
+			return ENOMEM;
+
+		node->allocators = allocators;
+		node->alloc_cap = cap;
+	}
+
+	node->allocators[node->alloc_size].length = length;
+	node->allocators[node->alloc_size].position = position;
+	node->allocators[node->alloc_size].offset = 0;
+	node->alloc_size++;
+
+	return EOK;
+}
+
 /** Read extended allocator in allocation sequence
  *
  * @paran node     UDF node
@@ -152,17 +187,14 @@ errno_t udf_read_allocation_sequence(udf_node_t *node, uint8_t *af,
 				break;
 			}
 
-			node->allocators = realloc(node->allocators,
-			    (node->alloc_size + 1) * sizeof(udf_allocator_t));
-			node->allocators[node->alloc_size].length =
-			    EXT_LENGTH(FLE32(short_d->length));
-			node->allocators[node->alloc_size].position =
-			    node->instance->partitions[pd_num].start + FLE32(short_d->position);
-			node->alloc_size++;
+			errno_t rc = udf_node_add_allocator(node,
+			    EXT_LENGTH(FLE32(short_d->length)),
+			    node->instance->partitions[pd_num].start +
+			    FLE32(short_d->position));
+			if (rc != EOK)
+				return rc;
 		}
 
-		node->allocators = realloc(node->allocators,
-		    node->alloc_size * sizeof(udf_allocator_t));
 		break;
 
 	case UDF_LONG_AD:
@@ -188,17 +220,12 @@ errno_t udf_read_allocation_sequence(udf_node_t *node, uint8_t *af,
 				break;
 			}
 
-			node->allocators = realloc(node->allocators,
-			    (node->alloc_size + 1) * sizeof(udf_allocator_t));
-			node->allocators[node->alloc_size].length =
-			    EXT_LENGTH(FLE32(long_d->length));
-			node->allocators[node->alloc_size].position = pos_long_ad;
-
-			node->alloc_size++;
+			errno_t rc = udf_node_add_allocator(node,
+			    EXT_LENGTH(FLE32(long_d->length)), pos_long_ad);
+			if (rc != EOK)
+				return rc;
 		}
 
-		node->allocators = realloc(node->allocators,
-		    node->alloc_size * sizeof(udf_allocator_t));
 		break;
 
 	case UDF_EXTENDED_AD:
@@ -305,263 +332,192 @@ errno_t udf_read_icb(udf_node_t *node)
 errno_t udf_node_get_core(udf_node_t *node)
 {
 	node->link_cnt = 1;
-	return udf_read_icb(node);
-}
-
-/** Read directory entry if all FIDs is saved inside of descriptor
- *
- * @param fid  Returned value
- * @param node UDF node
- * @param pos  Number of FID which we need to find
- *
- * @return EOK on success or an error code.
- *
- */
-static errno_t udf_get_fid_in_data(udf_file_identifier_descriptor_t **fid,
-    udf_node_t *node, aoff64_t pos)
-{
-	size_t fid_sum = 0;
-	size_t n = 0;
 
-	while (node->data_size - fid_sum >= MIN_FID_LEN) {
-		udf_descriptor_tag_t *desc =
-		    (udf_descriptor_tag_t *) (node->data + fid_sum);
-		if (desc->checksum != udf_tag_checksum((uint8_t *) desc)) {
-			if (fid_sum == 0)
-				return EINVAL;
-			else
-				return ENOENT;
-		}
-
-		*fid = (udf_file_identifier_descriptor_t *)
-		    (node->data + fid_sum);
-
-		/* According to ECMA 167 4/14.4.9 */
-		size_t padding = 4 * (((*fid)->lenght_file_id +
-		    FLE16((*fid)->lenght_iu) + 38 + 3) / 4) -
-		    ((*fid)->lenght_file_id + FLE16((*fid)->lenght_iu) + 38);
-		size_t size_fid = (*fid)->lenght_file_id +
-		    FLE16((*fid)->lenght_iu) + padding + 38;
-
-		fid_sum += size_fid;
-
-		/* aAcording to ECMA 167 4/8.6 */
-		if (((*fid)->lenght_file_id != 0) &&
-		    (((*fid)->file_characteristics & 4) == 0)) {
-			n++;
+	errno_t rc = udf_read_icb(node);
+	if (rc != EOK)
+		return rc;
 
-			if (n == pos + 1)
-				return EOK;
-		}
+	/* Remember where each extent starts so that reads can look it up */
+	uint64_t offset = 0;
+	for (size_t i = 0; i < node->alloc_size; i++) {
+		node->allocators[i].offset = offset;
+		offset += node->allocators[i].length;
 	}
 
-	return ENOENT;
+	return EOK;
 }
 
-/** Read directory entry
+/** Add an entry to the cached directory entries
  *
- * @param fid   Returned value
- * @param block Returned value
- * @param node  UDF node
- * @param pos   Number of FID which we need to find
+ * @param node  UDF node of the directory
+ * @param name  Name of the entry
+ * @param index ICB position of the entry
  *
  * @return EOK on success or an error code.
  *
  */
-errno_t udf_get_fid(udf_file_identifier_descriptor_t **fid, block_t **block,
-    udf_node_t *node, aoff64_t pos)
+static errno_t udf_dir_add(udf_node_t *node, const char *name,
+    fs_index_t index)
 {
-	if (node->data == NULL)
-		return udf_get_fid_in_allocator(fid, block, node, pos);
+	/* Grow the array whenever the count reaches a power of two */
+	if ((node->dirent_cnt & (node->dirent_cnt - 1)) == 0) {
+		size_t cap = (node->dirent_cnt > 0) ? 2 * node->dirent_cnt : 1;
+		udf_dirent_t *dirents = realloc(node->dirents,
+		    cap * sizeof(udf_dirent_t));
+		if (dirents == NULL)
+			return ENOMEM;
+
+		node->dirents = dirents;
+	}
 
-	return udf_get_fid_in_data(fid, node, pos);
+	char *dup = str_dup(name);
+	if (dup == NULL)
+		return ENOMEM;
+
+	node->dirents[node->dirent_cnt].name = dup;
+	node->dirents[node->dirent_cnt].index = index;
+	node->dirent_cnt++;
+
+	return EOK;
 }
 
-/** Read directory entry if all FIDS is saved in allocators.
+/** Read the contents of a directory which is saved in allocators
  *
- * @param fid   Returned value
- * @param block Returned value
- * @param node  UDF node
- * @param pos   Number of FID which we need to find
+ * @param node UDF node of the directory
+ * @param rbuf Returned value - buffer with the directory contents
  *
  * @return EOK on success or an error code.
  *
  */
-errno_t udf_get_fid_in_allocator(udf_file_identifier_descriptor_t **fid,
-    block_t **block, udf_node_t *node, aoff64_t pos)
+static errno_t udf_dir_read_data(udf_node_t *node, uint8_t **rbuf)
 {
-	void *buf = malloc(node->instance->sector_size);
+	uint32_t sector_size = node->instance->sector_size;
 
-	// FIXME: Check for NULL return value
+	uint8_t *buf = calloc(1, node->data_size);
+	if (buf == NULL)
+		return ENOMEM;
 
-	size_t j = 0;
-	size_t n = 0;
-	size_t len = 0;
+	for (size_t i = 0; i < node->alloc_size; i++) {
+		udf_allocator_t *alloc = &node->allocators[i];
 
-	while (j < node->alloc_size) {
-		size_t i = 0;
-		while (i * node->instance->sector_size < node->allocators[j].length) {
-			errno_t rc = block_get(block, node->instance->service_id,
-			    node->allocators[j].position + i, BLOCK_FLAGS_NONE);
-			if (rc != EOK) {
-				// FIXME: Memory leak
-				return rc;
-			}
-
-			/*
-			 * Last item in allocator is a part of sector. We take
-			 * this fragment and join it to part of sector in next allocator.
-			 */
-			if ((node->allocators[j].length / node->instance->sector_size == i) &&
-			    (node->allocators[j].length - i * node->instance->sector_size <
-			    MIN_FID_LEN)) {
-				size_t len = node->allocators[j].length - i * node->instance->sector_size;
-				memcpy(buf, (*block)->data, len);
-				block_put(*block);
-				*block = NULL;
+		for (uint32_t done = 0; done < alloc->length;
+		    done += sector_size) {
+			uint64_t offset = alloc->offset + done;
+			if (offset >= node->data_size)
 				break;
-			}
 
-			rc = udf_get_fid_in_sector(fid, block, node, pos, &n, &buf, &len);
-			if (rc == EOK) {
-				// FIXME: Memory leak
-				return EOK;
-			}
+			size_t len = min(min(sector_size, alloc->length - done),
+			    node->data_size - offset);
 
-			if (rc == EINVAL) {
-				// FIXME: Memory leak
-				return ENOENT;
+			block_t *block;
+			errno_t rc = block_get(&block, node->instance->service_id,
+			    alloc->position + done / sector_size, BLOCK_FLAGS_NONE);
+			if (rc != EOK) {
+				free(buf);
+				return rc;
 			}
 
-			if (rc == ENOENT) {
-				if (block) {
-					rc = block_put(*block);
-					*block = NULL;
+			memcpy(buf + offset, block->data, len);
 
-					if (rc != EOK)
-						return rc;
-				}
+			rc = block_put(block);
+			if (rc != EOK) {
+				free(buf);
+				return rc;
 			}
-
-			i++;
 		}
-
-		j++;
 	}
 
-	if (buf)
-		free(buf);
-
-	return ENOENT;
+	*rbuf = buf;
+	return EOK;
 }
 
-/** Read FIDs in sector inside of current allocator
+/** Read all entries of a directory into the node
+ *
+ * The file identifier descriptors are parsed only once and kept with the
+ * node, lookups and listing are then served from memory.
+ *
+ * Should be called with the node lock held.
  *
- * @param fid   Returned value.
- * @param block Returned value
- * @param node  UDF node
- * @param pos   Number FID which we need to find
- * @param n     Count of FIDs which we already have passed
- * @param buf   Part of FID from last sector (current allocator or previous)
- * @param len   Length of buf
+ * @param node UDF node of the directory
  *
  * @return EOK on success or an error code.
  *
  */
-errno_t udf_get_fid_in_sector(udf_file_identifier_descriptor_t **fid,
-    block_t **block, udf_node_t *node, aoff64_t pos, size_t *n, void **buf,
-    size_t *len)
+errno_t udf_dir_load(udf_node_t *node)
 {
-	void *fidbuf = malloc(node->instance->sector_size);
+	if (node->dirents_valid)
+		return EOK;
 
-	// FIXME: Check for NULL return value
-
-	bool buf_flag;
+	uint8_t *buf = node->data;
+	if (buf == NULL) {
+		errno_t rc = udf_dir_read_data(node, &buf);
+		if (rc != EOK)
+			return rc;
+	}
 
-	if (*len > 0) {
-		memcpy(fidbuf, *buf, *len);
-		buf_flag = true;
-	} else
-		buf_flag = false;
+	char *name = malloc(MAX_FILE_NAME_LEN + 1);
+	if (name == NULL) {
+		if (buf != node->data)
+			free(buf);
+		return ENOMEM;
+	}
 
+	errno_t rc = EOK;
 	size_t fid_sum = 0;
-	while (node->instance->sector_size - fid_sum > 0) {
-		if (node->instance->sector_size - fid_sum >= MIN_FID_LEN) {
-			void *fid_data;
-
-			if (buf_flag) {
-				memcpy((fidbuf + *len), (*block)->data,
-				    node->instance->sector_size - *len);
-				fid_data = fidbuf;
-			} else
-				fid_data = (*block)->data + fid_sum;
-
-			udf_descriptor_tag_t *desc =
-			    (udf_descriptor_tag_t *) fid_data;
-
-			if (desc->checksum != udf_tag_checksum((uint8_t *) desc)) {
-				if (fidbuf)
-					free(fidbuf);
-
-				if (*buf) {
-					free(*buf);
-					*buf = NULL;
-					*len = 0;
-				}
 
-				return EINVAL;
-			}
+	while (node->data_size - fid_sum >= MIN_FID_LEN) {
+		udf_descriptor_tag_t *desc =
+		    (udf_descriptor_tag_t *) (buf + fid_sum);
+		if (desc->checksum != udf_tag_checksum((uint8_t *) desc)) {
+			if (fid_sum == 0)
+				rc = EINVAL;
+			break;
+		}
 
-			*fid = (udf_file_identifier_descriptor_t *) fid_data;
-
-			/* According to ECMA 167 4/14.4.9 */
-			size_t padding = 4 * (((*fid)->lenght_file_id +
-			    FLE16((*fid)->lenght_iu) + 38 + 3) / 4) -
-			    ((*fid)->lenght_file_id + FLE16((*fid)->lenght_iu) + 38);
-			size_t size_fid = (*fid)->lenght_file_id +
-			    FLE16((*fid)->lenght_iu) + padding + 38;
-			if (buf_flag)
-				fid_sum += size_fid - *len;
-			else
-				fid_sum += size_fid;
-
-			/* According to ECMA 167 4/8.6 */
-			if (((*fid)->lenght_file_id != 0) &&
-			    (((*fid)->file_characteristics & 4) == 0)) {
-				(*n)++;
-				if (*n == pos + 1) {
-					if (fidbuf)
-						free(fidbuf);
-
-					return EOK;
-				}
-			}
+		udf_file_identifier_descriptor_t *fid =
+		    (udf_file_identifier_descriptor_t *) (buf + fid_sum);
 
-			if (fidbuf) {
-				buf_flag = false;
-				free(fidbuf);
-				fidbuf = NULL;
-			}
+		/* According to ECMA 167 4/14.4.9 */
+		size_t size_fid = ALIGN_UP(fid->lenght_file_id +
+		    FLE16(fid->lenght_iu) + MIN_FID_LEN, 4);
+		if (size_fid > node->data_size - fid_sum)
+			break;
 
-			if (*buf) {
-				free(*buf);
-				*buf = NULL;
-				*len = 0;
-			}
-		} else {
-			if (*buf)
-				free(*buf);
+		fid_sum += size_fid;
 
-			*len = node->instance->sector_size - fid_sum;
-			*buf = malloc(*len);
-			buf_flag = false;
-			memcpy(*buf, ((*block)->data + fid_sum), *len);
+		/* According to ECMA 167 4/8.6 */
+		if ((fid->lenght_file_id == 0) ||
+		    ((fid->file_characteristics & 4) != 0))
+			continue;
 
-			return ENOENT;
-		}
+		udf_long_ad_t long_ad = fid->icb;
+
+		udf_to_unix_name(name, MAX_FILE_NAME_LEN,
+		    (char *) fid->implementation_use + FLE16(fid->lenght_iu),
+		    fid->lenght_file_id, &node->instance->charset);
+
+		rc = udf_dir_add(node, name,
+		    udf_long_ad_to_pos(node->instance, &long_ad));
+		if (rc != EOK)
+			break;
 	}
 
-	return ENOENT;
+	free(name);
+	if (buf != node->data)
+		free(buf);
+
+	if (rc != EOK) {
+		for (size_t i = 0; i < node->dirent_cnt; i++)
+			free(node->dirents[i].name);
+
+		free(node->dirents);
+		node->dirents = NULL;
+		node->dirent_cnt = 0;
+		return rc;
+	}
+
+	node->dirents_valid = true;
+	return EOK;
 }
 
 /** Read file if it is saved in allocators.
@@ -578,15 +534,28 @@ errno_t udf_get_fid_in_sector(udf_file_identifier_descriptor_t **fid,
 errno_t udf_read_file(size_t *read_len, cap_call_handle_t chandle, udf_node_t *node,
     aoff64_t pos, size_t len)
 {
+	if (node->alloc_size == 0) {
+		async_answer_0(chandle, EIO);
+		return EIO;
+	}
+
+	/* Find the last extent starting at or before pos */
 	size_t i = 0;
-	size_t l = 0;
+	size_t hi = node->alloc_size;
 
-	while (i < node->alloc_size) {
-		if (pos >= l + node->allocators[i].length) {
-			l += node->allocators[i].length;
-			i++;
-		} else
-			break;
+	while (hi - i > 1) {
+		size_t mid = (i + hi) / 2;
+
+		if (node->allocators[mid].offset <= pos)
+			i = mid;
+		else
+			hi = mid;
+	}
+
+	uint64_t l = node->allocators[i].offset;
+	if (pos >= l + node->allocators[i].length) {
+		async_answer_0(chandle, EIO);
+		return EIO;
 	}
 
 	size_t sector_cnt = ALL_UP(l, node->instance->sector_size);
@@ -199,12 +199,7 @@ extern errno_t udf_read_allocation_sequence(udf_node_t *, uint8_t *, uint16_t,
     uint32_t, uint32_t);
 extern errno_t udf_read_file(size_t *, cap_call_handle_t, udf_node_t *, aoff64_t,
     size_t);
-extern errno_t udf_get_fid(udf_file_identifier_descriptor_t **, block_t **,
-    udf_node_t *, aoff64_t);
-extern errno_t udf_get_fid_in_allocator(udf_file_identifier_descriptor_t **,
-    block_t **, udf_node_t *, aoff64_t);
-extern errno_t udf_get_fid_in_sector(udf_file_identifier_descriptor_t **,
-    block_t **, udf_node_t *, aoff64_t, size_t *, void **, size_t *);
+extern errno_t udf_dir_load(udf_node_t *);
 
 #endif /* UDF_FILE_H_ */
 
@@ -51,6 +51,12 @@ static FIBRIL_MUTEX_INITIALIZE(udf_idx_lock);
 
 static hash_table_t udf_idx;
 
+/** List of unreferenced nodes, least recently used first */
+static LIST_INITIALIZE(udf_ffn_list);
+
+/** Number of nodes in udf_ffn_list */
+static size_t udf_ffn_cnt = 0;
+
 typedef struct {
 	service_id_t service_id;
 	fs_index_t index;
@@ -85,6 +91,30 @@ static hash_table_ops_t udf_idx_ops = {
 	.remove_callback = NULL
 };
 
+/** Release a node and everything it has decoded
+ *
+ * Should be called with udf_idx_lock held.
+ *
+ * @param node UDF node
+ *
+ */
+static void udf_idx_free(udf_node_t *node)
+{
+	hash_table_remove_item(&udf_idx, &node->link);
+
+	assert(node->instance->open_nodes_count > 0);
+	node->instance->open_nodes_count--;
+
+	for (size_t i = 0; i < node->dirent_cnt; i++)
+		free(node->dirents[i].name);
+
+	free(node->dirents);
+	free(node->allocators);
+	free(node->data);
+	free(node->fs_node);
+	free(node);
+}
+
 /** Initialization of hash table
  *
  * @return EOK on success or an error code.
@@ -131,7 +161,11 @@ errno_t udf_idx_get(udf_node_t **udfn, udf_instance_t *instance, fs_index_t inde
 	if (already_open) {
 		udf_node_t *node = hash_table_get_inst(already_open,
 		    udf_node_t, link);
-		node->ref_cnt++;
+
+		if (node->ref_cnt++ == 0) {
+			list_remove(&node->ffn_link);
+			udf_ffn_cnt--;
+		}
 
 		*udfn = node;
 
@@ -178,6 +212,12 @@ errno_t udf_idx_add(udf_node_t **udfn, udf_instance_t *instance, fs_index_t inde
 	udf_node->fs_node = fs_node;
 	udf_node->data = NULL;
 	udf_node->allocators = NULL;
+	udf_node->alloc_size = 0;
+	udf_node->alloc_cap = 0;
+	udf_node->dirents = NULL;
+	udf_node->dirent_cnt = 0;
+	udf_node->dirents_valid = false;
+	link_initialize(&udf_node->ffn_link);
 
 	fibril_mutex_initialize(&udf_node->lock);
 	fs_node->data = udf_node;
@@ -191,6 +231,40 @@ errno_t udf_idx_add(udf_node_t **udfn, udf_instance_t *instance, fs_index_t inde
 	return EOK;
 }
 
+/** Drop a reference to a node
+ *
+ * Unreferenced nodes stay in the hash table together with their decoded
+ * extents and directory entries, so that they are readily available when
+ * looked up again. Only the least recently used of them are released.
+ *
+ * @param node UDF node
+ *
+ * @return EOK on success or an error code.
+ *
+ */
+errno_t udf_idx_put(udf_node_t *node)
+{
+	fibril_mutex_lock(&udf_idx_lock);
+
+	assert(node->ref_cnt > 0);
+	if (--node->ref_cnt == 0) {
+		list_append(&node->ffn_link, &udf_ffn_list);
+		udf_ffn_cnt++;
+
+		if (udf_ffn_cnt > UDF_FREE_NODES_MAX) {
+			udf_node_t *lru = list_get_instance(
+			    list_first(&udf_ffn_list), udf_node_t, ffn_link);
+
+			list_remove(&lru->ffn_link);
+			udf_ffn_cnt--;
+			udf_idx_free(lru);
+		}
+	}
+
+	fibril_mutex_unlock(&udf_idx_lock);
+	return EOK;
+}
+
 /** Delete node from hash table
  *
  * @param node UDF node
@@ -203,17 +277,32 @@ errno_t udf_idx_del(udf_node_t *node)
 	assert(node->ref_cnt == 0);
 
 	fibril_mutex_lock(&udf_idx_lock);
+	udf_idx_free(node);
+	fibril_mutex_unlock(&udf_idx_lock);
 
-	hash_table_remove_item(&udf_idx, &node->link);
+	return EOK;
+}
 
-	assert(node->instance->open_nodes_count > 0);
-	node->instance->open_nodes_count--;
+/** Release all unreferenced nodes of an instance
+ *
+ * @param instance UDF instance
+ *
+ */
+void udf_idx_purge(udf_instance_t *instance)
+{
+	fibril_mutex_lock(&udf_idx_lock);
 
-	free(node->fs_node);
-	free(node);
+	list_foreach_safe(udf_ffn_list, cur, next) {
+		udf_node_t *node = list_get_instance(cur, udf_node_t, ffn_link);
+
+		if (node->instance == instance) {
+			list_remove(&node->ffn_link);
+			udf_ffn_cnt--;
+			udf_idx_free(node);
+		}
+	}
 
 	fibril_mutex_unlock(&udf_idx_lock);
-	return EOK;
 }
 
 /**
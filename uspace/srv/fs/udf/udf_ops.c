@@ -61,12 +61,6 @@
 #include "udf_file.h"
 #include "udf_osta.h"
 
-/** Mutex protecting the list of cached free nodes. */
-static FIBRIL_MUTEX_INITIALIZE(ffn_mutex);
-
-/** List of cached free nodes. */
-static LIST_INITIALIZE(ffn_list);
-
 static errno_t udf_node_get(fs_node_t **rfn, service_id_t service_id,
     fs_index_t index)
 {
@@ -115,43 +109,32 @@ static service_id_t udf_service_get(fs_node_t *node)
 
 static errno_t udf_match(fs_node_t **rfn, fs_node_t *pfn, const char *component)
 {
-	char *name = malloc(MAX_FILE_NAME_LEN + 1);
-	if (name == NULL)
-		return ENOMEM;
-
-	block_t *block = NULL;
-	udf_file_identifier_descriptor_t *fid = NULL;
-	size_t pos = 0;
+	udf_node_t *parent = UDF_NODE(pfn);
+	fs_index_t index = 0;
+	bool found = false;
 
-	while (udf_get_fid(&fid, &block, UDF_NODE(pfn), pos) == EOK) {
-		udf_long_ad_t long_ad = fid->icb;
+	fibril_mutex_lock(&parent->lock);
 
-		udf_to_unix_name(name, MAX_FILE_NAME_LEN,
-		    (char *) fid->implementation_use + FLE16(fid->lenght_iu),
-		    fid->lenght_file_id, &UDF_NODE(pfn)->instance->charset);
-
-		if (str_casecmp(name, component) == 0) {
-			errno_t rc = udf_node_get(rfn, udf_service_get(pfn),
-			    udf_long_ad_to_pos(UDF_NODE(pfn)->instance, &long_ad));
-
-			if (block != NULL)
-				block_put(block);
+	errno_t rc = udf_dir_load(parent);
+	if (rc != EOK) {
+		fibril_mutex_unlock(&parent->lock);
+		return rc;
+	}
 
-			free(name);
-			return rc;
+	for (size_t i = 0; i < parent->dirent_cnt; i++) {
+		if (str_casecmp(parent->dirents[i].name, component) == 0) {
+			index = parent->dirents[i].index;
+			found = true;
+			break;
 		}
+	}
 
-		if (block != NULL) {
-			errno_t rc = block_put(block);
-			if (rc != EOK)
-				return rc;
-		}
+	fibril_mutex_unlock(&parent->lock);
 
-		pos++;
-	}
+	if (!found)
+		return ENOENT;
 
-	free(name);
-	return ENOENT;
+	return udf_node_get(rfn, udf_service_get(pfn), index);
 }
 
 static errno_t udf_node_open(fs_node_t *fn)
@@ -165,15 +148,7 @@ static errno_t udf_node_put(fs_node_t *fn)
 	if (!node)
 		return EINVAL;
 
-	fibril_mutex_lock(&node->lock);
-	node->ref_cnt--;
-	fibril_mutex_unlock(&node->lock);
-
-	/* Delete node from hash table and memory */
-	if (!node->ref_cnt)
-		udf_idx_del(node);
-
-	return EOK;
+	return udf_idx_put(node);
 }
 
 static errno_t udf_create_node(fs_node_t **rfn, service_id_t service_id, int flags)
@@ -385,6 +360,8 @@ static errno_t udf_mounted(service_id_t service_id, const char *opts,
 		return rc;
 	}
 
+	(void) block_cache_readahead(service_id, UDF_READ_AHEAD);
+
 	/* Read Volume Descriptor Sequence */
 	rc = udf_read_volume_descriptor_sequence(service_id, avd.main_extent);
 	if (rc != EOK) {
@@ -440,6 +417,7 @@ static errno_t udf_unmounted(service_id_t service_id)
 	udf_node_put(fn);
 	udf_node_put(fn);
 
+	udf_idx_purge(instance);
 	fs_instance_destroy(service_id);
 	free(instance);
 	block_cache_fini(service_id);
@@ -493,32 +471,25 @@ static errno_t udf_read(service_id_t service_id, fs_index_t index, aoff64_t pos,
 		(void) udf_node_put(rfn);
 		return rc;
 	} else {
-		block_t *block = NULL;
-		udf_file_identifier_descriptor_t *fid = NULL;
-		if (udf_get_fid(&fid, &block, node, pos) == EOK) {
-			char *name = malloc(MAX_FILE_NAME_LEN + 1);
+		fibril_mutex_lock(&node->lock);
 
-			// FIXME: Check for NULL return value
+		rc = udf_dir_load(node);
+		if ((rc == EOK) && (pos >= node->dirent_cnt))
+			rc = ENOENT;
 
-			udf_to_unix_name(name, MAX_FILE_NAME_LEN,
-			    (char *) fid->implementation_use + FLE16(fid->lenght_iu),
-			    fid->lenght_file_id, &node->instance->charset);
+		if (rc == EOK) {
+			char *name = node->dirents[pos].name;
 
 			async_data_read_finalize(chandle, name, str_size(name) + 1);
 			*rbytes = 1;
-			free(name);
-			udf_node_put(rfn);
-
-			if (block != NULL)
-				return block_put(block);
-
-			return EOK;
 		} else {
 			*rbytes = 0;
-			udf_node_put(rfn);
-			async_answer_0(chandle, ENOENT);
-			return ENOENT;
+			async_answer_0(chandle, rc);
 		}
+
+		fibril_mutex_unlock(&node->lock);
+		udf_node_put(rfn);
+		return rc;
 	}
 }
 
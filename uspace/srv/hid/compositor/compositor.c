@@ -39,6 +39,7 @@
 #include <str_error.h>
 #include <byteorder.h>
 #include <stdio.h>
+#include <inttypes.h>
 #include <libc.h>
 
 #include <align.h>
@@ -56,6 +57,7 @@
 #include <async.h>
 #include <loc.h>
 #include <task.h>
+#include <sys/time.h>
 
 #include <io/keycode.h>
 #include <io/mode.h>
@@ -65,6 +67,7 @@
 
 #include <transform.h>
 #include <rectangle.h>
+#include <region.h>
 #include <surface.h>
 #include <cursor.h>
 #include <source.h>
@@ -84,6 +87,9 @@
 #define ANIMATE_WINDOW_TRANSFORMS 0
 #endif
 
+/** Number of buffers shared by double-buffered windows. */
+#define WINDOW_BUFFERS  2
+
 static char *server_name;
 static sysarg_t coord_origin;
 static pixel_t bg_color;
@@ -105,6 +111,7 @@ typedef struct {
 	double angle;
 	uint8_t opacity;
 	surface_t *surface;
+	surface_t *buffers[WINDOW_BUFFERS];
 } window_t;
 
 static service_id_t winreg_id;
@@ -233,10 +240,25 @@ static window_t *window_create(void)
 	win->angle = 0;
 	win->opacity = 255;
 	win->surface = NULL;
+	for (unsigned int i = 0; i < WINDOW_BUFFERS; i++)
+		win->buffers[i] = NULL;
 
 	return win;
 }
 
+/** Destroy all buffers shared by the window client. */
+static void window_buffers_destroy(window_t *win)
+{
+	for (unsigned int i = 0; i < WINDOW_BUFFERS; i++) {
+		if (win->buffers[i]) {
+			surface_destroy(win->buffers[i]);
+			win->buffers[i] = NULL;
+		}
+	}
+
+	win->surface = NULL;
+}
+
 static void window_destroy(window_t *win)
 {
 	if ((win) && (atomic_get(&win->ref_cnt) == 0)) {
@@ -246,8 +268,7 @@ static void window_destroy(window_t *win)
 			free(event);
 		}
 
-		if (win->surface)
-			surface_destroy(win->surface);
+		window_buffers_destroy(win);
 
 		free(win);
 	}
@@ -379,211 +400,379 @@ static void comp_restrict_pointers(void)
 	fibril_mutex_unlock(&pointer_list_mtx);
 }
 
-static void comp_damage(sysarg_t x_dmg_glob, sysarg_t y_dmg_glob,
-    sysarg_t w_dmg_glob, sysarg_t h_dmg_glob)
+/** Maximum number of rectangles of the pending damage. */
+#define DAMAGE_RECTS_MAX  16
+
+/** Damage waiting to be repainted, in global coordinates. */
+static region_t damage_region;
+/** The whole screen is to be repainted, damage_region aside. */
+static bool damage_all = false;
+/** Number of damage requests so far. */
+static unsigned int damage_gen = 0;
+/** Number of damage requests repainted so far. */
+static unsigned int damage_repainted_gen = 0;
+static FIBRIL_MUTEX_INITIALIZE(damage_mtx);
+/** Signalled when damage is added. */
+static FIBRIL_CONDVAR_INITIALIZE(damage_cv);
+/** Signalled when a repaint is finished. */
+static FIBRIL_CONDVAR_INITIALIZE(repaint_cv);
+
+/** Refresh rate of viewports which do not report any, in Hz. */
+#define DEFAULT_REFRESH_RATE  60
+
+/** Statistics of the painted frames. */
+typedef struct {
+	/** Number of painted frames. */
+	uint64_t frames;
+	/** Number of frames skipped because painting took too long. */
+	uint64_t skipped;
+	/** Total time spent painting, in microseconds. */
+	uint64_t paint_total;
+	/** Longest time spent painting a frame, in microseconds. */
+	uint64_t paint_max;
+} frame_stats_t;
+
+/** Frame statistics, protected by damage_mtx. */
+static frame_stats_t frame_stats;
+
+/** Window together with the part of it that is to be painted. */
+typedef struct {
+	window_t *win;
+	region_t visible;
+} comp_layer_t;
+
+/** Determine whether a window hides everything below its bounding rectangle.
+ *
+ * Windows under an integer translation are transferred by copying their
+ * pixels, so they are opaque unless they are translucent as a whole.
+ */
+static bool comp_window_is_opaque(window_t *win)
 {
-	fibril_mutex_lock(&viewport_list_mtx);
-	fibril_mutex_lock(&window_list_mtx);
-	fibril_mutex_lock(&pointer_list_mtx);
+	return (win->opacity == 255) && transform_is_fast(&win->transform);
+}
 
-	list_foreach(viewport_list, link, viewport_t, vp) {
-		/* Determine what part of the viewport must be updated. */
-		sysarg_t x_dmg_vp, y_dmg_vp, w_dmg_vp, h_dmg_vp;
-		surface_get_resolution(vp->surface, &w_dmg_vp, &h_dmg_vp);
-		bool isec_vp = rectangle_intersect(
-		    x_dmg_glob, y_dmg_glob, w_dmg_glob, h_dmg_glob,
-		    vp->pos.x, vp->pos.y, w_dmg_vp, h_dmg_vp,
-		    &x_dmg_vp, &y_dmg_vp, &w_dmg_vp, &h_dmg_vp);
+/** Determine the rectangle of the screen covered by a window. */
+static bool comp_window_bounds(window_t *win, sysarg_t *x, sysarg_t *y,
+    sysarg_t *w, sysarg_t *h)
+{
+	if (!win->surface)
+		return false;
 
-		if (isec_vp) {
+	surface_get_resolution(win->surface, w, h);
+	comp_coord_bounding_rect(0, 0, *w, *h, win->transform, x, y, w, h);
+	return (*w > 0) && (*h > 0);
+}
 
-			/* Paint background color. */
-			for (sysarg_t y = y_dmg_vp - vp->pos.y; y <  y_dmg_vp - vp->pos.y + h_dmg_vp; ++y) {
-				pixel_t *dst = pixelmap_pixel_at(
-				    surface_pixmap_access(vp->surface), x_dmg_vp - vp->pos.x, y);
-				sysarg_t count = w_dmg_vp;
-				while (count-- != 0) {
-					*dst++ = bg_color;
-				}
+/** Paint the background in a set of rectangles of a viewport. */
+static void comp_paint_background(viewport_t *vp, const region_rect_t *rects,
+    size_t count)
+{
+	pixelmap_t *pixmap = surface_pixmap_access(vp->surface);
+
+	for (size_t i = 0; i < count; i++) {
+		const region_rect_t *r = &rects[i];
+		for (sysarg_t y = r->y - vp->pos.y; y < r->y - vp->pos.y + r->h; ++y) {
+			pixel_t *dst = pixelmap_pixel_at(pixmap, r->x - vp->pos.x, y);
+			sysarg_t count = r->w;
+			while (count-- != 0) {
+				*dst++ = bg_color;
 			}
-			surface_add_damaged_region(vp->surface,
-			    x_dmg_vp - vp->pos.x, y_dmg_vp - vp->pos.y, w_dmg_vp, h_dmg_vp);
+		}
+		surface_add_damaged_region(vp->surface,
+		    r->x - vp->pos.x, r->y - vp->pos.y, r->w, r->h);
+	}
+}
 
-			transform_t transform;
-			source_t source;
-			drawctx_t context;
+/** Paint a window in a set of rectangles of a viewport. */
+static void comp_paint_window(viewport_t *vp, window_t *win,
+    const region_rect_t *rects, size_t count)
+{
+	if (count == 0 || !win->surface)
+		return;
 
-			source_init(&source);
-			source_set_filter(&source, filter);
-			drawctx_init(&context, vp->surface);
-			drawctx_set_compose(&context, compose_over);
-			drawctx_set_source(&context, &source);
+	source_t source;
+	drawctx_t context;
 
-			/* For each window. */
-			for (link_t *link = window_list.head.prev;
-			    link != &window_list.head; link = link->prev) {
+	source_init(&source);
+	source_set_filter(&source, filter);
+	drawctx_init(&context, vp->surface);
+	drawctx_set_compose(&context, compose_over);
+	drawctx_set_source(&context, &source);
+
+	/*
+	 * Prepare conversion from global coordinates to viewport
+	 * coordinates.
+	 */
+	transform_t transform = win->transform;
+	double_point_t pos;
+	pos.x = vp->pos.x;
+	pos.y = vp->pos.y;
+	transform_translate(&transform, -pos.x, -pos.y);
+
+	source_set_transform(&source, transform);
+	source_set_texture(&source, win->surface,
+	    PIXELMAP_EXTEND_TRANSPARENT_SIDES);
+	source_set_alpha(&source, PIXEL(win->opacity, 0, 0, 0));
+
+	for (size_t i = 0; i < count; i++) {
+		drawctx_transfer(&context, rects[i].x - vp->pos.x,
+		    rects[i].y - vp->pos.y, rects[i].w, rects[i].h);
+	}
+}
 
+/** Paint ghosts and pointers in a rectangle of a viewport.
+ *
+ * Ghosts are drawn by inverting the pixels below, so each pixel must be
+ * painted only once per repaint.
+ */
+static void comp_paint_overlays(viewport_t *vp, sysarg_t x_dmg_vp,
+    sysarg_t y_dmg_vp, sysarg_t w_dmg_vp, sysarg_t h_dmg_vp)
+{
+	list_foreach(pointer_list, link, pointer_t, ptr) {
+		if (ptr->ghost.surface) {
+
+			sysarg_t x_bnd_ghost, y_bnd_ghost, w_bnd_ghost, h_bnd_ghost;
+			sysarg_t x_dmg_ghost, y_dmg_ghost, w_dmg_ghost, h_dmg_ghost;
+			surface_get_resolution(ptr->ghost.surface, &w_bnd_ghost, &h_bnd_ghost);
+			comp_coord_bounding_rect(0, 0, w_bnd_ghost, h_bnd_ghost, ptr->ghost.transform,
+			    &x_bnd_ghost, &y_bnd_ghost, &w_bnd_ghost, &h_bnd_ghost);
+			bool isec_ghost = rectangle_intersect(
+			    x_dmg_vp, y_dmg_vp, w_dmg_vp, h_dmg_vp,
+			    x_bnd_ghost, y_bnd_ghost, w_bnd_ghost, h_bnd_ghost,
+			    &x_dmg_ghost, &y_dmg_ghost, &w_dmg_ghost, &h_dmg_ghost);
+
+			if (isec_ghost) {
 				/*
-				 * Determine what part of the window intersects with the
-				 * updated area of the current viewport.
+				 * FIXME: Ghost is currently drawn based on the bounding
+				 * rectangle of the window, which is sufficient as long
+				 * as the windows can be rotated only by 90 degrees.
+				 * For ghost to be compatible with arbitrary-angle
+				 * rotation, it should be drawn as four lines adjusted
+				 * by the transformation matrix. That would however
+				 * require to equip libdraw with line drawing functionality.
 				 */
-				window_t *win = list_get_instance(link, window_t, link);
-				if (!win->surface) {
-					continue;
+
+				transform_t transform = ptr->ghost.transform;
+				double_point_t pos;
+				pos.x = vp->pos.x;
+				pos.y = vp->pos.y;
+				transform_translate(&transform, -pos.x, -pos.y);
+
+				pixel_t ghost_color;
+
+				if (y_bnd_ghost == y_dmg_ghost) {
+					for (sysarg_t x = x_dmg_ghost - vp->pos.x;
+					    x < x_dmg_ghost - vp->pos.x + w_dmg_ghost; ++x) {
+						ghost_color = surface_get_pixel(vp->surface,
+						    x, y_dmg_ghost - vp->pos.y);
+						surface_put_pixel(vp->surface,
+						    x, y_dmg_ghost - vp->pos.y, INVERT(ghost_color));
+					}
 				}
-				sysarg_t x_dmg_win, y_dmg_win, w_dmg_win, h_dmg_win;
-				surface_get_resolution(win->surface, &w_dmg_win, &h_dmg_win);
-				comp_coord_bounding_rect(0, 0, w_dmg_win, h_dmg_win, win->transform,
-				    &x_dmg_win, &y_dmg_win, &w_dmg_win, &h_dmg_win);
-				bool isec_win = rectangle_intersect(
-				    x_dmg_vp, y_dmg_vp, w_dmg_vp, h_dmg_vp,
-				    x_dmg_win, y_dmg_win, w_dmg_win, h_dmg_win,
-				    &x_dmg_win, &y_dmg_win, &w_dmg_win, &h_dmg_win);
-
-				if (isec_win) {
-					/*
-					 * Prepare conversion from global coordinates to viewport
-					 * coordinates.
-					 */
-					transform = win->transform;
-					double_point_t pos;
-					pos.x = vp->pos.x;
-					pos.y = vp->pos.y;
-					transform_translate(&transform, -pos.x, -pos.y);
-
-					source_set_transform(&source, transform);
-					source_set_texture(&source, win->surface,
-					    PIXELMAP_EXTEND_TRANSPARENT_SIDES);
-					source_set_alpha(&source, PIXEL(win->opacity, 0, 0, 0));
-
-					drawctx_transfer(&context,
-					    x_dmg_win - vp->pos.x, y_dmg_win - vp->pos.y, w_dmg_win, h_dmg_win);
+
+				if (y_bnd_ghost + h_bnd_ghost == y_dmg_ghost + h_dmg_ghost) {
+					for (sysarg_t x = x_dmg_ghost - vp->pos.x;
+					    x < x_dmg_ghost - vp->pos.x + w_dmg_ghost; ++x) {
+						ghost_color = surface_get_pixel(vp->surface,
+						    x, y_dmg_ghost - vp->pos.y + h_dmg_ghost - 1);
+						surface_put_pixel(vp->surface,
+						    x, y_dmg_ghost - vp->pos.y + h_dmg_ghost - 1, INVERT(ghost_color));
+					}
 				}
-			}
 
-			list_foreach(pointer_list, link, pointer_t, ptr) {
-				if (ptr->ghost.surface) {
-
-					sysarg_t x_bnd_ghost, y_bnd_ghost, w_bnd_ghost, h_bnd_ghost;
-					sysarg_t x_dmg_ghost, y_dmg_ghost, w_dmg_ghost, h_dmg_ghost;
-					surface_get_resolution(ptr->ghost.surface, &w_bnd_ghost, &h_bnd_ghost);
-					comp_coord_bounding_rect(0, 0, w_bnd_ghost, h_bnd_ghost, ptr->ghost.transform,
-					    &x_bnd_ghost, &y_bnd_ghost, &w_bnd_ghost, &h_bnd_ghost);
-					bool isec_ghost = rectangle_intersect(
-					    x_dmg_vp, y_dmg_vp, w_dmg_vp, h_dmg_vp,
-					    x_bnd_ghost, y_bnd_ghost, w_bnd_ghost, h_bnd_ghost,
-					    &x_dmg_ghost, &y_dmg_ghost, &w_dmg_ghost, &h_dmg_ghost);
-
-					if (isec_ghost) {
-						/*
-						 * FIXME: Ghost is currently drawn based on the bounding
-						 * rectangle of the window, which is sufficient as long
-						 * as the windows can be rotated only by 90 degrees.
-						 * For ghost to be compatible with arbitrary-angle
-						 * rotation, it should be drawn as four lines adjusted
-						 * by the transformation matrix. That would however
-						 * require to equip libdraw with line drawing functionality.
-						 */
-
-						transform_t transform = ptr->ghost.transform;
-						double_point_t pos;
-						pos.x = vp->pos.x;
-						pos.y = vp->pos.y;
-						transform_translate(&transform, -pos.x, -pos.y);
-
-						pixel_t ghost_color;
-
-						if (y_bnd_ghost == y_dmg_ghost) {
-							for (sysarg_t x = x_dmg_ghost - vp->pos.x;
-							    x < x_dmg_ghost - vp->pos.x + w_dmg_ghost; ++x) {
-								ghost_color = surface_get_pixel(vp->surface,
-								    x, y_dmg_ghost - vp->pos.y);
-								surface_put_pixel(vp->surface,
-								    x, y_dmg_ghost - vp->pos.y, INVERT(ghost_color));
-							}
-						}
-
-						if (y_bnd_ghost + h_bnd_ghost == y_dmg_ghost + h_dmg_ghost) {
-							for (sysarg_t x = x_dmg_ghost - vp->pos.x;
-							    x < x_dmg_ghost - vp->pos.x + w_dmg_ghost; ++x) {
-								ghost_color = surface_get_pixel(vp->surface,
-								    x, y_dmg_ghost - vp->pos.y + h_dmg_ghost - 1);
-								surface_put_pixel(vp->surface,
-								    x, y_dmg_ghost - vp->pos.y + h_dmg_ghost - 1, INVERT(ghost_color));
-							}
-						}
-
-						if (x_bnd_ghost == x_dmg_ghost) {
-							for (sysarg_t y = y_dmg_ghost - vp->pos.y;
-							    y < y_dmg_ghost - vp->pos.y + h_dmg_ghost; ++y) {
-								ghost_color = surface_get_pixel(vp->surface,
-								    x_dmg_ghost - vp->pos.x, y);
-								surface_put_pixel(vp->surface,
-								    x_dmg_ghost - vp->pos.x, y, INVERT(ghost_color));
-							}
-						}
-
-						if (x_bnd_ghost + w_bnd_ghost == x_dmg_ghost + w_dmg_ghost) {
-							for (sysarg_t y = y_dmg_ghost - vp->pos.y;
-							    y < y_dmg_ghost - vp->pos.y + h_dmg_ghost; ++y) {
-								ghost_color = surface_get_pixel(vp->surface,
-								    x_dmg_ghost - vp->pos.x + w_dmg_ghost - 1, y);
-								surface_put_pixel(vp->surface,
-								    x_dmg_ghost - vp->pos.x + w_dmg_ghost - 1, y, INVERT(ghost_color));
-							}
-						}
+				if (x_bnd_ghost == x_dmg_ghost) {
+					for (sysarg_t y = y_dmg_ghost - vp->pos.y;
+					    y < y_dmg_ghost - vp->pos.y + h_dmg_ghost; ++y) {
+						ghost_color = surface_get_pixel(vp->surface,
+						    x_dmg_ghost - vp->pos.x, y);
+						surface_put_pixel(vp->surface,
+						    x_dmg_ghost - vp->pos.x, y, INVERT(ghost_color));
 					}
+				}
 
+				if (x_bnd_ghost + w_bnd_ghost == x_dmg_ghost + w_dmg_ghost) {
+					for (sysarg_t y = y_dmg_ghost - vp->pos.y;
+					    y < y_dmg_ghost - vp->pos.y + h_dmg_ghost; ++y) {
+						ghost_color = surface_get_pixel(vp->surface,
+						    x_dmg_ghost - vp->pos.x + w_dmg_ghost - 1, y);
+						surface_put_pixel(vp->surface,
+						    x_dmg_ghost - vp->pos.x + w_dmg_ghost - 1, y, INVERT(ghost_color));
+					}
 				}
 			}
 
-			list_foreach(pointer_list, link, pointer_t, ptr) {
+		}
+	}
 
-				/*
-				 * Determine what part of the pointer intersects with the
-				 * updated area of the current viewport.
-				 */
-				sysarg_t x_dmg_ptr, y_dmg_ptr, w_dmg_ptr, h_dmg_ptr;
-				surface_t *sf_ptr = ptr->cursor.states[ptr->state];
-				surface_get_resolution(sf_ptr, &w_dmg_ptr, &h_dmg_ptr);
-				bool isec_ptr = rectangle_intersect(
-				    x_dmg_vp, y_dmg_vp, w_dmg_vp, h_dmg_vp,
-				    ptr->pos.x, ptr->pos.y, w_dmg_ptr, h_dmg_ptr,
-				    &x_dmg_ptr, &y_dmg_ptr, &w_dmg_ptr, &h_dmg_ptr);
-
-				if (isec_ptr) {
-					/*
-					 * Pointer is currently painted directly by copying pixels.
-					 * However, it is possible to draw the pointer similarly
-					 * as window by using drawctx_transfer. It would allow
-					 * more sophisticated control over drawing, but would also
-					 * cost more regarding the performance.
-					 */
-
-					sysarg_t x_vp = x_dmg_ptr - vp->pos.x;
-					sysarg_t y_vp = y_dmg_ptr - vp->pos.y;
-					sysarg_t x_ptr = x_dmg_ptr - ptr->pos.x;
-					sysarg_t y_ptr = y_dmg_ptr - ptr->pos.y;
-
-					for (sysarg_t y = 0; y < h_dmg_ptr; ++y) {
-						pixel_t *src = pixelmap_pixel_at(
-						    surface_pixmap_access(sf_ptr), x_ptr, y_ptr + y);
-						pixel_t *dst = pixelmap_pixel_at(
-						    surface_pixmap_access(vp->surface), x_vp, y_vp + y);
-						sysarg_t count = w_dmg_ptr;
-						while (count-- != 0) {
-							*dst = (*src & 0xff000000) ? *src : *dst;
-							++dst;
-							++src;
-						}
-					}
-					surface_add_damaged_region(vp->surface, x_vp, y_vp, w_dmg_ptr, h_dmg_ptr);
+	list_foreach(pointer_list, link, pointer_t, ptr) {
+
+		/*
+		 * Determine what part of the pointer intersects with the
+		 * updated area of the current viewport.
+		 */
+		sysarg_t x_dmg_ptr, y_dmg_ptr, w_dmg_ptr, h_dmg_ptr;
+		surface_t *sf_ptr = ptr->cursor.states[ptr->state];
+		surface_get_resolution(sf_ptr, &w_dmg_ptr, &h_dmg_ptr);
+		bool isec_ptr = rectangle_intersect(
+		    x_dmg_vp, y_dmg_vp, w_dmg_vp, h_dmg_vp,
+		    ptr->pos.x, ptr->pos.y, w_dmg_ptr, h_dmg_ptr,
+		    &x_dmg_ptr, &y_dmg_ptr, &w_dmg_ptr, &h_dmg_ptr);
+
+		if (isec_ptr) {
+			/*
+			 * Pointer is currently painted directly by copying pixels.
+			 * However, it is possible to draw the pointer similarly
+			 * as window by using drawctx_transfer. It would allow
+			 * more sophisticated control over drawing, but would also
+			 * cost more regarding the performance.
+			 */
+
+			sysarg_t x_vp = x_dmg_ptr - vp->pos.x;
+			sysarg_t y_vp = y_dmg_ptr - vp->pos.y;
+			sysarg_t x_ptr = x_dmg_ptr - ptr->pos.x;
+			sysarg_t y_ptr = y_dmg_ptr - ptr->pos.y;
+
+			for (sysarg_t y = 0; y < h_dmg_ptr; ++y) {
+				pixel_t *src = pixelmap_pixel_at(
+				    surface_pixmap_access(sf_ptr), x_ptr, y_ptr + y);
+				pixel_t *dst = pixelmap_pixel_at(
+				    surface_pixmap_access(vp->surface), x_vp, y_vp + y);
+				sysarg_t count = w_dmg_ptr;
+				while (count-- != 0) {
+					*dst = (*src & 0xff000000) ? *src : *dst;
+					++dst;
+					++src;
 				}
+			}
+			surface_add_damaged_region(vp->surface, x_vp, y_vp, w_dmg_ptr, h_dmg_ptr);
+		}
+
+	}
+}
+
+/** Paint the windows and the background of a viewport.
+ *
+ * The windows are walked from the top to determine the part of each of them
+ * which is not hidden by opaque windows above it. Then only those parts and
+ * the rest of the background are painted from the bottom.
+ *
+ * @param vp     Viewport to paint.
+ * @param damage Disjoint rectangles to paint, in global coordinates.
+ *
+ * @return EOK on success or ENOMEM if there is not enough memory.
+ */
+static errno_t comp_paint_layers(viewport_t *vp, const region_t *damage)
+{
+	size_t nwin = list_count(&window_list);
+	comp_layer_t *layers = calloc(nwin, sizeof(comp_layer_t));
+	if (nwin > 0 && layers == NULL)
+		return ENOMEM;
+
+	region_t uncovered;
+	region_init(&uncovered);
+
+	errno_t rc = region_copy(&uncovered, damage);
+
+	size_t n = 0;
+	list_foreach(window_list, link, window_t, win) {
+		if (rc != EOK)
+			break;
+
+		if (region_empty(&uncovered))
+			break;
+
+		sysarg_t x, y, w, h;
+		if (!comp_window_bounds(win, &x, &y, &w, &h))
+			continue;
+
+		comp_layer_t *layer = &layers[n++];
+		layer->win = win;
+		region_init(&layer->visible);
+
+		rc = region_intersect(&layer->visible, &uncovered, x, y, w, h);
+		if (rc == EOK && comp_window_is_opaque(win))
+			rc = region_subtract(&uncovered, x, y, w, h);
+	}
+
+	if (rc == EOK) {
+		comp_paint_background(vp, uncovered.rects, uncovered.count);
+
+		for (size_t i = n; i > 0; i--) {
+			comp_layer_t *layer = &layers[i - 1];
+			comp_paint_window(vp, layer->win, layer->visible.rects,
+			    layer->visible.count);
+		}
+	}
+
+	for (size_t i = 0; i < n; i++)
+		region_fini(&layers[i].visible);
+	free(layers);
+	region_fini(&uncovered);
+
+	return rc;
+}
+
+/** Repaint damaged parts of all viewports.
+ *
+ * @param damage Damage to repaint, in global coordinates.
+ * @param all    Repaint all viewports completely.
+ */
+static void comp_repaint(const region_t *damage, bool all)
+{
+	fibril_mutex_lock(&viewport_list_mtx);
+	fibril_mutex_lock(&window_list_mtx);
+	fibril_mutex_lock(&pointer_list_mtx);
+
+	region_t dmg_vp;
+	region_init(&dmg_vp);
+
+	list_foreach(viewport_list, link, viewport_t, vp) {
+		/* Determine what part of the viewport must be updated. */
+		sysarg_t w_vp, h_vp;
+		surface_get_resolution(vp->surface, &w_vp, &h_vp);
+
+		errno_t rc;
+		if (all) {
+			region_clear(&dmg_vp);
+			rc = region_add(&dmg_vp, vp->pos.x, vp->pos.y, w_vp, h_vp);
+		} else {
+			rc = region_intersect(&dmg_vp, damage, vp->pos.x, vp->pos.y,
+			    w_vp, h_vp);
+		}
+
+		if (rc == EOK)
+			rc = comp_paint_layers(vp, &dmg_vp);
+
+		const region_rect_t *rects = dmg_vp.rects;
+		size_t count = dmg_vp.count;
+		region_rect_t r = {
+			.x = vp->pos.x,
+			.y = vp->pos.y,
+			.w = w_vp,
+			.h = h_vp
+		};
+
+		if (rc != EOK) {
+			/* Without memory for the regions paint everything. */
+			rects = &r;
+			count = 1;
 
+			comp_paint_background(vp, rects, count);
+			for (link_t *link = window_list.head.prev;
+			    link != &window_list.head; link = link->prev) {
+				window_t *win = list_get_instance(link, window_t, link);
+				comp_paint_window(vp, win, rects, count);
 			}
 		}
+
+		for (size_t i = 0; i < count; i++) {
+			comp_paint_overlays(vp, rects[i].x, rects[i].y,
+			    rects[i].w, rects[i].h);
+		}
 	}
 
+	region_fini(&dmg_vp);
+
 	fibril_mutex_unlock(&pointer_list_mtx);
 	fibril_mutex_unlock(&window_list_mtx);
 
@@ -601,6 +790,147 @@ static void comp_damage(sysarg_t x_dmg_glob, sysarg_t y_dmg_glob,
 	fibril_mutex_unlock(&viewport_list_mtx);
 }
 
+/** Determine the frame period of the viewports in microseconds.
+ *
+ * Frames follow the viewport with the highest refresh rate.
+ */
+static suseconds_t comp_frame_period(void)
+{
+	sysarg_t rate = 0;
+
+	fibril_mutex_lock(&viewport_list_mtx);
+	list_foreach(viewport_list, link, viewport_t, vp) {
+		if (vp->mode.refresh_rate > rate)
+			rate = vp->mode.refresh_rate;
+	}
+	fibril_mutex_unlock(&viewport_list_mtx);
+
+	if (rate == 0)
+		rate = DEFAULT_REFRESH_RATE;
+
+	return 1000000 / rate;
+}
+
+/** Get the uptime in microseconds. */
+static uint64_t comp_uptime(void)
+{
+	struct timeval tv;
+	getuptime(&tv);
+	return (uint64_t) tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+/** Repaint the damage once per frame.
+ *
+ * Frames start at multiples of the frame period. Damage added before the
+ * next frame starts is repainted in that frame together. Frames which
+ * would have started while the previous frame was still being painted are
+ * skipped.
+ */
+static errno_t comp_repaint_fibril(void *arg)
+{
+	region_t damage;
+	region_init(&damage);
+
+	uint64_t next_frame = 0;
+
+	while (true) {
+		fibril_mutex_lock(&damage_mtx);
+		while (damage_repainted_gen == damage_gen)
+			fibril_condvar_wait(&damage_cv, &damage_mtx);
+		fibril_mutex_unlock(&damage_mtx);
+
+		uint64_t now = comp_uptime();
+		if (now < next_frame)
+			async_usleep(next_frame - now);
+
+		fibril_mutex_lock(&damage_mtx);
+		region_swap(&damage, &damage_region);
+		region_clear(&damage_region);
+		bool all = damage_all;
+		damage_all = false;
+		unsigned int gen = damage_gen;
+		fibril_mutex_unlock(&damage_mtx);
+
+		uint64_t start = comp_uptime();
+		comp_repaint(&damage, all);
+		uint64_t end = comp_uptime();
+
+		suseconds_t period = comp_frame_period();
+		next_frame = (end / period + 1) * period;
+
+		fibril_mutex_lock(&damage_mtx);
+		frame_stats.frames++;
+		frame_stats.skipped += (end - start) / period;
+		frame_stats.paint_total += end - start;
+		if (end - start > frame_stats.paint_max)
+			frame_stats.paint_max = end - start;
+
+		damage_repainted_gen = gen;
+		fibril_condvar_broadcast(&repaint_cv);
+		fibril_mutex_unlock(&damage_mtx);
+	}
+
+	return EOK;
+}
+
+/** Print the frame statistics. */
+static void comp_frame_stats_print(void)
+{
+	fibril_mutex_lock(&damage_mtx);
+	frame_stats_t stats = frame_stats;
+	fibril_mutex_unlock(&damage_mtx);
+
+	printf("%s: %" PRIu64 " frames, %" PRIu64 " skipped, "
+	    "paint time avg %" PRIu64 " us, max %" PRIu64 " us\n", NAME,
+	    stats.frames, stats.skipped,
+	    stats.frames > 0 ? stats.paint_total / stats.frames : 0,
+	    stats.paint_max);
+}
+
+/** Mark a part of the screen for repainting.
+ *
+ * The damage is repainted in the next frame, together with all damage
+ * added in the meantime.
+ */
+static void comp_damage(sysarg_t x_dmg_glob, sysarg_t y_dmg_glob,
+    sysarg_t w_dmg_glob, sysarg_t h_dmg_glob)
+{
+	/* Keep the right and bottom edges representable. */
+	if (w_dmg_glob > UINTPTR_MAX - x_dmg_glob)
+		w_dmg_glob = UINTPTR_MAX - x_dmg_glob;
+	if (h_dmg_glob > UINTPTR_MAX - y_dmg_glob)
+		h_dmg_glob = UINTPTR_MAX - y_dmg_glob;
+
+	fibril_mutex_lock(&damage_mtx);
+
+	if (!damage_all) {
+		if (damage_region.count >= DAMAGE_RECTS_MAX) {
+			sysarg_t x, y, w, h;
+			region_bounds(&damage_region, &x, &y, &w, &h);
+			region_clear(&damage_region);
+			(void) region_add(&damage_region, x, y, w, h);
+		}
+
+		if (region_add(&damage_region, x_dmg_glob, y_dmg_glob,
+		    w_dmg_glob, h_dmg_glob) != EOK)
+			damage_all = true;
+	}
+
+	damage_gen++;
+	fibril_condvar_signal(&damage_cv);
+	fibril_mutex_unlock(&damage_mtx);
+}
+
+/** Wait until all damage added so far is repainted. */
+static void comp_damage_wait(void)
+{
+	fibril_mutex_lock(&damage_mtx);
+	unsigned int gen = damage_gen;
+	while ((int) (damage_repainted_gen - gen) < 0)
+		fibril_condvar_wait(&repaint_cv, &damage_mtx);
+	fibril_mutex_unlock(&damage_mtx);
+}
+
 static void comp_window_get_event(window_t *win, cap_call_handle_t icall_handle, ipc_call_t *icall)
 {
 	window_event_t *event = (window_event_t *) prodcons_consume(&win->queue);
@@ -643,6 +973,52 @@ static void comp_window_damage(window_t *win, cap_call_handle_t icall_handle, ip
 		comp_damage(x_dmg_glob, y_dmg_glob, w_dmg_glob, h_dmg_glob);
 	}
 
+	/*
+	 * The client may change the surface once it gets the answer. Waiting
+	 * for the frame also keeps clients from damaging faster than frames
+	 * are painted.
+	 */
+	comp_damage_wait();
+
+	async_answer_0(icall_handle, EOK);
+}
+
+/** Make one of the buffers of a double-buffered window visible.
+ *
+ * Unlike comp_window_damage() the answer does not wait for the frame. The
+ * flip happens under window_list_mtx which is also held while painting, so
+ * once it is done no paint reads the previously presented buffer anymore.
+ */
+static void comp_window_present(window_t *win, cap_call_handle_t icall_handle, ipc_call_t *icall)
+{
+	sysarg_t index = IPC_GET_ARG1(*icall);
+	double x = IPC_GET_ARG2(*icall);
+	double y = IPC_GET_ARG3(*icall);
+	double width = IPC_GET_ARG4(*icall);
+	double height = IPC_GET_ARG5(*icall);
+
+	fibril_mutex_lock(&window_list_mtx);
+
+	if ((index >= WINDOW_BUFFERS) || (win->buffers[index] == NULL)) {
+		fibril_mutex_unlock(&window_list_mtx);
+		async_answer_0(icall_handle, EINVAL);
+		return;
+	}
+
+	win->surface = win->buffers[index];
+
+	sysarg_t x_dmg_glob = 0;
+	sysarg_t y_dmg_glob = 0;
+	sysarg_t w_dmg_glob = UINT32_MAX;
+	sysarg_t h_dmg_glob = UINT32_MAX;
+	if ((width != 0) && (height != 0)) {
+		comp_coord_bounding_rect(x - 1, y - 1, width + 2, height + 2,
+		    win->transform, &x_dmg_glob, &y_dmg_glob, &w_dmg_glob, &h_dmg_glob);
+	}
+
+	fibril_mutex_unlock(&window_list_mtx);
+
+	comp_damage(x_dmg_glob, y_dmg_glob, w_dmg_glob, h_dmg_glob);
 	async_answer_0(icall_handle, EOK);
 }
 
@@ -711,25 +1087,43 @@ static void comp_window_resize(window_t *win, cap_call_handle_t icall_handle, ip
 	size_t size;
 	unsigned int flags;
 
-	/* Start sharing resized window with client. */
-	if (!async_share_out_receive(&chandle, &size, &flags)) {
-		async_answer_0(icall_handle, EINVAL);
-		return;
-	}
+	/* Double-buffered clients share out both buffers, front one first. */
+	unsigned int count =
+	    (win->flags & WINDOW_DOUBLE_BUFFERED) ? WINDOW_BUFFERS : 1;
+	surface_t *new_buffers[WINDOW_BUFFERS] = { NULL };
+	errno_t rc = EOK;
 
-	void *new_cell_storage;
-	errno_t rc = async_share_out_finalize(chandle, &new_cell_storage);
-	if ((rc != EOK) || (new_cell_storage == AS_MAP_FAILED)) {
-		async_answer_0(icall_handle, ENOMEM);
-		return;
+	for (unsigned int i = 0; i < count; i++) {
+		/* Start sharing resized window with client. */
+		if (!async_share_out_receive(&chandle, &size, &flags)) {
+			rc = EINVAL;
+			break;
+		}
+
+		void *new_cell_storage;
+		rc = async_share_out_finalize(chandle, &new_cell_storage);
+		if ((rc != EOK) || (new_cell_storage == AS_MAP_FAILED)) {
+			rc = ENOMEM;
+			break;
+		}
+
+		/* Create new surface for the resized window. */
+		new_buffers[i] = surface_create(IPC_GET_ARG3(*icall),
+		    IPC_GET_ARG4(*icall), new_cell_storage, SURFACE_FLAG_SHARED);
+		if (!new_buffers[i]) {
+			as_area_destroy(new_cell_storage);
+			rc = ENOMEM;
+			break;
+		}
 	}
 
-	/* Create new surface for the resized window. */
-	surface_t *new_surface = surface_create(IPC_GET_ARG3(*icall),
-	    IPC_GET_ARG4(*icall), new_cell_storage, SURFACE_FLAG_SHARED);
-	if (!new_surface) {
-		as_area_destroy(new_cell_storage);
-		async_answer_0(icall_handle, ENOMEM);
+	if (rc != EOK) {
+		for (unsigned int i = 0; i < count; i++) {
+			if (new_buffers[i])
+				surface_destroy(new_buffers[i]);
+		}
+
+		async_answer_0(icall_handle, rc);
 		return;
 	}
 
@@ -748,10 +1142,12 @@ static void comp_window_resize(window_t *win, cap_call_handle_t icall_handle, ip
 
 	if (win->surface) {
 		surface_get_resolution(win->surface, &old_width, &old_height);
-		surface_destroy(win->surface);
+		window_buffers_destroy(win);
 	}
 
-	win->surface = new_surface;
+	for (unsigned int i = 0; i < count; i++)
+		win->buffers[i] = new_buffers[i];
+	win->surface = win->buffers[0];
 
 	sysarg_t new_width = 0;
 	sysarg_t new_height = 0;
@@ -1039,6 +1435,9 @@ static void client_connection(cap_call_handle_t icall_handle, ipc_call_t *icall,
 			case WINDOW_RESIZE:
 				comp_window_resize(win, chandle, &call);
 				break;
+			case WINDOW_PRESENT:
+				comp_window_present(win, chandle, &call);
+				break;
 			case WINDOW_CLOSE:
 				/*
 				 * Postpone the closing until the phone is hung up to cover
@@ -1869,10 +2268,12 @@ static errno_t comp_key_press(input_t *input, kbd_event_type_t type, keycode_t k
 	bool viewport_change = (mods & KM_ALT) && (key == KC_O || key == KC_P);
 	bool kconsole_switch = (key == KC_PAUSE) || (key == KC_BREAK);
 	bool filter_switch = (mods & KM_ALT) && (key == KC_Y);
+	bool stats_print = (mods & KM_ALT) && (key == KC_H);
 
 	bool key_filter = (type == KEY_RELEASE) && (win_transform || win_resize ||
 	    win_opacity || win_close || win_switch || viewport_move ||
-	    viewport_change || kconsole_switch || filter_switch);
+	    viewport_change || kconsole_switch || filter_switch ||
+	    stats_print);
 
 	if (key_filter) {
 		/* no-op */
@@ -2144,14 +2545,18 @@ static errno_t comp_key_press(input_t *input, kbd_event_type_t type, keycode_t k
 			active = false;
 	} else if (filter_switch) {
 		filter_index++;
-		if (filter_index > 1)
+		if (filter_index > 2)
 			filter_index = 0;
 		if (filter_index == 0) {
 			filter = filter_nearest;
-		} else {
+		} else if (filter_index == 1) {
 			filter = filter_bilinear;
+		} else {
+			filter = filter_bicubic;
 		}
 		comp_damage(0, 0, UINT32_MAX, UINT32_MAX);
+	} else if (stats_print) {
+		comp_frame_stats_print();
 	} else {
 		window_event_t *event = (window_event_t *) malloc(sizeof(window_event_t));
 		if (event == NULL)
@@ -2318,6 +2723,15 @@ static errno_t compositor_srv_init(char *input_svc, char *name)
 		return rc;
 	}
 
+	region_init(&damage_region);
+	fid_t fid = fibril_create(comp_repaint_fibril, NULL);
+	if (fid == 0) {
+		printf("%s: Unable to create repaint fibril\n", NAME);
+		input_disconnect();
+		return ENOMEM;
+	}
+	fibril_add_ready(fid);
+
 	discover_viewports();
 
 	comp_restrict_pointers();
@@ -51,11 +51,15 @@
 #include <fibril_synch.h>
 #include <stdlib.h>
 #include <str.h>
+#include <sys/time.h>
 #include "console.h"
 
 #define NAME       "console"
 #define NAMESPACE  "term"
 
+/** Minimum interval between output updates of a console (in microseconds) */
+#define UPDATE_INTERVAL  20000
+
 #define UTF8_CHAR_BUFFER_SIZE  (STR_BOUNDS(1) + 1)
 
 typedef struct {
@@ -80,6 +84,10 @@ typedef struct {
 	chargrid_t *frontbuf;    /**< Front buffer */
 	frontbuf_handle_t fbid;  /**< Front buffer handle */
 	con_srvs_t srvs;         /**< Console service setup */
+
+	fibril_timer_t *update_timer;  /**< Deferred output update */
+	bool update_pending;           /**< Deferred output update is set */
+	struct timeval last_update;    /**< Time of the last output update */
 } console_t;
 
 /** Input server proxy */
@@ -162,6 +170,8 @@ static void cons_update(console_t *cons)
 	fibril_mutex_lock(&switch_mtx);
 	fibril_mutex_lock(&cons->mtx);
 
+	getuptime(&cons->last_update);
+
 	if ((active) && (cons == active_console)) {
 		output_update(output_sess, cons->fbid);
 		output_cursor_update(output_sess, cons->fbid);
@@ -171,6 +181,47 @@ static void cons_update(console_t *cons)
 	fibril_mutex_unlock(&switch_mtx);
 }
 
+static void cons_update_timeout(void *arg)
+{
+	console_t *cons = (console_t *) arg;
+
+	fibril_mutex_lock(&cons->mtx);
+	cons->update_pending = false;
+	fibril_mutex_unlock(&cons->mtx);
+
+	cons_update(cons);
+}
+
+/** Request an output update of a console
+ *
+ * Updates are sent at most once per UPDATE_INTERVAL. Writes arriving
+ * in between are only recorded in the shared front buffer and picked
+ * up by a single deferred update, so bulk output does not turn into
+ * one output server exchange per write.
+ *
+ */
+static void cons_schedule_update(console_t *cons)
+{
+	struct timeval now;
+	getuptime(&now);
+
+	fibril_mutex_lock(&cons->mtx);
+
+	suseconds_t elapsed = tv_sub_diff(&now, &cons->last_update);
+	bool immediate = (elapsed >= UPDATE_INTERVAL) || (elapsed < 0);
+
+	if ((!immediate) && (!cons->update_pending)) {
+		cons->update_pending = true;
+		fibril_timer_set_locked(cons->update_timer,
+		    UPDATE_INTERVAL - elapsed, cons_update_timeout, cons);
+	}
+
+	fibril_mutex_unlock(&cons->mtx);
+
+	if (immediate)
+		cons_update(cons);
+}
+
 static void cons_update_cursor(console_t *cons)
 {
 	fibril_mutex_lock(&switch_mtx);
@@ -290,33 +341,28 @@ static errno_t input_ev_button(input_t *input, int bnum, int bpress)
 	return EOK;
 }
 
-/** Process a character from the client (TTY emulation). */
+/** Process a character from the client (TTY emulation).
+ *
+ * Called with the console mutex held.
+ *
+ */
 static void cons_write_char(console_t *cons, wchar_t ch)
 {
-	sysarg_t updated = 0;
-
-	fibril_mutex_lock(&cons->mtx);
-
 	switch (ch) {
 	case '\n':
-		updated = chargrid_newline(cons->frontbuf);
+		chargrid_newline(cons->frontbuf);
 		break;
 	case '\r':
 		break;
 	case '\t':
-		updated = chargrid_tabstop(cons->frontbuf, 8);
+		chargrid_tabstop(cons->frontbuf, 8);
 		break;
 	case '\b':
-		updated = chargrid_backspace(cons->frontbuf);
+		chargrid_backspace(cons->frontbuf);
 		break;
 	default:
-		updated = chargrid_putwchar(cons->frontbuf, ch, true);
+		chargrid_putwchar(cons->frontbuf, ch, true);
 	}
-
-	fibril_mutex_unlock(&cons->mtx);
-
-	if (updated > 1)
-		cons_update(cons);
 }
 
 static void cons_set_cursor_vis(console_t *cons, bool visible)
@@ -386,10 +432,16 @@ static errno_t cons_write(con_srv_t *srv, void *data, size_t size, size_t *nwrit
 {
 	console_t *cons = srv_to_console(srv);
 
+	fibril_mutex_lock(&cons->mtx);
+
 	size_t off = 0;
 	while (off < size)
 		cons_write_char(cons, str_decode(data, &off, size));
 
+	fibril_mutex_unlock(&cons->mtx);
+
+	cons_schedule_update(cons);
+
 	*nwritten = size;
 	return EOK;
 }
@@ -398,7 +450,7 @@ static void cons_sync(con_srv_t *srv)
 {
 	console_t *cons = srv_to_console(srv);
 
-	cons_update(cons);
+	cons_schedule_update(cons);
 }
 
 static void cons_clear(con_srv_t *srv)
@@ -626,6 +678,14 @@ static bool console_srv_init(char *input_svc, char *output_svc)
 				return false;
 			}
 
+			consoles[i].update_pending = false;
+			consoles[i].update_timer =
+			    fibril_timer_create(&consoles[i].mtx);
+			if (consoles[i].update_timer == NULL) {
+				printf("%s: Unable to create update timer %zu\n", NAME, i);
+				return false;
+			}
+
 			consoles[i].fbid = output_frontbuf_create(output_sess,
 			    consoles[i].frontbuf);
 			if (consoles[i].fbid == 0) {
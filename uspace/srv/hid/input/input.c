@@ -49,6 +49,7 @@
 #include <ipc/services.h>
 #include <ipc/input.h>
 #include <loc.h>
+#include <mem.h>
 #include <ns.h>
 #include <stdbool.h>
 #include <stdio.h>
@@ -129,6 +130,124 @@ static void client_data_destroy(void *data)
 	free(client);
 }
 
+/** Time over which pointer motion is accumulated (about a frame) */
+#define BATCH_FRAME_USEC  16000
+
+/*
+ * Events waiting for delivery to the active client. Pointer motion is
+ * coalesced and delivered once per frame, keys and buttons are delivered
+ * right away together with the motion that preceded them.
+ */
+static FIBRIL_MUTEX_INITIALIZE(batch_lock);
+static FIBRIL_CONDVAR_INITIALIZE(batch_cv);
+static input_batch_event_t batch[INPUT_BATCH_MAX];
+static size_t batch_count;
+static bool batch_urgent;
+
+/** Session of the active client or NULL. */
+static async_sess_t *active_client_sess(void)
+{
+	list_foreach(clients, link, client_t, client) {
+		if (client->active)
+			return client->sess;
+	}
+
+	return NULL;
+}
+
+/** Queue event for the active client.
+ *
+ * @param method Notification method (INPUT_EVENT_KEY, ...)
+ * @param urgent Deliver without waiting for the end of the frame
+ */
+static void batch_push(sysarg_t method, sysarg_t arg1, sysarg_t arg2,
+    sysarg_t arg3, sysarg_t arg4, bool urgent)
+{
+	fibril_mutex_lock(&batch_lock);
+
+	input_batch_event_t *last = (batch_count > 0) ?
+	    &batch[batch_count - 1] : NULL;
+
+	if (method == INPUT_EVENT_MOVE && last != NULL &&
+	    last->method == INPUT_EVENT_MOVE) {
+		/* Accumulate relative motion. */
+		last->arg[0] = (int) last->arg[0] + (int) arg1;
+		last->arg[1] = (int) last->arg[1] + (int) arg2;
+	} else if (method == INPUT_EVENT_ABS_MOVE && last != NULL &&
+	    last->method == INPUT_EVENT_ABS_MOVE) {
+		/* Only the latest position matters. */
+		last->arg[0] = arg1;
+		last->arg[1] = arg2;
+		last->arg[2] = arg3;
+		last->arg[3] = arg4;
+	} else {
+		if (batch_count == INPUT_BATCH_MAX) {
+			/* The delivery fibril is behind, drop the event. */
+			fibril_mutex_unlock(&batch_lock);
+			return;
+		}
+
+		batch[batch_count].method = method;
+		batch[batch_count].arg[0] = arg1;
+		batch[batch_count].arg[1] = arg2;
+		batch[batch_count].arg[2] = arg3;
+		batch[batch_count].arg[3] = arg4;
+		batch_count++;
+
+		if (batch_count == 1 || urgent || batch_count == INPUT_BATCH_MAX) {
+			batch_urgent = batch_urgent || urgent ||
+			    batch_count == INPUT_BATCH_MAX;
+			fibril_condvar_broadcast(&batch_cv);
+		}
+	}
+
+	fibril_mutex_unlock(&batch_lock);
+}
+
+/** Deliver queued events to the active client in one message. */
+static errno_t batch_fibril(void *arg)
+{
+	input_batch_event_t events[INPUT_BATCH_MAX];
+
+	fibril_mutex_lock(&batch_lock);
+
+	while (true) {
+		while (batch_count == 0)
+			fibril_condvar_wait(&batch_cv, &batch_lock);
+
+		/* Let pointer motion accumulate unless something urgent came. */
+		if (!batch_urgent) {
+			(void) fibril_condvar_wait_timeout(&batch_cv, &batch_lock,
+			    BATCH_FRAME_USEC);
+		}
+
+		const size_t count = batch_count;
+		memcpy(events, batch, count * sizeof(input_batch_event_t));
+		batch_count = 0;
+		batch_urgent = false;
+
+		fibril_mutex_unlock(&batch_lock);
+
+		async_sess_t *sess = active_client_sess();
+		if (sess != NULL) {
+			async_exch_t *exch = async_exchange_begin(sess);
+			aid_t req = async_send_0(exch, INPUT_EVENT_BATCH, NULL);
+			errno_t rc = async_data_write_start(exch, events,
+			    count * sizeof(input_batch_event_t));
+			async_exchange_end(exch);
+
+			if (rc != EOK)
+				async_forget(req);
+			else
+				async_wait_for(req, NULL);
+		}
+
+		fibril_mutex_lock(&batch_lock);
+	}
+
+	return EOK;
+}
+
 void kbd_push_data(kbd_dev_t *kdev, sysarg_t data)
 {
 	(*kdev->ctl_ops->parse)(data);
@@ -241,37 +360,23 @@ void kbd_push_event(kbd_dev_t *kdev, int type, unsigned int key)
 
 	ev.c = layout_parse_ev(kdev->active_layout, &ev);
 
-	list_foreach(clients, link, client_t, client) {
-		if (client->active) {
-			async_exch_t *exch = async_exchange_begin(client->sess);
-			async_msg_4(exch, INPUT_EVENT_KEY, ev.type, ev.key, ev.mods, ev.c);
-			async_exchange_end(exch);
-		}
-	}
+	batch_push(INPUT_EVENT_KEY, ev.type, ev.key, ev.mods, ev.c, true);
 }
 
 /** Mouse pointer has moved (relative mode). */
 void mouse_push_event_move(mouse_dev_t *mdev, int dx, int dy, int dz)
 {
-	list_foreach(clients, link, client_t, client) {
-		if (client->active) {
-			async_exch_t *exch = async_exchange_begin(client->sess);
+	if ((dx) || (dy))
+		batch_push(INPUT_EVENT_MOVE, dx, dy, 0, 0, false);
 
-			if ((dx) || (dy))
-				async_msg_2(exch, INPUT_EVENT_MOVE, dx, dy);
+	if (dz) {
+		// TODO: Implement proper wheel support
+		keycode_t code = dz > 0 ? KC_UP : KC_DOWN;
 
-			if (dz) {
-				// TODO: Implement proper wheel support
-				keycode_t code = dz > 0 ? KC_UP : KC_DOWN;
+		for (unsigned int i = 0; i < 3; i++)
+			batch_push(INPUT_EVENT_KEY, KEY_PRESS, code, 0, 0, true);
 
-				for (unsigned int i = 0; i < 3; i++)
-					async_msg_4(exch, INPUT_EVENT_KEY, KEY_PRESS, code, 0, 0);
-
-				async_msg_4(exch, INPUT_EVENT_KEY, KEY_RELEASE, code, 0, 0);
-			}
-
-			async_exchange_end(exch);
-		}
+		batch_push(INPUT_EVENT_KEY, KEY_RELEASE, code, 0, 0, true);
 	}
 }
 
@@ -279,27 +384,14 @@ void mouse_push_event_move(mouse_dev_t *mdev, int dx, int dy, int dz)
 void mouse_push_event_abs_move(mouse_dev_t *mdev, unsigned int x, unsigned int y,
     unsigned int max_x, unsigned int max_y)
 {
-	list_foreach(clients, link, client_t, client) {
-		if (client->active) {
-			if ((max_x) && (max_y)) {
-				async_exch_t *exch = async_exchange_begin(client->sess);
-				async_msg_4(exch, INPUT_EVENT_ABS_MOVE, x, y, max_x, max_y);
-				async_exchange_end(exch);
-			}
-		}
-	}
+	if ((max_x) && (max_y))
+		batch_push(INPUT_EVENT_ABS_MOVE, x, y, max_x, max_y, false);
 }
 
 /** Mouse button has been pressed. */
 void mouse_push_event_button(mouse_dev_t *mdev, int bnum, int press)
 {
-	list_foreach(clients, link, client_t, client) {
-		if (client->active) {
-			async_exch_t *exch = async_exchange_begin(client->sess);
-			async_msg_2(exch, INPUT_EVENT_BUTTON, bnum, press);
-			async_exchange_end(exch);
-		}
-	}
+	batch_push(INPUT_EVENT_BUTTON, bnum, press, 0, 0, true);
 }
 
 /** Arbitrate client actiovation */
@@ -861,6 +953,13 @@ int main(int argc, char **argv)
 	/* Add legacy keyboard devices. */
 	kbd_add_legacy_devs();
 
+	fid_t fid = fibril_create(batch_fibril, NULL);
+	if (fid == 0) {
+		printf("%s: Unable to create event delivery fibril\n", NAME);
+		return ENOMEM;
+	}
+	fibril_add_ready(fid);
+
 	/* Register driver */
 	async_set_client_data_constructor(client_data_create);
 	async_set_client_data_destructor(client_data_destroy);
@@ -31,6 +31,7 @@
 #include <stdlib.h>
 #include <macros.h>
 #include <as.h>
+#include <mem.h>
 #include <task.h>
 #include <ipc/output.h>
 #include <config.h>
@@ -262,7 +263,51 @@ static void srv_set_rgb_color(cap_call_handle_t icall_handle, ipc_call_t *icall)
 	async_answer_0(icall_handle, EOK);
 }
 
-static bool srv_update_scroll(outdev_t *dev, chargrid_t *buf)
+/** Take the dirty row bitmap of a front buffer
+ *
+ * The bitmap is copied and cleared in the shared front buffer
+ * before the rows are examined, so rows written by the client
+ * during the update are picked up by the next one.
+ *
+ * @param frontbuf Front buffer.
+ * @param dirty    Buffer of at least MAX_ROWS / 8 bytes for the bitmap.
+ *
+ * @return True if the bitmap was taken, false if it cannot be used
+ *         and all rows need to be examined.
+ *
+ */
+static bool frontbuf_take_dirty(frontbuf_t *frontbuf, uint8_t *dirty)
+{
+	chargrid_t *buf = (chargrid_t *) frontbuf->data;
+	size_t length = (buf->rows + 7) / 8;
+
+	if ((buf->rows > MAX_ROWS) || (buf->dirty_offset > frontbuf->size) ||
+	    (length > frontbuf->size - buf->dirty_offset))
+		return false;
+
+	memcpy(dirty, chargrid_dirty_map(buf), length);
+	memset(chargrid_dirty_map(buf), 0, length);
+	return true;
+}
+
+/** Check whether a row may contain changed cells
+ *
+ * @param buf   Front buffer chargrid.
+ * @param dirty Dirty row bitmap taken by frontbuf_take_dirty() or NULL.
+ * @param row   Screen row.
+ *
+ */
+static bool row_dirty(chargrid_t *buf, uint8_t *dirty, sysarg_t row)
+{
+	if (dirty == NULL)
+		return true;
+
+	sysarg_t brow = (row + buf->top_row) % buf->rows;
+	return (dirty[brow / 8] & (1 << (brow % 8))) != 0;
+}
+
+static bool srv_update_scroll(outdev_t *dev, chargrid_t *buf,
+    uint8_t *dirty)
 {
 	assert(dev->ops.char_update);
 
@@ -271,15 +316,42 @@ static bool srv_update_scroll(outdev_t *dev, chargrid_t *buf)
 	if (dev->top_row == top_row)
 		return false;
 
+	/* Rows from this one down no longer match the back buffer. */
+	sysarg_t stale_row = dev->rows;
+
+	/*
+	 * Let the device move the rows it already shows instead of redrawing
+	 * every cell. This is only possible if the device shows the whole
+	 * cyclic buffer.
+	 */
+	if ((dev->ops.scroll) && (buf->rows == dev->rows) &&
+	    (buf->cols == dev->cols)) {
+		sysarg_t delta = (top_row + buf->rows - dev->top_row) % buf->rows;
+
+		dev->ops.scroll(dev, delta);
+
+		for (sysarg_t y = 0; y < dev->rows - delta; y++) {
+			memcpy(chargrid_charfield_at(dev->backbuf, 0, y),
+			    chargrid_charfield_at(dev->backbuf, 0, y + delta),
+			    dev->cols * sizeof(charfield_t));
+		}
+
+		stale_row = dev->rows - delta;
+	}
+
 	dev->top_row = top_row;
 
 	for (sysarg_t y = 0; y < dev->rows; y++) {
+		/* Rows moved by the device are only redrawn if written to */
+		if ((y < stale_row) && (!row_dirty(buf, dirty, y)))
+			continue;
+
 		for (sysarg_t x = 0; x < dev->cols; x++) {
 			charfield_t *front_field =
 			    chargrid_charfield_at(buf, x, y);
 			charfield_t *back_field =
 			    chargrid_charfield_at(dev->backbuf, x, y);
-			bool update = false;
+			bool update = (y >= stale_row);
 
 			if (front_field->ch != back_field->ch) {
 				back_field->ch = front_field->ch;
@@ -309,13 +381,21 @@ static void srv_update(cap_call_handle_t icall_handle, ipc_call_t *icall)
 
 	chargrid_t *buf = (chargrid_t *) frontbuf->data;
 
+	uint8_t dirty_map[MAX_ROWS / 8];
+	uint8_t *dirty = NULL;
+	if (frontbuf_take_dirty(frontbuf, dirty_map))
+		dirty = dirty_map;
+
 	list_foreach(outdevs, link, outdev_t, dev) {
 		assert(dev->ops.char_update);
 
-		if (srv_update_scroll(dev, buf))
+		if (srv_update_scroll(dev, buf, dirty))
 			continue;
 
 		for (sysarg_t y = 0; y < dev->rows; y++) {
+			if (!row_dirty(buf, dirty, y))
+				continue;
+
 			for (sysarg_t x = 0; x < dev->cols; x++) {
 				charfield_t *front_field =
 				    chargrid_charfield_at(buf, x, y);
@@ -347,7 +427,6 @@ static void srv_update(cap_call_handle_t icall_handle, ipc_call_t *icall)
 		dev->ops.flush(dev);
 	}
 
-
 	async_answer_0(icall_handle, EOK);
 }
 
@@ -362,7 +441,7 @@ static void srv_damage(cap_call_handle_t icall_handle, ipc_call_t *icall)
 	list_foreach(outdevs, link, outdev_t, dev) {
 		assert(dev->ops.char_update);
 
-		if (srv_update_scroll(dev, buf))
+		if (srv_update_scroll(dev, buf, NULL))
 			continue;
 
 		sysarg_t col = IPC_GET_ARG2(*icall);
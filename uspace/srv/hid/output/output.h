@@ -51,6 +51,11 @@ typedef struct {
 	void (*cursor_update)(struct outdev *dev, sysarg_t prev_col,
 	    sysarg_t prev_row, sysarg_t col, sysarg_t row, bool visible);
 	void (*char_update)(struct outdev *dev, sysarg_t col, sysarg_t row);
+	/*
+	 * Optional. Move the whole screen contents up by the given number
+	 * of rows. The vacated bottom rows are redrawn by the caller.
+	 */
+	void (*scroll)(struct outdev *dev, sysarg_t rows);
 	void (*flush)(struct outdev *dev);
 } outdev_ops_t;
 
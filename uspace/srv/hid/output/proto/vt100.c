@@ -90,6 +90,15 @@ static void vt100_set_pos(vt100_state_t *state, sysarg_t col, sysarg_t row)
 	state->control_puts(control);
 }
 
+/** Confine scrolling to our rows even if the terminal is taller. */
+static void vt100_set_margins(vt100_state_t *state)
+{
+	char control[MAX_CONTROL];
+
+	snprintf(control, MAX_CONTROL, "\033[1;%" PRIun "r", state->rows);
+	state->control_puts(control);
+}
+
 static void vt100_set_sgr(vt100_state_t *state, char_attrs_t attrs)
 {
 	switch (attrs.type) {
@@ -162,6 +171,7 @@ vt100_state_t *vt100_state_create(sysarg_t cols, sysarg_t rows,
 	vt100_sgr(state, SGR_RESET);
 	vt100_sgr(state, SGR_FGCOLOR + CI_BLACK);
 	vt100_sgr(state, SGR_BGCOLOR + CI_WHITE);
+	vt100_set_margins(state);
 	state->control_puts("\033[2J");
 	state->control_puts("\033[?25l");
 
@@ -229,6 +239,22 @@ void vt100_putwchar(vt100_state_t *state, wchar_t ch)
 	}
 }
 
+/** Scroll the screen contents up.
+ *
+ * The terminal scrolls on each line feed at the bottom margin. The new
+ * rows are blank in the current rendition and are expected to be redrawn.
+ */
+void vt100_scroll(vt100_state_t *state, sysarg_t rows)
+{
+	if (rows == 0)
+		return;
+
+	vt100_goto(state, 0, state->rows - 1);
+
+	for (sysarg_t i = 0; i < rows; i++)
+		state->control_puts("\n");
+}
+
 void vt100_flush(vt100_state_t *state)
 {
 	state->flush();
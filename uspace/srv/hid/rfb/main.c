@@ -111,6 +111,8 @@ static errno_t rfb_handle_damage_pixels(visualizer_t *vs,
 		}
 	}
 
+	fibril_condvar_broadcast(&rfb.damage_cv);
+
 	pixelmap_t *map = &vs->cells;
 
 	for (sysarg_t y = y0; y < height + y0; ++y) {
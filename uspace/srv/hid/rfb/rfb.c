@@ -52,6 +52,21 @@ static tcp_cb_t conn_cb = {
 	.connected = NULL
 };
 
+/** Size of TRLE tiles, also the granularity of change detection. */
+#define RFB_TILE_SIZE  16
+
+/** Largest palette a TRLE palette RLE tile can use. */
+#define RFB_TILE_PALETTE_MAX  127
+
+/** Smallest number of scrolled rows worth sending as CopyRect. */
+#define RFB_COPY_RECT_MIN_ROWS  16
+
+/** Number of scroll offsets tried when looking for CopyRect. */
+#define RFB_COPY_RECT_CANDIDATES  8
+
+/** Time an incremental update request waits for damage (usec). */
+#define RFB_UPDATE_WAIT  1000000
+
 /** Buffer for receiving the request. */
 #define BUFFER_SIZE  1024
 
@@ -177,6 +192,7 @@ errno_t rfb_init(rfb_t *rfb, uint16_t width, uint16_t height, const char *name)
 {
 	memset(rfb, 0, sizeof(rfb_t));
 	fibril_mutex_initialize(&rfb->lock);
+	fibril_condvar_initialize(&rfb->damage_cv);
 
 	rfb_pixel_format_t *pf = &rfb->pixel_format;
 	pf->bpp = 32;
@@ -192,6 +208,7 @@ errno_t rfb_init(rfb_t *rfb, uint16_t width, uint16_t height, const char *name)
 
 	rfb->name = str_dup(name);
 	rfb->supports_trle = false;
+	rfb->supports_copy_rect = false;
 
 	return rfb_set_size(rfb, width, height);
 }
@@ -203,10 +220,22 @@ errno_t rfb_set_size(rfb_t *rfb, uint16_t width, uint16_t height)
 	if (pixbuf == NULL)
 		return ENOMEM;
 
+	void *sentbuf = malloc(new_size);
+	if (sentbuf == NULL) {
+		free(pixbuf);
+		return ENOMEM;
+	}
+
 	free(rfb->framebuffer.data);
 	rfb->framebuffer.data = pixbuf;
 	rfb->framebuffer.width = width;
 	rfb->framebuffer.height = height;
+
+	free(rfb->sent.data);
+	rfb->sent.data = sentbuf;
+	rfb->sent.width = width;
+	rfb->sent.height = height;
+	rfb->sent_valid = false;
 	rfb->width = width;
 	rfb->height = height;
 
@@ -413,40 +442,211 @@ static void cpixel_encode(rfb_t *rfb, cpixel_ctx_t *cpixel, void *buf,
 	}
 }
 
-static size_t rfb_tile_encode_raw(rfb_t *rfb, cpixel_ctx_t *cpixel,
-    rfb_rectangle_t *tile, void *buf)
+/** Palette of a single TRLE tile. */
+typedef struct {
+	pixel_t colors[RFB_TILE_PALETTE_MAX];
+	size_t count;
+} tile_palette_t;
+
+static int tile_palette_index(tile_palette_t *palette, pixel_t pixel)
 {
-	size_t size = tile->width * tile->height * cpixel->size;
-	if (buf == NULL)
-		return size;
+	for (size_t i = 0; i < palette->count; i++) {
+		if (palette->colors[i] == pixel)
+			return i;
+	}
 
-	for (uint16_t y = tile->y; y < tile->y + tile->height; y++) {
-		for (uint16_t x = tile->x; x < tile->x + tile->width; x++) {
-			pixel_t pixel = pixelmap_get_pixel(&rfb->framebuffer, x, y);
-			cpixel_encode(rfb, cpixel, buf, pixel);
-		}
+	return -1;
+}
+
+static pixel_t tile_pixel(rfb_t *rfb, rfb_rectangle_t *tile, size_t i)
+{
+	return pixelmap_get_pixel(&rfb->framebuffer, tile->x + i % tile->width,
+	    tile->y + i / tile->width);
+}
+
+/** Number of bytes needed to encode a TRLE run length. */
+static size_t trle_run_length_size(size_t length)
+{
+	return (length - 1) / 255 + 1;
+}
+
+static uint8_t *trle_run_length_encode(uint8_t *buf, size_t length)
+{
+	length--;
+	while (length >= 255) {
+		*buf++ = 255;
+		length -= 255;
 	}
 
-	return size;
+	*buf++ = length;
+	return buf;
 }
 
-static errno_t rfb_tile_encode_solid(rfb_t *rfb, cpixel_ctx_t *cpixel,
-    rfb_rectangle_t *tile, void *buf, size_t *size)
+/** Encode a single TRLE tile using its smallest subencoding.
+ *
+ * The tile is analyzed first to get the sizes of the raw, solid, packed
+ * palette, plain RLE and palette RLE subencodings. The winner is then
+ * written into @a buf, which must hold at least the raw size plus one.
+ *
+ * @return Number of bytes written.
+ */
+static size_t rfb_tile_encode(rfb_t *rfb, cpixel_ctx_t *cpixel,
+    rfb_rectangle_t *tile, uint8_t *buf)
 {
-	/* Check if it is single color */
-	pixel_t the_color = pixelmap_get_pixel(&rfb->framebuffer, tile->x, tile->y);
-	for (uint16_t y = tile->y; y < tile->y + tile->height; y++) {
-		for (uint16_t x = tile->x; x < tile->x + tile->width; x++) {
-			if (pixelmap_get_pixel(&rfb->framebuffer, x, y) != the_color)
-				return EINVAL;
+	size_t count = tile->width * tile->height;
+
+	tile_palette_t palette;
+	palette.count = 0;
+	bool use_palette = true;
+
+	size_t rle_size = 0;
+	size_t palette_rle_size = 0;
+	pixel_t run_pixel = 0;
+	size_t run = 0;
+
+	for (size_t i = 0; i <= count; i++) {
+		pixel_t pixel = 0;
+		if (i < count) {
+			pixel = tile_pixel(rfb, tile, i);
+
+			if ((use_palette) &&
+			    (tile_palette_index(&palette, pixel) < 0)) {
+				if (palette.count < RFB_TILE_PALETTE_MAX)
+					palette.colors[palette.count++] = pixel;
+				else
+					use_palette = false;
+			}
+
+			if ((run > 0) && (pixel == run_pixel)) {
+				run++;
+				continue;
+			}
 		}
+
+		if (run > 0) {
+			rle_size += cpixel->size + trle_run_length_size(run);
+			palette_rle_size += (run == 1) ?
+			    1 : 1 + trle_run_length_size(run);
+		}
+
+		run_pixel = pixel;
+		run = 1;
 	}
 
-	/* OK, encode it */
-	if (buf)
-		cpixel_encode(rfb, cpixel, buf, the_color);
-	*size = cpixel->size;
-	return EOK;
+	uint8_t enctype = RFB_TILE_ENCODING_RAW;
+	size_t size = count * cpixel->size;
+	unsigned int bits = 0;
+
+	if ((use_palette) && (palette.count == 1)) {
+		enctype = RFB_TILE_ENCODING_SOLID;
+		size = cpixel->size;
+	} else {
+		if ((use_palette) && (palette.count <= 16)) {
+			bits = (palette.count <= 2) ? 1 :
+			    ((palette.count <= 4) ? 2 : 4);
+			size_t packed_size = palette.count * cpixel->size +
+			    tile->height * ((tile->width * bits + 7) / 8);
+			if (packed_size < size) {
+				enctype = palette.count;
+				size = packed_size;
+			}
+		}
+
+		if (rle_size < size) {
+			enctype = RFB_TILE_ENCODING_RLE;
+			size = rle_size;
+		}
+
+		if (use_palette) {
+			palette_rle_size += palette.count * cpixel->size;
+			if (palette_rle_size < size) {
+				enctype = RFB_TILE_ENCODING_RLE + palette.count;
+				size = palette_rle_size;
+			}
+		}
+	}
+
+	uint8_t *pos = buf;
+	*pos++ = enctype;
+
+	if (enctype == RFB_TILE_ENCODING_RAW) {
+		for (size_t i = 0; i < count; i++) {
+			cpixel_encode(rfb, cpixel, pos, tile_pixel(rfb, tile, i));
+			pos += cpixel->size;
+		}
+
+		return pos - buf;
+	}
+
+	if (enctype == RFB_TILE_ENCODING_SOLID) {
+		cpixel_encode(rfb, cpixel, pos, palette.colors[0]);
+		return 1 + cpixel->size;
+	}
+
+	if (enctype != RFB_TILE_ENCODING_RLE) {
+		for (size_t i = 0; i < palette.count; i++) {
+			cpixel_encode(rfb, cpixel, pos, palette.colors[i]);
+			pos += cpixel->size;
+		}
+	}
+
+	if (enctype <= 16) {
+		/* Packed palette, every row starts on a byte boundary. */
+		for (uint16_t y = 0; y < tile->height; y++) {
+			uint8_t byte = 0;
+			unsigned int used = 0;
+
+			for (uint16_t x = 0; x < tile->width; x++) {
+				pixel_t pixel = pixelmap_get_pixel(&rfb->framebuffer,
+				    tile->x + x, tile->y + y);
+				byte = (byte << bits) |
+				    tile_palette_index(&palette, pixel);
+				used += bits;
+
+				if (used == 8) {
+					*pos++ = byte;
+					byte = 0;
+					used = 0;
+				}
+			}
+
+			if (used > 0)
+				*pos++ = byte << (8 - used);
+		}
+
+		return pos - buf;
+	}
+
+	/* Plain or palette RLE, runs may continue on the next row. */
+	run = 0;
+	for (size_t i = 0; i <= count; i++) {
+		pixel_t pixel = 0;
+		if (i < count) {
+			pixel = tile_pixel(rfb, tile, i);
+			if ((run > 0) && (pixel == run_pixel)) {
+				run++;
+				continue;
+			}
+		}
+
+		if (run > 0) {
+			if (enctype == RFB_TILE_ENCODING_RLE) {
+				cpixel_encode(rfb, cpixel, pos, run_pixel);
+				pos += cpixel->size;
+				pos = trle_run_length_encode(pos, run);
+			} else if (run == 1) {
+				*pos++ = tile_palette_index(&palette, run_pixel);
+			} else {
+				*pos++ = 128 | tile_palette_index(&palette, run_pixel);
+				pos = trle_run_length_encode(pos, run);
+			}
+		}
+
+		run_pixel = pixel;
+		run = 1;
+	}
+
+	return pos - buf;
 }
 
 static size_t rfb_rect_encode_trle(rfb_t *rfb, rfb_rectangle_t *rect, void *buf)
@@ -455,84 +655,309 @@ static size_t rfb_rect_encode_trle(rfb_t *rfb, rfb_rectangle_t *rect, void *buf)
 	cpixel_context_init(&cpixel, &rfb->pixel_format);
 
 	size_t size = 0;
-	for (uint16_t y = 0; y < rect->height; y += 16) {
-		for (uint16_t x = 0; x < rect->width; x += 16) {
+	for (uint16_t y = 0; y < rect->height; y += RFB_TILE_SIZE) {
+		for (uint16_t x = 0; x < rect->width; x += RFB_TILE_SIZE) {
 			rfb_rectangle_t tile = {
-				.x = x,
-				.y = y,
-				.width = (x + 16 <= rect->width ? 16 : rect->width - x),
-				.height = (y + 16 <= rect->height ? 16 : rect->height - y)
+				.x = rect->x + x,
+				.y = rect->y + y,
+				.width = min(RFB_TILE_SIZE, rect->width - x),
+				.height = min(RFB_TILE_SIZE, rect->height - y)
 			};
 
-			size += 1;
-			uint8_t *tile_enctype_ptr = buf;
-			if (buf)
-				buf +=  1;
+			size += rfb_tile_encode(rfb, &cpixel, &tile,
+			    (uint8_t *) buf + size);
+		}
+	}
 
-			uint8_t tile_enctype = RFB_TILE_ENCODING_SOLID;
-			size_t tile_size;
-			errno_t rc = rfb_tile_encode_solid(rfb, &cpixel, &tile, buf,
-			    &tile_size);
-			if (rc != EOK) {
-				tile_size = rfb_tile_encode_raw(rfb, &cpixel, &tile, buf);
-				tile_enctype = RFB_TILE_ENCODING_RAW;
-			}
+	return size;
+}
+
+/** Check whether the client already shows the tile. */
+static bool rfb_tile_changed(rfb_t *rfb, rfb_rectangle_t *tile)
+{
+	for (uint16_t y = tile->y; y < tile->y + tile->height; y++) {
+		if (memcmp(pixelmap_pixel_at(&rfb->framebuffer, tile->x, y),
+		    pixelmap_pixel_at(&rfb->sent, tile->x, y),
+		    tile->width * sizeof(pixel_t)) != 0)
+			return true;
+	}
+
+	return false;
+}
+
+static void rfb_mark_sent(rfb_t *rfb, rfb_rectangle_t *rect)
+{
+	for (uint16_t y = rect->y; y < rect->y + rect->height; y++) {
+		memcpy(pixelmap_pixel_at(&rfb->sent, rect->x, y),
+		    pixelmap_pixel_at(&rfb->framebuffer, rect->x, y),
+		    rect->width * sizeof(pixel_t));
+	}
+}
+
+static uint32_t rfb_row_hash(pixelmap_t *map, uint16_t x, uint16_t y,
+    uint16_t width)
+{
+	/* FNV-1a */
+	uint32_t hash = 2166136261U;
+	pixel_t *pixel = pixelmap_pixel_at(map, x, y);
+
+	for (uint16_t i = 0; i < width; i++) {
+		hash ^= pixel[i];
+		hash *= 16777619U;
+	}
+
+	return hash;
+}
 
-			if (buf) {
-				*tile_enctype_ptr = tile_enctype;
-				buf += tile_size;
+static bool rfb_rows_equal(rfb_t *rfb, rfb_rectangle_t *rect, uint16_t y,
+    uint16_t sent_y)
+{
+	return memcmp(pixelmap_pixel_at(&rfb->framebuffer, rect->x, y),
+	    pixelmap_pixel_at(&rfb->sent, rect->x, sent_y),
+	    rect->width * sizeof(pixel_t)) == 0;
+}
+
+/** Look for a vertical scroll within the damaged rectangle.
+ *
+ * Rows of the current framebuffer are matched by hash against the rows
+ * the client already shows. The longest run of rows that moved by the
+ * same offset is reported if it is tall enough to be worth a CopyRect.
+ *
+ * @param rfb   RFB server.
+ * @param rect  Damaged rectangle.
+ * @param dst   Destination rectangle of the copy.
+ * @param src_y Source row of the copy.
+ *
+ * @return True if a scroll was found.
+ */
+static bool rfb_find_scroll(rfb_t *rfb, rfb_rectangle_t *rect,
+    rfb_rectangle_t *dst, uint16_t *src_y)
+{
+	if (rect->height < RFB_COPY_RECT_MIN_ROWS)
+		return false;
+
+	uint32_t *hashes = malloc(2 * rect->height * sizeof(uint32_t));
+	if (hashes == NULL)
+		return false;
+
+	uint32_t *cur = hashes;
+	uint32_t *prev = hashes + rect->height;
+
+	for (uint16_t i = 0; i < rect->height; i++) {
+		cur[i] = rfb_row_hash(&rfb->framebuffer, rect->x, rect->y + i,
+		    rect->width);
+		prev[i] = rfb_row_hash(&rfb->sent, rect->x, rect->y + i,
+		    rect->width);
+	}
+
+	/* The first changed row is the start of the moved block. */
+	uint16_t first = 0;
+	while ((first < rect->height) && (cur[first] == prev[first]))
+		first++;
+
+	if (rect->height - first < RFB_COPY_RECT_MIN_ROWS) {
+		free(hashes);
+		return false;
+	}
+
+	int best_offset = 0;
+	uint16_t best_rows = 0;
+	unsigned int candidates = 0;
+
+	/* Try the nearest matching rows first. */
+	for (int dist = 1; (dist < rect->height) &&
+	    (candidates < RFB_COPY_RECT_CANDIDATES); dist++) {
+		for (int sign = -1; sign <= 1; sign += 2) {
+			int offset = sign * dist;
+			int from = first + offset;
+			if ((from < 0) || (from >= rect->height))
+				continue;
+
+			if (prev[from] != cur[first])
+				continue;
+
+			candidates++;
+
+			uint16_t rows = 0;
+			while ((first + rows < rect->height) &&
+			    (from + rows < rect->height) &&
+			    (cur[first + rows] == prev[from + rows]) &&
+			    (rfb_rows_equal(rfb, rect, rect->y + first + rows,
+			    rect->y + from + rows)))
+				rows++;
+
+			if (rows > best_rows) {
+				best_rows = rows;
+				best_offset = offset;
 			}
 		}
 	}
-	return size;
+
+	free(hashes);
+
+	if (best_rows < RFB_COPY_RECT_MIN_ROWS)
+		return false;
+
+	dst->x = rect->x;
+	dst->y = rect->y + first;
+	dst->width = rect->width;
+	dst->height = best_rows;
+	*src_y = dst->y + best_offset;
+	return true;
+}
+
+/** Apply a CopyRect to the copy of what the client shows. */
+static void rfb_copy_sent(rfb_t *rfb, rfb_rectangle_t *dst, uint16_t src_y)
+{
+	size_t row_size = dst->width * sizeof(pixel_t);
+
+	if (src_y > dst->y) {
+		for (uint16_t i = 0; i < dst->height; i++) {
+			memcpy(pixelmap_pixel_at(&rfb->sent, dst->x, dst->y + i),
+			    pixelmap_pixel_at(&rfb->sent, dst->x, src_y + i),
+			    row_size);
+		}
+	} else {
+		for (uint16_t i = dst->height; i > 0; i--) {
+			memcpy(pixelmap_pixel_at(&rfb->sent, dst->x, dst->y + i - 1),
+			    pixelmap_pixel_at(&rfb->sent, dst->x, src_y + i - 1),
+			    row_size);
+		}
+	}
 }
 
 static errno_t rfb_send_framebuffer_update(rfb_t *rfb, tcp_conn_t *conn,
     bool incremental)
 {
 	fibril_mutex_lock(&rfb->lock);
-	if (!incremental || !rfb->damage_valid) {
-		rfb->damage_rect.x = 0;
-		rfb->damage_rect.y = 0;
-		rfb->damage_rect.width = rfb->width;
-		rfb->damage_rect.height = rfb->height;
+
+	/*
+	 * Do not answer incremental requests right away if nothing changed,
+	 * the client would only ask again.
+	 */
+	if ((incremental) && (rfb->sent_valid) && (!rfb->damage_valid)) {
+		fibril_condvar_wait_timeout(&rfb->damage_cv, &rfb->lock,
+		    RFB_UPDATE_WAIT);
 	}
 
+	bool full = !incremental || !rfb->sent_valid;
+	rfb_rectangle_t region;
+
+	if (full) {
+		region.x = 0;
+		region.y = 0;
+		region.width = rfb->width;
+		region.height = rfb->height;
+	} else if (rfb->damage_valid) {
+		region = rfb->damage_rect;
+	} else {
+		region.x = 0;
+		region.y = 0;
+		region.width = 0;
+		region.height = 0;
+	}
 
-	/* We send only single raw rectangle right now */
+	size_t tiles = ((region.width + RFB_TILE_SIZE - 1) / RFB_TILE_SIZE) *
+	    ((region.height + RFB_TILE_SIZE - 1) / RFB_TILE_SIZE);
+
+	/* Every tile may end up in its own rectangle and be sent raw. */
 	size_t buf_size = sizeof(rfb_framebuffer_update_t) +
-	    sizeof(rfb_rectangle_t) * 1 +
-	    rfb_rect_encode_raw(rfb, &rfb->damage_rect, NULL);
+	    (tiles + 1) * (sizeof(rfb_rectangle_t) + 2 * sizeof(uint16_t)) +
+	    tiles + region.width * region.height * sizeof(uint32_t);
 
 	void *buf = malloc(buf_size);
 	if (buf == NULL) {
 		fibril_mutex_unlock(&rfb->lock);
 		return ENOMEM;
 	}
-	memset(buf, 0, buf_size);
 
 	void *pos = buf;
 	rfb_framebuffer_update_t *fbu = buf;
 	fbu->message_type = RFB_SMSG_FRAMEBUFFER_UPDATE;
-	fbu->rect_count = 1;
-	rfb_framebuffer_update_to_be(fbu, fbu);
+	fbu->pad = 0;
+	fbu->rect_count = 0;
 	pos += sizeof(rfb_framebuffer_update_t);
 
-	rfb_rectangle_t *rect = pos;
-	pos += sizeof(rfb_rectangle_t);
+	rfb_rectangle_t copy;
+	uint16_t src_y;
+	if ((!full) && (rfb->supports_copy_rect) &&
+	    (rfb_find_scroll(rfb, &region, &copy, &src_y))) {
+		rfb_rectangle_t *rect = pos;
+		pos += sizeof(rfb_rectangle_t);
+
+		*rect = copy;
+		rect->enctype = RFB_ENCODING_COPY_RECT;
+		rfb_rectangle_to_be(rect, rect);
+
+		uint16_t src[2];
+		src[0] = host2uint16_t_be(copy.x);
+		src[1] = host2uint16_t_be(src_y);
+		memcpy(pos, src, sizeof(src));
+		pos += sizeof(src);
+
+		rfb_copy_sent(rfb, &copy, src_y);
+		fbu->rect_count++;
+	}
+
+	/*
+	 * Send changed tiles, merging neighbours in each tile row into
+	 * a single rectangle.
+	 */
+	for (uint16_t y = 0; y < region.height; y += RFB_TILE_SIZE) {
+		uint16_t height = min(RFB_TILE_SIZE, region.height - y);
+		uint16_t x = 0;
+
+		while (x < region.width) {
+			rfb_rectangle_t run = {
+				.x = region.x + x,
+				.y = region.y + y,
+				.width = 0,
+				.height = height
+			};
 
-	*rect = rfb->damage_rect;
+			while (x < region.width) {
+				rfb_rectangle_t tile = {
+					.x = region.x + x,
+					.y = region.y + y,
+					.width = min(RFB_TILE_SIZE, region.width - x),
+					.height = height
+				};
 
-	if (rfb->supports_trle) {
-		rect->enctype = RFB_ENCODING_TRLE;
-		pos += rfb_rect_encode_trle(rfb, rect, pos);
-	} else {
-		rect->enctype = RFB_ENCODING_RAW;
-		pos += rfb_rect_encode_raw(rfb, rect, pos);
+				if ((!full) && (!rfb_tile_changed(rfb, &tile)))
+					break;
+
+				run.width += tile.width;
+				x += tile.width;
+			}
+
+			if (run.width == 0) {
+				x += min(RFB_TILE_SIZE, region.width - x);
+				continue;
+			}
+
+			rfb_rectangle_t *rect = pos;
+			pos += sizeof(rfb_rectangle_t);
+
+			*rect = run;
+			if (rfb->supports_trle) {
+				rect->enctype = RFB_ENCODING_TRLE;
+				pos += rfb_rect_encode_trle(rfb, &run, pos);
+			} else {
+				rect->enctype = RFB_ENCODING_RAW;
+				pos += rfb_rect_encode_raw(rfb, &run, pos);
+			}
+			rfb_rectangle_to_be(rect, rect);
+
+			rfb_mark_sent(rfb, &run);
+			fbu->rect_count++;
+		}
 	}
-	rfb_rectangle_to_be(rect, rect);
+
+	rfb_framebuffer_update_to_be(fbu, fbu);
+	buf_size = pos - buf;
 
 	rfb->damage_valid = false;
+	rfb->sent_valid = true;
 
 	size_t send_palette_size = 0;
 	void *send_palette = NULL;
@@ -550,6 +975,7 @@ static errno_t rfb_send_framebuffer_update(rfb_t *rfb, tcp_conn_t *conn,
 
 	if (!rfb->pixel_format.true_color) {
 		errno_t rc = tcp_conn_send(conn, send_palette, send_palette_size);
+		free(send_palette);
 		if (rc != EOK) {
 			free(buf);
 			return rc;
@@ -721,6 +1147,8 @@ static void rfb_socket_connection(rfb_t *rfb, tcp_conn_t *conn)
 			}
 			rfb_set_encodings_to_host(&se, &se);
 			log_msg(LOG_DEFAULT, LVL_DEBUG2, "Received SetEncodings message");
+			rfb->supports_trle = false;
+			rfb->supports_copy_rect = false;
 			for (uint16_t i = 0; i < se.count; i++) {
 				int32_t encoding = 0;
 				rc = recv_chars(conn, (char *) &encoding, sizeof(int32_t));
@@ -731,6 +1159,10 @@ static void rfb_socket_connection(rfb_t *rfb, tcp_conn_t *conn)
 					log_msg(LOG_DEFAULT, LVL_DEBUG,
 					    "Client supports TRLE encoding");
 					rfb->supports_trle = true;
+				} else if (encoding == RFB_ENCODING_COPY_RECT) {
+					log_msg(LOG_DEFAULT, LVL_DEBUG,
+					    "Client supports CopyRect encoding");
+					rfb->supports_copy_rect = true;
 				}
 			}
 			break;
@@ -830,5 +1262,10 @@ static void rfb_new_conn(tcp_listener_t *lst, tcp_conn_t *conn)
 	rbuf_out = 0;
 	rbuf_in = 0;
 
+	/* The new client has not seen anything yet. */
+	fibril_mutex_lock(&rfb->lock);
+	rfb->sent_valid = false;
+	fibril_mutex_unlock(&rfb->lock);
+
 	rfb_socket_connection(rfb, conn);
 }
@@ -49,10 +49,12 @@
 #define RFB_SMSG_SERVER_CUT_TEXT 3
 
 #define RFB_ENCODING_RAW 0
+#define RFB_ENCODING_COPY_RECT 1
 #define RFB_ENCODING_TRLE 15
 
 #define RFB_TILE_ENCODING_RAW 0
 #define RFB_TILE_ENCODING_SOLID 1
+#define RFB_TILE_ENCODING_RLE 128
 
 typedef struct {
 	uint8_t bpp;
@@ -154,12 +156,17 @@ typedef struct {
 	tcp_t *tcp;
 	tcp_listener_t *lst;
 	pixelmap_t framebuffer;
+	/** What the client shows, valid only if sent_valid is set */
+	pixelmap_t sent;
+	bool sent_valid;
 	rfb_rectangle_t damage_rect;
 	bool damage_valid;
 	fibril_mutex_t lock;
+	fibril_condvar_t damage_cv;
 	pixel_t *palette;
 	size_t palette_used;
 	bool supports_trle;
+	bool supports_copy_rect;
 } rfb_t;
 
 
@@ -55,6 +55,7 @@
 #include <errno.h>
 #include <async.h>
 #include <str.h>
+#include <macros.h>
 #include <as.h>
 #include <elf/elf.h>
 #include <elf/elf_load.h>
@@ -274,19 +275,16 @@ static void ldr_add_inbox(cap_call_handle_t req_handle, ipc_call_t *request)
 	async_answer_0(req_handle, EOK);
 }
 
-/** Load the previously selected program.
+/** Load the previously selected program and fill in the PCB.
  *
- * @param req_handle
- * @param request
- * @return 0 on success, !0 on error.
+ * @return EOK on success or an error code.
  */
-static int ldr_load(cap_call_handle_t req_handle, ipc_call_t *request)
+static errno_t ldr_load_program(void)
 {
 	int rc = elf_load(program_fd, &prog_info);
 	if (rc != EE_OK) {
 		DPRINTF("Failed to load executable for '%s'.\n", progname);
-		async_answer_0(req_handle, EINVAL);
-		return 1;
+		return EINVAL;
 	}
 
 	elf_set_pcb(&prog_info, &pcb);
@@ -299,8 +297,170 @@ static int ldr_load(cap_call_handle_t req_handle, ipc_call_t *request)
 	pcb.inbox = inbox;
 	pcb.inbox_entries = inbox_entries;
 
-	async_answer_0(req_handle, EOK);
-	return 0;
+	return EOK;
+}
+
+/** Load the previously selected program.
+ *
+ * @param req_handle
+ * @param request
+ * @return 0 on success, !0 on error.
+ */
+static int ldr_load(cap_call_handle_t req_handle, ipc_call_t *request)
+{
+	errno_t rc = ldr_load_program();
+	async_answer_0(req_handle, rc);
+	return (rc == EOK) ? 0 : 1;
+}
+
+/** Return the next string in a serialized buffer.
+ *
+ * @param cur Pointer to the current position, advanced past the string.
+ * @param end End of the buffer.
+ * @return The string or NULL if the buffer is exhausted.
+ */
+static char *ldr_next_str(char **cur, char *end)
+{
+	char *str = *cur;
+	if (str >= end)
+		return NULL;
+
+	*cur += str_size(str) + 1;
+	return str;
+}
+
+/** Receive all parameters of the program and load it.
+ *
+ * The request carries the number of arguments and inbox entries. It is
+ * followed by a buffer of null-terminated strings with the working
+ * directory, the program name, the arguments and the names of the inbox
+ * entries, and then by the handles of the program file and of the inbox
+ * files. On success the ID of the task is returned in the answer.
+ *
+ * @param req_handle
+ * @param request
+ */
+static void ldr_prepare(cap_call_handle_t req_handle, ipc_call_t *request)
+{
+	size_t count = IPC_GET_ARG1(*request);
+	size_t entries = IPC_GET_ARG2(*request);
+	char *buf;
+	size_t buf_size;
+
+	if (entries > INBOX_MAX_ENTRIES - inbox_entries) {
+		async_answer_0(req_handle, ERANGE);
+		return;
+	}
+
+	errno_t rc = async_data_write_accept((void **) &buf, true, 0, 0, 0,
+	    &buf_size);
+	if (rc != EOK) {
+		async_answer_0(req_handle, rc);
+		return;
+	}
+
+	char *cur = buf;
+	char *end = buf + buf_size;
+
+	char *_cwd = ldr_next_str(&cur, end);
+	char *name = ldr_next_str(&cur, end);
+
+	char **_argv = NULL;
+	if (count < buf_size)
+		_argv = (char **) malloc((count + 1) * sizeof(char *));
+
+	if (_cwd == NULL || name == NULL || _argv == NULL) {
+		free(_argv);
+		free(buf);
+		async_answer_0(req_handle, (_argv == NULL) ? ENOMEM : EINVAL);
+		return;
+	}
+
+	size_t i;
+	for (i = 0; i < count; i++) {
+		_argv[i] = ldr_next_str(&cur, end);
+		if (_argv[i] == NULL)
+			break;
+	}
+	_argv[count] = NULL;
+
+	char *names[INBOX_MAX_ENTRIES];
+	size_t j;
+	for (j = 0; i == count && j < entries; j++) {
+		names[j] = ldr_next_str(&cur, end);
+		if (names[j] == NULL)
+			break;
+	}
+
+	_cwd = str_dup(_cwd);
+	name = str_dup(name);
+
+	if (i != count || j != entries || _cwd == NULL || name == NULL) {
+		free(_cwd);
+		free(name);
+		free(_argv);
+		free(buf);
+		async_answer_0(req_handle, EINVAL);
+		return;
+	}
+
+	int file;
+	j = 0;
+	rc = vfs_receive_handle(true, &file);
+	if (rc != EOK)
+		goto error;
+
+	for (j = 0; j < entries; j++) {
+		int ifile;
+		rc = vfs_receive_handle(true, &ifile);
+		if (rc != EOK) {
+			vfs_put(file);
+			goto error;
+		}
+
+		/* The dynamic linker needs the root early. */
+		if (str_cmp(names[j], "root") == 0)
+			vfs_root_set(ifile);
+
+		inbox[inbox_entries].name = names[j];
+		inbox[inbox_entries].file = ifile;
+		inbox_entries++;
+	}
+
+	if (cwd != NULL)
+		free(cwd);
+	cwd = _cwd;
+
+	progname = name;
+	program_fd = file;
+
+	if (arg_buf != NULL)
+		free(arg_buf);
+	if (argv != NULL)
+		free(argv);
+
+	argc = count;
+	arg_buf = buf;
+	argv = _argv;
+
+	rc = ldr_load_program();
+	if (rc != EOK) {
+		async_answer_0(req_handle, rc);
+		return;
+	}
+
+	task_id_t task_id = task_get_id();
+	async_answer_2(req_handle, EOK, LOWER32(task_id), UPPER32(task_id));
+	return;
+
+error:
+	/* Inbox entries received so far keep pointing into the buffer. */
+	if (j == 0)
+		free(buf);
+	free(_cwd);
+	free(name);
+	free(_argv);
+	async_answer_0(req_handle, EINVAL);
 }
 
 /** Run the previously loaded program.
@@ -375,6 +535,9 @@ static void ldr_connection(cap_call_handle_t icall_handle, ipc_call_t *icall,
 		case LOADER_LOAD:
 			ldr_load(chandle, &call);
 			continue;
+		case LOADER_PREPARE:
+			ldr_prepare(chandle, &call);
+			continue;
 		case LOADER_RUN:
 			ldr_run(chandle, &call);
 			/* Not reached */
@@ -36,6 +36,8 @@
 /** @file
  */
 
+#include <adt/hash.h>
+#include <adt/hash_table.h>
 #include <ipc/services.h>
 #include <ns.h>
 #include <async.h>
@@ -56,16 +58,34 @@
 #define NAME          "loc"
 #define NULL_SERVICES  256
 
+/** Delay for coalescing category change notifications */
+#define CAT_CHANGE_DELAY_USEC  (20 * 1000)
+
 /** Callback session */
 typedef struct {
 	link_t cb_sess_list;
 	async_sess_t *sess;
 } cb_sess_t;
 
+/** Service name key */
+typedef struct {
+	const char *ns_name;
+	const char *name;
+} loc_service_key_t;
+
 LIST_INITIALIZE(services_list);
 LIST_INITIALIZE(namespaces_list);
 LIST_INITIALIZE(servers_list);
 
+/*
+ * Indices of services_list and namespaces_list, protected by
+ * services_list_mutex.
+ */
+static hash_table_t services_by_id;
+static hash_table_t services_by_name;
+static hash_table_t namespaces_by_id;
+static hash_table_t namespaces_by_name;
+
 /*
  * Locking order:
  *  servers_list_mutex
@@ -95,6 +115,130 @@ static categ_dir_t cdir;
 static FIBRIL_MUTEX_INITIALIZE(callback_sess_mutex);
 static LIST_INITIALIZE(callback_sess_list);
 
+/** Timer for coalescing category change notifications */
+static fibril_timer_t *cat_change_timer;
+/** Category change notification is scheduled */
+static bool cat_change_pending;
+
+static size_t loc_str_hash(size_t hash, const char *str)
+{
+	while (*str != '\0')
+		hash = hash_combine(hash, (uint8_t) *str++);
+
+	return hash;
+}
+
+static size_t loc_id_key_hash(void *key)
+{
+	return *(service_id_t *) key;
+}
+
+static size_t loc_service_id_hash(const ht_link_t *item)
+{
+	loc_service_t *svc = hash_table_get_inst(item, loc_service_t, id_link);
+	return svc->id;
+}
+
+static bool loc_service_id_key_equal(void *key, const ht_link_t *item)
+{
+	loc_service_t *svc = hash_table_get_inst(item, loc_service_t, id_link);
+	return svc->id == *(service_id_t *) key;
+}
+
+static hash_table_ops_t services_by_id_ops = {
+	.hash = loc_service_id_hash,
+	.key_hash = loc_id_key_hash,
+	.key_equal = loc_service_id_key_equal,
+	.equal = NULL,
+	.remove_callback = NULL
+};
+
+static size_t loc_service_name_key_hash(void *key)
+{
+	loc_service_key_t *skey = (loc_service_key_t *) key;
+	return loc_str_hash(hash_combine(loc_str_hash(0, skey->ns_name), '/'),
+	    skey->name);
+}
+
+static size_t loc_service_name_hash(const ht_link_t *item)
+{
+	loc_service_t *svc = hash_table_get_inst(item, loc_service_t,
+	    name_link);
+	loc_service_key_t skey = {
+		.ns_name = svc->namespace->name,
+		.name = svc->name
+	};
+
+	return loc_service_name_key_hash(&skey);
+}
+
+static bool loc_service_name_key_equal(void *key, const ht_link_t *item)
+{
+	loc_service_key_t *skey = (loc_service_key_t *) key;
+	loc_service_t *svc = hash_table_get_inst(item, loc_service_t,
+	    name_link);
+
+	return str_cmp(svc->namespace->name, skey->ns_name) == 0 &&
+	    str_cmp(svc->name, skey->name) == 0;
+}
+
+static hash_table_ops_t services_by_name_ops = {
+	.hash = loc_service_name_hash,
+	.key_hash = loc_service_name_key_hash,
+	.key_equal = loc_service_name_key_equal,
+	.equal = NULL,
+	.remove_callback = NULL
+};
+
+static size_t loc_namespace_id_hash(const ht_link_t *item)
+{
+	loc_namespace_t *ns = hash_table_get_inst(item, loc_namespace_t,
+	    id_link);
+	return ns->id;
+}
+
+static bool loc_namespace_id_key_equal(void *key, const ht_link_t *item)
+{
+	loc_namespace_t *ns = hash_table_get_inst(item, loc_namespace_t,
+	    id_link);
+	return ns->id == *(service_id_t *) key;
+}
+
+static hash_table_ops_t namespaces_by_id_ops = {
+	.hash = loc_namespace_id_hash,
+	.key_hash = loc_id_key_hash,
+	.key_equal = loc_namespace_id_key_equal,
+	.equal = NULL,
+	.remove_callback = NULL
+};
+
+static size_t loc_namespace_name_key_hash(void *key)
+{
+	return loc_str_hash(0, (const char *) key);
+}
+
+static size_t loc_namespace_name_hash(const ht_link_t *item)
+{
+	loc_namespace_t *ns = hash_table_get_inst(item, loc_namespace_t,
+	    name_link);
+	return loc_str_hash(0, ns->name);
+}
+
+static bool loc_namespace_name_key_equal(void *key, const ht_link_t *item)
+{
+	loc_namespace_t *ns = hash_table_get_inst(item, loc_namespace_t,
+	    name_link);
+	return str_cmp(ns->name, (const char *) key) == 0;
+}
+
+static hash_table_ops_t namespaces_by_name_ops = {
+	.hash = loc_namespace_name_hash,
+	.key_hash = loc_namespace_name_key_hash,
+	.key_equal = loc_namespace_name_key_equal,
+	.equal = NULL,
+	.remove_callback = NULL
+};
+
 service_id_t loc_create_id(void)
 {
 	/*
@@ -184,63 +328,72 @@ static bool loc_fqsn_split(const char *fqsn, char **ns_name, char **name)
 /** Find namespace with given name. */
 static loc_namespace_t *loc_namespace_find_name(const char *name)
 {
+	ht_link_t *link;
+
 	assert(fibril_mutex_is_locked(&services_list_mutex));
 
-	list_foreach(namespaces_list, namespaces, loc_namespace_t, namespace) {
-		if (str_cmp(namespace->name, name) == 0)
-			return namespace;
-	}
+	link = hash_table_find(&namespaces_by_name, (void *) name);
+	if (link == NULL)
+		return NULL;
 
-	return NULL;
+	return hash_table_get_inst(link, loc_namespace_t, name_link);
 }
 
-/** Find namespace with given ID.
- *
- * @todo: use hash table
- *
- */
+/** Find namespace with given ID. */
 static loc_namespace_t *loc_namespace_find_id(service_id_t id)
 {
+	ht_link_t *link;
+
 	assert(fibril_mutex_is_locked(&services_list_mutex));
 
-	list_foreach(namespaces_list, namespaces, loc_namespace_t, namespace) {
-		if (namespace->id == id)
-			return namespace;
-	}
+	link = hash_table_find(&namespaces_by_id, &id);
+	if (link == NULL)
+		return NULL;
 
-	return NULL;
+	return hash_table_get_inst(link, loc_namespace_t, id_link);
 }
 
 /** Find service with given name. */
 static loc_service_t *loc_service_find_name(const char *ns_name,
     const char *name)
 {
+	loc_service_key_t skey;
+	ht_link_t *link;
+
 	assert(fibril_mutex_is_locked(&services_list_mutex));
 
-	list_foreach(services_list, services, loc_service_t, service) {
-		if ((str_cmp(service->namespace->name, ns_name) == 0) &&
-		    (str_cmp(service->name, name) == 0))
-			return service;
-	}
+	skey.ns_name = ns_name;
+	skey.name = name;
+
+	link = hash_table_find(&services_by_name, &skey);
+	if (link == NULL)
+		return NULL;
 
-	return NULL;
+	return hash_table_get_inst(link, loc_service_t, name_link);
 }
 
-/** Find service with given ID.
- *
- * @todo: use hash table
- *
- */
+/** Find service with given ID. */
 static loc_service_t *loc_service_find_id(service_id_t id)
 {
+	ht_link_t *link;
+
 	assert(fibril_mutex_is_locked(&services_list_mutex));
 
-	list_foreach(services_list, services, loc_service_t, service) {
-		if (service->id == id)
-			return service;
-	}
+	link = hash_table_find(&services_by_id, &id);
+	if (link == NULL)
+		return NULL;
 
-	return NULL;
+	return hash_table_get_inst(link, loc_service_t, id_link);
+}
+
+/** Insert service into global list of services and its indices. */
+static void loc_service_insert(loc_service_t *service)
+{
+	assert(fibril_mutex_is_locked(&services_list_mutex));
+
+	list_append(&service->services, &services_list);
+	hash_table_insert(&services_by_id, &service->id_link);
+	hash_table_insert(&services_by_name, &service->name_link);
 }
 
 /** Create a namespace (if not already present). */
@@ -271,6 +424,8 @@ static loc_namespace_t *loc_namespace_create(const char *ns_name)
 	 * Insert new namespace into list of registered namespaces
 	 */
 	list_append(&(namespace->namespaces), &namespaces_list);
+	hash_table_insert(&namespaces_by_id, &namespace->id_link);
+	hash_table_insert(&namespaces_by_name, &namespace->name_link);
 
 	return namespace;
 }
@@ -282,6 +437,9 @@ static void loc_namespace_destroy(loc_namespace_t *namespace)
 
 	if (namespace->refcnt == 0) {
 		list_remove(&(namespace->namespaces));
+		hash_table_remove_item(&namespaces_by_id, &namespace->id_link);
+		hash_table_remove_item(&namespaces_by_name,
+		    &namespace->name_link);
 
 		free(namespace->name);
 		free(namespace);
@@ -313,6 +471,9 @@ static void loc_service_unregister_core(loc_service_t *service)
 	assert(fibril_mutex_is_locked(&services_list_mutex));
 	assert(fibril_mutex_is_locked(&cdir.mutex));
 
+	/* Remove from name index while the namespace name is still valid. */
+	hash_table_remove_item(&services_by_name, &service->name_link);
+	hash_table_remove_item(&services_by_id, &service->id_link);
 	loc_namespace_delref(service->namespace);
 	list_remove(&(service->services));
 	list_remove(&(service->server_services));
@@ -526,7 +687,7 @@ static void loc_service_register(cap_call_handle_t icall_handle, ipc_call_t *ica
 	service->server = server;
 
 	/* Insert service into list of all services  */
-	list_append(&service->services, &services_list);
+	loc_service_insert(service);
 
 	/* Insert service into list of services supplied by one server */
 	fibril_mutex_lock(&service->server->services_mutex);
@@ -882,15 +1043,44 @@ static void loc_callback_create(cap_call_handle_t icall_handle, ipc_call_t *ical
 	async_answer_0(icall_handle, EOK);
 }
 
-void loc_category_change_event(void)
+/** Send category change notification to all clients. */
+static void loc_category_change_notify(void)
 {
-	fibril_mutex_lock(&callback_sess_mutex);
+	assert(fibril_mutex_is_locked(&callback_sess_mutex));
 
 	list_foreach(callback_sess_list, cb_sess_list, cb_sess_t, cb_sess) {
 		async_exch_t *exch = async_exchange_begin(cb_sess->sess);
 		async_msg_0(exch, LOC_EVENT_CAT_CHANGE);
 		async_exchange_end(exch);
 	}
+}
+
+/** Category change notification timer handler. */
+static void loc_category_change_timeout(void *arg)
+{
+	fibril_mutex_lock(&callback_sess_mutex);
+	cat_change_pending = false;
+	loc_category_change_notify();
+	fibril_mutex_unlock(&callback_sess_mutex);
+}
+
+/** Notify clients that categories changed.
+ *
+ * Changes happening within CAT_CHANGE_DELAY_USEC of each other are coalesced
+ * into a single notification, so that a burst of registrations does not
+ * cause every client to re-read its categories after each of them.
+ */
+void loc_category_change_event(void)
+{
+	fibril_mutex_lock(&callback_sess_mutex);
+
+	if (cat_change_timer == NULL) {
+		loc_category_change_notify();
+	} else if (!cat_change_pending) {
+		cat_change_pending = true;
+		fibril_timer_set_locked(cat_change_timer,
+		    CAT_CHANGE_DELAY_USEC, loc_category_change_timeout, NULL);
+	}
 
 	fibril_mutex_unlock(&callback_sess_mutex);
 }
@@ -1238,7 +1428,7 @@ static void loc_null_create(cap_call_handle_t icall_handle, ipc_call_t *icall)
 	 * Insert service into a dummy list of null server's services so that it
 	 * can be safely removed later.
 	 */
-	list_append(&service->services, &services_list);
+	loc_service_insert(service);
 	list_append(&service->server_services, &dummy_null_services);
 	null_services[i] = service;
 
@@ -1329,6 +1519,22 @@ static bool loc_init(void)
 	for (i = 0; i < NULL_SERVICES; i++)
 		null_services[i] = NULL;
 
+	if (!hash_table_create(&services_by_id, 0, 0, &services_by_id_ops))
+		return false;
+	if (!hash_table_create(&services_by_name, 0, 0, &services_by_name_ops))
+		return false;
+	if (!hash_table_create(&namespaces_by_id, 0, 0, &namespaces_by_id_ops))
+		return false;
+	if (!hash_table_create(&namespaces_by_name, 0, 0,
+	    &namespaces_by_name_ops))
+		return false;
+
+	/*
+	 * If the timer cannot be created, category change notifications
+	 * are sent immediately.
+	 */
+	cat_change_timer = fibril_timer_create(&callback_sess_mutex);
+
 	categ_dir_init(&cdir);
 
 	cat = category_new("disk");
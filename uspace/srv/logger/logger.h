@@ -42,6 +42,7 @@
 #include <stdbool.h>
 #include <fibril_synch.h>
 #include <stdio.h>
+#include <sys/time.h>
 
 #define NAME "logger"
 #define LOG_LEVEL_USE_DEFAULT (LVL_LIMIT + 1)
@@ -58,6 +59,8 @@ typedef struct {
 	fibril_mutex_t guard;
 	char *filename;
 	FILE *logfile;
+	/** Written to without flushing */
+	bool dirty;
 } logger_dest_t;
 
 struct logger_log {
@@ -86,11 +89,15 @@ logger_log_t *find_or_create_log_and_lock(const char *, sysarg_t);
 logger_log_t *find_log_by_id_and_lock(sysarg_t);
 bool shall_log_message(logger_log_t *, log_level_t);
 void log_unlock(logger_log_t *);
-void write_to_log(logger_log_t *, log_level_t, const char *);
+void write_to_log(logger_log_t *, log_level_t, const struct timeval *,
+    const char *, bool);
+void flush_logs(void);
 void log_release(logger_log_t *);
 
 void registered_logs_init(logger_registered_logs_t *);
 bool register_log(logger_registered_logs_t *, logger_log_t *);
+logger_log_t *find_registered_log_and_lock(logger_registered_logs_t *,
+    sysarg_t);
 void unregister_logs(logger_registered_logs_t *);
 
 log_level_t get_default_logging_level(void);
@@ -61,6 +61,7 @@ static errno_t create_dest(const char *name, logger_dest_t **dest)
 		return ENOMEM;
 	}
 	result->logfile = NULL;
+	result->dirty = false;
 	fibril_mutex_initialize(&result->guard);
 	*dest = result;
 	return EOK;
@@ -285,7 +286,8 @@ void log_release(logger_log_t *log)
 }
 
 
-void write_to_log(logger_log_t *log, log_level_t level, const char *message)
+void write_to_log(logger_log_t *log, log_level_t level,
+    const struct timeval *tv, const char *message, bool flush)
 {
 	assert(fibril_mutex_is_locked(&log->guard));
 	assert(log->dest != NULL);
@@ -294,15 +296,37 @@ void write_to_log(logger_log_t *log, log_level_t level, const char *message)
 		log->dest->logfile = fopen(log->dest->filename, "a");
 
 	if (log->dest->logfile != NULL) {
-		fprintf(log->dest->logfile, "[%s] %s: %s\n",
+		fprintf(log->dest->logfile, "[%lld.%06ld] [%s] %s: %s\n",
+		    (long long) tv->tv_sec, (long) tv->tv_usec,
 		    log->full_name, log_level_str(level),
 		    (const char *) message);
-		fflush(log->dest->logfile);
+		if (flush)
+			fflush(log->dest->logfile);
+		else
+			log->dest->dirty = true;
 	}
 
 	fibril_mutex_unlock(&log->dest->guard);
 }
 
+/** Flush all log files written to by write_to_log() without flushing. */
+void flush_logs(void)
+{
+	fibril_mutex_lock(&log_list_guard);
+	list_foreach(log_list, link, logger_log_t, log) {
+		if (log->parent != NULL)
+			continue;
+
+		fibril_mutex_lock(&log->dest->guard);
+		if (log->dest->dirty) {
+			fflush(log->dest->logfile);
+			log->dest->dirty = false;
+		}
+		fibril_mutex_unlock(&log->dest->guard);
+	}
+	fibril_mutex_unlock(&log_list_guard);
+}
+
 void registered_logs_init(logger_registered_logs_t *logs)
 {
 	logs->logs_count = 0;
@@ -323,6 +347,30 @@ bool register_log(logger_registered_logs_t *logs, logger_log_t *new_log)
 	return true;
 }
 
+/** Find a log registered by a client and lock it.
+ *
+ * Registered logs are referenced by the client, so the log
+ * cannot disappear while it is registered.
+ *
+ * @param logs Logs registered by the client.
+ * @param id   Log id.
+ *
+ * @return Locked log or NULL if no such log is registered.
+ */
+logger_log_t *find_registered_log_and_lock(logger_registered_logs_t *logs,
+    sysarg_t id)
+{
+	for (size_t i = 0; i < logs->logs_count; i++) {
+		logger_log_t *log = logs->logs[i];
+		if ((sysarg_t) log == id) {
+			fibril_mutex_lock(&log->guard);
+			return log;
+		}
+	}
+
+	return NULL;
+}
+
 void unregister_logs(logger_registered_logs_t *logs)
 {
 	for (size_t i = 0; i < logs->logs_count; i++) {
@@ -37,17 +37,42 @@
 
 #include <ipc/services.h>
 #include <ipc/logger.h>
+#include <async_ring.h>
 #include <io/log.h>
 #include <io/logctl.h>
 #include <io/klog.h>
 #include <ns.h>
 #include <async.h>
 #include <errno.h>
+#include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <mem.h>
 #include <str_error.h>
+#include <thread.h>
 #include "logger.h"
 
+/** Size of the buffer the ring is drained into. */
+#define DRAIN_BUFFER_SIZE 16384
+
+/** Writer connection state. */
+typedef struct {
+	/** Protects @c logs and @c drained. */
+	fibril_mutex_t guard;
+	/** Logs registered by the client. */
+	logger_registered_logs_t logs;
+	/** Ring with batched messages (NULL if not attached). */
+	async_ring_t *ring;
+	/** Buffer for draining the ring. */
+	uint8_t *drain_buffer;
+	/** Buffer for the text of the message being written. */
+	char *message;
+	/** The drain thread has terminated. */
+	bool drained;
+	/** Signalled when the drain thread terminates. */
+	fibril_condvar_t drained_cv;
+} writer_client_t;
+
 
 static logger_log_t *handle_create_log(sysarg_t parent)
 {
@@ -63,26 +88,44 @@ static logger_log_t *handle_create_log(sysarg_t parent)
 	return log;
 }
 
-static errno_t handle_receive_message(sysarg_t log_id, sysarg_t level)
+/** Log a message received from a client.
+ *
+ * @param log     Locked log.
+ * @param level   Message severity level.
+ * @param tv      Time of the message.
+ * @param message The message.
+ * @param flush   Flush the log file after writing the message.
+ */
+static void log_message(logger_log_t *log, log_level_t level,
+    const struct timeval *tv, const char *message, bool flush)
+{
+	if (!shall_log_message(log, level))
+		return;
+
+	KLOG_PRINTF(level, "[%s] %s: %s",
+	    log->full_name, log_level_str(level), message);
+	write_to_log(log, level, tv, message, flush);
+}
+
+static errno_t handle_receive_message(ipc_call_t *call)
 {
-	logger_log_t *log = find_log_by_id_and_lock(log_id);
+	sysarg_t level = IPC_GET_ARG2(*call);
+	logger_log_t *log = find_log_by_id_and_lock(IPC_GET_ARG1(*call));
 	if (log == NULL)
 		return ENOENT;
 
 	void *message = NULL;
-	errno_t rc = async_data_write_accept(&message, true, 1, 0, 0, NULL);
+	errno_t rc;
+	if (call->payload_size > 0)
+		rc = async_payload_accept(call, &message, true, 1, 0, NULL);
+	else
+		rc = async_data_write_accept(&message, true, 1, 0, 0, NULL);
 	if (rc != EOK)
 		goto leave;
 
-	if (!shall_log_message(log, level)) {
-		rc = EOK;
-		goto leave;
-	}
-
-	KLOG_PRINTF(level, "[%s] %s: %s",
-	    log->full_name, log_level_str(level),
-	    (const char *) message);
-	write_to_log(log, level, message);
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	log_message(log, level, &tv, (const char *) message, true);
 
 	rc = EOK;
 
@@ -93,6 +136,161 @@ leave:
 	return rc;
 }
 
+/** Write a message record taken from the ring.
+ *
+ * @param client  Client connection.
+ * @param record  Record header.
+ * @param message Message text (not zero terminated).
+ */
+static void handle_record(writer_client_t *client,
+    const logger_record_t *record, const uint8_t *message)
+{
+	if (record->level >= LVL_LIMIT)
+		return;
+
+	fibril_mutex_lock(&client->guard);
+	logger_log_t *log = find_registered_log_and_lock(&client->logs,
+	    record->log);
+	fibril_mutex_unlock(&client->guard);
+
+	if (log == NULL)
+		return;
+
+	struct timeval tv;
+	tv.tv_sec = record->tv_sec;
+	tv.tv_usec = record->tv_usec;
+
+	if (record->dropped > 0) {
+		snprintf(client->message, LOGGER_MESSAGE_MAX,
+		    "%" PRIu32 " message(s) dropped", record->dropped);
+		write_to_log(log, LVL_WARN, &tv, client->message, false);
+	}
+
+	memcpy(client->message, message, record->size);
+	client->message[record->size] = '\0';
+	log_message(log, record->level, &tv, client->message, false);
+
+	log_unlock(log);
+}
+
+/** Drain the client ring.
+ *
+ * The thread writes out all messages put into the ring and terminates
+ * once the ring is closed and empty. Since the client never waits for
+ * space in the ring, it never waits for us either.
+ *
+ * @param arg Client connection.
+ */
+static void drain_thread(void *arg)
+{
+	writer_client_t *client = (writer_client_t *) arg;
+	uint8_t *buffer = client->drain_buffer;
+	size_t fill = 0;
+
+	while (true) {
+		size_t nread;
+		errno_t rc = async_ring_read(client->ring, buffer + fill,
+		    DRAIN_BUFFER_SIZE - fill, &nread);
+		if (rc != EOK)
+			break;
+
+		bool batch_end = (fill + nread < DRAIN_BUFFER_SIZE);
+		fill += nread;
+
+		size_t pos = 0;
+		while (fill - pos >= sizeof(logger_record_t)) {
+			logger_record_t record;
+			memcpy(&record, buffer + pos, sizeof(record));
+
+			if (record.size >= LOGGER_MESSAGE_MAX) {
+				logger_log("writer: corrupted ring.\n");
+				goto leave;
+			}
+
+			size_t rsize = sizeof(record) + record.size;
+			if (fill - pos < rsize)
+				break;
+
+			handle_record(client, &record,
+			    buffer + pos + sizeof(record));
+			pos += rsize;
+		}
+
+		memmove(buffer, buffer + pos, fill - pos);
+		fill -= pos;
+
+		/* Write the batch out once the ring has been emptied */
+		if (batch_end)
+			flush_logs();
+	}
+
+leave:
+	flush_logs();
+
+	fibril_mutex_lock(&client->guard);
+	client->drained = true;
+	fibril_condvar_broadcast(&client->drained_cv);
+	fibril_mutex_unlock(&client->guard);
+}
+
+static errno_t handle_attach_ring(writer_client_t *client)
+{
+	async_ring_t *ring;
+	errno_t rc = async_ring_accept(&ring);
+	if (rc != EOK)
+		return rc;
+
+	if (client->ring != NULL) {
+		async_ring_destroy(ring);
+		return EEXIST;
+	}
+
+	client->drain_buffer = malloc(DRAIN_BUFFER_SIZE);
+	client->message = malloc(LOGGER_MESSAGE_MAX);
+	if ((client->drain_buffer == NULL) || (client->message == NULL)) {
+		rc = ENOMEM;
+		goto error;
+	}
+
+	client->ring = ring;
+
+	thread_id_t tid;
+	rc = thread_create(drain_thread, client, "logger_drain", &tid);
+	if (rc != EOK) {
+		client->ring = NULL;
+		goto error;
+	}
+
+	thread_detach(tid);
+	return EOK;
+
+error:
+	async_ring_destroy(ring);
+	free(client->drain_buffer);
+	free(client->message);
+	client->drain_buffer = NULL;
+	client->message = NULL;
+	return rc;
+}
+
+/** Stop draining the client ring and destroy it.
+ *
+ * @param client Client connection.
+ */
+static void detach_ring(writer_client_t *client)
+{
+	async_ring_close(client->ring);
+
+	fibril_mutex_lock(&client->guard);
+	while (!client->drained)
+		fibril_condvar_wait(&client->drained_cv, &client->guard);
+	fibril_mutex_unlock(&client->guard);
+
+	async_ring_destroy(client->ring);
+	free(client->drain_buffer);
+	free(client->message);
+}
+
 void logger_connection_handler_writer(cap_call_handle_t chandle)
 {
 	logger_log_t *log;
@@ -103,8 +301,14 @@ void logger_connection_handler_writer(cap_call_handle_t chandle)
 
 	logger_log("writer: new client.\n");
 
-	logger_registered_logs_t registered_logs;
-	registered_logs_init(&registered_logs);
+	writer_client_t client;
+	fibril_mutex_initialize(&client.guard);
+	registered_logs_init(&client.logs);
+	client.ring = NULL;
+	client.drain_buffer = NULL;
+	client.message = NULL;
+	client.drained = false;
+	fibril_condvar_initialize(&client.drained_cv);
 
 	while (true) {
 		ipc_call_t call;
@@ -115,22 +319,30 @@ void logger_connection_handler_writer(cap_call_handle_t chandle)
 
 		switch (IPC_GET_IMETHOD(call)) {
 		case LOGGER_WRITER_CREATE_LOG:
+			/* The drain thread looks up the registered logs */
+			fibril_mutex_lock(&client.guard);
 			log = handle_create_log(IPC_GET_ARG1(call));
 			if (log == NULL) {
+				fibril_mutex_unlock(&client.guard);
 				async_answer_0(chandle, ENOMEM);
 				break;
 			}
-			if (!register_log(&registered_logs, log)) {
+			if (!register_log(&client.logs, log)) {
 				log_unlock(log);
+				fibril_mutex_unlock(&client.guard);
 				async_answer_0(chandle, ELIMIT);
 				break;
 			}
 			log_unlock(log);
+			fibril_mutex_unlock(&client.guard);
 			async_answer_1(chandle, EOK, (sysarg_t) log);
 			break;
 		case LOGGER_WRITER_MESSAGE:
-			rc = handle_receive_message(IPC_GET_ARG1(call),
-			    IPC_GET_ARG2(call));
+			rc = handle_receive_message(&call);
+			async_answer_0(chandle, rc);
+			break;
+		case LOGGER_WRITER_ATTACH_RING:
+			rc = handle_attach_ring(&client);
 			async_answer_0(chandle, rc);
 			break;
 		default:
@@ -139,11 +351,13 @@ void logger_connection_handler_writer(cap_call_handle_t chandle)
 		}
 	}
 
-	unregister_logs(&registered_logs);
+	if (client.ring != NULL)
+		detach_ring(&client);
+
+	unregister_logs(&client.logs);
 	logger_log("writer: client terminated.\n");
 }
 
-
 /**
  * @}
  */
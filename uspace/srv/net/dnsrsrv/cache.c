@@ -0,0 +1,414 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup dnsres
+ * @{
+ */
+/**
+ * @file DNS resolution cache
+ *
+ * Positive and negative answers are kept until their TTL expires. Lookups
+ * of a name which is being resolved wait for the query already in progress
+ * instead of sending another one.
+ */
+
+#include <adt/hash.h>
+#include <adt/hash_table.h>
+#include <adt/list.h>
+#include <errno.h>
+#include <fibril_synch.h>
+#include <io/log.h>
+#include <macros.h>
+#include <stdlib.h>
+#include <str.h>
+#include <sys/time.h>
+#include "cache.h"
+
+/** Maximum number of cached entries */
+#define DNS_CACHE_MAX_ENTRIES 512
+
+/** Upper limit for the time a positive answer is cached (seconds) */
+#define DNS_CACHE_TTL_MAX (24 * 60 * 60)
+
+/** Upper limit for the time a negative answer is cached (seconds) */
+#define DNS_CACHE_NEG_TTL_MAX (3 * 60 * 60)
+
+/** Cache entry */
+typedef struct {
+	/** Link to cache_table */
+	ht_link_t lhash;
+	/** Link to cache_lru, most recently used first */
+	link_t llru;
+	/** Number of references (the table and fibrils using the entry) */
+	unsigned refcnt;
+	/** Entry is in the table */
+	bool cached;
+
+	/** Queried name */
+	char *name;
+	/** Query type */
+	dns_qtype_t qtype;
+
+	/** Query is in progress */
+	bool pending;
+	/** Result of the query */
+	errno_t status;
+	/** Uptime (seconds) when the entry expires */
+	time_t expires;
+	/** Canonical name (positive answer) */
+	char *cname;
+	/** Address (positive answer) */
+	inet_addr_t addr;
+} dns_cache_entry_t;
+
+/** Cache lookup key */
+typedef struct {
+	const char *name;
+	dns_qtype_t qtype;
+} dns_cache_key_t;
+
+static FIBRIL_MUTEX_INITIALIZE(cache_lock);
+/** Signalled when a pending query completes */
+static FIBRIL_CONDVAR_INITIALIZE(cache_cv);
+static hash_table_t cache_table;
+static LIST_INITIALIZE(cache_lru);
+static dnsr_cache_stats_t cache_stats;
+
+/** Compute hash of a name, ignoring case of ASCII letters. */
+static size_t cache_name_hash(const char *name, dns_qtype_t qtype)
+{
+	size_t hash = qtype;
+
+	for (const char *c = name; *c != '\0'; c++) {
+		char ch = *c;
+		if ((ch >= 'A') && (ch <= 'Z'))
+			ch += 'a' - 'A';
+
+		hash = hash * 31 + (uint8_t) ch;
+	}
+
+	return hash_mix(hash);
+}
+
+static size_t cache_hash(const ht_link_t *item)
+{
+	dns_cache_entry_t *entry = hash_table_get_inst(item,
+	    dns_cache_entry_t, lhash);
+	return cache_name_hash(entry->name, entry->qtype);
+}
+
+static size_t cache_key_hash(void *arg)
+{
+	dns_cache_key_t *key = (dns_cache_key_t *) arg;
+	return cache_name_hash(key->name, key->qtype);
+}
+
+static bool cache_equal(const ht_link_t *item1, const ht_link_t *item2)
+{
+	dns_cache_entry_t *entry1 = hash_table_get_inst(item1,
+	    dns_cache_entry_t, lhash);
+	dns_cache_entry_t *entry2 = hash_table_get_inst(item2,
+	    dns_cache_entry_t, lhash);
+	return (entry1->qtype == entry2->qtype) &&
+	    (str_casecmp(entry1->name, entry2->name) == 0);
+}
+
+static bool cache_key_equal(void *arg, const ht_link_t *item)
+{
+	dns_cache_key_t *key = (dns_cache_key_t *) arg;
+	dns_cache_entry_t *entry = hash_table_get_inst(item,
+	    dns_cache_entry_t, lhash);
+	return (entry->qtype == key->qtype) &&
+	    (str_casecmp(entry->name, key->name) == 0);
+}
+
+static hash_table_ops_t cache_hash_ops = {
+	.hash = cache_hash,
+	.key_hash = cache_key_hash,
+	.equal = cache_equal,
+	.key_equal = cache_key_equal,
+	.remove_callback = NULL
+};
+
+/** Initialize DNS cache.
+ *
+ * @return EOK on success, ENOMEM if out of memory
+ */
+errno_t dns_cache_init(void)
+{
+	if (!hash_table_create(&cache_table, 0, 0, &cache_hash_ops))
+		return ENOMEM;
+
+	return EOK;
+}
+
+/** Get current time in seconds. */
+static time_t cache_now(void)
+{
+	struct timeval tv;
+
+	getuptime(&tv);
+	return tv.tv_sec;
+}
+
+/** Drop reference to cache entry, destroying it when unused. */
+static void cache_entry_release(dns_cache_entry_t *entry)
+{
+	assert(fibril_mutex_is_locked(&cache_lock));
+	assert(entry->refcnt > 0);
+
+	if (--entry->refcnt > 0)
+		return;
+
+	free(entry->name);
+	free(entry->cname);
+	free(entry);
+}
+
+/** Remove entry from the cache. */
+static void cache_entry_remove(dns_cache_entry_t *entry)
+{
+	assert(fibril_mutex_is_locked(&cache_lock));
+	assert(entry->cached);
+
+	hash_table_remove_item(&cache_table, &entry->lhash);
+	list_remove(&entry->llru);
+	entry->cached = false;
+	cache_stats.entries--;
+
+	cache_entry_release(entry);
+}
+
+/** Make room for a new entry.
+ *
+ * Expired entries are removed first, otherwise the least recently used
+ * entry which is not being resolved.
+ */
+static void cache_make_room(time_t now)
+{
+	assert(fibril_mutex_is_locked(&cache_lock));
+
+	if (cache_stats.entries < DNS_CACHE_MAX_ENTRIES)
+		return;
+
+	list_foreach_safe(cache_lru, cur, next) {
+		dns_cache_entry_t *entry = list_get_instance(cur,
+		    dns_cache_entry_t, llru);
+
+		if (!entry->pending && (entry->expires <= now))
+			cache_entry_remove(entry);
+	}
+
+	link_t *link = list_last(&cache_lru);
+	while ((cache_stats.entries >= DNS_CACHE_MAX_ENTRIES) &&
+	    (link != NULL)) {
+		dns_cache_entry_t *entry = list_get_instance(link,
+		    dns_cache_entry_t, llru);
+		link = list_prev(link, &cache_lru);
+
+		if (!entry->pending) {
+			cache_entry_remove(entry);
+			cache_stats.evictions++;
+		}
+	}
+}
+
+/** Copy result from cache entry.
+ *
+ * @param entry Completed cache entry
+ * @param info  Host information to fill in
+ * @return Result of the query, ENOMEM if out of memory
+ */
+static errno_t cache_entry_result(dns_cache_entry_t *entry,
+    dns_host_info_t *info)
+{
+	if (entry->status != EOK)
+		return entry->status;
+
+	info->cname = str_dup(entry->cname);
+	if (info->cname == NULL)
+		return ENOMEM;
+
+	info->addr = entry->addr;
+	return EOK;
+}
+
+/** Resolve name using the cache.
+ *
+ * If the answer is not cached and no query for it is in progress, the
+ * query procedure is called and its answer stored in the cache.
+ *
+ * @param name  Name to resolve
+ * @param qtype Query type (A or AAAA)
+ * @param query Query procedure
+ * @param info  Host information to fill in
+ *
+ * @return EOK on success, ENOENT if the name does not resolve,
+ *         other error code if the query failed
+ */
+errno_t dns_cache_resolve(const char *name, dns_qtype_t qtype,
+    dns_cache_query_t query, dns_host_info_t *info)
+{
+	dns_cache_key_t key;
+	dns_cache_entry_t *entry;
+	errno_t rc;
+
+	key.name = name;
+	key.qtype = qtype;
+
+	fibril_mutex_lock(&cache_lock);
+
+	time_t now = cache_now();
+	ht_link_t *link = hash_table_find(&cache_table, &key);
+	if (link != NULL) {
+		entry = hash_table_get_inst(link, dns_cache_entry_t, lhash);
+
+		if (entry->pending) {
+			/* Wait for the query in progress */
+			cache_stats.joined++;
+			entry->refcnt++;
+
+			while (entry->pending)
+				fibril_condvar_wait(&cache_cv, &cache_lock);
+
+			rc = cache_entry_result(entry, info);
+			cache_entry_release(entry);
+			fibril_mutex_unlock(&cache_lock);
+			return rc;
+		}
+
+		if (entry->expires > now) {
+			if (entry->status == EOK)
+				cache_stats.hits++;
+			else
+				cache_stats.neg_hits++;
+
+			list_remove(&entry->llru);
+			list_prepend(&entry->llru, &cache_lru);
+
+			rc = cache_entry_result(entry, info);
+			fibril_mutex_unlock(&cache_lock);
+			return rc;
+		}
+
+		cache_entry_remove(entry);
+	}
+
+	cache_stats.misses++;
+
+	entry = calloc(1, sizeof(dns_cache_entry_t));
+	if (entry == NULL) {
+		fibril_mutex_unlock(&cache_lock);
+		return ENOMEM;
+	}
+
+	entry->name = str_dup(name);
+	if (entry->name == NULL) {
+		free(entry);
+		fibril_mutex_unlock(&cache_lock);
+		return ENOMEM;
+	}
+
+	entry->qtype = qtype;
+	entry->pending = true;
+	/* One reference for the table, one for us */
+	entry->refcnt = 2;
+
+	cache_make_room(now);
+
+	hash_table_insert(&cache_table, &entry->lhash);
+	list_prepend(&entry->llru, &cache_lru);
+	entry->cached = true;
+	cache_stats.entries++;
+
+	fibril_mutex_unlock(&cache_lock);
+
+	uint32_t ttl = 0;
+	rc = query(name, qtype, info, &ttl);
+
+	fibril_mutex_lock(&cache_lock);
+
+	entry->pending = false;
+	entry->status = rc;
+
+	if (rc == EOK) {
+		entry->addr = info->addr;
+		entry->cname = str_dup(info->cname);
+		if (entry->cname == NULL)
+			entry->status = ENOMEM;
+
+		ttl = min(ttl, DNS_CACHE_TTL_MAX);
+	} else {
+		ttl = min(ttl, DNS_CACHE_NEG_TTL_MAX);
+	}
+
+	entry->expires = cache_now() + ttl;
+
+	/* Failed queries only serve the fibrils which waited for them */
+	if ((entry->status != EOK && entry->status != ENOENT) || (ttl == 0)) {
+		if (entry->cached)
+			cache_entry_remove(entry);
+	}
+
+	cache_entry_release(entry);
+
+	fibril_condvar_broadcast(&cache_cv);
+	fibril_mutex_unlock(&cache_lock);
+
+	return rc;
+}
+
+/** Remove all completed entries from the cache. */
+void dns_cache_flush(void)
+{
+	fibril_mutex_lock(&cache_lock);
+
+	list_foreach_safe(cache_lru, cur, next) {
+		dns_cache_entry_t *entry = list_get_instance(cur,
+		    dns_cache_entry_t, llru);
+
+		if (!entry->pending)
+			cache_entry_remove(entry);
+	}
+
+	fibril_mutex_unlock(&cache_lock);
+}
+
+/** Get cache statistics.
+ *
+ * @param stats Place to store statistics
+ */
+void dns_cache_get_stats(dnsr_cache_stats_t *stats)
+{
+	fibril_mutex_lock(&cache_lock);
+	*stats = cache_stats;
+	fibril_mutex_unlock(&cache_lock);
+}
+
+/** @}
+ */
@@ -45,6 +45,7 @@
 #include <str.h>
 #include <task.h>
 
+#include "cache.h"
 #include "dns_msg.h"
 #include "dns_std.h"
 #include "query.h"
@@ -59,6 +60,12 @@ static errno_t dnsr_init(void)
 	errno_t rc;
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "dnsr_init()");
 
+	rc = dns_cache_init();
+	if (rc != EOK) {
+		log_msg(LOG_DEFAULT, LVL_ERROR, "Failed initializing cache.");
+		return EIO;
+	}
+
 	rc = transport_init();
 	if (rc != EOK) {
 		log_msg(LOG_DEFAULT, LVL_ERROR, "Failed initializing transport.");
@@ -203,8 +210,41 @@ static void dnsr_set_srvaddr_srv(dnsr_client_t *client, cap_call_handle_t icall_
 	if (rc != EOK) {
 		async_answer_0(chandle, rc);
 		async_answer_0(icall_handle, rc);
+		return;
 	}
 
+	/* Answers from the previous server are no longer relevant */
+	dns_cache_flush();
+
+	async_answer_0(icall_handle, rc);
+}
+
+static void dnsr_get_cache_stats_srv(dnsr_client_t *client,
+    cap_call_handle_t icall_handle, ipc_call_t *icall)
+{
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "dnsr_get_cache_stats_srv()");
+
+	cap_call_handle_t chandle;
+	size_t size;
+	if (!async_data_read_receive(&chandle, &size)) {
+		async_answer_0(chandle, EREFUSED);
+		async_answer_0(icall_handle, EREFUSED);
+		return;
+	}
+
+	if (size != sizeof(dnsr_cache_stats_t)) {
+		async_answer_0(chandle, EINVAL);
+		async_answer_0(icall_handle, EINVAL);
+		return;
+	}
+
+	dnsr_cache_stats_t stats;
+	dns_cache_get_stats(&stats);
+
+	errno_t rc = async_data_read_finalize(chandle, &stats, size);
+	if (rc != EOK)
+		async_answer_0(chandle, rc);
+
 	async_answer_0(icall_handle, rc);
 }
 
@@ -238,6 +278,9 @@ static void dnsr_client_conn(cap_call_handle_t icall_handle, ipc_call_t *icall,
 		case DNSR_SET_SRVADDR:
 			dnsr_set_srvaddr_srv(&client, chandle, &call);
 			break;
+		case DNSR_GET_CACHE_STATS:
+			dnsr_get_cache_stats_srv(&client, chandle, &call);
+			break;
 		default:
 			async_answer_0(chandle, EINVAL);
 		}
@@ -34,10 +34,14 @@
  */
 
 #include <errno.h>
+#include <fibril.h>
+#include <fibril_synch.h>
 #include <io/log.h>
+#include <macros.h>
 #include <mem.h>
 #include <stdlib.h>
 #include <str.h>
+#include "cache.h"
 #include "dns_msg.h"
 #include "dns_std.h"
 #include "dns_type.h"
@@ -46,8 +50,67 @@
 
 static uint16_t msg_id;
 
+/** Parallel query of a different record type */
+typedef struct {
+	const char *name;
+	dns_qtype_t qtype;
+	dns_host_info_t info;
+	errno_t rc;
+
+	bool done;
+	fibril_mutex_t lock;
+	fibril_condvar_t done_cv;
+} dns_par_query_t;
+
+/** Get TTL of resource record in seconds.
+ *
+ * Values with the most significant bit set are treated as zero
+ * (RFC 2181, section 8).
+ */
+static uint32_t dns_rr_ttl(dns_rr_t *rr)
+{
+	if ((rr->ttl & 0x80000000) != 0)
+		return 0;
+
+	return rr->ttl;
+}
+
+/** Determine how long a negative answer may be cached.
+ *
+ * Uses the SOA record from the authority section (RFC 2308, section 5).
+ *
+ * @param amsg Answer message
+ * @return TTL in seconds, zero if the answer must not be cached
+ */
+static uint32_t dns_negative_ttl(dns_message_t *amsg)
+{
+	list_foreach(amsg->authority, msg, dns_rr_t, rr) {
+		/* MINIMUM is the last field of SOA RDATA */
+		if ((rr->rtype == DTYPE_SOA) && (rr->rclass == DC_IN) &&
+		    (rr->rdata_size >= 2 + 5 * sizeof(uint32_t))) {
+			uint8_t *minimum = (uint8_t *) rr->rdata +
+			    rr->rdata_size - sizeof(uint32_t);
+
+			return min(dns_rr_ttl(rr),
+			    dns_uint32_t_decode(minimum, sizeof(uint32_t)));
+		}
+	}
+
+	return 0;
+}
+
+/** Query DNS server for a name.
+ *
+ * @param name  Name to resolve
+ * @param qtype Query type (A or AAAA)
+ * @param info  Host information to fill in
+ * @param rttl  Place to store how long the answer may be cached
+ *
+ * @return EOK on success, ENOENT if the name does not exist or has no
+ *         record of the type, other error code if the query failed
+ */
 static errno_t dns_name_query(const char *name, dns_qtype_t qtype,
-    dns_host_info_t *info)
+    dns_host_info_t *info, uint32_t *rttl)
 {
 	/* Start with the caller-provided name */
 	char *sname = str_dup(name);
@@ -98,6 +161,9 @@ static errno_t dns_name_query(const char *name, dns_qtype_t qtype,
 		return rc;
 	}
 
+	/* The answer may be cached as long as all records used are valid */
+	uint32_t ttl = UINT32_MAX;
+
 	list_foreach(amsg->answer, msg, dns_rr_t, rr) {
 		log_msg(LOG_DEFAULT, LVL_DEBUG, " - '%s' %u/%u, dsize %zu",
 		    rr->name, rr->rtype, rr->rclass, rr->rdata_size);
@@ -129,6 +195,7 @@ static errno_t dns_name_query(const char *name, dns_qtype_t qtype,
 			/* Continue looking for the more canonical name */
 			free(sname);
 			sname = cname;
+			ttl = min(ttl, dns_rr_ttl(rr));
 		}
 
 		if ((qtype == DTYPE_A) && (rr->rtype == DTYPE_A) &&
@@ -146,6 +213,7 @@ static errno_t dns_name_query(const char *name, dns_qtype_t qtype,
 
 			inet_addr_set(dns_uint32_t_decode(rr->rdata, rr->rdata_size),
 			    &info->addr);
+			*rttl = min(ttl, dns_rr_ttl(rr));
 
 			dns_message_destroy(msg);
 			dns_message_destroy(amsg);
@@ -171,6 +239,7 @@ static errno_t dns_name_query(const char *name, dns_qtype_t qtype,
 			dns_addr128_t_decode(rr->rdata, rr->rdata_size, addr);
 
 			inet_addr_set6(addr, &info->addr);
+			*rttl = min(ttl, dns_rr_ttl(rr));
 
 			dns_message_destroy(msg);
 			dns_message_destroy(amsg);
@@ -182,11 +251,82 @@ static errno_t dns_name_query(const char *name, dns_qtype_t qtype,
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "'%s' not resolved, fail", sname);
 
+	/* Name does not exist or has no such record */
+	if ((amsg->rcode == RC_OK) || (amsg->rcode == RC_NAME_ERR)) {
+		*rttl = dns_negative_ttl(amsg);
+		rc = ENOENT;
+	} else {
+		rc = EIO;
+	}
+
 	dns_message_destroy(msg);
 	dns_message_destroy(amsg);
 	free(sname);
 
-	return EIO;
+	return rc;
+}
+
+static errno_t dns_par_query_fibril(void *arg)
+{
+	dns_par_query_t *pq = (dns_par_query_t *) arg;
+
+	errno_t rc = dns_cache_resolve(pq->name, pq->qtype, dns_name_query,
+	    &pq->info);
+
+	fibril_mutex_lock(&pq->lock);
+	pq->rc = rc;
+	pq->done = true;
+	fibril_mutex_unlock(&pq->lock);
+	fibril_condvar_broadcast(&pq->done_cv);
+
+	return EOK;
+}
+
+/** Resolve name to any address, preferring IPv6.
+ *
+ * The A query runs in a separate fibril concurrently with the AAAA query.
+ */
+static errno_t dns_name2host_any(const char *name, dns_host_info_t *info)
+{
+	dns_par_query_t pq;
+
+	memset(&pq, 0, sizeof(pq));
+	pq.name = name;
+	pq.qtype = DTYPE_A;
+	fibril_mutex_initialize(&pq.lock);
+	fibril_condvar_initialize(&pq.done_cv);
+
+	fid_t fid = fibril_create(dns_par_query_fibril, &pq);
+	if (fid == 0) {
+		/* Fall back to sequential queries */
+		errno_t rc = dns_cache_resolve(name, DTYPE_AAAA, dns_name_query,
+		    info);
+		if (rc != EOK)
+			rc = dns_cache_resolve(name, DTYPE_A, dns_name_query, info);
+
+		return rc;
+	}
+
+	fibril_add_ready(fid);
+
+	errno_t rc = dns_cache_resolve(name, DTYPE_AAAA, dns_name_query, info);
+
+	fibril_mutex_lock(&pq.lock);
+	while (!pq.done)
+		fibril_condvar_wait(&pq.done_cv, &pq.lock);
+	fibril_mutex_unlock(&pq.lock);
+
+	if (rc == EOK) {
+		if (pq.rc == EOK)
+			free(pq.info.cname);
+
+		return EOK;
+	}
+
+	if (pq.rc == EOK)
+		*info = pq.info;
+
+	return pq.rc;
 }
 
 errno_t dns_name2host(const char *name, dns_host_info_t **rinfo, ip_ver_t ver)
@@ -199,22 +339,22 @@ errno_t dns_name2host(const char *name, dns_host_info_t **rinfo, ip_ver_t ver)
 
 	switch (ver) {
 	case ip_any:
-		rc = dns_name_query(name, DTYPE_AAAA, info);
-
-		if (rc != EOK)
-			rc = dns_name_query(name, DTYPE_A, info);
-
+		rc = dns_name2host_any(name, info);
 		break;
 	case ip_v4:
-		rc = dns_name_query(name, DTYPE_A, info);
+		rc = dns_cache_resolve(name, DTYPE_A, dns_name_query, info);
 		break;
 	case ip_v6:
-		rc = dns_name_query(name, DTYPE_AAAA, info);
+		rc = dns_cache_resolve(name, DTYPE_AAAA, dns_name_query, info);
 		break;
 	default:
 		rc = EINVAL;
 	}
 
+	/* Clients expect EIO for names which do not resolve */
+	if (rc == ENOENT)
+		rc = EIO;
+
 	if (rc == EOK)
 		*rinfo = info;
 	else
@@ -146,8 +146,10 @@ static trans_req_t *treq_create(dns_message_t *req)
 
 static void treq_destroy(trans_req_t *treq)
 {
+	fibril_mutex_lock(&treq_lock);
 	if (link_in_use(&treq->lreq))
 		list_remove(&treq->lreq);
+	fibril_mutex_unlock(&treq_lock);
 	free(treq);
 }
 
@@ -181,7 +183,7 @@ errno_t dns_request(dns_message_t *req, dns_message_t **rresp)
 	trans_req_t *treq = NULL;
 	inet_ep_t ep;
 
-	void *req_data;
+	void *req_data = NULL;
 	size_t req_size;
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "dns_request: Encode dns message");
 	errno_t rc = dns_message_encode(req, &req_data, &req_size);
@@ -194,6 +196,16 @@ errno_t dns_request(dns_message_t *req, dns_message_t **rresp)
 
 	size_t ntry = 0;
 
+	/*
+	 * Register the request before sending it so that a quick response
+	 * is not lost. The same request is used for all retries.
+	 */
+	treq = treq_create(req);
+	if (treq == NULL) {
+		rc = ENOMEM;
+		goto error;
+	}
+
 	while (ntry < REQ_RETRY_MAX) {
 		log_msg(LOG_DEFAULT, LVL_DEBUG, "dns_request: Send DNS message");
 		rc = udp_assoc_send_msg(transport_assoc, &ep, req_data,
@@ -203,12 +215,6 @@ errno_t dns_request(dns_message_t *req, dns_message_t **rresp)
 			goto error;
 		}
 
-		treq = treq_create(req);
-		if (treq == NULL) {
-			rc = ENOMEM;
-			goto error;
-		}
-
 		fibril_mutex_lock(&treq->done_lock);
 		while (treq->done != true) {
 			rc = fibril_condvar_wait_timeout(&treq->done_cv, &treq->done_lock,
@@ -228,22 +228,12 @@ errno_t inet_addrobj_send_dgram(inet_addrobj_t *addr, inet_addr_t *ldest,
 	if (lsrc_ver != ldest_ver)
 		return EINVAL;
 
-	errno_t rc;
-	addr48_t ldest_mac;
-
 	switch (ldest_ver) {
 	case ip_v4:
 		return inet_link_send_dgram(addr->ilink, lsrc_v4, ldest_v4,
 		    dgram, proto, ttl, df);
 	case ip_v6:
-		/*
-		 * Translate local destination IPv6 address.
-		 */
-		rc = ndp_translate(lsrc_v6, ldest_v6, ldest_mac, addr->ilink);
-		if (rc != EOK)
-			return rc;
-
-		return inet_link_send_dgram6(addr->ilink, ldest_mac, dgram,
+		return ndp_send_dgram(addr->ilink, lsrc_v6, ldest_v6, dgram,
 		    proto, ttl, df);
 	default:
 		assert(false);
@@ -36,6 +36,7 @@
 
 #include <byteorder.h>
 #include <errno.h>
+#include <inet/checksum.h>
 #include <io/log.h>
 #include <mem.h>
 #include <stdlib.h>
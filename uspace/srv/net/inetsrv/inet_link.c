@@ -39,6 +39,7 @@
 #include <str_error.h>
 #include <fibril_synch.h>
 #include <inet/iplink.h>
+#include <inet/iplink_srv.h>
 #include <io/log.h>
 #include <loc.h>
 #include <stdlib.h>
@@ -46,6 +47,7 @@
 #include "addrobj.h"
 #include "inetsrv.h"
 #include "inet_link.h"
+#include "inet_std.h"
 #include "pdu.h"
 
 static bool first_link = true;
@@ -127,7 +129,7 @@ static errno_t inet_iplink_change_addr(iplink_t *iplink, addr48_t mac)
 	    mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
 
 	list_foreach(inet_links, link_list, inet_link_t, ilink) {
-		if (ilink->sess == iplink->sess)
+		if (ilink->iplink == iplink)
 			memcpy(&ilink->mac, mac, sizeof(addr48_t));
 	}
 
@@ -161,6 +163,7 @@ errno_t inet_link_open(service_id_t sid)
 {
 	inet_link_t *ilink;
 	inet_addr_t iaddr;
+	iplink_srv_t *srv;
 	errno_t rc;
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "inet_link_open()");
@@ -177,13 +180,23 @@ errno_t inet_link_open(service_id_t sid)
 		goto error;
 	}
 
-	ilink->sess = loc_service_connect(sid, INTERFACE_IPLINK, 0);
-	if (ilink->sess == NULL) {
-		log_msg(LOG_DEFAULT, LVL_ERROR, "Failed connecting '%s'", ilink->svc_name);
-		goto error;
+	srv = iplink_srv_local_find(sid);
+	if (srv != NULL) {
+		/* Link provided by this task, use direct calls */
+		rc = iplink_open_local(srv, &inet_iplink_ev_ops, ilink,
+		    &ilink->iplink);
+	} else {
+		ilink->sess = loc_service_connect(sid, INTERFACE_IPLINK, 0);
+		if (ilink->sess == NULL) {
+			log_msg(LOG_DEFAULT, LVL_ERROR, "Failed connecting '%s'",
+			    ilink->svc_name);
+			goto error;
+		}
+
+		rc = iplink_open(ilink->sess, &inet_iplink_ev_ops, ilink,
+		    &ilink->iplink);
 	}
 
-	rc = iplink_open(ilink->sess, &inet_iplink_ev_ops, ilink, &ilink->iplink);
 	if (rc != EOK) {
 		log_msg(LOG_DEFAULT, LVL_ERROR, "Failed opening IP link '%s'",
 		    ilink->svc_name);
@@ -197,6 +210,10 @@ errno_t inet_link_open(service_id_t sid)
 		goto error;
 	}
 
+	rc = iplink_get_offload(ilink->iplink, &ilink->offload);
+	if (rc != EOK)
+		ilink->offload = 0;
+
 	/*
 	 * Get the MAC address of the link. If the link has a MAC
 	 * address, we assume that it supports NDP.
@@ -333,6 +350,21 @@ errno_t inet_link_send_dgram(inet_link_t *ilink, addr32_t lsrc, addr32_t ldest,
 
 	sdu.src = lsrc;
 	sdu.dest = ldest;
+	sdu.flags = 0;
+
+	/*
+	 * Let the link complete the transport checksum if it can and
+	 * the packet is not going to be fragmented.
+	 */
+	if ((df & INET_CSUM_PARTIAL) != 0) {
+		if ((ilink->offload & IPLINK_OFFLOAD_TX_CSUM4) != 0 &&
+		    sizeof(ip_header_t) + dgram->size <= ilink->def_mtu) {
+			sdu.flags |= IPLINK_SDU_CSUM_PARTIAL;
+		} else {
+			inet_pdu_csum_complete(proto, dgram->data,
+			    dgram->size);
+		}
+	}
 
 	inet_packet_t packet;
 
@@ -347,7 +379,7 @@ errno_t inet_link_send_dgram(inet_link_t *ilink, addr32_t lsrc, addr32_t ldest,
 	packet.ident = ++ip_ident;
 	fibril_mutex_unlock(&ip_ident_lock);
 
-	packet.df = df;
+	packet.df = (df & INET_DF) != 0;
 	packet.data = dgram->data;
 	packet.size = dgram->size;
 
@@ -420,10 +452,13 @@ errno_t inet_link_send_dgram6(inet_link_t *ilink, addr48_t ldest,
 	packet.ident = ++ip_ident;
 	fibril_mutex_unlock(&ip_ident_lock);
 
-	packet.df = df;
+	packet.df = (df & INET_DF) != 0;
 	packet.data = dgram->data;
 	packet.size = dgram->size;
 
+	if ((df & INET_CSUM_PARTIAL) != 0)
+		inet_pdu_csum_complete(proto, dgram->data, dgram->size);
+
 	errno_t rc;
 	size_t offs = 0;
 
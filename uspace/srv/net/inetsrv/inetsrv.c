@@ -38,6 +38,7 @@
 #include <async.h>
 #include <errno.h>
 #include <str_error.h>
+#include <ethip/ethip.h>
 #include <fibril_synch.h>
 #include <io/log.h>
 #include <ipc/inet.h>
@@ -47,6 +48,7 @@
 #include <stdlib.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <str.h>
 #include <task.h>
 #include "addrobj.h"
 #include "icmp.h"
@@ -57,6 +59,7 @@
 #include "inetcfg.h"
 #include "inetping.h"
 #include "inet_link.h"
+#include "ntrans.h"
 #include "reass.h"
 #include "sroute.h"
 
@@ -137,7 +140,7 @@ static void inet_callback_create_srv(inet_client_t *client, cap_call_handle_t ch
 static errno_t inet_find_dir(inet_addr_t *src, inet_addr_t *dest, uint8_t tos,
     inet_dir_t *dir)
 {
-	inet_sroute_t *sr;
+	inet_addr_t router;
 
 	/* XXX Handle case where source address is specified */
 	(void) src;
@@ -148,10 +151,9 @@ static errno_t inet_find_dir(inet_addr_t *src, inet_addr_t *dest, uint8_t tos,
 		dir->dtype = dt_direct;
 	} else {
 		/* No direct path, try using a static route */
-		sr = inet_sroute_find(dest);
-		if (sr != NULL) {
-			dir->aobj = inet_addrobj_find(&sr->router, iaf_net);
-			dir->ldest = sr->router;
+		if (inet_sroute_find(dest, &router) == EOK) {
+			dir->aobj = inet_addrobj_find(&router, iaf_net);
+			dir->ldest = router;
 			dir->dtype = dt_router;
 		}
 	}
@@ -544,17 +546,53 @@ int main(int argc, char *argv[])
 {
 	errno_t rc;
 
+	bool ethip = false;
+
 	printf(NAME ": HelenOS Internet Protocol service\n");
 
+	if (argc == 2 && str_cmp(argv[1], "--ethip") == 0) {
+		ethip = true;
+	} else if (argc != 1) {
+		printf("Syntax: %s [--ethip]\n", NAME);
+		return 1;
+	}
+
 	if (log_init(NAME) != EOK) {
 		printf(NAME ": Failed to initialize logging.\n");
 		return 1;
 	}
 
+	rc = ntrans_init();
+	if (rc != EOK) {
+		printf(NAME ": Failed initializing neighbor cache.\n");
+		return 1;
+	}
+
+	rc = inet_reass_init();
+	if (rc != EOK) {
+		printf(NAME ": Failed initializing reassembly.\n");
+		return 1;
+	}
+
 	rc = inet_init();
 	if (rc != EOK)
 		return 1;
 
+	/*
+	 * Provide IP over Ethernet links within this task. Received and
+	 * transmitted packets then pass between inetsrv and ethip via
+	 * direct function calls. The separate ethip task must not be
+	 * running in this case.
+	 */
+	if (ethip) {
+		rc = ethip_start();
+		if (rc != EOK) {
+			log_msg(LOG_DEFAULT, LVL_ERROR, "Failed starting "
+			    "IP over Ethernet.");
+			return 1;
+		}
+	}
+
 	printf(NAME ": Accepting connections.\n");
 	task_retval(0);
 	async_manager();
@@ -108,6 +108,8 @@ typedef struct {
 	async_sess_t *sess;
 	iplink_t *iplink;
 	size_t def_mtu;
+	/** Offload options supported by the link (IPLINK_OFFLOAD_xxx) */
+	uint32_t offload;
 	addr48_t mac;
 	bool mac_valid;
 } inet_link_t;
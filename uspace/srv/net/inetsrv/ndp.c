@@ -44,9 +44,6 @@
 #include "inet_link.h"
 #include "ndp.h"
 
-/** Time to wait for NDP reply in microseconds */
-#define NDP_REQUEST_TIMEOUT  (3 * 1000 * 1000)
-
 static addr128_t solicited_node_ip =
     { 0xff, 0x02, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x01, 0xff, 0, 0, 0 };
 
@@ -98,6 +95,8 @@ errno_t ndp_received(inet_dgram_t *dgram)
 	inet_addr_set6(packet.target_proto_addr, &target);
 
 	inet_addrobj_t *laddr;
+	inet_addr_t laddr_addr;
+	addr128_t laddr_v6;
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "NDP PDU decoded; opcode: %d",
 	    packet.opcode);
@@ -106,8 +105,8 @@ errno_t ndp_received(inet_dgram_t *dgram)
 	case ICMPV6_NEIGHBOUR_SOLICITATION:
 		laddr = inet_addrobj_find(&target, iaf_addr);
 		if (laddr != NULL) {
-			rc = ntrans_add(packet.sender_proto_addr,
-			    packet.sender_hw_addr);
+			rc = ntrans_add(laddr->ilink, packet.target_proto_addr,
+			    packet.sender_proto_addr, packet.sender_hw_addr);
 			if (rc != EOK)
 				return rc;
 
@@ -125,9 +124,12 @@ errno_t ndp_received(inet_dgram_t *dgram)
 		break;
 	case ICMPV6_NEIGHBOUR_ADVERTISEMENT:
 		laddr = inet_addrobj_find(&dgram->dest, iaf_addr);
-		if (laddr != NULL)
-			return ntrans_add(packet.sender_proto_addr,
-			    packet.sender_hw_addr);
+		if (laddr != NULL) {
+			inet_naddr_addr(&laddr->naddr, &laddr_addr);
+			(void) inet_addr_get(&laddr_addr, NULL, &laddr_v6);
+			return ntrans_add(laddr->ilink, laddr_v6,
+			    packet.sender_proto_addr, packet.sender_hw_addr);
+		}
 
 		break;
 	case ICMPV6_ROUTER_ADVERTISEMENT:
@@ -139,44 +141,72 @@ errno_t ndp_received(inet_dgram_t *dgram)
 	return EOK;
 }
 
-/** Translate IPv6 to MAC address
+/** Send neighbor solicitation
  *
- * @param src  Source IPv6 address
- * @param dest Destination IPv6 address
- * @param mac  Target MAC address to be assigned
- * @param link Network interface
+ * @param ilink    Network interface
+ * @param src_addr Source IPv6 address
+ * @param ip_addr  IPv6 address to be translated
+ * @param mac_addr MAC address of the neighbor to probe it directly or
+ *                 NULL to send the solicitation to solicited-node
+ *                 multicast address
  *
- * @return EOK on success
- * @return ENOENT when NDP translation failed
+ * @return EOK on success or an error code
  *
  */
-errno_t ndp_translate(addr128_t src_addr, addr128_t ip_addr, addr48_t mac_addr,
-    inet_link_t *ilink)
+errno_t ndp_solicit(inet_link_t *ilink, addr128_t src_addr, addr128_t ip_addr,
+    addr48_t mac_addr)
 {
-	if (!ilink->mac_valid) {
-		/* The link does not support NDP */
-		memset(mac_addr, 0, 6);
-		return EOK;
-	}
-
-	errno_t rc = ntrans_lookup(ip_addr, mac_addr);
-	if (rc == EOK)
-		return EOK;
-
 	ndp_packet_t packet;
 
 	packet.opcode = ICMPV6_NEIGHBOUR_SOLICITATION;
 	addr48(ilink->mac, packet.sender_hw_addr);
 	addr128(src_addr, packet.sender_proto_addr);
 	addr128(ip_addr, packet.solicited_ip);
-	addr48_solicited_node(ip_addr, packet.target_hw_addr);
-	ndp_solicited_node_ip(ip_addr, packet.target_proto_addr);
 
-	rc = ndp_send_packet(ilink, &packet);
-	if (rc != EOK)
-		return rc;
+	if (mac_addr != NULL) {
+		addr48(mac_addr, packet.target_hw_addr);
+		addr128(ip_addr, packet.target_proto_addr);
+	} else {
+		addr48_solicited_node(ip_addr, packet.target_hw_addr);
+		ndp_solicited_node_ip(ip_addr, packet.target_proto_addr);
+	}
+
+	return ndp_send_packet(ilink, &packet);
+}
 
-	(void) ntrans_wait_timeout(NDP_REQUEST_TIMEOUT);
+/** Send datagram to local destination IPv6 address
+ *
+ * If the destination MAC address is not known yet, the datagram is
+ * queued and sent once the neighbor advertisement arrives.
+ *
+ * @param ilink    Network interface
+ * @param src_addr Source IPv6 address
+ * @param ip_addr  Local destination IPv6 address
+ * @param dgram    Datagram
+ * @param proto    Protocol
+ * @param ttl      Time to live
+ * @param df       Do not fragment
+ *
+ * @return EOK on success or an error code
+ *
+ */
+errno_t ndp_send_dgram(inet_link_t *ilink, addr128_t src_addr,
+    addr128_t ip_addr, inet_dgram_t *dgram, uint8_t proto, uint8_t ttl,
+    int df)
+{
+	addr48_t mac_addr;
+
+	if (!ilink->mac_valid) {
+		/* The link does not support NDP */
+		memset(mac_addr, 0, 6);
+		return inet_link_send_dgram6(ilink, mac_addr, dgram, proto,
+		    ttl, df);
+	}
+
+	if (ntrans_lookup(ip_addr, mac_addr) == EOK) {
+		return inet_link_send_dgram6(ilink, mac_addr, dgram, proto,
+		    ttl, df);
+	}
 
-	return ntrans_lookup(ip_addr, mac_addr);
+	return ntrans_enqueue(ilink, src_addr, ip_addr, dgram, proto, ttl, df);
 }
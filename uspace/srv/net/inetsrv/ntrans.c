@@ -34,17 +34,114 @@
  * @brief
  */
 
+#include <adt/hash_table.h>
 #include <adt/list.h>
 #include <errno.h>
 #include <fibril_synch.h>
 #include <inet/iplink_srv.h>
+#include <io/log.h>
+#include <mem.h>
 #include <stdlib.h>
+#include <sys/time.h>
+#include "inet_link.h"
+#include "ndp.h"
 #include "ntrans.h"
 
-/** Address translation list (of inet_ntrans_t) */
+/** Interval of translation table maintenance in microseconds */
+#define NTRANS_TICK (1000 * 1000)
+
+/** Time translation stays reachable after confirmation in microseconds */
+#define NTRANS_REACHABLE_TIME (30 * 1000 * 1000)
+
+/** Time before expiry when refresh of used translation starts */
+#define NTRANS_REFRESH_TIME (5 * 1000 * 1000)
+
+/** Time after which stale translation is removed if not used */
+#define NTRANS_STALE_TIME (60 * 1000 * 1000)
+
+/** Time to wait for neighbor advertisement before retrying */
+#define NTRANS_RETRANS_TIME (1000 * 1000)
+
+/** Maximum number of neighbor solicitations sent before giving up */
+#define NTRANS_MAX_SOLICIT 3
+
+/** Maximum number of datagrams queued per unresolved neighbor */
+#define NTRANS_MAX_DGRAMS 4
+
+/** Address translation table (of inet_ntrans_t) */
 static FIBRIL_MUTEX_INITIALIZE(ntrans_list_lock);
-static LIST_INITIALIZE(ntrans_list);
-static FIBRIL_CONDVAR_INITIALIZE(ntrans_cv);
+static hash_table_t ntrans_table;
+static fibril_timer_t *ntrans_timer;
+static bool ntrans_timer_active;
+
+static void ntrans_timer_func(void *);
+
+static size_t ntrans_addr_hash(const addr128_t ip_addr)
+{
+	size_t hash = 0;
+	size_t i;
+
+	for (i = 0; i < 16; i++)
+		hash = hash * 31 + ip_addr[i];
+
+	return hash;
+}
+
+static size_t ntrans_hash(const ht_link_t *item)
+{
+	inet_ntrans_t *ntrans = hash_table_get_inst(item, inet_ntrans_t,
+	    ntrans_link);
+	return ntrans_addr_hash(ntrans->ip_addr);
+}
+
+static size_t ntrans_key_hash(void *key)
+{
+	return ntrans_addr_hash((uint8_t *) key);
+}
+
+static bool ntrans_equal(const ht_link_t *item1, const ht_link_t *item2)
+{
+	inet_ntrans_t *ntrans1 = hash_table_get_inst(item1, inet_ntrans_t,
+	    ntrans_link);
+	inet_ntrans_t *ntrans2 = hash_table_get_inst(item2, inet_ntrans_t,
+	    ntrans_link);
+	return addr128_compare(ntrans1->ip_addr, ntrans2->ip_addr);
+}
+
+static bool ntrans_key_equal(void *key, const ht_link_t *item)
+{
+	inet_ntrans_t *ntrans = hash_table_get_inst(item, inet_ntrans_t,
+	    ntrans_link);
+	return addr128_compare(ntrans->ip_addr, (uint8_t *) key);
+}
+
+static hash_table_ops_t ntrans_hash_ops = {
+	.hash = ntrans_hash,
+	.key_hash = ntrans_key_hash,
+	.equal = ntrans_equal,
+	.key_equal = ntrans_key_equal,
+	.remove_callback = NULL
+};
+
+/** Initialize translation table
+ *
+ * @return EOK on success
+ * @return ENOMEM if not enough memory
+ *
+ */
+errno_t ntrans_init(void)
+{
+	if (!hash_table_create(&ntrans_table, 0, 0, &ntrans_hash_ops))
+		return ENOMEM;
+
+	ntrans_timer = fibril_timer_create(&ntrans_list_lock);
+	if (ntrans_timer == NULL) {
+		hash_table_destroy(&ntrans_table);
+		return ENOMEM;
+	}
+
+	return EOK;
+}
 
 /** Look for address in translation table
  *
@@ -55,46 +152,165 @@ static FIBRIL_CONDVAR_INITIALIZE(ntrans_cv);
  */
 static inet_ntrans_t *ntrans_find(addr128_t ip_addr)
 {
-	list_foreach(ntrans_list, ntrans_list, inet_ntrans_t, ntrans) {
-		if (addr128_compare(ntrans->ip_addr, ip_addr))
-			return ntrans;
-	}
+	ht_link_t *link;
+
+	link = hash_table_find(&ntrans_table, ip_addr);
+	if (link == NULL)
+		return NULL;
 
-	return NULL;
+	return hash_table_get_inst(link, inet_ntrans_t, ntrans_link);
 }
 
-/** Add entry to translation table
+/** Create entry and insert it into translation table
  *
+ * @param ilink    Link used for sending solicitations
+ * @param src_addr Source address used for sending solicitations
  * @param ip_addr  IPv6 address of the new entry
- * @param mac_addr MAC address of the new entry
  *
- * @return EOK on success
- * @return ENOMEM if not enough memory
+ * @return New entry on success
+ * @return NULL if not enough memory
  *
  */
-errno_t ntrans_add(addr128_t ip_addr, addr48_t mac_addr)
+static inet_ntrans_t *ntrans_create_locked(inet_link_t *ilink,
+    addr128_t src_addr, addr128_t ip_addr)
 {
 	inet_ntrans_t *ntrans;
-	inet_ntrans_t *prev;
+
+	assert(fibril_mutex_is_locked(&ntrans_list_lock));
 
 	ntrans = calloc(1, sizeof(inet_ntrans_t));
 	if (ntrans == NULL)
-		return ENOMEM;
+		return NULL;
 
 	addr128(ip_addr, ntrans->ip_addr);
-	addr48(mac_addr, ntrans->mac_addr);
+	addr128(src_addr, ntrans->src_addr);
+	ntrans->ilink = ilink;
+	ntrans->state = nts_incomplete;
+	list_initialize(&ntrans->dgrams);
+
+	hash_table_insert(&ntrans_table, &ntrans->ntrans_link);
+
+	if (!ntrans_timer_active) {
+		fibril_timer_set_locked(ntrans_timer, NTRANS_TICK,
+		    ntrans_timer_func, NULL);
+		ntrans_timer_active = true;
+	}
+
+	return ntrans;
+}
+
+/** Destroy datagram waiting for translation
+ *
+ * @param qdgram Queued datagram
+ *
+ */
+static void ntrans_dgram_delete(inet_ntrans_dgram_t *qdgram)
+{
+	free(qdgram->dgram.data);
+	free(qdgram);
+}
+
+/** Remove entry from translation table and destroy it
+ *
+ * Datagrams waiting for the translation are discarded.
+ *
+ * @param ntrans Translation table entry
+ *
+ */
+static void ntrans_destroy_locked(inet_ntrans_t *ntrans)
+{
+	assert(fibril_mutex_is_locked(&ntrans_list_lock));
+
+	hash_table_remove_item(&ntrans_table, &ntrans->ntrans_link);
+
+	list_foreach_safe(ntrans->dgrams, cur, next) {
+		inet_ntrans_dgram_t *qdgram = list_get_instance(cur,
+		    inet_ntrans_dgram_t, link);
+		list_remove(&qdgram->link);
+		ntrans_dgram_delete(qdgram);
+	}
+
+	free(ntrans);
+}
+
+/** Set time of next state transition of translation table entry
+ *
+ * @param ntrans Translation table entry
+ * @param delay  Time from now in microseconds
+ *
+ */
+static void ntrans_set_deadline(inet_ntrans_t *ntrans, suseconds_t delay)
+{
+	getuptime(&ntrans->deadline);
+	tv_add_diff(&ntrans->deadline, delay);
+}
+
+/** Send datagrams waiting for translation
+ *
+ * @param ilink    Network interface
+ * @param dgrams   List of inet_ntrans_dgram_t, emptied
+ * @param mac_addr Destination MAC address
+ *
+ */
+static void ntrans_send_dgrams(inet_link_t *ilink, list_t *dgrams,
+    addr48_t mac_addr)
+{
+	list_foreach_safe(*dgrams, cur, next) {
+		inet_ntrans_dgram_t *qdgram = list_get_instance(cur,
+		    inet_ntrans_dgram_t, link);
+
+		(void) inet_link_send_dgram6(ilink, mac_addr, &qdgram->dgram,
+		    qdgram->proto, qdgram->ttl, qdgram->df);
+
+		list_remove(&qdgram->link);
+		ntrans_dgram_delete(qdgram);
+	}
+}
+
+/** Add or confirm entry in translation table
+ *
+ * The entry becomes reachable and datagrams waiting for it are sent.
+ *
+ * @param ilink    Network interface the translation was received on
+ * @param src_addr Local IPv6 address
+ * @param ip_addr  IPv6 address of the entry
+ * @param mac_addr MAC address of the entry
+ *
+ * @return EOK on success
+ * @return ENOMEM if not enough memory
+ *
+ */
+errno_t ntrans_add(inet_link_t *ilink, addr128_t src_addr, addr128_t ip_addr,
+    addr48_t mac_addr)
+{
+	inet_ntrans_t *ntrans;
+	list_t dgrams;
+
+	list_initialize(&dgrams);
 
 	fibril_mutex_lock(&ntrans_list_lock);
-	prev = ntrans_find(ip_addr);
-	if (prev != NULL) {
-		list_remove(&prev->ntrans_list);
-		free(prev);
+	ntrans = ntrans_find(ip_addr);
+	if (ntrans == NULL) {
+		ntrans = ntrans_create_locked(ilink, src_addr, ip_addr);
+		if (ntrans == NULL) {
+			fibril_mutex_unlock(&ntrans_list_lock);
+			return ENOMEM;
+		}
 	}
 
-	list_append(&ntrans->ntrans_list, &ntrans_list);
+	addr48(mac_addr, ntrans->mac_addr);
+	ntrans->state = nts_reachable;
+	ntrans->nsolicit = 0;
+	ntrans->used = false;
+	ntrans_set_deadline(ntrans, NTRANS_REACHABLE_TIME -
+	    NTRANS_REFRESH_TIME);
+
+	list_concat(&dgrams, &ntrans->dgrams);
+	ntrans->ndgrams = 0;
+	ilink = ntrans->ilink;
 	fibril_mutex_unlock(&ntrans_list_lock);
-	fibril_condvar_broadcast(&ntrans_cv);
 
+	ntrans_send_dgrams(ilink, &dgrams, mac_addr);
 	return EOK;
 }
 
@@ -117,14 +333,15 @@ errno_t ntrans_remove(addr128_t ip_addr)
 		return ENOENT;
 	}
 
-	list_remove(&ntrans->ntrans_list);
+	ntrans_destroy_locked(ntrans);
 	fibril_mutex_unlock(&ntrans_list_lock);
-	free(ntrans);
 
 	return EOK;
 }
 
 /** Translate IPv6 address to MAC address using the translation table
+ *
+ * Stale entry can still be used, but it will be re-confirmed.
  *
  * @param ip_addr  IPv6 address to be translated
  * @param mac_addr MAC address to be assigned
@@ -135,34 +352,189 @@ errno_t ntrans_remove(addr128_t ip_addr)
  */
 errno_t ntrans_lookup(addr128_t ip_addr, addr48_t mac_addr)
 {
+	inet_ntrans_t *ntrans;
+
 	fibril_mutex_lock(&ntrans_list_lock);
-	inet_ntrans_t *ntrans = ntrans_find(ip_addr);
-	if (ntrans == NULL) {
+	ntrans = ntrans_find(ip_addr);
+	if (ntrans == NULL || ntrans->state == nts_incomplete) {
 		fibril_mutex_unlock(&ntrans_list_lock);
 		return ENOENT;
 	}
 
-	fibril_mutex_unlock(&ntrans_list_lock);
+	if (ntrans->state == nts_stale) {
+		/* Probe at next tick */
+		ntrans->state = nts_probe;
+		ntrans->nsolicit = 0;
+		ntrans_set_deadline(ntrans, 0);
+	}
+
+	ntrans->used = true;
 	addr48(ntrans->mac_addr, mac_addr);
+	fibril_mutex_unlock(&ntrans_list_lock);
+
 	return EOK;
 }
 
-/** Wait on translation table CV for some time
+/** Queue datagram until translation is known
  *
- * @param timeout Timeout in microseconds
+ * If translation is not in progress yet, neighbor solicitation is sent.
+ * If too many datagrams are waiting for the translation, the oldest one
+ * is discarded.
  *
- * @return EOK if woken up by another fibril
- * @return ETIMEOUT if timed out
+ * @param ilink    Network interface
+ * @param src_addr Source IPv6 address
+ * @param ip_addr  Local destination IPv6 address
+ * @param dgram    Datagram
+ * @param proto    Protocol
+ * @param ttl      Time to live
+ * @param df       Do not fragment
+ *
+ * @return EOK on success
+ * @return ENOMEM if not enough memory
  *
  */
-errno_t ntrans_wait_timeout(suseconds_t timeout)
+errno_t ntrans_enqueue(inet_link_t *ilink, addr128_t src_addr,
+    addr128_t ip_addr, inet_dgram_t *dgram, uint8_t proto, uint8_t ttl,
+    int df)
 {
+	inet_ntrans_t *ntrans;
+	inet_ntrans_dgram_t *qdgram;
+	addr48_t mac_addr;
+	bool send_solicit;
+	errno_t rc;
+
+	qdgram = calloc(1, sizeof(inet_ntrans_dgram_t));
+	if (qdgram == NULL)
+		return ENOMEM;
+
+	qdgram->dgram = *dgram;
+	qdgram->dgram.data = malloc(dgram->size);
+	if (qdgram->dgram.data == NULL) {
+		free(qdgram);
+		return ENOMEM;
+	}
+
+	memcpy(qdgram->dgram.data, dgram->data, dgram->size);
+	qdgram->proto = proto;
+	qdgram->ttl = ttl;
+	qdgram->df = df;
+
 	fibril_mutex_lock(&ntrans_list_lock);
-	errno_t rc = fibril_condvar_wait_timeout(&ntrans_cv, &ntrans_list_lock,
-	    timeout);
+
+	ntrans = ntrans_find(ip_addr);
+	if (ntrans != NULL && ntrans->state != nts_incomplete) {
+		/* Translation arrived in the meantime */
+		ntrans->used = true;
+		addr48(ntrans->mac_addr, mac_addr);
+		fibril_mutex_unlock(&ntrans_list_lock);
+
+		rc = inet_link_send_dgram6(ilink, mac_addr, &qdgram->dgram,
+		    proto, ttl, df);
+		ntrans_dgram_delete(qdgram);
+		return rc;
+	}
+
+	send_solicit = false;
+	if (ntrans == NULL) {
+		ntrans = ntrans_create_locked(ilink, src_addr, ip_addr);
+		if (ntrans == NULL) {
+			fibril_mutex_unlock(&ntrans_list_lock);
+			ntrans_dgram_delete(qdgram);
+			return ENOMEM;
+		}
+
+		ntrans->nsolicit = 1;
+		ntrans_set_deadline(ntrans, NTRANS_RETRANS_TIME);
+		send_solicit = true;
+	}
+
+	list_append(&qdgram->link, &ntrans->dgrams);
+	if (++ntrans->ndgrams > NTRANS_MAX_DGRAMS) {
+		qdgram = list_get_instance(list_first(&ntrans->dgrams),
+		    inet_ntrans_dgram_t, link);
+		list_remove(&qdgram->link);
+		ntrans_dgram_delete(qdgram);
+		--ntrans->ndgrams;
+	}
+
 	fibril_mutex_unlock(&ntrans_list_lock);
 
-	return rc;
+	if (send_solicit)
+		return ndp_solicit(ilink, src_addr, ip_addr, NULL);
+
+	return EOK;
+}
+
+/** Advance state of translation table entry when its deadline has passed
+ *
+ * @param link Hash table link
+ * @param arg  Current time (struct timeval *)
+ *
+ * @return true to continue walking the table
+ *
+ */
+static bool ntrans_age(ht_link_t *link, void *arg)
+{
+	inet_ntrans_t *ntrans = hash_table_get_inst(link, inet_ntrans_t,
+	    ntrans_link);
+	struct timeval *now = (struct timeval *) arg;
+
+	if (!tv_gteq(now, &ntrans->deadline))
+		return true;
+
+	switch (ntrans->state) {
+	case nts_reachable:
+		if (!ntrans->used) {
+			ntrans->state = nts_stale;
+			ntrans_set_deadline(ntrans, NTRANS_STALE_TIME);
+			break;
+		}
+
+		/* Entry is in use, refresh it before it expires */
+		ntrans->state = nts_probe;
+		ntrans->nsolicit = 0;
+		/* Fallthrough */
+	case nts_probe:
+	case nts_incomplete:
+		if (ntrans->nsolicit >= NTRANS_MAX_SOLICIT) {
+			log_msg(LOG_DEFAULT, LVL_DEBUG, "No neighbor "
+			    "advertisement received.");
+			ntrans_destroy_locked(ntrans);
+			break;
+		}
+
+		/* Known neighbor is probed using unicast solicitation */
+		(void) ndp_solicit(ntrans->ilink, ntrans->src_addr,
+		    ntrans->ip_addr, ntrans->state == nts_probe ?
+		    ntrans->mac_addr : NULL);
+		++ntrans->nsolicit;
+		ntrans_set_deadline(ntrans, NTRANS_RETRANS_TIME);
+		break;
+	case nts_stale:
+		ntrans_destroy_locked(ntrans);
+		break;
+	}
+
+	return true;
+}
+
+static void ntrans_timer_func(void *arg)
+{
+	struct timeval now;
+
+	fibril_mutex_lock(&ntrans_list_lock);
+
+	getuptime(&now);
+	hash_table_apply(&ntrans_table, ntrans_age, &now);
+
+	if (!hash_table_empty(&ntrans_table)) {
+		fibril_timer_set_locked(ntrans_timer, NTRANS_TICK,
+		    ntrans_timer_func, NULL);
+	} else {
+		ntrans_timer_active = false;
+	}
+
+	fibril_mutex_unlock(&ntrans_list_lock);
 }
 
 /** @}
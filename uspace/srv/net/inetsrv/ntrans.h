@@ -37,20 +37,62 @@
 #ifndef NTRANS_H_
 #define NTRANS_H_
 
+#include <adt/hash_table.h>
+#include <adt/list.h>
 #include <inet/iplink_srv.h>
 #include <inet/addr.h>
+#include <sys/time.h>
+#include "inetsrv.h"
+
+/** Neighbor state */
+typedef enum {
+	/** Neighbor solicitation sent, no advertisement yet */
+	nts_incomplete,
+	/** Neighbor recently confirmed */
+	nts_reachable,
+	/** Neighbor not confirmed for some time */
+	nts_stale,
+	/** Translation usable, neighbor solicitation sent to re-confirm it */
+	nts_probe
+} inet_ntrans_state_t;
+
+/** Datagram waiting for address translation */
+typedef struct {
+	link_t link;
+	inet_dgram_t dgram;
+	uint8_t proto;
+	uint8_t ttl;
+	int df;
+} inet_ntrans_dgram_t;
 
 /** Address translation table element */
 typedef struct {
-	link_t ntrans_list;
+	ht_link_t ntrans_link;
 	addr128_t ip_addr;
 	addr48_t mac_addr;
+	inet_ntrans_state_t state;
+	/** Link used for sending solicitations */
+	inet_link_t *ilink;
+	/** Source address used for sending solicitations */
+	addr128_t src_addr;
+	/** Time of next state transition */
+	struct timeval deadline;
+	/** Number of solicitations sent in current state */
+	unsigned nsolicit;
+	/** Translation has been used since it was last confirmed */
+	bool used;
+	/** Datagrams waiting for the translation (of inet_ntrans_dgram_t) */
+	list_t dgrams;
+	/** Number of datagrams in @c dgrams */
+	size_t ndgrams;
 } inet_ntrans_t;
 
-extern errno_t ntrans_add(addr128_t, addr48_t);
+extern errno_t ntrans_init(void);
+extern errno_t ntrans_add(inet_link_t *, addr128_t, addr128_t, addr48_t);
 extern errno_t ntrans_remove(addr128_t);
 extern errno_t ntrans_lookup(addr128_t, addr48_t);
-extern errno_t ntrans_wait_timeout(suseconds_t);
+extern errno_t ntrans_enqueue(inet_link_t *, addr128_t, addr128_t,
+    inet_dgram_t *, uint8_t, uint8_t, int);
 
 #endif
 
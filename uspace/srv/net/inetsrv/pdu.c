@@ -39,6 +39,7 @@
 #include <byteorder.h>
 #include <errno.h>
 #include <fibril_synch.h>
+#include <inet/checksum.h>
 #include <io/log.h>
 #include <macros.h>
 #include <mem.h>
@@ -47,42 +48,6 @@
 #include "inet_std.h"
 #include "pdu.h"
 
-/** One's complement addition.
- *
- * Result is a + b + carry.
- */
-static uint16_t inet_ocadd16(uint16_t a, uint16_t b)
-{
-	uint32_t s;
-
-	s = (uint32_t)a + (uint32_t)b;
-	return (s & 0xffff) + (s >> 16);
-}
-
-uint16_t inet_checksum_calc(uint16_t ivalue, void *data, size_t size)
-{
-	uint16_t sum;
-	uint16_t w;
-	size_t words, i;
-	uint8_t *bdata;
-
-	sum = ~ivalue;
-	words = size / 2;
-	bdata = (uint8_t *)data;
-
-	for (i = 0; i < words; i++) {
-		w = ((uint16_t)bdata[2 * i] << 8) | bdata[2 * i + 1];
-		sum = inet_ocadd16(sum, w);
-	}
-
-	if (size % 2 != 0) {
-		w = ((uint16_t)bdata[2 * words] << 8);
-		sum = inet_ocadd16(sum, w);
-	}
-
-	return ~sum;
-}
-
 /** Encode IPv4 PDU.
  *
  * Encode internet packet into PDU (serialized form). Will encode a
@@ -473,6 +438,46 @@ errno_t inet_pdu_decode6(void *data, size_t size, service_id_t link_id,
  * @return EOK on success
  *
  */
+/** Complete partial TCP or UDP checksum.
+ *
+ * The checksum field of the transport PDU holds the ones' complement sum
+ * of the pseudo-header (see INET_CSUM_PARTIAL). Summing the whole PDU
+ * then yields the final checksum.
+ *
+ * @param proto Transport protocol
+ * @param data  Transport PDU
+ * @param size  Size of @a data in bytes
+ */
+void inet_pdu_csum_complete(uint8_t proto, void *data, size_t size)
+{
+	uint8_t *cs_field;
+	uint16_t cs;
+
+	switch (proto) {
+	case IP_PROTO_TCP:
+		if (size < TCP_CHECKSUM_OFFS + sizeof(uint16_t))
+			return;
+		cs_field = (uint8_t *) data + TCP_CHECKSUM_OFFS;
+		break;
+	case IP_PROTO_UDP:
+		if (size < UDP_CHECKSUM_OFFS + sizeof(uint16_t))
+			return;
+		cs_field = (uint8_t *) data + UDP_CHECKSUM_OFFS;
+		break;
+	default:
+		return;
+	}
+
+	cs = inet_checksum_calc(INET_CHECKSUM_INIT, data, size);
+
+	/* Zero means no checksum in UDP */
+	if (proto == IP_PROTO_UDP && cs == 0)
+		cs = 0xffff;
+
+	cs_field[0] = cs >> 8;
+	cs_field[1] = cs & 0xff;
+}
+
 errno_t ndp_pdu_encode(ndp_packet_t *ndp, inet_dgram_t *dgram)
 {
 	inet_addr_set6(ndp->sender_proto_addr, &dgram->src);
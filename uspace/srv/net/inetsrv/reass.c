@@ -34,51 +34,189 @@
  * @brief Datagram reassembly.
  */
 
+#include <adt/hash.h>
+#include <adt/hash_table.h>
 #include <errno.h>
 #include <fibril_synch.h>
 #include <io/log.h>
 #include <macros.h>
 #include <mem.h>
 #include <stdlib.h>
+#include <sys/time.h>
 
 #include "inetsrv.h"
 #include "inet_std.h"
 #include "reass.h"
 
-/** Datagram being reassembled.
+/** Maximum memory used by all datagrams being reassembled */
+#define REASS_MEM_MAX (1024 * 1024)
+
+/** Time after which incomplete datagram is discarded in microseconds */
+#define REASS_TIMEOUT (30 * 1000 * 1000)
+
+/** Initial size of reassembly buffer */
+#define REASS_BUF_SIZE_INIT 2048
+
+/** Upper bound on datagram size given by the fragment offset field */
+#define REASS_DGRAM_SIZE_MAX \
+	(FRAG_OFFS_UNIT * (1 << (FF_FRAGOFF_h - FF_FRAGOFF_l + 1)))
+
+/** Datagram identification.
  *
- * Uniquely identified by (source address, destination address, protocol,
- * identification) per RFC 791 sec. 2.3 / Fragmentation.
+ * Datagram is uniquely identified by (source address, destination address,
+ * protocol, identification) per RFC 791 sec. 2.3 / Fragmentation.
  */
 typedef struct {
-	link_t map_link;
-	/** List of fragments, @c reass_frag_t */
-	list_t frags;
-} reass_dgram_t;
+	inet_addr_t src;
+	inet_addr_t dest;
+	uint8_t proto;
+	uint32_t ident;
+} reass_key_t;
 
-/** One datagram fragment */
+/** Contiguous range of datagram data received so far */
 typedef struct {
 	link_t dgram_link;
-	inet_packet_t packet;
-} reass_frag_t;
+	/** Start offset */
+	size_t b;
+	/** End offset */
+	size_t e;
+} reass_range_t;
 
-/** Datagram map, list of reass_dgram_t */
-static LIST_INITIALIZE(reass_dgram_map);
+/** Datagram being reassembled. */
+typedef struct {
+	/** Link to @c reass_dgram_map */
+	ht_link_t map_link;
+	/** Link to @c reass_lru */
+	link_t lru_link;
+	/** Datagram identification */
+	reass_key_t key;
+	/** Link the first received fragment came from */
+	service_id_t link_id;
+	/** Type of service */
+	uint8_t tos;
+	/** Reassembly buffer, fragment data is copied to its final place */
+	uint8_t *buf;
+	/** Size of reassembly buffer */
+	size_t buf_size;
+	/** Datagram size is known (last fragment has been received) */
+	bool size_known;
+	/** Datagram size */
+	size_t dgram_size;
+	/** Received data, sorted disjoint list of @c reass_range_t */
+	list_t ranges;
+	/** Time when the datagram is discarded unless more fragments arrive */
+	struct timeval expires;
+} reass_dgram_t;
+
+/** Datagram map of reass_dgram_t */
+static hash_table_t reass_dgram_map;
+/** List of reass_dgram_t, least recently updated first */
+static LIST_INITIALIZE(reass_lru);
+/** Memory used by datagrams being reassembled */
+static size_t reass_mem;
 /** Protects access to @c reass_dgram_map */
 static FIBRIL_MUTEX_INITIALIZE(reass_dgram_map_lock);
 
-static reass_dgram_t *reass_dgram_new(void);
+static reass_dgram_t *reass_dgram_new(inet_packet_t *);
 static reass_dgram_t *reass_dgram_get(inet_packet_t *);
 static errno_t reass_dgram_insert_frag(reass_dgram_t *, inet_packet_t *);
 static bool reass_dgram_complete(reass_dgram_t *);
 static void reass_dgram_remove(reass_dgram_t *);
 static errno_t reass_dgram_deliver(reass_dgram_t *);
 static void reass_dgram_destroy(reass_dgram_t *);
+static void reass_expire(void);
+static void reass_evict(void);
+
+static size_t reass_addr_hash(const inet_addr_t *addr)
+{
+	size_t hash = addr->version;
+	size_t i;
+
+	switch (addr->version) {
+	case ip_v4:
+		hash = hash_combine(hash, addr->addr);
+		break;
+	case ip_v6:
+		for (i = 0; i < sizeof(addr128_t); i++)
+			hash = hash_combine(hash, addr->addr6[i]);
+		break;
+	default:
+		break;
+	}
+
+	return hash;
+}
+
+static size_t reass_key_hash_fn(const reass_key_t *key)
+{
+	size_t hash;
+
+	hash = hash_combine(reass_addr_hash(&key->src),
+	    reass_addr_hash(&key->dest));
+	hash = hash_combine(hash, key->proto);
+	return hash_combine(hash, key->ident);
+}
+
+static bool reass_key_equal_fn(const reass_key_t *a, const reass_key_t *b)
+{
+	return inet_addr_compare(&a->src, &b->src) &&
+	    inet_addr_compare(&a->dest, &b->dest) &&
+	    a->proto == b->proto && a->ident == b->ident;
+}
+
+static size_t reass_map_hash(const ht_link_t *item)
+{
+	reass_dgram_t *rdg = hash_table_get_inst(item, reass_dgram_t,
+	    map_link);
+	return reass_key_hash_fn(&rdg->key);
+}
+
+static size_t reass_map_key_hash(void *key)
+{
+	return reass_key_hash_fn((reass_key_t *) key);
+}
+
+static bool reass_map_equal(const ht_link_t *item1, const ht_link_t *item2)
+{
+	reass_dgram_t *rdg1 = hash_table_get_inst(item1, reass_dgram_t,
+	    map_link);
+	reass_dgram_t *rdg2 = hash_table_get_inst(item2, reass_dgram_t,
+	    map_link);
+	return reass_key_equal_fn(&rdg1->key, &rdg2->key);
+}
+
+static bool reass_map_key_equal(void *key, const ht_link_t *item)
+{
+	reass_dgram_t *rdg = hash_table_get_inst(item, reass_dgram_t,
+	    map_link);
+	return reass_key_equal_fn((reass_key_t *) key, &rdg->key);
+}
+
+static hash_table_ops_t reass_map_ops = {
+	.hash = reass_map_hash,
+	.key_hash = reass_map_key_hash,
+	.equal = reass_map_equal,
+	.key_equal = reass_map_key_equal,
+	.remove_callback = NULL
+};
+
+/** Initialize datagram reassembly.
+ *
+ * @return		EOK on success or ENOMEM.
+ */
+errno_t inet_reass_init(void)
+{
+	if (!hash_table_create(&reass_dgram_map, 0, 0, &reass_map_ops))
+		return ENOMEM;
+
+	return EOK;
+}
 
 /** Queue packet for datagram reassembly.
  *
  * @param packet	Packet
- * @return		EOK on success or ENOMEM.
+ * @return		EOK on success, ENOMEM if out of memory, ELIMIT
+ *			or EINVAL if the fragment is not valid
  */
 errno_t inet_reass_queue_packet(inet_packet_t *packet)
 {
@@ -87,8 +225,14 @@ errno_t inet_reass_queue_packet(inet_packet_t *packet)
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "inet_reass_queue_packet()");
 
+	/* Verify that total size of datagram is within reasonable bounds */
+	if (packet->offs + packet->size > REASS_DGRAM_SIZE_MAX)
+		return ELIMIT;
+
 	fibril_mutex_lock(&reass_dgram_map_lock);
 
+	reass_expire();
+
 	/* Get existing or new datagram */
 	rdg = reass_dgram_get(packet);
 	if (rdg == NULL) {
@@ -100,8 +244,14 @@ errno_t inet_reass_queue_packet(inet_packet_t *packet)
 
 	/* Insert fragment into the datagram */
 	rc = reass_dgram_insert_frag(rdg, packet);
-	if (rc != EOK)
-		return ENOMEM;
+	if (rc != EOK) {
+		log_msg(LOG_DEFAULT, LVL_DEBUG, "Fragment rejected, "
+		    "datagram dropped.");
+		reass_dgram_remove(rdg);
+		fibril_mutex_unlock(&reass_dgram_map_lock);
+		reass_dgram_destroy(rdg);
+		return rc;
+	}
 
 	/* Check if datagram is complete */
 	if (reass_dgram_complete(rdg)) {
@@ -115,6 +265,14 @@ errno_t inet_reass_queue_packet(inet_packet_t *packet)
 		return rc;
 	}
 
+	/* Most recently updated datagram goes last */
+	getuptime(&rdg->expires);
+	tv_add_diff(&rdg->expires, REASS_TIMEOUT);
+	list_remove(&rdg->lru_link);
+	list_append(&rdg->lru_link, &reass_lru);
+
+	reass_evict();
+
 	fibril_mutex_unlock(&reass_dgram_map_lock);
 	return EOK;
 }
@@ -126,108 +284,193 @@ errno_t inet_reass_queue_packet(inet_packet_t *packet)
  */
 static reass_dgram_t *reass_dgram_get(inet_packet_t *packet)
 {
-	assert(fibril_mutex_is_locked(&reass_dgram_map_lock));
+	reass_key_t key;
+	ht_link_t *link;
 
-	list_foreach(reass_dgram_map, map_link, reass_dgram_t, rdg) {
-		link_t *f1_link = list_first(&rdg->frags);
-		assert(f1_link != NULL);
+	assert(fibril_mutex_is_locked(&reass_dgram_map_lock));
 
-		reass_frag_t *f1 = list_get_instance(f1_link, reass_frag_t,
-		    dgram_link);
+	key.src = packet->src;
+	key.dest = packet->dest;
+	key.proto = packet->proto;
+	key.ident = packet->ident;
 
-		if ((inet_addr_compare(&f1->packet.src, &packet->src)) &&
-		    (inet_addr_compare(&f1->packet.dest, &packet->dest)) &&
-		    (f1->packet.proto == packet->proto) &&
-		    (f1->packet.ident == packet->ident)) {
-			/* Match */
-			return rdg;
-		}
-	}
+	link = hash_table_find(&reass_dgram_map, &key);
+	if (link != NULL)
+		return hash_table_get_inst(link, reass_dgram_t, map_link);
 
 	/* No existing reassembly structure. Create a new one. */
-	return reass_dgram_new();
+	return reass_dgram_new(packet);
 }
 
 /** Create new datagram reassembly structure.
  *
+ * @param packet	First received fragment of the datagram
  * @return New datagram reassembly structure.
  */
-static reass_dgram_t *reass_dgram_new(void)
+static reass_dgram_t *reass_dgram_new(inet_packet_t *packet)
 {
 	reass_dgram_t *rdg;
 
+	assert(fibril_mutex_is_locked(&reass_dgram_map_lock));
+
 	rdg = calloc(1, sizeof(reass_dgram_t));
 	if (rdg == NULL)
 		return NULL;
 
-	list_append(&rdg->map_link, &reass_dgram_map);
-	list_initialize(&rdg->frags);
+	rdg->key.src = packet->src;
+	rdg->key.dest = packet->dest;
+	rdg->key.proto = packet->proto;
+	rdg->key.ident = packet->ident;
+	rdg->link_id = packet->link_id;
+	rdg->tos = packet->tos;
+	list_initialize(&rdg->ranges);
+
+	hash_table_insert(&reass_dgram_map, &rdg->map_link);
+	list_append(&rdg->lru_link, &reass_lru);
+	reass_mem += sizeof(reass_dgram_t);
 
 	return rdg;
 }
 
-static reass_frag_t *reass_frag_new(void)
+/** Record that range of datagram data has been received.
+ *
+ * @param rdg		Datagram reassembly structure
+ * @param b		Start offset
+ * @param e		End offset
+ * @return		EOK on success or ENOMEM
+ */
+static errno_t reass_dgram_add_range(reass_dgram_t *rdg, size_t b, size_t e)
 {
-	reass_frag_t *frag;
+	reass_range_t *range = NULL;
+	reass_range_t *nrange;
+	link_t *link;
 
-	frag = calloc(1, sizeof(reass_frag_t));
-	if (frag == NULL)
-		return NULL;
+	/* Find first range that ends at or after @a b */
+	link = list_first(&rdg->ranges);
+	while (link != NULL) {
+		range = list_get_instance(link, reass_range_t, dgram_link);
+		if (range->e >= b)
+			break;
 
-	link_initialize(&frag->dgram_link);
+		link = list_next(link, &rdg->ranges);
+	}
 
-	return frag;
-}
+	if (link == NULL || range->b > e) {
+		/* Disjoint with all ranges received so far */
+		nrange = calloc(1, sizeof(reass_range_t));
+		if (nrange == NULL)
+			return ENOMEM;
 
-static errno_t reass_dgram_insert_frag(reass_dgram_t *rdg, inet_packet_t *packet)
-{
-	reass_frag_t *frag;
-	void *data_copy;
-	link_t *link;
+		nrange->b = b;
+		nrange->e = e;
 
-	assert(fibril_mutex_is_locked(&reass_dgram_map_lock));
+		if (link != NULL)
+			list_insert_before(&nrange->dgram_link, link);
+		else
+			list_append(&nrange->dgram_link, &rdg->ranges);
 
-	frag = reass_frag_new();
+		return EOK;
+	}
 
-	/* Clone the packet */
+	/* Extend the range and merge it with the ranges it now touches */
+	range->b = min(range->b, b);
+	range->e = max(range->e, e);
 
-	data_copy = malloc(packet->size);
-	if (data_copy == NULL) {
-		free(frag);
-		return ENOMEM;
+	while ((link = list_next(&range->dgram_link, &rdg->ranges)) != NULL) {
+		nrange = list_get_instance(link, reass_range_t, dgram_link);
+		if (nrange->b > range->e)
+			break;
+
+		range->e = max(range->e, nrange->e);
+		list_remove(&nrange->dgram_link);
+		free(nrange);
+	}
+
+	return EOK;
+}
+
+/** Make sure reassembly buffer can hold data up to the specified offset.
+ *
+ * @param rdg		Datagram reassembly structure
+ * @param size		Required buffer size
+ * @return		EOK on success or ENOMEM
+ */
+static errno_t reass_dgram_buf_reserve(reass_dgram_t *rdg, size_t size)
+{
+	size_t nsize;
+	uint8_t *nbuf;
+
+	if (size <= rdg->buf_size)
+		return EOK;
+
+	if (rdg->size_known) {
+		nsize = rdg->dgram_size;
+	} else {
+		nsize = max(max(size, 2 * rdg->buf_size),
+		    (size_t) REASS_BUF_SIZE_INIT);
+		nsize = min(nsize, (size_t) REASS_DGRAM_SIZE_MAX);
 	}
 
-	memcpy(data_copy, packet->data, packet->size);
+	nbuf = realloc(rdg->buf, nsize);
+	if (nbuf == NULL)
+		return ENOMEM;
 
-	frag->packet = *packet;
-	frag->packet.data = data_copy;
+	reass_mem = reass_mem - rdg->buf_size + nsize;
+	rdg->buf = nbuf;
+	rdg->buf_size = nsize;
+	return EOK;
+}
 
-	/*
-	 * XXX Make resource-consuming attacks harder, eliminate any duplicate
-	 * data immediately. Possibly eliminate redundant packet headers.
-	 */
+/** Insert fragment into datagram.
+ *
+ * Fragment data is copied directly to its place in the reassembly buffer.
+ * Overlapping data simply overwrites data received earlier.
+ *
+ * @param rdg		Datagram reassembly structure
+ * @param packet	Fragment
+ * @return		EOK on success, ENOMEM if out of memory, EINVAL
+ *			if the fragment is not consistent with the datagram
+ */
+static errno_t reass_dgram_insert_frag(reass_dgram_t *rdg,
+    inet_packet_t *packet)
+{
+	size_t fend;
+	link_t *link;
+	reass_range_t *last;
+	errno_t rc;
 
-	/*
-	 * Insert into the list, which is sorted by offs member ascending.
-	 */
+	assert(fibril_mutex_is_locked(&reass_dgram_map_lock));
 
-	link = list_first(&rdg->frags);
-	while (link != NULL) {
-		reass_frag_t *qf = list_get_instance(link, reass_frag_t,
-		    dgram_link);
+	fend = packet->offs + packet->size;
 
-		if (qf->packet.offs >= packet->offs)
-			break;
+	if (!packet->mf) {
+		/* Last fragment determines datagram size */
+		if (rdg->size_known && rdg->dgram_size != fend)
+			return EINVAL;
+
+		link = list_last(&rdg->ranges);
+		if (link != NULL) {
+			last = list_get_instance(link, reass_range_t,
+			    dgram_link);
+			if (last->e > fend)
+				return EINVAL;
+		}
 
-		link = list_next(link, &rdg->frags);
+		rdg->size_known = true;
+		rdg->dgram_size = fend;
+	} else if (rdg->size_known && fend > rdg->dgram_size) {
+		return EINVAL;
 	}
 
-	if (link != NULL)
-		list_insert_after(&frag->dgram_link, link);
-	else
-		list_append(&frag->dgram_link, &rdg->frags);
+	if (packet->size == 0)
+		return EOK;
 
-	return EOK;
+	rc = reass_dgram_buf_reserve(rdg, fend);
+	if (rc != EOK)
+		return rc;
+
+	memcpy(rdg->buf + packet->offs, packet->data, packet->size);
+	return reass_dgram_add_range(rdg, packet->offs, fend);
 }
 
 /** Check if datagram is complete.
@@ -237,42 +480,25 @@ static errno_t reass_dgram_insert_frag(reass_dgram_t *rdg, inet_packet_t *packet
  */
 static bool reass_dgram_complete(reass_dgram_t *rdg)
 {
-	reass_frag_t *frag, *prev;
+	reass_range_t *range;
 	link_t *link;
 
 	assert(fibril_mutex_is_locked(&reass_dgram_map_lock));
-	assert(!list_empty(&rdg->frags));
-
-	link = list_first(&rdg->frags);
-	assert(link != NULL);
 
-	frag = list_get_instance(link, reass_frag_t,
-	    dgram_link);
-
-	/* First fragment must be at offset zero */
-	if (frag->packet.offs != 0)
+	if (!rdg->size_known)
 		return false;
 
-	prev = frag;
-
-	while (true) {
-		link = list_next(link, &rdg->frags);
-		if (link == NULL)
-			break;
-
-		/* Each next fragment must follow immediately or overlap */
-		frag = list_get_instance(link, reass_frag_t, dgram_link);
-		if (frag->packet.offs > prev->packet.offs + prev->packet.size)
-			return false;
-
-		/* No more fragments - datagram is complete */
-		if (!frag->packet.mf)
-			return true;
+	/* Empty datagram */
+	if (rdg->dgram_size == 0)
+		return true;
 
-		prev = frag;
-	}
+	/* All data must be covered by a single range */
+	link = list_first(&rdg->ranges);
+	if (link == NULL || link != list_last(&rdg->ranges))
+		return false;
 
-	return false;
+	range = list_get_instance(link, reass_range_t, dgram_link);
+	return range->b == 0 && range->e == rdg->dgram_size;
 }
 
 /** Remove datagram from reassembly map.
@@ -282,7 +508,10 @@ static bool reass_dgram_complete(reass_dgram_t *rdg)
 static void reass_dgram_remove(reass_dgram_t *rdg)
 {
 	assert(fibril_mutex_is_locked(&reass_dgram_map_lock));
-	list_remove(&rdg->map_link);
+
+	hash_table_remove_item(&reass_dgram_map, &rdg->map_link);
+	list_remove(&rdg->lru_link);
+	reass_mem -= sizeof(reass_dgram_t) + rdg->buf_size;
 }
 
 /** Deliver complete datagram.
@@ -291,91 +520,89 @@ static void reass_dgram_remove(reass_dgram_t *rdg)
  */
 static errno_t reass_dgram_deliver(reass_dgram_t *rdg)
 {
-	size_t dgram_size;
-	size_t fragoff_limit;
 	inet_dgram_t dgram;
-	uint8_t proto;
-	reass_frag_t *frag;
-	errno_t rc;
 
-	/*
-	 * Potentially there could be something beyond the first packet
-	 * that has !MF. Make sure we ignore that.
-	 */
-	frag = NULL;
-	list_foreach(rdg->frags, dgram_link, reass_frag_t, cfrag) {
-		if (!cfrag->packet.mf) {
-			frag = cfrag;
-			break;
-		}
-	}
-
-	assert(frag != NULL);
-	assert(!frag->packet.mf);
-
-	dgram_size = frag->packet.offs + frag->packet.size;
-
-	/* Upper bound for fragment offset field */
-	fragoff_limit = 1 << (FF_FRAGOFF_h - FF_FRAGOFF_l + 1);
-
-	/* Verify that total size of datagram is within reasonable bounds */
-	if (dgram_size > FRAG_OFFS_UNIT * fragoff_limit)
-		return ELIMIT;
+	/* XXX What if different fragments came from different link? */
+	dgram.iplink = rdg->link_id;
+	dgram.size = rdg->dgram_size;
+	dgram.src = rdg->key.src;
+	dgram.dest = rdg->key.dest;
+	dgram.tos = rdg->tos;
+	dgram.data = rdg->buf;
+
+	return inet_recv_dgram_local(&dgram, rdg->key.proto);
+}
 
-	dgram.data = calloc(dgram_size, 1);
-	if (dgram.data == NULL)
-		return ENOMEM;
+/** Destroy datagram reassembly structure.
+ *
+ * @param rdg		Datagram reassembly structure.
+ */
+static void reass_dgram_destroy(reass_dgram_t *rdg)
+{
+	while (!list_empty(&rdg->ranges)) {
+		link_t *rlink = list_first(&rdg->ranges);
+		reass_range_t *range = list_get_instance(rlink, reass_range_t,
+		    dgram_link);
 
-	/* XXX What if different fragments came from different link? */
-	dgram.iplink = frag->packet.link_id;
-	dgram.size = dgram_size;
-	dgram.src = frag->packet.src;
-	dgram.dest = frag->packet.dest;
-	dgram.tos = frag->packet.tos;
-	proto = frag->packet.proto;
+		list_remove(&range->dgram_link);
+		free(range);
+	}
 
-	/* Pull together data from individual fragments */
+	free(rdg->buf);
+	free(rdg);
+}
 
-	size_t doffs = 0;
+/** Discard datagrams that have not been completed in time. */
+static void reass_expire(void)
+{
+	struct timeval now;
+	link_t *link;
 
-	list_foreach(rdg->frags, dgram_link, reass_frag_t, cfrag) {
-		size_t cb, ce;
+	assert(fibril_mutex_is_locked(&reass_dgram_map_lock));
 
-		cb = max(doffs, cfrag->packet.offs);
-		ce = min(dgram_size, cfrag->packet.offs + cfrag->packet.size);
+	getuptime(&now);
 
-		if (ce > cb) {
-			memcpy(dgram.data + cb,
-			    cfrag->packet.data + cb - cfrag->packet.offs,
-			    ce - cb);
-		}
+	/*
+	 * Datagram expires when no fragment has arrived for some time,
+	 * so expired datagrams are found at the start of the LRU list.
+	 */
+	while ((link = list_first(&reass_lru)) != NULL) {
+		reass_dgram_t *rdg = list_get_instance(link, reass_dgram_t,
+		    lru_link);
 
-		if (!cfrag->packet.mf)
+		if (tv_gt(&rdg->expires, &now))
 			break;
-	}
 
-	rc = inet_recv_dgram_local(&dgram, proto);
-	free(dgram.data);
-	return rc;
+		log_msg(LOG_DEFAULT, LVL_DEBUG, "Reassembly timed out, "
+		    "datagram dropped.");
+		reass_dgram_remove(rdg);
+		reass_dgram_destroy(rdg);
+	}
 }
 
-/** Destroy datagram reassembly structure.
+/** Discard least recently updated datagrams to stay within memory limit.
  *
- * @param rdg		Datagram reassembly structure.
+ * The most recently updated datagram is never discarded.
  */
-static void reass_dgram_destroy(reass_dgram_t *rdg)
+static void reass_evict(void)
 {
-	while (!list_empty(&rdg->frags)) {
-		link_t *flink = list_first(&rdg->frags);
-		reass_frag_t *frag = list_get_instance(flink, reass_frag_t,
-		    dgram_link);
+	link_t *link;
 
-		list_remove(&frag->dgram_link);
-		free(frag->packet.data);
-		free(frag);
-	}
+	assert(fibril_mutex_is_locked(&reass_dgram_map_lock));
 
-	free(rdg);
+	while (reass_mem > REASS_MEM_MAX) {
+		link = list_first(&reass_lru);
+		if (link == list_last(&reass_lru))
+			break;
+
+		reass_dgram_t *rdg = list_get_instance(link, reass_dgram_t,
+		    lru_link);
+
+		log_msg(LOG_DEFAULT, LVL_DEBUG, "Reassembly memory exhausted, "
+		    "datagram dropped.");
+		reass_dgram_remove(rdg);
+		reass_dgram_destroy(rdg);
+	}
 }
 
 /** @}
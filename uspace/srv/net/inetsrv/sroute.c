@@ -39,16 +39,348 @@
 #include <fibril_synch.h>
 #include <io/log.h>
 #include <ipc/loc.h>
+#include <macros.h>
+#include <mem.h>
+#include <rcu.h>
 #include <stdlib.h>
 #include <str.h>
 #include "sroute.h"
 #include "inetsrv.h"
 #include "inet_link.h"
 
+/** Number of entries in the destination cache (power of two) */
+#define SROUTE_CACHE_SIZE 64
+
+/** Node of the routing trie.
+ *
+ * The trie is a path-compressed binary trie keyed by destination prefix.
+ * Nodes without a route are branching nodes, they always have two children.
+ *
+ * Lookups traverse the trie in RCU reader sections without taking
+ * sroute_list_lock. Updates are made under sroute_list_lock, new nodes
+ * are published with rcu_assign() and unlinked nodes are freed only
+ * after rcu_synchronize().
+ */
+typedef struct inet_rtrie_node {
+	/** Children for next prefix bit 0 and 1 */
+	struct inet_rtrie_node *child[2];
+	/** Next node in the list of unlinked nodes waiting to be freed */
+	struct inet_rtrie_node *gc_next;
+	/** Prefix (bits beyond @c bits are zero) */
+	addr128_t key;
+	/** Prefix length */
+	uint8_t bits;
+	/** Route for this prefix or @c NULL */
+	inet_sroute_t *sroute;
+} inet_rtrie_node_t;
+
+/** Destination cache entry.
+ *
+ * Entries are never modified once published, a lookup replaces the whole
+ * entry and the old one is freed after a grace period.
+ */
+typedef struct {
+	/** RCU item used to free the entry */
+	rcu_item_t rcu;
+	/** Routing table generation the entry was looked up in */
+	size_t gen;
+	/** Destination address */
+	inet_addr_t addr;
+	/** A route to the destination has been found */
+	bool found;
+	/** Router for the destination if @c found */
+	inet_addr_t router;
+} inet_sroute_cache_t;
+
 static FIBRIL_MUTEX_INITIALIZE(sroute_list_lock);
 static LIST_INITIALIZE(sroute_list);
 static sysarg_t sroute_id = 0;
 
+/** Routing tries for IPv4 and IPv6 */
+static inet_rtrie_node_t *sroute_trie4;
+static inet_rtrie_node_t *sroute_trie6;
+
+/** Routing table generation, changed after every update of the tries */
+static size_t sroute_gen;
+
+/** Destination cache */
+static inet_sroute_cache_t *sroute_cache[SROUTE_CACHE_SIZE];
+
+/** Get bit @a i of trie key. */
+static unsigned inet_rtrie_key_bit(const uint8_t *key, unsigned i)
+{
+	return (key[i / 8] >> (7 - i % 8)) & 1;
+}
+
+/** Get number of leading bits two keys have in common.
+ *
+ * @param a    First key
+ * @param b    Second key
+ * @param bits Maximum number of bits to compare
+ * @return     Number of common leading bits, at most @a bits
+ */
+static unsigned inet_rtrie_common_bits(const uint8_t *a, const uint8_t *b,
+    unsigned bits)
+{
+	unsigned i;
+
+	for (i = 0; i < bits; i++) {
+		if (inet_rtrie_key_bit(a, i) != inet_rtrie_key_bit(b, i))
+			break;
+	}
+
+	return i;
+}
+
+/** Clear key bits beyond prefix length. */
+static void inet_rtrie_key_mask(uint8_t *key, unsigned bits)
+{
+	unsigned i;
+
+	for (i = bits; i < 128; i++)
+		key[i / 8] &= ~(1 << (7 - i % 8));
+}
+
+/** Get trie and trie key for address.
+ *
+ * @param addr Address
+ * @param key  Place to store key
+ * @return     Pointer to root of the trie or @c NULL if the address
+ *             family is not supported
+ */
+static inet_rtrie_node_t **inet_rtrie_get(const inet_addr_t *addr,
+    uint8_t *key)
+{
+	addr32_t v4;
+
+	memset(key, 0, sizeof(addr128_t));
+
+	switch (inet_addr_get(addr, &v4, (addr128_t *) key)) {
+	case ip_v4:
+		key[0] = v4 >> 24;
+		key[1] = (v4 >> 16) & 0xff;
+		key[2] = (v4 >> 8) & 0xff;
+		key[3] = v4 & 0xff;
+		return &sroute_trie4;
+	case ip_v6:
+		return &sroute_trie6;
+	default:
+		return NULL;
+	}
+}
+
+static inet_rtrie_node_t *inet_rtrie_node_new(const uint8_t *key,
+    unsigned bits, inet_sroute_t *sroute)
+{
+	inet_rtrie_node_t *node;
+
+	node = calloc(1, sizeof(inet_rtrie_node_t));
+	if (node == NULL)
+		return NULL;
+
+	memcpy(node->key, key, sizeof(addr128_t));
+	inet_rtrie_key_mask(node->key, bits);
+	node->bits = bits;
+	node->sroute = sroute;
+	return node;
+}
+
+/** Insert route into trie.
+ *
+ * If there already is a route with the same prefix, it is kept.
+ *
+ * @param nodep  Root of the trie
+ * @param key    Prefix
+ * @param bits   Prefix length
+ * @param sroute Route
+ * @return       EOK on success, ENOMEM if out of memory
+ */
+static errno_t inet_rtrie_insert(inet_rtrie_node_t **nodep, const uint8_t *key,
+    unsigned bits, inet_sroute_t *sroute)
+{
+	inet_rtrie_node_t *node;
+	inet_rtrie_node_t *nnode;
+	inet_rtrie_node_t *bnode;
+	unsigned cb;
+
+	while (*nodep != NULL) {
+		node = *nodep;
+		cb = inet_rtrie_common_bits(node->key, key, min(node->bits, bits));
+
+		if (cb == node->bits && cb == bits) {
+			/* Same prefix */
+			if (node->sroute == NULL)
+				rcu_assign(node->sroute, sroute);
+			return EOK;
+		}
+
+		if (cb == node->bits) {
+			/* Node prefix is a prefix of the key, descend */
+			nodep = &node->child[inet_rtrie_key_bit(key, cb)];
+			continue;
+		}
+
+		nnode = inet_rtrie_node_new(key, bits, sroute);
+		if (nnode == NULL)
+			return ENOMEM;
+
+		if (cb == bits) {
+			/* Key is a prefix of the node prefix */
+			nnode->child[inet_rtrie_key_bit(node->key, cb)] = node;
+			rcu_assign(*nodep, nnode);
+			return EOK;
+		}
+
+		/* Prefixes diverge, insert branching node */
+		bnode = inet_rtrie_node_new(key, cb, NULL);
+		if (bnode == NULL) {
+			free(nnode);
+			return ENOMEM;
+		}
+
+		bnode->child[inet_rtrie_key_bit(key, cb)] = nnode;
+		bnode->child[inet_rtrie_key_bit(node->key, cb)] = node;
+		rcu_assign(*nodep, bnode);
+		return EOK;
+	}
+
+	nnode = inet_rtrie_node_new(key, bits, sroute);
+	if (nnode == NULL)
+		return ENOMEM;
+
+	rcu_assign(*nodep, nnode);
+	return EOK;
+}
+
+/** Remove route from trie.
+ *
+ * @param nodep  Root of the (sub)trie
+ * @param key    Prefix
+ * @param bits   Prefix length
+ * @param sroute Route to remove
+ * @param repl   Other route with the same prefix to take its place or
+ *               @c NULL
+ * @param gc     List of unlinked nodes to be freed after a grace period
+ */
+static void inet_rtrie_remove(inet_rtrie_node_t **nodep, const uint8_t *key,
+    unsigned bits, inet_sroute_t *sroute, inet_sroute_t *repl,
+    inet_rtrie_node_t **gc)
+{
+	inet_rtrie_node_t *node = *nodep;
+	unsigned cb;
+
+	if (node == NULL)
+		return;
+
+	cb = inet_rtrie_common_bits(node->key, key, min(node->bits, bits));
+	if (cb < node->bits)
+		return;
+
+	if (node->bits == bits) {
+		if (node->sroute == sroute)
+			rcu_assign(node->sroute, repl);
+	} else {
+		inet_rtrie_remove(&node->child[inet_rtrie_key_bit(key, cb)],
+		    key, bits, sroute, repl, gc);
+	}
+
+	/*
+	 * Unlink nodes that have no route and no longer branch. Readers
+	 * may still be traversing them, so they are freed later.
+	 */
+	if (node->sroute == NULL &&
+	    (node->child[0] == NULL || node->child[1] == NULL)) {
+		rcu_assign(*nodep, node->child[node->child[0] == NULL ? 1 : 0]);
+		node->gc_next = *gc;
+		*gc = node;
+	}
+}
+
+/** Find longest prefix match in trie.
+ *
+ * Must be called in an RCU reader section.
+ *
+ * @param node Root of the trie
+ * @param key  Address
+ * @param bits Address length in bits
+ * @return     Most specific route or @c NULL
+ */
+static inet_sroute_t *inet_rtrie_lookup(inet_rtrie_node_t *node,
+    const uint8_t *key, unsigned bits)
+{
+	inet_sroute_t *best = NULL;
+	inet_sroute_t *sroute;
+
+	while (node != NULL) {
+		if (inet_rtrie_common_bits(node->key, key, node->bits) <
+		    node->bits)
+			break;
+
+		sroute = rcu_access(node->sroute);
+		if (sroute != NULL)
+			best = sroute;
+
+		if (node->bits >= bits)
+			break;
+
+		node = rcu_access(node->child[inet_rtrie_key_bit(key,
+		    node->bits)]);
+	}
+
+	return best;
+}
+
+/** Free unlinked trie nodes once no reader can reach them.
+ *
+ * @param gc List of unlinked nodes
+ */
+static void inet_rtrie_gc(inet_rtrie_node_t *gc)
+{
+	inet_rtrie_node_t *next;
+
+	if (gc == NULL)
+		return;
+
+	rcu_synchronize();
+
+	while (gc != NULL) {
+		next = gc->gc_next;
+		free(gc);
+		gc = next;
+	}
+}
+
+/** Get destination cache slot for address. */
+static inet_sroute_cache_t **inet_sroute_cache_get(const uint8_t *key)
+{
+	uint32_t hash = 0;
+	unsigned i;
+
+	for (i = 0; i < sizeof(addr128_t); i++)
+		hash = hash * 31 + key[i];
+
+	return &sroute_cache[(hash ^ (hash >> 16)) &
+	    (SROUTE_CACHE_SIZE - 1)];
+}
+
+/** Free destination cache entry after a grace period. */
+static void inet_sroute_cache_free(rcu_item_t *item)
+{
+	free(member_to_inst(item, inet_sroute_cache_t, rcu));
+}
+
+/** Invalidate destination cache after change of the routing table.
+ *
+ * Entries looked up in an older generation are ignored by readers and
+ * replaced by the next lookup of the same slot. The new generation is
+ * stored with release semantics, so a reader that sees it also sees
+ * the updated tries.
+ */
+static void inet_sroute_cache_flush(void)
+{
+	__atomic_store_n(&sroute_gen, sroute_gen + 1, __ATOMIC_RELEASE);
+}
+
 inet_sroute_t *inet_sroute_new(void)
 {
 	inet_sroute_t *sroute = calloc(1, sizeof(inet_sroute_t));
@@ -74,61 +406,166 @@ void inet_sroute_delete(inet_sroute_t *sroute)
 	free(sroute);
 }
 
-void inet_sroute_add(inet_sroute_t *sroute)
+/** Add static route.
+ *
+ * @param sroute Static route
+ * @return       EOK on success, ENOMEM if out of memory, EINVAL if
+ *               destination address family is not supported
+ */
+errno_t inet_sroute_add(inet_sroute_t *sroute)
 {
+	inet_rtrie_node_t **trie;
+	inet_addr_t dest;
+	addr128_t key;
+	uint8_t bits;
+	errno_t rc;
+
+	inet_naddr_addr(&sroute->dest, &dest);
+	(void) inet_naddr_get(&sroute->dest, NULL, NULL, &bits);
+
 	fibril_mutex_lock(&sroute_list_lock);
+
+	trie = inet_rtrie_get(&dest, key);
+	if (trie == NULL) {
+		fibril_mutex_unlock(&sroute_list_lock);
+		return EINVAL;
+	}
+
+	rc = inet_rtrie_insert(trie, key, bits, sroute);
+	if (rc != EOK) {
+		fibril_mutex_unlock(&sroute_list_lock);
+		return rc;
+	}
+
 	list_append(&sroute->sroute_list, &sroute_list);
+	inet_sroute_cache_flush();
 	fibril_mutex_unlock(&sroute_list_lock);
+	return EOK;
 }
 
 void inet_sroute_remove(inet_sroute_t *sroute)
 {
-	fibril_mutex_lock(&sroute_list_lock);
-	list_remove(&sroute->sroute_list);
-	fibril_mutex_unlock(&sroute_list_lock);
-}
+	inet_rtrie_node_t **trie;
+	inet_sroute_t *repl;
+	inet_addr_t dest;
+	addr128_t key;
+	uint8_t bits;
 
-/** Find static route object matching address @a addr.
- *
- * @param addr	Address
- */
-inet_sroute_t *inet_sroute_find(inet_addr_t *addr)
-{
-	ip_ver_t addr_ver = inet_addr_get(addr, NULL, NULL);
+	inet_naddr_addr(&sroute->dest, &dest);
+	(void) inet_naddr_get(&sroute->dest, NULL, NULL, &bits);
 
-	inet_sroute_t *best = NULL;
-	uint8_t best_bits = 0;
+	inet_rtrie_node_t *gc = NULL;
 
 	fibril_mutex_lock(&sroute_list_lock);
+	list_remove(&sroute->sroute_list);
 
-	list_foreach(sroute_list, sroute_list, inet_sroute_t, sroute) {
-		uint8_t dest_bits;
-		ip_ver_t dest_ver = inet_naddr_get(&sroute->dest, NULL, NULL,
-		    &dest_bits);
+	/* Another route with the same destination can take its place */
+	repl = NULL;
+	list_foreach(sroute_list, sroute_list, inet_sroute_t, sr) {
+		if (sr->dest.version == sroute->dest.version &&
+		    sr->dest.prefix == sroute->dest.prefix &&
+		    inet_naddr_compare_mask(&sr->dest, &dest)) {
+			repl = sr;
+			break;
+		}
+	}
 
-		/* Skip comparison with different address family */
-		if (addr_ver != dest_ver)
-			continue;
+	trie = inet_rtrie_get(&dest, key);
+	if (trie != NULL)
+		inet_rtrie_remove(trie, key, bits, sroute, repl, &gc);
 
-		/* Look for the most specific route */
-		if ((best != NULL) && (best_bits >= dest_bits))
-			continue;
+	inet_sroute_cache_flush();
+	fibril_mutex_unlock(&sroute_list_lock);
 
-		if (inet_naddr_compare_mask(&sroute->dest, addr)) {
-			log_msg(LOG_DEFAULT, LVL_DEBUG, "inet_sroute_find: found candidate %p",
-			    sroute);
+	/*
+	 * Wait for readers also when no node was unlinked, the caller
+	 * may free @a sroute once we return.
+	 */
+	if (gc == NULL)
+		rcu_synchronize();
+	else
+		inet_rtrie_gc(gc);
+}
 
-			best = sroute;
-			best_bits = dest_bits;
+/** Find router for address @a addr.
+ *
+ * Finds the most specific route (longest prefix match). The lookup does
+ * not take sroute_list_lock, it runs in an RCU reader section and copies
+ * the router address out of the route before leaving it.
+ *
+ * @param addr   Address
+ * @param router Place to store router address
+ * @return       EOK on success, ENOENT if there is no route to @a addr
+ */
+errno_t inet_sroute_find(inet_addr_t *addr, inet_addr_t *router)
+{
+	inet_rtrie_node_t **trie;
+	inet_sroute_cache_t **slot;
+	inet_sroute_cache_t *ent;
+	inet_sroute_cache_t *nent;
+	inet_sroute_t *best;
+	addr128_t key;
+	size_t gen;
+	bool found;
+
+	trie = inet_rtrie_get(addr, key);
+	if (trie == NULL)
+		return ENOENT;
+
+	/* Lookups may come from fibrils which do not use RCU otherwise. */
+	bool registered = rcu_fibril_registered();
+	if (!registered)
+		rcu_register_fibril();
+
+	rcu_read_lock();
+
+	gen = __atomic_load_n(&sroute_gen, __ATOMIC_ACQUIRE);
+	slot = inet_sroute_cache_get(key);
+	ent = __atomic_load_n(slot, __ATOMIC_ACQUIRE);
+
+	if (ent != NULL && ent->gen == gen &&
+	    inet_addr_compare(&ent->addr, addr)) {
+		found = ent->found;
+		if (found)
+			*router = ent->router;
+	} else {
+		best = inet_rtrie_lookup(rcu_access(*trie), key,
+		    trie == &sroute_trie4 ? 32 : 128);
+
+		found = (best != NULL);
+		if (found)
+			*router = best->router;
+
+		nent = calloc(1, sizeof(inet_sroute_cache_t));
+		if (nent != NULL) {
+			nent->gen = gen;
+			nent->addr = *addr;
+			nent->found = found;
+			if (found)
+				nent->router = best->router;
+
+			if (__atomic_compare_exchange_n(slot, &ent, nent, false,
+			    __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+				if (ent != NULL)
+					rcu_call(&ent->rcu, inet_sroute_cache_free);
+			} else {
+				/* Another lookup filled the slot meanwhile */
+				free(nent);
+			}
 		}
 	}
 
-	if (best == NULL)
-		log_msg(LOG_DEFAULT, LVL_DEBUG, "inet_sroute_find: Not found");
+	rcu_read_unlock();
 
-	fibril_mutex_unlock(&sroute_list_lock);
+	if (!registered)
+		rcu_deregister_fibril();
 
-	return best;
+	if (!found) {
+		log_msg(LOG_DEFAULT, LVL_DEBUG, "inet_sroute_find: Not found");
+		return ENOENT;
+	}
+
+	return EOK;
 }
 
 /** Find static route with a specific name.
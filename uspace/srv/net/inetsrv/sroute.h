@@ -43,9 +43,9 @@
 
 extern inet_sroute_t *inet_sroute_new(void);
 extern void inet_sroute_delete(inet_sroute_t *);
-extern void inet_sroute_add(inet_sroute_t *);
+extern errno_t inet_sroute_add(inet_sroute_t *);
 extern void inet_sroute_remove(inet_sroute_t *);
-extern inet_sroute_t *inet_sroute_find(inet_addr_t *);
+extern errno_t inet_sroute_find(inet_addr_t *, inet_addr_t *);
 extern inet_sroute_t *inet_sroute_find_by_name(const char *);
 extern inet_sroute_t *inet_sroute_get_by_id(sysarg_t);
 extern errno_t inet_sroute_send_dgram(inet_sroute_t *, inet_addr_t *,
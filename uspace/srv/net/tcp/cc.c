@@ -0,0 +1,265 @@
+/*
+ * Copyright (c) 2018 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup tcp
+ * @{
+ */
+/**
+ * @file TCP congestion control
+ *
+ * Window management common to all congestion control algorithms
+ * (fast retransmit and fast recovery, RFC 5681 and RFC 6582) and
+ * retransmission timeout computation (RFC 6298). Algorithms plug in
+ * through tcp_cc_ops_t to decide how the window grows and how much it
+ * shrinks when loss is detected.
+ */
+
+#include <io/log.h>
+#include <macros.h>
+#include <mem.h>
+#include <str.h>
+#include "cc.h"
+#include "tcp_type.h"
+#include "tqueue.h"
+
+/** Initial congestion window (RFC 3390) */
+#define CC_IW min(4 * TCP_SMSS, max(2 * TCP_SMSS, 4380))
+/** Upper bound on congestion window */
+#define CC_CWND_MAX (1U << 30)
+/** Number of duplicate ACKs that trigger fast retransmit */
+#define CC_DUPACK_THRESHOLD 3
+
+/** Initial retransmission timeout */
+#define RTO_INIT (1000 * 1000)
+/** Lower bound on retransmission timeout */
+#define RTO_MIN (200 * 1000)
+/** Upper bound on retransmission timeout */
+#define RTO_MAX (60 * 1000 * 1000)
+/** Clock granularity */
+#define RTO_G 1000
+
+/** Available congestion control algorithms */
+static tcp_cc_ops_t *tcp_cc_algs[] = {
+	&tcp_cc_newreno,
+	&tcp_cc_cubic,
+	NULL
+};
+
+/** Algorithm used for new connections */
+static tcp_cc_ops_t *tcp_cc_default = &tcp_cc_cubic;
+
+/** Select congestion control algorithm for new connections.
+ *
+ * @param name	Algorithm name
+ * @return	EOK on success, ENOENT if there is no such algorithm
+ */
+errno_t tcp_cc_set_default(const char *name)
+{
+	tcp_cc_ops_t **alg;
+
+	for (alg = tcp_cc_algs; *alg != NULL; alg++) {
+		if (str_cmp((*alg)->name, name) == 0) {
+			tcp_cc_default = *alg;
+			return EOK;
+		}
+	}
+
+	return ENOENT;
+}
+
+/** Initialize congestion control state of new connection.
+ *
+ * @param conn	Connection
+ */
+void tcp_cc_init(tcp_conn_t *conn)
+{
+	memset(&conn->cc, 0, sizeof(tcp_cc_t));
+
+	conn->cc.ops = tcp_cc_default;
+	conn->cc.cwnd = CC_IW;
+	conn->cc.ssthresh = UINT32_MAX;
+
+	conn->srtt = 0;
+	conn->rttvar = 0;
+	conn->rto = RTO_INIT;
+
+	conn->cc.ops->init(conn);
+}
+
+/** Get amount of data in flight.
+ *
+ * @param conn	Connection
+ * @return	Number of sent, but not yet acknowledged sequence numbers
+ */
+uint32_t tcp_cc_flight(tcp_conn_t *conn)
+{
+	return conn->snd_nxt - conn->snd_una;
+}
+
+/** Get effective send window.
+ *
+ * @param conn	Connection
+ * @return	Smaller of congestion window and window advertised by peer
+ */
+uint32_t tcp_cc_wnd(tcp_conn_t *conn)
+{
+	return min(conn->cc.cwnd, conn->snd_wnd);
+}
+
+/** Update round-trip time estimate with new measurement.
+ *
+ * @param conn	Connection
+ * @param rtt	Measured round-trip time in microseconds
+ */
+void tcp_cc_rtt_sample(tcp_conn_t *conn, suseconds_t rtt)
+{
+	suseconds_t delta;
+
+	/* Zero SRTT means no sample yet */
+	if (rtt <= 0)
+		rtt = 1;
+
+	if (conn->srtt == 0) {
+		conn->srtt = rtt;
+		conn->rttvar = rtt / 2;
+	} else {
+		delta = conn->srtt > rtt ? conn->srtt - rtt : rtt - conn->srtt;
+		conn->rttvar = (3 * conn->rttvar + delta) / 4;
+		conn->srtt = (7 * conn->srtt + rtt) / 8;
+	}
+
+	conn->rto = conn->srtt + max(RTO_G, 4 * conn->rttvar);
+	if (conn->rto < RTO_MIN)
+		conn->rto = RTO_MIN;
+	if (conn->rto > RTO_MAX)
+		conn->rto = RTO_MAX;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG2, "%s: RTT=%ld SRTT=%ld RTTVAR=%ld "
+	    "RTO=%ld", conn->name, rtt, conn->srtt, conn->rttvar, conn->rto);
+}
+
+/** New data has been acknowledged.
+ *
+ * This should be called after acknowledged segments have been removed
+ * from the retransmission queue.
+ *
+ * @param conn	Connection
+ * @param acked	Number of newly acknowledged sequence numbers
+ */
+void tcp_cc_ack(tcp_conn_t *conn, uint32_t acked)
+{
+	tcp_cc_t *cc = &conn->cc;
+
+	conn->stats.bytes_acked += acked;
+	cc->dupacks = 0;
+
+	if (cc->in_recovery) {
+		if ((int32_t)(conn->snd_una - cc->recover) >= 0) {
+			/* Full acknowledgement, leave fast recovery */
+			cc->cwnd = min(cc->ssthresh,
+			    max(tcp_cc_flight(conn), TCP_SMSS) + TCP_SMSS);
+			cc->in_recovery = false;
+			log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: Fast recovery "
+			    "finished, cwnd=%" PRIu32, conn->name, cc->cwnd);
+		} else {
+			/*
+			 * Partial acknowledgement, the next segment has been
+			 * lost as well. Retransmit it and deflate the window
+			 * by the amount of data that has left the network.
+			 */
+			tcp_tqueue_fast_retransmit(conn);
+			cc->cwnd = cc->cwnd > acked ? cc->cwnd - acked : 0;
+			if (acked >= TCP_SMSS)
+				cc->cwnd += TCP_SMSS;
+			cc->cwnd = max(cc->cwnd, TCP_SMSS);
+		}
+
+		return;
+	}
+
+	cc->ops->cong_avoid(conn, acked);
+	cc->cwnd = min(cc->cwnd, CC_CWND_MAX);
+}
+
+/** Duplicate acknowledgement has been received.
+ *
+ * @param conn	Connection
+ */
+void tcp_cc_dupack(tcp_conn_t *conn)
+{
+	tcp_cc_t *cc = &conn->cc;
+
+	if (cc->in_recovery) {
+		/* Another segment has left the network, inflate window */
+		cc->cwnd = min(cc->cwnd + TCP_SMSS, CC_CWND_MAX);
+		return;
+	}
+
+	if (++cc->dupacks != CC_DUPACK_THRESHOLD)
+		return;
+
+	/* Fast retransmit and enter fast recovery */
+	cc->ssthresh = cc->ops->ssthresh(conn);
+	cc->cwnd = cc->ssthresh + CC_DUPACK_THRESHOLD * TCP_SMSS;
+	cc->recover = conn->snd_nxt;
+	cc->in_recovery = true;
+	++conn->stats.fast_retransmits;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: Fast retransmit, ssthresh=%"
+	    PRIu32, conn->name, cc->ssthresh);
+
+	tcp_tqueue_fast_retransmit(conn);
+}
+
+/** Retransmission timer has expired.
+ *
+ * Back off the retransmission timer and restart from slow start.
+ *
+ * @param conn	Connection
+ */
+void tcp_cc_timeout(tcp_conn_t *conn)
+{
+	tcp_cc_t *cc = &conn->cc;
+
+	++conn->stats.timeouts;
+
+	conn->rto = min(2 * conn->rto, RTO_MAX);
+
+	cc->ssthresh = cc->ops->ssthresh(conn);
+	cc->cwnd = TCP_SMSS;
+	cc->bytes_acked = 0;
+	cc->dupacks = 0;
+	cc->in_recovery = false;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: Retransmission timeout, RTO=%ld, "
+	    "ssthresh=%" PRIu32, conn->name, conn->rto, cc->ssthresh);
+}
+
+/**
+ * @}
+ */
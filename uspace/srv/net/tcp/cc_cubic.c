@@ -0,0 +1,186 @@
+/*
+ * Copyright (c) 2018 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup tcp
+ * @{
+ */
+/**
+ * @file CUBIC congestion control
+ *
+ * Window growth follows a cubic function of time since the last
+ * reduction (RFC 8312), making it independent of round-trip time and
+ * quick to reclaim bandwidth on paths with large bandwidth-delay product.
+ * All computation is done in integer arithmetic with window in bytes and
+ * time in milliseconds.
+ */
+
+#include <macros.h>
+#include <sys/time.h>
+#include "cc.h"
+#include "tcp_type.h"
+
+/** Multiplicative decrease factor beta_cubic = 0.7 */
+#define CUBIC_BETA_NUM 7
+#define CUBIC_BETA_DEN 10
+
+/**
+ * Scale to compute K in milliseconds from window difference in bytes.
+ *
+ * K = cbrt(W_diff / (C * SMSS)) seconds with C = 0.4, i.e.
+ * K^3 = W_diff * 2.5 * 10^9 / SMSS ms^3.
+ */
+#define CUBIC_K_SCALE 2500000000ULL
+
+/** Limit of |t - K| in milliseconds to keep (t - K)^3 in range */
+#define CUBIC_T_MAX 60000
+
+static uint32_t cubic_now(void)
+{
+	struct timeval tv;
+
+	getuptime(&tv);
+	return tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
+
+/** Integer cube root.
+ *
+ * @param a	Argument
+ * @return	Largest integer x such that x^3 <= a
+ */
+static uint32_t cubic_cbrt(uint64_t a)
+{
+	uint64_t x, b;
+	int s;
+
+	x = 0;
+	for (s = 63; s >= 0; s -= 3) {
+		x += x;
+		b = 3 * x * (x + 1) + 1;
+		if ((a >> s) >= b) {
+			a -= b << s;
+			x++;
+		}
+	}
+
+	return x;
+}
+
+static void cubic_init(tcp_conn_t *conn)
+{
+	conn->cc.w_max = 0;
+	conn->cc.in_epoch = false;
+}
+
+static void cubic_cong_avoid(tcp_conn_t *conn, uint32_t acked)
+{
+	tcp_cc_t *cc = &conn->cc;
+	uint32_t now;
+	uint64_t target;
+	int64_t t, offs;
+
+	if (cc->cwnd < cc->ssthresh) {
+		/* Slow start */
+		cc->cwnd += min(acked, TCP_SMSS);
+		return;
+	}
+
+	now = cubic_now();
+
+	if (!cc->in_epoch) {
+		/* Start of congestion avoidance epoch */
+		cc->in_epoch = true;
+		cc->epoch_start = now;
+		if (cc->cwnd < cc->w_max) {
+			cc->k = cubic_cbrt((uint64_t)(cc->w_max - cc->cwnd) *
+			    CUBIC_K_SCALE / TCP_SMSS);
+			cc->origin = cc->w_max;
+		} else {
+			cc->k = 0;
+			cc->origin = cc->cwnd;
+		}
+
+		cc->w_est = cc->cwnd;
+	}
+
+	/* Target window one RTT from now, W(t) = C * (t - K)^3 + W_max */
+	t = (int64_t)(now - cc->epoch_start) + conn->srtt / 1000 -
+	    (int64_t)cc->k;
+	if (t > CUBIC_T_MAX)
+		t = CUBIC_T_MAX;
+	if (t < -CUBIC_T_MAX)
+		t = -CUBIC_T_MAX;
+
+	offs = t * t * t * 4 * TCP_SMSS / 10000000000LL;
+	if (offs < 0 && (uint64_t)-offs >= cc->origin)
+		target = TCP_SMSS;
+	else
+		target = cc->origin + offs;
+
+	if (target > cc->cwnd) {
+		cc->cwnd += min((target - cc->cwnd) * acked / cc->cwnd,
+		    (uint64_t)acked);
+	}
+
+	/*
+	 * TCP-friendly region. Estimate the window standard TCP would
+	 * have, growing by alpha = 3 * (1 - beta) / (1 + beta) = 9/17
+	 * segments per window, and do not fall behind it.
+	 */
+	cc->w_est += (uint64_t)acked * TCP_SMSS * 9 / (17 * (uint64_t)cc->cwnd);
+	if (cc->w_est > cc->cwnd)
+		cc->cwnd = cc->w_est;
+}
+
+static uint32_t cubic_ssthresh(tcp_conn_t *conn)
+{
+	tcp_cc_t *cc = &conn->cc;
+
+	/* Fast convergence, release bandwidth to new flows */
+	if (cc->cwnd < cc->w_max) {
+		cc->w_max = (uint64_t)cc->cwnd * (CUBIC_BETA_DEN +
+		    CUBIC_BETA_NUM) / (2 * CUBIC_BETA_DEN);
+	} else {
+		cc->w_max = cc->cwnd;
+	}
+
+	cc->in_epoch = false;
+
+	return max((uint64_t)cc->cwnd * CUBIC_BETA_NUM / CUBIC_BETA_DEN,
+	    2 * TCP_SMSS);
+}
+
+tcp_cc_ops_t tcp_cc_cubic = {
+	.name = "cubic",
+	.init = cubic_init,
+	.cong_avoid = cubic_cong_avoid,
+	.ssthresh = cubic_ssthresh
+};
+
+/**
+ * @}
+ */
@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2018 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup tcp
+ * @{
+ */
+/**
+ * @file NewReno congestion control
+ *
+ * Standard TCP window growth (RFC 5681): slow start followed by additive
+ * increase of one segment per window, halving the window on loss.
+ */
+
+#include <macros.h>
+#include "cc.h"
+#include "tcp_type.h"
+
+static void newreno_init(tcp_conn_t *conn)
+{
+	(void) conn;
+}
+
+static void newreno_cong_avoid(tcp_conn_t *conn, uint32_t acked)
+{
+	tcp_cc_t *cc = &conn->cc;
+
+	if (cc->cwnd < cc->ssthresh) {
+		/* Slow start */
+		cc->cwnd += min(acked, TCP_SMSS);
+		return;
+	}
+
+	/* Congestion avoidance, grow by one segment per window acked */
+	cc->bytes_acked += acked;
+	if (cc->bytes_acked >= cc->cwnd) {
+		cc->bytes_acked -= cc->cwnd;
+		cc->cwnd += TCP_SMSS;
+	}
+}
+
+static uint32_t newreno_ssthresh(tcp_conn_t *conn)
+{
+	return max(tcp_cc_flight(conn) / 2, 2 * TCP_SMSS);
+}
+
+tcp_cc_ops_t tcp_cc_newreno = {
+	.name = "newreno",
+	.init = newreno_init,
+	.cong_avoid = newreno_cong_avoid,
+	.ssthresh = newreno_ssthresh
+};
+
+/**
+ * @}
+ */
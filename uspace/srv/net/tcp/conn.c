@@ -34,14 +34,19 @@
  * @file TCP connection processing and state machine
  */
 
+#include <adt/hash.h>
+#include <adt/hash_table.h>
 #include <adt/list.h>
 #include <errno.h>
 #include <inet/endpoint.h>
 #include <io/log.h>
 #include <macros.h>
+#include <mem.h>
 #include <nettl/amap.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <sys/time.h>
+#include "cc.h"
 #include "conn.h"
 #include "inet.h"
 #include "iqueue.h"
@@ -53,12 +58,24 @@
 #include "tqueue.h"
 #include "ucall.h"
 
-#define RCV_BUF_SIZE 4096/*2*/
-#define SND_BUF_SIZE 4096
+#define RCV_BUF_SIZE (128 * 1024)
+#define SND_BUF_SIZE (128 * 1024)
 
 #define MAX_SEGMENT_LIFETIME	(15*1000*1000) //(2*60*1000*1000)
 #define TIME_WAIT_TIMEOUT	(2*MAX_SEGMENT_LIFETIME)
 
+/** Maximum number of half-open connections per listener */
+#define SYN_QUEUE_MAX		128
+/** Time after which a half-open connection is dropped (microseconds) */
+#define SYN_QUEUE_TIMEOUT	(30*1000*1000)
+
+/** Number of low-order bits of SYN cookie holding the hash */
+#define SYN_COOKIE_HASH_BITS	27
+/** Length of SYN cookie time slot (seconds) */
+#define SYN_COOKIE_SLOT_SEC	64
+/** Mask of SYN cookie time slot number */
+#define SYN_COOKIE_SLOT_MASK	((1u << (32 - SYN_COOKIE_HASH_BITS)) - 1)
+
 /** List of all allocated connections */
 static LIST_INITIALIZE(conn_list);
 /** Taken after tcp_conn_t lock */
@@ -68,9 +85,33 @@ static amap_t *amap;
 /** Taken after tcp_conn_t lock */
 static FIBRIL_MUTEX_INITIALIZE(amap_lock);
 
+/** Number of independently locked parts of the connection hash index */
+#define CONN_HASH_SHARDS 16
+
+/** Part of the connection hash index */
+typedef struct {
+	/** Taken after tcp_conn_t lock and amap_lock */
+	fibril_mutex_t lock;
+	hash_table_t conns;
+} tcp_conn_shard_t;
+
+/**
+ * Hash index of connections with fully specified endpoint pair.
+ *
+ * Incoming segments are matched against it first, only segments that do
+ * not belong to such connection need to go through the association map.
+ */
+static tcp_conn_shard_t conn_shards[CONN_HASH_SHARDS];
+
 /** Internal loopback configuration */
 tcp_lb_t tcp_conn_lb = tcp_lb_none;
 
+/** Answer SYN with a SYN cookie when the listener's SYN queue is full */
+bool tcp_conn_syn_cookies = false;
+
+/** Secret mixed into SYN cookies */
+static uint32_t syn_cookie_secret;
+
 static void tcp_conn_seg_process(tcp_conn_t *, tcp_segment_t *);
 static void tcp_conn_tw_timer_set(tcp_conn_t *);
 static void tcp_conn_tw_timer_clear(tcp_conn_t *);
@@ -82,10 +123,133 @@ static tcp_tqueue_cb_t tcp_conn_tqueue_cb = {
 	.transmit_seg = tcp_transmit_segment
 };
 
+static size_t tcp_addr_hash(const inet_addr_t *addr)
+{
+	size_t hash = addr->version;
+	size_t i;
+
+	switch (addr->version) {
+	case ip_v4:
+		hash = hash_combine(hash, addr->addr);
+		break;
+	case ip_v6:
+		for (i = 0; i < sizeof(addr128_t); i++)
+			hash = hash_combine(hash, addr->addr6[i]);
+		break;
+	default:
+		break;
+	}
+
+	return hash;
+}
+
+static size_t tcp_ep2_hash(const inet_ep2_t *epp)
+{
+	size_t hash;
+
+	hash = hash_combine(tcp_addr_hash(&epp->local.addr), epp->local.port);
+	hash = hash_combine(hash, tcp_addr_hash(&epp->remote.addr));
+	return hash_combine(hash, epp->remote.port);
+}
+
+static bool tcp_ep2_equal(const inet_ep2_t *a, const inet_ep2_t *b)
+{
+	return a->local.port == b->local.port &&
+	    a->remote.port == b->remote.port &&
+	    inet_addr_compare(&a->local.addr, &b->local.addr) &&
+	    inet_addr_compare(&a->remote.addr, &b->remote.addr);
+}
+
+/** Determine if endpoint pair identifies exactly one connection. */
+static bool tcp_ep2_is_full(const inet_ep2_t *epp)
+{
+	return !inet_addr_is_any(&epp->local.addr) &&
+	    epp->local.port != inet_port_any &&
+	    !inet_addr_is_any(&epp->remote.addr) &&
+	    epp->remote.port != inet_port_any;
+}
+
+static size_t conn_hash(const ht_link_t *item)
+{
+	tcp_conn_t *conn = hash_table_get_inst(item, tcp_conn_t, hash_link);
+	return tcp_ep2_hash(&conn->ident);
+}
+
+static size_t conn_key_hash(void *key)
+{
+	return tcp_ep2_hash((inet_ep2_t *) key);
+}
+
+static bool conn_equal(const ht_link_t *item1, const ht_link_t *item2)
+{
+	tcp_conn_t *conn1 = hash_table_get_inst(item1, tcp_conn_t, hash_link);
+	tcp_conn_t *conn2 = hash_table_get_inst(item2, tcp_conn_t, hash_link);
+	return tcp_ep2_equal(&conn1->ident, &conn2->ident);
+}
+
+static bool conn_key_equal(void *key, const ht_link_t *item)
+{
+	tcp_conn_t *conn = hash_table_get_inst(item, tcp_conn_t, hash_link);
+	return tcp_ep2_equal((inet_ep2_t *) key, &conn->ident);
+}
+
+static hash_table_ops_t conn_hash_ops = {
+	.hash = conn_hash,
+	.key_hash = conn_key_hash,
+	.equal = conn_equal,
+	.key_equal = conn_key_equal,
+	.remove_callback = NULL
+};
+
+static tcp_conn_shard_t *tcp_conn_shard(const inet_ep2_t *epp)
+{
+	return &conn_shards[tcp_ep2_hash(epp) % CONN_HASH_SHARDS];
+}
+
+/** Add connection to the hash index if its identity is fully specified.
+ *
+ * @param conn		Connection
+ */
+static void tcp_conn_hash_insert(tcp_conn_t *conn)
+{
+	tcp_conn_shard_t *shard;
+
+	assert(!conn->hashed);
+	if (!tcp_ep2_is_full(&conn->ident))
+		return;
+
+	shard = tcp_conn_shard(&conn->ident);
+	fibril_mutex_lock(&shard->lock);
+	/* On a clash the connection is simply found through amap. */
+	conn->hashed = hash_table_insert_unique(&shard->conns,
+	    &conn->hash_link);
+	fibril_mutex_unlock(&shard->lock);
+}
+
+/** Remove connection from the hash index.
+ *
+ * @param conn		Connection
+ */
+static void tcp_conn_hash_remove(tcp_conn_t *conn)
+{
+	tcp_conn_shard_t *shard;
+
+	if (!conn->hashed)
+		return;
+
+	shard = tcp_conn_shard(&conn->ident);
+	fibril_mutex_lock(&shard->lock);
+	hash_table_remove_item(&shard->conns, &conn->hash_link);
+	conn->hashed = false;
+	fibril_mutex_unlock(&shard->lock);
+}
+
 /** Initialize connections. */
 errno_t tcp_conns_init(void)
 {
+	struct timeval tv;
 	errno_t rc;
+	unsigned i;
 
 	rc = amap_create(&amap);
 	if (rc != EOK) {
@@ -93,6 +257,22 @@ errno_t tcp_conns_init(void)
 		return ENOMEM;
 	}
 
+	getuptime(&tv);
+	syn_cookie_secret = hash_mix32(((uint32_t) tv.tv_sec << 20) ^
+	    (uint32_t) tv.tv_usec ^ (uint32_t) rand());
+
+	for (i = 0; i < CONN_HASH_SHARDS; i++) {
+		fibril_mutex_initialize(&conn_shards[i].lock);
+		if (!hash_table_create(&conn_shards[i].conns, 0, 0,
+		    &conn_hash_ops)) {
+			while (i-- > 0)
+				hash_table_destroy(&conn_shards[i].conns);
+			amap_destroy(amap);
+			amap = NULL;
+			return ENOMEM;
+		}
+	}
+
 	return EOK;
 }
 
@@ -101,6 +281,9 @@ void tcp_conns_fini(void)
 {
 	assert(list_empty(&conn_list));
 
+	for (unsigned i = 0; i < CONN_HASH_SHARDS; i++)
+		hash_table_destroy(&conn_shards[i].conns);
+
 	amap_destroy(amap);
 	amap = NULL;
 }
@@ -151,9 +334,19 @@ tcp_conn_t *tcp_conn_new(inet_ep2_t *epp)
 	/* Set up receive window. */
 	conn->rcv_wnd = conn->rcv_buf_size;
 
+	/* Window scale we offer so that the entire buffer can be advertised */
+	conn->rcv_wscale = 0;
+	while ((conn->rcv_buf_size >> conn->rcv_wscale) > TCP_WND_MAX &&
+	    conn->rcv_wscale < TCP_WSCALE_MAX)
+		++conn->rcv_wscale;
+
 	/* Initialize incoming segment queue */
 	tcp_iqueue_init(&conn->incoming, conn);
 
+	/* Half-open connections (if we become a listener) */
+	list_initialize(&conn->syn_queue);
+	conn->syn_queue_len = 0;
+
 	/* Initialize retransmission queue */
 	if (tcp_tqueue_init(&conn->retransmit, conn, &tcp_conn_tqueue_cb) !=
 	    EOK) {
@@ -162,6 +355,9 @@ tcp_conn_t *tcp_conn_new(inet_ep2_t *epp)
 
 	tqueue_inited = true;
 
+	/* Initialize congestion control */
+	tcp_cc_init(conn);
+
 	/* Connection state change signalling */
 	fibril_condvar_initialize(&conn->cstate_cv);
 
@@ -226,6 +422,14 @@ static void tcp_conn_free(tcp_conn_t *conn)
 		free(conn->snd_buf);
 	if (conn->tw_timer != NULL)
 		fibril_timer_destroy(conn->tw_timer);
+
+	while (!list_empty(&conn->syn_queue)) {
+		tcp_syn_ent_t *ent = list_get_instance(
+		    list_first(&conn->syn_queue), tcp_syn_ent_t, link);
+		list_remove(&ent->link);
+		free(ent);
+	}
+
 	free(conn);
 }
 
@@ -321,6 +525,7 @@ errno_t tcp_conn_add(tcp_conn_t *conn)
 
 	conn->ident = aepp;
 	conn->mapped = true;
+	tcp_conn_hash_insert(conn);
 	fibril_mutex_unlock(&amap_lock);
 
 	return EOK;
@@ -336,6 +541,7 @@ static void tcp_conn_remove(tcp_conn_t *conn)
 		return;
 
 	fibril_mutex_lock(&amap_lock);
+	tcp_conn_hash_remove(conn);
 	amap_remove(amap, &conn->ident);
 	conn->mapped = false;
 	fibril_mutex_unlock(&amap_lock);
@@ -430,6 +636,25 @@ tcp_conn_t *tcp_conn_find_ref(inet_ep2_t *epp)
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "tcp_conn_find_ref(%p)", epp);
 
+	if (tcp_ep2_is_full(epp)) {
+		tcp_conn_shard_t *shard = tcp_conn_shard(epp);
+		ht_link_t *link;
+
+		fibril_mutex_lock(&shard->lock);
+		link = hash_table_find(&shard->conns, epp);
+		if (link != NULL) {
+			conn = hash_table_get_inst(link, tcp_conn_t,
+			    hash_link);
+			if (conn->ident.local_link == 0 ||
+			    conn->ident.local_link == epp->local_link) {
+				tcp_conn_addref(conn);
+				fibril_mutex_unlock(&shard->lock);
+				return conn;
+			}
+		}
+		fibril_mutex_unlock(&shard->lock);
+	}
+
 	fibril_mutex_lock(&amap_lock);
 
 	rc = amap_find_match(amap, epp, &arg);
@@ -509,61 +734,392 @@ bool tcp_conn_got_syn(tcp_conn_t *conn)
 	assert(false);
 }
 
-/** Segment arrived in Listen state.
+/** Record options negotiated in SYN received from peer.
+ *
+ * An option is in effect if the peer has sent it in its SYN. In passive
+ * open we confirm it in our SYN-ACK, in active open we have already
+ * offered it in our SYN.
  *
  * @param conn		Connection
+ * @param seg		SYN segment
+ */
+static void tcp_conn_syn_opts(tcp_conn_t *conn, tcp_segment_t *seg)
+{
+	conn->ws_ok = seg->opts.ws_present;
+	conn->snd_wscale = conn->ws_ok ? seg->opts.ws_shift : 0;
+	conn->sack_ok = seg->opts.sack_perm;
+	conn->ts_ok = seg->opts.ts_present;
+	conn->ts_recent = conn->ts_ok ? seg->opts.ts_val : 0;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: window scale %s (%u/%u), "
+	    "SACK %s, timestamps %s", conn->name, conn->ws_ok ? "on" : "off",
+	    conn->snd_wscale, conn->rcv_wscale, conn->sack_ok ? "on" : "off",
+	    conn->ts_ok ? "on" : "off");
+}
+
+/** Determine if timestamp @a a is older than timestamp @a b. */
+static bool tcp_conn_ts_older(uint32_t a, uint32_t b)
+{
+	return (int32_t)(a - b) < 0;
+}
+
+/** Get current SYN cookie time slot number. */
+static uint32_t tcp_conn_cookie_slot(void)
+{
+	struct timeval tv;
+
+	getuptime(&tv);
+	return (tv.tv_sec / SYN_COOKIE_SLOT_SEC) & SYN_COOKIE_SLOT_MASK;
+}
+
+/** Compute SYN cookie.
+ *
+ * The cookie is used as our initial sequence number. Its top bits hold
+ * the time slot in which it was issued, the rest is a keyed hash of
+ * the endpoint pair, the peer's initial sequence number and the time slot.
+ *
+ * @param epp	Endpoint pair
+ * @param irs	Initial receive sequence number
+ * @param slot	Time slot number
+ * @return	SYN cookie
+ */
+static uint32_t tcp_conn_cookie(inet_ep2_t *epp, uint32_t irs, uint32_t slot)
+{
+	size_t hash;
+
+	hash = hash_combine(syn_cookie_secret, tcp_ep2_hash(epp));
+	hash = hash_combine(hash, irs);
+	hash = hash_combine(hash, slot);
+
+	return (slot << SYN_COOKIE_HASH_BITS) | (hash_mix32((uint32_t) hash) &
+	    ((1u << SYN_COOKIE_HASH_BITS) - 1));
+}
+
+/** Determine if SYN cookie is valid.
+ *
+ * Cookies issued in the current and in the previous time slot are valid.
+ *
+ * @param epp	Endpoint pair
+ * @param irs	Initial receive sequence number
+ * @param iss	Initial send sequence number acknowledged by peer
+ * @return	@c true if @a iss is a valid cookie
+ */
+static bool tcp_conn_cookie_valid(inet_ep2_t *epp, uint32_t irs, uint32_t iss)
+{
+	uint32_t slot = tcp_conn_cookie_slot();
+	uint32_t cslot = iss >> SYN_COOKIE_HASH_BITS;
+
+	if (cslot != slot && cslot != ((slot - 1) & SYN_COOKIE_SLOT_MASK))
+		return false;
+
+	return tcp_conn_cookie(epp, irs, cslot) == iss;
+}
+
+/** Find half-open connection in listener's SYN queue.
+ *
+ * @param conn	Listening connection
+ * @param epp	Endpoint pair
+ * @return	SYN queue entry or NULL if not found
+ */
+static tcp_syn_ent_t *tcp_conn_syn_find(tcp_conn_t *conn, inet_ep2_t *epp)
+{
+	list_foreach(conn->syn_queue, link, tcp_syn_ent_t, ent) {
+		if (tcp_ep2_equal(&ent->epp, epp))
+			return ent;
+	}
+
+	return NULL;
+}
+
+/** Remove entry from listener's SYN queue and free it.
+ *
+ * @param conn	Listening connection
+ * @param ent	SYN queue entry
+ */
+static void tcp_conn_syn_remove(tcp_conn_t *conn, tcp_syn_ent_t *ent)
+{
+	list_remove(&ent->link);
+	--conn->syn_queue_len;
+	free(ent);
+}
+
+/** Drop half-open connections whose handshake did not complete in time.
+ *
+ * Entries are appended as SYNs arrive, so the oldest are at the front.
+ *
+ * @param conn	Listening connection
+ */
+static void tcp_conn_syn_prune(tcp_conn_t *conn)
+{
+	struct timeval now;
+	tcp_syn_ent_t *ent;
+
+	getuptime(&now);
+
+	while (!list_empty(&conn->syn_queue)) {
+		ent = list_get_instance(list_first(&conn->syn_queue),
+		    tcp_syn_ent_t, link);
+		if (tv_sub_diff(&now, &ent->rcvd_tv) < SYN_QUEUE_TIMEOUT)
+			break;
+
+		log_msg(LOG_DEFAULT, LVL_DEBUG, "Dropping stale half-open "
+		    "connection.");
+		tcp_conn_syn_remove(conn, ent);
+	}
+}
+
+/** Send SYN-ACK for half-open connection.
+ *
+ * The segment is sent directly, it is not retransmitted. If it is lost,
+ * the peer will retransmit its SYN.
+ *
+ * @param conn	Listening connection
+ * @param ent	Half-open connection
+ */
+static void tcp_conn_syn_ack(tcp_conn_t *conn, tcp_syn_ent_t *ent)
+{
+	tcp_segment_t *seg;
+
+	seg = tcp_segment_make_ctrl(CTL_SYN | CTL_ACK);
+	if (seg == NULL) {
+		log_msg(LOG_DEFAULT, LVL_WARN, "Not enough memory. "
+		    "SYN-ACK not sent.");
+		return;
+	}
+
+	seg->seq = ent->iss;
+	seg->ack = ent->irs + 1;
+	/* Window in SYN segments is never scaled */
+	seg->wnd = min(conn->rcv_wnd, TCP_WND_MAX);
+
+	if (ent->ws_ok) {
+		seg->opts.ws_present = true;
+		seg->opts.ws_shift = conn->rcv_wscale;
+	}
+
+	seg->opts.sack_perm = ent->sack_ok;
+
+	if (ent->ts_ok) {
+		seg->opts.ts_present = true;
+		seg->opts.ts_val = tcp_tqueue_ts_now();
+		seg->opts.ts_ecr = ent->ts_recent;
+	}
+
+	++conn->stats.segs_sent;
+	tcp_transmit_segment(&ent->epp, seg);
+	tcp_segment_delete(seg);
+}
+
+/** Build connection for a completed handshake.
+ *
+ * @param lconn	Listening connection
+ * @param ent	Half-open connection
+ * @return	New connection in Syn-Received state with an extra reference
+ *		held for the caller or NULL if out of memory
+ */
+static tcp_conn_t *tcp_conn_syn_complete(tcp_conn_t *lconn,
+    tcp_syn_ent_t *ent)
+{
+	tcp_conn_t *nconn;
+	errno_t rc;
+
+	nconn = tcp_conn_new(&ent->epp);
+	if (nconn == NULL)
+		return NULL;
+
+	nconn->name = (char *) "a";
+	nconn->ap = ap_passive;
+	nconn->cstate = st_syn_received;
+
+	nconn->irs = ent->irs;
+	nconn->rcv_nxt = ent->irs + 1;
+	nconn->last_ack_sent = nconn->rcv_nxt;
+	nconn->rcv_adv = nconn->rcv_nxt + min(nconn->rcv_wnd, TCP_WND_MAX);
+
+	/* Our SYN has been sent */
+	nconn->iss = ent->iss;
+	nconn->snd_una = ent->iss;
+	nconn->snd_nxt = ent->iss + 1;
+
+	nconn->snd_wnd = ent->snd_wnd;
+	nconn->snd_wl1 = ent->irs;
+	nconn->snd_wl2 = ent->irs;
+
+	nconn->ws_ok = ent->ws_ok;
+	nconn->snd_wscale = ent->snd_wscale;
+	nconn->sack_ok = ent->sack_ok;
+	nconn->ts_ok = ent->ts_ok;
+	nconn->ts_recent = ent->ts_recent;
+
+	/* Listener's user is notified once the connection is established */
+	nconn->cb = lconn->cb;
+	nconn->cb_arg = lconn->cb_arg;
+
+	rc = tcp_conn_add(nconn);
+	if (rc != EOK) {
+		log_msg(LOG_DEFAULT, LVL_WARN, "Failed adding connection.");
+		nconn->cb = NULL;
+		tcp_conn_lock(nconn);
+		tcp_conn_reset(nconn);
+		tcp_conn_unlock(nconn);
+		tcp_conn_delete(nconn);
+		return NULL;
+	}
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: window scale %s (%u/%u), "
+	    "SACK %s, timestamps %s", nconn->name, nconn->ws_ok ? "on" : "off",
+	    nconn->snd_wscale, nconn->rcv_wscale, nconn->sack_ok ? "on" : "off",
+	    nconn->ts_ok ? "on" : "off");
+
+	tcp_conn_addref(nconn);
+	return nconn;
+}
+
+/** Segment arrived in Listen state.
+ *
+ * A SYN creates a lightweight entry in the listener's SYN queue and is
+ * answered with SYN-ACK. The connection itself is only created when
+ * the peer acknowledges our SYN. If the SYN queue is full and SYN cookies
+ * are enabled, no entry is created. Instead the state is encoded in our
+ * initial sequence number and reconstructed (without options) from
+ * the acknowledgement.
+ *
+ * @param conn		Listening connection
+ * @param epp		Endpoint pair on which segment was received
  * @param seg		Segment
+ * @return		New connection (with reference) which should process
+ *			@a seg or NULL if the segment has been consumed
  */
-static void tcp_conn_sa_listen(tcp_conn_t *conn, tcp_segment_t *seg)
+static tcp_conn_t *tcp_conn_sa_listen(tcp_conn_t *conn, inet_ep2_t *epp,
+    tcp_segment_t *seg)
 {
+	tcp_syn_ent_t *ent;
+	tcp_syn_ent_t cent;
+	tcp_conn_t *nconn;
+
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "tcp_conn_sa_listen(%p, %p)", conn, seg);
 
+	tcp_conn_syn_prune(conn);
+	ent = tcp_conn_syn_find(conn, epp);
+
 	if ((seg->ctrl & CTL_RST) != 0) {
-		log_msg(LOG_DEFAULT, LVL_DEBUG, "Ignoring incoming RST.");
-		return;
+		if (ent != NULL && seg->seq == ent->irs + 1) {
+			log_msg(LOG_DEFAULT, LVL_DEBUG, "Half-open connection "
+			    "reset.");
+			tcp_conn_syn_remove(conn, ent);
+		} else {
+			log_msg(LOG_DEFAULT, LVL_DEBUG, "Ignoring incoming RST.");
+		}
+		tcp_segment_delete(seg);
+		return NULL;
+	}
+
+	if ((seg->ctrl & (CTL_SYN | CTL_ACK)) == CTL_ACK) {
+		nconn = NULL;
+
+		if (ent != NULL && seg->ack == ent->iss + 1 &&
+		    seg->seq == ent->irs + 1) {
+			log_msg(LOG_DEFAULT, LVL_DEBUG, "Handshake complete.");
+			nconn = tcp_conn_syn_complete(conn, ent);
+			tcp_conn_syn_remove(conn, ent);
+			if (nconn == NULL) {
+				tcp_segment_delete(seg);
+				return NULL;
+			}
+		} else if (ent == NULL && tcp_conn_syn_cookies &&
+		    tcp_conn_cookie_valid(epp, seg->seq - 1, seg->ack - 1)) {
+			log_msg(LOG_DEFAULT, LVL_DEBUG, "Handshake complete "
+			    "(SYN cookie).");
+			memset(&cent, 0, sizeof(cent));
+			cent.epp = *epp;
+			cent.irs = seg->seq - 1;
+			cent.iss = seg->ack - 1;
+			cent.snd_wnd = seg->wnd;
+			nconn = tcp_conn_syn_complete(conn, &cent);
+			if (nconn == NULL) {
+				tcp_segment_delete(seg);
+				return NULL;
+			}
+		}
+
+		if (nconn != NULL)
+			return nconn;
 	}
 
 	if ((seg->ctrl & CTL_ACK) != 0) {
 		log_msg(LOG_DEFAULT, LVL_DEBUG, "Incoming ACK, send acceptable RST.");
-		tcp_reply_rst(&conn->ident, seg);
-		return;
+		tcp_reply_rst(epp, seg);
+		tcp_segment_delete(seg);
+		return NULL;
 	}
 
 	if ((seg->ctrl & CTL_SYN) == 0) {
 		log_msg(LOG_DEFAULT, LVL_DEBUG, "SYN not present. Ignoring segment.");
-		return;
+		tcp_segment_delete(seg);
+		return NULL;
 	}
 
-	log_msg(LOG_DEFAULT, LVL_DEBUG, "Got SYN, sending SYN, ACK.");
+	if (seg->len > 1)
+		log_msg(LOG_DEFAULT, LVL_WARN, "SYN combined with data, ignoring data.");
 
-	conn->rcv_nxt = seg->seq + 1;
-	conn->irs = seg->seq;
+	if (ent != NULL) {
+		if (seg->seq == ent->irs) {
+			log_msg(LOG_DEFAULT, LVL_DEBUG, "Duplicate SYN, "
+			    "resending SYN, ACK.");
+			tcp_conn_syn_ack(conn, ent);
+			tcp_segment_delete(seg);
+			return NULL;
+		}
 
+		/* Peer started a new connection attempt */
+		tcp_conn_syn_remove(conn, ent);
+		ent = NULL;
+	}
 
-	log_msg(LOG_DEFAULT, LVL_DEBUG, "rcv_nxt=%u", conn->rcv_nxt);
+	if (conn->syn_queue_len < SYN_QUEUE_MAX)
+		ent = calloc(1, sizeof(tcp_syn_ent_t));
 
-	if (seg->len > 1)
-		log_msg(LOG_DEFAULT, LVL_WARN, "SYN combined with data, ignoring data.");
+	if (ent == NULL) {
+		if (!tcp_conn_syn_cookies) {
+			log_msg(LOG_DEFAULT, LVL_DEBUG, "SYN queue full. "
+			    "Dropping SYN.");
+			tcp_segment_delete(seg);
+			return NULL;
+		}
 
-	/* XXX select ISS */
-	conn->iss = 1;
-	conn->snd_nxt = conn->iss;
-	conn->snd_una = conn->iss;
+		log_msg(LOG_DEFAULT, LVL_DEBUG, "SYN queue full. "
+		    "Sending SYN cookie.");
+		memset(&cent, 0, sizeof(cent));
+		ent = &cent;
+	}
+
+	ent->epp = *epp;
+	ent->irs = seg->seq;
+	ent->iss = tcp_conn_cookie(epp, seg->seq, tcp_conn_cookie_slot());
 
 	/*
 	 * Surprisingly the spec does not deal with initial window setting.
-	 * Set SND.WND = SEG.WND and set SND.WL1 so that next segment
-	 * will always be accepted as new window setting.
+	 * Remember SEG.WND, it becomes SND.WND of the new connection.
 	 */
-	conn->snd_wnd = seg->wnd;
-	conn->snd_wl1 = seg->seq;
-	conn->snd_wl2 = seg->seq;
-
-	tcp_conn_state_set(conn, st_syn_received);
-
-	tcp_tqueue_ctrl_seg(conn, CTL_SYN | CTL_ACK /* XXX */);
+	ent->snd_wnd = seg->wnd;
+
+	if (ent != &cent) {
+		/* Options cannot be encoded in SYN cookie */
+		ent->ws_ok = seg->opts.ws_present;
+		ent->snd_wscale = ent->ws_ok ? seg->opts.ws_shift : 0;
+		ent->sack_ok = seg->opts.sack_perm;
+		ent->ts_ok = seg->opts.ts_present;
+		ent->ts_recent = ent->ts_ok ? seg->opts.ts_val : 0;
+		getuptime(&ent->rcvd_tv);
+
+		list_append(&ent->link, &conn->syn_queue);
+		++conn->syn_queue_len;
+	}
 
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "Got SYN, sending SYN, ACK.");
+	tcp_conn_syn_ack(conn, ent);
 	tcp_segment_delete(seg);
+	return NULL;
 }
 
 /** Segment arrived in Syn-Sent state.
@@ -613,6 +1169,7 @@ static void tcp_conn_sa_syn_sent(tcp_conn_t *conn, tcp_segment_t *seg)
 
 	conn->rcv_nxt = seg->seq + 1;
 	conn->irs = seg->seq;
+	tcp_conn_syn_opts(conn, seg);
 
 	if ((seg->ctrl & CTL_ACK) != 0) {
 		conn->snd_una = seg->ack;
@@ -661,9 +1218,20 @@ static void tcp_conn_sa_syn_sent(tcp_conn_t *conn, tcp_segment_t *seg)
 static void tcp_conn_sa_queue(tcp_conn_t *conn, tcp_segment_t *seg)
 {
 	tcp_segment_t *pseg;
+	bool has_text;
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "tcp_conn_sa_seq(%p, %p)", conn, seg);
 
+	/* Protection against wrapped sequence numbers (RFC 7323, PAWS) */
+	if (conn->ts_ok && seg->opts.ts_present && (seg->ctrl & CTL_RST) == 0 &&
+	    tcp_conn_ts_older(seg->opts.ts_val, conn->ts_recent)) {
+		log_msg(LOG_DEFAULT, LVL_DEBUG, "Replying ACK to segment with "
+		    "old timestamp.");
+		tcp_tqueue_ctrl_seg(conn, CTL_ACK);
+		tcp_segment_delete(seg);
+		return;
+	}
+
 	/* Discard unacceptable segments ("old duplicates") */
 	if (!seq_no_segment_acceptable(conn, seg)) {
 		log_msg(LOG_DEFAULT, LVL_DEBUG, "Replying ACK to unacceptable segment.");
@@ -672,7 +1240,13 @@ static void tcp_conn_sa_queue(tcp_conn_t *conn, tcp_segment_t *seg)
 		return;
 	}
 
+	/* Remember timestamp to echo if SEG.SEQ <= Last.ACK.sent */
+	if (conn->ts_ok && seg->opts.ts_present &&
+	    (int32_t)(conn->last_ack_sent - seg->seq) >= 0)
+		conn->ts_recent = seg->opts.ts_val;
+
 	/* Queue for processing */
+	has_text = tcp_segment_text_size(seg) > 0;
 	tcp_iqueue_insert_seg(&conn->incoming, seg);
 
 	/*
@@ -683,6 +1257,14 @@ static void tcp_conn_sa_queue(tcp_conn_t *conn, tcp_segment_t *seg)
 	 */
 	while (tcp_iqueue_get_ready_seg(&conn->incoming, &pseg) == EOK)
 		tcp_conn_seg_process(conn, pseg);
+
+	/*
+	 * Acknowledge out-of-order data immediately, so that the sender
+	 * learns about the hole (duplicate ACK, SACK) as soon as possible.
+	 */
+	if (has_text && !list_empty(&conn->incoming.list) &&
+	    conn->cstate != st_closed)
+		tcp_tqueue_ctrl_seg(conn, CTL_ACK);
 }
 
 /** Process segment RST field.
@@ -699,15 +1281,11 @@ static cproc_t tcp_conn_seg_proc_rst(tcp_conn_t *conn, tcp_segment_t *seg)
 
 	switch (conn->cstate) {
 	case st_syn_received:
-		/* XXX In case of passive open, revert to Listen state */
-		if (conn->ap == ap_passive) {
-			tcp_conn_state_set(conn, st_listen);
-			/* XXX Revert conn->ident */
-			tcp_conn_tw_timer_clear(conn);
-			tcp_tqueue_clear(&conn->retransmit);
-		} else {
-			tcp_conn_reset(conn);
-		}
+		/*
+		 * A passive open has been split off the listener, which
+		 * has remained in Listen state, so just drop the connection.
+		 */
+		tcp_conn_reset(conn);
 		break;
 	case st_established:
 	case st_fin_wait_1:
@@ -810,6 +1388,8 @@ static cproc_t tcp_conn_seg_proc_ack_sr(tcp_conn_t *conn, tcp_segment_t *seg)
  */
 static cproc_t tcp_conn_seg_proc_ack_est(tcp_conn_t *conn, tcp_segment_t *seg)
 {
+	bool dupack = false;
+
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "tcp_conn_seg_proc_ack_est(%p, %p)", conn, seg);
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "SEG.ACK=%u, SND.UNA=%u, SND.NXT=%u",
@@ -827,12 +1407,24 @@ static cproc_t tcp_conn_seg_proc_ack_est(tcp_conn_t *conn, tcp_segment_t *seg)
 			return cp_done;
 		} else {
 			log_msg(LOG_DEFAULT, LVL_DEBUG, "Ignoring duplicate ACK.");
+			/* Pure duplicate ACK hints at a lost segment */
+			dupack = seg->ack == conn->snd_una &&
+			    tcp_segment_text_size(seg) == 0 &&
+			    (seg->ctrl & (CTL_SYN | CTL_FIN)) == 0 &&
+			    seg->wnd == conn->snd_wnd &&
+			    conn->snd_nxt != conn->snd_una;
 		}
 	} else {
 		/* Update SND.UNA */
 		conn->snd_una = seg->ack;
 	}
 
+	if (conn->sack_ok && seg->opts.sack_cnt > 0)
+		tcp_tqueue_sack_received(conn, &seg->opts);
+
+	if (dupack)
+		tcp_cc_dupack(conn);
+
 	if (seq_no_new_wnd_update(conn, seg)) {
 		conn->snd_wnd = seg->wnd;
 		conn->snd_wl1 = seg->seq;
@@ -1078,9 +1670,9 @@ static cproc_t tcp_conn_seg_proc_text(tcp_conn_t *conn, tcp_segment_t *seg)
 	/* Update receive window. XXX Not an efficient strategy. */
 	conn->rcv_wnd -= xfer_size;
 
-	/* Send ACK */
+	/* Send ACK, possibly delayed */
 	if (xfer_size > 0)
-		tcp_tqueue_ctrl_seg(conn, CTL_ACK);
+		tcp_tqueue_ack_delayed(conn);
 
 	if (xfer_size < seg->len) {
 		/* Trim part of segment which we just received */
@@ -1230,6 +1822,7 @@ void tcp_conn_segment_arrived(tcp_conn_t *conn, inet_ep2_t *epp,
 {
 	inet_ep2_t aepp;
 	inet_ep2_t oldepp;
+	tcp_conn_t *nconn;
 	errno_t rc;
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: tcp_conn_segment_arrived(%p)",
@@ -1244,9 +1837,11 @@ void tcp_conn_segment_arrived(tcp_conn_t *conn, inet_ep2_t *epp,
 		return;
 	}
 
-	if (inet_addr_is_any(&conn->ident.remote.addr) ||
+	/* A listener keeps its identity, connections are split off it */
+	if (conn->cstate != st_listen &&
+	    (inet_addr_is_any(&conn->ident.remote.addr) ||
 	    conn->ident.remote.port == inet_port_any ||
-	    inet_addr_is_any(&conn->ident.local.addr)) {
+	    inet_addr_is_any(&conn->ident.local.addr))) {
 
 		log_msg(LOG_DEFAULT, LVL_DEBUG2, "tcp_conn_segment_arrived: "
 		    "Changing connection ID, updating amap.");
@@ -1275,14 +1870,23 @@ void tcp_conn_segment_arrived(tcp_conn_t *conn, inet_ep2_t *epp,
 		}
 
 		amap_remove(amap, &oldepp);
+		tcp_conn_hash_insert(conn);
 		fibril_mutex_unlock(&amap_lock);
 
 		conn->name = (char *) "a";
 	}
 
+	++conn->stats.segs_rcvd;
+
+	/* Window in SYN segments is never scaled */
+	if (conn->ws_ok && (seg->ctrl & CTL_SYN) == 0)
+		seg->wnd <<= conn->snd_wscale;
+
+	nconn = NULL;
+
 	switch (conn->cstate) {
 	case st_listen:
-		tcp_conn_sa_listen(conn, seg);
+		nconn = tcp_conn_sa_listen(conn, epp, seg);
 		break;
 	case st_syn_sent:
 		tcp_conn_sa_syn_sent(conn, seg);
@@ -1304,6 +1908,12 @@ void tcp_conn_segment_arrived(tcp_conn_t *conn, inet_ep2_t *epp,
 	}
 
 	tcp_conn_unlock(conn);
+
+	if (nconn != NULL) {
+		/* Handshake completed, the new connection processes the ACK */
+		tcp_conn_segment_arrived(nconn, epp, seg);
+		tcp_conn_delref(nconn);
+	}
 }
 
 /** Time-Wait timeout handler.
@@ -144,7 +144,7 @@ void tcp_transmit_pdu(tcp_pdu_t *pdu)
 	dgram.data = pdu_raw;
 	dgram.size = pdu_raw_size;
 
-	rc = inet_send(&dgram, INET_TTL_MAX, 0);
+	rc = inet_send(&dgram, INET_TTL_MAX, INET_CSUM_PARTIAL);
 	if (rc != EOK)
 		log_msg(LOG_DEFAULT, LVL_ERROR, "Failed to transmit PDU.");
 
@@ -186,6 +186,57 @@ errno_t tcp_iqueue_get_ready_seg(tcp_iqueue_t *iqueue, tcp_segment_t **seg)
 	return EOK;
 }
 
+/** Describe queued out-of-order data as SACK blocks.
+ *
+ * Segments held in the queue beyond RCV.NXT are merged into contiguous
+ * blocks of sequence space, in increasing order of sequence number.
+ *
+ * @param iqueue	Incoming queue
+ * @param blocks	Array to store blocks to
+ * @param max_blocks	Maximum number of blocks to return
+ * @return		Number of blocks stored
+ */
+size_t tcp_iqueue_sack_blocks(tcp_iqueue_t *iqueue, tcp_sack_block_t *blocks,
+    size_t max_blocks)
+{
+	tcp_conn_t *conn = iqueue->conn;
+	uint32_t left, right;
+	size_t cnt;
+
+	cnt = 0;
+
+	/*
+	 * Work with offsets from RCV.NXT. Since the queue is sorted and
+	 * only holds segments in the receive window, they grow monotonically.
+	 */
+	list_foreach(iqueue->list, link, tcp_iqueue_entry_t, iqe) {
+		if (iqe->seg->len == 0)
+			continue;
+
+		left = iqe->seg->seq - conn->rcv_nxt;
+		right = left + iqe->seg->len;
+		if (left == 0 || left >= conn->rcv_wnd)
+			continue;
+
+		if (cnt > 0 &&
+		    left <= blocks[cnt - 1].right - conn->rcv_nxt) {
+			/* Overlaps or adjoins previous block */
+			if (right > blocks[cnt - 1].right - conn->rcv_nxt)
+				blocks[cnt - 1].right = conn->rcv_nxt + right;
+			continue;
+		}
+
+		if (cnt == max_blocks)
+			break;
+
+		blocks[cnt].left = conn->rcv_nxt + left;
+		blocks[cnt].right = conn->rcv_nxt + right;
+		++cnt;
+	}
+
+	return cnt;
+}
+
 /**
  * @}
  */
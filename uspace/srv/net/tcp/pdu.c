@@ -37,7 +37,9 @@
 #include <bitops.h>
 #include <byteorder.h>
 #include <errno.h>
+#include <inet/checksum.h>
 #include <inet/endpoint.h>
+#include <macros.h>
 #include <mem.h>
 #include <stdlib.h>
 #include "pdu.h"
@@ -46,44 +48,6 @@
 #include "std.h"
 #include "tcp_type.h"
 
-#define TCP_CHECKSUM_INIT 0xffff
-
-/** One's complement addition.
- *
- * Result is a + b + carry.
- */
-static uint16_t tcp_ocadd16(uint16_t a, uint16_t b)
-{
-	uint32_t s;
-
-	s = (uint32_t)a + (uint32_t)b;
-	return (s & 0xffff) + (s >> 16);
-}
-
-static uint16_t tcp_checksum_calc(uint16_t ivalue, void *data, size_t size)
-{
-	uint16_t sum;
-	uint16_t w;
-	size_t words, i;
-	uint8_t *bdata;
-
-	sum = ~ivalue;
-	words = size / 2;
-	bdata = (uint8_t *)data;
-
-	for (i = 0; i < words; i++) {
-		w = ((uint16_t)bdata[2 * i] << 8) | bdata[2 * i + 1];
-		sum = tcp_ocadd16(sum, w);
-	}
-
-	if (size % 2 != 0) {
-		w = ((uint16_t)bdata[2 * words] << 8);
-		sum = tcp_ocadd16(sum, w);
-	}
-
-	return ~sum;
-}
-
 static void tcp_header_decode_flags(uint16_t doff_flags, tcp_control_t *rctl)
 {
 	tcp_control_t ctl;
@@ -125,7 +89,8 @@ static void tcp_header_encode_flags(tcp_control_t ctl, uint16_t doff_flags0,
 	*rdoff_flags = doff_flags;
 }
 
-static void tcp_header_setup(inet_ep2_t *epp, tcp_segment_t *seg, tcp_header_t *hdr)
+static void tcp_header_setup(inet_ep2_t *epp, tcp_segment_t *seg,
+    tcp_header_t *hdr, size_t hdr_size)
 {
 	uint16_t doff_flags;
 	uint16_t doff;
@@ -135,7 +100,7 @@ static void tcp_header_setup(inet_ep2_t *epp, tcp_segment_t *seg, tcp_header_t *
 	hdr->seq = host2uint32_t_be(seg->seq);
 	hdr->ack = host2uint32_t_be(seg->ack);
 
-	doff = (sizeof(tcp_header_t) / sizeof(uint32_t)) << DF_DATA_OFFSET_l;
+	doff = (hdr_size / sizeof(uint32_t)) << DF_DATA_OFFSET_l;
 	tcp_header_encode_flags(seg->ctrl, doff, &doff_flags);
 
 	hdr->doff_flags = host2uint16_t_be(doff_flags);
@@ -181,6 +146,162 @@ static ip_ver_t tcp_phdr_setup(tcp_pdu_t *pdu, tcp_phdr_t *phdr,
 	return src_ver;
 }
 
+/** Compute size of encoded segment options.
+ *
+ * @param opts	Segment options
+ * @return	Size of options area in bytes, a multiple of four
+ */
+static size_t tcp_opts_size(tcp_seg_opts_t *opts)
+{
+	size_t size = 0;
+
+	/* Options are NOP-padded to start at a 32-bit boundary */
+	if (opts->ws_present)
+		size += 1 + OPT_WINDOW_SCALE_LEN;
+	if (opts->ts_present)
+		size += 2 + OPT_TIMESTAMP_LEN;
+	if (opts->sack_perm)
+		size += 2 + OPT_SACK_PERMITTED_LEN;
+	if (opts->sack_cnt > 0) {
+		size += 2 + OPT_SACK_LEN + opts->sack_cnt *
+		    OPT_SACK_BLOCK_LEN;
+	}
+
+	assert(size % sizeof(uint32_t) == 0);
+	return size;
+}
+
+static uint8_t *tcp_opt_put32(uint8_t *bp, uint32_t val)
+{
+	bp[0] = (val >> 24) & 0xff;
+	bp[1] = (val >> 16) & 0xff;
+	bp[2] = (val >> 8) & 0xff;
+	bp[3] = val & 0xff;
+	return bp + 4;
+}
+
+static uint32_t tcp_opt_get32(uint8_t *bp)
+{
+	return ((uint32_t)bp[0] << 24) | ((uint32_t)bp[1] << 16) |
+	    ((uint32_t)bp[2] << 8) | bp[3];
+}
+
+/** Encode segment options.
+ *
+ * @param opts	Segment options
+ * @param buf	Buffer of size returned by tcp_opts_size()
+ */
+static void tcp_opts_encode(tcp_seg_opts_t *opts, uint8_t *buf)
+{
+	uint8_t *bp = buf;
+	size_t i;
+
+	if (opts->ws_present) {
+		*bp++ = OPT_NOP;
+		*bp++ = OPT_WINDOW_SCALE;
+		*bp++ = OPT_WINDOW_SCALE_LEN;
+		*bp++ = opts->ws_shift;
+	}
+
+	if (opts->ts_present) {
+		*bp++ = OPT_NOP;
+		*bp++ = OPT_NOP;
+		*bp++ = OPT_TIMESTAMP;
+		*bp++ = OPT_TIMESTAMP_LEN;
+		bp = tcp_opt_put32(bp, opts->ts_val);
+		bp = tcp_opt_put32(bp, opts->ts_ecr);
+	}
+
+	if (opts->sack_perm) {
+		*bp++ = OPT_NOP;
+		*bp++ = OPT_NOP;
+		*bp++ = OPT_SACK_PERMITTED;
+		*bp++ = OPT_SACK_PERMITTED_LEN;
+	}
+
+	if (opts->sack_cnt > 0) {
+		*bp++ = OPT_NOP;
+		*bp++ = OPT_NOP;
+		*bp++ = OPT_SACK;
+		*bp++ = OPT_SACK_LEN + opts->sack_cnt * OPT_SACK_BLOCK_LEN;
+		for (i = 0; i < opts->sack_cnt; i++) {
+			bp = tcp_opt_put32(bp, opts->sack[i].left);
+			bp = tcp_opt_put32(bp, opts->sack[i].right);
+		}
+	}
+}
+
+/** Decode segment options.
+ *
+ * Unknown or malformed options are skipped, an option with invalid length
+ * terminates decoding.
+ *
+ * @param buf	Options area
+ * @param size	Size of options area in bytes
+ * @param opts	Place to store decoded options
+ */
+static void tcp_opts_decode(uint8_t *buf, size_t size, tcp_seg_opts_t *opts)
+{
+	uint8_t kind, len;
+	size_t off, i;
+
+	memset(opts, 0, sizeof(tcp_seg_opts_t));
+
+	off = 0;
+	while (off < size) {
+		kind = buf[off];
+		if (kind == OPT_END_LIST)
+			break;
+		if (kind == OPT_NOP) {
+			++off;
+			continue;
+		}
+
+		if (size - off < 2)
+			break;
+		len = buf[off + 1];
+		if (len < 2 || len > size - off)
+			break;
+
+		switch (kind) {
+		case OPT_WINDOW_SCALE:
+			if (len != OPT_WINDOW_SCALE_LEN)
+				break;
+			opts->ws_present = true;
+			opts->ws_shift = min(buf[off + 2], TCP_WSCALE_MAX);
+			break;
+		case OPT_SACK_PERMITTED:
+			if (len != OPT_SACK_PERMITTED_LEN)
+				break;
+			opts->sack_perm = true;
+			break;
+		case OPT_TIMESTAMP:
+			if (len != OPT_TIMESTAMP_LEN)
+				break;
+			opts->ts_present = true;
+			opts->ts_val = tcp_opt_get32(&buf[off + 2]);
+			opts->ts_ecr = tcp_opt_get32(&buf[off + 6]);
+			break;
+		case OPT_SACK:
+			if ((len - OPT_SACK_LEN) % OPT_SACK_BLOCK_LEN != 0)
+				break;
+			opts->sack_cnt = min((len - OPT_SACK_LEN) /
+			    OPT_SACK_BLOCK_LEN, TCP_SACK_BLOCKS_MAX);
+			for (i = 0; i < opts->sack_cnt; i++) {
+				opts->sack[i].left = tcp_opt_get32(&buf[off +
+				    OPT_SACK_LEN + i * OPT_SACK_BLOCK_LEN]);
+				opts->sack[i].right = tcp_opt_get32(&buf[off +
+				    OPT_SACK_LEN + i * OPT_SACK_BLOCK_LEN + 4]);
+			}
+			break;
+		default:
+			break;
+		}
+
+		off += len;
+	}
+}
+
 static void tcp_header_decode(tcp_header_t *hdr, tcp_segment_t *seg)
 {
 	tcp_header_decode_flags(uint16_t_be2host(hdr->doff_flags), &seg->ctrl);
@@ -194,14 +315,19 @@ static errno_t tcp_header_encode(inet_ep2_t *epp, tcp_segment_t *seg,
     void **header, size_t *size)
 {
 	tcp_header_t *hdr;
+	size_t hdr_size;
+
+	hdr_size = sizeof(tcp_header_t) + tcp_opts_size(&seg->opts);
+	assert(hdr_size <= sizeof(tcp_header_t) + TCP_OPTS_MAX_SIZE);
 
-	hdr = calloc(1, sizeof(tcp_header_t));
+	hdr = calloc(1, hdr_size);
 	if (hdr == NULL)
 		return ENOMEM;
 
-	tcp_header_setup(epp, seg, hdr);
+	tcp_header_setup(epp, seg, hdr, hdr_size);
+	tcp_opts_encode(&seg->opts, (uint8_t *)(hdr + 1));
 	*header = hdr;
-	*size = sizeof(tcp_header_t);
+	*size = hdr_size;
 
 	return EOK;
 }
@@ -260,29 +386,36 @@ void tcp_pdu_delete(tcp_pdu_t *pdu)
 	free(pdu);
 }
 
-static uint16_t tcp_pdu_checksum_calc(tcp_pdu_t *pdu)
+/** Compute partial checksum of PDU.
+ *
+ * Only the pseudo-header is summed. The result is stored in the checksum
+ * field and the sum is completed over the segment by inetsrv or by the NIC
+ * (see INET_CSUM_PARTIAL).
+ *
+ * @param pdu PDU
+ * @return Ones' complement sum of the pseudo-header
+ */
+static uint16_t tcp_pdu_checksum_phdr(tcp_pdu_t *pdu)
 {
 	uint16_t cs_phdr;
-	uint16_t cs_headers;
 	tcp_phdr_t phdr;
 	tcp_phdr6_t phdr6;
 
 	ip_ver_t ver = tcp_phdr_setup(pdu, &phdr, &phdr6);
 	switch (ver) {
 	case ip_v4:
-		cs_phdr = tcp_checksum_calc(TCP_CHECKSUM_INIT, (void *) &phdr,
+		cs_phdr = inet_checksum_calc(INET_CHECKSUM_INIT, &phdr,
 		    sizeof(tcp_phdr_t));
 		break;
 	case ip_v6:
-		cs_phdr = tcp_checksum_calc(TCP_CHECKSUM_INIT, (void *) &phdr6,
+		cs_phdr = inet_checksum_calc(INET_CHECKSUM_INIT, &phdr6,
 		    sizeof(tcp_phdr6_t));
 		break;
 	default:
 		assert(false);
 	}
 
-	cs_headers = tcp_checksum_calc(cs_phdr, pdu->header, pdu->header_size);
-	return tcp_checksum_calc(cs_headers, pdu->text, pdu->text_size);
+	return ~cs_phdr;
 }
 
 static void tcp_pdu_set_checksum(tcp_pdu_t *pdu, uint16_t checksum)
@@ -305,6 +438,8 @@ errno_t tcp_pdu_decode(tcp_pdu_t *pdu, inet_ep2_t *epp, tcp_segment_t **seg)
 
 	tcp_header_decode(pdu->header, nseg);
 	nseg->len += seq_no_control_len(nseg->ctrl);
+	tcp_opts_decode((uint8_t *)pdu->header + sizeof(tcp_header_t),
+	    pdu->header_size - sizeof(tcp_header_t), &nseg->opts);
 
 	hdr = (tcp_header_t *)pdu->header;
 
@@ -322,7 +457,6 @@ errno_t tcp_pdu_encode(inet_ep2_t *epp, tcp_segment_t *seg, tcp_pdu_t **pdu)
 {
 	tcp_pdu_t *npdu;
 	size_t text_size;
-	uint16_t checksum;
 	errno_t rc;
 
 	npdu = tcp_pdu_new();
@@ -348,9 +482,8 @@ errno_t tcp_pdu_encode(inet_ep2_t *epp, tcp_segment_t *seg, tcp_pdu_t **pdu)
 	npdu->text_size = text_size;
 	memcpy(npdu->text, seg->data, text_size);
 
-	/* Checksum calculation */
-	checksum = tcp_pdu_checksum_calc(npdu);
-	tcp_pdu_set_checksum(npdu, checksum);
+	/* Partial checksum, completed when sent */
+	tcp_pdu_set_checksum(npdu, tcp_pdu_checksum_phdr(npdu));
 
 	*pdu = npdu;
 	return EOK;
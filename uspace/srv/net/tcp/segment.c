@@ -36,22 +36,30 @@
 
 #include <io/log.h>
 #include <mem.h>
+#include <slab.h>
 #include <stdlib.h>
 #include "segment.h"
 #include "seq_no.h"
 #include "tcp_type.h"
 
+static SLAB_CACHE_INITIALIZE(segment_cache, "tcp_segment_t",
+    sizeof(tcp_segment_t), 0, NULL, NULL);
+
 /** Alocate new segment structure. */
 static tcp_segment_t *tcp_segment_new(void)
 {
-	return calloc(1, sizeof(tcp_segment_t));
+	tcp_segment_t *seg = slab_alloc(&segment_cache);
+	if (seg != NULL)
+		memset(seg, 0, sizeof(tcp_segment_t));
+
+	return seg;
 }
 
 /** Delete segment. */
 void tcp_segment_delete(tcp_segment_t *seg)
 {
 	free(seg->dfptr);
-	free(seg);
+	slab_free(&segment_cache, seg);
 }
 
 /** Create duplicate of segment.
@@ -74,11 +82,12 @@ tcp_segment_t *tcp_segment_dup(tcp_segment_t *seg)
 	scopy->len = seg->len;
 	scopy->wnd = seg->wnd;
 	scopy->up = seg->up;
+	scopy->opts = seg->opts;
 
 	tsize = tcp_segment_text_size(seg);
 	scopy->data = calloc(tsize, 1);
 	if (scopy->data == NULL) {
-		free(scopy);
+		slab_free(&segment_cache, scopy);
 		return NULL;
 	}
 
@@ -149,7 +158,7 @@ tcp_segment_t *tcp_segment_make_data(tcp_control_t ctrl, void *data,
 
 	seg->dfptr = seg->data = malloc(size);
 	if (seg->dfptr == NULL) {
-		free(seg);
+		slab_free(&segment_cache, seg);
 		return NULL;
 	}
 
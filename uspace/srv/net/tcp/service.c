@@ -34,8 +34,10 @@
  * @file HelenOS service implementation
  */
 
+#include <as.h>
 #include <async.h>
 #include <errno.h>
+#include <fibril.h>
 #include <str_error.h>
 #include <inet/endpoint.h>
 #include <inet/inet.h>
@@ -57,6 +59,9 @@
 /** Maximum amount of data transferred in one send call */
 #define MAX_MSG_SIZE DATA_XFER_LIMIT
 
+/** Maximum number of new connections announced in one event */
+#define MAX_NEW_CONNS (DATA_XFER_LIMIT / sizeof(sysarg_t))
+
 static void tcp_ev_data(tcp_cconn_t *);
 static void tcp_ev_connected(tcp_cconn_t *);
 static void tcp_ev_conn_failed(tcp_cconn_t *);
@@ -75,7 +80,7 @@ static tcp_cb_t tcp_service_cb = {
 	.recv_data = tcp_service_recv_data
 };
 
-/** Sentinel connection callbacks to tie us to lower layer */
+/** Listener connection callbacks to tie us to lower layer */
 static tcp_cb_t tcp_service_lst_cb = {
 	.cstate_change = tcp_service_lst_cstate_change,
 	.recv_data = NULL
@@ -119,10 +124,13 @@ static void tcp_service_cstate_change(tcp_conn_t *conn, void *arg,
 		tcp_ev_conn_failed(cconn);
 }
 
-/** Sentinel connection state has changed.
+/** Listener connection state has changed.
  *
- * @param conn      Connection
- * @param arg       Argument (not used)
+ * Connections split off the listener keep the listener callbacks until
+ * they become established, then they are handed over to the client.
+ *
+ * @param conn      Listener connection or connection split off it
+ * @param arg       Client listener
  * @param old_state Previous connection state
  */
 static void tcp_service_lst_cstate_change(tcp_conn_t *conn, void *arg,
@@ -131,59 +139,35 @@ static void tcp_service_lst_cstate_change(tcp_conn_t *conn, void *arg,
 	tcp_cstate_t nstate;
 	tcp_clst_t *clst;
 	tcp_cconn_t *cconn;
-	inet_ep2_t epp;
 	errno_t rc;
-	tcp_error_t trc;
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "tcp_service_lst_cstate_change()");
 	nstate = conn->cstate;
 	clst = tcp_uc_get_userptr(conn);
 
-	if ((old_state == st_syn_sent || old_state == st_syn_received) &&
-	    (nstate == st_established)) {
-		/* Connection established */
-		clst->conn = NULL;
+	/* Listener itself stays in Listen state until it is destroyed */
+	if (conn == clst->conn)
+		return;
 
+	if (old_state == st_syn_received && nstate == st_established) {
+		/* Connection established */
 		rc = tcp_cconn_create(clst->client, conn, &cconn);
 		if (rc != EOK) {
 			/* XXX Could not create client connection */
 			return;
 		}
 
-		/* XXX Is there a race here (i.e. the connection is already active)? */
 		tcp_uc_set_cb(conn, &tcp_service_cb, cconn);
 
 		/* New incoming connection */
 		tcp_ev_new_conn(clst, cconn);
-	}
-
-	if (old_state != st_closed && nstate == st_closed && conn->reset) {
-		/* Connection reset */
-		/* XXX */
-	}
-
-	/* XXX Failed to establish connection */
-	if (0) {
-		/* XXX */
-	}
-
-	/* Replenish sentinel connection */
-
-	inet_ep2_init(&epp);
-	epp.local = clst->elocal;
-
-	trc = tcp_uc_open(&epp, ap_passive, tcp_open_nonblock,
-	    &conn);
-	if (trc != TCP_EOK) {
-		/* XXX Could not replenish connection */
 		return;
 	}
 
-	conn->name = (char *) "s";
-	clst->conn = conn;
-
-	/* XXX Is there a race here (i.e. the connection is already active)? */
-	tcp_uc_set_cb(conn, &tcp_service_lst_cb, clst);
+	if (nstate == st_closed) {
+		/* Connection failed before it was handed over to the client */
+		tcp_uc_delete(conn);
+	}
 }
 
 /** Received data became available on connection.
@@ -269,23 +253,141 @@ static void tcp_ev_conn_reset(tcp_cconn_t *cconn)
 	async_forget(req);
 }
 
+/** Send 'new_conn' or 'new_conns' event to client.
+ *
+ * @param clst Client listener that received the connections
+ * @param ids  IDs of new client connections
+ * @param cnt  Number of entries in @a ids
+ */
+static void tcp_ev_new_conns(tcp_clst_t *clst, sysarg_t *ids, size_t cnt)
+{
+	async_exch_t *exch;
+	aid_t req;
+	errno_t rc;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "tcp_ev_new_conns(%zu)", cnt);
+
+	exch = async_exchange_begin(clst->client->sess);
+
+	if (cnt == 1) {
+		req = async_send_2(exch, TCP_EV_NEW_CONN, clst->id, ids[0],
+		    NULL);
+	} else {
+		req = async_send_2(exch, TCP_EV_NEW_CONNS, clst->id, cnt,
+		    NULL);
+		rc = async_data_write_start(exch, ids, cnt * sizeof(sysarg_t));
+		if (rc != EOK) {
+			log_msg(LOG_DEFAULT, LVL_WARN, "Failed sending "
+			    "new connections: %s", str_error(rc));
+		}
+	}
+
+	async_exchange_end(exch);
+	async_forget(req);
+}
+
+/** Announce accepted connections to client.
+ *
+ * Connections which complete their handshake while the previous batch
+ * is being sent or before this fibril gets to run are announced together.
+ *
+ * @param arg Client listener
+ * @return EOK
+ */
+static errno_t tcp_clst_flush_fibril(void *arg)
+{
+	tcp_clst_t *clst = (tcp_clst_t *) arg;
+	sysarg_t *ids;
+	size_t cnt;
+	size_t i;
+	bool destroyed;
+
+	fibril_mutex_lock(&clst->lock);
+
+	while (clst->pending_cnt > 0 && !clst->destroyed) {
+		ids = clst->pending;
+		cnt = clst->pending_cnt;
+
+		clst->pending = NULL;
+		clst->pending_cnt = 0;
+		clst->pending_alloc = 0;
+
+		fibril_mutex_unlock(&clst->lock);
+
+		for (i = 0; i < cnt; i += MAX_NEW_CONNS) {
+			fibril_mutex_lock(&clst->lock);
+			destroyed = clst->destroyed;
+			fibril_mutex_unlock(&clst->lock);
+
+			if (destroyed)
+				break;
+
+			tcp_ev_new_conns(clst, ids + i,
+			    min(cnt - i, MAX_NEW_CONNS));
+		}
+
+		free(ids);
+		fibril_mutex_lock(&clst->lock);
+	}
+
+	clst->flush_active = false;
+	destroyed = clst->destroyed;
+
+	fibril_mutex_unlock(&clst->lock);
+
+	if (destroyed) {
+		free(clst->pending);
+		free(clst);
+	}
+
+	return EOK;
+}
+
 /** Send 'new_conn' event to client.
+ *
+ * The event is queued and sent from a separate fibril, possibly together
+ * with other new connections.
  *
  * @param clst Client listener that received the connection
  * @param cconn New client connection
  */
 static void tcp_ev_new_conn(tcp_clst_t *clst, tcp_cconn_t *cconn)
 {
-	async_exch_t *exch;
+	sysarg_t *npending;
+	size_t nalloc;
+	fid_t fid;
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "tcp_ev_new_conn()");
 
-	exch = async_exchange_begin(clst->client->sess);
-	aid_t req = async_send_2(exch, TCP_EV_NEW_CONN, clst->id, cconn->id,
-	    NULL);
-	async_exchange_end(exch);
+	fibril_mutex_lock(&clst->lock);
 
-	async_forget(req);
+	if (clst->pending_cnt >= clst->pending_alloc) {
+		nalloc = max(2 * clst->pending_alloc, 8);
+		npending = realloc(clst->pending, nalloc * sizeof(sysarg_t));
+		if (npending == NULL)
+			goto error;
+
+		clst->pending = npending;
+		clst->pending_alloc = nalloc;
+	}
+
+	if (!clst->flush_active) {
+		fid = fibril_create(tcp_clst_flush_fibril, clst);
+		if (fid == 0)
+			goto error;
+
+		clst->flush_active = true;
+		fibril_add_ready(fid);
+	}
+
+	clst->pending[clst->pending_cnt++] = cconn->id;
+	fibril_mutex_unlock(&clst->lock);
+	return;
+error:
+	fibril_mutex_unlock(&clst->lock);
+
+	/* Announce the connection right away */
+	tcp_ev_new_conns(clst, &cconn->id, 1);
 }
 
 /** Create client connection.
@@ -308,6 +410,8 @@ static errno_t tcp_cconn_create(tcp_client_t *client, tcp_conn_t *conn,
 	if (cconn == NULL)
 		return ENOMEM;
 
+	fibril_mutex_lock(&client->lock);
+
 	/* Allocate new ID */
 	id = 0;
 	list_foreach (client->cconn, lclient, tcp_cconn_t, cconn) {
@@ -320,6 +424,8 @@ static errno_t tcp_cconn_create(tcp_client_t *client, tcp_conn_t *conn,
 	cconn->conn = conn;
 
 	list_append(&cconn->lclient, &client->cconn);
+	fibril_mutex_unlock(&client->lock);
+
 	*rcconn = cconn;
 	return EOK;
 }
@@ -330,17 +436,21 @@ static errno_t tcp_cconn_create(tcp_client_t *client, tcp_conn_t *conn,
  */
 static void tcp_cconn_destroy(tcp_cconn_t *cconn)
 {
+	fibril_mutex_lock(&cconn->client->lock);
 	list_remove(&cconn->lclient);
+	fibril_mutex_unlock(&cconn->client->lock);
+
+	if (cconn->shm != NULL)
+		as_area_destroy(cconn->shm);
 	free(cconn);
 }
 
 /** Create client listener.
  *
- * Create client listener based on sentinel connection.
- * XXX Implement actual listener in protocol core
+ * Create client listener based on listening connection.
  *
  * @param client TCP client
- * @param conn   Sentinel connection
+ * @param conn   Listening connection
  * @param rclst  Place to store pointer to new client listener
  *
  * @return EOK on success or ENOMEM if out of memory
@@ -355,6 +465,10 @@ static errno_t tcp_clistener_create(tcp_client_t *client, tcp_conn_t *conn,
 	if (clst == NULL)
 		return ENOMEM;
 
+	fibril_mutex_initialize(&clst->lock);
+
+	fibril_mutex_lock(&client->lock);
+
 	/* Allocate new ID */
 	id = 0;
 	list_foreach (client->clst, lclient, tcp_clst_t, clst) {
@@ -367,6 +481,8 @@ static errno_t tcp_clistener_create(tcp_client_t *client, tcp_conn_t *conn,
 	clst->conn = conn;
 
 	list_append(&clst->lclient, &client->clst);
+	fibril_mutex_unlock(&client->lock);
+
 	*rclst = clst;
 	return EOK;
 }
@@ -377,7 +493,21 @@ static errno_t tcp_clistener_create(tcp_client_t *client, tcp_conn_t *conn,
  */
 static void tcp_clistener_destroy(tcp_clst_t *clst)
 {
+	fibril_mutex_lock(&clst->client->lock);
 	list_remove(&clst->lclient);
+	fibril_mutex_unlock(&clst->client->lock);
+
+	fibril_mutex_lock(&clst->lock);
+	if (clst->flush_active) {
+		/* Flush fibril will free the listener */
+		clst->destroyed = true;
+		fibril_mutex_unlock(&clst->lock);
+		return;
+	}
+
+	fibril_mutex_unlock(&clst->lock);
+
+	free(clst->pending);
 	free(clst);
 }
 
@@ -393,13 +523,17 @@ static void tcp_clistener_destroy(tcp_clst_t *clst)
 static errno_t tcp_cconn_get(tcp_client_t *client, sysarg_t id,
     tcp_cconn_t **rcconn)
 {
+	fibril_mutex_lock(&client->lock);
+
 	list_foreach (client->cconn, lclient, tcp_cconn_t, cconn) {
 		if (cconn->id == id) {
 			*rcconn = cconn;
+			fibril_mutex_unlock(&client->lock);
 			return EOK;
 		}
 	}
 
+	fibril_mutex_unlock(&client->lock);
 	return ENOENT;
 }
 
@@ -415,13 +549,17 @@ static errno_t tcp_cconn_get(tcp_client_t *client, sysarg_t id,
 static errno_t tcp_clistener_get(tcp_client_t *client, sysarg_t id,
     tcp_clst_t **rclst)
 {
+	fibril_mutex_lock(&client->lock);
+
 	list_foreach (client->clst, lclient, tcp_clst_t, clst) {
 		if (clst->id == id) {
 			*rclst = clst;
+			fibril_mutex_unlock(&client->lock);
 			return EOK;
 		}
 	}
 
+	fibril_mutex_unlock(&client->lock);
 	return ENOENT;
 }
 
@@ -566,9 +704,9 @@ static errno_t tcp_listener_destroy_impl(tcp_client_t *client, sysarg_t lst_id)
 		return ENOENT;
 	}
 
-#if 0
-	tcp_uc_close(cconn->conn);
-#endif
+	tcp_uc_set_cb(clst->conn, NULL, NULL);
+	tcp_uc_close(clst->conn);
+	tcp_uc_delete(clst->conn);
 	tcp_clistener_destroy(clst);
 	return EOK;
 }
@@ -611,6 +749,7 @@ static errno_t tcp_conn_push_impl(tcp_client_t *client, sysarg_t conn_id)
 {
 	tcp_cconn_t *cconn;
 	errno_t rc;
+	tcp_error_t trc;
 
 	rc = tcp_cconn_get(client, conn_id, &cconn);
 	if (rc != EOK) {
@@ -618,8 +757,73 @@ static errno_t tcp_conn_push_impl(tcp_client_t *client, sysarg_t conn_id)
 		return ENOENT;
 	}
 
-	(void) cconn;
-	/* XXX TODO */
+	trc = tcp_uc_send(cconn->conn, NULL, 0, XF_PUSH);
+	if (trc != TCP_EOK)
+		return EIO;
+
+	return EOK;
+}
+
+/** Set connection no-delay option.
+ *
+ * Handle client request to set connection no-delay option (with parameters
+ * unmarshalled).
+ *
+ * @param client  TCP client
+ * @param conn_id Connection ID
+ * @param nodelay @c true to disable delaying of small segments
+ *
+ * @return EOK on success or an error code
+ */
+static errno_t tcp_conn_set_nodelay_impl(tcp_client_t *client,
+    sysarg_t conn_id, bool nodelay)
+{
+	tcp_cconn_t *cconn;
+	errno_t rc;
+	tcp_error_t trc;
+
+	rc = tcp_cconn_get(client, conn_id, &cconn);
+	if (rc != EOK) {
+		assert(rc == ENOENT);
+		return ENOENT;
+	}
+
+	trc = tcp_uc_set_nodelay(cconn->conn, nodelay);
+	if (trc != TCP_EOK)
+		return EIO;
+
+	return EOK;
+}
+
+/** Send data from shared memory.
+ *
+ * Handle client request to send data from shared send buffer (with
+ * parameters unmarshalled).
+ *
+ * @param client  TCP client
+ * @param conn_id Connection ID
+ * @param size    Number of bytes to send
+ *
+ * @return EOK on success or an error code
+ */
+static errno_t tcp_conn_shm_send_impl(tcp_client_t *client, sysarg_t conn_id,
+    size_t size)
+{
+	tcp_cconn_t *cconn;
+	errno_t rc;
+	tcp_error_t trc;
+
+	rc = tcp_cconn_get(client, conn_id, &cconn);
+	if (rc != EOK)
+		return rc;
+
+	if (cconn->shm == NULL || size > cconn->shm_bsize)
+		return EINVAL;
+
+	trc = tcp_uc_send(cconn->conn, cconn->shm, size, 0);
+	if (trc != TCP_EOK)
+		return EIO;
+
 	return EOK;
 }
 
@@ -647,6 +851,33 @@ static errno_t tcp_conn_reset_impl(tcp_client_t *client, sysarg_t conn_id)
 	return EOK;
 }
 
+/** Get connection statistics.
+ *
+ * Handle client request to get connection statistics (with parameters
+ * unmarshalled).
+ *
+ * @param client  TCP client
+ * @param conn_id Connection ID
+ * @param stats   Place to store statistics
+ *
+ * @return EOK on success or an error code
+ */
+static errno_t tcp_conn_get_stats_impl(tcp_client_t *client, sysarg_t conn_id,
+    tcp_conn_stats_t *stats)
+{
+	tcp_cconn_t *cconn;
+	errno_t rc;
+
+	rc = tcp_cconn_get(client, conn_id, &cconn);
+	if (rc != EOK) {
+		assert(rc == ENOENT);
+		return ENOENT;
+	}
+
+	tcp_uc_get_stats(cconn->conn, stats);
+	return EOK;
+}
+
 /** Send data over connection..
  *
  * Handle client request to send data (with parameters unmarshalled).
@@ -923,6 +1154,154 @@ static void tcp_conn_push_srv(tcp_client_t *client,
 	async_answer_0(icall_handle, rc);
 }
 
+/** Set up shared memory.
+ *
+ * Handle client request to set up memory shared with the client for
+ * data transfer.
+ *
+ * @param client        TCP client
+ * @param icall_handle  Async request call handle
+ * @param icall         Async request data
+ */
+static void tcp_conn_shm_setup_srv(tcp_client_t *client,
+    cap_call_handle_t icall_handle, ipc_call_t *icall)
+{
+	cap_call_handle_t chandle;
+	tcp_cconn_t *cconn;
+	sysarg_t conn_id;
+	size_t bsize;
+	size_t size;
+	unsigned int flags;
+	void *shm;
+	errno_t rc;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "tcp_conn_shm_setup_srv()");
+
+	if (!async_share_out_receive(&chandle, &size, &flags)) {
+		async_answer_0(chandle, EREFUSED);
+		async_answer_0(icall_handle, EREFUSED);
+		return;
+	}
+
+	conn_id = IPC_GET_ARG1(*icall);
+	bsize = IPC_GET_ARG2(*icall);
+
+	rc = tcp_cconn_get(client, conn_id, &cconn);
+	if (rc != EOK) {
+		async_answer_0(chandle, rc);
+		async_answer_0(icall_handle, rc);
+		return;
+	}
+
+	if (bsize == 0 || bsize > size / 2 ||
+	    (flags & (AS_AREA_READ | AS_AREA_WRITE)) !=
+	    (AS_AREA_READ | AS_AREA_WRITE)) {
+		async_answer_0(chandle, EINVAL);
+		async_answer_0(icall_handle, EINVAL);
+		return;
+	}
+
+	rc = async_share_out_finalize(chandle, &shm);
+	if (rc != EOK || shm == AS_MAP_FAILED) {
+		async_answer_0(icall_handle, ENOMEM);
+		return;
+	}
+
+	if (cconn->shm != NULL)
+		as_area_destroy(cconn->shm);
+
+	cconn->shm = shm;
+	cconn->shm_bsize = bsize;
+	async_answer_0(icall_handle, EOK);
+}
+
+/** Send data from shared memory.
+ *
+ * Handle client request to send data from shared send buffer.
+ *
+ * @param client        TCP client
+ * @param icall_handle  Async request call handle
+ * @param icall         Async request data
+ */
+static void tcp_conn_shm_send_srv(tcp_client_t *client,
+    cap_call_handle_t icall_handle, ipc_call_t *icall)
+{
+	sysarg_t conn_id;
+	size_t size;
+	errno_t rc;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "tcp_conn_shm_send_srv()");
+
+	conn_id = IPC_GET_ARG1(*icall);
+	size = IPC_GET_ARG2(*icall);
+	rc = tcp_conn_shm_send_impl(client, conn_id, size);
+	async_answer_0(icall_handle, rc);
+}
+
+/** Receive data to shared memory.
+ *
+ * Handle client request to receive data into shared receive buffer.
+ *
+ * @param client        TCP client
+ * @param icall_handle  Async request call handle
+ * @param icall         Async request data
+ */
+static void tcp_conn_shm_recv_srv(tcp_client_t *client,
+    cap_call_handle_t icall_handle, ipc_call_t *icall)
+{
+	tcp_cconn_t *cconn;
+	sysarg_t conn_id;
+	size_t rsize;
+	errno_t rc;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "tcp_conn_shm_recv_srv()");
+
+	conn_id = IPC_GET_ARG1(*icall);
+
+	rc = tcp_cconn_get(client, conn_id, &cconn);
+	if (rc != EOK) {
+		async_answer_0(icall_handle, rc);
+		return;
+	}
+
+	if (cconn->shm == NULL) {
+		async_answer_0(icall_handle, EINVAL);
+		return;
+	}
+
+	rc = tcp_conn_recv_impl(client, conn_id,
+	    cconn->shm + cconn->shm_bsize, cconn->shm_bsize, &rsize);
+	if (rc != EOK) {
+		async_answer_0(icall_handle, rc);
+		return;
+	}
+
+	async_answer_1(icall_handle, EOK, rsize);
+}
+
+/** Set connection no-delay option.
+ *
+ * Handle client request to set connection no-delay option.
+ *
+ * @param client        TCP client
+ * @param icall_handle  Async request call handle
+ * @param icall         Async request data
+ */
+static void tcp_conn_set_nodelay_srv(tcp_client_t *client,
+    cap_call_handle_t icall_handle, ipc_call_t *icall)
+{
+	sysarg_t conn_id;
+	bool nodelay;
+	errno_t rc;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "tcp_conn_set_nodelay_srv()");
+
+	conn_id = IPC_GET_ARG1(*icall);
+	nodelay = IPC_GET_ARG2(*icall) != 0;
+	rc = tcp_conn_set_nodelay_impl(client, conn_id, nodelay);
+	async_answer_0(icall_handle, rc);
+}
+
 /** Reset connection.
  *
  * Handle client request to reset connection.
@@ -1061,6 +1440,50 @@ static void tcp_conn_recv_srv(tcp_client_t *client,
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "tcp_conn_recv_srv(): OK");
 }
 
+/** Get connection statistics.
+ *
+ * Handle client request to get connection statistics.
+ *
+ * @param client        TCP client
+ * @param icall_handle  Async request call handle
+ * @param icall         Async request data
+ */
+static void tcp_conn_get_stats_srv(tcp_client_t *client,
+    cap_call_handle_t icall_handle, ipc_call_t *icall)
+{
+	cap_call_handle_t chandle;
+	sysarg_t conn_id;
+	size_t size;
+	tcp_conn_stats_t stats;
+	errno_t rc;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "tcp_conn_get_stats_srv()");
+
+	conn_id = IPC_GET_ARG1(*icall);
+
+	if (!async_data_read_receive(&chandle, &size)) {
+		async_answer_0(chandle, EREFUSED);
+		async_answer_0(icall_handle, EREFUSED);
+		return;
+	}
+
+	if (size != sizeof(tcp_conn_stats_t)) {
+		async_answer_0(chandle, EINVAL);
+		async_answer_0(icall_handle, EINVAL);
+		return;
+	}
+
+	rc = tcp_conn_get_stats_impl(client, conn_id, &stats);
+	if (rc != EOK) {
+		async_answer_0(chandle, rc);
+		async_answer_0(icall_handle, rc);
+		return;
+	}
+
+	rc = async_data_read_finalize(chandle, &stats, size);
+	async_answer_0(icall_handle, rc);
+}
+
 /** Read received data from connection with blocking.
  *
  * Handle client request to read received data via connection with blocking.
@@ -1130,6 +1553,7 @@ static void tcp_client_init(tcp_client_t *client)
 {
 	memset(client, 0, sizeof(tcp_client_t));
 	client->sess = NULL;
+	fibril_mutex_initialize(&client->lock);
 	list_initialize(&client->cconn);
 	list_initialize(&client->clst);
 }
@@ -1143,21 +1567,33 @@ static void tcp_client_fini(tcp_client_t *client)
 	tcp_cconn_t *cconn;
 	unsigned long n;
 
+	fibril_mutex_lock(&client->lock);
 	n = list_count(&client->cconn);
+	fibril_mutex_unlock(&client->lock);
+
 	if (n != 0) {
 		log_msg(LOG_DEFAULT, LVL_WARN, "Client with %lu active "
 		    "connections closed session", n);
 
-		while (!list_empty(&client->cconn)) {
-			cconn = list_get_instance(list_first(&client->cconn),
-			    tcp_cconn_t, lclient);
+		while (true) {
+			fibril_mutex_lock(&client->lock);
+			link_t *link = list_first(&client->cconn);
+			fibril_mutex_unlock(&client->lock);
+
+			if (link == NULL)
+				break;
+
+			cconn = list_get_instance(link, tcp_cconn_t, lclient);
 			tcp_uc_close(cconn->conn);
 			tcp_uc_delete(cconn->conn);
 			tcp_cconn_destroy(cconn);
 		}
 	}
 
+	fibril_mutex_lock(&client->lock);
 	n = list_count(&client->clst);
+	fibril_mutex_unlock(&client->lock);
+
 	if (n != 0) {
 		log_msg(LOG_DEFAULT, LVL_WARN, "Client with %lu active "
 		    "listeners closed session", n);
@@ -1235,6 +1671,21 @@ static void tcp_client_conn(cap_call_handle_t icall_handle, ipc_call_t *icall,
 		case TCP_CONN_RECV_WAIT:
 			tcp_conn_recv_wait_srv(&client, chandle, &call);
 			break;
+		case TCP_CONN_GET_STATS:
+			tcp_conn_get_stats_srv(&client, chandle, &call);
+			break;
+		case TCP_CONN_SET_NODELAY:
+			tcp_conn_set_nodelay_srv(&client, chandle, &call);
+			break;
+		case TCP_CONN_SHM_SETUP:
+			tcp_conn_shm_setup_srv(&client, chandle, &call);
+			break;
+		case TCP_CONN_SHM_SEND:
+			tcp_conn_shm_send_srv(&client, chandle, &call);
+			break;
+		case TCP_CONN_SHM_RECV:
+			tcp_conn_shm_recv_srv(&client, chandle, &call);
+			break;
 		default:
 			async_answer_0(chandle, ENOTSUP);
 			break;
@@ -109,9 +109,36 @@ enum opt_kind {
 	/** No-operation */
 	OPT_NOP			= 1,
 	/** Maximum segment size */
-	OPT_MAX_SEG_SIZE	= 2
+	OPT_MAX_SEG_SIZE	= 2,
+	/** Window scale */
+	OPT_WINDOW_SCALE	= 3,
+	/** SACK permitted */
+	OPT_SACK_PERMITTED	= 4,
+	/** Selective acknowledgement */
+	OPT_SACK		= 5,
+	/** Timestamps */
+	OPT_TIMESTAMP		= 8
 };
 
+/** Option length (including kind and length bytes) */
+enum opt_len {
+	OPT_WINDOW_SCALE_LEN	= 3,
+	OPT_SACK_PERMITTED_LEN	= 2,
+	/** SACK option header, followed by 8 bytes per block */
+	OPT_SACK_LEN		= 2,
+	OPT_SACK_BLOCK_LEN	= 8,
+	OPT_TIMESTAMP_LEN	= 10
+};
+
+/** Maximum size of options area */
+#define TCP_OPTS_MAX_SIZE 40
+
+/** Largest value of the window field */
+#define TCP_WND_MAX 0xffff
+
+/** Largest allowed window scale shift count (RFC 7323) */
+#define TCP_WSCALE_MAX 14
+
 #endif
 
 /** @}
@@ -38,8 +38,10 @@
 #include <errno.h>
 #include <io/log.h>
 #include <stdio.h>
+#include <str.h>
 #include <task.h>
 
+#include "cc.h"
 #include "conn.h"
 #include "inet.h"
 #include "ncsim.h"
@@ -92,9 +94,29 @@ static errno_t tcp_init(void)
 int main(int argc, char **argv)
 {
 	errno_t rc;
+	int i;
 
 	printf(NAME ": TCP (Transmission Control Protocol) network module\n");
 
+	i = 1;
+	while (i < argc) {
+		if (i + 1 < argc && str_cmp(argv[i], "--cc") == 0) {
+			if (tcp_cc_set_default(argv[i + 1]) != EOK) {
+				printf(NAME ": Unknown congestion control "
+				    "algorithm '%s'.\n", argv[i + 1]);
+				return 1;
+			}
+			i += 2;
+		} else if (str_cmp(argv[i], "--syn-cookies") == 0) {
+			tcp_conn_syn_cookies = true;
+			++i;
+		} else {
+			printf("Syntax: %s [--cc newreno|cubic] "
+			    "[--syn-cookies]\n", NAME);
+			return 1;
+		}
+	}
+
 	rc = log_init(NAME);
 	if (rc != EOK) {
 		printf(NAME ": Failed to initialize log.\n");
@@ -105,6 +127,12 @@ int main(int argc, char **argv)
 	if (rc != EOK)
 		return 1;
 
+	rc = async_create_manager_threads(0);
+	if (rc != EOK) {
+		log_msg(LOG_DEFAULT, LVL_WARN, "Failed creating manager "
+		    "threads.");
+	}
+
 	printf(NAME ": Accepting connections.\n");
 	task_retval(0);
 	async_manager();
@@ -35,6 +35,7 @@
 #ifndef TCP_TYPE_H
 #define TCP_TYPE_H
 
+#include <adt/hash_table.h>
 #include <adt/list.h>
 #include <async.h>
 #include <stdbool.h>
@@ -44,9 +45,14 @@
 #include <stdint.h>
 #include <inet/addr.h>
 #include <inet/endpoint.h>
+#include <ipc/tcp.h>
+#include <sys/time.h>
 
 struct tcp_conn;
 
+/** Sender maximum segment size (amount of data sent in one segment) */
+#define TCP_SMSS 4096
+
 /** Connection state */
 typedef enum {
 	/** Listen */
@@ -153,6 +159,37 @@ typedef struct {
 	tcp_cstate_t cstate;
 } tcp_conn_status_t;
 
+/** Maximum number of SACK blocks in a segment */
+#define TCP_SACK_BLOCKS_MAX 4
+
+/** SACK block */
+typedef struct {
+	/** Sequence number of first byte in block */
+	uint32_t left;
+	/** Sequence number immediately following block */
+	uint32_t right;
+} tcp_sack_block_t;
+
+/** Segment options */
+typedef struct {
+	/** Window scale option is present */
+	bool ws_present;
+	/** Window scale shift count */
+	uint8_t ws_shift;
+	/** SACK-permitted option is present */
+	bool sack_perm;
+	/** Timestamps option is present */
+	bool ts_present;
+	/** Timestamp value */
+	uint32_t ts_val;
+	/** Timestamp echo reply */
+	uint32_t ts_ecr;
+	/** Number of SACK blocks */
+	size_t sack_cnt;
+	/** SACK blocks */
+	tcp_sack_block_t sack[TCP_SACK_BLOCKS_MAX];
+} tcp_seg_opts_t;
+
 typedef struct {
 	/** SYN, FIN */
 	tcp_control_t ctrl;
@@ -167,6 +204,8 @@ typedef struct {
 	uint32_t wnd;
 	/** Segment urgent pointer */
 	uint32_t up;
+	/** Segment options */
+	tcp_seg_opts_t opts;
 
 	/** Segment data, may be moved when trimming segment */
 	void *data;
@@ -206,6 +245,12 @@ typedef struct {
 	link_t link;
 	tcp_conn_t *conn;
 	tcp_segment_t *seg;
+	/** Segment has been selectively acknowledged by the peer */
+	bool sacked;
+	/** Segment has been retransmitted */
+	bool rexmit;
+	/** Time of first transmission */
+	struct timeval xmit_tv;
 } tcp_tqueue_entry_t;
 
 /** Retransmission queue callbacks */
@@ -214,6 +259,49 @@ typedef struct {
 	void (*transmit_seg)(inet_ep2_t *, tcp_segment_t *);
 } tcp_tqueue_cb_t;
 
+/** Congestion control algorithm */
+typedef struct tcp_cc_ops {
+	/** Algorithm name */
+	const char *name;
+	/** Initialize algorithm state of new connection */
+	void (*init)(struct tcp_conn *);
+	/** Grow congestion window after new data has been acknowledged */
+	void (*cong_avoid)(struct tcp_conn *, uint32_t);
+	/** Determine new slow start threshold when loss is detected */
+	uint32_t (*ssthresh)(struct tcp_conn *);
+} tcp_cc_ops_t;
+
+/** Congestion control state */
+typedef struct {
+	/** Congestion control algorithm */
+	tcp_cc_ops_t *ops;
+	/** Congestion window in bytes */
+	uint32_t cwnd;
+	/** Slow start threshold in bytes */
+	uint32_t ssthresh;
+	/** Bytes acknowledged since last window increase */
+	uint32_t bytes_acked;
+	/** Number of consecutive duplicate ACKs */
+	unsigned dupacks;
+	/** Fast recovery is in progress */
+	bool in_recovery;
+	/** SND.NXT when fast recovery started */
+	uint32_t recover;
+
+	/** CUBIC: window before last reduction in bytes */
+	uint32_t w_max;
+	/** CUBIC: congestion avoidance epoch has started */
+	bool in_epoch;
+	/** CUBIC: start of congestion avoidance epoch in milliseconds */
+	uint32_t epoch_start;
+	/** CUBIC: time to reach origin point in milliseconds */
+	uint32_t k;
+	/** CUBIC: window at the plateau of the cubic function in bytes */
+	uint32_t origin;
+	/** CUBIC: estimated window of standard TCP in bytes */
+	uint32_t w_est;
+} tcp_cc_t;
+
 /** Retransmission queue */
 typedef struct {
 	struct tcp_conn *conn;
@@ -221,11 +309,43 @@ typedef struct {
 
 	/** Retransmission timer */
 	fibril_timer_t *timer;
+	/** Delayed ACK timer */
+	fibril_timer_t *ack_timer;
 
 	/** Callbacks */
 	tcp_tqueue_cb_t *cb;
 } tcp_tqueue_t;
 
+/** Entry in listener's queue of half-open connections.
+ *
+ * Holds just enough state to answer the SYN and to build the connection
+ * once the handshake completes.
+ */
+typedef struct {
+	/** Link to tcp_conn_t.syn_queue */
+	link_t link;
+	/** Endpoint pair of the connection */
+	inet_ep2_t epp;
+	/** Initial receive sequence number */
+	uint32_t irs;
+	/** Initial send sequence number */
+	uint32_t iss;
+	/** Window received in SYN */
+	uint32_t snd_wnd;
+	/** Window scaling has been negotiated */
+	bool ws_ok;
+	/** Shift count applied to window received from peer */
+	uint8_t snd_wscale;
+	/** Selective acknowledgements have been negotiated */
+	bool sack_ok;
+	/** Timestamps have been negotiated */
+	bool ts_ok;
+	/** Timestamp received in SYN */
+	uint32_t ts_recent;
+	/** Time when SYN was received */
+	struct timeval rcvd_tv;
+} tcp_syn_ent_t;
+
 /** Connection */
 struct tcp_conn {
 	char *name;
@@ -240,6 +360,10 @@ struct tcp_conn {
 	inet_ep2_t ident;
 	/** Connection is in association map */
 	bool mapped;
+	/** Link to connection hash index */
+	ht_link_t hash_link;
+	/** Connection is in the connection hash index */
+	bool hashed;
 
 	/** Active or passive connection */
 	acpass_t ap;
@@ -270,6 +394,11 @@ struct tcp_conn {
 	/** Time-Wait timeout timer */
 	fibril_timer_t *tw_timer;
 
+	/** Half-open connections of a listening connection */
+	list_t syn_queue; /* of tcp_syn_ent_t */
+	/** Number of entries in @c syn_queue */
+	size_t syn_queue_len;
+
 	/** Receive buffer */
 	uint8_t *rcv_buf;
 	/** Receive buffer size */
@@ -291,6 +420,10 @@ struct tcp_conn {
 	bool snd_buf_fin;
 	/** Send buffer CV. Broadcast when space is made available in buffer */
 	fibril_condvar_t snd_buf_cv;
+	/** Number of bytes at start of send buffer to send without delay */
+	size_t snd_push;
+	/** Do not delay small segments (disable Nagle algorithm) */
+	bool nodelay;
 
 	/** Send unacknowledged */
 	uint32_t snd_una;
@@ -313,8 +446,39 @@ struct tcp_conn {
 	uint32_t rcv_wnd;
 	/** Receive urgent pointer */
 	uint32_t rcv_up;
+	/** Right edge of the last advertised receive window (RCV.ADV) */
+	uint32_t rcv_adv;
+	/** Number of received segments not acknowledged yet */
+	unsigned ack_pending;
 	/** Initial receive sequence number */
 	uint32_t irs;
+
+	/** Window scaling has been negotiated */
+	bool ws_ok;
+	/** Shift count applied to window received from peer */
+	uint8_t snd_wscale;
+	/** Shift count applied to window we advertise */
+	uint8_t rcv_wscale;
+	/** Selective acknowledgements have been negotiated */
+	bool sack_ok;
+	/** Timestamps have been negotiated */
+	bool ts_ok;
+	/** Most recent timestamp received from peer (TS.Recent) */
+	uint32_t ts_recent;
+	/** Last acknowledgement number sent (Last.ACK.sent) */
+	uint32_t last_ack_sent;
+
+	/** Congestion control */
+	tcp_cc_t cc;
+	/** Smoothed round-trip time (SRTT) in microseconds, 0 if unknown */
+	suseconds_t srtt;
+	/** Round-trip time variation (RTTVAR) in microseconds */
+	suseconds_t rttvar;
+	/** Retransmission timeout (RTO) in microseconds */
+	suseconds_t rto;
+
+	/** Statistics */
+	tcp_conn_stats_t stats;
 };
 
 /** Continuation of processing.
@@ -352,6 +516,10 @@ typedef struct tcp_cconn {
 	/** Client */
 	struct tcp_client *client;
 	link_t lclient;
+	/** Memory shared with client (send buffer, receive buffer) or NULL */
+	void *shm;
+	/** Size of send and of receive buffer in shared memory */
+	size_t shm_bsize;
 } tcp_cconn_t;
 
 /** TCP client listener */
@@ -366,12 +534,26 @@ typedef struct tcp_clst {
 	struct tcp_client *client;
 	/** Link to tcp_client_t.clst */
 	link_t lclient;
+	/** Protects the fields below */
+	fibril_mutex_t lock;
+	/** IDs of accepted connections not announced to the client yet */
+	sysarg_t *pending;
+	/** Number of entries in @c pending */
+	size_t pending_cnt;
+	/** Number of entries allocated for @c pending */
+	size_t pending_alloc;
+	/** A fibril announcing the pending connections has been started */
+	bool flush_active;
+	/** Listener has been destroyed, the flush fibril frees it */
+	bool destroyed;
 } tcp_clst_t;
 
 /** TCP client */
 typedef struct tcp_client {
 	/** Client callback session */
 	async_sess_t *sess;
+	/** Protects @c cconn and @c clst */
+	fibril_mutex_t lock;
 	/** Client's connections */
 	list_t cconn; /* of tcp_cconn_t */
 	/** Client's listeners */
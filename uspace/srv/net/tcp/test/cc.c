@@ -0,0 +1,186 @@
+/*
+ * Copyright (c) 2018 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <inet/endpoint.h>
+#include <io/log.h>
+#include <pcut/pcut.h>
+
+#include "../cc.h"
+#include "../conn.h"
+
+PCUT_INIT;
+
+PCUT_TEST_SUITE(cc);
+
+PCUT_TEST_BEFORE
+{
+	errno_t rc;
+
+	/* We will be calling functions that perform logging */
+	rc = log_init("test-tcp");
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	rc = tcp_conns_init();
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+}
+
+PCUT_TEST_AFTER
+{
+	PCUT_ASSERT_ERRNO_VAL(EOK, tcp_cc_set_default("cubic"));
+	tcp_conns_fini();
+}
+
+static tcp_conn_t *test_conn_new(const char *alg)
+{
+	tcp_conn_t *conn;
+	inet_ep2_t epp;
+
+	PCUT_ASSERT_ERRNO_VAL(EOK, tcp_cc_set_default(alg));
+
+	inet_ep2_init(&epp);
+	conn = tcp_conn_new(&epp);
+	PCUT_ASSERT_NOT_NULL(conn);
+	return conn;
+}
+
+static void test_conn_delete(tcp_conn_t *conn)
+{
+	tcp_conn_lock(conn);
+	tcp_conn_reset(conn);
+	tcp_conn_unlock(conn);
+	tcp_conn_delete(conn);
+}
+
+/** Test selecting unknown algorithm */
+PCUT_TEST(set_default_unknown)
+{
+	PCUT_ASSERT_ERRNO_VAL(ENOENT, tcp_cc_set_default("nosuchalg"));
+}
+
+/** Test round-trip time estimation */
+PCUT_TEST(rtt_sample)
+{
+	tcp_conn_t *conn;
+
+	conn = test_conn_new("newreno");
+
+	/* First sample initializes estimate */
+	tcp_cc_rtt_sample(conn, 100000);
+	PCUT_ASSERT_INT_EQUALS(100000, conn->srtt);
+	PCUT_ASSERT_INT_EQUALS(50000, conn->rttvar);
+	PCUT_ASSERT_INT_EQUALS(300000, conn->rto);
+
+	/* Same RTT again reduces variation */
+	tcp_cc_rtt_sample(conn, 100000);
+	PCUT_ASSERT_INT_EQUALS(100000, conn->srtt);
+	PCUT_ASSERT_INT_EQUALS(37500, conn->rttvar);
+	PCUT_ASSERT_INT_EQUALS(250000, conn->rto);
+
+	/* Timeout backs off RTO */
+	tcp_conn_lock(conn);
+	tcp_cc_timeout(conn);
+	tcp_conn_unlock(conn);
+	PCUT_ASSERT_INT_EQUALS(500000, conn->rto);
+	PCUT_ASSERT_INT_EQUALS(TCP_SMSS, conn->cc.cwnd);
+	PCUT_ASSERT_INT_EQUALS(1, conn->stats.timeouts);
+
+	test_conn_delete(conn);
+}
+
+/** Test NewReno slow start, fast retransmit and fast recovery */
+PCUT_TEST(newreno_recovery)
+{
+	tcp_conn_t *conn;
+	uint32_t cwnd;
+
+	conn = test_conn_new("newreno");
+
+	tcp_conn_lock(conn);
+
+	/* Slow start grows window by one segment per ACK */
+	cwnd = conn->cc.cwnd;
+	tcp_cc_ack(conn, TCP_SMSS);
+	PCUT_ASSERT_INT_EQUALS(cwnd + TCP_SMSS, conn->cc.cwnd);
+
+	conn->snd_una = 0;
+	conn->snd_nxt = 10 * TCP_SMSS;
+	conn->cc.cwnd = 10 * TCP_SMSS;
+
+	/* Third duplicate ACK triggers fast retransmit */
+	tcp_cc_dupack(conn);
+	tcp_cc_dupack(conn);
+	PCUT_ASSERT_FALSE(conn->cc.in_recovery);
+	tcp_cc_dupack(conn);
+	PCUT_ASSERT_TRUE(conn->cc.in_recovery);
+	PCUT_ASSERT_INT_EQUALS(5 * TCP_SMSS, conn->cc.ssthresh);
+	PCUT_ASSERT_INT_EQUALS(8 * TCP_SMSS, conn->cc.cwnd);
+	PCUT_ASSERT_INT_EQUALS(1, conn->stats.fast_retransmits);
+
+	/* Further duplicate ACKs inflate window */
+	tcp_cc_dupack(conn);
+	PCUT_ASSERT_INT_EQUALS(9 * TCP_SMSS, conn->cc.cwnd);
+
+	/* Full acknowledgement ends recovery */
+	conn->snd_una = conn->snd_nxt;
+	tcp_cc_ack(conn, 10 * TCP_SMSS);
+	PCUT_ASSERT_FALSE(conn->cc.in_recovery);
+	PCUT_ASSERT_INT_EQUALS(2 * TCP_SMSS, conn->cc.cwnd);
+
+	tcp_conn_unlock(conn);
+	test_conn_delete(conn);
+}
+
+/** Test CUBIC multiplicative decrease and fast convergence */
+PCUT_TEST(cubic_ssthresh)
+{
+	tcp_conn_t *conn;
+
+	conn = test_conn_new("cubic");
+
+	tcp_conn_lock(conn);
+
+	conn->snd_una = 0;
+	conn->snd_nxt = 100 * TCP_SMSS;
+	conn->cc.cwnd = 100 * TCP_SMSS;
+
+	tcp_cc_timeout(conn);
+	PCUT_ASSERT_INT_EQUALS(70 * TCP_SMSS, conn->cc.ssthresh);
+	PCUT_ASSERT_INT_EQUALS(100 * TCP_SMSS, conn->cc.w_max);
+
+	/* Loss below previous maximum releases more bandwidth */
+	conn->cc.cwnd = 80 * TCP_SMSS;
+	tcp_cc_timeout(conn);
+	PCUT_ASSERT_INT_EQUALS(56 * TCP_SMSS, conn->cc.ssthresh);
+	PCUT_ASSERT_INT_EQUALS(68 * TCP_SMSS, conn->cc.w_max);
+
+	tcp_conn_unlock(conn);
+	test_conn_delete(conn);
+}
+
+PCUT_EXPORT(cc);
@@ -27,6 +27,7 @@
  */
 
 #include <errno.h>
+#include <fibril_synch.h>
 #include <inet/endpoint.h>
 #include <io/log.h>
 #include <pcut/pcut.h>
@@ -39,10 +40,22 @@ PCUT_INIT;
 
 PCUT_TEST_SUITE(conn);
 
+static void test_lst_cstate_change(tcp_conn_t *, void *, tcp_cstate_t);
+
 static tcp_rqueue_cb_t test_rqueue_cb = {
 	.seg_received = tcp_as_segment_arrived
 };
 
+static tcp_cb_t test_lst_cb = {
+	.cstate_change = test_lst_cstate_change
+};
+
+/** Connection accepted by listener */
+static tcp_conn_t *accepted;
+
+static FIBRIL_MUTEX_INITIALIZE(accept_lock);
+static FIBRIL_CONDVAR_INITIALIZE(accept_cv);
+
 PCUT_TEST_BEFORE
 {
 	errno_t rc;
@@ -113,6 +126,45 @@ PCUT_TEST(add_find_delete)
 	tcp_conn_delete(conn);
 }
 
+/** Test finding a connection with fully specified endpoint pair */
+PCUT_TEST(add_find_full)
+{
+	tcp_conn_t *conn, *cfound;
+	inet_ep2_t epp;
+	errno_t rc;
+
+	inet_ep2_init(&epp);
+	inet_addr(&epp.local.addr, 127, 0, 0, 1);
+	epp.local.port = inet_port_user_lo;
+	inet_addr(&epp.remote.addr, 127, 0, 0, 1);
+	epp.remote.port = inet_port_user_lo + 1;
+
+	conn = tcp_conn_new(&epp);
+	PCUT_ASSERT_NOT_NULL(conn);
+
+	rc = tcp_conn_add(conn);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	cfound = tcp_conn_find_ref(&epp);
+	PCUT_ASSERT_EQUALS(conn, cfound);
+	tcp_conn_delref(cfound);
+
+	/* Different remote port should not match */
+	epp.remote.port++;
+	cfound = tcp_conn_find_ref(&epp);
+	PCUT_ASSERT_EQUALS(NULL, cfound);
+
+	tcp_conn_lock(conn);
+	tcp_conn_reset(conn);
+	tcp_conn_unlock(conn);
+	tcp_conn_delete(conn);
+
+	/* Connection should no longer be found */
+	epp.remote.port--;
+	cfound = tcp_conn_find_ref(&epp);
+	PCUT_ASSERT_EQUALS(NULL, cfound);
+}
+
 /** Test trying to connect to endpoint that sends RST back */
 PCUT_TEST(connect_rst)
 {
@@ -149,7 +201,7 @@ PCUT_TEST(connect_rst)
 /** Test establishing a connection */
 PCUT_TEST(conn_establish)
 {
-	tcp_conn_t *cconn, *sconn;
+	tcp_conn_t *cconn, *sconn, *aconn;
 	inet_ep2_t cepp, sepp;
 	errno_t rc;
 
@@ -184,6 +236,9 @@ PCUT_TEST(conn_establish)
 	PCUT_ASSERT_INT_EQUALS(st_listen, sconn->cstate);
 	PCUT_ASSERT_FALSE(tcp_conn_got_syn(sconn));
 
+	accepted = NULL;
+	tcp_uc_set_cb(sconn, &test_lst_cb, NULL);
+
 	/* Start establishing the connection */
 
 	tcp_conn_lock(cconn);
@@ -199,27 +254,41 @@ PCUT_TEST(conn_establish)
 	PCUT_ASSERT_TRUE(tcp_conn_got_syn(cconn));
 	tcp_conn_unlock(cconn);
 
-	/* Wait for server-side state to transition */
+	/* Wait for the server to accept the connection */
+	fibril_mutex_lock(&accept_lock);
+	while (accepted == NULL)
+		fibril_condvar_wait(&accept_cv, &accept_lock);
+	aconn = accepted;
+	fibril_mutex_unlock(&accept_lock);
+
+	/* Listener stays in Listen state */
 	tcp_conn_lock(sconn);
-	while (sconn->cstate == st_listen || sconn->cstate == st_syn_received)
-		fibril_condvar_wait(&sconn->cstate_cv, &sconn->lock);
+	PCUT_ASSERT_INT_EQUALS(st_listen, sconn->cstate);
+	tcp_conn_unlock(sconn);
 
-	PCUT_ASSERT_INT_EQUALS(st_established, sconn->cstate);
-	PCUT_ASSERT_TRUE(tcp_conn_got_syn(sconn));
+	tcp_conn_lock(aconn);
+	PCUT_ASSERT_INT_EQUALS(st_established, aconn->cstate);
+	PCUT_ASSERT_TRUE(tcp_conn_got_syn(aconn));
 
 	/* Verify counters */
 	PCUT_ASSERT_EQUALS(cconn->iss + 1, cconn->snd_nxt);
 	PCUT_ASSERT_EQUALS(cconn->iss + 1, cconn->snd_una);
-	PCUT_ASSERT_EQUALS(sconn->iss + 1, sconn->snd_nxt);
-	PCUT_ASSERT_EQUALS(sconn->iss + 1, sconn->snd_una);
+	PCUT_ASSERT_EQUALS(aconn->iss + 1, aconn->snd_nxt);
+	PCUT_ASSERT_EQUALS(aconn->iss + 1, aconn->snd_una);
 
-	tcp_conn_unlock(sconn);
+	tcp_conn_unlock(aconn);
 
 	tcp_conn_lock(cconn);
 	tcp_conn_reset(cconn);
 	tcp_conn_unlock(cconn);
 	tcp_conn_delete(cconn);
 
+	tcp_conn_lock(aconn);
+	tcp_conn_reset(aconn);
+	tcp_conn_unlock(aconn);
+	tcp_conn_delete(aconn);
+
+	tcp_uc_set_cb(sconn, NULL, NULL);
 	tcp_conn_lock(sconn);
 	tcp_conn_reset(sconn);
 	tcp_conn_unlock(sconn);
@@ -244,4 +313,19 @@ PCUT_TEST(ep2_flipped)
 	PCUT_ASSERT_TRUE(inet_addr_compare(&a.remote.addr, &fa.local.addr));
 }
 
+static void test_lst_cstate_change(tcp_conn_t *conn, void *arg,
+    tcp_cstate_t old_state)
+{
+	if (old_state != st_syn_received || conn->cstate != st_established)
+		return;
+
+	/* Take over connection split off the listener */
+	tcp_uc_set_cb(conn, NULL, NULL);
+
+	fibril_mutex_lock(&accept_lock);
+	accepted = conn;
+	fibril_mutex_unlock(&accept_lock);
+	fibril_condvar_broadcast(&accept_cv);
+}
+
 PCUT_EXPORT(conn);
@@ -36,12 +36,27 @@
 /** Verify that two segments have the same content */
 void test_seg_same(tcp_segment_t *a, tcp_segment_t *b)
 {
+	size_t i;
+
 	PCUT_ASSERT_INT_EQUALS(a->ctrl, b->ctrl);
 	PCUT_ASSERT_INT_EQUALS(a->seq, b->seq);
 	PCUT_ASSERT_INT_EQUALS(a->ack, b->ack);
 	PCUT_ASSERT_INT_EQUALS(a->len, b->len);
 	PCUT_ASSERT_INT_EQUALS(a->wnd, b->wnd);
 	PCUT_ASSERT_INT_EQUALS(a->up, b->up);
+	PCUT_ASSERT_EQUALS(a->opts.ws_present, b->opts.ws_present);
+	PCUT_ASSERT_INT_EQUALS(a->opts.ws_shift, b->opts.ws_shift);
+	PCUT_ASSERT_EQUALS(a->opts.sack_perm, b->opts.sack_perm);
+	PCUT_ASSERT_EQUALS(a->opts.ts_present, b->opts.ts_present);
+	PCUT_ASSERT_INT_EQUALS(a->opts.ts_val, b->opts.ts_val);
+	PCUT_ASSERT_INT_EQUALS(a->opts.ts_ecr, b->opts.ts_ecr);
+	PCUT_ASSERT_INT_EQUALS(a->opts.sack_cnt, b->opts.sack_cnt);
+	for (i = 0; i < a->opts.sack_cnt; i++) {
+		PCUT_ASSERT_INT_EQUALS(a->opts.sack[i].left,
+		    b->opts.sack[i].left);
+		PCUT_ASSERT_INT_EQUALS(a->opts.sack[i].right,
+		    b->opts.sack[i].right);
+	}
 	PCUT_ASSERT_INT_EQUALS(tcp_segment_text_size(a),
 	    tcp_segment_text_size(b));
 	if (tcp_segment_text_size(a) != 0)
@@ -56,6 +71,7 @@ void test_seg_same(tcp_segment_t *a, tcp_segment_t *b)
 
 PCUT_INIT;
 
+PCUT_IMPORT(cc);
 PCUT_IMPORT(conn);
 PCUT_IMPORT(iqueue);
 PCUT_IMPORT(pdu);
@@ -108,4 +108,77 @@ PCUT_TEST(encdec_data)
 	free(data);
 }
 
+/** Test encode/decode round trip for SYN PDU with options */
+PCUT_TEST(encdec_syn_opts)
+{
+	tcp_segment_t *seg, *dseg;
+	tcp_pdu_t *pdu;
+	inet_ep2_t epp, depp;
+	errno_t rc;
+
+	inet_ep2_init(&epp);
+	inet_addr(&epp.local.addr, 1, 2, 3, 4);
+	inet_addr(&epp.remote.addr, 5, 6, 7, 8);
+
+	seg = tcp_segment_make_ctrl(CTL_SYN);
+	PCUT_ASSERT_NOT_NULL(seg);
+
+	seg->seq = 20;
+	seg->wnd = 18;
+	seg->opts.ws_present = true;
+	seg->opts.ws_shift = 7;
+	seg->opts.sack_perm = true;
+	seg->opts.ts_present = true;
+	seg->opts.ts_val = 0x12345678;
+	seg->opts.ts_ecr = 0;
+
+	rc = tcp_pdu_encode(&epp, seg, &pdu);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(40, pdu->header_size);
+	rc = tcp_pdu_decode(pdu, &depp, &dseg);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	test_seg_same(seg, dseg);
+	tcp_segment_delete(seg);
+}
+
+/** Test encode/decode round trip for ACK PDU with timestamps and SACK */
+PCUT_TEST(encdec_ack_sack)
+{
+	tcp_segment_t *seg, *dseg;
+	tcp_pdu_t *pdu;
+	inet_ep2_t epp, depp;
+	size_t i;
+	errno_t rc;
+
+	inet_ep2_init(&epp);
+	inet_addr(&epp.local.addr, 1, 2, 3, 4);
+	inet_addr(&epp.remote.addr, 5, 6, 7, 8);
+
+	seg = tcp_segment_make_ctrl(CTL_ACK);
+	PCUT_ASSERT_NOT_NULL(seg);
+
+	seg->seq = 20;
+	seg->ack = 19;
+	seg->wnd = 18;
+	seg->opts.ts_present = true;
+	seg->opts.ts_val = 100;
+	seg->opts.ts_ecr = 0xfffffff0;
+	seg->opts.sack_cnt = TCP_SACK_BLOCKS_MAX - 1;
+	for (i = 0; i < seg->opts.sack_cnt; i++) {
+		seg->opts.sack[i].left = 1000 * (i + 1);
+		seg->opts.sack[i].right = 1000 * (i + 1) + 500;
+	}
+
+	rc = tcp_pdu_encode(&epp, seg, &pdu);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	/* Options area is full */
+	PCUT_ASSERT_INT_EQUALS(60, pdu->header_size);
+	rc = tcp_pdu_decode(pdu, &depp, &dseg);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	test_seg_same(seg, dseg);
+	tcp_segment_delete(seg);
+}
+
 PCUT_EXPORT(pdu);
@@ -28,6 +28,7 @@
 
 //#include <inet/endpoint.h>
 #include <io/log.h>
+#include <mem.h>
 #include <pcut/pcut.h>
 
 #include "../conn.h"
@@ -43,6 +44,7 @@ enum {
 
 static int seg_cnt;
 static tcp_segment_t *trans_seg[test_seg_max];
+static uint32_t trans_seq[test_seg_max];
 
 static void tqueue_test_transmit_seg(inet_ep2_t *, tcp_segment_t *);
 
@@ -216,6 +218,7 @@ PCUT_TEST(ack_received)
 	conn->snd_una = 10;
 	conn->snd_nxt = 10;
 	conn->snd_wnd = 1024;
+	conn->nodelay = true;
 
 	/* Redirect segment transmission */
 	conn->retransmit.cb = &tqueue_test_cb;
@@ -254,8 +257,128 @@ PCUT_TEST(ack_received)
 	tcp_conn_delete(conn);
 }
 
+/** Test retransmitting holes in SACK scoreboard on fast retransmit */
+PCUT_TEST(sack_fast_retransmit)
+{
+	tcp_conn_t *conn;
+	inet_ep2_t epp;
+	tcp_seg_opts_t opts;
+	int i;
+
+	/* XXX tqueue can only be created via tcp_conn_new */
+	inet_ep2_init(&epp);
+	conn = tcp_conn_new(&epp);
+	PCUT_ASSERT_NOT_NULL(conn);
+
+	conn->cstate = st_established;
+	conn->snd_una = 10;
+	conn->snd_nxt = 10;
+	conn->snd_wnd = 1024;
+	conn->sack_ok = true;
+	conn->nodelay = true;
+
+	/* Redirect segment transmission */
+	conn->retransmit.cb = &tqueue_test_cb;
+	seg_cnt = 0;
+
+	tcp_conn_lock(conn);
+
+	/* Queue four data segments */
+	for (i = 0; i < 4; i++) {
+		conn->snd_buf_used = 10;
+		conn->snd_buf_fin = false;
+		tcp_tqueue_new_data(conn);
+	}
+
+	PCUT_ASSERT_EQUALS(50, conn->snd_nxt);
+	PCUT_ASSERT_EQUALS(4, seg_cnt);
+
+	/* Peer holds the third segment */
+	memset(&opts, 0, sizeof(opts));
+	opts.sack_cnt = 1;
+	opts.sack[0].left = 30;
+	opts.sack[0].right = 40;
+	tcp_tqueue_sack_received(conn, &opts);
+
+	/* First two segments are retransmitted, the last one is not */
+	tcp_tqueue_fast_retransmit(conn);
+	PCUT_ASSERT_EQUALS(6, seg_cnt);
+	PCUT_ASSERT_INT_EQUALS(10, trans_seq[4]);
+	PCUT_ASSERT_INT_EQUALS(20, trans_seq[5]);
+
+	/* First segment is acked, only the remaining hole is re-sent */
+	conn->snd_una = 20;
+	tcp_tqueue_ack_received(conn);
+	PCUT_ASSERT_INT_EQUALS(3, list_count(&conn->retransmit.list));
+
+	tcp_tqueue_fast_retransmit(conn);
+	PCUT_ASSERT_EQUALS(7, seg_cnt);
+	PCUT_ASSERT_INT_EQUALS(20, trans_seq[6]);
+
+	tcp_conn_reset(conn);
+	tcp_conn_unlock(conn);
+	tcp_conn_delete(conn);
+}
+
+/** Test holding back small segment while data is in flight (Nagle) */
+PCUT_TEST(nagle)
+{
+	tcp_conn_t *conn;
+	inet_ep2_t epp;
+
+	/* XXX tqueue can only be created via tcp_conn_new */
+	inet_ep2_init(&epp);
+	conn = tcp_conn_new(&epp);
+	PCUT_ASSERT_NOT_NULL(conn);
+
+	conn->cstate = st_established;
+	conn->snd_una = 10;
+	conn->snd_nxt = 10;
+	conn->snd_wnd = 1024;
+
+	/* Redirect segment transmission */
+	conn->retransmit.cb = &tqueue_test_cb;
+	seg_cnt = 0;
+
+	tcp_conn_lock(conn);
+
+	/* Nothing is in flight, first small segment is sent */
+	conn->snd_buf_used = 10;
+	conn->snd_buf_fin = false;
+	tcp_tqueue_new_data(conn);
+	PCUT_ASSERT_EQUALS(20, conn->snd_nxt);
+	PCUT_ASSERT_EQUALS(1, seg_cnt);
+
+	/* Second small segment is held back */
+	conn->snd_buf_used = 10;
+	tcp_tqueue_new_data(conn);
+	PCUT_ASSERT_EQUALS(20, conn->snd_nxt);
+	PCUT_ASSERT_EQUALS(1, seg_cnt);
+
+	/* Coalesced with more data and sent once everything is acked */
+	conn->snd_buf_used = 30;
+	conn->snd_una = 20;
+	tcp_tqueue_ack_received(conn);
+	PCUT_ASSERT_EQUALS(50, conn->snd_nxt);
+	PCUT_ASSERT_EQUALS(2, seg_cnt);
+	PCUT_ASSERT_INT_EQUALS(20, trans_seq[1]);
+
+	/* Pushed data is sent regardless */
+	conn->snd_buf_used = 10;
+	conn->snd_push = 10;
+	tcp_tqueue_new_data(conn);
+	PCUT_ASSERT_EQUALS(60, conn->snd_nxt);
+	PCUT_ASSERT_EQUALS(3, seg_cnt);
+	PCUT_ASSERT_EQUALS(0, conn->snd_push);
+
+	tcp_conn_reset(conn);
+	tcp_conn_unlock(conn);
+	tcp_conn_delete(conn);
+}
+
 static void tqueue_test_transmit_seg(inet_ep2_t *epp, tcp_segment_t *seg)
 {
+	trans_seq[seg_cnt] = seg->seq;
 	trans_seg[seg_cnt++] = seg;
 }
 
@@ -40,6 +40,7 @@ PCUT_INIT;
 PCUT_TEST_SUITE(ucall);
 
 static void test_cstate_change(tcp_conn_t *, void *, tcp_cstate_t);
+static void test_lst_cstate_change(tcp_conn_t *, void *, tcp_cstate_t);
 static void test_conns_establish(tcp_conn_t **, tcp_conn_t **);
 static void test_conns_tear_down(tcp_conn_t *, tcp_conn_t *);
 
@@ -51,8 +52,14 @@ static tcp_cb_t test_conn_cb = {
 	.cstate_change = test_cstate_change
 };
 
+static tcp_cb_t test_lst_cb = {
+	.cstate_change = test_lst_cstate_change
+};
+
 static tcp_conn_status_t cconn_status;
 static tcp_conn_status_t sconn_status;
+/** Connection accepted by listener */
+static tcp_conn_t *sconn_accepted;
 
 static FIBRIL_MUTEX_INITIALIZE(cst_lock);
 static FIBRIL_CONDVAR_INITIALIZE(cst_cv);
@@ -246,10 +253,26 @@ static void test_cstate_change(tcp_conn_t *conn, void *arg,
 	fibril_condvar_broadcast(&cst_cv);
 }
 
+static void test_lst_cstate_change(tcp_conn_t *conn, void *arg,
+    tcp_cstate_t old_state)
+{
+	if (old_state != st_syn_received || conn->cstate != st_established)
+		return;
+
+	/* Take over connection split off the listener */
+	tcp_uc_set_cb(conn, &test_conn_cb, &sconn_status);
+
+	fibril_mutex_lock(&cst_lock);
+	sconn_accepted = conn;
+	tcp_uc_status(conn, &sconn_status);
+	fibril_mutex_unlock(&cst_lock);
+	fibril_condvar_broadcast(&cst_cv);
+}
+
 /** Establish client-server connection */
 static void test_conns_establish(tcp_conn_t **rcconn, tcp_conn_t **rsconn)
 {
-	tcp_conn_t *cconn, *sconn;
+	tcp_conn_t *cconn, *lconn, *sconn;
 	inet_ep2_t cepp, sepp;
 	tcp_conn_status_t cstatus;
 	tcp_error_t trc;
@@ -266,15 +289,15 @@ static void test_conns_establish(tcp_conn_t **rcconn, tcp_conn_t **rsconn)
 	sepp.local.port = inet_port_user_lo;
 
 	/* Server side of the connection */
-	sconn = NULL;
-	trc = tcp_uc_open(&sepp, ap_passive, tcp_open_nonblock, &sconn);
+	lconn = NULL;
+	trc = tcp_uc_open(&sepp, ap_passive, tcp_open_nonblock, &lconn);
 	PCUT_ASSERT_INT_EQUALS(TCP_EOK, trc);
-	PCUT_ASSERT_NOT_NULL(sconn);
+	PCUT_ASSERT_NOT_NULL(lconn);
 
-	tcp_uc_set_cb(sconn, &test_conn_cb, &sconn_status);
-	PCUT_ASSERT_EQUALS(&sconn_status, tcp_uc_get_userptr(sconn));
+	sconn_accepted = NULL;
+	tcp_uc_set_cb(lconn, &test_lst_cb, NULL);
 
-	tcp_uc_status(sconn, &cstatus);
+	tcp_uc_status(lconn, &cstatus);
 	PCUT_ASSERT_INT_EQUALS(st_listen, cstatus.cstate);
 
 	/* Client side of the connection */
@@ -295,11 +318,21 @@ static void test_conns_establish(tcp_conn_t **rcconn, tcp_conn_t **rsconn)
 	/* Need to wait for server side */
 
 	fibril_mutex_lock(&cst_lock);
-	tcp_uc_status(sconn, &sconn_status);
-	while (sconn_status.cstate != st_established)
+	while (sconn_accepted == NULL)
 		fibril_condvar_wait(&cst_cv, &cst_lock);
+	sconn = sconn_accepted;
 	fibril_mutex_unlock(&cst_lock);
 
+	PCUT_ASSERT_INT_EQUALS(st_established, sconn_status.cstate);
+
+	/* Listener remains in Listen state */
+	tcp_uc_status(lconn, &cstatus);
+	PCUT_ASSERT_INT_EQUALS(st_listen, cstatus.cstate);
+
+	tcp_uc_set_cb(lconn, NULL, NULL);
+	tcp_uc_abort(lconn);
+	tcp_uc_delete(lconn);
+
 	*rcconn = cconn;
 	*rsconn = sconn;
 }
@@ -42,9 +42,12 @@
 #include <macros.h>
 #include <mem.h>
 #include <stdlib.h>
+#include <sys/time.h>
 
+#include "cc.h"
 #include "conn.h"
 #include "inet.h"
+#include "iqueue.h"
 #include "ncsim.h"
 #include "rqueue.h"
 #include "segment.h"
@@ -52,15 +55,21 @@
 #include "tqueue.h"
 #include "tcp_type.h"
 
-#define RETRANSMIT_TIMEOUT	(2*1000*1000)
+/** Maximum delay of ACK */
+#define ACK_DELAY_TIMEOUT (200 * 1000)
+/** Number of received segments that are always acknowledged immediately */
+#define ACK_DELAY_SEGS 2
 
 static void retransmit_timeout_func(void *);
+static void ack_timeout_func(void *);
 static void tcp_tqueue_timer_set(tcp_conn_t *);
 static void tcp_tqueue_timer_clear(tcp_conn_t *);
+static void tcp_tqueue_ack_timer_clear(tcp_conn_t *);
 static void tcp_tqueue_seg(tcp_conn_t *, tcp_segment_t *);
 static void tcp_conn_transmit_segment(tcp_conn_t *, tcp_segment_t *);
 static void tcp_prepare_transmit_segment(tcp_conn_t *, tcp_segment_t *);
 static void tcp_tqueue_send_immed(tcp_conn_t *, tcp_segment_t *);
+static void tcp_tqueue_retransmit_seg(tcp_conn_t *, tcp_tqueue_entry_t *);
 
 errno_t tcp_tqueue_init(tcp_tqueue_t *tqueue, tcp_conn_t *conn,
     tcp_tqueue_cb_t *cb)
@@ -71,6 +80,13 @@ errno_t tcp_tqueue_init(tcp_tqueue_t *tqueue, tcp_conn_t *conn,
 	if (tqueue->timer == NULL)
 		return ENOMEM;
 
+	tqueue->ack_timer = fibril_timer_create(&conn->lock);
+	if (tqueue->ack_timer == NULL) {
+		fibril_timer_destroy(tqueue->timer);
+		tqueue->timer = NULL;
+		return ENOMEM;
+	}
+
 	list_initialize(&tqueue->list);
 
 	return EOK;
@@ -79,6 +95,10 @@ errno_t tcp_tqueue_init(tcp_tqueue_t *tqueue, tcp_conn_t *conn,
 void tcp_tqueue_clear(tcp_tqueue_t *tqueue)
 {
 	tcp_tqueue_timer_clear(tqueue->conn);
+	if (tqueue->conn->ack_pending > 0) {
+		tqueue->conn->ack_pending = 0;
+		tcp_tqueue_ack_timer_clear(tqueue->conn);
+	}
 }
 
 void tcp_tqueue_fini(tcp_tqueue_t *tqueue)
@@ -91,6 +111,11 @@ void tcp_tqueue_fini(tcp_tqueue_t *tqueue)
 		tqueue->timer = NULL;
 	}
 
+	if (tqueue->ack_timer != NULL) {
+		fibril_timer_destroy(tqueue->ack_timer);
+		tqueue->ack_timer = NULL;
+	}
+
 	while (!list_empty(&tqueue->list)) {
 		link = list_first(&tqueue->list);
 		tqe = list_get_instance(link, tcp_tqueue_entry_t, link);
@@ -146,6 +171,7 @@ static void tcp_tqueue_seg(tcp_conn_t *conn, tcp_segment_t *seg)
 		tqe->conn = conn;
 		tqe->seg = rt_seg;
 		rt_seg->seq = conn->snd_nxt;
+		getuptime(&tqe->xmit_tv);
 
 		list_append(&tqe->link, &conn->retransmit.list);
 
@@ -172,11 +198,12 @@ static void tcp_prepare_transmit_segment(tcp_conn_t *conn, tcp_segment_t *seg)
 	tcp_conn_transmit_segment(conn, seg);
 }
 
-/** Transmit data from the send buffer.
+/** Transmit one segment worth of data from the send buffer.
  *
  * @param conn	Connection
+ * @return	@c true if a segment was sent
  */
-void tcp_tqueue_new_data(tcp_conn_t *conn)
+static bool tcp_tqueue_new_seg(tcp_conn_t *conn)
 {
 	size_t avail_wnd;
 	size_t xfer_seqlen;
@@ -189,23 +216,40 @@ void tcp_tqueue_new_data(tcp_conn_t *conn)
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: tcp_tqueue_new_data()", conn->name);
 
-	/* Number of free sequence numbers in send window */
-	avail_wnd = (conn->snd_una + conn->snd_wnd) - conn->snd_nxt;
+	/* Number of free sequence numbers in send and congestion window */
+	avail_wnd = tcp_cc_wnd(conn);
+	if (avail_wnd > tcp_cc_flight(conn))
+		avail_wnd -= tcp_cc_flight(conn);
+	else
+		avail_wnd = 0;
+
 	snd_buf_seqlen = conn->snd_buf_used + (conn->snd_buf_fin ? 1 : 0);
 
-	xfer_seqlen = min(snd_buf_seqlen, avail_wnd);
+	xfer_seqlen = min(min(snd_buf_seqlen, avail_wnd), TCP_SMSS);
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: snd_buf_seqlen = %zu, SND.WND = %" PRIu32 ", "
 	    "xfer_seqlen = %zu", conn->name, snd_buf_seqlen, conn->snd_wnd,
 	    xfer_seqlen);
 
 	if (xfer_seqlen == 0)
-		return;
+		return false;
 
 	/* XXX Do not always send immediately */
 
 	send_fin = conn->snd_buf_fin && xfer_seqlen == snd_buf_seqlen;
 	data_size = xfer_seqlen - (send_fin ? 1 : 0);
 
+	/*
+	 * Nagle algorithm. Hold back a small segment while there is
+	 * unacknowledged data, so that it can be coalesced with subsequent
+	 * writes. Pushed data and FIN are sent regardless.
+	 */
+	if (!conn->nodelay && conn->snd_push == 0 && !send_fin &&
+	    data_size < TCP_SMSS && tcp_cc_flight(conn) > 0) {
+		log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: Delaying small segment "
+		    "(%zu bytes).", conn->name, data_size);
+		return false;
+	}
+
 	if (send_fin) {
 		log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: Sending out FIN.", conn->name);
 		/* We are sending out FIN */
@@ -217,13 +261,14 @@ void tcp_tqueue_new_data(tcp_conn_t *conn)
 	seg = tcp_segment_make_data(ctrl, conn->snd_buf, data_size);
 	if (seg == NULL) {
 		log_msg(LOG_DEFAULT, LVL_ERROR, "Memory allocation failure.");
-		return;
+		return false;
 	}
 
 	/* Remove data from send buffer */
 	memmove(conn->snd_buf, conn->snd_buf + data_size,
 	    conn->snd_buf_used - data_size);
 	conn->snd_buf_used -= data_size;
+	conn->snd_push -= min(conn->snd_push, data_size);
 
 	if (send_fin)
 		conn->snd_buf_fin = false;
@@ -235,6 +280,20 @@ void tcp_tqueue_new_data(tcp_conn_t *conn)
 
 	tcp_tqueue_seg(conn, seg);
 	tcp_segment_delete(seg);
+	return true;
+}
+
+/** Transmit data from the send buffer.
+ *
+ * Data is split into segments of at most TCP_SMSS bytes and sent
+ * as long as the send and congestion windows allow it.
+ *
+ * @param conn	Connection
+ */
+void tcp_tqueue_new_data(tcp_conn_t *conn)
+{
+	while (tcp_tqueue_new_seg(conn))
+		;
 }
 
 /** Remove ACKed segments from retransmission queue and possibly transmit
@@ -245,10 +304,16 @@ void tcp_tqueue_new_data(tcp_conn_t *conn)
 void tcp_tqueue_ack_received(tcp_conn_t *conn)
 {
 	link_t *cur, *next;
+	struct timeval now, sample_tv;
+	bool have_sample;
+	uint32_t acked;
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: tcp_tqueue_ack_received(%p)", conn->name,
 	    conn);
 
+	acked = 0;
+	have_sample = false;
+
 	cur = conn->retransmit.list.head.next;
 
 	while (cur != &conn->retransmit.list.head) {
@@ -270,6 +335,12 @@ void tcp_tqueue_ack_received(tcp_conn_t *conn)
 				conn->fin_is_acked = true;
 			}
 
+			acked += tqe->seg->len;
+
+			/* Only measure RTT on segments sent once (Karn) */
+			have_sample = !tqe->rexmit;
+			sample_tv = tqe->xmit_tv;
+
 			tcp_segment_delete(tqe->seg);
 			free(tqe);
 
@@ -280,6 +351,14 @@ void tcp_tqueue_ack_received(tcp_conn_t *conn)
 		cur = next;
 	}
 
+	if (have_sample) {
+		getuptime(&now);
+		tcp_cc_rtt_sample(conn, tv_sub_diff(&now, &sample_tv));
+	}
+
+	if (acked > 0)
+		tcp_cc_ack(conn, acked);
+
 	/* Clear retransmission timer if the queue is empty. */
 	if (list_empty(&conn->retransmit.list))
 		tcp_tqueue_timer_clear(conn);
@@ -288,21 +367,195 @@ void tcp_tqueue_ack_received(tcp_conn_t *conn)
 	tcp_tqueue_new_data(conn);
 }
 
+/** Update retransmission queue scoreboard with received SACK blocks.
+ *
+ * Segments the peer reports as received are marked so that they are
+ * skipped during loss recovery. This should be called before SND.UNA
+ * is used to prune the queue with tcp_tqueue_ack_received().
+ *
+ * @param conn	Connection
+ * @param opts	Options of the incoming segment
+ */
+void tcp_tqueue_sack_received(tcp_conn_t *conn, tcp_seg_opts_t *opts)
+{
+	uint32_t flight, left, right, sl;
+	size_t i;
+
+	/* Work with offsets from SND.UNA */
+	flight = conn->snd_nxt - conn->snd_una;
+
+	for (i = 0; i < opts->sack_cnt; i++) {
+		left = opts->sack[i].left - conn->snd_una;
+		right = opts->sack[i].right - conn->snd_una;
+
+		/* Ignore blocks not within (SND.UNA, SND.NXT] */
+		if (left >= right || right > flight)
+			continue;
+
+		list_foreach(conn->retransmit.list, link, tcp_tqueue_entry_t,
+		    tqe) {
+			sl = tqe->seg->seq - conn->snd_una;
+			if (sl >= flight)
+				continue;
+
+			if (left <= sl && sl + tqe->seg->len <= right)
+				tqe->sacked = true;
+		}
+	}
+}
+
+/** Retransmit segments presumed lost.
+ *
+ * This should be called on receiving the third duplicate ACK and on
+ * partial acknowledgement during fast recovery. Without SACK only the
+ * first unacknowledged segment is retransmitted. With SACK also every
+ * other segment below the highest selectively acknowledged one that is
+ * not held by the peer and has not been retransmitted yet is resent.
+ *
+ * @param conn	Connection
+ */
+void tcp_tqueue_fast_retransmit(tcp_conn_t *conn)
+{
+	tcp_tqueue_entry_t *last;
+	bool first;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: tcp_tqueue_fast_retransmit()",
+	    conn->name);
+
+	last = NULL;
+	list_foreach(conn->retransmit.list, link, tcp_tqueue_entry_t, tqe) {
+		if (tqe->sacked)
+			last = tqe;
+	}
+
+	first = true;
+	list_foreach(conn->retransmit.list, link, tcp_tqueue_entry_t, tqe) {
+		if (tqe == last)
+			break;
+		if (!tqe->sacked && (first || !tqe->rexmit))
+			tcp_tqueue_retransmit_seg(conn, tqe);
+		if (last == NULL)
+			break;
+		first = false;
+	}
+
+	/* Reset retransmission timer */
+	if (!list_empty(&conn->retransmit.list))
+		tcp_tqueue_timer_set(conn);
+}
+
+/** Get timestamp value for outgoing segment.
+ *
+ * @return	Timestamp in milliseconds
+ */
+uint32_t tcp_tqueue_ts_now(void)
+{
+	struct timeval tv;
+
+	getuptime(&tv);
+	return tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
+
+/** Fill in options of outgoing segment.
+ *
+ * SYN carries our offer of window scaling, SACK and timestamps. SYN-ACK
+ * only confirms the options the peer has offered.
+ *
+ * @param conn	Connection
+ * @param seg	Segment
+ */
+static void tcp_tqueue_set_opts(tcp_conn_t *conn, tcp_segment_t *seg)
+{
+	tcp_seg_opts_t *opts = &seg->opts;
+	bool offer;
+	size_t max_blocks;
+
+	memset(opts, 0, sizeof(tcp_seg_opts_t));
+
+	if ((seg->ctrl & CTL_RST) != 0)
+		return;
+
+	offer = (seg->ctrl & (CTL_SYN | CTL_ACK)) == CTL_SYN;
+
+	if ((seg->ctrl & CTL_SYN) != 0) {
+		if (offer || conn->ws_ok) {
+			opts->ws_present = true;
+			opts->ws_shift = conn->rcv_wscale;
+		}
+
+		if (offer || conn->sack_ok)
+			opts->sack_perm = true;
+	}
+
+	if (offer || conn->ts_ok) {
+		opts->ts_present = true;
+		opts->ts_val = tcp_tqueue_ts_now();
+		opts->ts_ecr = conn->ts_recent;
+	}
+
+	if (conn->sack_ok && (seg->ctrl & (CTL_SYN | CTL_ACK)) == CTL_ACK) {
+		/* Leave room for timestamps in the options area */
+		max_blocks = TCP_SACK_BLOCKS_MAX - (opts->ts_present ? 1 : 0);
+		opts->sack_cnt = tcp_iqueue_sack_blocks(&conn->incoming,
+		    opts->sack, max_blocks);
+	}
+}
+
 static void tcp_conn_transmit_segment(tcp_conn_t *conn, tcp_segment_t *seg)
 {
+	uint8_t shift;
+
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: tcp_conn_transmit_segment(%p, %p)",
 	    conn->name, conn, seg);
 
-	seg->wnd = conn->rcv_wnd;
+	/* Window in SYN segments is never scaled */
+	shift = 0;
+	if (conn->ws_ok && (seg->ctrl & CTL_SYN) == 0)
+		shift = conn->rcv_wscale;
+	seg->wnd = min(conn->rcv_wnd >> shift, TCP_WND_MAX);
+	conn->rcv_adv = conn->rcv_nxt + (seg->wnd << shift);
 
-	if ((seg->ctrl & CTL_ACK) != 0)
+	if ((seg->ctrl & CTL_ACK) != 0) {
 		seg->ack = conn->rcv_nxt;
-	else
+		conn->last_ack_sent = seg->ack;
+
+		/* Any delayed ACK is piggybacked on this segment */
+		if (conn->ack_pending > 0) {
+			conn->ack_pending = 0;
+			tcp_tqueue_ack_timer_clear(conn);
+		}
+	} else {
 		seg->ack = 0;
+	}
 
+	tcp_tqueue_set_opts(conn, seg);
 	tcp_tqueue_send_immed(conn, seg);
 }
 
+/** Retransmit segment from retransmission queue.
+ *
+ * @param conn	Connection
+ * @param tqe	Retransmission queue entry
+ */
+static void tcp_tqueue_retransmit_seg(tcp_conn_t *conn,
+    tcp_tqueue_entry_t *tqe)
+{
+	tcp_segment_t *rt_seg;
+
+	rt_seg = tcp_segment_dup(tqe->seg);
+	if (rt_seg == NULL) {
+		log_msg(LOG_DEFAULT, LVL_ERROR, "Memory allocation failed.");
+		/* XXX Handle properly */
+		return;
+	}
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "### %s: retransmitting segment", conn->name);
+	tqe->rexmit = true;
+	++conn->stats.retransmits;
+	tcp_conn_transmit_segment(conn, rt_seg);
+	tcp_segment_delete(rt_seg);
+}
+
 void tcp_tqueue_send_immed(tcp_conn_t *conn, tcp_segment_t *seg)
 {
 	log_msg(LOG_DEFAULT, LVL_DEBUG,
@@ -314,6 +567,7 @@ void tcp_tqueue_send_immed(tcp_conn_t *conn, tcp_segment_t *seg)
 
 	tcp_segment_dump(seg);
 
+	++conn->stats.segs_sent;
 	conn->retransmit.cb->transmit_seg(&conn->ident, seg);
 }
 
@@ -321,7 +575,6 @@ static void retransmit_timeout_func(void *arg)
 {
 	tcp_conn_t *conn = (tcp_conn_t *) arg;
 	tcp_tqueue_entry_t *tqe;
-	tcp_segment_t *rt_seg;
 	link_t *link;
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "### %s: retransmit_timeout_func(%p)", conn->name, conn);
@@ -343,27 +596,91 @@ static void retransmit_timeout_func(void *arg)
 		return;
 	}
 
+	tcp_cc_timeout(conn);
+
 	tqe = list_get_instance(link, tcp_tqueue_entry_t, link);
+	tcp_tqueue_retransmit_seg(tqe->conn, tqe);
 
-	rt_seg = tcp_segment_dup(tqe->seg);
-	if (rt_seg == NULL) {
-		log_msg(LOG_DEFAULT, LVL_ERROR, "Memory allocation failed.");
-		tcp_conn_unlock(conn);
-		tcp_conn_delref(conn);
-		/* XXX Handle properly */
+	/* Reset retransmission timer */
+	fibril_timer_set_locked(conn->retransmit.timer, conn->rto,
+	    retransmit_timeout_func, (void *) conn);
+
+	tcp_conn_unlock(conn);
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "### %s: retransmit_timeout_func(%p) end", conn->name, conn);
+}
+
+/** Acknowledge received data, possibly with a delay.
+ *
+ * The ACK is sent immediately for every ACK_DELAY_SEGS-th segment,
+ * otherwise it is delayed for up to ACK_DELAY_TIMEOUT in the hope it
+ * can be piggybacked on outgoing data.
+ *
+ * @param conn	Connection
+ */
+void tcp_tqueue_ack_delayed(tcp_conn_t *conn)
+{
+	assert(fibril_mutex_is_locked(&conn->lock));
+
+	if (++conn->ack_pending >= ACK_DELAY_SEGS) {
+		tcp_tqueue_ctrl_seg(conn, CTL_ACK);
 		return;
 	}
 
-	log_msg(LOG_DEFAULT, LVL_DEBUG, "### %s: retransmitting segment", conn->name);
-	tcp_conn_transmit_segment(tqe->conn, rt_seg);
+	if (conn->ack_pending == 1) {
+		tcp_conn_addref(conn);
+		fibril_timer_set_locked(conn->retransmit.ack_timer,
+		    ACK_DELAY_TIMEOUT, ack_timeout_func, (void *) conn);
+	}
+}
 
-	/* Reset retransmission timer */
-	fibril_timer_set_locked(conn->retransmit.timer, RETRANSMIT_TIMEOUT,
-	    retransmit_timeout_func, (void *) conn);
+/** Send window update if the receive window has opened enough.
+ *
+ * Avoid silly window syndrome by only announcing window increase of at
+ * least one segment or half of the receive buffer.
+ *
+ * @param conn	Connection
+ */
+void tcp_tqueue_wnd_update(tcp_conn_t *conn)
+{
+	uint32_t incr;
+
+	assert(fibril_mutex_is_locked(&conn->lock));
+
+	incr = (conn->rcv_nxt + conn->rcv_wnd) - conn->rcv_adv;
+	if ((int32_t)incr <= 0)
+		return;
+
+	if (incr >= min(TCP_SMSS, conn->rcv_buf_size / 2))
+		tcp_tqueue_ctrl_seg(conn, CTL_ACK);
+}
+
+static void ack_timeout_func(void *arg)
+{
+	tcp_conn_t *conn = (tcp_conn_t *) arg;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: ack_timeout_func(%p)", conn->name,
+	    conn);
+
+	tcp_conn_lock(conn);
+
+	/* Prevent clearing the timer from within its own handler */
+	if (conn->ack_pending > 0 && conn->cstate != st_closed) {
+		conn->ack_pending = 0;
+		tcp_tqueue_ctrl_seg(conn, CTL_ACK);
+	}
 
 	tcp_conn_unlock(conn);
+	tcp_conn_delref(conn);
+}
 
-	log_msg(LOG_DEFAULT, LVL_DEBUG, "### %s: retransmit_timeout_func(%p) end", conn->name, conn);
+/** Clear delayed ACK timer */
+static void tcp_tqueue_ack_timer_clear(tcp_conn_t *conn)
+{
+	assert(fibril_mutex_is_locked(&conn->lock));
+
+	if (fibril_timer_clear_locked(conn->retransmit.ack_timer) == fts_active)
+		tcp_conn_delref(conn);
 }
 
 /** Set or re-set retransmission timer */
@@ -377,7 +694,7 @@ static void tcp_tqueue_timer_set(tcp_conn_t *conn)
 	tcp_tqueue_timer_clear(conn);
 
 	tcp_conn_addref(conn);
-	fibril_timer_set_locked(conn->retransmit.timer, RETRANSMIT_TIMEOUT,
+	fibril_timer_set_locked(conn->retransmit.timer, conn->rto,
 	    retransmit_timeout_func, (void *) conn);
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "### %s: tcp_tqueue_timer_set() end", conn->name);
@@ -171,12 +171,43 @@ tcp_error_t tcp_uc_send(tcp_conn_t *conn, void *data, size_t size,
 		tcp_tqueue_new_data(conn);
 	}
 
+	if ((flags & XF_PUSH) != 0)
+		conn->snd_push = conn->snd_buf_used;
+
 	tcp_tqueue_new_data(conn);
 	tcp_conn_unlock(conn);
 
 	return TCP_EOK;
 }
 
+/** Set connection no-delay option.
+ *
+ * @param conn		Connection
+ * @param nodelay	@c true to send small segments without delay
+ *			(disable Nagle algorithm)
+ */
+tcp_error_t tcp_uc_set_nodelay(tcp_conn_t *conn, bool nodelay)
+{
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: tcp_uc_set_nodelay(%d)",
+	    conn->name, (int) nodelay);
+
+	tcp_conn_lock(conn);
+
+	if (conn->cstate == st_closed) {
+		tcp_conn_unlock(conn);
+		return TCP_ENOTEXIST;
+	}
+
+	conn->nodelay = nodelay;
+
+	/* Flush any held back data */
+	if (nodelay)
+		tcp_tqueue_new_data(conn);
+
+	tcp_conn_unlock(conn);
+	return TCP_EOK;
+}
+
 /** RECEIVE user call */
 tcp_error_t tcp_uc_receive(tcp_conn_t *conn, void *buf, size_t size,
     size_t *rcvd, xflags_t *xflags)
@@ -230,8 +261,8 @@ tcp_error_t tcp_uc_receive(tcp_conn_t *conn, void *buf, size_t size,
 	/* TODO */
 	*xflags = 0;
 
-	/* Send new size of receive window */
-	tcp_tqueue_ctrl_seg(conn, CTL_ACK);
+	/* Send new size of receive window if it opened enough */
+	tcp_tqueue_wnd_update(conn);
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: tcp_uc_receive() - returning %zu bytes",
 	    conn->name, xfer_size);
@@ -293,6 +324,27 @@ void tcp_uc_status(tcp_conn_t *conn, tcp_conn_status_t *cstatus)
 	cstatus->cstate = conn->cstate;
 }
 
+/** Get connection statistics (not in spec).
+ *
+ * @param conn		Connection
+ * @param stats		Place to store statistics
+ */
+void tcp_uc_get_stats(tcp_conn_t *conn, tcp_conn_stats_t *stats)
+{
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "tcp_uc_get_stats()");
+
+	tcp_conn_lock(conn);
+	*stats = conn->stats;
+	stats->srtt = conn->srtt;
+	stats->rttvar = conn->rttvar;
+	stats->rto = conn->rto;
+	stats->cwnd = conn->cc.cwnd;
+	stats->ssthresh = conn->cc.ssthresh;
+	stats->snd_wnd = conn->snd_wnd;
+	stats->rcv_wnd = conn->rcv_wnd;
+	tcp_conn_unlock(conn);
+}
+
 /** Delete connection user call.
  *
  * (Not in spec.) Inform TCP that the user is done with this connection
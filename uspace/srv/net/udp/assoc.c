@@ -34,6 +34,7 @@
  * @file UDP associations
  */
 
+#include <adt/hash_table.h>
 #include <adt/list.h>
 #include <errno.h>
 #include <stdbool.h>
@@ -54,6 +55,62 @@ static LIST_INITIALIZE(assoc_list);
 static FIBRIL_MUTEX_INITIALIZE(assoc_list_lock);
 static amap_t *amap;
 
+/**
+ * Hash index of associations keyed by local port number.
+ *
+ * Received datagrams are matched against the few associations sharing
+ * the destination port instead of walking the association map.
+ */
+static hash_table_t assoc_table;
+
+/** Match quality of an association, mirrors the order used by amap */
+typedef enum {
+	/** Does not match */
+	udp_am_none,
+	/** Unspecified local endpoint */
+	udp_am_unspec,
+	/** Local link */
+	udp_am_llink,
+	/** Local address */
+	udp_am_laddr,
+	/** Remote endpoint and local address */
+	udp_am_repla
+} udp_assoc_match_t;
+
+static size_t assoc_hash(const ht_link_t *item)
+{
+	udp_assoc_t *assoc = hash_table_get_inst(item, udp_assoc_t, hash_link);
+	return assoc->map_ident.local.port;
+}
+
+static size_t assoc_key_hash(void *key)
+{
+	return *(uint16_t *) key;
+}
+
+static bool assoc_equal(const ht_link_t *item1, const ht_link_t *item2)
+{
+	udp_assoc_t *assoc1 = hash_table_get_inst(item1, udp_assoc_t,
+	    hash_link);
+	udp_assoc_t *assoc2 = hash_table_get_inst(item2, udp_assoc_t,
+	    hash_link);
+	return assoc1->map_ident.local.port == assoc2->map_ident.local.port;
+}
+
+static bool assoc_key_equal(void *key, const ht_link_t *item)
+{
+	udp_assoc_t *assoc = hash_table_get_inst(item, udp_assoc_t, hash_link);
+	return assoc->map_ident.local.port == *(uint16_t *) key;
+}
+
+static hash_table_ops_t assoc_hash_ops = {
+	.hash = assoc_hash,
+	.key_hash = assoc_key_hash,
+	.equal = assoc_equal,
+	.key_equal = assoc_key_equal,
+	.remove_callback = NULL
+};
+
 static udp_assoc_t *udp_assoc_find_ref(inet_ep2_t *);
 static errno_t udp_assoc_queue_msg(udp_assoc_t *, inet_ep2_t *, udp_msg_t *);
 
@@ -68,6 +125,12 @@ errno_t udp_assocs_init(void)
 		return ENOMEM;
 	}
 
+	if (!hash_table_create(&assoc_table, 0, 0, &assoc_hash_ops)) {
+		amap_destroy(amap);
+		amap = NULL;
+		return ENOMEM;
+	}
+
 	return EOK;
 }
 
@@ -197,7 +260,9 @@ errno_t udp_assoc_add(udp_assoc_t *assoc)
 	}
 
 	assoc->ident = aepp;
+	assoc->map_ident = aepp;
 	list_append(&assoc->link, &assoc_list);
+	hash_table_insert(&assoc_table, &assoc->hash_link);
 	fibril_mutex_unlock(&assoc_list_lock);
 
 	return EOK;
@@ -212,6 +277,7 @@ void udp_assoc_remove(udp_assoc_t *assoc)
 	fibril_mutex_lock(&assoc_list_lock);
 	amap_remove(amap, &assoc->ident);
 	list_remove(&assoc->link);
+	hash_table_remove_item(&assoc_table, &assoc->hash_link);
 	fibril_mutex_unlock(&assoc_list_lock);
 	udp_assoc_delref(assoc);
 }
@@ -404,36 +470,88 @@ static errno_t udp_assoc_queue_msg(udp_assoc_t *assoc, inet_ep2_t *epp,
 	return EOK;
 }
 
+/** Determine how well an association matches an endpoint pair.
+ *
+ * Uses the same rules as the association map the association was
+ * entered into (see amap_find_match()).
+ *
+ * @param assoc	Association with the same local port as @a epp
+ * @param epp	Endpoint pair of a received datagram
+ * @return	Match quality
+ */
+static udp_assoc_match_t udp_assoc_match(udp_assoc_t *assoc, inet_ep2_t *epp)
+{
+	inet_ep2_t *mepp = &assoc->map_ident;
+
+	if (!inet_addr_is_any(&mepp->remote.addr)) {
+		if (inet_addr_compare(&mepp->remote.addr, &epp->remote.addr) &&
+		    mepp->remote.port == epp->remote.port &&
+		    inet_addr_compare(&mepp->local.addr, &epp->local.addr))
+			return udp_am_repla;
+
+		return udp_am_none;
+	}
+
+	if (!inet_addr_is_any(&mepp->local.addr)) {
+		if (inet_addr_compare(&mepp->local.addr, &epp->local.addr))
+			return udp_am_laddr;
+
+		return udp_am_none;
+	}
+
+	if (mepp->local_link != 0) {
+		if (epp->local_link != 0 &&
+		    mepp->local_link == epp->local_link)
+			return udp_am_llink;
+
+		return udp_am_none;
+	}
+
+	return udp_am_unspec;
+}
+
 /** Find association structure for specified endpoint pair.
  *
- * An association is uniquely identified by an endpoint pair. Look up our
- * association map and return association structure based on endpoint pair.
- * The association reference count is bumped by one.
+ * An association is uniquely identified by an endpoint pair. Look up
+ * associations with the local port of the endpoint pair and return the
+ * most specific one that matches. The association reference count is
+ * bumped by one.
  *
  * @param epp	Endpoint pair
  * @return	Association structure or NULL if not found.
  */
 static udp_assoc_t *udp_assoc_find_ref(inet_ep2_t *epp)
 {
-	errno_t rc;
-	void *arg;
-	udp_assoc_t *assoc;
+	udp_assoc_t *best = NULL;
+	udp_assoc_match_t best_match = udp_am_none;
+	ht_link_t *first;
+	ht_link_t *link;
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "udp_assoc_find_ref(%p)", epp);
 	fibril_mutex_lock(&assoc_list_lock);
 
-	rc = amap_find_match(amap, epp, &arg);
-	if (rc != EOK) {
-		assert(rc == ENOENT);
-		fibril_mutex_unlock(&assoc_list_lock);
-		return NULL;
+	first = hash_table_find(&assoc_table, &epp->local.port);
+	link = first;
+	while (link != NULL) {
+		udp_assoc_t *assoc = hash_table_get_inst(link, udp_assoc_t,
+		    hash_link);
+		udp_assoc_match_t match = udp_assoc_match(assoc, epp);
+
+		if (match > best_match) {
+			best = assoc;
+			best_match = match;
+			if (match == udp_am_repla)
+				break;
+		}
+
+		link = hash_table_find_next(&assoc_table, first, link);
 	}
 
-	assoc = (udp_assoc_t *)arg;
-	udp_assoc_addref(assoc);
+	if (best != NULL)
+		udp_assoc_addref(best);
 
 	fibril_mutex_unlock(&assoc_list_lock);
-	return assoc;
+	return best;
 }
 
 /**
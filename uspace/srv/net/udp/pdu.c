@@ -40,49 +40,12 @@
 #include <mem.h>
 #include <stdlib.h>
 #include <inet/addr.h>
+#include <inet/checksum.h>
 #include "msg.h"
 #include "pdu.h"
 #include "std.h"
 #include "udp_type.h"
 
-#define UDP_CHECKSUM_INIT 0xffff
-
-/** One's complement addition.
- *
- * Result is a + b + carry.
- */
-static uint16_t udp_ocadd16(uint16_t a, uint16_t b)
-{
-	uint32_t s;
-
-	s = (uint32_t)a + (uint32_t)b;
-	return (s & 0xffff) + (s >> 16);
-}
-
-static uint16_t udp_checksum_calc(uint16_t ivalue, void *data, size_t size)
-{
-	uint16_t sum;
-	uint16_t w;
-	size_t words, i;
-	uint8_t *bdata;
-
-	sum = ~ivalue;
-	words = size / 2;
-	bdata = (uint8_t *)data;
-
-	for (i = 0; i < words; i++) {
-		w = ((uint16_t)bdata[2 * i] << 8) | bdata[2 * i + 1];
-		sum = udp_ocadd16(sum, w);
-	}
-
-	if (size % 2 != 0) {
-		w = ((uint16_t)bdata[2 * words] << 8);
-		sum = udp_ocadd16(sum, w);
-	}
-
-	return ~sum;
-}
-
 static ip_ver_t udp_phdr_setup(udp_pdu_t *pdu, udp_phdr_t *phdr,
     udp_phdr6_t *phdr6)
 {
@@ -129,7 +92,16 @@ void udp_pdu_delete(udp_pdu_t *pdu)
 	free(pdu);
 }
 
-static uint16_t udp_pdu_checksum_calc(udp_pdu_t *pdu)
+/** Compute partial checksum of PDU.
+ *
+ * Only the pseudo-header is summed. The result is stored in the checksum
+ * field and the sum is completed over the datagram by inetsrv or by the NIC
+ * (see INET_CSUM_PARTIAL).
+ *
+ * @param pdu PDU
+ * @return Ones' complement sum of the pseudo-header
+ */
+static uint16_t udp_pdu_checksum_phdr(udp_pdu_t *pdu)
 {
 	uint16_t cs_phdr;
 	udp_phdr_t phdr;
@@ -138,18 +110,18 @@ static uint16_t udp_pdu_checksum_calc(udp_pdu_t *pdu)
 	ip_ver_t ver = udp_phdr_setup(pdu, &phdr, &phdr6);
 	switch (ver) {
 	case ip_v4:
-		cs_phdr = udp_checksum_calc(UDP_CHECKSUM_INIT, (void *) &phdr,
+		cs_phdr = inet_checksum_calc(INET_CHECKSUM_INIT, &phdr,
 		    sizeof(udp_phdr_t));
 		break;
 	case ip_v6:
-		cs_phdr = udp_checksum_calc(UDP_CHECKSUM_INIT, (void *) &phdr6,
+		cs_phdr = inet_checksum_calc(INET_CHECKSUM_INIT, &phdr6,
 		    sizeof(udp_phdr6_t));
 		break;
 	default:
 		assert(false);
 	}
 
-	return udp_checksum_calc(cs_phdr, pdu->data, pdu->data_size);
+	return ~cs_phdr;
 }
 
 static void udp_pdu_set_checksum(udp_pdu_t *pdu, uint16_t checksum)
@@ -212,7 +184,6 @@ errno_t udp_pdu_encode(inet_ep2_t *epp, udp_msg_t *msg, udp_pdu_t **pdu)
 {
 	udp_pdu_t *npdu;
 	udp_header_t *hdr;
-	uint16_t checksum;
 
 	npdu = udp_pdu_new();
 	if (npdu == NULL)
@@ -238,9 +209,8 @@ errno_t udp_pdu_encode(inet_ep2_t *epp, udp_msg_t *msg, udp_pdu_t **pdu)
 	memcpy((uint8_t *)npdu->data + sizeof(udp_header_t), msg->data,
 	    msg->data_size);
 
-	/* Checksum calculation */
-	checksum = udp_pdu_checksum_calc(npdu);
-	udp_pdu_set_checksum(npdu, checksum);
+	/* Partial checksum, completed when sent */
+	udp_pdu_set_checksum(npdu, udp_pdu_checksum_phdr(npdu));
 
 	*pdu = npdu;
 	return EOK;
@@ -34,6 +34,7 @@
  * @file HelenOS service implementation
  */
 
+#include <align.h>
 #include <async.h>
 #include <errno.h>
 #include <inet/endpoint.h>
@@ -42,7 +43,9 @@
 #include <ipc/udp.h>
 #include <loc.h>
 #include <macros.h>
+#include <mem.h>
 #include <stdlib.h>
+#include <str_error.h>
 
 #include "assoc.h"
 #include "msg.h"
@@ -54,6 +57,9 @@
 /** Maximum message size */
 #define MAX_MSG_SIZE DATA_XFER_LIMIT
 
+/** Maximum number of messages queued for one client association */
+#define MAX_CASSOC_QUEUED 256
+
 static void udp_cassoc_recv_msg(void *, inet_ep2_t *, udp_msg_t *);
 
 /** Callbacks to tie us to association layer */
@@ -67,7 +73,10 @@ static udp_assoc_cb_t udp_cassoc_cb = {
  * @param epp    Endpoint pair on which message was received
  * @param msg    Message
  *
- * @return EOK on success, ENOMEM if out of memory
+ * Must be called with client lock held.
+ *
+ * @return EOK on success, ENOMEM if out of memory, ELIMIT if the
+ *         association already has too many messages queued
  */
 static errno_t udp_cassoc_queue_msg(udp_cassoc_t *cassoc, inet_ep2_t *epp,
     udp_msg_t *msg)
@@ -77,6 +86,9 @@ static errno_t udp_cassoc_queue_msg(udp_cassoc_t *cassoc, inet_ep2_t *epp,
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "udp_cassoc_queue_msg(%p, %p, %p)",
 	    cassoc, epp, msg);
 
+	if (cassoc->rcv_queued >= MAX_CASSOC_QUEUED)
+		return ELIMIT;
+
 	rqe = calloc(1, sizeof(udp_crcv_queue_entry_t));
 	if (rqe == NULL)
 		return ENOMEM;
@@ -87,9 +99,24 @@ static errno_t udp_cassoc_queue_msg(udp_cassoc_t *cassoc, inet_ep2_t *epp,
 	rqe->cassoc = cassoc;
 
 	list_append(&rqe->link, &cassoc->client->crcv_queue);
+	++cassoc->rcv_queued;
 	return EOK;
 }
 
+/** Remove entry from client receive queue and free it.
+ *
+ * Must be called with client lock held.
+ *
+ * @param rqe Client receive queue entry
+ */
+static void udp_crcv_queue_entry_delete(udp_crcv_queue_entry_t *rqe)
+{
+	list_remove(&rqe->link);
+	--rqe->cassoc->rcv_queued;
+	udp_msg_delete(rqe->msg);
+	free(rqe);
+}
+
 /** Send 'data' event to client.
  *
  * @param client Client
@@ -149,6 +176,18 @@ static errno_t udp_cassoc_create(udp_client_t *client, udp_assoc_t *assoc,
  */
 static void udp_cassoc_destroy(udp_cassoc_t *cassoc)
 {
+	udp_client_t *client = cassoc->client;
+
+	/* Purge messages still queued for this association */
+	fibril_mutex_lock(&client->lock);
+	list_foreach_safe(client->crcv_queue, cur, next) {
+		udp_crcv_queue_entry_t *rqe = list_get_instance(cur,
+		    udp_crcv_queue_entry_t, link);
+		if (rqe->cassoc == cassoc)
+			udp_crcv_queue_entry_delete(rqe);
+	}
+	fibril_mutex_unlock(&client->lock);
+
 	list_remove(&cassoc->lclient);
 	free(cassoc);
 }
@@ -186,9 +225,31 @@ static errno_t udp_cassoc_get(udp_client_t *client, sysarg_t id,
 static void udp_cassoc_recv_msg(void *arg, inet_ep2_t *epp, udp_msg_t *msg)
 {
 	udp_cassoc_t *cassoc = (udp_cassoc_t *) arg;
+	udp_client_t *client = cassoc->client;
+	bool notify;
+	errno_t rc;
+
+	fibril_mutex_lock(&client->lock);
+
+	rc = udp_cassoc_queue_msg(cassoc, epp, msg);
+	if (rc != EOK) {
+		fibril_mutex_unlock(&client->lock);
+		log_msg(LOG_DEFAULT, LVL_DEBUG, "udp_cassoc_recv_msg: "
+		    "message dropped (%s)", str_error_name(rc));
+		udp_msg_delete(msg);
+		return;
+	}
+
+	/*
+	 * The client drains the whole queue in response to one event,
+	 * no need to send another one until it has found it empty.
+	 */
+	notify = !client->ev_pending;
+	client->ev_pending = true;
+	fibril_mutex_unlock(&client->lock);
 
-	udp_cassoc_queue_msg(cassoc, epp, msg);
-	udp_ev_data(cassoc->client);
+	if (notify)
+		udp_ev_data(client);
 }
 
 /** Create association.
@@ -555,7 +616,6 @@ udp_rmsg_info_srv(udp_client_t *client, cap_call_handle_t icall_handle,
 	errno_t rc;
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "udp_rmsg_info_srv()");
-	enext = udp_rmsg_get_next(client);
 
 	if (!async_data_read_receive(&chandle, &size)) {
 		async_answer_0(chandle, EREFUSED);
@@ -563,7 +623,12 @@ udp_rmsg_info_srv(udp_client_t *client, cap_call_handle_t icall_handle,
 		return;
 	}
 
+	fibril_mutex_lock(&client->lock);
+	enext = udp_rmsg_get_next(client);
+
 	if (enext == NULL) {
+		client->ev_pending = false;
+		fibril_mutex_unlock(&client->lock);
 		async_answer_0(chandle, ENOENT);
 		async_answer_0(icall_handle, ENOENT);
 		return;
@@ -572,12 +637,14 @@ udp_rmsg_info_srv(udp_client_t *client, cap_call_handle_t icall_handle,
 	rc = async_data_read_finalize(chandle, &enext->epp.remote,
 	    max(size, (size_t)sizeof(inet_ep_t)));
 	if (rc != EOK) {
+		fibril_mutex_unlock(&client->lock);
 		async_answer_0(icall_handle, rc);
 		return;
 	}
 
 	assoc_id = enext->cassoc->id;
 	size = enext->msg->data_size;
+	fibril_mutex_unlock(&client->lock);
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "udp_rmsg_info_srv(): assoc_id=%zu, "
 	    "size=%zu", assoc_id, size);
@@ -607,15 +674,17 @@ udp_rmsg_read_srv(udp_client_t *client, cap_call_handle_t icall_handle,
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "udp_rmsg_read_srv()");
 	off = IPC_GET_ARG1(*icall);
 
-	enext = udp_rmsg_get_next(client);
-
 	if (!async_data_read_receive(&chandle, &size)) {
 		async_answer_0(chandle, EREFUSED);
 		async_answer_0(icall_handle, EREFUSED);
 		return;
 	}
 
+	fibril_mutex_lock(&client->lock);
+	enext = udp_rmsg_get_next(client);
+
 	if (enext == NULL) {
+		fibril_mutex_unlock(&client->lock);
 		async_answer_0(chandle, ENOENT);
 		async_answer_0(icall_handle, ENOENT);
 		return;
@@ -625,12 +694,14 @@ udp_rmsg_read_srv(udp_client_t *client, cap_call_handle_t icall_handle,
 	msg_size = enext->msg->data_size;
 
 	if (off > msg_size) {
+		fibril_mutex_unlock(&client->lock);
 		async_answer_0(chandle, EINVAL);
 		async_answer_0(icall_handle, EINVAL);
 		return;
 	}
 
 	rc = async_data_read_finalize(chandle, data, min(msg_size - off, size));
+	fibril_mutex_unlock(&client->lock);
 	if (rc != EOK) {
 		async_answer_0(icall_handle, rc);
 		return;
@@ -657,19 +728,118 @@ udp_rmsg_discard_srv(udp_client_t *client, cap_call_handle_t icall_handle,
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "udp_rmsg_discard_srv()");
 
+	fibril_mutex_lock(&client->lock);
 	enext = udp_rmsg_get_next(client);
 	if (enext == NULL) {
+		fibril_mutex_unlock(&client->lock);
 		log_msg(LOG_DEFAULT, LVL_DEBUG, "usg_rmsg_discard_srv: enext==NULL");
 		async_answer_0(icall_handle, ENOENT);
 		return;
 	}
 
-	list_remove(&enext->link);
-	udp_msg_delete(enext->msg);
-	free(enext);
+	udp_crcv_queue_entry_delete(enext);
+	fibril_mutex_unlock(&client->lock);
 	async_answer_0(icall_handle, EOK);
 }
 
+/** Read and discard a batch of received messages.
+ *
+ * Handle client request to read as many received messages as fit into
+ * the client buffer. Each message is returned as a udp_rmsg_hdr_t header
+ * followed by the message data and is removed from the queue. The answer
+ * carries the number of messages and the number of bytes transferred.
+ *
+ * If the first message does not fit, ELIMIT is returned and the client
+ * needs to fall back to UDP_RMSG_INFO / UDP_RMSG_READ / UDP_RMSG_DISCARD.
+ *
+ * @param client        UDP client
+ * @param icall_handle  Async request call handle
+ * @param icall         Async request data
+ */
+static void
+udp_rmsg_read_batch_srv(udp_client_t *client, cap_call_handle_t icall_handle,
+    ipc_call_t *icall)
+{
+	cap_call_handle_t chandle;
+	udp_crcv_queue_entry_t *enext;
+	udp_rmsg_hdr_t *hdr;
+	uint8_t *buf;
+	size_t size;
+	size_t off;
+	size_t rlen;
+	sysarg_t count;
+	errno_t rc;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "udp_rmsg_read_batch_srv()");
+
+	if (!async_data_read_receive(&chandle, &size)) {
+		async_answer_0(chandle, EREFUSED);
+		async_answer_0(icall_handle, EREFUSED);
+		return;
+	}
+
+	if (size > MAX_MSG_SIZE)
+		size = MAX_MSG_SIZE;
+
+	buf = malloc(size);
+	if (buf == NULL) {
+		async_answer_0(chandle, ENOMEM);
+		async_answer_0(icall_handle, ENOMEM);
+		return;
+	}
+
+	fibril_mutex_lock(&client->lock);
+
+	if (list_empty(&client->crcv_queue)) {
+		client->ev_pending = false;
+		fibril_mutex_unlock(&client->lock);
+		free(buf);
+		async_answer_0(chandle, ENOENT);
+		async_answer_0(icall_handle, ENOENT);
+		return;
+	}
+
+	off = 0;
+	count = 0;
+	while ((enext = udp_rmsg_get_next(client)) != NULL) {
+		rlen = sizeof(udp_rmsg_hdr_t) + enext->msg->data_size;
+		if (rlen > size - off)
+			break;
+
+		hdr = (udp_rmsg_hdr_t *) (buf + off);
+		hdr->assoc_id = enext->cassoc->id;
+		hdr->size = enext->msg->data_size;
+		hdr->remote_ep = enext->epp.remote;
+		memcpy(buf + off + sizeof(udp_rmsg_hdr_t), enext->msg->data,
+		    enext->msg->data_size);
+
+		off = min((size_t) ALIGN_UP(off + rlen, sizeof(sysarg_t)), size);
+		++count;
+
+		udp_crcv_queue_entry_delete(enext);
+	}
+
+	fibril_mutex_unlock(&client->lock);
+
+	if (count == 0) {
+		free(buf);
+		async_answer_0(chandle, ELIMIT);
+		async_answer_0(icall_handle, ELIMIT);
+		return;
+	}
+
+	rc = async_data_read_finalize(chandle, buf, off);
+	free(buf);
+	if (rc != EOK) {
+		async_answer_0(icall_handle, rc);
+		return;
+	}
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "udp_rmsg_read_batch_srv(): "
+	    "count=%zu size=%zu", (size_t) count, off);
+	async_answer_2(icall_handle, EOK, count, off);
+}
+
 /** Handle UDP client connection.
  *
  * @param icall_handle  Connect call handle
@@ -690,6 +860,8 @@ static void udp_client_conn(cap_call_handle_t icall_handle, ipc_call_t *icall,
 	client.sess = NULL;
 	list_initialize(&client.cassoc);
 	list_initialize(&client.crcv_queue);
+	fibril_mutex_initialize(&client.lock);
+	client.ev_pending = false;
 
 	while (true) {
 		log_msg(LOG_DEFAULT, LVL_DEBUG, "udp_client_conn: wait req");
@@ -730,6 +902,9 @@ static void udp_client_conn(cap_call_handle_t icall_handle, ipc_call_t *icall,
 		case UDP_RMSG_DISCARD:
 			udp_rmsg_discard_srv(&client, chandle, &call);
 			break;
+		case UDP_RMSG_READ_BATCH:
+			udp_rmsg_read_batch_srv(&client, chandle, &call);
+			break;
 		default:
 			async_answer_0(chandle, ENOTSUP);
 			break;
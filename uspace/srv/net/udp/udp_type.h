@@ -35,6 +35,7 @@
 #ifndef UDP_TYPE_H
 #define UDP_TYPE_H
 
+#include <adt/hash_table.h>
 #include <async.h>
 #include <fibril.h>
 #include <fibril_synch.h>
@@ -100,9 +101,13 @@ typedef struct {
 typedef struct {
 	char *name;
 	link_t link;
+	/** Link to the association hash index (keyed by local port) */
+	ht_link_t hash_link;
 
 	/** Association identification (endpoint pair) */
 	inet_ep2_t ident;
+	/** Endpoint pair as entered in the association map */
+	inet_ep2_t map_ident;
 
 	/** True if association was reset by user */
 	bool reset;
@@ -151,6 +156,8 @@ typedef struct udp_cassoc {
 	/** Client */
 	struct udp_client *client;
 	link_t lclient;
+	/** Number of messages in client receive queue for this association */
+	size_t rcv_queued;
 } udp_cassoc_t;
 
 /** UDP client receive queue entry */
@@ -173,6 +180,10 @@ typedef struct udp_client {
 	list_t cassoc; /* of udp_cassoc_t */
 	/** Client receive queue */
 	list_t crcv_queue;
+	/** Protects client receive queue */
+	fibril_mutex_t lock;
+	/** Data event sent, client has not yet found the queue empty */
+	bool ev_pending;
 } udp_client_t;
 
 #endif
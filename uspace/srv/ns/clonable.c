@@ -42,6 +42,9 @@
 #include "clonable.h"
 #include "ns.h"
 
+/** Number of loaders kept started in advance. */
+#define LOADER_POOL_SIZE  2
+
 /** Request for connection to a clonable service. */
 typedef struct {
 	link_t link;
@@ -51,12 +54,74 @@ typedef struct {
 	sysarg_t arg3;
 } cs_req_t;
 
+/** Started clonable server waiting for a client. */
+typedef struct {
+	link_t link;
+	async_sess_t *sess;
+} cs_srv_t;
+
 /** List of clonable-service connection requests. */
 static list_t cs_req;
 
+/** List of idle clonable servers. */
+static list_t cs_pool;
+
+/** Number of idle clonable servers. */
+static size_t cs_pool_count;
+
+/** Number of spawned clonable servers which have not registered yet. */
+static size_t cs_starting;
+
+/** Start loaders until there are enough of them for future requests.
+ *
+ * Loaders which are still starting are first used to serve pending
+ * requests, the rest of them will end up in the pool.
+ *
+ * @return EOK on success or the error code of the failed spawn.
+ */
+static errno_t clonable_pool_fill(void)
+{
+	while (cs_pool_count + cs_starting <
+	    LOADER_POOL_SIZE + list_count(&cs_req)) {
+		errno_t rc = loader_spawn("loader");
+		if (rc != EOK)
+			return rc;
+
+		cs_starting++;
+	}
+
+	return EOK;
+}
+
+/** Forward a connection request to a clonable server.
+ *
+ * @param csr  Connection request.
+ * @param sess Session to the clonable server.
+ *
+ */
+static void clonable_forward(cs_req_t *csr, async_sess_t *sess)
+{
+	async_exch_t *exch = async_exchange_begin(sess);
+	async_forward_fast(csr->chandle, exch, csr->iface, csr->arg3, 0,
+	    IPC_FF_NONE);
+	async_exchange_end(exch);
+
+	free(csr);
+	async_hangup(sess);
+}
+
 errno_t clonable_init(void)
 {
 	list_initialize(&cs_req);
+	list_initialize(&cs_pool);
+	cs_pool_count = 0;
+	cs_starting = 0;
+
+	/*
+	 * Failure to start the loaders is not fatal, they are started
+	 * again when a client asks for one.
+	 */
+	(void) clonable_pool_fill();
 	return EOK;
 }
 
@@ -67,6 +132,9 @@ bool service_clonable(service_t service)
 }
 
 /** Register clonable service.
+ *
+ * The server is connected to a pending client or kept in the pool of
+ * idle servers.
  *
  * @param service Service to be registered.
  * @param phone   Phone to be used for connections to the service.
@@ -76,36 +144,54 @@ bool service_clonable(service_t service)
 void register_clonable(service_t service, sysarg_t phone, ipc_call_t *call,
     cap_call_handle_t chandle)
 {
+	/* Currently we can only handle a single type of clonable service. */
+	assert(service == SERVICE_LOADER);
+
+	if (cs_starting > 0)
+		cs_starting--;
+
 	link_t *req_link = list_first(&cs_req);
-	if (req_link == NULL) {
+	if ((req_link == NULL) && (cs_pool_count >= LOADER_POOL_SIZE)) {
 		/* There was no pending connection request. */
 		printf("%s: Unexpected clonable server.\n", NAME);
 		async_answer_0(chandle, EBUSY);
 		return;
 	}
 
-	cs_req_t *csr = list_get_instance(req_link, cs_req_t, link);
-	list_remove(req_link);
-
-	/* Currently we can only handle a single type of clonable service. */
-	assert(csr->service == SERVICE_LOADER);
-
 	async_answer_0(chandle, EOK);
 
 	async_sess_t *sess = async_callback_receive(EXCHANGE_SERIALIZE);
-	if (sess == NULL)
-		async_answer_0(chandle, EIO);
+	if (sess == NULL) {
+		(void) clonable_pool_fill();
+		return;
+	}
 
-	async_exch_t *exch = async_exchange_begin(sess);
-	async_forward_fast(csr->chandle, exch, csr->iface, csr->arg3, 0,
-	    IPC_FF_NONE);
-	async_exchange_end(exch);
+	if (req_link == NULL) {
+		cs_srv_t *srv = malloc(sizeof(cs_srv_t));
+		if (srv == NULL) {
+			async_hangup(sess);
+			return;
+		}
+
+		link_initialize(&srv->link);
+		srv->sess = sess;
+		list_append(&srv->link, &cs_pool);
+		cs_pool_count++;
+		return;
+	}
 
-	free(csr);
-	async_hangup(sess);
+	cs_req_t *csr = list_get_instance(req_link, cs_req_t, link);
+	list_remove(req_link);
+
+	assert(csr->service == SERVICE_LOADER);
+
+	clonable_forward(csr, sess);
 }
 
 /** Connect client to clonable service.
+ *
+ * An idle server from the pool is used if there is one, otherwise the
+ * request waits for a newly spawned server.
  *
  * @param service  Service to be connected to.
  * @param iface    Interface to be connected to.
@@ -126,27 +212,42 @@ void connect_to_clonable(service_t service, iface_t iface, ipc_call_t *call,
 		return;
 	}
 
-	/* Spawn a loader. */
-	errno_t rc = loader_spawn("loader");
-
-	if (rc != EOK) {
-		free(csr);
-		async_answer_0(chandle, rc);
-		return;
-	}
-
 	link_initialize(&csr->link);
 	csr->service = service;
 	csr->iface = iface;
 	csr->chandle = chandle;
 	csr->arg3 = IPC_GET_ARG3(*call);
 
+	link_t *srv_link = list_first(&cs_pool);
+	if (srv_link != NULL) {
+		cs_srv_t *srv = list_get_instance(srv_link, cs_srv_t, link);
+		list_remove(srv_link);
+		cs_pool_count--;
+
+		async_sess_t *sess = srv->sess;
+		free(srv);
+
+		clonable_forward(csr, sess);
+
+		/* Replace the server taken from the pool. */
+		(void) clonable_pool_fill();
+		return;
+	}
+
 	/*
 	 * We can forward the call only after the server we spawned connects
 	 * to us. Meanwhile we might need to service more connection requests.
 	 * Thus we store the call in a queue.
 	 */
 	list_append(&csr->link, &cs_req);
+
+	/* Spawn a loader. */
+	errno_t rc = clonable_pool_fill();
+	if (cs_starting == 0) {
+		list_remove(&csr->link);
+		free(csr);
+		async_answer_0(chandle, rc);
+	}
 }
 
 /**
@@ -0,0 +1,224 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup ipc-test
+ * @{
+ */
+/**
+ * @file
+ * @brief IPC test service
+ *
+ * Peer for IPC benchmarks. Answers pings and serves data and memory sharing
+ * requests without doing any work of its own, so that clients measure the
+ * cost of the IPC mechanism alone.
+ */
+
+#include <as.h>
+#include <async.h>
+#include <errno.h>
+#include <str_error.h>
+#include <ipc/ipc_test.h>
+#include <ipc/services.h>
+#include <loc.h>
+#include <mem.h>
+#include <stdio.h>
+#include <task.h>
+
+#define NAME  "ipc-test"
+
+/** Transfer buffer for data write and read */
+static char xfer_buf[DATA_XFER_LIMIT];
+
+/** Area shared with clients by IPC_TEST_SHARE_IN */
+static void *share_area;
+
+static void ipc_test_data_write_srv(cap_call_handle_t chandle,
+    ipc_call_t *call)
+{
+	cap_call_handle_t wcall_handle;
+	size_t size;
+
+	if (!async_data_write_receive(&wcall_handle, &size)) {
+		async_answer_0(wcall_handle, EREFUSED);
+		async_answer_0(chandle, EREFUSED);
+		return;
+	}
+
+	if (size > sizeof(xfer_buf)) {
+		async_answer_0(wcall_handle, ELIMIT);
+		async_answer_0(chandle, ELIMIT);
+		return;
+	}
+
+	errno_t rc = async_data_write_finalize(wcall_handle, xfer_buf, size);
+	async_answer_0(chandle, rc);
+}
+
+static void ipc_test_data_read_srv(cap_call_handle_t chandle,
+    ipc_call_t *call)
+{
+	cap_call_handle_t rcall_handle;
+	size_t size;
+
+	if (!async_data_read_receive(&rcall_handle, &size)) {
+		async_answer_0(rcall_handle, EREFUSED);
+		async_answer_0(chandle, EREFUSED);
+		return;
+	}
+
+	if (size > sizeof(xfer_buf)) {
+		async_answer_0(rcall_handle, ELIMIT);
+		async_answer_0(chandle, ELIMIT);
+		return;
+	}
+
+	errno_t rc = async_data_read_finalize(rcall_handle, xfer_buf, size);
+	async_answer_0(chandle, rc);
+}
+
+static void ipc_test_share_in_srv(cap_call_handle_t chandle,
+    ipc_call_t *call)
+{
+	cap_call_handle_t scall_handle;
+	size_t size;
+
+	if (!async_share_in_receive(&scall_handle, &size)) {
+		async_answer_0(scall_handle, EREFUSED);
+		async_answer_0(chandle, EREFUSED);
+		return;
+	}
+
+	if (size != IPC_TEST_SHARE_SIZE) {
+		async_answer_0(scall_handle, ELIMIT);
+		async_answer_0(chandle, ELIMIT);
+		return;
+	}
+
+	errno_t rc = async_share_in_finalize(scall_handle, share_area,
+	    AS_AREA_READ | AS_AREA_CACHEABLE);
+	async_answer_0(chandle, rc);
+}
+
+static void ipc_test_share_out_srv(cap_call_handle_t chandle,
+    ipc_call_t *call)
+{
+	cap_call_handle_t scall_handle;
+	unsigned int flags;
+	size_t size;
+	void *dst;
+
+	if (!async_share_out_receive(&scall_handle, &size, &flags)) {
+		async_answer_0(scall_handle, EREFUSED);
+		async_answer_0(chandle, EREFUSED);
+		return;
+	}
+
+	errno_t rc = async_share_out_finalize(scall_handle, &dst);
+	if (rc == EOK)
+		as_area_destroy(dst);
+
+	async_answer_0(chandle, rc);
+}
+
+static void ipc_test_connection(cap_call_handle_t icall_handle,
+    ipc_call_t *icall, void *arg)
+{
+	/* Accept connection */
+	async_answer_0(icall_handle, EOK);
+
+	while (true) {
+		ipc_call_t call;
+		cap_call_handle_t chandle = async_get_call(&call);
+
+		if (!IPC_GET_IMETHOD(call)) {
+			async_answer_0(chandle, EOK);
+			break;
+		}
+
+		switch (IPC_GET_IMETHOD(call)) {
+		case IPC_TEST_PING:
+			async_answer_0(chandle, EOK);
+			break;
+		case IPC_TEST_DATA_WRITE:
+			ipc_test_data_write_srv(chandle, &call);
+			break;
+		case IPC_TEST_DATA_READ:
+			ipc_test_data_read_srv(chandle, &call);
+			break;
+		case IPC_TEST_SHARE_IN:
+			ipc_test_share_in_srv(chandle, &call);
+			break;
+		case IPC_TEST_SHARE_OUT:
+			ipc_test_share_out_srv(chandle, &call);
+			break;
+		default:
+			async_answer_0(chandle, ENOTSUP);
+			break;
+		}
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	service_id_t svc_id;
+	errno_t rc;
+
+	printf("%s: IPC test service\n", NAME);
+	async_set_fallback_port_handler(ipc_test_connection, NULL);
+
+	share_area = as_area_create(AS_AREA_ANY, IPC_TEST_SHARE_SIZE,
+	    AS_AREA_READ | AS_AREA_WRITE | AS_AREA_CACHEABLE, AS_AREA_UNPAGED);
+	if (share_area == AS_MAP_FAILED) {
+		printf("%s: Failed creating shared area.\n", NAME);
+		return ENOMEM;
+	}
+
+	memset(share_area, 0, IPC_TEST_SHARE_SIZE);
+
+	rc = loc_server_register(NAME);
+	if (rc != EOK) {
+		printf("%s: Failed registering server: %s\n", NAME, str_error(rc));
+		return rc;
+	}
+
+	rc = loc_service_register(SERVICE_NAME_IPC_TEST, &svc_id);
+	if (rc != EOK) {
+		printf("%s: Failed registering service: %s\n", NAME, str_error(rc));
+		return rc;
+	}
+
+	printf("%s: Accepting connections\n", NAME);
+	task_retval(0);
+	async_manager();
+
+	/* Not reached */
+	return 0;
+}
+
+/** @}
+ */
@@ -100,6 +100,30 @@ int main(int argc, char **argv)
 		return ENOMEM;
 	}
 
+	/*
+	 * Initialize the VFS lookup cache.
+	 */
+	if (!vfs_lookup_cache_init()) {
+		printf("%s: Failed to initialize VFS lookup cache\n", NAME);
+		return ENOMEM;
+	}
+
+	/*
+	 * Initialize the VFS page cache.
+	 */
+	if (!vfs_cache_init()) {
+		printf("%s: Failed to initialize VFS page cache\n", NAME);
+		return ENOMEM;
+	}
+
+	/*
+	 * Initialize the resident pages of mapped files.
+	 */
+	if (!vfs_pager_init()) {
+		printf("%s: Failed to initialize VFS pager\n", NAME);
+		return ENOMEM;
+	}
+
 	/*
 	 * Allocate and initialize the Path Lookup Buffer.
 	 */
@@ -127,6 +151,17 @@ int main(int argc, char **argv)
 		return rc;
 	}
 
+	/*
+	 * Create a port for direct connections to file system servers.
+	 */
+	rc = async_create_port(INTERFACE_VFS_DIRECT, vfs_direct_connection,
+	    NULL, &port);
+	if (rc != EOK) {
+		printf("%s: Cannot create direct port: %s\n", NAME,
+		    str_error(rc));
+		return rc;
+	}
+
 	/*
 	 * Set a connection handling function/fibril.
 	 */
@@ -147,6 +182,20 @@ int main(int argc, char **argv)
 		return rc;
 	}
 
+	/*
+	 * Dispatch connections on one thread per CPU. Connection fibrils may
+	 * then run in parallel, so all state shared by them is protected by
+	 * fibril locks: the node hash by nodes_mutex, node contents and size
+	 * by their contents_rwlock, the namespace by namespace_rwlock, the
+	 * lookup and page caches and resident pages of mappings by their own
+	 * mutexes, pipes by their lock and file tables by the client's lock.
+	 */
+	rc = async_create_manager_threads(0);
+	if (rc != EOK) {
+		printf("%s: Cannot create manager threads: %s\n", NAME,
+		    str_error(rc));
+	}
+
 	/*
 	 * Start accepting connections.
 	 */
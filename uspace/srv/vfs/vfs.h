@@ -81,8 +81,11 @@ typedef enum vfs_node_type {
 	VFS_NODE_UNKNOWN,
 	VFS_NODE_FILE,
 	VFS_NODE_DIRECTORY,
+	VFS_NODE_PIPE,
 } vfs_node_type_t;
 
+typedef struct vfs_pipe vfs_pipe_t;
+
 typedef struct {
 	vfs_triplet_t triplet;
 	vfs_node_type_t type;
@@ -120,6 +123,21 @@ typedef struct _vfs_node {
 	fibril_rwlock_t contents_rwlock;
 
 	struct _vfs_node *mount;
+
+	/** File data of the node can be kept in the VFS page cache. */
+	bool cacheable;
+	/** Pages of the node in the VFS page cache. */
+	list_t cache_pages;
+	/** Incremented each time the cached pages are invalidated. */
+	unsigned cache_gen;
+
+	/** Resident pages of the node shared by file mappings. */
+	list_t map_pages;
+	/** Incremented each time the contents of a mapped node change. */
+	unsigned map_gen;
+
+	/** Pipe this node is an end of, NULL for file system nodes. */
+	vfs_pipe_t *pipe;
 } vfs_node_t;
 
 /**
@@ -141,6 +159,15 @@ typedef struct {
 
 	/** Append on write. */
 	bool append;
+
+	/** True if the file is mapped into the client's address space. */
+	bool mapped;
+	/** Node map generation at the time the file was mapped. */
+	unsigned map_gen;
+	/** Page following the last page fault in a mapping of the file. */
+	aoff64_t map_ra_next;
+	/** Number of pages to read ahead on the next page fault. */
+	size_t map_ra_pages;
 } vfs_file_t;
 
 extern fibril_mutex_t nodes_mutex;
@@ -177,6 +204,9 @@ extern errno_t vfs_get_fstypes(vfs_fstypes_t *);
 
 extern errno_t vfs_lookup_internal(vfs_node_t *, char *, int, vfs_lookup_res_t *);
 extern errno_t vfs_link_internal(vfs_node_t *, char *, vfs_triplet_t *);
+extern bool vfs_lookup_cache_init(void);
+extern void vfs_lookup_cache_flush(void);
+extern void vfs_lookup_cache_update(vfs_node_t *);
 
 extern bool vfs_nodes_init(void);
 extern vfs_node_t *vfs_node_get(vfs_lookup_res_t *);
@@ -210,6 +240,7 @@ extern errno_t vfs_op_mtab_get(void);
 extern errno_t vfs_op_open(int fd, int flags);
 extern errno_t vfs_op_put(int fd);
 extern errno_t vfs_op_read(int fd, aoff64_t, size_t *out_bytes);
+extern errno_t vfs_op_readdir(int fd, aoff64_t, size_t *out_bytes);
 extern errno_t vfs_op_rename(int basefd, char *old, char *new);
 extern errno_t vfs_op_resize(int fd, int64_t size);
 extern errno_t vfs_op_stat(int fd);
@@ -219,11 +250,21 @@ extern errno_t vfs_op_unlink(int parentfd, int expectfd, char *path);
 extern errno_t vfs_op_unmount(int mpfd);
 extern errno_t vfs_op_wait_handle(bool high_fd, int *out_fd);
 extern errno_t vfs_op_walk(int parentfd, int flags, char *path, int *out_fd);
+extern errno_t vfs_op_walk_read(int parentfd, char *path, bool keep,
+    cap_call_handle_t chandle, size_t size, int *out_fd, size_t *out_bytes,
+    aoff64_t *out_size);
 extern errno_t vfs_op_write(int fd, aoff64_t, size_t *out_bytes);
 
 extern void vfs_register(cap_call_handle_t, ipc_call_t *);
 
+extern bool vfs_pager_init(void);
 extern void vfs_page_in(cap_call_handle_t, ipc_call_t *);
+extern void vfs_pager_invalidate(vfs_node_t *);
+
+extern bool vfs_cache_init(void);
+extern errno_t vfs_cache_read(async_exch_t *, vfs_node_t *, aoff64_t, void *,
+    size_t, size_t *);
+extern void vfs_cache_invalidate(vfs_node_t *);
 
 typedef struct {
 	void *buffer;
@@ -232,7 +273,14 @@ typedef struct {
 
 extern errno_t vfs_rdwr_internal(int, aoff64_t, bool, rdwr_io_chunk_t *);
 
+extern errno_t vfs_op_pipe(int *, int *);
+extern void vfs_pipe_node_release(vfs_node_t *);
+extern errno_t vfs_pipe_read(vfs_node_t *, size_t *);
+extern errno_t vfs_pipe_write(vfs_node_t *, size_t *);
+extern errno_t vfs_pipe_stat(vfs_node_t *);
+
 extern void vfs_connection(cap_call_handle_t icall_handle, ipc_call_t *icall, void *arg);
+extern void vfs_direct_connection(cap_call_handle_t, ipc_call_t *, void *);
 
 #endif
 
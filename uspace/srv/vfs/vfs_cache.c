@@ -0,0 +1,357 @@
+/*
+ * Copyright (c) 2018 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup fs
+ * @{
+ */
+
+/**
+ * @file vfs_cache.c
+ * @brief VFS page cache.
+ *
+ * Regular file data read through VFS are kept in a cache of pages keyed by
+ * the file system node and the page index. The cache serves both read()
+ * requests of the clients and page faults of file-backed mappings, so that
+ * repeated accesses to the same data do not need to reach the endpoint file
+ * system server.
+ *
+ * Only nodes of file systems which declare themselves cacheable in their
+ * vfs_info_t are cached. The contents of other nodes, e.g. devices in
+ * locfs, can change behind the back of VFS.
+ */
+
+#include "vfs.h"
+#include <adt/hash.h>
+#include <adt/hash_table.h>
+#include <adt/list.h>
+#include <as.h>
+#include <async.h>
+#include <errno.h>
+#include <fibril_synch.h>
+#include <macros.h>
+#include <mem.h>
+#include <stdlib.h>
+
+/** Size of a cached page. */
+#define VFS_CACHE_PAGE_SIZE	PAGE_SIZE
+/** Maximum number of cached pages. */
+#define VFS_CACHE_PAGES		256
+
+typedef struct {
+	vfs_triplet_t triplet;
+	aoff64_t page;
+} vfs_cache_key_t;
+
+/** Cached page of file data. */
+typedef struct {
+	ht_link_t hash_link;	/**< Cache hash table link. */
+	link_t lru_link;	/**< Cache LRU list link. */
+	link_t node_link;	/**< Link to the list of the node's pages. */
+	vfs_cache_key_t key;
+	size_t size;		/**< Number of valid bytes, less at EOF. */
+	uint8_t data[VFS_CACHE_PAGE_SIZE];
+} vfs_cache_page_t;
+
+/** Mutex protecting the page cache. */
+static FIBRIL_MUTEX_INITIALIZE(cache_mutex);
+/** Hash table of cached pages. */
+static hash_table_t cache_hash;
+/** Cached pages, least recently used first. */
+static LIST_INITIALIZE(cache_lru);
+/** Number of cached pages. */
+static size_t cache_count;
+
+static size_t cache_key_hash(void *key)
+{
+	vfs_cache_key_t *ckey = key;
+	size_t hash = hash_combine(ckey->triplet.fs_handle,
+	    ckey->triplet.index);
+	hash = hash_combine(hash, ckey->triplet.service_id);
+	return hash_combine(hash, ckey->page);
+}
+
+static size_t cache_hash_fn(const ht_link_t *item)
+{
+	vfs_cache_page_t *p = hash_table_get_inst(item, vfs_cache_page_t,
+	    hash_link);
+	return cache_key_hash(&p->key);
+}
+
+static bool cache_key_equal(void *key, const ht_link_t *item)
+{
+	vfs_cache_key_t *ckey = key;
+	vfs_cache_page_t *p = hash_table_get_inst(item, vfs_cache_page_t,
+	    hash_link);
+
+	return p->key.triplet.fs_handle == ckey->triplet.fs_handle &&
+	    p->key.triplet.service_id == ckey->triplet.service_id &&
+	    p->key.triplet.index == ckey->triplet.index &&
+	    p->key.page == ckey->page;
+}
+
+/** VFS page cache hash table operations. */
+static hash_table_ops_t cache_ops = {
+	.hash = cache_hash_fn,
+	.key_hash = cache_key_hash,
+	.key_equal = cache_key_equal,
+	.equal = NULL,
+	.remove_callback = NULL
+};
+
+/** Initialize the VFS page cache.
+ *
+ * @return		Return true on success, false on failure.
+ */
+bool vfs_cache_init(void)
+{
+	return hash_table_create(&cache_hash, 0, 0, &cache_ops);
+}
+
+static void cache_key_init(vfs_cache_key_t *key, vfs_node_t *node,
+    aoff64_t page)
+{
+	key->triplet.fs_handle = node->fs_handle;
+	key->triplet.service_id = node->service_id;
+	key->triplet.index = node->index;
+	key->page = page;
+}
+
+/** Find a cached page. Must be called with cache_mutex held. */
+static vfs_cache_page_t *cache_find(vfs_node_t *node, aoff64_t page)
+{
+	vfs_cache_key_t key;
+
+	cache_key_init(&key, node, page);
+	ht_link_t *link = hash_table_find(&cache_hash, &key);
+	if (link == NULL)
+		return NULL;
+
+	return hash_table_get_inst(link, vfs_cache_page_t, hash_link);
+}
+
+/** Remove and free a cached page. Must be called with cache_mutex held. */
+static void cache_remove(vfs_cache_page_t *p)
+{
+	hash_table_remove_item(&cache_hash, &p->hash_link);
+	list_remove(&p->lru_link);
+	list_remove(&p->node_link);
+	cache_count--;
+	free(p);
+}
+
+/** Insert a page into the cache. Must be called with cache_mutex held. */
+static void cache_insert(vfs_node_t *node, vfs_cache_page_t *p)
+{
+	if (cache_count == VFS_CACHE_PAGES) {
+		cache_remove(list_get_instance(list_first(&cache_lru),
+		    vfs_cache_page_t, lru_link));
+	}
+
+	hash_table_insert(&cache_hash, &p->hash_link);
+	list_append(&p->lru_link, &cache_lru);
+	list_append(&p->node_link, &node->cache_pages);
+	cache_count++;
+}
+
+/** Read data from the endpoint file system with a single request.
+ *
+ * @param exch		Exchange with the endpoint file system.
+ * @param node		Node to read.
+ * @param pos		Position in the file.
+ * @param buf		Buffer for the data.
+ * @param size		Size of the buffer.
+ * @param nread		Place to store the number of bytes read.
+ *
+ * @return		EOK on success or an error code.
+ */
+static errno_t cache_read_remote(async_exch_t *exch, vfs_node_t *node,
+    aoff64_t pos, void *buf, size_t size, size_t *nread)
+{
+	ipc_call_t answer;
+	aid_t msg = async_send_fast(exch, VFS_OUT_READ, node->service_id,
+	    node->index, LOWER32(pos), UPPER32(pos), &answer);
+	if (msg == 0)
+		return EINVAL;
+
+	errno_t rc = async_data_read_start(exch, buf, size);
+	if (rc != EOK) {
+		async_forget(msg);
+		return rc;
+	}
+
+	async_wait_for(msg, &rc);
+	if (rc != EOK)
+		return rc;
+
+	*nread = IPC_GET_ARG1(answer);
+	return EOK;
+}
+
+/** Read a page of data from the endpoint file system.
+ *
+ * Only used for cacheable nodes, whose servers return less than asked for
+ * just at the end of file or at their own block boundaries.
+ *
+ * @param exch		Exchange with the endpoint file system.
+ * @param node		Node to read.
+ * @param p		Page to fill, the key must be already set.
+ *
+ * @return		EOK on success or an error code.
+ */
+static errno_t cache_fill(async_exch_t *exch, vfs_node_t *node,
+    vfs_cache_page_t *p)
+{
+	aoff64_t pos = p->key.page * VFS_CACHE_PAGE_SIZE;
+
+	p->size = 0;
+	while (p->size < VFS_CACHE_PAGE_SIZE) {
+		size_t bytes;
+		errno_t rc = cache_read_remote(exch, node, pos + p->size,
+		    p->data + p->size, VFS_CACHE_PAGE_SIZE - p->size, &bytes);
+		if (rc != EOK)
+			return rc;
+
+		if (bytes == 0)
+			break;
+
+		p->size += bytes;
+	}
+
+	return EOK;
+}
+
+/** Read file data through the page cache.
+ *
+ * The caller must hold the node's contents rwlock at least for reading.
+ * Nodes which are not cacheable are read with a single request to the
+ * endpoint file system, bypassing the cache.
+ *
+ * @param exch		Exchange with the endpoint file system.
+ * @param node		Node of a regular file to read.
+ * @param pos		Position in the file.
+ * @param buf		Buffer for the data.
+ * @param size		Size of the buffer.
+ * @param nread		Place to store the number of bytes read, zero at EOF.
+ *
+ * @return		EOK on success or an error code.
+ */
+errno_t vfs_cache_read(async_exch_t *exch, vfs_node_t *node, aoff64_t pos,
+    void *buf, size_t size, size_t *nread)
+{
+	if (!node->cacheable)
+		return cache_read_remote(exch, node, pos, buf, size, nread);
+
+	size_t done = 0;
+
+	while (done < size) {
+		aoff64_t page = (pos + done) / VFS_CACHE_PAGE_SIZE;
+		size_t off = (pos + done) % VFS_CACHE_PAGE_SIZE;
+		size_t n = 0;
+		bool eof;
+
+		fibril_mutex_lock(&cache_mutex);
+		vfs_cache_page_t *p = cache_find(node, page);
+		if (p != NULL) {
+			list_remove(&p->lru_link);
+			list_append(&p->lru_link, &cache_lru);
+
+			if (p->size > off)
+				n = min(p->size - off, size - done);
+			memcpy(buf + done, p->data + off, n);
+			eof = p->size < VFS_CACHE_PAGE_SIZE;
+			fibril_mutex_unlock(&cache_mutex);
+		} else {
+			unsigned gen = node->cache_gen;
+			fibril_mutex_unlock(&cache_mutex);
+
+			p = malloc(sizeof(vfs_cache_page_t));
+			if (p == NULL) {
+				if (done > 0)
+					break;
+				return ENOMEM;
+			}
+
+			cache_key_init(&p->key, node, page);
+			errno_t rc = cache_fill(exch, node, p);
+			if (rc != EOK) {
+				free(p);
+				if (done > 0)
+					break;
+				return rc;
+			}
+
+			if (p->size > off)
+				n = min(p->size - off, size - done);
+			memcpy(buf + done, p->data + off, n);
+			eof = p->size < VFS_CACHE_PAGE_SIZE;
+
+			/*
+			 * Do not cache the page if the node was modified while
+			 * we were reading it or if someone else was faster.
+			 */
+			fibril_mutex_lock(&cache_mutex);
+			if (node->cache_gen == gen &&
+			    cache_find(node, page) == NULL)
+				cache_insert(node, p);
+			else
+				free(p);
+			fibril_mutex_unlock(&cache_mutex);
+		}
+
+		done += n;
+		if (eof || n == 0)
+			break;
+	}
+
+	*nread = done;
+	return EOK;
+}
+
+/** Drop all cached pages of a node.
+ *
+ * Must be called whenever the contents of the node change and before the
+ * node is freed.
+ *
+ * @param node		Node whose pages are to be dropped.
+ */
+void vfs_cache_invalidate(vfs_node_t *node)
+{
+	fibril_mutex_lock(&cache_mutex);
+	node->cache_gen++;
+	while (!list_empty(&node->cache_pages)) {
+		cache_remove(list_get_instance(list_first(&node->cache_pages),
+		    vfs_cache_page_t, node_link));
+	}
+	fibril_mutex_unlock(&cache_mutex);
+
+	vfs_pager_invalidate(node);
+}
+
+/**
+ * @}
+ */
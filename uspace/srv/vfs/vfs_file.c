@@ -180,7 +180,8 @@ static errno_t vfs_file_delref(vfs_client_data_t *vfs_data, vfs_file_t *file)
 		 */
 
 		if (file->node != NULL) {
-			if (file->open_read || file->open_write) {
+			if ((file->open_read || file->open_write) &&
+			    file->node->pipe == NULL) {
 				rc = vfs_file_close_remote(file);
 			}
 			vfs_node_delref(file->node);
@@ -34,6 +34,17 @@
 #include <str.h>
 #include <vfs/canonify.h>
 
+/** Receive a path sent either inline with the request or by a data write. */
+static errno_t vfs_path_accept(ipc_call_t *request, char **path)
+{
+	if (request->payload_size > 0) {
+		return async_payload_accept(request, (void **) path, true, 0, 0,
+		    NULL);
+	}
+
+	return async_data_write_accept((void **) path, true, 0, 0, 0, NULL);
+}
+
 static void vfs_in_clone(cap_call_handle_t req_handle, ipc_call_t *request)
 {
 	int oldfd = IPC_GET_ARG1(*request);
@@ -165,6 +176,14 @@ static void vfs_in_open(cap_call_handle_t req_handle, ipc_call_t *request)
 	async_answer_0(req_handle, rc);
 }
 
+static void vfs_in_pipe(cap_call_handle_t req_handle, ipc_call_t *request)
+{
+	int rfd = -1;
+	int wfd = -1;
+	errno_t rc = vfs_op_pipe(&rfd, &wfd);
+	async_answer_2(req_handle, rc, rfd, wfd);
+}
+
 static void vfs_in_put(cap_call_handle_t req_handle, ipc_call_t *request)
 {
 	int fd = IPC_GET_ARG1(*request);
@@ -183,6 +202,17 @@ static void vfs_in_read(cap_call_handle_t req_handle, ipc_call_t *request)
 	async_answer_1(req_handle, rc, bytes);
 }
 
+static void vfs_in_readdir(cap_call_handle_t req_handle, ipc_call_t *request)
+{
+	int fd = IPC_GET_ARG1(*request);
+	aoff64_t pos = MERGE_LOUP32(IPC_GET_ARG2(*request),
+	    IPC_GET_ARG3(*request));
+
+	size_t bytes = 0;
+	errno_t rc = vfs_op_readdir(fd, pos, &bytes);
+	async_answer_1(req_handle, rc, bytes);
+}
+
 static void vfs_in_rename(cap_call_handle_t req_handle, ipc_call_t *request)
 {
 	/* The common base directory. */
@@ -296,7 +326,7 @@ static void vfs_in_walk(cap_call_handle_t req_handle, ipc_call_t *request)
 
 	int fd = 0;
 	char *path;
-	errno_t rc = async_data_write_accept((void **)&path, true, 0, 0, 0, NULL);
+	errno_t rc = vfs_path_accept(request, &path);
 	if (rc == EOK) {
 		rc = vfs_op_walk(parentfd, flags, path, &fd);
 		free(path);
@@ -304,6 +334,37 @@ static void vfs_in_walk(cap_call_handle_t req_handle, ipc_call_t *request)
 	async_answer_1(req_handle, rc, fd);
 }
 
+static void vfs_in_walk_read(cap_call_handle_t req_handle, ipc_call_t *request)
+{
+	int parentfd = IPC_GET_ARG1(*request);
+	bool keep = IPC_GET_ARG2(*request);
+	cap_call_handle_t chandle;
+	size_t size;
+
+	char *path;
+	errno_t rc = vfs_path_accept(request, &path);
+	if (rc != EOK) {
+		async_answer_0(req_handle, rc);
+		return;
+	}
+
+	/* The data is returned in the client's IPC_M_DATA_READ. */
+	if (!async_data_read_receive(&chandle, &size)) {
+		free(path);
+		async_answer_0(req_handle, EINVAL);
+		return;
+	}
+
+	int fd = -1;
+	size_t bytes = 0;
+	aoff64_t fsize = 0;
+	rc = vfs_op_walk_read(parentfd, path, keep, chandle, size, &fd,
+	    &bytes, &fsize);
+	free(path);
+	async_answer_4(req_handle, rc, fd, bytes, LOWER32(fsize),
+	    UPPER32(fsize));
+}
+
 static void vfs_in_write(cap_call_handle_t req_handle, ipc_call_t *request)
 {
 	int fd = IPC_GET_ARG1(*request);
@@ -315,6 +376,38 @@ static void vfs_in_write(cap_call_handle_t req_handle, ipc_call_t *request)
 	async_answer_1(req_handle, rc, bytes);
 }
 
+/** Connect a client directly to the file system server of an open file.
+ *
+ * The connection request carries the file handle of a regular file opened
+ * for reading and is forwarded to the endpoint file system server. The
+ * forwarded request names the node of the file, the file system server
+ * lets the session read only that node.
+ */
+void vfs_direct_connection(cap_call_handle_t icall_handle, ipc_call_t *icall,
+    void *arg)
+{
+	int fd = IPC_GET_ARG2(*icall);
+
+	vfs_file_t *file = vfs_file_get(fd);
+	if (!file) {
+		async_answer_0(icall_handle, EBADF);
+		return;
+	}
+
+	if (!file->open_read || file->node->type != VFS_NODE_FILE) {
+		vfs_file_put(file);
+		async_answer_0(icall_handle, EINVAL);
+		return;
+	}
+
+	async_exch_t *exch = vfs_exchange_grab(file->node->fs_handle);
+	async_forward_fast(icall_handle, exch, INTERFACE_VFS_DIRECT,
+	    file->node->service_id, file->node->index, IPC_FF_NONE);
+	vfs_exchange_release(exch);
+
+	vfs_file_put(file);
+}
+
 void vfs_connection(cap_call_handle_t icall_handle, ipc_call_t *icall, void *arg)
 {
 	bool cont = true;
@@ -348,12 +441,18 @@ void vfs_connection(cap_call_handle_t icall_handle, ipc_call_t *icall, void *arg
 		case VFS_IN_OPEN:
 			vfs_in_open(chandle, &call);
 			break;
+		case VFS_IN_PIPE:
+			vfs_in_pipe(chandle, &call);
+			break;
 		case VFS_IN_PUT:
 			vfs_in_put(chandle, &call);
 			break;
 		case VFS_IN_READ:
 			vfs_in_read(chandle, &call);
 			break;
+		case VFS_IN_READDIR:
+			vfs_in_readdir(chandle, &call);
+			break;
 		case VFS_IN_REGISTER:
 			vfs_register(chandle, &call);
 			cont = false;
@@ -385,6 +484,9 @@ void vfs_connection(cap_call_handle_t icall_handle, ipc_call_t *icall, void *arg
 		case VFS_IN_WALK:
 			vfs_in_walk(chandle, &call);
 			break;
+		case VFS_IN_WALK_READ:
+			vfs_in_walk_read(chandle, &call);
+			break;
 		case VFS_IN_WRITE:
 			vfs_in_write(chandle, &call);
 			break;
@@ -43,15 +43,415 @@
 #include <stdarg.h>
 #include <stdbool.h>
 #include <fibril_synch.h>
+#include <adt/hash.h>
+#include <adt/hash_table.h>
 #include <adt/list.h>
 #include <vfs/canonify.h>
 #include <dirent.h>
 #include <assert.h>
+#include <mem.h>
+#include <stdlib.h>
+
+/** Maximum number of cached lookup results. */
+#define LOOKUP_CACHE_SIZE	256
 
 FIBRIL_MUTEX_INITIALIZE(plb_mutex);
 LIST_INITIALIZE(plb_entries);	/**< PLB entry ring buffer. */
 uint8_t *plb = NULL;
 
+/** Cached lookup results sharing a node. */
+typedef struct {
+	ht_link_t hash_link;	/**< Link in lookup_parents or lookup_nodes. */
+	vfs_triplet_t triplet;	/**< The shared node. */
+	list_t entries;		/**< Entries sharing the node. */
+} lookup_group_t;
+
+/** Cached result of a path lookup. */
+typedef struct {
+	ht_link_t hash_link;	/**< Lookup cache hash table link. */
+	link_t lru_link;	/**< Lookup cache LRU list link. */
+	link_t parent_link;	/**< Link to the entries of the parent. */
+	link_t node_link;	/**< Link to the entries of the result. */
+	lookup_group_t *parent;	/**< Directory holding the last component. */
+	lookup_group_t *node;	/**< Result node or NULL if rc is not EOK. */
+	vfs_triplet_t base;	/**< Node the lookup started from. */
+	int lflag;		/**< Lookup flags. */
+	char *path;		/**< Canonical path, not NULL-terminated. */
+	size_t len;		/**< Length of the path. */
+	errno_t rc;		/**< EOK, or ENOENT for negative entries. */
+	vfs_lookup_res_t res;	/**< Lookup result if rc is EOK. */
+} lookup_entry_t;
+
+typedef struct {
+	vfs_triplet_t *base;
+	int lflag;
+	const char *path;
+	size_t len;
+} lookup_key_t;
+
+/** Mutex protecting the lookup cache. */
+static FIBRIL_MUTEX_INITIALIZE(lookup_mutex);
+/** Hash table of cached lookup results. */
+static hash_table_t lookup_hash;
+/** Cached lookup results grouped by the parent of the last component. */
+static hash_table_t lookup_parents;
+/** Positive cached lookup results grouped by the result node. */
+static hash_table_t lookup_nodes;
+/** Cached lookup results, least recently used first. */
+static LIST_INITIALIZE(lookup_lru);
+/** Number of cached lookup results. */
+static size_t lookup_count;
+/** Incremented each time cached lookup results are invalidated. */
+static unsigned lookup_gen;
+
+static size_t lookup_hash_compute(vfs_triplet_t *base, int lflag,
+    const char *path, size_t len)
+{
+	size_t hash = hash_combine(base->fs_handle, base->index);
+	hash = hash_combine(hash, base->service_id);
+	hash = hash_combine(hash, lflag);
+	for (size_t i = 0; i < len; i++)
+		hash = hash_combine(hash, (uint8_t) path[i]);
+
+	return hash;
+}
+
+static size_t lookup_key_hash(void *key)
+{
+	lookup_key_t *lkey = key;
+	return lookup_hash_compute(lkey->base, lkey->lflag, lkey->path,
+	    lkey->len);
+}
+
+static size_t lookup_entry_hash(const ht_link_t *item)
+{
+	lookup_entry_t *e = hash_table_get_inst(item, lookup_entry_t,
+	    hash_link);
+	return lookup_hash_compute(&e->base, e->lflag, e->path, e->len);
+}
+
+static bool lookup_key_equal(void *key, const ht_link_t *item)
+{
+	lookup_key_t *lkey = key;
+	lookup_entry_t *e = hash_table_get_inst(item, lookup_entry_t,
+	    hash_link);
+
+	return e->base.fs_handle == lkey->base->fs_handle &&
+	    e->base.service_id == lkey->base->service_id &&
+	    e->base.index == lkey->base->index &&
+	    e->lflag == lkey->lflag && e->len == lkey->len &&
+	    memcmp(e->path, lkey->path, e->len) == 0;
+}
+
+/** VFS lookup cache hash table operations. */
+static hash_table_ops_t lookup_ops = {
+	.hash = lookup_entry_hash,
+	.key_hash = lookup_key_hash,
+	.key_equal = lookup_key_equal,
+	.equal = NULL,
+	.remove_callback = NULL
+};
+
+static size_t lookup_group_key_hash(void *key)
+{
+	vfs_triplet_t *triplet = key;
+	size_t hash = hash_combine(triplet->fs_handle, triplet->index);
+	return hash_combine(hash, triplet->service_id);
+}
+
+static size_t lookup_group_hash(const ht_link_t *item)
+{
+	lookup_group_t *g = hash_table_get_inst(item, lookup_group_t,
+	    hash_link);
+	return lookup_group_key_hash(&g->triplet);
+}
+
+static bool lookup_group_key_equal(void *key, const ht_link_t *item)
+{
+	vfs_triplet_t *triplet = key;
+	lookup_group_t *g = hash_table_get_inst(item, lookup_group_t,
+	    hash_link);
+
+	return g->triplet.fs_handle == triplet->fs_handle &&
+	    g->triplet.service_id == triplet->service_id &&
+	    g->triplet.index == triplet->index;
+}
+
+/** Operations of the hash tables of lookup cache groups. */
+static hash_table_ops_t lookup_group_ops = {
+	.hash = lookup_group_hash,
+	.key_hash = lookup_group_key_hash,
+	.key_equal = lookup_group_key_equal,
+	.equal = NULL,
+	.remove_callback = NULL
+};
+
+/** Initialize the VFS lookup cache.
+ *
+ * @return		Return true on success, false on failure.
+ */
+bool vfs_lookup_cache_init(void)
+{
+	return hash_table_create(&lookup_hash, 0, 0, &lookup_ops) &&
+	    hash_table_create(&lookup_parents, 0, 0, &lookup_group_ops) &&
+	    hash_table_create(&lookup_nodes, 0, 0, &lookup_group_ops);
+}
+
+/** Find a lookup cache group. Must be called with lookup_mutex held. */
+static lookup_group_t *lookup_group_find(hash_table_t *groups,
+    vfs_triplet_t *triplet)
+{
+	ht_link_t *link = hash_table_find(groups, triplet);
+	if (link == NULL)
+		return NULL;
+
+	return hash_table_get_inst(link, lookup_group_t, hash_link);
+}
+
+/** Find or create a lookup cache group.
+ *
+ * Must be called with lookup_mutex held.
+ *
+ * @return		The group or NULL if out of memory.
+ */
+static lookup_group_t *lookup_group_get(hash_table_t *groups,
+    vfs_triplet_t *triplet)
+{
+	lookup_group_t *g = lookup_group_find(groups, triplet);
+	if (g != NULL)
+		return g;
+
+	g = malloc(sizeof(lookup_group_t));
+	if (g == NULL)
+		return NULL;
+
+	g->triplet = *triplet;
+	list_initialize(&g->entries);
+	hash_table_insert(groups, &g->hash_link);
+	return g;
+}
+
+/** Free a lookup cache group if it has no entries left.
+ *
+ * Must be called with lookup_mutex held.
+ */
+static void lookup_group_put(hash_table_t *groups, lookup_group_t *g)
+{
+	if (!list_empty(&g->entries))
+		return;
+
+	hash_table_remove_item(groups, &g->hash_link);
+	free(g);
+}
+
+/** Remove a cached lookup result. Must be called with lookup_mutex held. */
+static void lookup_entry_remove(lookup_entry_t *e)
+{
+	hash_table_remove_item(&lookup_hash, &e->hash_link);
+	list_remove(&e->lru_link);
+	list_remove(&e->parent_link);
+	lookup_group_put(&lookup_parents, e->parent);
+	if (e->node != NULL) {
+		list_remove(&e->node_link);
+		lookup_group_put(&lookup_nodes, e->node);
+	}
+	lookup_count--;
+	free(e->path);
+	free(e);
+}
+
+/** Find out whether lookups in a file system can be cached.
+ *
+ * Only file systems whose namespace changes just through VFS are cached.
+ * Names in locfs, for example, appear as devices are registered.
+ */
+static bool lookup_cacheable(vfs_triplet_t *triplet)
+{
+	vfs_info_t *info = fs_handle_to_info(triplet->fs_handle);
+	return (info != NULL) && info->cacheable;
+}
+
+/** Find the node a lookup starting at @a node is resolved in. */
+static vfs_node_t *lookup_mounted(vfs_node_t *node)
+{
+	while (node->mount != NULL)
+		node = node->mount;
+
+	return node;
+}
+
+/** Look up a path in the lookup cache.
+ *
+ * @param base		Node the lookup starts from.
+ * @param path		Canonical path.
+ * @param len		Length of the path.
+ * @param lflag		Lookup flags.
+ * @param rc		Place to store the cached return code.
+ * @param res		Place to store the cached result.
+ * @param gen		Place to store the cache generation on a miss.
+ *
+ * @return		True on a hit, false on a miss.
+ */
+static bool lookup_cache_find(vfs_node_t *base, char *path, size_t len,
+    int lflag, errno_t *rc, vfs_lookup_res_t *res, unsigned *gen)
+{
+	lookup_key_t key = {
+		.base = (vfs_triplet_t *) base,
+		.lflag = lflag,
+		.path = path,
+		.len = len
+	};
+
+	fibril_mutex_lock(&lookup_mutex);
+	ht_link_t *link = hash_table_find(&lookup_hash, &key);
+	if (link == NULL) {
+		*gen = lookup_gen;
+		fibril_mutex_unlock(&lookup_mutex);
+		return false;
+	}
+
+	lookup_entry_t *e = hash_table_get_inst(link, lookup_entry_t,
+	    hash_link);
+	list_remove(&e->lru_link);
+	list_append(&e->lru_link, &lookup_lru);
+	*rc = e->rc;
+	*res = e->res;
+	fibril_mutex_unlock(&lookup_mutex);
+
+	return true;
+}
+
+/** Insert a lookup result into the lookup cache.
+ *
+ * The result is not inserted if cached results were invalidated since
+ * @a gen was obtained from lookup_cache_find().
+ *
+ * @param parent	Directory holding the last component of the path.
+ */
+static void lookup_cache_insert(vfs_node_t *base, char *path, size_t len,
+    int lflag, errno_t rc, vfs_lookup_res_t *res, vfs_triplet_t *parent,
+    unsigned gen)
+{
+	lookup_entry_t *e = malloc(sizeof(lookup_entry_t));
+	if (e == NULL)
+		return;
+
+	e->path = malloc(len);
+	if (e->path == NULL) {
+		free(e);
+		return;
+	}
+
+	e->base = *(vfs_triplet_t *) base;
+	e->lflag = lflag;
+	memcpy(e->path, path, len);
+	e->len = len;
+	e->rc = rc;
+	if (rc == EOK)
+		e->res = *res;
+	else
+		memset(&e->res, 0, sizeof(e->res));
+
+	lookup_key_t key = {
+		.base = &e->base,
+		.lflag = lflag,
+		.path = path,
+		.len = len
+	};
+
+	fibril_mutex_lock(&lookup_mutex);
+	if (gen != lookup_gen || hash_table_find(&lookup_hash, &key) != NULL)
+		goto fail;
+
+	e->parent = lookup_group_get(&lookup_parents, parent);
+	if (e->parent == NULL)
+		goto fail;
+
+	e->node = NULL;
+	if (rc == EOK) {
+		e->node = lookup_group_get(&lookup_nodes, &e->res.triplet);
+		if (e->node == NULL) {
+			lookup_group_put(&lookup_parents, e->parent);
+			goto fail;
+		}
+		list_append(&e->node_link, &e->node->entries);
+	}
+	list_append(&e->parent_link, &e->parent->entries);
+
+	if (lookup_count == LOOKUP_CACHE_SIZE) {
+		lookup_entry_remove(list_get_instance(list_first(&lookup_lru),
+		    lookup_entry_t, lru_link));
+	}
+
+	hash_table_insert(&lookup_hash, &e->hash_link);
+	list_append(&e->lru_link, &lookup_lru);
+	lookup_count++;
+	fibril_mutex_unlock(&lookup_mutex);
+	return;
+
+fail:
+	fibril_mutex_unlock(&lookup_mutex);
+	free(e->path);
+	free(e);
+}
+
+/** Flush the lookup cache.
+ *
+ * Must be called whenever the file system namespace changes other than
+ * by adding or removing a name in a directory, e.g. on mount.
+ */
+void vfs_lookup_cache_flush(void)
+{
+	fibril_mutex_lock(&lookup_mutex);
+	lookup_gen++;
+	while (!list_empty(&lookup_lru)) {
+		lookup_entry_remove(list_get_instance(list_first(&lookup_lru),
+		    lookup_entry_t, lru_link));
+	}
+	fibril_mutex_unlock(&lookup_mutex);
+}
+
+/** Invalidate cached lookup results ending in a directory.
+ *
+ * Must be called whenever a name is added to or removed from the
+ * directory. Results of lookups which merely pass through the directory
+ * stay valid: a directory cannot be removed while it has any entries.
+ *
+ * @param parent	Directory whose names changed.
+ */
+static void lookup_cache_invalidate(vfs_triplet_t *parent)
+{
+	fibril_mutex_lock(&lookup_mutex);
+	lookup_gen++;
+
+	/* The group is freed along with its last entry. */
+	lookup_group_t *g;
+	while ((g = lookup_group_find(&lookup_parents, parent)) != NULL) {
+		lookup_entry_remove(list_get_instance(list_first(&g->entries),
+		    lookup_entry_t, parent_link));
+	}
+	fibril_mutex_unlock(&lookup_mutex);
+}
+
+/** Update cached lookup results with the state of a node being freed.
+ *
+ * While the node exists, its size is taken from the node, so the cached
+ * size only needs to be current when the node goes away.
+ *
+ * @param node		Node being freed.
+ */
+void vfs_lookup_cache_update(vfs_node_t *node)
+{
+	fibril_mutex_lock(&lookup_mutex);
+	lookup_group_t *g = lookup_group_find(&lookup_nodes,
+	    (vfs_triplet_t *) node);
+	if (g != NULL) {
+		list_foreach(g->entries, node_link, lookup_entry_t, e)
+			e->res.size = node->size;
+	}
+	fibril_mutex_unlock(&lookup_mutex);
+}
+
 static errno_t plb_insert_entry(plb_entry_t *entry, char *path, size_t *start,
     size_t len)
 {
@@ -202,6 +602,9 @@ errno_t vfs_link_internal(vfs_node_t *base, char *path, vfs_triplet_t *child)
 	if (orig_rc != EOK)
 		rc = orig_rc;
 
+	if (rc == EOK)
+		lookup_cache_invalidate(triplet);
+
 out:
 	return rc;
 }
@@ -321,6 +724,51 @@ out:
 	return rc;
 }
 
+/** Cache the result of a path lookup.
+ *
+ * The directory holding the last component of the path is looked up,
+ * usually in the cache itself, to file the result under it. Nothing is
+ * cached if the directory does not exist or if either the directory or
+ * the result live in a file system whose names can change without VFS
+ * knowing.
+ *
+ * @param base		Node the lookup started from.
+ * @param path		Canonical path, NULL-terminated.
+ * @param len		Length of the path.
+ * @param lflag		Lookup flags.
+ * @param rc		EOK or ENOENT.
+ * @param res		Lookup result if rc is EOK.
+ * @param gen		Cache generation obtained from lookup_cache_find().
+ */
+static void lookup_cache_add(vfs_node_t *base, char *path, size_t len,
+    int lflag, errno_t rc, vfs_lookup_res_t *res, unsigned gen)
+{
+	vfs_triplet_t parent;
+
+	char *slash = str_rchr(path, L'/');
+	if (slash == path) {
+		parent = *(vfs_triplet_t *) lookup_mounted(base);
+	} else {
+		vfs_lookup_res_t pres;
+
+		*slash = 0;
+		errno_t prc = vfs_lookup_internal(base, path, L_DIRECTORY,
+		    &pres);
+		*slash = '/';
+		if (prc != EOK)
+			return;
+
+		parent = pres.triplet;
+	}
+
+	if (!lookup_cacheable(&parent))
+		return;
+	if ((rc == EOK) && !lookup_cacheable(&res->triplet))
+		return;
+
+	lookup_cache_insert(base, path, len, lflag, rc, res, &parent, gen);
+}
+
 /** Perform a path lookup.
  *
  * @param base    The file from which to perform the lookup.
@@ -339,6 +787,9 @@ errno_t vfs_lookup_internal(vfs_node_t *base, char *path, int lflag,
 	assert(base != NULL);
 	assert(path != NULL);
 
+	if (base->type == VFS_NODE_PIPE)
+		return ENOTDIR;
+
 	size_t len;
 	errno_t rc;
 	char *npath = canonify(path, &len);
@@ -386,10 +837,42 @@ errno_t vfs_lookup_internal(vfs_node_t *base, char *path, int lflag,
 		rc = _vfs_lookup_internal(parent, slash, lflag, result,
 		    len - (slash - path));
 
-		vfs_node_put(parent);
+		/*
+		 * Removing a directory may take a whole subtree with it if
+		 * it is being renamed. Other changes only affect the names
+		 * in the parent.
+		 */
+		if (rc == EOK) {
+			if ((lflag & L_UNLINK) && ((result == NULL) ||
+			    (result->type == VFS_NODE_DIRECTORY))) {
+				vfs_lookup_cache_flush();
+			} else {
+				lookup_cache_invalidate(
+				    (vfs_triplet_t *) lookup_mounted(parent));
+			}
+		}
 
+		vfs_node_put(parent);
 	} else {
-		rc = _vfs_lookup_internal(base, path, lflag, result, len);
+		vfs_lookup_res_t res;
+		unsigned gen;
+
+		/*
+		 * Both successful and failed lookups are cached. Each result
+		 * is filed under the directory holding the last component of
+		 * the path, so that it can be invalidated when a name is added
+		 * to or removed from the directory. A failed lookup is cached
+		 * only if that directory exists.
+		 */
+		if (!lookup_cache_find(base, path, len, lflag, &rc, &res,
+		    &gen)) {
+			rc = _vfs_lookup_internal(base, path, lflag, &res, len);
+			if (rc == EOK || rc == ENOENT)
+				lookup_cache_add(base, path, len, lflag, rc, &res, gen);
+		}
+
+		if (rc == EOK && result != NULL)
+			*result = res;
 	}
 
 	return rc;
@@ -111,6 +111,13 @@ void vfs_node_delref(vfs_node_t *node)
 	fibril_mutex_lock(&nodes_mutex);
 
 	node->refcnt--;
+	if (node->refcnt == 0 && node->pipe != NULL) {
+		/* Pipe ends are not hashed and have no file system behind */
+		fibril_mutex_unlock(&nodes_mutex);
+		vfs_pipe_node_release(node);
+		return;
+	}
+
 	if (node->refcnt == 0) {
 		/*
 		 * We are dropping the last reference to this node.
@@ -134,6 +141,8 @@ void vfs_node_delref(vfs_node_t *node)
 		    (sysarg_t)node->index);
 		vfs_exchange_release(exch);
 
+		vfs_cache_invalidate(node);
+		vfs_lookup_cache_update(node);
 		free(node);
 	}
 }
@@ -150,6 +159,7 @@ void vfs_node_forget(vfs_node_t *node)
 	fibril_mutex_lock(&nodes_mutex);
 	hash_table_remove_item(&nodes, &node->nh_link);
 	fibril_mutex_unlock(&nodes_mutex);
+	vfs_cache_invalidate(node);
 	free(node);
 }
 
@@ -183,7 +193,13 @@ vfs_node_t *vfs_node_get(vfs_lookup_res_t *result)
 		node->index = result->triplet.index;
 		node->size = result->size;
 		node->type = result->type;
+
+		vfs_info_t *info = fs_handle_to_info(node->fs_handle);
+		node->cacheable = (info != NULL) && info->cacheable;
+
 		fibril_rwlock_initialize(&node->contents_rwlock);
+		list_initialize(&node->cache_pages);
+		list_initialize(&node->map_pages);
 		hash_table_insert(&nodes, &node->nh_link);
 	} else {
 		node = hash_table_get_inst(tmp, vfs_node_t, nh_link);
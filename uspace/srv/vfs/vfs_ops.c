@@ -271,6 +271,7 @@ errno_t vfs_op_mount(int mpfd, unsigned service_id, unsigned flags,
 		mp->node->mount = root;
 	}
 
+	vfs_lookup_cache_flush();
 	fibril_rwlock_write_unlock(&namespace_rwlock);
 
 	if (rc != EOK)
@@ -335,6 +336,11 @@ errno_t vfs_op_open(int fd, int mode)
 		return EINVAL;
 	}
 
+	if (file->node->type == VFS_NODE_PIPE) {
+		vfs_file_put(file);
+		return EOK;
+	}
+
 	errno_t rc = vfs_open_node_remote(file->node);
 	if (rc != EOK) {
 		file->open_read = file->open_write = false;
@@ -355,6 +361,37 @@ static errno_t rdwr_ipc_client(async_exch_t *exch, vfs_file_t *file, aoff64_t po
 	size_t *bytes = (size_t *) data;
 	errno_t rc;
 
+	if (read && file->node->type == VFS_NODE_FILE &&
+	    file->node->cacheable) {
+		/*
+		 * Regular files are read through the page cache, answer
+		 * the client's IPC_M_DATA_READ request ourselves.
+		 */
+		cap_call_handle_t chandle;
+		size_t size;
+
+		if (!async_data_read_receive(&chandle, &size))
+			return EINVAL;
+
+		if (size > DATA_XFER_LIMIT)
+			size = DATA_XFER_LIMIT;
+
+		void *buf = malloc(size);
+		if (buf == NULL) {
+			async_answer_0(chandle, ENOMEM);
+			return ENOMEM;
+		}
+
+		rc = vfs_cache_read(exch, file->node, pos, buf, size, bytes);
+		if (rc == EOK)
+			rc = async_data_read_finalize(chandle, buf, *bytes);
+		else
+			async_answer_0(chandle, rc);
+
+		free(buf);
+		return rc;
+	}
+
 	/*
 	 * Make a VFS_READ/VFS_WRITE request at the destination FS server
 	 * and forward the IPC_M_DATA_READ/IPC_M_DATA_WRITE request to the
@@ -385,6 +422,11 @@ static errno_t rdwr_ipc_internal(async_exch_t *exch, vfs_file_t *file, aoff64_t
 	if (exch == NULL)
 		return ENOENT;
 
+	/*
+	 * The pager keeps the pages it reads resident on its own, so its reads
+	 * bypass the page cache and reach the file system in as few requests
+	 * as possible.
+	 */
 	aid_t msg = async_send_fast(exch, read ? VFS_OUT_READ : VFS_OUT_WRITE,
 	    file->node->service_id, file->node->index, LOWER32(pos),
 	    UPPER32(pos), answer);
@@ -428,6 +470,19 @@ static errno_t vfs_rdwr(int fd, aoff64_t pos, bool read, rdwr_ipc_cb_t ipc_cb,
 		return EINVAL;
 	}
 
+	if (file->node->type == VFS_NODE_PIPE) {
+		/* Pipes are served by VFS itself and cannot be mapped */
+		errno_t rc = ENOTSUP;
+		if (ipc_cb == rdwr_ipc_client) {
+			size_t *bytes = (size_t *) ipc_cb_data;
+			rc = read ? vfs_pipe_read(file->node, bytes) :
+			    vfs_pipe_write(file->node, bytes);
+		}
+
+		vfs_file_put(file);
+		return rc;
+	}
+
 	vfs_info_t *fs_info = fs_handle_to_info(file->node->fs_handle);
 	assert(fs_info);
 
@@ -478,6 +533,13 @@ static errno_t vfs_rdwr(int fd, aoff64_t pos, bool read, rdwr_ipc_cb_t ipc_cb,
 
 	vfs_exchange_release(fs_exch);
 
+	/*
+	 * Drop the cached pages after the write so that concurrent readers
+	 * cannot cache the old contents.
+	 */
+	if (!read)
+		vfs_cache_invalidate(file->node);
+
 	if (file->node->type == VFS_NODE_DIRECTORY)
 		fibril_rwlock_read_unlock(&namespace_rwlock);
 
@@ -508,6 +570,111 @@ errno_t vfs_op_read(int fd, aoff64_t pos, size_t *out_bytes)
 	return vfs_rdwr(fd, pos, true, rdwr_ipc_client, out_bytes);
 }
 
+/** Replace the attributes of a mount point with those of the mounted root.
+ *
+ * This keeps the attributes returned by vfs_op_readdir() consistent with
+ * what a lookup of the entry followed by a stat would return.
+ */
+static void readdir_cross_mount(vfs_node_t *dir, vfs_dirent_t *ent)
+{
+	vfs_lookup_res_t res;
+
+	res.triplet.fs_handle = dir->fs_handle;
+	res.triplet.service_id = dir->service_id;
+	res.triplet.index = ent->stat.index;
+
+	vfs_node_t *node = vfs_node_peek(&res);
+	if (node == NULL)
+		return;
+
+	vfs_node_t *mnt = node->mount;
+	if (mnt != NULL) {
+		async_exch_t *exch = vfs_exchange_grab(mnt->fs_handle);
+		aid_t msg = async_send_2(exch, VFS_OUT_STAT, mnt->service_id,
+		    mnt->index, NULL);
+		errno_t rc = async_data_read_start(exch, &ent->stat,
+		    sizeof(vfs_stat_t));
+		vfs_exchange_release(exch);
+
+		if (rc == EOK)
+			async_wait_for(msg, &rc);
+		else
+			async_forget(msg);
+	}
+
+	vfs_node_put(node);
+}
+
+errno_t vfs_op_readdir(int fd, aoff64_t pos, size_t *out_bytes)
+{
+	vfs_file_t *file = vfs_file_get(fd);
+	if (!file)
+		return EBADF;
+
+	if (!file->open_read || file->node->type != VFS_NODE_DIRECTORY) {
+		vfs_file_put(file);
+		return EINVAL;
+	}
+
+	cap_call_handle_t chandle;
+	size_t size;
+	if (!async_data_read_receive(&chandle, &size)) {
+		vfs_file_put(file);
+		return EINVAL;
+	}
+
+	void *buf = malloc(size);
+	if (buf == NULL) {
+		async_answer_0(chandle, ENOMEM);
+		vfs_file_put(file);
+		return ENOMEM;
+	}
+
+	fibril_rwlock_read_lock(&file->node->contents_rwlock);
+	fibril_rwlock_read_lock(&namespace_rwlock);
+
+	ipc_call_t answer;
+	async_exch_t *exch = vfs_exchange_grab(file->node->fs_handle);
+	aid_t msg = async_send_4(exch, VFS_OUT_READDIR,
+	    file->node->service_id, file->node->index, LOWER32(pos),
+	    UPPER32(pos), &answer);
+	errno_t rc = async_data_read_start(exch, buf, size);
+	vfs_exchange_release(exch);
+
+	if (rc == EOK)
+		async_wait_for(msg, &rc);
+	else
+		async_forget(msg);
+
+	size_t bytes = 0;
+	if (rc == EOK) {
+		bytes = IPC_GET_ARG1(answer);
+
+		size_t off = 0;
+		while (off < bytes) {
+			vfs_dirent_t *ent = (vfs_dirent_t *) ((uint8_t *) buf +
+			    off);
+			if (ent->stat.is_directory)
+				readdir_cross_mount(file->node, ent);
+			off += ent->reclen;
+		}
+	}
+
+	fibril_rwlock_read_unlock(&namespace_rwlock);
+	fibril_rwlock_read_unlock(&file->node->contents_rwlock);
+
+	if (rc == EOK)
+		rc = async_data_read_finalize(chandle, buf, bytes);
+	else
+		async_answer_0(chandle, rc);
+
+	free(buf);
+	vfs_file_put(file);
+
+	*out_bytes = bytes;
+	return rc;
+}
+
 errno_t vfs_op_rename(int basefd, char *old, char *new)
 {
 	vfs_file_t *base_file = vfs_file_get(basefd);
@@ -615,12 +782,18 @@ errno_t vfs_op_resize(int fd, int64_t size)
 	if (!file)
 		return EBADF;
 
+	if (file->node->type == VFS_NODE_PIPE) {
+		vfs_file_put(file);
+		return EINVAL;
+	}
+
 	fibril_rwlock_write_lock(&file->node->contents_rwlock);
 
 	errno_t rc = vfs_truncate_internal(file->node->fs_handle,
 	    file->node->service_id, file->node->index, size);
 	if (rc == EOK)
 		file->node->size = size;
+	vfs_cache_invalidate(file->node);
 
 	fibril_rwlock_write_unlock(&file->node->contents_rwlock);
 	vfs_file_put(file);
@@ -635,6 +808,12 @@ errno_t vfs_op_stat(int fd)
 
 	vfs_node_t *node = file->node;
 
+	if (node->type == VFS_NODE_PIPE) {
+		errno_t rc = vfs_pipe_stat(node);
+		vfs_file_put(file);
+		return rc;
+	}
+
 	async_exch_t *exch = vfs_exchange_grab(node->fs_handle);
 	errno_t rc = async_data_read_forward_fast(exch, VFS_OUT_STAT,
 	    node->service_id, node->index, true, 0, NULL);
@@ -652,6 +831,11 @@ errno_t vfs_op_statfs(int fd)
 
 	vfs_node_t *node = file->node;
 
+	if (node->type == VFS_NODE_PIPE) {
+		vfs_file_put(file);
+		return ENOTSUP;
+	}
+
 	async_exch_t *exch = vfs_exchange_grab(node->fs_handle);
 	errno_t rc = async_data_read_forward_fast(exch, VFS_OUT_STATFS,
 	    node->service_id, node->index, false, 0, NULL);
@@ -667,6 +851,11 @@ errno_t vfs_op_sync(int fd)
 	if (!file)
 		return EBADF;
 
+	if (file->node->type == VFS_NODE_PIPE) {
+		vfs_file_put(file);
+		return EOK;
+	}
+
 	async_exch_t *fs_exch = vfs_exchange_grab(file->node->fs_handle);
 
 	aid_t msg;
@@ -819,6 +1008,7 @@ errno_t vfs_op_unmount(int mpfd)
 	vfs_node_put(mp->node);
 	mp->node->mount = NULL;
 
+	vfs_lookup_cache_flush();
 	fibril_rwlock_write_unlock(&namespace_rwlock);
 
 	vfs_file_put(mp);
@@ -910,6 +1100,113 @@ errno_t vfs_op_walk(int parentfd, int flags, char *path, int *out_fd)
 	return EOK;
 }
 
+/** Walk a path to a regular file, open it and read its beginning.
+ *
+ * This is what vfs_op_walk(), vfs_op_open() and vfs_op_read() do together,
+ * with the open and the first read done by a single request to the file
+ * system server.
+ *
+ * @param parentfd	File handle of the directory where the walk starts.
+ * @param path		Path relative to @a parentfd.
+ * @param keep		Keep the file open for reading after the read. If
+ *			false, the file handle is released.
+ * @param chandle	Client's IPC_M_DATA_READ request, always answered.
+ * @param size		Size of the client's buffer.
+ * @param out_fd	Place to store the file handle or -1.
+ * @param out_bytes	Place to store the number of bytes read.
+ * @param out_size	Place to store the size of the file.
+ *
+ * @return EOK on success or an error code.
+ */
+errno_t vfs_op_walk_read(int parentfd, char *path, bool keep,
+    cap_call_handle_t chandle, size_t size, int *out_fd, size_t *out_bytes,
+    aoff64_t *out_size)
+{
+	int fd;
+	errno_t rc = vfs_op_walk(parentfd, WALK_REGULAR, path, &fd);
+	if (rc != EOK) {
+		async_answer_0(chandle, rc);
+		return rc;
+	}
+
+	vfs_file_t *file = vfs_file_get(fd);
+	if (!file) {
+		async_answer_0(chandle, EBADF);
+		return EBADF;
+	}
+
+	void *buf = NULL;
+	size_t bytes = 0;
+	aoff64_t fsize = 0;
+
+	if ((MODE_READ & ~file->permissions) != 0) {
+		rc = EPERM;
+		goto out;
+	}
+
+	if (size > DATA_XFER_LIMIT)
+		size = DATA_XFER_LIMIT;
+
+	buf = malloc(size);
+	if (buf == NULL) {
+		rc = ENOMEM;
+		goto out;
+	}
+
+	vfs_node_t *node = file->node;
+	fibril_rwlock_read_lock(&node->contents_rwlock);
+	async_exch_t *exch = vfs_exchange_grab(node->fs_handle);
+
+	ipc_call_t answer;
+	aid_t msg = async_send_4(exch, VFS_OUT_OPEN_READ, node->service_id,
+	    node->index, 0, 0, &answer);
+	errno_t retval = async_data_read_start(exch, buf, size);
+	async_wait_for(msg, &rc);
+
+	if (rc == EOK) {
+		/* The node is open now, make sure it gets closed. */
+		file->open_read = true;
+		rc = retval;
+	}
+
+	if (rc == EOK) {
+		bytes = IPC_GET_ARG5(answer);
+		fsize = MERGE_LOUP32(IPC_GET_ARG1(answer),
+		    IPC_GET_ARG2(answer));
+
+		/* Read the rest of a larger file through the page cache. */
+		if (bytes < size && bytes < fsize) {
+			size_t more;
+			rc = vfs_cache_read(exch, node, bytes, buf + bytes,
+			    size - bytes, &more);
+			if (rc == EOK)
+				bytes += more;
+		}
+	}
+
+	vfs_exchange_release(exch);
+	fibril_rwlock_read_unlock(&node->contents_rwlock);
+
+out:
+	if (rc == EOK)
+		rc = async_data_read_finalize(chandle, buf, bytes);
+	else
+		async_answer_0(chandle, rc);
+
+	free(buf);
+	vfs_file_put(file);
+
+	if (rc != EOK || !keep) {
+		(void) vfs_fd_free(fd);
+		fd = -1;
+	}
+
+	*out_fd = fd;
+	*out_bytes = bytes;
+	*out_size = fsize;
+	return rc;
+}
+
 errno_t vfs_op_write(int fd, aoff64_t pos, size_t *out_bytes)
 {
 	return vfs_rdwr(fd, pos, false, rdwr_ipc_client, out_bytes);
@@ -36,35 +36,158 @@
  */
 
 #include "vfs.h"
+#include <adt/hash.h>
+#include <adt/hash_table.h>
+#include <adt/list.h>
 #include <async.h>
 #include <fibril_synch.h>
 #include <errno.h>
 #include <as.h>
+#include <assert.h>
+#include <macros.h>
+#include <mem.h>
+#include <stdlib.h>
 
-void vfs_page_in(cap_call_handle_t req_handle, ipc_call_t *request)
+/** Maximum number of resident pages of mapped files. */
+#define VFS_MAP_PAGES	1024
+/** Number of pages read on a random page fault in a mapped file. */
+#define VFS_MAP_RA_MIN	4
+/** Maximum number of pages read on a sequential page fault. */
+#define VFS_MAP_RA_MAX	32
+
+/** Resident page of a mapped file.
+ *
+ * The page is kept in its own address space area, so that the frame can be
+ * handed out to the read-only mappings of all clients instead of a copy.
+ */
+typedef struct {
+	ht_link_t hash_link;	/**< Hash table link. */
+	link_t lru_link;	/**< LRU list link. */
+	link_t node_link;	/**< Link to the list of the node's pages. */
+	vfs_node_t *node;
+	aoff64_t page;
+	void *data;		/**< Address space area holding the data. */
+} vfs_map_page_t;
+
+typedef struct {
+	vfs_node_t *node;
+	aoff64_t page;
+} vfs_map_key_t;
+
+/** Mutex protecting the resident pages and the map generations. */
+static FIBRIL_MUTEX_INITIALIZE(map_mutex);
+/** Hash table of resident pages. */
+static hash_table_t map_hash;
+/** Resident pages, least recently used first. */
+static LIST_INITIALIZE(map_lru);
+/** Number of resident pages. */
+static size_t map_count;
+
+static size_t map_key_hash(void *key)
 {
-	aoff64_t offset = IPC_GET_ARG1(*request);
-	size_t page_size = IPC_GET_ARG2(*request);
-	int fd = IPC_GET_ARG3(*request);
-	void *page;
-	errno_t rc;
+	vfs_map_key_t *mkey = key;
+	return hash_combine((size_t) mkey->node, mkey->page);
+}
 
-	page = as_area_create(AS_AREA_ANY, page_size,
-	    AS_AREA_READ | AS_AREA_WRITE | AS_AREA_CACHEABLE,
-	    AS_AREA_UNPAGED);
+static size_t map_hash_fn(const ht_link_t *item)
+{
+	vfs_map_page_t *p = hash_table_get_inst(item, vfs_map_page_t,
+	    hash_link);
+	vfs_map_key_t key = {
+		.node = p->node,
+		.page = p->page
+	};
 
-	if (page == AS_MAP_FAILED) {
-		async_answer_0(req_handle, ENOMEM);
-		return;
+	return map_key_hash(&key);
+}
+
+static bool map_key_equal(void *key, const ht_link_t *item)
+{
+	vfs_map_key_t *mkey = key;
+	vfs_map_page_t *p = hash_table_get_inst(item, vfs_map_page_t,
+	    hash_link);
+
+	return p->node == mkey->node && p->page == mkey->page;
+}
+
+static hash_table_ops_t map_ops = {
+	.hash = map_hash_fn,
+	.key_hash = map_key_hash,
+	.key_equal = map_key_equal,
+	.equal = NULL,
+	.remove_callback = NULL
+};
+
+/** Initialize the resident pages of mapped files.
+ *
+ * @return		Return true on success, false on failure.
+ */
+bool vfs_pager_init(void)
+{
+	return hash_table_create(&map_hash, 0, 0, &map_ops);
+}
+
+/** Find a resident page. Must be called with map_mutex held. */
+static vfs_map_page_t *map_find(vfs_node_t *node, aoff64_t page)
+{
+	vfs_map_key_t key = {
+		.node = node,
+		.page = page
+	};
+
+	ht_link_t *link = hash_table_find(&map_hash, &key);
+	if (link == NULL)
+		return NULL;
+
+	return hash_table_get_inst(link, vfs_map_page_t, hash_link);
+}
+
+/** Remove and free a resident page. Must be called with map_mutex held.
+ *
+ * Clients which have the page mapped keep their reference to the frame.
+ */
+static void map_remove(vfs_map_page_t *p)
+{
+	hash_table_remove_item(&map_hash, &p->hash_link);
+	list_remove(&p->lru_link);
+	list_remove(&p->node_link);
+	map_count--;
+	as_area_destroy(p->data);
+	free(p);
+}
+
+/** Insert a resident page. Must be called with map_mutex held. */
+static void map_insert(vfs_map_page_t *p)
+{
+	if (map_count == VFS_MAP_PAGES) {
+		map_remove(list_get_instance(list_first(&map_lru),
+		    vfs_map_page_t, lru_link));
 	}
 
+	hash_table_insert(&map_hash, &p->hash_link);
+	list_append(&p->lru_link, &map_lru);
+	list_append(&p->node_link, &p->node->map_pages);
+	map_count++;
+}
+
+/** Read file data into a page.
+ *
+ * @param fd		File descriptor of the mapped file.
+ * @param pos		Position in the file.
+ * @param page		Buffer to fill.
+ * @param page_size	Size of the buffer.
+ *
+ * @return		EOK on success or an error code.
+ */
+static errno_t page_fill(int fd, aoff64_t pos, void *page, size_t page_size)
+{
 	rdwr_io_chunk_t chunk = {
 		.buffer = page,
 		.size = page_size
 	};
 
 	size_t total = 0;
-	aoff64_t pos = offset;
+	errno_t rc = EOK;
 	do {
 		rc = vfs_rdwr_internal(fd, pos, true, &chunk);
 		if (rc != EOK)
@@ -77,15 +200,270 @@ void vfs_page_in(cap_call_handle_t req_handle, ipc_call_t *request)
 		chunk.size = page_size - total;
 	} while (total < page_size);
 
-	async_answer_1(req_handle, rc, (sysarg_t) page);
+	return rc;
+}
+
+/** Make a cluster of pages of a mapped file resident.
+ *
+ * Read the page and up to @a count - 1 pages following it with a single
+ * read from the file system and make those of them that are not resident
+ * yet resident. The cluster ends at the end of the file or at the first
+ * page which is already resident. Pages read while the node was being
+ * modified are discarded.
+ *
+ * @param fd		File descriptor of the mapped file.
+ * @param node		Node of the mapped file.
+ * @param page		First page of the cluster.
+ * @param count		Maximum number of pages in the cluster.
+ *
+ * @return		EOK on success or an error code.
+ */
+static errno_t map_read_ahead(int fd, vfs_node_t *node, aoff64_t page,
+    size_t count)
+{
+	vfs_map_page_t *pages[VFS_MAP_RA_MAX];
+
+	assert(count <= VFS_MAP_RA_MAX);
+
+	/* The size is updated under the contents lock by writers */
+	fibril_rwlock_read_lock(&node->contents_rwlock);
+	aoff64_t size = node->size;
+	fibril_rwlock_read_unlock(&node->contents_rwlock);
+
+	fibril_mutex_lock(&map_mutex);
+	unsigned gen = node->map_gen;
+	aoff64_t end = (size + PAGE_SIZE - 1) / PAGE_SIZE;
+	if (end <= page)
+		count = 1;
+	else if (end - page < count)
+		count = end - page;
+	for (size_t i = 1; i < count; i++) {
+		if (map_find(node, page + i) != NULL) {
+			count = i;
+			break;
+		}
+	}
+	fibril_mutex_unlock(&map_mutex);
+
+	void *buf = as_area_create(AS_AREA_ANY, count * PAGE_SIZE,
+	    AS_AREA_READ | AS_AREA_WRITE | AS_AREA_CACHEABLE,
+	    AS_AREA_UNPAGED);
+	if (buf == AS_MAP_FAILED)
+		return ENOMEM;
+
+	errno_t rc = page_fill(fd, page * PAGE_SIZE, buf, count * PAGE_SIZE);
+	if (rc != EOK) {
+		as_area_destroy(buf);
+		return rc;
+	}
 
 	/*
-	 * FIXME:
-	 * This is just for now until we implement proper page cache
-	 * management.  Not keeping the pages around in a cache results in
-	 * inherently non-coherent private mappings.
+	 * Every resident page lives in its own area, so that the pages can be
+	 * evicted one by one.
 	 */
+	size_t n;
+	for (n = 0; n < count; n++) {
+		pages[n] = malloc(sizeof(vfs_map_page_t));
+		if (pages[n] == NULL)
+			break;
+
+		pages[n]->data = as_area_create(AS_AREA_ANY, PAGE_SIZE,
+		    AS_AREA_READ | AS_AREA_WRITE | AS_AREA_CACHEABLE,
+		    AS_AREA_UNPAGED);
+		if (pages[n]->data == AS_MAP_FAILED) {
+			free(pages[n]);
+			break;
+		}
+
+		memcpy(pages[n]->data, buf + n * PAGE_SIZE, PAGE_SIZE);
+		pages[n]->node = node;
+		pages[n]->page = page + n;
+	}
+
+	as_area_destroy(buf);
+
+	fibril_mutex_lock(&map_mutex);
+	for (size_t i = 0; i < n; i++) {
+		if (node->map_gen == gen &&
+		    map_find(node, pages[i]->page) == NULL) {
+			map_insert(pages[i]);
+		} else {
+			as_area_destroy(pages[i]->data);
+			free(pages[i]);
+		}
+	}
+	fibril_mutex_unlock(&map_mutex);
+
+	return (n > 0) ? EOK : ENOMEM;
+}
+
+/** Handle a page fault in a client area mapping a file.
+ *
+ * The pager arguments of the area are the file descriptor, the position in
+ * the file where the area starts and the VFS_MAP_* flags of the mapping.
+ *
+ * Pages of the file are kept resident and shared by all read-only
+ * mappings, writable mappings get a copy of the resident page. A page
+ * fault which misses the resident pages reads a cluster of pages starting
+ * at the faulting page. The cluster grows while the mapping is faulted in
+ * sequentially.
+ *
+ * Shared mappings always see the current contents of the file. If the file
+ * changes after it has been mapped privately, page faults in the mapping
+ * fail rather than mixing old and new contents.
+ */
+void vfs_page_in(cap_call_handle_t req_handle, ipc_call_t *request)
+{
+	aoff64_t offset = IPC_GET_ARG1(*request);
+	size_t page_size = IPC_GET_ARG2(*request);
+	int fd = IPC_GET_ARG3(*request);
+	aoff64_t pos = IPC_GET_ARG4(*request) + offset;
+	unsigned int mode = IPC_GET_ARG5(*request);
+	void *page;
+	errno_t rc;
+
+	vfs_file_t *file = vfs_file_get(fd);
+	if (file == NULL) {
+		async_answer_0(req_handle, EBADF);
+		return;
+	}
+
+	vfs_node_t *node = file->node;
+	vfs_node_addref(node);
+
+	fibril_mutex_lock(&map_mutex);
+	if (!file->mapped) {
+		file->mapped = true;
+		file->map_gen = node->map_gen;
+	}
+	unsigned gen = file->map_gen;
+
+	/* Sequential page faults double the read-ahead window. */
+	if (pos / PAGE_SIZE == file->map_ra_next) {
+		file->map_ra_pages = min(max(2 * file->map_ra_pages,
+		    VFS_MAP_RA_MIN), VFS_MAP_RA_MAX);
+	} else {
+		file->map_ra_pages = VFS_MAP_RA_MIN;
+	}
+	file->map_ra_next = pos / PAGE_SIZE + 1;
+	size_t ra_pages = file->map_ra_pages;
+	fibril_mutex_unlock(&map_mutex);
+
+	vfs_file_put(file);
+
+	/* Private mappings must not see changes made after the file was mapped */
+	bool check_gen = (mode & VFS_MAP_SHARED) == 0;
+	bool resident = (page_size == PAGE_SIZE) && (pos % PAGE_SIZE == 0);
+
+	if (resident) {
+		fibril_mutex_lock(&map_mutex);
+		if (check_gen && node->map_gen != gen) {
+			rc = EIO;
+			goto error;
+		}
+
+		vfs_map_page_t *p = map_find(node, pos / PAGE_SIZE);
+		if (p == NULL) {
+			fibril_mutex_unlock(&map_mutex);
+
+			rc = map_read_ahead(fd, node, pos / PAGE_SIZE, ra_pages);
+
+			fibril_mutex_lock(&map_mutex);
+			if (check_gen && node->map_gen != gen) {
+				rc = EIO;
+				goto error;
+			}
+
+			if (rc == EOK)
+				p = map_find(node, pos / PAGE_SIZE);
+		}
+
+		if (p != NULL) {
+			list_remove(&p->lru_link);
+			list_append(&p->lru_link, &map_lru);
+
+			if ((mode & VFS_MAP_WRITE) == 0) {
+				/* Answer before the page can be evicted. */
+				async_answer_2(req_handle, EOK,
+				    (sysarg_t) p->data, AS_PAGE_IN_SHARED);
+				fibril_mutex_unlock(&map_mutex);
+				vfs_node_delref(node);
+				return;
+			}
+
+			page = as_area_create(AS_AREA_ANY, PAGE_SIZE,
+			    AS_AREA_READ | AS_AREA_WRITE | AS_AREA_CACHEABLE,
+			    AS_AREA_UNPAGED);
+			if (page == AS_MAP_FAILED) {
+				rc = ENOMEM;
+				goto error;
+			}
+
+			memcpy(page, p->data, PAGE_SIZE);
+			fibril_mutex_unlock(&map_mutex);
+
+			async_answer_1(req_handle, EOK, (sysarg_t) page);
+			as_area_destroy(page);
+			vfs_node_delref(node);
+			return;
+		}
+
+		/*
+		 * The page could not be made resident or it was evicted or
+		 * changed before we could use it.
+		 */
+		fibril_mutex_unlock(&map_mutex);
+	}
+
+	page = as_area_create(AS_AREA_ANY, page_size,
+	    AS_AREA_READ | AS_AREA_WRITE | AS_AREA_CACHEABLE,
+	    AS_AREA_UNPAGED);
+
+	if (page == AS_MAP_FAILED) {
+		vfs_node_delref(node);
+		async_answer_0(req_handle, ENOMEM);
+		return;
+	}
+
+	rc = page_fill(fd, pos, page, page_size);
+
+	fibril_mutex_lock(&map_mutex);
+	if (rc == EOK && check_gen && node->map_gen != gen)
+		rc = EIO;
+
+	if (rc != EOK) {
+		as_area_destroy(page);
+		goto error;
+	}
+	fibril_mutex_unlock(&map_mutex);
+
+	/* The mapping gets its own copy of the data. */
+	async_answer_1(req_handle, EOK, (sysarg_t) page);
 	as_area_destroy(page);
+	vfs_node_delref(node);
+	return;
+
+error:
+	fibril_mutex_unlock(&map_mutex);
+	vfs_node_delref(node);
+	async_answer_0(req_handle, rc);
+}
+
+/** Drop the resident pages of a node.
+ *
+ * Existing mappings of the node stop being served.
+ *
+ * @param node		Node whose contents changed or which is being freed.
+ */
+void vfs_pager_invalidate(vfs_node_t *node)
+{
+	fibril_mutex_lock(&map_mutex);
+	node->map_gen++;
+	while (!list_empty(&node->map_pages)) {
+		map_remove(list_get_instance(list_first(&node->map_pages),
+		    vfs_map_page_t, node_link));
+	}
+	fibril_mutex_unlock(&map_mutex);
 }
 
 /**
@@ -0,0 +1,351 @@
+/*
+ * Copyright (c) 2018 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup fs
+ * @{
+ */
+
+/**
+ * @file vfs_pipe.c
+ * @brief Anonymous pipes.
+ *
+ * A pipe is a ring buffer kept by VFS with two VFS nodes, one for each end.
+ * The nodes do not belong to any file system and are not present in the
+ * node hash table, so the only way to reach them are the file handles
+ * returned by vfs_op_pipe() and their clones passed to other tasks.
+ *
+ * Readers block while the ring is empty and writers while it is full. An end
+ * is gone when the last reference to its node is dropped, which includes the
+ * handles passed to a task that has not opened them yet. A read from a pipe
+ * without a writer returns the remaining data and then zero bytes, a write
+ * to a pipe without a reader fails with EPIPE.
+ */
+
+#include <adt/list.h>
+#include <async.h>
+#include <errno.h>
+#include <fibril_synch.h>
+#include <macros.h>
+#include <mem.h>
+#include <stdlib.h>
+#include <vfs/vfs.h>
+#include "vfs.h"
+
+/** Size of the ring buffer of a pipe */
+#define VFS_PIPE_SIZE  (64 * 1024)
+
+struct vfs_pipe {
+	/** Protects the ring and the ends */
+	fibril_mutex_t lock;
+	/** Signalled when data are added, removed or an end goes away */
+	fibril_condvar_t cv;
+
+	/** Read end, NULL once all its references are gone */
+	vfs_node_t *rnode;
+	/** Write end, NULL once all its references are gone */
+	vfs_node_t *wnode;
+
+	uint8_t buf[VFS_PIPE_SIZE];
+	/** Index of the first unread byte */
+	size_t head;
+	/** Number of unread bytes */
+	size_t count;
+};
+
+static vfs_node_t *vfs_pipe_node_create(vfs_pipe_t *pipe)
+{
+	vfs_node_t *node = calloc(1, sizeof(vfs_node_t));
+	if (node == NULL)
+		return NULL;
+
+	node->type = VFS_NODE_PIPE;
+	node->pipe = pipe;
+	node->refcnt = 1;
+	fibril_rwlock_initialize(&node->contents_rwlock);
+	list_initialize(&node->cache_pages);
+	list_initialize(&node->map_pages);
+
+	return node;
+}
+
+/** Open a new file handle for one end of a pipe. */
+static errno_t vfs_pipe_fd_alloc(vfs_node_t *node, bool read, int *out_fd)
+{
+	vfs_file_t *file;
+	errno_t rc = vfs_fd_alloc(&file, false, out_fd);
+	if (rc != EOK)
+		return rc;
+
+	file->node = node;
+	vfs_node_addref(node);
+
+	if (read) {
+		file->permissions = MODE_READ;
+		file->open_read = true;
+	} else {
+		file->permissions = MODE_WRITE | MODE_APPEND;
+		file->open_write = true;
+	}
+
+	vfs_file_put(file);
+	return EOK;
+}
+
+/** Create a pipe.
+ *
+ * @param out_rfd Place to store the file handle of the read end
+ * @param out_wfd Place to store the file handle of the write end
+ *
+ * @return EOK on success or an error code.
+ */
+errno_t vfs_op_pipe(int *out_rfd, int *out_wfd)
+{
+	vfs_pipe_t *pipe = malloc(sizeof(vfs_pipe_t));
+	if (pipe == NULL)
+		return ENOMEM;
+
+	fibril_mutex_initialize(&pipe->lock);
+	fibril_condvar_initialize(&pipe->cv);
+	pipe->head = 0;
+	pipe->count = 0;
+
+	pipe->rnode = vfs_pipe_node_create(pipe);
+	pipe->wnode = vfs_pipe_node_create(pipe);
+	if (pipe->rnode == NULL || pipe->wnode == NULL) {
+		free(pipe->rnode);
+		free(pipe->wnode);
+		free(pipe);
+		return ENOMEM;
+	}
+
+	/* From now on the nodes own the pipe */
+	vfs_node_t *rnode = pipe->rnode;
+	vfs_node_t *wnode = pipe->wnode;
+
+	*out_rfd = -1;
+	*out_wfd = -1;
+
+	errno_t rc = vfs_pipe_fd_alloc(rnode, true, out_rfd);
+	if (rc == EOK)
+		rc = vfs_pipe_fd_alloc(wnode, false, out_wfd);
+
+	if (rc != EOK && *out_rfd >= 0)
+		vfs_fd_free(*out_rfd);
+
+	/* Drop the creation references, the file handles keep their own */
+	vfs_node_delref(rnode);
+	vfs_node_delref(wnode);
+
+	return rc;
+}
+
+/** Drop the last reference to one end of a pipe.
+ *
+ * Called by vfs_node_delref() instead of destroying the node in a file
+ * system. Frees the node and, once both ends are gone, the pipe.
+ *
+ * @param node Pipe end
+ */
+void vfs_pipe_node_release(vfs_node_t *node)
+{
+	vfs_pipe_t *pipe = node->pipe;
+
+	fibril_mutex_lock(&pipe->lock);
+
+	if (pipe->rnode == node)
+		pipe->rnode = NULL;
+	else
+		pipe->wnode = NULL;
+
+	bool last = (pipe->rnode == NULL && pipe->wnode == NULL);
+	fibril_condvar_broadcast(&pipe->cv);
+	fibril_mutex_unlock(&pipe->lock);
+
+	free(node);
+	if (last)
+		free(pipe);
+}
+
+/** Answer the client's IPC_M_DATA_READ from a pipe.
+ *
+ * Blocks until some data are available or the write end is gone.
+ *
+ * @param node      Read end of the pipe
+ * @param out_bytes Place to store the number of bytes read
+ *
+ * @return EOK on success or an error code.
+ */
+errno_t vfs_pipe_read(vfs_node_t *node, size_t *out_bytes)
+{
+	vfs_pipe_t *pipe = node->pipe;
+	cap_call_handle_t chandle;
+	size_t size;
+
+	*out_bytes = 0;
+
+	if (!async_data_read_receive(&chandle, &size))
+		return EINVAL;
+
+	if (pipe->rnode != node) {
+		async_answer_0(chandle, EBADF);
+		return EBADF;
+	}
+
+	size = min(size, (size_t) VFS_PIPE_SIZE);
+	uint8_t *buf = malloc(max(size, (size_t) 1));
+	if (buf == NULL) {
+		async_answer_0(chandle, ENOMEM);
+		return ENOMEM;
+	}
+
+	fibril_mutex_lock(&pipe->lock);
+
+	while (pipe->count == 0 && pipe->wnode != NULL && size > 0)
+		fibril_condvar_wait(&pipe->cv, &pipe->lock);
+
+	size_t bytes = min(size, pipe->count);
+	size_t first = min(bytes, VFS_PIPE_SIZE - pipe->head);
+	memcpy(buf, pipe->buf + pipe->head, first);
+	memcpy(buf + first, pipe->buf, bytes - first);
+
+	pipe->head = (pipe->head + bytes) % VFS_PIPE_SIZE;
+	pipe->count -= bytes;
+	if (pipe->count == 0)
+		pipe->head = 0;
+
+	if (bytes > 0)
+		fibril_condvar_broadcast(&pipe->cv);
+
+	fibril_mutex_unlock(&pipe->lock);
+
+	errno_t rc = async_data_read_finalize(chandle, buf, bytes);
+	free(buf);
+
+	if (rc == EOK)
+		*out_bytes = bytes;
+	return rc;
+}
+
+/** Accept the client's IPC_M_DATA_WRITE into a pipe.
+ *
+ * Blocks until all the data fit into the ring or the read end is gone.
+ *
+ * @param node      Write end of the pipe
+ * @param out_bytes Place to store the number of bytes written
+ *
+ * @return EOK on success, EPIPE if there is no reader or another error code.
+ */
+errno_t vfs_pipe_write(vfs_node_t *node, size_t *out_bytes)
+{
+	vfs_pipe_t *pipe = node->pipe;
+	cap_call_handle_t chandle;
+	size_t size;
+
+	*out_bytes = 0;
+
+	if (!async_data_write_receive(&chandle, &size))
+		return EINVAL;
+
+	if (pipe->wnode != node) {
+		async_answer_0(chandle, EBADF);
+		return EBADF;
+	}
+
+	uint8_t *buf = malloc(max(size, (size_t) 1));
+	if (buf == NULL) {
+		async_answer_0(chandle, ENOMEM);
+		return ENOMEM;
+	}
+
+	errno_t rc = async_data_write_finalize(chandle, buf, size);
+	if (rc != EOK) {
+		free(buf);
+		return rc;
+	}
+
+	size_t done = 0;
+
+	fibril_mutex_lock(&pipe->lock);
+
+	while (done < size) {
+		if (pipe->rnode == NULL) {
+			rc = EPIPE;
+			break;
+		}
+
+		if (pipe->count == VFS_PIPE_SIZE) {
+			fibril_condvar_wait(&pipe->cv, &pipe->lock);
+			continue;
+		}
+
+		size_t tail = (pipe->head + pipe->count) % VFS_PIPE_SIZE;
+		size_t chunk = min(size - done, VFS_PIPE_SIZE - pipe->count);
+		chunk = min(chunk, VFS_PIPE_SIZE - tail);
+
+		memcpy(pipe->buf + tail, buf + done, chunk);
+		pipe->count += chunk;
+		done += chunk;
+
+		fibril_condvar_broadcast(&pipe->cv);
+	}
+
+	fibril_mutex_unlock(&pipe->lock);
+	free(buf);
+
+	*out_bytes = done;
+	return (done > 0) ? EOK : rc;
+}
+
+/** Answer the client's IPC_M_DATA_READ with the attributes of a pipe end.
+ *
+ * @param node Pipe end
+ *
+ * @return EOK on success or an error code.
+ */
+errno_t vfs_pipe_stat(vfs_node_t *node)
+{
+	cap_call_handle_t chandle;
+	size_t size;
+
+	if (!async_data_read_receive(&chandle, &size))
+		return EINVAL;
+
+	vfs_stat_t stat;
+	memset(&stat, 0, sizeof(stat));
+
+	fibril_mutex_lock(&node->pipe->lock);
+	stat.size = node->pipe->count;
+	fibril_mutex_unlock(&node->pipe->lock);
+
+	return async_data_read_finalize(chandle, &stat,
+	    min(size, sizeof(stat)));
+}
+
+/**
+ * @}
+ */